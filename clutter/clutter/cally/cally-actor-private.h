@@ -39,4 +39,6 @@ void _cally_actor_get_top_level_origin (ClutterActor *actor,
                                         gint         *x,
                                         gint         *y);
 
+void _cally_actor_track_children (CallyActor *cally_actor);
+
 #endif /* __CALLY_ACTOR_PRIVATE_H__ */
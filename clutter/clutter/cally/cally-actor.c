@@ -179,9 +179,15 @@ struct _CallyActorPrivate
   guint   action_idle_handler;
   GList  *action_list;
 
+  /* The children, kept once an AT client has asked for them: until
+   * then there is nobody to tell about changes in them, so no
+   * accessible is made for them either */
   GList *children;
+  guint  track_children : 1;
 };
 
+static GQuark quark_accessible = 0;
+
 G_DEFINE_TYPE_WITH_CODE (CallyActor,
                          cally_actor,
                          ATK_TYPE_GOBJECT_ACCESSIBLE,
@@ -240,7 +246,7 @@ cally_actor_initialize (AtkObject *obj,
   g_object_set_data (G_OBJECT (obj), "atk-component-layer",
                      GINT_TO_POINTER (ATK_LAYER_MDI));
 
-  priv->children = clutter_actor_get_children (actor);
+  g_object_set_qdata (G_OBJECT (actor), quark_accessible, obj);
 
   /*
    * We store the handler ids for these signals in case some objects
@@ -269,6 +275,8 @@ cally_actor_class_init (CallyActorClass *klass)
   AtkObjectClass *class         = ATK_OBJECT_CLASS (klass);
   GObjectClass   *gobject_class = G_OBJECT_CLASS (klass);
 
+  quark_accessible = g_quark_from_static_string ("cally-actor-accessible");
+
   klass->notify_clutter = cally_actor_real_notify_clutter;
   klass->add_actor      = cally_actor_real_add_actor;
   klass->remove_actor   = cally_actor_real_remove_actor;
@@ -487,6 +495,8 @@ cally_actor_get_n_children (AtkObject *obj)
 
   g_return_val_if_fail (CLUTTER_IS_ACTOR (actor), 0);
 
+  _cally_actor_track_children (CALLY_ACTOR (obj));
+
   return clutter_actor_get_n_children (actor);
 }
 
@@ -505,6 +515,8 @@ cally_actor_ref_child (AtkObject *obj,
 
   g_return_val_if_fail (CLUTTER_IS_ACTOR (actor), NULL);
 
+  _cally_actor_track_children (CALLY_ACTOR (obj));
+
   if (i >= clutter_actor_get_n_children (actor))
     return NULL;
 
@@ -530,6 +542,38 @@ cally_actor_get_attributes (AtkObject *obj)
   return attributes;
 }
 
+/*
+ * _cally_actor_track_children:
+ * @cally_actor: a #CallyActor
+ *
+ * Called whenever the children of @cally_actor are asked for. From then
+ * on children being added and removed are announced, which means
+ * making accessibles for the new ones.
+ */
+void
+_cally_actor_track_children (CallyActor *cally_actor)
+{
+  CallyActorPrivate *priv = cally_actor->priv;
+  ClutterActor *actor;
+
+  if (priv->track_children)
+    return;
+
+  actor = CALLY_GET_CLUTTER_ACTOR (cally_actor);
+  if (actor == NULL) /* State is defunct */
+    return;
+
+  priv->track_children = TRUE;
+  priv->children = clutter_actor_get_children (actor);
+}
+
+/* Returns the accessible of @actor if it has one already */
+static AtkObject *
+peek_accessible (ClutterActor *actor)
+{
+  return g_object_get_qdata (G_OBJECT (actor), quark_accessible);
+}
+
 /* ClutterContainer */
 static gint
 cally_actor_add_actor (ClutterActor *container,
@@ -570,7 +614,7 @@ cally_actor_real_add_actor (ClutterActor *container,
                             gpointer      data)
 {
   AtkObject        *atk_parent = ATK_OBJECT (data);
-  AtkObject        *atk_child  = clutter_actor_get_accessible (actor);
+  AtkObject        *atk_child  = NULL;
   CallyActor        *cally_actor = CALLY_ACTOR (atk_parent);
   CallyActorPrivate *priv       = cally_actor->priv;
   gint              index;
@@ -578,6 +622,11 @@ cally_actor_real_add_actor (ClutterActor *container,
   g_return_val_if_fail (CLUTTER_IS_CONTAINER (container), 0);
   g_return_val_if_fail (CLUTTER_IS_ACTOR (actor), 0);
 
+  if (!priv->track_children)
+    return 1;
+
+  atk_child = clutter_actor_get_accessible (actor);
+
   g_object_notify (G_OBJECT (atk_child), "accessible_parent");
 
   g_list_free (priv->children);
@@ -606,7 +655,13 @@ cally_actor_real_remove_actor (ClutterActor *container,
   g_return_val_if_fail (CLUTTER_IS_ACTOR (actor), 0);
 
   atk_parent = ATK_OBJECT (data);
-  atk_child = clutter_actor_get_accessible (actor);
+  priv = CALLY_ACTOR (atk_parent)->priv;
+
+  if (!priv->track_children)
+    return 1;
+
+  /* Nobody can be holding on to an accessible that was never made */
+  atk_child = peek_accessible (actor);
 
   if (atk_child)
     {
@@ -621,7 +676,6 @@ cally_actor_real_remove_actor (ClutterActor *container,
       g_object_unref (atk_child);
     }
 
-  priv = CALLY_ACTOR (atk_parent)->priv;
   index = g_list_index (priv->children, actor);
   g_list_free (priv->children);
 
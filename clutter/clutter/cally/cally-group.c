@@ -105,6 +105,8 @@ cally_group_get_n_children (AtkObject *obj)
 
   g_return_val_if_fail (CLUTTER_IS_GROUP(actor), count);
 
+  _cally_actor_track_children (CALLY_ACTOR (obj));
+
   count = clutter_actor_get_n_children (actor);
 
   return count;
@@ -124,6 +126,9 @@ cally_group_ref_child (AtkObject *obj,
   actor = CALLY_GET_CLUTTER_ACTOR (obj);
 
   g_return_val_if_fail (CLUTTER_IS_GROUP(actor), NULL);
+
+  _cally_actor_track_children (CALLY_ACTOR (obj));
+
   child = clutter_actor_get_child_at_index (actor, i);
 
   if (!child)
@@ -132,7 +132,8 @@ static void                 _cally_text_delete_text_cb           (ClutterText *c
                                                                   gint         start_pos,
                                                                   gint         end_pos,
                                                                   gpointer     data);
-static gboolean             _idle_notify_insert                  (gpointer data);
+static gboolean             _idle_notify_changes                 (gpointer data);
+static void                 _queue_notify_changes                (CallyText *cally_text);
 static void                 _notify_insert                       (CallyText *cally_text);
 static void                 _notify_delete                       (CallyText *cally_text);
 
@@ -184,13 +185,18 @@ struct _CallyTextPrivate
   const gchar *signal_name_insert;
   gint position_insert;
   gint length_insert;
-  guint insert_idle_handler;
 
   /* text_changed::delete stuff */
   const gchar *signal_name_delete;
   gint position_delete;
   gint length_delete;
 
+  /* Insertions and the caret moving are announced together in an
+   * idle, so typing a word sends one notification for it instead of
+   * one per keystroke */
+  guint notify_idle_handler;
+  guint caret_moved : 1;
+
   /* action */
   guint activate_action_id;
 };
@@ -232,12 +238,14 @@ cally_text_init (CallyText *cally_text)
   priv->signal_name_insert = NULL;
   priv->position_insert = -1;
   priv->length_insert = -1;
-  priv->insert_idle_handler = 0;
 
   priv->signal_name_delete = NULL;
   priv->position_delete = -1;
   priv->length_delete = -1;
 
+  priv->notify_idle_handler = 0;
+  priv->caret_moved = FALSE;
+
   priv->activate_action_id = 0;
 }
 
@@ -249,10 +257,10 @@ cally_text_finalize   (GObject *obj)
 /*   g_object_unref (cally_text->priv->textutil); */
 /*   cally_text->priv->textutil = NULL; */
 
-  if (cally_text->priv->insert_idle_handler)
+  if (cally_text->priv->notify_idle_handler)
     {
-      g_source_remove (cally_text->priv->insert_idle_handler);
-      cally_text->priv->insert_idle_handler = 0;
+      g_source_remove (cally_text->priv->notify_idle_handler);
+      cally_text->priv->notify_idle_handler = 0;
     }
 
   G_OBJECT_CLASS (cally_text_parent_class)->finalize (obj);
@@ -1564,6 +1572,11 @@ _cally_text_delete_text_cb (ClutterText *clutter_text,
 
   cally_text = CALLY_TEXT (data);
 
+  /* Keep the changes in order */
+  _notify_insert (cally_text);
+
+  /* Unlike insertions, deletions can't wait: the bridge reads the
+   * removed text from us when the signal is emitted */
   if (!cally_text->priv->signal_name_delete)
     {
       cally_text->priv->signal_name_delete = "text_changed::delete";
@@ -1582,25 +1595,32 @@ _cally_text_insert_text_cb (ClutterText *clutter_text,
                             gpointer     data)
 {
   CallyText *cally_text = NULL;
+  CallyTextPrivate *priv;
+  gint length;
 
   g_return_if_fail (CALLY_IS_TEXT (data));
 
   cally_text = CALLY_TEXT (data);
+  priv = cally_text->priv;
+  length = g_utf8_strlen (new_text, new_text_length);
 
-  if (!cally_text->priv->signal_name_insert)
+  /* Extend the pending insertion when typing on at its end, otherwise
+   * announce it first */
+  if (priv->signal_name_insert &&
+      *position == priv->position_insert + priv->length_insert)
     {
-      cally_text->priv->signal_name_insert = "text_changed::insert";
-      cally_text->priv->position_insert = *position;
-      cally_text->priv->length_insert = g_utf8_strlen (new_text, new_text_length);
+      priv->length_insert += length;
+    }
+  else
+    {
+      _notify_insert (cally_text);
+
+      priv->signal_name_insert = "text_changed::insert";
+      priv->position_insert = *position;
+      priv->length_insert = length;
     }
 
-  /*
-   * The signal will be emitted when the cursor position is updated,
-   * or in an idle handler if it not updated.
-   */
-  if (cally_text->priv->insert_idle_handler == 0)
-    cally_text->priv->insert_idle_handler = clutter_threads_add_idle (_idle_notify_insert,
-                                                                      cally_text);
+  _queue_notify_changes (cally_text);
 }
 
 /***** atkeditabletext.h ******/
@@ -1701,8 +1721,9 @@ cally_text_notify_clutter (GObject    *obj,
       if (_check_for_selection_change (cally_text, clutter_text))
         g_signal_emit_by_name (atk_obj, "text_selection_changed");
 
-      g_signal_emit_by_name (atk_obj, "text_caret_moved",
-                             clutter_text_get_cursor_position (clutter_text));
+      /* Announced after the text changes that moved it */
+      cally_text->priv->caret_moved = TRUE;
+      _queue_notify_changes (cally_text);
     }
   else if (g_strcmp0 (pspec->name, "selection-bound") == 0)
     {
@@ -1768,18 +1789,35 @@ _check_for_selection_change (CallyText *cally_text,
 }
 
 static gboolean
-_idle_notify_insert (gpointer data)
+_idle_notify_changes (gpointer data)
 {
   CallyText *cally_text = NULL;
+  ClutterActor *actor;
 
   cally_text = CALLY_TEXT (data);
-  cally_text->priv->insert_idle_handler = 0;
+  cally_text->priv->notify_idle_handler = 0;
 
   _notify_insert (cally_text);
 
+  actor = CALLY_GET_CLUTTER_ACTOR (cally_text);
+
+  if (cally_text->priv->caret_moved && actor != NULL)
+    g_signal_emit_by_name (cally_text, "text_caret_moved",
+                           clutter_text_get_cursor_position (CLUTTER_TEXT (actor)));
+
+  cally_text->priv->caret_moved = FALSE;
+
   return FALSE;
 }
 
+static void
+_queue_notify_changes (CallyText *cally_text)
+{
+  if (cally_text->priv->notify_idle_handler == 0)
+    cally_text->priv->notify_idle_handler =
+      clutter_threads_add_idle (_idle_notify_changes, cally_text);
+}
+
 static void
 _notify_insert (CallyText *cally_text)
 {
@@ -288,6 +288,8 @@ void                            _clutter_actor_set_queue_redraw_clip
                                                                                          ClutterPaintVolume *clip_volume);
 void                            _clutter_actor_finish_queue_redraw                      (ClutterActor       *self,
                                                                                          ClutterPaintVolume *clip);
+gboolean                        _clutter_actor_coalesce_queue_redraw                    (ClutterActor       *self,
+                                                                                         ClutterActor       *ancestor);
 
 gboolean                        _clutter_actor_set_default_paint_volume                 (ClutterActor       *self,
                                                                                          GType               check_gtype,
@@ -316,6 +318,21 @@ void                            _clutter_actor_detach_clone
 void                            _clutter_actor_queue_redraw_on_clones                   (ClutterActor *actor);
 void                            _clutter_actor_queue_relayout_on_clones                 (ClutterActor *actor);
 void                            _clutter_actor_queue_only_relayout                      (ClutterActor *actor);
+void                            _clutter_actor_relayout_root                            (ClutterActor *actor);
+
+cairo_region_t *                _clutter_actor_get_opaque_region                        (ClutterActor *actor);
+gboolean                        _clutter_actor_paint_volume_covers_children             (ClutterActor *actor);
+void                            _clutter_actor_set_occluded                             (ClutterActor *actor,
+                                                                                         gboolean      occluded);
+
+gboolean                        _clutter_actor_set_animatable_value                     (ClutterActor *actor,
+                                                                                         GParamSpec   *pspec,
+                                                                                         const GValue *value);
+#ifdef CLUTTER_ENABLE_DEBUG
+guint                           _clutter_actor_get_allocation_count                     (void);
+void                            _clutter_actor_get_size_request_stats                   (guint *hits,
+                                                                                         guint *misses);
+#endif
 
 CoglFramebuffer *               _clutter_actor_get_active_framebuffer                   (ClutterActor *actor);
 
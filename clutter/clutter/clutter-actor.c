@@ -635,6 +635,7 @@
 #include "clutter-interval.h"
 #include "clutter-main.h"
 #include "clutter-marshal.h"
+#include "clutter-offscreen-effect-private.h"
 #include "clutter-paint-nodes.h"
 #include "clutter-paint-node-private.h"
 #include "clutter-paint-volume-private.h"
@@ -669,17 +670,28 @@ typedef enum {
 } MapStateChange;
 
 /* 3 entries should be a good compromise, few layout managers
- * will ask for 3 different preferred size in each allocation cycle */
+ * will ask for 3 different preferred size in each allocation cycle;
+ * actors that do get asked for more, like text inside box or flow
+ * layouts, get a larger cache of up to MAX_CACHED_SIZE_REQUESTS */
 #define N_CACHED_SIZE_REQUESTS 3
+#define MAX_CACHED_SIZE_REQUESTS 16
 
 struct _ClutterActorPrivate
 {
   /* request mode */
   ClutterRequestMode request_mode;
 
-  /* our cached size requests for different width / height */
-  SizeRequest width_requests[N_CACHED_SIZE_REQUESTS];
-  SizeRequest height_requests[N_CACHED_SIZE_REQUESTS];
+  /* our cached size requests for different width / height; these
+   * point to the embedded arrays until an entry has been evicted
+   * before the next relayout, and then to allocated ones twice as
+   * large
+   */
+  SizeRequest *width_requests;
+  SizeRequest *height_requests;
+  SizeRequest embedded_width_requests[N_CACHED_SIZE_REQUESTS];
+  SizeRequest embedded_height_requests[N_CACHED_SIZE_REQUESTS];
+  guint8 n_width_requests;
+  guint8 n_height_requests;
 
   /* An age of 0 means the entry is not set */
   guint cached_height_age;
@@ -706,6 +718,15 @@ struct _ClutterActorPrivate
      offscreen-redirect property */
   ClutterEffect *flatten_effect;
 
+  /* For CLUTTER_OFFSCREEN_REDIRECT_AUTOMATIC_FOR_STATIC: the number of
+     actors the last paint without the flatten effect went through, the
+     number of paints in a row the actor wasn't dirty for, and the size
+     of its image counted against the memory cap while it is flattened
+     because of it */
+  guint paint_cost;
+  guint n_static_paints;
+  gsize static_flatten_bytes;
+
   /* scene graph */
   ClutterActor *parent;
   ClutterActor *prev_sibling;
@@ -726,6 +747,7 @@ struct _ClutterActorPrivate
   gchar *name; /* a non-unique name, used for debugging */
 
   gint32 pick_id; /* per-stage unique id, used for picking */
+  guint pick_pass; /* the pick pass pick_id was given out for */
 
   /* a back-pointer to the Pango context that we can use
    * to create pre-configured PangoLayout
@@ -781,8 +803,31 @@ struct _ClutterActorPrivate
    */
   ClutterPaintVolume last_paint_volume;
 
+  /* The eye transform last_paint_volume was computed with, and what
+   * each of them was derived from, so that an actor that didn't move
+   * relative to the stage can keep its last_paint_volume from one
+   * paint to the next and its children only have to apply their own
+   * transform on top of it; see _clutter_actor_update_eye_transform()
+   */
+  CoglMatrix eye_transform;
+  guint64 eye_transform_generation;
+  guint64 eye_parent_generation;
+  guint eye_transform_serial;
+  guint eye_paint_volume_serial;
+  guint eye_paint_serial;
+
+  /* bumped each time priv->transform and priv->paint_volume are
+   * recomputed */
+  guint transform_serial;
+  guint paint_volume_serial;
+
   ClutterStageQueueRedrawEntry *queue_redraw_entry;
 
+  /* the paint nodes of the last paint, if retain_paint_nodes is set,
+   * and the paint opacity they were built for */
+  ClutterPaintNode *retained_paint_node;
+  guint8 retained_paint_opacity;
+
   ClutterColor bg_color;
 
 #ifdef CLUTTER_ENABLE_DEBUG
@@ -841,6 +886,16 @@ struct _ClutterActorPrivate
   guint needs_x_expand              : 1;
   guint needs_y_expand              : 1;
   guint needs_paint_volume_update   : 1;
+  guint eye_transform_valid         : 1;
+  /* last_paint_volume was computed from eye_transform */
+  guint eye_paint_volume_valid      : 1;
+  guint retain_paint_nodes          : 1;
+  /* set by the stage for the duration of a paint if the actor is
+   * entirely covered by opaque actors painted after it */
+  guint occluded                    : 1;
+  /* the out-of-band queue redraw clip only covers what changed in
+   * the actor, rather than also where it moves to */
+  guint queue_redraw_clip_is_damage : 1;
 };
 
 enum
@@ -1047,6 +1102,7 @@ static void clutter_actor_set_natural_height_set (ClutterActor *self,
 static void clutter_actor_update_map_state       (ClutterActor  *self,
                                                   MapStateChange change);
 static void clutter_actor_unrealize_not_hiding   (ClutterActor *self);
+static void clutter_actor_clear_retained_paint_node (ClutterActor *self);
 
 /* Helper routines for managing anchor coords */
 static void clutter_anchor_coord_get_units (ClutterActor      *self,
@@ -1102,6 +1158,26 @@ static void     clutter_actor_unrealize_internal        (ClutterActor *self);
   { _transform; }                                                      \
   cogl_matrix_translate ((m), -_tx, -_ty, -_tz);        } G_STMT_END
 
+#ifdef CLUTTER_ENABLE_DEBUG
+/* the number of clutter_actor_allocate() calls, so that a relayout can
+ * tell how many actors it visited, and how well the size request
+ * caches did */
+static guint allocation_count = 0;
+
+/* How long an actor with CLUTTER_OFFSCREEN_REDIRECT_AUTOMATIC_FOR_STATIC
+ * has to stay unchanged, and how many actors painting it has to go
+ * through, before it is flattened, and how much memory the images of
+ * all the actors flattened that way can use */
+#define STATIC_FLATTEN_MIN_PAINTS       5
+#define STATIC_FLATTEN_MIN_COST         16
+#define STATIC_FLATTEN_MAX_BYTES        (32 * 1024 * 1024)
+
+static guint n_actors_painted = 0;
+static gsize static_flatten_bytes = 0;
+static guint size_request_hits = 0;
+static guint size_request_misses = 0;
+#endif
+
 static GQuark quark_shader_data = 0;
 static GQuark quark_actor_layout_info = 0;
 static GQuark quark_actor_transform_info = 0;
@@ -1495,8 +1571,8 @@ clutter_actor_update_map_state (ClutterActor  *self,
 static void
 clutter_actor_real_map (ClutterActor *self)
 {
-  ClutterActorPrivate *priv = self->priv;
-  ClutterActor *stage, *iter;
+  ClutterActor *stage;
+  ClutterActor *iter;
 
   g_assert (!CLUTTER_ACTOR_IS_MAPPED (self));
 
@@ -1508,11 +1584,8 @@ clutter_actor_real_map (ClutterActor *self)
   self->priv->needs_paint_volume_update = TRUE;
 
   stage = _clutter_actor_get_stage_internal (self);
-  priv->pick_id = _clutter_stage_acquire_pick_id (CLUTTER_STAGE (stage), self);
-
-  CLUTTER_NOTE (ACTOR, "Pick id '%d' for actor '%s'",
-                priv->pick_id,
-                _clutter_actor_get_debug_name (self));
+  if (stage != NULL)
+    _clutter_stage_invalidate_pick (CLUTTER_STAGE (stage));
 
   /* notify on parent mapped before potentially mapping
    * children, so apps see a top-down notification.
@@ -1582,6 +1655,7 @@ static void
 clutter_actor_real_unmap (ClutterActor *self)
 {
   ClutterActorPrivate *priv = self->priv;
+  ClutterActor *stage;
   ClutterActor *iter;
 
   g_assert (CLUTTER_ACTOR_IS_MAPPED (self));
@@ -1598,11 +1672,25 @@ clutter_actor_real_unmap (ClutterActor *self)
 
   CLUTTER_ACTOR_UNSET_FLAGS (self, CLUTTER_ACTOR_MAPPED);
 
+  /* the previous picks may have found the actor */
+  stage = _clutter_actor_get_stage_internal (self);
+  if (stage != NULL)
+    _clutter_stage_invalidate_pick (CLUTTER_STAGE (stage));
+
   /* clear the contents of the last paint volume, so that hiding + moving +
    * showing will not result in the wrong area being repainted
    */
   _clutter_paint_volume_init_static (&priv->last_paint_volume, NULL);
   priv->last_paint_volume_valid = TRUE;
+  priv->eye_paint_volume_valid = FALSE;
+
+  /* the actor may be mapped on another stage next, whose pick passes
+   * are counted separately */
+  priv->pick_id = -1;
+
+  /* don't keep the resources of the retained paint nodes alive while
+   * the actor can't be painted */
+  clutter_actor_clear_retained_paint_node (self);
 
   /* notify on parent mapped after potentially unmapping
    * children, so apps see a bottom-up notification.
@@ -1616,11 +1704,6 @@ clutter_actor_real_unmap (ClutterActor *self)
 
       stage = CLUTTER_STAGE (_clutter_actor_get_stage_internal (self));
 
-      if (stage != NULL)
-        _clutter_stage_release_pick_id (stage, priv->pick_id);
-
-      priv->pick_id = -1;
-
       if (stage != NULL &&
           clutter_stage_get_key_focus (stage) == self)
         {
@@ -2227,19 +2310,14 @@ clutter_actor_real_pick (ClutterActor       *self,
   if (clutter_actor_should_pick_paint (self))
     {
       ClutterActorBox box = { 0, };
-      float width, height;
+      ClutterActorBox pick_box = { 0, };
 
       clutter_actor_get_allocation_box (self, &box);
 
-      width = box.x2 - box.x1;
-      height = box.y2 - box.y1;
-
-      cogl_set_source_color4ub (color->red,
-                                color->green,
-                                color->blue,
-                                color->alpha);
+      pick_box.x2 = box.x2 - box.x1;
+      pick_box.y2 = box.y2 - box.y1;
 
-      cogl_rectangle (0, 0, width, height);
+      clutter_actor_pick_box (self, &pick_box);
     }
 
   /* XXX - this thoroughly sucks, but we need to maintain compatibility
@@ -2260,6 +2338,52 @@ clutter_actor_real_pick (ClutterActor       *self,
     }
 }
 
+/**
+ * clutter_actor_pick_box:
+ * @self: A #ClutterActor
+ * @box: a #ClutterActorBox, in @self's coordinate space
+ *
+ * Marks @box as part of the silhouette of @self while picking. Should
+ * be called inside the implementation of the #ClutterActor::pick
+ * virtual function, instead of painting the silhouette with Cogl, so
+ * that the actor can be picked both by rendering the pick buffer and
+ * by a geometric pick (see clutter_stage_set_geometric_picking()).
+ *
+ * This function should never be called directly by applications.
+ */
+void
+clutter_actor_pick_box (ClutterActor          *self,
+                        const ClutterActorBox *box)
+{
+  ClutterStage *stage;
+
+  g_return_if_fail (CLUTTER_IS_ACTOR (self));
+  g_return_if_fail (box != NULL);
+
+  if (box->x1 >= box->x2 || box->y1 >= box->y2)
+    return;
+
+  stage = (ClutterStage *) _clutter_actor_get_stage_internal (self);
+
+  if (stage != NULL && _clutter_stage_is_logging_picks (stage))
+    {
+      _clutter_stage_log_pick (stage, box, self);
+    }
+  else
+    {
+      ClutterColor color = { 0, };
+
+      _clutter_id_to_color (_clutter_actor_get_pick_id (self), &color);
+
+      cogl_set_source_color4ub (color.red,
+                                color.green,
+                                color.blue,
+                                color.alpha);
+
+      cogl_rectangle (box->x1, box->y1, box->x2, box->y2);
+    }
+}
+
 /**
  * clutter_actor_should_pick_paint:
  * @self: A #ClutterActor
@@ -2496,11 +2620,16 @@ clutter_actor_set_allocation_internal (ClutterActor           *self,
       x2_changed ||
       y2_changed)
     {
+      ClutterActor *stage = _clutter_actor_get_stage_internal (self);
+
       CLUTTER_NOTE (LAYOUT, "Allocation for '%s' changed",
                     _clutter_actor_get_debug_name (self));
 
       priv->transform_valid = FALSE;
 
+      if (stage != NULL)
+        _clutter_stage_invalidate_pick (CLUTTER_STAGE (stage));
+
       g_object_notify_by_pspec (obj, obj_props[PROP_ALLOCATION]);
 
       /* if the allocation changes, so does the content box */
@@ -2670,6 +2799,61 @@ _clutter_actor_signal_queue_redraw (ClutterActor *self,
     }
 }
 
+/* Lets the offscreen effects of @self know that a redraw queued on
+ * @origin is going to change what they would render, so that they can
+ * update only the changed part of their cached image when that is all
+ * the redraw touches.
+ */
+static void
+_clutter_actor_queue_effects_damage (ClutterActor *self,
+                                     ClutterActor *origin)
+{
+  ClutterPaintVolume *clip = NULL;
+  ClutterEffect *last_enabled = NULL;
+  const GList *effects, *l;
+
+  if (self->priv->effects == NULL)
+    return;
+
+  if (origin != NULL && origin->priv->queue_redraw_clip_is_damage)
+    clip = _clutter_actor_get_queue_redraw_clip (origin);
+
+  effects = _clutter_meta_group_peek_metas (self->priv->effects);
+  for (l = effects; l != NULL; l = l->next)
+    {
+      if (clutter_actor_meta_get_enabled (l->data))
+        last_enabled = l->data;
+    }
+
+  for (l = effects; l != NULL; l = l->next)
+    {
+      ClutterPaintVolume pv;
+      ClutterActorBox box;
+
+      if (!CLUTTER_IS_OFFSCREEN_EFFECT (l->data))
+        continue;
+
+      /* Only the last effect renders the actor itself; the others
+       * render the output of the effects after them, which may spread
+       * the change over a larger area */
+      if (clip == NULL || l->data != last_enabled)
+        {
+          _clutter_offscreen_effect_queue_damage (l->data, NULL);
+          continue;
+        }
+
+      if (clip->is_empty)
+        continue;
+
+      _clutter_paint_volume_copy_static (clip, &pv);
+      _clutter_paint_volume_transform_relative (&pv, self);
+      _clutter_paint_volume_get_bounding_box (&pv, &box);
+      clutter_paint_volume_free (&pv);
+
+      _clutter_offscreen_effect_queue_damage (l->data, &box);
+    }
+}
+
 static void
 clutter_actor_real_queue_redraw (ClutterActor *self,
                                  ClutterActor *origin)
@@ -2693,6 +2877,8 @@ clutter_actor_real_queue_redraw (ClutterActor *self,
       self->priv->effect_to_redraw = NULL;
     }
 
+  _clutter_actor_queue_effects_damage (self, origin);
+
   /* If the actor isn't visible, we still had to emit the signal
    * to allow for a ClutterClone, but the appearance of the parent
    * won't change so we don't have to propagate up the hierarchy.
@@ -2712,7 +2898,16 @@ clutter_actor_real_queue_redraw (ClutterActor *self,
       ClutterActor *stage = _clutter_actor_get_stage_internal (self);
       if (stage != NULL &&
           _clutter_stage_has_full_redraw_queued (CLUTTER_STAGE (stage)))
-        return;
+        {
+          /* our parents are dirty already, but the cached images of
+           * their offscreen effects still need to know what changed */
+          for (parent = self->priv->parent;
+               parent != NULL;
+               parent = parent->priv->parent)
+            _clutter_actor_queue_effects_damage (parent, origin);
+
+          return;
+        }
     }
 
   self->priv->propagated_one_redraw = TRUE;
@@ -2744,15 +2939,99 @@ clutter_actor_real_queue_relayout (ClutterActor *self)
 
   /* reset the cached size requests */
   memset (priv->width_requests, 0,
-          N_CACHED_SIZE_REQUESTS * sizeof (SizeRequest));
+          priv->n_width_requests * sizeof (SizeRequest));
   memset (priv->height_requests, 0,
-          N_CACHED_SIZE_REQUESTS * sizeof (SizeRequest));
+          priv->n_height_requests * sizeof (SizeRequest));
 
-  /* We need to go all the way up the hierarchy */
-  if (priv->parent != NULL)
-    _clutter_actor_queue_only_relayout (priv->parent);
+  if (priv->parent == NULL)
+    return;
+
+  /* A parent that manages the layout of its children by itself just
+   * gives them their preferred size at their fixed position, so this
+   * actor can be allocated again on its own as a relayout root; the
+   * stage checks afterwards whether the parent's size request changed
+   */
+  if (priv->parent->flags & CLUTTER_ACTOR_NO_LAYOUT)
+    {
+      ClutterActor *stage = _clutter_actor_get_stage_internal (self);
+
+      if (stage != NULL)
+        {
+          _clutter_stage_queue_actor_relayout (CLUTTER_STAGE (stage), self);
+          return;
+        }
+    }
+
+  /* Otherwise we need to go all the way up the hierarchy */
+  _clutter_actor_queue_only_relayout (priv->parent);
 }
 
+/*
+ * _clutter_actor_relayout_root:
+ * @self: an actor queued with _clutter_stage_queue_actor_relayout()
+ *
+ * Allocates @self at its preferred size, the way its parent would,
+ * and queues a relayout of the parent if that may have changed the
+ * parent's own size request.
+ */
+void
+_clutter_actor_relayout_root (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+  ClutterActor *parent = priv->parent;
+  ClutterActorBox old_allocation;
+  gfloat parent_width, parent_height;
+
+  if (CLUTTER_ACTOR_IN_DESTRUCTION (self) ||
+      parent == NULL ||
+      !priv->needs_allocation ||
+      _clutter_actor_get_stage_internal (self) == NULL)
+    return;
+
+  /* The parent may have started delegating its layout since the
+   * relayout was queued */
+  if (!(parent->flags & CLUTTER_ACTOR_NO_LAYOUT))
+    {
+      _clutter_actor_queue_only_relayout (parent);
+      return;
+    }
+
+  old_allocation = priv->allocation;
+
+  clutter_actor_allocate_preferred_size (self, CLUTTER_ALLOCATION_NONE);
+
+  if (clutter_actor_box_equal (&old_allocation, &priv->allocation))
+    return;
+
+  /* Such a parent is as large as the right and bottom edges of its
+   * children reach, so its size request can only have changed if this
+   * child reached its edges before or after the relayout */
+  clutter_actor_box_get_size (&parent->priv->allocation,
+                              &parent_width, &parent_height);
+
+  if (old_allocation.x2 >= parent_width ||
+      old_allocation.y2 >= parent_height ||
+      priv->allocation.x2 >= parent_width ||
+      priv->allocation.y2 >= parent_height)
+    _clutter_actor_queue_only_relayout (parent);
+}
+
+#ifdef CLUTTER_ENABLE_DEBUG
+guint
+_clutter_actor_get_allocation_count (void)
+{
+  return allocation_count;
+}
+
+void
+_clutter_actor_get_size_request_stats (guint *hits,
+                                       guint *misses)
+{
+  *hits = size_request_hits;
+  *misses = size_request_misses;
+}
+#endif
+
 /**
  * clutter_actor_apply_relative_transform_to_point:
  * @self: A #ClutterActor
@@ -3210,6 +3489,7 @@ roll_back_pivot:
 
   /* we have a valid modelview */
   priv->transform_valid = TRUE;
+  priv->transform_serial++;
 
 multiply_and_return:
   cogl_matrix_multiply (matrix, matrix, &priv->transform);
@@ -3487,19 +3767,107 @@ cull_actor (ClutterActor      *self,
   return TRUE;
 }
 
+/* Every actor whose last paint volume is updated gets a new
+ * generation each time its eye transform changes; a child whose own
+ * transform and whose parent's generation are unchanged since its
+ * last paint knows that its eye transform didn't change either */
+static guint64 eye_transform_generation = 0;
+
+/* Bumped each time a toplevel is painted, so that a child can tell
+ * whether its parent's eye transform was computed during the current
+ * paint, or is left over from before the parent moved while it wasn't
+ * being painted */
+static guint eye_paint_serial = 0;
+
+/* Brings priv->eye_transform up to date with the transformation from
+ * the actor's coordinates to eye coordinates, returning whether it
+ * changed. This has to be called in paint order, after the parent's
+ * eye transform has been updated, for it to reuse the parent's and
+ * save walking up to the stage. */
+static gboolean
+_clutter_actor_update_eye_transform (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+  ClutterActor *parent = priv->parent;
+  CoglMatrix eye_transform;
+
+  if (parent == NULL)
+    eye_paint_serial++;
+
+  if (parent != NULL &&
+      parent->priv->eye_transform_valid &&
+      parent->priv->eye_paint_serial == eye_paint_serial)
+    {
+      /* Subclasses overriding apply_transform() don't tell us when
+       * their transformation changes, so we always apply it */
+      if (priv->eye_transform_valid &&
+          priv->transform_valid &&
+          priv->eye_transform_serial == priv->transform_serial &&
+          priv->eye_parent_generation == parent->priv->eye_transform_generation &&
+          CLUTTER_ACTOR_GET_CLASS (self)->apply_transform ==
+            clutter_actor_real_apply_transform)
+        {
+          priv->eye_paint_serial = eye_paint_serial;
+          return FALSE;
+        }
+
+      eye_transform = parent->priv->eye_transform;
+      _clutter_actor_apply_modelview_transform (self, &eye_transform);
+
+      priv->eye_parent_generation = parent->priv->eye_transform_generation;
+    }
+  else
+    {
+      cogl_matrix_init_identity (&eye_transform);
+      _clutter_actor_apply_relative_transformation_matrix (self, NULL,
+                                                           &eye_transform);
+
+      /* not derived from the parent's cached transform, so it mustn't
+       * be trusted because of it later */
+      priv->eye_parent_generation = 0;
+    }
+
+  priv->eye_transform_serial = priv->transform_serial;
+  priv->eye_paint_serial = eye_paint_serial;
+
+  if (priv->eye_transform_valid &&
+      cogl_matrix_equal (&eye_transform, &priv->eye_transform))
+    return FALSE;
+
+  priv->eye_transform = eye_transform;
+  priv->eye_transform_generation = ++eye_transform_generation;
+  priv->eye_transform_valid = TRUE;
+
+  return TRUE;
+}
+
 static void
 _clutter_actor_update_last_paint_volume (ClutterActor *self)
 {
   ClutterActorPrivate *priv = self->priv;
   const ClutterPaintVolume *pv;
+  gboolean eye_transform_changed;
+
+  eye_transform_changed = _clutter_actor_update_eye_transform (self);
+
+  pv = clutter_actor_get_paint_volume (self);
+
+  /* Nothing changed since the last paint, so the last paint volume
+   * is still the volume in eye coordinates */
+  if (pv != NULL &&
+      !eye_transform_changed &&
+      priv->last_paint_volume_valid &&
+      priv->eye_paint_volume_valid &&
+      priv->eye_paint_volume_serial == priv->paint_volume_serial)
+    return;
 
   if (priv->last_paint_volume_valid)
     {
       clutter_paint_volume_free (&priv->last_paint_volume);
       priv->last_paint_volume_valid = FALSE;
+      priv->eye_paint_volume_valid = FALSE;
     }
 
-  pv = clutter_actor_get_paint_volume (self);
   if (!pv)
     {
       CLUTTER_NOTE (CLIPPING, "Bail from update_last_paint_volume (%s): "
@@ -3510,8 +3878,19 @@ _clutter_actor_update_last_paint_volume (ClutterActor *self)
 
   _clutter_paint_volume_copy_static (pv, &priv->last_paint_volume);
 
-  _clutter_paint_volume_transform_relative (&priv->last_paint_volume,
-                                            NULL); /* eye coordinates */
+  if (pv->actor == self)
+    {
+      _clutter_paint_volume_set_reference_actor (&priv->last_paint_volume,
+                                                 NULL);
+      _clutter_paint_volume_transform (&priv->last_paint_volume,
+                                       &priv->eye_transform);
+
+      priv->eye_paint_volume_serial = priv->paint_volume_serial;
+      priv->eye_paint_volume_valid = TRUE;
+    }
+  else
+    _clutter_paint_volume_transform_relative (&priv->last_paint_volume,
+                                              NULL); /* eye coordinates */
 
   priv->last_paint_volume_valid = TRUE;
 }
@@ -3522,13 +3901,34 @@ actor_has_shader_data (ClutterActor *self)
   return g_object_get_qdata (G_OBJECT (self), quark_shader_data) != NULL;
 }
 
+/* Pick ids are handed out as actors are painted in a color pick pass,
+ * and the stage forgets all of them when the next pass starts. A
+ * geometric pick logs the actors themselves and never starts a pass,
+ * so it mustn't take any: nothing would give them back. */
 guint32
 _clutter_actor_get_pick_id (ClutterActor *self)
 {
-  if (self->priv->pick_id < 0)
+  ClutterActorPrivate *priv = self->priv;
+  ClutterActor *stage;
+  guint pick_pass;
+
+  stage = _clutter_actor_get_stage_internal (self);
+  if (stage == NULL)
     return 0;
 
-  return self->priv->pick_id;
+  if (_clutter_stage_is_logging_picks (CLUTTER_STAGE (stage)))
+    return 0;
+
+  pick_pass = _clutter_stage_get_pick_pass (CLUTTER_STAGE (stage));
+
+  if (priv->pick_id < 0 || priv->pick_pass != pick_pass)
+    {
+      priv->pick_id = _clutter_stage_acquire_pick_id (CLUTTER_STAGE (stage),
+                                                      self);
+      priv->pick_pass = pick_pass;
+    }
+
+  return priv->pick_id;
 }
 
 /* This is the same as clutter_actor_add_effect except that it doesn't
@@ -3576,16 +3976,51 @@ needs_flatten_effect (ClutterActor *self)
 
   if (priv->offscreen_redirect & CLUTTER_OFFSCREEN_REDIRECT_ALWAYS)
     return TRUE;
-  else if (priv->offscreen_redirect & CLUTTER_OFFSCREEN_REDIRECT_AUTOMATIC_FOR_OPACITY)
+
+  if (priv->offscreen_redirect & CLUTTER_OFFSCREEN_REDIRECT_AUTOMATIC_FOR_OPACITY)
     {
       if (clutter_actor_get_paint_opacity (self) < 255 &&
           clutter_actor_has_overlaps (self))
         return TRUE;
     }
 
+  if (priv->offscreen_redirect & CLUTTER_OFFSCREEN_REDIRECT_AUTOMATIC_FOR_STATIC)
+    {
+      ClutterActorBox box;
+      gsize size;
+
+      if (priv->n_static_paints < STATIC_FLATTEN_MIN_PAINTS ||
+          priv->paint_cost < STATIC_FLATTEN_MIN_COST)
+        return FALSE;
+
+      if (priv->static_flatten_bytes != 0)
+        return TRUE;
+
+      if (!clutter_actor_get_paint_box (self, &box))
+        return FALSE;
+
+      size = (gsize) ceilf (box.x2 - box.x1) * (gsize) ceilf (box.y2 - box.y1) * 4;
+      if (size == 0 || static_flatten_bytes + size > STATIC_FLATTEN_MAX_BYTES)
+        return FALSE;
+
+      priv->static_flatten_bytes = size;
+      static_flatten_bytes += size;
+
+      return TRUE;
+    }
+
   return FALSE;
 }
 
+static void
+release_static_flatten_bytes (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+
+  static_flatten_bytes -= priv->static_flatten_bytes;
+  priv->static_flatten_bytes = 0;
+}
+
 static void
 add_or_remove_flatten_effect (ClutterActor *self)
 {
@@ -3625,6 +4060,8 @@ add_or_remove_flatten_effect (ClutterActor *self)
           _clutter_actor_remove_effect_internal (self, priv->flatten_effect);
           g_clear_object (&priv->flatten_effect);
         }
+
+      release_static_flatten_bytes (self);
     }
 }
 
@@ -3739,6 +4176,57 @@ clutter_actor_paint_node (ClutterActor     *actor,
   return TRUE;
 }
 
+static void
+clutter_actor_clear_retained_paint_node (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+
+  if (priv->retained_paint_node != NULL)
+    {
+      clutter_paint_node_unref (priv->retained_paint_node);
+      priv->retained_paint_node = NULL;
+    }
+}
+
+/* Paints the nodes of @actor like clutter_actor_paint_node() does with
+ * a new root node, but keeps them to be painted again as long as the
+ * actor isn't dirty. Nothing queued a redraw on the actor when it isn't,
+ * so its allocation, background and content are the same as when they
+ * were built; only its paint opacity may still have changed through an
+ * ancestor. The nodes are relative to the actor so they remain valid
+ * however it is transformed. */
+static void
+clutter_actor_paint_retained_node (ClutterActor *actor)
+{
+  ClutterActorPrivate *priv = actor->priv;
+  guint8 paint_opacity;
+
+  paint_opacity = clutter_actor_get_paint_opacity_internal (actor);
+
+  if (priv->retained_paint_node != NULL &&
+      (priv->is_dirty || priv->retained_paint_opacity != paint_opacity))
+    clutter_actor_clear_retained_paint_node (actor);
+
+  if (priv->retained_paint_node == NULL)
+    {
+      priv->retained_paint_node = _clutter_dummy_node_new (actor);
+      priv->retained_paint_opacity = paint_opacity;
+      clutter_paint_node_set_name (priv->retained_paint_node, "Root");
+
+      clutter_actor_paint_node (actor, priv->retained_paint_node);
+      return;
+    }
+
+  if (clutter_paint_node_get_n_children (priv->retained_paint_node) == 0)
+    return;
+
+  /* the framebuffer the nodes draw to is only valid while painting */
+  _clutter_dummy_node_set_framebuffer (priv->retained_paint_node,
+                                       _clutter_actor_get_active_framebuffer (actor));
+
+  _clutter_paint_node_paint (priv->retained_paint_node);
+}
+
 /**
  * clutter_actor_paint:
  * @self: A #ClutterActor
@@ -3763,7 +4251,9 @@ clutter_actor_paint (ClutterActor *self)
   ClutterActorPrivate *priv;
   ClutterPickMode pick_mode;
   gboolean clip_set = FALSE;
+  gboolean pick_clip_set = FALSE;
   gboolean shader_applied = FALSE;
+  guint first_actor_painted = 0;
   ClutterStage *stage;
 
   g_return_if_fail (CLUTTER_IS_ACTOR (self));
@@ -3794,6 +4284,11 @@ clutter_actor_paint (ClutterActor *self)
   if (!CLUTTER_ACTOR_IS_MAPPED (self))
     return;
 
+  /* nothing of the actor would be visible; clones of it still have
+   * to be painted though */
+  if (priv->occluded && pick_mode == CLUTTER_PICK_NONE && !in_clone_paint ())
+    return;
+
   stage = (ClutterStage *) _clutter_actor_get_stage_internal (self);
 
   /* mark that we are in the paint process */
@@ -3861,6 +4356,20 @@ clutter_actor_paint (ClutterActor *self)
                                             priv->clip.origin.x + priv->clip.size.width,
                                             priv->clip.origin.y + priv->clip.size.height);
       clip_set = TRUE;
+
+      if (pick_mode != CLUTTER_PICK_NONE &&
+          _clutter_stage_is_logging_picks (stage))
+        {
+          ClutterActorBox clip_box = {
+            priv->clip.origin.x,
+            priv->clip.origin.y,
+            priv->clip.origin.x + priv->clip.size.width,
+            priv->clip.origin.y + priv->clip.size.height,
+          };
+
+          _clutter_stage_push_pick_clip (stage, &clip_box);
+          pick_clip_set = TRUE;
+        }
     }
   else if (priv->clip_to_allocation)
     {
@@ -3872,10 +4381,29 @@ clutter_actor_paint (ClutterActor *self)
 
       cogl_framebuffer_push_rectangle_clip (fb, 0, 0, width, height);
       clip_set = TRUE;
+
+      if (pick_mode != CLUTTER_PICK_NONE &&
+          _clutter_stage_is_logging_picks (stage))
+        {
+          ClutterActorBox clip_box = { 0, 0, width, height };
+
+          _clutter_stage_push_pick_clip (stage, &clip_box);
+          pick_clip_set = TRUE;
+        }
     }
 
   if (pick_mode == CLUTTER_PICK_NONE)
     {
+      /* Nothing queued a redraw on the actor or its children since it
+         was last painted if it isn't dirty */
+      if (!in_clone_paint ())
+        {
+          if (priv->is_dirty)
+            priv->n_static_paints = 0;
+          else if (priv->n_static_paints < STATIC_FLATTEN_MIN_PAINTS)
+            priv->n_static_paints++;
+        }
+
       /* We check whether we need to add the flatten effect before
          each paint so that we can avoid having a mechanism for
          applications to notify when the value of the
@@ -3947,7 +4475,32 @@ clutter_actor_paint (ClutterActor *self)
     priv->next_effect_to_paint =
       _clutter_meta_group_peek_metas (priv->effects);
 
-  clutter_actor_continue_paint (self);
+  /* Count the actors painting this one goes through while it isn't
+     flattened, to tell whether flattening it would be worth it */
+  if (pick_mode == CLUTTER_PICK_NONE)
+    {
+      n_actors_painted++;
+
+      if (priv->flatten_effect == NULL &&
+          (priv->offscreen_redirect & CLUTTER_OFFSCREEN_REDIRECT_AUTOMATIC_FOR_STATIC))
+        first_actor_painted = n_actors_painted;
+    }
+
+  /* CLUTTER_PAINT=gpu-timings times the actors that have a name */
+  if (G_UNLIKELY (clutter_paint_debug_flags & CLUTTER_DEBUG_GPU_TIMINGS) &&
+      pick_mode == CLUTTER_PICK_NONE && priv->name != NULL)
+    {
+      CoglFramebuffer *fb = cogl_get_draw_framebuffer ();
+
+      cogl_framebuffer_push_gpu_timer (fb, g_intern_string (priv->name));
+      clutter_actor_continue_paint (self);
+      cogl_framebuffer_pop_gpu_timer (fb);
+    }
+  else
+    clutter_actor_continue_paint (self);
+
+  if (first_actor_painted != 0)
+    priv->paint_cost = n_actors_painted - first_actor_painted;
 
   if (shader_applied)
     _clutter_actor_shader_post_paint (self);
@@ -3969,6 +4522,9 @@ done:
       cogl_framebuffer_pop_clip (fb);
     }
 
+  if (pick_clip_set)
+    _clutter_stage_pop_pick_clip (stage);
+
   cogl_pop_matrix ();
 
   /* paint sequence complete */
@@ -4010,21 +4566,28 @@ clutter_actor_continue_paint (ClutterActor *self)
     {
       if (_clutter_context_get_pick_mode () == CLUTTER_PICK_NONE)
         {
-          ClutterPaintNode *dummy;
+          /* The stage's nodes clear the framebuffer, and are rebuilt
+           * each time for it */
+          if (priv->retain_paint_nodes && !CLUTTER_ACTOR_IS_TOPLEVEL (self))
+            clutter_actor_paint_retained_node (self);
+          else
+            {
+              ClutterPaintNode *dummy;
 
-          /* XXX - this will go away in 2.0, when we can get rid of this
-           * stuff and switch to a pure retained render tree of PaintNodes
-           * for the entire frame, starting from the Stage; the paint()
-           * virtual function can then be called directly.
-           */
-          dummy = _clutter_dummy_node_new (self);
-          clutter_paint_node_set_name (dummy, "Root");
+              /* XXX - this will go away in 2.0, when we can get rid of this
+               * stuff and switch to a pure retained render tree of PaintNodes
+               * for the entire frame, starting from the Stage; the paint()
+               * virtual function can then be called directly.
+               */
+              dummy = _clutter_dummy_node_new (self);
+              clutter_paint_node_set_name (dummy, "Root");
 
-          /* XXX - for 1.12, we use the return value of paint_node() to
-           * decide whether we should emit the ::paint signal.
-           */
-          clutter_actor_paint_node (self, dummy);
-          clutter_paint_node_unref (dummy);
+              /* XXX - for 1.12, we use the return value of paint_node() to
+               * decide whether we should emit the ::paint signal.
+               */
+              clutter_actor_paint_node (self, dummy);
+              clutter_paint_node_unref (dummy);
+            }
 
           /* XXX:2.0 - Call the paint() virtual directly */
           if (g_signal_has_handler_pending (self, actor_signals[PAINT],
@@ -4078,7 +4641,22 @@ clutter_actor_continue_paint (ClutterActor *self)
                 run_flags |= CLUTTER_EFFECT_PAINT_ACTOR_DIRTY;
             }
 
-          _clutter_effect_paint (priv->current_effect, run_flags);
+          /* Timing effects covers the offscreen passes too */
+          if (G_UNLIKELY (clutter_paint_debug_flags &
+                          CLUTTER_DEBUG_GPU_TIMINGS))
+            {
+              CoglFramebuffer *fb = cogl_get_draw_framebuffer ();
+              const gchar *name =
+                clutter_actor_meta_get_name (CLUTTER_ACTOR_META (priv->current_effect));
+
+              cogl_framebuffer_push_gpu_timer (fb, name != NULL ?
+                                               g_intern_string (name) :
+                                               G_OBJECT_TYPE_NAME (priv->current_effect));
+              _clutter_effect_paint (priv->current_effect, run_flags);
+              cogl_framebuffer_pop_gpu_timer (fb);
+            }
+          else
+            _clutter_effect_paint (priv->current_effect, run_flags);
         }
       else
         {
@@ -5955,6 +6533,7 @@ clutter_actor_dispose (GObject *object)
   g_clear_object (&priv->constraints);
   g_clear_object (&priv->effects);
   g_clear_object (&priv->flatten_effect);
+  release_static_flatten_bytes (self);
 
   if (priv->child_model != NULL)
     {
@@ -5986,6 +6565,8 @@ clutter_actor_dispose (GObject *object)
       priv->clones = NULL;
     }
 
+  clutter_actor_clear_retained_paint_node (self);
+
   G_OBJECT_CLASS (clutter_actor_parent_class)->dispose (object);
 }
 
@@ -6000,6 +6581,11 @@ clutter_actor_finalize (GObject *object)
 
   free (priv->name);
 
+  if (priv->width_requests != priv->embedded_width_requests)
+    free (priv->width_requests);
+  if (priv->height_requests != priv->embedded_height_requests)
+    free (priv->height_requests);
+
 #ifdef CLUTTER_ENABLE_DEBUG
   free (priv->debug_name);
 #endif
@@ -8524,6 +9110,10 @@ clutter_actor_init (ClutterActor *self)
   priv->needs_allocation = TRUE;
   priv->needs_paint_volume_update = TRUE;
 
+  priv->width_requests = priv->embedded_width_requests;
+  priv->height_requests = priv->embedded_height_requests;
+  priv->n_width_requests = N_CACHED_SIZE_REQUESTS;
+  priv->n_height_requests = N_CACHED_SIZE_REQUESTS;
   priv->cached_width_age = 1;
   priv->cached_height_age = 1;
 
@@ -8533,6 +9123,7 @@ clutter_actor_init (ClutterActor *self)
   /* Initialize an empty paint volume to start with */
   _clutter_paint_volume_init_static (&priv->last_paint_volume, NULL);
   priv->last_paint_volume_valid = TRUE;
+  priv->eye_paint_volume_valid = FALSE;
 
   priv->transform_valid = FALSE;
 
@@ -8645,6 +9236,7 @@ _clutter_actor_finish_queue_redraw (ClutterActor *self,
   if (clip)
     {
       _clutter_actor_set_queue_redraw_clip (self, clip);
+      priv->queue_redraw_clip_is_damage = TRUE;
       clipped = TRUE;
     }
   else if (G_LIKELY (priv->last_paint_volume_valid))
@@ -8685,6 +9277,74 @@ _clutter_actor_finish_queue_redraw (ClutterActor *self,
    */
   if (G_LIKELY (clipped))
     _clutter_actor_set_queue_redraw_clip (self, NULL);
+
+  priv->queue_redraw_clip_is_damage = FALSE;
+}
+
+/*
+ * _clutter_actor_coalesce_queue_redraw:
+ * @self: an actor with a queued redraw
+ * @ancestor: an ancestor of @self with an unclipped redraw queued
+ *
+ * Drops the redraw queued on @self if finishing the one queued on
+ * @ancestor does everything finishing it would: the paint volume of
+ * @ancestor, before and after, covers @self, so the only thing to
+ * check is that nothing between the two reacts to a redraw bubbling
+ * up from @self, because it doesn't get one.
+ *
+ * The paint volume only covers @self when it is the union of those
+ * of the children all the way up, so @ancestor and the actors between
+ * the two mustn't replace ClutterActorClass.get_paint_volume() either.
+ *
+ * Return value: %TRUE if the redraw of @self was dropped, in which case
+ *   the stage frees its entry
+ */
+gboolean
+_clutter_actor_coalesce_queue_redraw (ClutterActor *self,
+                                      ClutterActor *ancestor)
+{
+  ClutterActor *iter;
+
+  for (iter = self; iter != ancestor; iter = iter->priv->parent)
+    {
+      if (iter->priv->effects != NULL ||
+          clutter_actor_has_mapped_clones (iter) ||
+          CLUTTER_ACTOR_GET_CLASS (iter)->queue_redraw !=
+            clutter_actor_real_queue_redraw ||
+          g_signal_has_handler_pending (iter, actor_signals[QUEUE_REDRAW],
+                                        0, TRUE))
+        return FALSE;
+
+      if (iter != self &&
+          CLUTTER_ACTOR_GET_CLASS (iter)->get_paint_volume !=
+            clutter_actor_real_get_paint_volume)
+        return FALSE;
+    }
+
+  if (CLUTTER_ACTOR_GET_CLASS (ancestor)->get_paint_volume !=
+        clutter_actor_real_get_paint_volume)
+    return FALSE;
+
+  CLUTTER_NOTE (PAINT, "Redraw of '%s' is covered by the one of '%s'",
+                _clutter_actor_get_debug_name (self),
+                _clutter_actor_get_debug_name (ancestor));
+
+  self->priv->queue_redraw_entry = NULL;
+
+  /* The cached paint volumes of the ancestors don't know that @self
+   * changed; this is what bubbling the redraw up would have done */
+  for (iter = self->priv->parent; ; iter = iter->priv->parent)
+    {
+      iter->priv->needs_paint_volume_update = TRUE;
+
+      if (iter == ancestor)
+        break;
+
+      iter->priv->is_dirty = TRUE;
+      iter->priv->effect_to_redraw = NULL;
+    }
+
+  return TRUE;
 }
 
 static void
@@ -8834,6 +9494,9 @@ _clutter_actor_queue_redraw_full (ClutterActor       *self,
   if (CLUTTER_ACTOR_IN_DESTRUCTION (stage))
     return;
 
+  /* whatever changed may also change what is under the pointer */
+  _clutter_stage_invalidate_pick (CLUTTER_STAGE (stage));
+
   if (flags & CLUTTER_REDRAW_CLIPPED_TO_ALLOCATION)
     {
       ClutterActorBox allocation_clip;
@@ -9391,26 +10054,35 @@ clutter_actor_adjust_height (ClutterActor *self,
 }
 
 /* looks for a cached size request for this for_size. If not
- * found, returns the oldest entry so it can be overwritten */
+ * found, returns the oldest entry so it can be overwritten; if that
+ * entry is still in use, the cache is grown instead so that an actor
+ * asked for many sizes between two relayouts stops evicting them */
 static gboolean
 _clutter_actor_get_cached_size_request (gfloat         for_size,
-                                        SizeRequest   *cached_size_requests,
+                                        SizeRequest  **cached_size_requests,
+                                        SizeRequest   *embedded_size_requests,
+                                        guint8        *n_cached_size_requests,
                                         SizeRequest  **result)
 {
+  SizeRequest *requests = *cached_size_requests;
+  guint n_requests = *n_cached_size_requests;
   guint i;
 
-  *result = &cached_size_requests[0];
+  *result = &requests[0];
 
-  for (i = 0; i < N_CACHED_SIZE_REQUESTS; i++)
+  for (i = 0; i < n_requests; i++)
     {
       SizeRequest *sr;
 
-      sr = &cached_size_requests[i];
+      sr = &requests[i];
 
       if (sr->age > 0 &&
           sr->for_size == for_size)
         {
           CLUTTER_NOTE (LAYOUT, "Size cache hit for size: %.2f", for_size);
+#ifdef CLUTTER_ENABLE_DEBUG
+          size_request_hits++;
+#endif
           *result = sr;
           return TRUE;
         }
@@ -9421,6 +10093,24 @@ _clutter_actor_get_cached_size_request (gfloat         for_size,
     }
 
   CLUTTER_NOTE (LAYOUT, "Size cache miss for size: %.2f", for_size);
+#ifdef CLUTTER_ENABLE_DEBUG
+  size_request_misses++;
+#endif
+
+  if ((*result)->age > 0 && n_requests < MAX_CACHED_SIZE_REQUESTS)
+    {
+      guint new_n_requests = MIN (n_requests * 2, MAX_CACHED_SIZE_REQUESTS);
+      SizeRequest *new_requests = g_new0 (SizeRequest, new_n_requests);
+
+      memcpy (new_requests, requests, n_requests * sizeof (SizeRequest));
+
+      if (requests != embedded_size_requests)
+        free (requests);
+
+      *cached_size_requests = new_requests;
+      *n_cached_size_requests = new_n_requests;
+      *result = &new_requests[n_requests];
+    }
 
   return FALSE;
 }
@@ -9531,7 +10221,9 @@ clutter_actor_get_preferred_width (ClutterActor *self,
     {
       found_in_cache =
         _clutter_actor_get_cached_size_request (for_height,
-                                                priv->width_requests,
+                                                &priv->width_requests,
+                                                priv->embedded_width_requests,
+                                                &priv->n_width_requests,
                                                 &cached_size_request);
     }
   else
@@ -9675,7 +10367,9 @@ clutter_actor_get_preferred_height (ClutterActor *self,
     {
       found_in_cache =
         _clutter_actor_get_cached_size_request (for_width,
-                                                priv->height_requests,
+                                                &priv->height_requests,
+                                                priv->embedded_height_requests,
+                                                &priv->n_height_requests,
                                                 &cached_size_request);
     }
   else
@@ -10034,6 +10728,10 @@ clutter_actor_allocate (ClutterActor           *self,
 
   priv = self->priv;
 
+#ifdef CLUTTER_ENABLE_DEBUG
+  allocation_count++;
+#endif
+
   old_allocation = priv->allocation;
   real_allocation = *box;
 
@@ -11855,6 +12553,13 @@ clutter_actor_get_opacity (ClutterActor *self)
  * recommended to override the has_overlaps() virtual to return %FALSE
  * for maximum efficiency.
  *
+ * Containers whose contents rarely change but that are costly to paint,
+ * like panels or menus, can set the
+ * %CLUTTER_OFFSCREEN_REDIRECT_AUTOMATIC_FOR_STATIC flag instead of
+ * deciding when to cache them: once nothing in them changed for a few
+ * frames they are painted from an offscreen image, until something in
+ * them changes again.
+ *
  * Since: 1.8
  */
 void
@@ -11905,6 +12610,55 @@ clutter_actor_get_offscreen_redirect (ClutterActor *self)
   return self->priv->offscreen_redirect;
 }
 
+/**
+ * clutter_actor_set_retain_paint_nodes:
+ * @self: A #ClutterActor
+ * @retain: whether to retain the paint nodes of @self
+ *
+ * Sets whether the paint nodes @self builds for its background color,
+ * its #ClutterContent and its #ClutterActorClass.paint_node()
+ * implementation should be kept from one paint to the next and painted
+ * again as long as nothing queued a redraw on @self, instead of being
+ * built again each time. This is worth it for actors that are mostly
+ * static while the rest of the stage is redrawn.
+ *
+ * Actors drawing in their #ClutterActorClass.paint() implementation
+ * are not affected.
+ */
+void
+clutter_actor_set_retain_paint_nodes (ClutterActor *self,
+                                      gboolean      retain)
+{
+  g_return_if_fail (CLUTTER_IS_ACTOR (self));
+
+  retain = !!retain;
+
+  if (self->priv->retain_paint_nodes == retain)
+    return;
+
+  self->priv->retain_paint_nodes = retain;
+
+  if (!retain)
+    clutter_actor_clear_retained_paint_node (self);
+}
+
+/**
+ * clutter_actor_get_retain_paint_nodes:
+ * @self: A #ClutterActor
+ *
+ * Retrieves whether the paint nodes of @self are retained, as set
+ * with clutter_actor_set_retain_paint_nodes().
+ *
+ * Return value: %TRUE if the paint nodes of @self are retained
+ */
+gboolean
+clutter_actor_get_retain_paint_nodes (ClutterActor *self)
+{
+  g_return_val_if_fail (CLUTTER_IS_ACTOR (self), FALSE);
+
+  return self->priv->retain_paint_nodes;
+}
+
 /**
  * clutter_actor_set_name:
  * @self: A #ClutterActor
@@ -13977,6 +14731,8 @@ void
 clutter_actor_set_reactive (ClutterActor *actor,
                             gboolean      reactive)
 {
+  ClutterActor *stage;
+
   g_return_if_fail (CLUTTER_IS_ACTOR (actor));
 
   if (reactive == CLUTTER_ACTOR_IS_REACTIVE (actor))
@@ -13987,6 +14743,10 @@ clutter_actor_set_reactive (ClutterActor *actor,
   else
     CLUTTER_ACTOR_UNSET_FLAGS (actor, CLUTTER_ACTOR_REACTIVE);
 
+  stage = _clutter_actor_get_stage_internal (actor);
+  if (stage != NULL)
+    _clutter_stage_invalidate_pick (CLUTTER_STAGE (stage));
+
   g_object_notify_by_pspec (G_OBJECT (actor), obj_props[PROP_REACTIVE]);
 }
 
@@ -15132,6 +15892,37 @@ clutter_actor_set_final_state (ClutterAnimatable *animatable,
   free (p_name);
 }
 
+/*< private >
+ * _clutter_actor_set_animatable_value:
+ * @actor: a #ClutterActor
+ * @pspec: an animatable property of #ClutterActor
+ * @value: the new value of the property
+ *
+ * Sets @pspec like ClutterAnimatable.set_final_state() would, without
+ * looking the property up by name; transitions use it every frame.
+ *
+ * Return value: %FALSE if @pspec can't be set this way, in which case
+ *   the caller should go through clutter_animatable_set_final_state()
+ */
+gboolean
+_clutter_actor_set_animatable_value (ClutterActor *actor,
+                                     GParamSpec   *pspec,
+                                     const GValue *value)
+{
+  ClutterAnimatableIface *iface = CLUTTER_ANIMATABLE_GET_IFACE (actor);
+
+  /* the property ids are only meaningful for the properties that
+   * ClutterActor itself installs */
+  if (iface->set_final_state != clutter_actor_set_final_state ||
+      pspec->owner_type != CLUTTER_TYPE_ACTOR ||
+      (pspec->flags & CLUTTER_PARAM_ANIMATABLE) == 0)
+    return FALSE;
+
+  clutter_actor_set_animatable_property (actor, pspec->param_id, value, pspec);
+
+  return TRUE;
+}
+
 static void
 clutter_animatable_iface_init (ClutterAnimatableIface *iface)
 {
@@ -17555,6 +18346,7 @@ _clutter_actor_get_paint_volume_mutable (ClutterActor *self)
     {
       priv->paint_volume_valid = TRUE;
       priv->needs_paint_volume_update = FALSE;
+      priv->paint_volume_serial++;
       return &priv->paint_volume;
     }
   else
@@ -17701,6 +18493,50 @@ clutter_actor_get_paint_box (ClutterActor    *self,
   return TRUE;
 }
 
+/*
+ * _clutter_actor_get_opaque_region:
+ * @actor: a #ClutterActor
+ *
+ * Retrieves the opaque region of @actor, as returned by the
+ * #ClutterActorClass.get_opaque_region() virtual function.
+ *
+ * Return value: (transfer full): a region in the coordinates of @actor,
+ *   or %NULL if the actor doesn't know of any opaque area
+ */
+cairo_region_t *
+_clutter_actor_get_opaque_region (ClutterActor *actor)
+{
+  ClutterActorClass *klass = CLUTTER_ACTOR_GET_CLASS (actor);
+
+  if (klass->get_opaque_region == NULL)
+    return NULL;
+
+  return klass->get_opaque_region (actor);
+}
+
+/*
+ * _clutter_actor_paint_volume_covers_children:
+ * @actor: a #ClutterActor
+ *
+ * Checks whether the paint volume of @actor is known to include the
+ * paint volumes of its children, so that nothing of its subtree is
+ * painted outside of it.
+ */
+gboolean
+_clutter_actor_paint_volume_covers_children (ClutterActor *actor)
+{
+  return actor->priv->n_children == 0 ||
+         CLUTTER_ACTOR_GET_CLASS (actor)->get_paint_volume ==
+           clutter_actor_real_get_paint_volume;
+}
+
+void
+_clutter_actor_set_occluded (ClutterActor *actor,
+                             gboolean      occluded)
+{
+  actor->priv->occluded = !!occluded;
+}
+
 /**
  * clutter_actor_has_overlaps:
  * @self: A #ClutterActor
@@ -20868,6 +21704,66 @@ clutter_actor_has_mapped_clones (ClutterActor *self)
   return FALSE;
 }
 
+static gboolean
+clone_is_visible (ClutterActor *clone)
+{
+  const ClutterActorBox *box = &clone->priv->allocation;
+
+  if (!CLUTTER_ACTOR_IS_MAPPED (clone) ||
+      clutter_actor_get_paint_opacity (clone) == 0)
+    return FALSE;
+
+  /* Don't use clutter_actor_get_allocation_box(), this is called
+   * from paint and must not trigger a relayout */
+  return box->x2 > box->x1 && box->y2 > box->y1;
+}
+
+/**
+ * clutter_actor_has_visible_clones:
+ * @self: a #ClutterActor
+ *
+ * Returns whether a #ClutterActor is shown anywhere through a clone:
+ * whether @self or one of its ancestors has a clone that is mapped,
+ * not fully transparent and not empty.
+ *
+ * Unlike clutter_actor_has_mapped_clones(), clones that are mapped but
+ * can't show anything, like ones faded out, don't count, and neither
+ * do clones of ancestors that aren't visible.
+ *
+ * Return: %TRUE if the actor is visible through clones
+ */
+gboolean
+clutter_actor_has_visible_clones (ClutterActor *self)
+{
+  ClutterActor *actor;
+
+  g_return_val_if_fail (CLUTTER_IS_ACTOR (self), FALSE);
+
+  if (self->priv->in_cloned_branch == 0)
+    return FALSE;
+
+  for (actor = self; actor != NULL; actor = actor->priv->parent)
+    {
+      GHashTableIter iter;
+      gpointer key;
+
+      if (actor->priv->in_cloned_branch == 0)
+        break;
+
+      if (actor->priv->clones == NULL)
+        continue;
+
+      g_hash_table_iter_init (&iter, actor->priv->clones);
+      while (g_hash_table_iter_next (&iter, &key, NULL))
+        {
+          if (clone_is_visible (key))
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
 CoglFramebuffer *
 _clutter_actor_get_active_framebuffer (ClutterActor *self)
 {
@@ -211,6 +211,11 @@ struct _ClutterActor
  * @paint_node: virtual function for creating paint nodes and attaching
  *   them to the render tree
  * @touch_event: signal class closure for #ClutterActor::touch-event
+ * @get_opaque_region: virtual function, returning the region of the
+ *   actor, in its own coordinates, that it covers with fully opaque
+ *   pixels when painted at full opacity, not counting its children.
+ *   The stage uses it to skip painting actors that are hidden beneath
+ *   it. Since: Muffin
  *
  * Base class for actors.
  */
@@ -296,9 +301,11 @@ struct _ClutterActorClass
   gboolean (* touch_event)          (ClutterActor         *self,
                                      ClutterTouchEvent    *event);
 
+  cairo_region_t * (* get_opaque_region) (ClutterActor    *self);
+
   /*< private >*/
   /* padding for future expansion */
-  gpointer _padding_dummy[26];
+  gpointer _padding_dummy[25];
 };
 
 /**
@@ -578,6 +585,14 @@ CLUTTER_AVAILABLE_IN_1_8
 ClutterOffscreenRedirect        clutter_actor_get_offscreen_redirect            (ClutterActor               *self);
 CLUTTER_AVAILABLE_IN_ALL
 gboolean                        clutter_actor_should_pick_paint                 (ClutterActor               *self);
+CLUTTER_AVAILABLE_IN_MUFFIN
+void                            clutter_actor_pick_box                          (ClutterActor               *self,
+                                                                                 const ClutterActorBox      *box);
+CLUTTER_AVAILABLE_IN_MUFFIN
+void                            clutter_actor_set_retain_paint_nodes            (ClutterActor               *self,
+                                                                                 gboolean                    retain);
+CLUTTER_AVAILABLE_IN_MUFFIN
+gboolean                        clutter_actor_get_retain_paint_nodes            (ClutterActor               *self);
 CLUTTER_AVAILABLE_IN_ALL
 gboolean                        clutter_actor_is_in_clone_paint                 (ClutterActor               *self);
 CLUTTER_AVAILABLE_IN_ALL
@@ -858,6 +873,8 @@ void                            clutter_actor_remove_all_transitions
 
 CLUTTER_AVAILABLE_IN_1_16
 gboolean                        clutter_actor_has_mapped_clones                 (ClutterActor *self);
+CLUTTER_AVAILABLE_IN_MUFFIN
+gboolean                        clutter_actor_has_visible_clones                (ClutterActor *self);
 CLUTTER_AVAILABLE_IN_1_22
 void                            clutter_actor_set_opacity_override              (ClutterActor               *self,
                                                                                  gint                        opacity);
@@ -30,6 +30,12 @@
  * #ClutterBlurEffect is a sub-class of #ClutterEffect that allows blurring a
  * actor and its contents.
  *
+ * By default the effect applies a small, fixed box blur. Setting the
+ * #ClutterBlurEffect:radius property switches it to a dual filter blur:
+ * the actor is downsampled through a chain of progressively smaller
+ * textures and then upsampled back, each pass sampling a handful of
+ * texels, so that large radii cost little more than small ones.
+ *
  * #ClutterBlurEffect is available since Clutter 1.4
  */
 
@@ -43,6 +49,8 @@
 
 #define CLUTTER_ENABLE_EXPERIMENTAL_API
 
+#include <math.h>
+
 #include "clutter-blur-effect.h"
 
 #include "cogl/cogl.h"
@@ -53,6 +61,10 @@
 
 #define BLUR_PADDING    2
 
+/* Every level of the dual filter halves the resolution of the previous
+ * one; past this the image is too small to be worth blurring further */
+#define DUAL_FILTER_MAX_LEVELS  6
+
 /* FIXME - lame shader; we should really have a decoupled
  * horizontal/vertical two pass shader for the gaussian blur
  */
@@ -74,6 +86,53 @@ static const gchar *box_blur_glsl_shader =
 "  cogl_texel /= 9.0;\n";
 #undef SAMPLE
 
+/* The two passes of the dual filter: half_pixel is half a texel of the
+ * destination, scaled by the offset that fine tunes the radius
+ */
+static const gchar *dual_filter_glsl_declarations =
+"uniform vec2 half_pixel;\n";
+#define SAMPLE(offx, offy, weight) \
+  "cogl_texel += texture2D (cogl_sampler, cogl_tex_coord.st + half_pixel * " \
+  "vec2 (" G_STRINGIFY (offx) ", " G_STRINGIFY (offy) ")) * " \
+  G_STRINGIFY (weight) ";\n"
+static const gchar *dual_filter_down_glsl_shader =
+"  cogl_texel = texture2D (cogl_sampler, cogl_tex_coord.st) * 4.0;\n"
+  SAMPLE (-1.0, -1.0, 1.0)
+  SAMPLE (+1.0, -1.0, 1.0)
+  SAMPLE (-1.0, +1.0, 1.0)
+  SAMPLE (+1.0, +1.0, 1.0)
+"  cogl_texel /= 8.0;\n";
+static const gchar *dual_filter_up_glsl_shader =
+"  cogl_texel = vec4 (0.0);\n"
+  SAMPLE (-2.0,  0.0, 1.0)
+  SAMPLE (-1.0, +1.0, 2.0)
+  SAMPLE ( 0.0, +2.0, 1.0)
+  SAMPLE (+1.0, +1.0, 2.0)
+  SAMPLE (+2.0,  0.0, 1.0)
+  SAMPLE (+1.0, -1.0, 2.0)
+  SAMPLE ( 0.0, -2.0, 1.0)
+  SAMPLE (-1.0, -1.0, 2.0)
+"  cogl_texel /= 12.0;\n";
+#undef SAMPLE
+
+/* The levels of the dual filter only hold anything while an effect is
+ * painting, so all the effects blurring textures of the same size share
+ * them instead of each keeping its own chain of framebuffers
+ */
+typedef struct
+{
+  gint ref_count;
+
+  gint width;
+  gint height;
+
+  gint n_levels;
+  CoglHandle textures[DUAL_FILTER_MAX_LEVELS];
+  CoglHandle offscreens[DUAL_FILTER_MAX_LEVELS];
+} BlurChain;
+
+static GHashTable *blur_chains = NULL;
+
 struct _ClutterBlurEffect
 {
   ClutterOffscreenEffect parent_instance;
@@ -87,6 +146,15 @@ struct _ClutterBlurEffect
   gint tex_height;
 
   CoglPipeline *pipeline;
+
+  gfloat radius;
+
+  BlurChain *chain;
+
+  CoglPipeline *down_pipeline;
+  CoglPipeline *up_pipeline;
+  gint down_half_pixel_uniform;
+  gint up_half_pixel_uniform;
 };
 
 struct _ClutterBlurEffectClass
@@ -94,12 +162,231 @@ struct _ClutterBlurEffectClass
   ClutterOffscreenEffectClass parent_class;
 
   CoglPipeline *base_pipeline;
+  CoglPipeline *base_down_pipeline;
+  CoglPipeline *base_up_pipeline;
+};
+
+enum
+{
+  PROP_0,
+
+  PROP_RADIUS,
+
+  PROP_LAST
 };
 
+static GParamSpec *obj_props[PROP_LAST];
+
 G_DEFINE_TYPE (ClutterBlurEffect,
                clutter_blur_effect,
                CLUTTER_TYPE_OFFSCREEN_EFFECT);
 
+/* Texture sizes are bounded by GL_MAX_TEXTURE_SIZE, so both fit in the
+ * key with room to spare */
+#define BLUR_CHAIN_KEY(width, height) \
+  GUINT_TO_POINTER (((guint) (width) << 16) | ((guint) (height) & 0xffff))
+
+static BlurChain *
+blur_chain_get (gint width,
+                gint height)
+{
+  BlurChain *chain;
+
+  if (G_UNLIKELY (blur_chains == NULL))
+    blur_chains = g_hash_table_new (NULL, NULL);
+
+  chain = g_hash_table_lookup (blur_chains, BLUR_CHAIN_KEY (width, height));
+  if (chain == NULL)
+    {
+      chain = g_slice_new0 (BlurChain);
+      chain->width = width;
+      chain->height = height;
+
+      g_hash_table_insert (blur_chains,
+                           BLUR_CHAIN_KEY (width, height),
+                           chain);
+    }
+
+  chain->ref_count += 1;
+
+  return chain;
+}
+
+static void
+blur_chain_unref (BlurChain *chain)
+{
+  gint i;
+
+  chain->ref_count -= 1;
+  if (chain->ref_count > 0)
+    return;
+
+  g_hash_table_remove (blur_chains,
+                       BLUR_CHAIN_KEY (chain->width, chain->height));
+
+  for (i = 0; i < chain->n_levels; i++)
+    {
+      cogl_handle_unref (chain->offscreens[i]);
+      cogl_handle_unref (chain->textures[i]);
+    }
+
+  g_slice_free (BlurChain, chain);
+}
+
+/* Allocates the first @n_levels levels of @chain, if they aren't yet;
+ * returns how many levels are available */
+static gint
+blur_chain_ensure_levels (BlurChain *chain,
+                          gint       n_levels)
+{
+  while (chain->n_levels < n_levels)
+    {
+      gint level = chain->n_levels;
+      gint width = MAX (chain->width >> (level + 1), 1);
+      gint height = MAX (chain->height >> (level + 1), 1);
+      CoglHandle texture;
+      CoglHandle offscreen;
+
+      texture = cogl_texture_new_with_size (width, height,
+                                            COGL_TEXTURE_NO_SLICING,
+                                            COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+      if (texture == NULL)
+        break;
+
+      offscreen = cogl_offscreen_new_to_texture (texture);
+      if (offscreen == NULL)
+        {
+          cogl_handle_unref (texture);
+          break;
+        }
+
+      cogl_framebuffer_orthographic (offscreen,
+                                     0, 0, width, height,
+                                     -1.f, 1.f);
+
+      chain->textures[level] = texture;
+      chain->offscreens[level] = offscreen;
+      chain->n_levels += 1;
+    }
+
+  return MIN (chain->n_levels, n_levels);
+}
+
+/* Picks the number of levels reaching @radius; every level doubles
+ * the spread of the samples, and @offset scales them between levels */
+static gint
+get_dual_filter_levels (gfloat  radius,
+                        gfloat *offset)
+{
+  gint n_levels = 1;
+
+  while (n_levels < DUAL_FILTER_MAX_LEVELS && (2 << n_levels) < radius)
+    n_levels += 1;
+
+  *offset = radius / (2 << n_levels);
+
+  return n_levels;
+}
+
+static void
+set_half_pixel (CoglPipeline *pipeline,
+                gint          uniform,
+                gint          width,
+                gint          height,
+                gfloat        offset)
+{
+  gfloat half_pixel[2];
+
+  if (uniform < 0)
+    return;
+
+  half_pixel[0] = offset * 0.5f / width;
+  half_pixel[1] = offset * 0.5f / height;
+
+  cogl_pipeline_set_uniform_float (pipeline, uniform,
+                                   2, /* n_components */
+                                   1, /* count */
+                                   half_pixel);
+}
+
+static void
+dual_filter_pass (CoglPipeline    *pipeline,
+                  gint             half_pixel_uniform,
+                  CoglHandle       source,
+                  CoglFramebuffer *target,
+                  gfloat           offset)
+{
+  gint width = cogl_framebuffer_get_width (target);
+  gint height = cogl_framebuffer_get_height (target);
+
+  cogl_pipeline_set_layer_texture (pipeline, 0, source);
+  cogl_pipeline_set_color4ub (pipeline, 0xff, 0xff, 0xff, 0xff);
+  set_half_pixel (pipeline, half_pixel_uniform, width, height, offset);
+
+  cogl_framebuffer_clear4f (target, COGL_BUFFER_BIT_COLOR, 0, 0, 0, 0);
+  cogl_framebuffer_draw_textured_rectangle (target, pipeline,
+                                            0, 0, width, height,
+                                            0, 0, 1, 1);
+}
+
+static gboolean
+clutter_blur_effect_paint_dual_filter (ClutterBlurEffect *self,
+                                       guint8             paint_opacity)
+{
+  CoglHandle texture;
+  gfloat offset;
+  gint n_levels, i;
+
+  n_levels = get_dual_filter_levels (self->radius, &offset);
+  n_levels = blur_chain_ensure_levels (self->chain, n_levels);
+  if (n_levels == 0)
+    return FALSE;
+
+  texture =
+    clutter_offscreen_effect_get_texture (CLUTTER_OFFSCREEN_EFFECT (self));
+
+  for (i = 0; i < n_levels; i++)
+    {
+      dual_filter_pass (self->down_pipeline,
+                        self->down_half_pixel_uniform,
+                        i == 0 ? texture : self->chain->textures[i - 1],
+                        self->chain->offscreens[i],
+                        offset);
+    }
+
+  for (i = n_levels - 1; i > 0; i--)
+    {
+      dual_filter_pass (self->up_pipeline,
+                        self->up_half_pixel_uniform,
+                        self->chain->textures[i],
+                        self->chain->offscreens[i - 1],
+                        offset);
+    }
+
+  /* the last pass upsamples the first level onto the actor */
+  cogl_pipeline_set_layer_texture (self->up_pipeline, 0,
+                                   self->chain->textures[0]);
+  cogl_pipeline_set_color4ub (self->up_pipeline,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity);
+  set_half_pixel (self->up_pipeline, self->up_half_pixel_uniform,
+                  self->tex_width, self->tex_height,
+                  offset);
+
+  cogl_push_source (self->up_pipeline);
+  cogl_rectangle (0, 0, self->tex_width, self->tex_height);
+  cogl_pop_source ();
+
+  /* the journal only records which textures a rectangle reads, not
+   * their contents, so the shared levels must not be drawn to by the
+   * next effect before this one has been submitted */
+  cogl_flush ();
+
+  return TRUE;
+}
+
 static gboolean
 clutter_blur_effect_pre_paint (ClutterEffect *effect)
 {
@@ -152,6 +439,17 @@ clutter_blur_effect_pre_paint (ClutterEffect *effect)
 
       cogl_pipeline_set_layer_texture (self->pipeline, 0, texture);
 
+      if (self->radius > 0.f &&
+          (self->chain == NULL ||
+           self->chain->width != self->tex_width ||
+           self->chain->height != self->tex_height))
+        {
+          if (self->chain != NULL)
+            blur_chain_unref (self->chain);
+
+          self->chain = blur_chain_get (self->tex_width, self->tex_height);
+        }
+
       return TRUE;
     }
   else
@@ -166,6 +464,10 @@ clutter_blur_effect_paint_target (ClutterOffscreenEffect *effect)
 
   paint_opacity = clutter_actor_get_paint_opacity (self->actor);
 
+  if (self->radius > 0.f &&
+      clutter_blur_effect_paint_dual_filter (self, paint_opacity))
+    return;
+
   cogl_pipeline_set_color4ub (self->pipeline,
                               paint_opacity,
                               paint_opacity,
@@ -182,17 +484,21 @@ static gboolean
 clutter_blur_effect_get_paint_volume (ClutterEffect      *effect,
                                       ClutterPaintVolume *volume)
 {
+  ClutterBlurEffect *self = CLUTTER_BLUR_EFFECT (effect);
   gfloat cur_width, cur_height;
+  gfloat padding;
   ClutterVertex origin;
 
+  padding = MAX (BLUR_PADDING, ceilf (self->radius));
+
   clutter_paint_volume_get_origin (volume, &origin);
   cur_width = clutter_paint_volume_get_width (volume);
   cur_height = clutter_paint_volume_get_height (volume);
 
-  origin.x -= BLUR_PADDING;
-  origin.y -= BLUR_PADDING;
-  cur_width += 2 * BLUR_PADDING;
-  cur_height += 2 * BLUR_PADDING;
+  origin.x -= padding;
+  origin.y -= padding;
+  cur_width += 2 * padding;
+  cur_height += 2 * padding;
   clutter_paint_volume_set_origin (volume, &origin);
   clutter_paint_volume_set_width (volume, cur_width);
   clutter_paint_volume_set_height (volume, cur_height);
@@ -211,9 +517,67 @@ clutter_blur_effect_dispose (GObject *gobject)
       self->pipeline = NULL;
     }
 
+  if (self->down_pipeline != NULL)
+    {
+      cogl_object_unref (self->down_pipeline);
+      self->down_pipeline = NULL;
+    }
+
+  if (self->up_pipeline != NULL)
+    {
+      cogl_object_unref (self->up_pipeline);
+      self->up_pipeline = NULL;
+    }
+
+  if (self->chain != NULL)
+    {
+      blur_chain_unref (self->chain);
+      self->chain = NULL;
+    }
+
   G_OBJECT_CLASS (clutter_blur_effect_parent_class)->dispose (gobject);
 }
 
+static void
+clutter_blur_effect_set_property (GObject      *gobject,
+                                  guint         prop_id,
+                                  const GValue *value,
+                                  GParamSpec   *pspec)
+{
+  ClutterBlurEffect *effect = CLUTTER_BLUR_EFFECT (gobject);
+
+  switch (prop_id)
+    {
+    case PROP_RADIUS:
+      clutter_blur_effect_set_radius (effect, g_value_get_float (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+clutter_blur_effect_get_property (GObject    *gobject,
+                                  guint       prop_id,
+                                  GValue     *value,
+                                  GParamSpec *pspec)
+{
+  ClutterBlurEffect *effect = CLUTTER_BLUR_EFFECT (gobject);
+
+  switch (prop_id)
+    {
+    case PROP_RADIUS:
+      g_value_set_float (value, effect->radius);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
+      break;
+    }
+}
+
 static void
 clutter_blur_effect_class_init (ClutterBlurEffectClass *klass)
 {
@@ -221,7 +585,25 @@ clutter_blur_effect_class_init (ClutterBlurEffectClass *klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   ClutterOffscreenEffectClass *offscreen_class;
 
+  /**
+   * ClutterBlurEffect:radius:
+   *
+   * The radius of the blur, in pixels. A radius of 0.0 applies the
+   * default fixed box blur; any other radius uses the dual filter.
+   */
+  obj_props[PROP_RADIUS] =
+    g_param_spec_float ("radius",
+                        P_("Radius"),
+                        P_("The radius of the blur"),
+                        0.0, 128.0,
+                        0.0,
+                        CLUTTER_PARAM_READWRITE);
+
   gobject_class->dispose = clutter_blur_effect_dispose;
+  gobject_class->set_property = clutter_blur_effect_set_property;
+  gobject_class->get_property = clutter_blur_effect_get_property;
+
+  g_object_class_install_properties (gobject_class, PROP_LAST, obj_props);
 
   effect_class->pre_paint = clutter_blur_effect_pre_paint;
   effect_class->get_paint_volume = clutter_blur_effect_get_paint_volume;
@@ -230,6 +612,36 @@ clutter_blur_effect_class_init (ClutterBlurEffectClass *klass)
   offscreen_class->paint_target = clutter_blur_effect_paint_target;
 }
 
+static CoglPipeline *
+create_dual_filter_pipeline (CoglContext *ctx,
+                             const gchar *shader)
+{
+  CoglPipeline *pipeline;
+  CoglSnippet *snippet;
+
+  pipeline = cogl_pipeline_new (ctx);
+
+  snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                              dual_filter_glsl_declarations,
+                              NULL);
+  cogl_snippet_set_replace (snippet, shader);
+  cogl_pipeline_add_layer_snippet (pipeline, 0, snippet);
+  cogl_object_unref (snippet);
+
+  /* the filter relies on bilinear filtering to average four texels
+   * with each sample, and must not wrap around the edges */
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_LINEAR,
+                                   COGL_PIPELINE_FILTER_LINEAR);
+  cogl_pipeline_set_layer_wrap_mode (pipeline, 0,
+                                     COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
+  cogl_pipeline_set_layer_null_texture (pipeline,
+                                        0, /* layer number */
+                                        COGL_TEXTURE_TYPE_2D);
+
+  return pipeline;
+}
+
 static void
 clutter_blur_effect_init (ClutterBlurEffect *self)
 {
@@ -253,12 +665,25 @@ clutter_blur_effect_init (ClutterBlurEffect *self)
       cogl_pipeline_set_layer_null_texture (klass->base_pipeline,
                                             0, /* layer number */
                                             COGL_TEXTURE_TYPE_2D);
+
+      klass->base_down_pipeline =
+        create_dual_filter_pipeline (ctx, dual_filter_down_glsl_shader);
+      klass->base_up_pipeline =
+        create_dual_filter_pipeline (ctx, dual_filter_up_glsl_shader);
     }
 
   self->pipeline = cogl_pipeline_copy (klass->base_pipeline);
 
   self->pixel_step_uniform =
     cogl_pipeline_get_uniform_location (self->pipeline, "pixel_step");
+
+  self->down_pipeline = cogl_pipeline_copy (klass->base_down_pipeline);
+  self->down_half_pixel_uniform =
+    cogl_pipeline_get_uniform_location (self->down_pipeline, "half_pixel");
+
+  self->up_pipeline = cogl_pipeline_copy (klass->base_up_pipeline);
+  self->up_half_pixel_uniform =
+    cogl_pipeline_get_uniform_location (self->up_pipeline, "half_pixel");
 }
 
 /**
@@ -276,3 +701,58 @@ clutter_blur_effect_new (void)
 {
   return g_object_new (CLUTTER_TYPE_BLUR_EFFECT, NULL);
 }
+
+/**
+ * clutter_blur_effect_set_radius:
+ * @effect: a #ClutterBlurEffect
+ * @radius: the radius of the blur, in pixels
+ *
+ * Sets the radius of the blur applied by @effect. A @radius of 0.0
+ * applies the default fixed box blur; any other radius blurs the actor
+ * with the dual filter.
+ */
+void
+clutter_blur_effect_set_radius (ClutterBlurEffect *effect,
+                                gfloat             radius)
+{
+  ClutterActor *actor;
+
+  g_return_if_fail (CLUTTER_IS_BLUR_EFFECT (effect));
+  g_return_if_fail (radius >= 0.f);
+
+  if (fabsf (effect->radius - radius) < 0.00001)
+    return;
+
+  effect->radius = radius;
+
+  if (radius == 0.f && effect->chain != NULL)
+    {
+      blur_chain_unref (effect->chain);
+      effect->chain = NULL;
+    }
+
+  /* the padding added to the paint volume depends on the radius */
+  actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
+  if (actor != NULL)
+    clutter_actor_queue_relayout (actor);
+
+  clutter_effect_queue_repaint (CLUTTER_EFFECT (effect));
+
+  g_object_notify_by_pspec (G_OBJECT (effect), obj_props[PROP_RADIUS]);
+}
+
+/**
+ * clutter_blur_effect_get_radius:
+ * @effect: a #ClutterBlurEffect
+ *
+ * Retrieves the radius of the blur applied by @effect
+ *
+ * Return value: the radius, in pixels
+ */
+gfloat
+clutter_blur_effect_get_radius (ClutterBlurEffect *effect)
+{
+  g_return_val_if_fail (CLUTTER_IS_BLUR_EFFECT (effect), 0.f);
+
+  return effect->radius;
+}
@@ -54,6 +54,12 @@ GType clutter_blur_effect_get_type (void) G_GNUC_CONST;
 CLUTTER_AVAILABLE_IN_1_4
 ClutterEffect *clutter_blur_effect_new (void);
 
+CLUTTER_AVAILABLE_IN_MUFFIN
+void clutter_blur_effect_set_radius (ClutterBlurEffect *effect,
+                                     gfloat             radius);
+CLUTTER_AVAILABLE_IN_MUFFIN
+gfloat clutter_blur_effect_get_radius (ClutterBlurEffect *effect);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_BLUR_EFFECT_H__ */
@@ -287,6 +287,13 @@ clutter_brightness_contrast_effect_get_property (GObject    *gobject,
     }
 }
 
+static gboolean
+clutter_brightness_contrast_effect_preserves_opaque_region (ClutterEffect *effect)
+{
+  /* Only the color channels are changed */
+  return TRUE;
+}
+
 static void
 clutter_brightness_contrast_effect_class_init (ClutterBrightnessContrastEffectClass *klass)
 {
@@ -298,6 +305,7 @@ clutter_brightness_contrast_effect_class_init (ClutterBrightnessContrastEffectCl
   offscreen_class->paint_target = clutter_brightness_contrast_effect_paint_target;
 
   effect_class->pre_paint = clutter_brightness_contrast_effect_pre_paint;
+  effect_class->preserves_opaque_region = clutter_brightness_contrast_effect_preserves_opaque_region;
 
   gobject_class->set_property = clutter_brightness_contrast_effect_set_property;
   gobject_class->get_property = clutter_brightness_contrast_effect_get_property;
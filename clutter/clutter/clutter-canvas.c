@@ -39,6 +39,15 @@
  * See [canvas.c](https://git.gnome.org/browse/clutter/tree/examples/canvas.c?h=clutter-1.18)
  * for an example of how to use #ClutterCanvas.
  *
+ * Parts of a canvas can be redrawn with clutter_canvas_invalidate_rect():
+ * the Cairo context passed to #ClutterCanvas::draw is then clipped to the
+ * invalidated areas, which have been cleared, and only those areas are
+ * uploaded to the texture.
+ *
+ * A canvas with #ClutterCanvas:async set emits #ClutterCanvas::draw from
+ * a worker thread instead, and keeps painting its previous contents until
+ * the new ones have been drawn and uploaded.
+ *
  * #ClutterCanvas is available since Clutter 1.10.
  */
 
@@ -46,6 +55,8 @@
 #include "clutter-build-config.h"
 #endif
 
+#include <string.h>
+
 #include <cogl/cogl.h>
 #include <cairo-gobject.h>
 
@@ -65,6 +76,8 @@
 #include "clutter-private.h"
 #include "clutter-settings.h"
 
+typedef struct _ClutterCanvasDrawJob    ClutterCanvasDrawJob;
+
 struct _ClutterCanvasPrivate
 {
   cairo_t *cr;
@@ -76,6 +89,43 @@ struct _ClutterCanvasPrivate
   gboolean dirty;
 
   CoglBitmap *buffer;
+
+  /* the areas of the buffer not uploaded yet; NULL means all of it */
+  cairo_region_t *dirty_region;
+
+  /* set by clutter_canvas_invalidate_rect() for the next invalidation */
+  cairo_region_t *queued_damage;
+
+  /* asynchronous drawing: the worker draws into the back surface while
+   * the front one holds the last complete contents; back_stale is what
+   * changed in the front surface since the back one was drawn */
+  ClutterCanvasDrawJob *job;
+  cairo_region_t *pending_damage;
+  cairo_surface_t *surfaces[2];
+  cairo_region_t *back_stale;
+  int front;
+
+  guint async : 1;
+  guint front_valid : 1;
+  guint redraw_pending : 1;
+};
+
+/* A draw running on the worker thread. The job owns a reference on the
+ * canvas, which is only released on the main thread */
+struct _ClutterCanvasDrawJob
+{
+  ClutterCanvas *canvas;
+
+  int width;
+  int height;
+
+  cairo_surface_t *surface;
+  cairo_region_t *damage;
+  gboolean full;
+
+  /* the contents to bring @surface up to date with before drawing */
+  cairo_surface_t *front;
+  cairo_region_t *stale;
 };
 
 enum
@@ -84,6 +134,7 @@ enum
 
   PROP_WIDTH,
   PROP_HEIGHT,
+  PROP_ASYNC,
 
   LAST_PROP
 };
@@ -99,6 +150,12 @@ enum
 
 static guint canvas_signals[LAST_SIGNAL] = { 0, };
 
+static GThreadPool *draw_thread_pool = NULL;
+static guint        repaint_upload_func = 0;
+static GList       *finished_jobs = NULL;
+static guint        finished_jobs_idle = 0;
+static GMutex       finished_jobs_mutex;
+
 static void clutter_content_iface_init (ClutterContentIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (ClutterCanvas, clutter_canvas, G_TYPE_OBJECT,
@@ -128,6 +185,47 @@ clutter_cairo_context_draw_marshaller (GClosure     *closure,
   cairo_restore (cr);
 }
 
+static void
+clip_to_region (cairo_t              *cr,
+                const cairo_region_t *region)
+{
+  int i, n_rects;
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      cairo_rectangle (cr, rect.x, rect.y, rect.width, rect.height);
+    }
+
+  cairo_clip (cr);
+}
+
+/* Clips @cr to @damage and clears it, for a partial redraw */
+static void
+prepare_partial_draw (cairo_t              *cr,
+                      const cairo_region_t *damage)
+{
+  clip_to_region (cr, damage);
+
+  cairo_save (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_restore (cr);
+}
+
+static void
+clutter_canvas_free_surfaces (ClutterCanvasPrivate *priv)
+{
+  g_clear_pointer (&priv->surfaces[0], cairo_surface_destroy);
+  g_clear_pointer (&priv->surfaces[1], cairo_surface_destroy);
+  g_clear_pointer (&priv->back_stale, cairo_region_destroy);
+
+  priv->front_valid = FALSE;
+}
+
 static void
 clutter_canvas_finalize (GObject *gobject)
 {
@@ -141,6 +239,11 @@ clutter_canvas_finalize (GObject *gobject)
 
   g_clear_pointer (&priv->texture, cogl_object_unref);
 
+  g_clear_pointer (&priv->dirty_region, cairo_region_destroy);
+  g_clear_pointer (&priv->queued_damage, cairo_region_destroy);
+  g_clear_pointer (&priv->pending_damage, cairo_region_destroy);
+  clutter_canvas_free_surfaces (priv);
+
   G_OBJECT_CLASS (clutter_canvas_parent_class)->finalize (gobject);
 }
 
@@ -180,6 +283,11 @@ clutter_canvas_set_property (GObject      *gobject,
       }
       break;
 
+    case PROP_ASYNC:
+      clutter_canvas_set_async (CLUTTER_CANVAS (gobject),
+                                g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
       break;
@@ -204,6 +312,10 @@ clutter_canvas_get_property (GObject    *gobject,
       g_value_set_int (value, priv->height);
       break;
 
+    case PROP_ASYNC:
+      g_value_set_boolean (value, priv->async);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
       break;
@@ -247,6 +359,25 @@ clutter_canvas_class_init (ClutterCanvasClass *klass)
                       G_PARAM_READWRITE |
                       G_PARAM_STATIC_STRINGS);
 
+  /**
+   * ClutterCanvas:async:
+   *
+   * Whether the #ClutterCanvas::draw signal is emitted from a worker
+   * thread.
+   *
+   * While an asynchronous draw is running the canvas keeps painting its
+   * previous contents; the new ones are uploaded on the first frame
+   * after the draw finishes. The handlers of #ClutterCanvas::draw are
+   * then called outside of the main thread, and must not use Clutter or
+   * anything else that isn't thread safe.
+   */
+  obj_props[PROP_ASYNC] =
+    g_param_spec_boolean ("async",
+                          P_("Asynchronous"),
+                          P_("Whether the canvas is drawn in a thread"),
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS);
 
   /**
    * ClutterCanvas::draw:
@@ -262,6 +393,13 @@ clutter_canvas_class_init (ClutterCanvasClass *klass)
    * handler invocation will be automatically protected by cairo_save()
    * and cairo_restore() pairs.
    *
+   * When only parts of the canvas were invalidated, using
+   * clutter_canvas_invalidate_rect(), @cr is clipped to them and they
+   * have been cleared; the rest of the canvas keeps its contents.
+   *
+   * If #ClutterCanvas:async is set the signal is emitted from a worker
+   * thread.
+   *
    * Return value: %TRUE if the signal emission should stop, and
    *   %FALSE otherwise
    *
@@ -307,9 +445,33 @@ clutter_canvas_paint_content (ClutterContent   *content,
   if (priv->buffer == NULL)
     return;
 
-  if (priv->dirty)
+  if (priv->dirty && priv->dirty_region != NULL && priv->texture != NULL &&
+      cogl_texture_get_width (priv->texture) ==
+      cogl_bitmap_get_width (priv->buffer) &&
+      cogl_texture_get_height (priv->texture) ==
+      cogl_bitmap_get_height (priv->buffer))
+    {
+      int i, n_rects;
+
+      /* only upload what was redrawn */
+      n_rects = cairo_region_num_rectangles (priv->dirty_region);
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+
+          cairo_region_get_rectangle (priv->dirty_region, i, &rect);
+          cogl_texture_set_region_from_bitmap (priv->texture,
+                                               rect.x, rect.y,
+                                               rect.x, rect.y,
+                                               rect.width, rect.height,
+                                               priv->buffer);
+        }
+    }
+  else if (priv->dirty)
     g_clear_pointer (&priv->texture, cogl_object_unref);
 
+  g_clear_pointer (&priv->dirty_region, cairo_region_destroy);
+
   if (priv->texture == NULL)
     priv->texture = cogl_texture_new_from_bitmap (priv->buffer,
                                                   COGL_TEXTURE_NO_SLICING,
@@ -326,8 +488,25 @@ clutter_canvas_paint_content (ClutterContent   *content,
   priv->dirty = FALSE;
 }
 
+/* Records that @damage, or all of the buffer if %NULL, needs to be
+ * uploaded on the next paint */
 static void
-clutter_canvas_emit_draw (ClutterCanvas *self)
+clutter_canvas_add_dirty_region (ClutterCanvasPrivate *priv,
+                                 const cairo_region_t *damage)
+{
+  if (damage == NULL)
+    g_clear_pointer (&priv->dirty_region, cairo_region_destroy);
+  else if (!priv->dirty)
+    priv->dirty_region = cairo_region_copy (damage);
+  else if (priv->dirty_region != NULL)
+    cairo_region_union (priv->dirty_region, damage);
+
+  priv->dirty = TRUE;
+}
+
+static void
+clutter_canvas_emit_draw (ClutterCanvas  *self,
+                          cairo_region_t *damage)
 {
   ClutterCanvasPrivate *priv = self->priv;
   int real_width, real_height;
@@ -340,8 +519,6 @@ clutter_canvas_emit_draw (ClutterCanvas *self)
 
   g_assert (priv->height > 0 && priv->width > 0);
 
-  priv->dirty = TRUE;
-
   real_width = priv->width;
   real_height = priv->height;
 
@@ -365,9 +542,10 @@ clutter_canvas_emit_draw (ClutterCanvas *self)
 
   cogl_buffer_set_update_hint (buffer, COGL_BUFFER_UPDATE_HINT_DYNAMIC);
 
+  /* a partial redraw paints over the previous contents */
   data = cogl_buffer_map (buffer,
                           COGL_BUFFER_ACCESS_READ_WRITE,
-                          COGL_BUFFER_MAP_HINT_DISCARD);
+                          damage == NULL ? COGL_BUFFER_MAP_HINT_DISCARD : 0);
 
   if (data != NULL)
     {
@@ -387,10 +565,18 @@ clutter_canvas_emit_draw (ClutterCanvas *self)
                                             real_height);
 
       mapped_buffer = FALSE;
+
+      /* the new surface has none of the previous contents */
+      damage = NULL;
     }
 
+  clutter_canvas_add_dirty_region (priv, damage);
+
   self->priv->cr = cr = cairo_create (surface);
 
+  if (damage != NULL)
+    prepare_partial_draw (cr, damage);
+
   g_signal_emit (self, canvas_signals[DRAW], 0,
                  cr, priv->width, priv->height,
                  &res);
@@ -421,22 +607,384 @@ clutter_canvas_emit_draw (ClutterCanvas *self)
   cairo_surface_destroy (surface);
 }
 
+static void
+clutter_canvas_draw_job_free (ClutterCanvasDrawJob *job)
+{
+  cairo_surface_destroy (job->surface);
+  cairo_region_destroy (job->damage);
+
+  if (job->front != NULL)
+    cairo_surface_destroy (job->front);
+
+  if (job->stale != NULL)
+    cairo_region_destroy (job->stale);
+
+  g_object_unref (job->canvas);
+
+  g_slice_free (ClutterCanvasDrawJob, job);
+}
+
+static void clutter_canvas_queue_async_draw (ClutterCanvas  *self,
+                                             cairo_region_t *damage);
+
+/* Copies @damage, or all of @surface if %NULL, into the buffer that the
+ * next paint uploads */
+static void
+clutter_canvas_copy_to_buffer (ClutterCanvas        *self,
+                               cairo_surface_t      *surface,
+                               const cairo_region_t *damage)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+  cairo_rectangle_int_t extents = { 0, 0, priv->width, priv->height };
+  cairo_region_t *region;
+  const unsigned char *src;
+  unsigned char *data;
+  CoglBuffer *buffer;
+  int src_stride, dst_stride;
+  int i, n_rects;
+
+  if (priv->buffer != NULL &&
+      (cogl_bitmap_get_width (priv->buffer) != priv->width ||
+       cogl_bitmap_get_height (priv->buffer) != priv->height))
+    {
+      cogl_object_unref (priv->buffer);
+      priv->buffer = NULL;
+    }
+
+  if (priv->buffer == NULL)
+    {
+      CoglContext *ctx;
+
+      ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+      priv->buffer = cogl_bitmap_new_with_size (ctx,
+                                                priv->width,
+                                                priv->height,
+                                                CLUTTER_CAIRO_FORMAT_ARGB32);
+      damage = NULL;
+    }
+
+  buffer = COGL_BUFFER (cogl_bitmap_get_buffer (priv->buffer));
+  if (buffer == NULL)
+    return;
+
+  cogl_buffer_set_update_hint (buffer, COGL_BUFFER_UPDATE_HINT_DYNAMIC);
+
+  data = cogl_buffer_map (buffer,
+                          COGL_BUFFER_ACCESS_READ_WRITE,
+                          damage == NULL ? COGL_BUFFER_MAP_HINT_DISCARD : 0);
+
+  src = cairo_image_surface_get_data (surface);
+  src_stride = cairo_image_surface_get_stride (surface);
+  dst_stride = cogl_bitmap_get_rowstride (priv->buffer);
+
+  if (damage != NULL)
+    region = cairo_region_reference ((cairo_region_t *) damage);
+  else
+    region = cairo_region_create_rectangle (&extents);
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int y;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      for (y = rect.y; y < rect.y + rect.height; y++)
+        {
+          const unsigned char *row = src + y * src_stride + rect.x * 4;
+
+          if (data != NULL)
+            memcpy (data + y * dst_stride + rect.x * 4, row, rect.width * 4);
+          else
+            cogl_buffer_set_data (buffer,
+                                  y * dst_stride + rect.x * 4,
+                                  row,
+                                  rect.width * 4);
+        }
+    }
+
+  cairo_region_destroy (region);
+
+  if (data != NULL)
+    cogl_buffer_unmap (buffer);
+
+  clutter_canvas_add_dirty_region (priv, damage);
+}
+
+static void
+clutter_canvas_draw_job_finished (ClutterCanvasDrawJob *job)
+{
+  ClutterCanvas *self = job->canvas;
+  ClutterCanvasPrivate *priv = self->priv;
+
+  priv->job = NULL;
+
+  /* a job drawn at a size the canvas no longer has is simply dropped;
+   * the resize queued a full redraw */
+  if (priv->async &&
+      job->width == priv->width &&
+      job->height == priv->height &&
+      job->surface == priv->surfaces[1 - priv->front])
+    {
+      priv->front = 1 - priv->front;
+      priv->front_valid = TRUE;
+
+      g_clear_pointer (&priv->back_stale, cairo_region_destroy);
+      priv->back_stale = cairo_region_reference (job->damage);
+
+      clutter_canvas_copy_to_buffer (self,
+                                     job->surface,
+                                     job->full ? NULL : job->damage);
+
+      _clutter_content_queue_redraw (CLUTTER_CONTENT (self));
+    }
+
+  if (priv->redraw_pending)
+    {
+      cairo_region_t *damage = priv->pending_damage;
+
+      priv->pending_damage = NULL;
+      priv->redraw_pending = FALSE;
+
+      clutter_canvas_queue_async_draw (self, damage);
+    }
+}
+
+static gboolean
+canvas_repaint_upload_func (gpointer user_data)
+{
+  GList *jobs, *l;
+
+  g_mutex_lock (&finished_jobs_mutex);
+  jobs = finished_jobs;
+  finished_jobs = NULL;
+  g_mutex_unlock (&finished_jobs_mutex);
+
+  for (l = jobs; l != NULL; l = l->next)
+    {
+      ClutterCanvasDrawJob *job = l->data;
+
+      clutter_canvas_draw_job_finished (job);
+      clutter_canvas_draw_job_free (job);
+    }
+
+  g_list_free (jobs);
+
+  return TRUE;
+}
+
+/* Runs on the main thread once a draw has finished, so that the
+ * master clock is only ever touched from there and wakes up even if
+ * nothing else is going on */
+static gboolean
+canvas_jobs_finished_idle (gpointer user_data)
+{
+  ClutterMasterClock *master_clock = _clutter_master_clock_get_default ();
+
+  g_mutex_lock (&finished_jobs_mutex);
+  finished_jobs_idle = 0;
+  g_mutex_unlock (&finished_jobs_mutex);
+
+  if (repaint_upload_func == 0)
+    {
+      repaint_upload_func =
+        clutter_threads_add_repaint_func (canvas_repaint_upload_func,
+                                          NULL, NULL);
+    }
+
+  _clutter_master_clock_ensure_next_iteration (master_clock);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+clutter_canvas_draw_job_run (gpointer data,
+                             gpointer pool_data)
+{
+  ClutterCanvasDrawJob *job = data;
+  gboolean res;
+  cairo_t *cr;
+
+  CLUTTER_NOTE (MISC, "[async] drawing canvas %p of size %d x %d",
+                job->canvas, job->width, job->height);
+
+  cr = cairo_create (job->surface);
+
+  if (job->front != NULL)
+    {
+      /* catch up with the previous draw, which went to the front surface */
+      cairo_save (cr);
+      clip_to_region (cr, job->stale);
+      cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+      cairo_set_source_surface (cr, job->front, 0, 0);
+      cairo_paint (cr);
+      cairo_restore (cr);
+    }
+
+  if (!job->full)
+    prepare_partial_draw (cr, job->damage);
+
+  g_signal_emit (job->canvas, canvas_signals[DRAW], 0,
+                 cr, job->width, job->height,
+                 &res);
+
+#ifdef CLUTTER_ENABLE_DEBUG
+  if (_clutter_diagnostic_enabled () && cairo_status (cr))
+    {
+      g_warning ("Drawing failed for <ClutterCanvas>[%p]: %s",
+                 job->canvas,
+                 cairo_status_to_string (cairo_status (cr)));
+    }
+#endif
+
+  cairo_destroy (cr);
+  cairo_surface_flush (job->surface);
+
+  g_mutex_lock (&finished_jobs_mutex);
+
+  finished_jobs = g_list_append (finished_jobs, job);
+
+  if (finished_jobs_idle == 0)
+    {
+      finished_jobs_idle =
+        clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                       canvas_jobs_finished_idle,
+                                       NULL, NULL);
+    }
+
+  g_mutex_unlock (&finished_jobs_mutex);
+}
+
+/* Draws @damage, or all of the canvas if %NULL, on the worker thread;
+ * takes ownership of @damage */
+static void
+clutter_canvas_queue_async_draw (ClutterCanvas  *self,
+                                 cairo_region_t *damage)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+  cairo_rectangle_int_t extents = { 0, 0, priv->width, priv->height };
+  ClutterCanvasDrawJob *job;
+  int back;
+
+  if (priv->width <= 0 || priv->height <= 0)
+    {
+      g_clear_pointer (&damage, cairo_region_destroy);
+      return;
+    }
+
+  /* only one draw runs at a time; the next one merges everything
+   * invalidated in the meantime */
+  if (priv->job != NULL)
+    {
+      if (!priv->redraw_pending)
+        priv->pending_damage = damage;
+      else if (priv->pending_damage != NULL && damage != NULL)
+        cairo_region_union (priv->pending_damage, damage);
+      else
+        g_clear_pointer (&priv->pending_damage, cairo_region_destroy);
+
+      if (priv->pending_damage != damage)
+        g_clear_pointer (&damage, cairo_region_destroy);
+
+      priv->redraw_pending = TRUE;
+      return;
+    }
+
+  if (priv->surfaces[0] != NULL &&
+      (cairo_image_surface_get_width (priv->surfaces[0]) != priv->width ||
+       cairo_image_surface_get_height (priv->surfaces[0]) != priv->height))
+    clutter_canvas_free_surfaces (priv);
+
+  if (priv->surfaces[0] == NULL)
+    {
+      priv->surfaces[0] = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                      priv->width,
+                                                      priv->height);
+      priv->surfaces[1] = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                      priv->width,
+                                                      priv->height);
+      priv->front = 0;
+    }
+
+  if (!priv->front_valid)
+    g_clear_pointer (&damage, cairo_region_destroy);
+
+  back = 1 - priv->front;
+
+  job = g_slice_new0 (ClutterCanvasDrawJob);
+  job->canvas = g_object_ref (self);
+  job->width = priv->width;
+  job->height = priv->height;
+  job->surface = cairo_surface_reference (priv->surfaces[back]);
+  job->full = damage == NULL;
+
+  if (damage != NULL)
+    {
+      job->damage = damage;
+
+      if (priv->back_stale != NULL)
+        {
+          job->front = cairo_surface_reference (priv->surfaces[priv->front]);
+          job->stale = cairo_region_reference (priv->back_stale);
+        }
+    }
+  else
+    job->damage = cairo_region_create_rectangle (&extents);
+
+  priv->job = job;
+
+  if (G_UNLIKELY (draw_thread_pool == NULL))
+    {
+      /* This apparently can't fail if exclusive == FALSE */
+      draw_thread_pool =
+        g_thread_pool_new (clutter_canvas_draw_job_run, NULL,
+                           MAX (g_get_num_processors () - 1, 1),
+                           FALSE,
+                           NULL);
+    }
+
+  g_thread_pool_push (draw_thread_pool, job, NULL);
+}
+
 static void
 clutter_canvas_invalidate (ClutterContent *content)
 {
   ClutterCanvas *self = CLUTTER_CANVAS (content);
   ClutterCanvasPrivate *priv = self->priv;
+  cairo_region_t *damage;
 
-  if (priv->buffer != NULL)
+  damage = priv->queued_damage;
+  priv->queued_damage = NULL;
+
+  if (priv->async && priv->width > 0 && priv->height > 0)
+    {
+      clutter_canvas_queue_async_draw (self, damage);
+      return;
+    }
+
+  /* a partial redraw needs the previous contents of the buffer */
+  if (priv->buffer != NULL &&
+      (damage == NULL ||
+       cogl_bitmap_get_width (priv->buffer) != priv->width ||
+       cogl_bitmap_get_height (priv->buffer) != priv->height))
     {
       cogl_object_unref (priv->buffer);
       priv->buffer = NULL;
     }
 
+  if (priv->buffer == NULL)
+    g_clear_pointer (&damage, cairo_region_destroy);
+
   if (priv->width <= 0 || priv->height <= 0)
-    return;
+    {
+      g_clear_pointer (&damage, cairo_region_destroy);
+      return;
+    }
 
-  clutter_canvas_emit_draw (self);
+  clutter_canvas_emit_draw (self, damage);
+
+  g_clear_pointer (&damage, cairo_region_destroy);
 }
 
 static gboolean
@@ -562,3 +1110,107 @@ clutter_canvas_set_size (ClutterCanvas *canvas,
 
   return clutter_canvas_invalidate_internal (canvas, width, height);
 }
+
+/**
+ * clutter_canvas_invalidate_rect:
+ * @canvas: a #ClutterCanvas
+ * @rect: the area to redraw, in pixels
+ *
+ * Invalidates the area of @canvas covered by @rect, like
+ * clutter_content_invalidate() does for the whole canvas.
+ *
+ * The Cairo context passed to #ClutterCanvas::draw is clipped to the
+ * invalidated areas, which have been cleared, and only they are
+ * uploaded to the texture: handlers drawing the whole canvas anyway
+ * just have most of their drawing discarded by Cairo.
+ */
+void
+clutter_canvas_invalidate_rect (ClutterCanvas               *canvas,
+                                const cairo_rectangle_int_t *rect)
+{
+  ClutterCanvasPrivate *priv;
+  cairo_rectangle_int_t extents;
+
+  g_return_if_fail (CLUTTER_IS_CANVAS (canvas));
+  g_return_if_fail (rect != NULL);
+
+  priv = canvas->priv;
+
+  if (priv->width <= 0 || priv->height <= 0)
+    return;
+
+  extents.x = 0;
+  extents.y = 0;
+  extents.width = priv->width;
+  extents.height = priv->height;
+
+  g_clear_pointer (&priv->queued_damage, cairo_region_destroy);
+  priv->queued_damage = cairo_region_create_rectangle (rect);
+  cairo_region_intersect_rectangle (priv->queued_damage, &extents);
+
+  if (cairo_region_is_empty (priv->queued_damage))
+    {
+      g_clear_pointer (&priv->queued_damage, cairo_region_destroy);
+      return;
+    }
+
+  clutter_content_invalidate (CLUTTER_CONTENT (canvas));
+}
+
+/**
+ * clutter_canvas_set_async:
+ * @canvas: a #ClutterCanvas
+ * @async: whether to draw @canvas in a worker thread
+ *
+ * Sets whether #ClutterCanvas::draw is emitted from a worker thread;
+ * see #ClutterCanvas:async.
+ */
+void
+clutter_canvas_set_async (ClutterCanvas *canvas,
+                          gboolean       async)
+{
+  ClutterCanvasPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_CANVAS (canvas));
+
+  priv = canvas->priv;
+
+  if (priv->async == !!async)
+    return;
+
+  priv->async = !!async;
+
+  /* the surfaces miss whatever is drawn synchronously meanwhile */
+  if (priv->job == NULL)
+    clutter_canvas_free_surfaces (priv);
+  else
+    priv->front_valid = FALSE;
+
+  /* a running draw is dropped once it finishes, so what it and the
+   * draws waiting for it cover must be drawn again */
+  if (!priv->async && priv->job != NULL)
+    {
+      g_clear_pointer (&priv->pending_damage, cairo_region_destroy);
+      priv->redraw_pending = FALSE;
+
+      clutter_content_invalidate (CLUTTER_CONTENT (canvas));
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (canvas), obj_props[PROP_ASYNC]);
+}
+
+/**
+ * clutter_canvas_get_async:
+ * @canvas: a #ClutterCanvas
+ *
+ * Retrieves the value set with clutter_canvas_set_async().
+ *
+ * Return value: %TRUE if @canvas is drawn in a worker thread
+ */
+gboolean
+clutter_canvas_get_async (ClutterCanvas *canvas)
+{
+  g_return_val_if_fail (CLUTTER_IS_CANVAS (canvas), FALSE);
+
+  return canvas->priv->async;
+}
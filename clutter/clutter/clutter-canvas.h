@@ -101,6 +101,16 @@ void                    clutter_canvas_set_scale_factor         (ClutterCanvas *
 CLUTTER_AVAILABLE_IN_1_18
 int                     clutter_canvas_get_scale_factor         (ClutterCanvas *canvas);
 
+CLUTTER_AVAILABLE_IN_MUFFIN
+void                    clutter_canvas_invalidate_rect          (ClutterCanvas               *canvas,
+                                                                 const cairo_rectangle_int_t *rect);
+
+CLUTTER_AVAILABLE_IN_MUFFIN
+void                    clutter_canvas_set_async                (ClutterCanvas *canvas,
+                                                                 gboolean       async);
+CLUTTER_AVAILABLE_IN_MUFFIN
+gboolean                clutter_canvas_get_async                (ClutterCanvas *canvas);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_CANVAS_H__ */
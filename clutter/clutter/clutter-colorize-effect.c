@@ -223,6 +223,13 @@ clutter_colorize_effect_get_property (GObject    *gobject,
     }
 }
 
+static gboolean
+clutter_colorize_effect_preserves_opaque_region (ClutterEffect *effect)
+{
+  /* Only the color channels are changed */
+  return TRUE;
+}
+
 static void
 clutter_colorize_effect_class_init (ClutterColorizeEffectClass *klass)
 {
@@ -234,6 +241,7 @@ clutter_colorize_effect_class_init (ClutterColorizeEffectClass *klass)
   offscreen_class->paint_target = clutter_colorize_effect_paint_target;
 
   effect_class->pre_paint = clutter_colorize_effect_pre_paint;
+  effect_class->preserves_opaque_region = clutter_colorize_effect_preserves_opaque_region;
 
   gobject_class->set_property = clutter_colorize_effect_set_property;
   gobject_class->get_property = clutter_colorize_effect_get_property;
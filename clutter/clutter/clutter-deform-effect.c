@@ -49,6 +49,15 @@
  * Each passed vertex is an in-out parameter that initially contains the
  * position of the vertex and should be modified according to a specific
  * deformation algorithm.
+ *
+ * Calling the function on every vertex and uploading them again each
+ * time the effect changes is expensive with fine grids, so sub-classes
+ * can also give a vertex #CoglSnippet doing the same deformation on the
+ * GPU to clutter_deform_effect_set_vertex_snippet(). The grid is then
+ * only built when its size changes, undeformed, and the snippet's
+ * uniforms are updated in #ClutterDeformEffectClass.update_uniforms()
+ * instead; the deform_vertex() function is still used where GLSL isn't
+ * available.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -78,13 +87,24 @@ struct _ClutterDeformEffectPrivate
 
   CoglPrimitive *primitive;
 
+  /* The same grid without the colors, which a vertex snippet works out
+   * from the pipeline's color */
+  CoglPrimitive *flat_primitive;
+
   CoglPrimitive *lines_primitive;
 
+  CoglSnippet *vertex_snippet;
+
+  /* The size the undeformed grid in the buffer was built for */
+  gfloat flat_width;
+  gfloat flat_height;
+
   gint n_vertices;
 
   gulong allocation_id;
 
   guint is_dirty : 1;
+  guint buffer_is_flat : 1;
 };
 
 enum
@@ -129,6 +149,25 @@ clutter_deform_effect_deform_vertex (ClutterDeformEffect *effect,
                                                            vertex);
 }
 
+static void
+clutter_deform_effect_update_uniforms (ClutterDeformEffect *effect,
+                                       CoglPipeline        *pipeline,
+                                       gfloat               width,
+                                       gfloat               height)
+{
+  ClutterDeformEffectClass *klass = CLUTTER_DEFORM_EFFECT_GET_CLASS (effect);
+
+  if (klass->update_uniforms != NULL)
+    klass->update_uniforms (effect, pipeline, width, height);
+}
+
+static gboolean
+clutter_deform_effect_uses_snippet (ClutterDeformEffect *effect)
+{
+  return (effect->priv->vertex_snippet != NULL &&
+          clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL));
+}
+
 static void
 vbo_invalidate (ClutterActor           *actor,
                 const ClutterActorBox  *allocation,
@@ -167,6 +206,105 @@ clutter_deform_effect_set_actor (ClutterActorMeta *meta,
   CLUTTER_ACTOR_META_CLASS (clutter_deform_effect_parent_class)->set_actor (meta, actor);
 }
 
+/* Fills the buffer with the grid for a @width by @height target,
+ * deformed by the deform_vertex() function or left flat for a vertex
+ * snippet to deform */
+static void
+clutter_deform_effect_fill_buffer (ClutterDeformEffect *self,
+                                   gfloat               width,
+                                   gfloat               height,
+                                   gboolean             deform)
+{
+  ClutterDeformEffectPrivate *priv = self->priv;
+  gboolean mapped_buffer;
+  CoglVertexP3T2C4 *verts;
+  ClutterActor *actor;
+  guint opacity;
+  gint i, j;
+
+  actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (self));
+  opacity = clutter_actor_get_paint_opacity (actor);
+
+  /* XXX ideally, the sub-classes should tell us what they
+   * changed in the texture vertices; we then would be able to
+   * avoid resubmitting the same data, if it did not change. for
+   * the time being, we resubmit everything
+   */
+  verts = cogl_buffer_map (COGL_BUFFER (priv->buffer),
+                           COGL_BUFFER_ACCESS_WRITE,
+                           COGL_BUFFER_MAP_HINT_DISCARD);
+
+  /* If the map failed then we'll resort to allocating a temporary
+     buffer */
+  if (verts == NULL)
+    {
+      mapped_buffer = FALSE;
+      verts = malloc (sizeof (*verts) * priv->n_vertices);
+    }
+  else
+    mapped_buffer = TRUE;
+
+  for (i = 0; i < priv->y_tiles + 1; i++)
+    {
+      for (j = 0; j < priv->x_tiles + 1; j++)
+        {
+          CoglVertexP3T2C4 *vertex_out;
+          CoglTextureVertex vertex;
+
+          /* CoglTextureVertex isn't an ideal structure to use for
+             this because it contains a CoglColor. The internal
+             layout of CoglColor is mean to be private so Clutter
+             can not pass a pointer to it as a vertex
+             attribute. Also it contains padding so we end up
+             storing more data in the vertex buffer than we need
+             to. Instead we let the application modify a dummy
+             vertex and then copy the details back out to a more
+             well-defined struct */
+
+          vertex.tx = (float) j / priv->x_tiles;
+          vertex.ty = (float) i / priv->y_tiles;
+
+          vertex.x = width * vertex.tx;
+          vertex.y = height * vertex.ty;
+          vertex.z = 0.0f;
+
+          cogl_color_init_from_4ub (&vertex.color, 255, 255, 255, opacity);
+
+          if (deform)
+            clutter_deform_effect_deform_vertex (self,
+                                                 width, height,
+                                                 &vertex);
+
+          vertex_out = verts + i * (priv->x_tiles + 1) + j;
+
+          vertex_out->x = vertex.x;
+          vertex_out->y = vertex.y;
+          vertex_out->z = vertex.z;
+          vertex_out->s = vertex.tx;
+          vertex_out->t = vertex.ty;
+          vertex_out->r = cogl_color_get_red_byte (&vertex.color);
+          vertex_out->g = cogl_color_get_green_byte (&vertex.color);
+          vertex_out->b = cogl_color_get_blue_byte (&vertex.color);
+          vertex_out->a = cogl_color_get_alpha_byte (&vertex.color);
+        }
+    }
+
+  if (mapped_buffer)
+    cogl_buffer_unmap (COGL_BUFFER (priv->buffer));
+  else
+    {
+      cogl_buffer_set_data (COGL_BUFFER (priv->buffer),
+                            0, /* offset */
+                            verts,
+                            sizeof (*verts) * priv->n_vertices);
+      free (verts);
+    }
+
+  priv->buffer_is_flat = !deform;
+  priv->flat_width = width;
+  priv->flat_height = height;
+}
+
 static void
 clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
 {
@@ -174,106 +312,38 @@ clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
   ClutterDeformEffectPrivate *priv = self->priv;
   CoglHandle material;
   CoglPipeline *pipeline;
+  CoglPrimitive *primitive;
   CoglDepthState depth_state;
   CoglFramebuffer *fb = cogl_get_draw_framebuffer ();
+  gboolean use_snippet = clutter_deform_effect_uses_snippet (self);
+  ClutterRect rect;
+  gfloat width, height;
 
-  if (priv->is_dirty)
+  /* if we don't have a target size, fall back to the actor's
+   * allocation, though wrong it might be
+   */
+  if (clutter_offscreen_effect_get_target_rect (effect, &rect))
     {
-      ClutterRect rect;
-      gboolean mapped_buffer;
-      CoglVertexP3T2C4 *verts;
-      ClutterActor *actor;
-      gfloat width, height;
-      guint opacity;
-      gint i, j;
-
-      actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
-      opacity = clutter_actor_get_paint_opacity (actor);
-
-      /* if we don't have a target size, fall back to the actor's
-       * allocation, though wrong it might be
-       */
-      if (clutter_offscreen_effect_get_target_rect (effect, &rect))
-        {
-          width = clutter_rect_get_width (&rect);
-          height = clutter_rect_get_height (&rect);
-        }
-      else
-        clutter_actor_get_size (actor, &width, &height);
-
-      /* XXX ideally, the sub-classes should tell us what they
-       * changed in the texture vertices; we then would be able to
-       * avoid resubmitting the same data, if it did not change. for
-       * the time being, we resubmit everything
-       */
-      verts = cogl_buffer_map (COGL_BUFFER (priv->buffer),
-                               COGL_BUFFER_ACCESS_WRITE,
-                               COGL_BUFFER_MAP_HINT_DISCARD);
-
-      /* If the map failed then we'll resort to allocating a temporary
-         buffer */
-      if (verts == NULL)
-        {
-          mapped_buffer = FALSE;
-          verts = malloc (sizeof (*verts) * priv->n_vertices);
-        }
-      else
-        mapped_buffer = TRUE;
+      width = clutter_rect_get_width (&rect);
+      height = clutter_rect_get_height (&rect);
+    }
+  else
+    clutter_actor_get_size (clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect)),
+                            &width, &height);
 
-      for (i = 0; i < priv->y_tiles + 1; i++)
-        {
-          for (j = 0; j < priv->x_tiles + 1; j++)
-            {
-              CoglVertexP3T2C4 *vertex_out;
-              CoglTextureVertex vertex;
-
-              /* CoglTextureVertex isn't an ideal structure to use for
-                 this because it contains a CoglColor. The internal
-                 layout of CoglColor is mean to be private so Clutter
-                 can not pass a pointer to it as a vertex
-                 attribute. Also it contains padding so we end up
-                 storing more data in the vertex buffer than we need
-                 to. Instead we let the application modify a dummy
-                 vertex and then copy the details back out to a more
-                 well-defined struct */
-
-              vertex.tx = (float) j / priv->x_tiles;
-              vertex.ty = (float) i / priv->y_tiles;
-
-              vertex.x = width * vertex.tx;
-              vertex.y = height * vertex.ty;
-              vertex.z = 0.0f;
-
-              cogl_color_init_from_4ub (&vertex.color, 255, 255, 255, opacity);
-
-              clutter_deform_effect_deform_vertex (self,
-                                                   width, height,
-                                                   &vertex);
-
-              vertex_out = verts + i * (priv->x_tiles + 1) + j;
-
-              vertex_out->x = vertex.x;
-              vertex_out->y = vertex.y;
-              vertex_out->z = vertex.z;
-              vertex_out->s = vertex.tx;
-              vertex_out->t = vertex.ty;
-              vertex_out->r = cogl_color_get_red_byte (&vertex.color);
-              vertex_out->g = cogl_color_get_green_byte (&vertex.color);
-              vertex_out->b = cogl_color_get_blue_byte (&vertex.color);
-              vertex_out->a = cogl_color_get_alpha_byte (&vertex.color);
-            }
-        }
+  if (use_snippet)
+    {
+      /* The grid only changes with its size */
+      if (!priv->buffer_is_flat ||
+          priv->flat_width != width ||
+          priv->flat_height != height)
+        clutter_deform_effect_fill_buffer (self, width, height, FALSE);
 
-      if (mapped_buffer)
-        cogl_buffer_unmap (COGL_BUFFER (priv->buffer));
-      else
-        {
-          cogl_buffer_set_data (COGL_BUFFER (priv->buffer),
-                                0, /* offset */
-                                verts,
-                                sizeof (*verts) * priv->n_vertices);
-          free (verts);
-        }
+      priv->is_dirty = FALSE;
+    }
+  else if (priv->is_dirty || priv->buffer_is_flat)
+    {
+      clutter_deform_effect_fill_buffer (self, width, height, TRUE);
 
       priv->is_dirty = FALSE;
     }
@@ -284,16 +354,42 @@ clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
   /* enable depth testing */
   cogl_depth_state_init (&depth_state);
   cogl_depth_state_set_test_enabled (&depth_state, TRUE);
-  cogl_pipeline_set_depth_state (pipeline, &depth_state, NULL);
+
+  if (use_snippet && pipeline != NULL)
+    {
+      guint8 opacity =
+        clutter_actor_get_paint_opacity (clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect)));
+
+      /* Each paint gets its own uniform values */
+      pipeline = cogl_pipeline_copy (pipeline);
+      cogl_pipeline_add_snippet (pipeline, priv->vertex_snippet);
+      cogl_pipeline_set_color4ub (pipeline, opacity, opacity, opacity, opacity);
+      clutter_deform_effect_update_uniforms (self, pipeline, width, height);
+
+      primitive = priv->flat_primitive;
+    }
+  else
+    {
+      if (pipeline != NULL)
+        cogl_object_ref (pipeline);
+
+      primitive = priv->primitive;
+    }
+
+  if (pipeline != NULL)
+    cogl_pipeline_set_depth_state (pipeline, &depth_state, NULL);
 
   /* enable backface culling if we have a back material */
-  if (priv->back_pipeline != NULL)
+  if (pipeline != NULL && priv->back_pipeline != NULL)
     cogl_pipeline_set_cull_face_mode (pipeline,
                                       COGL_PIPELINE_CULL_FACE_MODE_BACK);
 
   /* draw the front */
-  if (material != NULL)
-    cogl_framebuffer_draw_primitive (fb, pipeline, priv->primitive);
+  if (pipeline != NULL)
+    {
+      cogl_framebuffer_draw_primitive (fb, pipeline, primitive);
+      cogl_object_unref (pipeline);
+    }
 
   /* draw the back */
   if (priv->back_pipeline != NULL)
@@ -307,7 +403,14 @@ clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
       cogl_pipeline_set_cull_face_mode (back_pipeline,
                                         COGL_PIPELINE_CULL_FACE_MODE_FRONT);
 
-      cogl_framebuffer_draw_primitive (fb, back_pipeline, priv->primitive);
+      if (use_snippet)
+        {
+          cogl_pipeline_add_snippet (back_pipeline, priv->vertex_snippet);
+          clutter_deform_effect_update_uniforms (self, back_pipeline,
+                                                 width, height);
+        }
+
+      cogl_framebuffer_draw_primitive (fb, back_pipeline, primitive);
 
       cogl_object_unref (back_pipeline);
     }
@@ -318,6 +421,12 @@ clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
         clutter_backend_get_cogl_context (clutter_get_default_backend ());
       CoglPipeline *lines_pipeline = cogl_pipeline_new (ctx);
       cogl_pipeline_set_color4f (lines_pipeline, 1.0, 0, 0, 1.0);
+      if (use_snippet)
+        {
+          cogl_pipeline_add_snippet (lines_pipeline, priv->vertex_snippet);
+          clutter_deform_effect_update_uniforms (self, lines_pipeline,
+                                                 width, height);
+        }
       cogl_framebuffer_draw_primitive (fb, lines_pipeline,
                                        priv->lines_primitive);
       cogl_object_unref (lines_pipeline);
@@ -341,6 +450,12 @@ clutter_deform_effect_free_arrays (ClutterDeformEffect *self)
       priv->primitive = NULL;
     }
 
+  if (priv->flat_primitive)
+    {
+      cogl_object_unref (priv->flat_primitive);
+      priv->flat_primitive = NULL;
+    }
+
   if (priv->lines_primitive)
     {
       cogl_object_unref (priv->lines_primitive);
@@ -468,6 +583,15 @@ clutter_deform_effect_init_arrays (ClutterDeformEffect *self)
                               indices,
                               n_indices);
 
+  priv->flat_primitive =
+    cogl_primitive_new_with_attributes (COGL_VERTICES_MODE_TRIANGLE_STRIP,
+                                        priv->n_vertices,
+                                        attributes,
+                                        2 /* n_attributes */);
+  cogl_primitive_set_indices (priv->flat_primitive,
+                              indices,
+                              n_indices);
+
   if (G_UNLIKELY (clutter_paint_debug_flags & CLUTTER_DEBUG_PAINT_DEFORM_TILES))
     {
       priv->lines_primitive =
@@ -486,6 +610,8 @@ clutter_deform_effect_init_arrays (ClutterDeformEffect *self)
     cogl_object_unref (attributes[i]);
 
   priv->is_dirty = TRUE;
+  priv->buffer_is_flat = FALSE;
+  priv->flat_width = priv->flat_height = -1;
 }
 
 static inline void
@@ -508,6 +634,9 @@ clutter_deform_effect_finalize (GObject *gobject)
   clutter_deform_effect_free_arrays (self);
   clutter_deform_effect_free_back_pipeline (self);
 
+  if (self->priv->vertex_snippet != NULL)
+    cogl_object_unref (self->priv->vertex_snippet);
+
   G_OBJECT_CLASS (clutter_deform_effect_parent_class)->finalize (gobject);
 }
 
@@ -802,12 +931,59 @@ clutter_deform_effect_invalidate (ClutterDeformEffect *effect)
 
   g_return_if_fail (CLUTTER_IS_DEFORM_EFFECT (effect));
 
-  if (effect->priv->is_dirty)
-    return;
+  /* A vertex snippet only needs its uniforms to be set again */
+  if (!clutter_deform_effect_uses_snippet (effect))
+    {
+      if (effect->priv->is_dirty)
+        return;
 
-  effect->priv->is_dirty = TRUE;
+      effect->priv->is_dirty = TRUE;
+    }
 
   actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
   if (actor != NULL)
     clutter_effect_queue_repaint (CLUTTER_EFFECT (effect));
 }
+
+/**
+ * clutter_deform_effect_set_vertex_snippet:
+ * @effect: a #ClutterDeformEffect
+ * @snippet: (allow-none): a #CoglSnippet for the vertex hooks, or %NULL
+ *
+ * Sets a snippet deforming the grid on the GPU, instead of the
+ * #ClutterDeformEffectClass.deform_vertex() function on the CPU. The
+ * snippet is given the undeformed grid, in pixels of the actor, in
+ * cogl_position_in and cogl_tex_coord0_in, and should set
+ * cogl_position_out from it; it may also change cogl_color_out, which is
+ * the actor's paint opacity. The uniforms it declares are set in the
+ * #ClutterDeformEffectClass.update_uniforms() function before each
+ * paint, and clutter_deform_effect_invalidate() then only queues a
+ * repaint.
+ *
+ * The deform_vertex() function is still used when GLSL isn't
+ * available, so it should do the same deformation.
+ *
+ * The #ClutterDeformEffect will take a reference on the snippet.
+ */
+void
+clutter_deform_effect_set_vertex_snippet (ClutterDeformEffect *effect,
+                                          CoglSnippet         *snippet)
+{
+  ClutterDeformEffectPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_DEFORM_EFFECT (effect));
+  g_return_if_fail (snippet == NULL || cogl_is_snippet (snippet));
+
+  priv = effect->priv;
+
+  if (snippet != NULL)
+    cogl_object_ref (snippet);
+  if (priv->vertex_snippet != NULL)
+    cogl_object_unref (priv->vertex_snippet);
+  priv->vertex_snippet = snippet;
+
+  priv->is_dirty = TRUE;
+
+  if (clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect)) != NULL)
+    clutter_effect_queue_repaint (CLUTTER_EFFECT (effect));
+}
@@ -65,6 +65,10 @@ struct _ClutterDeformEffect
  * ClutterDeformEffectClass:
  * @deform_vertex: virtual function; sub-classes should override this
  *   function to compute the deformation of each vertex
+ * @update_uniforms: virtual function; sub-classes giving a vertex
+ *   snippet to clutter_deform_effect_set_vertex_snippet() should
+ *   override this function to set the uniforms of the snippet on
+ *   @pipeline for a deformation of a @width by @height target
  *
  * The #ClutterDeformEffectClass structure contains
  * only private data
@@ -82,8 +86,12 @@ struct _ClutterDeformEffectClass
                           gfloat               height,
                           CoglTextureVertex   *vertex);
 
+  void (* update_uniforms) (ClutterDeformEffect *effect,
+                            CoglPipeline        *pipeline,
+                            gfloat               width,
+                            gfloat               height);
+
   /*< private >*/
-  void (*_clutter_deform1) (void);
   void (*_clutter_deform2) (void);
   void (*_clutter_deform3) (void);
   void (*_clutter_deform4) (void);
@@ -112,6 +120,10 @@ void            clutter_deform_effect_get_n_tiles       (ClutterDeformEffect *ef
 CLUTTER_AVAILABLE_IN_1_4
 void            clutter_deform_effect_invalidate        (ClutterDeformEffect *effect);
 
+CLUTTER_AVAILABLE_IN_MUFFIN
+void            clutter_deform_effect_set_vertex_snippet (ClutterDeformEffect *effect,
+                                                          CoglSnippet         *snippet);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_DEFORM_EFFECT_H__ */
@@ -245,6 +245,13 @@ update_factor_uniform (ClutterDesaturateEffect *self)
                                   self->factor);
 }
 
+static gboolean
+clutter_desaturate_effect_preserves_opaque_region (ClutterEffect *effect)
+{
+  /* Only the color channels are changed */
+  return TRUE;
+}
+
 static void
 clutter_desaturate_effect_class_init (ClutterDesaturateEffectClass *klass)
 {
@@ -256,6 +263,7 @@ clutter_desaturate_effect_class_init (ClutterDesaturateEffectClass *klass)
   offscreen_class->paint_target = clutter_desaturate_effect_paint_target;
 
   effect_class->pre_paint = clutter_desaturate_effect_pre_paint;
+  effect_class->preserves_opaque_region = clutter_desaturate_effect_preserves_opaque_region;
 
   /**
    * ClutterDesaturateEffect:factor:
@@ -228,6 +228,12 @@ clutter_effect_real_pick (ClutterEffect           *effect,
   clutter_actor_continue_paint (actor);
 }
 
+static gboolean
+clutter_effect_real_preserves_opaque_region (ClutterEffect *effect)
+{
+  return FALSE;
+}
+
 static void
 clutter_effect_notify (GObject    *gobject,
                        GParamSpec *pspec)
@@ -257,6 +263,7 @@ clutter_effect_class_init (ClutterEffectClass *klass)
   klass->get_paint_volume = clutter_effect_real_get_paint_volume;
   klass->paint = clutter_effect_real_paint;
   klass->pick = clutter_effect_real_pick;
+  klass->preserves_opaque_region = clutter_effect_real_preserves_opaque_region;
 }
 
 static void
@@ -366,3 +373,26 @@ clutter_effect_queue_repaint (ClutterEffect *effect)
                                       NULL, /* clip volume */
                                       effect /* effect */);
 }
+
+/**
+ * clutter_effect_preserves_opaque_region:
+ * @effect: a #ClutterEffect
+ *
+ * Checks whether @effect leaves the area covered by the opaque parts of
+ * its actor unchanged: the effect paints the actor's pixels in the same
+ * place and does not lower their alpha. A compositor can then keep
+ * treating the actor as an occluder of what lies beneath it while the
+ * effect is applied.
+ *
+ * Effects that move, distort or fade their actor must return %FALSE,
+ * which is the default.
+ *
+ * Return value: %TRUE if the effect preserves the opaque region
+ */
+gboolean
+clutter_effect_preserves_opaque_region (ClutterEffect *effect)
+{
+  g_return_val_if_fail (CLUTTER_IS_EFFECT (effect), FALSE);
+
+  return CLUTTER_EFFECT_GET_CLASS (effect)->preserves_opaque_region (effect);
+}
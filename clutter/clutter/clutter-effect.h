@@ -63,6 +63,9 @@ struct _ClutterEffect
  * @get_paint_volume: virtual function
  * @paint: virtual function
  * @pick: virtual function
+ * @preserves_opaque_region: virtual function; returns %TRUE if the effect
+ *   paints the actor's pixels where the actor would, without making any
+ *   of them less opaque
  *
  * The #ClutterEffectClass structure contains only private data
  *
@@ -85,8 +88,9 @@ struct _ClutterEffectClass
   void     (* pick)             (ClutterEffect           *effect,
                                  ClutterEffectPaintFlags  flags);
 
+  gboolean (* preserves_opaque_region) (ClutterEffect *effect);
+
   /*< private >*/
-  void (* _clutter_effect4) (void);
   void (* _clutter_effect5) (void);
   void (* _clutter_effect6) (void);
 };
@@ -97,6 +101,9 @@ GType clutter_effect_get_type (void) G_GNUC_CONST;
 CLUTTER_AVAILABLE_IN_1_8
 void    clutter_effect_queue_repaint    (ClutterEffect *effect);
 
+CLUTTER_AVAILABLE_IN_MUFFIN
+gboolean clutter_effect_preserves_opaque_region (ClutterEffect *effect);
+
 /*
  * ClutterActor API
  */
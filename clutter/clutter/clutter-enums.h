@@ -463,6 +463,12 @@ typedef enum { /*< prefix=CLUTTER_ACTOR >*/
  *   virtual returns %TRUE. This is the default.
  * @CLUTTER_OFFSCREEN_REDIRECT_ALWAYS: Always redirect the actor to an
  *   offscreen buffer even if it is fully opaque.
+ * @CLUTTER_OFFSCREEN_REDIRECT_AUTOMATIC_FOR_STATIC: Redirect the actor
+ *   once it has been painted a few times without anything in it
+ *   changing, if painting it means painting many actors. The redirect
+ *   is dropped as soon as the actor changes again, or when the images
+ *   of other actors redirected this way already use too much memory.
+ *   Available since Muffin.
  *
  * Possible flags to pass to clutter_actor_set_offscreen_redirect().
  *
@@ -470,7 +476,8 @@ typedef enum { /*< prefix=CLUTTER_ACTOR >*/
  */
 typedef enum { /*< prefix=CLUTTER_OFFSCREEN_REDIRECT >*/
   CLUTTER_OFFSCREEN_REDIRECT_AUTOMATIC_FOR_OPACITY = 1<<0,
-  CLUTTER_OFFSCREEN_REDIRECT_ALWAYS = 1<<1
+  CLUTTER_OFFSCREEN_REDIRECT_ALWAYS = 1<<1,
+  CLUTTER_OFFSCREEN_REDIRECT_AUTOMATIC_FOR_STATIC = 1<<2
 } ClutterOffscreenRedirect;
 
 /**
@@ -34,6 +34,7 @@
 #include "clutter-private.h"
 
 #include <math.h>
+#include <string.h>
 
 /**
  * SECTION:clutter-event
@@ -77,6 +78,15 @@ typedef struct _ClutterEventFilter {
 
 static GHashTable *all_events = NULL;
 
+/* Freed events are kept for reuse, so that a steady stream of input,
+ * each event of which is freed once the stage has processed it, doesn't
+ * go through the allocator. Events are only created and freed on the
+ * main thread. */
+#define EVENT_POOL_SIZE 64
+
+static ClutterEventPrivate *event_pool[EVENT_POOL_SIZE];
+static guint n_pooled_events = 0;
+
 G_DEFINE_BOXED_TYPE (ClutterEvent, clutter_event,
                      clutter_event_copy,
                      clutter_event_free);
@@ -1324,7 +1334,13 @@ clutter_event_new (ClutterEventType type)
   ClutterEvent *new_event;
   ClutterEventPrivate *priv;
 
-  priv = g_slice_new0 (ClutterEventPrivate);
+  if (n_pooled_events > 0)
+    {
+      priv = event_pool[--n_pooled_events];
+      memset (priv, 0, sizeof (ClutterEventPrivate));
+    }
+  else
+    priv = g_slice_new0 (ClutterEventPrivate);
 
   new_event = (ClutterEvent *) priv;
   new_event->type = new_event->any.type = type;
@@ -1462,7 +1478,11 @@ clutter_event_free (ClutterEvent *event)
         }
 
       g_hash_table_remove (all_events, event);
-      g_slice_free (ClutterEventPrivate, (ClutterEventPrivate *) event);
+
+      if (n_pooled_events < EVENT_POOL_SIZE)
+        event_pool[n_pooled_events++] = (ClutterEventPrivate *) event;
+      else
+        g_slice_free (ClutterEventPrivate, (ClutterEventPrivate *) event);
     }
 }
 
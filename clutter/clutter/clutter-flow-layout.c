@@ -183,6 +183,26 @@ compute_lines (ClutterFlowLayout *self,
     return get_rows (self, avail_height);
 }
 
+/* The line arrays are kept between requests, so that relayouts of
+ * a large flow don't allocate them again each time
+ */
+static void
+clear_lines (ClutterFlowLayoutPrivate *priv)
+{
+  if (priv->line_min == NULL)
+    {
+      priv->line_min = g_array_sized_new (FALSE, FALSE,
+                                          sizeof (gfloat),
+                                          16);
+      priv->line_natural = g_array_sized_new (FALSE, FALSE,
+                                              sizeof (gfloat),
+                                              16);
+    }
+
+  g_array_set_size (priv->line_min, 0);
+  g_array_set_size (priv->line_natural, 0);
+}
+
 static void
 clutter_flow_layout_get_preferred_width (ClutterLayoutManager *manager,
                                          ClutterContainer     *container,
@@ -214,19 +234,7 @@ clutter_flow_layout_get_preferred_width (ClutterLayoutManager *manager,
 
   actor = CLUTTER_ACTOR (container);
 
-  /* clear the line width arrays */
-  if (priv->line_min != NULL)
-    g_array_free (priv->line_min, TRUE);
-
-  if (priv->line_natural != NULL)
-    g_array_free (priv->line_natural, TRUE);
-
-  priv->line_min = g_array_sized_new (FALSE, FALSE,
-                                      sizeof (gfloat),
-                                      16);
-  priv->line_natural = g_array_sized_new (FALSE, FALSE,
-                                          sizeof (gfloat),
-                                          16);
+  clear_lines (priv);
 
   if (clutter_actor_get_n_children (actor) != 0)
     line_count = 1;
@@ -405,19 +413,7 @@ clutter_flow_layout_get_preferred_height (ClutterLayoutManager *manager,
 
   actor = CLUTTER_ACTOR (container);
 
-  /* clear the line height arrays */
-  if (priv->line_min != NULL)
-    g_array_free (priv->line_min, TRUE);
-
-  if (priv->line_natural != NULL)
-    g_array_free (priv->line_natural, TRUE);
-
-  priv->line_min = g_array_sized_new (FALSE, FALSE,
-                                      sizeof (gfloat),
-                                      16);
-  priv->line_natural = g_array_sized_new (FALSE, FALSE,
-                                          sizeof (gfloat),
-                                          16);
+  clear_lines (priv);
 
   if (clutter_actor_get_n_children (actor) != 0)
     line_count = 1;
@@ -75,6 +75,7 @@ typedef struct _ClutterGridLine         ClutterGridLine;
 typedef struct _ClutterGridLines        ClutterGridLines;
 typedef struct _ClutterGridLineData     ClutterGridLineData;
 typedef struct _ClutterGridRequest      ClutterGridRequest;
+typedef struct _ClutterGridRequestChild ClutterGridRequestChild;
 
 
 struct _ClutterGridAttach
@@ -136,10 +137,25 @@ struct _ClutterGridLines
   gint min, max;
 };
 
+/* A ClutterGridRequestChild struct holds what the passes of a
+ * request need to know about a child, looked up once per request
+ */
+struct _ClutterGridRequestChild
+{
+  ClutterActor *actor;
+  ClutterGridChild *grid_child;
+
+  guint visible : 1;
+  gboolean expand[2];
+};
+
 struct _ClutterGridRequest
 {
   ClutterGridLayout *grid;
   ClutterGridLines lines[2];
+
+  ClutterGridRequestChild *children;
+  gint n_children;
 };
 
 enum
@@ -391,27 +407,55 @@ clutter_grid_request_update_attach (ClutterGridRequest *request)
     clutter_grid_request_update_child_attach (request, child);
 }
 
-/* Calculates the min and max numbers for both orientations.
+/* Looks up the child meta, visibility and expand flags of the
+ * children once, rather than in each of the passes over them.
+ * Requires the children to be attached.
  */
 static void
-clutter_grid_request_count_lines (ClutterGridRequest *request)
+clutter_grid_request_collect_children (ClutterGridRequest *request)
 {
   ClutterGridLayoutPrivate *priv = request->grid->priv;
-  ClutterGridChild *grid_child;
-  ClutterGridAttach *attach;
+  ClutterGridRequestChild *request_child;
   ClutterActorIter iter;
   ClutterActor *child;
+
+  request->n_children =
+    clutter_actor_get_n_children (CLUTTER_ACTOR (priv->container));
+  request->children = g_new (ClutterGridRequestChild, request->n_children);
+
+  request_child = request->children;
+
+  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (priv->container));
+  while (clutter_actor_iter_next (&iter, &child))
+    {
+      request_child->actor = child;
+      request_child->grid_child = GET_GRID_CHILD (request->grid, child);
+      request_child->visible = clutter_actor_is_visible (child);
+      request_child->expand[CLUTTER_ORIENTATION_HORIZONTAL] =
+        clutter_actor_needs_expand (child, CLUTTER_ORIENTATION_HORIZONTAL);
+      request_child->expand[CLUTTER_ORIENTATION_VERTICAL] =
+        clutter_actor_needs_expand (child, CLUTTER_ORIENTATION_VERTICAL);
+
+      request_child++;
+    }
+}
+
+/* Calculates the min and max numbers for both orientations.
+ */
+static void
+clutter_grid_request_count_lines (ClutterGridRequest *request)
+{
+  ClutterGridAttach *attach;
   gint min[2];
   gint max[2];
+  gint i;
 
   min[0] = min[1] = G_MAXINT;
   max[0] = max[1] = G_MININT;
 
-  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (priv->container));
-  while (clutter_actor_iter_next (&iter, &child))
+  for (i = 0; i < request->n_children; i++)
     {
-      grid_child = GET_GRID_CHILD (request->grid, child);
-      attach = grid_child->attach;
+      attach = request->children[i].grid_child->attach;
 
       min[0] = MIN (min[0], attach[0].pos);
       max[0] = MAX (max[0], attach[0].pos + attach[0].span);
@@ -432,12 +476,9 @@ static void
 clutter_grid_request_init (ClutterGridRequest *request,
                            ClutterOrientation  orientation)
 {
-  ClutterGridLayoutPrivate *priv = request->grid->priv;
-  ClutterGridChild *grid_child;
+  ClutterGridRequestChild *request_child;
   ClutterGridAttach *attach;
   ClutterGridLines *lines;
-  ClutterActorIter iter;
-  ClutterActor *child;
   gint i;
 
   lines = &request->lines[orientation];
@@ -449,12 +490,11 @@ clutter_grid_request_init (ClutterGridRequest *request,
       lines->lines[i].expand = FALSE;
     }
 
-  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (priv->container));
-  while (clutter_actor_iter_next (&iter, &child))
+  for (i = 0; i < request->n_children; i++)
     {
-      grid_child = GET_GRID_CHILD (request->grid, child);
-      attach = &grid_child->attach[orientation];
-      if (attach->span == 1 && clutter_actor_needs_expand (child, orientation))
+      request_child = &request->children[i];
+      attach = &request_child->grid_child->attach[orientation];
+      if (attach->span == 1 && request_child->expand[orientation])
         lines->lines[attach->pos - lines->min].expand = TRUE;
     }
 }
@@ -463,11 +503,10 @@ clutter_grid_request_init (ClutterGridRequest *request,
  */
 static gfloat
 compute_allocation_for_child (ClutterGridRequest *request,
-                              ClutterActor       *child,
+                              ClutterGridChild   *grid_child,
                               ClutterOrientation  orientation)
 {
   ClutterGridLayoutPrivate *priv = request->grid->priv;
-  ClutterGridChild *grid_child;
   ClutterGridLineData *linedata;
   ClutterGridLines *lines;
   ClutterGridLine *line;
@@ -475,7 +514,6 @@ compute_allocation_for_child (ClutterGridRequest *request,
   gfloat size;
   gint i;
 
-  grid_child = GET_GRID_CHILD (request->grid, child);
   linedata = &priv->linedata[orientation];
   lines = &request->lines[orientation];
   attach = &grid_child->attach[orientation];
@@ -491,18 +529,21 @@ compute_allocation_for_child (ClutterGridRequest *request,
 }
 
 static void
-compute_request_for_child (ClutterGridRequest *request,
-                           ClutterActor       *child,
-                           ClutterOrientation  orientation,
-                           gboolean            contextual,
-                           gfloat             *minimum,
-                           gfloat             *natural)
+compute_request_for_child (ClutterGridRequest      *request,
+                           ClutterGridRequestChild *request_child,
+                           ClutterOrientation       orientation,
+                           gboolean                 contextual,
+                           gfloat                  *minimum,
+                           gfloat                  *natural)
 {
+  ClutterActor *child = request_child->actor;
+
   if (contextual)
     {
       gfloat size;
 
-      size = compute_allocation_for_child (request, child, 1 - orientation);
+      size = compute_allocation_for_child (request, request_child->grid_child,
+                                           1 - orientation);
       if (orientation == CLUTTER_ORIENTATION_HORIZONTAL)
         clutter_actor_get_preferred_width (child, size, minimum, natural);
       else
@@ -526,31 +567,27 @@ clutter_grid_request_non_spanning (ClutterGridRequest *request,
                                    ClutterOrientation  orientation,
                                    gboolean            contextual)
 {
-  ClutterGridLayoutPrivate *priv = request->grid->priv;
-  ClutterGridChild *grid_child;
+  ClutterGridRequestChild *request_child;
   ClutterGridAttach *attach;
   ClutterGridLines *lines;
   ClutterGridLine *line;
-  ClutterActorIter iter;
-  ClutterActor *child;
   gfloat minimum;
   gfloat natural;
+  gint i;
 
   lines = &request->lines[orientation];
 
-  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (priv->container));
-  while (clutter_actor_iter_next (&iter, &child))
+  for (i = 0; i < request->n_children; i++)
     {
-      if (!clutter_actor_is_visible (child))
+      request_child = &request->children[i];
+      if (!request_child->visible)
         continue;
 
-      grid_child = GET_GRID_CHILD (request->grid, child);
-
-      attach = &grid_child->attach[orientation];
+      attach = &request_child->grid_child->attach[orientation];
       if (attach->span != 1)
         continue;
 
-      compute_request_for_child (request, child, orientation, contextual, &minimum, &natural);
+      compute_request_for_child (request, request_child, orientation, contextual, &minimum, &natural);
 
       line = &lines->lines[attach->pos - lines->min];
       line->minimum = MAX (line->minimum, minimum);
@@ -602,9 +639,7 @@ clutter_grid_request_spanning (ClutterGridRequest *request,
                                gboolean            contextual)
 {
   ClutterGridLayoutPrivate *priv = request->grid->priv;
-  ClutterGridChild *grid_child;
-  ClutterActor *child;
-  ClutterActorIter iter;
+  ClutterGridRequestChild *request_child;
   ClutterGridAttach *attach;
   ClutterGridLineData *linedata;
   ClutterGridLines *lines;
@@ -618,25 +653,23 @@ clutter_grid_request_spanning (ClutterGridRequest *request,
   gint extra;
   gint expand;
   gint line_extra;
-  gint i;
+  gint i, j;
 
   linedata = &priv->linedata[orientation];
   lines = &request->lines[orientation];
 
-  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (priv->container));
-  while (clutter_actor_iter_next (&iter, &child))
+  for (j = 0; j < request->n_children; j++)
     {
-      if (!clutter_actor_is_visible (child))
+      request_child = &request->children[j];
+      if (!request_child->visible)
         continue;
 
-      grid_child = GET_GRID_CHILD (request->grid, child);
-
-      attach = &grid_child->attach[orientation];
+      attach = &request_child->grid_child->attach[orientation];
       if (attach->span == 1)
         continue;
 
-      compute_request_for_child (request, child, orientation, contextual,
-                                 &minimum, &natural);
+      compute_request_for_child (request, request_child, orientation,
+                                 contextual, &minimum, &natural);
 
       span_minimum = (attach->span - 1) * linedata->spacing;
       span_natural = (attach->span - 1) * linedata->spacing;
@@ -739,12 +772,9 @@ clutter_grid_request_compute_expand (ClutterGridRequest *request,
                                      gint               *nonempty_lines,
                                      gint               *expand_lines)
 {
-  ClutterGridLayoutPrivate *priv = request->grid->priv;
-  ClutterGridChild *grid_child;
+  ClutterGridRequestChild *request_child;
   ClutterGridAttach *attach;
-  ClutterActorIter iter;
-  ClutterActor *child;
-  gint i;
+  gint i, j;
   ClutterGridLines *lines;
   ClutterGridLine *line;
   gboolean has_expand;
@@ -760,34 +790,30 @@ clutter_grid_request_compute_expand (ClutterGridRequest *request,
       lines->lines[i].empty = TRUE;
     }
 
-  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (priv->container));
-  while (clutter_actor_iter_next (&iter, &child))
+  for (j = 0; j < request->n_children; j++)
     {
-      if (!clutter_actor_is_visible (child))
+      request_child = &request->children[j];
+      if (!request_child->visible)
         continue;
 
-      grid_child = GET_GRID_CHILD (request->grid, child);
-
-      attach = &grid_child->attach[orientation];
+      attach = &request_child->grid_child->attach[orientation];
       if (attach->span != 1)
         continue;
 
       line = &lines->lines[attach->pos - lines->min];
       line->empty = FALSE;
-      if (clutter_actor_needs_expand (child, orientation))
+      if (request_child->expand[orientation])
         line->expand = TRUE;
     }
 
 
-  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (priv->container));
-  while (clutter_actor_iter_next (&iter, &child))
+  for (j = 0; j < request->n_children; j++)
     {
-      if (!clutter_actor_is_visible (child))
+      request_child = &request->children[j];
+      if (!request_child->visible)
         continue;
 
-      grid_child = GET_GRID_CHILD (request->grid, child);
-
-      attach = &grid_child->attach[orientation];
+      attach = &request_child->grid_child->attach[orientation];
       if (attach->span == 1)
         continue;
 
@@ -800,7 +826,7 @@ clutter_grid_request_compute_expand (ClutterGridRequest *request,
             has_expand = TRUE;
         }
 
-      if (!has_expand && clutter_actor_needs_expand (child, orientation))
+      if (!has_expand && request_child->expand[orientation])
         {
           for (i = 0; i < attach->span; i++)
             {
@@ -1301,6 +1327,7 @@ clutter_grid_layout_get_size_for_size (ClutterGridLayout  *self,
 
   request.grid = self;
   clutter_grid_request_update_attach (&request);
+  clutter_grid_request_collect_children (&request);
   clutter_grid_request_count_lines (&request);
 
   lines = &request.lines[0];
@@ -1317,6 +1344,8 @@ clutter_grid_layout_get_size_for_size (ClutterGridLayout  *self,
 
   clutter_grid_request_run (&request, orientation, TRUE);
   clutter_grid_request_sum (&request, orientation, minimum, natural);
+
+  g_free (request.children);
 }
 
 static void
@@ -1400,12 +1429,12 @@ clutter_grid_layout_allocate (ClutterLayoutManager   *layout,
   ClutterOrientation orientation;
   ClutterGridRequest request;
   ClutterGridLines *lines;
-  ClutterActorIter iter;
-  ClutterActor *child;
+  gint i;
 
   request.grid = self;
 
   clutter_grid_request_update_attach (&request);
+  clutter_grid_request_collect_children (&request);
   clutter_grid_request_count_lines (&request);
   lines = &request.lines[0];
   lines->lines = g_newa (ClutterGridLine, lines->max - lines->min);
@@ -1428,17 +1457,18 @@ clutter_grid_layout_allocate (ClutterLayoutManager   *layout,
   clutter_grid_request_position (&request, 0);
   clutter_grid_request_position (&request, 1);
 
-  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (container));
-  while (clutter_actor_iter_next (&iter, &child))
+  for (i = 0; i < request.n_children; i++)
     {
       ClutterActorBox child_allocation;
       gfloat x, y, width, height;
       ClutterGridChild *grid_child;
+      ClutterActor *child;
 
-      if (!clutter_actor_is_visible (child))
+      if (!request.children[i].visible)
         continue;
 
-      grid_child = GET_GRID_CHILD (self, child);
+      child = request.children[i].actor;
+      grid_child = request.children[i].grid_child;
       allocate_child (&request, CLUTTER_ORIENTATION_HORIZONTAL, grid_child,
                       &x, &width);
       allocate_child (&request, CLUTTER_ORIENTATION_VERTICAL, grid_child,
@@ -1457,6 +1487,8 @@ clutter_grid_layout_allocate (ClutterLayoutManager   *layout,
 
       clutter_actor_allocate (child, &child_allocation, flags);
     }
+
+  g_free (request.children);
 }
 
 static GType
@@ -23,6 +23,9 @@
  *
  *
  * ClutterIDPool: pool of reusable integer ids associated with pointers.
+ * Ids are handed out in order and all of them are given back at once
+ * with _clutter_id_pool_clear(), so the ids stay dense and a lookup is
+ * an index into an array.
  *
  * Author: Øyvind Kolås <pippin@o-hand-com>
  *
@@ -38,7 +41,6 @@
 struct _ClutterIDPool
 {
   GArray *array;     /* Array of pointers    */
-  GSList *free_ids;  /* A stack of freed ids */
 };
 
 ClutterIDPool *
@@ -50,7 +52,6 @@ _clutter_id_pool_new  (guint initial_size)
 
   self->array = g_array_sized_new (FALSE, FALSE, 
                                    sizeof (gpointer), initial_size);
-  self->free_ids = NULL;
   return self;
 }
 
@@ -60,7 +61,6 @@ _clutter_id_pool_free (ClutterIDPool *id_pool)
   g_return_if_fail (id_pool != NULL);
 
   g_array_free (id_pool->array, TRUE);
-  g_slist_free (id_pool->free_ids);
   g_slice_free (ClutterIDPool, id_pool);
 }
 
@@ -68,43 +68,32 @@ guint32
 _clutter_id_pool_add (ClutterIDPool *id_pool,
                       gpointer       ptr)
 {
-  gpointer *array;
   guint32 retval;
 
   g_return_val_if_fail (id_pool != NULL, 0);
 
-  if (id_pool->free_ids) /* There are items on our freelist, reuse one */
-    {
-      array = (void*) id_pool->array->data;
-      retval = GPOINTER_TO_UINT (id_pool->free_ids->data);
-
-      id_pool->free_ids = g_slist_remove (id_pool->free_ids,
-                                          id_pool->free_ids->data);
-      array[retval] = ptr;
-      return retval;
-    }
-
-  /* Allocate new id */
   retval = id_pool->array->len;
   g_array_append_val (id_pool->array, ptr);
 
   return retval;
 }
 
+/* Drops every id at once; the array keeps its allocation for the next
+ * round of _clutter_id_pool_add() calls */
 void
-_clutter_id_pool_remove (ClutterIDPool *id_pool,
-                         guint32        id_)
+_clutter_id_pool_clear (ClutterIDPool *id_pool)
 {
-  gpointer *array;
-
   g_return_if_fail (id_pool != NULL);
 
-  array = (void*) id_pool->array->data;
+  g_array_set_size (id_pool->array, 0);
+}
 
-  array[id_] = NULL;
+guint
+_clutter_id_pool_get_size (ClutterIDPool *id_pool)
+{
+  g_return_val_if_fail (id_pool != NULL, 0);
 
-  id_pool->free_ids = g_slist_prepend (id_pool->free_ids,
-                                       GUINT_TO_POINTER (id_));
+  return id_pool->array->len;
 }
 
 gpointer
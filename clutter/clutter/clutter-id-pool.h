@@ -21,6 +21,7 @@
  * License along with this library. If not, see <http://www.gnu.org/licenses/>.
  *
  * ClutterIDPool: pool of reusable integer ids associated with pointers.
+ * The ids are given back all at once, see clutter-id-pool.c.
  *
  * Author: Øyvind Kolås <pippin@o-hand.com>
  */
@@ -39,8 +40,8 @@ void            _clutter_id_pool_free   (ClutterIDPool *id_pool);
 
 guint32         _clutter_id_pool_add    (ClutterIDPool *id_pool,
                                          gpointer       ptr);
-void            _clutter_id_pool_remove (ClutterIDPool *id_pool,
-                                         guint32        id_);
+void            _clutter_id_pool_clear  (ClutterIDPool *id_pool);
+guint           _clutter_id_pool_get_size (ClutterIDPool *id_pool);
 gpointer        _clutter_id_pool_lookup (ClutterIDPool *id_pool,
                                          guint32        id_);
 
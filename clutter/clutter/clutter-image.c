@@ -42,12 +42,17 @@
 
 #define CLUTTER_ENABLE_EXPERIMENTAL_API
 
+#include <string.h>
+
+#include <gio/gio.h>
+
 #include "clutter-image.h"
 
 #include "clutter-actor-private.h"
 #include "clutter-color.h"
 #include "clutter-content-private.h"
 #include "clutter-debug.h"
+#include "clutter-main.h"
 #include "clutter-paint-node.h"
 #include "clutter-paint-nodes.h"
 #include "clutter-private.h"
@@ -55,8 +60,33 @@
 struct _ClutterImagePrivate
 {
   CoglTexture *texture;
+
+  /* Bumped by each queued upload, so that only the latest is used */
+  guint upload_serial;
 };
 
+/* An image queued by clutter_image_queue_bytes() */
+typedef struct
+{
+  ClutterImage *image;
+  guint serial;
+
+  GBytes *data;
+  CoglPixelFormat pixel_format;
+  guint width;
+  guint height;
+  guint row_stride;
+
+  /* Only touched in the main thread */
+  CoglPixelBuffer *buffer;
+  /* The mapped buffer, written by the worker thread */
+  guint8 *pixels;
+} ClutterImageUpload;
+
+/* Uploads converted and waiting for the next frame */
+static GQueue pending_uploads = G_QUEUE_INIT;
+static guint upload_repaint_id = 0;
+
 static void clutter_content_iface_init (ClutterContentIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (ClutterImage, clutter_image, G_TYPE_OBJECT,
@@ -217,6 +247,7 @@ clutter_image_set_data (ClutterImage     *image,
   g_return_val_if_fail (data != NULL, FALSE);
 
   priv = image->priv;
+  priv->upload_serial++;
 
   if (priv->texture != NULL)
     cogl_object_unref (priv->texture);
@@ -285,6 +316,7 @@ clutter_image_set_bytes (ClutterImage     *image,
   g_return_val_if_fail (data != NULL, FALSE);
 
   priv = image->priv;
+  priv->upload_serial++;
 
   if (priv->texture != NULL)
     cogl_object_unref (priv->texture);
@@ -356,6 +388,7 @@ clutter_image_set_area (ClutterImage                 *image,
   g_return_val_if_fail (area != NULL, FALSE);
 
   priv = image->priv;
+  priv->upload_serial++;
 
   if (priv->texture == NULL)
     {
@@ -405,6 +438,239 @@ clutter_image_set_area (ClutterImage                 *image,
   return TRUE;
 }
 
+static void
+clutter_image_upload_free (ClutterImageUpload *upload)
+{
+  if (upload->buffer != NULL)
+    {
+      if (upload->pixels != NULL)
+        cogl_buffer_unmap (COGL_BUFFER (upload->buffer));
+      cogl_object_unref (upload->buffer);
+    }
+
+  g_bytes_unref (upload->data);
+  g_object_unref (upload->image);
+  g_slice_free (ClutterImageUpload, upload);
+}
+
+/* Copies @upload's data into its pixel buffer, premultiplying the
+ * formats that GL can't be given unpremultiplied, so that uploading it
+ * needs no conversion */
+static void
+convert_upload (ClutterImageUpload *upload)
+{
+  const guint8 *src = g_bytes_get_data (upload->data, NULL);
+  CoglPixelFormat format = upload->pixel_format;
+  gboolean premultiply;
+  int alpha, first;
+  guint x, y;
+
+  premultiply = (format == COGL_PIXEL_FORMAT_RGBA_8888 ||
+                 format == COGL_PIXEL_FORMAT_BGRA_8888 ||
+                 format == COGL_PIXEL_FORMAT_ARGB_8888 ||
+                 format == COGL_PIXEL_FORMAT_ABGR_8888);
+
+  if (!premultiply)
+    {
+      memcpy (upload->pixels, src, (gsize) upload->row_stride * upload->height);
+      return;
+    }
+
+  /* The alpha byte is either first or last */
+  alpha = (format & COGL_AFIRST_BIT) ? 0 : 3;
+  first = (format & COGL_AFIRST_BIT) ? 1 : 0;
+
+  for (y = 0; y < upload->height; y++)
+    {
+      const guint8 *src_row = src + y * upload->row_stride;
+      guint8 *dst_row = upload->pixels + y * upload->row_stride;
+
+      for (x = 0; x < upload->width; x++)
+        {
+          const guint8 *p = src_row + x * 4;
+          guint8 *q = dst_row + x * 4;
+          guint a = p[alpha];
+          int i;
+
+          q[alpha] = a;
+          for (i = first; i < first + 3; i++)
+            {
+              guint t = p[i] * a + 128;
+
+              q[i] = (t + (t >> 8)) >> 8;
+            }
+        }
+    }
+
+  upload->pixel_format = (CoglPixelFormat) (format | COGL_PREMULT_BIT);
+}
+
+static void
+convert_upload_thread (GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable)
+{
+  convert_upload (task_data);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+finish_upload (ClutterImageUpload *upload)
+{
+  ClutterImagePrivate *priv = upload->image->priv;
+  CoglBitmap *bitmap;
+  CoglTexture *texture;
+  CoglError *error = NULL;
+
+  /* A later upload replaced this one */
+  if (upload->serial != priv->upload_serial)
+    return;
+
+  cogl_buffer_unmap (COGL_BUFFER (upload->buffer));
+  upload->pixels = NULL;
+
+  bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (upload->buffer),
+                                        upload->pixel_format,
+                                        upload->width, upload->height,
+                                        upload->row_stride, 0);
+  texture = COGL_TEXTURE (cogl_texture_2d_new_from_bitmap (bitmap));
+  cogl_object_unref (bitmap);
+
+  if (!cogl_texture_allocate (texture, &error))
+    {
+      g_warning ("Unable to upload image data: %s", error->message);
+      cogl_error_free (error);
+      cogl_object_unref (texture);
+      return;
+    }
+
+  if (priv->texture != NULL)
+    cogl_object_unref (priv->texture);
+  priv->texture = texture;
+
+  clutter_content_invalidate (CLUTTER_CONTENT (upload->image));
+}
+
+/* The textures are swapped before the frame is painted, so the actors
+ * show the old image up to that frame and the new one from it */
+static gboolean
+upload_repaint_func (gpointer data)
+{
+  ClutterImageUpload *upload;
+
+  while ((upload = g_queue_pop_head (&pending_uploads)) != NULL)
+    {
+      finish_upload (upload);
+      clutter_image_upload_free (upload);
+    }
+
+  upload_repaint_id = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_upload_converted (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+  ClutterImageUpload *upload = user_data;
+
+  g_task_propagate_boolean (G_TASK (result), NULL);
+
+  if (upload->serial != upload->image->priv->upload_serial)
+    {
+      clutter_image_upload_free (upload);
+      return;
+    }
+
+  g_queue_push_tail (&pending_uploads, upload);
+
+  if (upload_repaint_id == 0)
+    upload_repaint_id =
+      clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_PRE_PAINT,
+                                             upload_repaint_func,
+                                             NULL, NULL);
+
+  /* Get a frame painted; the texture is swapped before it is */
+  clutter_content_invalidate (CLUTTER_CONTENT (upload->image));
+}
+
+/**
+ * clutter_image_queue_bytes:
+ * @image: a #ClutterImage
+ * @data: the image data, as a #GBytes
+ * @pixel_format: the Cogl pixel format of the image data
+ * @width: the width of the image data
+ * @height: the height of the image data
+ * @row_stride: the length of each row inside @data
+ *
+ * Like clutter_image_set_bytes(), but without blocking the caller: a
+ * reference is taken on @data, which is converted for uploading on a
+ * worker thread into a pixel buffer, and the texture is created from
+ * that buffer at the start of the next frame. Until then, @image keeps
+ * showing what it showed before.
+ *
+ * When images are queued again before the previous one is shown, only
+ * the latest is. @data must not be changed until it isn't referenced
+ * any more.
+ */
+void
+clutter_image_queue_bytes (ClutterImage    *image,
+                           GBytes          *data,
+                           CoglPixelFormat  pixel_format,
+                           guint            width,
+                           guint            height,
+                           guint            row_stride)
+{
+  ClutterImageUpload *upload;
+  CoglContext *ctx;
+  GTask *task;
+
+  g_return_if_fail (CLUTTER_IS_IMAGE (image));
+  g_return_if_fail (data != NULL);
+  g_return_if_fail (g_bytes_get_size (data) >= (gsize) row_stride * height);
+
+  upload = g_slice_new0 (ClutterImageUpload);
+  upload->image = g_object_ref (image);
+  upload->serial = ++image->priv->upload_serial;
+  upload->data = g_bytes_ref (data);
+  upload->pixel_format = pixel_format;
+  upload->width = width;
+  upload->height = height;
+  upload->row_stride = row_stride;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  upload->buffer = cogl_pixel_buffer_new (ctx, (gsize) row_stride * height,
+                                          NULL);
+  upload->pixels = cogl_buffer_map (COGL_BUFFER (upload->buffer),
+                                    COGL_BUFFER_ACCESS_WRITE,
+                                    COGL_BUFFER_MAP_HINT_DISCARD);
+
+  if (upload->pixels == NULL)
+    {
+      GError *error = NULL;
+
+      /* Nothing to hand over to a thread */
+      if (!clutter_image_set_bytes (image, data, pixel_format,
+                                    width, height, row_stride, &error))
+        {
+          g_warning ("%s", error->message);
+          g_error_free (error);
+        }
+
+      clutter_image_upload_free (upload);
+      return;
+    }
+
+  task = g_task_new (NULL, NULL, on_upload_converted, upload);
+  g_task_set_task_data (task, upload, NULL);
+  g_task_run_in_thread (task, convert_upload_thread);
+  g_object_unref (task);
+}
+
 /**
  * clutter_image_get_texture:
  * @image: a #ClutterImage
@@ -131,6 +131,14 @@ gboolean                clutter_image_set_bytes         (ClutterImage
                                                          guint                         row_stride,
                                                          GError                      **error);
 
+CLUTTER_AVAILABLE_IN_MUFFIN
+void                    clutter_image_queue_bytes       (ClutterImage                 *image,
+                                                         GBytes                       *data,
+                                                         CoglPixelFormat               pixel_format,
+                                                         guint                         width,
+                                                         guint                         height,
+                                                         guint                         row_stride);
+
 CLUTTER_AVAILABLE_IN_1_10
 CoglTexture *           clutter_image_get_texture       (ClutterImage                 *image);
 
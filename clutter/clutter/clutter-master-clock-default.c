@@ -33,12 +33,18 @@
 #include "clutter-build-config.h"
 #endif
 
+#include <unistd.h>
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#endif
+
 #include "clutter-master-clock.h"
 #include "clutter-master-clock-default.h"
 #include "clutter-debug.h"
 #include "clutter-private.h"
 #include "clutter-stage-manager-private.h"
 #include "clutter-stage-private.h"
+#include "clutter-trace-private.h"
 #include "clutter-muffin.h"
 
 #ifdef CLUTTER_ENABLE_DEBUG
@@ -82,6 +88,24 @@ struct _ClutterMasterClockDefault
    */
   GSource *source;
 
+  /* a timerfd polled by the source, so that frames can be started with
+   * microsecond rather than millisecond precision; -1 if unavailable
+   */
+  int timer_fd;
+  gpointer timer_fd_tag;
+  gint64 timer_ready_time;
+
+  /* with CLUTTER_VIRTUAL_REFRESH, the fixed interval between frames;
+   * 0 otherwise */
+  gint64 virtual_interval;
+
+  /* with a frame rate cap, the shortest interval between frames; 0
+   * otherwise */
+  gint64 min_interval;
+
+  /* the monotonic time the last frame was dispatched at */
+  gint64 prev_dispatch_time;
+
   guint ensure_next_iteration : 1;
 
   guint paused : 1;
@@ -258,11 +282,66 @@ master_clock_reschedule_stage_updates (ClutterMasterClockDefault *master_clock,
  *
  * Return value: A valid timestamp in microseconds. Never fails.
  */
+/*
+ * master_clock_get_refresh_interval:
+ * @master_clock: a #ClutterMasterClock
+ *
+ * Returns the refresh interval, in microseconds, of the fastest output
+ * the stages were last presented on, falling back to the default frame
+ * rate until a frame has been presented.
+ */
 static gint64
-master_clock_next_frame_time (ClutterMasterClockDefault *master_clock)
+master_clock_get_refresh_interval (ClutterMasterClockDefault *master_clock)
+{
+  ClutterStageManager *stage_manager = clutter_stage_manager_get_default ();
+  const GSList *l;
+  float refresh_rate = 0.0;
+
+  for (l = stage_manager->stages; l != NULL; l = l->next)
+    refresh_rate = MAX (refresh_rate,
+                        _clutter_stage_get_refresh_rate (l->data));
+
+  if (refresh_rate <= 0.0)
+    refresh_rate = clutter_get_default_frame_rate ();
+
+  return (gint64) (0.5 + G_USEC_PER_SEC / refresh_rate);
+}
+
+/*
+ * master_clock_next_virtual_frame_time:
+ * @master_clock: a #ClutterMasterClock
+ *
+ * Frames are dispatched at a fixed rate when a virtual refresh is set,
+ * whatever the stages report about presentation, so that runs without
+ * a real display behave the same from one run to the next.
+ */
+static gint64
+master_clock_next_virtual_frame_time (ClutterMasterClockDefault *master_clock)
 {
   gint64 next, now, interval;
 
+  master_clock->active_sync_method = SYNC_FALLBACK;
+
+  now = g_source_get_time (master_clock->source);
+  interval = master_clock->virtual_interval;
+
+  if (!master_clock->prev_dispatch_time)
+    return now;
+
+  next = master_clock->prev_dispatch_time + interval;
+  if (next < (now - interval))  /* Idle or too slow; don't catch up. */
+    next = now;
+  return next;
+}
+
+static gint64
+master_clock_next_synced_frame_time (ClutterMasterClockDefault *master_clock)
+{
+  gint64 next, now, interval;
+
+  if (master_clock->virtual_interval > 0)
+    return master_clock_next_virtual_frame_time (master_clock);
+
   if (master_clock->preferred_sync_method >= SYNC_PRESENTATION_TIME)
     {
       next = master_clock_get_hw_update_time (master_clock);
@@ -293,27 +372,43 @@ master_clock_next_frame_time (ClutterMasterClockDefault *master_clock)
     }
 
   master_clock->active_sync_method = SYNC_FALLBACK;
-  interval = 1000000 / clutter_get_default_frame_rate ();
+  interval = master_clock_get_refresh_interval (master_clock);
   next = master_clock->prev_tick + interval;
   if (next < (now - interval))  /* Too old? Must have been sleeping. */
     next = now;
   return next;
 }
 
+static gint64
+master_clock_next_frame_time (ClutterMasterClockDefault *master_clock)
+{
+  gint64 next = master_clock_next_synced_frame_time (master_clock);
+
+  /* The cap only ever delays a frame; after an idle spell the first
+   * frame still goes out at once */
+  if (master_clock->min_interval > 0 && master_clock->prev_dispatch_time)
+    next = MAX (next, master_clock->prev_dispatch_time +
+                      master_clock->min_interval);
+
+  return next;
+}
+
 /*
  * master_clock_next_frame_delay:
  * @master_clock: a #ClutterMasterClock
+ * @next_p: (out): return location for the time of the next frame
  *
  * Computes the number of delay before we need to draw the next frame.
  *
  * Return value: -1 if there is no next frame pending, otherwise the
- *  number of millseconds before the we need to draw the next frame
+ *  number of microseconds before the we need to draw the next frame
  */
-static gint
-master_clock_next_frame_delay (ClutterMasterClockDefault *master_clock)
+static gint64
+master_clock_next_frame_delay (ClutterMasterClockDefault *master_clock,
+                               gint64                    *next_p)
 {
   gint64 now, next;
-  gint delay_ms;
+  gint64 delay;
 
   if (!master_clock_is_running (master_clock))
     return -1;
@@ -321,21 +416,63 @@ master_clock_next_frame_delay (ClutterMasterClockDefault *master_clock)
   now = g_source_get_time (master_clock->source);
   next = master_clock_next_frame_time (master_clock);
 
-  /* Round your microseconds UP to milliseconds! If we were to round down
-   * then we'd spend an entire millisecond per frame continuously
-   * dispatching without any throttling. Thus spinning the CPU at around 6%
-   * for a 60Hz display.
-   */
   if (next > now)
-    delay_ms = (next - now + 999) / 1000;  /* Always round up! */
+    delay = next - now;
   else
-    delay_ms = 0;
+    delay = 0;
 
 #ifdef CLUTTER_ENABLE_DEBUG
-  CLUTTER_NOTE (SCHEDULER, "Waiting %d ms", delay_ms);
+  CLUTTER_NOTE (SCHEDULER, "Waiting %" G_GINT64_FORMAT " us", delay);
 #endif
 
-  return delay_ms;
+  if (next_p)
+    *next_p = next;
+
+  return delay;
+}
+
+/*
+ * master_clock_arm_timer:
+ * @master_clock: a #ClutterMasterClock
+ * @ready_time: the monotonic time to wake up at, or -1 to disarm
+ *
+ * Sets the timerfd polled by the clock source to expire at @ready_time.
+ *
+ * Return value: %TRUE if the timer is armed, %FALSE if the source has
+ *  to fall back to a poll timeout
+ */
+static gboolean
+master_clock_arm_timer (ClutterMasterClockDefault *master_clock,
+                        gint64                     ready_time)
+{
+#ifdef HAVE_SYS_TIMERFD_H
+  struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+
+  if (master_clock->timer_fd < 0)
+    return FALSE;
+
+  if (ready_time == master_clock->timer_ready_time)
+    return TRUE;
+
+  /* g_get_monotonic_time() is CLOCK_MONOTONIC, so the frame times can
+   * be used as absolute expirations directly. An all-zero value
+   * disarms the timer. */
+  if (ready_time > 0)
+    {
+      spec.it_value.tv_sec = ready_time / G_USEC_PER_SEC;
+      spec.it_value.tv_nsec = (ready_time % G_USEC_PER_SEC) * 1000;
+    }
+
+  if (timerfd_settime (master_clock->timer_fd, TFD_TIMER_ABSTIME,
+                       &spec, NULL) < 0)
+    return FALSE;
+
+  master_clock->timer_ready_time = ready_time;
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
 }
 
 static void
@@ -416,14 +553,25 @@ static gboolean
 master_clock_update_stages (ClutterMasterClockDefault *master_clock,
                             GSList                    *stages)
 {
+  CoglContext *cogl_context =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
   gboolean stages_updated = FALSE;
   GSList *l;
 #ifdef CLUTTER_ENABLE_DEBUG
   gint64 start = g_get_monotonic_time ();
 #endif
 
+  CLUTTER_TRACE (frame_start);
+
   _clutter_run_repaint_functions (CLUTTER_REPAINT_FLAGS_PRE_PAINT);
 
+  /* Texture uploads queued with cogl_texture_queue_region() land
+   * before the stages are painted, as far as the budget for the frame
+   * goes; the clock keeps going until they all have
+   */
+  if (cogl_context_flush_uploads (cogl_context))
+    master_clock->ensure_next_iteration = TRUE;
+
   /* Update any stage that needs redraw/relayout after the clock
    * is advanced.
    */
@@ -432,6 +580,8 @@ master_clock_update_stages (ClutterMasterClockDefault *master_clock,
 
   _clutter_run_repaint_functions (CLUTTER_REPAINT_FLAGS_POST_PAINT);
 
+  CLUTTER_TRACE1 (frame_end, stages_updated);
+
 #ifdef CLUTTER_ENABLE_DEBUG
   if (_clutter_diagnostic_enabled ())
     clutter_warn_if_over_budget (master_clock, start, "Updating the stage");
@@ -471,7 +621,7 @@ clutter_clock_prepare (GSource *source,
 {
   ClutterClockSource *clock_source = (ClutterClockSource *) source;
   ClutterMasterClockDefault *master_clock = clock_source->master_clock;
-  int delay;
+  gint64 delay, next;
 
   if (G_UNLIKELY (clutter_paint_debug_flags &
                   CLUTTER_DEBUG_CONTINUOUS_REDRAW))
@@ -486,9 +636,26 @@ clutter_clock_prepare (GSource *source,
         clutter_actor_queue_redraw (l->data);
     }
 
-  delay = master_clock_next_frame_delay (master_clock);
+  delay = master_clock_next_frame_delay (master_clock, &next);
 
-  *timeout = delay;
+  if (delay <= 0)
+    {
+      master_clock_arm_timer (master_clock, -1);
+      *timeout = delay;
+    }
+  else if (master_clock_arm_timer (master_clock, next))
+    {
+      *timeout = -1;
+    }
+  else
+    {
+      /* Round your microseconds UP to milliseconds! If we were to round
+       * down then we'd spend an entire millisecond per frame continuously
+       * dispatching without any throttling. Thus spinning the CPU at
+       * around 6% for a 60Hz display.
+       */
+      *timeout = (delay + 999) / 1000;  /* Always round up! */
+    }
 
   return delay == 0;
 }
@@ -498,9 +665,20 @@ clutter_clock_check (GSource *source)
 {
   ClutterClockSource *clock_source = (ClutterClockSource *) source;
   ClutterMasterClockDefault *master_clock = clock_source->master_clock;
-  int delay;
+  gint64 delay;
+
+  if (master_clock->timer_fd_tag != NULL &&
+      g_source_query_unix_fd (source, master_clock->timer_fd_tag) & G_IO_IN)
+    {
+      guint64 expirations;
 
-  delay = master_clock_next_frame_delay (master_clock);
+      /* Drain the expiration so the fd stops polling as readable */
+      if (read (master_clock->timer_fd, &expirations,
+                sizeof (expirations)) == sizeof (expirations))
+        master_clock->timer_ready_time = -1;
+    }
+
+  delay = master_clock_next_frame_delay (master_clock, NULL);
 
   return delay == 0;
 }
@@ -520,6 +698,14 @@ clutter_clock_dispatch (GSource     *source,
 
   /* Get the time to use for this frame */
   master_clock->cur_tick = master_clock_next_frame_time (master_clock);
+  master_clock->prev_dispatch_time = master_clock->cur_tick;
+
+  /* With a virtual refresh the frame time moves by exactly one interval
+   * per frame, however late the frame is, so timelines make the same
+   * progress on every frame */
+  if (master_clock->virtual_interval > 0 && master_clock->prev_tick)
+    master_clock->cur_tick = master_clock->prev_tick +
+                             master_clock->virtual_interval;
 
 #ifdef CLUTTER_ENABLE_DEBUG
   master_clock->remaining_budget = master_clock->frame_budget;
@@ -562,6 +748,13 @@ clutter_master_clock_default_finalize (GObject *gobject)
 
   g_slist_free (master_clock->timelines);
 
+  if (master_clock->timer_fd >= 0)
+    {
+      g_source_remove_unix_fd (master_clock->source,
+                               master_clock->timer_fd_tag);
+      close (master_clock->timer_fd);
+    }
+
   G_OBJECT_CLASS (clutter_master_clock_default_parent_class)->finalize (gobject);
 }
 
@@ -587,6 +780,9 @@ clutter_master_clock_set_sync_method (SyncMethod method)
       case SYNC_PRESENTATION_TIME:
         g_message ("Sync method: PRESENTATION TIME");
         break;
+      case SYNC_LATE_LATCHING:
+        g_message ("Sync method: LATE LATCHING");
+        break;
       case SYNC_FALLBACK:
         g_message ("Sync method: FALLBACK");
         break;
@@ -599,6 +795,9 @@ clutter_master_clock_set_sync_method (SyncMethod method)
 
   master_clock_global->preferred_sync_method = method;
 
+  /* The stages read it back to decide how late to schedule frames */
+  _clutter_set_sync_method (method);
+
   stages = stage_manager->stages;
 
   for (l = stages; l; l = l->next)
@@ -607,15 +806,52 @@ clutter_master_clock_set_sync_method (SyncMethod method)
     }
 }
 
+/**
+ * clutter_master_clock_set_max_frame_rate:
+ * @frames_per_sec: the most frames to draw per second, or 0 for no limit
+ *
+ * Caps the rate the master clock draws frames at, whatever the sync
+ * method would allow. Redraws queued in between are coalesced into
+ * the next frame.
+ */
+void
+clutter_master_clock_set_max_frame_rate (guint frames_per_sec)
+{
+  ClutterStageManager *stage_manager = clutter_stage_manager_get_default ();
+  ClutterMasterClockDefault *master_clock;
+  const GSList *l;
+
+  master_clock = (ClutterMasterClockDefault *) _clutter_master_clock_get_default ();
+
+  if (frames_per_sec > 0)
+    master_clock->min_interval = G_USEC_PER_SEC / CLAMP (frames_per_sec, 1, 1000);
+  else
+    master_clock->min_interval = 0;
+
+  for (l = stage_manager->stages; l; l = l->next)
+    _clutter_stage_clear_update_time (l->data);
+}
+
 static void
 clutter_master_clock_default_init (ClutterMasterClockDefault *self)
 {
   GSource *source = clutter_clock_source_new (self);
   SyncMethod method = _clutter_get_sync_method ();
+  const char *env_string;
 
   self->source = source;
   master_clock_global = self;
 
+  self->timer_fd = -1;
+  self->timer_fd_tag = NULL;
+  self->timer_ready_time = -1;
+
+#ifdef HAVE_SYS_TIMERFD_H
+  self->timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (self->timer_fd >= 0)
+    self->timer_fd_tag = g_source_add_unix_fd (source, self->timer_fd, G_IO_IN);
+#endif
+
   self->active_sync_method = method;
   clutter_master_clock_set_sync_method (method);
 
@@ -623,8 +859,23 @@ clutter_master_clock_default_init (ClutterMasterClockDefault *self)
   self->paused = FALSE;
   self->sync_available = clutter_feature_available (CLUTTER_FEATURE_SYNC_TO_VBLANK);
 
+  self->virtual_interval = 0;
+  self->min_interval = 0;
+  self->prev_dispatch_time = 0;
+
+  env_string = g_getenv ("CLUTTER_VIRTUAL_REFRESH");
+  if (env_string)
+    {
+      gint refresh_rate = g_ascii_strtoll (env_string, NULL, 10);
+
+      if (refresh_rate > 0)
+        self->virtual_interval = G_USEC_PER_SEC / CLAMP (refresh_rate, 1, 1000);
+    }
+
 #ifdef CLUTTER_ENABLE_DEBUG
   self->frame_budget = G_USEC_PER_SEC / 60;
+  if (self->virtual_interval > 0)
+    self->frame_budget = self->virtual_interval;
 #endif
 
   g_source_set_priority (source, CLUTTER_PRIORITY_REDRAW);
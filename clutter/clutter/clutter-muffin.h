@@ -36,7 +36,9 @@ typedef enum _SyncMethod /* In order of priority */
   SYNC_NONE = 0,         /* Always     High         Poor                   */
   SYNC_FALLBACK,         /* Always     Medium       Medium                 */
   SYNC_SWAP_THROTTLING,  /* Usually    Medium-high  Medium, sometimes best */
-  SYNC_PRESENTATION_TIME /* Usually    Low          Good, sometimes best   */
+  SYNC_PRESENTATION_TIME,/* Usually    Low          Good, sometimes best   */
+  SYNC_LATE_LATCHING     /* Usually    Lowest       Good, unless frame
+                                                    times vary widely      */
                          /* ^ As you can see SWAP_THROTTLING doesn't add much
                               value. And it does create the the very real
                               risk of blocking the main loop for up to 16ms
@@ -63,6 +65,9 @@ void            _clutter_set_sync_to_vblank     (gboolean      sync_to_vblank);
 CLUTTER_AVAILABLE_IN_MUFFIN
 void clutter_master_clock_set_sync_method (SyncMethod method);
 
+CLUTTER_AVAILABLE_IN_MUFFIN
+void clutter_master_clock_set_max_frame_rate (guint frames_per_sec);
+
 CLUTTER_AVAILABLE_IN_MUFFIN
 void clutter_stage_x11_update_sync_state (ClutterStage *stage,
                                           SyncMethod    method);
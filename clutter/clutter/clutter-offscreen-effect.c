@@ -66,7 +66,10 @@
 #include "clutter-build-config.h"
 #endif
 
+#include <math.h>
+
 #include "clutter-offscreen-effect.h"
+#include "clutter-offscreen-effect-private.h"
 
 #include "cogl/cogl.h"
 
@@ -99,6 +102,14 @@ struct _ClutterOffscreenEffectPrivate
   int fbo_height;
 
   gint old_opacity_override;
+
+  /* The part of the actor the fbo was rendered for, and what changed
+     in it since, in the actor's coordinates. As long as the same part
+     is rendered again into the same fbo, only what changed has to be. */
+  ClutterActorBox cached_box;
+  cairo_region_t *damage;
+  guint cached_valid : 1;
+  guint scissor_pushed : 1;
 };
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (ClutterOffscreenEffect,
@@ -123,6 +134,8 @@ clutter_offscreen_effect_set_actor (ClutterActorMeta *meta,
       priv->offscreen = NULL;
     }
 
+  priv->cached_valid = FALSE;
+
   /* we keep a back pointer here, to avoid going through the ActorMeta */
   priv->actor = clutter_actor_meta_get_actor (meta);
 }
@@ -186,11 +199,15 @@ update_fbo (ClutterEffect *effect, int fbo_width, int fbo_height)
       priv->offscreen = NULL;
     }
 
+  priv->cached_valid = FALSE;
+
   priv->texture =
     clutter_offscreen_effect_create_texture (self, fbo_width, fbo_height);
   if (priv->texture == NULL)
     return FALSE;
 
+  cogl_texture_set_memory_category (priv->texture, "offscreen effects");
+
   cogl_pipeline_set_layer_texture (priv->target, 0, priv->texture);
 
   priv->fbo_width = fbo_width;
@@ -213,6 +230,73 @@ update_fbo (ClutterEffect *effect, int fbo_width, int fbo_height)
   return TRUE;
 }
 
+/* Gets the part of the actor to render, relative to the actor: @raw_box
+ * is its paint box and @box the same enlarged to whole pixels */
+static void
+get_fbo_box (ClutterOffscreenEffect *self,
+             ClutterActorBox        *raw_box,
+             ClutterActorBox        *box)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+  const ClutterPaintVolume *volume;
+
+  /* Get the minimal bounding box for what we want to paint, relative to the
+   * parent of priv->actor. Note that we may actually be painting a clone of
+   * priv->actor so we need to be careful to avoid querying the transformation
+   * of priv->actor (like clutter_actor_get_paint_box would). Just stay in
+   * local coordinates for now...
+   */
+  volume = clutter_actor_get_paint_volume (priv->actor);
+  if (volume)
+    {
+      ClutterPaintVolume mutable_volume;
+
+      _clutter_paint_volume_copy_static (volume, &mutable_volume);
+      _clutter_paint_volume_get_bounding_box (&mutable_volume, raw_box);
+      clutter_paint_volume_free (&mutable_volume);
+    }
+  else
+    {
+      clutter_actor_get_allocation_box (priv->actor, raw_box);
+    }
+
+  *box = *raw_box;
+  _clutter_actor_box_enlarge_for_effects (box);
+}
+
+/* Gets the part of the fbo that is out of date, in fbo pixels, if the
+ * rest of it can be kept; returns FALSE if all of it has to be
+ * rendered again */
+static gboolean
+get_fbo_damage (ClutterOffscreenEffect *self,
+                const ClutterActorBox  *box,
+                cairo_rectangle_int_t  *rect)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+  cairo_rectangle_int_t fbo_rect;
+
+  if (!priv->cached_valid ||
+      priv->damage == NULL ||
+      priv->offscreen == NULL ||
+      !clutter_actor_box_equal (box, &priv->cached_box))
+    return FALSE;
+
+  cairo_region_get_extents (priv->damage, rect);
+
+  /* the actor is rendered at its coordinates minus the offset */
+  rect->x -= priv->fbo_offset_x;
+  rect->y -= priv->fbo_offset_y;
+
+  fbo_rect.x = 0;
+  fbo_rect.y = 0;
+  fbo_rect.width = priv->fbo_width;
+  fbo_rect.height = priv->fbo_height;
+
+  _clutter_util_rectangle_intersection (rect, &fbo_rect, rect);
+
+  return TRUE;
+}
+
 static gboolean
 clutter_offscreen_effect_pre_paint (ClutterEffect *effect)
 {
@@ -221,8 +305,9 @@ clutter_offscreen_effect_pre_paint (ClutterEffect *effect)
   ClutterActorBox raw_box, box;
   ClutterActor *stage;
   CoglMatrix projection, old_modelview, modelview;
-  const ClutterPaintVolume *volume;
   CoglColor transparent;
+  cairo_rectangle_int_t damage;
+  gboolean partial;
   gfloat stage_width, stage_height;
   gfloat fbo_width = -1, fbo_height = -1;
   ClutterVertex local_offset = { 0.f, 0.f, 0.f };
@@ -237,28 +322,7 @@ clutter_offscreen_effect_pre_paint (ClutterEffect *effect)
   stage = _clutter_actor_get_stage_internal (priv->actor);
   clutter_actor_get_size (stage, &stage_width, &stage_height);
 
-  /* Get the minimal bounding box for what we want to paint, relative to the
-   * parent of priv->actor. Note that we may actually be painting a clone of
-   * priv->actor so we need to be careful to avoid querying the transformation
-   * of priv->actor (like clutter_actor_get_paint_box would). Just stay in
-   * local coordinates for now...
-   */
-  volume = clutter_actor_get_paint_volume (priv->actor);
-  if (volume)
-    {
-      ClutterPaintVolume mutable_volume;
-
-      _clutter_paint_volume_copy_static (volume, &mutable_volume);
-      _clutter_paint_volume_get_bounding_box (&mutable_volume, &raw_box);
-      clutter_paint_volume_free (&mutable_volume);
-    }
-  else
-    {
-      clutter_actor_get_allocation_box (priv->actor, &raw_box);
-    }
-
-  box = raw_box;
-  _clutter_actor_box_enlarge_for_effects (&box);
+  get_fbo_box (self, &raw_box, &box);
 
   priv->fbo_offset_x = box.x1 - raw_box.x1;
   priv->fbo_offset_y = box.y1 - raw_box.y1;
@@ -269,6 +333,8 @@ clutter_offscreen_effect_pre_paint (ClutterEffect *effect)
   if (!update_fbo (effect, fbo_width, fbo_height))
     return FALSE;
 
+  partial = get_fbo_damage (self, &box, &damage);
+
   cogl_get_modelview_matrix (&old_modelview);
 
   /* let's draw offscreen */
@@ -315,6 +381,28 @@ clutter_offscreen_effect_pre_paint (ClutterEffect *effect)
 
   cogl_set_projection_matrix (&projection);
 
+  /* Only clear and render again what changed since the last time */
+  if (partial)
+    {
+      CLUTTER_NOTE (PAINT, "Updating %dx%d of the %dx%d offscreen buffer",
+                    damage.width, damage.height,
+                    priv->fbo_width, priv->fbo_height);
+
+      cogl_framebuffer_push_scissor_clip (priv->offscreen,
+                                          damage.x, damage.y,
+                                          damage.width, damage.height);
+      priv->scissor_pushed = TRUE;
+    }
+
+  /* Whatever changes from now on is relative to this image */
+  priv->cached_box = box;
+  priv->cached_valid = TRUE;
+  if (priv->damage != NULL)
+    {
+      cairo_region_destroy (priv->damage);
+      priv->damage = NULL;
+    }
+
   cogl_color_init_from_4ub (&transparent, 0, 0, 0, 0);
   cogl_clear (&transparent,
               COGL_BUFFER_BIT_COLOR |
@@ -400,6 +488,12 @@ clutter_offscreen_effect_post_paint (ClutterEffect *effect)
   /* Restore the previous opacity override */
   clutter_actor_set_opacity_override (priv->actor, priv->old_opacity_override);
 
+  if (priv->scissor_pushed)
+    {
+      cogl_framebuffer_pop_clip (priv->offscreen);
+      priv->scissor_pushed = FALSE;
+    }
+
   cogl_pop_matrix ();
   cogl_pop_framebuffer ();
 
@@ -419,6 +513,18 @@ clutter_offscreen_effect_paint (ClutterEffect           *effect,
   /* If we've already got a cached image and the actor hasn't been redrawn
    * then we can just use the cached image in the FBO.
    */
+  if (priv->offscreen != NULL && (flags & CLUTTER_EFFECT_PAINT_ACTOR_DIRTY))
+    {
+      ClutterActorBox raw_box, box;
+      cairo_rectangle_int_t damage;
+
+      /* ...nor if nothing that changed is going to end up in it */
+      get_fbo_box (self, &raw_box, &box);
+      if (get_fbo_damage (self, &box, &damage) &&
+          (damage.width == 0 || damage.height == 0))
+        flags &= ~CLUTTER_EFFECT_PAINT_ACTOR_DIRTY;
+    }
+
   if (priv->offscreen == NULL || (flags & CLUTTER_EFFECT_PAINT_ACTOR_DIRTY))
     {
       /* Chain up to the parent paint method which will call the pre and
@@ -445,6 +551,9 @@ clutter_offscreen_effect_finalize (GObject *gobject)
   if (priv->texture)
     cogl_handle_unref (priv->texture);
 
+  if (priv->damage)
+    cairo_region_destroy (priv->damage);
+
   G_OBJECT_CLASS (clutter_offscreen_effect_parent_class)->finalize (gobject);
 }
 
@@ -652,3 +761,40 @@ clutter_offscreen_effect_get_target_rect (ClutterOffscreenEffect *effect,
 
   return TRUE;
 }
+
+/*
+ * _clutter_offscreen_effect_queue_damage:
+ * @effect: a #ClutterOffscreenEffect
+ * @box: (allow-none): the part of the actor that is going to change,
+ *   in the actor's coordinates, or %NULL if the whole actor may
+ *
+ * Records what is going to change in the actor the next time it is
+ * rendered, so that only that part of the cached image is rendered.
+ */
+void
+_clutter_offscreen_effect_queue_damage (ClutterOffscreenEffect *effect,
+                                        const ClutterActorBox  *box)
+{
+  ClutterOffscreenEffectPrivate *priv = effect->priv;
+  cairo_rectangle_int_t rect;
+
+  if (!priv->cached_valid)
+    return;
+
+  if (box == NULL)
+    {
+      priv->cached_valid = FALSE;
+      return;
+    }
+
+  /* round outwards, with a pixel to spare for filtering */
+  rect.x = floorf (box->x1) - 1;
+  rect.y = floorf (box->y1) - 1;
+  rect.width = ceilf (box->x2) + 1 - rect.x;
+  rect.height = ceilf (box->y2) + 1 - rect.y;
+
+  if (priv->damage == NULL)
+    priv->damage = cairo_region_create_rectangle (&rect);
+  else
+    cairo_region_union_rectangle (priv->damage, &rect);
+}
@@ -147,6 +147,75 @@ clutter_page_turn_effect_deform_vertex (ClutterDeformEffect *effect,
     }
 }
 
+/* The same deformation as clutter_page_turn_effect_deform_vertex() */
+static const char page_turn_declarations[] =
+  "uniform float page_turn_period;\n"
+  "uniform float page_turn_angle;\n"
+  "uniform float page_turn_radius;\n"
+  "uniform vec2 page_turn_size;\n";
+
+static const char page_turn_post[] =
+  "if (page_turn_period != 0.0)\n"
+  "  {\n"
+  "    vec4 pos = cogl_position_in;\n"
+  "    vec2 c = (1.0 - page_turn_period) * page_turn_size;\n"
+  "    float cos_a = cos (page_turn_angle);\n"
+  "    float sin_a = sin (page_turn_angle);\n"
+  "    float rx = (pos.x - c.x) * cos_a + (pos.y - c.y) * sin_a\n"
+  "               - page_turn_radius;\n"
+  "    float ry = (c.x - pos.x) * sin_a + (pos.y - c.y) * cos_a;\n"
+  "    float turn_angle = 0.0;\n"
+  "\n"
+  "    if (rx > page_turn_radius * -2.0)\n"
+  "      {\n"
+  "        float shade;\n"
+  "\n"
+  "        turn_angle = rx / page_turn_radius * 1.5707963 - 1.5707963;\n"
+  "        shade = floor (sin (turn_angle) * 96.0 + 159.0) / 255.0;\n"
+  "        cogl_color_out = vec4 (shade, shade, shade, 1.0);\n"
+  "      }\n"
+  "\n"
+  "    if (rx > 0.0)\n"
+  "      {\n"
+  "        float small_radius = page_turn_radius\n"
+  "          - min (page_turn_radius, turn_angle * 10.0 / 3.1415927);\n"
+  "\n"
+  "        rx = small_radius * cos (turn_angle) + page_turn_radius;\n"
+  "        pos.x = rx * cos_a - ry * sin_a + c.x;\n"
+  "        pos.y = rx * sin_a + ry * cos_a + c.y;\n"
+  "        pos.z = small_radius * sin (turn_angle) + page_turn_radius;\n"
+  "      }\n"
+  "\n"
+  "    cogl_position_out = cogl_modelview_projection_matrix * pos;\n"
+  "  }\n";
+
+static void
+clutter_page_turn_effect_update_uniforms (ClutterDeformEffect *effect,
+                                          CoglPipeline        *pipeline,
+                                          gfloat               width,
+                                          gfloat               height)
+{
+  ClutterPageTurnEffect *self = CLUTTER_PAGE_TURN_EFFECT (effect);
+  float size[2] = { width, height };
+
+  cogl_pipeline_set_uniform_1f (pipeline,
+                                cogl_pipeline_get_uniform_location (pipeline,
+                                                                    "page_turn_period"),
+                                self->period);
+  cogl_pipeline_set_uniform_1f (pipeline,
+                                cogl_pipeline_get_uniform_location (pipeline,
+                                                                    "page_turn_angle"),
+                                self->angle / (180.0f / G_PI));
+  cogl_pipeline_set_uniform_1f (pipeline,
+                                cogl_pipeline_get_uniform_location (pipeline,
+                                                                    "page_turn_radius"),
+                                self->radius);
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline,
+                                                                       "page_turn_size"),
+                                   2, 1, size);
+}
+
 static void
 clutter_page_turn_effect_set_property (GObject      *gobject,
                                        guint         prop_id,
@@ -263,14 +332,25 @@ clutter_page_turn_effect_class_init (ClutterPageTurnEffectClass *klass)
   g_object_class_install_property (gobject_class, PROP_RADIUS, pspec);
 
   deform_class->deform_vertex = clutter_page_turn_effect_deform_vertex;
+  deform_class->update_uniforms = clutter_page_turn_effect_update_uniforms;
 }
 
 static void
 clutter_page_turn_effect_init (ClutterPageTurnEffect *self)
 {
+  static CoglSnippet *snippet = NULL;
+
   self->period = 0.0;
   self->angle = 0.0;
   self->radius = 24.0f;
+
+  if (G_UNLIKELY (snippet == NULL))
+    snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_VERTEX,
+                                page_turn_declarations,
+                                page_turn_post);
+
+  clutter_deform_effect_set_vertex_snippet (CLUTTER_DEFORM_EFFECT (self),
+                                            snippet);
 }
 
 /**
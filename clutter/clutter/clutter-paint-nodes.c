@@ -344,6 +344,15 @@ _clutter_dummy_node_new (ClutterActor *actor)
   return res;
 }
 
+void
+_clutter_dummy_node_set_framebuffer (ClutterPaintNode *node,
+                                     CoglFramebuffer  *framebuffer)
+{
+  ClutterDummyNode *dnode = (ClutterDummyNode *) node;
+
+  dnode->framebuffer = framebuffer;
+}
+
 /*
  * Pipeline node
  */
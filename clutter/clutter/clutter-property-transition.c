@@ -36,6 +36,7 @@
 
 #include "clutter-property-transition.h"
 
+#include "clutter-actor-private.h"
 #include "clutter-animatable.h"
 #include "clutter-debug.h"
 #include "clutter-interval.h"
@@ -47,6 +48,11 @@ struct _ClutterPropertyTransitionPrivate
   char *property_name;
 
   GParamSpec *pspec;
+
+  /* numeric properties of actors are interpolated and set directly,
+   * reusing this value every frame */
+  GValue direct_value;
+  guint can_set_direct : 1;
 };
 
 enum
@@ -94,6 +100,128 @@ clutter_property_transition_ensure_interval (ClutterPropertyTransition *transiti
     }
 }
 
+static gboolean
+clutter_property_transition_can_set_direct (ClutterPropertyTransition *transition,
+                                            ClutterAnimatable         *animatable)
+{
+  GParamSpec *pspec = transition->priv->pspec;
+  GType value_type = G_PARAM_SPEC_VALUE_TYPE (pspec);
+
+  if (!CLUTTER_IS_ACTOR (animatable) ||
+      CLUTTER_ANIMATABLE_GET_IFACE (animatable)->interpolate_value != NULL ||
+      pspec->owner_type != CLUTTER_TYPE_ACTOR)
+    return FALSE;
+
+  switch (value_type)
+    {
+    case G_TYPE_INT:
+    case G_TYPE_UINT:
+    case G_TYPE_UCHAR:
+    case G_TYPE_FLOAT:
+    case G_TYPE_DOUBLE:
+      break;
+
+    default:
+      return FALSE;
+    }
+
+  return !_clutter_has_progress_function (value_type);
+}
+
+/* Does what ClutterInterval.compute_value() and set_final_state() would
+ * do for the value types clutter_property_transition_can_set_direct()
+ * accepts, without the intermediate GValues */
+static gboolean
+clutter_property_transition_compute_direct (ClutterPropertyTransition *transition,
+                                            ClutterAnimatable         *animatable,
+                                            ClutterInterval           *interval,
+                                            gdouble                    progress)
+{
+  ClutterPropertyTransitionPrivate *priv = transition->priv;
+  const GValue *initial, *final;
+  GValue *value = &priv->direct_value;
+
+  initial = clutter_interval_peek_initial_value (interval);
+  final = clutter_interval_peek_final_value (interval);
+
+  switch (G_VALUE_TYPE (value))
+    {
+    case G_TYPE_INT:
+      {
+        gint ia = g_value_get_int (initial);
+        gint ib = g_value_get_int (final);
+
+        g_value_set_int (value, (progress * (ib - ia)) + ia);
+      }
+      break;
+
+    case G_TYPE_UINT:
+      {
+        guint ia = g_value_get_uint (initial);
+        guint ib = g_value_get_uint (final);
+
+        g_value_set_uint (value, (progress * (ib - (gdouble) ia)) + ia);
+      }
+      break;
+
+    case G_TYPE_UCHAR:
+      {
+        guchar ia = g_value_get_uchar (initial);
+        guchar ib = g_value_get_uchar (final);
+
+        g_value_set_uchar (value, (progress * (ib - (gdouble) ia)) + ia);
+      }
+      break;
+
+    case G_TYPE_FLOAT:
+      {
+        gdouble ia = g_value_get_float (initial);
+        gdouble ib = g_value_get_float (final);
+
+        g_value_set_float (value, (progress * (ib - ia)) + ia);
+      }
+      break;
+
+    case G_TYPE_DOUBLE:
+      {
+        gdouble ia = g_value_get_double (initial);
+        gdouble ib = g_value_get_double (final);
+
+        g_value_set_double (value, (progress * (ib - ia)) + ia);
+      }
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  if (_clutter_actor_set_animatable_value (CLUTTER_ACTOR (animatable),
+                                           priv->pspec,
+                                           value))
+    return TRUE;
+
+  /* the actor overrides how its properties are set */
+  priv->can_set_direct = FALSE;
+
+  return FALSE;
+}
+
+static void
+clutter_property_transition_update_direct (ClutterPropertyTransition *transition,
+                                           ClutterAnimatable         *animatable)
+{
+  ClutterPropertyTransitionPrivate *priv = transition->priv;
+
+  if (G_IS_VALUE (&priv->direct_value))
+    g_value_unset (&priv->direct_value);
+
+  priv->can_set_direct = priv->pspec != NULL &&
+    clutter_property_transition_can_set_direct (transition, animatable);
+
+  if (priv->can_set_direct)
+    g_value_init (&priv->direct_value, G_PARAM_SPEC_VALUE_TYPE (priv->pspec));
+}
+
 static void
 clutter_property_transition_attached (ClutterTransition *transition,
                                       ClutterAnimatable *animatable)
@@ -108,6 +236,8 @@ clutter_property_transition_attached (ClutterTransition *transition,
   priv->pspec =
     clutter_animatable_find_property (animatable, priv->property_name);
 
+  clutter_property_transition_update_direct (self, animatable);
+
   if (priv->pspec == NULL)
     return;
 
@@ -126,6 +256,10 @@ clutter_property_transition_detached (ClutterTransition *transition,
   ClutterPropertyTransitionPrivate *priv = self->priv;
 
   priv->pspec = NULL;
+  priv->can_set_direct = FALSE;
+
+  if (G_IS_VALUE (&priv->direct_value))
+    g_value_unset (&priv->direct_value);
 }
 
 static void
@@ -146,6 +280,14 @@ clutter_property_transition_compute_value (ClutterTransition *transition,
 
   clutter_property_transition_ensure_interval (self, animatable, interval);
 
+  if (priv->can_set_direct &&
+      G_OBJECT_TYPE (interval) == CLUTTER_TYPE_INTERVAL &&
+      clutter_interval_get_value_type (interval) ==
+      G_VALUE_TYPE (&priv->direct_value) &&
+      clutter_property_transition_compute_direct (self, animatable,
+                                                  interval, progress))
+    return;
+
   p_type = G_PARAM_SPEC_VALUE_TYPE (priv->pspec);
   i_type = clutter_interval_get_value_type (interval);
 
@@ -240,6 +382,9 @@ clutter_property_transition_finalize (GObject *gobject)
 
   free (priv->property_name);
 
+  if (G_IS_VALUE (&priv->direct_value))
+    g_value_unset (&priv->direct_value);
+
   G_OBJECT_CLASS (clutter_property_transition_parent_class)->finalize (gobject);
 }
 
@@ -332,6 +477,7 @@ clutter_property_transition_set_property_name (ClutterPropertyTransition *transi
     {
       priv->pspec = clutter_animatable_find_property (animatable,
                                                       priv->property_name);
+      clutter_property_transition_update_direct (transition, animatable);
     }
 
   g_object_notify_by_pspec (G_OBJECT (transition),
@@ -1198,6 +1198,88 @@ clutter_script_parser_parse_end (JsonParser *parser)
   clutter_script_ensure_objects (CLUTTER_SCRIPT_PARSER (parser)->script);
 }
 
+/* Copies @node, running the handler for each object once its members
+ * are copied: the same order json-glib emits JsonParser::object-end in.
+ * The handler modifies the objects it is given, so it has to work on
+ * a copy to leave @node intact.
+ */
+static JsonNode *
+replay_node (ClutterScriptParser *parser,
+             JsonNode            *node)
+{
+  JsonNode *copy;
+
+  switch (JSON_NODE_TYPE (node))
+    {
+    case JSON_NODE_OBJECT:
+      {
+        JsonObject *object = json_node_get_object (node);
+        JsonObject *object_copy = json_object_new ();
+        GList *members, *l;
+
+        members = json_object_get_members (object);
+        for (l = members; l != NULL; l = l->next)
+          {
+            JsonNode *member = json_object_get_member (object, l->data);
+
+            json_object_set_member (object_copy, l->data,
+                                    replay_node (parser, member));
+          }
+        g_list_free (members);
+
+        clutter_script_parser_object_end (JSON_PARSER (parser), object_copy);
+
+        copy = json_node_new (JSON_NODE_OBJECT);
+        json_node_take_object (copy, object_copy);
+      }
+      break;
+
+    case JSON_NODE_ARRAY:
+      {
+        JsonArray *array = json_node_get_array (node);
+        JsonArray *array_copy;
+        guint i, len;
+
+        len = json_array_get_length (array);
+        array_copy = json_array_sized_new (len);
+
+        for (i = 0; i < len; i++)
+          json_array_add_element (array_copy,
+                                  replay_node (parser,
+                                               json_array_get_element (array, i)));
+
+        copy = json_node_new (JSON_NODE_ARRAY);
+        json_node_take_array (copy, array_copy);
+      }
+      break;
+
+    default:
+      copy = json_node_copy (node);
+      break;
+    }
+
+  return copy;
+}
+
+/*
+ * _clutter_script_parser_load_from_node:
+ * @parser: a #ClutterScriptParser
+ * @root: (nullable): the root of the definitions
+ *
+ * Loads the definitions in @root, as parsed by a plain #JsonParser,
+ * just like loading them from their source would. @root is not
+ * modified, so it can be loaded again.
+ */
+void
+_clutter_script_parser_load_from_node (ClutterScriptParser *parser,
+                                       JsonNode            *root)
+{
+  if (root != NULL)
+    json_node_free (replay_node (parser, root));
+
+  clutter_script_parser_parse_end (JSON_PARSER (parser));
+}
+
 gboolean
 _clutter_script_parse_translatable_string (ClutterScript *script,
                                            JsonNode      *node,
@@ -101,6 +101,9 @@ void property_info_free (gpointer data);
 
 GType _clutter_script_parser_get_type (void) G_GNUC_CONST;
 
+void _clutter_script_parser_load_from_node (ClutterScriptParser *parser,
+                                            JsonNode            *root);
+
 gboolean _clutter_script_parse_node        (ClutterScript *script,
                                             GValue        *value,
                                             const gchar   *name,
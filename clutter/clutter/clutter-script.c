@@ -230,6 +230,7 @@
 #include <errno.h>
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <glib-object.h>
 #include <gmodule.h>
 
@@ -548,6 +549,88 @@ clutter_script_new (void)
   return g_object_new (CLUTTER_TYPE_SCRIPT, NULL);
 }
 
+/* The parsed definitions of every file loaded so far, so that loading
+ * a file again only has to build its objects. An entry is used as long
+ * as the file keeps the same size and modification time. The GTypes
+ * and GParamSpecs the definitions resolve to only exist for the life
+ * of the process, so there's no point in keeping any of this on disk.
+ */
+typedef struct {
+  JsonNode *root;
+  goffset size;
+  gint64 mtime;
+} ScriptDefinitions;
+
+static GHashTable *script_definitions = NULL;
+
+static void
+script_definitions_free (gpointer data)
+{
+  ScriptDefinitions *definitions = data;
+
+  if (definitions->root != NULL)
+    json_node_free (definitions->root);
+
+  g_slice_free (ScriptDefinitions, definitions);
+}
+
+static ScriptDefinitions *
+get_script_definitions (const gchar  *filename,
+                        GError      **error)
+{
+  ScriptDefinitions *definitions;
+  JsonParser *parser;
+  GStatBuf buf;
+
+  if (G_UNLIKELY (script_definitions == NULL))
+    script_definitions = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                free,
+                                                script_definitions_free);
+
+  /* Let the parser report files we can't read */
+  if (g_stat (filename, &buf) != 0)
+    {
+      g_hash_table_remove (script_definitions, filename);
+      buf.st_size = -1;
+      buf.st_mtime = 0;
+    }
+  else
+    {
+      definitions = g_hash_table_lookup (script_definitions, filename);
+
+      if (definitions != NULL &&
+          definitions->size == buf.st_size &&
+          definitions->mtime == buf.st_mtime)
+        {
+          CLUTTER_NOTE (SCRIPT, "Reusing the definitions of '%s'", filename);
+          return definitions;
+        }
+    }
+
+  /* A plain parser leaves the tree alone, unlike the script parser */
+  parser = json_parser_new ();
+
+  if (!json_parser_load_from_file (parser, filename, error))
+    {
+      g_object_unref (parser);
+      return NULL;
+    }
+
+  definitions = g_slice_new (ScriptDefinitions);
+  definitions->root = json_parser_get_root (parser) != NULL
+                    ? json_node_copy (json_parser_get_root (parser))
+                    : NULL;
+  definitions->size = buf.st_size;
+  definitions->mtime = buf.st_mtime;
+
+  g_object_unref (parser);
+
+  /* A size of -1 never matches, so the file is parsed again next time */
+  g_hash_table_replace (script_definitions, g_strdup (filename), definitions);
+
+  return definitions;
+}
+
 /**
  * clutter_script_load_from_file:
  * @script: a #ClutterScript
@@ -569,6 +652,7 @@ clutter_script_load_from_file (ClutterScript  *script,
                                GError        **error)
 {
   ClutterScriptPrivate *priv;
+  ScriptDefinitions *definitions;
   GError *internal_error;
 
   g_return_val_if_fail (CLUTTER_IS_SCRIPT (script), 0);
@@ -582,9 +666,7 @@ clutter_script_load_from_file (ClutterScript  *script,
   priv->last_merge_id += 1;
 
   internal_error = NULL;
-  json_parser_load_from_file (JSON_PARSER (priv->parser),
-                              filename,
-                              &internal_error);
+  definitions = get_script_definitions (filename, &internal_error);
   if (internal_error)
     {
       g_propagate_error (error, internal_error);
@@ -592,6 +674,8 @@ clutter_script_load_from_file (ClutterScript  *script,
       return 0;
     }
 
+  _clutter_script_parser_load_from_node (priv->parser, definitions->root);
+
   return priv->last_merge_id;
 }
 
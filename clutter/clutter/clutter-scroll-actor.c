@@ -36,6 +36,11 @@
  * #ClutterScrollActor does not provide pointer or keyboard event handling,
  * nor does it provide visible scroll handles.
  *
+ * A #ClutterScrollActor with many children, most of them outside the
+ * visible area, can be made to skip those when painting and picking by
+ * setting #ClutterScrollActor:virtualized; see
+ * clutter_scroll_actor_set_virtualized().
+ *
  * See [scroll-actor.c](https://git.gnome.org/browse/clutter/tree/examples/scroll-actor.c?h=clutter-1.18)
  * for an example of how to use #ClutterScrollActor.
  *
@@ -56,6 +61,22 @@
 #include "clutter-property-transition.h"
 #include "clutter-transition.h"
 
+/* The extent of a child along the scrolling direction, for finding
+ * the children in the visible area with a binary search */
+typedef struct
+{
+  ClutterActor *child;
+
+  /* Position among the children, to paint them in the right order */
+  guint index;
+
+  ClutterActorBox box;
+
+  /* The largest end along the scrolling direction of this child and
+   * all the ones sorted before it */
+  float max_end;
+} VirtualChild;
+
 struct _ClutterScrollActorPrivate
 {
   ClutterPoint scroll_to;
@@ -63,6 +84,17 @@ struct _ClutterScrollActorPrivate
   ClutterScrollMode scroll_mode;
 
   ClutterTransition *transition;
+
+  /* Children that paint within their allocation, sorted by where they
+   * start along the scrolling direction */
+  GArray *virtual_children;
+  /* Children that can paint anywhere, so are always painted */
+  GArray *unbounded_children;
+  /* Scratch space for the children found to be visible */
+  GArray *visible_children;
+
+  guint virtualized : 1;
+  guint virtual_children_valid : 1;
 };
 
 enum
@@ -70,6 +102,7 @@ enum
   PROP_0,
 
   PROP_SCROLL_MODE,
+  PROP_VIRTUALIZED,
 
   PROP_LAST
 };
@@ -126,6 +159,258 @@ clutter_scroll_actor_set_scroll_to_internal (ClutterScrollActor *self,
   clutter_actor_set_child_transform (actor, &m);
 }
 
+static gboolean
+scrolls_vertically (ClutterScrollActor *self)
+{
+  return (self->priv->scroll_mode & CLUTTER_SCROLL_VERTICALLY) != 0;
+}
+
+static int
+compare_virtual_children (gconstpointer a,
+                          gconstpointer b,
+                          gpointer      user_data)
+{
+  const VirtualChild *child_a = a;
+  const VirtualChild *child_b = b;
+  gboolean vertical = GPOINTER_TO_INT (user_data);
+  float start_a = vertical ? child_a->box.y1 : child_a->box.x1;
+  float start_b = vertical ? child_b->box.y1 : child_b->box.x1;
+
+  if (start_a < start_b)
+    return -1;
+  if (start_a > start_b)
+    return 1;
+
+  return (int) child_a->index - (int) child_b->index;
+}
+
+static int
+compare_child_index (gconstpointer a,
+                     gconstpointer b)
+{
+  const VirtualChild *child_a = a;
+  const VirtualChild *child_b = b;
+
+  return (int) child_a->index - (int) child_b->index;
+}
+
+/* Children that are transformed or have effects may paint outside
+ * of their allocation */
+static gboolean
+child_paints_within_allocation (ClutterActor *child)
+{
+  float translate_x, translate_y, translate_z;
+
+  if (clutter_actor_is_rotated (child) ||
+      clutter_actor_is_scaled (child) ||
+      clutter_actor_has_effects (child))
+    return FALSE;
+
+  clutter_actor_get_translation (child,
+                                 &translate_x, &translate_y, &translate_z);
+
+  return translate_x == 0.f && translate_y == 0.f && translate_z == 0.f;
+}
+
+static void
+clutter_scroll_actor_update_virtual_children (ClutterScrollActor *self)
+{
+  ClutterScrollActorPrivate *priv = self->priv;
+  gboolean vertical = scrolls_vertically (self);
+  ClutterActorIter iter;
+  ClutterActor *child;
+  guint index = 0;
+  float max_end;
+  guint i;
+
+  g_array_set_size (priv->virtual_children, 0);
+  g_array_set_size (priv->unbounded_children, 0);
+
+  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (self));
+  while (clutter_actor_iter_next (&iter, &child))
+    {
+      VirtualChild virtual_child;
+
+      virtual_child.child = child;
+      virtual_child.index = index++;
+      clutter_actor_get_allocation_box (child, &virtual_child.box);
+
+      if (child_paints_within_allocation (child))
+        g_array_append_val (priv->virtual_children, virtual_child);
+      else
+        g_array_append_val (priv->unbounded_children, virtual_child);
+    }
+
+  g_array_sort_with_data (priv->virtual_children,
+                          compare_virtual_children,
+                          GINT_TO_POINTER (vertical));
+
+  max_end = -G_MAXFLOAT;
+  for (i = 0; i < priv->virtual_children->len; i++)
+    {
+      VirtualChild *virtual_child =
+        &g_array_index (priv->virtual_children, VirtualChild, i);
+      float end = vertical ? virtual_child->box.y2 : virtual_child->box.x2;
+
+      max_end = MAX (max_end, end);
+      virtual_child->max_end = max_end;
+    }
+
+  priv->virtual_children_valid = TRUE;
+}
+
+/* Collects the children intersecting the visible area into
+ * priv->visible_children, in painting order. Returns %FALSE if the
+ * children have to be painted the usual way. */
+static gboolean
+clutter_scroll_actor_collect_visible_children (ClutterScrollActor *self)
+{
+  ClutterScrollActorPrivate *priv = self->priv;
+  gboolean vertical = scrolls_vertically (self);
+  ClutterActorBox viewport;
+  float width, height;
+  float start, end;
+  guint lo, hi, i;
+
+  if (!priv->virtualized || !priv->virtual_children_valid)
+    return FALSE;
+
+  clutter_actor_get_size (CLUTTER_ACTOR (self), &width, &height);
+
+  viewport.x1 = (priv->scroll_mode & CLUTTER_SCROLL_HORIZONTALLY) ? priv->scroll_to.x : 0.f;
+  viewport.y1 = (priv->scroll_mode & CLUTTER_SCROLL_VERTICALLY) ? priv->scroll_to.y : 0.f;
+  viewport.x2 = viewport.x1 + width;
+  viewport.y2 = viewport.y1 + height;
+
+  start = vertical ? viewport.y1 : viewport.x1;
+  end = vertical ? viewport.y2 : viewport.x2;
+
+  g_array_set_size (priv->visible_children, 0);
+
+  /* Find the first child that ends after the start of the viewport;
+   * max_end grows monotonically, so this is a binary search */
+  lo = 0;
+  hi = priv->virtual_children->len;
+  while (lo < hi)
+    {
+      guint mid = lo + (hi - lo) / 2;
+
+      if (g_array_index (priv->virtual_children, VirtualChild, mid).max_end <= start)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  for (i = lo; i < priv->virtual_children->len; i++)
+    {
+      VirtualChild *virtual_child =
+        &g_array_index (priv->virtual_children, VirtualChild, i);
+      const ClutterActorBox *box = &virtual_child->box;
+
+      /* Sorted by their start, so nothing further on is visible */
+      if ((vertical ? box->y1 : box->x1) >= end)
+        break;
+
+      if (box->x2 > viewport.x1 && box->x1 < viewport.x2 &&
+          box->y2 > viewport.y1 && box->y1 < viewport.y2)
+        g_array_append_val (priv->visible_children, *virtual_child);
+    }
+
+  if (priv->unbounded_children->len > 0)
+    g_array_append_vals (priv->visible_children,
+                         priv->unbounded_children->data,
+                         priv->unbounded_children->len);
+
+  g_array_sort (priv->visible_children, compare_child_index);
+
+  return TRUE;
+}
+
+static void
+clutter_scroll_actor_paint_visible_children (ClutterScrollActor *self)
+{
+  ClutterScrollActorPrivate *priv = self->priv;
+  guint i;
+
+  for (i = 0; i < priv->visible_children->len; i++)
+    clutter_actor_paint (g_array_index (priv->visible_children,
+                                        VirtualChild, i).child);
+}
+
+static void
+clutter_scroll_actor_allocate (ClutterActor           *actor,
+                               const ClutterActorBox  *box,
+                               ClutterAllocationFlags  flags)
+{
+  ClutterScrollActor *self = CLUTTER_SCROLL_ACTOR (actor);
+
+  CLUTTER_ACTOR_CLASS (clutter_scroll_actor_parent_class)->allocate (actor, box, flags);
+
+  /* Positions only change when allocating, so this is where the
+   * children are sorted for lookups during paint and pick */
+  if (self->priv->virtualized)
+    clutter_scroll_actor_update_virtual_children (self);
+}
+
+static void
+clutter_scroll_actor_paint (ClutterActor *actor)
+{
+  ClutterScrollActor *self = CLUTTER_SCROLL_ACTOR (actor);
+
+  if (!clutter_scroll_actor_collect_visible_children (self))
+    {
+      CLUTTER_ACTOR_CLASS (clutter_scroll_actor_parent_class)->paint (actor);
+      return;
+    }
+
+  clutter_scroll_actor_paint_visible_children (self);
+}
+
+static void
+clutter_scroll_actor_pick (ClutterActor       *actor,
+                           const ClutterColor *color)
+{
+  ClutterScrollActor *self = CLUTTER_SCROLL_ACTOR (actor);
+
+  /* Picks the actor itself; the default implementation only picks the
+   * children for classes that don't override it */
+  CLUTTER_ACTOR_CLASS (clutter_scroll_actor_parent_class)->pick (actor, color);
+
+  if (!clutter_scroll_actor_collect_visible_children (self))
+    {
+      ClutterActorIter iter;
+      ClutterActor *child;
+
+      clutter_actor_iter_init (&iter, actor);
+      while (clutter_actor_iter_next (&iter, &child))
+        clutter_actor_paint (child);
+
+      return;
+    }
+
+  clutter_scroll_actor_paint_visible_children (self);
+}
+
+/* Children added, removed or restacked since the last allocation
+ * can't be looked up until the next one */
+static void
+clutter_scroll_actor_children_changed (ClutterScrollActor *self)
+{
+  self->priv->virtual_children_valid = FALSE;
+}
+
+static void
+clutter_scroll_actor_finalize (GObject *gobject)
+{
+  ClutterScrollActorPrivate *priv = CLUTTER_SCROLL_ACTOR (gobject)->priv;
+
+  g_array_unref (priv->virtual_children);
+  g_array_unref (priv->unbounded_children);
+  g_array_unref (priv->visible_children);
+
+  G_OBJECT_CLASS (clutter_scroll_actor_parent_class)->finalize (gobject);
+}
+
 static void
 clutter_scroll_actor_set_property (GObject      *gobject,
                                    guint         prop_id,
@@ -140,6 +425,10 @@ clutter_scroll_actor_set_property (GObject      *gobject,
       clutter_scroll_actor_set_scroll_mode (actor, g_value_get_flags (value));
       break;
 
+    case PROP_VIRTUALIZED:
+      clutter_scroll_actor_set_virtualized (actor, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
     }
@@ -159,6 +448,10 @@ clutter_scroll_actor_get_property (GObject    *gobject,
       g_value_set_flags (value, actor->priv->scroll_mode);
       break;
 
+    case PROP_VIRTUALIZED:
+      g_value_set_boolean (value, actor->priv->virtualized);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
     }
@@ -168,9 +461,15 @@ static void
 clutter_scroll_actor_class_init (ClutterScrollActorClass *klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
 
   gobject_class->set_property = clutter_scroll_actor_set_property;
   gobject_class->get_property = clutter_scroll_actor_get_property;
+  gobject_class->finalize = clutter_scroll_actor_finalize;
+
+  actor_class->allocate = clutter_scroll_actor_allocate;
+  actor_class->paint = clutter_scroll_actor_paint;
+  actor_class->pick = clutter_scroll_actor_pick;
 
   /**
    * ClutterScrollActor:scroll-mode:
@@ -188,6 +487,20 @@ clutter_scroll_actor_class_init (ClutterScrollActorClass *klass)
                         G_PARAM_READWRITE |
                         G_PARAM_STATIC_STRINGS);
 
+  /**
+   * ClutterScrollActor:virtualized:
+   *
+   * Whether only the children intersecting the visible area are
+   * painted and picked.
+   */
+  obj_props[PROP_VIRTUALIZED] =
+    g_param_spec_boolean ("virtualized",
+                          P_("Virtualized"),
+                          P_("Whether to skip children outside the visible area"),
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, obj_props);
 }
 
@@ -197,7 +510,16 @@ clutter_scroll_actor_init (ClutterScrollActor *self)
   self->priv = clutter_scroll_actor_get_instance_private (self);
   self->priv->scroll_mode = CLUTTER_SCROLL_BOTH;
 
+  self->priv->virtual_children = g_array_new (FALSE, FALSE, sizeof (VirtualChild));
+  self->priv->unbounded_children = g_array_new (FALSE, FALSE, sizeof (VirtualChild));
+  self->priv->visible_children = g_array_new (FALSE, FALSE, sizeof (VirtualChild));
+
   clutter_actor_set_clip_to_allocation (CLUTTER_ACTOR (self), TRUE);
+
+  g_signal_connect (self, "actor-added",
+                    G_CALLBACK (clutter_scroll_actor_children_changed), NULL);
+  g_signal_connect (self, "actor-removed",
+                    G_CALLBACK (clutter_scroll_actor_children_changed), NULL);
 }
 
 static GParamSpec *
@@ -300,6 +622,11 @@ clutter_scroll_actor_set_scroll_mode (ClutterScrollActor *actor,
 
   priv->scroll_mode = mode;
 
+  /* The children are sorted along the scrolling direction */
+  priv->virtual_children_valid = FALSE;
+  if (priv->virtualized)
+    clutter_actor_queue_relayout (CLUTTER_ACTOR (actor));
+
   g_object_notify_by_pspec (G_OBJECT (actor), obj_props[PROP_SCROLL_MODE]);
 }
 
@@ -434,3 +761,61 @@ clutter_scroll_actor_scroll_to_rect (ClutterScrollActor *actor,
 
   clutter_scroll_actor_scroll_to_point (actor, &n_rect.origin);
 }
+
+/**
+ * clutter_scroll_actor_set_virtualized:
+ * @actor: a #ClutterScrollActor
+ * @virtualized: whether to skip children outside the visible area
+ *
+ * Sets whether @actor only paints and picks the children that intersect
+ * its visible area. The children are looked up by their allocation, so
+ * this is only correct if they don't paint outside of it. Children that
+ * are transformed or have effects when @actor is allocated are always
+ * painted.
+ *
+ * This is meant for long lists: the children are sorted along the
+ * scrolling direction on each allocation, and the visible ones are then
+ * found without going through the others.
+ */
+void
+clutter_scroll_actor_set_virtualized (ClutterScrollActor *actor,
+                                      gboolean            virtualized)
+{
+  ClutterScrollActorPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_SCROLL_ACTOR (actor));
+
+  priv = actor->priv;
+
+  virtualized = !!virtualized;
+
+  if (priv->virtualized == virtualized)
+    return;
+
+  priv->virtualized = virtualized;
+  priv->virtual_children_valid = FALSE;
+
+  /* The children are sorted on the next allocation */
+  if (virtualized)
+    clutter_actor_queue_relayout (CLUTTER_ACTOR (actor));
+  else
+    clutter_actor_queue_redraw (CLUTTER_ACTOR (actor));
+
+  g_object_notify_by_pspec (G_OBJECT (actor), obj_props[PROP_VIRTUALIZED]);
+}
+
+/**
+ * clutter_scroll_actor_get_virtualized:
+ * @actor: a #ClutterScrollActor
+ *
+ * Retrieves the #ClutterScrollActor:virtualized property.
+ *
+ * Return value: %TRUE if children outside the visible area are skipped
+ */
+gboolean
+clutter_scroll_actor_get_virtualized (ClutterScrollActor *actor)
+{
+  g_return_val_if_fail (CLUTTER_IS_SCROLL_ACTOR (actor), FALSE);
+
+  return actor->priv->virtualized;
+}
@@ -92,6 +92,12 @@ CLUTTER_AVAILABLE_IN_1_12
 void                    clutter_scroll_actor_scroll_to_rect     (ClutterScrollActor *actor,
                                                                  const ClutterRect  *rect);
 
+CLUTTER_AVAILABLE_IN_MUFFIN
+void                    clutter_scroll_actor_set_virtualized    (ClutterScrollActor *actor,
+                                                                 gboolean            virtualized);
+CLUTTER_AVAILABLE_IN_MUFFIN
+gboolean                clutter_scroll_actor_get_virtualized    (ClutterScrollActor *actor);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_SCROLL_ACTOR_H__ */
@@ -6,11 +6,23 @@
 
 G_BEGIN_DECLS
 
+/* What changed in the values of the settings, for the handlers of
+ * ClutterBackend::settings-changed to know what they need to update */
+typedef enum
+{
+  CLUTTER_SETTINGS_CHANGED_FONT_NAME    = 1 << 0,
+  /* The options glyphs are rendered with, or the fontconfig setup */
+  CLUTTER_SETTINGS_CHANGED_FONT_OPTIONS = 1 << 1,
+  CLUTTER_SETTINGS_CHANGED_RESOLUTION   = 1 << 2
+} ClutterSettingsChanges;
+
 void    _clutter_settings_set_backend           (ClutterSettings *settings,
                                                  ClutterBackend  *backend);
 void    _clutter_settings_read_from_key_file    (ClutterSettings *settings,
                                                  GKeyFile        *key_file);
 
+ClutterSettingsChanges _clutter_settings_get_changes (ClutterSettings *settings);
+
 void    clutter_settings_set_property_internal (ClutterSettings *settings,
                                                 const char *property,
                                                 GValue *value);
@@ -78,6 +78,9 @@ struct _ClutterSettings
   guint password_hint_time;
 
   gint unscaled_font_dpi;
+
+  /* The changes behind the ::settings-changed being emitted */
+  ClutterSettingsChanges changes;
 };
 
 struct _ClutterSettingsClass
@@ -264,7 +267,10 @@ settings_update_fontmap (ClutterSettings *self,
       self->last_fontconfig_timestamp = stamp;
 
       if (update_needed)
-        g_signal_emit_by_name (self->backend, "font-changed");
+        {
+          self->changes |= CLUTTER_SETTINGS_CHANGED_FONT_OPTIONS;
+          g_signal_emit_by_name (self->backend, "font-changed");
+        }
     }
 #endif /* HAVE_PANGO_FT2 */
 }
@@ -307,36 +313,56 @@ clutter_settings_set_property (GObject      *gobject,
       self->dnd_drag_threshold = g_value_get_int (value);
       break;
 
+    /* Setting a font setting to the value it has doesn't update
+     * anything, since every text would be laid out again */
     case PROP_FONT_NAME:
+      if (g_strcmp0 (self->font_name, g_value_get_string (value)) == 0)
+        break;
       free (self->font_name);
       self->font_name = g_value_dup_string (value);
+      self->changes |= CLUTTER_SETTINGS_CHANGED_FONT_NAME;
       settings_update_font_name (self);
       break;
 
     case PROP_FONT_ANTIALIAS:
+      if (self->xft_antialias == g_value_get_int (value))
+        break;
       self->xft_antialias = g_value_get_int (value);
+      self->changes |= CLUTTER_SETTINGS_CHANGED_FONT_OPTIONS;
       settings_update_font_options (self);
       break;
 
     case PROP_FONT_DPI:
+      if (self->font_dpi == g_value_get_int (value))
+        break;
       self->font_dpi = g_value_get_int (value);
+      self->changes |= CLUTTER_SETTINGS_CHANGED_RESOLUTION;
       settings_update_resolution (self);
       break;
 
     case PROP_FONT_HINTING:
+      if (self->xft_hinting == g_value_get_int (value))
+        break;
       self->xft_hinting = g_value_get_int (value);
+      self->changes |= CLUTTER_SETTINGS_CHANGED_FONT_OPTIONS;
       settings_update_font_options (self);
       break;
 
     case PROP_FONT_HINT_STYLE:
+      if (g_strcmp0 (self->xft_hint_style, g_value_get_string (value)) == 0)
+        break;
       free (self->xft_hint_style);
       self->xft_hint_style = g_value_dup_string (value);
+      self->changes |= CLUTTER_SETTINGS_CHANGED_FONT_OPTIONS;
       settings_update_font_options (self);
       break;
 
     case PROP_FONT_RGBA:
+      if (g_strcmp0 (self->xft_rgba, g_value_get_string (value)) == 0)
+        break;
       free (self->xft_rgba);
       self->xft_rgba = g_value_dup_string (value);
+      self->changes |= CLUTTER_SETTINGS_CHANGED_FONT_OPTIONS;
       settings_update_font_options (self);
       break;
 
@@ -353,7 +379,10 @@ clutter_settings_set_property (GObject      *gobject,
       break;
 
     case PROP_UNSCALED_FONT_DPI:
+      if (self->font_dpi == g_value_get_int (value))
+        break;
       self->font_dpi = g_value_get_int (value);
+      self->changes |= CLUTTER_SETTINGS_CHANGED_RESOLUTION;
       settings_update_resolution (self);
       break;
 
@@ -449,6 +478,24 @@ clutter_settings_dispatch_properties_changed (GObject     *gobject,
   /* emit settings-changed just once for multiple properties */
   if (self->backend != NULL)
     g_signal_emit_by_name (self->backend, "settings-changed");
+
+  self->changes = 0;
+}
+
+/*
+ * _clutter_settings_get_changes:
+ * @settings: a #ClutterSettings
+ *
+ * Retrieves what changed in the values of @settings, for the handlers
+ * of #ClutterBackend::settings-changed. Outside of the emission there
+ * are no changes.
+ *
+ * Return value: the #ClutterSettingsChanges
+ */
+ClutterSettingsChanges
+_clutter_settings_get_changes (ClutterSettings *settings)
+{
+  return settings->changes;
 }
 
 static void
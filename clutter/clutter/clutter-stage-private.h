@@ -39,6 +39,15 @@ ClutterStageWindow *_clutter_stage_get_default_window    (void);
 void                _clutter_stage_paint_view            (ClutterStage                *stage,
                                                           ClutterStageView            *view,
                                                           const cairo_rectangle_int_t *clip);
+void                _clutter_stage_emit_after_paint      (ClutterStage                *stage);
+
+gboolean            _clutter_stage_is_logging_picks      (ClutterStage                *stage);
+void                _clutter_stage_log_pick              (ClutterStage                *stage,
+                                                          const ClutterActorBox       *box,
+                                                          ClutterActor                *actor);
+void                _clutter_stage_push_pick_clip        (ClutterStage                *stage,
+                                                          const ClutterActorBox       *box);
+void                _clutter_stage_pop_pick_clip         (ClutterStage                *stage);
 
 void                _clutter_stage_set_window            (ClutterStage          *stage,
                                                           ClutterStageWindow    *stage_window);
@@ -60,6 +69,8 @@ void                _clutter_stage_dirty_viewport        (ClutterStage
 void                _clutter_stage_maybe_setup_viewport  (ClutterStage          *stage,
                                                           ClutterStageView      *view);
 void                _clutter_stage_maybe_relayout        (ClutterActor          *stage);
+void                _clutter_stage_queue_actor_relayout  (ClutterStage          *stage,
+                                                          ClutterActor          *actor);
 gboolean            _clutter_stage_needs_update          (ClutterStage          *stage);
 gboolean            _clutter_stage_do_update             (ClutterStage          *stage);
 
@@ -72,12 +83,14 @@ void     _clutter_stage_update_input_devices              (ClutterStage *stage);
 void     _clutter_stage_schedule_update                   (ClutterStage *stage);
 gint64    _clutter_stage_get_update_time                  (ClutterStage *stage);
 void     _clutter_stage_clear_update_time                 (ClutterStage *stage);
+float    _clutter_stage_get_refresh_rate                  (ClutterStage *stage);
 gboolean _clutter_stage_has_full_redraw_queued            (ClutterStage *stage);
 
 ClutterActor *_clutter_stage_do_pick (ClutterStage    *stage,
                                       gint             x,
                                       gint             y,
                                       ClutterPickMode  mode);
+void          _clutter_stage_invalidate_pick (ClutterStage    *stage);
 
 ClutterPaintVolume *_clutter_stage_paint_volume_stack_allocate (ClutterStage *stage);
 void                _clutter_stage_paint_volume_stack_free_all (ClutterStage *stage);
@@ -92,10 +105,11 @@ void                          _clutter_stage_queue_redraw_entry_invalidate (Clut
 
 CoglFramebuffer *_clutter_stage_get_active_framebuffer (ClutterStage *stage);
 
+guint           _clutter_stage_get_pick_pass            (ClutterStage *stage);
+
+const CoglMatrix *_clutter_stage_get_color_transform    (ClutterStage *stage);
 gint32          _clutter_stage_acquire_pick_id          (ClutterStage *stage,
                                                          ClutterActor *actor);
-void            _clutter_stage_release_pick_id          (ClutterStage *stage,
-                                                         gint32        pick_id);
 ClutterActor *  _clutter_stage_get_actor_by_pick_id     (ClutterStage *stage,
                                                          gint32        pick_id);
 
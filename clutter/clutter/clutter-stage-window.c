@@ -330,3 +330,14 @@ _clutter_stage_window_get_frame_counter (ClutterStageWindow *window)
   else
     return 0;
 }
+
+float
+_clutter_stage_window_get_refresh_rate (ClutterStageWindow *window)
+{
+  ClutterStageWindowIface *iface = CLUTTER_STAGE_WINDOW_GET_IFACE (window);
+
+  if (iface->get_refresh_rate)
+    return iface->get_refresh_rate (window);
+  else
+    return 0.0;
+}
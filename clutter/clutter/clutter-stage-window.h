@@ -86,6 +86,7 @@ struct _ClutterStageWindowIface
   GList            *(* get_views)               (ClutterStageWindow *stage_window);
   int64_t           (* get_frame_counter)       (ClutterStageWindow *stage_window);
   void              (* finish_frame)            (ClutterStageWindow *stage_window);
+  float             (* get_refresh_rate)        (ClutterStageWindow *stage_window);
 };
 
 CLUTTER_AVAILABLE_IN_MUFFIN
@@ -143,6 +144,8 @@ void              _clutter_stage_window_finish_frame            (ClutterStageWin
 
 int64_t           _clutter_stage_window_get_frame_counter       (ClutterStageWindow *window);
 
+float             _clutter_stage_window_get_refresh_rate        (ClutterStageWindow *window);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_STAGE_WINDOW_H__ */
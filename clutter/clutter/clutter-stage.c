@@ -74,6 +74,7 @@
 #include "clutter-private.h"
 #include "clutter-stage-manager-private.h"
 #include "clutter-stage-private.h"
+#include "clutter-trace-private.h"
 #include "clutter-version.h" 	/* For flavour */
 #include "clutter-private.h"
 
@@ -105,6 +106,37 @@ struct _ClutterStageQueueRedrawEntry
   ClutterPaintVolume clip;
 };
 
+/* Geometric picking: instead of rendering the scene in pick mode and
+ * reading back a pixel, every actor logs the screen-space quad it would
+ * have filled and the hit test is done on the CPU.
+ */
+typedef struct _PickRecord
+{
+  ClutterPoint vertex[4];
+  ClutterActor *actor;
+  int clip_stack_top;
+} PickRecord;
+
+typedef struct _PickClipRecord
+{
+  int prev;
+  ClutterPoint vertex[4];
+} PickClipRecord;
+
+/* The results of the last few picks, for as long as nothing changed in
+ * the scene since; the pointer often stays on the same pixel while
+ * several picks are done for it */
+#define PICK_CACHE_SIZE 4
+
+typedef struct _PickCacheEntry
+{
+  guint scene_generation;
+  gint x;
+  gint y;
+  ClutterPickMode mode;
+  ClutterActor *actor;
+} PickCacheEntry;
+
 struct _ClutterStagePrivate
 {
   /* the stage implementation */
@@ -121,7 +153,11 @@ struct _ClutterStagePrivate
   gchar *title;
   ClutterActor *key_focused_actor;
 
-  GQueue *event_queue;
+  /* Events waiting for _clutter_stage_process_queued_events(), and
+   * the array they are swapped with while being processed, kept so
+   * that queueing doesn't allocate once the arrays have grown */
+  GPtrArray *event_queue;
+  GPtrArray *spare_event_queue;
 
   ClutterStageHint stage_hints;
 
@@ -131,6 +167,9 @@ struct _ClutterStagePrivate
 
   GList *pending_queue_redraws;
 
+  /* actors that can be allocated without relayouting their parent */
+  GSList *pending_relayouts;
+
   CoglFramebuffer *active_framebuffer;
 
   gint sync_delay;
@@ -138,17 +177,42 @@ struct _ClutterStagePrivate
   GTimer *fps_timer;
   gint32 timer_n_frames;
 
+  /* The actors painted in the current color pick pass, by pick id */
   ClutterIDPool *pick_id_pool;
+  guint pick_pass;
+
+  GArray *pick_stack;
+  GArray *pick_clip_stack;
+  int pick_clip_stack_top;
+
+  /* Bumped whenever something that picking depends on changes */
+  guint scene_generation;
+
+  PickCacheEntry pick_cache[PICK_CACHE_SIZE];
+  guint next_pick_cache_entry;
+
+  /* What the records of the pick stack were logged for; they can be
+   * hit-tested again at any position while the scene is the same */
+  guint pick_stack_generation;
+  ClutterPickMode pick_stack_mode;
+  ClutterStageView *pick_stack_view;
 
 #ifdef CLUTTER_ENABLE_DEBUG
   gulong redraw_count;
 #endif /* CLUTTER_ENABLE_DEBUG */
 
+  /* Redraw queue entries finished in this update, and in the last one */
+  guint n_queue_redraw_entries;
+  guint last_n_queue_redraw_entries;
+
   ClutterStageState current_state;
 
   gpointer paint_data;
   GDestroyNotify paint_notify;
 
+  /* Applied to the colour of every pixel of the views */
+  CoglMatrix color_transform;
+
   guint relayout_pending       : 1;
   guint redraw_pending         : 1;
   guint is_fullscreen          : 1;
@@ -162,6 +226,9 @@ struct _ClutterStagePrivate
   guint motion_events_enabled  : 1;
   guint has_custom_perspective : 1;
   guint stage_was_relayout     : 1;
+  guint geometric_picking      : 1;
+  guint logging_picks          : 1;
+  guint has_color_transform    : 1;
 };
 
 enum
@@ -613,6 +680,285 @@ _clutter_stage_update_active_framebuffer (ClutterStage    *stage,
   priv->active_framebuffer = framebuffer;
 }
 
+/* Occlusion culling
+ *
+ * Before painting, the stage is walked from the top-most actor down,
+ * accumulating in window coordinates the areas in which actors
+ * implementing #ClutterActorClass.get_opaque_region() paint fully
+ * opaque pixels. Actors whose paint box lies within that area are
+ * marked as occluded and skipped by clutter_actor_paint() for the
+ * rest of the paint. Only actors mapped to the window by a scale and
+ * a translation contribute, and subtrees painted through effects or
+ * an offscreen redirect are left alone entirely, since those may
+ * change what ends up on screen and may cache their contents.
+ */
+
+typedef struct
+{
+  cairo_region_t *covered;
+  GPtrArray *occluded;
+} OcclusionState;
+
+/* Small enough not to matter, but enough for the float error of an
+ * untransformed actor not to lose it a row of pixels */
+#define OCCLUSION_EPSILON 0.01f
+
+/* Retrieves how @actor is mapped to window coordinates, if that is by
+ * a scale and a translation only */
+static gboolean
+get_actor_window_transform (ClutterActor *actor,
+                            float        *x_origin,
+                            float        *y_origin,
+                            float        *x_scale,
+                            float        *y_scale)
+{
+  ClutterVertex verts[4];
+  float width, height;
+
+  clutter_actor_get_size (actor, &width, &height);
+  if (width <= 0.f || height <= 0.f)
+    return FALSE;
+
+  /* top-left, top-right, bottom-left, bottom-right */
+  clutter_actor_get_abs_allocation_vertices (actor, verts);
+
+  if (fabsf (verts[0].y - verts[1].y) > OCCLUSION_EPSILON ||
+      fabsf (verts[2].y - verts[3].y) > OCCLUSION_EPSILON ||
+      fabsf (verts[0].x - verts[2].x) > OCCLUSION_EPSILON ||
+      fabsf (verts[1].x - verts[3].x) > OCCLUSION_EPSILON)
+    return FALSE;
+
+  *x_origin = verts[0].x;
+  *y_origin = verts[0].y;
+  *x_scale = (verts[1].x - verts[0].x) / width;
+  *y_scale = (verts[2].y - verts[0].y) / height;
+
+  return *x_scale > 0.f && *y_scale > 0.f;
+}
+
+/* Maps @box to the largest rectangle of whole window pixels it covers,
+ * so that we never claim a partially covered pixel */
+static void
+box_to_inner_window_rect (const ClutterActorBox *box,
+                          float                  x_origin,
+                          float                  y_origin,
+                          float                  x_scale,
+                          float                  y_scale,
+                          cairo_rectangle_int_t *rect)
+{
+  float x1, y1, x2, y2;
+
+  x1 = ceilf (x_origin + box->x1 * x_scale - OCCLUSION_EPSILON);
+  y1 = ceilf (y_origin + box->y1 * y_scale - OCCLUSION_EPSILON);
+  x2 = floorf (x_origin + box->x2 * x_scale + OCCLUSION_EPSILON);
+  y2 = floorf (y_origin + box->y2 * y_scale + OCCLUSION_EPSILON);
+
+  rect->x = x1;
+  rect->y = y1;
+  rect->width = MAX (x2 - x1, 0);
+  rect->height = MAX (y2 - y1, 0);
+}
+
+/* Adds the opaque region of @actor, clipped to @clip, to the covered
+ * area */
+static void
+occlusion_add_opaque_region (OcclusionState              *state,
+                             ClutterActor                *actor,
+                             const cairo_rectangle_int_t *clip)
+{
+  cairo_region_t *opaque;
+  float x_origin, y_origin, x_scale, y_scale;
+  int i, n_rects;
+
+  if (clip != NULL && (clip->width == 0 || clip->height == 0))
+    return;
+
+  if (clutter_actor_get_paint_opacity (actor) != 0xff)
+    return;
+
+  opaque = _clutter_actor_get_opaque_region (actor);
+  if (opaque == NULL)
+    return;
+
+  if (get_actor_window_transform (actor, &x_origin, &y_origin,
+                                  &x_scale, &y_scale))
+    {
+      n_rects = cairo_region_num_rectangles (opaque);
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+          ClutterActorBox box;
+
+          cairo_region_get_rectangle (opaque, i, &rect);
+          clutter_actor_box_init (&box,
+                                  rect.x, rect.y,
+                                  rect.x + rect.width, rect.y + rect.height);
+
+          box_to_inner_window_rect (&box, x_origin, y_origin,
+                                    x_scale, y_scale, &rect);
+
+          if (clip != NULL &&
+              !_clutter_util_rectangle_intersection (&rect, clip, &rect))
+            continue;
+
+          if (rect.width > 0 && rect.height > 0)
+            cairo_region_union_rectangle (state->covered, &rect);
+        }
+    }
+
+  cairo_region_destroy (opaque);
+}
+
+/* Checks whether the whole of @actor painted within @paint_clip is
+ * beneath the covered area */
+static gboolean
+occlusion_is_covered (OcclusionState              *state,
+                      ClutterActor                *actor,
+                      const cairo_rectangle_int_t *paint_clip)
+{
+  ClutterActorBox box;
+  cairo_rectangle_int_t rect;
+  int x1, y1, x2, y2;
+
+  if (cairo_region_is_empty (state->covered))
+    return FALSE;
+
+  if (!_clutter_actor_paint_volume_covers_children (actor))
+    return FALSE;
+
+  if (!clutter_actor_get_paint_box (actor, &box))
+    return FALSE;
+
+  x1 = MAX (floorf (box.x1), paint_clip->x);
+  y1 = MAX (floorf (box.y1), paint_clip->y);
+  x2 = MIN (ceilf (box.x2), paint_clip->x + paint_clip->width);
+  y2 = MIN (ceilf (box.y2), paint_clip->y + paint_clip->height);
+
+  /* culled anyway */
+  if (x2 <= x1 || y2 <= y1)
+    return FALSE;
+
+  rect.x = x1;
+  rect.y = y1;
+  rect.width = x2 - x1;
+  rect.height = y2 - y1;
+
+  return cairo_region_contains_rectangle (state->covered, &rect) ==
+         CAIRO_REGION_OVERLAP_IN;
+}
+
+/* Walks the children of @actor from the top-most down. @clip is the
+ * window rectangle their opaque regions are limited to by the clips
+ * of their ancestors, or %NULL if there is none. */
+static void
+clutter_stage_cull_occluded_children (OcclusionState              *state,
+                                      ClutterActor                *actor,
+                                      const cairo_rectangle_int_t *paint_clip,
+                                      const cairo_rectangle_int_t *clip)
+{
+  ClutterActorIter iter;
+  ClutterActor *child;
+
+  clutter_actor_iter_init (&iter, actor);
+  while (clutter_actor_iter_prev (&iter, &child))
+    {
+      cairo_rectangle_int_t child_clip;
+      const cairo_rectangle_int_t *child_clip_p = clip;
+
+      if (!CLUTTER_ACTOR_IS_MAPPED (child) ||
+          clutter_actor_get_opacity (child) == 0)
+        continue;
+
+      if (clutter_actor_has_effects (child) ||
+          clutter_actor_get_offscreen_redirect (child) != 0)
+        continue;
+
+      if (occlusion_is_covered (state, child, paint_clip))
+        {
+          _clutter_actor_set_occluded (child, TRUE);
+          g_ptr_array_add (state->occluded, child);
+          continue;
+        }
+
+      if (clutter_actor_get_clip_to_allocation (child) ||
+          clutter_actor_has_clip (child))
+        {
+          float x_origin, y_origin, x_scale, y_scale;
+          ClutterActorBox box;
+
+          if (clutter_actor_get_clip_to_allocation (child))
+            {
+              box.x1 = box.y1 = 0.f;
+              clutter_actor_get_size (child, &box.x2, &box.y2);
+            }
+          else
+            {
+              float x, y, width, height;
+
+              clutter_actor_get_clip (child, &x, &y, &width, &height);
+              clutter_actor_box_init (&box, x, y, x + width, y + height);
+            }
+
+          if (get_actor_window_transform (child, &x_origin, &y_origin,
+                                          &x_scale, &y_scale))
+            {
+              box_to_inner_window_rect (&box, x_origin, y_origin,
+                                        x_scale, y_scale, &child_clip);
+
+              if (clip != NULL)
+                _clutter_util_rectangle_intersection (&child_clip, clip,
+                                                      &child_clip);
+            }
+          else
+            child_clip.width = child_clip.height = 0;
+
+          child_clip_p = &child_clip;
+        }
+
+      /* the children are painted above the actor itself */
+      clutter_stage_cull_occluded_children (state, child,
+                                            paint_clip, child_clip_p);
+
+      occlusion_add_opaque_region (state, child, child_clip_p);
+    }
+}
+
+static GPtrArray *
+clutter_stage_cull_occluded (ClutterStage                *stage,
+                             const cairo_rectangle_int_t *paint_clip)
+{
+  OcclusionState state;
+
+  if (G_UNLIKELY (clutter_paint_debug_flags & CLUTTER_DEBUG_DISABLE_CULLING))
+    return NULL;
+
+  state.covered = cairo_region_create ();
+  state.occluded = g_ptr_array_new ();
+
+  clutter_stage_cull_occluded_children (&state, CLUTTER_ACTOR (stage),
+                                        paint_clip, NULL);
+
+  cairo_region_destroy (state.covered);
+
+  CLUTTER_NOTE (CLIPPING, "%u actors are occluded", state.occluded->len);
+
+  return state.occluded;
+}
+
+static void
+clutter_stage_reset_occluded (GPtrArray *occluded)
+{
+  guint i;
+
+  if (occluded == NULL)
+    return;
+
+  for (i = 0; i < occluded->len; i++)
+    _clutter_actor_set_occluded (g_ptr_array_index (occluded, i), FALSE);
+
+  g_ptr_array_free (occluded, TRUE);
+}
+
 /* XXX: Instead of having a toplevel 2D clip region, it might be
  * better to have a clip volume within the view frustum. This could
  * allow us to avoid projecting actors into window coordinates to
@@ -629,6 +975,7 @@ clutter_stage_do_paint_view (ClutterStage                *stage,
   float clip_poly[8];
   float viewport[4];
   cairo_rectangle_int_t geom;
+  GPtrArray *occluded;
 
   _clutter_stage_window_get_geometry (priv->impl, &geom);
 
@@ -670,11 +1017,18 @@ clutter_stage_do_paint_view (ClutterStage                *stage,
 
   _clutter_stage_paint_volume_stack_free_all (stage);
   _clutter_stage_update_active_framebuffer (stage, framebuffer);
+
+  occluded = clutter_stage_cull_occluded (stage, clip);
   clutter_actor_paint (CLUTTER_ACTOR (stage));
+  clutter_stage_reset_occluded (occluded);
 }
 
 /* This provides a common point of entry for painting the scenegraph
  * for picking or painting...
+ *
+ * A view may be painted in several clipped passes, so the stage window
+ * is responsible for calling _clutter_stage_emit_after_paint() once the
+ * whole view has been painted.
  */
 void
 _clutter_stage_paint_view (ClutterStage                *stage,
@@ -687,6 +1041,11 @@ _clutter_stage_paint_view (ClutterStage                *stage,
     return;
 
   clutter_stage_do_paint_view (stage, view, clip);
+}
+
+void
+_clutter_stage_emit_after_paint (ClutterStage *stage)
+{
   g_signal_emit (stage, stage_signals[AFTER_PAINT], 0);
 }
 
@@ -889,12 +1248,12 @@ _clutter_stage_queue_event (ClutterStage *stage,
 
   priv = stage->priv;
 
-  first_event = priv->event_queue->length == 0;
+  first_event = priv->event_queue->len == 0;
 
   if (copy_event)
     event = clutter_event_copy (event);
 
-  g_queue_push_tail (priv->event_queue, event);
+  g_ptr_array_add (priv->event_queue, event);
 
   if (first_event)
     {
@@ -934,97 +1293,159 @@ _clutter_stage_has_queued_events (ClutterStage *stage)
 
   priv = stage->priv;
 
-  return priv->event_queue->length > 0;
+  return priv->event_queue->len > 0;
+}
+
+static gboolean
+events_share_device (const ClutterEvent *event,
+                     const ClutterEvent *other)
+{
+  ClutterInputDevice *device, *other_device;
+  ClutterInputDevice *source, *other_source;
+
+  device = clutter_event_get_device (event);
+  other_device = clutter_event_get_device (other);
+
+  /* without a device we can't tell the events apart */
+  if (device == NULL || other_device == NULL)
+    return TRUE;
+
+  source = clutter_event_get_source_device (event);
+  other_source = clutter_event_get_source_device (other);
+
+  return device == other_device || source == other_source;
+}
+
+/* Returns the queued event that makes the motion or touch update at
+ * @index in @events redundant, if any: a later motion from the same source device,
+ * or update of the same touch sequence, or a leave of the same device.
+ * Motions and touch updates of other devices and sequences are skipped
+ * over, so that they don't keep a fast device from being compressed;
+ * any other event, like a button, scroll or key event, stops the search
+ * so that the positions leading to it are kept. Tablet tools are never
+ * compressed, since users of their events want no precision loss.
+ */
+static ClutterEvent *
+find_superseding_event (GPtrArray *events,
+                        guint      index)
+{
+  ClutterEvent *event = g_ptr_array_index (events, index);
+  ClutterInputDevice *source;
+  ClutterInputDeviceType device_type;
+  guint i;
+
+  source = clutter_event_get_source_device (event);
+  if (source == NULL)
+    source = clutter_event_get_device (event);
+
+  if (source != NULL)
+    {
+      device_type = clutter_input_device_get_device_type (source);
+
+      if (device_type == CLUTTER_TABLET_DEVICE ||
+          device_type == CLUTTER_PEN_DEVICE ||
+          device_type == CLUTTER_ERASER_DEVICE)
+        return NULL;
+    }
+
+  for (i = index + 1; i < events->len; i++)
+    {
+      ClutterEvent *next_event = g_ptr_array_index (events, i);
+      gboolean same_device = events_share_device (event, next_event);
+
+      if (event->type == CLUTTER_MOTION &&
+          next_event->type == CLUTTER_LEAVE &&
+          same_device)
+        return next_event;
+
+      if (next_event->type != CLUTTER_MOTION &&
+          next_event->type != CLUTTER_TOUCH_UPDATE)
+        return NULL;
+
+      if (!same_device || next_event->type != event->type)
+        continue;
+
+      if (event->type == CLUTTER_MOTION)
+        {
+          if (clutter_event_get_source_device (event) ==
+              clutter_event_get_source_device (next_event))
+            return next_event;
+        }
+      else if (next_event->touch.sequence == event->touch.sequence)
+        return next_event;
+    }
+
+  return NULL;
 }
 
 void
 _clutter_stage_process_queued_events (ClutterStage *stage)
 {
   ClutterStagePrivate *priv;
-  GList *events, *l;
+  GPtrArray *events;
+  guint i;
 
   g_return_if_fail (CLUTTER_IS_STAGE (stage));
 
   priv = stage->priv;
 
-  if (priv->event_queue->length == 0)
+  if (priv->event_queue->len == 0)
     return;
 
   /* In case the stage gets destroyed during event processing */
   g_object_ref (stage);
 
   /* Steal events before starting processing to avoid reentrancy
-   * issues */
-  events = priv->event_queue->head;
-  priv->event_queue->head =  NULL;
-  priv->event_queue->tail = NULL;
-  priv->event_queue->length = 0;
+   * issues; events queued meanwhile go into the spare array, unless
+   * that is being processed by an outer call already */
+  events = priv->event_queue;
+  if (priv->spare_event_queue != NULL)
+    {
+      priv->event_queue = priv->spare_event_queue;
+      priv->spare_event_queue = NULL;
+    }
+  else
+    priv->event_queue = g_ptr_array_new ();
 
-  for (l = events; l != NULL; l = l->next)
+  for (i = 0; i < events->len; i++)
     {
       ClutterEvent *event;
       ClutterEvent *next_event;
-      ClutterInputDevice *device;
-      ClutterInputDevice *next_device;
-      ClutterInputDeviceType device_type;
-      gboolean check_device = FALSE;
 
-      event = l->data;
-      next_event = l->next ? l->next->data : NULL;
+      event = g_ptr_array_index (events, i);
 
-      device = clutter_event_get_device (event);
-
-      if (next_event != NULL)
-        next_device = clutter_event_get_device (next_event);
+      if (priv->throttle_motion_events &&
+          (event->type == CLUTTER_MOTION ||
+           event->type == CLUTTER_TOUCH_UPDATE))
+        next_event = find_superseding_event (events, i);
       else
-        next_device = NULL;
-
-      if (device != NULL && next_device != NULL)
-        check_device = TRUE;
+        next_event = NULL;
 
-      device_type = clutter_input_device_get_device_type (device);
-
-      /* Skip consecutive motion events coming from the same device,
-       * except those of tablet tools, since users of these events
-       * want no precision loss.
-       */
-      if (priv->throttle_motion_events && next_event != NULL &&
-          device_type != CLUTTER_TABLET_DEVICE &&
-          device_type != CLUTTER_PEN_DEVICE &&
-          device_type != CLUTTER_ERASER_DEVICE)
+      if (next_event != NULL && event->type == CLUTTER_MOTION)
         {
-          if (event->type == CLUTTER_MOTION &&
-              (next_event->type == CLUTTER_MOTION ||
-               next_event->type == CLUTTER_LEAVE) &&
-              (!check_device || (device == next_device)))
-            {
-              CLUTTER_NOTE (EVENT,
-                            "Omitting motion event at %d, %d",
-                            (int) event->motion.x,
-                            (int) event->motion.y);
-
-              if (next_event->type == CLUTTER_MOTION)
-                {
-                  ClutterDeviceManager *device_manager =
-                    clutter_device_manager_get_default ();
+          CLUTTER_NOTE (EVENT,
+                        "Omitting motion event at %d, %d",
+                        (int) event->motion.x,
+                        (int) event->motion.y);
 
-                  _clutter_device_manager_compress_motion (device_manager,
-                                                           next_event, event);
-                }
-
-              goto next_event;
-            }
-          else if (event->type == CLUTTER_TOUCH_UPDATE &&
-                   next_event->type == CLUTTER_TOUCH_UPDATE &&
-                   event->touch.sequence == next_event->touch.sequence &&
-                   (!check_device || (device == next_device)))
+          if (next_event->type == CLUTTER_MOTION)
             {
-              CLUTTER_NOTE (EVENT,
-                            "Omitting touch update event at %d, %d",
-                            (int) event->touch.x,
-                            (int) event->touch.y);
-              goto next_event;
+              ClutterDeviceManager *device_manager =
+                clutter_device_manager_get_default ();
+
+              _clutter_device_manager_compress_motion (device_manager,
+                                                       next_event, event);
             }
+
+          goto next_event;
+        }
+      else if (next_event != NULL)
+        {
+          CLUTTER_NOTE (EVENT,
+                        "Omitting touch update event at %d, %d",
+                        (int) event->touch.x,
+                        (int) event->touch.y);
+          goto next_event;
         }
 
       _clutter_process_event (event);
@@ -1033,7 +1454,12 @@ _clutter_stage_process_queued_events (ClutterStage *stage)
       clutter_event_free (event);
     }
 
-  g_list_free (events);
+  g_ptr_array_set_size (events, 0);
+
+  if (priv->spare_event_queue == NULL)
+    priv->spare_event_queue = events;
+  else
+    g_ptr_array_unref (events);
 
   g_object_unref (stage);
 }
@@ -1055,7 +1481,9 @@ _clutter_stage_needs_update (ClutterStage *stage)
 
   priv = stage->priv;
 
-  return priv->relayout_pending || priv->redraw_pending;
+  return priv->relayout_pending ||
+         priv->pending_relayouts != NULL ||
+         priv->redraw_pending;
 }
 
 void
@@ -1065,22 +1493,55 @@ _clutter_stage_maybe_relayout (ClutterActor *actor)
   ClutterStagePrivate *priv = stage->priv;
   gfloat natural_width, natural_height;
   ClutterActorBox box = { 0, };
+  GSList *roots, *l;
+#ifdef CLUTTER_ENABLE_DEBUG
+  guint allocation_count = _clutter_actor_get_allocation_count ();
+  guint n_roots = 0;
+  guint hits, misses, old_hits, old_misses;
 
-  if (!priv->relayout_pending)
+  _clutter_actor_get_size_request_stats (&old_hits, &old_misses);
+#endif
+
+  if (!priv->relayout_pending && priv->pending_relayouts == NULL)
     return;
 
   /* avoid reentrancy */
-  if (!CLUTTER_ACTOR_IN_RELAYOUT (stage))
+  if (CLUTTER_ACTOR_IN_RELAYOUT (stage))
+    return;
+
+  priv->stage_was_relayout = TRUE;
+
+  CLUTTER_TRACE1 (relayout_start, (int) priv->relayout_pending);
+
+  CLUTTER_SET_PRIVATE_FLAGS (stage, CLUTTER_IN_RELAYOUT);
+
+  /* Reallocate the relayout roots first: if one of them changed the
+   * size request of its parent, that queues a relayout of the stage
+   * which is then done below */
+  roots = g_slist_reverse (priv->pending_relayouts);
+  priv->pending_relayouts = NULL;
+
+  for (l = roots; l != NULL; l = l->next)
+    {
+#ifdef CLUTTER_ENABLE_DEBUG
+      CLUTTER_NOTE (ACTOR, "Recomputing layout of '%s'",
+                    _clutter_actor_get_debug_name (l->data));
+      n_roots++;
+#endif
+
+      _clutter_actor_relayout_root (l->data);
+    }
+
+  g_slist_free_full (roots, g_object_unref);
+
+  if (priv->relayout_pending)
     {
       priv->relayout_pending = FALSE;
-      priv->stage_was_relayout = TRUE;
 
 #ifdef CLUTTER_ENABLE_DEBUG
       CLUTTER_NOTE (ACTOR, "Recomputing layout");
 #endif
 
-      CLUTTER_SET_PRIVATE_FLAGS (stage, CLUTTER_IN_RELAYOUT);
-
       natural_width = natural_height = 0;
       clutter_actor_get_preferred_size (CLUTTER_ACTOR (stage),
                                         NULL, NULL,
@@ -1099,9 +1560,46 @@ _clutter_stage_maybe_relayout (ClutterActor *actor)
 
       clutter_actor_allocate (CLUTTER_ACTOR (stage),
                               &box, CLUTTER_ALLOCATION_NONE);
-
-      CLUTTER_UNSET_PRIVATE_FLAGS (stage, CLUTTER_IN_RELAYOUT);
     }
+
+  CLUTTER_UNSET_PRIVATE_FLAGS (stage, CLUTTER_IN_RELAYOUT);
+
+  CLUTTER_TRACE (relayout_end);
+
+#ifdef CLUTTER_ENABLE_DEBUG
+  _clutter_actor_get_size_request_stats (&hits, &misses);
+
+  CLUTTER_NOTE (LAYOUT, "Relayout visited %u actors from %u roots; "
+                "%u size requests hit the cache, %u missed",
+                _clutter_actor_get_allocation_count () - allocation_count,
+                n_roots,
+                hits - old_hits, misses - old_misses);
+#endif
+}
+
+/*
+ * _clutter_stage_queue_actor_relayout:
+ * @stage: a #ClutterStage
+ * @actor: a descendant of @stage whose parent has the
+ *   %CLUTTER_ACTOR_NO_LAYOUT flag
+ *
+ * Queues @actor to be allocated on its own during the next relayout,
+ * instead of relayouting the whole stage.
+ */
+void
+_clutter_stage_queue_actor_relayout (ClutterStage *stage,
+                                     ClutterActor *actor)
+{
+  ClutterStagePrivate *priv = stage->priv;
+
+  if (g_slist_find (priv->pending_relayouts, actor) != NULL)
+    return;
+
+  if (!priv->relayout_pending && priv->pending_relayouts == NULL)
+    _clutter_stage_schedule_update (stage);
+
+  priv->pending_relayouts = g_slist_prepend (priv->pending_relayouts,
+                                             g_object_ref (actor));
 }
 
 static void
@@ -1263,6 +1761,9 @@ _clutter_stage_do_update (ClutterStage *stage)
     }
 #endif /* CLUTTER_ENABLE_DEBUG */
 
+  priv->last_n_queue_redraw_entries = priv->n_queue_redraw_entries;
+  priv->n_queue_redraw_entries = 0;
+
   while (pointers)
     {
       _clutter_input_device_update (pointers->data, NULL, TRUE);
@@ -1383,8 +1884,9 @@ _clutter_stage_has_full_redraw_queued (ClutterStage *stage)
  * bounds of that clip. An application can use this information to
  * avoid some extra work if it knows that some regions of the stage
  * aren't going to be painted. This should only be called while the
- * stage is being painted. If there is no current redraw clip then
- * this function will set @clip to the full extents of the stage.
+ * stage is being painted, which includes the #ClutterStage::after-paint
+ * signal. If there is no current redraw clip then this function will
+ * set @clip to the full extents of the stage.
  *
  * Since: 1.8
  */
@@ -1439,6 +1941,231 @@ read_pixels_to_file (char *filename_stem,
   read_count++;
 }
 
+static void
+transform_pick_box (ClutterStage          *stage,
+                    const ClutterActorBox *box,
+                    ClutterPoint          *vertex)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  ClutterVertex vertices_in[4] = {
+    { box->x1, box->y1, 0.f },
+    { box->x2, box->y1, 0.f },
+    { box->x2, box->y2, 0.f },
+    { box->x1, box->y2, 0.f },
+  };
+  ClutterVertex vertices_out[4];
+  CoglMatrix modelview;
+  int i;
+
+  /* The modelview tracks whatever transformations are in effect while
+   * the scene is traversed, including the ones applied by clones and
+   * effects, so the logged quad matches what a pick render would fill.
+   */
+  cogl_get_modelview_matrix (&modelview);
+  _clutter_util_fully_transform_vertices (&modelview,
+                                          &priv->projection,
+                                          priv->viewport,
+                                          vertices_in,
+                                          vertices_out,
+                                          4);
+
+  for (i = 0; i < 4; i++)
+    {
+      vertex[i].x = vertices_out[i].x;
+      vertex[i].y = vertices_out[i].y;
+    }
+}
+
+/*< private >
+ * _clutter_stage_is_logging_picks:
+ * @stage: a #ClutterStage
+ *
+ * Checks whether a geometric pick is in progress on @stage, in which
+ * case actors should describe their pick silhouette through
+ * clutter_actor_pick_box() instead of painting it.
+ *
+ * Return value: %TRUE if pick boxes are being logged
+ */
+gboolean
+_clutter_stage_is_logging_picks (ClutterStage *stage)
+{
+  return stage->priv->logging_picks;
+}
+
+void
+_clutter_stage_log_pick (ClutterStage          *stage,
+                         const ClutterActorBox *box,
+                         ClutterActor          *actor)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  PickRecord rec;
+
+  g_assert (priv->logging_picks);
+
+  transform_pick_box (stage, box, rec.vertex);
+  rec.actor = actor;
+  rec.clip_stack_top = priv->pick_clip_stack_top;
+
+  g_array_append_val (priv->pick_stack, rec);
+}
+
+void
+_clutter_stage_push_pick_clip (ClutterStage          *stage,
+                               const ClutterActorBox *box)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  PickClipRecord clip;
+
+  g_assert (priv->logging_picks);
+
+  transform_pick_box (stage, box, clip.vertex);
+  clip.prev = priv->pick_clip_stack_top;
+
+  g_array_append_val (priv->pick_clip_stack, clip);
+  priv->pick_clip_stack_top = priv->pick_clip_stack->len - 1;
+}
+
+void
+_clutter_stage_pop_pick_clip (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  const PickClipRecord *top;
+
+  g_assert (priv->logging_picks);
+  g_assert (priv->pick_clip_stack_top >= 0);
+
+  /* Clips are never freed individually, since pick records logged
+   * while they were active still point at them. */
+  top = &g_array_index (priv->pick_clip_stack,
+                        PickClipRecord,
+                        priv->pick_clip_stack_top);
+  priv->pick_clip_stack_top = top->prev;
+}
+
+static gboolean
+quad_contains_point (const ClutterPoint *vertex,
+                     float               x,
+                     float               y)
+{
+  gboolean has_negative = FALSE;
+  gboolean has_positive = FALSE;
+  int i;
+
+  /* The quads are projected rectangles, so they are convex and the
+   * point is inside if it lies on the same side of every edge,
+   * whichever way round the vertices ended up winding. */
+  for (i = 0; i < 4; i++)
+    {
+      const ClutterPoint *a = &vertex[i];
+      const ClutterPoint *b = &vertex[(i + 1) % 4];
+      float cross = (b->x - a->x) * (y - a->y) - (b->y - a->y) * (x - a->x);
+
+      if (cross < 0.f)
+        has_negative = TRUE;
+      else if (cross > 0.f)
+        has_positive = TRUE;
+
+      if (has_negative && has_positive)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+pick_record_contains_point (ClutterStage     *stage,
+                            const PickRecord *rec,
+                            float             x,
+                            float             y)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  int clip_index;
+
+  if (!quad_contains_point (rec->vertex, x, y))
+    return FALSE;
+
+  clip_index = rec->clip_stack_top;
+  while (clip_index >= 0)
+    {
+      const PickClipRecord *clip =
+        &g_array_index (priv->pick_clip_stack, PickClipRecord, clip_index);
+
+      if (!quad_contains_point (clip->vertex, x, y))
+        return FALSE;
+
+      clip_index = clip->prev;
+    }
+
+  return TRUE;
+}
+
+static ClutterActor *
+_clutter_stage_do_geometric_pick_on_view (ClutterStage     *stage,
+                                          gint              x,
+                                          gint              y,
+                                          ClutterPickMode   mode,
+                                          ClutterStageView *view)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  CoglFramebuffer *fb = clutter_stage_view_get_framebuffer (view);
+  ClutterMainContext *context;
+  ClutterActor *retval = CLUTTER_ACTOR (stage);
+  int i;
+
+  context = _clutter_context_get_default ();
+
+  if (priv->pick_stack_generation != priv->scene_generation ||
+      priv->pick_stack_mode != mode ||
+      priv->pick_stack_view != view)
+    {
+      guint scene_generation = priv->scene_generation;
+
+      /* The framebuffer is only needed for its matrix stack; nothing is
+       * read back, so the GPU is never waited on. Pick vfuncs drawing
+       * with Cogl themselves, like ClutterTexture's, still draw, so an
+       * empty scissor keeps them off the view's contents. */
+      cogl_push_framebuffer (fb);
+      _clutter_stage_maybe_setup_viewport (stage, view);
+      cogl_framebuffer_push_scissor_clip (fb, 0, 0, 0, 0);
+
+      g_array_set_size (priv->pick_stack, 0);
+      g_array_set_size (priv->pick_clip_stack, 0);
+      priv->pick_clip_stack_top = -1;
+
+      priv->logging_picks = TRUE;
+      context->pick_mode = mode;
+      clutter_stage_do_paint_view (stage, view, NULL);
+      context->pick_mode = CLUTTER_PICK_NONE;
+      priv->logging_picks = FALSE;
+
+      cogl_framebuffer_pop_clip (fb);
+      cogl_pop_framebuffer ();
+
+      priv->pick_stack_generation = scene_generation;
+      priv->pick_stack_mode = mode;
+      priv->pick_stack_view = view;
+    }
+
+  /* Records are logged in paint order, so the topmost actor is the
+   * last one containing the center of the picked pixel. */
+  for (i = priv->pick_stack->len - 1; i >= 0; i--)
+    {
+      const PickRecord *rec = &g_array_index (priv->pick_stack, PickRecord, i);
+
+      if (pick_record_contains_point (stage, rec, x + 0.5f, y + 0.5f))
+        {
+          retval = rec->actor;
+          break;
+        }
+    }
+
+  CLUTTER_NOTE (PICK, "Geometric pick at %i,%i over %u records found %s",
+                x, y, priv->pick_stack->len,
+                _clutter_actor_get_debug_name (retval));
+
+  return retval;
+}
+
 static ClutterActor *
 _clutter_stage_do_pick_on_view (ClutterStage     *stage,
                                 gint              x,
@@ -1463,6 +2190,7 @@ _clutter_stage_do_pick_on_view (ClutterStage     *stage,
   float fb_scale;
   float viewport_offset_x;
   float viewport_offset_y;
+  gint64 pick_start = 0;
 
   context = _clutter_context_get_default ();
   fb_scale = clutter_stage_view_get_scale (view);
@@ -1516,6 +2244,15 @@ _clutter_stage_do_pick_on_view (ClutterStage     *stage,
   cogl_color_init_from_4ub (&stage_pick_id, 255, 255, 255, 255);
   cogl_clear (&stage_pick_id, COGL_BUFFER_BIT_COLOR | COGL_BUFFER_BIT_DEPTH);
 
+  /* Start handing out pick ids from 0 again; the actors that still hold
+   * one from the previous pass see it is stale from the pass number */
+  _clutter_id_pool_clear (priv->pick_id_pool);
+  if (++priv->pick_pass == 0)
+    priv->pick_pass = 1;
+
+  if (G_UNLIKELY (CLUTTER_HAS_DEBUG (PICK)))
+    pick_start = g_get_monotonic_time ();
+
   /* Disable dithering (if any) when doing the painting in pick mode */
   dither_enabled_save = cogl_framebuffer_get_dither_enabled (fb);
   cogl_framebuffer_set_dither_enabled (fb, FALSE);
@@ -1552,6 +2289,11 @@ _clutter_stage_do_pick_on_view (ClutterStage     *stage,
       free (file_name);
     }
 
+  CLUTTER_NOTE (PICK, "Pick pass %u painted %u actors in %.3f ms",
+                priv->pick_pass,
+                _clutter_id_pool_get_size (priv->pick_id_pool),
+                (g_get_monotonic_time () - pick_start) / 1000.0);
+
   /* Restore whether GL_DITHER was enabled */
   cogl_framebuffer_set_dither_enabled (fb, dither_enabled_save);
 
@@ -1614,6 +2356,9 @@ _clutter_stage_do_pick (ClutterStage   *stage,
   ClutterStagePrivate *priv = stage->priv;
   float stage_width, stage_height;
   ClutterStageView *view = NULL;
+  PickCacheEntry *entry;
+  guint scene_generation;
+  int i;
 
   priv = stage->priv;
 
@@ -1631,12 +2376,64 @@ _clutter_stage_do_pick (ClutterStage   *stage,
     return actor;
 
   view = get_view_at (stage, x, y);
-  if (view)
-    return _clutter_stage_do_pick_on_view (stage, x, y, mode, view);
+  if (view == NULL)
+    return actor;
+
+  scene_generation = priv->scene_generation;
+
+  if (G_LIKELY (!(clutter_pick_debug_flags & CLUTTER_DEBUG_DUMP_PICK_BUFFERS)))
+    {
+      for (i = 0; i < PICK_CACHE_SIZE; i++)
+        {
+          entry = &priv->pick_cache[i];
+
+          if (entry->scene_generation == scene_generation &&
+              entry->x == x && entry->y == y && entry->mode == mode)
+            {
+              CLUTTER_NOTE (PICK, "Pick at %i,%i found %s in the cache",
+                            x, y, _clutter_actor_get_debug_name (entry->actor));
+              return entry->actor;
+            }
+        }
+    }
+
+  if (priv->geometric_picking)
+    actor = _clutter_stage_do_geometric_pick_on_view (stage, x, y, mode, view);
+  else
+    actor = _clutter_stage_do_pick_on_view (stage, x, y, mode, view);
+
+  entry = &priv->pick_cache[priv->next_pick_cache_entry];
+  priv->next_pick_cache_entry = (priv->next_pick_cache_entry + 1) % PICK_CACHE_SIZE;
+
+  entry->scene_generation = scene_generation;
+  entry->x = x;
+  entry->y = y;
+  entry->mode = mode;
+  entry->actor = actor;
 
   return actor;
 }
 
+/**
+ * _clutter_stage_invalidate_pick:
+ * @stage: a #ClutterStage
+ *
+ * Drops the results of the previous picks on @stage. Needs to be called
+ * whenever something changes that could make a pick at the same
+ * position find another actor: the redraws queued on the actors, which
+ * their transforms, stacking and visibility all queue, their
+ * allocations, or their reactivity.
+ */
+void
+_clutter_stage_invalidate_pick (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+
+  /* 0 is what the cache entries and pick stack start with */
+  if (++priv->scene_generation == 0)
+    priv->scene_generation = 1;
+}
+
 static gboolean
 clutter_stage_real_delete_event (ClutterStage *stage,
                                  ClutterEvent *event)
@@ -1868,6 +2665,9 @@ clutter_stage_dispose (GObject *object)
 
   g_list_free_full (priv->pending_queue_redraws,
                     (GDestroyNotify) free_queue_redraw_entry);
+
+  g_slist_free_full (priv->pending_relayouts, g_object_unref);
+  priv->pending_relayouts = NULL;
   priv->pending_queue_redraws = NULL;
 
   /* this will release the reference on the stage */
@@ -1883,8 +2683,9 @@ clutter_stage_finalize (GObject *object)
   ClutterStage *stage = CLUTTER_STAGE (object);
   ClutterStagePrivate *priv = stage->priv;
 
-  g_queue_foreach (priv->event_queue, (GFunc) clutter_event_free, NULL);
-  g_queue_free (priv->event_queue);
+  g_ptr_array_foreach (priv->event_queue, (GFunc) clutter_event_free, NULL);
+  g_ptr_array_unref (priv->event_queue);
+  g_clear_pointer (&priv->spare_event_queue, g_ptr_array_unref);
 
   free (priv->title);
 
@@ -1892,6 +2693,9 @@ clutter_stage_finalize (GObject *object)
 
   _clutter_id_pool_free (priv->pick_id_pool);
 
+  g_array_free (priv->pick_stack, TRUE);
+  g_array_free (priv->pick_clip_stack, TRUE);
+
   if (priv->fps_timer != NULL)
     g_timer_destroy (priv->fps_timer);
 
@@ -2321,7 +3125,8 @@ clutter_stage_init (ClutterStage *self)
         g_critical ("Unable to create a new stage implementation.");
     }
 
-  priv->event_queue = g_queue_new ();
+  priv->event_queue = g_ptr_array_sized_new (64);
+  priv->spare_event_queue = g_ptr_array_sized_new (64);
 
   priv->is_fullscreen = FALSE;
   priv->is_user_resizable = FALSE;
@@ -2389,6 +3194,11 @@ clutter_stage_init (ClutterStage *self)
     g_array_new (FALSE, FALSE, sizeof (ClutterPaintVolume));
 
   priv->pick_id_pool = _clutter_id_pool_new (256);
+
+  priv->pick_stack = g_array_new (FALSE, FALSE, sizeof (PickRecord));
+  priv->pick_clip_stack = g_array_new (FALSE, FALSE, sizeof (PickClipRecord));
+  priv->pick_clip_stack_top = -1;
+  priv->scene_generation = 1;
 }
 
 /**
@@ -4038,6 +4848,20 @@ _clutter_stage_clear_update_time (ClutterStage *stage)
     _clutter_stage_window_clear_update_time (stage_window);
 }
 
+/* Returns the refresh rate of the output the stage was last presented
+ * on, or 0 if it isn't known yet */
+float
+_clutter_stage_get_refresh_rate (ClutterStage *stage)
+{
+  ClutterStageWindow *stage_window;
+
+  stage_window = _clutter_stage_get_window (stage);
+  if (stage_window == NULL)
+    return 0.0;
+
+  return _clutter_stage_window_get_refresh_rate (stage_window);
+}
+
 /**
  * clutter_stage_set_no_clear_hint:
  * @stage: a #ClutterStage
@@ -4261,6 +5085,72 @@ _clutter_stage_queue_redraw_entry_invalidate (ClutterStageQueueRedrawEntry *entr
     }
 }
 
+/* Drops the entries of actors which have an ancestor with an unclipped
+ * redraw queued, when finishing the ancestor's redraw does everything
+ * finishing theirs would; see _clutter_actor_coalesce_queue_redraw().
+ * A whole subtree that got a queue_redraw() each, as a relayout or an
+ * animated group does, then costs one paint volume transformation
+ * rather than one per actor.
+ */
+static GList *
+coalesce_queue_redraws (GList *entries)
+{
+  GHashTable *unclipped = NULL;
+  GList *l, *next;
+  guint n_coalesced = 0;
+
+  for (l = entries; l != NULL; l = l->next)
+    {
+      ClutterStageQueueRedrawEntry *entry = l->data;
+
+      if (entry->actor == NULL || entry->has_clip)
+        continue;
+
+      if (unclipped == NULL)
+        unclipped = g_hash_table_new (NULL, NULL);
+
+      g_hash_table_add (unclipped, entry->actor);
+    }
+
+  if (unclipped == NULL)
+    return entries;
+
+  for (l = entries; l != NULL; l = next)
+    {
+      ClutterStageQueueRedrawEntry *entry = l->data;
+      ClutterActor *ancestor;
+
+      next = l->next;
+
+      if (entry->actor == NULL)
+        continue;
+
+      for (ancestor = clutter_actor_get_parent (entry->actor);
+           ancestor != NULL;
+           ancestor = clutter_actor_get_parent (ancestor))
+        {
+          if (g_hash_table_contains (unclipped, ancestor))
+            break;
+        }
+
+      if (ancestor != NULL &&
+          _clutter_actor_coalesce_queue_redraw (entry->actor, ancestor))
+        {
+          free_queue_redraw_entry (entry);
+          entries = g_list_delete_link (entries, l);
+          n_coalesced++;
+        }
+    }
+
+  g_hash_table_destroy (unclipped);
+
+  if (n_coalesced > 0)
+    CLUTTER_NOTE (CLIPPING, "Coalesced %u redraws into their ancestors'",
+                  n_coalesced);
+
+  return entries;
+}
+
 static void
 clutter_stage_maybe_finish_queue_redraws (ClutterStage *stage)
 {
@@ -4280,6 +5170,8 @@ clutter_stage_maybe_finish_queue_redraws (ClutterStage *stage)
       GList *stolen_list = stage->priv->pending_queue_redraws;
       stage->priv->pending_queue_redraws = NULL;
 
+      stolen_list = coalesce_queue_redraws (stolen_list);
+
       for (l = stolen_list; l; l = l->next)
         {
           ClutterStageQueueRedrawEntry *entry = l->data;
@@ -4291,6 +5183,7 @@ clutter_stage_maybe_finish_queue_redraws (ClutterStage *stage)
 	      clip = entry->has_clip ? &entry->clip : NULL;
 
 	      _clutter_actor_finish_queue_redraw (entry->actor, clip);
+	      stage->priv->n_queue_redraw_entries++;
 	    }
 
           free_queue_redraw_entry (entry);
@@ -4425,6 +5318,20 @@ _clutter_stage_get_active_framebuffer (ClutterStage *stage)
   return stage->priv->active_framebuffer;
 }
 
+/*
+ * _clutter_stage_get_pick_pass:
+ * @stage: a #ClutterStage
+ *
+ * Pick ids are only given out for the duration of a color pick pass;
+ * this returns a number identifying the current one, so that actors
+ * can tell whether the id they got earlier is still valid.
+ */
+guint
+_clutter_stage_get_pick_pass (ClutterStage *stage)
+{
+  return stage->priv->pick_pass;
+}
+
 gint32
 _clutter_stage_acquire_pick_id (ClutterStage *stage,
                                 ClutterActor *actor)
@@ -4436,17 +5343,6 @@ _clutter_stage_acquire_pick_id (ClutterStage *stage,
   return _clutter_id_pool_add (priv->pick_id_pool, actor);
 }
 
-void
-_clutter_stage_release_pick_id (ClutterStage *stage,
-                                gint32        pick_id)
-{
-  ClutterStagePrivate *priv = stage->priv;
-
-  g_assert (priv->pick_id_pool != NULL);
-
-  _clutter_id_pool_remove (priv->pick_id_pool, pick_id);
-}
-
 ClutterActor *
 _clutter_stage_get_actor_by_pick_id (ClutterStage *stage,
                                      gint32        pick_id)
@@ -4706,6 +5602,44 @@ clutter_stage_skip_sync_delay (ClutterStage *stage)
     _clutter_stage_window_schedule_update (stage_window, -1);
 }
 
+/**
+ * clutter_stage_set_tearing_allowed:
+ * @stage: a #ClutterStage
+ * @allowed: whether late frames may tear
+ *
+ * Lets frames of @stage that miss the vblank they were drawn for be
+ * presented right away, with a tear line, instead of a whole refresh
+ * later. Frames that are on time are still synchronized to the vblank.
+ *
+ * This only has an effect where the window system supports it; see
+ * cogl_onscreen_set_swap_tearing_allowed().
+ *
+ * Stability: unstable
+ */
+void
+clutter_stage_set_tearing_allowed (ClutterStage *stage,
+                                   gboolean      allowed)
+{
+  ClutterStageWindow *stage_window;
+  GList *l;
+
+  g_return_if_fail (CLUTTER_IS_STAGE (stage));
+
+  stage_window = _clutter_stage_get_window (stage);
+  if (stage_window == NULL)
+    return;
+
+  for (l = _clutter_stage_window_get_views (stage_window); l; l = l->next)
+    {
+      CoglFramebuffer *framebuffer =
+        clutter_stage_view_get_framebuffer (l->data);
+
+      if (cogl_is_onscreen (framebuffer))
+        cogl_onscreen_set_swap_tearing_allowed (COGL_ONSCREEN (framebuffer),
+                                                allowed);
+    }
+}
+
 int64_t
 clutter_stage_get_frame_counter (ClutterStage          *stage)
 {
@@ -4919,3 +5853,112 @@ clutter_stage_capture_into (ClutterStage          *stage,
   view = get_view_at_rect (stage, rect);
   capture_view_into (stage, paint, view, rect, data, rect->width * bpp);
 }
+
+/**
+ * clutter_stage_set_geometric_picking:
+ * @stage: a #ClutterStage
+ * @enabled: whether to pick geometrically
+ *
+ * Selects how clutter_stage_get_actor_at_pos() finds the actor under a
+ * point. By default the scene is painted in pick mode into the
+ * framebuffer and the pixel is read back, which synchronizes with the
+ * GPU. With geometric picking enabled, actors log the transformed
+ * boxes they cover through clutter_actor_pick_box() and the hit test
+ * runs on the CPU instead.
+ *
+ * Actors overriding #ClutterActorClass.pick() must describe their
+ * silhouette with clutter_actor_pick_box() to be pickable in this mode;
+ * what they paint with Cogl directly is scissored away.
+ */
+void
+clutter_stage_set_geometric_picking (ClutterStage *stage,
+                                     gboolean      enabled)
+{
+  g_return_if_fail (CLUTTER_IS_STAGE (stage));
+
+  stage->priv->geometric_picking = !!enabled;
+  _clutter_stage_invalidate_pick (stage);
+}
+
+/**
+ * clutter_stage_get_geometric_picking:
+ * @stage: a #ClutterStage
+ *
+ * Retrieves the value set with clutter_stage_set_geometric_picking().
+ *
+ * Return value: %TRUE if the stage picks geometrically
+ */
+gboolean
+clutter_stage_get_geometric_picking (ClutterStage *stage)
+{
+  g_return_val_if_fail (CLUTTER_IS_STAGE (stage), FALSE);
+
+  return stage->priv->geometric_picking;
+}
+
+/**
+ * clutter_stage_get_n_queued_redraws:
+ * @stage: a #ClutterStage
+ *
+ * Retrieves how many actors had their queued redraw processed for the
+ * last frame of @stage, not counting those whose redraw was covered by
+ * the redraw of one of their ancestors. Every one of them has its
+ * paint volume transformed to the stage's coordinates, so this tells
+ * how much queueing redraws costs each frame.
+ *
+ * Return value: the number of redraw queue entries of the last frame
+ */
+guint
+clutter_stage_get_n_queued_redraws (ClutterStage *stage)
+{
+  g_return_val_if_fail (CLUTTER_IS_STAGE (stage), 0);
+
+  return stage->priv->last_n_queue_redraw_entries;
+}
+
+/**
+ * clutter_stage_set_color_transform:
+ * @stage: a #ClutterStage
+ * @transform: (allow-none): the matrix to transform colours with, or
+ *   %NULL to show them as they are
+ *
+ * Transforms the colour of every pixel the stage shows by @transform,
+ * which multiplies the column vector (red, green, blue, 1), with each
+ * component between 0 and 1. The fourth column of @transform is thus
+ * an offset added to the result: inverting the colours, for instance,
+ * takes a diagonal of -1 and an offset of 1.
+ *
+ * The transform is applied to each view as a final pass over what the
+ * frame repainted, so it costs the same whatever the scene contains.
+ * It isn't seen by #ClutterStage::after-paint handlers, so screen
+ * captures get the colours as they were painted.
+ */
+void
+clutter_stage_set_color_transform (ClutterStage     *stage,
+                                   const CoglMatrix *transform)
+{
+  ClutterStagePrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_STAGE (stage));
+
+  priv = stage->priv;
+
+  if (transform == NULL && !priv->has_color_transform)
+    return;
+
+  priv->has_color_transform = transform != NULL;
+  if (transform != NULL)
+    priv->color_transform = *transform;
+
+  /* The parts of the back buffers that wouldn't be repainted show the
+   * old colours */
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (stage));
+}
+
+const CoglMatrix *
+_clutter_stage_get_color_transform (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+
+  return priv->has_color_transform ? &priv->color_transform : NULL;
+}
@@ -256,6 +256,9 @@ void            clutter_stage_set_sync_delay                    (ClutterStage
                                                                  gint                   sync_delay);
 CLUTTER_AVAILABLE_IN_1_14
 void            clutter_stage_skip_sync_delay                   (ClutterStage          *stage);
+CLUTTER_AVAILABLE_IN_MUFFIN
+void            clutter_stage_set_tearing_allowed               (ClutterStage          *stage,
+                                                                 gboolean               allowed);
 #endif
 
 CLUTTER_AVAILABLE_IN_MUFFIN
@@ -265,6 +268,19 @@ gboolean clutter_stage_capture (ClutterStage          *stage,
                                 ClutterCapture       **captures,
                                 int                   *n_captures);
 
+CLUTTER_AVAILABLE_IN_MUFFIN
+void     clutter_stage_set_geometric_picking (ClutterStage *stage,
+                                              gboolean      enabled);
+CLUTTER_AVAILABLE_IN_MUFFIN
+gboolean clutter_stage_get_geometric_picking (ClutterStage *stage);
+
+CLUTTER_AVAILABLE_IN_MUFFIN
+guint    clutter_stage_get_n_queued_redraws  (ClutterStage *stage);
+
+CLUTTER_AVAILABLE_IN_MUFFIN
+void     clutter_stage_set_color_transform   (ClutterStage     *stage,
+                                              const CoglMatrix *transform);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_STAGE_H__ */
@@ -63,6 +63,7 @@
 #include "clutter-units.h"
 #include "clutter-paint-volume-private.h"
 #include "clutter-scriptable.h"
+#include "clutter-settings-private.h"
 #include "clutter-input-focus.h"
 
 /* cursor width in pixels */
@@ -99,6 +100,46 @@ struct _LayoutCache
   guint age;
 };
 
+/* Layouts of non-editable text without attributes are shared between
+ * all the ClutterText actors that lay out the same text the same way,
+ * so that repeated labels are only shaped once. The cache holds a
+ * reference on each layout and drops the least recently used ones
+ * beyond its size; layouts still in use stay alive through the
+ * references in the actors' LayoutCache slots.
+ */
+#define DEFAULT_SHARED_LAYOUTS  256
+
+typedef struct _SharedLayout    SharedLayout;
+
+struct _SharedLayout
+{
+  /* Everything the layout depends on */
+  gchar *text;
+  PangoFontDescription *font_desc;
+  gint width;
+  gint height;
+  PangoEllipsizeMode ellipsize;
+  PangoWrapMode wrap_mode;
+  PangoAlignment alignment;
+  PangoDirection direction;
+  guint justify          : 1;
+  guint single_line_mode : 1;
+
+  PangoLayout *layout;
+
+  /* Link in shared_layouts_lru, most recently used first */
+  GList lru_link;
+};
+
+static GHashTable *shared_layouts = NULL;
+static GQueue shared_layouts_lru = G_QUEUE_INIT;
+static gint max_shared_layouts = -1;
+
+/* The shared layouts are made with their own contexts, one for each
+ * base direction, rather than that of the actor which first needed
+ * them, since actors change the base direction of their context */
+static PangoContext *shared_contexts[3];
+
 struct _ClutterTextInputFocus
 {
   ClutterInputFocus parent_instance;
@@ -211,6 +252,7 @@ struct _ClutterTextPrivate
   guint paint_volume_valid      : 1;
   guint show_password_hint      : 1;
   guint password_hint_visible   : 1;
+  guint in_set_positions        : 1;
   guint resolved_direction      : 4;
 };
 
@@ -605,6 +647,68 @@ clutter_text_ensure_effective_attributes (ClutterText *self)
     }
 }
 
+static PangoDirection
+clutter_text_resolve_direction (ClutterText *text,
+                                const gchar *contents,
+                                gsize        contents_len)
+{
+  ClutterTextPrivate *priv = text->priv;
+  PangoDirection pango_dir;
+
+  if (priv->password_char != 0)
+    pango_dir = PANGO_DIRECTION_NEUTRAL;
+  else
+    pango_dir = pango_find_base_dir (contents, contents_len);
+
+  if (pango_dir == PANGO_DIRECTION_NEUTRAL)
+    {
+      ClutterBackend *backend = clutter_get_default_backend ();
+      ClutterTextDirection text_dir;
+
+      if (clutter_actor_has_key_focus (CLUTTER_ACTOR (text)))
+        pango_dir = _clutter_backend_get_keymap_direction (backend);
+      else
+        {
+          text_dir = clutter_actor_get_text_direction (CLUTTER_ACTOR (text));
+
+          if (text_dir == CLUTTER_TEXT_DIRECTION_RTL)
+            pango_dir = PANGO_DIRECTION_RTL;
+          else
+            pango_dir = PANGO_DIRECTION_LTR;
+       }
+    }
+
+  return pango_dir;
+}
+
+/* Applies the layout properties of @text that don't depend on the text
+ * itself */
+static void
+clutter_text_setup_layout (ClutterText       *text,
+                           PangoLayout       *layout,
+                           gint               width,
+                           gint               height,
+                           PangoEllipsizeMode ellipsize)
+{
+  ClutterTextPrivate *priv = text->priv;
+
+  /* This will merge the markup attributes and the attributes
+   * property if needed */
+  clutter_text_ensure_effective_attributes (text);
+
+  if (priv->effective_attrs != NULL)
+    pango_layout_set_attributes (layout, priv->effective_attrs);
+
+  pango_layout_set_alignment (layout, priv->alignment);
+  pango_layout_set_single_paragraph_mode (layout, priv->single_line_mode);
+  pango_layout_set_justify (layout, priv->justify);
+  pango_layout_set_wrap (layout, priv->wrap_mode);
+
+  pango_layout_set_ellipsize (layout, ellipsize);
+  pango_layout_set_width (layout, width);
+  pango_layout_set_height (layout, height);
+}
+
 static PangoLayout *
 clutter_text_create_layout_no_cache (ClutterText       *text,
 				     gint               width,
@@ -653,28 +757,7 @@ clutter_text_create_layout_no_cache (ClutterText       *text,
     {
       PangoDirection pango_dir;
 
-      if (priv->password_char != 0)
-        pango_dir = PANGO_DIRECTION_NEUTRAL;
-      else
-        pango_dir = pango_find_base_dir (contents, contents_len);
-
-      if (pango_dir == PANGO_DIRECTION_NEUTRAL)
-        {
-          ClutterBackend *backend = clutter_get_default_backend ();
-          ClutterTextDirection text_dir;
-
-          if (clutter_actor_has_key_focus (CLUTTER_ACTOR (text)))
-            pango_dir = _clutter_backend_get_keymap_direction (backend);
-          else
-            {
-              text_dir = clutter_actor_get_text_direction (CLUTTER_ACTOR (text));
-
-              if (text_dir == CLUTTER_TEXT_DIRECTION_RTL)
-                pango_dir = PANGO_DIRECTION_RTL;
-              else
-                pango_dir = PANGO_DIRECTION_LTR;
-           }
-        }
+      pango_dir = clutter_text_resolve_direction (text, contents, contents_len);
 
       pango_context_set_base_dir (clutter_actor_get_pango_context (CLUTTER_ACTOR (text)), pango_dir);
 
@@ -683,25 +766,234 @@ clutter_text_create_layout_no_cache (ClutterText       *text,
       pango_layout_set_text (layout, contents, contents_len);
     }
 
-  /* This will merge the markup attributes and the attributes
-   * property if needed */
-  clutter_text_ensure_effective_attributes (text);
+  clutter_text_setup_layout (text, layout, width, height, ellipsize);
 
-  if (priv->effective_attrs != NULL)
-    pango_layout_set_attributes (layout, priv->effective_attrs);
+  free (contents);
 
-  pango_layout_set_alignment (layout, priv->alignment);
-  pango_layout_set_single_paragraph_mode (layout, priv->single_line_mode);
-  pango_layout_set_justify (layout, priv->justify);
-  pango_layout_set_wrap (layout, priv->wrap_mode);
+  return layout;
+}
 
-  pango_layout_set_ellipsize (layout, ellipsize);
-  pango_layout_set_width (layout, width);
-  pango_layout_set_height (layout, height);
+static guint
+shared_layout_hash (gconstpointer key)
+{
+  const SharedLayout *shared = key;
 
-  free (contents);
+  return (g_str_hash (shared->text) ^
+          pango_font_description_hash (shared->font_desc) ^
+          (guint) shared->width * 31 ^
+          (guint) shared->height * 17 ^
+          (shared->ellipsize << 2) ^
+          (shared->wrap_mode << 4) ^
+          (shared->alignment << 6) ^
+          (shared->direction << 8) ^
+          (shared->justify << 12) ^
+          (shared->single_line_mode << 13));
+}
 
-  return layout;
+static gboolean
+shared_layout_equal (gconstpointer a,
+                     gconstpointer b)
+{
+  const SharedLayout *shared_a = a;
+  const SharedLayout *shared_b = b;
+
+  return (shared_a->width == shared_b->width &&
+          shared_a->height == shared_b->height &&
+          shared_a->ellipsize == shared_b->ellipsize &&
+          shared_a->wrap_mode == shared_b->wrap_mode &&
+          shared_a->alignment == shared_b->alignment &&
+          shared_a->direction == shared_b->direction &&
+          shared_a->justify == shared_b->justify &&
+          shared_a->single_line_mode == shared_b->single_line_mode &&
+          strcmp (shared_a->text, shared_b->text) == 0 &&
+          pango_font_description_equal (shared_a->font_desc,
+                                        shared_b->font_desc));
+}
+
+static void
+shared_layout_free (gpointer data)
+{
+  SharedLayout *shared = data;
+
+  g_queue_unlink (&shared_layouts_lru, &shared->lru_link);
+
+  free (shared->text);
+  pango_font_description_free (shared->font_desc);
+  if (shared->layout != NULL)
+    g_object_unref (shared->layout);
+
+  g_slice_free (SharedLayout, shared);
+}
+
+/* Called whenever the backend changes the font settings the shared
+ * contexts were made with */
+static void
+clutter_text_flush_shared_layouts (ClutterBackend *backend)
+{
+  int i;
+
+  if (shared_layouts != NULL)
+    g_hash_table_remove_all (shared_layouts);
+
+  for (i = 0; i < G_N_ELEMENTS (shared_contexts); i++)
+    g_clear_object (&shared_contexts[i]);
+}
+
+static gboolean
+clutter_text_shared_layouts_enabled (void)
+{
+  if (G_UNLIKELY (max_shared_layouts < 0))
+    {
+      ClutterBackend *backend = clutter_get_default_backend ();
+      const gchar *env_string;
+
+      max_shared_layouts = DEFAULT_SHARED_LAYOUTS;
+
+      env_string = g_getenv ("CLUTTER_TEXT_LAYOUT_CACHE");
+      if (env_string != NULL)
+        max_shared_layouts = MAX (0, g_ascii_strtoll (env_string, NULL, 10));
+
+      shared_layouts = g_hash_table_new_full (shared_layout_hash,
+                                              shared_layout_equal,
+                                              shared_layout_free,
+                                              NULL);
+
+      g_signal_connect (backend, "settings-changed",
+                        G_CALLBACK (clutter_text_flush_shared_layouts), NULL);
+      g_signal_connect (backend, "font-changed",
+                        G_CALLBACK (clutter_text_flush_shared_layouts), NULL);
+      g_signal_connect (backend, "resolution-changed",
+                        G_CALLBACK (clutter_text_flush_shared_layouts), NULL);
+    }
+
+  return max_shared_layouts > 0;
+}
+
+static gboolean
+clutter_text_can_share_layout (ClutterText *text)
+{
+  ClutterTextPrivate *priv = text->priv;
+
+  /* Editable text is changed under the layout, and there is no cheap
+   * way to compare attribute lists */
+  return (!priv->editable &&
+          priv->password_char == 0 &&
+          priv->attrs == NULL &&
+          priv->markup_attrs == NULL &&
+          clutter_text_shared_layouts_enabled ());
+}
+
+static PangoContext *
+get_shared_context (PangoDirection direction)
+{
+  int index;
+
+  switch (direction)
+    {
+    case PANGO_DIRECTION_RTL:
+      index = 1;
+      break;
+    case PANGO_DIRECTION_LTR:
+      index = 0;
+      break;
+    default:
+      index = 2;
+      break;
+    }
+
+  if (shared_contexts[index] == NULL)
+    {
+      CoglPangoFontMap *font_map =
+        COGL_PANGO_FONT_MAP (clutter_get_font_map ());
+      ClutterBackend *backend = clutter_get_default_backend ();
+      gdouble resolution = clutter_backend_get_resolution (backend);
+
+      shared_contexts[index] = cogl_pango_font_map_create_context (font_map);
+      pango_cairo_context_set_font_options (shared_contexts[index],
+                                            clutter_backend_get_font_options (backend));
+      pango_cairo_context_set_resolution (shared_contexts[index],
+                                          resolution < 0 ? 96.0 : resolution);
+      pango_context_set_language (shared_contexts[index],
+                                  pango_language_get_default ());
+      pango_context_set_base_dir (shared_contexts[index], direction);
+    }
+
+  return shared_contexts[index];
+}
+
+/*
+ * clutter_text_get_shared_layout:
+ *
+ * Like clutter_text_create_layout_no_cache(), but returns a layout
+ * from the cache shared by all actors if one matches. Only valid if
+ * clutter_text_can_share_layout() returned %TRUE.
+ *
+ * Return value: (transfer full): the layout
+ */
+static PangoLayout *
+clutter_text_get_shared_layout (ClutterText       *text,
+                                gint               width,
+                                gint               height,
+                                PangoEllipsizeMode ellipsize)
+{
+  ClutterTextPrivate *priv = text->priv;
+  SharedLayout key, *shared;
+  gchar *contents;
+  gsize contents_len;
+
+  contents = clutter_text_get_display_text (text);
+  contents_len = strlen (contents);
+
+  priv->resolved_direction =
+    clutter_text_resolve_direction (text, contents, contents_len);
+
+  key.text = contents;
+  key.font_desc = priv->font_desc;
+  key.width = width;
+  key.height = height;
+  key.ellipsize = ellipsize;
+  key.wrap_mode = priv->wrap_mode;
+  key.alignment = priv->alignment;
+  key.direction = priv->resolved_direction;
+  key.justify = priv->justify;
+  key.single_line_mode = priv->single_line_mode;
+
+  shared = g_hash_table_lookup (shared_layouts, &key);
+  if (shared != NULL)
+    {
+      CLUTTER_NOTE (ACTOR, "ClutterText: %p: shared layout cache hit", text);
+
+      free (contents);
+
+      g_queue_unlink (&shared_layouts_lru, &shared->lru_link);
+      g_queue_push_head_link (&shared_layouts_lru, &shared->lru_link);
+
+      return g_object_ref (shared->layout);
+    }
+
+  shared = g_slice_new0 (SharedLayout);
+  *shared = key;
+  shared->text = contents;
+  shared->font_desc = pango_font_description_copy (priv->font_desc);
+  shared->lru_link.data = shared;
+  shared->lru_link.prev = shared->lru_link.next = NULL;
+
+  shared->layout = pango_layout_new (get_shared_context (key.direction));
+  pango_layout_set_font_description (shared->layout, priv->font_desc);
+  pango_layout_set_text (shared->layout, contents, contents_len);
+  clutter_text_setup_layout (text, shared->layout, width, height, ellipsize);
+
+  g_queue_push_head_link (&shared_layouts_lru, &shared->lru_link);
+  g_hash_table_add (shared_layouts, shared);
+
+  while (g_queue_get_length (&shared_layouts_lru) > (guint) max_shared_layouts)
+    {
+      SharedLayout *oldest = g_queue_peek_tail (&shared_layouts_lru);
+
+      g_hash_table_remove (shared_layouts, oldest);
+    }
+
+  return g_object_ref (shared->layout);
 }
 
 static void
@@ -765,21 +1057,29 @@ clutter_text_set_font_description_internal (ClutterText          *self,
   g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_FONT_DESCRIPTION]);
 }
 
+/* Only the texts using the default font depend on its name, and the
+ * font options and resolution only matter while a text is shown: a
+ * hidden one is measured again from scratch when it is shown, so just
+ * its layouts are dropped. Every text relaying out at once is what
+ * makes changing the font settings slow */
 static void
 clutter_text_settings_changed_cb (ClutterText *text)
 {
   ClutterTextPrivate *priv = text->priv;
   guint password_hint_time = 0;
   ClutterSettings *settings;
+  ClutterSettingsChanges changes;
 
   settings = clutter_settings_get_default ();
+  changes = _clutter_settings_get_changes (settings);
 
   g_object_get (settings, "password-hint-time", &password_hint_time, NULL);
 
   priv->show_password_hint = password_hint_time > 0;
   priv->password_hint_timeout = password_hint_time;
 
-  if (priv->is_default_font)
+  if (priv->is_default_font &&
+      (changes & CLUTTER_SETTINGS_CHANGED_FONT_NAME))
     {
       PangoFontDescription *font_desc;
       gchar *font_name = NULL;
@@ -797,8 +1097,14 @@ clutter_text_settings_changed_cb (ClutterText *text)
       free (font_name);
     }
 
+  if ((changes & (CLUTTER_SETTINGS_CHANGED_FONT_OPTIONS |
+                  CLUTTER_SETTINGS_CHANGED_RESOLUTION)) == 0)
+    return;
+
   clutter_text_dirty_cache (text);
-  clutter_actor_queue_relayout (CLUTTER_ACTOR (text));
+
+  if (CLUTTER_ACTOR_IS_VISIBLE (text))
+    clutter_actor_queue_relayout (CLUTTER_ACTOR (text));
 }
 
 static void
@@ -981,8 +1287,12 @@ clutter_text_create_layout (ClutterText *text,
   if (oldest_cache->layout)
     g_object_unref (oldest_cache->layout);
 
-  oldest_cache->layout =
-    clutter_text_create_layout_no_cache (text, width, height, ellipsize);
+  if (clutter_text_can_share_layout (text))
+    oldest_cache->layout =
+      clutter_text_get_shared_layout (text, width, height, ellipsize);
+  else
+    oldest_cache->layout =
+      clutter_text_create_layout_no_cache (text, width, height, ellipsize);
 
   cogl_pango_ensure_glyph_cache_for_layout (oldest_cache->layout);
 
@@ -1199,6 +1509,95 @@ clutter_text_ensure_cursor_position (ClutterText *self)
     }
 }
 
+/* Queues a redraw of @rect, in actor coordinates, or of the whole
+ * actor if the cursor position was never computed
+ */
+static void
+clutter_text_queue_redraw_rect (ClutterText       *self,
+                                const ClutterRect *rect)
+{
+  cairo_rectangle_int_t clip;
+
+  if (rect->size.width <= 0 || rect->size.height <= 0)
+    {
+      clutter_text_queue_redraw (CLUTTER_ACTOR (self));
+      return;
+    }
+
+  clip.x = floorf (rect->origin.x) - 1;
+  clip.y = floorf (rect->origin.y) - 1;
+  clip.width = ceilf (rect->origin.x + rect->size.width) + 1 - clip.x;
+  clip.height = ceilf (rect->origin.y + rect->size.height) + 1 - clip.y;
+
+  clutter_text_dirty_paint_volume (self);
+  clutter_actor_queue_redraw_with_clip (CLUTTER_ACTOR (self), &clip);
+}
+
+/* Whether moving the cursor can scroll the text: a single line
+ * editable actor scrolls to keep the cursor in view once the text
+ * doesn't fit in the allocation
+ */
+static gboolean
+clutter_text_cursor_can_scroll (ClutterText *self)
+{
+  ClutterTextPrivate *priv = self->priv;
+  PangoLayout *layout;
+  PangoRectangle logical_rect = { 0, };
+  ClutterActorBox alloc = { 0, };
+
+  if (!(priv->editable && priv->single_line_mode))
+    return FALSE;
+
+  clutter_actor_get_allocation_box (CLUTTER_ACTOR (self), &alloc);
+  layout = clutter_text_create_layout (self, -1, -1);
+  pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
+
+  return logical_rect.width > (alloc.x2 - alloc.x1) - 2 * TEXT_PADDING;
+}
+
+/* The cursor is painted as a rectangle of its own on top of the
+ * layout, so as long as there is no selection, making it blink or
+ * moving it only needs the area under the old and the new cursor
+ * redrawn, and the layout and its display list stay as they are.
+ * Anything else redraws the whole actor.
+ */
+static void
+clutter_text_queue_redraw_cursor (ClutterText *self,
+                                  gint         old_position,
+                                  gint         old_selection_bound,
+                                  gboolean     was_drawn)
+{
+  ClutterTextPrivate *priv = self->priv;
+  ClutterRect old_cursor_rect = priv->cursor_rect;
+  gboolean is_drawn = clutter_text_should_draw_cursor (self);
+
+  if (!was_drawn && !is_drawn)
+    return;
+
+  if (old_position != old_selection_bound ||
+      priv->position != priv->selection_bound ||
+      (priv->editable && priv->preedit_set) ||
+      !clutter_actor_has_allocation (CLUTTER_ACTOR (self)) ||
+      (old_position != priv->position &&
+       clutter_text_cursor_can_scroll (self)))
+    {
+      clutter_text_queue_redraw (CLUTTER_ACTOR (self));
+      return;
+    }
+
+  if (was_drawn)
+    clutter_text_queue_redraw_rect (self, &old_cursor_rect);
+
+  if (is_drawn)
+    {
+      clutter_text_ensure_cursor_position (self);
+
+      if (!was_drawn ||
+          !clutter_rect_equals (&old_cursor_rect, &priv->cursor_rect))
+        clutter_text_queue_redraw_rect (self, &priv->cursor_rect);
+    }
+}
+
 /**
  * clutter_text_delete_selection:
  * @self: a #ClutterText
@@ -1273,9 +1672,20 @@ clutter_text_set_positions (ClutterText *self,
                             gint         new_pos,
                             gint         new_bound)
 {
+  ClutterTextPrivate *priv = self->priv;
+  gint old_position = priv->position;
+  gint old_selection_bound = priv->selection_bound;
+
+  /* Moving the cursor and collapsing the selection at once is a
+   * plain cursor move, so queue the redraw for both together
+   */
   g_object_freeze_notify (G_OBJECT (self));
+  priv->in_set_positions = TRUE;
   clutter_text_set_cursor_position (self, new_pos);
   clutter_text_set_selection_bound (self, new_bound);
+  priv->in_set_positions = FALSE;
+  clutter_text_queue_redraw_cursor (self, old_position, old_selection_bound,
+                                    clutter_text_should_draw_cursor (self));
   g_object_thaw_notify (G_OBJECT (self));
 }
 
@@ -4898,9 +5308,14 @@ clutter_text_set_cursor_visible (ClutterText *self,
 
   if (priv->cursor_visible != cursor_visible)
     {
+      gboolean was_drawn = clutter_text_should_draw_cursor (self);
+
+      /* The cursor doesn't take any space, so there is nothing to
+       * lay out again */
       priv->cursor_visible = cursor_visible;
 
-      clutter_text_queue_redraw_or_relayout (self);
+      clutter_text_queue_redraw_cursor (self, priv->position,
+                                        priv->selection_bound, was_drawn);
 
       g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_CURSOR_VISIBLE]);
     }
@@ -5082,7 +5497,8 @@ clutter_text_set_selection_bound (ClutterText *self,
       else
         priv->selection_bound = selection_bound;
 
-      clutter_text_queue_redraw (CLUTTER_ACTOR (self));
+      if (!priv->in_set_positions)
+        clutter_text_queue_redraw (CLUTTER_ACTOR (self));
 
       g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_SELECTION_BOUND]);
     }
@@ -5962,6 +6378,7 @@ clutter_text_set_cursor_position (ClutterText *self,
                                   gint         position)
 {
   ClutterTextPrivate *priv;
+  gint old_position;
   gint len;
 
   g_return_if_fail (CLUTTER_IS_TEXT (self));
@@ -5971,6 +6388,8 @@ clutter_text_set_cursor_position (ClutterText *self,
   if (priv->position == position)
     return;
 
+  old_position = priv->position;
+
   len = clutter_text_buffer_get_length (get_buffer (self));
 
   if (position < 0 || position >= len)
@@ -5982,7 +6401,10 @@ clutter_text_set_cursor_position (ClutterText *self,
      time the cursor is moved up or down */
   priv->x_pos = -1;
 
-  clutter_text_queue_redraw (CLUTTER_ACTOR (self));
+  if (!priv->in_set_positions)
+    clutter_text_queue_redraw_cursor (self, old_position,
+                                      priv->selection_bound,
+                                      clutter_text_should_draw_cursor (self));
 
   /* XXX:2.0 - remove */
   g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_POSITION]);
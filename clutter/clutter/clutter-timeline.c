@@ -960,6 +960,20 @@ emit_frame_signal (ClutterTimeline *timeline)
 
   CLUTTER_NOTE (SCHEDULER, "Emitting ::new-frame signal on timeline[%p]", timeline);
 
+  /* most timelines are transitions nobody connects to; going through
+   * the signal machinery for them every frame is wasted work */
+  if (!g_signal_has_handler_pending (timeline,
+                                     timeline_signals[NEW_FRAME],
+                                     0, TRUE))
+    {
+      ClutterTimelineClass *klass = CLUTTER_TIMELINE_GET_CLASS (timeline);
+
+      if (klass->new_frame != NULL)
+        klass->new_frame (timeline, elapsed);
+
+      return;
+    }
+
   g_signal_emit (timeline, timeline_signals[NEW_FRAME], 0, elapsed);
 }
 
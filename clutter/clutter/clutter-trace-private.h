@@ -0,0 +1,42 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_TRACE_PRIVATE_H__
+#define __CLUTTER_TRACE_PRIVATE_H__
+
+/* Static tracepoints in the "clutter" provider; see cogl-trace-private.h.
+ * Unlike CLUTTER_NOTE() they are present in release builds. */
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define CLUTTER_TRACE(probe) DTRACE_PROBE (clutter, probe)
+#define CLUTTER_TRACE1(probe, a) DTRACE_PROBE1 (clutter, probe, a)
+#define CLUTTER_TRACE2(probe, a, b) DTRACE_PROBE2 (clutter, probe, a, b)
+
+#else
+
+#define CLUTTER_TRACE(probe) G_STMT_START { } G_STMT_END
+#define CLUTTER_TRACE1(probe, a) G_STMT_START { } G_STMT_END
+#define CLUTTER_TRACE2(probe, a, b) G_STMT_START { } G_STMT_END
+
+#endif
+
+#endif /* __CLUTTER_TRACE_PRIVATE_H__ */
@@ -48,17 +48,49 @@
 #include "clutter-main.h"
 #include "clutter-private.h"
 #include "clutter-stage-private.h"
+#include "clutter-trace-private.h"
 #include "clutter-muffin.h"
 
+/* Painting each rectangle of a redraw clip costs a traversal of the
+ * scene graph, so past this many rectangles, or when the rectangles
+ * cover most of their bounding box anyway, the extents are painted in
+ * a single pass instead.
+ */
+#define MAX_REDRAW_CLIP_RECTS 8
+#define REDRAW_CLIP_MERGE_RATIO 0.75
+
+/* Under SYNC_LATE_LATCHING a frame is started just early enough for
+ * the slowest of the recent frames to finish before the deadline. The
+ * margin covers what the history can't see, such as the GPU finishing
+ * its work after a threaded swap, and nothing is predicted until a few
+ * frames have been measured.
+ */
+#define LATE_LATCHING_MARGIN_US 2000
+#define LATE_LATCHING_MIN_FRAMES 4
+
 typedef struct _ClutterStageViewCoglPrivate
 {
+  /*
+   * Redraw clips queued for the next frame, in stage coordinate space,
+   * clipped to the view layout.
+   */
+  cairo_region_t *redraw_clip;
+
   /*
    * List of previous damaged areas in stage view framebuffer coordinate space.
    */
 #define DAMAGE_HISTORY_MAX 16
 #define DAMAGE_HISTORY(x) ((x) & (DAMAGE_HISTORY_MAX - 1))
-  cairo_rectangle_int_t damage_history[DAMAGE_HISTORY_MAX];
+  cairo_region_t *damage_history[DAMAGE_HISTORY_MAX];
   unsigned int damage_index;
+
+  /*
+   * What the stage colour transform pass copies the repainted part of
+   * the framebuffer into, and draws it back with.
+   */
+  CoglTexture *color_texture;
+  CoglPipeline *color_pipeline;
+  int color_transform_location;
 } ClutterStageViewCoglPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (ClutterStageViewCogl, clutter_stage_view_cogl,
@@ -146,6 +178,44 @@ clutter_stage_cogl_realize (ClutterStageWindow *stage_window)
   return TRUE;
 }
 
+static void
+clutter_stage_cogl_record_frame (ClutterStageCogl *stage_cogl)
+{
+  gint64 start_time;
+
+  /* Only frames driven by presentation times have a known start */
+  if (stage_cogl->update_time == -1)
+    return;
+
+  start_time = MAX (stage_cogl->update_time, stage_cogl->schedule_time);
+
+  stage_cogl->frame_durations[stage_cogl->frame_history_index] =
+    MAX (0, g_get_monotonic_time () - start_time);
+  stage_cogl->frame_history_index =
+    (stage_cogl->frame_history_index + 1) %
+    CLUTTER_STAGE_COGL_FRAME_HISTORY_MAX;
+  stage_cogl->n_frame_durations =
+    MIN (stage_cogl->n_frame_durations + 1,
+         CLUTTER_STAGE_COGL_FRAME_HISTORY_MAX);
+}
+
+/* Returns how long before its presentation the next frame should
+ * start, or -1 if there isn't enough history to tell */
+static gint64
+clutter_stage_cogl_predict_frame_time (ClutterStageCogl *stage_cogl)
+{
+  gint64 max_duration = 0;
+  unsigned int i;
+
+  if (stage_cogl->n_frame_durations < LATE_LATCHING_MIN_FRAMES)
+    return -1;
+
+  for (i = 0; i < stage_cogl->n_frame_durations; i++)
+    max_duration = MAX (max_duration, stage_cogl->frame_durations[i]);
+
+  return max_duration + LATE_LATCHING_MARGIN_US;
+}
+
 static void
 clutter_stage_cogl_schedule_update (ClutterStageWindow *stage_window,
                                     gint                sync_delay)
@@ -170,6 +240,7 @@ clutter_stage_cogl_schedule_update (ClutterStageWindow *stage_window,
     return;
 
   now = g_get_monotonic_time ();
+  stage_cogl->schedule_time = now;
 
   if (sync_delay < 0 ||
       stage_cogl->last_presentation_time <= 0 ||
@@ -219,6 +290,18 @@ clutter_stage_cogl_schedule_update (ClutterStageWindow *stage_window,
   prerender_time = will_prerender_frames * refresh_interval
                  - 1000 * sync_delay;
 
+  /* Rather than starting right after the previous presentation, wait
+   * until the frame can only just be finished in time, so that it
+   * samples input and damage as close to scanout as possible */
+  if (_clutter_get_sync_method () == SYNC_LATE_LATCHING &&
+      refresh_interval > 0)
+    {
+      gint64 frame_time = clutter_stage_cogl_predict_frame_time (stage_cogl);
+
+      if (frame_time >= 0)
+        prerender_time = MIN (prerender_time, frame_time);
+    }
+
   stage_cogl->update_time = target_presentation_time - prerender_time;
 
   /* Are we repeating ourselves? If a clear and reschedule occur too close
@@ -247,6 +330,14 @@ clutter_stage_cogl_clear_update_time (ClutterStageWindow *stage_window)
   stage_cogl->update_time = -1;
 }
 
+static float
+clutter_stage_cogl_get_refresh_rate (ClutterStageWindow *stage_window)
+{
+  ClutterStageCogl *stage_cogl = CLUTTER_STAGE_COGL (stage_window);
+
+  return stage_cogl->refresh_rate;
+}
+
 static ClutterActor *
 clutter_stage_cogl_get_wrapper (ClutterStageWindow *stage_window)
 {
@@ -310,6 +401,22 @@ clutter_stage_cogl_ignoring_redraw_clips (ClutterStageWindow *stage_window)
     return FALSE;
 }
 
+static void
+clutter_stage_cogl_clear_view_redraw_clips (ClutterStageCogl *stage_cogl)
+{
+  ClutterStageWindow *stage_window = CLUTTER_STAGE_WINDOW (stage_cogl);
+  GList *l;
+
+  for (l = _clutter_stage_window_get_views (stage_window); l; l = l->next)
+    {
+      ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (l->data);
+      ClutterStageViewCoglPrivate *view_priv =
+        clutter_stage_view_cogl_get_instance_private (view_cogl);
+
+      g_clear_pointer (&view_priv->redraw_clip, cairo_region_destroy);
+    }
+}
+
 /* A redraw clip represents (in stage coordinates) the bounding box of
  * something that needs to be redraw. Typically they are added to the
  * StageWindow as a result of clutter_actor_queue_clipped_redraw() by
@@ -320,15 +427,19 @@ clutter_stage_cogl_ignoring_redraw_clips (ClutterStageWindow *stage_window)
  *
  * What we do with this information:
  * - we keep track of the bounding box for all redraw clips
- * - when we come to redraw; we scissor the redraw to that box and use
- *   glBlitFramebuffer to present the redraw to the front
- *   buffer.
+ * - each view accumulates the redraw clips that intersect it into a
+ *   region, so unrelated damage in opposite corners doesn't turn
+ *   into a redraw of everything between them
+ * - when we come to redraw; we scissor the redraw to each rectangle
+ *   of that region and use glBlitFramebuffer or swap-with-damage to
+ *   present the redraw to the front buffer.
  */
 static void
 clutter_stage_cogl_add_redraw_clip (ClutterStageWindow    *stage_window,
                                     cairo_rectangle_int_t *stage_clip)
 {
   ClutterStageCogl *stage_cogl = CLUTTER_STAGE_COGL (stage_window);
+  GList *l;
 
   /* If we are already forced to do a full stage redraw then bail early */
   if (clutter_stage_cogl_ignoring_redraw_clips (stage_window))
@@ -341,6 +452,7 @@ clutter_stage_cogl_add_redraw_clip (ClutterStageWindow    *stage_window,
     {
       stage_cogl->bounding_redraw_clip.width = 0;
       stage_cogl->initialized_redraw_clip = TRUE;
+      clutter_stage_cogl_clear_view_redraw_clips (stage_cogl);
       return;
     }
 
@@ -360,6 +472,27 @@ clutter_stage_cogl_add_redraw_clip (ClutterStageWindow    *stage_window,
     }
 
   stage_cogl->initialized_redraw_clip = TRUE;
+
+  for (l = _clutter_stage_window_get_views (stage_window); l; l = l->next)
+    {
+      ClutterStageView *view = l->data;
+      ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
+      ClutterStageViewCoglPrivate *view_priv =
+        clutter_stage_view_cogl_get_instance_private (view_cogl);
+      cairo_rectangle_int_t view_rect;
+      cairo_rectangle_int_t view_clip;
+
+      clutter_stage_view_get_layout (view, &view_rect);
+      if (!_clutter_util_rectangle_intersection (stage_clip,
+                                                 &view_rect,
+                                                 &view_clip))
+        continue;
+
+      if (view_priv->redraw_clip)
+        cairo_region_union_rectangle (view_priv->redraw_clip, &view_clip);
+      else
+        view_priv->redraw_clip = cairo_region_create_rectangle (&view_clip);
+    }
 }
 
 static gboolean
@@ -370,7 +503,7 @@ clutter_stage_cogl_get_redraw_clip_bounds (ClutterStageWindow    *stage_window,
 
   if (stage_cogl->using_clipped_redraw)
     {
-      *stage_clip = stage_cogl->bounding_redraw_clip;
+      *stage_clip = stage_cogl->current_redraw_clip;
 
       return TRUE;
     }
@@ -391,41 +524,64 @@ valid_buffer_age (ClutterStageViewCogl *view_cogl,
   return age < MIN (view_priv->damage_index, DAMAGE_HISTORY_MAX);
 }
 
+static void
+queue_damage_region (CoglOnscreen         *onscreen,
+                     const cairo_region_t *fb_paint_region)
+{
+  int *damage, n_rects, i;
+
+  n_rects = cairo_region_num_rectangles (fb_paint_region);
+  damage = g_newa (int, n_rects * 4);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (fb_paint_region, i, &rect);
+      damage[i * 4] = rect.x;
+      damage[i * 4 + 1] = rect.y;
+      damage[i * 4 + 2] = rect.width;
+      damage[i * 4 + 3] = rect.height;
+    }
+
+  cogl_onscreen_queue_damage_region (onscreen, damage, n_rects);
+}
+
 static gboolean
-swap_framebuffer (ClutterStageWindow    *stage_window,
-                  ClutterStageView      *view,
-                  cairo_rectangle_int_t *swap_region,
-                  gboolean               swap_with_damage)
+swap_framebuffer (ClutterStageWindow   *stage_window,
+                  ClutterStageView     *view,
+                  const cairo_region_t *swap_region,
+                  gboolean              swap_with_damage)
 {
   CoglFramebuffer *framebuffer = clutter_stage_view_get_onscreen (view);
-  int damage[4], ndamage;
+  int *damage, n_rects, i;
 
-  damage[0] = swap_region->x;
-  damage[1] = swap_region->y;
-  damage[2] = swap_region->width;
-  damage[3] = swap_region->height;
+  n_rects = cairo_region_num_rectangles (swap_region);
+  damage = g_newa (int, n_rects * 4);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
 
-  if (swap_region->width != 0)
-    ndamage = 1;
-  else
-    ndamage = 0;
+      cairo_region_get_rectangle (swap_region, i, &rect);
+      damage[i * 4] = rect.x;
+      damage[i * 4 + 1] = rect.y;
+      damage[i * 4 + 2] = rect.width;
+      damage[i * 4 + 3] = rect.height;
+    }
 
   if (cogl_is_onscreen (framebuffer))
     {
       CoglOnscreen *onscreen = COGL_ONSCREEN (framebuffer);
 
       /* push on the screen */
-      if (ndamage == 1 && !swap_with_damage)
+      if (n_rects > 0 && !swap_with_damage)
         {
           CLUTTER_NOTE (BACKEND,
                         "cogl_onscreen_swap_region (onscreen: %p, "
-                        "x: %d, y: %d, "
-                        "width: %d, height: %d)",
-                        onscreen,
-                        damage[0], damage[1], damage[2], damage[3]);
+                        "n_rects: %d)",
+                        onscreen, n_rects);
 
           cogl_onscreen_swap_region (onscreen,
-                                     damage, ndamage);
+                                     damage, n_rects);
 
           return FALSE;
         }
@@ -435,7 +591,7 @@ swap_framebuffer (ClutterStageWindow    *stage_window,
                         onscreen);
 
           cogl_onscreen_swap_buffers_with_damage (onscreen,
-                                                  damage, ndamage);
+                                                  damage, n_rects);
 
           return TRUE;
         }
@@ -468,32 +624,39 @@ paint_stage (ClutterStageCogl            *stage_cogl,
 }
 
 static void
-fill_current_damage_history_and_step (ClutterStageView *view)
+record_full_damage_history (ClutterStageView *view,
+                            cairo_region_t  **fb_damage)
 {
-  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
-  ClutterStageViewCoglPrivate *view_priv =
-    clutter_stage_view_cogl_get_instance_private (view_cogl);
   cairo_rectangle_int_t view_rect;
   float fb_scale;
-  cairo_rectangle_int_t *current_fb_damage;
 
-  current_fb_damage =
-    &view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index)];
   clutter_stage_view_get_layout (view, &view_rect);
   fb_scale = clutter_stage_view_get_scale (view);
 
-  *current_fb_damage = (cairo_rectangle_int_t) {
+  g_clear_pointer (fb_damage, cairo_region_destroy);
+  *fb_damage = cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
     .x = 0,
     .y = 0,
     .width = view_rect.width * fb_scale,
     .height = view_rect.height * fb_scale
-  };
+  });
+}
+
+static void
+fill_current_damage_history_and_step (ClutterStageView *view)
+{
+  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+
+  record_full_damage_history (view,
+    &view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index)]);
   view_priv->damage_index++;
 }
 
 static void
-transform_swap_region_to_onscreen (ClutterStageView      *view,
-                                   cairo_rectangle_int_t *swap_region)
+transform_swap_rect_to_onscreen (ClutterStageView      *view,
+                                 cairo_rectangle_int_t *swap_rect)
 {
   CoglFramebuffer *framebuffer;
   cairo_rectangle_int_t layout;
@@ -503,10 +666,10 @@ transform_swap_region_to_onscreen (ClutterStageView      *view,
   framebuffer = clutter_stage_view_get_onscreen (view);
   clutter_stage_view_get_layout (view, &layout);
 
-  x1 = (float) swap_region->x / layout.width;
-  y1 = (float) swap_region->y / layout.height;
-  x2 = (float) (swap_region->x + swap_region->width) / layout.width;
-  y2 = (float) (swap_region->y + swap_region->height) / layout.height;
+  x1 = (float) swap_rect->x / layout.width;
+  y1 = (float) swap_rect->y / layout.height;
+  x2 = (float) (swap_rect->x + swap_rect->width) / layout.width;
+  y2 = (float) (swap_rect->y + swap_rect->height) / layout.height;
 
   clutter_stage_view_transform_to_onscreen (view, &x1, &y1);
   clutter_stage_view_transform_to_onscreen (view, &x2, &y2);
@@ -519,7 +682,7 @@ transform_swap_region_to_onscreen (ClutterStageView      *view,
   x2 = ceil (x2 * width);
   y2 = ceil (height - (y2 * height));
 
-  *swap_region = (cairo_rectangle_int_t) {
+  *swap_rect = (cairo_rectangle_int_t) {
     .x = x1,
     .y = y1,
     .width = x2 - x1,
@@ -527,6 +690,28 @@ transform_swap_region_to_onscreen (ClutterStageView      *view,
   };
 }
 
+static cairo_region_t *
+transform_swap_region_to_onscreen (ClutterStageView     *view,
+                                   const cairo_region_t *swap_region)
+{
+  cairo_region_t *transformed_region;
+  int n_rects, i;
+
+  transformed_region = cairo_region_create ();
+
+  n_rects = cairo_region_num_rectangles (swap_region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (swap_region, i, &rect);
+      transform_swap_rect_to_onscreen (view, &rect);
+      cairo_region_union_rectangle (transformed_region, &rect);
+    }
+
+  return transformed_region;
+}
+
 static void
 calculate_scissor_region (cairo_rectangle_int_t *fb_clip_region,
                           int                    subpixel_compensation,
@@ -561,6 +746,264 @@ calculate_scissor_region (cairo_rectangle_int_t *fb_clip_region,
   };
 }
 
+static cairo_region_t *
+stage_region_to_fb_region (const cairo_region_t        *stage_region,
+                           const cairo_rectangle_int_t *view_rect,
+                           float                        fb_scale,
+                           int                          subpixel_compensation)
+{
+  cairo_region_t *fb_region;
+  int n_rects, i;
+
+  fb_region = cairo_region_create ();
+
+  n_rects = cairo_region_num_rectangles (stage_region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (stage_region, i, &rect);
+      cairo_region_union_rectangle (fb_region,
+                                    &(cairo_rectangle_int_t) {
+                                      .x = (floorf ((rect.x - view_rect->x) * fb_scale) -
+                                            subpixel_compensation),
+                                      .y = (floorf ((rect.y - view_rect->y) * fb_scale) -
+                                            subpixel_compensation),
+                                      .width = (ceilf (rect.width * fb_scale) +
+                                                (2 * subpixel_compensation)),
+                                      .height = (ceilf (rect.height * fb_scale) +
+                                                 (2 * subpixel_compensation))
+                                    });
+    }
+
+  return fb_region;
+}
+
+/* Decides which rectangles of the framebuffer clip region get their
+ * own paint pass. Every pass walks the whole scene graph, so a region
+ * made of many rectangles, or one that covers most of its extents
+ * anyway, is painted as its bounding box instead.
+ */
+static cairo_region_t *
+get_fb_paint_region (const cairo_region_t *fb_clip_region)
+{
+  cairo_rectangle_int_t extents;
+  gint64 area = 0;
+  int n_rects, i;
+
+  n_rects = cairo_region_num_rectangles (fb_clip_region);
+  if (n_rects <= 1)
+    return cairo_region_copy (fb_clip_region);
+
+  cairo_region_get_extents (fb_clip_region, &extents);
+
+  if (n_rects <= MAX_REDRAW_CLIP_RECTS)
+    {
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+
+          cairo_region_get_rectangle (fb_clip_region, i, &rect);
+          area += (gint64) rect.width * rect.height;
+        }
+
+      if (area < REDRAW_CLIP_MERGE_RATIO * ((gint64) extents.width * extents.height))
+        return cairo_region_copy (fb_clip_region);
+    }
+
+  CLUTTER_NOTE (CLIPPING, "Merging %d redraw clip rectangles into one\n",
+                n_rects);
+
+  return cairo_region_create_rectangle (&extents);
+}
+
+static void
+paint_stage_region (ClutterStageCogl     *stage_cogl,
+                    ClutterStageView     *view,
+                    const cairo_region_t *fb_paint_region,
+                    int                   subpixel_compensation)
+{
+  CoglFramebuffer *fb = clutter_stage_view_get_framebuffer (view);
+  cairo_rectangle_int_t view_rect;
+  float fb_scale;
+  int fb_width, fb_height;
+  int n_rects, i;
+
+  clutter_stage_view_get_layout (view, &view_rect);
+  fb_scale = clutter_stage_view_get_scale (view);
+  fb_width = cogl_framebuffer_get_width (fb);
+  fb_height = cogl_framebuffer_get_height (fb);
+
+  n_rects = cairo_region_num_rectangles (fb_paint_region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t fb_rect;
+      cairo_rectangle_int_t scissor_rect;
+
+      cairo_region_get_rectangle (fb_paint_region, i, &fb_rect);
+      calculate_scissor_region (&fb_rect,
+                                subpixel_compensation,
+                                fb_width, fb_height,
+                                &scissor_rect);
+
+      CLUTTER_NOTE (CLIPPING,
+                    "Stage clip pushed: x=%d, y=%d, width=%d, height=%d\n",
+                    scissor_rect.x,
+                    scissor_rect.y,
+                    scissor_rect.width,
+                    scissor_rect.height);
+
+      stage_cogl->current_redraw_clip = (cairo_rectangle_int_t) {
+        .x = view_rect.x + floorf (fb_rect.x / fb_scale),
+        .y = view_rect.y + floorf (fb_rect.y / fb_scale),
+        .width = ceilf (fb_rect.width / fb_scale),
+        .height = ceilf (fb_rect.height / fb_scale)
+      };
+
+      cogl_framebuffer_push_scissor_clip (fb,
+                                          scissor_rect.x,
+                                          scissor_rect.y,
+                                          scissor_rect.width,
+                                          scissor_rect.height);
+      paint_stage (stage_cogl, view, &stage_cogl->current_redraw_clip);
+      cogl_framebuffer_pop_clip (fb);
+    }
+}
+
+static void
+ensure_color_pipeline (ClutterStageView *view)
+{
+  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+  CoglFramebuffer *fb = clutter_stage_view_get_onscreen (view);
+  CoglContext *ctx = cogl_framebuffer_get_context (fb);
+  int fb_width = cogl_framebuffer_get_width (fb);
+  int fb_height = cogl_framebuffer_get_height (fb);
+  CoglSnippet *snippet;
+
+  if (view_priv->color_texture &&
+      cogl_texture_get_width (view_priv->color_texture) == fb_width &&
+      cogl_texture_get_height (view_priv->color_texture) == fb_height)
+    return;
+
+  g_clear_pointer (&view_priv->color_texture, cogl_object_unref);
+  g_clear_pointer (&view_priv->color_pipeline, cogl_object_unref);
+
+  view_priv->color_texture =
+    cogl_texture_2d_new_with_size (ctx, fb_width, fb_height);
+  /* GLES can't copy a framebuffer without alpha into one with it */
+  cogl_texture_set_components (view_priv->color_texture,
+                               COGL_TEXTURE_COMPONENTS_RGB);
+
+  view_priv->color_pipeline = cogl_pipeline_new (ctx);
+  cogl_pipeline_set_layer_texture (view_priv->color_pipeline, 0,
+                                   view_priv->color_texture);
+  cogl_pipeline_set_layer_filters (view_priv->color_pipeline, 0,
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+  cogl_pipeline_set_blend (view_priv->color_pipeline,
+                           "RGBA = ADD (SRC_COLOR, 0)", NULL);
+
+  snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_FRAGMENT,
+                              "uniform mat4 color_transform;\n",
+                              "cogl_color_out.rgb =\n"
+                              "  (color_transform *\n"
+                              "   vec4 (cogl_color_out.rgb, 1.0)).rgb;\n");
+  cogl_pipeline_add_snippet (view_priv->color_pipeline, snippet);
+  cogl_object_unref (snippet);
+
+  view_priv->color_transform_location =
+    cogl_pipeline_get_uniform_location (view_priv->color_pipeline,
+                                        "color_transform");
+}
+
+/* Runs the colour transform as a single pass over the part of the
+ * view that was just painted: @fb_paint_region, or the whole view when
+ * it is NULL. The pixels go through a texture as a fragment shader
+ * can't read the framebuffer it draws to; the rest of the back buffer
+ * was transformed by the frames that painted it. A view painted
+ * through an offscreen has been blitted already, so the pass always
+ * works on the onscreen framebuffer.
+ */
+static void
+apply_color_transform (ClutterStageView     *view,
+                       const CoglMatrix     *transform,
+                       const cairo_region_t *fb_paint_region)
+{
+  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+  CoglFramebuffer *fb = clutter_stage_view_get_onscreen (view);
+  int fb_width = cogl_framebuffer_get_width (fb);
+  int fb_height = cogl_framebuffer_get_height (fb);
+  cairo_region_t *region;
+  CoglMatrix projection;
+  int n_rects, i;
+
+  ensure_color_pipeline (view);
+
+  cogl_pipeline_set_uniform_matrix (view_priv->color_pipeline,
+                                    view_priv->color_transform_location,
+                                    4, 1, FALSE,
+                                    cogl_matrix_get_array (transform));
+
+  if (fb_paint_region)
+    region = cairo_region_copy (fb_paint_region);
+  else
+    region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+      .width = fb_width,
+      .height = fb_height
+    });
+
+  /* Each rectangle goes to the same place in the texture, which
+   * mirrors the framebuffer. They don't overlap, so all of them can be
+   * copied before any is drawn back */
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      cogl_framebuffer_copy_to_texture (fb, view_priv->color_texture,
+                                        rect.x, rect.y,
+                                        rect.x,
+                                        fb_height - rect.y - rect.height,
+                                        rect.width, rect.height);
+    }
+
+  cogl_framebuffer_get_projection_matrix (fb, &projection);
+  cogl_framebuffer_push_matrix (fb);
+  cogl_framebuffer_identity_matrix (fb);
+  cogl_framebuffer_orthographic (fb, 0, 0, fb_width, fb_height, -1, 1);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      float t_1, t_2;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      /* The copies are upside down */
+      t_1 = 1.0f - (float) rect.y / fb_height;
+      t_2 = 1.0f - (float) (rect.y + rect.height) / fb_height;
+
+      cogl_framebuffer_draw_textured_rectangle (fb, view_priv->color_pipeline,
+                                                rect.x, rect.y,
+                                                rect.x + rect.width,
+                                                rect.y + rect.height,
+                                                (float) rect.x / fb_width,
+                                                t_1,
+                                                (float) (rect.x + rect.width) / fb_width,
+                                                t_2);
+    }
+
+  cogl_framebuffer_pop_matrix (fb);
+  cogl_framebuffer_set_projection_matrix (fb, &projection);
+
+  cairo_region_destroy (region);
+}
+
 static gboolean
 clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
                                 ClutterStageView   *view)
@@ -578,21 +1021,21 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
   gboolean has_buffer_age;
   gboolean do_swap_buffer;
   gboolean swap_with_damage;
+  gboolean swap_event = FALSE;
   ClutterActor *wrapper;
-  cairo_rectangle_int_t redraw_clip;
-  cairo_rectangle_int_t swap_region;
-  cairo_rectangle_int_t fb_clip_region;
+  cairo_region_t *redraw_clip = NULL;
+  cairo_region_t *fb_clip_region;
+  cairo_region_t *fb_paint_region = NULL;
+  cairo_region_t *swap_region = NULL;
   gboolean clip_region_empty;
+  const CoglMatrix *color_transform;
   float fb_scale;
   int subpixel_compensation = 0;
-  int fb_width, fb_height;
 
   wrapper = CLUTTER_ACTOR (stage_cogl->wrapper);
 
   clutter_stage_view_get_layout (view, &view_rect);
   fb_scale = clutter_stage_view_get_scale (view);
-  fb_width = cogl_framebuffer_get_width (fb);
-  fb_height = cogl_framebuffer_get_height (fb);
 
   can_blit_sub_buffer =
     cogl_is_onscreen (fb) &&
@@ -602,20 +1045,18 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
     cogl_is_onscreen (fb) &&
     cogl_clutter_winsys_has_feature (COGL_WINSYS_FEATURE_BUFFER_AGE);
 
-  /* NB: a zero width redraw clip == full stage redraw */
-  if (stage_cogl->bounding_redraw_clip.width == 0)
+  /* NB: a zero width bounding redraw clip == full stage redraw */
+  if (!stage_cogl->initialized_redraw_clip ||
+      stage_cogl->bounding_redraw_clip.width == 0)
     have_clip = FALSE;
   else
     {
-      redraw_clip = stage_cogl->bounding_redraw_clip;
-      _clutter_util_rectangle_intersection (&redraw_clip,
-                                            &view_rect,
-                                            &redraw_clip);
-
-      have_clip = !(redraw_clip.x == view_rect.x &&
-                    redraw_clip.y == view_rect.y &&
-                    redraw_clip.width == view_rect.width &&
-                    redraw_clip.height == view_rect.height);
+      redraw_clip = g_steal_pointer (&view_priv->redraw_clip);
+      if (!redraw_clip)
+        redraw_clip = cairo_region_create ();
+
+      have_clip = (cairo_region_contains_rectangle (redraw_clip, &view_rect) !=
+                   CAIRO_REGION_OVERLAP_IN);
     }
 
   may_use_clipped_redraw = FALSE;
@@ -631,20 +1072,14 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
       if (fb_scale != floorf (fb_scale))
         subpixel_compensation = ceilf (fb_scale);
 
-      fb_clip_region = (cairo_rectangle_int_t) {
-        .x = (floorf ((redraw_clip.x - view_rect.x) * fb_scale) -
-              subpixel_compensation),
-        .y = (floorf ((redraw_clip.y - view_rect.y) * fb_scale) -
-              subpixel_compensation),
-        .width = (ceilf (redraw_clip.width * fb_scale) +
-                  (2 * subpixel_compensation)),
-        .height = (ceilf (redraw_clip.height * fb_scale) +
-                   (2 * subpixel_compensation))
-      };
+      fb_clip_region = stage_region_to_fb_region (redraw_clip,
+                                                  &view_rect,
+                                                  fb_scale,
+                                                  subpixel_compensation);
     }
   else
     {
-      fb_clip_region = (cairo_rectangle_int_t) { 0 };
+      fb_clip_region = cairo_region_create ();
     }
 
   if (may_use_clipped_redraw &&
@@ -653,7 +1088,8 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
   else
     use_clipped_redraw = FALSE;
 
-  clip_region_empty = may_use_clipped_redraw && fb_clip_region.width == 0;
+  clip_region_empty = may_use_clipped_redraw &&
+                      cairo_region_is_empty (fb_clip_region);
 
   swap_with_damage = FALSE;
   if (has_buffer_age)
@@ -661,47 +1097,37 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
       if (use_clipped_redraw && !clip_region_empty)
         {
           int age, i;
-          cairo_rectangle_int_t *current_fb_damage =
+          cairo_region_t **current_fb_damage =
             &view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index++)];
 
           age = cogl_onscreen_get_buffer_age (COGL_ONSCREEN (fb));
 
           if (valid_buffer_age (view_cogl, age))
             {
-              cairo_rectangle_int_t damage_region;
+              cairo_rectangle_int_t fb_clip_extents;
 
               if (age > stage_cogl->max_buffer_age)
                 stage_cogl->max_buffer_age = age;
 
-              *current_fb_damage = fb_clip_region;
+              g_clear_pointer (current_fb_damage, cairo_region_destroy);
+              *current_fb_damage = cairo_region_copy (fb_clip_region);
 
               for (i = 1; i <= age; i++)
                 {
-                  cairo_rectangle_int_t *fb_damage =
-                    &view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index - i - 1)];
+                  cairo_region_t *fb_damage =
+                    view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index - i - 1)];
 
-                  _clutter_util_rectangle_union (&fb_clip_region,
-                                                 fb_damage,
-                                                 &fb_clip_region);
+                  cairo_region_union (fb_clip_region, fb_damage);
                 }
 
-              /* Update the bounding redraw clip state with the extra damage. */
-              damage_region = (cairo_rectangle_int_t) {
-                .x = view_rect.x + floorf (fb_clip_region.x / fb_scale),
-                .y = view_rect.y + floorf (fb_clip_region.y / fb_scale),
-                .width = ceilf (fb_clip_region.width / fb_scale),
-                .height = ceilf (fb_clip_region.height / fb_scale)
-              };
-              _clutter_util_rectangle_union (&stage_cogl->bounding_redraw_clip,
-                                             &damage_region,
-                                             &stage_cogl->bounding_redraw_clip);
-
-              CLUTTER_NOTE (CLIPPING, "Reusing back buffer(age=%d) - repairing region: x=%d, y=%d, width=%d, height=%d\n",
+              cairo_region_get_extents (fb_clip_region, &fb_clip_extents);
+              CLUTTER_NOTE (CLIPPING, "Reusing back buffer(age=%d) - repairing %d rectangles: x=%d, y=%d, width=%d, height=%d\n",
                             age,
-                            fb_clip_region.x,
-                            fb_clip_region.y,
-                            fb_clip_region.width,
-                            fb_clip_region.height);
+                            cairo_region_num_rectangles (fb_clip_region),
+                            fb_clip_extents.x,
+                            fb_clip_extents.y,
+                            fb_clip_extents.width,
+                            fb_clip_extents.height);
 
               swap_with_damage = TRUE;
             }
@@ -709,12 +1135,7 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
             {
               CLUTTER_NOTE (CLIPPING, "Invalid back buffer(age=%d): forcing full redraw\n", age);
               use_clipped_redraw = FALSE;
-              *current_fb_damage = (cairo_rectangle_int_t) {
-                .x = 0,
-                .y = 0,
-                .width = view_rect.width * fb_scale,
-                .height = view_rect.height * fb_scale
-              };
+              record_full_damage_history (view, current_fb_damage);
             }
         }
       else if (!use_clipped_redraw)
@@ -723,6 +1144,18 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
         }
     }
 
+  if (may_use_clipped_redraw && !clip_region_empty)
+    fb_paint_region = get_fb_paint_region (fb_clip_region);
+
+  /* When the old contents of the back buffer are reused, tell the
+   * driver up front which rectangles get repainted so that tile based
+   * GPUs don't have to load and resolve the rest of it */
+  if (swap_with_damage && use_clipped_redraw &&
+      cogl_clutter_winsys_has_feature (COGL_WINSYS_FEATURE_PARTIAL_UPDATE))
+    queue_damage_region (COGL_ONSCREEN (fb), fb_paint_region);
+
+  CLUTTER_TRACE1 (paint_start, use_clipped_redraw);
+
   cogl_push_framebuffer (fb);
   if (use_clipped_redraw && clip_region_empty)
     {
@@ -730,36 +1163,10 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
     }
   else if (use_clipped_redraw)
     {
-      cairo_rectangle_int_t scissor_rect;
-
-      calculate_scissor_region (&fb_clip_region,
-                                subpixel_compensation,
-                                fb_width, fb_height,
-                                &scissor_rect);
-
-      CLUTTER_NOTE (CLIPPING,
-                    "Stage clip pushed: x=%d, y=%d, width=%d, height=%d\n",
-                    scissor_rect.x,
-                    scissor_rect.y,
-                    scissor_rect.width,
-                    scissor_rect.height);
-
       stage_cogl->using_clipped_redraw = TRUE;
-
-      cogl_framebuffer_push_scissor_clip (fb,
-                                          scissor_rect.x,
-                                          scissor_rect.y,
-                                          scissor_rect.width,
-                                          scissor_rect.height);
-      paint_stage (stage_cogl, view,
-                   &(cairo_rectangle_int_t) {
-                     .x = view_rect.x + floorf ((fb_clip_region.x - 0) / fb_scale),
-                     .y = view_rect.y + floorf ((fb_clip_region.y - 0) / fb_scale),
-                     .width = ceilf ((fb_clip_region.width + 0) / fb_scale),
-                     .height = ceilf ((fb_clip_region.height + 0) / fb_scale)
-                   });
-      cogl_framebuffer_pop_clip (fb);
-
+      paint_stage_region (stage_cogl, view,
+                          fb_paint_region,
+                          subpixel_compensation);
       stage_cogl->using_clipped_redraw = FALSE;
     }
   else
@@ -767,55 +1174,59 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
       CLUTTER_NOTE (CLIPPING, "Unclipped stage paint\n");
 
       /* If we are trying to debug redraw issues then we want to pass
-       * the bounding_redraw_clip so it can be visualized */
+       * the redraw clip region so it can be visualized */
       if (G_UNLIKELY (clutter_paint_debug_flags & CLUTTER_DEBUG_DISABLE_CLIPPED_REDRAWS) &&
           may_use_clipped_redraw &&
           !clip_region_empty)
         {
-          cairo_rectangle_int_t scissor_rect;
-
-          calculate_scissor_region (&fb_clip_region,
-                                    subpixel_compensation,
-                                    fb_width, fb_height,
-                                    &scissor_rect);
-
-          cogl_framebuffer_push_scissor_clip (fb,
-                                              scissor_rect.x,
-                                              scissor_rect.y,
-                                              scissor_rect.width,
-                                              scissor_rect.height);
-          paint_stage (stage_cogl, view,
-                       &(cairo_rectangle_int_t) {
-                         .x = view_rect.x + floorf (fb_clip_region.x / fb_scale),
-                         .y = view_rect.y + floorf (fb_clip_region.y / fb_scale),
-                         .width = ceilf (fb_clip_region.width / fb_scale),
-                         .height = ceilf (fb_clip_region.height / fb_scale)
-                       });
-          cogl_framebuffer_pop_clip (fb);
+          paint_stage_region (stage_cogl, view,
+                              fb_paint_region,
+                              subpixel_compensation);
         }
       else
         paint_stage (stage_cogl, view, &view_rect);
     }
   cogl_pop_framebuffer ();
 
+  CLUTTER_TRACE (paint_end);
+
+  if (!(use_clipped_redraw && clip_region_empty))
+    {
+      /* Handlers of after-paint can read back what was just drawn: the
+       * view's framebuffer is the draw framebuffer for the emission and
+       * clutter_stage_get_redraw_clip_bounds() gives the bounds of the
+       * part of the view that changed */
+      if (use_clipped_redraw)
+        {
+          cairo_rectangle_int_t clip_extents;
+
+          cairo_region_get_extents (redraw_clip, &clip_extents);
+          _clutter_util_rectangle_intersection (&clip_extents, &view_rect,
+                                                &stage_cogl->current_redraw_clip);
+          stage_cogl->using_clipped_redraw = TRUE;
+        }
+
+      cogl_push_framebuffer (fb);
+      _clutter_stage_emit_after_paint (stage_cogl->wrapper);
+      cogl_pop_framebuffer ();
+
+      stage_cogl->using_clipped_redraw = FALSE;
+
+      color_transform =
+        _clutter_stage_get_color_transform (stage_cogl->wrapper);
+      if (color_transform)
+        apply_color_transform (view, color_transform,
+                               use_clipped_redraw ? fb_paint_region : NULL);
+    }
+
   if (may_use_clipped_redraw &&
       G_UNLIKELY ((clutter_paint_debug_flags & CLUTTER_DEBUG_REDRAWS)))
     {
       CoglContext *ctx = cogl_framebuffer_get_context (fb);
       static CoglPipeline *outline = NULL;
       ClutterActor *actor = CLUTTER_ACTOR (wrapper);
-      float x_1 = redraw_clip.x;
-      float x_2 = redraw_clip.x + redraw_clip.width;
-      float y_1 = redraw_clip.y;
-      float y_2 = redraw_clip.y + redraw_clip.height;
-      CoglVertexP2 quad[4] = {
-        { x_1, y_1 },
-        { x_2, y_1 },
-        { x_2, y_2 },
-        { x_1, y_2 }
-      };
-      CoglPrimitive *prim;
       CoglMatrix modelview;
+      int n_rects, i;
 
       if (outline == NULL)
         {
@@ -823,18 +1234,41 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
           cogl_pipeline_set_color4ub (outline, 0xff, 0x00, 0x00, 0xff);
         }
 
-      prim = cogl_primitive_new_p2 (ctx,
-                                    COGL_VERTICES_MODE_LINE_LOOP,
-                                    4, /* n_vertices */
-                                    quad);
-
       cogl_framebuffer_push_matrix (fb);
       cogl_matrix_init_identity (&modelview);
       _clutter_actor_apply_modelview_transform (actor, &modelview);
       cogl_framebuffer_set_modelview_matrix (fb, &modelview);
-      cogl_framebuffer_draw_primitive (fb, outline, prim);
+
+      n_rects = cairo_region_num_rectangles (redraw_clip);
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+          CoglPrimitive *prim;
+
+          cairo_region_get_rectangle (redraw_clip, i, &rect);
+
+          {
+            float x_1 = rect.x;
+            float x_2 = rect.x + rect.width;
+            float y_1 = rect.y;
+            float y_2 = rect.y + rect.height;
+            CoglVertexP2 quad[4] = {
+              { x_1, y_1 },
+              { x_2, y_1 },
+              { x_2, y_2 },
+              { x_1, y_2 }
+            };
+
+            prim = cogl_primitive_new_p2 (ctx,
+                                          COGL_VERTICES_MODE_LINE_LOOP,
+                                          4, /* n_vertices */
+                                          quad);
+          }
+          cogl_framebuffer_draw_primitive (fb, outline, prim);
+          cogl_object_unref (prim);
+        }
+
       cogl_framebuffer_pop_matrix (fb);
-      cogl_object_unref (prim);
     }
 
   /* XXX: It seems there will be a race here in that the stage
@@ -847,30 +1281,20 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
    */
   if (use_clipped_redraw)
     {
-      if (use_clipped_redraw && clip_region_empty)
+      if (clip_region_empty)
         {
           do_swap_buffer = FALSE;
         }
-      else if (use_clipped_redraw)
-        {
-          swap_region = fb_clip_region;
-          g_assert (swap_region.width > 0);
-          do_swap_buffer = TRUE;
-        }
       else
         {
-          swap_region = (cairo_rectangle_int_t) {
-            .x = 0,
-            .y = 0,
-            .width = view_rect.width * fb_scale,
-            .height = view_rect.height * fb_scale,
-          };
+          swap_region = cairo_region_reference (fb_paint_region);
+          g_assert (!cairo_region_is_empty (swap_region));
           do_swap_buffer = TRUE;
         }
     }
   else
     {
-      swap_region = (cairo_rectangle_int_t) { 0 };
+      swap_region = cairo_region_create ();
       do_swap_buffer = TRUE;
     }
 
@@ -879,17 +1303,142 @@ clutter_stage_cogl_redraw_view (ClutterStageWindow *stage_window,
       if (clutter_stage_view_get_onscreen (view) !=
           clutter_stage_view_get_framebuffer (view))
         {
-          transform_swap_region_to_onscreen (view, &swap_region);
+          cairo_region_t *transformed_swap_region;
+
+          transformed_swap_region =
+            transform_swap_region_to_onscreen (view, swap_region);
+          cairo_region_destroy (swap_region);
+          swap_region = transformed_swap_region;
         }
 
-      return swap_framebuffer (stage_window,
-                               view,
-                               &swap_region,
-                               swap_with_damage);
+      CLUTTER_TRACE1 (swap_start, cairo_region_num_rectangles (swap_region));
+
+      swap_event = swap_framebuffer (stage_window,
+                                     view,
+                                     swap_region,
+                                     swap_with_damage);
+
+      CLUTTER_TRACE (swap_end);
     }
-  else
+
+  g_clear_pointer (&redraw_clip, cairo_region_destroy);
+  g_clear_pointer (&fb_clip_region, cairo_region_destroy);
+  g_clear_pointer (&fb_paint_region, cairo_region_destroy);
+  g_clear_pointer (&swap_region, cairo_region_destroy);
+
+  return swap_event;
+}
+
+/* The GPU time reported by CLUTTER_PAINT=gpu-timings is summed up by
+ * section name and printed every GPU_TIMINGS_PERIOD */
+#define GPU_TIMINGS_PERIOD (10 * G_USEC_PER_SEC)
+
+typedef struct
+{
+  guint  n_sections;
+  gint64 total_ns;
+  gint64 max_ns;
+} GpuTiming;
+
+static struct
+{
+  gint64      period_start;
+  guint       n_frames;
+  GHashTable *sections;
+} gpu_timings;
+
+static void
+add_gpu_timing (const char *name,
+                int         depth,
+                int64_t     elapsed_ns,
+                void       *user_data)
+{
+  GpuTiming *timing = g_hash_table_lookup (gpu_timings.sections, name);
+
+  if (timing == NULL)
     {
-      return FALSE;
+      timing = g_new0 (GpuTiming, 1);
+      g_hash_table_insert (gpu_timings.sections, (gpointer) name, timing);
+    }
+
+  timing->n_sections++;
+  timing->total_ns += elapsed_ns;
+  timing->max_ns = MAX (timing->max_ns, elapsed_ns);
+}
+
+static gint
+compare_gpu_timing_totals (gconstpointer a,
+                           gconstpointer b)
+{
+  const GpuTiming *timing_a = g_hash_table_lookup (gpu_timings.sections, a);
+  const GpuTiming *timing_b = g_hash_table_lookup (gpu_timings.sections, b);
+
+  if (timing_a->total_ns == timing_b->total_ns)
+    return 0;
+
+  return timing_a->total_ns > timing_b->total_ns ? -1 : 1;
+}
+
+static void
+print_gpu_timings (double seconds)
+{
+  GList *names, *l;
+
+  names = g_hash_table_get_keys (gpu_timings.sections);
+  names = g_list_sort (names, compare_gpu_timing_totals);
+
+  g_printerr ("GPU time over the last %.1fs (%u frames):\n",
+              seconds, gpu_timings.n_frames);
+
+  for (l = names; l != NULL; l = l->next)
+    {
+      const GpuTiming *timing = g_hash_table_lookup (gpu_timings.sections,
+                                                     l->data);
+
+      g_printerr ("  %-32s %8.3f ms/frame  mean %7.3f ms  max %7.3f ms"
+                  "  (%u)\n",
+                  (const char *) l->data,
+                  timing->total_ns / 1e6 / MAX (gpu_timings.n_frames, 1),
+                  timing->total_ns / 1e6 / timing->n_sections,
+                  timing->max_ns / 1e6,
+                  timing->n_sections);
+    }
+
+  g_list_free (names);
+}
+
+/* The results come in a frame or two after they were recorded, once
+ * the GPU is done with them */
+static void
+clutter_stage_cogl_collect_gpu_timings (ClutterStageCogl *stage_cogl)
+{
+  CoglContext *context =
+    clutter_backend_get_cogl_context (stage_cogl->backend);
+  gint64 now = g_get_monotonic_time ();
+
+  if (gpu_timings.sections == NULL)
+    {
+      if (!cogl_gpu_timer_is_supported (context))
+        g_warning ("CLUTTER_PAINT=gpu-timings needs timestamp queries, "
+                   "which the GL driver doesn't support");
+
+      gpu_timings.sections = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                    NULL, g_free);
+      gpu_timings.period_start = now;
+    }
+
+  gpu_timings.n_frames++;
+
+  cogl_gpu_timer_collect (context, add_gpu_timing, NULL);
+
+  if (now - gpu_timings.period_start >= GPU_TIMINGS_PERIOD)
+    {
+      print_gpu_timings ((now - gpu_timings.period_start) /
+                         (double) G_USEC_PER_SEC);
+
+      g_hash_table_remove_all (gpu_timings.sections);
+      gpu_timings.n_frames = 0;
+      gpu_timings.period_start = now;
     }
 }
 
@@ -897,19 +1446,33 @@ static void
 clutter_stage_cogl_redraw (ClutterStageWindow *stage_window)
 {
   ClutterStageCogl *stage_cogl = CLUTTER_STAGE_COGL (stage_window);
+  gboolean gpu_timed =
+    G_UNLIKELY (clutter_paint_debug_flags & CLUTTER_DEBUG_GPU_TIMINGS);
   gboolean swap_event = FALSE;
   GList *l;
 
   for (l = _clutter_stage_window_get_views (stage_window); l; l = l->next)
     {
       ClutterStageView *view = l->data;
+      CoglFramebuffer *framebuffer = clutter_stage_view_get_framebuffer (view);
+
+      if (gpu_timed)
+        cogl_framebuffer_push_gpu_timer (framebuffer, "stage view");
 
       swap_event =
         clutter_stage_cogl_redraw_view (stage_window, view) || swap_event;
+
+      if (gpu_timed)
+        cogl_framebuffer_pop_gpu_timer (framebuffer);
     }
 
   _clutter_stage_window_finish_frame (stage_window);
 
+  if (gpu_timed)
+    clutter_stage_cogl_collect_gpu_timings (stage_cogl);
+
+  clutter_stage_cogl_record_frame (stage_cogl);
+
   if (swap_event)
     {
       /* If we have swap buffer events then cogl_onscreen_swap_buffers
@@ -921,6 +1484,7 @@ clutter_stage_cogl_redraw (ClutterStageWindow *stage_window)
 
   /* reset the redraw clipping for the next paint... */
   stage_cogl->initialized_redraw_clip = FALSE;
+  clutter_stage_cogl_clear_view_redraw_clips (stage_cogl);
 
   stage_cogl->frame_count++;
 }
@@ -963,11 +1527,15 @@ clutter_stage_cogl_get_dirty_pixel (ClutterStageWindow *stage_window,
       ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (view);
       ClutterStageViewCoglPrivate *view_priv =
         clutter_stage_view_cogl_get_instance_private (view_cogl);
-      cairo_rectangle_int_t *fb_damage;
+      cairo_region_t *fb_damage;
+      cairo_rectangle_int_t fb_damage_rect = { 0 };
+
+      fb_damage = view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index - 1)];
+      if (fb_damage && !cairo_region_is_empty (fb_damage))
+        cairo_region_get_rectangle (fb_damage, 0, &fb_damage_rect);
 
-      fb_damage = &view_priv->damage_history[DAMAGE_HISTORY (view_priv->damage_index - 1)];
-      *x = fb_damage->x / fb_scale;
-      *y = fb_damage->y / fb_scale;
+      *x = fb_damage_rect.x / fb_scale;
+      *y = fb_damage_rect.y / fb_scale;
     }
 }
 
@@ -983,6 +1551,7 @@ clutter_stage_window_iface_init (ClutterStageWindowIface *iface)
   iface->schedule_update = clutter_stage_cogl_schedule_update;
   iface->get_update_time = clutter_stage_cogl_get_update_time;
   iface->clear_update_time = clutter_stage_cogl_clear_update_time;
+  iface->get_refresh_rate = clutter_stage_cogl_get_refresh_rate;
   iface->add_redraw_clip = clutter_stage_cogl_add_redraw_clip;
   iface->has_redraw_clips = clutter_stage_cogl_has_redraw_clips;
   iface->ignoring_redraw_clips = clutter_stage_cogl_ignoring_redraw_clips;
@@ -1035,6 +1604,25 @@ _clutter_stage_cogl_init (ClutterStageCogl *stage)
   stage->update_time = -1;
 }
 
+static void
+clutter_stage_view_cogl_finalize (GObject *object)
+{
+  ClutterStageViewCogl *view_cogl = CLUTTER_STAGE_VIEW_COGL (object);
+  ClutterStageViewCoglPrivate *view_priv =
+    clutter_stage_view_cogl_get_instance_private (view_cogl);
+  int i;
+
+  g_clear_pointer (&view_priv->redraw_clip, cairo_region_destroy);
+
+  for (i = 0; i < DAMAGE_HISTORY_MAX; i++)
+    g_clear_pointer (&view_priv->damage_history[i], cairo_region_destroy);
+
+  g_clear_pointer (&view_priv->color_texture, cogl_object_unref);
+  g_clear_pointer (&view_priv->color_pipeline, cogl_object_unref);
+
+  G_OBJECT_CLASS (clutter_stage_view_cogl_parent_class)->finalize (object);
+}
+
 static void
 clutter_stage_view_cogl_init (ClutterStageViewCogl *view_cogl)
 {
@@ -1043,4 +1631,7 @@ clutter_stage_view_cogl_init (ClutterStageViewCogl *view_cogl)
 static void
 clutter_stage_view_cogl_class_init (ClutterStageViewCoglClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = clutter_stage_view_cogl_finalize;
 }
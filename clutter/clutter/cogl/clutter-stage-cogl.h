@@ -56,17 +56,32 @@ struct _ClutterStageCogl
   gint64 last_presentation_time;
   gint64 update_time;
 
+  /* When the pending update was requested, and how long the last
+   * frames took from the time they were due to the end of their swap;
+   * used to start frames as late as possible under SYNC_LATE_LATCHING */
+  gint64 schedule_time;
+#define CLUTTER_STAGE_COGL_FRAME_HISTORY_MAX 16
+  gint64 frame_durations[CLUTTER_STAGE_COGL_FRAME_HISTORY_MAX];
+  unsigned int frame_history_index;
+  unsigned int n_frame_durations;
+
   /* We only enable clipped redraws after 2 frames, since we've seen
    * a lot of drivers can struggle to get going and may output some
    * junk frames to start with. */
   unsigned int frame_count;
 
+  /* Bounding box of every redraw clip queued for the next frame; the
+   * individual rectangles are kept per view. A zero width means a full
+   * stage redraw has been queued. */
   cairo_rectangle_int_t bounding_redraw_clip;
 
+  /* The rectangle currently being painted during a clipped redraw */
+  cairo_rectangle_int_t current_redraw_clip;
+
   guint initialized_redraw_clip : 1;
 
   /* TRUE if the current paint cycle has a clipped redraw. In that
-     case bounding_redraw_clip specifies the the bounds. */
+     case current_redraw_clip specifies the the bounds. */
   guint using_clipped_redraw : 1;
 };
 
@@ -30,6 +30,7 @@
 #include <math.h>
 #include <float.h>
 #include <linux/input.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <errno.h>
@@ -38,6 +39,7 @@
 #include <unistd.h>
 
 #include <glib.h>
+#include <glib-unix.h>
 #include <libinput.h>
 
 #include "clutter-backend.h"
@@ -84,6 +86,18 @@ struct _ClutterDeviceManagerEvdevPrivate
 {
   struct libinput *libinput;
 
+  /* Serializes calls into libinput between the main thread and the
+   * input thread; recursive since event processing can end up in
+   * functions that take it themselves */
+  GRecMutex libinput_lock;
+
+  /* With CLUTTER_EVDEV_INPUT_THREAD set, a thread that reads the
+   * devices into libinput's event queue as soon as they have data and
+   * then writes to wakeup_fds[1] to have the main thread process them */
+  GThread *input_thread;
+  int wakeup_fds[2];
+  int quit_fds[2];
+
   ClutterStage *stage;
   gboolean released;
 
@@ -667,8 +681,20 @@ dispatch_libinput (ClutterDeviceManagerEvdev *manager_evdev)
 {
   ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
 
+  g_rec_mutex_lock (&priv->libinput_lock);
   libinput_dispatch (priv->libinput);
   process_events (manager_evdev);
+  g_rec_mutex_unlock (&priv->libinput_lock);
+}
+
+static void
+drain_wakeup_fd (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+  char buf[64];
+
+  while (read (priv->wakeup_fds[0], buf, sizeof (buf)) > 0)
+    ;
 }
 
 static gboolean
@@ -689,6 +715,13 @@ clutter_event_dispatch (GSource     *g_source,
   if (clutter_events_pending ())
     goto queue_event;
 
+  /* Only take the wakeup now: while the previous batch is still being
+   * handled, the pipe stays readable and brings us back here for what
+   * the input thread has queued in libinput meanwhile
+   */
+  if (manager_evdev->priv->input_thread != NULL)
+    drain_wakeup_fd (manager_evdev);
+
   dispatch_libinput (manager_evdev);
 
  queue_event:
@@ -744,7 +777,12 @@ clutter_event_source_new (ClutterDeviceManagerEvdev *manager_evdev)
   /* setup the source */
   event_source->manager_evdev = manager_evdev;
 
-  fd = libinput_get_fd (priv->libinput);
+  /* With an input thread, libinput is already read by the time the
+   * thread wakes us up */
+  if (priv->input_thread != NULL)
+    fd = priv->wakeup_fds[0];
+  else
+    fd = libinput_get_fd (priv->libinput);
   event_source->event_poll_fd.fd = fd;
   event_source->event_poll_fd.events = G_IO_IN;
 
@@ -1047,7 +1085,8 @@ input_device_update_tool (ClutterInputDevice          *input_device,
 
       if (!tool)
         {
-          tool = clutter_input_device_tool_evdev_new (libinput_tool,
+          tool = clutter_input_device_tool_evdev_new (CLUTTER_DEVICE_MANAGER_EVDEV (input_device->device_manager),
+                                                      libinput_tool,
                                                       tool_serial, tool_type);
           clutter_input_device_add_tool (input_device, tool);
         }
@@ -1795,11 +1834,132 @@ process_events (ClutterDeviceManagerEvdev *manager_evdev)
   ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
   struct libinput_event *event;
 
+  g_rec_mutex_lock (&priv->libinput_lock);
+
   while ((event = libinput_get_event (priv->libinput)))
     {
       process_event(manager_evdev, event);
       libinput_event_destroy(event);
     }
+
+  g_rec_mutex_unlock (&priv->libinput_lock);
+}
+
+/*
+ * The input thread
+ *
+ * Only libinput_dispatch() runs here: it empties the kernel buffers of
+ * the devices and queues the resulting events inside libinput, so that
+ * fast devices don't overflow them and lose events while the main
+ * thread is busy painting. The events are translated and constrained
+ * on the main thread as before, since that involves the seat state and
+ * application callbacks. Note that device hotplugging means
+ * libinput_dispatch() may call the open and close callbacks set with
+ * clutter_evdev_set_device_callbacks() from this thread.
+ */
+
+static gpointer
+input_thread_func (gpointer data)
+{
+  ClutterDeviceManagerEvdev *manager_evdev = data;
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+  struct pollfd fds[2];
+
+  fds[0].fd = libinput_get_fd (priv->libinput);
+  fds[0].events = POLLIN;
+  fds[1].fd = priv->quit_fds[0];
+  fds[1].events = POLLIN;
+
+  while (TRUE)
+    {
+      if (poll (fds, G_N_ELEMENTS (fds), -1) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          g_warning ("Failed to poll libinput: %s", g_strerror (errno));
+          break;
+        }
+
+      if (fds[1].revents)
+        break;
+
+      if (fds[0].revents & POLLIN)
+        {
+          g_rec_mutex_lock (&priv->libinput_lock);
+          libinput_dispatch (priv->libinput);
+          g_rec_mutex_unlock (&priv->libinput_lock);
+
+          /* A full pipe already has a wakeup pending */
+          if (write (priv->wakeup_fds[1], "", 1) < 0 && errno != EAGAIN)
+            g_warning ("Failed to wake up the main thread: %s",
+                       g_strerror (errno));
+        }
+    }
+
+  return NULL;
+}
+
+static gboolean
+start_input_thread (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+  GError *error = NULL;
+
+  if (!g_unix_open_pipe (priv->wakeup_fds, FD_CLOEXEC, &error))
+    goto fail;
+
+  if (!g_unix_set_fd_nonblocking (priv->wakeup_fds[0], TRUE, &error) ||
+      !g_unix_set_fd_nonblocking (priv->wakeup_fds[1], TRUE, &error) ||
+      !g_unix_open_pipe (priv->quit_fds, FD_CLOEXEC, &error))
+    {
+      close (priv->wakeup_fds[0]);
+      close (priv->wakeup_fds[1]);
+      goto fail;
+    }
+
+  priv->input_thread = g_thread_new ("clutter-evdev-input",
+                                     input_thread_func, manager_evdev);
+
+  return TRUE;
+
+ fail:
+  g_warning ("Failed to start the input thread: %s", error->message);
+  g_error_free (error);
+  return FALSE;
+}
+
+static void
+stop_input_thread (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  ClutterDeviceManagerEvdevPrivate *priv = manager_evdev->priv;
+
+  if (priv->input_thread == NULL)
+    return;
+
+  if (write (priv->quit_fds[1], "", 1) < 0)
+    g_warning ("Failed to stop the input thread: %s", g_strerror (errno));
+
+  g_thread_join (priv->input_thread);
+  priv->input_thread = NULL;
+
+  close (priv->quit_fds[0]);
+  close (priv->quit_fds[1]);
+
+  /* The read end is closed along with the event source */
+  close (priv->wakeup_fds[1]);
+}
+
+void
+_clutter_device_manager_evdev_lock_libinput (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  g_rec_mutex_lock (&manager_evdev->priv->libinput_lock);
+}
+
+void
+_clutter_device_manager_evdev_unlock_libinput (ClutterDeviceManagerEvdev *manager_evdev)
+{
+  g_rec_mutex_unlock (&manager_evdev->priv->libinput_lock);
 }
 
 static int
@@ -1968,6 +2128,9 @@ clutter_device_manager_evdev_constructed (GObject *gobject)
 
   dispatch_libinput (manager_evdev);
 
+  if (g_getenv ("CLUTTER_EVDEV_INPUT_THREAD"))
+    start_input_thread (manager_evdev);
+
   source = clutter_event_source_new (manager_evdev);
   priv->event_source = source;
 }
@@ -2019,6 +2182,8 @@ clutter_device_manager_evdev_finalize (GObject *object)
   if (priv->keymap)
     xkb_keymap_unref (priv->keymap);
 
+  stop_input_thread (manager_evdev);
+
   if (priv->event_source != NULL)
     clutter_event_source_free (priv->event_source);
 
@@ -2030,6 +2195,8 @@ clutter_device_manager_evdev_finalize (GObject *object)
 
   g_list_free (priv->free_device_ids);
 
+  g_rec_mutex_clear (&priv->libinput_lock);
+
   G_OBJECT_CLASS (clutter_device_manager_evdev_parent_class)->finalize (object);
 }
 
@@ -2113,6 +2280,8 @@ clutter_device_manager_evdev_init (ClutterDeviceManagerEvdev *self)
 
   priv = self->priv = clutter_device_manager_evdev_get_instance_private (self);
 
+  g_rec_mutex_init (&priv->libinput_lock);
+
   priv->stage_manager = clutter_stage_manager_get_default ();
   g_object_ref (priv->stage_manager);
 
@@ -2260,8 +2429,10 @@ clutter_evdev_release_devices (void)
       return;
     }
 
+  g_rec_mutex_lock (&priv->libinput_lock);
   libinput_suspend (priv->libinput);
   process_events (manager_evdev);
+  g_rec_mutex_unlock (&priv->libinput_lock);
 
   priv->released = TRUE;
 }
@@ -2331,9 +2502,11 @@ clutter_evdev_reclaim_devices (void)
       return;
     }
 
+  g_rec_mutex_lock (&priv->libinput_lock);
   libinput_resume (priv->libinput);
   clutter_evdev_update_xkb_state (manager_evdev);
   process_events (manager_evdev);
+  g_rec_mutex_unlock (&priv->libinput_lock);
 
   priv->released = FALSE;
 }
@@ -2351,6 +2524,10 @@ clutter_evdev_reclaim_devices (void)
  *
  * Setting @callback to %NULL will reset the default behavior.
  *
+ * If the CLUTTER_EVDEV_INPUT_THREAD environment variable is set,
+ * devices are read on a separate thread and the callbacks for devices
+ * plugged in later may be called from that thread.
+ *
  * For reliable effects, this function must be called before clutter_init().
  *
  * Since: 1.16
@@ -85,6 +85,9 @@ void _clutter_device_manager_evdev_filter_relative_motion (ClutterDeviceManagerE
 
 void _clutter_device_manager_evdev_dispatch (ClutterDeviceManagerEvdev *manager_evdev);
 
+void _clutter_device_manager_evdev_lock_libinput   (ClutterDeviceManagerEvdev *manager_evdev);
+void _clutter_device_manager_evdev_unlock_libinput (ClutterDeviceManagerEvdev *manager_evdev);
+
 static inline guint64
 us (guint64 us)
 {
@@ -79,7 +79,11 @@ clutter_input_device_evdev_finalize (GObject *object)
     CLUTTER_DEVICE_MANAGER_EVDEV (device->device_manager);
 
   if (device_evdev->libinput_device)
-    libinput_device_unref (device_evdev->libinput_device);
+    {
+      _clutter_device_manager_evdev_lock_libinput (manager_evdev);
+      libinput_device_unref (device_evdev->libinput_device);
+      _clutter_device_manager_evdev_unlock_libinput (manager_evdev);
+    }
 
   clutter_input_device_evdev_release_touch_slots (device_evdev,
                                                   g_get_monotonic_time ());
@@ -1439,10 +1443,17 @@ void
 _clutter_input_device_evdev_update_leds (ClutterInputDeviceEvdev *device,
                                          enum libinput_led leds)
 {
+  ClutterDeviceManagerEvdev *manager_evdev;
+
   if (!device->libinput_device)
     return;
 
+  manager_evdev =
+    CLUTTER_DEVICE_MANAGER_EVDEV (CLUTTER_INPUT_DEVICE (device)->device_manager);
+
+  _clutter_device_manager_evdev_lock_libinput (manager_evdev);
   libinput_device_led_update (device->libinput_device, leds);
+  _clutter_device_manager_evdev_unlock_libinput (manager_evdev);
 }
 
 ClutterInputDeviceType
@@ -37,7 +37,10 @@ clutter_input_device_tool_evdev_finalize (GObject *object)
   ClutterInputDeviceToolEvdev *tool = CLUTTER_INPUT_DEVICE_TOOL_EVDEV (object);
 
   g_hash_table_unref (tool->button_map);
+
+  _clutter_device_manager_evdev_lock_libinput (tool->manager_evdev);
   libinput_tablet_tool_unref (tool->tool);
+  _clutter_device_manager_evdev_unlock_libinput (tool->manager_evdev);
 
   G_OBJECT_CLASS (clutter_input_device_tool_evdev_parent_class)->finalize (object);
 }
@@ -57,7 +60,8 @@ clutter_input_device_tool_evdev_init (ClutterInputDeviceToolEvdev *tool)
 }
 
 ClutterInputDeviceTool *
-clutter_input_device_tool_evdev_new (struct libinput_tablet_tool *tool,
+clutter_input_device_tool_evdev_new (ClutterDeviceManagerEvdev   *manager_evdev,
+                                     struct libinput_tablet_tool *tool,
                                      guint64                      serial,
                                      ClutterInputDeviceToolType   type)
 {
@@ -69,6 +73,7 @@ clutter_input_device_tool_evdev_new (struct libinput_tablet_tool *tool,
                              "id", libinput_tablet_tool_get_tool_id (tool),
                              NULL);
 
+  evdev_tool->manager_evdev = manager_evdev;
   evdev_tool->tool = libinput_tablet_tool_ref (tool);
 
   return CLUTTER_INPUT_DEVICE_TOOL (evdev_tool);
@@ -27,6 +27,7 @@
 #include <libinput.h>
 
 #include <clutter/clutter-input-device-tool.h>
+#include "clutter-device-manager-evdev.h"
 
 G_BEGIN_DECLS
 
@@ -58,6 +59,7 @@ typedef struct _ClutterInputDeviceToolEvdevClass ClutterInputDeviceToolEvdevClas
 struct _ClutterInputDeviceToolEvdev
 {
   ClutterInputDeviceTool parent_instance;
+  ClutterDeviceManagerEvdev *manager_evdev;
   struct libinput_tablet_tool *tool;
   GHashTable *button_map;
   gdouble pressure_curve[4];
@@ -70,7 +72,8 @@ struct _ClutterInputDeviceToolEvdevClass
 
 GType                    clutter_input_device_tool_evdev_get_type (void) G_GNUC_CONST;
 
-ClutterInputDeviceTool * clutter_input_device_tool_evdev_new      (struct libinput_tablet_tool *tool,
+ClutterInputDeviceTool * clutter_input_device_tool_evdev_new      (ClutterDeviceManagerEvdev   *manager_evdev,
+                                                                   struct libinput_tablet_tool *tool,
                                                                    guint64                      serial,
                                                                    ClutterInputDeviceToolType   type);
 
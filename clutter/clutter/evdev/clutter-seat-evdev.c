@@ -852,7 +852,11 @@ clutter_seat_evdev_free (ClutterSeatEvdev *seat)
   clutter_seat_evdev_clear_repeat_timer (seat);
 
   if (seat->libinput_seat)
-    libinput_seat_unref (seat->libinput_seat);
+    {
+      _clutter_device_manager_evdev_lock_libinput (seat->manager_evdev);
+      libinput_seat_unref (seat->libinput_seat);
+      _clutter_device_manager_evdev_unlock_libinput (seat->manager_evdev);
+    }
 
   free (seat);
 }
@@ -37,6 +37,16 @@
 #include "cogl-pango-pipeline-cache.h"
 #include "cogl/cogl-context-private.h"
 
+/* Runs of text at least this long are always drawn from a vertex
+   buffer */
+#define COGL_PANGO_DISPLAY_LIST_VBO_MIN_RECTANGLES 25
+
+/* Shorter runs go through the journal so they can be batched, but
+   once one has been drawn this many times without changing we assume
+   it is a label that will stay the same and keep a vertex buffer for
+   it instead of transforming its quads again every frame */
+#define COGL_PANGO_DISPLAY_LIST_VBO_MIN_RENDERS 3
+
 typedef enum
 {
   COGL_PANGO_DISPLAY_LIST_TEXTURE,
@@ -83,6 +93,9 @@ struct _CoglPangoDisplayListNode
       GArray *rectangles;
       /* A primitive representing those vertices */
       CoglPrimitive *primitive;
+      /* Number of times the node has been drawn since it last
+         changed */
+      unsigned int n_renders;
     } texture;
 
     struct
@@ -158,6 +171,7 @@ _cogl_pango_display_list_add_texture (CoglPangoDisplayList *dl,
           cogl_object_unref (node->d.texture.primitive);
           node->d.texture.primitive = NULL;
         }
+      node->d.texture.n_renders = 0;
     }
   else
     {
@@ -172,6 +186,7 @@ _cogl_pango_display_list_add_texture (CoglPangoDisplayList *dl,
       node->d.texture.rectangles
         = g_array_new (FALSE, FALSE, sizeof (CoglPangoDisplayListRectangle));
       node->d.texture.primitive = NULL;
+      node->d.texture.n_renders = 0;
 
       _cogl_pango_display_list_append_node (dl, node);
     }
@@ -392,13 +407,19 @@ _cogl_framebuffer_draw_display_list_texture (CoglFramebuffer *fb,
 {
   /* For small runs of text like icon labels, we can get better performance
    * going through the Cogl journal since text may then be batched together
-   * with other geometry. */
+   * with other geometry. The colour isn't part of the vertices so a
+   * retained vertex buffer stays valid when the text changes colour. */
   /* FIXME: 25 is a number I plucked out of thin air; it would be good
    * to determine this empirically! */
-  if (node->d.texture.rectangles->len < 25)
+  if (node->d.texture.primitive == NULL &&
+      node->d.texture.rectangles->len <
+      COGL_PANGO_DISPLAY_LIST_VBO_MIN_RECTANGLES &&
+      node->d.texture.n_renders < COGL_PANGO_DISPLAY_LIST_VBO_MIN_RENDERS)
     emit_rectangles_through_journal (fb, pipeline, node);
   else
     emit_vertex_buffer_geometry (fb, pipeline, node);
+
+  node->d.texture.n_renders++;
 }
 
 void
@@ -442,6 +463,8 @@ _cogl_pango_display_list_render (CoglFramebuffer *fb,
       switch (node->type)
         {
         case COGL_PANGO_DISPLAY_LIST_TEXTURE:
+          _cogl_pango_pipeline_cache_update_pipeline (dl->pipeline_cache,
+                                                      node->pipeline);
           _cogl_framebuffer_draw_display_list_texture (fb, node->pipeline, node);
           break;
 
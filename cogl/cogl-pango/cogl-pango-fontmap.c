@@ -153,6 +153,16 @@ cogl_pango_font_map_clear_glyph_cache (CoglPangoFontMap *fm)
   _cogl_pango_renderer_clear_glyph_cache (COGL_PANGO_RENDERER (renderer));
 }
 
+void
+cogl_pango_font_map_get_glyph_cache_stats (CoglPangoFontMap *fm,
+                                           CoglCacheStats *stats)
+{
+  PangoRenderer *renderer = _cogl_pango_font_map_get_renderer (fm);
+
+  _cogl_pango_renderer_get_glyph_cache_stats (COGL_PANGO_RENDERER (renderer),
+                                              stats);
+}
+
 void
 cogl_pango_font_map_set_use_mipmapping (CoglPangoFontMap *fm,
                                         CoglBool          value)
@@ -172,6 +182,25 @@ cogl_pango_font_map_get_use_mipmapping (CoglPangoFontMap *fm)
     _cogl_pango_renderer_get_use_mipmapping (COGL_PANGO_RENDERER (renderer));
 }
 
+void
+cogl_pango_font_map_set_use_distance_field (CoglPangoFontMap *fm,
+                                            CoglBool          value)
+{
+  PangoRenderer *renderer = _cogl_pango_font_map_get_renderer (fm);
+
+  _cogl_pango_renderer_set_use_distance_field (COGL_PANGO_RENDERER (renderer),
+                                               value);
+}
+
+CoglBool
+cogl_pango_font_map_get_use_distance_field (CoglPangoFontMap *fm)
+{
+  PangoRenderer *renderer = _cogl_pango_font_map_get_renderer (fm);
+
+  return
+    _cogl_pango_renderer_get_use_distance_field (COGL_PANGO_RENDERER (renderer));
+}
+
 static GQuark
 cogl_pango_font_map_get_priv_key (void)
 {
@@ -39,6 +39,29 @@
 
 typedef struct _CoglPangoGlyphCacheKey     CoglPangoGlyphCacheKey;
 
+/* The local atlases are pages of at most this size. A page is never
+   reorganized, it only grows in place until it reaches the limit */
+#define COGL_PANGO_GLYPH_CACHE_PAGE_SIZE 1024
+
+/* Once this many pages are allocated the least recently used page is
+   evicted to make room for a new one */
+#define COGL_PANGO_GLYPH_CACHE_MAX_PAGES 4
+
+/* Limit on the glyph memory a cache may take from the shared atlas;
+   the rest go into the pages where they can be evicted */
+#define COGL_PANGO_GLYPH_CACHE_MAX_GLOBAL_BYTES (1024 * 1024)
+
+struct _CoglPangoGlyphCachePage
+{
+  CoglAtlas *atlas;
+
+  /* The cache generation in which a glyph was last looked up */
+  unsigned int last_used;
+
+  unsigned int n_glyphs;
+  size_t bytes;
+};
+
 struct _CoglPangoGlyphCache
 {
   CoglContext *ctx;
@@ -47,8 +70,23 @@ struct _CoglPangoGlyphCache
      particular font is already cached */
   GHashTable       *hash_table;
 
-  /* List of CoglAtlases */
-  GSList           *atlases;
+  /* List of CoglPangoGlyphCachePages, most recently created first */
+  GSList           *pages;
+
+  /* Bumped every time the dirty glyphs are drawn, which happens once
+     per layout drawn. Pages used in the current generation may have
+     glyphs that are about to be painted so they aren't evicted */
+  unsigned int      generation;
+
+  /* Keys of the glyphs that need to be drawn */
+  GPtrArray        *dirty_glyphs;
+
+  size_t            global_bytes;
+
+  unsigned int      hits;
+  unsigned int      misses;
+  unsigned int      n_evicted_pages;
+  unsigned int      n_evicted_glyphs;
 
   /* List of callbacks to invoke when an atlas is reorganized */
   GHookList         reorganize_callbacks;
@@ -58,14 +96,13 @@ struct _CoglPangoGlyphCache
      global atlas reorganizations */
   CoglBool          using_global_atlas;
 
-  /* True if some of the glyphs are dirty. This is used as an
-     optimization in _cogl_pango_glyph_cache_set_dirty_glyphs to avoid
-     iterating the hash table if we know none of them are dirty */
-  CoglBool          has_dirty_glyphs;
-
   /* Whether mipmapping is being used for this cache. This only
      affects whether we decide to put the glyph in the global atlas */
   CoglBool          use_mipmapping;
+
+  /* Whether the glyphs are stored as distance fields, with a margin
+     around them and at a larger size than they are drawn */
+  CoglBool          use_distance_field;
 };
 
 struct _CoglPangoGlyphCacheKey
@@ -119,7 +156,8 @@ cogl_pango_glyph_cache_equal_func (const void *a, const void *b)
 
 CoglPangoGlyphCache *
 cogl_pango_glyph_cache_new (CoglContext *ctx,
-                            CoglBool use_mipmapping)
+                            CoglBool use_mipmapping,
+                            CoglBool use_distance_field)
 {
   CoglPangoGlyphCache *cache;
 
@@ -135,14 +173,21 @@ cogl_pango_glyph_cache_new (CoglContext *ctx,
      (GDestroyNotify) cogl_pango_glyph_cache_key_free,
      (GDestroyNotify) cogl_pango_glyph_cache_value_free);
 
-  cache->atlases = NULL;
-  g_hook_list_init (&cache->reorganize_callbacks, sizeof (GHook));
+  cache->pages = NULL;
+  cache->generation = 0;
+  cache->dirty_glyphs = g_ptr_array_new ();
+  cache->global_bytes = 0;
+  cache->hits = 0;
+  cache->misses = 0;
+  cache->n_evicted_pages = 0;
+  cache->n_evicted_glyphs = 0;
 
-  cache->has_dirty_glyphs = FALSE;
+  g_hook_list_init (&cache->reorganize_callbacks, sizeof (GHook));
 
   cache->using_global_atlas = FALSE;
 
   cache->use_mipmapping = use_mipmapping;
+  cache->use_distance_field = use_distance_field;
 
   return cache;
 }
@@ -155,15 +200,30 @@ cogl_pango_glyph_cache_reorganize_cb (void *user_data)
   g_hook_list_invoke (&cache->reorganize_callbacks, FALSE);
 }
 
+static void
+cogl_pango_glyph_cache_page_free (CoglPangoGlyphCachePage *page)
+{
+  cogl_object_unref (page->atlas);
+  g_slice_free (CoglPangoGlyphCachePage, page);
+}
+
 void
 cogl_pango_glyph_cache_clear (CoglPangoGlyphCache *cache)
 {
-  g_slist_foreach (cache->atlases, (GFunc) cogl_object_unref, NULL);
-  g_slist_free (cache->atlases);
-  cache->atlases = NULL;
-  cache->has_dirty_glyphs = FALSE;
-
+  /* The values point into the pages so they have to go first */
+  g_ptr_array_set_size (cache->dirty_glyphs, 0);
   g_hash_table_remove_all (cache->hash_table);
+
+  g_slist_foreach (cache->pages, (GFunc) cogl_pango_glyph_cache_page_free,
+                   NULL);
+  g_slist_free (cache->pages);
+  cache->pages = NULL;
+
+  cache->global_bytes = 0;
+  cache->hits = 0;
+  cache->misses = 0;
+  cache->n_evicted_pages = 0;
+  cache->n_evicted_glyphs = 0;
 }
 
 void
@@ -179,6 +239,7 @@ cogl_pango_glyph_cache_free (CoglPangoGlyphCache *cache)
   cogl_pango_glyph_cache_clear (cache);
 
   g_hash_table_unref (cache->hash_table);
+  g_ptr_array_free (cache->dirty_glyphs, TRUE);
 
   g_hook_list_clear (&cache->reorganize_callbacks);
 
@@ -193,6 +254,10 @@ cogl_pango_glyph_cache_update_position_cb (void *user_data,
   CoglPangoGlyphCacheValue *value = user_data;
   float tex_width, tex_height;
 
+  /* The pages are only ever grown in place, which copies the old
+     contents, so only a glyph that is being added needs to be drawn.
+     That is marked dirty by cogl_pango_glyph_cache_lookup */
+
   if (value->texture)
     cogl_object_unref (value->texture);
   value->texture = cogl_object_ref (new_texture);
@@ -202,14 +267,11 @@ cogl_pango_glyph_cache_update_position_cb (void *user_data,
 
   value->tx1 = rect->x / tex_width;
   value->ty1 = rect->y / tex_height;
-  value->tx2 = (rect->x + value->draw_width) / tex_width;
-  value->ty2 = (rect->y + value->draw_height) / tex_height;
+  value->tx2 = (rect->x + value->tex_width) / tex_width;
+  value->ty2 = (rect->y + value->tex_height) / tex_height;
 
   value->tx_pixel = rect->x;
   value->ty_pixel = rect->y;
-
-  /* The glyph has changed position so it will need to be redrawn */
-  value->dirty = TRUE;
 }
 
 static CoglBool
@@ -220,6 +282,7 @@ cogl_pango_glyph_cache_add_to_global_atlas (CoglPangoGlyphCache *cache,
 {
   CoglAtlasTexture *texture;
   CoglError *ignore_error = NULL;
+  size_t bytes = value->tex_width * value->tex_height * 4;
 
   if (COGL_DEBUG_ENABLED (COGL_DEBUG_DISABLE_SHARED_ATLAS))
     return FALSE;
@@ -229,9 +292,19 @@ cogl_pango_glyph_cache_add_to_global_atlas (CoglPangoGlyphCache *cache,
   if (cache->use_mipmapping)
     return FALSE;
 
+  /* The distance fields need to stay in alpha-only textures for the
+     pipelines that read them */
+  if (cache->use_distance_field)
+    return FALSE;
+
+  /* Glyphs in the global atlas can't be evicted so don't let one
+     cache fill it up */
+  if (cache->global_bytes + bytes > COGL_PANGO_GLYPH_CACHE_MAX_GLOBAL_BYTES)
+    return FALSE;
+
   texture = cogl_atlas_texture_new_with_size (cache->ctx,
-                                              value->draw_width,
-                                              value->draw_height);
+                                              value->tex_width,
+                                              value->tex_height);
   if (!cogl_texture_allocate (COGL_TEXTURE (texture), &ignore_error))
     {
       cogl_error_free (ignore_error);
@@ -245,6 +318,9 @@ cogl_pango_glyph_cache_add_to_global_atlas (CoglPangoGlyphCache *cache,
   value->ty2 = 1;
   value->tx_pixel = 0;
   value->ty_pixel = 0;
+  value->page = NULL;
+
+  cache->global_bytes += bytes;
 
   /* The first time we store a texture in the global atlas we'll
      register for notifications when the global atlas is reorganized
@@ -261,51 +337,130 @@ cogl_pango_glyph_cache_add_to_global_atlas (CoglPangoGlyphCache *cache,
   return TRUE;
 }
 
+static CoglBool
+cogl_pango_glyph_cache_value_in_page_cb (void *key_ptr,
+                                         void *value_ptr,
+                                         void *user_data)
+{
+  CoglPangoGlyphCacheValue *value = value_ptr;
+
+  return value->page == user_data;
+}
+
+static CoglBool
+cogl_pango_glyph_cache_evict_page (CoglPangoGlyphCache *cache)
+{
+  CoglPangoGlyphCachePage *lru_page = NULL;
+  GSList *l;
+
+  /* Pages used in this generation may have glyphs that are about to
+     be painted. If every page is in use we go over the limit and
+     catch up when the next page is created */
+  for (l = cache->pages; l; l = l->next)
+    {
+      CoglPangoGlyphCachePage *page = l->data;
+
+      if (page->last_used != cache->generation &&
+          (lru_page == NULL || page->last_used < lru_page->last_used))
+        lru_page = page;
+    }
+
+  if (lru_page == NULL)
+    return FALSE;
+
+  COGL_NOTE (PANGO, "Evicting glyph page %p with %u glyphs, unused for "
+             "%u generations",
+             lru_page, lru_page->n_glyphs,
+             cache->generation - lru_page->last_used);
+
+  /* The display lists keep their own references to the textures so
+     layouts already using the glyphs can still be painted */
+  g_hash_table_foreach_remove (cache->hash_table,
+                               cogl_pango_glyph_cache_value_in_page_cb,
+                               lru_page);
+
+  cache->n_evicted_pages++;
+  cache->n_evicted_glyphs += lru_page->n_glyphs;
+
+  cache->pages = g_slist_remove (cache->pages, lru_page);
+  cogl_pango_glyph_cache_page_free (lru_page);
+
+  return TRUE;
+}
+
 static CoglBool
 cogl_pango_glyph_cache_add_to_local_atlas (CoglPangoGlyphCache *cache,
                                            PangoFont *font,
                                            PangoGlyph glyph,
                                            CoglPangoGlyphCacheValue *value)
 {
-  CoglAtlas *atlas = NULL;
+  CoglPangoGlyphCachePage *page = NULL;
+  unsigned int width = value->tex_width + 1;
+  unsigned int height = value->tex_height + 1;
+  unsigned int max_size;
   GSList *l;
 
-  /* Look for an atlas that can reserve the space */
-  for (l = cache->atlases; l; l = l->next)
-    if (_cogl_atlas_reserve_space (l->data,
-                                   value->draw_width + 1,
-                                   value->draw_height + 1,
+  /* Look for a page that can reserve the space */
+  for (l = cache->pages; l; l = l->next)
+    if (_cogl_atlas_reserve_space (((CoglPangoGlyphCachePage *)
+                                    l->data)->atlas,
+                                   width, height,
                                    value))
       {
-        atlas = l->data;
+        page = l->data;
         break;
       }
 
-  /* If we couldn't find one then start a new atlas */
-  if (atlas == NULL)
+  /* If we couldn't find one then start a new page */
+  if (page == NULL)
     {
-      atlas = _cogl_atlas_new (COGL_PIXEL_FORMAT_A_8,
-                               COGL_ATLAS_CLEAR_TEXTURE |
-                               COGL_ATLAS_DISABLE_MIGRATION,
-                               cogl_pango_glyph_cache_update_position_cb);
-      COGL_NOTE (ATLAS, "Created new atlas for glyphs: %p", atlas);
+      while (g_slist_length (cache->pages) >=
+             COGL_PANGO_GLYPH_CACHE_MAX_PAGES &&
+             cogl_pango_glyph_cache_evict_page (cache))
+        ;
+
+      page = g_slice_new (CoglPangoGlyphCachePage);
+      page->n_glyphs = 0;
+      page->bytes = 0;
+
+      /* Glyphs mostly have similar heights so they pack well on a
+         skyline. Growing the page keeps the glyphs already drawn so
+         it doesn't need migration disabled, and it must never be
+         reorganized because that would lose them */
+      page->atlas = _cogl_atlas_new (COGL_PIXEL_FORMAT_A_8,
+                                     COGL_ATLAS_CLEAR_TEXTURE |
+                                     COGL_ATLAS_SKYLINE_PACKING |
+                                     COGL_ATLAS_INCREMENTAL_MIGRATION |
+                                     COGL_ATLAS_DISABLE_REORGANIZATION,
+                                     cogl_pango_glyph_cache_update_position_cb);
+
+      /* A glyph bigger than a page gets a page to itself */
+      max_size = COGL_PANGO_GLYPH_CACHE_PAGE_SIZE;
+      while (max_size < width || max_size < height)
+        max_size *= 2;
+      _cogl_atlas_set_max_size (page->atlas, max_size, max_size);
+      _cogl_atlas_set_memory_category (page->atlas, "glyph atlas");
+
+      COGL_NOTE (ATLAS, "Created new atlas for glyphs: %p", page->atlas);
       /* If we still can't reserve space then something has gone
          seriously wrong so we'll just give up */
-      if (!_cogl_atlas_reserve_space (atlas,
-                                      value->draw_width + 1,
-                                      value->draw_height + 1,
-                                      value))
+      if (!_cogl_atlas_reserve_space (page->atlas, width, height, value))
         {
-          cogl_object_unref (atlas);
+          cogl_pango_glyph_cache_page_free (page);
           return FALSE;
         }
 
       _cogl_atlas_add_reorganize_callback
-        (atlas, cogl_pango_glyph_cache_reorganize_cb, NULL, cache);
+        (page->atlas, cogl_pango_glyph_cache_reorganize_cb, NULL, cache);
 
-      cache->atlases = g_slist_prepend (cache->atlases, atlas);
+      cache->pages = g_slist_prepend (cache->pages, page);
     }
 
+  value->page = page;
+  page->last_used = cache->generation;
+  page->n_glyphs++;
+  page->bytes += width * height;
+
   return TRUE;
 }
 
@@ -323,13 +478,24 @@ cogl_pango_glyph_cache_lookup (CoglPangoGlyphCache *cache,
 
   value = g_hash_table_lookup (cache->hash_table, &lookup_key);
 
-  if (create && value == NULL)
+  if (value)
+    {
+      if (create)
+        cache->hits++;
+
+      if (value->page)
+        value->page->last_used = cache->generation;
+    }
+  else if (create)
     {
       CoglPangoGlyphCacheKey *key;
       PangoRectangle ink_rect;
 
+      cache->misses++;
+
       value = g_slice_new (CoglPangoGlyphCacheValue);
       value->texture = NULL;
+      value->page = NULL;
 
       pango_font_get_glyph_extents (font, glyph, &ink_rect, NULL);
       pango_extents_to_pixels (&ink_rect, NULL);
@@ -339,6 +505,27 @@ cogl_pango_glyph_cache_lookup (CoglPangoGlyphCache *cache,
       value->draw_width = ink_rect.width;
       value->draw_height = ink_rect.height;
 
+      if (cache->use_distance_field && ink_rect.width > 0 &&
+          ink_rect.height > 0)
+        {
+          int margin = (COGL_PANGO_DISTANCE_FIELD_SPREAD /
+                        COGL_PANGO_DISTANCE_FIELD_SCALE);
+
+          value->draw_x -= margin;
+          value->draw_y -= margin;
+          value->draw_width += 2 * margin;
+          value->draw_height += 2 * margin;
+          value->tex_width =
+            value->draw_width * COGL_PANGO_DISTANCE_FIELD_SCALE;
+          value->tex_height =
+            value->draw_height * COGL_PANGO_DISTANCE_FIELD_SCALE;
+        }
+      else
+        {
+          value->tex_width = value->draw_width;
+          value->tex_height = value->draw_height;
+        }
+
       /* If the glyph is zero-sized then we don't need to reserve any
          space for it and we can just avoid painting anything */
       if (ink_rect.width < 1 || ink_rect.height < 1)
@@ -361,7 +548,6 @@ cogl_pango_glyph_cache_lookup (CoglPangoGlyphCache *cache,
             }
 
           value->dirty = TRUE;
-          cache->has_dirty_glyphs = TRUE;
         }
 
       key = g_slice_new (CoglPangoGlyphCacheKey);
@@ -369,42 +555,63 @@ cogl_pango_glyph_cache_lookup (CoglPangoGlyphCache *cache,
       key->glyph = glyph;
 
       g_hash_table_insert (cache->hash_table, key, value);
+
+      if (value->dirty)
+        g_ptr_array_add (cache->dirty_glyphs, key);
     }
 
   return value;
 }
 
-static void
-_cogl_pango_glyph_cache_set_dirty_glyphs_cb (void *key_ptr,
-                                             void *value_ptr,
-                                             void *user_data)
+void
+_cogl_pango_glyph_cache_set_dirty_glyphs (CoglPangoGlyphCache *cache,
+                                          CoglPangoGlyphCacheDirtyFunc func,
+                                          void *user_data)
 {
-  CoglPangoGlyphCacheKey *key = key_ptr;
-  CoglPangoGlyphCacheValue *value = value_ptr;
-  CoglPangoGlyphCacheDirtyFunc func = user_data;
+  unsigned int i;
 
-  if (value->dirty)
+  /* Only glyphs added since the last call can be dirty. Their pages
+     were used in this generation so none of them has been evicted */
+  for (i = 0; i < cache->dirty_glyphs->len; i++)
     {
-      func (key->font, key->glyph, value);
+      CoglPangoGlyphCacheKey *key = g_ptr_array_index (cache->dirty_glyphs, i);
+      CoglPangoGlyphCacheValue *value =
+        g_hash_table_lookup (cache->hash_table, key);
 
-      value->dirty = FALSE;
+      if (value->dirty)
+        {
+          func (key->font, key->glyph, value, user_data);
+
+          value->dirty = FALSE;
+        }
     }
+
+  g_ptr_array_set_size (cache->dirty_glyphs, 0);
+
+  cache->generation++;
 }
 
 void
-_cogl_pango_glyph_cache_set_dirty_glyphs (CoglPangoGlyphCache *cache,
-                                          CoglPangoGlyphCacheDirtyFunc func)
+_cogl_pango_glyph_cache_get_stats (CoglPangoGlyphCache *cache,
+                                   CoglPangoGlyphCacheStats *stats)
 {
-  /* If we know that there are no dirty glyphs then we can shortcut
-     out early */
-  if (!cache->has_dirty_glyphs)
-    return;
+  GSList *l;
+
+  stats->hits = cache->hits;
+  stats->misses = cache->misses;
+  stats->n_glyphs = g_hash_table_size (cache->hash_table);
+  stats->n_pages = 0;
+  stats->bytes = cache->global_bytes;
+  stats->n_evicted_pages = cache->n_evicted_pages;
+  stats->n_evicted_glyphs = cache->n_evicted_glyphs;
 
-  g_hash_table_foreach (cache->hash_table,
-                        _cogl_pango_glyph_cache_set_dirty_glyphs_cb,
-                        func);
+  for (l = cache->pages; l; l = l->next)
+    {
+      CoglPangoGlyphCachePage *page = l->data;
 
-  cache->has_dirty_glyphs = FALSE;
+      stats->n_pages++;
+      stats->bytes += page->bytes;
+    }
 }
 
 void
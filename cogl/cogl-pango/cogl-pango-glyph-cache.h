@@ -38,6 +38,14 @@ COGL_BEGIN_DECLS
 
 typedef struct _CoglPangoGlyphCache      CoglPangoGlyphCache;
 typedef struct _CoglPangoGlyphCacheValue CoglPangoGlyphCacheValue;
+typedef struct _CoglPangoGlyphCachePage  CoglPangoGlyphCachePage;
+
+/* A cache of distance fields stores each glyph at this many texels
+   per pixel, and the distance to the outline is measured up to this
+   many texels from it, which takes a margin of the spread over the
+   scale pixels around the ink rectangle */
+#define COGL_PANGO_DISTANCE_FIELD_SCALE  2
+#define COGL_PANGO_DISTANCE_FIELD_SPREAD 4
 
 struct _CoglPangoGlyphCacheValue
 {
@@ -56,18 +64,44 @@ struct _CoglPangoGlyphCacheValue
   int draw_width;
   int draw_height;
 
+  /* The size of the glyph in the texture, which is the same as the
+     size it is drawn at unless the cache stores distance fields */
+  int tex_width;
+  int tex_height;
+
+  /* The page of the local atlases holding the glyph or NULL if it
+     is in the global atlas */
+  CoglPangoGlyphCachePage *page;
+
   /* This will be set to TRUE when the glyph atlas is reorganized
      which means the glyph will need to be redrawn */
   CoglBool   dirty;
 };
 
+typedef struct
+{
+  /* Lookups that asked for the glyph to be created */
+  unsigned int hits;
+  unsigned int misses;
+
+  unsigned int n_glyphs;
+  unsigned int n_pages;
+  /* Approximate texture memory used by the glyphs */
+  size_t bytes;
+
+  unsigned int n_evicted_pages;
+  unsigned int n_evicted_glyphs;
+} CoglPangoGlyphCacheStats;
+
 typedef void (* CoglPangoGlyphCacheDirtyFunc) (PangoFont *font,
                                                PangoGlyph glyph,
-                                               CoglPangoGlyphCacheValue *value);
+                                               CoglPangoGlyphCacheValue *value,
+                                               void *user_data);
 
 CoglPangoGlyphCache *
 cogl_pango_glyph_cache_new (CoglContext *ctx,
-                            CoglBool use_mipmapping);
+                            CoglBool use_mipmapping,
+                            CoglBool use_distance_field);
 
 void
 cogl_pango_glyph_cache_free (CoglPangoGlyphCache *cache);
@@ -93,7 +127,12 @@ _cogl_pango_glyph_cache_remove_reorganize_callback (CoglPangoGlyphCache *cache,
 
 void
 _cogl_pango_glyph_cache_set_dirty_glyphs (CoglPangoGlyphCache *cache,
-                                          CoglPangoGlyphCacheDirtyFunc func);
+                                          CoglPangoGlyphCacheDirtyFunc func,
+                                          void *user_data);
+
+void
+_cogl_pango_glyph_cache_get_stats (CoglPangoGlyphCache *cache,
+                                   CoglPangoGlyphCacheStats *stats);
 
 COGL_END_DECLS
 
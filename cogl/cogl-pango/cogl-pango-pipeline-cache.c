@@ -76,7 +76,8 @@ _cogl_pango_pipeline_cache_value_destroy (void *data)
 
 CoglPangoPipelineCache *
 _cogl_pango_pipeline_cache_new (CoglContext *ctx,
-                                CoglBool use_mipmapping)
+                                CoglBool use_mipmapping,
+                                CoglBool use_distance_field)
 {
   CoglPangoPipelineCache *cache = g_new (CoglPangoPipelineCache, 1);
 
@@ -96,6 +97,10 @@ _cogl_pango_pipeline_cache_new (CoglContext *ctx,
 
   cache->use_mipmapping = use_mipmapping;
 
+  cache->use_distance_field = use_distance_field;
+  cache->distance_field_width_location = -1;
+  cache->distance_field_width = 0.0f;
+
   return cache;
 }
 
@@ -149,6 +154,28 @@ get_base_texture_alpha_pipeline (CoglPangoPipelineCache *cache)
       cogl_pipeline_set_layer_combine (pipeline, 0, /* layer */
                                        "RGBA = MODULATE (PREVIOUS, TEXTURE[A])",
                                        NULL);
+
+      /* The glyphs of a distance field cache are all in alpha
+         textures. The texel is 0.5 on the outline and the coverage
+         ramps up across it over the smoothing width */
+      if (cache->use_distance_field)
+        {
+          CoglSnippet *snippet;
+
+          snippet =
+            cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                              "uniform float distance_field_width;\n",
+                              "cogl_texel.a =\n"
+                              "  smoothstep (0.5 - distance_field_width,\n"
+                              "              0.5 + distance_field_width,\n"
+                              "              cogl_texel.a);\n");
+          cogl_pipeline_add_layer_snippet (pipeline, 0, snippet);
+          cogl_object_unref (snippet);
+
+          cache->distance_field_width_location =
+            cogl_pipeline_get_uniform_location (pipeline,
+                                                "distance_field_width");
+        }
     }
 
   return cache->base_texture_alpha_pipeline;
@@ -226,6 +253,19 @@ _cogl_pango_pipeline_cache_get (CoglPangoPipelineCache *cache,
   return entry->pipeline;
 }
 
+void
+_cogl_pango_pipeline_cache_update_pipeline (CoglPangoPipelineCache *cache,
+                                            CoglPipeline *pipeline)
+{
+  /* The location is known once a pipeline for the glyphs was made */
+  if (cache->distance_field_width_location == -1)
+    return;
+
+  cogl_pipeline_set_uniform_1f (pipeline,
+                                cache->distance_field_width_location,
+                                cache->distance_field_width);
+}
+
 void
 _cogl_pango_pipeline_cache_free (CoglPangoPipelineCache *cache)
 {
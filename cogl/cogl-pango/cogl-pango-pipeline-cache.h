@@ -50,12 +50,20 @@ typedef struct _CoglPangoPipelineCache
   CoglPipeline *base_texture_rgba_pipeline;
 
   CoglBool use_mipmapping;
+
+  /* Whether the glyph textures hold distance fields. The pipelines for
+     them turn the distance into coverage with a smoothing width that
+     depends on how much the glyphs are magnified */
+  CoglBool use_distance_field;
+  int distance_field_width_location;
+  float distance_field_width;
 } CoglPangoPipelineCache;
 
 
 CoglPangoPipelineCache *
 _cogl_pango_pipeline_cache_new (CoglContext *ctx,
-                                CoglBool use_mipmapping);
+                                CoglBool use_mipmapping,
+                                CoglBool use_distance_field);
 
 /* Returns a pipeline that can be used to render glyphs in the given
    texture. The pipeline has a new reference so it is up to the caller
@@ -64,6 +72,12 @@ CoglPipeline *
 _cogl_pango_pipeline_cache_get (CoglPangoPipelineCache *cache,
                                 CoglTexture *texture);
 
+/* Applies the smoothing width of the distance fields to a pipeline
+   from the cache before it is drawn with */
+void
+_cogl_pango_pipeline_cache_update_pipeline (CoglPangoPipelineCache *cache,
+                                            CoglPipeline *pipeline);
+
 void
 _cogl_pango_pipeline_cache_free (CoglPangoPipelineCache *cache);
 
@@ -46,12 +46,22 @@ _cogl_pango_renderer_new (CoglContext *context);
 void
 _cogl_pango_renderer_clear_glyph_cache  (CoglPangoRenderer *renderer);
 
+void
+_cogl_pango_renderer_get_glyph_cache_stats (CoglPangoRenderer *renderer,
+                                            CoglCacheStats *stats);
+
 void
 _cogl_pango_renderer_set_use_mipmapping (CoglPangoRenderer *renderer,
                                          CoglBool value);
 CoglBool
 _cogl_pango_renderer_get_use_mipmapping (CoglPangoRenderer *renderer);
 
+void
+_cogl_pango_renderer_set_use_distance_field (CoglPangoRenderer *renderer,
+                                             CoglBool value);
+CoglBool
+_cogl_pango_renderer_get_use_distance_field (CoglPangoRenderer *renderer);
+
 
 
 CoglContext *
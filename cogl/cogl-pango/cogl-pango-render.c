@@ -45,6 +45,8 @@
 #include <pango/pangocairo.h>
 #include <pango/pango-renderer.h>
 #include <cairo.h>
+#include <math.h>
+#include <string.h>
 
 #include "cogl/cogl-debug.h"
 #include "cogl/cogl-context-private.h"
@@ -78,12 +80,46 @@ struct _CoglPangoRenderer
   CoglPangoRendererCaches no_mipmap_caches;
   CoglPangoRendererCaches mipmap_caches;
 
+  /* Glyphs as distance fields for layouts drawn magnified, and
+     whether those are used at all */
+  CoglPangoRendererCaches distance_field_caches;
+  CoglBool use_distance_field;
+
   CoglBool use_mipmapping;
 
+  /* Set while the glyphs of a magnified layout are cached and drawn */
+  CoglBool drawing_distance_field;
+
   /* The current display list that is being built */
   CoglPangoDisplayList *display_list;
+
+  /* The glyphs waiting to be drawn into their place in the atlases,
+     as CoglPangoDirtyGlyph */
+  GArray *dirty_glyphs;
 };
 
+/* A glyph to draw into the space reserved for it. Drawing it with
+   cairo is all done without touching anything but the members here
+   so it can happen in a worker thread */
+typedef struct
+{
+  cairo_scaled_font_t *scaled_font;
+  PangoGlyph glyph;
+  cairo_format_t format;
+  int draw_x;
+  int draw_y;
+  int draw_width;
+  int draw_height;
+  int tex_width;
+  int tex_height;
+  CoglBool distance_field;
+
+  cairo_surface_t *surface;
+
+  CoglPangoGlyphCacheValue *value;
+  CoglPixelFormat format_cogl;
+} CoglPangoDirtyGlyph;
+
 struct _CoglPangoRendererClass
 {
   PangoRendererClass class_instance;
@@ -101,15 +137,28 @@ struct _CoglPangoLayoutQdata
   /* A reference to the first line of the layout. This is just used to
      detect changes */
   PangoLayoutLine *first_line;
-  /* Whether mipmapping was previously used to render this layout. We
-     need to regenerate the display list if the mipmapping value is
-     changed because it will be using a different set of textures */
-  CoglBool mipmapping_used;
+  /* The caches the display list was built from. We need to
+     regenerate the display list when the layout is drawn from other
+     caches, such as when mipmapping is changed or the layout starts
+     or stops being magnified, because it will be using a different
+     set of textures */
+  CoglPangoRendererCaches *caches;
 };
 
 static void
 _cogl_pango_ensure_glyph_cache_for_layout_line (PangoLayoutLine *line);
 
+static CoglPangoRendererCaches *
+cogl_pango_renderer_get_caches (CoglPangoRenderer *priv)
+{
+  if (priv->drawing_distance_field)
+    return &priv->distance_field_caches;
+
+  return (priv->use_mipmapping ?
+          &priv->mipmap_caches :
+          &priv->no_mipmap_caches);
+}
+
 typedef struct
 {
   CoglPangoDisplayList *display_list;
@@ -207,6 +256,8 @@ G_DEFINE_TYPE (CoglPangoRenderer, cogl_pango_renderer, PANGO_TYPE_RENDERER);
 static void
 cogl_pango_renderer_init (CoglPangoRenderer *priv)
 {
+  priv->dirty_glyphs = g_array_new (FALSE, FALSE,
+                                    sizeof (CoglPangoDirtyGlyph));
 }
 
 static void
@@ -216,14 +267,18 @@ _cogl_pango_renderer_constructed (GObject *gobject)
   CoglContext *ctx = renderer->ctx;
 
   renderer->no_mipmap_caches.pipeline_cache =
-    _cogl_pango_pipeline_cache_new (ctx, FALSE);
+    _cogl_pango_pipeline_cache_new (ctx, FALSE, FALSE);
   renderer->mipmap_caches.pipeline_cache =
-    _cogl_pango_pipeline_cache_new (ctx, TRUE);
+    _cogl_pango_pipeline_cache_new (ctx, TRUE, FALSE);
+  renderer->distance_field_caches.pipeline_cache =
+    _cogl_pango_pipeline_cache_new (ctx, FALSE, TRUE);
 
   renderer->no_mipmap_caches.glyph_cache =
-    cogl_pango_glyph_cache_new (ctx, FALSE);
+    cogl_pango_glyph_cache_new (ctx, FALSE, FALSE);
   renderer->mipmap_caches.glyph_cache =
-    cogl_pango_glyph_cache_new (ctx, TRUE);
+    cogl_pango_glyph_cache_new (ctx, TRUE, FALSE);
+  renderer->distance_field_caches.glyph_cache =
+    cogl_pango_glyph_cache_new (ctx, FALSE, TRUE);
 
   _cogl_pango_renderer_set_use_mipmapping (renderer, FALSE);
 
@@ -296,9 +351,13 @@ cogl_pango_renderer_finalize (GObject *object)
 
   cogl_pango_glyph_cache_free (priv->no_mipmap_caches.glyph_cache);
   cogl_pango_glyph_cache_free (priv->mipmap_caches.glyph_cache);
+  cogl_pango_glyph_cache_free (priv->distance_field_caches.glyph_cache);
 
   _cogl_pango_pipeline_cache_free (priv->no_mipmap_caches.pipeline_cache);
   _cogl_pango_pipeline_cache_free (priv->mipmap_caches.pipeline_cache);
+  _cogl_pango_pipeline_cache_free (priv->distance_field_caches.pipeline_cache);
+
+  g_array_free (priv->dirty_glyphs, TRUE);
 
   G_OBJECT_CLASS (cogl_pango_renderer_parent_class)->finalize (object);
 }
@@ -338,12 +397,8 @@ cogl_pango_layout_qdata_forget_display_list (CoglPangoLayoutQdata *qdata)
 {
   if (qdata->display_list)
     {
-      CoglPangoRendererCaches *caches = qdata->mipmapping_used ?
-        &qdata->renderer->mipmap_caches :
-        &qdata->renderer->no_mipmap_caches;
-
       _cogl_pango_glyph_cache_remove_reorganize_callback
-        (caches->glyph_cache,
+        (qdata->caches->glyph_cache,
          (GHookFunc) cogl_pango_layout_qdata_forget_display_list,
          qdata);
 
@@ -362,6 +417,80 @@ cogl_pango_render_qdata_destroy (CoglPangoLayoutQdata *qdata)
   g_slice_free (CoglPangoLayoutQdata, qdata);
 }
 
+/* Measures how many pixels of @fb a pixel of text drawn at the
+   origin of the current modelview covers, along each axis */
+static void
+cogl_pango_get_framebuffer_scale (CoglFramebuffer *fb,
+                                  float *scale_x,
+                                  float *scale_y)
+{
+  CoglMatrix modelview, projection, transform;
+  float points[3][4] = {
+    { 0, 0, 0, 1 },
+    { 1, 0, 0, 1 },
+    { 0, 1, 0, 1 }
+  };
+  float viewport_width = cogl_framebuffer_get_viewport_width (fb);
+  float viewport_height = cogl_framebuffer_get_viewport_height (fb);
+  int i;
+
+  cogl_framebuffer_get_modelview_matrix (fb, &modelview);
+  cogl_framebuffer_get_projection_matrix (fb, &projection);
+  cogl_matrix_multiply (&transform, &projection, &modelview);
+
+  for (i = 0; i < 3; i++)
+    {
+      float *p = points[i];
+
+      cogl_matrix_transform_point (&transform, &p[0], &p[1], &p[2], &p[3]);
+
+      /* Behind the eye, the text isn't going to show anyway */
+      if (p[3] <= 0.0f)
+        {
+          *scale_x = *scale_y = 1.0f;
+          return;
+        }
+
+      p[0] = p[0] / p[3] * viewport_width / 2.0f;
+      p[1] = p[1] / p[3] * viewport_height / 2.0f;
+    }
+
+  *scale_x = hypotf (points[1][0] - points[0][0], points[1][1] - points[0][1]);
+  *scale_y = hypotf (points[2][0] - points[0][0], points[2][1] - points[0][1]);
+}
+
+/* Text scaled up, such as while a zoom animation runs, would show the
+   bitmap glyphs' texels blurred into blocks, so it is drawn from
+   distance fields instead, which keep the outlines sharp at any
+   magnification. Text at its size keeps the hinted glyphs, which are
+   crisper there, and text scaled down keeps them too because their
+   mipmaps filter it better than a distance field can */
+static CoglBool
+cogl_pango_renderer_should_use_distance_field (CoglPangoRenderer *priv,
+                                               CoglFramebuffer *fb)
+{
+  CoglPangoPipelineCache *pipeline_cache;
+  float scale_x, scale_y, scale;
+
+  if (!priv->use_distance_field)
+    return FALSE;
+
+  cogl_pango_get_framebuffer_scale (fb, &scale_x, &scale_y);
+  scale = MIN (scale_x, scale_y);
+
+  if (scale < 1.01f)
+    return FALSE;
+
+  /* A texel of the distance field changes by 1 / (2 * spread); smooth
+     the outline over half a pixel of the framebuffer */
+  pipeline_cache = priv->distance_field_caches.pipeline_cache;
+  pipeline_cache->distance_field_width =
+    COGL_PANGO_DISTANCE_FIELD_SCALE /
+    (4.0f * COGL_PANGO_DISTANCE_FIELD_SPREAD * scale);
+
+  return TRUE;
+}
+
 void
 cogl_pango_show_layout (CoglFramebuffer *fb,
                         PangoLayout *layout,
@@ -372,6 +501,7 @@ cogl_pango_show_layout (CoglFramebuffer *fb,
   PangoContext *context;
   CoglPangoRenderer *priv;
   CoglPangoLayoutQdata *qdata;
+  CoglPangoRendererCaches *caches;
 
   context = pango_layout_get_context (layout);
   priv = cogl_pango_get_renderer_from_context (context);
@@ -392,21 +522,21 @@ cogl_pango_show_layout (CoglFramebuffer *fb,
                                cogl_pango_render_qdata_destroy);
     }
 
+  priv->drawing_distance_field =
+    cogl_pango_renderer_should_use_distance_field (priv, fb);
+  caches = cogl_pango_renderer_get_caches (priv);
+
   /* Check if the layout has changed since the last build of the
      display list. This trick was suggested by Behdad Esfahbod here:
      http://mail.gnome.org/archives/gtk-i18n-list/2009-May/msg00019.html */
   if (qdata->display_list &&
       ((qdata->first_line &&
         qdata->first_line->layout != layout) ||
-       qdata->mipmapping_used != priv->use_mipmapping))
+       qdata->caches != caches))
     cogl_pango_layout_qdata_forget_display_list (qdata);
 
   if (qdata->display_list == NULL)
     {
-      CoglPangoRendererCaches *caches = priv->use_mipmapping ?
-        &priv->mipmap_caches :
-        &priv->no_mipmap_caches;
-
       cogl_pango_ensure_glyph_cache_for_layout (layout);
 
       qdata->display_list =
@@ -423,9 +553,11 @@ cogl_pango_show_layout (CoglFramebuffer *fb,
       pango_renderer_draw_layout (PANGO_RENDERER (priv), layout, 0, 0);
       priv->display_list = NULL;
 
-      qdata->mipmapping_used = priv->use_mipmapping;
+      qdata->caches = caches;
     }
 
+  priv->drawing_distance_field = FALSE;
+
   cogl_framebuffer_push_matrix (fb);
   cogl_framebuffer_translate (fb, x, y, 0);
 
@@ -495,9 +627,7 @@ cogl_pango_show_layout_line (CoglFramebuffer *fb,
   if (G_UNLIKELY (!priv))
     return;
 
-  caches = (priv->use_mipmapping ?
-            &priv->mipmap_caches :
-            &priv->no_mipmap_caches);
+  caches = cogl_pango_renderer_get_caches (priv);
 
   priv->display_list = _cogl_pango_display_list_new (caches->pipeline_cache);
 
@@ -532,6 +662,33 @@ _cogl_pango_renderer_clear_glyph_cache (CoglPangoRenderer *renderer)
 {
   cogl_pango_glyph_cache_clear (renderer->mipmap_caches.glyph_cache);
   cogl_pango_glyph_cache_clear (renderer->no_mipmap_caches.glyph_cache);
+  cogl_pango_glyph_cache_clear (renderer->distance_field_caches.glyph_cache);
+}
+
+static void
+add_glyph_cache_stats (CoglPangoGlyphCache *cache,
+                       CoglCacheStats *stats)
+{
+  CoglPangoGlyphCacheStats cache_stats;
+
+  _cogl_pango_glyph_cache_get_stats (cache, &cache_stats);
+
+  stats->n_entries += cache_stats.n_glyphs;
+  stats->bytes += cache_stats.bytes;
+  stats->hits += cache_stats.hits;
+  stats->misses += cache_stats.misses;
+  stats->evictions += cache_stats.n_evicted_glyphs;
+}
+
+void
+_cogl_pango_renderer_get_glyph_cache_stats (CoglPangoRenderer *renderer,
+                                            CoglCacheStats *stats)
+{
+  memset (stats, 0, sizeof (CoglCacheStats));
+
+  add_glyph_cache_stats (renderer->mipmap_caches.glyph_cache, stats);
+  add_glyph_cache_stats (renderer->no_mipmap_caches.glyph_cache, stats);
+  add_glyph_cache_stats (renderer->distance_field_caches.glyph_cache, stats);
 }
 
 void
@@ -547,6 +704,21 @@ _cogl_pango_renderer_get_use_mipmapping (CoglPangoRenderer *renderer)
   return renderer->use_mipmapping;
 }
 
+void
+_cogl_pango_renderer_set_use_distance_field (CoglPangoRenderer *renderer,
+                                             CoglBool value)
+{
+  /* The distance is turned into coverage in a snippet */
+  renderer->use_distance_field =
+    value && cogl_has_feature (renderer->ctx, COGL_FEATURE_ID_GLSL);
+}
+
+CoglBool
+_cogl_pango_renderer_get_use_distance_field (CoglPangoRenderer *renderer)
+{
+  return renderer->use_distance_field;
+}
+
 static CoglPangoGlyphCacheValue *
 cogl_pango_renderer_get_cached_glyph (PangoRenderer *renderer,
                                       CoglBool       create,
@@ -554,25 +726,20 @@ cogl_pango_renderer_get_cached_glyph (PangoRenderer *renderer,
                                       PangoGlyph     glyph)
 {
   CoglPangoRenderer *priv = COGL_PANGO_RENDERER (renderer);
-  CoglPangoRendererCaches *caches = (priv->use_mipmapping ?
-                                     &priv->mipmap_caches :
-                                     &priv->no_mipmap_caches);
+  CoglPangoRendererCaches *caches = cogl_pango_renderer_get_caches (priv);
 
   return cogl_pango_glyph_cache_lookup (caches->glyph_cache,
                                         create, font, glyph);
 }
 
 static void
-cogl_pango_renderer_set_dirty_glyph (PangoFont *font,
+cogl_pango_renderer_add_dirty_glyph (CoglPangoRenderer *priv,
+                                     PangoFont *font,
                                      PangoGlyph glyph,
-                                     CoglPangoGlyphCacheValue *value)
+                                     CoglPangoGlyphCacheValue *value,
+                                     CoglBool distance_field)
 {
-  cairo_surface_t *surface;
-  cairo_t *cr;
-  cairo_scaled_font_t *scaled_font;
-  cairo_glyph_t cairo_glyph;
-  cairo_format_t format_cairo;
-  CoglPixelFormat format_cogl;
+  CoglPangoDirtyGlyph dirty;
 
   COGL_NOTE (PANGO, "redrawing glyph %i", glyph);
 
@@ -583,59 +750,426 @@ cogl_pango_renderer_set_dirty_glyph (PangoFont *font,
 
   if (_cogl_texture_get_format (value->texture) == COGL_PIXEL_FORMAT_A_8)
     {
-      format_cairo = CAIRO_FORMAT_A8;
-      format_cogl = COGL_PIXEL_FORMAT_A_8;
+      dirty.format = CAIRO_FORMAT_A8;
+      dirty.format_cogl = COGL_PIXEL_FORMAT_A_8;
     }
   else
     {
-      format_cairo = CAIRO_FORMAT_ARGB32;
+      dirty.format = CAIRO_FORMAT_ARGB32;
 
       /* Cairo stores the data in native byte order as ARGB but Cogl's
          pixel formats specify the actual byte order. Therefore we
          need to use a different format depending on the
          architecture */
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
-      format_cogl = COGL_PIXEL_FORMAT_BGRA_8888_PRE;
+      dirty.format_cogl = COGL_PIXEL_FORMAT_BGRA_8888_PRE;
 #else
-      format_cogl = COGL_PIXEL_FORMAT_ARGB_8888_PRE;
+      dirty.format_cogl = COGL_PIXEL_FORMAT_ARGB_8888_PRE;
 #endif
     }
 
-  surface = cairo_image_surface_create (format_cairo,
-                                        value->draw_width,
-                                        value->draw_height);
-  cr = cairo_create (surface);
+  dirty.scaled_font =
+    cairo_scaled_font_reference (pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font)));
+  dirty.glyph = glyph;
+  dirty.draw_x = value->draw_x;
+  dirty.draw_y = value->draw_y;
+  dirty.draw_width = value->draw_width;
+  dirty.draw_height = value->draw_height;
+  dirty.tex_width = value->tex_width;
+  dirty.tex_height = value->tex_height;
+  dirty.distance_field = distance_field;
+  dirty.surface = NULL;
+  dirty.value = value;
+
+  g_array_append_val (priv->dirty_glyphs, dirty);
+}
+
+static void
+cogl_pango_renderer_set_dirty_glyph (PangoFont *font,
+                                     PangoGlyph glyph,
+                                     CoglPangoGlyphCacheValue *value,
+                                     void *user_data)
+{
+  cogl_pango_renderer_add_dirty_glyph (user_data, font, glyph, value, FALSE);
+}
+
+static void
+cogl_pango_renderer_set_dirty_distance_field_glyph (PangoFont *font,
+                                                    PangoGlyph glyph,
+                                                    CoglPangoGlyphCacheValue *value,
+                                                    void *user_data)
+{
+  cogl_pango_renderer_add_dirty_glyph (user_data, font, glyph, value, TRUE);
+}
+
+/* The outline is drawn at this many times the resolution of the
+   distance field to find the distances from, as long as that keeps
+   the drawing under the maximum size */
+#define DISTANCE_FIELD_OVERSAMPLE 4
+#define DISTANCE_FIELD_MAX_OVERSAMPLED_SIZE 1024
+
+typedef struct
+{
+  int dx, dy;
+} CoglPangoDistancePoint;
+
+#define DISTANCE_FIELD_FAR 10000
+
+static inline int
+distance_point_length_squared (const CoglPangoDistancePoint *point)
+{
+  return point->dx * point->dx + point->dy * point->dy;
+}
+
+static inline void
+distance_point_compare (CoglPangoDistancePoint *grid,
+                        int width,
+                        int height,
+                        CoglPangoDistancePoint *point,
+                        int x,
+                        int y,
+                        int offset_x,
+                        int offset_y)
+{
+  CoglPangoDistancePoint other;
 
-  scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font));
-  cairo_set_scaled_font (cr, scaled_font);
+  x += offset_x;
+  y += offset_y;
 
+  if (x < 0 || y < 0 || x >= width || y >= height)
+    return;
+
+  other = grid[y * width + x];
+  other.dx += offset_x;
+  other.dy += offset_y;
+
+  if (distance_point_length_squared (&other) <
+      distance_point_length_squared (point))
+    *point = other;
+}
+
+/* Sweeps @grid twice so each point ends up with the offset to the
+   nearest of the points that started at no distance (8SSEDT) */
+static void
+distance_grid_propagate (CoglPangoDistancePoint *grid,
+                         int width,
+                         int height)
+{
+  int x, y;
+
+  for (y = 0; y < height; y++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          CoglPangoDistancePoint *point = &grid[y * width + x];
+
+          distance_point_compare (grid, width, height, point, x, y, -1, 0);
+          distance_point_compare (grid, width, height, point, x, y, 0, -1);
+          distance_point_compare (grid, width, height, point, x, y, -1, -1);
+          distance_point_compare (grid, width, height, point, x, y, 1, -1);
+        }
+
+      for (x = width - 1; x >= 0; x--)
+        distance_point_compare (grid, width, height,
+                                &grid[y * width + x], x, y, 1, 0);
+    }
+
+  for (y = height - 1; y >= 0; y--)
+    {
+      for (x = width - 1; x >= 0; x--)
+        {
+          CoglPangoDistancePoint *point = &grid[y * width + x];
+
+          distance_point_compare (grid, width, height, point, x, y, 1, 0);
+          distance_point_compare (grid, width, height, point, x, y, 0, 1);
+          distance_point_compare (grid, width, height, point, x, y, -1, 1);
+          distance_point_compare (grid, width, height, point, x, y, 1, 1);
+        }
+
+      for (x = 0; x < width; x++)
+        distance_point_compare (grid, width, height,
+                                &grid[y * width + x], x, y, -1, 0);
+    }
+}
+
+/* Draws the outline of the glyph oversampled and stores the signed
+   distance of each texel's centre to it, positive inside, as 0.5
+   plus the distance over twice the spread */
+static void
+cogl_pango_renderer_rasterize_distance_field (CoglPangoDirtyGlyph *dirty)
+{
+  int oversample = DISTANCE_FIELD_OVERSAMPLE;
+  int width, height;
+  cairo_surface_t *outline;
+  cairo_t *cr;
+  cairo_glyph_t cairo_glyph;
+  const uint8_t *outline_data;
+  int outline_stride;
+  CoglPangoDistancePoint *inside, *outside;
+  uint8_t *data;
+  int stride;
+  int x, y, i;
+
+  while (oversample > 1 &&
+         MAX (dirty->tex_width, dirty->tex_height) * oversample >
+         DISTANCE_FIELD_MAX_OVERSAMPLED_SIZE)
+    oversample /= 2;
+
+  width = dirty->tex_width * oversample;
+  height = dirty->tex_height * oversample;
+
+  outline = cairo_image_surface_create (CAIRO_FORMAT_A8, width, height);
+  cr = cairo_create (outline);
+
+  /* The outline is hinted for the size it is drawn at here */
+  cairo_scale (cr,
+               COGL_PANGO_DISTANCE_FIELD_SCALE * oversample,
+               COGL_PANGO_DISTANCE_FIELD_SCALE * oversample);
+  cairo_set_scaled_font (cr, dirty->scaled_font);
   cairo_set_source_rgba (cr, 1.0, 1.0, 1.0, 1.0);
 
-  cairo_glyph.x = -value->draw_x;
-  cairo_glyph.y = -value->draw_y;
+  cairo_glyph.x = -dirty->draw_x;
+  cairo_glyph.y = -dirty->draw_y;
+  cairo_glyph.index = dirty->glyph;
+  cairo_show_glyphs (cr, &cairo_glyph, 1);
+
+  cairo_destroy (cr);
+  cairo_surface_flush (outline);
+
+  outline_data = cairo_image_surface_get_data (outline);
+  outline_stride = cairo_image_surface_get_stride (outline);
+
+  /* Offsets to the nearest pixel inside the outline, and to the
+     nearest one outside it */
+  inside = g_new (CoglPangoDistancePoint, width * height);
+  outside = g_new (CoglPangoDistancePoint, width * height);
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        CoglBool is_inside = outline_data[y * outline_stride + x] >= 128;
+        CoglPangoDistancePoint near = { 0, 0 };
+        CoglPangoDistancePoint far = { DISTANCE_FIELD_FAR, DISTANCE_FIELD_FAR };
+
+        inside[y * width + x] = is_inside ? near : far;
+        outside[y * width + x] = is_inside ? far : near;
+      }
+
+  cairo_surface_destroy (outline);
+
+  distance_grid_propagate (inside, width, height);
+  distance_grid_propagate (outside, width, height);
+
+  dirty->surface = cairo_image_surface_create (CAIRO_FORMAT_A8,
+                                               dirty->tex_width,
+                                               dirty->tex_height);
+  data = cairo_image_surface_get_data (dirty->surface);
+  stride = cairo_image_surface_get_stride (dirty->surface);
+
+  for (y = 0; y < dirty->tex_height; y++)
+    for (x = 0; x < dirty->tex_width; x++)
+      {
+        float distance = 0.0f;
+        float value;
+
+        /* A texel's centre falls between the middle pixels of its
+           block of the oversampled outline, so average those */
+        for (i = 0; i < 4; i++)
+          {
+            int px = x * oversample + MAX (oversample / 2 - (i & 1), 0);
+            int py = y * oversample + MAX (oversample / 2 - (i >> 1), 0);
+            int offset = MIN (py, height - 1) * width + MIN (px, width - 1);
+
+            distance +=
+              sqrtf (distance_point_length_squared (&outside[offset])) -
+              sqrtf (distance_point_length_squared (&inside[offset]));
+          }
+
+        distance /= 4.0f * oversample;
+
+        value = 0.5f + distance / (2.0f * COGL_PANGO_DISTANCE_FIELD_SPREAD);
+        data[y * stride + x] = CLAMP (value, 0.0f, 1.0f) * 255.0f + 0.5f;
+      }
+
+  cairo_surface_mark_dirty (dirty->surface);
+
+  g_free (inside);
+  g_free (outside);
+}
+
+static void
+cogl_pango_renderer_rasterize_glyph (CoglPangoDirtyGlyph *dirty)
+{
+  cairo_t *cr;
+  cairo_glyph_t cairo_glyph;
+
+  if (dirty->distance_field)
+    {
+      cogl_pango_renderer_rasterize_distance_field (dirty);
+      return;
+    }
+
+  dirty->surface = cairo_image_surface_create (dirty->format,
+                                               dirty->draw_width,
+                                               dirty->draw_height);
+  cr = cairo_create (dirty->surface);
+
+  cairo_set_scaled_font (cr, dirty->scaled_font);
+
+  cairo_set_source_rgba (cr, 1.0, 1.0, 1.0, 1.0);
+
+  cairo_glyph.x = -dirty->draw_x;
+  cairo_glyph.y = -dirty->draw_y;
   /* The PangoCairo glyph numbers directly map to Cairo glyph
      numbers */
-  cairo_glyph.index = glyph;
+  cairo_glyph.index = dirty->glyph;
   cairo_show_glyphs (cr, &cairo_glyph, 1);
 
   cairo_destroy (cr);
-  cairo_surface_flush (surface);
+  cairo_surface_flush (dirty->surface);
+}
+
+/* Below this many glyphs handing them to other threads costs more
+   than it saves */
+#define MIN_GLYPHS_PER_THREAD 16
+#define MAX_RASTERIZE_THREADS 4
 
-  /* Copy the glyph to the texture */
-  cogl_texture_set_region (value->texture,
-                           0, /* src_x */
-                           0, /* src_y */
-                           value->tx_pixel, /* dst_x */
-                           value->ty_pixel, /* dst_y */
-                           value->draw_width, /* dst_width */
-                           value->draw_height, /* dst_height */
-                           value->draw_width, /* width */
-                           value->draw_height, /* height */
-                           format_cogl,
-                           cairo_image_surface_get_stride (surface),
-                           cairo_image_surface_get_data (surface));
+typedef struct
+{
+  GMutex mutex;
+  GCond cond;
+  int n_pending;
+} CoglPangoRasterizeBatch;
+
+typedef struct
+{
+  CoglPangoRasterizeBatch *batch;
+  CoglPangoDirtyGlyph *glyphs;
+  unsigned int n_glyphs;
+} CoglPangoRasterizeJob;
+
+static void
+cogl_pango_rasterize_job_run (void *data,
+                              void *user_data)
+{
+  CoglPangoRasterizeJob *job = data;
+  CoglPangoRasterizeBatch *batch = job->batch;
+  unsigned int i;
+
+  for (i = 0; i < job->n_glyphs; i++)
+    cogl_pango_renderer_rasterize_glyph (&job->glyphs[i]);
+
+  g_mutex_lock (&batch->mutex);
+  if (--batch->n_pending == 0)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->mutex);
+}
+
+static GThreadPool *
+get_rasterize_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  static CoglBool initialized = FALSE;
+
+  if (!initialized)
+    {
+      int n_threads = MIN (g_get_num_processors () - 1,
+                           MAX_RASTERIZE_THREADS);
+
+      if (n_threads > 0)
+        pool = g_thread_pool_new (cogl_pango_rasterize_job_run, NULL,
+                                  n_threads, FALSE, NULL);
+
+      initialized = TRUE;
+    }
+
+  return pool;
+}
+
+/* A layout in a script with many glyphs, or any text in a font size
+   not seen before, can miss the cache for hundreds of glyphs at once.
+   Their places in the atlases are settled by now so they are drawn in
+   parallel, the main thread taking its share, and only uploaded here */
+static void
+cogl_pango_renderer_rasterize_dirty_glyphs (CoglPangoRenderer *priv)
+{
+  CoglPangoDirtyGlyph *glyphs = (CoglPangoDirtyGlyph *) priv->dirty_glyphs->data;
+  unsigned int n_glyphs = priv->dirty_glyphs->len;
+  GThreadPool *pool = NULL;
+  unsigned int n_jobs = 1;
+  unsigned int i;
+
+  if (n_glyphs >= 2 * MIN_GLYPHS_PER_THREAD)
+    pool = get_rasterize_pool ();
+
+  if (pool != NULL)
+    n_jobs = MIN (n_glyphs / MIN_GLYPHS_PER_THREAD,
+                  g_thread_pool_get_max_threads (pool) + 1);
+
+  if (n_jobs > 1)
+    {
+      CoglPangoRasterizeJob *jobs = g_newa (CoglPangoRasterizeJob, n_jobs);
+      CoglPangoRasterizeBatch batch;
+      unsigned int start = 0;
+
+      g_mutex_init (&batch.mutex);
+      g_cond_init (&batch.cond);
+      batch.n_pending = n_jobs - 1;
+
+      for (i = 0; i < n_jobs; i++)
+        {
+          unsigned int end = (unsigned int) ((guint64) n_glyphs * (i + 1) / n_jobs);
+
+          jobs[i].batch = &batch;
+          jobs[i].glyphs = glyphs + start;
+          jobs[i].n_glyphs = end - start;
+          start = end;
+
+          if (i > 0)
+            g_thread_pool_push (pool, &jobs[i], NULL);
+        }
+
+      for (i = 0; i < jobs[0].n_glyphs; i++)
+        cogl_pango_renderer_rasterize_glyph (&jobs[0].glyphs[i]);
 
-  cairo_surface_destroy (surface);
+      g_mutex_lock (&batch.mutex);
+      while (batch.n_pending > 0)
+        g_cond_wait (&batch.cond, &batch.mutex);
+      g_mutex_unlock (&batch.mutex);
+
+      g_mutex_clear (&batch.mutex);
+      g_cond_clear (&batch.cond);
+    }
+  else
+    {
+      for (i = 0; i < n_glyphs; i++)
+        cogl_pango_renderer_rasterize_glyph (&glyphs[i]);
+    }
+
+  for (i = 0; i < n_glyphs; i++)
+    {
+      CoglPangoDirtyGlyph *dirty = &glyphs[i];
+      CoglPangoGlyphCacheValue *value = dirty->value;
+
+      /* Copy the glyph to the texture */
+      cogl_texture_set_region (value->texture,
+                               0, /* src_x */
+                               0, /* src_y */
+                               value->tx_pixel, /* dst_x */
+                               value->ty_pixel, /* dst_y */
+                               value->tex_width, /* dst_width */
+                               value->tex_height, /* dst_height */
+                               value->tex_width, /* width */
+                               value->tex_height, /* height */
+                               dirty->format_cogl,
+                               cairo_image_surface_get_stride (dirty->surface),
+                               cairo_image_surface_get_data (dirty->surface));
+
+      cairo_surface_destroy (dirty->surface);
+      cairo_scaled_font_destroy (dirty->scaled_font);
+    }
+
+  g_array_set_size (priv->dirty_glyphs, 0);
 }
 
 static void
@@ -676,9 +1210,15 @@ static void
 _cogl_pango_set_dirty_glyphs (CoglPangoRenderer *priv)
 {
   _cogl_pango_glyph_cache_set_dirty_glyphs
-    (priv->mipmap_caches.glyph_cache, cogl_pango_renderer_set_dirty_glyph);
+    (priv->mipmap_caches.glyph_cache, cogl_pango_renderer_set_dirty_glyph, priv);
   _cogl_pango_glyph_cache_set_dirty_glyphs
-    (priv->no_mipmap_caches.glyph_cache, cogl_pango_renderer_set_dirty_glyph);
+    (priv->no_mipmap_caches.glyph_cache, cogl_pango_renderer_set_dirty_glyph, priv);
+  _cogl_pango_glyph_cache_set_dirty_glyphs
+    (priv->distance_field_caches.glyph_cache,
+     cogl_pango_renderer_set_dirty_distance_field_glyph, priv);
+
+  if (priv->dirty_glyphs->len > 0)
+    cogl_pango_renderer_rasterize_dirty_glyphs (priv);
 }
 
 static void
@@ -117,6 +117,22 @@ cogl_pango_font_map_set_resolution (CoglPangoFontMap *font_map,
 void
 cogl_pango_font_map_clear_glyph_cache (CoglPangoFontMap *font_map);
 
+/**
+ * cogl_pango_font_map_get_glyph_cache_stats:
+ * @font_map: a #CoglPangoFontMap
+ * @stats: (out): return location for the statistics
+ *
+ * Retrieves statistics about the glyph cache of @font_map, covering
+ * both the mipmapped and the non-mipmapped glyphs. Evictions count
+ * glyphs dropped to make room for others. The counts restart when the
+ * cache is cleared.
+ *
+ * Stability: Unstable
+ */
+void
+cogl_pango_font_map_get_glyph_cache_stats (CoglPangoFontMap *font_map,
+                                           CoglCacheStats *stats);
+
 /**
  * cogl_pango_ensure_glyph_cache_for_layout:
  * @layout: A #PangoLayout
@@ -160,6 +176,38 @@ cogl_pango_font_map_set_use_mipmapping (CoglPangoFontMap *font_map,
 CoglBool
 cogl_pango_font_map_get_use_mipmapping (CoglPangoFontMap *font_map);
 
+/**
+ * cogl_pango_font_map_set_use_distance_field:
+ * @font_map: a #CoglPangoFontMap
+ * @value: %TRUE to draw magnified text from distance fields
+ *
+ * Sets whether the renderer for the passed font map should draw a
+ * #PangoLayout that is scaled up, such as during a zoom animation,
+ * from signed distance fields of its glyphs, which keep the outlines
+ * sharp at any magnification. Text at its size or scaled down is
+ * still drawn from the hinted glyphs. This has no effect unless GLSL
+ * is supported.
+ *
+ * Stability: Unstable
+ */
+void
+cogl_pango_font_map_set_use_distance_field (CoglPangoFontMap *font_map,
+                                            CoglBool value);
+
+/**
+ * cogl_pango_font_map_get_use_distance_field:
+ * @font_map: a #CoglPangoFontMap
+ *
+ * Retrieves whether the #CoglPangoRenderer used by @font_map draws
+ * magnified text from distance fields.
+ *
+ * Return value: %TRUE if distance fields are used, %FALSE otherwise.
+ *
+ * Stability: Unstable
+ */
+CoglBool
+cogl_pango_font_map_get_use_distance_field (CoglPangoFontMap *font_map);
+
 /**
  * cogl_pango_font_map_get_renderer:
  * @font_map: a #CoglPangoFontMap
@@ -71,8 +71,6 @@ struct _CoglPath
   CoglPathData *data;
 };
 
-#define COGL_PATH_N_ATTRIBUTES 2
-
 struct _CoglPathData
 {
   unsigned int         ref_count;
@@ -89,15 +87,13 @@ struct _CoglPathData
   floatVec2            path_nodes_min;
   floatVec2            path_nodes_max;
 
-  CoglAttributeBuffer *fill_attribute_buffer;
-  CoglIndices         *fill_vbo_indices;
-  unsigned int         fill_vbo_n_indices;
-  CoglAttribute       *fill_attributes[COGL_PATH_N_ATTRIBUTES + 1];
+  /* The geometry is shared with other paths of the same shape through
+     the context's path cache. It is relative to path_nodes_min so it
+     has to be drawn translated by that */
   CoglPrimitive       *fill_primitive;
 
-  CoglAttributeBuffer *stroke_attribute_buffer;
-  CoglAttribute      **stroke_attributes;
-  unsigned int         stroke_n_attributes;
+  CoglPrimitive      **stroke_primitives;
+  unsigned int         stroke_n_primitives;
 
   /* This is used as an optimisation for when the path contains a
      single contour specified using cogl2_path_rectangle. Cogl is more
@@ -108,6 +104,21 @@ struct _CoglPathData
   CoglBool             is_rectangle;
 };
 
+typedef struct
+{
+  unsigned int n_entries;
+  /* Approximate size of the vertex and index data in bytes */
+  size_t size;
+
+  unsigned int hits;
+  unsigned int misses;
+  unsigned int n_evictions;
+} CoglPathCacheStats;
+
+void
+_cogl_path_get_cache_stats (CoglContext *context,
+                            CoglPathCacheStats *stats);
+
 void
 _cogl_add_path_to_stencil_buffer (CoglPath  *path,
                                   CoglBool   merge,
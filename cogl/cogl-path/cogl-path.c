@@ -57,11 +57,52 @@
 
 #define _COGL_MAX_BEZ_RECURSE_DEPTH 16
 
+/* Limits on the tesselated geometry kept alive by the path cache */
+#define COGL_PATH_CACHE_MAX_ENTRIES 128
+#define COGL_PATH_CACHE_MAX_SIZE (2 * 1024 * 1024)
+
+typedef enum
+{
+  COGL_PATH_CACHE_FILL_EVEN_ODD,
+  COGL_PATH_CACHE_FILL_NON_ZERO,
+  COGL_PATH_CACHE_STROKE
+} CoglPathCacheType;
+
+/* The tesselated geometry of a path, keyed by its nodes with the
+   minimum of the path moved to the origin so that translated copies
+   of a shape share the same entry */
+typedef struct
+{
+  CoglPathCacheType type;
+  unsigned int hash;
+  unsigned int n_nodes;
+  CoglPathNode *nodes;
+
+  CoglPrimitive **primitives;
+  unsigned int n_primitives;
+  size_t size;
+
+  /* Link in the cache's LRU queue */
+  GList link;
+} CoglPathCacheEntry;
+
+typedef struct
+{
+  /* Set of CoglPathCacheEntries */
+  GHashTable *entries;
+  /* Most recently used entry at the head */
+  GQueue lru;
+  size_t size;
+
+  unsigned int hits;
+  unsigned int misses;
+  unsigned int n_evictions;
+} CoglPathCache;
+
 static void _cogl_path_free (CoglPath *path);
 
-static void _cogl_path_build_fill_attribute_buffer (CoglPath *path);
 static CoglPrimitive *_cogl_path_get_fill_primitive (CoglPath *path);
-static void _cogl_path_build_stroke_attribute_buffer (CoglPath *path);
+static void _cogl_path_get_stroke_primitives (CoglPath *path);
 
 COGL_OBJECT_DEFINE (Path, path);
 COGL_GTYPE_DEFINE_CLASS (Path, path);
@@ -71,33 +112,20 @@ _cogl_path_data_clear_vbos (CoglPathData *data)
 {
   int i;
 
-  if (data->fill_attribute_buffer)
-    {
-      cogl_object_unref (data->fill_attribute_buffer);
-      cogl_object_unref (data->fill_vbo_indices);
-
-      for (i = 0; i < COGL_PATH_N_ATTRIBUTES; i++)
-        cogl_object_unref (data->fill_attributes[i]);
-
-      data->fill_attribute_buffer = NULL;
-    }
-
   if (data->fill_primitive)
     {
       cogl_object_unref (data->fill_primitive);
       data->fill_primitive = NULL;
     }
 
-  if (data->stroke_attribute_buffer)
+  if (data->stroke_primitives)
     {
-      cogl_object_unref (data->stroke_attribute_buffer);
-
-      for (i = 0; i < data->stroke_n_attributes; i++)
-        cogl_object_unref (data->stroke_attributes[i]);
+      for (i = 0; i < data->stroke_n_primitives; i++)
+        cogl_object_unref (data->stroke_primitives[i]);
 
-      free (data->stroke_attributes);
+      free (data->stroke_primitives);
 
-      data->stroke_attribute_buffer = NULL;
+      data->stroke_primitives = NULL;
     }
 }
 
@@ -133,9 +161,8 @@ _cogl_path_modify (CoglPath *path)
                            old_data->path_nodes->data,
                            old_data->path_nodes->len);
 
-      path->data->fill_attribute_buffer = NULL;
       path->data->fill_primitive = NULL;
-      path->data->stroke_attribute_buffer = NULL;
+      path->data->stroke_primitives = NULL;
       path->data->ref_count = 1;
 
       _cogl_path_data_unref (old_data);
@@ -214,6 +241,33 @@ _cogl_path_add_node (CoglPath *path,
   data->is_rectangle = FALSE;
 }
 
+/* Draws primitives of the path's cached geometry, which is relative
+   to the minimum of the path */
+static void
+_cogl_path_draw_primitives (CoglPath *path,
+                            CoglFramebuffer *framebuffer,
+                            CoglPipeline *pipeline,
+                            CoglPrimitive **primitives,
+                            unsigned int n_primitives,
+                            CoglDrawFlags flags)
+{
+  const floatVec2 *offset = &path->data->path_nodes_min;
+  CoglBool translate = offset->x != 0.0f || offset->y != 0.0f;
+  unsigned int i;
+
+  if (translate)
+    {
+      cogl_framebuffer_push_matrix (framebuffer);
+      cogl_framebuffer_translate (framebuffer, offset->x, offset->y, 0.0f);
+    }
+
+  for (i = 0; i < n_primitives; i++)
+    _cogl_primitive_draw (primitives[i], framebuffer, pipeline, flags);
+
+  if (translate)
+    cogl_framebuffer_pop_matrix (framebuffer);
+}
+
 static void
 _cogl_path_stroke_nodes (CoglPath *path,
                          CoglFramebuffer *framebuffer,
@@ -221,9 +275,6 @@ _cogl_path_stroke_nodes (CoglPath *path,
 {
   CoglPathData *data;
   CoglPipeline *copy = NULL;
-  unsigned int path_start;
-  int path_num = 0;
-  CoglPathNode *node;
 
   _COGL_RETURN_IF_FAIL (cogl_is_path (path));
   _COGL_RETURN_IF_FAIL (cogl_is_framebuffer (framebuffer));
@@ -241,26 +292,12 @@ _cogl_path_stroke_nodes (CoglPath *path,
       pipeline = copy;
     }
 
-  _cogl_path_build_stroke_attribute_buffer (path);
-
-  for (path_start = 0;
-       path_start < data->path_nodes->len;
-       path_start += node->path_size)
-    {
-      CoglPrimitive *primitive;
+  _cogl_path_get_stroke_primitives (path);
 
-      node = &g_array_index (data->path_nodes, CoglPathNode, path_start);
-
-      primitive =
-        cogl_primitive_new_with_attributes (COGL_VERTICES_MODE_LINE_STRIP,
-                                            node->path_size,
-                                            &data->stroke_attributes[path_num],
-                                            1);
-      cogl_primitive_draw (primitive, framebuffer, pipeline);
-      cogl_object_unref (primitive);
-
-      path_num++;
-    }
+  _cogl_path_draw_primitives (path, framebuffer, pipeline,
+                              data->stroke_primitives,
+                              data->stroke_n_primitives,
+                              0 /* flags */);
 
   if (copy)
     cogl_object_unref (copy);
@@ -381,7 +418,8 @@ _cogl_path_fill_nodes (CoglPath *path,
 
       primitive = _cogl_path_get_fill_primitive (path);
 
-      _cogl_primitive_draw (primitive, framebuffer, pipeline, flags);
+      _cogl_path_draw_primitives (path, framebuffer, pipeline,
+                                  &primitive, 1, flags);
     }
 }
 
@@ -919,9 +957,8 @@ cogl2_path_new (void)
   data->fill_rule = COGL_PATH_FILL_RULE_EVEN_ODD;
   data->path_nodes = g_array_new (FALSE, FALSE, sizeof (CoglPathNode));
   data->last_path = 0;
-  data->fill_attribute_buffer = NULL;
-  data->stroke_attribute_buffer = NULL;
   data->fill_primitive = NULL;
+  data->stroke_primitives = NULL;
   data->is_rectangle = FALSE;
 
   return _cogl_path_object_new (path);
@@ -1299,27 +1336,39 @@ _cogl_path_tesselator_combine (double coords[3],
     }
 }
 
-static void
-_cogl_path_build_fill_attribute_buffer (CoglPath *path)
+static CoglPrimitive *
+_cogl_path_build_fill_primitive (CoglContext *context,
+                                 CoglPathFillRule fill_rule,
+                                 const CoglPathNode *nodes,
+                                 unsigned int n_nodes,
+                                 size_t *size)
 {
   CoglPathTesselator tess;
   unsigned int path_start = 0;
-  CoglPathData *data = path->data;
+  CoglAttributeBuffer *attribute_buffer;
+  CoglAttribute *attributes[2];
+  CoglIndices *indices;
+  CoglPrimitive *primitive;
+  floatVec2 max = { 0.0f, 0.0f };
   int i;
 
-  /* If we've already got a vbo then we don't need to do anything */
-  if (data->fill_attribute_buffer)
-    return;
+  /* The nodes have been moved so that the minimum is at the origin */
+  for (i = 0; i < n_nodes; i++)
+    {
+      if (nodes[i].x > max.x)
+        max.x = nodes[i].x;
+      if (nodes[i].y > max.y)
+        max.y = nodes[i].y;
+    }
 
   tess.primitive_type = FALSE;
 
   /* Generate a vertex for each point on the path */
   tess.vertices = g_array_new (FALSE, FALSE, sizeof (CoglPathTesselatorVertex));
-  g_array_set_size (tess.vertices, data->path_nodes->len);
-  for (i = 0; i < data->path_nodes->len; i++)
+  g_array_set_size (tess.vertices, n_nodes);
+  for (i = 0; i < n_nodes; i++)
     {
-      CoglPathNode *node =
-        &g_array_index (data->path_nodes, CoglPathNode, i);
+      const CoglPathNode *node = nodes + i;
       CoglPathTesselatorVertex *vertex =
         &g_array_index (tess.vertices, CoglPathTesselatorVertex, i);
 
@@ -1329,25 +1378,23 @@ _cogl_path_build_fill_attribute_buffer (CoglPath *path)
       /* Add texture coordinates so that a texture would be drawn to
          fit the bounding box of the path and then cropped by the
          path */
-      if (data->path_nodes_min.x == data->path_nodes_max.x)
+      if (max.x == 0.0f)
         vertex->s = 0.0f;
       else
-        vertex->s = ((node->x - data->path_nodes_min.x)
-                     / (data->path_nodes_max.x - data->path_nodes_min.x));
-      if (data->path_nodes_min.y == data->path_nodes_max.y)
+        vertex->s = node->x / max.x;
+      if (max.y == 0.0f)
         vertex->t = 0.0f;
       else
-        vertex->t = ((node->y - data->path_nodes_min.y)
-                     / (data->path_nodes_max.y - data->path_nodes_min.y));
+        vertex->t = node->y / max.y;
     }
 
   tess.indices_type =
-    _cogl_path_tesselator_get_indices_type_for_size (data->path_nodes->len);
+    _cogl_path_tesselator_get_indices_type_for_size (n_nodes);
   _cogl_path_tesselator_allocate_indices_array (&tess);
 
   tess.glu_tess = gluNewTess ();
 
-  if (data->fill_rule == COGL_PATH_FILL_RULE_EVEN_ODD)
+  if (fill_rule == COGL_PATH_FILL_RULE_EVEN_ODD)
     gluTessProperty (tess.glu_tess, GLU_TESS_WINDING_RULE,
                      GLU_TESS_WINDING_ODD);
   else
@@ -1368,10 +1415,9 @@ _cogl_path_build_fill_attribute_buffer (CoglPath *path)
 
   gluTessBeginPolygon (tess.glu_tess, &tess);
 
-  while (path_start < data->path_nodes->len)
+  while (path_start < n_nodes)
     {
-      CoglPathNode *node =
-        &g_array_index (data->path_nodes, CoglPathNode, path_start);
+      const CoglPathNode *node = nodes + path_start;
 
       gluTessBeginContour (tess.glu_tess);
 
@@ -1391,54 +1437,347 @@ _cogl_path_build_fill_attribute_buffer (CoglPath *path)
 
   gluDeleteTess (tess.glu_tess);
 
-  data->fill_attribute_buffer =
-    cogl_attribute_buffer_new (data->context,
+  attribute_buffer =
+    cogl_attribute_buffer_new (context,
                                sizeof (CoglPathTesselatorVertex) *
                                tess.vertices->len,
                                tess.vertices->data);
-  g_array_free (tess.vertices, TRUE);
 
-  data->fill_attributes[0] =
-    cogl_attribute_new (data->fill_attribute_buffer,
+  attributes[0] =
+    cogl_attribute_new (attribute_buffer,
                         "cogl_position_in",
                         sizeof (CoglPathTesselatorVertex),
                         G_STRUCT_OFFSET (CoglPathTesselatorVertex, x),
                         2, /* n_components */
                         COGL_ATTRIBUTE_TYPE_FLOAT);
-  data->fill_attributes[1] =
-    cogl_attribute_new (data->fill_attribute_buffer,
+  attributes[1] =
+    cogl_attribute_new (attribute_buffer,
                         "cogl_tex_coord0_in",
                         sizeof (CoglPathTesselatorVertex),
                         G_STRUCT_OFFSET (CoglPathTesselatorVertex, s),
                         2, /* n_components */
                         COGL_ATTRIBUTE_TYPE_FLOAT);
 
-  data->fill_vbo_indices = cogl_indices_new (data->context,
-                                             tess.indices_type,
-                                             tess.indices->data,
-                                             tess.indices->len);
-  data->fill_vbo_n_indices = tess.indices->len;
+  indices = cogl_indices_new (context,
+                              tess.indices_type,
+                              tess.indices->data,
+                              tess.indices->len);
+
+  primitive = cogl_primitive_new_with_attributes (COGL_VERTICES_MODE_TRIANGLES,
+                                                  tess.indices->len,
+                                                  attributes,
+                                                  2 /* n_attributes */);
+  cogl_primitive_set_indices (primitive, indices, tess.indices->len);
+
+  *size = (sizeof (CoglPathTesselatorVertex) * tess.vertices->len +
+           g_array_get_element_size (tess.indices) * tess.indices->len);
+
+  g_array_free (tess.vertices, TRUE);
   g_array_free (tess.indices, TRUE);
+
+  cogl_object_unref (indices);
+  cogl_object_unref (attributes[0]);
+  cogl_object_unref (attributes[1]);
+  cogl_object_unref (attribute_buffer);
+
+  return primitive;
+}
+
+static CoglPrimitive **
+_cogl_path_build_stroke_primitives (CoglContext *context,
+                                    const CoglPathNode *nodes,
+                                    unsigned int n_nodes,
+                                    unsigned int *n_primitives,
+                                    size_t *size)
+{
+  CoglAttributeBuffer *attribute_buffer;
+  CoglBuffer *buffer;
+  CoglPrimitive **primitives;
+  unsigned int n_sub_paths = 0;
+  unsigned int path_start;
+  const CoglPathNode *node;
+  floatVec2 *buffer_p;
+  unsigned int i;
+
+  attribute_buffer =
+    cogl_attribute_buffer_new_with_size (context,
+                                         n_nodes * sizeof (floatVec2));
+
+  buffer = COGL_BUFFER (attribute_buffer);
+  buffer_p = _cogl_buffer_map_for_fill_or_fallback (buffer);
+
+  /* Copy the vertices in and count the number of sub paths. Each sub
+     path will form a separate primitive so we can paint the disjoint
+     line strips */
+  for (path_start = 0; path_start < n_nodes; path_start += node->path_size)
+    {
+      node = nodes + path_start;
+
+      for (i = 0; i < node->path_size; i++)
+        {
+          buffer_p[path_start + i].x = node[i].x;
+          buffer_p[path_start + i].y = node[i].y;
+        }
+
+      n_sub_paths++;
+    }
+
+  _cogl_buffer_unmap_for_fill_or_fallback (buffer);
+
+  primitives = g_new (CoglPrimitive *, n_sub_paths);
+
+  /* Now we can loop the sub paths again to create the primitives */
+  for (i = 0, path_start = 0;
+       path_start < n_nodes;
+       i++, path_start += node->path_size)
+    {
+      CoglAttribute *attribute;
+
+      node = nodes + path_start;
+
+      attribute = cogl_attribute_new (attribute_buffer,
+                                      "cogl_position_in",
+                                      sizeof (floatVec2),
+                                      path_start * sizeof (floatVec2),
+                                      2, /* n_components */
+                                      COGL_ATTRIBUTE_TYPE_FLOAT);
+
+      primitives[i] =
+        cogl_primitive_new_with_attributes (COGL_VERTICES_MODE_LINE_STRIP,
+                                            node->path_size,
+                                            &attribute,
+                                            1);
+
+      cogl_object_unref (attribute);
+    }
+
+  cogl_object_unref (attribute_buffer);
+
+  *n_primitives = n_sub_paths;
+  *size = n_nodes * sizeof (floatVec2);
+
+  return primitives;
+}
+
+static unsigned int
+_cogl_path_cache_entry_hash (const void *key)
+{
+  const CoglPathCacheEntry *entry = key;
+
+  return entry->hash;
+}
+
+static CoglBool
+_cogl_path_cache_entry_equal (const void *a,
+                              const void *b)
+{
+  const CoglPathCacheEntry *entry_a = a;
+  const CoglPathCacheEntry *entry_b = b;
+
+  return (entry_a->hash == entry_b->hash &&
+          entry_a->type == entry_b->type &&
+          entry_a->n_nodes == entry_b->n_nodes &&
+          memcmp (entry_a->nodes, entry_b->nodes,
+                  sizeof (CoglPathNode) * entry_a->n_nodes) == 0);
+}
+
+static void
+_cogl_path_cache_entry_free (CoglPathCacheEntry *entry)
+{
+  unsigned int i;
+
+  for (i = 0; i < entry->n_primitives; i++)
+    cogl_object_unref (entry->primitives[i]);
+
+  free (entry->primitives);
+  free (entry->nodes);
+  g_slice_free (CoglPathCacheEntry, entry);
+}
+
+static void
+_cogl_path_cache_free (CoglPathCache *cache)
+{
+  GList *l, *next;
+
+  for (l = cache->lru.head; l; l = next)
+    {
+      next = l->next;
+      _cogl_path_cache_entry_free (l->data);
+    }
+
+  g_hash_table_destroy (cache->entries);
+  g_slice_free (CoglPathCache, cache);
+}
+
+static CoglPathCache *
+_cogl_path_cache_get_for_context (CoglContext *context)
+{
+  static CoglUserDataKey path_cache_key;
+  CoglPathCache *cache;
+
+  cache = cogl_object_get_user_data (COGL_OBJECT (context), &path_cache_key);
+
+  if (cache == NULL)
+    {
+      cache = g_slice_new0 (CoglPathCache);
+      cache->entries = g_hash_table_new (_cogl_path_cache_entry_hash,
+                                         _cogl_path_cache_entry_equal);
+      g_queue_init (&cache->lru);
+
+      cogl_object_set_user_data (COGL_OBJECT (context),
+                                 &path_cache_key,
+                                 cache,
+                                 (CoglUserDataDestroyCallback)
+                                 _cogl_path_cache_free);
+    }
+
+  return cache;
+}
+
+static void
+_cogl_path_cache_evict (CoglPathCache *cache,
+                        CoglPathCacheEntry *entry)
+{
+  g_hash_table_remove (cache->entries, entry);
+  g_queue_unlink (&cache->lru, &entry->link);
+  cache->size -= entry->size;
+  cache->n_evictions++;
+
+  _cogl_path_cache_entry_free (entry);
+}
+
+/* Returns the geometry for the path, tesselating it only if no path
+   of the same shape has been drawn recently. The entry is only valid
+   until the cache is used again */
+static CoglPathCacheEntry *
+_cogl_path_cache_lookup (CoglPathData *data,
+                         CoglPathCacheType type)
+{
+  CoglPathCache *cache = _cogl_path_cache_get_for_context (data->context);
+  CoglPathCacheEntry lookup_entry, *entry;
+  unsigned int i;
+
+  lookup_entry.type = type;
+  lookup_entry.n_nodes = data->path_nodes->len;
+  lookup_entry.nodes = g_new (CoglPathNode, lookup_entry.n_nodes);
+
+  for (i = 0; i < lookup_entry.n_nodes; i++)
+    {
+      const CoglPathNode *node =
+        &g_array_index (data->path_nodes, CoglPathNode, i);
+
+      lookup_entry.nodes[i].x = node->x - data->path_nodes_min.x;
+      lookup_entry.nodes[i].y = node->y - data->path_nodes_min.y;
+      lookup_entry.nodes[i].path_size = node->path_size;
+    }
+
+  lookup_entry.hash = _cogl_util_one_at_a_time_hash (type,
+                                                     lookup_entry.nodes,
+                                                     sizeof (CoglPathNode) *
+                                                     lookup_entry.n_nodes);
+
+  entry = g_hash_table_lookup (cache->entries, &lookup_entry);
+
+  if (entry)
+    {
+      free (lookup_entry.nodes);
+
+      g_queue_unlink (&cache->lru, &entry->link);
+      g_queue_push_head_link (&cache->lru, &entry->link);
+      cache->hits++;
+
+      return entry;
+    }
+
+  entry = g_slice_dup (CoglPathCacheEntry, &lookup_entry);
+  entry->link.data = entry;
+  entry->link.prev = entry->link.next = NULL;
+
+  if (type == COGL_PATH_CACHE_STROKE)
+    entry->primitives =
+      _cogl_path_build_stroke_primitives (data->context,
+                                          entry->nodes,
+                                          entry->n_nodes,
+                                          &entry->n_primitives,
+                                          &entry->size);
+  else
+    {
+      entry->primitives = g_new (CoglPrimitive *, 1);
+      entry->primitives[0] =
+        _cogl_path_build_fill_primitive (data->context,
+                                         data->fill_rule,
+                                         entry->nodes,
+                                         entry->n_nodes,
+                                         &entry->size);
+      entry->n_primitives = 1;
+    }
+
+  entry->size += sizeof (CoglPathNode) * entry->n_nodes;
+
+  g_hash_table_add (cache->entries, entry);
+  g_queue_push_head_link (&cache->lru, &entry->link);
+  cache->size += entry->size;
+  cache->misses++;
+
+  /* The paths using an entry keep their own references to its
+     primitives so it can be dropped at any time */
+  while (cache->lru.tail != &entry->link &&
+         (cache->lru.length > COGL_PATH_CACHE_MAX_ENTRIES ||
+          cache->size > COGL_PATH_CACHE_MAX_SIZE))
+    _cogl_path_cache_evict (cache, cache->lru.tail->data);
+
+  return entry;
+}
+
+void
+_cogl_path_get_cache_stats (CoglContext *context,
+                            CoglPathCacheStats *stats)
+{
+  CoglPathCache *cache = _cogl_path_cache_get_for_context (context);
+
+  stats->n_entries = cache->lru.length;
+  stats->size = cache->size;
+  stats->hits = cache->hits;
+  stats->misses = cache->misses;
+  stats->n_evictions = cache->n_evictions;
 }
 
 static CoglPrimitive *
 _cogl_path_get_fill_primitive (CoglPath *path)
 {
-  if (path->data->fill_primitive)
-    return path->data->fill_primitive;
+  CoglPathData *data = path->data;
+  CoglPathCacheEntry *entry;
+
+  if (data->fill_primitive)
+    return data->fill_primitive;
+
+  entry = _cogl_path_cache_lookup (data,
+                                   data->fill_rule ==
+                                   COGL_PATH_FILL_RULE_EVEN_ODD ?
+                                   COGL_PATH_CACHE_FILL_EVEN_ODD :
+                                   COGL_PATH_CACHE_FILL_NON_ZERO);
+
+  data->fill_primitive = cogl_object_ref (entry->primitives[0]);
+
+  return data->fill_primitive;
+}
+
+static void
+_cogl_path_get_stroke_primitives (CoglPath *path)
+{
+  CoglPathData *data = path->data;
+  CoglPathCacheEntry *entry;
+  unsigned int i;
 
-  _cogl_path_build_fill_attribute_buffer (path);
+  if (data->stroke_primitives)
+    return;
 
-  path->data->fill_primitive =
-    cogl_primitive_new_with_attributes (COGL_VERTICES_MODE_TRIANGLES,
-                                        path->data->fill_vbo_n_indices,
-                                        path->data->fill_attributes,
-                                        COGL_PATH_N_ATTRIBUTES);
-  cogl_primitive_set_indices (path->data->fill_primitive,
-                              path->data->fill_vbo_indices,
-                              path->data->fill_vbo_n_indices);
+  entry = _cogl_path_cache_lookup (data, COGL_PATH_CACHE_STROKE);
 
-  return path->data->fill_primitive;
+  data->stroke_primitives = g_new (CoglPrimitive *, entry->n_primitives);
+  for (i = 0; i < entry->n_primitives; i++)
+    data->stroke_primitives[i] = cogl_object_ref (entry->primitives[i]);
+  data->stroke_n_primitives = entry->n_primitives;
 }
 
 static CoglClipStack *
@@ -1465,13 +1804,33 @@ _cogl_clip_stack_push_from_path (CoglClipStack *stack,
   else
     {
       CoglPrimitive *primitive = _cogl_path_get_fill_primitive (path);
-
-      return _cogl_clip_stack_push_primitive (stack,
-                                              primitive,
-                                              x_1, y_1, x_2, y_2,
-                                              modelview_entry,
-                                              projection_entry,
-                                              viewport);
+      const floatVec2 *offset = &path->data->path_nodes_min;
+      CoglMatrixStack *matrix_stack;
+      CoglMatrix matrix, *matrix_p;
+      CoglMatrixEntry *entry;
+      CoglClipStack *ret;
+
+      /* The primitive is relative to the minimum of the path so the
+         clip has to be pushed with that translation added to the
+         modelview */
+      matrix_stack = cogl_matrix_stack_new (path->data->context);
+      matrix_p = cogl_matrix_entry_get (modelview_entry, &matrix);
+      cogl_matrix_stack_set (matrix_stack, matrix_p ? matrix_p : &matrix);
+      cogl_matrix_stack_translate (matrix_stack, offset->x, offset->y, 0.0f);
+      entry = cogl_matrix_entry_ref (cogl_matrix_stack_get_entry (matrix_stack));
+      cogl_object_unref (matrix_stack);
+
+      ret = _cogl_clip_stack_push_primitive (stack,
+                                             primitive,
+                                             0.0f, 0.0f,
+                                             x_2 - x_1, y_2 - y_1,
+                                             entry,
+                                             projection_entry,
+                                             viewport);
+
+      cogl_matrix_entry_unref (entry);
+
+      return ret;
     }
 }
 
@@ -1511,70 +1870,6 @@ cogl_clip_push_from_path (CoglPath *path)
   cogl_framebuffer_push_path_clip (cogl_get_draw_framebuffer (), path);
 }
 
-static void
-_cogl_path_build_stroke_attribute_buffer (CoglPath *path)
-{
-  CoglPathData *data = path->data;
-  CoglBuffer *buffer;
-  unsigned int n_attributes = 0;
-  unsigned int path_start;
-  CoglPathNode *node;
-  floatVec2 *buffer_p;
-  unsigned int i;
-
-  /* If we've already got a cached vbo then we don't need to do anything */
-  if (data->stroke_attribute_buffer)
-    return;
-
-  data->stroke_attribute_buffer =
-    cogl_attribute_buffer_new_with_size (data->context,
-                                         data->path_nodes->len *
-                                         sizeof (floatVec2));
-
-  buffer = COGL_BUFFER (data->stroke_attribute_buffer);
-  buffer_p = _cogl_buffer_map_for_fill_or_fallback (buffer);
-
-  /* Copy the vertices in and count the number of sub paths. Each sub
-     path will form a separate attribute so we can paint the disjoint
-     line strips */
-  for (path_start = 0;
-       path_start < data->path_nodes->len;
-       path_start += node->path_size)
-    {
-      node = &g_array_index (data->path_nodes, CoglPathNode, path_start);
-
-      for (i = 0; i < node->path_size; i++)
-        {
-          buffer_p[path_start + i].x = node[i].x;
-          buffer_p[path_start + i].y = node[i].y;
-        }
-
-      n_attributes++;
-    }
-
-  _cogl_buffer_unmap_for_fill_or_fallback (buffer);
-
-  data->stroke_attributes = g_new (CoglAttribute *, n_attributes);
-
-  /* Now we can loop the sub paths again to create the attributes */
-  for (i = 0, path_start = 0;
-       path_start < data->path_nodes->len;
-       i++, path_start += node->path_size)
-    {
-      node = &g_array_index (data->path_nodes, CoglPathNode, path_start);
-
-      data->stroke_attributes[i] =
-        cogl_attribute_new (data->stroke_attribute_buffer,
-                            "cogl_position_in",
-                            sizeof (floatVec2),
-                            path_start * sizeof (floatVec2),
-                            2, /* n_components */
-                            COGL_ATTRIBUTE_TYPE_FLOAT);
-    }
-
-  data->stroke_n_attributes = n_attributes;
-}
-
 /* XXX: deprecated */
 void
 cogl_framebuffer_fill_path (CoglFramebuffer *framebuffer,
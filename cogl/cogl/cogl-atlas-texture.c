@@ -206,7 +206,7 @@ _cogl_atlas_texture_create_atlas (CoglContext *ctx)
   static CoglUserDataKey atlas_private_key;
 
   CoglAtlas *atlas = _cogl_atlas_new (COGL_PIXEL_FORMAT_RGBA_8888,
-                                      0,
+                                      COGL_ATLAS_INCREMENTAL_MIGRATION,
                                       _cogl_atlas_texture_update_position_cb);
 
   _cogl_atlas_add_reorganize_callback (atlas,
@@ -1043,5 +1043,6 @@ cogl_atlas_texture_vtable =
     _cogl_atlas_texture_get_gl_format,
     _cogl_atlas_texture_get_type,
     NULL, /* is_foreign */
-    NULL /* set_auto_mipmap */
+    NULL /* set_auto_mipmap */,
+    NULL /* set_memory_category */
   };
@@ -45,6 +45,7 @@
 #include "cogl-framebuffer-private.h"
 #include "cogl-blit.h"
 #include "cogl-private.h"
+#include "cogl-texture-memory.h"
 
 #include <stdlib.h>
 
@@ -64,6 +65,12 @@ _cogl_atlas_new (CoglPixelFormat texture_format,
   atlas->texture = NULL;
   atlas->flags = flags;
   atlas->texture_format = texture_format;
+  atlas->memory_category = g_intern_static_string ("atlas");
+  atlas->max_width = 0;
+  atlas->max_height = 0;
+  atlas->n_grows = 0;
+  atlas->n_reorganizations = 0;
+  atlas->n_migrated_rectangles = 0;
   g_hook_list_init (&atlas->pre_reorganize_callbacks, sizeof (GHook));
   g_hook_list_init (&atlas->post_reorganize_callbacks, sizeof (GHook));
 
@@ -215,37 +222,60 @@ _cogl_atlas_get_initial_size (CoglPixelFormat format,
   *map_height = size;
 }
 
-static CoglRectangleMap *
-_cogl_atlas_create_map (CoglPixelFormat          format,
-                        unsigned int             map_width,
-                        unsigned int             map_height,
-                        unsigned int             n_textures,
-                        CoglAtlasRepositionData *textures)
+static CoglBool
+_cogl_atlas_size_supported (CoglAtlas *atlas,
+                            unsigned int width,
+                            unsigned int height)
 {
   GLenum gl_intformat;
   GLenum gl_format;
   GLenum gl_type;
 
-  _COGL_GET_CONTEXT (ctx, NULL);
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  if ((atlas->max_width && width > atlas->max_width) ||
+      (atlas->max_height && height > atlas->max_height))
+    return FALSE;
 
   ctx->driver_vtable->pixel_format_to_gl (ctx,
-                                          format,
+                                          atlas->texture_format,
                                           &gl_intformat,
                                           &gl_format,
                                           &gl_type);
 
-  /* Keep trying increasingly larger atlases until we can fit all of
-     the textures */
-  while (ctx->texture_driver->size_supported (ctx,
+  return ctx->texture_driver->size_supported (ctx,
                                               GL_TEXTURE_2D,
                                               gl_intformat,
                                               gl_format,
                                               gl_type,
-                                              map_width, map_height))
+                                              width, height);
+}
+
+static CoglRectangleMapPacking
+_cogl_atlas_get_packing (CoglAtlas *atlas)
+{
+  if ((atlas->flags & COGL_ATLAS_SKYLINE_PACKING))
+    return COGL_RECTANGLE_MAP_PACKING_SKYLINE;
+  else
+    return COGL_RECTANGLE_MAP_PACKING_TREE;
+}
+
+static CoglRectangleMap *
+_cogl_atlas_create_map (CoglAtlas               *atlas,
+                        unsigned int             map_width,
+                        unsigned int             map_height,
+                        unsigned int             n_textures,
+                        CoglAtlasRepositionData *textures)
+{
+  /* Keep trying increasingly larger atlases until we can fit all of
+     the textures */
+  while (_cogl_atlas_size_supported (atlas, map_width, map_height))
     {
-      CoglRectangleMap *new_atlas = _cogl_rectangle_map_new (map_width,
-                                                             map_height,
-                                                             NULL);
+      CoglRectangleMap *new_atlas =
+        _cogl_rectangle_map_new_with_packing (map_width,
+                                              map_height,
+                                              _cogl_atlas_get_packing (atlas),
+                                              NULL);
       unsigned int i;
 
       COGL_NOTE (ATLAS, "Trying to resize the atlas to %ux%u",
@@ -308,6 +338,7 @@ _cogl_atlas_create_texture (CoglAtlas *atlas,
 
       _cogl_texture_set_internal_format (COGL_TEXTURE (tex),
                                          atlas->texture_format);
+      COGL_TEXTURE (tex)->memory_category = atlas->memory_category;
 
       if (!cogl_texture_allocate (COGL_TEXTURE (tex), &ignore_error))
         {
@@ -326,6 +357,7 @@ _cogl_atlas_create_texture (CoglAtlas *atlas,
 
       _cogl_texture_set_internal_format (COGL_TEXTURE (tex),
                                          atlas->texture_format);
+      COGL_TEXTURE (tex)->memory_category = atlas->memory_category;
 
       if (!cogl_texture_allocate (COGL_TEXTURE (tex), &ignore_error))
         {
@@ -352,6 +384,40 @@ _cogl_atlas_compare_size_cb (const void *a,
   return a_size < b_size ? 1 : a_size > b_size ? -1 : 0;
 }
 
+static int
+_cogl_atlas_compare_height_cb (const void *a,
+                               const void *b)
+{
+  const CoglAtlasRepositionData *ta = a;
+  const CoglAtlasRepositionData *tb = b;
+  unsigned int a_height = ta->old_position.height;
+  unsigned int b_height = tb->old_position.height;
+
+  return a_height < b_height ? 1 : a_height > b_height ? -1 : 0;
+}
+
+static void
+_cogl_atlas_note_usage (CoglAtlas *atlas)
+{
+  CoglAtlasStats stats;
+
+  _cogl_atlas_get_stats (atlas, &stats);
+
+  COGL_NOTE (ATLAS, "%p: Atlas is %ix%i, has %i textures and is %i%% waste. "
+             "It has grown %u times and been reorganized %u times, "
+             "moving %u textures",
+             atlas,
+             stats.width,
+             stats.height,
+             stats.n_rectangles,
+             /* waste as a percentage */
+             (stats.width * stats.height - stats.used_space) * 100 /
+             (stats.width * stats.height),
+             stats.n_grows,
+             stats.n_reorganizations,
+             stats.n_migrated_rectangles);
+}
+
 static void
 _cogl_atlas_notify_pre_reorganize (CoglAtlas *atlas)
 {
@@ -364,6 +430,90 @@ _cogl_atlas_notify_post_reorganize (CoglAtlas *atlas)
   g_hook_list_invoke (&atlas->post_reorganize_callbacks, FALSE);
 }
 
+/* Grows the atlas so that the new rectangle fits in the added space,
+   keeping everything else where it is. This only needs one blit to
+   copy the old texture and the positions don't change */
+static CoglBool
+_cogl_atlas_grow (CoglAtlas *atlas,
+                  unsigned int width,
+                  unsigned int height,
+                  void *user_data)
+{
+  CoglAtlasGetRectanglesData data;
+  unsigned int old_width = _cogl_rectangle_map_get_width (atlas->map);
+  unsigned int old_height = _cogl_rectangle_map_get_height (atlas->map);
+  unsigned int map_width = old_width, map_height = old_height;
+  CoglRectangleMapEntry new_position;
+  CoglTexture2D *new_tex;
+  CoglBool added;
+  unsigned int i;
+
+  /* Both maps leave the space to the right of the old map and the
+     space below it free after growing, so the rectangle is sure to fit
+     if it fits in either of those */
+  do
+    {
+      _cogl_atlas_get_next_size (&map_width, &map_height);
+
+      if (!_cogl_atlas_size_supported (atlas, map_width, map_height))
+        return FALSE;
+    }
+  while ((width > map_width - old_width || height > map_height) &&
+         (width > old_width || height > map_height - old_height));
+
+  /* Let the users of the atlas know the texture is going to change */
+  _cogl_atlas_notify_pre_reorganize (atlas);
+
+  new_tex = _cogl_atlas_create_texture (atlas, map_width, map_height);
+  if (new_tex == NULL)
+    {
+      _cogl_atlas_notify_post_reorganize (atlas);
+      return FALSE;
+    }
+
+  COGL_NOTE (ATLAS, "%p: Atlas grown to %ux%u", atlas, map_width, map_height);
+
+  _cogl_rectangle_map_grow (atlas->map, map_width, map_height);
+  added = _cogl_rectangle_map_add (atlas->map, width, height,
+                                   user_data, &new_position);
+  g_assert (added);
+
+  if (!(atlas->flags & COGL_ATLAS_DISABLE_MIGRATION))
+    {
+      CoglBlitData blit_data;
+
+      _cogl_blit_begin (&blit_data, COGL_TEXTURE (new_tex), atlas->texture);
+      _cogl_blit (&blit_data, 0, 0, 0, 0, old_width, old_height);
+      _cogl_blit_end (&blit_data);
+    }
+
+  /* Every texture still needs to be pointed at the new texture. This
+     includes the one being added */
+  data.n_textures = 0;
+  data.textures = malloc (sizeof (CoglAtlasRepositionData) *
+                          _cogl_rectangle_map_get_n_rectangles (atlas->map));
+  _cogl_rectangle_map_foreach (atlas->map,
+                               _cogl_atlas_get_rectangles_cb,
+                               &data);
+
+  for (i = 0; i < data.n_textures; i++)
+    atlas->update_position_cb (data.textures[i].user_data,
+                               COGL_TEXTURE (new_tex),
+                               &data.textures[i].old_position);
+
+  free (data.textures);
+
+  cogl_object_unref (atlas->texture);
+  atlas->texture = COGL_TEXTURE (new_tex);
+
+  atlas->n_grows++;
+
+  _cogl_atlas_note_usage (atlas);
+  _cogl_atlas_notify_post_reorganize (atlas);
+
+  return TRUE;
+}
+
 CoglBool
 _cogl_atlas_reserve_space (CoglAtlas             *atlas,
                            unsigned int           width,
@@ -383,15 +533,7 @@ _cogl_atlas_reserve_space (CoglAtlas             *atlas,
                                user_data,
                                &new_position))
     {
-      COGL_NOTE (ATLAS, "%p: Atlas is %ix%i, has %i textures and is %i%% waste",
-                 atlas,
-                 _cogl_rectangle_map_get_width (atlas->map),
-                 _cogl_rectangle_map_get_height (atlas->map),
-                 _cogl_rectangle_map_get_n_rectangles (atlas->map),
-                 /* waste as a percentage */
-                 _cogl_rectangle_map_get_remaining_space (atlas->map) *
-                 100 / (_cogl_rectangle_map_get_width (atlas->map) *
-                        _cogl_rectangle_map_get_height (atlas->map)));
+      _cogl_atlas_note_usage (atlas);
 
       atlas->update_position_cb (user_data,
                                  atlas->texture,
@@ -400,6 +542,14 @@ _cogl_atlas_reserve_space (CoglAtlas             *atlas,
       return TRUE;
     }
 
+  if ((atlas->flags & COGL_ATLAS_INCREMENTAL_MIGRATION) &&
+      atlas->map &&
+      _cogl_atlas_grow (atlas, width, height, user_data))
+    return TRUE;
+
+  if ((atlas->flags & COGL_ATLAS_DISABLE_REORGANIZATION) && atlas->map)
+    return FALSE;
+
   /* If we make it here then we need to reorganize the atlas. First
      we'll notify any users of the atlas that this is going to happen
      so that for example in CoglAtlasTexture it can notify that the
@@ -431,9 +581,12 @@ _cogl_atlas_reserve_space (CoglAtlas             *atlas,
 
   /* The atlasing algorithm works a lot better if the rectangles are
      added in decreasing order of size so we'll first sort the
-     array */
+     array. The skyline works best with similar heights next to each
+     other so for that the height is used instead */
   qsort (data.textures, data.n_textures,
          sizeof (CoglAtlasRepositionData),
+         (atlas->flags & COGL_ATLAS_SKYLINE_PACKING) ?
+         _cogl_atlas_compare_height_cb :
          _cogl_atlas_compare_size_cb);
 
   /* Try to create a new atlas that can contain all of the textures */
@@ -455,7 +608,7 @@ _cogl_atlas_reserve_space (CoglAtlas             *atlas,
     _cogl_atlas_get_initial_size (atlas->texture_format,
                                   &map_width, &map_height);
 
-  new_map = _cogl_atlas_create_map (atlas->texture_format,
+  new_map = _cogl_atlas_create_map (atlas,
                                     map_width, map_height,
                                     data.n_textures, data.textures);
 
@@ -477,8 +630,6 @@ _cogl_atlas_reserve_space (CoglAtlas             *atlas,
     }
   else
     {
-      int waste;
-
       COGL_NOTE (ATLAS,
                  "%p: Atlas %s with size %ix%i",
                  atlas,
@@ -503,6 +654,10 @@ _cogl_atlas_reserve_space (CoglAtlas             *atlas,
                                user_data);
           _cogl_rectangle_map_free (atlas->map);
           cogl_object_unref (atlas->texture);
+
+          atlas->n_reorganizations++;
+          /* The new texture didn't need moving */
+          atlas->n_migrated_rectangles += data.n_textures - 1;
         }
       else
         /* We know there's only one texture so we can just directly
@@ -514,16 +669,7 @@ _cogl_atlas_reserve_space (CoglAtlas             *atlas,
       atlas->map = new_map;
       atlas->texture = COGL_TEXTURE (new_tex);
 
-      waste = (_cogl_rectangle_map_get_remaining_space (atlas->map) *
-               100 / (_cogl_rectangle_map_get_width (atlas->map) *
-                      _cogl_rectangle_map_get_height (atlas->map)));
-
-      COGL_NOTE (ATLAS, "%p: Atlas is %ix%i, has %i textures and is %i%% waste",
-                 atlas,
-                 _cogl_rectangle_map_get_width (atlas->map),
-                 _cogl_rectangle_map_get_height (atlas->map),
-                 _cogl_rectangle_map_get_n_rectangles (atlas->map),
-                 waste);
+      _cogl_atlas_note_usage (atlas);
 
       ret = TRUE;
     }
@@ -545,16 +691,54 @@ _cogl_atlas_remove (CoglAtlas *atlas,
              atlas,
              rectangle->width,
              rectangle->height);
-  COGL_NOTE (ATLAS, "%p: Atlas is %ix%i, has %i textures and is %i%% waste",
-             atlas,
-             _cogl_rectangle_map_get_width (atlas->map),
-             _cogl_rectangle_map_get_height (atlas->map),
-             _cogl_rectangle_map_get_n_rectangles (atlas->map),
-             _cogl_rectangle_map_get_remaining_space (atlas->map) *
-             100 / (_cogl_rectangle_map_get_width (atlas->map) *
-                    _cogl_rectangle_map_get_height (atlas->map)));
+  _cogl_atlas_note_usage (atlas);
 };
 
+void
+_cogl_atlas_set_memory_category (CoglAtlas *atlas,
+                                 const char *category)
+{
+  atlas->memory_category = g_intern_string (category);
+
+  if (atlas->texture)
+    cogl_texture_set_memory_category (atlas->texture, category);
+}
+
+void
+_cogl_atlas_set_max_size (CoglAtlas *atlas,
+                          unsigned int max_width,
+                          unsigned int max_height)
+{
+  atlas->max_width = max_width;
+  atlas->max_height = max_height;
+}
+
+void
+_cogl_atlas_get_stats (CoglAtlas *atlas,
+                       CoglAtlasStats *stats)
+{
+  if (atlas->map)
+    {
+      stats->width = _cogl_rectangle_map_get_width (atlas->map);
+      stats->height = _cogl_rectangle_map_get_height (atlas->map);
+      stats->n_rectangles = _cogl_rectangle_map_get_n_rectangles (atlas->map);
+      stats->used_space = (stats->width * stats->height -
+                           _cogl_rectangle_map_get_remaining_space
+                           (atlas->map));
+    }
+  else
+    {
+      stats->width = 0;
+      stats->height = 0;
+      stats->n_rectangles = 0;
+      stats->used_space = 0;
+    }
+
+  stats->n_grows = atlas->n_grows;
+  stats->n_reorganizations = atlas->n_reorganizations;
+  stats->n_migrated_rectangles = atlas->n_migrated_rectangles;
+}
+
 static CoglTexture *
 create_migration_texture (CoglContext *ctx,
                           int width,
@@ -41,9 +41,34 @@ typedef void
 typedef enum
 {
   COGL_ATLAS_CLEAR_TEXTURE     = (1 << 0),
-  COGL_ATLAS_DISABLE_MIGRATION = (1 << 1)
+  COGL_ATLAS_DISABLE_MIGRATION = (1 << 1),
+  /* Use a skyline instead of a tree to pack the rectangles */
+  COGL_ATLAS_SKYLINE_PACKING   = (1 << 2),
+  /* When the atlas is full, first try growing it while keeping all of
+     the rectangles in place so that the old texture can be copied
+     across in one go. The rectangles are only laid out again once the
+     atlas can't grow any more */
+  COGL_ATLAS_INCREMENTAL_MIGRATION = (1 << 3),
+  /* Fail instead of laying out the rectangles again when the atlas is
+     full and can't grow */
+  COGL_ATLAS_DISABLE_REORGANIZATION = (1 << 4)
 } CoglAtlasFlags;
 
+typedef struct
+{
+  unsigned int width, height;
+  unsigned int n_rectangles;
+  /* Area covered by rectangles */
+  unsigned int used_space;
+
+  /* Number of times the atlas grew keeping the rectangles in place */
+  unsigned int n_grows;
+  /* Number of times all of the rectangles were laid out again, and the
+     total number of rectangles that moved because of it */
+  unsigned int n_reorganizations;
+  unsigned int n_migrated_rectangles;
+} CoglAtlasStats;
+
 typedef struct _CoglAtlas CoglAtlas;
 
 #define COGL_ATLAS(object) ((CoglAtlas *) object)
@@ -58,8 +83,18 @@ struct _CoglAtlas
   CoglPixelFormat texture_format;
   CoglAtlasFlags flags;
 
+  /* The memory category of the textures, "atlas" by default */
+  const char *memory_category;
+
+  /* The atlas never grows beyond this if it is non-zero */
+  unsigned int max_width, max_height;
+
   CoglAtlasUpdatePositionCallback update_position_cb;
 
+  unsigned int n_grows;
+  unsigned int n_reorganizations;
+  unsigned int n_migrated_rectangles;
+
   GHookList pre_reorganize_callbacks;
   GHookList post_reorganize_callbacks;
 };
@@ -99,6 +134,19 @@ _cogl_atlas_remove_reorganize_callback (CoglAtlas            *atlas,
                                         GHookFunc             post_callback,
                                         void                 *user_data);
 
+void
+_cogl_atlas_set_max_size (CoglAtlas *atlas,
+                          unsigned int max_width,
+                          unsigned int max_height);
+
+void
+_cogl_atlas_set_memory_category (CoglAtlas *atlas,
+                                 const char *category);
+
+void
+_cogl_atlas_get_stats (CoglAtlas *atlas,
+                       CoglAtlasStats *stats);
+
 CoglBool
 _cogl_is_atlas (void *object);
 
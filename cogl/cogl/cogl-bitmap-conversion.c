@@ -36,6 +36,7 @@
 #include "cogl-bitmap-private.h"
 #include "cogl-context-private.h"
 #include "cogl-texture-private.h"
+#include "cogl-bitmap-kernels-private.h"
 
 #include <string.h>
 
@@ -65,197 +66,18 @@
 
 /* (Un)Premultiplication */
 
-inline static void
-_cogl_unpremult_alpha_0 (uint8_t *dst)
-{
-  dst[0] = 0;
-  dst[1] = 0;
-  dst[2] = 0;
-  dst[3] = 0;
-}
-
-inline static void
-_cogl_unpremult_alpha_last (uint8_t *dst)
-{
-  uint8_t alpha = dst[3];
-
-  dst[0] = (dst[0] * 255) / alpha;
-  dst[1] = (dst[1] * 255) / alpha;
-  dst[2] = (dst[2] * 255) / alpha;
-}
-
-inline static void
-_cogl_unpremult_alpha_first (uint8_t *dst)
-{
-  uint8_t alpha = dst[0];
-
-  dst[1] = (dst[1] * 255) / alpha;
-  dst[2] = (dst[2] * 255) / alpha;
-  dst[3] = (dst[3] * 255) / alpha;
-}
-
-/* No division form of floor((c*a + 128)/255) (I first encountered
- * this in the RENDER implementation in the X server.) Being exact
- * is important for a == 255 - we want to get exactly c.
- */
-#define MULT(d,a,t)                             \
-  G_STMT_START {                                \
-    t = d * a + 128;                            \
-    d = ((t >> 8) + t) >> 8;                    \
-  } G_STMT_END
-
-inline static void
-_cogl_premult_alpha_last (uint8_t *dst)
-{
-  uint8_t alpha = dst[3];
-  /* Using a separate temporary per component has given slightly better
-   * code generation with GCC in the past; it shouldn't do any worse in
-   * any case.
-   */
-  unsigned int t1, t2, t3;
-  MULT(dst[0], alpha, t1);
-  MULT(dst[1], alpha, t2);
-  MULT(dst[2], alpha, t3);
-}
-
-inline static void
-_cogl_premult_alpha_first (uint8_t *dst)
-{
-  uint8_t alpha = dst[0];
-  unsigned int t1, t2, t3;
-
-  MULT(dst[1], alpha, t1);
-  MULT(dst[2], alpha, t2);
-  MULT(dst[3], alpha, t3);
-}
-
-#undef MULT
-
-/* Use the SSE optimized version to premult four pixels at once when
-   it is available. The same assembler code works for x86 and x86-64
-   because it doesn't refer to any non-SSE registers directly */
-#if defined(__SSE2__) && defined(__GNUC__) \
-  && (defined(__x86_64) || defined(__i386))
-#define COGL_USE_PREMULT_SSE2
-#endif
-
-#ifdef COGL_USE_PREMULT_SSE2
-
-inline static void
-_cogl_premult_alpha_last_four_pixels_sse2 (uint8_t *p)
-{
-  /* 8 copies of 128 used below */
-  static const int16_t eight_halves[8] __attribute__ ((aligned (16))) =
-    { 128, 128, 128, 128, 128, 128, 128, 128 };
-  /* Mask of the rgb components of the four pixels */
-  static const int8_t just_rgb[16] __attribute__ ((aligned (16))) =
-    { 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00,
-      0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00 };
-  /* Each SSE register only holds two pixels because we need to work
-     with 16-bit intermediate values. We still do four pixels by
-     interleaving two registers in the hope that it will pipeline
-     better */
-  asm (/* Load eight_halves into xmm5 for later */
-       "movdqa (%1), %%xmm5\n"
-       /* Clear xmm3 */
-       "pxor %%xmm3, %%xmm3\n"
-       /* Load two pixels from p into the low half of xmm0 */
-       "movlps (%0), %%xmm0\n"
-       /* Load the next set of two pixels from p into the low half of xmm1 */
-       "movlps 8(%0), %%xmm1\n"
-       /* Unpack 8 bytes from the low quad-words in each register to 8
-          16-bit values */
-       "punpcklbw %%xmm3, %%xmm0\n"
-       "punpcklbw %%xmm3, %%xmm1\n"
-       /* Copy alpha values of the first pixel in xmm0 to all
-          components of the first pixel in xmm2 */
-       "pshuflw $255, %%xmm0, %%xmm2\n"
-       /* same for xmm1 and xmm3 */
-       "pshuflw $255, %%xmm1, %%xmm3\n"
-       /* The above also copies the second pixel directly so we now
-          want to replace the RGB components with copies of the alpha
-          components */
-       "pshufhw $255, %%xmm2, %%xmm2\n"
-       "pshufhw $255, %%xmm3, %%xmm3\n"
-       /* Multiply the rgb components by the alpha */
-       "pmullw %%xmm2, %%xmm0\n"
-       "pmullw %%xmm3, %%xmm1\n"
-       /* Add 128 to each component */
-       "paddw %%xmm5, %%xmm0\n"
-       "paddw %%xmm5, %%xmm1\n"
-       /* Copy the results to temporary registers xmm4 and xmm5 */
-       "movdqa %%xmm0, %%xmm4\n"
-       "movdqa %%xmm1, %%xmm5\n"
-       /* Divide the results by 256 */
-       "psrlw $8, %%xmm0\n"
-       "psrlw $8, %%xmm1\n"
-       /* Add the temporaries back in */
-       "paddw %%xmm4, %%xmm0\n"
-       "paddw %%xmm5, %%xmm1\n"
-       /* Divide again */
-       "psrlw $8, %%xmm0\n"
-       "psrlw $8, %%xmm1\n"
-       /* Pack the results back as bytes */
-       "packuswb %%xmm1, %%xmm0\n"
-       /* Load just_rgb into xmm3 for later */
-       "movdqa (%2), %%xmm3\n"
-       /* Reload all four pixels into xmm2 */
-       "movups (%0), %%xmm2\n"
-       /* Mask out the alpha from the results */
-       "andps %%xmm3, %%xmm0\n"
-       /* Mask out the RGB from the original four pixels */
-       "andnps %%xmm2, %%xmm3\n"
-       /* Combine the two to get the right alpha values */
-       "orps %%xmm3, %%xmm0\n"
-       /* Write to memory */
-       "movdqu %%xmm0, (%0)\n"
-       : /* no outputs */
-       : "r" (p), "r" (eight_halves), "r" (just_rgb)
-       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5");
-}
-
-#endif /* COGL_USE_PREMULT_SSE2 */
-
 static void
 _cogl_bitmap_premult_unpacked_span_8 (uint8_t *data,
                                       int width)
 {
-#ifdef COGL_USE_PREMULT_SSE2
-
-  /* Process 4 pixels at a time */
-  while (width >= 4)
-    {
-      _cogl_premult_alpha_last_four_pixels_sse2 (data);
-      data += 4 * 4;
-      width -= 4;
-    }
-
-  /* If there are any pixels left we will fall through and
-     handle them below */
-
-#endif /* COGL_USE_PREMULT_SSE2 */
-
-  while (width-- > 0)
-    {
-      _cogl_premult_alpha_last (data);
-      data += 4;
-    }
+  _cogl_bitmap_kernels_get ()->premult (data, 3, width);
 }
 
 static void
 _cogl_bitmap_unpremult_unpacked_span_8 (uint8_t *data,
                                         int width)
 {
-  int x;
-
-  for (x = 0; x < width; x++)
-    {
-      if (data[3] == 0)
-        _cogl_unpremult_alpha_0 (data);
-      else
-        _cogl_unpremult_alpha_last (data);
-      data += 4;
-    }
+  _cogl_bitmap_kernels_get ()->unpremult (data, 3, width);
 }
 
 static void
@@ -307,6 +129,45 @@ _cogl_bitmap_can_fast_premult (CoglPixelFormat format)
     }
 }
 
+/* Gets the byte holding each of the red, green, blue and alpha
+   components of the 8-bit, 4-component formats */
+static CoglBool
+_cogl_bitmap_get_8888_layout (CoglPixelFormat format,
+                              int layout[4])
+{
+  static const int layouts[][4] =
+    {
+      { 0, 1, 2, 3 }, /* RGBA */
+      { 2, 1, 0, 3 }, /* BGRA */
+      { 1, 2, 3, 0 }, /* ARGB */
+      { 3, 2, 1, 0 }, /* ABGR */
+    };
+  int i;
+
+  switch (format & ~COGL_PREMULT_BIT)
+    {
+    case COGL_PIXEL_FORMAT_RGBA_8888:
+      i = 0;
+      break;
+    case COGL_PIXEL_FORMAT_BGRA_8888:
+      i = 1;
+      break;
+    case COGL_PIXEL_FORMAT_ARGB_8888:
+      i = 2;
+      break;
+    case COGL_PIXEL_FORMAT_ABGR_8888:
+      i = 3;
+      break;
+
+    default:
+      return FALSE;
+    }
+
+  memcpy (layout, layouts[i], sizeof (layouts[i]));
+
+  return TRUE;
+}
+
 static CoglBool
 _cogl_bitmap_needs_short_temp_buffer (CoglPixelFormat format)
 {
@@ -375,6 +236,7 @@ _cogl_bitmap_convert_into_bitmap (CoglBitmap *src_bmp,
   int width, height;
   CoglPixelFormat src_format;
   CoglPixelFormat dst_format;
+  int src_layout[4], dst_layout[4];
   CoglBool use_16;
   CoglBool need_premult;
 
@@ -436,6 +298,40 @@ _cogl_bitmap_convert_into_bitmap (CoglBitmap *src_bmp,
       return FALSE;
     }
 
+  /* Conversions between the 8888 formats are just a swizzle, so they
+     can skip the temporary row */
+  if (_cogl_bitmap_get_8888_layout (src_format, src_layout) &&
+      _cogl_bitmap_get_8888_layout (dst_format, dst_layout))
+    {
+      const CoglBitmapKernels *kernels = _cogl_bitmap_kernels_get ();
+      uint8_t order[4];
+      int i;
+
+      for (i = 0; i < 4; i++)
+        order[dst_layout[i]] = src_layout[i];
+
+      for (y = 0; y < height; y++)
+        {
+          src = src_data + y * src_rowstride;
+          dst = dst_data + y * dst_rowstride;
+
+          kernels->swizzle (src, dst, order, width);
+
+          if (!need_premult)
+            continue;
+
+          if (dst_format & COGL_PREMULT_BIT)
+            kernels->premult (dst, dst_layout[3], width);
+          else
+            kernels->unpremult (dst, dst_layout[3], width);
+        }
+
+      _cogl_bitmap_unmap (src_bmp);
+      _cogl_bitmap_unmap (dst_bmp);
+
+      return TRUE;
+    }
+
   use_16 = _cogl_bitmap_needs_short_temp_buffer (dst_format);
 
   /* Allocate a buffer to hold a temporary RGBA row */
@@ -621,7 +517,8 @@ _cogl_bitmap_unpremult (CoglBitmap *bmp,
 {
   uint8_t *p, *data;
   uint16_t *tmp_row;
-  int x,y;
+  int y;
+  int alpha_index;
   CoglPixelFormat format;
   int width, height;
   int rowstride;
@@ -630,6 +527,7 @@ _cogl_bitmap_unpremult (CoglBitmap *bmp,
   width = cogl_bitmap_get_width (bmp);
   height = cogl_bitmap_get_height (bmp);
   rowstride = cogl_bitmap_get_rowstride (bmp);
+  alpha_index = (format & COGL_AFIRST_BIT) ? 0 : 3;
 
   if ((data = _cogl_bitmap_map (bmp,
                                 COGL_BUFFER_ACCESS_READ |
@@ -657,21 +555,7 @@ _cogl_bitmap_unpremult (CoglBitmap *bmp,
           _cogl_pack_16 (format, tmp_row, p, width);
         }
       else
-        {
-          if (format & COGL_AFIRST_BIT)
-            {
-              for (x = 0; x < width; x++)
-                {
-                  if (p[0] == 0)
-                    _cogl_unpremult_alpha_0 (p);
-                  else
-                    _cogl_unpremult_alpha_first (p);
-                  p += 4;
-                }
-            }
-          else
-            _cogl_bitmap_unpremult_unpacked_span_8 (p, width);
-        }
+        _cogl_bitmap_kernels_get ()->unpremult (p, alpha_index, width);
     }
 
   free (tmp_row);
@@ -689,7 +573,8 @@ _cogl_bitmap_premult (CoglBitmap *bmp,
 {
   uint8_t *p, *data;
   uint16_t *tmp_row;
-  int x,y;
+  int y;
+  int alpha_index;
   CoglPixelFormat format;
   int width, height;
   int rowstride;
@@ -698,6 +583,7 @@ _cogl_bitmap_premult (CoglBitmap *bmp,
   width = cogl_bitmap_get_width (bmp);
   height = cogl_bitmap_get_height (bmp);
   rowstride = cogl_bitmap_get_rowstride (bmp);
+  alpha_index = (format & COGL_AFIRST_BIT) ? 0 : 3;
 
   if ((data = _cogl_bitmap_map (bmp,
                                 COGL_BUFFER_ACCESS_READ |
@@ -724,18 +610,7 @@ _cogl_bitmap_premult (CoglBitmap *bmp,
           _cogl_pack_16 (format, tmp_row, p, width);
         }
       else
-        {
-          if (format & COGL_AFIRST_BIT)
-            {
-              for (x = 0; x < width; x++)
-                {
-                  _cogl_premult_alpha_first (p);
-                  p += 4;
-                }
-            }
-          else
-            _cogl_bitmap_premult_unpacked_span_8 (p, width);
-        }
+        _cogl_bitmap_kernels_get ()->premult (p, alpha_index, width);
     }
 
   free (tmp_row);
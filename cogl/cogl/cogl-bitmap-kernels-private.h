@@ -0,0 +1,71 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __COGL_BITMAP_KERNELS_PRIVATE_H
+#define __COGL_BITMAP_KERNELS_PRIVATE_H
+
+#include <stdint.h>
+
+/*
+ * Row kernels for the 8-bit, 4-component formats, which are what most
+ * images uploaded through Cogl use. The bitmap conversion code uses
+ * these instead of unpacking to a temporary RGBA row whenever both the
+ * source and the destination are one of the 8888 formats.
+ */
+typedef struct
+{
+  const char *name;
+
+  /* Writes @width pixels to @dst where byte c of each pixel is byte
+   * @order[c] of the same pixel in @src. @src and @dst may be the same
+   * but must not otherwise overlap. */
+  void (* swizzle) (const uint8_t *src,
+                    uint8_t *dst,
+                    const uint8_t order[4],
+                    int width);
+
+  /* (Un)premultiply @width pixels in place. @alpha_index is the byte
+   * of each pixel holding the alpha. Unpremultiplying saturates
+   * components that are larger than the alpha. */
+  void (* premult) (uint8_t *data,
+                    int alpha_index,
+                    int width);
+  void (* unpremult) (uint8_t *data,
+                      int alpha_index,
+                      int width);
+} CoglBitmapKernels;
+
+/* Returns the implementations this CPU can run, the plain C one first
+ * and the preferred one last. */
+const CoglBitmapKernels *
+_cogl_bitmap_kernels_get_impls (int *n_impls);
+
+/* The implementation the bitmap code uses. It can be forced by setting
+ * COGL_BITMAP_KERNELS to the name of one of the above. */
+const CoglBitmapKernels *
+_cogl_bitmap_kernels_get (void);
+
+#endif /* __COGL_BITMAP_KERNELS_PRIVATE_H */
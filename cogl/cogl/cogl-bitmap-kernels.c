@@ -0,0 +1,692 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "cogl-config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <test-fixtures/test-unit.h>
+
+#include "cogl-bitmap-kernels-private.h"
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+  (defined(__x86_64__) || defined(__i386__))
+/* SSE2 is only used for the baseline premultiplication */
+#define COGL_BITMAP_KERNELS_SSE2
+
+/* SSSE3 and AVX2 aren't part of any baseline so they are compiled
+   with target attributes and only picked after checking the CPU */
+#if defined(__clang__) || \
+  (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define COGL_BITMAP_KERNELS_SSSE3
+#define COGL_BITMAP_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+/* vqtbl1q_u8 is only available on AArch64 */
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_NEON)
+#define COGL_BITMAP_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+/* floor (c * 255 / a) is computed as (c * unpremult_table[a]) >> 16.
+ * Rounding the reciprocal up keeps this exact for any 8-bit c: the
+ * error it adds is below 255 / 65536, which is less than the smallest
+ * non-zero distance of c * 255 / a from the next integer, 1 / a. The
+ * entry for 0 is 0 so that pixels without alpha become 0. */
+static uint32_t unpremult_table[256];
+
+static void
+init_unpremult_table (void)
+{
+  int a;
+
+  for (a = 1; a < 256; a++)
+    unpremult_table[a] = (255 * 65536 + a - 1) / a;
+}
+
+static inline uint8_t
+unpremult_component (uint8_t c, uint32_t recip)
+{
+  uint32_t v = (c * recip) >> 16;
+
+  return v > 255 ? 255 : v;
+}
+
+/* No division form of floor((c*a + 128)/255) (I first encountered
+ * this in the RENDER implementation in the X server.) Being exact
+ * is important for a == 255 - we want to get exactly c.
+ */
+static inline uint8_t
+premult_component (uint8_t c, uint8_t a)
+{
+  unsigned int t = c * a + 128;
+
+  return ((t >> 8) + t) >> 8;
+}
+
+static void
+swizzle_c (const uint8_t *src,
+           uint8_t *dst,
+           const uint8_t order[4],
+           int width)
+{
+  while (width-- > 0)
+    {
+      uint8_t p0 = src[order[0]], p1 = src[order[1]];
+      uint8_t p2 = src[order[2]], p3 = src[order[3]];
+
+      dst[0] = p0;
+      dst[1] = p1;
+      dst[2] = p2;
+      dst[3] = p3;
+
+      src += 4;
+      dst += 4;
+    }
+}
+
+static void
+premult_one (uint8_t *p,
+             int alpha_index)
+{
+  uint8_t alpha = p[alpha_index];
+  int c;
+
+  for (c = 0; c < 4; c++)
+    if (c != alpha_index)
+      p[c] = premult_component (p[c], alpha);
+}
+
+static void
+unpremult_one (uint8_t *p,
+               int alpha_index)
+{
+  uint32_t recip = unpremult_table[p[alpha_index]];
+  int c;
+
+  for (c = 0; c < 4; c++)
+    if (c != alpha_index)
+      p[c] = unpremult_component (p[c], recip);
+}
+
+#ifdef COGL_BITMAP_KERNELS_SSE2
+
+/* Premultiplies four pixels at once. The same assembler code works
+   for x86 and x86-64 because it doesn't refer to any non-SSE
+   registers directly */
+static inline void
+premult_alpha_last_four_pixels_sse2 (uint8_t *p)
+{
+  /* 8 copies of 128 used below */
+  static const int16_t eight_halves[8] __attribute__ ((aligned (16))) =
+    { 128, 128, 128, 128, 128, 128, 128, 128 };
+  /* Mask of the rgb components of the four pixels */
+  static const int8_t just_rgb[16] __attribute__ ((aligned (16))) =
+    { 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00,
+      0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00 };
+  /* Each SSE register only holds two pixels because we need to work
+     with 16-bit intermediate values. We still do four pixels by
+     interleaving two registers in the hope that it will pipeline
+     better */
+  asm (/* Load eight_halves into xmm5 for later */
+       "movdqa (%1), %%xmm5\n"
+       /* Clear xmm3 */
+       "pxor %%xmm3, %%xmm3\n"
+       /* Load two pixels from p into the low half of xmm0 */
+       "movlps (%0), %%xmm0\n"
+       /* Load the next set of two pixels from p into the low half of xmm1 */
+       "movlps 8(%0), %%xmm1\n"
+       /* Unpack 8 bytes from the low quad-words in each register to 8
+          16-bit values */
+       "punpcklbw %%xmm3, %%xmm0\n"
+       "punpcklbw %%xmm3, %%xmm1\n"
+       /* Copy alpha values of the first pixel in xmm0 to all
+          components of the first pixel in xmm2 */
+       "pshuflw $255, %%xmm0, %%xmm2\n"
+       /* same for xmm1 and xmm3 */
+       "pshuflw $255, %%xmm1, %%xmm3\n"
+       /* The above also copies the second pixel directly so we now
+          want to replace the RGB components with copies of the alpha
+          components */
+       "pshufhw $255, %%xmm2, %%xmm2\n"
+       "pshufhw $255, %%xmm3, %%xmm3\n"
+       /* Multiply the rgb components by the alpha */
+       "pmullw %%xmm2, %%xmm0\n"
+       "pmullw %%xmm3, %%xmm1\n"
+       /* Add 128 to each component */
+       "paddw %%xmm5, %%xmm0\n"
+       "paddw %%xmm5, %%xmm1\n"
+       /* Copy the results to temporary registers xmm4 and xmm5 */
+       "movdqa %%xmm0, %%xmm4\n"
+       "movdqa %%xmm1, %%xmm5\n"
+       /* Divide the results by 256 */
+       "psrlw $8, %%xmm0\n"
+       "psrlw $8, %%xmm1\n"
+       /* Add the temporaries back in */
+       "paddw %%xmm4, %%xmm0\n"
+       "paddw %%xmm5, %%xmm1\n"
+       /* Divide again */
+       "psrlw $8, %%xmm0\n"
+       "psrlw $8, %%xmm1\n"
+       /* Pack the results back as bytes */
+       "packuswb %%xmm1, %%xmm0\n"
+       /* Load just_rgb into xmm3 for later */
+       "movdqa (%2), %%xmm3\n"
+       /* Reload all four pixels into xmm2 */
+       "movups (%0), %%xmm2\n"
+       /* Mask out the alpha from the results */
+       "andps %%xmm3, %%xmm0\n"
+       /* Mask out the RGB from the original four pixels */
+       "andnps %%xmm2, %%xmm3\n"
+       /* Combine the two to get the right alpha values */
+       "orps %%xmm3, %%xmm0\n"
+       /* Write to memory */
+       "movdqu %%xmm0, (%0)\n"
+       : /* no outputs */
+       : "r" (p), "r" (eight_halves), "r" (just_rgb)
+       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5");
+}
+
+#endif /* COGL_BITMAP_KERNELS_SSE2 */
+
+static void
+premult_c (uint8_t *data,
+           int alpha_index,
+           int width)
+{
+#ifdef COGL_BITMAP_KERNELS_SSE2
+  if (alpha_index == 3)
+    {
+      /* Process 4 pixels at a time */
+      while (width >= 4)
+        {
+          premult_alpha_last_four_pixels_sse2 (data);
+          data += 4 * 4;
+          width -= 4;
+        }
+    }
+#endif /* COGL_BITMAP_KERNELS_SSE2 */
+
+  while (width-- > 0)
+    {
+      premult_one (data, alpha_index);
+      data += 4;
+    }
+}
+
+static void
+unpremult_c (uint8_t *data,
+             int alpha_index,
+             int width)
+{
+  while (width-- > 0)
+    {
+      unpremult_one (data, alpha_index);
+      data += 4;
+    }
+}
+
+/* Byte masks shared by the shuffle based versions. make_shuffle()
+ * builds a pshufb/tbl mask for four pixels that applies @order to each
+ * of them, make_alpha_shuffle() one that spreads the alpha of pixel
+ * @first_pixel + i / 4 over 16-bit lane i / 2 for i in [0, 8), leaving
+ * the high byte of every lane zero. */
+
+static void
+make_shuffle (uint8_t mask[16],
+              const uint8_t order[4])
+{
+  int i;
+
+  for (i = 0; i < 16; i++)
+    mask[i] = (i & ~3) + order[i & 3];
+}
+
+static void
+make_alpha_shuffle (uint8_t mask[16],
+                    int first_pixel,
+                    int alpha_index)
+{
+  int i;
+
+  for (i = 0; i < 16; i++)
+    mask[i] = (i & 1) ? 0x80 : (first_pixel + i / 8) * 4 + alpha_index;
+}
+
+static void
+make_alpha_mask (uint8_t mask[16],
+                 int alpha_index)
+{
+  int i;
+
+  for (i = 0; i < 16; i++)
+    mask[i] = (i & 3) == alpha_index ? 0xff : 0x00;
+}
+
+#ifdef COGL_BITMAP_KERNELS_SSSE3
+
+__attribute__ ((target ("ssse3"))) static void
+swizzle_ssse3 (const uint8_t *src,
+               uint8_t *dst,
+               const uint8_t order[4],
+               int width)
+{
+  uint8_t mask_bytes[16];
+  __m128i mask;
+
+  make_shuffle (mask_bytes, order);
+  mask = _mm_loadu_si128 ((const __m128i *) mask_bytes);
+
+  for (; width >= 4; width -= 4, src += 16, dst += 16)
+    {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) src);
+
+      _mm_storeu_si128 ((__m128i *) dst, _mm_shuffle_epi8 (v, mask));
+    }
+
+  swizzle_c (src, dst, order, width);
+}
+
+/* (c * a + 128 + ((c * a + 128) >> 8)) >> 8 on 16-bit lanes holding
+ * two pixels, matching premult_component() */
+__attribute__ ((target ("ssse3"))) static inline __m128i
+premult_lanes_ssse3 (__m128i c, __m128i a)
+{
+  __m128i t = _mm_add_epi16 (_mm_mullo_epi16 (c, a), _mm_set1_epi16 (128));
+
+  return _mm_srli_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), 8);
+}
+
+__attribute__ ((target ("ssse3"))) static void
+premult_ssse3 (uint8_t *data,
+               int alpha_index,
+               int width)
+{
+  uint8_t mask_bytes[16];
+  __m128i alpha_lo, alpha_hi, alpha_mask, zero = _mm_setzero_si128 ();
+
+  make_alpha_shuffle (mask_bytes, 0, alpha_index);
+  alpha_lo = _mm_loadu_si128 ((const __m128i *) mask_bytes);
+  make_alpha_shuffle (mask_bytes, 2, alpha_index);
+  alpha_hi = _mm_loadu_si128 ((const __m128i *) mask_bytes);
+  make_alpha_mask (mask_bytes, alpha_index);
+  alpha_mask = _mm_loadu_si128 ((const __m128i *) mask_bytes);
+
+  for (; width >= 4; width -= 4, data += 16)
+    {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) data);
+      __m128i lo, hi, r;
+
+      lo = premult_lanes_ssse3 (_mm_unpacklo_epi8 (v, zero),
+                                _mm_shuffle_epi8 (v, alpha_lo));
+      hi = premult_lanes_ssse3 (_mm_unpackhi_epi8 (v, zero),
+                                _mm_shuffle_epi8 (v, alpha_hi));
+      r = _mm_packus_epi16 (lo, hi);
+
+      /* The alpha itself comes out as a * a / 255 so put it back */
+      r = _mm_or_si128 (_mm_andnot_si128 (alpha_mask, r),
+                        _mm_and_si128 (alpha_mask, v));
+
+      _mm_storeu_si128 ((__m128i *) data, r);
+    }
+
+  premult_c (data, alpha_index, width);
+}
+
+#endif /* COGL_BITMAP_KERNELS_SSSE3 */
+
+#ifdef COGL_BITMAP_KERNELS_AVX2
+
+/* The byte shuffles and unpacks work within each 128-bit half, so the
+   SSSE3 masks are simply used for both halves */
+__attribute__ ((target ("avx2"))) static inline __m256i
+load_mask_avx2 (const uint8_t mask_bytes[16])
+{
+  return _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *)
+                                                       mask_bytes));
+}
+
+__attribute__ ((target ("avx2"))) static void
+swizzle_avx2 (const uint8_t *src,
+              uint8_t *dst,
+              const uint8_t order[4],
+              int width)
+{
+  uint8_t mask_bytes[16];
+  __m256i mask;
+
+  make_shuffle (mask_bytes, order);
+  mask = load_mask_avx2 (mask_bytes);
+
+  for (; width >= 8; width -= 8, src += 32, dst += 32)
+    {
+      __m256i v = _mm256_loadu_si256 ((const __m256i *) src);
+
+      _mm256_storeu_si256 ((__m256i *) dst, _mm256_shuffle_epi8 (v, mask));
+    }
+
+  swizzle_c (src, dst, order, width);
+}
+
+__attribute__ ((target ("avx2"))) static inline __m256i
+premult_lanes_avx2 (__m256i c, __m256i a)
+{
+  __m256i t = _mm256_add_epi16 (_mm256_mullo_epi16 (c, a),
+                                _mm256_set1_epi16 (128));
+
+  return _mm256_srli_epi16 (_mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8)),
+                            8);
+}
+
+__attribute__ ((target ("avx2"))) static void
+premult_avx2 (uint8_t *data,
+              int alpha_index,
+              int width)
+{
+  uint8_t mask_bytes[16];
+  __m256i alpha_lo, alpha_hi, alpha_mask, zero = _mm256_setzero_si256 ();
+
+  make_alpha_shuffle (mask_bytes, 0, alpha_index);
+  alpha_lo = load_mask_avx2 (mask_bytes);
+  make_alpha_shuffle (mask_bytes, 2, alpha_index);
+  alpha_hi = load_mask_avx2 (mask_bytes);
+  make_alpha_mask (mask_bytes, alpha_index);
+  alpha_mask = load_mask_avx2 (mask_bytes);
+
+  for (; width >= 8; width -= 8, data += 32)
+    {
+      __m256i v = _mm256_loadu_si256 ((const __m256i *) data);
+      __m256i lo, hi, r;
+
+      lo = premult_lanes_avx2 (_mm256_unpacklo_epi8 (v, zero),
+                               _mm256_shuffle_epi8 (v, alpha_lo));
+      hi = premult_lanes_avx2 (_mm256_unpackhi_epi8 (v, zero),
+                               _mm256_shuffle_epi8 (v, alpha_hi));
+      r = _mm256_packus_epi16 (lo, hi);
+      r = _mm256_blendv_epi8 (r, v, alpha_mask);
+
+      _mm256_storeu_si256 ((__m256i *) data, r);
+    }
+
+  premult_c (data, alpha_index, width);
+}
+
+/* The reciprocals are looked up per pixel with a gather, which only
+ * AVX2 has, and each component is multiplied in its own 32-bit lane */
+__attribute__ ((target ("avx2"))) static void
+unpremult_avx2 (uint8_t *data,
+                int alpha_index,
+                int width)
+{
+  const __m256i byte_mask = _mm256_set1_epi32 (0xff);
+  const __m256i max = _mm256_set1_epi32 (255);
+  const __m256i alpha_mask = _mm256_set1_epi32 (0xff << (alpha_index * 8));
+
+  for (; width >= 8; width -= 8, data += 32)
+    {
+      __m256i v = _mm256_loadu_si256 ((const __m256i *) data);
+      __m256i alpha, recip, r;
+      int c;
+
+      alpha = _mm256_and_si256 (_mm256_srlv_epi32 (v,
+                                                   _mm256_set1_epi32
+                                                   (alpha_index * 8)),
+                                byte_mask);
+      recip = _mm256_i32gather_epi32 ((const int *) unpremult_table,
+                                      alpha, 4);
+
+      r = _mm256_and_si256 (v, alpha_mask);
+
+      for (c = 0; c < 4; c++)
+        {
+          __m256i shift = _mm256_set1_epi32 (c * 8);
+          __m256i comp;
+
+          if (c == alpha_index)
+            continue;
+
+          comp = _mm256_and_si256 (_mm256_srlv_epi32 (v, shift), byte_mask);
+          comp = _mm256_srli_epi32 (_mm256_mullo_epi32 (comp, recip), 16);
+          comp = _mm256_min_epu32 (comp, max);
+          r = _mm256_or_si256 (r, _mm256_sllv_epi32 (comp, shift));
+        }
+
+      _mm256_storeu_si256 ((__m256i *) data, r);
+    }
+
+  unpremult_c (data, alpha_index, width);
+}
+
+#endif /* COGL_BITMAP_KERNELS_AVX2 */
+
+#ifdef COGL_BITMAP_KERNELS_NEON
+
+static void
+swizzle_neon (const uint8_t *src,
+              uint8_t *dst,
+              const uint8_t order[4],
+              int width)
+{
+  uint8_t mask_bytes[16];
+  uint8x16_t mask;
+
+  make_shuffle (mask_bytes, order);
+  mask = vld1q_u8 (mask_bytes);
+
+  for (; width >= 4; width -= 4, src += 16, dst += 16)
+    vst1q_u8 (dst, vqtbl1q_u8 (vld1q_u8 (src), mask));
+
+  swizzle_c (src, dst, order, width);
+}
+
+static void
+premult_neon (uint8_t *data,
+              int alpha_index,
+              int width)
+{
+  uint8_t mask_bytes[16];
+  uint8x16_t alpha_spread, alpha_mask;
+  int i;
+
+  /* Unlike the x86 versions the alpha is spread over bytes rather than
+     16-bit lanes because vmull widens as it multiplies */
+  for (i = 0; i < 16; i++)
+    mask_bytes[i] = (i & ~3) + alpha_index;
+  alpha_spread = vld1q_u8 (mask_bytes);
+  make_alpha_mask (mask_bytes, alpha_index);
+  alpha_mask = vld1q_u8 (mask_bytes);
+
+  for (; width >= 4; width -= 4, data += 16)
+    {
+      uint8x16_t v = vld1q_u8 (data);
+      uint8x16_t a = vqtbl1q_u8 (v, alpha_spread);
+      uint16x8_t lo = vmull_u8 (vget_low_u8 (v), vget_low_u8 (a));
+      uint16x8_t hi = vmull_u8 (vget_high_u8 (v), vget_high_u8 (a));
+      uint8x16_t r;
+
+      /* vraddhn (t, vrshr (t, 8)) is (t + 128 + ((t + 128) >> 8)) >> 8 */
+      r = vcombine_u8 (vraddhn_u16 (lo, vrshrq_n_u16 (lo, 8)),
+                       vraddhn_u16 (hi, vrshrq_n_u16 (hi, 8)));
+
+      vst1q_u8 (data, vbslq_u8 (alpha_mask, v, r));
+    }
+
+  premult_c (data, alpha_index, width);
+}
+
+#endif /* COGL_BITMAP_KERNELS_NEON */
+
+static const CoglBitmapKernels all_impls[] =
+  {
+    { "c", swizzle_c, premult_c, unpremult_c },
+#ifdef COGL_BITMAP_KERNELS_NEON
+    { "neon", swizzle_neon, premult_neon, unpremult_c },
+#endif
+#ifdef COGL_BITMAP_KERNELS_SSSE3
+    { "ssse3", swizzle_ssse3, premult_ssse3, unpremult_c },
+#endif
+#ifdef COGL_BITMAP_KERNELS_AVX2
+    { "avx2", swizzle_avx2, premult_avx2, unpremult_avx2 },
+#endif
+  };
+
+const CoglBitmapKernels *
+_cogl_bitmap_kernels_get_impls (int *n_impls)
+{
+  int n = G_N_ELEMENTS (all_impls);
+
+  if (G_UNLIKELY (unpremult_table[1] == 0))
+    init_unpremult_table ();
+
+#ifdef COGL_BITMAP_KERNELS_SSSE3
+  /* The x86 versions are last, each needing more of the CPU than the
+     one before, so the unsupported ones can simply be left out */
+  __builtin_cpu_init ();
+  if (!__builtin_cpu_supports ("avx2"))
+    n--;
+  if (!__builtin_cpu_supports ("ssse3"))
+    n--;
+#endif
+
+  *n_impls = n;
+
+  return all_impls;
+}
+
+const CoglBitmapKernels *
+_cogl_bitmap_kernels_get (void)
+{
+  static const CoglBitmapKernels *kernels = NULL;
+
+  if (G_UNLIKELY (kernels == NULL))
+    {
+      const CoglBitmapKernels *impls;
+      const char *name = g_getenv ("COGL_BITMAP_KERNELS");
+      int n_impls, i;
+
+      impls = _cogl_bitmap_kernels_get_impls (&n_impls);
+      kernels = &impls[n_impls - 1];
+
+      if (name)
+        {
+          for (i = 0; i < n_impls; i++)
+            if (!strcmp (impls[i].name, name))
+              break;
+
+          if (i < n_impls)
+            kernels = &impls[i];
+          else
+            g_warning ("Unknown or unsupported COGL_BITMAP_KERNELS "
+                       "implementation \"%s\"", name);
+        }
+    }
+
+  return kernels;
+}
+
+UNIT_TEST (check_bitmap_kernels,
+           0, /* no requirements */
+           0 /* no failure cases */)
+{
+  /* An odd width so every implementation also runs its tail */
+#define N_PIXELS 37
+  static const uint8_t orders[][4] =
+    {
+      { 0, 1, 2, 3 }, /* copy */
+      { 3, 0, 1, 2 }, /* RGBA <-> ARGB */
+      { 2, 1, 0, 3 }, /* RGBA <-> BGRA */
+      { 3, 2, 1, 0 }, /* RGBA <-> ABGR */
+      { 1, 2, 3, 0 }, /* ARGB -> RGBA */
+    };
+  uint8_t src[N_PIXELS * 4 + 1];
+  uint8_t dst[N_PIXELS * 4 + 1];
+  const CoglBitmapKernels *impls;
+  int n_impls, i, o, p, alpha_index;
+
+  /* Include the extreme alphas and components larger than the alpha */
+  for (i = 0; i < N_PIXELS * 4; i++)
+    src[i] = (i * 83 + 7) & 0xff;
+  src[3] = 0;
+  src[7] = 255;
+  src[11] = 1;
+
+  impls = _cogl_bitmap_kernels_get_impls (&n_impls);
+
+  for (i = 0; i < n_impls; i++)
+    {
+      for (o = 0; o < G_N_ELEMENTS (orders); o++)
+        {
+          memset (dst, 0xaa, sizeof (dst));
+          impls[i].swizzle (src, dst, orders[o], N_PIXELS);
+
+          for (p = 0; p < N_PIXELS * 4; p++)
+            g_assert_cmpint (dst[p], ==, src[(p & ~3) + orders[o][p & 3]]);
+          /* Nothing may be written beyond the last pixel */
+          g_assert_cmpint (dst[N_PIXELS * 4], ==, 0xaa);
+        }
+
+      for (alpha_index = 0; alpha_index < 4; alpha_index += 3)
+        {
+          memcpy (dst, src, sizeof (dst));
+          impls[i].premult (dst, alpha_index, N_PIXELS);
+
+          for (p = 0; p < N_PIXELS * 4; p++)
+            {
+              const uint8_t *pixel = src + (p & ~3);
+
+              if ((p & 3) == alpha_index)
+                g_assert_cmpint (dst[p], ==, src[p]);
+              else
+                g_assert_cmpint (dst[p], ==,
+                                 (src[p] * pixel[alpha_index] + 127) / 255);
+            }
+
+          memcpy (dst, src, sizeof (dst));
+          impls[i].unpremult (dst, alpha_index, N_PIXELS);
+
+          for (p = 0; p < N_PIXELS * 4; p++)
+            {
+              const uint8_t *pixel = src + (p & ~3);
+              int alpha = pixel[alpha_index];
+
+              if ((p & 3) == alpha_index)
+                g_assert_cmpint (dst[p], ==, src[p]);
+              else if (alpha == 0)
+                g_assert_cmpint (dst[p], ==, 0);
+              else
+                g_assert_cmpint (dst[p], ==,
+                                 MIN (src[p] * 255 / alpha, 255));
+            }
+        }
+    }
+#undef N_PIXELS
+}
@@ -69,7 +69,9 @@ typedef enum _CoglBufferFlags
   COGL_BUFFER_FLAG_NONE            = 0,
   COGL_BUFFER_FLAG_BUFFER_OBJECT   = 1UL << 0,  /* real openGL buffer object */
   COGL_BUFFER_FLAG_MAPPED          = 1UL << 1,
-  COGL_BUFFER_FLAG_MAPPED_FALLBACK = 1UL << 2
+  COGL_BUFFER_FLAG_MAPPED_FALLBACK = 1UL << 2,
+  /* immutable store that stays mapped, see _cogl_buffer_gl_map_persistent */
+  COGL_BUFFER_FLAG_PERSISTENT      = 1UL << 3
 } CoglBufferFlags;
 
 typedef enum {
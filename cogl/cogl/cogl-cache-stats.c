@@ -0,0 +1,60 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "cogl-config.h"
+#endif
+
+#include <string.h>
+
+#include "cogl-context-private.h"
+#include "cogl-pipeline-cache.h"
+#include "cogl-sampler-cache-private.h"
+#include "cogl-cache-stats.h"
+
+void
+cogl_context_get_pipeline_cache_stats (CoglContext *context,
+                                       CoglCacheStats *stats)
+{
+  memset (stats, 0, sizeof (CoglCacheStats));
+
+  _cogl_pipeline_cache_get_stats (context->pipeline_cache, stats);
+}
+
+void
+cogl_context_get_sampler_cache_stats (CoglContext *context,
+                                      CoglCacheStats *stats)
+{
+  memset (stats, 0, sizeof (CoglCacheStats));
+
+  _cogl_sampler_cache_get_stats (context->sampler_cache, stats);
+}
+
+void
+cogl_context_trim_pipeline_cache (CoglContext *context)
+{
+  _cogl_pipeline_cache_trim (context->pipeline_cache);
+}
@@ -0,0 +1,114 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(__COGL_H_INSIDE__) && !defined(COGL_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_CACHE_STATS_H__
+#define __COGL_CACHE_STATS_H__
+
+#include <cogl/cogl-types.h>
+#include <cogl/cogl-context.h>
+
+COGL_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-cache-stats
+ * @short_description: Functions for monitoring Cogl's internal caches
+ *
+ * Cogl caches the state it derives from pipelines so that it doesn't
+ * have to be worked out again every time a pipeline is drawn with.
+ * These functions report how big those caches are and how well they
+ * work, so that long running applications can tell whether they keep
+ * growing, and let the pipeline cache be trimmed when memory is short.
+ */
+
+/**
+ * CoglCacheStats:
+ * @n_entries: The number of entries in the cache
+ * @bytes: An estimate of the memory the entries take, in bytes
+ * @hits: How many lookups found an entry
+ * @misses: How many lookups had to add an entry
+ * @evictions: How many entries were dropped to make room
+ *
+ * Statistics about one of Cogl's caches.
+ *
+ * Stability: Unstable
+ */
+typedef struct
+{
+  unsigned int n_entries;
+  size_t bytes;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+} CoglCacheStats;
+
+/**
+ * cogl_context_get_pipeline_cache_stats:
+ * @context: A #CoglContext
+ * @stats: (out): Return location for the statistics
+ *
+ * Retrieves statistics about the templates the GLSL backends keep to
+ * share shaders and programs between pipelines with the same state.
+ *
+ * Stability: Unstable
+ */
+void
+cogl_context_get_pipeline_cache_stats (CoglContext *context,
+                                       CoglCacheStats *stats);
+
+/**
+ * cogl_context_get_sampler_cache_stats:
+ * @context: A #CoglContext
+ * @stats: (out): Return location for the statistics
+ *
+ * Retrieves statistics about the sampler states shared by the layers
+ * of all the pipelines. Entries are never dropped from this cache.
+ *
+ * Stability: Unstable
+ */
+void
+cogl_context_get_sampler_cache_stats (CoglContext *context,
+                                      CoglCacheStats *stats);
+
+/**
+ * cogl_context_trim_pipeline_cache:
+ * @context: A #CoglContext
+ *
+ * Drops the templates in the pipeline cache that no pipeline currently
+ * uses, along with the shaders and programs they hold. They are
+ * regenerated the next time a pipeline needs them.
+ *
+ * Stability: Unstable
+ */
+void
+cogl_context_trim_pipeline_cache (CoglContext *context);
+
+COGL_END_DECLS
+
+#endif /* __COGL_CACHE_STATS_H__ */
@@ -52,15 +52,31 @@
 #include "cogl1-context.h"
 #include "cogl-offscreen.h"
 #include "cogl-matrix-stack.h"
+#include "cogl-magazine-private.h"
 
-
+static CoglMagazine *clip_stack_magazine;
 
 static void *
 _cogl_clip_stack_push_entry (CoglClipStack *clip_stack,
                              size_t size,
                              CoglClipStackType type)
 {
-  CoglClipStack *entry = g_slice_alloc (size);
+  CoglClipStack *entry;
+
+  /* Clutter pushes and pops clip entries for every clipped actor it
+     paints, so they are recycled through a magazine sized for the
+     largest entry type */
+  if (G_UNLIKELY (clip_stack_magazine == NULL))
+    clip_stack_magazine =
+      _cogl_magazine_new ("Clip stack entry",
+                          MAX (sizeof (CoglClipStackRect),
+                               MAX (sizeof (CoglClipStackWindowRect),
+                                    sizeof (CoglClipStackPrimitive))),
+                          16);
+
+  g_assert (size <= clip_stack_magazine->chunk_size);
+
+  entry = _cogl_magazine_chunk_alloc (clip_stack_magazine);
 
   /* The new entry starts with a ref count of 1 because the stack
      holds a reference to it as it is the top entry */
@@ -326,11 +342,11 @@ _cogl_clip_stack_unref (CoglClipStack *entry)
           {
             CoglClipStackRect *rect = (CoglClipStackRect *) entry;
             cogl_matrix_entry_unref (rect->matrix_entry);
-            g_slice_free1 (sizeof (CoglClipStackRect), entry);
+            _cogl_magazine_chunk_free (clip_stack_magazine, entry);
             break;
           }
         case COGL_CLIP_STACK_WINDOW_RECT:
-          g_slice_free1 (sizeof (CoglClipStackWindowRect), entry);
+          _cogl_magazine_chunk_free (clip_stack_magazine, entry);
           break;
         case COGL_CLIP_STACK_PRIMITIVE:
           {
@@ -338,7 +354,7 @@ _cogl_clip_stack_unref (CoglClipStack *entry)
               (CoglClipStackPrimitive *) entry;
             cogl_matrix_entry_unref (primitive_entry->matrix_entry);
             cogl_object_unref (primitive_entry->primitive);
-            g_slice_free1 (sizeof (CoglClipStackPrimitive), entry);
+            _cogl_magazine_chunk_free (clip_stack_magazine, entry);
             break;
           }
         default:
@@ -127,6 +127,13 @@ struct _CoglContext
   CoglBitmask       enable_custom_attributes_tmp;
   CoglBitmask       changed_bits_tmp;
 
+  /* Vertex array objects set up for the GLSL progend, keyed by the
+   * buffered attributes they point at; see cogl-attribute-gl.c. The
+   * default one is where the attribute state above is tracked */
+  GHashTable       *vertex_array_cache;
+  GLuint            default_vertex_array;
+  GLuint            current_vertex_array;
+
   CoglBool          legacy_backface_culling_enabled;
 
   /* A few handy matrix constants */
@@ -180,6 +187,16 @@ struct _CoglContext
   GArray           *journal_flush_attributes_array;
   GArray           *journal_clip_bounds;
 
+  /* The persistently mapped buffer journals stream their vertices
+     into. Each segment gets a GL sync object once the journals move
+     past it and is only written again after that has signalled */
+  CoglAttributeBuffer *journal_ring;
+  uint8_t          *journal_ring_data;
+  int               journal_ring_segment;
+  size_t            journal_ring_offset;
+  void             *journal_ring_fences[COGL_JOURNAL_RING_N_SEGMENTS];
+  CoglBool          journal_ring_failed;
+
   GArray           *polygon_vertices;
 
   /* Some simple caching, to minimize state changes... */
@@ -222,6 +239,23 @@ struct _CoglContext
   CoglGLES2Context *current_gles2_context;
   GQueue gles2_context_stack;
 
+  /* GPU timer sections still open, innermost first, and those waiting
+   * for their results, see cogl-gpu-timer.c */
+  GQueue gpu_timer_stack;
+  GQueue gpu_timer_pending;
+  GArray *gpu_timer_queries;
+  CoglBool gpu_timer_flushes;
+
+  /* The estimated memory of textures and renderbuffers by category,
+   * see cogl-texture-memory.c */
+  GHashTable *texture_memory;
+
+  /* Uploads by memory category, the bytes uploaded since the queued
+   * uploads were last flushed and the queue, see cogl-texture-upload.c */
+  GHashTable *texture_uploads;
+  size_t upload_frame_bytes;
+  struct _CoglUploadQueue *upload_queue;
+
   /* This becomes TRUE the first time the context is bound to an
    * onscreen buffer. This is used by cogl-framebuffer-gl to determine
    * when to initialise the glDrawBuffer state */
@@ -316,6 +350,11 @@ struct _CoglContext
   /* Current top of the XError trap state stack. The actual memory for
      these is expected to be allocated on the stack by the caller */
   CoglXlibTrapState *trap_state;
+  /* Free shared memory segments and the staging pixel buffer reused
+     by every CoglTexturePixmapX11 that updates through XShmGetImage */
+  GList *shm_pool;
+  size_t shm_pool_size;
+  CoglBuffer *shm_staging_buffer;
 #endif
 
   unsigned long winsys_features
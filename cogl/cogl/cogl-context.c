@@ -43,6 +43,9 @@
 #include "cogl-display-private.h"
 #include "cogl-renderer-private.h"
 #include "cogl-journal-private.h"
+#include "cogl-gpu-timer-private.h"
+#include "cogl-texture-memory-private.h"
+#include "cogl-texture-upload-private.h"
 #include "cogl-texture-private.h"
 #include "cogl-texture-2d-private.h"
 #include "cogl-texture-3d-private.h"
@@ -52,12 +55,17 @@
 #include "cogl-framebuffer-private.h"
 #include "cogl-onscreen-private.h"
 #include "cogl-attribute-private.h"
+#include "cogl-attribute-gl-private.h"
 #include "cogl1-context.h"
 #include "cogl-gpu-info-private.h"
 #include "cogl-config-private.h"
 #include "cogl-error-private.h"
 #include "cogl-gtype-private.h"
 
+#ifdef COGL_HAS_XLIB_SUPPORT
+#include "winsys/cogl-texture-pixmap-x11-private.h"
+#endif
+
 #include "cogl/deprecated/cogl-framebuffer-deprecated.h"
 
 #include <string.h>
@@ -352,6 +360,17 @@ cogl_context_new (CoglDisplay *display,
 
   g_queue_init (&context->gles2_context_stack);
 
+  g_queue_init (&context->gpu_timer_stack);
+  g_queue_init (&context->gpu_timer_pending);
+  context->gpu_timer_queries = NULL;
+  context->gpu_timer_flushes = FALSE;
+
+  context->texture_memory = NULL;
+
+  context->texture_uploads = NULL;
+  context->upload_frame_bytes = 0;
+  context->upload_queue = NULL;
+
   context->journal_flush_attributes_array =
     g_array_new (TRUE, FALSE, sizeof (CoglAttribute *));
   context->journal_clip_bounds = NULL;
@@ -442,13 +461,14 @@ cogl_context_new (CoglDisplay *display,
       GLuint vertex_array;
 
       /* In a forward compatible context, GL 3 doesn't support rendering
-       * using the default vertex array object. Cogl doesn't use vertex
-       * array objects yet so for now we just create a dummy array
-       * object that we will use as our own default object. Eventually
-       * it could be good to attach the vertex array objects to
-       * CoglPrimitives */
+       * using the default vertex array object, so we create a dummy
+       * array object that we will use as our own default object. The
+       * GLSL progend caches other ones for the attributes it draws
+       * with, see cogl-attribute-gl.c */
       context->glGenVertexArrays (1, &vertex_array);
       context->glBindVertexArray (vertex_array);
+      context->default_vertex_array = vertex_array;
+      context->current_vertex_array = vertex_array;
     }
 #endif
 
@@ -531,6 +551,13 @@ _cogl_context_free (CoglContext *context)
 {
   const CoglWinsysVtable *winsys = _cogl_context_get_winsys (context);
 
+  /* The queued uploads hold texture references */
+  _cogl_texture_uploads_free (context);
+
+#ifdef COGL_HAS_XLIB_SUPPORT
+  _cogl_texture_pixmap_x11_free_shm_pool (context);
+#endif
+
   winsys->context_deinit (context);
 
   _cogl_free_framebuffer_stack (context->framebuffer_stack);
@@ -560,6 +587,10 @@ _cogl_context_free (CoglContext *context)
 
   g_warn_if_fail (context->gles2_context_stack.length == 0);
 
+  _cogl_journal_free_ring (context);
+
+  _cogl_gpu_timer_free (context);
+
   if (context->journal_flush_attributes_array)
     g_array_free (context->journal_flush_attributes_array, TRUE);
   if (context->journal_clip_bounds)
@@ -602,6 +633,8 @@ _cogl_context_free (CoglContext *context)
   _cogl_bitmask_destroy (&context->enable_custom_attributes_tmp);
   _cogl_bitmask_destroy (&context->changed_bits_tmp);
 
+  _cogl_gl_free_vertex_array_cache (context);
+
   if (context->current_modelview_entry)
     cogl_matrix_entry_unref (context->current_modelview_entry);
   if (context->current_projection_entry)
@@ -623,6 +656,9 @@ _cogl_context_free (CoglContext *context)
 
   g_byte_array_free (context->buffer_map_fallback_array, TRUE);
 
+  /* After the pipelines, which can hold the last texture references */
+  _cogl_texture_memory_free (context);
+
   cogl_object_unref (context->display);
 
   free (context);
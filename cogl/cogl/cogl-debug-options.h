@@ -37,7 +37,7 @@ OPT (SLICING,
      N_("Cogl Tracing"),
      "slicing",
      N_("Trace Texture Slicing"),
-     N_("debug the creation of texture slices"))
+     N_("debug the creation of texture slices and updates to them"))
 OPT (ATLAS,
      N_("Cogl Tracing"),
      "atlas",
@@ -187,6 +187,18 @@ OPT (DISABLE_FAST_READ_PIXEL,
      N_("Disable read pixel optimization"),
      N_("Disable optimization for reading 1px for simple "
         "scenes of opaque rectangles"))
+OPT (DISABLE_BATCH_REORDER,
+     N_("Root Cause"),
+     "disable-batch-reorder",
+     N_("Disable journal reordering"),
+     N_("Keep journal entries in submission order instead of moving "
+        "non-overlapping rectangles together to improve batching."))
+OPT (DISABLE_PARALLEL_SHADER_COMPILE,
+     N_("Root Cause"),
+     "disable-parallel-shader-compile",
+     N_("Disable parallel shader compilation"),
+     N_("Ask the driver to compile and link shaders on the thread "
+        "that submits them"))
 OPT (CLIPPING,
      N_("Cogl Tracing"),
      "clipping",
@@ -197,3 +209,9 @@ OPT (PERFORMANCE,
      "performance",
      N_("Trace performance concerns"),
      N_("Tries to highlight sub-optimal Cogl usage."))
+OPT (ALLOCATIONS,
+     N_("Cogl Tracing"),
+     "allocations",
+     N_("Trace magazine allocations"),
+     N_("Logs whenever one of the per-type allocators for frequently "
+        "created objects has to carve out a new chunk of memory."))
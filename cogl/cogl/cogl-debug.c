@@ -64,7 +64,8 @@ static const GDebugKey cogl_log_debug_keys[] = {
   { "bitmap", COGL_DEBUG_BITMAP },
   { "clipping", COGL_DEBUG_CLIPPING },
   { "winsys", COGL_DEBUG_WINSYS },
-  { "performance", COGL_DEBUG_PERFORMANCE }
+  { "performance", COGL_DEBUG_PERFORMANCE },
+  { "allocations", COGL_DEBUG_ALLOCATIONS }
 };
 static const int n_cogl_log_debug_keys =
   G_N_ELEMENTS (cogl_log_debug_keys);
@@ -87,7 +88,10 @@ static const GDebugKey cogl_behavioural_debug_keys[] = {
   { "wireframe", COGL_DEBUG_WIREFRAME},
   { "disable-software-clip", COGL_DEBUG_DISABLE_SOFTWARE_CLIP},
   { "disable-program-caches", COGL_DEBUG_DISABLE_PROGRAM_CACHES},
-  { "disable-fast-read-pixel", COGL_DEBUG_DISABLE_FAST_READ_PIXEL}
+  { "disable-fast-read-pixel", COGL_DEBUG_DISABLE_FAST_READ_PIXEL},
+  { "disable-batch-reorder", COGL_DEBUG_DISABLE_BATCH_REORDER},
+  { "disable-parallel-shader-compile",
+    COGL_DEBUG_DISABLE_PARALLEL_SHADER_COMPILE }
 };
 static const int n_cogl_behavioural_debug_keys =
   G_N_ELEMENTS (cogl_behavioural_debug_keys);
@@ -72,9 +72,12 @@ typedef enum {
   COGL_DEBUG_DISABLE_SOFTWARE_CLIP,
   COGL_DEBUG_DISABLE_PROGRAM_CACHES,
   COGL_DEBUG_DISABLE_FAST_READ_PIXEL,
+  COGL_DEBUG_DISABLE_BATCH_REORDER,
+  COGL_DEBUG_DISABLE_PARALLEL_SHADER_COMPILE,
   COGL_DEBUG_CLIPPING,
   COGL_DEBUG_WINSYS,
   COGL_DEBUG_PERFORMANCE,
+  COGL_DEBUG_ALLOCATIONS,
 
   COGL_DEBUG_N_FLAGS
 } CoglDebugFlags;
@@ -60,6 +60,7 @@ typedef struct
   CoglBool need_stencil;
   int samples_per_pixel;
   CoglBool swap_throttled;
+  CoglBool swap_tearing_allowed;
   CoglBool depth_texture_enabled;
   CoglBool stereo_enabled;
 } CoglFramebufferConfig;
@@ -107,16 +108,6 @@ typedef enum _CoglFramebufferState
 
 #define COGL_FRAMEBUFFER_STATE_ALL ((1<<COGL_FRAMEBUFFER_STATE_INDEX_MAX) - 1)
 
-/* Private flags that can internally be added to CoglReadPixelsFlags */
-typedef enum
-{
-  /* If this is set then the data will not be flipped to compensate
-     for GL's upside-down coordinate system but instead will be left
-     in whatever order GL gives us (which will depend on whether the
-     framebuffer is offscreen or not) */
-  COGL_READ_PIXELS_NO_FLIP = 1L << 30
-} CoglPrivateReadPixelsFlags;
-
 typedef struct
 {
   int red;
@@ -221,6 +212,10 @@ struct _CoglOffscreen
 
   CoglOffscreenAllocateFlags allocation_flags;
 
+  /* The estimated memory of the renderbuffers, accounted under
+   * "renderbuffers" */
+  size_t renderbuffer_bytes;
+
   /* FIXME: _cogl_offscreen_new_with_texture_full should be made to use
    * fb->config to configure if we want a depth or stencil buffer so
    * we can get rid of these flags */
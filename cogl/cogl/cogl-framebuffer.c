@@ -41,6 +41,7 @@
 #include "cogl-object-private.h"
 #include "cogl-util.h"
 #include "cogl-texture-private.h"
+#include "cogl-texture-2d-private.h"
 #include "cogl-framebuffer-private.h"
 #include "cogl-onscreen-template-private.h"
 #include "cogl-clip-stack.h"
@@ -250,6 +251,11 @@ void
 _cogl_framebuffer_mark_mid_scene (CoglFramebuffer *framebuffer)
 {
   framebuffer->mid_scene = TRUE;
+
+  /* Anything drawn to an offscreen framebuffer leaves the mipmaps of
+   * its texture out of date */
+  if (framebuffer->type == COGL_FRAMEBUFFER_TYPE_OFFSCREEN)
+    _cogl_texture_2d_externally_modified (COGL_OFFSCREEN (framebuffer)->texture);
 }
 
 void
@@ -1438,6 +1444,36 @@ cogl_framebuffer_read_pixels (CoglFramebuffer *framebuffer,
   return ret;
 }
 
+CoglBool
+cogl_framebuffer_copy_to_texture (CoglFramebuffer *framebuffer,
+                                  CoglTexture *texture,
+                                  int src_x,
+                                  int src_y,
+                                  int dst_x,
+                                  int dst_y,
+                                  int width,
+                                  int height)
+{
+  _COGL_RETURN_VAL_IF_FAIL (cogl_is_texture_2d (texture), FALSE);
+
+  /* The copy is made by GL straightaway, so whatever is still in the
+   * journal has to reach the framebuffer first */
+  _cogl_framebuffer_flush_journal (framebuffer);
+
+  /* GL counts rows from the bottom of onscreen framebuffers */
+  if (framebuffer->type == COGL_FRAMEBUFFER_TYPE_ONSCREEN)
+    src_y = framebuffer->height - src_y - height;
+
+  _cogl_texture_2d_copy_from_framebuffer (COGL_TEXTURE_2D (texture),
+                                          src_x, src_y,
+                                          width, height,
+                                          framebuffer,
+                                          dst_x, dst_y,
+                                          0);
+
+  return TRUE;
+}
+
 void
 _cogl_blit_framebuffer (CoglFramebuffer *src,
                         CoglFramebuffer *dest,
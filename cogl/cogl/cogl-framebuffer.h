@@ -1804,6 +1804,41 @@ cogl_framebuffer_read_pixels (CoglFramebuffer *framebuffer,
                               CoglPixelFormat format,
                               uint8_t *pixels);
 
+/**
+ * cogl_framebuffer_copy_to_texture:
+ * @framebuffer: A #CoglFramebuffer
+ * @texture: A #CoglTexture2D to copy into
+ * @src_x: The x position to copy from
+ * @src_y: The y position to copy from
+ * @dst_x: The x position within @texture to copy to
+ * @dst_y: The y position within @texture to copy to
+ * @width: The width of the rectangle to copy
+ * @height: The height of the rectangle to copy
+ *
+ * Copies a rectangle of @framebuffer, where position (0, 0) is the top
+ * left, into @texture without the pixels leaving the GPU. Anything
+ * drawn to @framebuffer so far is included.
+ *
+ * The rows are copied in the order the framebuffer stores them. For an
+ * offscreen framebuffer that is the order Cogl draws textures in, but
+ * an onscreen framebuffer stores them bottom up, so the rectangle ends
+ * up upside down in @texture and has to be drawn with flipped texture
+ * coordinates.
+ *
+ * Return value: %TRUE if the copy was made or %FALSE if @texture isn't
+ *   a #CoglTexture2D
+ * Stability: unstable
+ */
+CoglBool
+cogl_framebuffer_copy_to_texture (CoglFramebuffer *framebuffer,
+                                  CoglTexture *texture,
+                                  int src_x,
+                                  int src_y,
+                                  int dst_x,
+                                  int dst_y,
+                                  int width,
+                                  int height);
+
 /**
  * cogl_get_draw_framebuffer:
  *
@@ -38,4 +38,15 @@ _cogl_glsl_shader_set_source_with_boilerplate (CoglContext *ctx,
                                                const char **strings_in,
                                                const GLint *lengths_in);
 
+/* When the driver compiles in parallel this doesn't wait for the
+ * result; _cogl_glsl_shader_report_errors() can be used once the
+ * program using the shader has failed to link */
+void
+_cogl_glsl_shader_compile (CoglContext *ctx,
+                           GLuint shader_gl_handle);
+
+void
+_cogl_glsl_shader_report_errors (CoglContext *ctx,
+                                 GLuint shader_gl_handle);
+
 #endif /* _COGL_GLSL_SHADER_PRIVATE_H_ */
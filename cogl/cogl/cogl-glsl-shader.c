@@ -198,3 +198,38 @@ _cogl_glsl_shader_set_source_with_boilerplate (CoglContext *ctx,
 
   free (version_string);
 }
+
+void
+_cogl_glsl_shader_compile (CoglContext *ctx,
+                           GLuint shader_gl_handle)
+{
+  GE( ctx, glCompileShader (shader_gl_handle) );
+
+  /* Asking for the status would wait for the driver's compiler
+   * thread. Any error still turns up when the program fails to link,
+   * which reports it then */
+  if (!_cogl_has_private_feature
+      (ctx, COGL_PRIVATE_FEATURE_PARALLEL_SHADER_COMPILE))
+    _cogl_glsl_shader_report_errors (ctx, shader_gl_handle);
+}
+
+void
+_cogl_glsl_shader_report_errors (CoglContext *ctx,
+                                 GLuint shader_gl_handle)
+{
+  GLint compile_status;
+
+  GE( ctx, glGetShaderiv (shader_gl_handle,
+                          GL_COMPILE_STATUS, &compile_status) );
+
+  if (!compile_status)
+    {
+      GLint len = 0;
+      char *shader_log;
+
+      GE( ctx, glGetShaderiv (shader_gl_handle, GL_INFO_LOG_LENGTH, &len) );
+      shader_log = g_alloca (len);
+      GE( ctx, glGetShaderInfoLog (shader_gl_handle, len, &len, shader_log) );
+      g_warning ("Shader compilation failed:\n%s", shader_log);
+    }
+}
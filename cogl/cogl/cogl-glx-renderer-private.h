@@ -70,6 +70,10 @@ typedef struct _CoglGLXRenderer
 
   CoglFeatureFlags legacy_feature_flags;
 
+  /* GLX_EXT_swap_control_tear only adds negative intervals to
+   * glXSwapIntervalEXT, so it has no functions of its own */
+  CoglBool have_swap_control_tear;
+
   /* Function pointers for core GLX functionality. We can't just link
      against these directly because we need to conditionally load
      libGL when we are using GLX so that it won't conflict with a GLES
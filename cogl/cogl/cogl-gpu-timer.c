@@ -0,0 +1,219 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "cogl-config.h"
+#endif
+
+#include "cogl-context-private.h"
+#include "cogl-framebuffer-private.h"
+#include "cogl-util-gl-private.h"
+#include "cogl-private.h"
+#include "cogl-gpu-timer.h"
+#include "cogl-gpu-timer-private.h"
+
+/* A section is timed by two GL_TIMESTAMP queries */
+typedef struct
+{
+  const char *name;
+  int depth;
+  GLuint start_query;
+  GLuint end_query;
+} CoglGpuTimerSection;
+
+/* Past this many sections waiting to be collected new ones aren't
+ * timed, in case nobody collects them */
+#define MAX_PENDING_SECTIONS 4096
+
+static GLuint
+get_query (CoglContext *ctx)
+{
+  GArray *queries = ctx->gpu_timer_queries;
+  GLuint query;
+
+  if (queries != NULL && queries->len > 0)
+    {
+      query = g_array_index (queries, GLuint, queries->len - 1);
+      g_array_set_size (queries, queries->len - 1);
+    }
+  else
+    GE( ctx, glGenQueries (1, &query) );
+
+  return query;
+}
+
+static void
+release_section (CoglContext *ctx,
+                 CoglGpuTimerSection *section)
+{
+  if (ctx->gpu_timer_queries == NULL)
+    ctx->gpu_timer_queries = g_array_new (FALSE, FALSE, sizeof (GLuint));
+
+  if (section->start_query)
+    g_array_append_val (ctx->gpu_timer_queries, section->start_query);
+  if (section->end_query)
+    g_array_append_val (ctx->gpu_timer_queries, section->end_query);
+
+  g_slice_free (CoglGpuTimerSection, section);
+}
+
+CoglBool
+cogl_gpu_timer_is_supported (CoglContext *context)
+{
+  return _cogl_has_private_feature (context,
+                                    COGL_PRIVATE_FEATURE_TIMER_QUERY);
+}
+
+void
+_cogl_gpu_timer_push (CoglContext *ctx,
+                      const char *name)
+{
+  CoglGpuTimerSection *section = g_slice_new0 (CoglGpuTimerSection);
+
+  section->name = name;
+  section->depth = ctx->gpu_timer_stack.length;
+
+  /* Untimed sections are still pushed so the pops stay balanced */
+  if (ctx->gpu_timer_pending.length < MAX_PENDING_SECTIONS)
+    {
+      section->start_query = get_query (ctx);
+      GE( ctx, glQueryCounter (section->start_query, GL_TIMESTAMP) );
+    }
+
+  g_queue_push_head (&ctx->gpu_timer_stack, section);
+}
+
+void
+_cogl_gpu_timer_pop (CoglContext *ctx)
+{
+  CoglGpuTimerSection *section = g_queue_pop_head (&ctx->gpu_timer_stack);
+
+  _COGL_RETURN_IF_FAIL (section != NULL);
+
+  if (section->start_query == 0)
+    {
+      release_section (ctx, section);
+      return;
+    }
+
+  section->end_query = get_query (ctx);
+  GE( ctx, glQueryCounter (section->end_query, GL_TIMESTAMP) );
+
+  g_queue_push_tail (&ctx->gpu_timer_pending, section);
+}
+
+void
+cogl_framebuffer_push_gpu_timer (CoglFramebuffer *framebuffer,
+                                 const char *name)
+{
+  CoglContext *ctx = framebuffer->context;
+
+  if (!cogl_gpu_timer_is_supported (ctx))
+    return;
+
+  /* Only what was drawn up to now is in the GL command stream */
+  _cogl_framebuffer_flush_journal (framebuffer);
+
+  _cogl_gpu_timer_push (ctx, name);
+}
+
+void
+cogl_framebuffer_pop_gpu_timer (CoglFramebuffer *framebuffer)
+{
+  CoglContext *ctx = framebuffer->context;
+
+  if (!cogl_gpu_timer_is_supported (ctx))
+    return;
+
+  _cogl_framebuffer_flush_journal (framebuffer);
+
+  _cogl_gpu_timer_pop (ctx);
+}
+
+void
+cogl_gpu_timer_collect (CoglContext *context,
+                        CoglGpuTimerCallback callback,
+                        void *user_data)
+{
+  CoglGpuTimerSection *section;
+  GLint disjoint = GL_FALSE;
+
+  if (!cogl_gpu_timer_is_supported (context))
+    return;
+
+  context->gpu_timer_flushes = TRUE;
+
+  /* Only GL_EXT_disjoint_timer_query can tell us the timestamps
+   * stopped being comparable; reading the flag also clears it */
+  if (_cogl_has_private_feature (context, COGL_PRIVATE_FEATURE_GL_EMBEDDED))
+    GE( context, glGetIntegerv (GL_GPU_DISJOINT_EXT, &disjoint) );
+
+  /* The sections are queued in the order they ended, which is the
+   * order the GPU gets to their end queries */
+  while ((section = g_queue_peek_head (&context->gpu_timer_pending)))
+    {
+      GLint available = GL_FALSE;
+      uint64_t start, end;
+
+      GE( context, glGetQueryObjectiv (section->end_query,
+                                       GL_QUERY_RESULT_AVAILABLE,
+                                       &available) );
+      if (!available)
+        break;
+
+      g_queue_pop_head (&context->gpu_timer_pending);
+
+      GE( context, glGetQueryObjectui64v (section->start_query,
+                                          GL_QUERY_RESULT, &start) );
+      GE( context, glGetQueryObjectui64v (section->end_query,
+                                          GL_QUERY_RESULT, &end) );
+
+      if (!disjoint && end >= start)
+        callback (section->name, section->depth, end - start, user_data);
+
+      release_section (context, section);
+    }
+}
+
+void
+_cogl_gpu_timer_free (CoglContext *ctx)
+{
+  CoglGpuTimerSection *section;
+
+  while ((section = g_queue_pop_head (&ctx->gpu_timer_stack)))
+    release_section (ctx, section);
+  while ((section = g_queue_pop_head (&ctx->gpu_timer_pending)))
+    release_section (ctx, section);
+
+  if (ctx->gpu_timer_queries)
+    {
+      if (ctx->gpu_timer_queries->len > 0)
+        GE( ctx, glDeleteQueries (ctx->gpu_timer_queries->len,
+                                  (GLuint *) ctx->gpu_timer_queries->data) );
+      g_array_free (ctx->gpu_timer_queries, TRUE);
+      ctx->gpu_timer_queries = NULL;
+    }
+}
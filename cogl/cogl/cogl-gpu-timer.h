@@ -0,0 +1,131 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(__COGL_H_INSIDE__) && !defined(COGL_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_GPU_TIMER_H__
+#define __COGL_GPU_TIMER_H__
+
+#include <cogl/cogl-types.h>
+#include <cogl/cogl-context.h>
+#include <cogl/cogl-framebuffer.h>
+
+COGL_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-gpu-timer
+ * @short_description: Functions for measuring GPU time
+ *
+ * Cogl can measure how long the GPU takes to execute the commands
+ * submitted between two points, using timestamp queries. The results
+ * only become available once the GPU has caught up, usually a frame or
+ * two later, so they are collected asynchronously with
+ * cogl_gpu_timer_collect().
+ *
+ * A section has to flush the framebuffer's journal at each end, which
+ * defeats batching across it; these functions are meant for profiling.
+ */
+
+/**
+ * CoglGpuTimerCallback:
+ * @name: The name the section was pushed with
+ * @depth: How many sections enclosed it, 0 for the outermost ones
+ * @elapsed_ns: The GPU time spent in the section, in nanoseconds
+ * @user_data: The private data passed to cogl_gpu_timer_collect()
+ *
+ * The callback prototype used with cogl_gpu_timer_collect().
+ *
+ * Stability: Unstable
+ */
+typedef void (* CoglGpuTimerCallback) (const char *name,
+                                       int depth,
+                                       int64_t elapsed_ns,
+                                       void *user_data);
+
+/**
+ * cogl_gpu_timer_is_supported:
+ * @context: A #CoglContext
+ *
+ * Return value: %TRUE if the driver supports the timestamp queries
+ *   GPU timing depends on. When it doesn't, the other functions here
+ *   do nothing.
+ *
+ * Stability: Unstable
+ */
+CoglBool
+cogl_gpu_timer_is_supported (CoglContext *context);
+
+/**
+ * cogl_framebuffer_push_gpu_timer:
+ * @framebuffer: The #CoglFramebuffer being drawn to
+ * @name: A name for the section, which must stay valid until the
+ *   section is collected; an interned string is the easiest
+ *
+ * Starts timing the commands submitted from now on, up to the matching
+ * cogl_framebuffer_pop_gpu_timer(). Sections may be nested.
+ *
+ * Stability: Unstable
+ */
+void
+cogl_framebuffer_push_gpu_timer (CoglFramebuffer *framebuffer,
+                                 const char *name);
+
+/**
+ * cogl_framebuffer_pop_gpu_timer:
+ * @framebuffer: The #CoglFramebuffer being drawn to
+ *
+ * Ends the section started by the last cogl_framebuffer_push_gpu_timer().
+ *
+ * Stability: Unstable
+ */
+void
+cogl_framebuffer_pop_gpu_timer (CoglFramebuffer *framebuffer);
+
+/**
+ * cogl_gpu_timer_collect:
+ * @context: A #CoglContext
+ * @callback: (scope call): A #CoglGpuTimerCallback
+ * @user_data: (closure): Private data passed to @callback
+ *
+ * Calls @callback for each finished section whose result the GPU has
+ * made available, in the order they ended, without waiting for the
+ * others. Results spanning a GPU reset or clock change are dropped.
+ *
+ * Once this has been called, the flushes of all journals are timed as
+ * sections named "journal flush" too.
+ *
+ * Stability: Unstable
+ */
+void
+cogl_gpu_timer_collect (CoglContext *context,
+                        CoglGpuTimerCallback callback,
+                        void *user_data);
+
+COGL_END_DECLS
+
+#endif /* __COGL_GPU_TIMER_H__ */
@@ -38,6 +38,11 @@
 
 #define COGL_JOURNAL_VBO_POOL_SIZE 8
 
+/* With persistent buffers the journals share a streaming buffer made
+ * of this many segments, see reserve_ring_space() in cogl-journal.c */
+#define COGL_JOURNAL_RING_N_SEGMENTS 4
+#define COGL_JOURNAL_RING_SEGMENT_SIZE (1024 * 1024)
+
 typedef struct _CoglJournal
 {
   CoglObject _parent;
@@ -54,6 +59,11 @@ typedef struct _CoglJournal
   GArray *vertices;
   size_t needed_vbo_len;
 
+  /* Spare arrays that the flush swaps with the ones above when it
+     reorders the entries, kept around to avoid reallocating them */
+  GArray *reorder_entries;
+  GArray *reorder_vertices;
+
   /* A pool of attribute buffers is used so that we can avoid repeatedly
      reallocating buffers. Only one of these buffers at a time will be
      used by Cogl but we keep more than one alive anyway in case the
@@ -118,4 +128,7 @@ _cogl_journal_try_read_pixel (CoglJournal *journal,
 CoglBool
 _cogl_is_journal (void *object);
 
+void
+_cogl_journal_free_ring (CoglContext *ctx);
+
 #endif /* __COGL_JOURNAL_PRIVATE_H */
@@ -0,0 +1,72 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __COGL_JOURNAL_TRANSFORM_PRIVATE_H
+#define __COGL_JOURNAL_TRANSFORM_PRIVATE_H
+
+#include <stddef.h>
+
+#include "cogl-matrix.h"
+
+/*
+ * Transforms and expands a run of logged quads sharing one modelview.
+ *
+ * Each quad is logged as two corners (x0, y0) and (x1, y1), the
+ * second @corner_stride floats after the first, and consecutive quads
+ * start @quad_stride floats apart in @vin. For each quad four (x, y, z)
+ * vertices are written @vertex_stride floats apart in @vout, in the
+ * order (x0, y0), (x0, y1), (x1, y1), (x1, y0), and the next quad's
+ * vertices follow 4 * @vertex_stride floats later.
+ *
+ * The vectorised versions store whole 4-float registers so the float
+ * following each position may be clobbered; the journal writes the
+ * color there afterwards.
+ */
+typedef void (* CoglJournalTransformFunc) (const CoglMatrix *matrix,
+                                           const float *vin,
+                                           size_t corner_stride,
+                                           size_t quad_stride,
+                                           float *vout,
+                                           size_t vertex_stride,
+                                           int n_quads);
+
+typedef struct
+{
+  const char *name;
+  CoglJournalTransformFunc func;
+} CoglJournalTransformImpl;
+
+/* Returns the implementations this CPU can run, the plain C one
+ * first and the preferred one last. */
+const CoglJournalTransformImpl *
+_cogl_journal_transform_get_impls (int *n_impls);
+
+/* The implementation the journal uses. It can be forced by setting
+ * COGL_JOURNAL_TRANSFORM to the name of one of the above. */
+CoglJournalTransformFunc
+_cogl_journal_transform_get_func (void);
+
+#endif /* __COGL_JOURNAL_TRANSFORM_PRIVATE_H */
@@ -0,0 +1,368 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "cogl-config.h"
+#endif
+
+#include <string.h>
+#include <math.h>
+
+#include <glib.h>
+
+#include <test-fixtures/test-unit.h>
+
+#include "cogl-journal-transform-private.h"
+
+/* The quads logged by the journal are axis aligned in model space with
+ * z = 0, so every corner is (x0 or x1, y0 or y1, 0, 1). Transforming
+ * it is column0 * x + column1 * y + column3, and because the corners
+ * share their x and y values the two products per axis can be
+ * computed once and added in pairs. */
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+  (defined(__x86_64__) || defined(__i386__))
+#define COGL_JOURNAL_TRANSFORM_SSE2
+#include <xmmintrin.h>
+
+/* AVX2 isn't part of any baseline so it is compiled with a target
+   attribute and only picked after checking the CPU */
+#if defined(__clang__) || \
+  (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define COGL_JOURNAL_TRANSFORM_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define COGL_JOURNAL_TRANSFORM_NEON
+#include <arm_neon.h>
+#endif
+
+static void
+transform_quads_c (const CoglMatrix *matrix,
+                   const float *vin,
+                   size_t corner_stride,
+                   size_t quad_stride,
+                   float *vout,
+                   size_t vertex_stride,
+                   int n_quads)
+{
+  int i;
+
+  for (i = 0; i < n_quads; i++)
+    {
+      float x0 = vin[0], y0 = vin[1];
+      float x1 = vin[corner_stride], y1 = vin[corner_stride + 1];
+      float ax0[3], ax1[3], by0[3], by1[3];
+      int c;
+
+      ax0[0] = matrix->xx * x0 + matrix->xw;
+      ax0[1] = matrix->yx * x0 + matrix->yw;
+      ax0[2] = matrix->zx * x0 + matrix->zw;
+      ax1[0] = matrix->xx * x1 + matrix->xw;
+      ax1[1] = matrix->yx * x1 + matrix->yw;
+      ax1[2] = matrix->zx * x1 + matrix->zw;
+      by0[0] = matrix->xy * y0;
+      by0[1] = matrix->yy * y0;
+      by0[2] = matrix->zy * y0;
+      by1[0] = matrix->xy * y1;
+      by1[1] = matrix->yy * y1;
+      by1[2] = matrix->zy * y1;
+
+      for (c = 0; c < 3; c++)
+        {
+          vout[vertex_stride * 0 + c] = ax0[c] + by0[c];
+          vout[vertex_stride * 1 + c] = ax0[c] + by1[c];
+          vout[vertex_stride * 2 + c] = ax1[c] + by1[c];
+          vout[vertex_stride * 3 + c] = ax1[c] + by0[c];
+        }
+
+      vin += quad_stride;
+      vout += vertex_stride * 4;
+    }
+}
+
+#ifdef COGL_JOURNAL_TRANSFORM_SSE2
+
+static void
+transform_quads_sse2 (const CoglMatrix *matrix,
+                      const float *vin,
+                      size_t corner_stride,
+                      size_t quad_stride,
+                      float *vout,
+                      size_t vertex_stride,
+                      int n_quads)
+{
+  /* CoglMatrix is column major so each column is four consecutive
+     floats. The w row ends up in the fourth lane and is stored over
+     the color word */
+  __m128 col0 = _mm_loadu_ps (&matrix->xx);
+  __m128 col1 = _mm_loadu_ps (&matrix->xy);
+  __m128 col3 = _mm_loadu_ps (&matrix->xw);
+  int i;
+
+  for (i = 0; i < n_quads; i++)
+    {
+      __m128 ax0, ax1, by0, by1;
+
+      ax0 = _mm_add_ps (_mm_mul_ps (col0, _mm_set1_ps (vin[0])), col3);
+      ax1 = _mm_add_ps (_mm_mul_ps (col0, _mm_set1_ps (vin[corner_stride])),
+                        col3);
+      by0 = _mm_mul_ps (col1, _mm_set1_ps (vin[1]));
+      by1 = _mm_mul_ps (col1, _mm_set1_ps (vin[corner_stride + 1]));
+
+      _mm_storeu_ps (vout + vertex_stride * 0, _mm_add_ps (ax0, by0));
+      _mm_storeu_ps (vout + vertex_stride * 1, _mm_add_ps (ax0, by1));
+      _mm_storeu_ps (vout + vertex_stride * 2, _mm_add_ps (ax1, by1));
+      _mm_storeu_ps (vout + vertex_stride * 3, _mm_add_ps (ax1, by0));
+
+      vin += quad_stride;
+      vout += vertex_stride * 4;
+    }
+}
+
+#endif /* COGL_JOURNAL_TRANSFORM_SSE2 */
+
+#ifdef COGL_JOURNAL_TRANSFORM_AVX2
+
+__attribute__ ((target ("avx2")))
+static void
+transform_quads_avx2 (const CoglMatrix *matrix,
+                      const float *vin,
+                      size_t corner_stride,
+                      size_t quad_stride,
+                      float *vout,
+                      size_t vertex_stride,
+                      int n_quads)
+{
+  /* Each register holds the same column twice so that both corners of
+     a quad are handled at once: the low half works on (x0, y0) and the
+     high half on (x1, y1) */
+  __m256 col0 = _mm256_broadcast_ps ((const __m128 *) &matrix->xx);
+  __m256 col1 = _mm256_broadcast_ps ((const __m128 *) &matrix->xy);
+  __m256 col3 = _mm256_broadcast_ps ((const __m128 *) &matrix->xw);
+  int i;
+
+  for (i = 0; i < n_quads; i++)
+    {
+      __m256 x, y, ax, by, by_swapped, v02, v13;
+
+      x = _mm256_insertf128_ps (_mm256_set1_ps (vin[0]),
+                                _mm_set1_ps (vin[corner_stride]), 1);
+      y = _mm256_insertf128_ps (_mm256_set1_ps (vin[1]),
+                                _mm_set1_ps (vin[corner_stride + 1]), 1);
+
+      ax = _mm256_add_ps (_mm256_mul_ps (col0, x), col3);
+      by = _mm256_mul_ps (col1, y);
+      by_swapped = _mm256_permute2f128_ps (by, by, 0x01);
+
+      /* (ax0 + by0, ax1 + by1) and (ax0 + by1, ax1 + by0) */
+      v02 = _mm256_add_ps (ax, by);
+      v13 = _mm256_add_ps (ax, by_swapped);
+
+      _mm_storeu_ps (vout + vertex_stride * 0, _mm256_castps256_ps128 (v02));
+      _mm_storeu_ps (vout + vertex_stride * 1, _mm256_castps256_ps128 (v13));
+      _mm_storeu_ps (vout + vertex_stride * 2,
+                     _mm256_extractf128_ps (v02, 1));
+      _mm_storeu_ps (vout + vertex_stride * 3,
+                     _mm256_extractf128_ps (v13, 1));
+
+      vin += quad_stride;
+      vout += vertex_stride * 4;
+    }
+}
+
+#endif /* COGL_JOURNAL_TRANSFORM_AVX2 */
+
+#ifdef COGL_JOURNAL_TRANSFORM_NEON
+
+static void
+transform_quads_neon (const CoglMatrix *matrix,
+                      const float *vin,
+                      size_t corner_stride,
+                      size_t quad_stride,
+                      float *vout,
+                      size_t vertex_stride,
+                      int n_quads)
+{
+  float32x4_t col0 = vld1q_f32 (&matrix->xx);
+  float32x4_t col1 = vld1q_f32 (&matrix->xy);
+  float32x4_t col3 = vld1q_f32 (&matrix->xw);
+  int i;
+
+  for (i = 0; i < n_quads; i++)
+    {
+      float32x4_t ax0, ax1, by0, by1;
+
+      ax0 = vmlaq_n_f32 (col3, col0, vin[0]);
+      ax1 = vmlaq_n_f32 (col3, col0, vin[corner_stride]);
+      by0 = vmulq_n_f32 (col1, vin[1]);
+      by1 = vmulq_n_f32 (col1, vin[corner_stride + 1]);
+
+      vst1q_f32 (vout + vertex_stride * 0, vaddq_f32 (ax0, by0));
+      vst1q_f32 (vout + vertex_stride * 1, vaddq_f32 (ax0, by1));
+      vst1q_f32 (vout + vertex_stride * 2, vaddq_f32 (ax1, by1));
+      vst1q_f32 (vout + vertex_stride * 3, vaddq_f32 (ax1, by0));
+
+      vin += quad_stride;
+      vout += vertex_stride * 4;
+    }
+}
+
+#endif /* COGL_JOURNAL_TRANSFORM_NEON */
+
+static const CoglJournalTransformImpl all_impls[] =
+  {
+    { "c", transform_quads_c },
+#ifdef COGL_JOURNAL_TRANSFORM_NEON
+    { "neon", transform_quads_neon },
+#endif
+#ifdef COGL_JOURNAL_TRANSFORM_SSE2
+    { "sse2", transform_quads_sse2 },
+#endif
+#ifdef COGL_JOURNAL_TRANSFORM_AVX2
+    { "avx2", transform_quads_avx2 },
+#endif
+  };
+
+const CoglJournalTransformImpl *
+_cogl_journal_transform_get_impls (int *n_impls)
+{
+  int n = G_N_ELEMENTS (all_impls);
+
+#ifdef COGL_JOURNAL_TRANSFORM_AVX2
+  /* AVX2 is always last so it can simply be left out */
+  __builtin_cpu_init ();
+  if (!__builtin_cpu_supports ("avx2"))
+    n--;
+#endif
+
+  *n_impls = n;
+
+  return all_impls;
+}
+
+CoglJournalTransformFunc
+_cogl_journal_transform_get_func (void)
+{
+  static CoglJournalTransformFunc func = NULL;
+
+  if (G_UNLIKELY (func == NULL))
+    {
+      const CoglJournalTransformImpl *impls;
+      const char *name = g_getenv ("COGL_JOURNAL_TRANSFORM");
+      int n_impls, i;
+
+      impls = _cogl_journal_transform_get_impls (&n_impls);
+      func = impls[n_impls - 1].func;
+
+      if (name)
+        {
+          for (i = 0; i < n_impls; i++)
+            if (!strcmp (impls[i].name, name))
+              break;
+
+          if (i < n_impls)
+            func = impls[i].func;
+          else
+            g_warning ("Unknown or unsupported COGL_JOURNAL_TRANSFORM "
+                       "implementation \"%s\"", name);
+        }
+    }
+
+  return func;
+}
+
+UNIT_TEST (check_journal_transform_impls,
+           0, /* no requirements */
+           0 /* no failure cases */)
+{
+  /* 2 corners with one layer of texture coordinates, one color word in
+     between quads, like the journal logs them */
+  const size_t corner_stride = 4, quad_stride = 9, vertex_stride = 6;
+  const int n_quads = 3;
+  float vin[9 * 3];
+  float expected[6 * 4 * 3];
+  float vout[6 * 4 * 3 + 1];
+  const CoglJournalTransformImpl *impls;
+  CoglMatrix matrix;
+  int n_impls, i, q, v;
+
+  for (i = 0; i < G_N_ELEMENTS (vin); i++)
+    vin[i] = i * 1.5f - 10.0f;
+
+  cogl_matrix_init_identity (&matrix);
+  cogl_matrix_translate (&matrix, 10, 20, -3);
+  cogl_matrix_rotate (&matrix, 30, 0.3, 0.5, 1);
+  cogl_matrix_scale (&matrix, 2, 0.5, 1);
+
+  for (q = 0; q < n_quads; q++)
+    {
+      const float *corners = vin + q * quad_stride;
+      float points[8];
+
+      points[0] = corners[0];
+      points[1] = corners[1];
+      points[2] = corners[0];
+      points[3] = corners[corner_stride + 1];
+      points[4] = corners[corner_stride];
+      points[5] = corners[corner_stride + 1];
+      points[6] = corners[corner_stride];
+      points[7] = corners[1];
+
+      cogl_matrix_transform_points (&matrix,
+                                    2, /* n_components */
+                                    sizeof (float) * 2, /* stride_in */
+                                    points,
+                                    sizeof (float) * vertex_stride,
+                                    expected + q * vertex_stride * 4,
+                                    4 /* n_points */);
+    }
+
+  impls = _cogl_journal_transform_get_impls (&n_impls);
+
+  for (i = 0; i < n_impls; i++)
+    {
+      memset (vout, 0, sizeof (vout));
+
+      impls[i].func (&matrix, vin, corner_stride, quad_stride,
+                     vout, vertex_stride, n_quads);
+
+      for (v = 0; v < n_quads * 4; v++)
+        {
+          int c;
+
+          for (c = 0; c < 3; c++)
+            g_assert_cmpfloat (fabsf (vout[v * vertex_stride + c] -
+                                      expected[v * vertex_stride + c]),
+                               <, 1e-3f);
+        }
+
+      /* Nothing may be written beyond the last vertex */
+      g_assert_cmpfloat (vout[G_N_ELEMENTS (vout) - 1], ==, 0.0f);
+    }
+}
@@ -35,14 +35,19 @@
 #include "cogl-debug.h"
 #include "cogl-context-private.h"
 #include "cogl-journal-private.h"
+#include "cogl-journal-transform-private.h"
 #include "cogl-texture-private.h"
 #include "cogl-pipeline-private.h"
+#include "cogl-pipeline-state-private.h"
 #include "cogl-pipeline-opengl-private.h"
+#include "cogl-buffer-gl-private.h"
 #include "cogl-vertex-buffer-private.h"
 #include "cogl-framebuffer-private.h"
 #include "cogl-profile.h"
 #include "cogl-attribute-private.h"
 #include "cogl-point-in-poly-private.h"
+#include "cogl-gpu-timer-private.h"
+#include "cogl-trace-private.h"
 #include "cogl-private.h"
 #include "cogl1-context.h"
 
@@ -137,6 +142,10 @@ _cogl_journal_free (CoglJournal *journal)
     g_array_free (journal->entries, TRUE);
   if (journal->vertices)
     g_array_free (journal->vertices, TRUE);
+  if (journal->reorder_entries)
+    g_array_free (journal->reorder_entries, TRUE);
+  if (journal->reorder_vertices)
+    g_array_free (journal->reorder_vertices, TRUE);
 
   for (i = 0; i < COGL_JOURNAL_VBO_POOL_SIZE; i++)
     if (journal->vbo_pool[i])
@@ -160,6 +169,9 @@ _cogl_journal_new (CoglFramebuffer *framebuffer)
 
   journal->entries = g_array_new (FALSE, FALSE, sizeof (CoglJournalEntry));
   journal->vertices = g_array_new (FALSE, FALSE, sizeof (float));
+  journal->reorder_entries =
+    g_array_new (FALSE, FALSE, sizeof (CoglJournalEntry));
+  journal->reorder_vertices = g_array_new (FALSE, FALSE, sizeof (float));
 
   _cogl_list_init (&journal->pending_fences);
 
@@ -453,12 +465,26 @@ _cogl_journal_flush_pipeline_and_entries (CoglJournalEntry *batch_start,
 static CoglBool
 compare_entry_pipelines (CoglJournalEntry *entry0, CoglJournalEntry *entry1)
 {
+  unsigned int state = COGL_PIPELINE_STATE_ALL & ~COGL_PIPELINE_STATE_COLOR;
+
   /* batch rectangles using compatible pipelines */
 
+  if (entry0->pipeline == entry1->pipeline)
+    return TRUE;
+
+  /* Journaled pipelines can't change until the journal is flushed and
+   * each one is compared to both of its neighbours in every batching
+   * pass, so it pays to hash them once; after that differing pipelines
+   * are told apart without walking their ancestry again */
+  if (_cogl_pipeline_hash (entry0->pipeline, state,
+                           COGL_PIPELINE_LAYER_STATE_ALL, 0) !=
+      _cogl_pipeline_hash (entry1->pipeline, state,
+                           COGL_PIPELINE_LAYER_STATE_ALL, 0))
+    return FALSE;
+
   if (_cogl_pipeline_equal (entry0->pipeline,
                             entry1->pipeline,
-                            (COGL_PIPELINE_STATE_ALL &
-                             ~COGL_PIPELINE_STATE_COLOR),
+                            state,
                             COGL_PIPELINE_LAYER_STATE_ALL,
                             0))
     return TRUE;
@@ -765,10 +791,16 @@ typedef struct
   float x_2, y_2;
 } ClipBounds;
 
+/* Checks whether the rectangle clips of @clip_stack above
+ * @clip_base can be applied to @journal_entry by adjusting its
+ * vertex and texture coordinates, and returns their combined bounds
+ * in the entry's modelview space. @clip_base is the part of the stack
+ * left for hardware clipping, or NULL. */
 static CoglBool
 can_software_clip_entry (CoglJournalEntry *journal_entry,
                          CoglJournalEntry *prev_journal_entry,
                          CoglClipStack *clip_stack,
+                         CoglClipStack *clip_base,
                          ClipBounds *clip_bounds_out)
 {
   CoglPipeline *pipeline = journal_entry->pipeline;
@@ -802,7 +834,9 @@ can_software_clip_entry (CoglJournalEntry *journal_entry,
      translation of the journal entry's modelview matrix. We can
      also work out the bounds of the clip in modelview space using
      this translation */
-  for (clip_entry = clip_stack; clip_entry; clip_entry = clip_entry->parent)
+  for (clip_entry = clip_stack;
+       clip_entry != clip_base;
+       clip_entry = clip_entry->parent)
     {
       float rect_x1, rect_y1, rect_x2, rect_y2;
       CoglClipStackRect *clip_rect;
@@ -851,9 +885,12 @@ can_software_clip_entry (CoglJournalEntry *journal_entry,
   return TRUE;
 }
 
+/* Applies the clip bounds found by can_software_clip_entry() to the
+ * entry, leaving it with only @clip_base as its clip stack */
 static void
 software_clip_entry (CoglJournalEntry *journal_entry,
                      float *verts,
+                     CoglClipStack *clip_base,
                      ClipBounds *clip_bounds)
 {
   size_t stride =
@@ -863,8 +900,10 @@ software_clip_entry (CoglJournalEntry *journal_entry,
   int layer_num;
 
   /* Remove the clip on the entry */
+  if (clip_base)
+    _cogl_clip_stack_ref (clip_base);
   _cogl_clip_stack_unref (journal_entry->clip_stack);
-  journal_entry->clip_stack = NULL;
+  journal_entry->clip_stack = clip_base;
 
   vx1 = verts[0];
   vy1 = verts[1];
@@ -950,7 +989,7 @@ maybe_software_clip_entries (CoglJournalEntry      *batch_start,
 {
   CoglContext *ctx;
   CoglJournal *journal;
-  CoglClipStack *clip_stack, *clip_entry;
+  CoglClipStack *clip_stack, *clip_base;
   int entry_num;
 
   /* This tries to find cases where the entry is logged with a clip
@@ -968,11 +1007,19 @@ maybe_software_clip_entries (CoglJournalEntry      *batch_start,
   if (clip_stack == NULL)
     return;
 
-  /* Verify that all of the clip stack entries are a simple rectangle
-     clip */
-  for (clip_entry = clip_stack; clip_entry; clip_entry = clip_entry->parent)
-    if (clip_entry->type != COGL_CLIP_STACK_RECT)
-      return;
+  /* Only the rectangle clips at the top of the stack can be done in
+     software. Whatever is beneath them, typically the window space
+     scissor of a clipped redraw, is shared by many batches, so once
+     their rectangle clips are gone those batches end up with the
+     same clip stack and get joined together in the next pass without
+     any further clip state changes */
+  for (clip_base = clip_stack;
+       clip_base && clip_base->type == COGL_CLIP_STACK_RECT;
+       clip_base = clip_base->parent)
+    ;
+
+  if (clip_base == clip_stack)
+    return;
 
   ctx = state->ctx;
   journal = state->journal;
@@ -995,14 +1042,15 @@ maybe_software_clip_entries (CoglJournalEntry      *batch_start,
                                                 ClipBounds, entry_num);
 
       if (!can_software_clip_entry (journal_entry, prev_journal_entry,
-                                    clip_stack,
+                                    clip_stack, clip_base,
                                     clip_bounds))
         return;
     }
 
   /* If we make it here then we know we can software clip the entire batch */
 
-  COGL_NOTE (CLIPPING, "Software clipping a batch of length %i", batch_len);
+  COGL_NOTE (CLIPPING, "Software clipping a batch of length %i%s", batch_len,
+             clip_base ? " down to its base clip" : "");
 
   for (entry_num = 0; entry_num < batch_len; entry_num++)
     {
@@ -1012,7 +1060,7 @@ maybe_software_clip_entries (CoglJournalEntry      *batch_start,
       ClipBounds *clip_bounds = &g_array_index (ctx->journal_clip_bounds,
                                                 ClipBounds, entry_num);
 
-      software_clip_entry (journal_entry, verts, clip_bounds);
+      software_clip_entry (journal_entry, verts, clip_base, clip_bounds);
     }
 
   return;
@@ -1082,33 +1130,169 @@ create_attribute_buffer (CoglJournal *journal,
   return cogl_object_ref (vbo);
 }
 
+static CoglBool
+ensure_ring (CoglContext *ctx)
+{
+  CoglError *error = NULL;
+
+  if (ctx->journal_ring)
+    return TRUE;
+
+  if (ctx->journal_ring_failed)
+    return FALSE;
+
+  ctx->journal_ring =
+    cogl_attribute_buffer_new_with_size (ctx,
+                                         COGL_JOURNAL_RING_N_SEGMENTS *
+                                         COGL_JOURNAL_RING_SEGMENT_SIZE);
+  ctx->journal_ring_data =
+    _cogl_buffer_gl_map_persistent (COGL_BUFFER (ctx->journal_ring), &error);
+
+  if (ctx->journal_ring_data == NULL)
+    {
+      if (error)
+        {
+          COGL_NOTE (OPENGL, "Not streaming journal vertices: %s",
+                     error->message);
+          cogl_error_free (error);
+        }
+
+      cogl_object_unref (ctx->journal_ring);
+      ctx->journal_ring = NULL;
+      /* Don't keep trying every flush */
+      ctx->journal_ring_failed = TRUE;
+      return FALSE;
+    }
+
+  ctx->journal_ring_segment = 0;
+  ctx->journal_ring_offset = 0;
+
+  return TRUE;
+}
+
+/* Reserves @n_bytes in the context's persistently mapped streaming
+ * buffer. This never waits for the GPU: if the next segment is still
+ * in use we return NULL and the caller falls back to the pool. */
+static CoglAttributeBuffer *
+reserve_ring_space (CoglContext *ctx,
+                    size_t n_bytes,
+                    size_t *offset_out,
+                    float **data_out)
+{
+#ifdef GL_ARB_sync
+  size_t offset;
+
+  if (n_bytes > COGL_JOURNAL_RING_SEGMENT_SIZE || !ensure_ring (ctx))
+    return NULL;
+
+  /* Keep each upload 16 byte aligned */
+  offset = (ctx->journal_ring_offset + 15) & ~(size_t) 15;
+
+  if (offset + n_bytes > COGL_JOURNAL_RING_SEGMENT_SIZE)
+    {
+      int next = ((ctx->journal_ring_segment + 1) %
+                  COGL_JOURNAL_RING_N_SEGMENTS);
+
+      if (ctx->journal_ring_fences[next])
+        {
+          GLenum status =
+            ctx->glClientWaitSync (ctx->journal_ring_fences[next],
+                                   GL_SYNC_FLUSH_COMMANDS_BIT,
+                                   0 /* timeout */);
+
+          if (status != GL_ALREADY_SIGNALED &&
+              status != GL_CONDITION_SATISFIED)
+            return NULL;
+
+          ctx->glDeleteSync (ctx->journal_ring_fences[next]);
+          ctx->journal_ring_fences[next] = NULL;
+        }
+
+      /* All the draws reading the segment we are leaving have been
+         submitted so this fence covers them */
+      ctx->journal_ring_fences[ctx->journal_ring_segment] =
+        ctx->glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+      ctx->journal_ring_segment = next;
+      offset = 0;
+    }
+
+  ctx->journal_ring_offset = offset + n_bytes;
+
+  *offset_out = (ctx->journal_ring_segment * COGL_JOURNAL_RING_SEGMENT_SIZE +
+                 offset);
+  *data_out = (float *) (ctx->journal_ring_data + *offset_out);
+
+  return cogl_object_ref (ctx->journal_ring);
+#else
+  return NULL;
+#endif
+}
+
+void
+_cogl_journal_free_ring (CoglContext *ctx)
+{
+#ifdef GL_ARB_sync
+  int i;
+
+  for (i = 0; i < COGL_JOURNAL_RING_N_SEGMENTS; i++)
+    if (ctx->journal_ring_fences[i])
+      ctx->glDeleteSync (ctx->journal_ring_fences[i]);
+#endif
+
+  /* Deleting the buffer also unmaps it */
+  if (ctx->journal_ring)
+    cogl_object_unref (ctx->journal_ring);
+}
+
 static CoglAttributeBuffer *
 upload_vertices (CoglJournal *journal,
                  const CoglJournalEntry *entries,
                  int n_entries,
                  size_t needed_vbo_len,
-                 GArray *vertices)
+                 GArray *vertices,
+                 size_t *offset_out)
 {
-  CoglAttributeBuffer *attribute_buffer;
-  CoglBuffer *buffer;
+  CoglContext *ctx = journal->framebuffer->context;
+  CoglAttributeBuffer *attribute_buffer = NULL;
+  CoglBuffer *buffer = NULL;
   const float *vin;
   float *vout;
   int entry_num;
   int i;
   CoglMatrixEntry *last_modelview_entry = NULL;
   CoglMatrix modelview;
+  CoglJournalTransformFunc transform = NULL;
+  int transformed_end = 0;
 
   g_assert (needed_vbo_len);
 
-  attribute_buffer = create_attribute_buffer (journal, needed_vbo_len * 4);
-  buffer = COGL_BUFFER (attribute_buffer);
-  cogl_buffer_set_update_hint (buffer, COGL_BUFFER_UPDATE_HINT_DYNAMIC);
+  /* Writing straight into the streaming buffer needs no map or unmap.
+     The journal debug output maps the buffer to read it back which
+     can't be done with a persistent one */
+  if (_cogl_has_private_feature (ctx, COGL_PRIVATE_FEATURE_PERSISTENT_BUFFERS) &&
+      G_LIKELY (!COGL_DEBUG_ENABLED (COGL_DEBUG_JOURNAL)))
+    attribute_buffer = reserve_ring_space (ctx, needed_vbo_len * 4,
+                                           offset_out, &vout);
+
+  if (attribute_buffer == NULL)
+    {
+      attribute_buffer = create_attribute_buffer (journal,
+                                                  needed_vbo_len * 4);
+      buffer = COGL_BUFFER (attribute_buffer);
+      cogl_buffer_set_update_hint (buffer, COGL_BUFFER_UPDATE_HINT_DYNAMIC);
+
+      vout = _cogl_buffer_map_range_for_fill_or_fallback (buffer,
+                                                          0, /* offset */
+                                                          needed_vbo_len * 4);
+      *offset_out = 0;
+    }
 
-  vout = _cogl_buffer_map_range_for_fill_or_fallback (buffer,
-                                                      0, /* offset */
-                                                      needed_vbo_len * 4);
   vin = &g_array_index (vertices, float, 0);
 
+  if (SW_TRANSFORM)
+    transform = _cogl_journal_transform_get_func ();
+
   /* Expand the number of vertices from 2 to 4 while uploading */
   for (entry_num = 0; entry_num < n_entries; entry_num++)
     {
@@ -1117,12 +1301,42 @@ upload_vertices (CoglJournal *journal,
       size_t array_stride =
         GET_JOURNAL_ARRAY_STRIDE_FOR_N_LAYERS (entry->n_layers);
 
+      /* Transform the positions of the whole run of entries sharing
+       * this entry's modelview and layout in one go. This has to
+       * happen before the colors are copied because the vectorised
+       * transforms write over them. */
+      if (transform && entry_num >= transformed_end)
+        {
+          int run_end = entry_num + 1;
+
+          while (run_end < n_entries &&
+                 entries[run_end].modelview_entry == entry->modelview_entry &&
+                 entries[run_end].n_layers == entry->n_layers)
+            run_end++;
+
+          if (entry->modelview_entry != last_modelview_entry)
+            {
+              cogl_matrix_entry_get (entry->modelview_entry, &modelview);
+              last_modelview_entry = entry->modelview_entry;
+            }
+
+          transform (&modelview,
+                     vin + 1, /* skip the color */
+                     array_stride, /* corner_stride */
+                     array_stride * 2 + 1, /* quad_stride */
+                     vout,
+                     vb_stride,
+                     run_end - entry_num);
+
+          transformed_end = run_end;
+        }
+
       /* Copy the color to all four of the vertices */
       for (i = 0; i < 4; i++)
         memcpy (vout + vb_stride * i + POS_STRIDE, vin, 4);
       vin++;
 
-      if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_DISABLE_SOFTWARE_TRANSFORM)))
+      if (!transform)
         {
           vout[vb_stride * 0] = vin[0];
           vout[vb_stride * 0 + 1] = vin[1];
@@ -1133,30 +1347,6 @@ upload_vertices (CoglJournal *journal,
           vout[vb_stride * 3] = vin[array_stride];
           vout[vb_stride * 3 + 1] = vin[1];
         }
-      else
-        {
-          float v[8];
-
-          v[0] = vin[0];
-          v[1] = vin[1];
-          v[2] = vin[0];
-          v[3] = vin[array_stride + 1];
-          v[4] = vin[array_stride];
-          v[5] = vin[array_stride + 1];
-          v[6] = vin[array_stride];
-          v[7] = vin[1];
-
-          if (entry->modelview_entry != last_modelview_entry)
-            cogl_matrix_entry_get (entry->modelview_entry, &modelview);
-          cogl_matrix_transform_points (&modelview,
-                                        2, /* n_components */
-                                        sizeof (float) * 2, /* stride_in */
-                                        v, /* points_in */
-                                        /* strideout */
-                                        vb_stride * sizeof (float),
-                                        vout, /* points_out */
-                                        4 /* n_points */);
-        }
 
       for (i = 0; i < entry->n_layers; i++)
         {
@@ -1177,7 +1367,8 @@ upload_vertices (CoglJournal *journal,
       vout += vb_stride * 4;
     }
 
-  _cogl_buffer_unmap_for_fill_or_fallback (buffer);
+  if (buffer)
+    _cogl_buffer_unmap_for_fill_or_fallback (buffer);
 
   return attribute_buffer;
 }
@@ -1293,6 +1484,219 @@ post_fences (CoglJournal *journal)
  * to pipelines, all glEnable flags and current matrix state
  * is undefined.
  */
+/* The window space bounding box of an entry, grown by a pixel so that
+ * rounding can't make neighbouring quads look disjoint when they
+ * touch a common pixel. Entries whose footprint we can't work out are
+ * marked invalid and nothing may be moved past them. */
+typedef struct
+{
+  float x0, y0, x1, y1;
+  CoglBool valid;
+} JournalEntryBounds;
+
+/* How far back an entry may be moved to join an earlier batch. This
+ * keeps the reorder pass linear for long journals. */
+#define JOURNAL_REORDER_WINDOW 64
+
+static void
+get_entry_bounds (const CoglJournalEntry *entry,
+                  const float *vertices,
+                  const CoglMatrix *mvp,
+                  const float *viewport,
+                  JournalEntryBounds *bounds)
+{
+  size_t array_stride =
+    GET_JOURNAL_ARRAY_STRIDE_FOR_N_LAYERS (entry->n_layers);
+  float xs[2] = { vertices[0], vertices[array_stride] };
+  float ys[2] = { vertices[1], vertices[array_stride + 1] };
+  int i;
+
+  /* Vertex snippets can move the vertices anywhere */
+  if (_cogl_pipeline_has_non_layer_vertex_snippets (entry->pipeline))
+    {
+      bounds->valid = FALSE;
+      return;
+    }
+
+  for (i = 0; i < 4; i++)
+    {
+      float x = xs[i >> 1], y = ys[i & 1];
+      float w = mvp->wx * x + mvp->wy * y + mvp->ww;
+      float wx, wy;
+
+      /* Clipped by the near plane; the projected box means nothing */
+      if (w <= 0.0f)
+        {
+          bounds->valid = FALSE;
+          return;
+        }
+
+      /* The viewport transform without the origin or the y flip,
+         neither changes whether two boxes overlap */
+      wx = (mvp->xx * x + mvp->xy * y + mvp->xw) / w * viewport[2] / 2.0f;
+      wy = (mvp->yx * x + mvp->yy * y + mvp->yw) / w * viewport[3] / 2.0f;
+
+      if (i == 0)
+        {
+          bounds->x0 = bounds->x1 = wx;
+          bounds->y0 = bounds->y1 = wy;
+        }
+      else
+        {
+          bounds->x0 = MIN (bounds->x0, wx);
+          bounds->x1 = MAX (bounds->x1, wx);
+          bounds->y0 = MIN (bounds->y0, wy);
+          bounds->y1 = MAX (bounds->y1, wy);
+        }
+    }
+
+  bounds->x0 -= 1.0f;
+  bounds->y0 -= 1.0f;
+  bounds->x1 += 1.0f;
+  bounds->y1 += 1.0f;
+  bounds->valid = TRUE;
+}
+
+static CoglBool
+bounds_overlap (const JournalEntryBounds *a,
+                const JournalEntryBounds *b)
+{
+  return (a->x0 < b->x1 && b->x0 < a->x1 &&
+          a->y0 < b->y1 && b->y0 < a->y1);
+}
+
+static CoglBool
+compare_entry_batches (CoglJournalEntry *entry0,
+                       CoglJournalEntry *entry1)
+{
+  /* Without software transforms the batches are also split by
+     modelview so there is no point grouping entries that differ */
+  if (!SW_TRANSFORM && !compare_entry_modelviews (entry0, entry1))
+    return FALSE;
+
+  return compare_entry_pipelines (entry0, entry1);
+}
+
+/* Quads drawn with alternating pipelines, such as text next to icons,
+ * would each end up in their own batch. Walking the journal in order
+ * we move every entry back to just after the last entry it could be
+ * batched with, provided it doesn't overlap anything it jumps over.
+ * Disjoint quads touch different pixels so drawing them in another
+ * order can't change the result, whatever the pipelines do. */
+static void
+reorder_entries (CoglJournal *journal)
+{
+  CoglFramebuffer *framebuffer = journal->framebuffer;
+  CoglJournalEntry *entries = (CoglJournalEntry *) journal->entries->data;
+  int n_entries = journal->entries->len;
+  const float *vertices = &g_array_index (journal->vertices, float, 0);
+  CoglMatrixEntry *last_modelview_entry = NULL;
+  CoglMatrix projection, modelview, mvp;
+  JournalEntryBounds *bounds;
+  float viewport[4];
+  int *order;
+  int n_ordered = 0;
+  int n_moved = 0;
+  GArray *tmp;
+  int i, k;
+
+  if (n_entries < 3)
+    return;
+
+  cogl_matrix_stack_get (_cogl_framebuffer_get_projection_stack (framebuffer),
+                         &projection);
+  cogl_framebuffer_get_viewport4fv (framebuffer, viewport);
+
+  bounds = g_new (JournalEntryBounds, n_entries);
+  order = g_new (int, n_entries);
+
+  for (i = 0; i < n_entries; i++)
+    {
+      CoglJournalEntry *entry = entries + i;
+      int insert_pos = n_ordered;
+
+      if (entry->modelview_entry != last_modelview_entry)
+        {
+          cogl_matrix_entry_get (entry->modelview_entry, &modelview);
+          cogl_matrix_multiply (&mvp, &projection, &modelview);
+          last_modelview_entry = entry->modelview_entry;
+        }
+
+      get_entry_bounds (entry, vertices + entry->array_offset + 1,
+                        &mvp, viewport, &bounds[i]);
+
+      if (bounds[i].valid)
+        {
+          for (k = n_ordered - 1;
+               k >= 0 && k >= n_ordered - JOURNAL_REORDER_WINDOW;
+               k--)
+            {
+              CoglJournalEntry *other = entries + order[k];
+
+              /* Batches never span clip stacks */
+              if (other->clip_stack != entry->clip_stack)
+                break;
+
+              if (compare_entry_batches (other, entry))
+                {
+                  insert_pos = k + 1;
+                  break;
+                }
+
+              if (!bounds[order[k]].valid ||
+                  bounds_overlap (&bounds[order[k]], &bounds[i]))
+                break;
+            }
+        }
+
+      if (insert_pos < n_ordered)
+        {
+          memmove (order + insert_pos + 1,
+                   order + insert_pos,
+                   (n_ordered - insert_pos) * sizeof (int));
+          n_moved++;
+        }
+
+      order[insert_pos] = i;
+      n_ordered++;
+    }
+
+  if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_BATCHING)))
+    g_print ("BATCHING: reordered %d of %d entries\n", n_moved, n_entries);
+
+  if (n_moved > 0)
+    {
+      /* Rebuild both arrays in the new order. The upload walks the
+         vertices in step with the entries so they have to match */
+      g_array_set_size (journal->reorder_entries, 0);
+      g_array_set_size (journal->reorder_vertices, 0);
+
+      for (i = 0; i < n_entries; i++)
+        {
+          CoglJournalEntry entry = entries[order[i]];
+          size_t len =
+            2 * GET_JOURNAL_ARRAY_STRIDE_FOR_N_LAYERS (entry.n_layers) + 1;
+
+          g_array_append_vals (journal->reorder_vertices,
+                               vertices + entry.array_offset, len);
+          entry.array_offset = journal->reorder_vertices->len - len;
+          g_array_append_val (journal->reorder_entries, entry);
+        }
+
+      /* The references held by the entries move with them */
+      tmp = journal->entries;
+      journal->entries = journal->reorder_entries;
+      journal->reorder_entries = tmp;
+
+      tmp = journal->vertices;
+      journal->vertices = journal->reorder_vertices;
+      journal->reorder_vertices = tmp;
+    }
+
+  free (order);
+  free (bounds);
+}
+
 void
 _cogl_journal_flush (CoglJournal *journal)
 {
@@ -1330,6 +1734,11 @@ _cogl_journal_flush (CoglJournal *journal)
    * that the timer isn't started recursively. */
   COGL_TIMER_START (_cogl_uprof_context, flush_timer);
 
+  COGL_TRACE1 (journal_flush_start, journal->entries->len);
+
+  if (G_UNLIKELY (ctx->gpu_timer_flushes))
+    _cogl_gpu_timer_push (ctx, "journal flush");
+
   if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_BATCHING)))
     g_print ("BATCHING: journal len = %d\n", journal->entries->len);
 
@@ -1364,15 +1773,19 @@ _cogl_journal_flush (CoglJournal *journal)
                       &state); /* data */
     }
 
-  /* We upload the vertices after the clip stack pass in case it
-     modifies the entries */
+  if (G_LIKELY (!COGL_DEBUG_ENABLED (COGL_DEBUG_DISABLE_BATCHING) &&
+                !COGL_DEBUG_ENABLED (COGL_DEBUG_DISABLE_BATCH_REORDER)))
+    reorder_entries (journal);
+
+  /* We upload the vertices after the clip stack and reorder passes in
+     case they modify the entries */
   state.attribute_buffer =
     upload_vertices (journal,
                      &g_array_index (journal->entries, CoglJournalEntry, 0),
                      journal->entries->len,
                      journal->needed_vbo_len,
-                     journal->vertices);
-  state.array_offset = 0;
+                     journal->vertices,
+                     &state.array_offset);
 
   /* batch_and_call() batches a list of journal entries according to some
    * given criteria and calls a callback once for each determined batch.
@@ -1409,12 +1822,17 @@ _cogl_journal_flush (CoglJournal *journal)
 
   cogl_object_unref (state.attribute_buffer);
 
+  if (G_UNLIKELY (ctx->gpu_timer_flushes))
+    _cogl_gpu_timer_pop (ctx);
+
   COGL_TIMER_START (_cogl_uprof_context, discard_timer);
   _cogl_journal_discard (journal);
   COGL_TIMER_STOP (_cogl_uprof_context, discard_timer);
 
   post_fences (journal);
 
+  COGL_TRACE (journal_flush_end);
+
   COGL_TIMER_STOP (_cogl_uprof_context, flush_timer);
 }
 
@@ -1726,10 +2144,10 @@ try_checking_point_hits_entry_after_clipping (CoglFramebuffer *framebuffer,
         return FALSE;
 
       if (!can_software_clip_entry (entry, NULL,
-                                    entry->clip_stack, &clip_bounds))
+                                    entry->clip_stack, NULL, &clip_bounds))
         return FALSE;
 
-      software_clip_entry (entry, vertices, &clip_bounds);
+      software_clip_entry (entry, vertices, NULL, &clip_bounds);
       entry_to_screen_polygon (framebuffer, entry, vertices, poly);
 
       *hit = _cogl_util_point_in_screen_poly (x, y, poly, sizeof (float) * 4, 4);
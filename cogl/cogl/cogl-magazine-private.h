@@ -48,14 +48,27 @@ typedef struct _CoglMagazine
 
   CoglMemoryStack *stack;
   CoglMagazineChunk *head;
+
+  /* For COGL_DEBUG=allocations: the number of chunks ever carved out
+   * of the stack and the number currently handed out */
+  const char *name;
+  int n_chunks;
+  int n_live;
 } CoglMagazine;
 
 CoglMagazine *
-_cogl_magazine_new (size_t chunk_size, int initial_chunk_count);
+_cogl_magazine_new (const char *name,
+                    size_t chunk_size,
+                    int initial_chunk_count);
+
+void *
+_cogl_magazine_grow (CoglMagazine *magazine);
 
 static inline void *
 _cogl_magazine_chunk_alloc (CoglMagazine *magazine)
 {
+  magazine->n_live++;
+
   if (G_LIKELY (magazine->head))
     {
       CoglMagazineChunk *chunk = magazine->head;
@@ -63,7 +76,7 @@ _cogl_magazine_chunk_alloc (CoglMagazine *magazine)
       return chunk;
     }
   else
-    return _cogl_memory_stack_alloc (magazine->stack, magazine->chunk_size);
+    return _cogl_magazine_grow (magazine);
 }
 
 static inline void
@@ -71,6 +84,8 @@ _cogl_magazine_chunk_free (CoglMagazine *magazine, void *data)
 {
   CoglMagazineChunk *chunk = data;
 
+  magazine->n_live--;
+
   chunk->next = magazine->head;
   magazine->head = chunk;
 }
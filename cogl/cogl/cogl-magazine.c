@@ -44,7 +44,9 @@
  * re-use.
  *
  * No attempt is ever made to shrink the amount of memory associated
- * with a CoglMagazine.
+ * with a CoglMagazine. Once the working set of a magazine has been
+ * reached it never allocates again, which can be checked with
+ * COGL_DEBUG=allocations.
  *
  *
  * Authors:
@@ -57,12 +59,15 @@
 
 #include "cogl-memory-stack-private.h"
 #include "cogl-magazine-private.h"
+#include "cogl-debug.h"
 #include <glib.h>
 
 #define ROUND_UP_8(X) ((X + (8 - 1)) & ~(8 - 1))
 
 CoglMagazine *
-_cogl_magazine_new (size_t chunk_size, int initial_chunk_count)
+_cogl_magazine_new (const char *name,
+                    size_t chunk_size,
+                    int initial_chunk_count)
 {
   CoglMagazine *magazine = g_new0 (CoglMagazine, 1);
 
@@ -72,10 +77,28 @@ _cogl_magazine_new (size_t chunk_size, int initial_chunk_count)
   magazine->chunk_size = chunk_size;
   magazine->stack = _cogl_memory_stack_new (chunk_size * initial_chunk_count);
   magazine->head = NULL;
+  magazine->name = name;
 
   return magazine;
 }
 
+/* Slow path of _cogl_magazine_chunk_alloc() for when no freed chunk
+ * is available */
+void *
+_cogl_magazine_grow (CoglMagazine *magazine)
+{
+  magazine->n_chunks++;
+
+  COGL_NOTE (ALLOCATIONS,
+             "%s magazine grew to %i chunks of %i bytes (%i in use)",
+             magazine->name,
+             magazine->n_chunks,
+             (int) magazine->chunk_size,
+             magazine->n_live);
+
+  return _cogl_memory_stack_alloc (magazine->stack, magazine->chunk_size);
+}
+
 void
 _cogl_magazine_free (CoglMagazine *magazine)
 {
@@ -0,0 +1,75 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __COGL_MATRIX_KERNELS_PRIVATE_H
+#define __COGL_MATRIX_KERNELS_PRIVATE_H
+
+#include <stddef.h>
+
+#include "cogl-matrix.h"
+
+/*
+ * The arithmetic behind the CoglMatrix API. The matrices are arrays
+ * of 16 floats in column major order.
+ */
+typedef struct
+{
+  const char *name;
+
+  /* @result = @a * @b. @result may be @a but not @b. */
+  void (* multiply4x4) (float *result,
+                        const float *a,
+                        const float *b);
+  /* The same for matrices whose bottom row is (0, 0, 0, 1) */
+  void (* multiply3x4) (float *result,
+                        const float *a,
+                        const float *b);
+
+  /* Transforms @n_points points of @n_components floats, which can be
+   * 2, 3 or 4, with a missing z taken as 0 and a missing w as 1. The
+   * first @n_out_components of the result, which can be 3 or 4, are
+   * written to @points_out. */
+  void (* transform_points) (const CoglMatrix *matrix,
+                             int n_components,
+                             size_t stride_in,
+                             const void *points_in,
+                             int n_out_components,
+                             size_t stride_out,
+                             void *points_out,
+                             int n_points);
+} CoglMatrixKernels;
+
+/* Returns the implementations this CPU can run, the plain C one first
+ * and the preferred one last. */
+const CoglMatrixKernels *
+_cogl_matrix_kernels_get_impls (int *n_impls);
+
+/* The implementation the matrix code uses. It can be forced by setting
+ * COGL_MATRIX_KERNELS to the name of one of the above. */
+const CoglMatrixKernels *
+_cogl_matrix_kernels_get (void);
+
+#endif /* __COGL_MATRIX_KERNELS_PRIVATE_H */
@@ -0,0 +1,707 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "cogl-config.h"
+#endif
+
+#include <string.h>
+#include <math.h>
+
+#include <glib.h>
+
+#include <test-fixtures/test-unit.h>
+
+#include "cogl-matrix-kernels-private.h"
+
+/* In column major order column j of a product is the sum of the
+ * columns of @a scaled by the elements of column j of @b, so the SIMD
+ * versions keep the columns of @a in registers and broadcast the
+ * elements of @b. The sums are done in the same order as the C
+ * version so the results only differ if the compiler contracts the
+ * C version into fused multiply-adds. */
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+  (defined(__x86_64__) || defined(__i386__))
+#define COGL_MATRIX_KERNELS_SSE2
+#include <xmmintrin.h>
+
+/* AVX2 isn't part of any baseline so it is compiled with a target
+   attribute and only picked after checking the CPU */
+#if defined(__clang__) || \
+  (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define COGL_MATRIX_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define COGL_MATRIX_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#define A(row,col)  a[(col<<2)+row]
+#define B(row,col)  b[(col<<2)+row]
+#define R(row,col)  result[(col<<2)+row]
+
+static void
+multiply4x4_c (float *result, const float *a, const float *b)
+{
+  int i;
+  for (i = 0; i < 4; i++)
+    {
+      const float ai0 = A(i,0),  ai1=A(i,1),  ai2=A(i,2),  ai3=A(i,3);
+      R(i,0) = ai0 * B(0,0) + ai1 * B(1,0) + ai2 * B(2,0) + ai3 * B(3,0);
+      R(i,1) = ai0 * B(0,1) + ai1 * B(1,1) + ai2 * B(2,1) + ai3 * B(3,1);
+      R(i,2) = ai0 * B(0,2) + ai1 * B(1,2) + ai2 * B(2,2) + ai3 * B(3,2);
+      R(i,3) = ai0 * B(0,3) + ai1 * B(1,3) + ai2 * B(2,3) + ai3 * B(3,3);
+    }
+}
+
+static void
+multiply3x4_c (float *result, const float *a, const float *b)
+{
+  int i;
+  for (i = 0; i < 3; i++)
+    {
+      const float ai0 = A(i,0), ai1 = A(i,1), ai2 = A(i,2), ai3 = A(i,3);
+      R(i,0) = ai0 * B(0,0) + ai1 * B(1,0) + ai2 * B(2,0);
+      R(i,1) = ai0 * B(0,1) + ai1 * B(1,1) + ai2 * B(2,1);
+      R(i,2) = ai0 * B(0,2) + ai1 * B(1,2) + ai2 * B(2,2);
+      R(i,3) = ai0 * B(0,3) + ai1 * B(1,3) + ai2 * B(2,3) + ai3;
+    }
+  R(3,0) = 0;
+  R(3,1) = 0;
+  R(3,2) = 0;
+  R(3,3) = 1;
+}
+
+#undef A
+#undef B
+#undef R
+
+/* Always inlined with constant component counts so each combination
+   gets its own loop */
+static inline void
+transform_points_c_generic (const CoglMatrix *matrix,
+                            const int n_components,
+                            size_t stride_in,
+                            const void *points_in,
+                            const int n_out_components,
+                            size_t stride_out,
+                            void *points_out,
+                            int n_points)
+{
+  int i;
+
+  for (i = 0; i < n_points; i++)
+    {
+      const float *p = (const float *) ((const uint8_t *) points_in +
+                                        i * stride_in);
+      float *o = (float *) ((uint8_t *) points_out + i * stride_out);
+      float x = p[0], y = p[1];
+      float z = n_components >= 3 ? p[2] : 0.0f;
+      float w = n_components >= 4 ? p[3] : 1.0f;
+
+      o[0] = matrix->xx * x + matrix->xy * y + matrix->xz * z + matrix->xw * w;
+      o[1] = matrix->yx * x + matrix->yy * y + matrix->yz * z + matrix->yw * w;
+      o[2] = matrix->zx * x + matrix->zy * y + matrix->zz * z + matrix->zw * w;
+      if (n_out_components == 4)
+        o[3] = (matrix->wx * x + matrix->wy * y +
+                matrix->wz * z + matrix->ww * w);
+    }
+}
+
+/* Calls @func with constant component counts for the combinations
+   the matrix API uses */
+#define DISPATCH_TRANSFORM_POINTS(func)                                 \
+  switch (n_components * 10 + n_out_components)                         \
+    {                                                                   \
+    case 23:                                                            \
+      func (matrix, 2, stride_in, points_in, 3, stride_out, points_out, \
+            n_points);                                                  \
+      break;                                                            \
+    case 24:                                                            \
+      func (matrix, 2, stride_in, points_in, 4, stride_out, points_out, \
+            n_points);                                                  \
+      break;                                                            \
+    case 33:                                                            \
+      func (matrix, 3, stride_in, points_in, 3, stride_out, points_out, \
+            n_points);                                                  \
+      break;                                                            \
+    case 34:                                                            \
+      func (matrix, 3, stride_in, points_in, 4, stride_out, points_out, \
+            n_points);                                                  \
+      break;                                                            \
+    case 43:                                                            \
+      func (matrix, 4, stride_in, points_in, 3, stride_out, points_out, \
+            n_points);                                                  \
+      break;                                                            \
+    default:                                                            \
+      func (matrix, 4, stride_in, points_in, 4, stride_out, points_out, \
+            n_points);                                                  \
+      break;                                                            \
+    }
+
+static void
+transform_points_c (const CoglMatrix *matrix,
+                    int n_components,
+                    size_t stride_in,
+                    const void *points_in,
+                    int n_out_components,
+                    size_t stride_out,
+                    void *points_out,
+                    int n_points)
+{
+  DISPATCH_TRANSFORM_POINTS (transform_points_c_generic);
+}
+
+#ifdef COGL_MATRIX_KERNELS_SSE2
+
+static void
+multiply4x4_sse2 (float *result, const float *a, const float *b)
+{
+  /* All of @a is loaded before anything is stored because @result may
+     be @a */
+  __m128 a0 = _mm_loadu_ps (a + 0);
+  __m128 a1 = _mm_loadu_ps (a + 4);
+  __m128 a2 = _mm_loadu_ps (a + 8);
+  __m128 a3 = _mm_loadu_ps (a + 12);
+  int j;
+
+  for (j = 0; j < 4; j++)
+    {
+      const float *bj = b + j * 4;
+      __m128 r;
+
+      r = _mm_mul_ps (a0, _mm_set1_ps (bj[0]));
+      r = _mm_add_ps (r, _mm_mul_ps (a1, _mm_set1_ps (bj[1])));
+      r = _mm_add_ps (r, _mm_mul_ps (a2, _mm_set1_ps (bj[2])));
+      r = _mm_add_ps (r, _mm_mul_ps (a3, _mm_set1_ps (bj[3])));
+
+      _mm_storeu_ps (result + j * 4, r);
+    }
+}
+
+static void
+multiply3x4_sse2 (float *result, const float *a, const float *b)
+{
+  static const union { uint32_t u[4]; __m128 v; } xyz_mask =
+    { { 0xffffffff, 0xffffffff, 0xffffffff, 0 } };
+  __m128 a0 = _mm_loadu_ps (a + 0);
+  __m128 a1 = _mm_loadu_ps (a + 4);
+  __m128 a2 = _mm_loadu_ps (a + 8);
+  __m128 a3 = _mm_loadu_ps (a + 12);
+  __m128 r[4];
+  int j;
+
+  for (j = 0; j < 4; j++)
+    {
+      const float *bj = b + j * 4;
+
+      r[j] = _mm_mul_ps (a0, _mm_set1_ps (bj[0]));
+      r[j] = _mm_add_ps (r[j], _mm_mul_ps (a1, _mm_set1_ps (bj[1])));
+      r[j] = _mm_add_ps (r[j], _mm_mul_ps (a2, _mm_set1_ps (bj[2])));
+    }
+
+  /* The bottom row is forced to (0, 0, 0, 1) */
+  r[3] = _mm_add_ps (r[3], a3);
+
+  for (j = 0; j < 3; j++)
+    _mm_storeu_ps (result + j * 4, _mm_and_ps (r[j], xyz_mask.v));
+  _mm_storeu_ps (result + 12,
+                 _mm_or_ps (_mm_and_ps (r[3], xyz_mask.v),
+                            _mm_setr_ps (0.0f, 0.0f, 0.0f, 1.0f)));
+}
+
+static inline void
+store_point_sse2 (float *o, __m128 v, const int n_out_components)
+{
+  if (n_out_components == 4)
+    _mm_storeu_ps (o, v);
+  else
+    {
+      /* Only three floats may be written */
+      _mm_storel_pi ((__m64 *) o, v);
+      _mm_store_ss (o + 2, _mm_movehl_ps (v, v));
+    }
+}
+
+static inline void
+transform_points_sse2_generic (const CoglMatrix *matrix,
+                               const int n_components,
+                               size_t stride_in,
+                               const void *points_in,
+                               const int n_out_components,
+                               size_t stride_out,
+                               void *points_out,
+                               int n_points)
+{
+  __m128 c0 = _mm_loadu_ps (&matrix->xx);
+  __m128 c1 = _mm_loadu_ps (&matrix->xy);
+  __m128 c2 = _mm_loadu_ps (&matrix->xz);
+  __m128 c3 = _mm_loadu_ps (&matrix->xw);
+  int i;
+
+  for (i = 0; i < n_points; i++)
+    {
+      const float *p = (const float *) ((const uint8_t *) points_in +
+                                        i * stride_in);
+      float *o = (float *) ((uint8_t *) points_out + i * stride_out);
+      __m128 v;
+
+      v = _mm_mul_ps (c0, _mm_set1_ps (p[0]));
+      v = _mm_add_ps (v, _mm_mul_ps (c1, _mm_set1_ps (p[1])));
+      if (n_components >= 3)
+        v = _mm_add_ps (v, _mm_mul_ps (c2, _mm_set1_ps (p[2])));
+      if (n_components >= 4)
+        v = _mm_add_ps (v, _mm_mul_ps (c3, _mm_set1_ps (p[3])));
+      else
+        v = _mm_add_ps (v, c3);
+
+      store_point_sse2 (o, v, n_out_components);
+    }
+}
+
+static void
+transform_points_sse2 (const CoglMatrix *matrix,
+                       int n_components,
+                       size_t stride_in,
+                       const void *points_in,
+                       int n_out_components,
+                       size_t stride_out,
+                       void *points_out,
+                       int n_points)
+{
+  DISPATCH_TRANSFORM_POINTS (transform_points_sse2_generic);
+}
+
+#endif /* COGL_MATRIX_KERNELS_SSE2 */
+
+#ifdef COGL_MATRIX_KERNELS_AVX2
+
+/* The AVX2 versions handle two columns or two points at a time, one
+   in each half of the registers */
+
+__attribute__ ((target ("avx2")))
+static inline __m256
+pair_avx2 (float lo, float hi)
+{
+  return _mm256_insertf128_ps (_mm256_set1_ps (lo), _mm_set1_ps (hi), 1);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+multiply4x4_avx2 (float *result, const float *a, const float *b)
+{
+  __m256 a0 = _mm256_broadcast_ps ((const __m128 *) (a + 0));
+  __m256 a1 = _mm256_broadcast_ps ((const __m128 *) (a + 4));
+  __m256 a2 = _mm256_broadcast_ps ((const __m128 *) (a + 8));
+  __m256 a3 = _mm256_broadcast_ps ((const __m128 *) (a + 12));
+  int j;
+
+  for (j = 0; j < 4; j += 2)
+    {
+      const float *bj = b + j * 4;
+      __m256 r;
+
+      r = _mm256_mul_ps (a0, pair_avx2 (bj[0], bj[4]));
+      r = _mm256_add_ps (r, _mm256_mul_ps (a1, pair_avx2 (bj[1], bj[5])));
+      r = _mm256_add_ps (r, _mm256_mul_ps (a2, pair_avx2 (bj[2], bj[6])));
+      r = _mm256_add_ps (r, _mm256_mul_ps (a3, pair_avx2 (bj[3], bj[7])));
+
+      _mm256_storeu_ps (result + j * 4, r);
+    }
+}
+
+__attribute__ ((target ("avx2")))
+static void
+multiply3x4_avx2 (float *result, const float *a, const float *b)
+{
+  __m256 a0 = _mm256_broadcast_ps ((const __m128 *) (a + 0));
+  __m256 a1 = _mm256_broadcast_ps ((const __m128 *) (a + 4));
+  __m256 a2 = _mm256_broadcast_ps ((const __m128 *) (a + 8));
+  /* Only added to the last column */
+  __m256 a3 = _mm256_insertf128_ps (_mm256_setzero_ps (),
+                                    _mm_loadu_ps (a + 12), 1);
+  /* Keeps x, y and z of each column and sets the bottom row to
+     (0, 0, 0, 1) */
+  __m256 mask = _mm256_castsi256_ps (_mm256_setr_epi32 (-1, -1, -1, 0,
+                                                        -1, -1, -1, 0));
+  __m256 w = _mm256_setr_ps (0.0f, 0.0f, 0.0f, 0.0f,
+                             0.0f, 0.0f, 0.0f, 1.0f);
+  __m256 r[2];
+  int j;
+
+  for (j = 0; j < 2; j++)
+    {
+      const float *bj = b + j * 8;
+
+      r[j] = _mm256_mul_ps (a0, pair_avx2 (bj[0], bj[4]));
+      r[j] = _mm256_add_ps (r[j], _mm256_mul_ps (a1, pair_avx2 (bj[1], bj[5])));
+      r[j] = _mm256_add_ps (r[j], _mm256_mul_ps (a2, pair_avx2 (bj[2], bj[6])));
+    }
+
+  r[1] = _mm256_add_ps (r[1], a3);
+
+  _mm256_storeu_ps (result, _mm256_and_ps (r[0], mask));
+  _mm256_storeu_ps (result + 8,
+                    _mm256_or_ps (_mm256_and_ps (r[1], mask), w));
+}
+
+__attribute__ ((target ("avx2")))
+static inline void
+transform_points_avx2_generic (const CoglMatrix *matrix,
+                               const int n_components,
+                               size_t stride_in,
+                               const void *points_in,
+                               const int n_out_components,
+                               size_t stride_out,
+                               void *points_out,
+                               int n_points)
+{
+  __m256 c0 = _mm256_broadcast_ps ((const __m128 *) &matrix->xx);
+  __m256 c1 = _mm256_broadcast_ps ((const __m128 *) &matrix->xy);
+  __m256 c2 = _mm256_broadcast_ps ((const __m128 *) &matrix->xz);
+  __m256 c3 = _mm256_broadcast_ps ((const __m128 *) &matrix->xw);
+  const uint8_t *in = points_in;
+  uint8_t *out = points_out;
+  int i;
+
+  for (i = 0; i + 1 < n_points; i += 2)
+    {
+      const float *p = (const float *) in;
+      const float *q = (const float *) (in + stride_in);
+      __m256 v;
+
+      v = _mm256_mul_ps (c0, pair_avx2 (p[0], q[0]));
+      v = _mm256_add_ps (v, _mm256_mul_ps (c1, pair_avx2 (p[1], q[1])));
+      if (n_components >= 3)
+        v = _mm256_add_ps (v, _mm256_mul_ps (c2, pair_avx2 (p[2], q[2])));
+      if (n_components >= 4)
+        v = _mm256_add_ps (v, _mm256_mul_ps (c3, pair_avx2 (p[3], q[3])));
+      else
+        v = _mm256_add_ps (v, c3);
+
+      store_point_sse2 ((float *) out, _mm256_castps256_ps128 (v),
+                        n_out_components);
+      store_point_sse2 ((float *) (out + stride_out),
+                        _mm256_extractf128_ps (v, 1),
+                        n_out_components);
+
+      in += stride_in * 2;
+      out += stride_out * 2;
+    }
+
+  if (i < n_points)
+    transform_points_sse2_generic (matrix,
+                                   n_components, stride_in, in,
+                                   n_out_components, stride_out, out,
+                                   1);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+transform_points_avx2 (const CoglMatrix *matrix,
+                       int n_components,
+                       size_t stride_in,
+                       const void *points_in,
+                       int n_out_components,
+                       size_t stride_out,
+                       void *points_out,
+                       int n_points)
+{
+  DISPATCH_TRANSFORM_POINTS (transform_points_avx2_generic);
+}
+
+#endif /* COGL_MATRIX_KERNELS_AVX2 */
+
+#ifdef COGL_MATRIX_KERNELS_NEON
+
+static void
+multiply4x4_neon (float *result, const float *a, const float *b)
+{
+  float32x4_t a0 = vld1q_f32 (a + 0);
+  float32x4_t a1 = vld1q_f32 (a + 4);
+  float32x4_t a2 = vld1q_f32 (a + 8);
+  float32x4_t a3 = vld1q_f32 (a + 12);
+  int j;
+
+  for (j = 0; j < 4; j++)
+    {
+      const float *bj = b + j * 4;
+      float32x4_t r;
+
+      r = vmulq_n_f32 (a0, bj[0]);
+      r = vaddq_f32 (r, vmulq_n_f32 (a1, bj[1]));
+      r = vaddq_f32 (r, vmulq_n_f32 (a2, bj[2]));
+      r = vaddq_f32 (r, vmulq_n_f32 (a3, bj[3]));
+
+      vst1q_f32 (result + j * 4, r);
+    }
+}
+
+static void
+multiply3x4_neon (float *result, const float *a, const float *b)
+{
+  float32x4_t a0 = vld1q_f32 (a + 0);
+  float32x4_t a1 = vld1q_f32 (a + 4);
+  float32x4_t a2 = vld1q_f32 (a + 8);
+  float32x4_t a3 = vld1q_f32 (a + 12);
+  float32x4_t r[4];
+  int j;
+
+  for (j = 0; j < 4; j++)
+    {
+      const float *bj = b + j * 4;
+
+      r[j] = vmulq_n_f32 (a0, bj[0]);
+      r[j] = vaddq_f32 (r[j], vmulq_n_f32 (a1, bj[1]));
+      r[j] = vaddq_f32 (r[j], vmulq_n_f32 (a2, bj[2]));
+    }
+
+  r[3] = vaddq_f32 (r[3], a3);
+
+  /* The bottom row is forced to (0, 0, 0, 1) */
+  for (j = 0; j < 4; j++)
+    vst1q_f32 (result + j * 4, vsetq_lane_f32 (j == 3 ? 1.0f : 0.0f,
+                                               r[j], 3));
+}
+
+static inline void
+transform_points_neon_generic (const CoglMatrix *matrix,
+                               const int n_components,
+                               size_t stride_in,
+                               const void *points_in,
+                               const int n_out_components,
+                               size_t stride_out,
+                               void *points_out,
+                               int n_points)
+{
+  float32x4_t c0 = vld1q_f32 (&matrix->xx);
+  float32x4_t c1 = vld1q_f32 (&matrix->xy);
+  float32x4_t c2 = vld1q_f32 (&matrix->xz);
+  float32x4_t c3 = vld1q_f32 (&matrix->xw);
+  int i;
+
+  for (i = 0; i < n_points; i++)
+    {
+      const float *p = (const float *) ((const uint8_t *) points_in +
+                                        i * stride_in);
+      float *o = (float *) ((uint8_t *) points_out + i * stride_out);
+      float32x4_t v;
+
+      v = vmulq_n_f32 (c0, p[0]);
+      v = vaddq_f32 (v, vmulq_n_f32 (c1, p[1]));
+      if (n_components >= 3)
+        v = vaddq_f32 (v, vmulq_n_f32 (c2, p[2]));
+      if (n_components >= 4)
+        v = vaddq_f32 (v, vmulq_n_f32 (c3, p[3]));
+      else
+        v = vaddq_f32 (v, c3);
+
+      if (n_out_components == 4)
+        vst1q_f32 (o, v);
+      else
+        {
+          vst1_f32 (o, vget_low_f32 (v));
+          vst1q_lane_f32 (o + 2, v, 2);
+        }
+    }
+}
+
+static void
+transform_points_neon (const CoglMatrix *matrix,
+                       int n_components,
+                       size_t stride_in,
+                       const void *points_in,
+                       int n_out_components,
+                       size_t stride_out,
+                       void *points_out,
+                       int n_points)
+{
+  DISPATCH_TRANSFORM_POINTS (transform_points_neon_generic);
+}
+
+#endif /* COGL_MATRIX_KERNELS_NEON */
+
+static const CoglMatrixKernels all_impls[] =
+  {
+    { "c", multiply4x4_c, multiply3x4_c, transform_points_c },
+#ifdef COGL_MATRIX_KERNELS_NEON
+    { "neon", multiply4x4_neon, multiply3x4_neon, transform_points_neon },
+#endif
+#ifdef COGL_MATRIX_KERNELS_SSE2
+    { "sse2", multiply4x4_sse2, multiply3x4_sse2, transform_points_sse2 },
+#endif
+#ifdef COGL_MATRIX_KERNELS_AVX2
+    { "avx2", multiply4x4_avx2, multiply3x4_avx2, transform_points_avx2 },
+#endif
+  };
+
+const CoglMatrixKernels *
+_cogl_matrix_kernels_get_impls (int *n_impls)
+{
+  int n = G_N_ELEMENTS (all_impls);
+
+#ifdef COGL_MATRIX_KERNELS_AVX2
+  /* AVX2 is always last so it can simply be left out */
+  __builtin_cpu_init ();
+  if (!__builtin_cpu_supports ("avx2"))
+    n--;
+#endif
+
+  *n_impls = n;
+
+  return all_impls;
+}
+
+const CoglMatrixKernels *
+_cogl_matrix_kernels_get (void)
+{
+  static const CoglMatrixKernels *kernels = NULL;
+
+  if (G_UNLIKELY (kernels == NULL))
+    {
+      const CoglMatrixKernels *impls;
+      const char *name = g_getenv ("COGL_MATRIX_KERNELS");
+      int n_impls, i;
+
+      impls = _cogl_matrix_kernels_get_impls (&n_impls);
+      kernels = &impls[n_impls - 1];
+
+      if (name)
+        {
+          for (i = 0; i < n_impls; i++)
+            if (!strcmp (impls[i].name, name))
+              break;
+
+          if (i < n_impls)
+            kernels = &impls[i];
+          else
+            g_warning ("Unknown or unsupported COGL_MATRIX_KERNELS "
+                       "implementation \"%s\"", name);
+        }
+    }
+
+  return kernels;
+}
+
+static void
+check_floats (const float *a, const float *b, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    g_assert_cmpfloat (fabsf (a[i] - b[i]), <=, 1e-4f * (1.0f + fabsf (b[i])));
+}
+
+UNIT_TEST (check_matrix_kernels,
+           0, /* no requirements */
+           0 /* no failure cases */)
+{
+  /* Enough points for every implementation to run its tail, padded
+     with a guard float after each point */
+#define N_POINTS 7
+#define STRIDE 5
+  static const int components[][2] =
+    { { 2, 3 }, { 2, 4 }, { 3, 3 }, { 3, 4 }, { 4, 3 }, { 4, 4 } };
+  const CoglMatrixKernels *impls;
+  float a[16], b[16], a3d[16], b3d[16];
+  float expected[16], result[16];
+  float points_in[N_POINTS * STRIDE];
+  float points_expected[N_POINTS * STRIDE];
+  float points_out[N_POINTS * STRIDE];
+  CoglMatrix matrix;
+  int n_impls, i, c, k;
+
+  for (k = 0; k < 16; k++)
+    {
+      a[k] = k * 0.75f - 5.0f;
+      b[k] = 3.0f - k * 0.5f;
+    }
+
+  /* 3D matrices have a bottom row of (0, 0, 0, 1) */
+  memcpy (a3d, a, sizeof (a));
+  memcpy (b3d, b, sizeof (b));
+  for (k = 0; k < 4; k++)
+    {
+      a3d[k * 4 + 3] = k == 3;
+      b3d[k * 4 + 3] = k == 3;
+    }
+
+  for (k = 0; k < G_N_ELEMENTS (points_in); k++)
+    points_in[k] = k * 1.25f - 20.0f;
+
+  cogl_matrix_init_identity (&matrix);
+  cogl_matrix_translate (&matrix, 10, 20, -3);
+  cogl_matrix_rotate (&matrix, 30, 0.3, 0.5, 1);
+  cogl_matrix_scale (&matrix, 2, 0.5, 1);
+  matrix.wx = 0.01f;
+  matrix.wy = -0.02f;
+
+  impls = _cogl_matrix_kernels_get_impls (&n_impls);
+
+  for (i = 0; i < n_impls; i++)
+    {
+      multiply4x4_c (expected, a, b);
+      impls[i].multiply4x4 (result, a, b);
+      check_floats (result, expected, 16);
+
+      /* The result may be the left hand matrix */
+      memcpy (result, a, sizeof (a));
+      impls[i].multiply4x4 (result, result, b);
+      check_floats (result, expected, 16);
+
+      multiply3x4_c (expected, a3d, b3d);
+      memcpy (result, a3d, sizeof (a3d));
+      impls[i].multiply3x4 (result, result, b3d);
+      check_floats (result, expected, 16);
+
+      for (c = 0; c < G_N_ELEMENTS (components); c++)
+        {
+          int n_in = components[c][0], n_out = components[c][1];
+
+          memset (points_expected, 0, sizeof (points_expected));
+          memset (points_out, 0, sizeof (points_out));
+
+          transform_points_c (&matrix,
+                              n_in, sizeof (float) * STRIDE, points_in,
+                              n_out, sizeof (float) * STRIDE, points_expected,
+                              N_POINTS);
+          impls[i].transform_points (&matrix,
+                                     n_in, sizeof (float) * STRIDE, points_in,
+                                     n_out, sizeof (float) * STRIDE,
+                                     points_out,
+                                     N_POINTS);
+
+          /* The floats after each point must be left alone */
+          check_floats (points_out, points_expected, G_N_ELEMENTS (points_out));
+        }
+    }
+#undef N_POINTS
+#undef STRIDE
+}
@@ -662,9 +662,9 @@ cogl_matrix_stack_new (CoglContext *ctx)
   if (G_UNLIKELY (cogl_matrix_stack_magazine == NULL))
     {
       cogl_matrix_stack_magazine =
-        _cogl_magazine_new (sizeof (CoglMatrixEntryFull), 20);
+        _cogl_magazine_new ("Matrix entry", sizeof (CoglMatrixEntryFull), 20);
       cogl_matrix_stack_matrices_magazine =
-        _cogl_magazine_new (sizeof (CoglMatrix), 20);
+        _cogl_magazine_new ("Matrix", sizeof (CoglMatrix), 20);
     }
 
   stack->context = ctx;
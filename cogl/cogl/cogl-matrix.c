@@ -79,6 +79,7 @@
 #include <cogl-quaternion-private.h>
 #include <cogl-matrix.h>
 #include <cogl-matrix-private.h>
+#include <cogl-matrix-kernels-private.h>
 #include <cogl-quaternion-private.h>
 
 #include <glib.h>
@@ -235,61 +236,27 @@ static float identity[16] = {
 };
 
 
-#define A(row,col)  a[(col<<2)+row]
-#define B(row,col)  b[(col<<2)+row]
-#define R(row,col)  result[(col<<2)+row]
-
 /*
  * Perform a full 4x4 matrix multiplication.
  *
  * <note>It's assumed that @result != @b. @product == @a is allowed.</note>
- *
- * <note>KW: 4*16 = 64 multiplications</note>
  */
-static void
+static inline void
 matrix_multiply4x4 (float *result, const float *a, const float *b)
 {
-  int i;
-  for (i = 0; i < 4; i++)
-    {
-      const float ai0 = A(i,0),  ai1=A(i,1),  ai2=A(i,2),  ai3=A(i,3);
-      R(i,0) = ai0 * B(0,0) + ai1 * B(1,0) + ai2 * B(2,0) + ai3 * B(3,0);
-      R(i,1) = ai0 * B(0,1) + ai1 * B(1,1) + ai2 * B(2,1) + ai3 * B(3,1);
-      R(i,2) = ai0 * B(0,2) + ai1 * B(1,2) + ai2 * B(2,2) + ai3 * B(3,2);
-      R(i,3) = ai0 * B(0,3) + ai1 * B(1,3) + ai2 * B(2,3) + ai3 * B(3,3);
-    }
+  _cogl_matrix_kernels_get ()->multiply4x4 (result, a, b);
 }
 
 /*
  * Multiply two matrices known to occupy only the top three rows, such
  * as typical model matrices, and orthogonal matrices.
- *
- * @a matrix.
- * @b matrix.
- * @product will receive the product of \p a and \p b.
  */
-static void
+static inline void
 matrix_multiply3x4 (float *result, const float *a, const float *b)
 {
-  int i;
-  for (i = 0; i < 3; i++)
-    {
-      const float ai0 = A(i,0), ai1 = A(i,1), ai2 = A(i,2), ai3 = A(i,3);
-      R(i,0) = ai0 * B(0,0) + ai1 * B(1,0) + ai2 * B(2,0);
-      R(i,1) = ai0 * B(0,1) + ai1 * B(1,1) + ai2 * B(2,1);
-      R(i,2) = ai0 * B(0,2) + ai1 * B(1,2) + ai2 * B(2,2);
-      R(i,3) = ai0 * B(0,3) + ai1 * B(1,3) + ai2 * B(2,3) + ai3;
-    }
-  R(3,0) = 0;
-  R(3,1) = 0;
-  R(3,2) = 0;
-  R(3,3) = 1;
+  _cogl_matrix_kernels_get ()->multiply3x4 (result, a, b);
 }
 
-#undef A
-#undef B
-#undef R
-
 /*
  * Multiply a matrix by an array of floats with known properties.
  *
@@ -2019,12 +1986,6 @@ cogl_matrix_transform_point (const CoglMatrix *matrix,
   *w = matrix->wx * _x + matrix->wy * _y + matrix->wz * _z + matrix->ww * _w;
 }
 
-typedef struct _Point2f
-{
-  float x;
-  float y;
-} Point2f;
-
 typedef struct _Point3f
 {
   float x;
@@ -2032,133 +1993,6 @@ typedef struct _Point3f
   float z;
 } Point3f;
 
-typedef struct _Point4f
-{
-  float x;
-  float y;
-  float z;
-  float w;
-} Point4f;
-
-static void
-_cogl_matrix_transform_points_f2 (const CoglMatrix *matrix,
-                                  size_t stride_in,
-                                  const void *points_in,
-                                  size_t stride_out,
-                                  void *points_out,
-                                  int n_points)
-{
-  int i;
-
-  for (i = 0; i < n_points; i++)
-    {
-      Point2f p = *(Point2f *)((uint8_t *)points_in + i * stride_in);
-      Point3f *o = (Point3f *)((uint8_t *)points_out + i * stride_out);
-
-      o->x = matrix->xx * p.x + matrix->xy * p.y + matrix->xw;
-      o->y = matrix->yx * p.x + matrix->yy * p.y + matrix->yw;
-      o->z = matrix->zx * p.x + matrix->zy * p.y + matrix->zw;
-    }
-}
-
-static void
-_cogl_matrix_project_points_f2 (const CoglMatrix *matrix,
-                                size_t stride_in,
-                                const void *points_in,
-                                size_t stride_out,
-                                void *points_out,
-                                int n_points)
-{
-  int i;
-
-  for (i = 0; i < n_points; i++)
-    {
-      Point2f p = *(Point2f *)((uint8_t *)points_in + i * stride_in);
-      Point4f *o = (Point4f *)((uint8_t *)points_out + i * stride_out);
-
-      o->x = matrix->xx * p.x + matrix->xy * p.y + matrix->xw;
-      o->y = matrix->yx * p.x + matrix->yy * p.y + matrix->yw;
-      o->z = matrix->zx * p.x + matrix->zy * p.y + matrix->zw;
-      o->w = matrix->wx * p.x + matrix->wy * p.y + matrix->ww;
-    }
-}
-
-static void
-_cogl_matrix_transform_points_f3 (const CoglMatrix *matrix,
-                                  size_t stride_in,
-                                  const void *points_in,
-                                  size_t stride_out,
-                                  void *points_out,
-                                  int n_points)
-{
-  int i;
-
-  for (i = 0; i < n_points; i++)
-    {
-      Point3f p = *(Point3f *)((uint8_t *)points_in + i * stride_in);
-      Point3f *o = (Point3f *)((uint8_t *)points_out + i * stride_out);
-
-      o->x = matrix->xx * p.x + matrix->xy * p.y +
-             matrix->xz * p.z + matrix->xw;
-      o->y = matrix->yx * p.x + matrix->yy * p.y +
-             matrix->yz * p.z + matrix->yw;
-      o->z = matrix->zx * p.x + matrix->zy * p.y +
-             matrix->zz * p.z + matrix->zw;
-    }
-}
-
-static void
-_cogl_matrix_project_points_f3 (const CoglMatrix *matrix,
-                                size_t stride_in,
-                                const void *points_in,
-                                size_t stride_out,
-                                void *points_out,
-                                int n_points)
-{
-  int i;
-
-  for (i = 0; i < n_points; i++)
-    {
-      Point3f p = *(Point3f *)((uint8_t *)points_in + i * stride_in);
-      Point4f *o = (Point4f *)((uint8_t *)points_out + i * stride_out);
-
-      o->x = matrix->xx * p.x + matrix->xy * p.y +
-             matrix->xz * p.z + matrix->xw;
-      o->y = matrix->yx * p.x + matrix->yy * p.y +
-             matrix->yz * p.z + matrix->yw;
-      o->z = matrix->zx * p.x + matrix->zy * p.y +
-             matrix->zz * p.z + matrix->zw;
-      o->w = matrix->wx * p.x + matrix->wy * p.y +
-             matrix->wz * p.z + matrix->ww;
-    }
-}
-
-static void
-_cogl_matrix_project_points_f4 (const CoglMatrix *matrix,
-                                size_t stride_in,
-                                const void *points_in,
-                                size_t stride_out,
-                                void *points_out,
-                                int n_points)
-{
-  int i;
-
-  for (i = 0; i < n_points; i++)
-    {
-      Point4f p = *(Point4f *)((uint8_t *)points_in + i * stride_in);
-      Point4f *o = (Point4f *)((uint8_t *)points_out + i * stride_out);
-
-      o->x = matrix->xx * p.x + matrix->xy * p.y +
-             matrix->xz * p.z + matrix->xw * p.w;
-      o->y = matrix->yx * p.x + matrix->yy * p.y +
-             matrix->yz * p.z + matrix->yw * p.w;
-      o->z = matrix->zx * p.x + matrix->zy * p.y +
-             matrix->zz * p.z + matrix->zw * p.w;
-      o->w = matrix->wx * p.x + matrix->wy * p.y +
-             matrix->wz * p.z + matrix->ww * p.w;
-    }
-}
-
 void
 cogl_matrix_transform_points (const CoglMatrix *matrix,
                               int n_components,
@@ -2170,21 +2004,14 @@ cogl_matrix_transform_points (const CoglMatrix *matrix,
 {
   /* The results of transforming always have three components... */
   _COGL_RETURN_IF_FAIL (stride_out >= sizeof (Point3f));
+  _COGL_RETURN_IF_FAIL (n_components == 2 || n_components == 3);
 
-  if (n_components == 2)
-    _cogl_matrix_transform_points_f2 (matrix,
-                                      stride_in, points_in,
-                                      stride_out, points_out,
-                                      n_points);
-  else
-    {
-      _COGL_RETURN_IF_FAIL (n_components == 3);
-
-      _cogl_matrix_transform_points_f3 (matrix,
-                                        stride_in, points_in,
-                                        stride_out, points_out,
-                                        n_points);
-    }
+  _cogl_matrix_kernels_get ()->transform_points (matrix,
+                                                 n_components,
+                                                 stride_in, points_in,
+                                                 3, /* n_out_components */
+                                                 stride_out, points_out,
+                                                 n_points);
 }
 
 void
@@ -2196,25 +2023,14 @@ cogl_matrix_project_points (const CoglMatrix *matrix,
                             void *points_out,
                             int n_points)
 {
-  if (n_components == 2)
-    _cogl_matrix_project_points_f2 (matrix,
-                                    stride_in, points_in,
-                                    stride_out, points_out,
-                                    n_points);
-  else if (n_components == 3)
-    _cogl_matrix_project_points_f3 (matrix,
-                                    stride_in, points_in,
-                                    stride_out, points_out,
-                                    n_points);
-  else
-    {
-      _COGL_RETURN_IF_FAIL (n_components == 4);
+  _COGL_RETURN_IF_FAIL (n_components >= 2 && n_components <= 4);
 
-      _cogl_matrix_project_points_f4 (matrix,
-                                      stride_in, points_in,
-                                      stride_out, points_out,
-                                      n_points);
-    }
+  _cogl_matrix_kernels_get ()->transform_points (matrix,
+                                                 n_components,
+                                                 stride_in, points_in,
+                                                 4, /* n_out_components */
+                                                 stride_out, points_out,
+                                                 n_points);
 }
 
 CoglBool
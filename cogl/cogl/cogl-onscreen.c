@@ -414,6 +414,25 @@ cogl_onscreen_get_buffer_age (CoglOnscreen *onscreen)
   return winsys->onscreen_get_buffer_age (onscreen);
 }
 
+void
+cogl_onscreen_queue_damage_region (CoglOnscreen *onscreen,
+                                   const int *rectangles,
+                                   int n_rectangles)
+{
+  CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
+  const CoglWinsysVtable *winsys;
+
+  _COGL_RETURN_IF_FAIL  (framebuffer->type == COGL_FRAMEBUFFER_TYPE_ONSCREEN);
+  _COGL_RETURN_IF_FAIL (n_rectangles > 0);
+
+  winsys = _cogl_framebuffer_get_winsys (framebuffer);
+
+  if (!winsys->onscreen_queue_damage_region)
+    return;
+
+  winsys->onscreen_queue_damage_region (onscreen, rectangles, n_rectangles);
+}
+
 #ifdef COGL_HAS_X11_SUPPORT
 void
 cogl_x11_onscreen_set_foreign_window_xid (CoglOnscreen *onscreen,
@@ -573,6 +592,27 @@ cogl_onscreen_set_swap_throttled (CoglOnscreen *onscreen,
     }
 }
 
+void
+cogl_onscreen_set_swap_tearing_allowed (CoglOnscreen *onscreen,
+                                        CoglBool allowed)
+{
+  CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
+
+  if (framebuffer->config.swap_tearing_allowed == !!allowed)
+    return;
+
+  framebuffer->config.swap_tearing_allowed = !!allowed;
+
+  /* The swap interval is set when the onscreen is bound, so changing
+   * it goes through the same path as throttling */
+  if (framebuffer->allocated && framebuffer->config.swap_throttled)
+    {
+      const CoglWinsysVtable *winsys =
+        _cogl_framebuffer_get_winsys (framebuffer);
+      winsys->onscreen_update_swap_throttled (onscreen);
+    }
+}
+
 void
 cogl_onscreen_show (CoglOnscreen *onscreen)
 {
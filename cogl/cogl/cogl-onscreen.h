@@ -179,6 +179,26 @@ void
 cogl_onscreen_set_swap_throttled (CoglOnscreen *onscreen,
                                   CoglBool throttled);
 
+/**
+ * cogl_onscreen_set_swap_tearing_allowed:
+ * @onscreen: A #CoglOnscreen framebuffer
+ * @allowed: Whether a late swap may tear
+ *
+ * Requests that throttled swaps of @onscreen which miss a vblank are
+ * presented right away instead of waiting for the next one. This keeps
+ * the latency of late frames down at the cost of a tear line. Frames
+ * that are on time are still synchronized to the vblank.
+ *
+ * This has no effect unless swaps are throttled (see
+ * cogl_onscreen_set_swap_throttled()) and the window system supports
+ * it; with GLX that needs GLX_EXT_swap_control_tear.
+ *
+ * Stability: unstable
+ */
+void
+cogl_onscreen_set_swap_tearing_allowed (CoglOnscreen *onscreen,
+                                        CoglBool allowed);
+
 /**
  * cogl_onscreen_show:
  * @onscreen: The onscreen framebuffer to make visible
@@ -312,6 +332,34 @@ cogl_onscreen_swap_buffers (CoglOnscreen *onscreen);
 int
 cogl_onscreen_get_buffer_age (CoglOnscreen *onscreen);
 
+/**
+ * cogl_onscreen_queue_damage_region:
+ * @onscreen: A #CoglOnscreen framebuffer
+ * @rectangles: An array of integer 4-tuples representing the
+ *              rectangles that will be redrawn, as (x, y, width,
+ *              height) tuples relative to the top left corner.
+ * @n_rectangles: The number of 4-tuples to be read from @rectangles
+ *
+ * Tells the driver which parts of the current back buffer are about
+ * to be redrawn. This must be called after querying the buffer age
+ * with cogl_onscreen_get_buffer_age() and before anything is drawn to
+ * @onscreen for the frame.
+ *
+ * Tile based GPUs can then skip loading the old contents of, and
+ * resolving, the rest of the buffer. The contents of the buffer
+ * outside the given rectangles become undefined once the frame is
+ * drawn.
+ *
+ * This does nothing unless the %COGL_WINSYS_FEATURE_PARTIAL_UPDATE
+ * feature is available.
+ *
+ * Stability: unstable
+ */
+void
+cogl_onscreen_queue_damage_region (CoglOnscreen *onscreen,
+                                   const int *rectangles,
+                                   int n_rectangles);
+
 /**
  * cogl_onscreen_swap_buffers_with_damage:
  * @onscreen: A #CoglOnscreen framebuffer
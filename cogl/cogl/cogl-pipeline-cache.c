@@ -118,6 +118,23 @@ _cogl_pipeline_cache_get_combined_template (CoglPipelineCache *cache,
                                         key_pipeline);
 }
 
+void
+_cogl_pipeline_cache_get_stats (CoglPipelineCache *cache,
+                                CoglCacheStats *stats)
+{
+  _cogl_pipeline_hash_table_get_stats (&cache->fragment_hash, stats);
+  _cogl_pipeline_hash_table_get_stats (&cache->vertex_hash, stats);
+  _cogl_pipeline_hash_table_get_stats (&cache->combined_hash, stats);
+}
+
+void
+_cogl_pipeline_cache_trim (CoglPipelineCache *cache)
+{
+  _cogl_pipeline_hash_table_trim (&cache->fragment_hash);
+  _cogl_pipeline_hash_table_trim (&cache->vertex_hash);
+  _cogl_pipeline_hash_table_trim (&cache->combined_hash);
+}
+
 #ifdef ENABLE_UNIT_TESTS
 
 static void
@@ -32,6 +32,7 @@
 #define __COGL_PIPELINE_CACHE_H__
 
 #include "cogl-pipeline.h"
+#include "cogl-cache-stats.h"
 
 typedef struct _CoglPipelineCache CoglPipelineCache;
 
@@ -90,4 +91,13 @@ CoglPipelineCacheEntry *
 _cogl_pipeline_cache_get_combined_template (CoglPipelineCache *cache,
                                             CoglPipeline *key_pipeline);
 
+/* Adds the statistics of the three template tables to @stats */
+void
+_cogl_pipeline_cache_get_stats (CoglPipelineCache *cache,
+                                CoglCacheStats *stats);
+
+/* Removes the templates no pipeline is using */
+void
+_cogl_pipeline_cache_trim (CoglPipelineCache *cache);
+
 #endif /* __COGL_PIPELINE_CACHE_H__ */
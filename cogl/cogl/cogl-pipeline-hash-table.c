@@ -102,6 +102,9 @@ _cogl_pipeline_hash_table_init (CoglPipelineHashTable *hash,
 {
   hash->n_unique_pipelines = 0;
   hash->debug_string = debug_string;
+  hash->n_hits = 0;
+  hash->n_misses = 0;
+  hash->n_evictions = 0;
   hash->main_state = main_state;
   hash->layer_state = layer_state;
   /* We'll only start pruning once we get to 16 unique pipelines */
@@ -170,6 +173,7 @@ prune_old_pipelines (CoglPipelineHashTable *hash)
       CoglPipelineCacheEntry *entry = l->data;
 
       g_hash_table_remove (hash->table, entry);
+      hash->n_evictions++;
     }
 
   g_list_free (entries.head);
@@ -194,9 +198,12 @@ _cogl_pipeline_hash_table_get (CoglPipelineHashTable *hash,
   if (entry)
     {
       entry->age = hash->n_unique_pipelines;
+      hash->n_hits++;
       return &entry->parent;
     }
 
+  hash->n_misses++;
+
   if (hash->n_unique_pipelines == 50)
     g_warning ("Over 50 separate %s have been generated which is very "
                "unusual, so something is probably wrong!\n",
@@ -231,3 +238,40 @@ _cogl_pipeline_hash_table_get (CoglPipelineHashTable *hash,
 
   return &entry->parent;
 }
+
+void
+_cogl_pipeline_hash_table_get_stats (CoglPipelineHashTable *hash,
+                                     CoglCacheStats *stats)
+{
+  unsigned int n_entries = g_hash_table_size (hash->table);
+
+  /* The templates take little more than their pipeline; the shaders
+   * and programs attached to them aren't counted */
+  stats->n_entries += n_entries;
+  stats->bytes += n_entries * (sizeof (CoglPipelineHashTableEntry) +
+                               sizeof (CoglPipeline));
+  stats->hits += hash->n_hits;
+  stats->misses += hash->n_misses;
+  stats->evictions += hash->n_evictions;
+}
+
+static CoglBool
+entry_unused_cb (void *key,
+                 void *value,
+                 void *user_data)
+{
+  CoglPipelineCacheEntry *entry = value;
+
+  return entry->usage_count == 0;
+}
+
+void
+_cogl_pipeline_hash_table_trim (CoglPipelineHashTable *hash)
+{
+  hash->n_evictions += g_hash_table_foreach_remove (hash->table,
+                                                    entry_unused_cb,
+                                                    NULL);
+
+  /* Start pruning again once the table has doubled from here */
+  hash->expected_min_size = MAX (g_hash_table_size (hash->table), 8);
+}
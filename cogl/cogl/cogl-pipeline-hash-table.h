@@ -32,6 +32,7 @@
 #define __COGL_PIPELINE_HASH_H__
 
 #include "cogl-pipeline-cache.h"
+#include "cogl-cache-stats.h"
 
 typedef struct
 {
@@ -51,6 +52,12 @@ typedef struct
    * must be a static string because it won't be copied or freed */
   const char *debug_string;
 
+  /* Lookups that found a pipeline or added one, and pipelines pruned,
+   * for cogl_context_get_pipeline_cache_stats() */
+  uint64_t n_hits;
+  uint64_t n_misses;
+  uint64_t n_evictions;
+
   unsigned int main_state;
   unsigned int layer_state;
 
@@ -78,4 +85,13 @@ CoglPipelineCacheEntry *
 _cogl_pipeline_hash_table_get (CoglPipelineHashTable *hash,
                                CoglPipeline *key_pipeline);
 
+/* Adds the statistics of @hash to @stats */
+void
+_cogl_pipeline_hash_table_get_stats (CoglPipelineHashTable *hash,
+                                     CoglCacheStats *stats);
+
+/* Removes all of the pipelines that are not in use */
+void
+_cogl_pipeline_hash_table_trim (CoglPipelineHashTable *hash);
+
 #endif /* __COGL_PIPELINE_HASH_H__ */
@@ -47,6 +47,7 @@
 #include "cogl-pipeline-opengl-private.h"
 #include "cogl-context-private.h"
 #include "cogl-texture-private.h"
+#include "cogl-magazine-private.h"
 
 #include <string.h>
 
@@ -59,6 +60,9 @@ _cogl_pipeline_layer_free (CoglPipelineLayer *layer);
    so that the cogl_is_* function won't get defined */
 COGL_OBJECT_INTERNAL_DEFINE (PipelineLayer, pipeline_layer);
 
+static CoglMagazine *layer_magazine;
+static CoglMagazine *big_state_magazine;
+
 
 CoglPipelineLayer *
 _cogl_pipeline_layer_get_authority (CoglPipelineLayer *layer,
@@ -164,7 +168,7 @@ _cogl_pipeline_layer_copy_differences (CoglPipelineLayer *dest,
   if ((differences & COGL_PIPELINE_LAYER_STATE_NEEDS_BIG_STATE) &&
       !dest->has_big_state)
     {
-      dest->big_state = g_slice_new (CoglPipelineLayerBigState);
+      dest->big_state = _cogl_magazine_chunk_alloc (big_state_magazine);
       dest->has_big_state = TRUE;
     }
 
@@ -431,7 +435,7 @@ init_layer_state:
   if (change & COGL_PIPELINE_LAYER_STATE_NEEDS_BIG_STATE &&
       !layer->has_big_state)
     {
-      layer->big_state = g_slice_new (CoglPipelineLayerBigState);
+      layer->big_state = _cogl_magazine_chunk_alloc (big_state_magazine);
       layer->has_big_state = TRUE;
     }
 
@@ -480,7 +484,7 @@ _cogl_pipeline_layer_set_parent (CoglPipelineLayer *layer,
 CoglPipelineLayer *
 _cogl_pipeline_layer_copy (CoglPipelineLayer *src)
 {
-  CoglPipelineLayer *layer = g_slice_new (CoglPipelineLayer);
+  CoglPipelineLayer *layer = _cogl_magazine_chunk_alloc (layer_magazine);
 
   _cogl_pipeline_node_init (COGL_NODE (layer));
 
@@ -745,21 +749,37 @@ _cogl_pipeline_layer_free (CoglPipelineLayer *layer)
     _cogl_pipeline_snippet_list_free (&layer->big_state->fragment_snippets);
 
   if (layer->differences & COGL_PIPELINE_LAYER_STATE_NEEDS_BIG_STATE)
-    g_slice_free (CoglPipelineLayerBigState, layer->big_state);
+    _cogl_magazine_chunk_free (big_state_magazine, layer->big_state);
 
-  g_slice_free (CoglPipelineLayer, layer);
+  _cogl_magazine_chunk_free (layer_magazine, layer);
 }
 
 void
 _cogl_pipeline_init_default_layers (void)
 {
-  CoglPipelineLayer *layer = g_slice_new0 (CoglPipelineLayer);
-  CoglPipelineLayerBigState *big_state =
-    g_slice_new0 (CoglPipelineLayerBigState);
+  CoglPipelineLayer *layer;
+  CoglPipelineLayerBigState *big_state;
   CoglPipelineLayer *new;
 
   _COGL_GET_CONTEXT (ctx, NO_RETVAL);
 
+  /* Layers are copied whenever a pipeline's layer state is changed,
+   * which can happen many times a frame, so they come from magazines
+   * instead of the general purpose allocator */
+  if (G_UNLIKELY (layer_magazine == NULL))
+    {
+      layer_magazine =
+        _cogl_magazine_new ("Pipeline layer", sizeof (CoglPipelineLayer), 64);
+      big_state_magazine =
+        _cogl_magazine_new ("Pipeline layer big state",
+                            sizeof (CoglPipelineLayerBigState), 16);
+    }
+
+  layer = _cogl_magazine_chunk_alloc (layer_magazine);
+  memset (layer, 0, sizeof (CoglPipelineLayer));
+  big_state = _cogl_magazine_chunk_alloc (big_state_magazine);
+  memset (big_state, 0, sizeof (CoglPipelineLayerBigState));
+
   _cogl_pipeline_node_init (COGL_NODE (layer));
 
   layer->index = 0;
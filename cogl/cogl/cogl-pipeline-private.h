@@ -357,6 +357,9 @@ typedef struct _CoglPipelineHashState
 {
   unsigned long layer_differences;
   CoglPipelineEvalFlags flags;
+  /* The real_blend_enable of the pipeline being hashed, rather than
+   * of the authority of a state group */
+  CoglBool real_blend_enable;
   unsigned int hash;
 } CoglPipelineHashState;
 
@@ -455,6 +458,16 @@ struct _CoglPipeline
    * const GList of layers, which we track here... */
   GList                *deprecated_get_layers_list;
 
+  /* The value last returned by _cogl_pipeline_hash() and the state
+   * it was computed for. Since the ancestors of a pipeline are copied
+   * on write rather than modified under it, the value stays valid
+   * until the age of the pipeline itself changes. */
+  unsigned int          hash_cache_value;
+  unsigned int          hash_cache_age;
+  unsigned int          hash_cache_differences;
+  unsigned long         hash_cache_layer_differences;
+  CoglPipelineEvalFlags hash_cache_flags;
+
   /* XXX: consider adding an authorities cache to speed up sparse
    * property value lookups:
    * CoglPipeline *authorities_cache[COGL_PIPELINE_N_SPARSE_PROPERTIES];
@@ -499,6 +512,11 @@ struct _CoglPipeline
   unsigned int          layers_cache_dirty:1;
   unsigned int          deprecated_get_layers_list_dirty:1;
 
+  /* Whether the hash_cache_* members are valid, and the
+   * real_blend_enable value they were computed with */
+  unsigned int          has_hash_cache:1;
+  unsigned int          hash_cache_real_blend_enable:1;
+
 #ifdef COGL_DEBUG_ENABLED
   /* For debugging purposes it's possible to associate a static const
    * string with a pipeline which can be an aid when trying to trace
@@ -1842,7 +1842,7 @@ _cogl_pipeline_hash_blend_state (CoglPipeline *authority,
 
   _COGL_GET_CONTEXT (ctx, NO_RETVAL);
 
-  if (!authority->real_blend_enable)
+  if (!state->real_blend_enable)
     return;
 
   hash = state->hash;
@@ -177,6 +177,7 @@ _cogl_pipeline_init_default_pipeline (void)
   pipeline->has_static_breadcrumb = TRUE;
 
   pipeline->age = 0;
+  pipeline->has_hash_cache = FALSE;
 
   /* Use the same defaults as the GL spec... */
   cogl_color_init_from_4ub (&pipeline->color, 0xff, 0xff, 0xff, 0xff);
@@ -393,6 +394,7 @@ _cogl_pipeline_copy (CoglPipeline *src, CoglBool is_weak)
   pipeline->has_static_breadcrumb = FALSE;
 
   pipeline->age = 0;
+  pipeline->has_hash_cache = FALSE;
 
   _cogl_pipeline_set_parent (pipeline, src, !is_weak);
 
@@ -2238,6 +2240,21 @@ _cogl_pipeline_resolve_authorities (CoglPipeline *pipeline,
  * COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE because once they get to the
  * journal stage they act exactly the same.
  */
+static CoglBool
+hash_cache_is_valid (CoglPipeline *pipeline,
+                     unsigned int differences,
+                     unsigned long layer_differences,
+                     CoglPipelineEvalFlags flags)
+{
+  return (pipeline->has_hash_cache &&
+          pipeline->hash_cache_age == pipeline->age &&
+          pipeline->hash_cache_real_blend_enable ==
+          pipeline->real_blend_enable &&
+          pipeline->hash_cache_differences == differences &&
+          pipeline->hash_cache_layer_differences == layer_differences &&
+          pipeline->hash_cache_flags == flags);
+}
+
 CoglBool
 _cogl_pipeline_equal (CoglPipeline *pipeline0,
                       CoglPipeline *pipeline1,
@@ -2270,6 +2287,14 @@ _cogl_pipeline_equal (CoglPipeline *pipeline0,
   _cogl_pipeline_update_real_blend_enable (pipeline0, FALSE);
   _cogl_pipeline_update_real_blend_enable (pipeline1, FALSE);
 
+  /* Equal pipelines have equal hashes, so if both pipelines were
+   * already hashed for this comparison we may know the answer
+   * without resolving any state */
+  if (hash_cache_is_valid (pipeline0, differences, layer_differences, flags) &&
+      hash_cache_is_valid (pipeline1, differences, layer_differences, flags) &&
+      pipeline0->hash_cache_value != pipeline1->hash_cache_value)
+    goto done;
+
   /* First check non-sparse properties */
 
   if (differences & COGL_PIPELINE_STATE_REAL_BLEND_ENABLE &&
@@ -2843,11 +2868,15 @@ _cogl_pipeline_hash (CoglPipeline *pipeline,
   CoglPipelineHashState state;
   unsigned int final_hash = 0;
 
+  _cogl_pipeline_update_real_blend_enable (pipeline, FALSE);
+
+  if (hash_cache_is_valid (pipeline, differences, layer_differences, flags))
+    return pipeline->hash_cache_value;
+
   state.hash = 0;
   state.layer_differences = layer_differences;
   state.flags = flags;
-
-  _cogl_pipeline_update_real_blend_enable (pipeline, FALSE);
+  state.real_blend_enable = pipeline->real_blend_enable;
 
   /* hash non-sparse state */
 
@@ -2883,7 +2912,17 @@ _cogl_pipeline_hash (CoglPipeline *pipeline,
         break;
     }
 
-  return _cogl_util_one_at_a_time_mix (final_hash);
+  final_hash = _cogl_util_one_at_a_time_mix (final_hash);
+
+  pipeline->hash_cache_value = final_hash;
+  pipeline->hash_cache_age = pipeline->age;
+  pipeline->hash_cache_real_blend_enable = pipeline->real_blend_enable;
+  pipeline->hash_cache_differences = differences;
+  pipeline->hash_cache_layer_differences = layer_differences;
+  pipeline->hash_cache_flags = flags;
+  pipeline->has_hash_cache = TRUE;
+
+  return final_hash;
 }
 
 typedef struct
@@ -69,6 +69,17 @@ typedef enum
    * is first allocated or when it is shown or resized */
   COGL_PRIVATE_FEATURE_DIRTY_EVENTS,
   COGL_PRIVATE_FEATURE_ENABLE_PROGRAM_POINT_SIZE,
+  COGL_PRIVATE_FEATURE_PROGRAM_BINARY,
+  /* Buffers can be given immutable storage that stays mapped while
+   * the GPU reads from it, and fenced with GL sync objects */
+  COGL_PRIVATE_FEATURE_PERSISTENT_BUFFERS,
+  /* GL_TIMESTAMP queries, see cogl-gpu-timer.h */
+  COGL_PRIVATE_FEATURE_TIMER_QUERY,
+  /* Vertex array objects can be created and bound */
+  COGL_PRIVATE_FEATURE_VERTEX_ARRAY_OBJECTS,
+  /* The driver compiles and links on its own threads, so waiting for
+   * the result of a compile can be put off until it is needed */
+  COGL_PRIVATE_FEATURE_PARALLEL_SHADER_COMPILE,
   /* These features let us avoid conditioning code based on the exact
    * driver being used and instead check for broad opengl feature
    * sets that can be shared by several GL apis */
@@ -80,6 +91,8 @@ typedef enum
   /* This is currently only implemented for GLX, but isn't actually
    * that winsys dependent */
   COGL_PRIVATE_FEATURE_THREADED_SWAP_WAIT,
+  /* The swap itself is also issued from the swap wait thread */
+  COGL_PRIVATE_FEATURE_THREADED_PRESENT,
 
   COGL_N_PRIVATE_FEATURES
 } CoglPrivateFeature;
@@ -35,8 +35,11 @@
 #include "cogl-config.h"
 #endif
 
+#include <string.h>
 #include <glib.h>
 
+#include <test-fixtures/test-unit.h>
+
 #include "cogl-util.h"
 #include "cogl-rectangle-map.h"
 #include "cogl-debug.h"
@@ -46,6 +49,14 @@
    structure. The algorithm for this is based on the description here:
 
    http://www.blackpawn.com/texts/lightmaps/default.html
+
+   Alternatively the map can use a skyline. This is a list of
+   horizontal segments covering the width of the map, each holding the
+   y position from which the map is free all the way to the bottom. A
+   new rectangle rests on the lowest point of the segments it spans,
+   at the position where its bottom edge ends up nearest the top of
+   the map, and the segments it covers are replaced with one at its
+   bottom edge.
 */
 
 #if defined (COGL_ENABLE_DEBUG) && defined (HAVE_CAIRO)
@@ -71,10 +82,32 @@ typedef enum
   COGL_RECTANGLE_MAP_EMPTY_LEAF
 } CoglRectangleMapNodeType;
 
+typedef struct _CoglRectangleMapSegment
+{
+  unsigned int x, y;
+  unsigned int width;
+} CoglRectangleMapSegment;
+
+typedef struct _CoglRectangleMapSkylineEntry
+{
+  CoglRectangleMapEntry rectangle;
+  void *data;
+} CoglRectangleMapSkylineEntry;
+
 struct _CoglRectangleMap
 {
+  CoglRectangleMapPacking packing;
+
+  unsigned int width, height;
+
+  /* The tree when using COGL_RECTANGLE_MAP_PACKING_TREE */
   CoglRectangleMapNode *root;
 
+  /* The segments sorted by x and the placed rectangles when using
+     COGL_RECTANGLE_MAP_PACKING_SKYLINE */
+  GArray *skyline;
+  GHashTable *skyline_rectangles;
+
   unsigned int n_rectangles;
 
   unsigned int space_remaining;
@@ -132,23 +165,86 @@ _cogl_rectangle_map_node_free (CoglRectangleMapNode *node)
   g_slice_free (CoglRectangleMapNode, node);
 }
 
+static unsigned int
+_cogl_rectangle_map_skyline_hash (const void *key)
+{
+  const CoglRectangleMapEntry *rectangle = key;
+
+  /* Rectangles never overlap so the position is enough to tell them
+     apart */
+  return (rectangle->y << 16) ^ rectangle->x;
+}
+
+static gboolean
+_cogl_rectangle_map_skyline_equal (const void *a,
+                                   const void *b)
+{
+  const CoglRectangleMapEntry *ra = a;
+  const CoglRectangleMapEntry *rb = b;
+
+  return ra->x == rb->x && ra->y == rb->y;
+}
+
+static void
+_cogl_rectangle_map_skyline_entry_free (void *data)
+{
+  g_slice_free (CoglRectangleMapSkylineEntry, data);
+}
+
+static void
+_cogl_rectangle_map_skyline_reset (CoglRectangleMap *map)
+{
+  CoglRectangleMapSegment segment;
+
+  segment.x = 0;
+  segment.y = 0;
+  segment.width = map->width;
+
+  g_array_set_size (map->skyline, 0);
+  g_array_append_val (map->skyline, segment);
+}
+
 CoglRectangleMap *
-_cogl_rectangle_map_new (unsigned int width,
-                         unsigned int height,
-                         GDestroyNotify value_destroy_func)
+_cogl_rectangle_map_new_with_packing (unsigned int width,
+                                      unsigned int height,
+                                      CoglRectangleMapPacking packing,
+                                      GDestroyNotify value_destroy_func)
 {
   CoglRectangleMap *map = g_new (CoglRectangleMap, 1);
-  CoglRectangleMapNode *root = _cogl_rectangle_map_node_new ();
 
-  root->type = COGL_RECTANGLE_MAP_EMPTY_LEAF;
-  root->parent = NULL;
-  root->rectangle.x = 0;
-  root->rectangle.y = 0;
-  root->rectangle.width = width;
-  root->rectangle.height = height;
-  root->largest_gap = width * height;
+  map->packing = packing;
+  map->width = width;
+  map->height = height;
+  map->root = NULL;
+  map->skyline = NULL;
+  map->skyline_rectangles = NULL;
+
+  if (packing == COGL_RECTANGLE_MAP_PACKING_SKYLINE)
+    {
+      map->skyline = g_array_new (FALSE, FALSE,
+                                  sizeof (CoglRectangleMapSegment));
+      map->skyline_rectangles =
+        g_hash_table_new_full (_cogl_rectangle_map_skyline_hash,
+                               _cogl_rectangle_map_skyline_equal,
+                               _cogl_rectangle_map_skyline_entry_free,
+                               NULL);
+      _cogl_rectangle_map_skyline_reset (map);
+    }
+  else
+    {
+      CoglRectangleMapNode *root = _cogl_rectangle_map_node_new ();
+
+      root->type = COGL_RECTANGLE_MAP_EMPTY_LEAF;
+      root->parent = NULL;
+      root->rectangle.x = 0;
+      root->rectangle.y = 0;
+      root->rectangle.width = width;
+      root->rectangle.height = height;
+      root->largest_gap = width * height;
+
+      map->root = root;
+    }
 
-  map->root = root;
   map->n_rectangles = 0;
   map->value_destroy_func = value_destroy_func;
   map->space_remaining = width * height;
@@ -158,6 +254,22 @@ _cogl_rectangle_map_new (unsigned int width,
   return map;
 }
 
+CoglRectangleMap *
+_cogl_rectangle_map_new (unsigned int width,
+                         unsigned int height,
+                         GDestroyNotify value_destroy_func)
+{
+  return _cogl_rectangle_map_new_with_packing (width, height,
+                                               COGL_RECTANGLE_MAP_PACKING_TREE,
+                                               value_destroy_func);
+}
+
+CoglRectangleMapPacking
+_cogl_rectangle_map_get_packing (CoglRectangleMap *map)
+{
+  return map->packing;
+}
+
 static void
 _cogl_rectangle_map_stack_push (GArray *stack,
                                 CoglRectangleMapNode *node,
@@ -334,13 +446,64 @@ _cogl_rectangle_map_get_space_remaining_recursive (CoglRectangleMapNode *node)
   return 0;
 }
 
+static void
+_cogl_rectangle_map_verify_skyline (CoglRectangleMap *map,
+                                    unsigned int *n_rectangles,
+                                    unsigned int *space_remaining)
+{
+  GHashTableIter iter;
+  CoglRectangleMapSkylineEntry *entry;
+  unsigned int x = 0;
+  int i;
+
+  /* The segments must cover the whole width without overlapping and
+     neighbours must have been merged if they are at the same height */
+  for (i = 0; i < map->skyline->len; i++)
+    {
+      CoglRectangleMapSegment *segment =
+        &g_array_index (map->skyline, CoglRectangleMapSegment, i);
+
+      g_assert_cmpuint (segment->x, ==, x);
+      g_assert_cmpuint (segment->width, >, 0);
+      g_assert_cmpuint (segment->y, <=, map->height);
+      g_assert (i == 0 ||
+                g_array_index (map->skyline,
+                               CoglRectangleMapSegment,
+                               i - 1).y != segment->y);
+
+      x += segment->width;
+    }
+
+  g_assert_cmpuint (x, ==, map->width);
+
+  *n_rectangles = 0;
+  *space_remaining = map->width * map->height;
+
+  g_hash_table_iter_init (&iter, map->skyline_rectangles);
+  while (g_hash_table_iter_next (&iter, (void **) &entry, NULL))
+    {
+      (*n_rectangles)++;
+      *space_remaining -= entry->rectangle.width * entry->rectangle.height;
+    }
+}
+
 static void
 _cogl_rectangle_map_verify (CoglRectangleMap *map)
 {
-  unsigned int actual_n_rectangles =
-    _cogl_rectangle_map_verify_recursive (map->root);
-  unsigned int actual_space_remaining =
-    _cogl_rectangle_map_get_space_remaining_recursive (map->root);
+  unsigned int actual_n_rectangles;
+  unsigned int actual_space_remaining;
+
+  if (map->packing == COGL_RECTANGLE_MAP_PACKING_SKYLINE)
+    _cogl_rectangle_map_verify_skyline (map,
+                                        &actual_n_rectangles,
+                                        &actual_space_remaining);
+  else
+    {
+      actual_n_rectangles =
+        _cogl_rectangle_map_verify_recursive (map->root);
+      actual_space_remaining =
+        _cogl_rectangle_map_get_space_remaining_recursive (map->root);
+    }
 
   g_assert_cmpuint (actual_n_rectangles, ==, map->n_rectangles);
   g_assert_cmpuint (actual_space_remaining, ==, map->space_remaining);
@@ -348,22 +511,18 @@ _cogl_rectangle_map_verify (CoglRectangleMap *map)
 
 #endif /* COGL_ENABLE_DEBUG */
 
-CoglBool
-_cogl_rectangle_map_add (CoglRectangleMap *map,
-                         unsigned int width,
-                         unsigned int height,
-                         void *data,
-                         CoglRectangleMapEntry *rectangle)
+static CoglBool
+_cogl_rectangle_map_tree_add (CoglRectangleMap *map,
+                              unsigned int width,
+                              unsigned int height,
+                              void *data,
+                              CoglRectangleMapEntry *rectangle)
 {
   unsigned int rectangle_size = width * height;
   /* Stack of nodes to search in */
   GArray *stack = map->stack;
   CoglRectangleMapNode *found_node = NULL;
 
-  /* Zero-sized rectangles break the algorithm for removing rectangles
-     so we'll disallow them */
-  _COGL_RETURN_VAL_IF_FAIL (width > 0 && height > 0, FALSE);
-
   /* Start with the root node */
   g_array_set_size (stack, 0);
   _cogl_rectangle_map_stack_push (stack, map->root, FALSE);
@@ -456,32 +615,173 @@ _cogl_rectangle_map_add (CoglRectangleMap *map,
                                    node->d.branch.right->largest_gap);
         }
 
-      /* There is now an extra rectangle in the map */
-      map->n_rectangles++;
-      /* and less space */
-      map->space_remaining -= rectangle_size;
+      return TRUE;
+    }
+  else
+    return FALSE;
+}
 
-#ifdef COGL_ENABLE_DEBUG
-      if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_DUMP_ATLAS_IMAGE)))
+/* Merges the segments around @index that have the same height */
+static void
+_cogl_rectangle_map_skyline_merge (GArray *skyline,
+                                   int index)
+{
+  CoglRectangleMapSegment *segments =
+    (CoglRectangleMapSegment *) skyline->data;
+
+  if (index + 1 < skyline->len &&
+      segments[index + 1].y == segments[index].y)
+    {
+      segments[index].width += segments[index + 1].width;
+      g_array_remove_index (skyline, index + 1);
+    }
+
+  if (index > 0 && segments[index - 1].y == segments[index].y)
+    {
+      segments[index - 1].width += segments[index].width;
+      g_array_remove_index (skyline, index);
+    }
+}
+
+static CoglBool
+_cogl_rectangle_map_skyline_add (CoglRectangleMap *map,
+                                 unsigned int width,
+                                 unsigned int height,
+                                 void *data,
+                                 CoglRectangleMapEntry *rectangle)
+{
+  GArray *skyline = map->skyline;
+  CoglRectangleMapSegment *segments =
+    (CoglRectangleMapSegment *) skyline->data;
+  CoglRectangleMapSkylineEntry *entry;
+  CoglRectangleMapSegment new_segment;
+  unsigned int best_bottom = G_MAXUINT, best_waste = G_MAXUINT;
+  unsigned int end;
+  int best_index = -1;
+  int i, j;
+
+  /* Try placing the rectangle at the left edge of every segment. Ties
+     between positions where the bottom edge would end up at the same
+     height go to the one leaving the smallest gap above the
+     rectangle */
+  for (i = 0; i < skyline->len; i++)
+    {
+      unsigned int x = segments[i].x;
+      unsigned int y = 0, waste = 0;
+      unsigned int covered;
+
+      if (x + width > map->width)
+        break;
+
+      for (j = i; j < skyline->len && segments[j].x < x + width; j++)
+        y = MAX (y, segments[j].y);
+
+      if (y + height > map->height || y + height > best_bottom)
+        continue;
+
+      for (j = i; j < skyline->len && segments[j].x < x + width; j++)
         {
-#ifdef HAVE_CAIRO
-          _cogl_rectangle_map_dump_image (map);
-#endif
-          /* Dumping the rectangle map is really slow so we might as well
-             verify the space remaining here as it is also quite slow */
-          _cogl_rectangle_map_verify (map);
+          covered = MIN (segments[j].x + segments[j].width, x + width) -
+            segments[j].x;
+          waste += (y - segments[j].y) * covered;
         }
-#endif
 
-      return TRUE;
+      if (y + height < best_bottom || waste < best_waste)
+        {
+          best_index = i;
+          best_bottom = y + height;
+          best_waste = waste;
+        }
+    }
+
+  if (best_index == -1)
+    return FALSE;
+
+  new_segment.x = segments[best_index].x;
+  new_segment.y = best_bottom;
+  new_segment.width = width;
+  end = new_segment.x + width;
+
+  /* Remove or trim the segments that the new one covers */
+  while (best_index < skyline->len &&
+         segments[best_index].x < end)
+    {
+      CoglRectangleMapSegment *segment = segments + best_index;
+
+      if (segment->x + segment->width <= end)
+        g_array_remove_index (skyline, best_index);
+      else
+        {
+          segment->width -= end - segment->x;
+          segment->x = end;
+          break;
+        }
     }
+
+  g_array_insert_val (skyline, best_index, new_segment);
+  _cogl_rectangle_map_skyline_merge (skyline, best_index);
+
+  entry = g_slice_new (CoglRectangleMapSkylineEntry);
+  entry->rectangle.x = new_segment.x;
+  entry->rectangle.y = best_bottom - height;
+  entry->rectangle.width = width;
+  entry->rectangle.height = height;
+  entry->data = data;
+
+  g_hash_table_add (map->skyline_rectangles, entry);
+
+  if (rectangle)
+    *rectangle = entry->rectangle;
+
+  return TRUE;
+}
+
+CoglBool
+_cogl_rectangle_map_add (CoglRectangleMap *map,
+                         unsigned int width,
+                         unsigned int height,
+                         void *data,
+                         CoglRectangleMapEntry *rectangle)
+{
+  CoglBool ret;
+
+  /* Zero-sized rectangles break the algorithm for removing rectangles
+     so we'll disallow them */
+  _COGL_RETURN_VAL_IF_FAIL (width > 0 && height > 0, FALSE);
+
+  if (map->packing == COGL_RECTANGLE_MAP_PACKING_SKYLINE)
+    ret = _cogl_rectangle_map_skyline_add (map, width, height,
+                                           data, rectangle);
   else
+    ret = _cogl_rectangle_map_tree_add (map, width, height,
+                                        data, rectangle);
+
+  if (!ret)
     return FALSE;
+
+  /* There is now an extra rectangle in the map */
+  map->n_rectangles++;
+  /* and less space */
+  map->space_remaining -= width * height;
+
+#ifdef COGL_ENABLE_DEBUG
+  if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_DUMP_ATLAS_IMAGE)))
+    {
+#ifdef HAVE_CAIRO
+      _cogl_rectangle_map_dump_image (map);
+#endif
+      /* Dumping the rectangle map is really slow so we might as well
+         verify the space remaining here as it is also quite slow */
+      _cogl_rectangle_map_verify (map);
+    }
+#endif
+
+  return TRUE;
 }
 
-void
-_cogl_rectangle_map_remove (CoglRectangleMap *map,
-                            const CoglRectangleMapEntry *rectangle)
+static void
+_cogl_rectangle_map_tree_remove (CoglRectangleMap *map,
+                                 const CoglRectangleMapEntry *rectangle)
 {
   CoglRectangleMapNode *node = map->root;
   unsigned int rectangle_size = rectangle->width * rectangle->height;
@@ -553,6 +853,101 @@ _cogl_rectangle_map_remove (CoglRectangleMap *map,
       /* and more space */
       map->space_remaining += rectangle_size;
     }
+}
+
+static void
+_cogl_rectangle_map_skyline_remove (CoglRectangleMap *map,
+                                    const CoglRectangleMapEntry *rectangle)
+{
+  CoglRectangleMapSkylineEntry *entry;
+  GArray *skyline = map->skyline;
+  unsigned int bottom = rectangle->y + rectangle->height;
+  unsigned int end = rectangle->x + rectangle->width;
+  int i;
+
+  entry = g_hash_table_lookup (map->skyline_rectangles, rectangle);
+
+  if (entry == NULL ||
+      entry->rectangle.width != rectangle->width ||
+      entry->rectangle.height != rectangle->height)
+    /* This should only happen if someone tried to remove a rectangle
+       that was not in the map so something has gone wrong */
+    g_return_if_reached ();
+
+  if (map->value_destroy_func)
+    map->value_destroy_func (entry->data);
+
+  g_hash_table_remove (map->skyline_rectangles, rectangle);
+
+  g_assert (map->n_rectangles > 0);
+  map->n_rectangles--;
+  map->space_remaining += rectangle->width * rectangle->height;
+
+  if (map->n_rectangles == 0)
+    {
+      _cogl_rectangle_map_skyline_reset (map);
+      return;
+    }
+
+  /* Wherever the skyline is at the bottom edge of the rectangle
+     nothing was placed below it, so the skyline can move back up to
+     the rectangle's top edge */
+  for (i = 0; i < skyline->len; i++)
+    {
+      CoglRectangleMapSegment *segment =
+        &g_array_index (skyline, CoglRectangleMapSegment, i);
+      CoglRectangleMapSegment part;
+
+      if (segment->x >= end)
+        break;
+      if (segment->x + segment->width <= rectangle->x ||
+          segment->y != bottom)
+        continue;
+
+      /* Split off the parts of the segment outside the rectangle */
+      if (segment->x < rectangle->x)
+        {
+          part = *segment;
+          part.width = rectangle->x - segment->x;
+          segment->x = rectangle->x;
+          segment->width -= part.width;
+          g_array_insert_val (skyline, i, part);
+          i++;
+          segment = &g_array_index (skyline, CoglRectangleMapSegment, i);
+        }
+
+      if (segment->x + segment->width > end)
+        {
+          part = *segment;
+          part.x = end;
+          part.width = segment->x + segment->width - end;
+          segment->width -= part.width;
+          g_array_insert_val (skyline, i + 1, part);
+          segment = &g_array_index (skyline, CoglRectangleMapSegment, i);
+        }
+
+      segment->y = rectangle->y;
+    }
+
+  for (i = skyline->len - 1; i >= 0; i--)
+    if (i + 1 < skyline->len &&
+        g_array_index (skyline, CoglRectangleMapSegment, i).y ==
+        g_array_index (skyline, CoglRectangleMapSegment, i + 1).y)
+      {
+        g_array_index (skyline, CoglRectangleMapSegment, i).width +=
+          g_array_index (skyline, CoglRectangleMapSegment, i + 1).width;
+        g_array_remove_index (skyline, i + 1);
+      }
+}
+
+void
+_cogl_rectangle_map_remove (CoglRectangleMap *map,
+                            const CoglRectangleMapEntry *rectangle)
+{
+  if (map->packing == COGL_RECTANGLE_MAP_PACKING_SKYLINE)
+    _cogl_rectangle_map_skyline_remove (map, rectangle);
+  else
+    _cogl_rectangle_map_tree_remove (map, rectangle);
 
 #ifdef COGL_ENABLE_DEBUG
   if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_DUMP_ATLAS_IMAGE)))
@@ -567,16 +962,99 @@ _cogl_rectangle_map_remove (CoglRectangleMap *map,
 #endif
 }
 
+static void
+_cogl_rectangle_map_tree_grow (CoglRectangleMap *map,
+                               unsigned int width,
+                               unsigned int height)
+{
+  CoglRectangleMapNode *old_root = map->root;
+  CoglRectangleMapNode *root = _cogl_rectangle_map_node_new ();
+  CoglRectangleMapNode *node, *parent;
+
+  root->type = COGL_RECTANGLE_MAP_EMPTY_LEAF;
+  root->parent = NULL;
+  root->rectangle.x = 0;
+  root->rectangle.y = 0;
+  root->rectangle.width = width;
+  root->rectangle.height = height;
+  root->largest_gap = width * height;
+
+  /* Split the new root so that one leaf covers exactly the old map
+     and then put the old tree in its place */
+  node = _cogl_rectangle_map_node_split_horizontally (root,
+                                                      map->width);
+  node = _cogl_rectangle_map_node_split_vertically (node, map->height);
+
+  parent = node->parent;
+  if (parent->d.branch.left == node)
+    parent->d.branch.left = old_root;
+  else
+    parent->d.branch.right = old_root;
+  old_root->parent = parent;
+  _cogl_rectangle_map_node_free (node);
+
+  for (node = parent; node; node = node->parent)
+    node->largest_gap = MAX (node->d.branch.left->largest_gap,
+                             node->d.branch.right->largest_gap);
+
+  map->root = root;
+}
+
+static void
+_cogl_rectangle_map_skyline_grow (CoglRectangleMap *map,
+                                  unsigned int width,
+                                  unsigned int height)
+{
+  CoglRectangleMapSegment segment;
+
+  /* The segments already extend to the bottom of the map so only the
+     new columns need a segment */
+  if (width > map->width)
+    {
+      segment.x = map->width;
+      segment.y = 0;
+      segment.width = width - map->width;
+      g_array_append_val (map->skyline, segment);
+      _cogl_rectangle_map_skyline_merge (map->skyline,
+                                         map->skyline->len - 1);
+    }
+}
+
+void
+_cogl_rectangle_map_grow (CoglRectangleMap *map,
+                          unsigned int width,
+                          unsigned int height)
+{
+  _COGL_RETURN_IF_FAIL (width >= map->width && height >= map->height);
+
+  if (width == map->width && height == map->height)
+    return;
+
+  if (map->packing == COGL_RECTANGLE_MAP_PACKING_SKYLINE)
+    _cogl_rectangle_map_skyline_grow (map, width, height);
+  else
+    _cogl_rectangle_map_tree_grow (map, width, height);
+
+  map->space_remaining += width * height - map->width * map->height;
+  map->width = width;
+  map->height = height;
+
+#ifdef COGL_ENABLE_DEBUG
+  if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_DUMP_ATLAS_IMAGE)))
+    _cogl_rectangle_map_verify (map);
+#endif
+}
+
 unsigned int
 _cogl_rectangle_map_get_width (CoglRectangleMap *map)
 {
-  return map->root->rectangle.width;
+  return map->width;
 }
 
 unsigned int
 _cogl_rectangle_map_get_height (CoglRectangleMap *map)
 {
-  return map->root->rectangle.height;
+  return map->height;
 }
 
 unsigned int
@@ -675,6 +1153,18 @@ _cogl_rectangle_map_foreach (CoglRectangleMap *map,
 {
   CoglRectangleMapForeachClosure closure;
 
+  if (map->packing == COGL_RECTANGLE_MAP_PACKING_SKYLINE)
+    {
+      GHashTableIter iter;
+      CoglRectangleMapSkylineEntry *entry;
+
+      g_hash_table_iter_init (&iter, map->skyline_rectangles);
+      while (g_hash_table_iter_next (&iter, (void **) &entry, NULL))
+        callback (&entry->rectangle, entry->data, data);
+
+      return;
+    }
+
   closure.callback = callback;
   closure.data = data;
 
@@ -697,9 +1187,25 @@ _cogl_rectangle_map_free_cb (CoglRectangleMapNode *node, void *data)
 void
 _cogl_rectangle_map_free (CoglRectangleMap *map)
 {
-  _cogl_rectangle_map_internal_foreach (map,
-                                        _cogl_rectangle_map_free_cb,
-                                        map);
+  if (map->packing == COGL_RECTANGLE_MAP_PACKING_SKYLINE)
+    {
+      GHashTableIter iter;
+      CoglRectangleMapSkylineEntry *entry;
+
+      if (map->value_destroy_func)
+        {
+          g_hash_table_iter_init (&iter, map->skyline_rectangles);
+          while (g_hash_table_iter_next (&iter, (void **) &entry, NULL))
+            map->value_destroy_func (entry->data);
+        }
+
+      g_hash_table_destroy (map->skyline_rectangles);
+      g_array_free (map->skyline, TRUE);
+    }
+  else
+    _cogl_rectangle_map_internal_foreach (map,
+                                          _cogl_rectangle_map_free_cb,
+                                          map);
 
   g_array_free (map->stack, TRUE);
 
@@ -708,6 +1214,31 @@ _cogl_rectangle_map_free (CoglRectangleMap *map)
 
 #if defined (COGL_ENABLE_DEBUG) && defined (HAVE_CAIRO)
 
+static void
+_cogl_rectangle_map_dump_rectangle (cairo_t *cr,
+                                    const CoglRectangleMapEntry *rectangle,
+                                    CoglBool filled)
+{
+  /* Fill the rectangle using a different colour depending on
+     whether the rectangle is used */
+  if (filled)
+    cairo_set_source_rgb (cr, 0.0, 0.0, 1.0);
+  else
+    cairo_set_source_rgb (cr, 0.0, 0.0, 0.0);
+
+  cairo_rectangle (cr,
+                   rectangle->x,
+                   rectangle->y,
+                   rectangle->width,
+                   rectangle->height);
+
+  cairo_fill_preserve (cr);
+
+  /* Draw a white outline around the rectangle */
+  cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+  cairo_stroke (cr);
+}
+
 static void
 _cogl_rectangle_map_dump_image_cb (CoglRectangleMapNode *node, void *data)
 {
@@ -715,26 +1246,18 @@ _cogl_rectangle_map_dump_image_cb (CoglRectangleMapNode *node, void *data)
 
   if (node->type == COGL_RECTANGLE_MAP_FILLED_LEAF ||
       node->type == COGL_RECTANGLE_MAP_EMPTY_LEAF)
-    {
-      /* Fill the rectangle using a different colour depending on
-         whether the rectangle is used */
-      if (node->type == COGL_RECTANGLE_MAP_FILLED_LEAF)
-        cairo_set_source_rgb (cr, 0.0, 0.0, 1.0);
-      else
-        cairo_set_source_rgb (cr, 0.0, 0.0, 0.0);
-
-      cairo_rectangle (cr,
-                       node->rectangle.x,
-                       node->rectangle.y,
-                       node->rectangle.width,
-                       node->rectangle.height);
-
-      cairo_fill_preserve (cr);
+    _cogl_rectangle_map_dump_rectangle (cr,
+                                        &node->rectangle,
+                                        node->type ==
+                                        COGL_RECTANGLE_MAP_FILLED_LEAF);
+}
 
-      /* Draw a white outline around the rectangle */
-      cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
-      cairo_stroke (cr);
-    }
+static void
+_cogl_rectangle_map_dump_skyline_cb (const CoglRectangleMapEntry *rectangle,
+                                     void *rectangle_data,
+                                     void *user_data)
+{
+  _cogl_rectangle_map_dump_rectangle (user_data, rectangle, TRUE);
 }
 
 static void
@@ -750,9 +1273,16 @@ _cogl_rectangle_map_dump_image (CoglRectangleMap *map)
                                 _cogl_rectangle_map_get_height (map));
   cairo_t *cr = cairo_create (surface);
 
-  _cogl_rectangle_map_internal_foreach (map,
-                                        _cogl_rectangle_map_dump_image_cb,
-                                        cr);
+  /* The skyline doesn't keep track of the empty space so that is just
+     left black */
+  if (map->packing == COGL_RECTANGLE_MAP_PACKING_SKYLINE)
+    _cogl_rectangle_map_foreach (map,
+                                 _cogl_rectangle_map_dump_skyline_cb,
+                                 cr);
+  else
+    _cogl_rectangle_map_internal_foreach (map,
+                                          _cogl_rectangle_map_dump_image_cb,
+                                          cr);
 
   cairo_destroy (cr);
 
@@ -762,3 +1292,159 @@ _cogl_rectangle_map_dump_image (CoglRectangleMap *map)
 }
 
 #endif /* COGL_ENABLE_DEBUG && HAVE_CAIRO */
+
+typedef struct
+{
+  CoglRectangleMapEntry rectangles[512];
+  int n_rectangles;
+} CheckRectanglesData;
+
+static void
+check_rectangles_cb (const CoglRectangleMapEntry *entry,
+                     void *rectangle_data,
+                     void *user_data)
+{
+  CheckRectanglesData *data = user_data;
+  const CoglRectangleMapEntry *expected = rectangle_data;
+
+  /* The data is the entry that was returned when it was added */
+  g_assert_cmpuint (entry->x, ==, expected->x);
+  g_assert_cmpuint (entry->y, ==, expected->y);
+  g_assert_cmpuint (entry->width, ==, expected->width);
+  g_assert_cmpuint (entry->height, ==, expected->height);
+
+  data->rectangles[data->n_rectangles++] = *entry;
+}
+
+static void
+check_rectangles (CoglRectangleMap *map,
+                  int n_rectangles)
+{
+  CheckRectanglesData data;
+  unsigned int used_space = 0;
+  int i, j;
+
+  data.n_rectangles = 0;
+  _cogl_rectangle_map_foreach (map, check_rectangles_cb, &data);
+
+  g_assert_cmpint (data.n_rectangles, ==, n_rectangles);
+  g_assert_cmpuint (_cogl_rectangle_map_get_n_rectangles (map),
+                    ==,
+                    n_rectangles);
+
+  for (i = 0; i < data.n_rectangles; i++)
+    {
+      const CoglRectangleMapEntry *a = data.rectangles + i;
+
+      g_assert_cmpuint (a->x + a->width, <=,
+                        _cogl_rectangle_map_get_width (map));
+      g_assert_cmpuint (a->y + a->height, <=,
+                        _cogl_rectangle_map_get_height (map));
+
+      for (j = 0; j < i; j++)
+        {
+          const CoglRectangleMapEntry *b = data.rectangles + j;
+
+          g_assert (a->x >= b->x + b->width ||
+                    b->x >= a->x + a->width ||
+                    a->y >= b->y + b->height ||
+                    b->y >= a->y + a->height);
+        }
+
+      used_space += a->width * a->height;
+    }
+
+  g_assert_cmpuint (_cogl_rectangle_map_get_remaining_space (map),
+                    ==,
+                    _cogl_rectangle_map_get_width (map) *
+                    _cogl_rectangle_map_get_height (map) -
+                    used_space);
+}
+
+UNIT_TEST (check_rectangle_map_packing,
+           0, /* no requirements */
+           0 /* no failure cases */)
+{
+  CoglRectangleMapPacking packing;
+
+  for (packing = COGL_RECTANGLE_MAP_PACKING_TREE;
+       packing <= COGL_RECTANGLE_MAP_PACKING_SKYLINE;
+       packing++)
+    {
+      /* Each rectangle's data points at the entry returned for it */
+      CoglRectangleMapEntry rectangles[512];
+      CoglRectangleMapEntry before_grow[512];
+      CoglBool removed[512];
+      CoglRectangleMap *map;
+      int n_rectangles = 0, n_live;
+      int i;
+
+      map = _cogl_rectangle_map_new_with_packing (64, 64, packing, NULL);
+
+      /* Fill the map with glyph-sized rectangles until one doesn't
+         fit */
+      while (n_rectangles < 256 &&
+             _cogl_rectangle_map_add (map,
+                                      (n_rectangles * 7) % 9 + 3,
+                                      (n_rectangles * 5) % 4 + 8,
+                                      rectangles + n_rectangles,
+                                      rectangles + n_rectangles))
+        removed[n_rectangles++] = FALSE;
+
+      g_assert_cmpint (n_rectangles, >, 0);
+      g_assert_cmpint (n_rectangles, <, 256);
+      n_live = n_rectangles;
+      check_rectangles (map, n_live);
+
+      /* Remove every third rectangle */
+      for (i = 0; i < n_rectangles; i += 3)
+        {
+          _cogl_rectangle_map_remove (map, rectangles + i);
+          removed[i] = TRUE;
+          n_live--;
+        }
+
+      check_rectangles (map, n_live);
+
+      /* Growing the map must keep every rectangle where it was */
+      memcpy (before_grow, rectangles, sizeof (rectangles));
+      _cogl_rectangle_map_grow (map, 128, 64);
+      _cogl_rectangle_map_grow (map, 128, 128);
+
+      check_rectangles (map, n_live);
+      for (i = 0; i < n_rectangles; i++)
+        g_assert (removed[i] ||
+                  !memcmp (before_grow + i, rectangles + i,
+                           sizeof (CoglRectangleMapEntry)));
+
+      /* and the new space must be usable */
+      g_assert (_cogl_rectangle_map_add (map, 64, 64,
+                                         rectangles + n_rectangles,
+                                         rectangles + n_rectangles));
+      removed[n_rectangles++] = FALSE;
+      n_live++;
+
+      while (n_rectangles < G_N_ELEMENTS (rectangles) &&
+             _cogl_rectangle_map_add (map,
+                                      (n_rectangles * 3) % 11 + 2,
+                                      (n_rectangles * 7) % 5 + 6,
+                                      rectangles + n_rectangles,
+                                      rectangles + n_rectangles))
+        {
+          removed[n_rectangles++] = FALSE;
+          n_live++;
+        }
+
+      check_rectangles (map, n_live);
+
+      /* Emptying the map must give all of the space back */
+      for (i = 0; i < n_rectangles; i++)
+        if (!removed[i])
+          _cogl_rectangle_map_remove (map, rectangles + i);
+
+      check_rectangles (map, 0);
+      g_assert (_cogl_rectangle_map_add (map, 128, 128, NULL, NULL));
+
+      _cogl_rectangle_map_free (map);
+    }
+}
@@ -45,11 +45,31 @@ struct _CoglRectangleMapEntry
   unsigned int width, height;
 };
 
+/* How the map places new rectangles. The tree splits the free space
+   recursively and can reuse any gap left by a removed rectangle. The
+   skyline only tracks the top edge of the placed rectangles so gaps
+   below it can't be reused, but it wastes much less space when most
+   rectangles have similar heights, as glyphs do */
+typedef enum
+{
+  COGL_RECTANGLE_MAP_PACKING_TREE,
+  COGL_RECTANGLE_MAP_PACKING_SKYLINE
+} CoglRectangleMapPacking;
+
 CoglRectangleMap *
 _cogl_rectangle_map_new (unsigned int width,
                          unsigned int height,
                          GDestroyNotify value_destroy_func);
 
+CoglRectangleMap *
+_cogl_rectangle_map_new_with_packing (unsigned int width,
+                                      unsigned int height,
+                                      CoglRectangleMapPacking packing,
+                                      GDestroyNotify value_destroy_func);
+
+CoglRectangleMapPacking
+_cogl_rectangle_map_get_packing (CoglRectangleMap *map);
+
 CoglBool
 _cogl_rectangle_map_add (CoglRectangleMap *map,
                          unsigned int width,
@@ -61,6 +81,15 @@ void
 _cogl_rectangle_map_remove (CoglRectangleMap *map,
                             const CoglRectangleMapEntry *rectangle);
 
+/* Enlarges the map to the given size, which must be at least the
+   current size in both directions. The rectangles already in the map
+   keep their positions and the new space is added to the right and
+   bottom */
+void
+_cogl_rectangle_map_grow (CoglRectangleMap *map,
+                          unsigned int width,
+                          unsigned int height);
+
 unsigned int
 _cogl_rectangle_map_get_width (CoglRectangleMap *map);
 
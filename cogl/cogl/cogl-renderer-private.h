@@ -72,6 +72,7 @@ struct _CoglRenderer
   CoglBool xlib_enable_event_retrieval;
   CoglBool xlib_want_reset_on_video_memory_purge;
   CoglBool xlib_enable_threaded_swap_wait;
+  CoglBool xlib_enable_threaded_present;
 #endif
 
   CoglDriver driver;
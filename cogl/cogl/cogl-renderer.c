@@ -296,6 +296,17 @@ cogl_xlib_renderer_set_threaded_swap_wait_enabled (CoglRenderer *renderer,
 
   renderer->xlib_enable_threaded_swap_wait = enable;
 }
+
+void
+cogl_xlib_renderer_set_threaded_present_enabled (CoglRenderer *renderer,
+                                                 CoglBool enable)
+{
+  _COGL_RETURN_IF_FAIL (cogl_is_renderer (renderer));
+  /* NB: Renderers are considered immutable once connected */
+  _COGL_RETURN_IF_FAIL (!renderer->connected);
+
+  renderer->xlib_enable_threaded_present = enable;
+}
 #endif /* COGL_HAS_XLIB_SUPPORT */
 
 CoglBool
@@ -33,6 +33,7 @@
 
 #include "cogl-context.h"
 #include "cogl-gl-header.h"
+#include "cogl-cache-stats.h"
 
 /* These aren't defined in the GLES headers */
 #ifndef GL_CLAMP_TO_BORDER
@@ -74,6 +75,10 @@ typedef struct _CoglSamplerCacheEntry
 CoglSamplerCache *
 _cogl_sampler_cache_new (CoglContext *context);
 
+void
+_cogl_sampler_cache_get_stats (CoglSamplerCache *cache,
+                               CoglCacheStats *stats);
+
 const CoglSamplerCacheEntry *
 _cogl_sampler_cache_get_default_entry (CoglSamplerCache *cache);
 
@@ -60,6 +60,10 @@ struct _CoglSamplerCache
   /* This is used for generated fake unique sampler object numbers
      when the sampler object extension is not supported */
   GLuint next_fake_sampler_object_number;
+
+  /* Lookups in hash_table_cogl that found or added an entry */
+  uint64_t n_hits;
+  uint64_t n_misses;
 };
 
 static CoglSamplerCacheWrapMode
@@ -185,6 +189,8 @@ _cogl_sampler_cache_new (CoglContext *context)
   cache->hash_table_cogl = g_hash_table_new (hash_sampler_state_cogl,
                                              sampler_state_equal_cogl);
   cache->next_fake_sampler_object_number = 1;
+  cache->n_hits = 0;
+  cache->n_misses = 0;
 
   return cache;
 }
@@ -262,11 +268,15 @@ _cogl_sampler_cache_get_entry_cogl (CoglSamplerCache *cache,
 
   entry = g_hash_table_lookup (cache->hash_table_cogl, key);
 
-  if (entry == NULL)
+  if (entry)
+    cache->n_hits++;
+  else
     {
       CoglSamplerCacheEntry canonical_key;
       CoglSamplerCacheEntry *gl_entry;
 
+      cache->n_misses++;
+
       entry = g_slice_dup (CoglSamplerCacheEntry, key);
 
       /* Get the sampler object number from the canonical GL version
@@ -327,6 +337,19 @@ _cogl_sampler_cache_update_filters (CoglSamplerCache *cache,
   return _cogl_sampler_cache_get_entry_cogl (cache, &key);
 }
 
+void
+_cogl_sampler_cache_get_stats (CoglSamplerCache *cache,
+                               CoglCacheStats *stats)
+{
+  unsigned int n_cogl = g_hash_table_size (cache->hash_table_cogl);
+  unsigned int n_gl = g_hash_table_size (cache->hash_table_gl);
+
+  stats->n_entries += n_cogl;
+  stats->bytes += (n_cogl + n_gl) * sizeof (CoglSamplerCacheEntry);
+  stats->hits += cache->n_hits;
+  stats->misses += cache->n_misses;
+}
+
 static void
 hash_table_free_gl_cb (void *key,
                        void *value,
@@ -476,5 +476,6 @@ cogl_sub_texture_vtable =
     _cogl_sub_texture_get_gl_format,
     _cogl_sub_texture_get_type,
     NULL, /* is_foreign */
-    NULL /* set_auto_mipmap */
+    NULL /* set_auto_mipmap */,
+    NULL /* set_memory_category */
   };
@@ -38,6 +38,7 @@
 #endif
 
 #include "cogl-debug.h"
+#include "cogl-profile.h"
 #include "cogl-private.h"
 #include "cogl-util.h"
 #include "cogl-bitmap.h"
@@ -57,6 +58,7 @@
 #include "cogl-error-private.h"
 #include "cogl-texture-gl-private.h"
 #include "cogl-gtype-private.h"
+#include "cogl-texture-memory.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -180,11 +182,15 @@ _cogl_texture_2d_sliced_allocate_waste_buffer (CoglTexture2DSliced *tex_2ds,
   return waste_buf;
 }
 
+/* The waste buffer is only allocated here, the first time an upload
+   actually reaches the waste of a slice, so that updates away from the
+   right and bottom edges of the texture don't need one. The caller
+   frees *waste_buf. */
 static CoglBool
 _cogl_texture_2d_sliced_set_waste (CoglTexture2DSliced *tex_2ds,
                                    CoglBitmap *source_bmp,
                                    CoglTexture2D *slice_tex,
-                                   uint8_t *waste_buf,
+                                   uint8_t **waste_buf_p,
                                    CoglSpan *x_span,
                                    CoglSpan *y_span,
                                    CoglSpanIter *x_iter,
@@ -218,6 +224,13 @@ _cogl_texture_2d_sliced_set_waste (CoglTexture2DSliced *tex_2ds,
       uint8_t *dst;
       unsigned int wy, wx;
       CoglBitmap *waste_bmp;
+      uint8_t *waste_buf;
+
+      if (*waste_buf_p == NULL)
+        *waste_buf_p =
+          _cogl_texture_2d_sliced_allocate_waste_buffer (tex_2ds,
+                                                         source_format);
+      waste_buf = *waste_buf_p;
 
       bmp_data = _cogl_bitmap_map (source_bmp, COGL_BUFFER_ACCESS_READ, 0, error);
       if (bmp_data == NULL)
@@ -350,13 +363,7 @@ _cogl_texture_2d_sliced_upload_bitmap (CoglTexture2DSliced *tex_2ds,
   CoglSpan *y_span;
   CoglTexture2D *slice_tex;
   int x, y;
-  uint8_t *waste_buf;
-  CoglPixelFormat bmp_format;
-
-  bmp_format = cogl_bitmap_get_format (bmp);
-
-  waste_buf = _cogl_texture_2d_sliced_allocate_waste_buffer (tex_2ds,
-                                                             bmp_format);
+  uint8_t *waste_buf = NULL;
 
   /* Iterate vertical slices */
   for (y = 0; y < tex_2ds->slice_y_spans->len; ++y)
@@ -409,7 +416,7 @@ _cogl_texture_2d_sliced_upload_bitmap (CoglTexture2DSliced *tex_2ds,
           if (!_cogl_texture_2d_sliced_set_waste (tex_2ds,
                                                   bmp,
                                                   slice_tex,
-                                                  waste_buf,
+                                                  &waste_buf,
                                                   x_span, y_span,
                                                   &x_iter, &y_iter,
                                                   0, /* src_x */
@@ -451,13 +458,14 @@ _cogl_texture_2d_sliced_upload_subregion (CoglTexture2DSliced *tex_2ds,
   int source_x = 0, source_y = 0;
   int inter_w = 0, inter_h = 0;
   int local_x = 0, local_y = 0;
-  uint8_t *waste_buf;
-  CoglPixelFormat source_format;
-
-  source_format = cogl_bitmap_get_format (source_bmp);
+  uint8_t *waste_buf = NULL;
+  int n_slices_updated = 0;
 
-  waste_buf =
-    _cogl_texture_2d_sliced_allocate_waste_buffer (tex_2ds, source_format);
+  COGL_STATIC_COUNTER (sliced_upload_slice_counter,
+                       "sliced texture slice updates counter",
+                       "Increments for each slice of a sliced texture "
+                       "touched by a sub-region upload",
+                       0 /* no application private data */);
 
   /* Iterate vertical spans */
   for (source_y = src_y,
@@ -511,6 +519,9 @@ _cogl_texture_2d_sliced_upload_subregion (CoglTexture2DSliced *tex_2ds,
           slice_tex = g_array_index (tex_2ds->slice_textures,
                                      CoglTexture2D *, slice_num);
 
+          COGL_COUNTER_INC (_cogl_uprof_context, sliced_upload_slice_counter);
+          n_slices_updated++;
+
           if (!_cogl_texture_set_region_from_bitmap (COGL_TEXTURE (slice_tex),
                                                      source_x,
                                                      source_y,
@@ -530,7 +541,7 @@ _cogl_texture_2d_sliced_upload_subregion (CoglTexture2DSliced *tex_2ds,
           if (!_cogl_texture_2d_sliced_set_waste (tex_2ds,
                                                   source_bmp,
                                                   slice_tex,
-                                                  waste_buf,
+                                                  &waste_buf,
                                                   x_span, y_span,
                                                   &x_iter, &y_iter,
                                                   src_x, src_y,
@@ -547,6 +558,12 @@ _cogl_texture_2d_sliced_upload_subregion (CoglTexture2DSliced *tex_2ds,
   if (waste_buf)
     free (waste_buf);
 
+  COGL_NOTE (SLICING,
+             "Updated %ix%i at (%i, %i) of %ix%i sliced texture %p "
+             "in %i of %i slices",
+             width, height, dst_x, dst_y, tex->width, tex->height, tex_2ds,
+             n_slices_updated, tex_2ds->slice_textures->len);
+
   return TRUE;
 }
 
@@ -894,6 +911,7 @@ allocate_slices (CoglTexture2DSliced *tex_2ds,
                                            x_span->size, y_span->size));
 
           _cogl_texture_copy_internal_format (tex, slice);
+          slice->memory_category = tex->memory_category;
 
           g_array_append_val (tex_2ds->slice_textures, slice);
           if (!cogl_texture_allocate (slice, error))
@@ -1520,6 +1538,25 @@ _cogl_texture_2d_sliced_get_type (CoglTexture *tex)
   return COGL_TEXTURE_TYPE_2D;
 }
 
+static void
+_cogl_texture_2d_sliced_set_memory_category (CoglTexture *tex,
+                                             const char *category)
+{
+  CoglTexture2DSliced *tex_2ds = COGL_TEXTURE_2D_SLICED (tex);
+  int i;
+
+  if (tex_2ds->slice_textures == NULL)
+    return;
+
+  for (i = 0; i < tex_2ds->slice_textures->len; i++)
+    {
+      CoglTexture *slice_tex =
+        g_array_index (tex_2ds->slice_textures, CoglTexture *, i);
+
+      cogl_texture_set_memory_category (slice_tex, category);
+    }
+}
+
 static const CoglTextureVtable
 cogl_texture_2d_sliced_vtable =
   {
@@ -1542,5 +1579,6 @@ cogl_texture_2d_sliced_vtable =
     _cogl_texture_2d_sliced_get_gl_format,
     _cogl_texture_2d_sliced_get_type,
     _cogl_texture_2d_sliced_is_foreign,
-    NULL /* set_auto_mipmap */
+    NULL /* set_auto_mipmap */,
+    _cogl_texture_2d_sliced_set_memory_category
   };
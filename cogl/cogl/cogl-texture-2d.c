@@ -577,6 +577,12 @@ _cogl_texture_2d_pre_paint (CoglTexture *tex, CoglTexturePrePaintFlags flags)
 {
   CoglTexture2D *tex_2d = COGL_TEXTURE_2D (tex);
 
+  /* Rendering to the texture that is still queued in the journal of
+   * an offscreen framebuffer has to land before the mipmaps are made
+   * from it */
+  if ((flags & COGL_TEXTURE_NEEDS_MIPMAP) && tex_2d->auto_mipmap)
+    _cogl_texture_flush_journal_rendering (tex);
+
   /* Only update if the mipmaps are dirty */
   if ((flags & COGL_TEXTURE_NEEDS_MIPMAP) &&
       tex_2d->auto_mipmap && tex_2d->mipmaps_dirty)
@@ -693,5 +699,6 @@ cogl_texture_2d_vtable =
     _cogl_texture_2d_get_gl_format,
     _cogl_texture_2d_get_type,
     _cogl_texture_2d_is_foreign,
-    _cogl_texture_2d_set_auto_mipmap
+    _cogl_texture_2d_set_auto_mipmap,
+    NULL /* set_memory_category */
   };
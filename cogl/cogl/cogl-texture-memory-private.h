@@ -0,0 +1,52 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __COGL_TEXTURE_MEMORY_PRIVATE_H
+#define __COGL_TEXTURE_MEMORY_PRIVATE_H
+
+#include "cogl-context.h"
+#include "cogl-texture.h"
+
+/* Adds @n_objects and @bytes, which may be negative, to @category */
+void
+_cogl_memory_account (CoglContext *ctx,
+                      const char *category,
+                      int n_objects,
+                      int64_t bytes);
+
+/* Re-estimates the memory taken by a primitive texture after it has
+ * been allocated or got mipmaps */
+void
+_cogl_texture_update_memory (CoglTexture *texture);
+
+/* Stops accounting for a texture that is being freed */
+void
+_cogl_texture_release_memory (CoglTexture *texture);
+
+void
+_cogl_texture_memory_free (CoglContext *ctx);
+
+#endif /* __COGL_TEXTURE_MEMORY_PRIVATE_H */
@@ -0,0 +1,197 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "cogl-config.h"
+#endif
+
+#include "cogl-context-private.h"
+#include "cogl-texture-private.h"
+#include "cogl-texture-memory.h"
+#include "cogl-texture-memory-private.h"
+
+typedef struct
+{
+  int n_objects;
+  size_t bytes;
+} CoglTextureMemory;
+
+void
+_cogl_memory_account (CoglContext *ctx,
+                      const char *category,
+                      int n_objects,
+                      int64_t bytes)
+{
+  CoglTextureMemory *memory;
+
+  if (category == NULL)
+    category = "other";
+
+  if (ctx->texture_memory == NULL)
+    ctx->texture_memory = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 NULL, g_free);
+
+  memory = g_hash_table_lookup (ctx->texture_memory, category);
+  if (memory == NULL)
+    {
+      memory = g_new0 (CoglTextureMemory, 1);
+      g_hash_table_insert (ctx->texture_memory, (char *) category, memory);
+    }
+
+  memory->n_objects += n_objects;
+  memory->bytes += bytes;
+
+  if (memory->n_objects <= 0)
+    g_hash_table_remove (ctx->texture_memory, category);
+}
+
+static size_t
+estimate_texture_memory (CoglTexture *texture)
+{
+  int width, height, depth;
+  size_t bpp, bytes;
+
+  _cogl_texture_get_level_size (texture, 0, &width, &height, &depth);
+
+  switch (texture->components)
+    {
+    case COGL_TEXTURE_COMPONENTS_A:
+      bpp = 1;
+      break;
+    case COGL_TEXTURE_COMPONENTS_RG:
+      bpp = 2;
+      break;
+    default:
+      /* Drivers pad RGB to 4 bytes too */
+      bpp = 4;
+      break;
+    }
+
+  bytes = (size_t) width * height * MAX (depth, 1) * bpp;
+
+  /* A full mipmap chain adds about a third */
+  if (texture->memory_mipmapped)
+    bytes += bytes / 3;
+
+  return bytes;
+}
+
+void
+_cogl_texture_update_memory (CoglTexture *texture)
+{
+  size_t bytes;
+
+  if (!texture->vtable->is_primitive)
+    return;
+
+  bytes = estimate_texture_memory (texture);
+
+  _cogl_memory_account (texture->context, texture->memory_category,
+                        texture->memory_bytes ? 0 : 1,
+                        (int64_t) bytes - (int64_t) texture->memory_bytes);
+
+  texture->memory_bytes = bytes;
+}
+
+void
+_cogl_texture_release_memory (CoglTexture *texture)
+{
+  if (texture->memory_bytes == 0)
+    return;
+
+  _cogl_memory_account (texture->context, texture->memory_category,
+                        -1, -(int64_t) texture->memory_bytes);
+
+  texture->memory_bytes = 0;
+}
+
+void
+cogl_texture_set_memory_category (CoglTexture *texture,
+                                  const char *category)
+{
+  size_t bytes;
+
+  _COGL_RETURN_IF_FAIL (cogl_is_texture (texture));
+
+  bytes = texture->memory_bytes;
+
+  if (category)
+    category = g_intern_string (category);
+
+  if (texture->memory_category == category)
+    return;
+
+  _cogl_texture_release_memory (texture);
+
+  texture->memory_category = category;
+
+  if (bytes)
+    {
+      _cogl_memory_account (texture->context, category, 1, bytes);
+      texture->memory_bytes = bytes;
+    }
+
+  if (texture->vtable->set_memory_category)
+    texture->vtable->set_memory_category (texture, category);
+}
+
+typedef struct
+{
+  CoglTextureMemoryCallback callback;
+  void *user_data;
+} ForeachState;
+
+static void
+foreach_cb (void *key,
+            void *value,
+            void *user_data)
+{
+  CoglTextureMemory *memory = value;
+  ForeachState *state = user_data;
+
+  state->callback (key, memory->n_objects, memory->bytes, state->user_data);
+}
+
+void
+cogl_context_foreach_texture_memory (CoglContext *context,
+                                     CoglTextureMemoryCallback callback,
+                                     void *user_data)
+{
+  ForeachState state = { callback, user_data };
+
+  if (context->texture_memory)
+    g_hash_table_foreach (context->texture_memory, foreach_cb, &state);
+}
+
+void
+_cogl_texture_memory_free (CoglContext *ctx)
+{
+  if (ctx->texture_memory)
+    {
+      g_hash_table_destroy (ctx->texture_memory);
+      ctx->texture_memory = NULL;
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(__COGL_H_INSIDE__) && !defined(COGL_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_TEXTURE_MEMORY_H__
+#define __COGL_TEXTURE_MEMORY_H__
+
+#include <cogl/cogl-types.h>
+#include <cogl/cogl-context.h>
+#include <cogl/cogl-texture.h>
+
+COGL_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-texture-memory
+ * @short_description: Functions for accounting GPU memory
+ *
+ * Cogl keeps an estimate of the GPU memory taken by each texture it
+ * allocates, from its size and internal format, plus the depth and
+ * stencil renderbuffers of offscreen framebuffers. The estimates are
+ * summed up by category, which applications can assign to textures
+ * with cogl_texture_set_memory_category().
+ *
+ * Textures that don't store their own data, such as sub-textures and
+ * atlas textures, don't count; the atlases they share do, under the
+ * "atlas" category, and the renderbuffers come under "renderbuffers".
+ * Textures without a category come under "other".
+ */
+
+/**
+ * cogl_texture_set_memory_category:
+ * @texture: A #CoglTexture
+ * @category: (allow-none): The category to account the memory of
+ *   @texture to, or %NULL for "other"
+ *
+ * Sets the category the memory of @texture is accounted to. For sliced
+ * and X11 pixmap textures this applies to the textures holding their
+ * data, including those created later on.
+ *
+ * Stability: Unstable
+ */
+void
+cogl_texture_set_memory_category (CoglTexture *texture,
+                                  const char *category);
+
+/**
+ * CoglTextureMemoryCallback:
+ * @category: The name of the category
+ * @n_objects: How many textures or renderbuffers are accounted to it
+ * @bytes: An estimate of the memory they take, in bytes
+ * @user_data: The private data passed to
+ *   cogl_context_foreach_texture_memory()
+ *
+ * The callback prototype used with cogl_context_foreach_texture_memory().
+ *
+ * Stability: Unstable
+ */
+typedef void (* CoglTextureMemoryCallback) (const char *category,
+                                            int n_objects,
+                                            size_t bytes,
+                                            void *user_data);
+
+/**
+ * cogl_context_foreach_texture_memory:
+ * @context: A #CoglContext
+ * @callback: (scope call): A #CoglTextureMemoryCallback
+ * @user_data: (closure): Private data passed to @callback
+ *
+ * Calls @callback for each category that currently has memory accounted
+ * to it, in no particular order.
+ *
+ * Stability: Unstable
+ */
+void
+cogl_context_foreach_texture_memory (CoglContext *context,
+                                     CoglTextureMemoryCallback callback,
+                                     void *user_data);
+
+COGL_END_DECLS
+
+#endif /* __COGL_TEXTURE_MEMORY_H__ */
@@ -149,6 +149,11 @@ struct _CoglTextureVtable
   /* Only needs to be implemented if is_primitive == TRUE */
   void (* set_auto_mipmap) (CoglTexture *texture,
                             CoglBool value);
+
+  /* Only needs to be implemented by textures whose data is held by
+     other textures they own */
+  void (* set_memory_category) (CoglTexture *texture,
+                                const char *category);
 };
 
 typedef enum _CoglTextureSoureType {
@@ -216,6 +221,15 @@ struct _CoglTexture
   CoglTextureComponents components;
   unsigned int premultiplied:1;
 
+  /* See cogl-texture-memory.c; only primitive textures have any
+   * memory_bytes */
+  unsigned int memory_mipmapped:1;
+  const char *memory_category;
+  size_t memory_bytes;
+
+  /* Uploads queued with cogl_texture_queue_region() */
+  unsigned int n_queued_uploads;
+
   const CoglTextureVtable *vtable;
 };
 
@@ -0,0 +1,47 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __COGL_TEXTURE_UPLOAD_PRIVATE_H
+#define __COGL_TEXTURE_UPLOAD_PRIVATE_H
+
+#include "cogl-context.h"
+#include "cogl-texture.h"
+
+/* Counts @bytes uploaded into a primitive texture, against its memory
+ * category and the budget of the frame */
+void
+_cogl_texture_account_upload (CoglTexture *texture,
+                              size_t bytes);
+
+/* Makes the uploads still queued for @texture, before it is updated
+ * or read back synchronously */
+void
+_cogl_texture_flush_queued_uploads (CoglTexture *texture);
+
+void
+_cogl_texture_uploads_free (CoglContext *ctx);
+
+#endif /* __COGL_TEXTURE_UPLOAD_PRIVATE_H */
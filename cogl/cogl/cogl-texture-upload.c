@@ -0,0 +1,676 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "cogl-config.h"
+#endif
+
+#include <string.h>
+
+#include "cogl-context-private.h"
+#include "cogl-object-private.h"
+#include "cogl-private.h"
+#include "cogl-bitmap-private.h"
+#include "cogl-buffer-private.h"
+#include "cogl-error-private.h"
+#include "cogl-pixel-buffer.h"
+#include "cogl-texture-private.h"
+#include "cogl-texture-upload.h"
+#include "cogl-texture-upload-private.h"
+
+/* Queued uploads are copied into the mapped pixel buffer at the head
+ * of a small ring, which is unmapped at the next flush so that the
+ * uploads can be made from it. A buffer goes back to the ring once
+ * every upload staged in it has been made; uploads too large for a
+ * buffer, or all of them without PBOs, are copied to client memory.
+ */
+#define STAGING_BUFFER_SIZE (4 * 1024 * 1024)
+#define STAGING_ALIGNMENT 16
+#define MAX_FREE_STAGING_BUFFERS 2
+
+/* About 1GB/s at 60 frames a second */
+#define DEFAULT_UPLOAD_BUDGET (16 * 1024 * 1024)
+
+typedef struct
+{
+  CoglBuffer *buffer;
+  /* Where new data goes while the buffer is the head of the ring */
+  uint8_t *map;
+  size_t used;
+  /* Uploads staged in the buffer that haven't been made yet */
+  int n_pending;
+} CoglUploadStaging;
+
+typedef struct
+{
+  CoglTexture *texture;
+  int dst_x;
+  int dst_y;
+  int width;
+  int height;
+  CoglPixelFormat format;
+  int rowstride;
+
+  CoglUploadPriority priority;
+  unsigned int deadline_frame;
+
+  /* Either in a staging buffer or in client memory */
+  CoglUploadStaging *staging;
+  size_t offset;
+  uint8_t *data;
+
+  CoglQueuedUploadCallback callback;
+  void *user_data;
+  CoglBool uploaded;
+
+  /* Raised to those of later uploads into the same texture when the
+   * queue is flushed, so that they don't overtake this one */
+  CoglUploadPriority effective_priority;
+  CoglBool due;
+} CoglQueuedUpload;
+
+typedef struct _CoglUploadQueue
+{
+  GQueue uploads;
+  /* The uploads taken off the queue by a flush in progress */
+  GQueue *flushing;
+  CoglBool dispatching;
+
+  CoglUploadStaging *staging;
+  GList *free_staging;
+
+  size_t budget;
+  unsigned int frame;
+} CoglUploadQueue;
+
+typedef struct
+{
+  unsigned int n_uploads;
+  uint64_t bytes;
+} CoglTextureUploads;
+
+void
+_cogl_texture_account_upload (CoglTexture *texture,
+                              size_t bytes)
+{
+  CoglContext *ctx = texture->context;
+  const char *category = texture->memory_category;
+  CoglTextureUploads *uploads;
+
+  if (category == NULL)
+    category = "other";
+
+  if (ctx->texture_uploads == NULL)
+    ctx->texture_uploads = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  NULL, g_free);
+
+  uploads = g_hash_table_lookup (ctx->texture_uploads, category);
+  if (uploads == NULL)
+    {
+      uploads = g_new0 (CoglTextureUploads, 1);
+      g_hash_table_insert (ctx->texture_uploads, (char *) category, uploads);
+    }
+
+  uploads->n_uploads++;
+  uploads->bytes += bytes;
+
+  ctx->upload_frame_bytes += bytes;
+}
+
+static CoglUploadQueue *
+get_upload_queue (CoglContext *ctx)
+{
+  if (ctx->upload_queue == NULL)
+    {
+      ctx->upload_queue = g_new0 (CoglUploadQueue, 1);
+      g_queue_init (&ctx->upload_queue->uploads);
+      ctx->upload_queue->budget = DEFAULT_UPLOAD_BUDGET;
+    }
+
+  return ctx->upload_queue;
+}
+
+static void
+free_staging (CoglUploadStaging *staging)
+{
+  if (staging->map)
+    cogl_buffer_unmap (staging->buffer);
+
+  cogl_object_unref (staging->buffer);
+  g_slice_free (CoglUploadStaging, staging);
+}
+
+static void
+recycle_staging (CoglUploadQueue *queue,
+                 CoglUploadStaging *staging)
+{
+  if (g_list_length (queue->free_staging) >= MAX_FREE_STAGING_BUFFERS)
+    {
+      free_staging (staging);
+      return;
+    }
+
+  staging->used = 0;
+  queue->free_staging = g_list_prepend (queue->free_staging, staging);
+}
+
+/* Stops staging data in the head of the ring so that the uploads
+ * staged in it can be made */
+static void
+close_staging (CoglUploadQueue *queue)
+{
+  CoglUploadStaging *staging = queue->staging;
+
+  if (staging == NULL)
+    return;
+
+  cogl_buffer_unmap (staging->buffer);
+  staging->map = NULL;
+  queue->staging = NULL;
+
+  if (staging->n_pending == 0)
+    recycle_staging (queue, staging);
+}
+
+static CoglUploadStaging *
+open_staging (CoglContext *ctx,
+              CoglUploadQueue *queue)
+{
+  CoglUploadStaging *staging;
+  CoglError *ignore_error = NULL;
+
+  if (queue->free_staging)
+    {
+      staging = queue->free_staging->data;
+      queue->free_staging = g_list_delete_link (queue->free_staging,
+                                                queue->free_staging);
+    }
+  else
+    {
+      staging = g_slice_new0 (CoglUploadStaging);
+      staging->buffer =
+        COGL_BUFFER (cogl_pixel_buffer_new (ctx, STAGING_BUFFER_SIZE, NULL));
+      cogl_buffer_set_update_hint (staging->buffer,
+                                   COGL_BUFFER_UPDATE_HINT_STREAM);
+    }
+
+  staging->map = _cogl_buffer_map (staging->buffer,
+                                   COGL_BUFFER_ACCESS_WRITE,
+                                   COGL_BUFFER_MAP_HINT_DISCARD,
+                                   &ignore_error);
+  if (staging->map == NULL)
+    {
+      cogl_error_free (ignore_error);
+      free_staging (staging);
+      return NULL;
+    }
+
+  queue->staging = staging;
+
+  return staging;
+}
+
+static uint8_t *
+stage_upload (CoglContext *ctx,
+              CoglUploadQueue *queue,
+              CoglQueuedUpload *upload)
+{
+  size_t size = (size_t) upload->rowstride * upload->height;
+  CoglUploadStaging *staging;
+
+  if (!_cogl_has_private_feature (ctx, COGL_PRIVATE_FEATURE_PBOS) ||
+      size > STAGING_BUFFER_SIZE)
+    {
+      upload->data = g_malloc (size);
+      return upload->data;
+    }
+
+  staging = queue->staging;
+  if (staging && staging->used + size > STAGING_BUFFER_SIZE)
+    {
+      close_staging (queue);
+      staging = NULL;
+    }
+
+  if (staging == NULL)
+    staging = open_staging (ctx, queue);
+
+  if (staging == NULL)
+    {
+      upload->data = g_malloc (size);
+      return upload->data;
+    }
+
+  upload->staging = staging;
+  upload->offset = staging->used;
+  staging->used += (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+  staging->n_pending++;
+
+  return staging->map + upload->offset;
+}
+
+CoglBool
+cogl_texture_queue_region (CoglTexture *texture,
+                           int dst_x,
+                           int dst_y,
+                           int width,
+                           int height,
+                           CoglPixelFormat format,
+                           int rowstride,
+                           const uint8_t *data,
+                           CoglUploadPriority priority,
+                           int deadline,
+                           CoglQueuedUploadCallback callback,
+                           void *user_data)
+{
+  CoglContext *ctx;
+  CoglUploadQueue *queue;
+  CoglQueuedUpload *upload;
+  uint8_t *dst;
+  int bpp;
+  int y;
+
+  _COGL_RETURN_VAL_IF_FAIL (cogl_is_texture (texture), FALSE);
+  _COGL_RETURN_VAL_IF_FAIL (format != COGL_PIXEL_FORMAT_ANY, FALSE);
+  _COGL_RETURN_VAL_IF_FAIL (width > 0 && height > 0, FALSE);
+
+  ctx = texture->context;
+  queue = get_upload_queue (ctx);
+
+  bpp = _cogl_pixel_format_get_bytes_per_pixel (format);
+  if (rowstride == 0)
+    rowstride = bpp * width;
+
+  upload = g_slice_new0 (CoglQueuedUpload);
+  upload->texture = cogl_object_ref (texture);
+  upload->dst_x = dst_x;
+  upload->dst_y = dst_y;
+  upload->width = width;
+  upload->height = height;
+  upload->format = format;
+  upload->rowstride = bpp * width;
+  upload->priority = priority;
+  upload->deadline_frame = deadline < 0 ? G_MAXUINT
+                                        : queue->frame + 1 + deadline;
+  upload->callback = callback;
+  upload->user_data = user_data;
+
+  /* The rows are packed on the way */
+  dst = stage_upload (ctx, queue, upload);
+  for (y = 0; y < height; y++)
+    memcpy (dst + y * upload->rowstride,
+            data + y * rowstride,
+            upload->rowstride);
+
+  texture->n_queued_uploads++;
+  g_queue_push_tail (&queue->uploads, upload);
+
+  return TRUE;
+}
+
+static size_t
+upload_size (CoglQueuedUpload *upload)
+{
+  return (size_t) upload->rowstride * upload->height;
+}
+
+/* Makes @upload, which has been taken off the queue; its callback
+ * is left to finish_uploads() */
+static void
+dispatch_upload (CoglContext *ctx,
+                 CoglUploadQueue *queue,
+                 CoglQueuedUpload *upload)
+{
+  CoglTexture *texture = upload->texture;
+  CoglBitmap *bitmap;
+  CoglError *ignore_error = NULL;
+
+  texture->n_queued_uploads--;
+
+  /* Nothing can show the texture but the queue */
+  if (COGL_OBJECT (texture)->ref_count > 1)
+    {
+      if (upload->staging)
+        bitmap = cogl_bitmap_new_from_buffer (upload->staging->buffer,
+                                              upload->format,
+                                              upload->width,
+                                              upload->height,
+                                              upload->rowstride,
+                                              upload->offset);
+      else
+        bitmap = cogl_bitmap_new_for_data (ctx,
+                                           upload->width,
+                                           upload->height,
+                                           upload->format,
+                                           upload->rowstride,
+                                           upload->data);
+
+      queue->dispatching = TRUE;
+      upload->uploaded =
+        _cogl_texture_set_region_from_bitmap (texture,
+                                              0, 0,
+                                              upload->width,
+                                              upload->height,
+                                              bitmap,
+                                              upload->dst_x,
+                                              upload->dst_y,
+                                              0, /* level */
+                                              &ignore_error);
+      queue->dispatching = FALSE;
+
+      if (!upload->uploaded)
+        cogl_error_free (ignore_error);
+
+      cogl_object_unref (bitmap);
+    }
+
+  if (upload->staging)
+    {
+      CoglUploadStaging *staging = upload->staging;
+
+      upload->staging = NULL;
+      if (--staging->n_pending == 0 && staging != queue->staging)
+        recycle_staging (queue, staging);
+    }
+
+  g_free (upload->data);
+  upload->data = NULL;
+}
+
+/* The callbacks are only called once the queue is consistent again,
+ * as they may queue or make uploads themselves */
+static void
+finish_uploads (GList *done)
+{
+  GList *l;
+
+  for (l = done; l; l = l->next)
+    {
+      CoglQueuedUpload *upload = l->data;
+
+      if (upload->callback)
+        upload->callback (upload->texture, upload->uploaded,
+                          upload->user_data);
+
+      cogl_object_unref (upload->texture);
+      g_slice_free (CoglQueuedUpload, upload);
+    }
+
+  g_list_free (done);
+}
+
+static GList *
+flush_texture_uploads (CoglContext *ctx,
+                       CoglUploadQueue *queue,
+                       GQueue *uploads,
+                       CoglTexture *texture,
+                       GList *done)
+{
+  GList *l, *next;
+
+  for (l = uploads->head; l && texture->n_queued_uploads > 0; l = next)
+    {
+      CoglQueuedUpload *upload = l->data;
+
+      next = l->next;
+
+      if (upload->texture != texture)
+        continue;
+
+      g_queue_delete_link (uploads, l);
+      dispatch_upload (ctx, queue, upload);
+      done = g_list_prepend (done, upload);
+    }
+
+  return done;
+}
+
+void
+_cogl_texture_flush_queued_uploads (CoglTexture *texture)
+{
+  CoglContext *ctx = texture->context;
+  CoglUploadQueue *queue = ctx->upload_queue;
+  GList *done = NULL;
+
+  if (texture->n_queued_uploads == 0 || queue->dispatching)
+    return;
+
+  close_staging (queue);
+
+  if (queue->flushing)
+    done = flush_texture_uploads (ctx, queue, queue->flushing, texture, done);
+  done = flush_texture_uploads (ctx, queue, &queue->uploads, texture, done);
+
+  finish_uploads (g_list_reverse (done));
+}
+
+/* Gives each upload the highest priority of those queued after it
+ * into the same texture, and makes it due when one of those is */
+static void
+propagate_priorities (CoglUploadQueue *queue,
+                      GQueue *uploads)
+{
+  GHashTable *textures = g_hash_table_new (NULL, NULL);
+  GList *l;
+
+  for (l = uploads->tail; l; l = l->prev)
+    {
+      CoglQueuedUpload *upload = l->data;
+      int later;
+
+      upload->due = (upload->priority == COGL_UPLOAD_PRIORITY_HIGH ||
+                     queue->frame >= upload->deadline_frame);
+      upload->effective_priority = upload->priority;
+
+      /* Stored shifted by one so that 0 means no later upload */
+      later = GPOINTER_TO_INT (g_hash_table_lookup (textures,
+                                                    upload->texture));
+      if (later)
+        {
+          upload->due |= (later & 0x100) != 0;
+          upload->effective_priority = MIN (upload->effective_priority,
+                                            (later & 0xff) - 1);
+        }
+
+      g_hash_table_insert (textures, upload->texture,
+                           GINT_TO_POINTER ((upload->effective_priority + 1) |
+                                            (upload->due ? 0x100 : 0)));
+    }
+
+  g_hash_table_destroy (textures);
+}
+
+CoglBool
+cogl_context_flush_uploads (CoglContext *context)
+{
+  CoglUploadQueue *queue = context->upload_queue;
+  GHashTable *deferred = NULL;
+  GList *done = NULL;
+  GQueue pending;
+  int priority;
+  GList *l, *next;
+
+  if (queue == NULL || g_queue_is_empty (&queue->uploads))
+    {
+      context->upload_frame_bytes = 0;
+      return FALSE;
+    }
+
+  queue->frame++;
+
+  close_staging (queue);
+
+  pending = queue->uploads;
+  g_queue_init (&queue->uploads);
+  queue->flushing = &pending;
+
+  propagate_priorities (queue, &pending);
+
+  for (priority = COGL_UPLOAD_PRIORITY_HIGH;
+       priority <= COGL_UPLOAD_PRIORITY_LOW;
+       priority++)
+    {
+      for (l = pending.head; l; l = next)
+        {
+          CoglQueuedUpload *upload = l->data;
+          size_t size = upload_size (upload);
+
+          next = l->next;
+
+          if (upload->due)
+            {
+              if (priority != COGL_UPLOAD_PRIORITY_HIGH)
+                continue;
+            }
+          else
+            {
+              if (upload->effective_priority != priority)
+                continue;
+
+              /* Later uploads into a texture wait for earlier ones */
+              if (deferred &&
+                  g_hash_table_contains (deferred, upload->texture))
+                continue;
+
+              /* Whatever the budget, something gets uploaded */
+              if (queue->budget > 0 &&
+                  context->upload_frame_bytes > 0 &&
+                  context->upload_frame_bytes + size > queue->budget)
+                {
+                  if (deferred == NULL)
+                    deferred = g_hash_table_new (NULL, NULL);
+                  g_hash_table_add (deferred, upload->texture);
+                  continue;
+                }
+            }
+
+          g_queue_delete_link (&pending, l);
+          dispatch_upload (context, queue, upload);
+          done = g_list_prepend (done, upload);
+        }
+    }
+
+  if (deferred)
+    g_hash_table_destroy (deferred);
+
+  /* What was queued meanwhile goes after what is left */
+  queue->flushing = NULL;
+  while (!g_queue_is_empty (&queue->uploads))
+    g_queue_push_tail (&pending, g_queue_pop_head (&queue->uploads));
+  queue->uploads = pending;
+
+  context->upload_frame_bytes = 0;
+
+  finish_uploads (g_list_reverse (done));
+
+  return !g_queue_is_empty (&queue->uploads);
+}
+
+void
+cogl_context_set_upload_budget (CoglContext *context,
+                                size_t bytes)
+{
+  _COGL_RETURN_IF_FAIL (cogl_is_context (context));
+
+  get_upload_queue (context)->budget = bytes;
+}
+
+typedef struct
+{
+  CoglTextureUploadsCallback callback;
+  void *user_data;
+} ForeachState;
+
+static void
+foreach_cb (void *key,
+            void *value,
+            void *user_data)
+{
+  CoglTextureUploads *uploads = value;
+  ForeachState *state = user_data;
+
+  state->callback (key, uploads->n_uploads, uploads->bytes,
+                   state->user_data);
+}
+
+void
+cogl_context_foreach_texture_uploads (CoglContext *context,
+                                      CoglTextureUploadsCallback callback,
+                                      void *user_data)
+{
+  ForeachState state = { callback, user_data };
+
+  if (context->texture_uploads)
+    g_hash_table_foreach (context->texture_uploads, foreach_cb, &state);
+}
+
+void
+_cogl_texture_uploads_free (CoglContext *ctx)
+{
+  CoglUploadQueue *queue = ctx->upload_queue;
+
+  if (queue)
+    {
+      CoglQueuedUpload *upload;
+      GList *done = NULL;
+
+      /* The uploads are dropped rather than made */
+      while ((upload = g_queue_pop_head (&queue->uploads)))
+        {
+          CoglUploadStaging *staging = upload->staging;
+
+          upload->texture->n_queued_uploads--;
+
+          if (staging &&
+              --staging->n_pending == 0 &&
+              staging != queue->staging)
+            free_staging (staging);
+          g_free (upload->data);
+          upload->uploaded = FALSE;
+
+          done = g_list_prepend (done, upload);
+        }
+
+      finish_uploads (g_list_reverse (done));
+
+      if (queue->staging)
+        {
+          free_staging (queue->staging);
+          queue->staging = NULL;
+        }
+
+      g_list_free_full (queue->free_staging, (GDestroyNotify) free_staging);
+
+      g_free (queue);
+      ctx->upload_queue = NULL;
+    }
+
+  if (ctx->texture_uploads)
+    {
+      g_hash_table_destroy (ctx->texture_uploads);
+      ctx->texture_uploads = NULL;
+    }
+}
@@ -0,0 +1,209 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(__COGL_H_INSIDE__) && !defined(COGL_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_TEXTURE_UPLOAD_H__
+#define __COGL_TEXTURE_UPLOAD_H__
+
+#include <cogl/cogl-types.h>
+#include <cogl/cogl-context.h>
+#include <cogl/cogl-texture.h>
+
+COGL_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-texture-upload
+ * @short_description: Functions for scheduling texture uploads
+ *
+ * Cogl counts the data uploaded into each texture that holds its own
+ * storage, by the category its memory is accounted to (see
+ * cogl_texture_set_memory_category()), whether it comes from
+ * cogl_texture_set_region(), from creating a texture with data or
+ * from updating an X11 pixmap texture.
+ *
+ * Uploads that needn't show up in the very next frame can be queued
+ * with cogl_texture_queue_region() instead. The data is copied into a
+ * staging pixel buffer straight away, and the queued uploads are made
+ * when the application calls cogl_context_flush_uploads(), once per
+ * frame, as far as a byte budget for the frame allows. Data uploaded
+ * synchronously in a frame counts against the budget too, so queued
+ * uploads give way to a burst of those.
+ */
+
+/**
+ * CoglUploadPriority:
+ * @COGL_UPLOAD_PRIORITY_HIGH: Upload on the next
+ *   cogl_context_flush_uploads(), whatever the budget
+ * @COGL_UPLOAD_PRIORITY_NORMAL: Upload as soon as the budget allows
+ * @COGL_UPLOAD_PRIORITY_LOW: Upload once the budget is left over by
+ *   the uploads of higher priorities
+ *
+ * The priorities of queued texture uploads.
+ *
+ * Stability: Unstable
+ */
+typedef enum
+{
+  COGL_UPLOAD_PRIORITY_HIGH,
+  COGL_UPLOAD_PRIORITY_NORMAL,
+  COGL_UPLOAD_PRIORITY_LOW
+} CoglUploadPriority;
+
+/**
+ * CoglQueuedUploadCallback:
+ * @texture: The #CoglTexture the upload was queued for
+ * @uploaded: Whether the data was uploaded; it isn't when nothing
+ *   else holds a reference on @texture any more, or the upload failed
+ * @user_data: The private data passed to cogl_texture_queue_region()
+ *
+ * The callback prototype used with cogl_texture_queue_region(), for
+ * example to redraw what shows @texture.
+ *
+ * Stability: Unstable
+ */
+typedef void (* CoglQueuedUploadCallback) (CoglTexture *texture,
+                                           CoglBool uploaded,
+                                           void *user_data);
+
+/**
+ * cogl_texture_queue_region:
+ * @texture: The #CoglTexture to update
+ * @dst_x: The x coordinate of the region to update in @texture
+ * @dst_y: The y coordinate of the region to update in @texture
+ * @width: The width of the region
+ * @height: The height of the region
+ * @format: The #CoglPixelFormat of @data
+ * @rowstride: The length of each row of @data in bytes, or 0 to
+ *   infer it from @width and @format
+ * @data: The pixels to upload
+ * @priority: A #CoglUploadPriority
+ * @deadline: The number of frames the upload may be put off by when
+ *   over the budget, or -1 to wait as long as it takes
+ * @callback: (allow-none): A #CoglQueuedUploadCallback to call once
+ *   the upload has been made or dropped
+ * @user_data: (closure): Private data passed to @callback
+ *
+ * Like cogl_texture_set_region(), but the upload is queued and made
+ * by cogl_context_flush_uploads(). @data is copied before this
+ * function returns; until the upload is made, @texture keeps its
+ * previous contents.
+ *
+ * The uploads into the same texture are made in the order they were
+ * queued, and before any made into it with cogl_texture_set_region()
+ * or read back with cogl_texture_get_data() later on.
+ *
+ * Return value: %TRUE if the upload was queued
+ *
+ * Stability: Unstable
+ */
+CoglBool
+cogl_texture_queue_region (CoglTexture *texture,
+                           int dst_x,
+                           int dst_y,
+                           int width,
+                           int height,
+                           CoglPixelFormat format,
+                           int rowstride,
+                           const uint8_t *data,
+                           CoglUploadPriority priority,
+                           int deadline,
+                           CoglQueuedUploadCallback callback,
+                           void *user_data);
+
+/**
+ * cogl_context_set_upload_budget:
+ * @context: A #CoglContext
+ * @bytes: The number of bytes that may be uploaded in a frame, or 0
+ *   for no limit
+ *
+ * Sets how much data cogl_context_flush_uploads() uploads from the
+ * queue in a frame, including what has been uploaded synchronously
+ * since it was last called. A queued upload larger than the budget
+ * is made on its own in a frame.
+ *
+ * Stability: Unstable
+ */
+void
+cogl_context_set_upload_budget (CoglContext *context,
+                                size_t bytes);
+
+/**
+ * cogl_context_flush_uploads:
+ * @context: A #CoglContext
+ *
+ * Makes the uploads queued with cogl_texture_queue_region() that are
+ * due or fit in the budget of the frame, and starts a new frame. This
+ * should be called once per frame, before painting.
+ *
+ * Return value: %TRUE if uploads are still queued, so another frame
+ *   should follow
+ *
+ * Stability: Unstable
+ */
+CoglBool
+cogl_context_flush_uploads (CoglContext *context);
+
+/**
+ * CoglTextureUploadsCallback:
+ * @category: The name of the category
+ * @n_uploads: How many uploads went into textures of the category
+ * @bytes: How much data they uploaded, in bytes
+ * @user_data: The private data passed to
+ *   cogl_context_foreach_texture_uploads()
+ *
+ * The callback prototype used with
+ * cogl_context_foreach_texture_uploads().
+ *
+ * Stability: Unstable
+ */
+typedef void (* CoglTextureUploadsCallback) (const char *category,
+                                             unsigned int n_uploads,
+                                             uint64_t bytes,
+                                             void *user_data);
+
+/**
+ * cogl_context_foreach_texture_uploads:
+ * @context: A #CoglContext
+ * @callback: (scope call): A #CoglTextureUploadsCallback
+ * @user_data: (closure): Private data passed to @callback
+ *
+ * Calls @callback for each memory category that textures have been
+ * uploaded into since @context was created, in no particular order.
+ * Uploads into textures without a category come under "other".
+ *
+ * Stability: Unstable
+ */
+void
+cogl_context_foreach_texture_uploads (CoglContext *context,
+                                      CoglTextureUploadsCallback callback,
+                                      void *user_data);
+
+COGL_END_DECLS
+
+#endif /* __COGL_TEXTURE_UPLOAD_H__ */
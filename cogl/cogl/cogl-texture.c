@@ -64,6 +64,8 @@
 #include "cogl-primitive-texture.h"
 #include "cogl-error-private.h"
 #include "cogl-gtype-private.h"
+#include "cogl-texture-memory-private.h"
+#include "cogl-texture-upload-private.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -128,6 +130,10 @@ _cogl_texture_init (CoglTexture *texture,
   texture->allocated = FALSE;
   texture->vtable = vtable;
   texture->framebuffers = NULL;
+  texture->memory_mipmapped = FALSE;
+  texture->memory_category = NULL;
+  texture->memory_bytes = 0;
+  texture->n_queued_uploads = 0;
 
   texture->loader = loader;
 
@@ -182,6 +188,8 @@ _cogl_texture_free (CoglTexture *texture)
 {
   _cogl_texture_free_loader (texture);
 
+  _cogl_texture_release_memory (texture);
+
   free (texture);
 }
 
@@ -380,6 +388,8 @@ _cogl_texture_set_region_from_bitmap (CoglTexture *texture,
                                       int level,
                                       CoglError **error)
 {
+  int bpp;
+
   _COGL_RETURN_VAL_IF_FAIL ((cogl_bitmap_get_width (bmp) - src_x)
                             >= width, FALSE);
   _COGL_RETURN_VAL_IF_FAIL ((cogl_bitmap_get_height (bmp) - src_y)
@@ -391,6 +401,9 @@ _cogl_texture_set_region_from_bitmap (CoglTexture *texture,
   if (!cogl_texture_allocate (texture, error))
     return FALSE;
 
+  /* Uploads queued earlier go first */
+  _cogl_texture_flush_queued_uploads (texture);
+
   /* Note that we don't prepare the bitmap for upload here because
      some backends may be internally using a different format for the
      actual GL texture than that reported by
@@ -398,13 +411,25 @@ _cogl_texture_set_region_from_bitmap (CoglTexture *texture,
      always stored in an RGBA texture even if the texture format is
      advertised as RGB. */
 
-  return texture->vtable->set_region (texture,
-                                      src_x, src_y,
-                                      dst_x, dst_y,
-                                      width, height,
-                                      level,
-                                      bmp,
-                                      error);
+  if (!texture->vtable->set_region (texture,
+                                    src_x, src_y,
+                                    dst_x, dst_y,
+                                    width, height,
+                                    level,
+                                    bmp,
+                                    error))
+    return FALSE;
+
+  /* Only what reaches the textures holding the data is counted,
+     rather than also each atlas, sub- or sliced texture on the way */
+  if (texture->vtable->is_primitive)
+    {
+      bpp =
+        _cogl_pixel_format_get_bytes_per_pixel (cogl_bitmap_get_format (bmp));
+      _cogl_texture_account_upload (texture, (size_t) width * height * bpp);
+    }
+
+  return TRUE;
 }
 
 CoglBool
@@ -759,6 +784,8 @@ cogl_texture_get_data (CoglTexture *texture,
 
   CoglTextureGetData tg_data;
 
+  _cogl_texture_flush_queued_uploads (texture);
+
   texture_format = _cogl_texture_get_format (texture);
 
   /* Default to internal format if none specified */
@@ -1089,12 +1116,16 @@ _cogl_texture_set_allocated (CoglTexture *texture,
   texture->allocated = TRUE;
 
   _cogl_texture_free_loader (texture);
+
+  _cogl_texture_update_memory (texture);
 }
 
 CoglBool
 cogl_texture_allocate (CoglTexture *texture,
                        CoglError **error)
 {
+  size_t upload_bytes = 0;
+
   if (texture->allocated)
     return TRUE;
 
@@ -1106,8 +1137,24 @@ cogl_texture_allocate (CoglTexture *texture,
                      "A red-green texture was requested but the driver "
                      "does not support them");
 
+  /* The loader is gone once the texture is allocated */
+  if (texture->vtable->is_primitive &&
+      texture->loader &&
+      texture->loader->src_type == COGL_TEXTURE_SOURCE_TYPE_BITMAP)
+    {
+      CoglBitmap *bitmap = texture->loader->src.bitmap.bitmap;
+      CoglPixelFormat format = cogl_bitmap_get_format (bitmap);
+
+      upload_bytes = ((size_t) cogl_bitmap_get_width (bitmap) *
+                      cogl_bitmap_get_height (bitmap) *
+                      _cogl_pixel_format_get_bytes_per_pixel (format));
+    }
+
   texture->allocated = texture->vtable->allocate (texture, error);
 
+  if (texture->allocated && upload_bytes)
+    _cogl_texture_account_upload (texture, upload_bytes);
+
   return texture->allocated;
 }
 
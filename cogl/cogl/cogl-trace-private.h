@@ -0,0 +1,49 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __COGL_TRACE_PRIVATE_H
+#define __COGL_TRACE_PRIVATE_H
+
+/* Static tracepoints for perf, bpftrace or systemtap, in the "cogl"
+ * provider. A probe is a single nop that the tracer patches while
+ * attached, so they are always built when <sys/sdt.h> is available.
+ * The arguments are still evaluated, so keep them cheap. */
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define COGL_TRACE(probe) DTRACE_PROBE (cogl, probe)
+#define COGL_TRACE1(probe, a) DTRACE_PROBE1 (cogl, probe, a)
+
+#else
+
+#define COGL_TRACE(probe) G_STMT_START{ (void)0; }G_STMT_END
+#define COGL_TRACE1(probe, a) G_STMT_START{ (void)0; }G_STMT_END
+
+#endif
+
+#endif /* __COGL_TRACE_PRIVATE_H */
@@ -806,6 +806,10 @@ typedef enum _CoglWinsysFeature
   /* Avaiable if the winsys directly handles _SYNC and _COMPLETE events */
   COGL_WINSYS_FEATURE_SYNC_AND_COMPLETE_EVENT,
 
+  /* Available if the region that will be redrawn can be given to the
+   * driver before drawing a frame */
+  COGL_WINSYS_FEATURE_PARTIAL_UPDATE,
+
   COGL_WINSYS_FEATURE_N_FEATURES
 } CoglWinsysFeature;
 
@@ -869,13 +873,19 @@ typedef enum {
 /**
  * CoglReadPixelsFlags:
  * @COGL_READ_PIXELS_COLOR_BUFFER: Read from the color buffer
+ * @COGL_READ_PIXELS_NO_FLIP: Leave the rows in the order GL gives
+ *   them instead of flipping them to compensate for GL's upside-down
+ *   coordinate system. For an onscreen framebuffer that means bottom
+ *   to top; offscreen framebuffers are always read top to bottom. This
+ *   lets a read into a pixel buffer complete without mapping it.
  *
  * Flags for cogl_framebuffer_read_pixels_into_bitmap()
  *
  * Since: 1.0
  */
 typedef enum { /*< prefix=COGL_READ_PIXELS >*/
-  COGL_READ_PIXELS_COLOR_BUFFER = 1L << 0
+  COGL_READ_PIXELS_COLOR_BUFFER = 1L << 0,
+  COGL_READ_PIXELS_NO_FLIP      = 1L << 30
 } CoglReadPixelsFlags;
 
 /**
@@ -197,6 +197,28 @@ void
 cogl_xlib_renderer_set_threaded_swap_wait_enabled (CoglRenderer *renderer,
 						   CoglBool enable);
 
+/**
+ * cogl_xlib_renderer_set_threaded_present_enabled: (skip)
+ * @renderer: a #CoglRenderer
+ * @enable: The new value
+ *
+ * Sets whether Cogl should also move the glXSwapBuffers() call itself
+ * onto the thread used for the threaded swap wait. This only has an
+ * effect when the threaded swap wait is enabled and in use; see
+ * cogl_xlib_renderer_set_threaded_swap_wait_enabled().
+ *
+ * Some drivers block in glXSwapBuffers() once they have as many frames
+ * queued as they allow. With this enabled that time is spent on the
+ * swap thread instead, so the main loop keeps handling events. Drawing
+ * to the #CoglOnscreen again waits until the previous swap has been
+ * issued.
+ *
+ * Stability: unstable
+ */
+void
+cogl_xlib_renderer_set_threaded_present_enabled (CoglRenderer *renderer,
+                                                 CoglBool enable);
+
 /**
  * cogl_xlib_renderer_get_display: (skip)
  */
@@ -127,6 +127,10 @@
 #include <cogl/cogl-frame-info.h>
 #include <cogl/cogl-poll.h>
 #include <cogl/cogl-fence.h>
+#include <cogl/cogl-gpu-timer.h>
+#include <cogl/cogl-texture-memory.h>
+#include <cogl/cogl-texture-upload.h>
+#include <cogl/cogl-cache-stats.h>
 #include <cogl/cogl-glib-source.h>
 /* XXX: This will definitly go away once all the Clutter winsys
  * code has been migrated down into Cogl! */
@@ -38,6 +38,7 @@
 #include "cogl-framebuffer.h"
 #include "cogl-attribute.h"
 #include "cogl-attribute-private.h"
+#include "cogl-gl-header.h"
 
 void
 _cogl_gl_flush_attributes_state (CoglFramebuffer *framebuffer,
@@ -50,4 +51,13 @@ _cogl_gl_flush_attributes_state (CoglFramebuffer *framebuffer,
 void
 _cogl_gl_disable_all_attributes (CoglContext *ctx);
 
+/* Drops the cached vertex array objects pointing into @gl_handle,
+ * which is about to be deleted */
+void
+_cogl_gl_forget_vertex_arrays_for_buffer (CoglContext *ctx,
+                                          GLuint gl_handle);
+
+void
+_cogl_gl_free_vertex_array_cache (CoglContext *ctx);
+
 #endif /* _COGL_ATTRIBUTE_GL_PRIVATE_H_ */
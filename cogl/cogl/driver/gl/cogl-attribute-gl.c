@@ -39,6 +39,7 @@
 #include <string.h>
 
 #include "cogl-private.h"
+#include "cogl-util.h"
 #include "cogl-util-gl-private.h"
 #include "cogl-pipeline-opengl-private.h"
 #include "cogl-error-private.h"
@@ -49,6 +50,38 @@
 #include "cogl-pipeline-progend-glsl-private.h"
 #include "cogl-buffer-gl-private.h"
 
+/* Vertex array objects are only cached for draws with at most this
+ * many attributes, and the cache is emptied when it grows past
+ * COGL_VERTEX_ARRAY_CACHE_SIZE entries */
+#define COGL_VERTEX_ARRAY_MAX_ATTRIBUTES 16
+#define COGL_VERTEX_ARRAY_CACHE_SIZE 256
+
+/* One buffered attribute as a vertex array object records it */
+typedef struct
+{
+  GLuint buffer;
+  int location;
+  int n_components;
+  GLenum type;
+  CoglBool normalized;
+  int stride;
+  size_t offset;
+} CoglVertexArrayAttribute;
+
+typedef struct
+{
+  unsigned int hash;
+  int n_attributes;
+  CoglVertexArrayAttribute attributes[COGL_VERTEX_ARRAY_MAX_ATTRIBUTES];
+} CoglVertexArrayKey;
+
+typedef struct
+{
+  CoglContext *context;
+  GLuint vertex_array;
+  CoglVertexArrayKey key;
+} CoglVertexArray;
+
 typedef struct _ForeachChangedBitState
 {
   CoglContext *context;
@@ -159,8 +192,222 @@ foreach_changed_bit_and_save (CoglContext *context,
   _cogl_bitmask_set_bits (current_bits, new_bits);
 }
 
+static void
+bind_vertex_array (CoglContext *ctx,
+                   GLuint vertex_array)
+{
+  if (ctx->current_vertex_array == vertex_array)
+    return;
+
+  GE (ctx, glBindVertexArray (vertex_array));
+  ctx->current_vertex_array = vertex_array;
+}
+
+static unsigned int
+vertex_array_key_hash (const void *data)
+{
+  const CoglVertexArrayKey *key = data;
+
+  return key->hash;
+}
+
+static gboolean
+vertex_array_key_equal (const void *a,
+                        const void *b)
+{
+  const CoglVertexArrayKey *key_a = a;
+  const CoglVertexArrayKey *key_b = b;
+
+  return (key_a->hash == key_b->hash &&
+          key_a->n_attributes == key_b->n_attributes &&
+          memcmp (key_a->attributes, key_b->attributes,
+                  key_a->n_attributes *
+                  sizeof (CoglVertexArrayAttribute)) == 0);
+}
+
+static void
+vertex_array_free (CoglVertexArray *vertex_array)
+{
+  CoglContext *ctx = vertex_array->context;
+
+  /* Deleting the bound vertex array would leave us drawing with
+   * none at all */
+  if (ctx->current_vertex_array == vertex_array->vertex_array)
+    bind_vertex_array (ctx, ctx->default_vertex_array);
+
+  GE (ctx, glDeleteVertexArrays (1, &vertex_array->vertex_array));
+  g_slice_free (CoglVertexArray, vertex_array);
+}
+
+static gboolean
+vertex_array_uses_buffer (void *key,
+                          void *value,
+                          void *user_data)
+{
+  CoglVertexArray *vertex_array = value;
+  GLuint gl_handle = GPOINTER_TO_UINT (user_data);
+  int i;
+
+  for (i = 0; i < vertex_array->key.n_attributes; i++)
+    if (vertex_array->key.attributes[i].buffer == gl_handle)
+      return TRUE;
+
+  return FALSE;
+}
+
+void
+_cogl_gl_forget_vertex_arrays_for_buffer (CoglContext *ctx,
+                                          GLuint gl_handle)
+{
+  /* A vertex array object keeps a deleted buffer alive, and the
+   * buffer's name may then be given to a new one */
+  if (ctx->vertex_array_cache)
+    g_hash_table_foreach_remove (ctx->vertex_array_cache,
+                                 vertex_array_uses_buffer,
+                                 GUINT_TO_POINTER (gl_handle));
+}
+
+void
+_cogl_gl_free_vertex_array_cache (CoglContext *ctx)
+{
+  if (ctx->vertex_array_cache)
+    {
+      g_hash_table_destroy (ctx->vertex_array_cache);
+      ctx->vertex_array_cache = NULL;
+    }
+}
+
 #ifdef COGL_PIPELINE_PROGEND_GLSL
 
+/* Binds a vertex array object holding the pointers and enables of the
+ * buffered attributes, creating it the first time this set of
+ * attributes is drawn with. The journal and the primitives keep
+ * drawing from the same buffers, so later draws don't specify their
+ * attributes again. Returns FALSE if the attributes can't be cached,
+ * in which case the default vertex array object is bound for them to
+ * be set up as usual. */
+static CoglBool
+flush_cached_vertex_array (CoglContext *ctx,
+                           CoglPipeline *pipeline,
+                           CoglAttribute **attributes,
+                           int n_attributes)
+{
+  CoglVertexArrayKey key;
+  CoglVertexArray *vertex_array;
+  int i;
+
+  if (!_cogl_has_private_feature (ctx,
+                                  COGL_PRIVATE_FEATURE_VERTEX_ARRAY_OBJECTS) ||
+      n_attributes > COGL_VERTEX_ARRAY_MAX_ATTRIBUTES)
+    goto uncached;
+
+  /* The padding is compared too */
+  memset (&key, 0, sizeof (key));
+
+  for (i = 0; i < n_attributes; i++)
+    {
+      CoglAttribute *attribute = attributes[i];
+      CoglVertexArrayAttribute *entry;
+      CoglBuffer *buffer;
+      int location;
+
+      if (!attribute->is_buffered)
+        continue;
+
+      location = _cogl_pipeline_progend_glsl_get_attrib_location
+        (pipeline, attribute->name_state->name_index);
+      if (location == -1)
+        continue;
+
+      /* Client side arrays would be read at the pointer given when the
+       * vertex array object was set up */
+      buffer = COGL_BUFFER (cogl_attribute_get_buffer (attribute));
+      if (!(buffer->flags & COGL_BUFFER_FLAG_BUFFER_OBJECT) ||
+          !buffer->store_created)
+        goto uncached;
+
+      entry = &key.attributes[key.n_attributes++];
+      entry->buffer = buffer->gl_handle;
+      entry->location = location;
+      entry->n_components = attribute->d.buffered.n_components;
+      entry->type = attribute->d.buffered.type;
+      entry->normalized = attribute->normalized;
+      entry->stride = attribute->d.buffered.stride;
+      entry->offset = attribute->d.buffered.offset;
+    }
+
+  key.hash = _cogl_util_one_at_a_time_hash (0, key.attributes,
+                                            key.n_attributes *
+                                            sizeof (CoglVertexArrayAttribute));
+  key.hash = _cogl_util_one_at_a_time_mix (key.hash);
+
+  if (ctx->vertex_array_cache == NULL)
+    ctx->vertex_array_cache =
+      g_hash_table_new_full (vertex_array_key_hash,
+                             vertex_array_key_equal,
+                             NULL,
+                             (GDestroyNotify) vertex_array_free);
+
+  vertex_array = g_hash_table_lookup (ctx->vertex_array_cache, &key);
+  if (vertex_array)
+    {
+      bind_vertex_array (ctx, vertex_array->vertex_array);
+      return TRUE;
+    }
+
+  if (g_hash_table_size (ctx->vertex_array_cache) >=
+      COGL_VERTEX_ARRAY_CACHE_SIZE)
+    g_hash_table_remove_all (ctx->vertex_array_cache);
+
+  vertex_array = g_slice_new (CoglVertexArray);
+  vertex_array->context = ctx;
+  vertex_array->key = key;
+  GE (ctx, glGenVertexArrays (1, &vertex_array->vertex_array));
+  bind_vertex_array (ctx, vertex_array->vertex_array);
+
+  /* A new vertex array object has all its attributes disabled */
+  for (i = 0; i < n_attributes; i++)
+    {
+      CoglAttribute *attribute = attributes[i];
+      CoglBuffer *buffer;
+      int location;
+      uint8_t *base;
+
+      if (!attribute->is_buffered)
+        continue;
+
+      location = _cogl_pipeline_progend_glsl_get_attrib_location
+        (pipeline, attribute->name_state->name_index);
+      if (location == -1)
+        continue;
+
+      buffer = COGL_BUFFER (cogl_attribute_get_buffer (attribute));
+      base = _cogl_buffer_gl_bind (buffer,
+                                   COGL_BUFFER_BIND_TARGET_ATTRIBUTE_BUFFER,
+                                   NULL);
+
+      GE( ctx, glVertexAttribPointer (location,
+                                      attribute->d.buffered.n_components,
+                                      attribute->d.buffered.type,
+                                      attribute->normalized,
+                                      attribute->d.buffered.stride,
+                                      base + attribute->d.buffered.offset) );
+      GE( ctx, glEnableVertexAttribArray (location) );
+
+      _cogl_buffer_gl_unbind (buffer);
+    }
+
+  g_hash_table_insert (ctx->vertex_array_cache, &vertex_array->key,
+                       vertex_array);
+
+  return TRUE;
+
+ uncached:
+  bind_vertex_array (ctx, ctx->default_vertex_array);
+
+  return FALSE;
+}
+
 static void
 setup_generic_buffered_attribute (CoglContext *context,
                                   CoglPipeline *pipeline,
@@ -483,6 +730,26 @@ _cogl_gl_flush_attributes_state (CoglFramebuffer *framebuffer,
    * pipeline is flushed because when using GLSL that is the only
    * point when we can determine the attribute locations */
 
+#ifdef COGL_PIPELINE_PROGEND_GLSL
+  if (pipeline->progend == COGL_PIPELINE_PROGEND_GLSL &&
+      flush_cached_vertex_array (ctx, pipeline, attributes, n_attributes))
+    {
+      /* Constant attributes aren't part of the vertex array object */
+      for (i = 0; i < n_attributes; i++)
+        if (!attributes[i]->is_buffered)
+          setup_generic_const_attribute (ctx, pipeline, attributes[i]);
+
+      if (copy)
+        cogl_object_unref (copy);
+
+      return;
+    }
+#endif
+
+  /* The attribute enables tracked in the context are those of the
+   * default vertex array object */
+  bind_vertex_array (ctx, ctx->default_vertex_array);
+
   for (i = 0; i < n_attributes; i++)
     {
       CoglAttribute *attribute = attributes[i];
@@ -530,6 +797,8 @@ _cogl_gl_flush_attributes_state (CoglFramebuffer *framebuffer,
 void
 _cogl_gl_disable_all_attributes (CoglContext *ctx)
 {
+  bind_vertex_array (ctx, ctx->default_vertex_array);
+
   _cogl_bitmask_clear_all (&ctx->enable_builtin_attributes_tmp);
   _cogl_bitmask_clear_all (&ctx->enable_texcoord_attributes_tmp);
   _cogl_bitmask_clear_all (&ctx->enable_custom_attributes_tmp);
@@ -56,6 +56,10 @@ _cogl_buffer_gl_map_range (CoglBuffer *buffer,
 void
 _cogl_buffer_gl_unmap (CoglBuffer *buffer);
 
+void *
+_cogl_buffer_gl_map_persistent (CoglBuffer *buffer,
+                                CoglError **error);
+
 CoglBool
 _cogl_buffer_gl_set_data (CoglBuffer *buffer,
                           unsigned int offset,
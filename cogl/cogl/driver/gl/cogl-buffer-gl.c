@@ -40,6 +40,7 @@
 #include "cogl-buffer-gl-private.h"
 #include "cogl-error-private.h"
 #include "cogl-util-gl-private.h"
+#include "cogl-attribute-gl-private.h"
 
 /*
  * GL/GLES compatibility defines for the buffer API:
@@ -78,6 +79,12 @@
 #ifndef GL_MAP_INVALIDATE_BUFFER_BIT
 #define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
 #endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
 
 void
 _cogl_buffer_gl_create (CoglBuffer *buffer)
@@ -90,6 +97,9 @@ _cogl_buffer_gl_create (CoglBuffer *buffer)
 void
 _cogl_buffer_gl_destroy (CoglBuffer *buffer)
 {
+  _cogl_gl_forget_vertex_arrays_for_buffer (buffer->context,
+                                            buffer->gl_handle);
+
   GE( buffer->context, glDeleteBuffers (1, &buffer->gl_handle) );
 }
 
@@ -348,6 +358,60 @@ _cogl_buffer_gl_unmap (CoglBuffer *buffer)
   _cogl_buffer_gl_unbind (buffer);
 }
 
+/* Gives the buffer an immutable store that stays mapped for writing
+ * for the rest of its life, returning the mapping. The buffer can't be
+ * mapped the normal way afterwards. Writes are coherent so the GPU
+ * sees them without flushing, but the caller has to fence the ranges
+ * it reuses. Deleting the buffer implicitly unmaps it. */
+void *
+_cogl_buffer_gl_map_persistent (CoglBuffer *buffer,
+                                CoglError **error)
+{
+  CoglContext *ctx = buffer->context;
+  GLbitfield gl_access =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  GLenum gl_target;
+  void *data;
+
+  _COGL_RETURN_VAL_IF_FAIL (!buffer->store_created, NULL);
+  _COGL_RETURN_VAL_IF_FAIL (buffer->flags & COGL_BUFFER_FLAG_BUFFER_OBJECT,
+                            NULL);
+
+  _cogl_buffer_bind_no_create (buffer, buffer->last_target);
+
+  gl_target = convert_bind_target_to_gl_target (buffer->last_target);
+
+  /* Clear any GL errors */
+  _cogl_gl_util_clear_gl_errors (ctx);
+
+  ctx->glBufferStorage (gl_target, buffer->size, NULL, gl_access);
+
+  if (_cogl_gl_util_catch_out_of_memory (ctx, error))
+    {
+      _cogl_buffer_gl_unbind (buffer);
+      return NULL;
+    }
+
+  buffer->store_created = TRUE;
+
+  data = ctx->glMapBufferRange (gl_target, 0, buffer->size, gl_access);
+
+  _cogl_buffer_gl_unbind (buffer);
+
+  if (data == NULL)
+    {
+      _cogl_set_error (error,
+                       COGL_SYSTEM_ERROR,
+                       COGL_SYSTEM_ERROR_UNSUPPORTED,
+                       "Failed to persistently map a buffer");
+      return NULL;
+    }
+
+  buffer->flags |= COGL_BUFFER_FLAG_PERSISTENT;
+
+  return data;
+}
+
 CoglBool
 _cogl_buffer_gl_set_data (CoglBuffer *buffer,
                           unsigned int offset,
@@ -40,6 +40,7 @@
 #include "cogl-error-private.h"
 #include "cogl-texture-gl-private.h"
 #include "cogl-texture-private.h"
+#include "cogl-texture-memory-private.h"
 
 #include <glib.h>
 #include <string.h>
@@ -641,6 +642,24 @@ try_creating_renderbuffers (CoglContext *ctx,
   return renderbuffers;
 }
 
+static size_t
+estimate_renderbuffer_memory (CoglOffscreenAllocateFlags flags,
+                              int width,
+                              int height,
+                              int n_samples)
+{
+  size_t bpp = 0;
+
+  if (flags & COGL_OFFSCREEN_ALLOCATE_FLAG_DEPTH_STENCIL)
+    bpp += 4;
+  if (flags & COGL_OFFSCREEN_ALLOCATE_FLAG_DEPTH)
+    bpp += 2;
+  if (flags & COGL_OFFSCREEN_ALLOCATE_FLAG_STENCIL)
+    bpp += 1;
+
+  return (size_t) width * height * bpp * MAX (n_samples, 1);
+}
+
 static void
 delete_renderbuffers (CoglContext *ctx, GList *renderbuffers)
 {
@@ -946,6 +965,18 @@ _cogl_offscreen_gl_allocate (CoglOffscreen *offscreen,
        * GLES2 context later */
       offscreen->allocation_flags = flags;
 
+      /* What the depth texture provides doesn't need renderbuffers */
+      if (offscreen->depth_texture)
+        flags &= ~(COGL_OFFSCREEN_ALLOCATE_FLAG_DEPTH_STENCIL |
+                   COGL_OFFSCREEN_ALLOCATE_FLAG_DEPTH);
+
+      offscreen->renderbuffer_bytes =
+        estimate_renderbuffer_memory (flags, level_width, level_height,
+                                      gl_framebuffer->samples_per_pixel);
+      if (offscreen->renderbuffer_bytes)
+        _cogl_memory_account (ctx, "renderbuffers", 1,
+                              offscreen->renderbuffer_bytes);
+
       return TRUE;
     }
   else
@@ -964,6 +995,10 @@ _cogl_offscreen_gl_free (CoglOffscreen *offscreen)
 
   delete_renderbuffers (ctx, offscreen->gl_framebuffer.renderbuffers);
 
+  if (offscreen->renderbuffer_bytes)
+    _cogl_memory_account (ctx, "renderbuffers", -1,
+                          -(int64_t) offscreen->renderbuffer_bytes);
+
   GE (ctx, glDeleteFramebuffers (1, &offscreen->gl_framebuffer.fbo_handle));
 }
 
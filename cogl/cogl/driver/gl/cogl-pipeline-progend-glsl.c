@@ -56,6 +56,8 @@
 #include "cogl-attribute-private.h"
 #include "cogl-framebuffer-private.h"
 #include "cogl-pipeline-progend-glsl-private.h"
+#include "cogl-glsl-shader-private.h"
+#include "cogl-program-binary-cache-private.h"
 
 /* These are used to generalise updating some uniforms that are
    required when building for drivers missing some fixed function
@@ -63,10 +65,12 @@
 
 typedef void (* UpdateUniformFunc) (CoglPipeline *pipeline,
                                     int uniform_location,
+                                    CoglBoxedValue *flushed_value,
                                     void *getter_func);
 
 static void update_float_uniform (CoglPipeline *pipeline,
                                   int uniform_location,
+                                  CoglBoxedValue *flushed_value,
                                   void *getter_func);
 
 typedef struct
@@ -103,6 +107,10 @@ typedef struct _UnitState
   GLint combine_constant_uniform;
 
   GLint texture_matrix_uniform;
+
+  /* The values last given to the uniforms above */
+  CoglBoxedValue flushed_combine_constant;
+  CoglBoxedValue flushed_texture_matrix;
 } UnitState;
 
 typedef struct
@@ -117,6 +125,7 @@ typedef struct
 
   unsigned long dirty_builtin_uniforms;
   GLint builtin_uniform_locations[G_N_ELEMENTS (builtin_uniforms)];
+  CoglBoxedValue flushed_builtin_uniforms[G_N_ELEMENTS (builtin_uniforms)];
 
   GLint modelview_uniform;
   GLint projection_uniform;
@@ -134,6 +143,11 @@ typedef struct
      uniform is actually set */
   GArray *uniform_locations;
 
+  /* The values last given to each of those uniforms, so that pipelines
+     taking turns with the program don't upload the values it already
+     has again */
+  GArray *flushed_uniform_values;
+
   /* Array of attribute locations. */
   GArray *attribute_locations;
 
@@ -145,6 +159,7 @@ typedef struct
   int flushed_flip_state;
 
   UnitState *unit_state;
+  int n_units;
 
   CoglPipelineCacheEntry *cache_entry;
 } CoglPipelineProgramState;
@@ -235,17 +250,80 @@ clear_flushed_matrix_stacks (CoglPipelineProgramState *program_state)
   _cogl_matrix_entry_cache_init (&program_state->modelview_cache);
 }
 
+/* Uploads @value to @location unless the uniform already has it */
+static void
+set_uniform_if_changed (CoglContext *ctx,
+                        GLint location,
+                        CoglBoxedValue *flushed_value,
+                        const CoglBoxedValue *value)
+{
+  if (_cogl_boxed_value_equal (flushed_value, value))
+    return;
+
+  _cogl_boxed_value_set_uniform (ctx, location, value);
+
+  _cogl_boxed_value_destroy (flushed_value);
+  _cogl_boxed_value_copy (flushed_value, value);
+}
+
+static void
+forget_flushed_value (CoglBoxedValue *flushed_value)
+{
+  _cogl_boxed_value_destroy (flushed_value);
+  _cogl_boxed_value_init (flushed_value);
+}
+
+/* A newly linked program has all its uniforms set to zero, which we
+ * don't track, so after linking every uniform is uploaded again */
+static void
+forget_flushed_uniform_values (CoglPipelineProgramState *program_state)
+{
+  int i;
+
+  for (i = 0; i < G_N_ELEMENTS (builtin_uniforms); i++)
+    forget_flushed_value (&program_state->flushed_builtin_uniforms[i]);
+
+  for (i = 0; i < program_state->n_units; i++)
+    {
+      UnitState *unit_state = &program_state->unit_state[i];
+
+      forget_flushed_value (&unit_state->flushed_combine_constant);
+      forget_flushed_value (&unit_state->flushed_texture_matrix);
+    }
+
+  if (program_state->flushed_uniform_values)
+    {
+      for (i = 0; i < program_state->flushed_uniform_values->len; i++)
+        _cogl_boxed_value_destroy (&g_array_index (program_state->
+                                                   flushed_uniform_values,
+                                                   CoglBoxedValue, i));
+      g_array_set_size (program_state->flushed_uniform_values, 0);
+    }
+}
+
 static CoglPipelineProgramState *
 program_state_new (int n_layers,
                    CoglPipelineCacheEntry *cache_entry)
 {
   CoglPipelineProgramState *program_state;
+  int i;
 
   program_state = g_slice_new (CoglPipelineProgramState);
   program_state->ref_count = 1;
   program_state->program = 0;
   program_state->unit_state = g_new (UnitState, n_layers);
+  program_state->n_units = n_layers;
+  for (i = 0; i < n_layers; i++)
+    {
+      _cogl_boxed_value_init (&program_state->unit_state[i]
+                              .flushed_combine_constant);
+      _cogl_boxed_value_init (&program_state->unit_state[i]
+                              .flushed_texture_matrix);
+    }
+  for (i = 0; i < G_N_ELEMENTS (builtin_uniforms); i++)
+    _cogl_boxed_value_init (&program_state->flushed_builtin_uniforms[i]);
   program_state->uniform_locations = NULL;
+  program_state->flushed_uniform_values = NULL;
   program_state->attribute_locations = NULL;
   program_state->cache_entry = cache_entry;
   _cogl_matrix_entry_cache_init (&program_state->modelview_cache);
@@ -283,10 +361,14 @@ destroy_program_state (void *user_data,
       if (program_state->program)
         GE( ctx, glDeleteProgram (program_state->program) );
 
+      forget_flushed_uniform_values (program_state);
+
       free (program_state->unit_state);
 
       if (program_state->uniform_locations)
         g_array_free (program_state->uniform_locations, TRUE);
+      if (program_state->flushed_uniform_values)
+        g_array_free (program_state->flushed_uniform_values, TRUE);
 
       g_slice_free (CoglPipelineProgramState, program_state);
     }
@@ -322,12 +404,14 @@ dirty_program_state (CoglPipeline *pipeline)
                              NULL);
 }
 
-static void
-link_program (GLint gl_program)
+static CoglBool
+link_program (GLint gl_program,
+              GLuint fragment_shader,
+              GLuint vertex_shader)
 {
   GLint link_status;
 
-  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+  _COGL_GET_CONTEXT (ctx, FALSE);
 
   GE( ctx, glLinkProgram (gl_program) );
 
@@ -350,7 +434,41 @@ link_program (GLint gl_program)
                  log_length, log);
 
       free (log);
+
+      /* Compile errors weren't checked while the driver had the
+       * shaders on its own threads */
+      if (_cogl_has_private_feature
+          (ctx, COGL_PRIVATE_FEATURE_PARALLEL_SHADER_COMPILE))
+        {
+          if (fragment_shader)
+            _cogl_glsl_shader_report_errors (ctx, fragment_shader);
+          if (vertex_shader)
+            _cogl_glsl_shader_report_errors (ctx, vertex_shader);
+        }
     }
+
+  return link_status;
+}
+
+static void
+attach_backend_shader (CoglContext *ctx,
+                       GLuint gl_program,
+                       GLuint shader)
+{
+  GLint compile_status;
+
+  if (shader == 0)
+    return;
+
+  /* The GLSL backends leave compiling their shaders to us so that it
+     can be skipped when the program comes from the binary cache. A
+     shader that has been compiled before was already waited for when
+     its first program was linked, so asking again doesn't stall */
+  GE( ctx, glGetShaderiv (shader, GL_COMPILE_STATUS, &compile_status) );
+  if (!compile_status)
+    _cogl_glsl_shader_compile (ctx, shader);
+
+  GE( ctx, glAttachShader (gl_program, shader) );
 }
 
 typedef struct
@@ -430,11 +548,17 @@ update_constants_cb (CoglPipeline *pipeline,
       (state->update_all || unit_state->dirty_combine_constant))
     {
       float constant[4];
+      CoglBoxedValue value;
+
       _cogl_pipeline_get_layer_combine_constant (pipeline,
                                                  layer_index,
                                                  constant);
-      GE (ctx, glUniform4fv (unit_state->combine_constant_uniform,
-                             1, constant));
+      _cogl_boxed_value_init (&value);
+      _cogl_boxed_value_set_float (&value, 4, 1, constant);
+      set_uniform_if_changed (ctx,
+                              unit_state->combine_constant_uniform,
+                              &unit_state->flushed_combine_constant,
+                              &value);
       unit_state->dirty_combine_constant = FALSE;
     }
 
@@ -442,12 +566,16 @@ update_constants_cb (CoglPipeline *pipeline,
       (state->update_all || unit_state->dirty_texture_matrix))
     {
       const CoglMatrix *matrix;
-      const float *array;
+      CoglBoxedValue value;
 
       matrix = _cogl_pipeline_get_layer_matrix (pipeline, layer_index);
-      array = cogl_matrix_get_array (matrix);
-      GE (ctx, glUniformMatrix4fv (unit_state->texture_matrix_uniform,
-                                   1, FALSE, array));
+      _cogl_boxed_value_init (&value);
+      _cogl_boxed_value_set_matrix (&value, 4, 1, FALSE,
+                                    cogl_matrix_get_array (matrix));
+      set_uniform_if_changed (ctx,
+                              unit_state->texture_matrix_uniform,
+                              &unit_state->flushed_texture_matrix,
+                              &value);
       unit_state->dirty_texture_matrix = FALSE;
     }
 
@@ -473,6 +601,8 @@ update_builtin_uniforms (CoglContext *context,
       builtin_uniforms[i].update_func (pipeline,
                                        program_state
                                        ->builtin_uniform_locations[i],
+                                       &program_state
+                                       ->flushed_builtin_uniforms[i],
                                        builtin_uniforms[i].getter_func);
 
   program_state->dirty_builtin_uniforms = 0;
@@ -498,11 +628,18 @@ flush_uniform_cb (int uniform_num, void *user_data)
       GArray *uniform_locations;
       GLint uniform_location;
 
+      GArray *flushed_values;
+
       if (data->program_state->uniform_locations == NULL)
-        data->program_state->uniform_locations =
-          g_array_new (FALSE, FALSE, sizeof (GLint));
+        {
+          data->program_state->uniform_locations =
+            g_array_new (FALSE, FALSE, sizeof (GLint));
+          data->program_state->flushed_uniform_values =
+            g_array_new (FALSE, FALSE, sizeof (CoglBoxedValue));
+        }
 
       uniform_locations = data->program_state->uniform_locations;
+      flushed_values = data->program_state->flushed_uniform_values;
 
       if (uniform_locations->len <= uniform_num)
         {
@@ -518,6 +655,21 @@ flush_uniform_cb (int uniform_num, void *user_data)
             }
         }
 
+      if (flushed_values->len <= uniform_num)
+        {
+          unsigned int old_len = flushed_values->len;
+
+          g_array_set_size (flushed_values, uniform_num + 1);
+
+          while (old_len <= uniform_num)
+            {
+              _cogl_boxed_value_init (&g_array_index (flushed_values,
+                                                      CoglBoxedValue,
+                                                      old_len));
+              old_len++;
+            }
+        }
+
       uniform_location = g_array_index (uniform_locations, GLint, uniform_num);
 
       if (uniform_location == UNIFORM_LOCATION_UNKNOWN)
@@ -533,9 +685,12 @@ flush_uniform_cb (int uniform_num, void *user_data)
         }
 
       if (uniform_location != -1)
-        _cogl_boxed_value_set_uniform (data->ctx,
-                                       uniform_location,
-                                       data->values + data->value_index);
+        set_uniform_if_changed (data->ctx,
+                                uniform_location,
+                                &g_array_index (flushed_values,
+                                                CoglBoxedValue,
+                                                uniform_num),
+                                data->values + data->value_index);
 
       data->n_differences--;
       COGL_FLAGS_SET (data->uniform_differences, uniform_num, FALSE);
@@ -735,11 +890,23 @@ _cogl_pipeline_progend_glsl_end (CoglPipeline *pipeline,
 
   if (program_state->program == 0)
     {
-      GLuint backend_shader;
+      GLuint fragment_shader, vertex_shader;
+      char *binary_key = NULL;
       GSList *l;
 
       GE_RET( program_state->program, ctx, glCreateProgram () );
 
+      fragment_shader = _cogl_pipeline_fragend_glsl_get_shader (pipeline);
+      vertex_shader = _cogl_pipeline_vertend_glsl_get_shader (pipeline);
+
+      /* Programs made only of generated shaders can be cached on
+         disk. User programs aren't, their shaders are compiled by
+         CoglShader and may change under us */
+      if (user_program == NULL)
+        binary_key = _cogl_program_binary_cache_get_key (ctx,
+                                                         vertex_shader,
+                                                         fragment_shader);
+
       /* Attach all of the shader from the user program */
       if (user_program)
         {
@@ -758,20 +925,37 @@ _cogl_pipeline_progend_glsl_end (CoglPipeline *pipeline,
           program_state->user_program_age = user_program->age;
         }
 
-      /* Attach any shaders from the GLSL backends */
-      if ((backend_shader = _cogl_pipeline_fragend_glsl_get_shader (pipeline)))
-        GE( ctx, glAttachShader (program_state->program, backend_shader) );
-      if ((backend_shader = _cogl_pipeline_vertend_glsl_get_shader (pipeline)))
-        GE( ctx, glAttachShader (program_state->program, backend_shader) );
-
-      /* XXX: OpenGL as a special case requires the vertex position to
-       * be bound to generic attribute 0 so for simplicity we
-       * unconditionally bind the cogl_position_in attribute here...
-       */
-      GE( ctx, glBindAttribLocation (program_state->program,
-                                     0, "cogl_position_in"));
+      if (binary_key == NULL ||
+          !_cogl_program_binary_cache_load (ctx,
+                                            program_state->program,
+                                            binary_key))
+        {
+          /* Attach any shaders from the GLSL backends */
+          attach_backend_shader (ctx, program_state->program,
+                                 fragment_shader);
+          attach_backend_shader (ctx, program_state->program,
+                                 vertex_shader);
+
+          /* XXX: OpenGL as a special case requires the vertex position to
+           * be bound to generic attribute 0 so for simplicity we
+           * unconditionally bind the cogl_position_in attribute here...
+           */
+          GE( ctx, glBindAttribLocation (program_state->program,
+                                         0, "cogl_position_in"));
+
+          if (binary_key)
+            _cogl_program_binary_cache_prepare (ctx, program_state->program);
+
+          if (link_program (program_state->program,
+                            fragment_shader,
+                            vertex_shader) &&
+              binary_key)
+            _cogl_program_binary_cache_store (ctx,
+                                              program_state->program,
+                                              binary_key);
+        }
 
-      link_program (program_state->program);
+      free (binary_key);
 
       program_changed = TRUE;
     }
@@ -787,6 +971,8 @@ _cogl_pipeline_progend_glsl_end (CoglPipeline *pipeline,
 
   if (program_changed)
     {
+      forget_flushed_uniform_values (program_state);
+
       cogl_pipeline_foreach_layer (pipeline,
                                    get_uniform_cb,
                                    &state);
@@ -1049,15 +1235,17 @@ _cogl_pipeline_progend_glsl_pre_paint (CoglPipeline *pipeline,
 static void
 update_float_uniform (CoglPipeline *pipeline,
                       int uniform_location,
+                      CoglBoxedValue *flushed_value,
                       void *getter_func)
 {
   float (* float_getter_func) (CoglPipeline *) = getter_func;
-  float value;
+  CoglBoxedValue value;
 
   _COGL_GET_CONTEXT (ctx, NO_RETVAL);
 
-  value = float_getter_func (pipeline);
-  GE( ctx, glUniform1f (uniform_location, value) );
+  _cogl_boxed_value_init (&value);
+  _cogl_boxed_value_set_1f (&value, float_getter_func (pipeline));
+  set_uniform_if_changed (ctx, uniform_location, flushed_value, &value);
 }
 
 const CoglPipelineProgend _cogl_pipeline_glsl_progend =
@@ -421,7 +421,6 @@ _cogl_pipeline_vertend_glsl_end (CoglPipeline *pipeline,
     {
       const char *source_strings[2];
       GLint lengths[2];
-      GLint compile_status;
       GLuint shader;
       CoglPipelineSnippetData snippet_data;
       CoglPipelineSnippetList *vertex_snippets;
@@ -532,19 +531,9 @@ _cogl_pipeline_vertend_glsl_end (CoglPipeline *pipeline,
                                                      2, /* count */
                                                      source_strings, lengths);
 
-      GE( ctx, glCompileShader (shader) );
-      GE( ctx, glGetShaderiv (shader, GL_COMPILE_STATUS, &compile_status) );
-
-      if (!compile_status)
-        {
-          GLint len = 0;
-          char *shader_log;
-
-          GE( ctx, glGetShaderiv (shader, GL_INFO_LOG_LENGTH, &len) );
-          shader_log = g_alloca (len);
-          GE( ctx, glGetShaderInfoLog (shader, len, &len, shader_log) );
-          g_warning ("Shader compilation failed:\n%s", shader_log);
-        }
+      /* The shader is compiled by the progend when it links a
+         program using it, which it can skip if the linked program
+         is in the binary cache */
 
       shader_state->header = NULL;
       shader_state->source = NULL;
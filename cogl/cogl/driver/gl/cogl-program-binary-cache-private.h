@@ -0,0 +1,75 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __COGL_PROGRAM_BINARY_CACHE_PRIVATE_H
+#define __COGL_PROGRAM_BINARY_CACHE_PRIVATE_H
+
+#include "cogl-context-private.h"
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+/*
+ * The GLSL progend keeps the binaries of the programs it links in
+ * $XDG_CACHE_HOME/cogl/program-binaries so that the next process using
+ * the same driver can skip compiling and linking them. A program is
+ * identified by a hash of the GPU and driver identity and the sources
+ * of its shaders, taken before they are compiled.
+ */
+
+/* Returns a newly allocated key for the program that would be linked
+ * from the given shaders, or NULL if programs can't be cached. The
+ * shaders must have their source set but needn't be compiled yet. */
+char *
+_cogl_program_binary_cache_get_key (CoglContext *ctx,
+                                    GLuint vertex_shader,
+                                    GLuint fragment_shader);
+
+/* Tries to load @gl_program from the binary stored under @key; returns
+ * TRUE if the program is now linked. */
+CoglBool
+_cogl_program_binary_cache_load (CoglContext *ctx,
+                                 GLuint gl_program,
+                                 const char *key);
+
+/* To be called before linking a program that will be stored */
+void
+_cogl_program_binary_cache_prepare (CoglContext *ctx,
+                                    GLuint gl_program);
+
+void
+_cogl_program_binary_cache_store (CoglContext *ctx,
+                                  GLuint gl_program,
+                                  const char *key);
+
+#endif /* __COGL_PROGRAM_BINARY_CACHE_PRIVATE_H */
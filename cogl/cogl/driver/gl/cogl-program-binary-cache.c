@@ -0,0 +1,253 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "cogl-config.h"
+#endif
+
+#include <string.h>
+#include <errno.h>
+
+#include <glib/gstdio.h>
+
+#include "cogl-context-private.h"
+#include "cogl-util-gl-private.h"
+#include "cogl-private.h"
+#include "cogl-debug.h"
+#include "cogl-program-binary-cache-private.h"
+
+/* A cached program is stored as this header followed by the binary */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t format;
+} CoglProgramBinaryHeader;
+
+#define COGL_PROGRAM_BINARY_MAGIC 0x42504f43 /* "COPB" */
+
+static char *
+get_cache_dir (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "cogl", "program-binaries", NULL);
+}
+
+static char *
+get_cache_file (const char *key)
+{
+  char *dir = get_cache_dir ();
+  char *filename = g_build_filename (dir, key, NULL);
+
+  free (dir);
+
+  return filename;
+}
+
+static void
+checksum_shader_source (CoglContext *ctx,
+                        GChecksum *checksum,
+                        GLuint shader)
+{
+  GLint length = 0;
+  char *source;
+
+  if (shader == 0)
+    {
+      g_checksum_update (checksum, (const guchar *) "", 1);
+      return;
+    }
+
+  GE( ctx, glGetShaderiv (shader, GL_SHADER_SOURCE_LENGTH, &length) );
+
+  source = g_malloc (length + 1);
+  source[0] = '\0';
+  GE( ctx, glGetShaderSource (shader, length + 1, NULL, source) );
+
+  /* Include the terminator so the boundary between the shaders is
+     part of the key */
+  g_checksum_update (checksum, (const guchar *) source, strlen (source) + 1);
+
+  free (source);
+}
+
+static void
+checksum_string (GChecksum *checksum,
+                 const char *str)
+{
+  if (str == NULL)
+    str = "";
+
+  g_checksum_update (checksum, (const guchar *) str, strlen (str) + 1);
+}
+
+char *
+_cogl_program_binary_cache_get_key (CoglContext *ctx,
+                                    GLuint vertex_shader,
+                                    GLuint fragment_shader)
+{
+  GChecksum *checksum;
+  char *key;
+  char *version;
+
+  if (!_cogl_has_private_feature (ctx, COGL_PRIVATE_FEATURE_PROGRAM_BINARY) ||
+      G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_DISABLE_PROGRAM_CACHES)))
+    return NULL;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+  /* The vendor, renderer and version strings identify the driver
+   * build closely enough; the parsed GPU info is added in case a
+   * driver reuses the same strings across versions */
+  checksum_string (checksum, (const char *) ctx->glGetString (GL_VENDOR));
+  checksum_string (checksum, (const char *) ctx->glGetString (GL_RENDERER));
+  checksum_string (checksum, (const char *) ctx->glGetString (GL_VERSION));
+  checksum_string (checksum, ctx->gpu.driver_package_name);
+  checksum_string (checksum, ctx->gpu.architecture_name);
+
+  version = g_strdup_printf ("%i", ctx->gpu.driver_package_version);
+  checksum_string (checksum, version);
+  free (version);
+
+  checksum_shader_source (ctx, checksum, vertex_shader);
+  checksum_shader_source (ctx, checksum, fragment_shader);
+
+  key = g_strdup (g_checksum_get_string (checksum));
+
+  g_checksum_free (checksum);
+
+  return key;
+}
+
+CoglBool
+_cogl_program_binary_cache_load (CoglContext *ctx,
+                                 GLuint gl_program,
+                                 const char *key)
+{
+  CoglProgramBinaryHeader header;
+  char *filename;
+  char *contents;
+  gsize length;
+  GLint link_status = GL_FALSE;
+
+  filename = get_cache_file (key);
+
+  if (!g_file_get_contents (filename, &contents, &length, NULL))
+    {
+      free (filename);
+      return FALSE;
+    }
+
+  if (length > sizeof (header))
+    {
+      memcpy (&header, contents, sizeof (header));
+
+      if (header.magic == COGL_PROGRAM_BINARY_MAGIC)
+        {
+          GE( ctx, glProgramBinary (gl_program, header.format,
+                                    contents + sizeof (header),
+                                    length - sizeof (header)) );
+          GE( ctx, glGetProgramiv (gl_program, GL_LINK_STATUS,
+                                   &link_status) );
+        }
+    }
+
+  /* A binary the driver no longer accepts, say after an update that
+     kept the version strings, is simply replaced once we've linked
+     the program from source again */
+  if (!link_status)
+    {
+      COGL_NOTE (OPENGL, "Discarding stale program binary %s", filename);
+      g_unlink (filename);
+    }
+
+  free (contents);
+  free (filename);
+
+  return link_status;
+}
+
+void
+_cogl_program_binary_cache_prepare (CoglContext *ctx,
+                                    GLuint gl_program)
+{
+  /* GL_OES_get_program_binary has no hint; every program can be
+     retrieved there */
+  if (ctx->glProgramParameteri)
+    GE( ctx, glProgramParameteri (gl_program,
+                                  GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                  GL_TRUE) );
+}
+
+void
+_cogl_program_binary_cache_store (CoglContext *ctx,
+                                  GLuint gl_program,
+                                  const char *key)
+{
+  CoglProgramBinaryHeader header;
+  GLint binary_length = 0;
+  GLsizei length = 0;
+  GLenum format = 0;
+  char *contents;
+  char *dir;
+  char *filename;
+  GError *error = NULL;
+
+  GE( ctx, glGetProgramiv (gl_program, GL_PROGRAM_BINARY_LENGTH,
+                           &binary_length) );
+  if (binary_length <= 0)
+    return;
+
+  contents = g_malloc (sizeof (header) + binary_length);
+
+  GE( ctx, glGetProgramBinary (gl_program, binary_length, &length, &format,
+                               contents + sizeof (header)) );
+  if (length <= 0)
+    {
+      free (contents);
+      return;
+    }
+
+  header.magic = COGL_PROGRAM_BINARY_MAGIC;
+  header.format = format;
+  memcpy (contents, &header, sizeof (header));
+
+  dir = get_cache_dir ();
+  filename = g_build_filename (dir, key, NULL);
+
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    COGL_NOTE (OPENGL, "Failed to create %s: %s", dir, g_strerror (errno));
+  else if (!g_file_set_contents (filename, contents,
+                                 sizeof (header) + length, &error))
+    {
+      COGL_NOTE (OPENGL, "Failed to store program binary: %s",
+                 error->message);
+      g_error_free (error);
+    }
+
+  free (filename);
+  free (dir);
+  free (contents);
+}
@@ -41,6 +41,7 @@
 #include "cogl-texture-3d-private.h"
 #include "cogl-util.h"
 #include "cogl-pipeline-opengl-private.h"
+#include "cogl-texture-memory-private.h"
 
 static inline int
 calculate_alignment (int rowstride)
@@ -149,6 +150,12 @@ _cogl_texture_gl_generate_mipmaps (CoglTexture *texture)
                                    gl_handle,
                                    _cogl_texture_is_foreign (texture));
   GE( ctx, glGenerateMipmap (gl_target) );
+
+  if (!texture->memory_mipmapped)
+    {
+      texture->memory_mipmapped = TRUE;
+      _cogl_texture_update_memory (texture);
+    }
 }
 
 GLenum
@@ -45,6 +45,7 @@
 #include "cogl-attribute-gl-private.h"
 #include "cogl-clip-stack-gl-private.h"
 #include "cogl-buffer-gl-private.h"
+#include "cogl-program-binary-cache-private.h"
 
 static CoglBool
 _cogl_driver_pixel_format_from_gl_internal (CoglContext *context,
@@ -524,6 +525,37 @@ _cogl_driver_update_features (CoglContext *ctx,
       COGL_FLAGS_SET (ctx->features, COGL_FEATURE_ID_ARBFP, TRUE);
     }
 
+  /* Only worth caching if the driver can hand back at least one
+   * binary format for us to store */
+  if (ctx->glGetProgramBinary && ctx->glGetShaderSource)
+    {
+      GLint n_formats = 0;
+
+      GE( ctx, glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats) );
+      if (n_formats > 0)
+        COGL_FLAGS_SET (private_features,
+                        COGL_PRIVATE_FEATURE_PROGRAM_BINARY, TRUE);
+    }
+
+  if (ctx->glQueryCounter)
+    COGL_FLAGS_SET (private_features, COGL_PRIVATE_FEATURE_TIMER_QUERY, TRUE);
+
+  /* Drivers may already compile on their own threads by default, so
+   * opting out means explicitly asking for none */
+  if (ctx->glMaxShaderCompilerThreads)
+    {
+      if (G_UNLIKELY (COGL_DEBUG_ENABLED
+                      (COGL_DEBUG_DISABLE_PARALLEL_SHADER_COMPILE)))
+        GE( ctx, glMaxShaderCompilerThreads (0) );
+      else
+        {
+          GE( ctx, glMaxShaderCompilerThreads (0xffffffff) );
+          COGL_FLAGS_SET (private_features,
+                          COGL_PRIVATE_FEATURE_PARALLEL_SHADER_COMPILE,
+                          TRUE);
+        }
+    }
+
   if (ctx->glCreateProgram)
     {
       flags |= COGL_FEATURE_SHADERS_GLSL;
@@ -661,6 +693,15 @@ _cogl_driver_update_features (CoglContext *ctx,
   if (ctx->glFenceSync)
     COGL_FLAGS_SET (ctx->features, COGL_FEATURE_ID_FENCE, TRUE);
 
+  if (ctx->glGenVertexArrays)
+    COGL_FLAGS_SET (private_features,
+                    COGL_PRIVATE_FEATURE_VERTEX_ARRAY_OBJECTS, TRUE);
+
+  if (ctx->glBufferStorage && ctx->glMapBufferRange && ctx->glFenceSync &&
+      COGL_FLAGS_GET (private_features, COGL_PRIVATE_FEATURE_VBOS))
+    COGL_FLAGS_SET (private_features,
+                    COGL_PRIVATE_FEATURE_PERSISTENT_BUFFERS, TRUE);
+
   if (COGL_CHECK_GL_VERSION (gl_major, gl_minor, 3, 0) ||
       _cogl_check_extension ("GL_ARB_texture_rg", gl_extensions))
     COGL_FLAGS_SET (ctx->features,
@@ -44,6 +44,7 @@
 #include "cogl-attribute-gl-private.h"
 #include "cogl-clip-stack-gl-private.h"
 #include "cogl-buffer-gl-private.h"
+#include "cogl-program-binary-cache-private.h"
 
 #ifndef GL_UNSIGNED_INT_24_8
 #define GL_UNSIGNED_INT_24_8 0x84FA
@@ -452,6 +453,37 @@ _cogl_driver_update_features (CoglContext *context,
       _cogl_check_extension ("GL_OES_egl_sync", gl_extensions))
     COGL_FLAGS_SET (private_features, COGL_PRIVATE_FEATURE_OES_EGL_SYNC, TRUE);
 
+  /* Only worth caching if the driver can hand back at least one
+   * binary format for us to store */
+  if (context->glGetProgramBinary && context->glGetShaderSource)
+    {
+      GLint n_formats = 0;
+
+      GE( context, glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats) );
+      if (n_formats > 0)
+        COGL_FLAGS_SET (private_features,
+                        COGL_PRIVATE_FEATURE_PROGRAM_BINARY, TRUE);
+    }
+
+  if (context->glQueryCounter)
+    COGL_FLAGS_SET (private_features, COGL_PRIVATE_FEATURE_TIMER_QUERY, TRUE);
+
+  /* Drivers may already compile on their own threads by default, so
+   * opting out means explicitly asking for none */
+  if (context->glMaxShaderCompilerThreads)
+    {
+      if (G_UNLIKELY (COGL_DEBUG_ENABLED
+                      (COGL_DEBUG_DISABLE_PARALLEL_SHADER_COMPILE)))
+        GE( context, glMaxShaderCompilerThreads (0) );
+      else
+        {
+          GE( context, glMaxShaderCompilerThreads (0xffffffff) );
+          COGL_FLAGS_SET (private_features,
+                          COGL_PRIVATE_FEATURE_PARALLEL_SHADER_COMPILE,
+                          TRUE);
+        }
+    }
+
   if (_cogl_check_extension ("GL_EXT_texture_rg", gl_extensions))
     COGL_FLAGS_SET (context->features,
                     COGL_FEATURE_ID_TEXTURE_RG,
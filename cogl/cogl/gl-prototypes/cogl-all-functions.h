@@ -319,6 +319,72 @@ COGL_EXT_FUNCTION (void, glDeleteSync,
 COGL_EXT_END ()
 #endif
 
+COGL_EXT_BEGIN (get_program_binary, 4, 1,
+                COGL_EXT_IN_GLES3,
+                "ARB:\0OES\0",
+                "get_program_binary\0")
+COGL_EXT_FUNCTION (void, glGetProgramBinary,
+                   (GLuint program,
+                    GLsizei bufSize,
+                    GLsizei *length,
+                    GLenum *binaryFormat,
+                    GLvoid *binary))
+COGL_EXT_FUNCTION (void, glProgramBinary,
+                   (GLuint program,
+                    GLenum binaryFormat,
+                    const GLvoid *binary,
+                    GLsizei length))
+COGL_EXT_END ()
+
+/* The retrievable hint only exists in the ARB extension; with the OES
+ * one every binary can be retrieved */
+COGL_EXT_BEGIN (program_parameteri, 4, 1,
+                COGL_EXT_IN_GLES3,
+                "ARB:\0",
+                "get_program_binary\0")
+COGL_EXT_FUNCTION (void, glProgramParameteri,
+                   (GLuint program,
+                    GLenum pname,
+                    GLint value))
+COGL_EXT_END ()
+
+COGL_EXT_BEGIN (parallel_shader_compile, 255, 255,
+                0, /* not in either GLES */
+                "KHR\0ARB\0",
+                "parallel_shader_compile\0")
+COGL_EXT_FUNCTION (void, glMaxShaderCompilerThreads,
+                   (GLuint count))
+COGL_EXT_END ()
+
+COGL_EXT_BEGIN (buffer_storage, 4, 4,
+                0, /* not in either GLES */
+                "ARB:\0EXT\0",
+                "buffer_storage\0")
+COGL_EXT_FUNCTION (void, glBufferStorage,
+                   (GLenum target,
+                    GLsizeiptr size,
+                    const GLvoid *data,
+                    GLbitfield flags))
+COGL_EXT_END ()
+
+/* Timestamp queries; GLES only has them through the disjoint timer
+ * query extension */
+COGL_EXT_BEGIN (timer_query, 3, 3,
+                0, /* not in either GLES */
+                "ARB:\0EXT\0",
+                "timer_query\0disjoint_timer_query\0")
+COGL_EXT_FUNCTION (void, glGenQueries,
+                   (GLsizei n, GLuint *ids))
+COGL_EXT_FUNCTION (void, glDeleteQueries,
+                   (GLsizei n, const GLuint *ids))
+COGL_EXT_FUNCTION (void, glQueryCounter,
+                   (GLuint id, GLenum target))
+COGL_EXT_FUNCTION (void, glGetQueryObjectiv,
+                   (GLuint id, GLenum pname, GLint *params))
+COGL_EXT_FUNCTION (void, glGetQueryObjectui64v,
+                   (GLuint id, GLenum pname, uint64_t *params))
+COGL_EXT_END ()
+
 COGL_EXT_BEGIN (draw_buffers, 2, 0,
                 COGL_EXT_IN_GLES3,
                 "ARB\0EXT\0",
@@ -55,6 +55,19 @@ struct _CoglDamageRectangle
   unsigned int y2;
 };
 
+/* The fallback path keeps this many separate damage rectangles before
+   it starts merging them, so that a few small updates far apart don't
+   turn into one download of the box spanning them */
+#define COGL_TEXTURE_PIXMAP_X11_MAX_DAMAGE_RECTS 4
+
+/* A shared memory segment from the context's pool, see
+   _cogl_texture_pixmap_x11_acquire_shm() */
+typedef struct _CoglShmSegment
+{
+  XShmSegmentInfo info;
+  size_t size;
+} CoglShmSegment;
+
 /* For stereo, there are a pair of textures, but we want to share most
  * other state (the GLXPixmap, visual, etc.) The way we do this is that
  * the left-eye texture has all the state (there is in fact, no internal
@@ -84,12 +97,17 @@ struct _CoglTexturePixmapX11
 
   XImage *image;
 
-  XShmSegmentInfo shm_info;
+  /* Set once XShmGetImage has failed for this pixmap so we stick to
+     XGetImage */
+  CoglBool shm_failed;
 
   Damage damage;
   CoglTexturePixmapX11ReportLevel damage_report_level;
   CoglBool damage_owned;
+  /* damage_rect is the bounding box of the damage_rects */
   CoglDamageRectangle damage_rect;
+  CoglDamageRectangle damage_rects[COGL_TEXTURE_PIXMAP_X11_MAX_DAMAGE_RECTS];
+  int n_damage_rects;
 
   void *winsys;
 
@@ -99,5 +117,7 @@ struct _CoglTexturePixmapX11
   CoglBool use_winsys_texture;
 };
 
+void
+_cogl_texture_pixmap_x11_free_shm_pool (CoglContext *ctx);
 
 #endif /* __COGL_TEXTURE_PIXMAP_X11_PRIVATE_H */
@@ -42,6 +42,8 @@
 #include "cogl-texture-pixmap-x11.h"
 #include "cogl-texture-pixmap-x11-private.h"
 #include "cogl-bitmap-private.h"
+#include "cogl-buffer-private.h"
+#include "cogl-pixel-buffer.h"
 #include "cogl-texture-private.h"
 #include "cogl-texture-driver.h"
 #include "cogl-texture-2d-private.h"
@@ -58,6 +60,7 @@
 #include "cogl-texture-gl-private.h"
 #include "cogl-private.h"
 #include "cogl-gtype-private.h"
+#include "cogl-texture-memory.h"
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -121,6 +124,87 @@ cogl_damage_rectangle_is_whole (const CoglDamageRectangle *damage_rect,
           && damage_rect->x2 == width && damage_rect->y2 == height);
 }
 
+static unsigned int
+cogl_damage_rectangle_area (const CoglDamageRectangle *damage_rect)
+{
+  return ((damage_rect->x2 - damage_rect->x1) *
+          (damage_rect->y2 - damage_rect->y1));
+}
+
+static void
+cogl_damage_reset (CoglTexturePixmapX11 *tex_pixmap)
+{
+  memset (&tex_pixmap->damage_rect, 0, sizeof (CoglDamageRectangle));
+  tex_pixmap->n_damage_rects = 0;
+}
+
+/* Adds a rectangle to both the bounding box and the list of damage
+   rectangles. Once the list is full the new rectangle is merged into
+   whichever existing one grows the least, and if the rectangles cover
+   as much as their bounding box we may as well just keep that. */
+static void
+cogl_damage_add_rectangle (CoglTexturePixmapX11 *tex_pixmap,
+                           int x,
+                           int y,
+                           int width,
+                           int height)
+{
+  CoglDamageRectangle *rects = tex_pixmap->damage_rects;
+  CoglDamageRectangle rect;
+  unsigned int total_area = 0;
+  int i;
+
+  if (width <= 0 || height <= 0)
+    return;
+
+  cogl_damage_rectangle_union (&tex_pixmap->damage_rect,
+                               x, y, width, height);
+
+  rect.x1 = x;
+  rect.y1 = y;
+  rect.x2 = x + width;
+  rect.y2 = y + height;
+
+  for (i = 0; i < tex_pixmap->n_damage_rects; i++)
+    if (rects[i].x1 <= rect.x1 && rects[i].y1 <= rect.y1 &&
+        rects[i].x2 >= rect.x2 && rects[i].y2 >= rect.y2)
+      return;
+
+  if (tex_pixmap->n_damage_rects < COGL_TEXTURE_PIXMAP_X11_MAX_DAMAGE_RECTS)
+    rects[tex_pixmap->n_damage_rects++] = rect;
+  else
+    {
+      unsigned int best_growth = G_MAXUINT;
+      int best = 0;
+
+      for (i = 0; i < tex_pixmap->n_damage_rects; i++)
+        {
+          CoglDamageRectangle merged = rects[i];
+          unsigned int growth;
+
+          cogl_damage_rectangle_union (&merged, x, y, width, height);
+          growth = (cogl_damage_rectangle_area (&merged) -
+                    cogl_damage_rectangle_area (&rects[i]));
+          if (growth < best_growth)
+            {
+              best_growth = growth;
+              best = i;
+            }
+        }
+
+      cogl_damage_rectangle_union (&rects[best], x, y, width, height);
+    }
+
+  for (i = 0; i < tex_pixmap->n_damage_rects; i++)
+    total_area += cogl_damage_rectangle_area (&rects[i]);
+
+  if (total_area >= cogl_damage_rectangle_area (&tex_pixmap->damage_rect))
+    {
+      rects[0] = tex_pixmap->damage_rect;
+      tex_pixmap->n_damage_rects = 1;
+    }
+}
+
 static const CoglWinsysVtable *
 _cogl_texture_pixmap_x11_get_winsys (CoglTexturePixmapX11 *tex_pixmap)
 {
@@ -190,9 +274,10 @@ process_damage_event (CoglTexturePixmapX11 *tex_pixmap,
       int r_count;
       XRectangle r_bounds;
       XRectangle *r_damage;
+      int i;
 
       /* We need to extract the damage region so we can get the
-         bounding box */
+         rectangles in it */
 
       parts = XFixesCreateRegion (display, 0, 0);
       XDamageSubtract (display, tex_pixmap->damage, None, parts);
@@ -200,13 +285,22 @@ process_damage_event (CoglTexturePixmapX11 *tex_pixmap,
                                              parts,
                                              &r_count,
                                              &r_bounds);
-      cogl_damage_rectangle_union (&tex_pixmap->damage_rect,
+      if (r_damage)
+        {
+          for (i = 0; i < r_count; i++)
+            cogl_damage_add_rectangle (tex_pixmap,
+                                       r_damage[i].x,
+                                       r_damage[i].y,
+                                       r_damage[i].width,
+                                       r_damage[i].height);
+          XFree (r_damage);
+        }
+      else
+        cogl_damage_add_rectangle (tex_pixmap,
                                    r_bounds.x,
                                    r_bounds.y,
                                    r_bounds.width,
                                    r_bounds.height);
-      if (r_damage)
-        XFree (r_damage);
 
       XFixesDestroyRegion (display, parts);
     }
@@ -217,11 +311,11 @@ process_damage_event (CoglTexturePixmapX11 *tex_pixmap,
            don't care what the region actually was */
         XDamageSubtract (display, tex_pixmap->damage, None, None);
 
-      cogl_damage_rectangle_union (&tex_pixmap->damage_rect,
-                                   damage_event->area.x,
-                                   damage_event->area.y,
-                                   damage_event->area.width,
-                                   damage_event->area.height);
+      cogl_damage_add_rectangle (tex_pixmap,
+                                 damage_event->area.x,
+                                 damage_event->area.y,
+                                 damage_event->area.width,
+                                 damage_event->area.height);
     }
 
   if (tex_pixmap->winsys)
@@ -331,7 +425,7 @@ _cogl_texture_pixmap_x11_new (CoglContext *ctxt,
   tex_pixmap->stereo_mode = stereo_mode;
   tex_pixmap->left = NULL;
   tex_pixmap->image = NULL;
-  tex_pixmap->shm_info.shmid = -1;
+  tex_pixmap->shm_failed = FALSE;
   tex_pixmap->tex = NULL;
   tex_pixmap->damage_owned = FALSE;
   tex_pixmap->damage = 0;
@@ -367,10 +461,8 @@ _cogl_texture_pixmap_x11_new (CoglContext *ctxt,
     }
 
   /* Assume the entire pixmap is damaged to begin with */
-  tex_pixmap->damage_rect.x1 = 0;
-  tex_pixmap->damage_rect.x2 = pixmap_width;
-  tex_pixmap->damage_rect.y1 = 0;
-  tex_pixmap->damage_rect.y2 = pixmap_height;
+  cogl_damage_reset (tex_pixmap);
+  cogl_damage_add_rectangle (tex_pixmap, 0, 0, pixmap_width, pixmap_height);
 
   winsys = _cogl_texture_pixmap_x11_get_winsys (tex_pixmap);
   if (winsys->texture_pixmap_x11_create)
@@ -450,77 +542,182 @@ _cogl_texture_pixmap_x11_allocate (CoglTexture *tex,
   return TRUE;
 }
 
-/* Tries to allocate enough shared mem to handle a full size
- * update size of the X Pixmap. */
+/* Shared memory segments are handed out in power-of-two size classes
+   starting at this size so that segments freed by one pixmap fit the
+   updates of others */
+#define COGL_SHM_MIN_SEGMENT_SIZE (64 * 1024)
+
+/* Free segments beyond this many bytes are destroyed instead of being
+   kept in the pool */
+#define COGL_SHM_POOL_MAX_SIZE (64 * 1024 * 1024)
+
+static size_t
+shm_segment_size_for (size_t size)
+{
+  size_t segment_size = COGL_SHM_MIN_SEGMENT_SIZE;
+
+  while (segment_size < size)
+    segment_size *= 2;
+
+  return segment_size;
+}
+
 static void
-try_alloc_shm (CoglTexturePixmapX11 *tex_pixmap)
+destroy_shm_segment (Display *display,
+                     CoglShmSegment *segment)
 {
-  CoglTexture *tex = COGL_TEXTURE (tex_pixmap);
-  XImage *dummy_image;
-  Display *display;
+  XShmDetach (display, &segment->info);
+  shmdt (segment->info.shmaddr);
+  shmctl (segment->info.shmid, IPC_RMID, 0);
+  free (segment);
+}
 
-  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+/* Returns a shared memory segment attached to the X server of at least
+   @size bytes, reusing one from the context's pool if possible, or
+   NULL if shared memory can't be used. The segment must be given back
+   with release_shm() once the data in it has been consumed. */
+static CoglShmSegment *
+acquire_shm (CoglContext *ctx,
+             size_t size)
+{
+  CoglShmSegment *segment;
+  Display *display;
+  size_t segment_size;
+  GList *l;
 
   display = cogl_xlib_renderer_get_display (ctx->display->renderer);
 
   if (!XShmQueryExtension (display))
-    return;
+    return NULL;
+
+  segment_size = shm_segment_size_for (size);
+
+  for (l = ctx->shm_pool; l; l = l->next)
+    {
+      segment = l->data;
 
-  /* We are creating a dummy_image so we can have Xlib calculate
-   * image->bytes_per_line - including any magic padding it may
-   * want - for the largest possible ximage we might need to use
-   * when handling updates to the texture.
-   *
-   * Note: we pass a NULL shminfo here, but that has no bearing
-   * on the setup of the XImage, except that ximage->obdata will
-   * == NULL.
-   */
-  dummy_image =
-    XShmCreateImage (display,
-                     tex_pixmap->visual,
-                     tex_pixmap->depth,
-                     ZPixmap,
-                     NULL,
-                     NULL, /* shminfo, */
-                     tex->width,
-                     tex->height);
-  if (!dummy_image)
-    goto failed_image_create;
-
-  tex_pixmap->shm_info.shmid = shmget (IPC_PRIVATE,
-                                       dummy_image->bytes_per_line
-                                       * dummy_image->height,
-                                       IPC_CREAT | 0777);
-  if (tex_pixmap->shm_info.shmid == -1)
+      if (segment->size == segment_size)
+        {
+          ctx->shm_pool = g_list_delete_link (ctx->shm_pool, l);
+          ctx->shm_pool_size -= segment->size;
+          return segment;
+        }
+    }
+
+  segment = g_new0 (CoglShmSegment, 1);
+  segment->size = segment_size;
+
+  segment->info.shmid = shmget (IPC_PRIVATE, segment_size, IPC_CREAT | 0777);
+  if (segment->info.shmid == -1)
     goto failed_shmget;
 
-  tex_pixmap->shm_info.shmaddr = shmat (tex_pixmap->shm_info.shmid, 0, 0);
-  if (tex_pixmap->shm_info.shmaddr == (void *) -1)
+  segment->info.shmaddr = shmat (segment->info.shmid, 0, 0);
+  if (segment->info.shmaddr == (void *) -1)
     goto failed_shmat;
 
-  tex_pixmap->shm_info.readOnly = False;
+  segment->info.readOnly = False;
 
-  if (XShmAttach (display, &tex_pixmap->shm_info) == 0)
+  if (XShmAttach (display, &segment->info) == 0)
     goto failed_xshmattach;
 
-  XDestroyImage (dummy_image);
+  COGL_NOTE (TEXTURE_PIXMAP, "Allocated a %lu byte shm segment",
+             (unsigned long) segment_size);
 
-  return;
+  return segment;
 
  failed_xshmattach:
   g_warning ("XShmAttach failed");
-  shmdt (tex_pixmap->shm_info.shmaddr);
+  shmdt (segment->info.shmaddr);
 
  failed_shmat:
   g_warning ("shmat failed");
-  shmctl (tex_pixmap->shm_info.shmid, IPC_RMID, 0);
+  shmctl (segment->info.shmid, IPC_RMID, 0);
 
  failed_shmget:
   g_warning ("shmget failed");
-  XDestroyImage (dummy_image);
+  free (segment);
+
+  return NULL;
+}
+
+static void
+release_shm (CoglContext *ctx,
+             CoglShmSegment *segment)
+{
+  Display *display;
+  GList *l;
+
+  display = cogl_xlib_renderer_get_display (ctx->display->renderer);
+
+  /* One free segment per size class is enough since updates are done
+     one pixmap at a time */
+  for (l = ctx->shm_pool; l; l = l->next)
+    if (((CoglShmSegment *) l->data)->size == segment->size)
+      break;
+
+  if (l || ctx->shm_pool_size + segment->size > COGL_SHM_POOL_MAX_SIZE)
+    {
+      destroy_shm_segment (display, segment);
+      return;
+    }
 
- failed_image_create:
-  tex_pixmap->shm_info.shmid = -1;
+  ctx->shm_pool = g_list_prepend (ctx->shm_pool, segment);
+  ctx->shm_pool_size += segment->size;
+}
+
+void
+_cogl_texture_pixmap_x11_free_shm_pool (CoglContext *ctx)
+{
+  Display *display;
+  GList *l;
+
+  if (ctx->shm_staging_buffer)
+    {
+      cogl_object_unref (ctx->shm_staging_buffer);
+      ctx->shm_staging_buffer = NULL;
+    }
+
+  if (ctx->shm_pool == NULL)
+    return;
+
+  display = cogl_xlib_renderer_get_display (ctx->display->renderer);
+
+  for (l = ctx->shm_pool; l; l = l->next)
+    destroy_shm_segment (display, l->data);
+
+  g_list_free (ctx->shm_pool);
+  ctx->shm_pool = NULL;
+  ctx->shm_pool_size = 0;
+}
+
+/* Returns a pixel buffer of at least @size bytes to stage uploads in,
+   or NULL if the driver has no PBOs so the data should be uploaded
+   straight from client memory */
+static CoglBuffer *
+get_staging_buffer (CoglContext *ctx,
+                    size_t size)
+{
+  CoglBuffer *buffer = ctx->shm_staging_buffer;
+
+  if (!_cogl_has_private_feature (ctx, COGL_PRIVATE_FEATURE_PBOS))
+    return NULL;
+
+  if (buffer && cogl_buffer_get_size (buffer) < size)
+    {
+      cogl_object_unref (buffer);
+      buffer = NULL;
+    }
+
+  if (buffer == NULL)
+    {
+      buffer = COGL_BUFFER (cogl_pixel_buffer_new (ctx,
+                                                   shm_segment_size_for (size),
+                                                   NULL));
+      cogl_buffer_set_update_hint (buffer, COGL_BUFFER_UPDATE_HINT_STREAM);
+      ctx->shm_staging_buffer = buffer;
+    }
+
+  return buffer;
 }
 
 void
@@ -544,8 +741,7 @@ cogl_texture_pixmap_x11_update_area (CoglTexturePixmapX11 *tex_pixmap,
       winsys->texture_pixmap_x11_damage_notify (tex_pixmap);
     }
 
-  cogl_damage_rectangle_union (&tex_pixmap->damage_rect,
-                               x, y, width, height);
+  cogl_damage_add_rectangle (tex_pixmap, x, y, width, height);
 }
 
 CoglBool
@@ -622,34 +818,186 @@ create_fallback_texture (CoglContext *ctx,
   return tex;
 }
 
+static CoglPixelFormat
+image_format_for (CoglTexturePixmapX11 *tex_pixmap,
+                  XImage *image)
+{
+  Visual *visual = tex_pixmap->visual;
+
+  return _cogl_util_pixel_format_from_masks (visual->red_mask,
+                                             visual->green_mask,
+                                             visual->blue_mask,
+                                             image->depth,
+                                             image->bits_per_pixel,
+                                             image->byte_order == LSBFirst);
+}
+
+static void
+upload_damage_rect (CoglTexturePixmapX11 *tex_pixmap,
+                    const CoglDamageRectangle *rect,
+                    CoglPixelFormat format,
+                    int rowstride,
+                    const uint8_t *data)
+{
+  CoglError *ignore = NULL;
+
+  if (!_cogl_texture_set_region (tex_pixmap->tex,
+                                 rect->x2 - rect->x1,
+                                 rect->y2 - rect->y1,
+                                 format,
+                                 rowstride,
+                                 data,
+                                 rect->x1, rect->y1,
+                                 0, /* level */
+                                 &ignore))
+    cogl_error_free (ignore);
+}
+
+/* Downloads the damage rectangles with XShmGetImage through a pooled
+   segment. When the driver has PBOs each rectangle is copied into a
+   staging buffer so that the texture uploads are queued to the GPU
+   instead of waiting for glTexSubImage2D to copy from client memory.
+   Returns FALSE if shared memory can't be used. */
+static CoglBool
+update_image_texture_from_shm (CoglContext *ctx,
+                               CoglTexturePixmapX11 *tex_pixmap)
+{
+  XImage *images[COGL_TEXTURE_PIXMAP_X11_MAX_DAMAGE_RECTS];
+  size_t offsets[COGL_TEXTURE_PIXMAP_X11_MAX_DAMAGE_RECTS];
+  int n_rects = tex_pixmap->n_damage_rects;
+  CoglShmSegment *segment;
+  CoglPixelFormat image_format;
+  CoglBuffer *buffer;
+  uint8_t *staging = NULL;
+  Display *display;
+  size_t max_size = 0, total_size = 0;
+  int i;
+
+  display = cogl_xlib_renderer_get_display (ctx->display->renderer);
+
+  /* Create an image for each rectangle so Xlib works out the
+     bytes_per_line, including any padding it wants. There is no
+     XShmGetSubImage so each one reads into the start of the segment. */
+  for (i = 0; i < n_rects; i++)
+    {
+      const CoglDamageRectangle *rect = &tex_pixmap->damage_rects[i];
+      size_t size;
+
+      images[i] = XShmCreateImage (display,
+                                   tex_pixmap->visual,
+                                   tex_pixmap->depth,
+                                   ZPixmap,
+                                   NULL,
+                                   NULL, /* shminfo */
+                                   rect->x2 - rect->x1,
+                                   rect->y2 - rect->y1);
+      if (images[i] == NULL)
+        {
+          while (i--)
+            XFree (images[i]);
+          return FALSE;
+        }
+
+      size = images[i]->bytes_per_line * images[i]->height;
+      offsets[i] = total_size;
+      total_size += size;
+      max_size = MAX (max_size, size);
+    }
+
+  segment = acquire_shm (ctx, max_size);
+  if (segment == NULL)
+    {
+      for (i = 0; i < n_rects; i++)
+        XFree (images[i]);
+      return FALSE;
+    }
+
+  COGL_NOTE (TEXTURE_PIXMAP, "Updating %p using XShmGetImage (%i rectangles)",
+             tex_pixmap, n_rects);
+
+  image_format = image_format_for (tex_pixmap, images[0]);
+
+  buffer = get_staging_buffer (ctx, total_size);
+  if (buffer)
+    staging = _cogl_buffer_map_range_for_fill_or_fallback (buffer,
+                                                           0, total_size);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      const CoglDamageRectangle *rect = &tex_pixmap->damage_rects[i];
+
+      images[i]->data = segment->info.shmaddr;
+      images[i]->obdata = (char *) &segment->info;
+
+      XShmGetImage (display, tex_pixmap->pixmap, images[i],
+                    rect->x1, rect->y1, AllPlanes);
+
+      if (staging)
+        memcpy (staging + offsets[i], segment->info.shmaddr,
+                images[i]->bytes_per_line * images[i]->height);
+      else
+        upload_damage_rect (tex_pixmap, rect, image_format,
+                            images[i]->bytes_per_line,
+                            (const uint8_t *) segment->info.shmaddr);
+    }
+
+  /* The data has been copied out of the segment either way */
+  release_shm (ctx, segment);
+
+  if (staging)
+    {
+      _cogl_buffer_unmap_for_fill_or_fallback (buffer);
+
+      for (i = 0; i < n_rects; i++)
+        {
+          const CoglDamageRectangle *rect = &tex_pixmap->damage_rects[i];
+          CoglError *ignore = NULL;
+          CoglBitmap *bmp;
+
+          bmp = cogl_bitmap_new_from_buffer (buffer,
+                                             image_format,
+                                             rect->x2 - rect->x1,
+                                             rect->y2 - rect->y1,
+                                             images[i]->bytes_per_line,
+                                             offsets[i]);
+          if (!_cogl_texture_set_region_from_bitmap (tex_pixmap->tex,
+                                                     0, 0,
+                                                     rect->x2 - rect->x1,
+                                                     rect->y2 - rect->y1,
+                                                     bmp,
+                                                     rect->x1, rect->y1,
+                                                     0, /* level */
+                                                     &ignore))
+            cogl_error_free (ignore);
+          cogl_object_unref (bmp);
+        }
+    }
+
+  /* The images have no data of their own so we can just XFree them */
+  for (i = 0; i < n_rects; i++)
+    XFree (images[i]);
+
+  return TRUE;
+}
+
 static void
 _cogl_texture_pixmap_x11_update_image_texture (CoglTexturePixmapX11 *tex_pixmap)
 {
   CoglTexture *tex = COGL_TEXTURE (tex_pixmap);
   Display *display;
-  Visual *visual;
   CoglPixelFormat image_format;
   XImage *image;
-  int src_x, src_y;
-  int x, y, width, height;
   int bpp;
-  int offset;
-  CoglError *ignore = NULL;
+  int i;
 
   _COGL_GET_CONTEXT (ctx, NO_RETVAL);
 
   display = cogl_xlib_renderer_get_display (ctx->display->renderer);
-  visual = tex_pixmap->visual;
 
   /* If the damage region is empty then there's nothing to do */
-  if (tex_pixmap->damage_rect.x2 == tex_pixmap->damage_rect.x1)
+  if (tex_pixmap->n_damage_rects == 0)
     return;
 
-  x = tex_pixmap->damage_rect.x1;
-  y = tex_pixmap->damage_rect.y1;
-  width = tex_pixmap->damage_rect.x2 - x;
-  height = tex_pixmap->damage_rect.y2 - y;
-
   /* We lazily create the texture the first time it is needed in case
      this texture can be entirely handled using the GLX texture
      instead */
@@ -667,99 +1015,65 @@ _cogl_texture_pixmap_x11_update_image_texture (CoglTexturePixmapX11 *tex_pixmap)
                                                  texture_format);
     }
 
-  if (tex_pixmap->image == NULL)
+  if (tex_pixmap->image == NULL && !tex_pixmap->shm_failed)
     {
-      /* If we also haven't got a shm segment then this must be the
-         first time we've tried to update, so lets try allocating shm
-         first */
-      if (tex_pixmap->shm_info.shmid == -1)
-        try_alloc_shm (tex_pixmap);
-
-      if (tex_pixmap->shm_info.shmid == -1)
-        {
-          COGL_NOTE (TEXTURE_PIXMAP, "Updating %p using XGetImage", tex_pixmap);
-
-          /* We'll fallback to using a regular XImage. We'll download
-             the entire area instead of a sub region because presumably
-             if this is the first update then the entire pixmap is
-             needed anyway and it saves trying to manually allocate an
-             XImage at the right size */
-          tex_pixmap->image = XGetImage (display,
-                                         tex_pixmap->pixmap,
-                                         0, 0,
-                                         tex->width, tex->height,
-                                         AllPlanes, ZPixmap);
-          image = tex_pixmap->image;
-          src_x = x;
-          src_y = y;
-        }
-      else
+      if (update_image_texture_from_shm (ctx, tex_pixmap))
         {
-          COGL_NOTE (TEXTURE_PIXMAP, "Updating %p using XShmGetImage",
-                     tex_pixmap);
-
-          /* Create a temporary image using the beginning of the
-             shared memory segment and the right size for the region
-             we want to update. We need to reallocate the XImage every
-             time because there is no XShmGetSubImage. */
-          image = XShmCreateImage (display,
-                                   tex_pixmap->visual,
-                                   tex_pixmap->depth,
-                                   ZPixmap,
-                                   NULL,
-                                   &tex_pixmap->shm_info,
-                                   width,
-                                   height);
-          image->data = tex_pixmap->shm_info.shmaddr;
-          src_x = 0;
-          src_y = 0;
-
-          XShmGetImage (display, tex_pixmap->pixmap, image, x, y, AllPlanes);
+          cogl_damage_reset (tex_pixmap);
+          return;
         }
+
+      tex_pixmap->shm_failed = TRUE;
+    }
+
+  if (tex_pixmap->image == NULL)
+    {
+      COGL_NOTE (TEXTURE_PIXMAP, "Updating %p using XGetImage", tex_pixmap);
+
+      /* We'll fallback to using a regular XImage. We'll download
+         the entire area instead of a sub region because presumably
+         if this is the first update then the entire pixmap is
+         needed anyway and it saves trying to manually allocate an
+         XImage at the right size */
+      tex_pixmap->image = XGetImage (display,
+                                     tex_pixmap->pixmap,
+                                     0, 0,
+                                     tex->width, tex->height,
+                                     AllPlanes, ZPixmap);
     }
   else
     {
       COGL_NOTE (TEXTURE_PIXMAP, "Updating %p using XGetSubImage", tex_pixmap);
 
-      image = tex_pixmap->image;
-      src_x = x;
-      src_y = y;
-
-      XGetSubImage (display,
-                    tex_pixmap->pixmap,
-                    x, y, width, height,
-                    AllPlanes, ZPixmap,
-                    image,
-                    x, y);
+      for (i = 0; i < tex_pixmap->n_damage_rects; i++)
+        {
+          const CoglDamageRectangle *rect = &tex_pixmap->damage_rects[i];
+
+          XGetSubImage (display,
+                        tex_pixmap->pixmap,
+                        rect->x1, rect->y1,
+                        rect->x2 - rect->x1, rect->y2 - rect->y1,
+                        AllPlanes, ZPixmap,
+                        tex_pixmap->image,
+                        rect->x1, rect->y1);
+        }
     }
 
-  image_format =
-    _cogl_util_pixel_format_from_masks (visual->red_mask,
-                                        visual->green_mask,
-                                        visual->blue_mask,
-                                        image->depth,
-                                        image->bits_per_pixel,
-                                        image->byte_order == LSBFirst);
-
+  image = tex_pixmap->image;
+  image_format = image_format_for (tex_pixmap, image);
   bpp = _cogl_pixel_format_get_bytes_per_pixel (image_format);
-  offset = image->bytes_per_line * src_y + bpp * src_x;
-
-  _cogl_texture_set_region (tex_pixmap->tex,
-                            width,
-                            height,
-                            image_format,
-                            image->bytes_per_line,
-                            ((const uint8_t *) image->data) + offset,
-                            x, y,
-                            0, /* level */
-                            &ignore);
-
-  /* If we have a shared memory segment then the XImage would be a
-     temporary one with no data allocated so we can just XFree it */
-  if (tex_pixmap->shm_info.shmid != -1)
-    XFree (image);
 
-  memset (&tex_pixmap->damage_rect, 0, sizeof (CoglDamageRectangle));
+  for (i = 0; i < tex_pixmap->n_damage_rects; i++)
+    {
+      const CoglDamageRectangle *rect = &tex_pixmap->damage_rects[i];
+      int offset = image->bytes_per_line * rect->y1 + bpp * rect->x1;
+
+      upload_damage_rect (tex_pixmap, rect, image_format,
+                          image->bytes_per_line,
+                          ((const uint8_t *) image->data) + offset);
+    }
+
+  cogl_damage_reset (tex_pixmap);
 }
 
 static void
@@ -836,7 +1150,16 @@ _cogl_texture_pixmap_x11_get_texture (CoglTexturePixmapX11 *tex_pixmap)
         tex = tex_pixmap->tex;
 
       if (tex)
-        return tex;
+        {
+          /* The textures come and go with updates, so they pick up the
+             memory category here rather than when it is set */
+          const char *category = COGL_TEXTURE (original_pixmap)->memory_category;
+
+          if (tex->memory_category != category)
+            cogl_texture_set_memory_category (tex, category);
+
+          return tex;
+        }
 
       _cogl_texture_pixmap_x11_update (original_pixmap, FALSE);
     }
@@ -1116,8 +1439,6 @@ _cogl_texture_pixmap_x11_get_type (CoglTexture *tex)
 static void
 _cogl_texture_pixmap_x11_free (CoglTexturePixmapX11 *tex_pixmap)
 {
-  Display *display;
-
   _COGL_GET_CONTEXT (ctxt, NO_RETVAL);
 
   if (tex_pixmap->stereo_mode == COGL_TEXTURE_PIXMAP_RIGHT)
@@ -1130,20 +1451,11 @@ _cogl_texture_pixmap_x11_free (CoglTexturePixmapX11 *tex_pixmap)
       return;
     }
 
-  display = cogl_xlib_renderer_get_display (ctxt->display->renderer);
-
   set_damage_object_internal (ctxt, tex_pixmap, 0, 0);
 
   if (tex_pixmap->image)
     XDestroyImage (tex_pixmap->image);
 
-  if (tex_pixmap->shm_info.shmid != -1)
-    {
-      XShmDetach (display, &tex_pixmap->shm_info);
-      shmdt (tex_pixmap->shm_info.shmaddr);
-      shmctl (tex_pixmap->shm_info.shmid, IPC_RMID, 0);
-    }
-
   if (tex_pixmap->tex)
     cogl_object_unref (tex_pixmap->tex);
 
@@ -1180,5 +1492,6 @@ cogl_texture_pixmap_x11_vtable =
     _cogl_texture_pixmap_x11_get_gl_format,
     _cogl_texture_pixmap_x11_get_type,
     NULL, /* is_foreign */
-    NULL /* set_auto_mipmap */
+    NULL /* set_auto_mipmap */,
+    NULL /* set_memory_category */
   };
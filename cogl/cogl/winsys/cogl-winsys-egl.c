@@ -534,6 +534,14 @@ _cogl_winsys_context_init (CoglContext *context, CoglError **error)
       COGL_FLAGS_SET (context->features, COGL_FEATURE_ID_BUFFER_AGE, TRUE);
     }
 
+  /* The damage region is only useful together with the buffer age,
+   * and the extension requires the age to be queried first anyway */
+  if ((egl_renderer->private_features & COGL_EGL_WINSYS_FEATURE_PARTIAL_UPDATE) &&
+      (egl_renderer->private_features & COGL_EGL_WINSYS_FEATURE_BUFFER_AGE))
+    COGL_FLAGS_SET (context->winsys_features,
+                    COGL_WINSYS_FEATURE_PARTIAL_UPDATE,
+                    TRUE);
+
   /* NB: We currently only support creating standalone GLES2 contexts
    * for offscreen rendering and so we need a dummy (non-visible)
    * surface to be able to bind those contexts */
@@ -776,6 +784,47 @@ _cogl_winsys_onscreen_get_buffer_age (CoglOnscreen *onscreen)
   return age;
 }
 
+static void
+_cogl_winsys_onscreen_queue_damage_region (CoglOnscreen *onscreen,
+                                           const int *rectangles,
+                                           int n_rectangles)
+{
+  CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
+  CoglContext *context = framebuffer->context;
+  CoglRenderer *renderer = context->display->renderer;
+  CoglRendererEGL *egl_renderer = renderer->winsys;
+  CoglOnscreenEGL *egl_onscreen = onscreen->winsys;
+  size_t size = n_rectangles * sizeof (int) * 4;
+  int *flipped;
+  int i;
+
+  if (!(egl_renderer->private_features & COGL_EGL_WINSYS_FEATURE_PARTIAL_UPDATE))
+    return;
+
+  /* eglSetDamageRegionKHR expects rectangles relative to the bottom
+   * left corner but we are given rectangles relative to the top left
+   * so we need to flip them... */
+  flipped = g_alloca (size);
+  memcpy (flipped, rectangles, size);
+  for (i = 0; i < n_rectangles; i++)
+    {
+      const int *rect = rectangles + 4 * i;
+      int *flip_rect = flipped + 4 * i;
+      flip_rect[1] = framebuffer->height - rect[1] - rect[3];
+    }
+
+  /* The damage region applies to the surface bound for drawing */
+  _cogl_framebuffer_flush_state (framebuffer,
+                                 framebuffer,
+                                 COGL_FRAMEBUFFER_STATE_BIND);
+
+  if (egl_renderer->pf_eglSetDamageRegion (egl_renderer->edpy,
+                                           egl_onscreen->egl_surface,
+                                           flipped,
+                                           n_rectangles) == EGL_FALSE)
+    g_warning ("Error reported by eglSetDamageRegion");
+}
+
 static void
 _cogl_winsys_onscreen_swap_region (CoglOnscreen *onscreen,
                                    const int *user_rectangles,
@@ -990,6 +1039,8 @@ static CoglWinsysVtable _cogl_winsys_vtable =
       _cogl_winsys_onscreen_swap_buffers_with_damage,
     .onscreen_swap_region = _cogl_winsys_onscreen_swap_region,
     .onscreen_get_buffer_age = _cogl_winsys_onscreen_get_buffer_age,
+    .onscreen_queue_damage_region =
+      _cogl_winsys_onscreen_queue_damage_region,
     .onscreen_update_swap_throttled =
       _cogl_winsys_onscreen_update_swap_throttled,
 
@@ -135,6 +135,18 @@ COGL_WINSYS_FEATURE_FUNCTION (int, glXSwapInterval,
                               (int interval))
 COGL_WINSYS_FEATURE_END ()
 
+COGL_WINSYS_FEATURE_BEGIN (255, 255,
+                           ext_swap_control,
+                           "EXT\0",
+                           "swap_control\0",
+                           0,
+                           0)
+COGL_WINSYS_FEATURE_FUNCTION (void, glXSwapIntervalEXT,
+                              (Display *dpy,
+                               GLXDrawable drawable,
+                               int interval))
+COGL_WINSYS_FEATURE_END ()
+
 COGL_WINSYS_FEATURE_BEGIN (255, 255,
                            sync_control,
                            "OML\0",
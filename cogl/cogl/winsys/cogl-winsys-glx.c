@@ -112,8 +112,20 @@ typedef struct _CoglOnscreenGLX
   int swap_wait_pipe[2];
   GLXContext swap_wait_context;
   CoglBool closing_down;
+
+  /* Set while a swap handed over to the swap wait thread hasn't been
+   * issued yet; protected by swap_wait_mutex */
+  CoglBool present_pending;
+  GCond present_cond;
 } CoglOnscreenGLX;
 
+/* An entry of swap_wait_queue */
+typedef struct _CoglSwapWaitRequest
+{
+  uint32_t vblank_counter;
+  CoglBool present;
+} CoglSwapWaitRequest;
+
 typedef struct _CoglPixmapTextureEyeGLX
 {
   CoglTexture *glx_tex;
@@ -728,6 +740,10 @@ update_base_winsys_features (CoglRenderer *renderer)
                           TRUE);
       }
 
+  glx_renderer->have_swap_control_tear =
+    glx_renderer->glXSwapIntervalEXT &&
+    _cogl_check_extension ("GLX_EXT_swap_control_tear", split_extensions);
+
   g_strfreev (split_extensions);
 
   /* The GLX_SGI_video_sync spec explicitly states this extension
@@ -918,6 +934,10 @@ update_winsys_features (CoglContext *context, CoglError **error)
           COGL_FLAGS_SET (context->private_features,
                           COGL_PRIVATE_FEATURE_THREADED_SWAP_WAIT,
                           TRUE);
+          if (context->display->renderer->xlib_enable_threaded_present)
+            COGL_FLAGS_SET (context->private_features,
+                            COGL_PRIVATE_FEATURE_THREADED_PRESENT,
+                            TRUE);
         }
     }
 
@@ -1570,9 +1590,10 @@ _cogl_winsys_onscreen_deinit (CoglOnscreen *onscreen)
       glx_onscreen->swap_wait_thread = NULL;
 
       g_cond_clear (&glx_onscreen->swap_wait_cond);
+      g_cond_clear (&glx_onscreen->present_cond);
       g_mutex_clear (&glx_onscreen->swap_wait_mutex);
 
-      g_queue_free (glx_onscreen->swap_wait_queue);
+      g_queue_free_full (glx_onscreen->swap_wait_queue, free);
       glx_onscreen->swap_wait_queue = NULL;
 
       _cogl_poll_renderer_remove_fd (context->display->renderer,
@@ -1632,6 +1653,59 @@ _cogl_winsys_onscreen_deinit (CoglOnscreen *onscreen)
   onscreen->winsys = NULL;
 }
 
+static void
+wait_for_threaded_present (CoglOnscreen *onscreen)
+{
+  CoglOnscreenGLX *glx_onscreen = onscreen->winsys;
+
+  if (glx_onscreen->swap_wait_thread == NULL)
+    return;
+
+  g_mutex_lock (&glx_onscreen->swap_wait_mutex);
+  while (glx_onscreen->present_pending)
+    g_cond_wait (&glx_onscreen->present_cond, &glx_onscreen->swap_wait_mutex);
+  g_mutex_unlock (&glx_onscreen->swap_wait_mutex);
+}
+
+/* A negative interval from GLX_EXT_swap_control_tear syncs the swap to
+ * the vblank unless the frame is late, in which case it's presented
+ * right away. The EXT interval belongs to the drawable and the SGI one
+ * to the context, so the context's interval is only touched when the
+ * EXT one isn't used */
+static void
+set_swap_interval (CoglOnscreen *onscreen,
+                   GLXDrawable   drawable)
+{
+  CoglFramebuffer *fb = COGL_FRAMEBUFFER (onscreen);
+  CoglContext *context = fb->context;
+  CoglGLXRenderer *glx_renderer = context->display->renderer->winsys;
+  CoglXlibRenderer *xlib_renderer =
+    _cogl_xlib_renderer_get_data (context->display->renderer);
+
+  if (glx_renderer->have_swap_control_tear)
+    {
+      int interval;
+
+      if (!fb->config.swap_throttled)
+        interval = 0;
+      else if (fb->config.swap_tearing_allowed)
+        interval = -1;
+      else
+        interval = 1;
+
+      glx_renderer->glXSwapIntervalEXT (xlib_renderer->xdpy,
+                                        drawable,
+                                        interval);
+    }
+  else if (glx_renderer->glXSwapInterval)
+    {
+      if (fb->config.swap_throttled)
+        glx_renderer->glXSwapInterval (1);
+      else
+        glx_renderer->glXSwapInterval (0);
+    }
+}
+
 static void
 _cogl_winsys_onscreen_bind (CoglOnscreen *onscreen)
 {
@@ -1649,6 +1723,10 @@ _cogl_winsys_onscreen_bind (CoglOnscreen *onscreen)
   drawable =
     glx_onscreen->glxwin ? glx_onscreen->glxwin : xlib_onscreen->xwin;
 
+  /* This is where a new frame starts drawing into the back buffer, so
+   * the swap of the previous one has to have been issued */
+  wait_for_threaded_present (onscreen);
+
   if (glx_context->current_drawable == drawable)
     return;
 
@@ -1679,21 +1757,13 @@ _cogl_winsys_onscreen_bind (CoglOnscreen *onscreen)
    * drawable which is why we can't just do this once when the
    * framebuffer is allocated.
    *
-   * FIXME: We should check for GLX_EXT_swap_control which allows
-   * per framebuffer swap intervals. GLX_MESA_swap_control also
-   * allows per-framebuffer swap intervals but the semantics tend
-   * to be more muddled since Mesa drivers tend to expose both the
-   * MESA and SGI extensions which should technically be mutually
-   * exclusive.
+   * GLX_EXT_swap_control is only used for late swaps that may tear
+   * (see set_swap_interval()). GLX_MESA_swap_control also allows
+   * per-framebuffer swap intervals but the semantics tend to be more
+   * muddled since Mesa drivers tend to expose both the MESA and SGI
+   * extensions which should technically be mutually exclusive.
    */
-  if (glx_renderer->glXSwapInterval)
-    {
-      CoglFramebuffer *fb = COGL_FRAMEBUFFER (onscreen);
-      if (fb->config.swap_throttled)
-        glx_renderer->glXSwapInterval (1);
-      else
-        glx_renderer->glXSwapInterval (0);
-    }
+  set_swap_interval (onscreen, drawable);
 
   XSync (xlib_renderer->xdpy, False);
 
@@ -1797,6 +1867,8 @@ _cogl_winsys_onscreen_get_buffer_age (CoglOnscreen *onscreen)
   if (!_cogl_winsys_has_feature (COGL_WINSYS_FEATURE_BUFFER_AGE))
     return 0;
 
+  wait_for_threaded_present (onscreen);
+
   glx_renderer->glXQueryDrawable (xlib_renderer->xdpy, drawable, GLX_BACK_BUFFER_AGE_EXT, &age);
 
   return age;
@@ -1831,7 +1903,11 @@ threaded_swap_wait (gpointer data)
   CoglXlibRenderer *xlib_renderer = _cogl_xlib_renderer_get_data (display->renderer);
   CoglGLXDisplay *glx_display = display->winsys;
   CoglGLXRenderer *glx_renderer = display->renderer->winsys;
+  CoglOnscreenXlib *xlib_onscreen = onscreen->winsys;
+  GLXDrawable drawable =
+    glx_onscreen->glxwin ? glx_onscreen->glxwin : xlib_onscreen->xwin;
   GLXDrawable dummy_drawable;
+  CoglBool drawable_bound = FALSE;
 
   if (glx_display->dummy_glxwin)
     dummy_drawable = glx_display->dummy_glxwin;
@@ -1847,8 +1923,9 @@ threaded_swap_wait (gpointer data)
 
   while (TRUE)
     {
-      gpointer queue_element;
+      CoglSwapWaitRequest *request;
       uint32_t vblank_counter;
+      CoglBool present;
 
       while (!glx_onscreen->closing_down && glx_onscreen->swap_wait_queue->length == 0)
          g_cond_wait (&glx_onscreen->swap_wait_cond, &glx_onscreen->swap_wait_mutex);
@@ -1856,10 +1933,38 @@ threaded_swap_wait (gpointer data)
       if (glx_onscreen->closing_down)
          break;
 
-      queue_element = g_queue_pop_tail (glx_onscreen->swap_wait_queue);
-      vblank_counter = GPOINTER_TO_UINT(queue_element);
+      request = g_queue_pop_tail (glx_onscreen->swap_wait_queue);
+      vblank_counter = request->vblank_counter;
+      present = request->present;
+      free (request);
 
       g_mutex_unlock (&glx_onscreen->swap_wait_mutex);
+
+      if (present)
+        {
+          /* The main thread has finished drawing the frame, so the
+           * swap can be issued from our context. The swap interval
+           * belongs to the context, so it has to be set on ours too */
+          if (!drawable_bound)
+            {
+              glx_renderer->glXMakeContextCurrent (xlib_renderer->xdpy,
+                                                   drawable,
+                                                   drawable,
+                                                   glx_onscreen->swap_wait_context);
+              if (!glx_renderer->have_swap_control_tear &&
+                  glx_renderer->glXSwapInterval)
+                glx_renderer->glXSwapInterval (1);
+              drawable_bound = TRUE;
+            }
+
+          glx_renderer->glXSwapBuffers (xlib_renderer->xdpy, drawable);
+
+          g_mutex_lock (&glx_onscreen->swap_wait_mutex);
+          glx_onscreen->present_pending = FALSE;
+          g_cond_broadcast (&glx_onscreen->present_cond);
+          g_mutex_unlock (&glx_onscreen->swap_wait_mutex);
+        }
+
       glx_renderer->glXWaitVideoSync (2,
                                       (vblank_counter + 1) % 2,
                                       &vblank_counter);
@@ -1951,11 +2056,13 @@ threaded_swap_wait_pipe_dispatch (void *user_data, int revents)
 
 static void
 start_threaded_swap_wait (CoglOnscreen *onscreen,
-                           uint32_t      vblank_counter)
+                           uint32_t      vblank_counter,
+                           CoglBool      present)
 {
   CoglOnscreenGLX *glx_onscreen = onscreen->winsys;
   CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
   CoglContext *context = framebuffer->context;
+  CoglSwapWaitRequest *request;
 
   if (glx_onscreen->swap_wait_thread == NULL)
     {
@@ -1994,6 +2101,7 @@ start_threaded_swap_wait (CoglOnscreen *onscreen,
       glx_onscreen->swap_wait_queue = g_queue_new ();
       g_mutex_init (&glx_onscreen->swap_wait_mutex);
       g_cond_init (&glx_onscreen->swap_wait_cond);
+      g_cond_init (&glx_onscreen->present_cond);
       glx_onscreen->swap_wait_context =
          glx_renderer->glXCreateNewContext (xlib_renderer->xdpy,
                                             glx_display->fbconfig,
@@ -2005,8 +2113,14 @@ start_threaded_swap_wait (CoglOnscreen *onscreen,
                                                      onscreen);
     }
 
+  request = g_new (CoglSwapWaitRequest, 1);
+  request->vblank_counter = vblank_counter;
+  request->present = present;
+
   g_mutex_lock (&glx_onscreen->swap_wait_mutex);
-  g_queue_push_head (glx_onscreen->swap_wait_queue, GUINT_TO_POINTER(vblank_counter));
+  if (present)
+    glx_onscreen->present_pending = TRUE;
+  g_queue_push_head (glx_onscreen->swap_wait_queue, request);
   g_cond_signal (&glx_onscreen->swap_wait_cond);
   g_mutex_unlock (&glx_onscreen->swap_wait_mutex);
 }
@@ -2240,6 +2354,7 @@ _cogl_winsys_onscreen_swap_buffers_with_damage (CoglOnscreen *onscreen,
   CoglOnscreenXlib *xlib_onscreen = onscreen->winsys;
   CoglOnscreenGLX *glx_onscreen = onscreen->winsys;
   CoglBool have_counter;
+  CoglBool threaded_present = FALSE;
   GLXDrawable drawable;
 
   /* XXX: theoretically this shouldn't be necessary but at least with
@@ -2272,7 +2387,17 @@ _cogl_winsys_onscreen_swap_buffers_with_damage (CoglOnscreen *onscreen,
 	       * waits for the buffer swap to happen.)
 	       */
               _cogl_winsys_wait_for_gpu (onscreen);
-              start_threaded_swap_wait (onscreen, _cogl_winsys_get_vsync_counter (context));
+
+              /* Since the frame has been finished the swap can be left
+               * to the swap wait thread, which then takes any time the
+               * driver spends throttling us */
+              threaded_present =
+                _cogl_has_private_feature (context,
+                                           COGL_PRIVATE_FEATURE_THREADED_PRESENT);
+
+              start_threaded_swap_wait (onscreen,
+                                        _cogl_winsys_get_vsync_counter (context),
+                                        threaded_present);
             }
         }
       else
@@ -2318,6 +2443,15 @@ _cogl_winsys_onscreen_swap_buffers_with_damage (CoglOnscreen *onscreen,
   else
     have_counter = FALSE;
 
+  if (threaded_present)
+    {
+      /* Make the next draw rebind the onscreen, which waits for the
+       * swap to be issued before the back buffer is touched again */
+      context->current_draw_buffer_changes |= COGL_FRAMEBUFFER_STATE_BIND;
+      set_frame_info_output (onscreen, xlib_onscreen->output);
+      return;
+    }
+
   glx_renderer->glXSwapBuffers (xlib_renderer->xdpy, drawable);
 
   if (have_counter)
@@ -145,6 +145,11 @@ typedef struct _CoglWinsysVtable
   int
   (*onscreen_get_buffer_age) (CoglOnscreen *onscreen);
 
+  void
+  (*onscreen_queue_damage_region) (CoglOnscreen *onscreen,
+                                   const int *rectangles,
+                                   int n_rectangles);
+
   uint32_t
   (*onscreen_x11_get_window_xid) (CoglOnscreen *onscreen);
 
@@ -174,6 +174,18 @@ paint (TestState *state)
   draw_path_at (path_a, white, 11, 0);
 
   cogl_object_unref (path_a);
+
+  /* Draw the two sub paths from block 9 again but with the
+     translation built into the path. This should share the geometry
+     of the first path */
+  path_a = cogl_path_new ();
+  cogl_path_rectangle (path_a,
+                       BLOCK_SIZE * 12, 0, BLOCK_SIZE * 13, BLOCK_SIZE);
+  cogl_path_rectangle (path_a,
+                       BLOCK_SIZE * 12 + BLOCK_SIZE / 2, BLOCK_SIZE / 2,
+                       BLOCK_SIZE * 13, BLOCK_SIZE);
+  draw_path_at (path_a, white, 0, 0);
+  cogl_object_unref (path_a);
 }
 
 static void
@@ -191,6 +203,7 @@ validate_result ()
   check_block (9, 0, 0x7 /* all but bottom right */);
   check_block (10, 0, 0xc /* bottom two */);
   check_block (11, 0, 0xd /* all but top right */);
+  check_block (12, 0, 0x7 /* all but bottom right */);
 }
 
 void
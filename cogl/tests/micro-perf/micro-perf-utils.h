@@ -0,0 +1,34 @@
+#ifndef __MICRO_PERF_UTILS_H__
+#define __MICRO_PERF_UTILS_H__
+
+#include <glib.h>
+#include <cogl/cogl.h>
+
+/* Unless COGL_DRIVER or COGL_RENDERER say otherwise the benchmarks
+ * run on the nop driver and the stub winsys, which need neither a
+ * display nor a GPU, so what they time is Cogl's own CPU overhead */
+static inline CoglContext *
+micro_perf_context_new (void)
+{
+  CoglContext *ctx;
+  CoglError *error = NULL;
+
+  g_setenv ("COGL_DRIVER", "nop", FALSE);
+  g_setenv ("COGL_RENDERER", "stub", FALSE);
+
+  ctx = cogl_context_new (NULL, &error);
+  if (ctx == NULL)
+    g_error ("Failed to create a CoglContext: %s", error->message);
+
+  return ctx;
+}
+
+static inline void
+micro_perf_report (const char *name,
+                   double elapsed,
+                   int n_iterations)
+{
+  g_print ("  %-40s %10.1f ns\n", name, elapsed * 1e9 / n_iterations);
+}
+
+#endif /* __MICRO_PERF_UTILS_H__ */
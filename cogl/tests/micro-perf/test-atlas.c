@@ -0,0 +1,115 @@
+#include <glib.h>
+#include <cogl/cogl.h>
+
+#include "cogl/cogl-atlas.h"
+#include "micro-perf-utils.h"
+
+/* Times filling an atlas with glyph sized rectangles, including the
+ * migrations when it has to grow, with each packing strategy, and
+ * creating atlas textures the way small window icons and glyphs do */
+
+#define N_RECTANGLES 4000
+#define N_ROUNDS 10
+#define N_TEXTURES 2000
+
+static const struct
+{
+  const char *name;
+  CoglAtlasFlags flags;
+} strategies[] =
+  {
+    { "tree", 0 },
+    { "skyline", COGL_ATLAS_SKYLINE_PACKING },
+    { "tree, incremental migration", COGL_ATLAS_INCREMENTAL_MIGRATION },
+    { "skyline, incremental migration",
+      COGL_ATLAS_SKYLINE_PACKING | COGL_ATLAS_INCREMENTAL_MIGRATION },
+  };
+
+static void
+update_position_cb (void *user_data,
+                    CoglTexture *new_texture,
+                    const CoglRectangleMapEntry *rect)
+{
+}
+
+int
+main (int argc, char **argv)
+{
+  CoglContext *ctx;
+  GTimer *timer;
+  unsigned int sizes[N_RECTANGLES][2];
+  int i, j, s;
+
+  ctx = micro_perf_context_new ();
+  timer = g_timer_new ();
+
+  /* Roughly the spread of glyph sizes of a UI font */
+  for (i = 0; i < N_RECTANGLES; i++)
+    {
+      sizes[i][0] = g_random_int_range (4, 20);
+      sizes[i][1] = g_random_int_range (8, 24);
+    }
+
+  g_print ("atlas reserve space, per rectangle:\n");
+
+  for (s = 0; s < G_N_ELEMENTS (strategies); s++)
+    {
+      CoglAtlasStats stats;
+      double elapsed = 0;
+
+      for (j = 0; j < N_ROUNDS; j++)
+        {
+          CoglAtlas *atlas =
+            _cogl_atlas_new (COGL_PIXEL_FORMAT_A_8,
+                             strategies[s].flags,
+                             update_position_cb);
+
+          g_timer_start (timer);
+          for (i = 0; i < N_RECTANGLES; i++)
+            _cogl_atlas_reserve_space (atlas,
+                                       sizes[i][0], sizes[i][1],
+                                       GINT_TO_POINTER (i + 1));
+          elapsed += g_timer_elapsed (timer, NULL);
+
+          _cogl_atlas_get_stats (atlas, &stats);
+          cogl_object_unref (atlas);
+        }
+
+      micro_perf_report (strategies[s].name, elapsed,
+                         N_RECTANGLES * N_ROUNDS);
+      g_print ("    %ux%u, %u grows, %u reorganizations moving %u rectangles\n",
+               stats.width, stats.height, stats.n_grows,
+               stats.n_reorganizations, stats.n_migrated_rectangles);
+    }
+
+  g_print ("atlas textures:\n");
+
+  {
+    CoglTexture **textures = g_new (CoglTexture *, N_TEXTURES);
+
+    g_timer_start (timer);
+    for (i = 0; i < N_TEXTURES; i++)
+      {
+        textures[i] =
+          cogl_atlas_texture_new_with_size (ctx,
+                                            sizes[i][0] * 2,
+                                            sizes[i][1] * 2);
+        cogl_texture_allocate (textures[i], NULL);
+      }
+    micro_perf_report ("new and allocate",
+                       g_timer_elapsed (timer, NULL), N_TEXTURES);
+
+    g_timer_start (timer);
+    for (i = 0; i < N_TEXTURES; i++)
+      cogl_object_unref (textures[i]);
+    micro_perf_report ("unref",
+                       g_timer_elapsed (timer, NULL), N_TEXTURES);
+
+    g_free (textures);
+  }
+
+  g_timer_destroy (timer);
+  cogl_object_unref (ctx);
+
+  return 0;
+}
@@ -0,0 +1,113 @@
+#include <glib.h>
+#include <cogl/cogl.h>
+#include <string.h>
+
+#include "cogl/cogl-bitmap-kernels-private.h"
+
+/* Times each implementation of the bitmap conversion kernels on rows
+ * the size of a typical window-sized ARGB image */
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define N_ITERATIONS 20
+
+typedef enum
+{
+  OP_SWIZZLE,
+  OP_PREMULT,
+  OP_UNPREMULT
+} Op;
+
+static const struct
+{
+  const char *name;
+  Op op;
+  int alpha_index;
+  uint8_t order[4];
+} ops[] =
+  {
+    { "ARGB -> RGBA", OP_SWIZZLE, 0, { 1, 2, 3, 0 } },
+    { "RGBA -> BGRA", OP_SWIZZLE, 0, { 2, 1, 0, 3 } },
+    { "premult alpha last", OP_PREMULT, 3 },
+    { "premult alpha first", OP_PREMULT, 0 },
+    { "unpremult alpha last", OP_UNPREMULT, 3 },
+    { "unpremult alpha first", OP_UNPREMULT, 0 },
+  };
+
+static void
+run_op (const CoglBitmapKernels *kernels,
+        int op,
+        const uint8_t *src,
+        uint8_t *dst)
+{
+  int y;
+
+  for (y = 0; y < HEIGHT; y++)
+    {
+      const uint8_t *src_row = src + y * WIDTH * 4;
+      uint8_t *dst_row = dst + y * WIDTH * 4;
+
+      switch (ops[op].op)
+        {
+        case OP_SWIZZLE:
+          kernels->swizzle (src_row, dst_row, ops[op].order, WIDTH);
+          break;
+        case OP_PREMULT:
+          kernels->premult (dst_row, ops[op].alpha_index, WIDTH);
+          break;
+        case OP_UNPREMULT:
+          kernels->unpremult (dst_row, ops[op].alpha_index, WIDTH);
+          break;
+        }
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  const CoglBitmapKernels *impls;
+  uint8_t *src, *dst;
+  GTimer *timer;
+  int n_impls, i, op, j;
+
+  src = g_malloc (WIDTH * HEIGHT * 4);
+  dst = g_malloc (WIDTH * HEIGHT * 4);
+
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    src[i] = g_random_int_range (0, 256);
+
+  timer = g_timer_new ();
+
+  impls = _cogl_bitmap_kernels_get_impls (&n_impls);
+
+  for (op = 0; op < G_N_ELEMENTS (ops); op++)
+    {
+      g_print ("%s:\n", ops[op].name);
+
+      for (i = 0; i < n_impls; i++)
+        {
+          double elapsed = 0;
+
+          for (j = 0; j < N_ITERATIONS; j++)
+            {
+              /* The in place operations start from the same data every
+                 time */
+              memcpy (dst, src, WIDTH * HEIGHT * 4);
+
+              g_timer_start (timer);
+              run_op (&impls[i], op, src, dst);
+              elapsed += g_timer_elapsed (timer, NULL);
+            }
+
+          g_print ("  %-6s %8.3f ns/pixel\n",
+                   impls[i].name,
+                   elapsed * 1e9 / ((double) WIDTH * HEIGHT * N_ITERATIONS));
+        }
+    }
+
+  g_timer_destroy (timer);
+  g_free (dst);
+  g_free (src);
+
+  return 0;
+}
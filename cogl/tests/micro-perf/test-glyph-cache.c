@@ -0,0 +1,137 @@
+#include <glib.h>
+#include <cogl/cogl.h>
+#include <cogl-pango/cogl-pango.h>
+
+#include "cogl-pango/cogl-pango-glyph-cache.h"
+#include "micro-perf-utils.h"
+
+/* Times populating the glyph cache with the glyphs of a few UI font
+ * sizes, the way the first paint of a panel or menu does, and looking
+ * up glyphs that are already cached */
+
+#define N_ROUNDS 20
+#define N_LOOKUPS 1000000
+
+typedef struct
+{
+  PangoFont *font;
+  PangoGlyph glyph;
+} Glyph;
+
+static void
+add_glyphs (PangoContext *context,
+            const char *font_name,
+            GArray *glyphs)
+{
+  PangoFontDescription *desc;
+  PangoLayout *layout;
+  PangoLayoutIter *iter;
+  GString *text;
+  int c;
+
+  text = g_string_new (NULL);
+  for (c = 0x21; c < 0x7f; c++)
+    g_string_append_c (text, c);
+
+  layout = pango_layout_new (context);
+  desc = pango_font_description_from_string (font_name);
+  pango_layout_set_font_description (layout, desc);
+  pango_layout_set_text (layout, text->str, -1);
+
+  iter = pango_layout_get_iter (layout);
+  do
+    {
+      PangoLayoutRun *run = pango_layout_iter_get_run_readonly (iter);
+      int i;
+
+      if (run == NULL)
+        continue;
+
+      for (i = 0; i < run->glyphs->num_glyphs; i++)
+        {
+          Glyph glyph;
+
+          glyph.font = g_object_ref (run->item->analysis.font);
+          glyph.glyph = run->glyphs->glyphs[i].glyph;
+          g_array_append_val (glyphs, glyph);
+        }
+    }
+  while (pango_layout_iter_next_run (iter));
+
+  pango_layout_iter_free (iter);
+  pango_font_description_free (desc);
+  g_object_unref (layout);
+  g_string_free (text, TRUE);
+}
+
+int
+main (int argc, char **argv)
+{
+  static const char *font_names[] = { "Sans 9", "Sans 10", "Sans Bold 10", "Sans 14" };
+  CoglContext *ctx;
+  PangoFontMap *font_map;
+  PangoContext *context;
+  CoglPangoGlyphCache *cache;
+  GArray *glyphs;
+  GTimer *timer;
+  double elapsed = 0;
+  int i, j;
+
+  ctx = micro_perf_context_new ();
+
+  font_map = cogl_pango_font_map_new ();
+  context = cogl_pango_font_map_create_context (COGL_PANGO_FONT_MAP (font_map));
+
+  glyphs = g_array_new (FALSE, FALSE, sizeof (Glyph));
+  for (i = 0; i < G_N_ELEMENTS (font_names); i++)
+    add_glyphs (context, font_names[i], glyphs);
+
+  timer = g_timer_new ();
+
+  g_print ("glyph cache, %u glyphs:\n", glyphs->len);
+
+  for (j = 0; j < N_ROUNDS; j++)
+    {
+      cache = cogl_pango_glyph_cache_new (ctx, FALSE, FALSE);
+
+      g_timer_start (timer);
+      for (i = 0; i < glyphs->len; i++)
+        {
+          Glyph *glyph = &g_array_index (glyphs, Glyph, i);
+          cogl_pango_glyph_cache_lookup (cache, TRUE,
+                                         glyph->font, glyph->glyph);
+        }
+      elapsed += g_timer_elapsed (timer, NULL);
+
+      cogl_pango_glyph_cache_free (cache);
+    }
+  micro_perf_report ("populate, per glyph", elapsed, glyphs->len * N_ROUNDS);
+
+  cache = cogl_pango_glyph_cache_new (ctx, FALSE, FALSE);
+  for (i = 0; i < glyphs->len; i++)
+    {
+      Glyph *glyph = &g_array_index (glyphs, Glyph, i);
+      cogl_pango_glyph_cache_lookup (cache, TRUE, glyph->font, glyph->glyph);
+    }
+
+  g_timer_start (timer);
+  for (i = 0; i < N_LOOKUPS; i++)
+    {
+      Glyph *glyph = &g_array_index (glyphs, Glyph, i % glyphs->len);
+      cogl_pango_glyph_cache_lookup (cache, TRUE, glyph->font, glyph->glyph);
+    }
+  micro_perf_report ("cached lookup", g_timer_elapsed (timer, NULL), N_LOOKUPS);
+
+  cogl_pango_glyph_cache_free (cache);
+
+  for (i = 0; i < glyphs->len; i++)
+    g_object_unref (g_array_index (glyphs, Glyph, i).font);
+  g_array_free (glyphs, TRUE);
+
+  g_timer_destroy (timer);
+  g_object_unref (context);
+  g_object_unref (font_map);
+  cogl_object_unref (ctx);
+
+  return 0;
+}
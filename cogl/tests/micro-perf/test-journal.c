@@ -1,8 +1,10 @@
 #include <glib.h>
 #include <cogl/cogl.h>
 #include <math.h>
+#include <string.h>
 
 #include "cogl/cogl-profile.h"
+#include "cogl/cogl-journal-transform-private.h"
 
 #define FRAMEBUFFER_WIDTH 800
 #define FRAMEBUFFER_HEIGHT 600
@@ -100,6 +102,59 @@ test_rectangles (Data *data)
   cogl_framebuffer_pop_clip (data->fb);
 }
 
+/* Times the implementations of the journal's vertex transform against
+ * each other on the same data, laid out as the journal logs 1-layer
+ * quads: a color word followed by two corners of position and texture
+ * coordinates each. */
+static void
+benchmark_transforms (void)
+{
+#define N_QUADS 10000
+#define N_ITERATIONS 1000
+  const size_t corner_stride = 4, quad_stride = 9, vertex_stride = 8;
+  const CoglJournalTransformImpl *impls;
+  CoglMatrix matrix;
+  float *vin, *vout;
+  GTimer *timer;
+  int n_impls, i, j;
+
+  vin = g_new (float, N_QUADS * quad_stride);
+  vout = g_new (float, N_QUADS * vertex_stride * 4);
+
+  for (i = 0; i < N_QUADS * quad_stride; i++)
+    vin[i] = g_random_double_range (-1000, 1000);
+
+  cogl_matrix_init_identity (&matrix);
+  cogl_matrix_translate (&matrix, 100, 50, 0);
+  cogl_matrix_rotate (&matrix, 45, 0, 0, 1);
+
+  timer = g_timer_new ();
+
+  impls = _cogl_journal_transform_get_impls (&n_impls);
+
+  for (i = 0; i < n_impls; i++)
+    {
+      double elapsed;
+
+      g_timer_start (timer);
+
+      for (j = 0; j < N_ITERATIONS; j++)
+        impls[i].func (&matrix,
+                       vin + 1, corner_stride, quad_stride,
+                       vout, vertex_stride,
+                       N_QUADS);
+
+      elapsed = g_timer_elapsed (timer, NULL);
+
+      g_print ("%-6s %8.2f ns/quad\n",
+               impls[i].name, elapsed * 1e9 / (N_QUADS * N_ITERATIONS));
+    }
+
+  g_timer_destroy (timer);
+  g_free (vout);
+  g_free (vin);
+}
+
 static CoglBool
 paint_cb (void *user_data)
 {
@@ -146,6 +201,12 @@ main (int argc, char **argv)
                       "The time spent in the glib mainloop",
                       0);  // no application private data
 
+  if (argc > 1 && !strcmp (argv[1], "--transform"))
+    {
+      benchmark_transforms ();
+      return 0;
+    }
+
   data.ctx = cogl_context_new (NULL, NULL);
 
   onscreen = cogl_onscreen_new (data.ctx,
@@ -0,0 +1,113 @@
+#include <glib.h>
+#include <cogl/cogl.h>
+#include <string.h>
+
+#include "cogl/cogl-matrix-kernels-private.h"
+
+/* Times each implementation of the matrix kernels on what painting a
+ * stage does for every actor: composing its transform from its
+ * parent's and projecting the corners of its paint volume */
+
+#define N_ACTORS 10000
+#define DEPTH 8
+#define N_ITERATIONS 50
+
+static void
+init_actor_transform (float *m, int seed)
+{
+  float angle = seed * 0.01f;
+  float c = cosf (angle), s = sinf (angle);
+  float scale = 1.0f + (seed % 7) * 0.05f;
+
+  /* A rotation about z, a scale and a translation like
+     clutter_actor_apply_transform builds */
+  memset (m, 0, sizeof (float) * 16);
+  m[0] = c * scale;
+  m[1] = s * scale;
+  m[4] = -s * scale;
+  m[5] = c * scale;
+  m[10] = 1.0f;
+  m[12] = seed % 100;
+  m[13] = seed % 50;
+  m[15] = 1.0f;
+}
+
+static void
+run_actors (const CoglMatrixKernels *kernels,
+            const float (*transforms)[16],
+            const CoglMatrix *projection,
+            float *corners_out)
+{
+  static const float corners[4][3] =
+    { { 0, 0, 0 }, { 100, 0, 0 }, { 100, 50, 0 }, { 0, 50, 0 } };
+  CoglMatrix modelview;
+  float stack[DEPTH + 1][16];
+  int i, j;
+
+  memcpy (stack[0], projection, sizeof (float) * 16);
+
+  for (i = 0; i < N_ACTORS; i++)
+    {
+      /* Every DEPTH actors start again from the stage so the
+         hierarchy is DEPTH levels deep */
+      j = i % DEPTH;
+
+      kernels->multiply4x4 (stack[j + 1], stack[j], transforms[i]);
+
+      memcpy (&modelview, stack[j + 1], sizeof (float) * 16);
+      kernels->transform_points (&modelview,
+                                 3, /* n_components */
+                                 sizeof (float) * 3,
+                                 corners,
+                                 4, /* n_out_components */
+                                 sizeof (float) * 4,
+                                 corners_out + i * 16,
+                                 4 /* n_points */);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  const CoglMatrixKernels *impls;
+  float (*transforms)[16];
+  float *corners_out;
+  CoglMatrix projection;
+  GTimer *timer;
+  int n_impls, i, j;
+
+  transforms = g_new (float[16], N_ACTORS);
+  corners_out = g_new (float, N_ACTORS * 16);
+
+  for (i = 0; i < N_ACTORS; i++)
+    init_actor_transform (transforms[i], i);
+
+  cogl_matrix_init_identity (&projection);
+  cogl_matrix_perspective (&projection, 60, 16.0f / 9.0f, 0.1f, 100.0f);
+
+  timer = g_timer_new ();
+
+  impls = _cogl_matrix_kernels_get_impls (&n_impls);
+
+  for (i = 0; i < n_impls; i++)
+    {
+      g_timer_start (timer);
+
+      for (j = 0; j < N_ITERATIONS; j++)
+        run_actors (&impls[i],
+                    (const float (*)[16]) transforms,
+                    &projection,
+                    corners_out);
+
+      g_print ("%-6s %8.3f ns/actor\n",
+               impls[i].name,
+               g_timer_elapsed (timer, NULL) * 1e9 /
+               ((double) N_ACTORS * N_ITERATIONS));
+    }
+
+  g_timer_destroy (timer);
+  g_free (corners_out);
+  g_free (transforms);
+
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include <glib.h>
+#include <cogl/cogl.h>
+
+#include "micro-perf-utils.h"
+
+/* Times what painting a stage asks of a matrix stack for every actor:
+ * pushing, applying the actor's transform, resolving the resulting
+ * matrix and popping. test-matrix-kernels times only the arithmetic */
+
+#define N_ACTORS 10000
+#define DEPTH 8
+#define N_ITERATIONS 20
+
+static void
+paint_actors (CoglMatrixStack *stack,
+              CoglBool resolve)
+{
+  CoglMatrix matrix;
+  int i, depth = 0;
+
+  for (i = 0; i < N_ACTORS; i++)
+    {
+      /* Every DEPTH actors go back up to the stage so the hierarchy
+         is DEPTH levels deep */
+      if (depth == DEPTH)
+        {
+          for (; depth > 0; depth--)
+            cogl_matrix_stack_pop (stack);
+        }
+
+      cogl_matrix_stack_push (stack);
+      depth++;
+
+      cogl_matrix_stack_translate (stack, i % 100, i % 50, 0);
+      if (i % 3 == 0)
+        cogl_matrix_stack_rotate (stack, i % 360, 0, 0, 1);
+      if (i % 5 == 0)
+        cogl_matrix_stack_scale (stack, 1.1f, 1.1f, 1);
+
+      if (resolve)
+        cogl_matrix_stack_get (stack, &matrix);
+    }
+
+  for (; depth > 0; depth--)
+    cogl_matrix_stack_pop (stack);
+}
+
+int
+main (int argc, char **argv)
+{
+  CoglContext *ctx;
+  CoglMatrixStack *stack;
+  GTimer *timer;
+  int i;
+
+  ctx = micro_perf_context_new ();
+  timer = g_timer_new ();
+
+  stack = cogl_matrix_stack_new (ctx);
+  cogl_matrix_stack_perspective (stack, 60, 16.0f / 9.0f, 0.1f, 100);
+
+  g_print ("matrix stack, per actor:\n");
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    paint_actors (stack, FALSE);
+  micro_perf_report ("push, transform, pop",
+                     g_timer_elapsed (timer, NULL), N_ACTORS * N_ITERATIONS);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    paint_actors (stack, TRUE);
+  micro_perf_report ("push, transform, resolve, pop",
+                     g_timer_elapsed (timer, NULL), N_ACTORS * N_ITERATIONS);
+
+  cogl_object_unref (stack);
+  g_timer_destroy (timer);
+  cogl_object_unref (ctx);
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include <glib.h>
+#include <cogl/cogl.h>
+
+#include "cogl/cogl-pipeline-private.h"
+#include "cogl/cogl-pipeline-layer-private.h"
+#include "micro-perf-utils.h"
+
+/* Times making per actor copies of a template pipeline, the way
+ * meta_shaped_texture_paint() does for every window each frame, and
+ * the hashing and comparison the journal does to batch them */
+
+#define N_ITERATIONS 100000
+#define N_PIPELINES 1024
+#define N_TEXTURES 16
+
+static CoglPipeline *
+create_template (CoglContext *ctx)
+{
+  CoglPipeline *template = cogl_pipeline_new (ctx);
+
+  cogl_pipeline_set_layer_wrap_mode (template, 0,
+                                     COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
+  cogl_pipeline_set_layer_wrap_mode (template, 1,
+                                     COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
+  cogl_pipeline_set_layer_combine (template, 1,
+                                   "RGBA = MODULATE (PREVIOUS, TEXTURE[A])",
+                                   NULL);
+
+  return template;
+}
+
+static CoglPipeline *
+copy_template (CoglPipeline *template,
+               CoglTexture *texture,
+               CoglTexture *mask)
+{
+  CoglPipeline *pipeline = cogl_pipeline_copy (template);
+
+  cogl_pipeline_set_layer_texture (pipeline, 0, texture);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_LINEAR,
+                                   COGL_PIPELINE_FILTER_LINEAR);
+  cogl_pipeline_set_layer_texture (pipeline, 1, mask);
+  cogl_pipeline_set_layer_filters (pipeline, 1,
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+
+  return pipeline;
+}
+
+int
+main (int argc, char **argv)
+{
+  /* The state the journal compares entries on */
+  unsigned int state = COGL_PIPELINE_STATE_ALL & ~COGL_PIPELINE_STATE_COLOR;
+  CoglContext *ctx;
+  CoglPipeline *template;
+  CoglPipeline *pipelines[N_PIPELINES];
+  CoglTexture *textures[N_TEXTURES];
+  CoglTexture *mask;
+  GTimer *timer;
+  unsigned int hash = 0;
+  int n_equal = 0;
+  int i;
+
+  ctx = micro_perf_context_new ();
+
+  for (i = 0; i < N_TEXTURES; i++)
+    textures[i] = cogl_texture_2d_new_with_size (ctx, 256, 256);
+  mask = cogl_texture_2d_new_with_size (ctx, 256, 256);
+
+  template = create_template (ctx);
+  timer = g_timer_new ();
+
+  g_print ("pipelines:\n");
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    {
+      CoglPipeline *pipeline = cogl_pipeline_new (ctx);
+      cogl_pipeline_set_color4f (pipeline, 1, 1, 1, 0.5);
+      cogl_object_unref (pipeline);
+    }
+  micro_perf_report ("new and set color",
+                     g_timer_elapsed (timer, NULL), N_ITERATIONS);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    {
+      CoglPipeline *pipeline =
+        copy_template (template, textures[i % N_TEXTURES], mask);
+      cogl_object_unref (pipeline);
+    }
+  micro_perf_report ("copy of a template with two layers",
+                     g_timer_elapsed (timer, NULL), N_ITERATIONS);
+
+  /* What the journal would be batching, built up front so that only
+     the hashing and comparing is timed */
+  for (i = 0; i < N_PIPELINES; i++)
+    pipelines[i] = copy_template (template, textures[i % N_TEXTURES], mask);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_PIPELINES; i++)
+    hash ^= _cogl_pipeline_hash (pipelines[i], state,
+                                 COGL_PIPELINE_LAYER_STATE_ALL, 0);
+  micro_perf_report ("hash, first time",
+                     g_timer_elapsed (timer, NULL), N_PIPELINES);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    hash ^= _cogl_pipeline_hash (pipelines[i % N_PIPELINES], state,
+                                 COGL_PIPELINE_LAYER_STATE_ALL, 0);
+  micro_perf_report ("hash, cached",
+                     g_timer_elapsed (timer, NULL), N_ITERATIONS);
+
+  /* Neighbours share the template but not the texture, except every
+     N_TEXTURES pipelines where they are equal */
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    n_equal += _cogl_pipeline_equal (pipelines[i % N_PIPELINES],
+                                     pipelines[(i + 1) % N_PIPELINES],
+                                     state,
+                                     COGL_PIPELINE_LAYER_STATE_ALL,
+                                     0);
+  micro_perf_report ("equal, different textures",
+                     g_timer_elapsed (timer, NULL), N_ITERATIONS);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    n_equal += _cogl_pipeline_equal (pipelines[i % N_PIPELINES],
+                                     pipelines[(i + N_TEXTURES) % N_PIPELINES],
+                                     state,
+                                     COGL_PIPELINE_LAYER_STATE_ALL,
+                                     0);
+  micro_perf_report ("equal, same textures",
+                     g_timer_elapsed (timer, NULL), N_ITERATIONS);
+
+  /* Keeps the results live */
+  if (hash == 0 && n_equal == 0)
+    g_print ("\n");
+
+  for (i = 0; i < N_PIPELINES; i++)
+    cogl_object_unref (pipelines[i]);
+  for (i = 0; i < N_TEXTURES; i++)
+    cogl_object_unref (textures[i]);
+  cogl_object_unref (mask);
+  cogl_object_unref (template);
+  g_timer_destroy (timer);
+  cogl_object_unref (ctx);
+
+  return 0;
+}
@@ -0,0 +1,136 @@
+#include <glib.h>
+#include <cogl/cogl.h>
+
+#include "cogl/cogl-private.h"
+#include "cogl/cogl-bitmap-private.h"
+#include "micro-perf-utils.h"
+
+/* Times whole bitmap conversions, which the kernels benchmarked by
+ * test-bitmap-kernels are only the inner loop of, and reading back
+ * from a framebuffer, as screenshots and picking do */
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define N_ITERATIONS 20
+#define N_READS 10000
+
+static const struct
+{
+  const char *name;
+  CoglPixelFormat src_format;
+  CoglPixelFormat dst_format;
+} conversions[] =
+  {
+    { "ARGB premult -> RGBA premult",
+      COGL_PIXEL_FORMAT_ARGB_8888_PRE, COGL_PIXEL_FORMAT_RGBA_8888_PRE },
+    { "BGRA -> BGRA premult",
+      COGL_PIXEL_FORMAT_BGRA_8888, COGL_PIXEL_FORMAT_BGRA_8888_PRE },
+    { "RGBA premult -> RGBA",
+      COGL_PIXEL_FORMAT_RGBA_8888_PRE, COGL_PIXEL_FORMAT_RGBA_8888 },
+    { "RGB -> RGBA premult",
+      COGL_PIXEL_FORMAT_RGB_888, COGL_PIXEL_FORMAT_RGBA_8888_PRE },
+    { "RGBA -> A",
+      COGL_PIXEL_FORMAT_RGBA_8888, COGL_PIXEL_FORMAT_A_8 },
+  };
+
+int
+main (int argc, char **argv)
+{
+  CoglContext *ctx;
+  CoglTexture *texture;
+  CoglOffscreen *offscreen;
+  CoglFramebuffer *fb;
+  CoglPipeline *pipeline;
+  uint8_t *data, *pixels;
+  GTimer *timer;
+  int i, j;
+
+  ctx = micro_perf_context_new ();
+  timer = g_timer_new ();
+
+  data = g_malloc (WIDTH * HEIGHT * 4);
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    data[i] = g_random_int_range (0, 256);
+
+  g_print ("bitmap conversion, per pixel:\n");
+
+  for (i = 0; i < G_N_ELEMENTS (conversions); i++)
+    {
+      int bpp = _cogl_pixel_format_get_bytes_per_pixel (conversions[i].src_format);
+      CoglBitmap *src_bmp = cogl_bitmap_new_for_data (ctx, WIDTH, HEIGHT,
+                                                      conversions[i].src_format,
+                                                      WIDTH * bpp,
+                                                      data);
+      double elapsed = 0;
+
+      for (j = 0; j < N_ITERATIONS; j++)
+        {
+          CoglBitmap *dst_bmp;
+
+          g_timer_start (timer);
+          dst_bmp = _cogl_bitmap_convert (src_bmp,
+                                          conversions[i].dst_format,
+                                          NULL);
+          elapsed += g_timer_elapsed (timer, NULL);
+
+          cogl_object_unref (dst_bmp);
+        }
+
+      micro_perf_report (conversions[i].name, elapsed,
+                         WIDTH * HEIGHT * N_ITERATIONS);
+      cogl_object_unref (src_bmp);
+    }
+
+  texture = cogl_texture_2d_new_with_size (ctx, WIDTH, HEIGHT);
+  offscreen = cogl_offscreen_new_with_texture (texture);
+  fb = COGL_FRAMEBUFFER (offscreen);
+  cogl_framebuffer_allocate (fb, NULL);
+  cogl_framebuffer_orthographic (fb, 0, 0, WIDTH, HEIGHT, -1, 100);
+
+  pipeline = cogl_pipeline_new (ctx);
+  cogl_pipeline_set_color4f (pipeline, 1, 0, 0, 1);
+
+  pixels = g_malloc (WIDTH * HEIGHT * 4);
+
+  g_print ("framebuffer read pixels:\n");
+
+  /* A single pixel read of a rectangle still in the journal can be
+     answered without flushing it */
+  g_timer_start (timer);
+  for (i = 0; i < N_READS; i++)
+    {
+      cogl_framebuffer_draw_rectangle (fb, pipeline, 0, 0, WIDTH, HEIGHT);
+      cogl_framebuffer_read_pixels (fb, i % WIDTH, i % HEIGHT, 1, 1,
+                                    COGL_PIXEL_FORMAT_RGBA_8888_PRE, pixels);
+    }
+  micro_perf_report ("1x1 after a rectangle",
+                     g_timer_elapsed (timer, NULL), N_READS);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_READS; i++)
+    {
+      cogl_framebuffer_draw_rectangle (fb, pipeline, i % 10, 0, 100, 100);
+      cogl_framebuffer_draw_rectangle (fb, pipeline, 50, i % 10, 150, 150);
+      cogl_framebuffer_read_pixels (fb, 60, 60, 1, 1,
+                                    COGL_PIXEL_FORMAT_RGBA_8888_PRE, pixels);
+    }
+  micro_perf_report ("1x1 after overlapping rectangles",
+                     g_timer_elapsed (timer, NULL), N_READS);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    cogl_framebuffer_read_pixels (fb, 0, 0, WIDTH, HEIGHT,
+                                  COGL_PIXEL_FORMAT_RGBA_8888_PRE, pixels);
+  micro_perf_report ("whole framebuffer",
+                     g_timer_elapsed (timer, NULL), N_ITERATIONS);
+
+  g_free (pixels);
+  g_free (data);
+  cogl_object_unref (pipeline);
+  cogl_object_unref (offscreen);
+  cogl_object_unref (texture);
+  g_timer_destroy (timer);
+  cogl_object_unref (ctx);
+
+  return 0;
+}
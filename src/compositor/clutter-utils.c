@@ -124,6 +124,84 @@ meta_actor_is_untransformed (ClutterActor *actor,
   return meta_actor_vertices_are_untransformed (verts, widthf, heightf, x_origin, y_origin);
 }
 
+/* Like meta_actor_vertices_are_untransformed(), but also accepts boxes
+ * at fractional positions and scaled independently along each axis, as
+ * long as they stay aligned to the axes and are not flipped. The box maps
+ * onto the screen as x * @x_scale + @x_origin, y * @y_scale + @y_origin.
+ */
+static gboolean
+vertices_are_axis_aligned (ClutterVertex *verts,
+                           float          widthf,
+                           float          heightf,
+                           float         *x_origin,
+                           float         *y_origin,
+                           float         *x_scale,
+                           float         *y_scale)
+{
+  int width, height;
+  int v0x, v0y, v1x, v1y, v2x, v2y, v3x, v3y;
+
+  width = round_to_fixed (widthf); height = round_to_fixed (heightf);
+  if (width <= 0 || height <= 0)
+    return FALSE;
+
+  v0x = round_to_fixed (verts[0].x); v0y = round_to_fixed (verts[0].y);
+  v1x = round_to_fixed (verts[1].x); v1y = round_to_fixed (verts[1].y);
+  v2x = round_to_fixed (verts[2].x); v2y = round_to_fixed (verts[2].y);
+  v3x = round_to_fixed (verts[3].x); v3y = round_to_fixed (verts[3].y);
+
+  /* Not rotated/skewed? */
+  if (v0x != v2x || v0y != v1y ||
+      v3x != v1x || v3y != v2y)
+    return FALSE;
+
+  /* Not flipped or collapsed? */
+  if (v1x <= v0x || v2y <= v0y)
+    return FALSE;
+
+  *x_origin = v0x / 256.;
+  *y_origin = v0y / 256.;
+
+  /* Keep unscaled axes exactly unscaled */
+  *x_scale = v1x - v0x == width ? 1. : (float) (v1x - v0x) / width;
+  *y_scale = v2y - v0y == height ? 1. : (float) (v2y - v0y) / height;
+
+  return TRUE;
+}
+
+/**
+ * meta_actor_is_axis_aligned:
+ * @actor: a #ClutterActor
+ * @x_origin: (out): screen X coordinate of the actor's origin
+ * @y_origin: (out): screen Y coordinate of the actor's origin
+ * @x_scale: (out): horizontal scale from actor to screen pixels
+ * @y_scale: (out): vertical scale from actor to screen pixels
+ *
+ * Checks whether @actor is transformed to the screen by at most a
+ * translation and a positive scale along each axis, as is the case
+ * while it is being slid or zoomed by an animation. Unlike
+ * meta_actor_is_untransformed(), the translation doesn't have to
+ * be integral and the scale doesn't have to be 1.
+ *
+ * Return value: %TRUE if @actor is axis aligned on screen
+ */
+gboolean
+meta_actor_is_axis_aligned (ClutterActor *actor,
+                            float        *x_origin,
+                            float        *y_origin,
+                            float        *x_scale,
+                            float        *y_scale)
+{
+  gfloat widthf, heightf;
+  ClutterVertex verts[4];
+
+  clutter_actor_get_size (actor, &widthf, &heightf);
+  clutter_actor_get_abs_allocation_vertices (actor, verts);
+
+  return vertices_are_axis_aligned (verts, widthf, heightf,
+                                    x_origin, y_origin, x_scale, y_scale);
+}
+
 /**
  * meta_actor_painting_untransformed:
  * @paint_width: the width of the painted area
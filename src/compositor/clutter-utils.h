@@ -30,6 +30,11 @@ gboolean meta_actor_vertices_are_untransformed (ClutterVertex *verts,
 gboolean meta_actor_is_untransformed (ClutterActor *actor,
                                       int          *x_origin,
                                       int          *y_origin);
+gboolean meta_actor_is_axis_aligned  (ClutterActor *actor,
+                                      float        *x_origin,
+                                      float        *y_origin,
+                                      float        *x_scale,
+                                      float        *y_scale);
 
 gboolean meta_actor_painting_untransformed (int         paint_width,
                                             int         paint_height,
@@ -27,9 +27,23 @@ struct _MetaCompositor
   ClutterActor   *background_actor;
   ClutterActor   *hidden_group;
 
-  GList          *windows;
+  /* The window actors, bottom first */
+  GQueue          windows;
+  /* Those with pre-paint work pending, and those owing frame timings */
+  GQueue          pre_paint_windows;
+  GQueue          frame_windows;
 
-  MetaWindowActor *unredirected_window;
+  /* The topmost fullscreen window of each monitor, when it can be unredirected */
+  GList          *unredirected_windows;
+
+  /* The composited fullscreen window the monitors refresh for, and
+   * whether _VARIABLE_REFRESH is set on the stage window for it; see
+   * update_variable_refresh() */
+  MetaWindowActor *variable_refresh_window;
+  gboolean        variable_refresh;
+
+  /* Whether late frames may tear; see update_tearing() */
+  gboolean        tearing_allowed;
 
   CoglContext    *context;
 
@@ -38,8 +52,49 @@ struct _MetaCompositor
   /* Used for unredirecting fullscreen windows */
   guint           disable_unredirect_count;
 
-  /* Before we create the output window */
+  /* An unredirected window would be shown unfiltered */
+  gboolean        color_filter_active;
+
+  /* Texture memory, in bytes, above which hidden windows lose their
+   * textures; 0 for no limit */
+  gsize           texture_budget;
+
+  /* Prints the texture memory with MUFFIN_DEBUG_TEXTURE_MEMORY */
+  guint           texture_memory_report_id;
+
+  /* Caches the glyphs of MUFFIN_PREWARM_GLYPHS after startup */
+  guint           prewarm_glyphs_id;
+
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  /* Trims the caches when the system runs low on memory */
+  GMemoryMonitor *memory_monitor;
+  gulong          low_memory_id;
+#endif
+
+  /* How many window pixmaps may be bound per frame, 0 for no limit;
+   * see meta_compositor_reserve_pixmap_bind() */
+  gint            pixmap_bind_budget;
+  gint            pixmap_binds_remaining;
+  guint           deferred_bind_id;
+
+  /* _NET_WM_FRAME_DRAWN and _NET_WM_FRAME_TIMINGS messages waiting to
+   * be sent together, see meta_compositor_queue_frame_message(); and
+   * the one timer, for the earliest deadline, that sends them for all
+   * obscured windows */
+  GArray         *frame_messages;
+  guint           frame_messages_timer;
+  gint64          frame_messages_deadline;
+
+  /* A copy of the last region given to meta_set_stage_input_region(),
+   * None for the whole screen. It is applied once the output window
+   * exists, from an idle so that several changes make one update */
   XserverRegion   pending_input_region;
+  guint           input_region_idle_id;
+  /* What was last applied, to skip updates that change nothing;
+   * n_input_rects is -1 for the whole screen */
+  XRectangle     *input_rects;
+  int             n_input_rects;
+  gboolean        input_region_applied;
 
   gint            switch_workspace_in_progress;
 
@@ -54,6 +109,8 @@ struct _MetaCompositor
   guint           show_redraw : 1;
   guint           debug       : 1;
   guint           no_mipmaps  : 1;
+  guint           damage_regions : 1;
+  guint           no_opaque_detection : 1;
 
   gboolean frame_has_updated_xsurfaces;
   gboolean have_x11_sync_object;
@@ -87,4 +144,22 @@ void meta_check_end_modal (MetaScreen *screen);
 void meta_compositor_update_sync_state (MetaCompositor *compositor,
                                         MetaSyncMethod  method);
 
+void meta_compositor_update_geometric_picking (MetaCompositor *compositor);
+
+void meta_compositor_update_density_mode (MetaCompositor *compositor);
+
+void meta_compositor_update_color_filter (MetaCompositor *compositor);
+
+gboolean meta_compositor_reserve_pixmap_bind (MetaCompositor *compositor);
+
+void meta_compositor_queue_frame_message     (MetaCompositor      *compositor,
+                                              XClientMessageEvent *event);
+void meta_compositor_flush_frame_messages    (MetaCompositor      *compositor);
+void meta_compositor_schedule_frame_messages (MetaCompositor      *compositor,
+                                              gint64               deadline);
+
+void meta_queue_redraw_all (ClutterActor *actor);
+
+void meta_icon_textures_reload (ClutterActor *stage);
+
 #endif /* META_COMPOSITOR_PRIVATE_H */
@@ -58,6 +58,8 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include <clutter/x11/clutter-x11.h>
 
 #include <meta/screen.h>
@@ -69,6 +71,7 @@
 #include <meta/prefs.h>
 #include <meta/main.h>
 #include <meta/meta-shadow-factory.h>
+#include "meta-shadow-factory-private.h"
 #include "meta-window-actor-private.h"
 #include "meta-window-group.h"
 #include "meta-background-actor-private.h"
@@ -77,11 +80,23 @@
 #include "util-private.h"
 #include <X11/extensions/shape.h>
 #include <X11/extensions/Xcomposite.h>
+#include <X11/Xatom.h>
 #include "meta-sync-ring.h"
+#include "meta-texture-tower.h"
+#include "meta-frame-timings.h"
+#include "meta-stage-capture.h"
+#include "meta-magnifier.h"
+#include "trace-private.h"
+#include "startup-trace.h"
+#include "cache-stats.h"
+#include <cogl-pango/cogl-pango.h>
 
 /* #define DEBUG_TRACE g_print */
 #define DEBUG_TRACE(X)
 
+/* Pixmaps bound per frame unless META_PIXMAP_BIND_BUDGET says otherwise */
+#define DEFAULT_PIXMAP_BIND_BUDGET 8
+
 static MetaCompositor *compositor_global = NULL;
 
 static void
@@ -110,7 +125,7 @@ meta_finish_workspace_switch (MetaCompositor *compositor)
   GList *l;
 
   /* Finish hiding and showing actors for the new workspace */
-  for (l = compositor->windows; l; l = l->next)
+  for (l = compositor->windows.head; l; l = l->next)
     meta_window_actor_sync_visibility (l->data);
 
   /*
@@ -145,10 +160,86 @@ meta_compositor_destroy (MetaCompositor *compositor)
   clutter_threads_remove_repaint_func (compositor->pre_paint_func_id);
   clutter_threads_remove_repaint_func (compositor->post_paint_func_id);
 
+  if (compositor->deferred_bind_id != 0)
+    g_source_remove (compositor->deferred_bind_id);
+
+  if (compositor->frame_messages_timer != 0)
+    g_source_remove (compositor->frame_messages_timer);
+
+  if (compositor->texture_memory_report_id != 0)
+    g_source_remove (compositor->texture_memory_report_id);
+
+  if (compositor->prewarm_glyphs_id != 0)
+    g_source_remove (compositor->prewarm_glyphs_id);
+
+  meta_cache_stop_sampler ();
+  meta_magnifier_shutdown ();
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  if (compositor->memory_monitor)
+    {
+      g_signal_handler_disconnect (compositor->memory_monitor,
+                                   compositor->low_memory_id);
+      g_object_unref (compositor->memory_monitor);
+    }
+#endif
+  meta_cache_unregister ("cogl pipelines", compositor->context);
+  meta_cache_unregister ("cogl samplers", compositor->context);
+  meta_cache_unregister ("glyphs", clutter_get_font_map ());
+
+  meta_compositor_flush_frame_messages (compositor);
+  g_array_free (compositor->frame_messages, TRUE);
+
   if (compositor->have_x11_sync_object)
     meta_sync_ring_destroy ();
 }
 
+/* The glyphs that most labels are made of */
+#define DEFAULT_PREWARM_GLYPHS \
+  " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ" \
+  "[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~"
+
+/* Glyphs missing from the cache are drawn while the frame showing them
+ * is painted, so the first frames showing the panel and window titles
+ * would draw them all. They are drawn in an idle once the stage is up
+ * instead, in the default font, both regular and bold, which is what
+ * the glyph cache is keyed by. MUFFIN_PREWARM_GLYPHS replaces the
+ * glyphs, say by those of a script the titles are mostly in, and turns
+ * this off when empty.
+ */
+static gboolean
+prewarm_glyphs (gpointer data)
+{
+  MetaCompositor *compositor = data;
+  const char *text = g_getenv ("MUFFIN_PREWARM_GLYPHS");
+  PangoContext *context;
+  PangoLayout *layout;
+  PangoAttrList *attrs;
+
+  compositor->prewarm_glyphs_id = 0;
+
+  if (text == NULL)
+    text = DEFAULT_PREWARM_GLYPHS;
+
+  if (*text == '\0' || !g_utf8_validate (text, -1, NULL))
+    return G_SOURCE_REMOVE;
+
+  context = clutter_actor_create_pango_context (compositor->stage);
+  layout = pango_layout_new (context);
+  pango_layout_set_text (layout, text, -1);
+  cogl_pango_ensure_glyph_cache_for_layout (layout);
+
+  attrs = pango_attr_list_new ();
+  pango_attr_list_insert (attrs, pango_attr_weight_new (PANGO_WEIGHT_BOLD));
+  pango_layout_set_attributes (layout, attrs);
+  pango_attr_list_unref (attrs);
+  cogl_pango_ensure_glyph_cache_for_layout (layout);
+
+  g_object_unref (layout);
+  g_object_unref (context);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 add_win (MetaWindow *window)
 {
@@ -259,6 +350,192 @@ meta_get_stage_for_screen (MetaScreen *screen)
   return screen->display->compositor->stage;
 }
 
+/**
+ * meta_dump_frame_timings_for_screen:
+ * @screen: a #MetaScreen
+ * @filename: file to write the timings to
+ * @error: return location for an error
+ *
+ * Writes the timings of the most recent stage frames to @filename as
+ * tab-separated text, for graphing compositor latency. Each line holds
+ * the frame counter, the monotonic time the frame started at, the
+ * offsets in microseconds of the layout, paint, swap, done and
+ * presentation steps from that (or -1), the number of windows that
+ * had damage repaired, the damaged area in pixels and the microseconds
+ * spent blocked on the GPU by the sync ring. When the sync ring is in
+ * use, a comment line at the top gives its size and overall stalls.
+ *
+ * Returns: %TRUE if the file was written
+ */
+gboolean
+meta_dump_frame_timings_for_screen (MetaScreen  *screen,
+                                    const char  *filename,
+                                    GError     **error)
+{
+  return meta_frame_timings_dump (filename, error);
+}
+
+static void
+add_texture_memory (const char *category,
+                    int         n_objects,
+                    size_t      bytes,
+                    void       *user_data)
+{
+  GVariantBuilder *builder = user_data;
+
+  g_variant_builder_add (builder, "{s(ut)}",
+                         category, (guint32) n_objects, (guint64) bytes);
+}
+
+/**
+ * meta_get_texture_memory_for_screen:
+ * @screen: a #MetaScreen
+ *
+ * Gets an estimate of the GPU memory taken by the compositor's textures
+ * and offscreen buffers, by what they are used for: "window pixmaps",
+ * "masks", "texture tower", "shadows", "backgrounds", "offscreen
+ * effects", "glyph atlas", "atlas", "renderbuffers" and "other". The
+ * result can be returned as is from a D-Bus method.
+ *
+ * Returns: (transfer full): a floating #GVariant of type a{s(ut)},
+ *   mapping each category to its number of textures and their bytes
+ */
+GVariant *
+meta_get_texture_memory_for_screen (MetaScreen *screen)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{s(ut)}"));
+  cogl_context_foreach_texture_memory (screen->display->compositor->context,
+                                       add_texture_memory, &builder);
+
+  return g_variant_builder_end (&builder);
+}
+
+static void
+add_cache_stats (const char           *name,
+                 const MetaCacheStats *stats,
+                 gpointer              user_data)
+{
+  GVariantBuilder *builder = user_data;
+
+  g_variant_builder_add (builder, "{s(utttt)}",
+                         name, (guint32) stats->n_entries,
+                         (guint64) stats->bytes, stats->hits, stats->misses,
+                         stats->evictions);
+}
+
+/**
+ * meta_get_cache_stats_for_screen:
+ * @screen: a #MetaScreen
+ *
+ * Gets the size and effectiveness of the caches Muffin and Cogl keep
+ * for the compositor, such as "shadows", "frame pieces", "theme
+ * pixbufs", "window icons", "cogl pipelines", "cogl samplers" and
+ * "glyphs". The result can be returned as is from a D-Bus method.
+ *
+ * Returns: (transfer full): a floating #GVariant of type a{s(utttt)},
+ *   mapping each cache to its number of entries, their estimated
+ *   bytes, and its hits, misses and evictions
+ */
+GVariant *
+meta_get_cache_stats_for_screen (MetaScreen *screen)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{s(utttt)}"));
+  meta_cache_foreach (add_cache_stats, &builder);
+
+  return g_variant_builder_end (&builder);
+}
+
+/**
+ * meta_trim_caches_for_screen:
+ * @screen: a #MetaScreen
+ *
+ * Drops whatever the compositor's caches hold that isn't in use and
+ * can be rebuilt later. This happens by itself when the system runs
+ * low on memory.
+ */
+void
+meta_trim_caches_for_screen (MetaScreen *screen)
+{
+  meta_cache_trim_all ();
+}
+
+/**
+ * meta_add_stage_capture_for_screen:
+ * @screen: a #MetaScreen
+ * @func: (scope notified): called with each changed part of the stage
+ * @user_data: data for @func
+ * @notify: called on @user_data once the capture is removed
+ *
+ * Starts capturing the stage of @screen for recording or remote
+ * display. After every stage paint that changed something, the
+ * bounding box of the change is read back without waiting for the GPU
+ * and passed to @func a frame or so later; the first call covers the
+ * whole stage. Frames are skipped while earlier reads are still in
+ * flight, with their changes included in the next call.
+ *
+ * Returns: an id to pass to meta_remove_stage_capture_for_screen()
+ */
+guint
+meta_add_stage_capture_for_screen (MetaScreen           *screen,
+                                   MetaStageCaptureFunc  func,
+                                   gpointer              user_data,
+                                   GDestroyNotify        notify)
+{
+  MetaCompositor *compositor = screen->display->compositor;
+
+  return meta_stage_capture_add (CLUTTER_STAGE (compositor->stage),
+                                 func, user_data, notify);
+}
+
+/**
+ * meta_remove_stage_capture_for_screen:
+ * @screen: a #MetaScreen
+ * @id: an id returned from meta_add_stage_capture_for_screen()
+ *
+ * Stops a capture started with meta_add_stage_capture_for_screen().
+ */
+void
+meta_remove_stage_capture_for_screen (MetaScreen *screen,
+                                      guint       id)
+{
+  meta_stage_capture_remove (id);
+}
+
+/**
+ * meta_set_magnification_for_screen:
+ * @screen: a #MetaScreen
+ * @zoom: how many times to magnify the screen, 1 to stop magnifying
+ *
+ * Zooms the whole screen in on the pointer, which keeps being followed
+ * until @zoom goes back to 1. The zoom is drawn by the compositor, so
+ * any other magnifier should be off. The compositor-magnifier preference
+ * only governs the mouse zoom modifiers; plugins can set the zoom
+ * whatever its value.
+ */
+void
+meta_set_magnification_for_screen (MetaScreen *screen,
+                                   double      zoom)
+{
+  meta_magnifier_set_zoom (zoom);
+}
+
+/**
+ * meta_get_magnification_for_screen:
+ * @screen: a #MetaScreen
+ *
+ * Returns: the zoom set by meta_set_magnification_for_screen() or the
+ *   mouse zoom modifiers, 1 when the screen is not magnified
+ */
+double
+meta_get_magnification_for_screen (MetaScreen *screen)
+{
+  return meta_magnifier_get_zoom ();
+}
+
 /**
  * meta_get_overlay_group_for_screen:
  * @screen: a #MetaScreen
@@ -332,7 +609,7 @@ meta_get_background_actor_for_screen (MetaScreen *screen)
 GList *
 meta_get_window_actors (MetaScreen *screen)
 {
-  return screen->display->compositor->windows;
+  return screen->display->compositor->windows.head;
 }
 
 static void
@@ -343,6 +620,29 @@ do_set_stage_input_region (MetaScreen   *screen,
   MetaCompositor *compositor = display->compositor;
   Display *xdpy = display->xdisplay;
   Window xstage = clutter_x11_get_stage_window (CLUTTER_STAGE (compositor->stage));
+  XRectangle *rects = NULL;
+  int n_rects = -1;
+
+  /* Reshaping makes the server send crossing events, so an update
+   * that changes nothing is worth a round trip to spot */
+  if (region != None)
+    rects = XFixesFetchRegion (xdpy, region, &n_rects);
+
+  if (compositor->input_region_applied &&
+      n_rects == compositor->n_input_rects &&
+      (n_rects <= 0 ||
+       memcmp (rects, compositor->input_rects, n_rects * sizeof (XRectangle)) == 0))
+    {
+      if (rects)
+        XFree (rects);
+      return;
+    }
+
+  if (compositor->input_rects)
+    XFree (compositor->input_rects);
+  compositor->input_rects = rects;
+  compositor->n_input_rects = n_rects;
+  compositor->input_region_applied = TRUE;
 
   XFixesSetWindowShapeRegion (xdpy, xstage, ShapeInput, 0, 0, region);
 
@@ -354,6 +654,20 @@ do_set_stage_input_region (MetaScreen   *screen,
   XFixesSetWindowShapeRegion (xdpy, compositor->output, ShapeInput, 0, 0, region);
 }
 
+static gboolean
+apply_stage_input_region (gpointer data)
+{
+  MetaScreen *screen = data;
+  MetaCompositor *compositor = screen->display->compositor;
+
+  compositor->input_region_idle_id = 0;
+
+  if (compositor->stage && compositor->output)
+    do_set_stage_input_region (screen, compositor->pending_input_region);
+
+  return G_SOURCE_REMOVE;
+}
+
 void
 meta_set_stage_input_region (MetaScreen   *screen,
                              XserverRegion region)
@@ -362,24 +676,33 @@ meta_set_stage_input_region (MetaScreen   *screen,
   MetaCompositor *compositor = display->compositor;
   Display *xdpy = display->xdisplay;
 
-  if (compositor->stage && compositor->output)
-    {
-      do_set_stage_input_region (screen, region);
-    }
-  else
+  /* Chrome that moves calls this for every frame it moves in, and
+   * often several times in one; keep the region for later, which the
+   * caller is free to destroy meanwhile */
+  if (region == None)
     {
-      /* Reset compositor->pending_input_region if one existed before and set the new
-       * one to use it later. */
-      if (compositor->pending_input_region)
+      if (compositor->pending_input_region != None)
         {
           XFixesDestroyRegion (xdpy, compositor->pending_input_region);
           compositor->pending_input_region = None;
         }
-      if (region != None)
-        {
-          compositor->pending_input_region = XFixesCreateRegion (xdpy, NULL, 0);
-          XFixesCopyRegion (xdpy, compositor->pending_input_region, region);
-        }
+    }
+  else
+    {
+      if (compositor->pending_input_region == None)
+        compositor->pending_input_region = XFixesCreateRegion (xdpy, NULL, 0);
+      XFixesCopyRegion (xdpy, compositor->pending_input_region, region);
+    }
+
+  /* Before the output window exists, manage_screen applies it */
+  if (compositor->stage && compositor->output &&
+      compositor->input_region_idle_id == 0)
+    {
+      compositor->input_region_idle_id =
+        g_idle_add_full (META_PRIORITY_BEFORE_REDRAW,
+                         apply_stage_input_region, screen, NULL);
+      g_source_set_name_by_id (compositor->input_region_idle_id,
+                               "[muffin] apply_stage_input_region");
     }
 }
 
@@ -514,8 +837,14 @@ after_stage_paint (ClutterStage *stage,
   MetaCompositor *compositor = (MetaCompositor*) data;
   GList *l;
 
-  for (l = compositor->windows; l; l = l->next)
+  meta_frame_timings_mark (META_FRAME_PHASE_SWAP);
+
+  for (l = compositor->windows.head; l; l = l->next)
     meta_window_actor_post_paint (l->data);
+
+  meta_stage_capture_after_paint (stage);
+
+  meta_compositor_flush_frame_messages (compositor);
 }
 
 static void
@@ -601,13 +930,18 @@ meta_compositor_manage_screen (MetaCompositor *compositor,
 
   compositor->screen = screen;
   compositor->output = None;
-  compositor->windows = NULL;
+  g_queue_init (&compositor->windows);
+  g_queue_init (&compositor->pre_paint_windows);
+  g_queue_init (&compositor->frame_windows);
 
   meta_screen_set_cm_selection (screen);
 
   compositor->stage = clutter_stage_new ();
 
   meta_compositor_toggle_send_frame_timings(screen);
+  meta_compositor_update_geometric_picking (compositor);
+  meta_compositor_update_density_mode (compositor);
+  meta_compositor_update_color_filter (compositor);
 
   g_signal_connect_after (CLUTTER_STAGE (compositor->stage), "after-paint",
                           G_CALLBACK (after_stage_paint), compositor);
@@ -652,6 +986,8 @@ meta_compositor_manage_screen (MetaCompositor *compositor,
 
   clutter_actor_hide (compositor->hidden_group);
 
+  meta_magnifier_init (screen);
+
   compositor->plugin_mgr = meta_plugin_manager_new (screen);
 
   /*
@@ -675,11 +1011,6 @@ meta_compositor_manage_screen (MetaCompositor *compositor,
   XFixesSetWindowShapeRegion (xdisplay, compositor->output, ShapeBounding, 0, 0, None);
 
   do_set_stage_input_region (screen, compositor->pending_input_region);
-  if (compositor->pending_input_region != None)
-    {
-      XFixesDestroyRegion (xdisplay, compositor->pending_input_region);
-      compositor->pending_input_region = None;
-    }
 
   clutter_actor_show (compositor->overlay_group);
   clutter_actor_show (compositor->stage);
@@ -690,6 +1021,12 @@ meta_compositor_manage_screen (MetaCompositor *compositor,
   XMapWindow (xdisplay, compositor->output);
 
   compositor->have_x11_sync_object = meta_sync_ring_init (xdisplay);
+
+  compositor->prewarm_glyphs_id = g_idle_add_full (G_PRIORITY_LOW,
+                                                   prewarm_glyphs,
+                                                   compositor, NULL);
+  g_source_set_name_by_id (compositor->prewarm_glyphs_id,
+                           "[muffin] prewarm_glyphs");
 }
 
 void
@@ -704,35 +1041,50 @@ meta_compositor_unmanage_screen (MetaCompositor *compositor,
    * before giving up the window manager selection or the next
    * window manager won't be able to redirect subwindows */
   XCompositeUnredirectSubwindows (xdisplay, xroot, CompositeRedirectManual);
+
+  if (compositor->input_region_idle_id)
+    {
+      g_source_remove (compositor->input_region_idle_id);
+      compositor->input_region_idle_id = 0;
+    }
 }
 
 /*
- * Shapes the cow so that the given window is exposed,
- * when metaWindow is NULL it clears the shape again
+ * Shapes the cow so that the given windows are exposed,
+ * when window_actors is NULL it clears the shape again
  */
 static void
-meta_shape_cow_for_window (MetaScreen *screen,
-                           MetaWindow *metaWindow)
+meta_shape_cow_for_windows (MetaScreen *screen,
+                            GList      *window_actors)
 {
   MetaDisplay *display = screen->display;
   MetaCompositor *compositor = display->compositor;
   Display *xdisplay = display->xdisplay;
 
-  if (metaWindow == NULL)
+  if (window_actors == NULL)
       XFixesSetWindowShapeRegion (xdisplay, compositor->output, ShapeBounding, 0, 0, None);
   else
     {
       XserverRegion output_region;
-      XRectangle screen_rect, window_bounds;
+      XRectangle screen_rect, *window_bounds;
       int width, height;
-      MetaRectangle rect;
+      int n_windows, i;
+      GList *l;
 
-      meta_window_get_outer_rect (metaWindow, &rect);
+      n_windows = g_list_length (window_actors);
+      window_bounds = g_newa (XRectangle, n_windows);
 
-      window_bounds.x = rect.x;
-      window_bounds.y = rect.y;
-      window_bounds.width = rect.width;
-      window_bounds.height = rect.height;
+      for (l = window_actors, i = 0; l; l = l->next, i++)
+        {
+          MetaRectangle rect;
+
+          meta_window_get_outer_rect (meta_window_actor_get_meta_window (l->data), &rect);
+
+          window_bounds[i].x = rect.x;
+          window_bounds[i].y = rect.y;
+          window_bounds[i].width = rect.width;
+          window_bounds[i].height = rect.height;
+        }
 
       meta_screen_get_size (screen, &width, &height);
       screen_rect.x = 0;
@@ -740,7 +1092,7 @@ meta_shape_cow_for_window (MetaScreen *screen,
       screen_rect.width = width;
       screen_rect.height = height;
 
-      output_region = XFixesCreateRegion (xdisplay, &window_bounds, 1);
+      output_region = XFixesCreateRegion (xdisplay, window_bounds, n_windows);
 
       XFixesInvertRegion (xdisplay, output_region, &screen_rect, output_region);
       XFixesSetWindowShapeRegion (xdisplay, compositor->output, ShapeBounding, 0, 0, output_region);
@@ -777,13 +1129,17 @@ meta_compositor_remove_window (MetaCompositor *compositor,
 
   screen = window->screen;
 
-  if (window_actor == compositor->unredirected_window)
+  if (g_list_find (compositor->unredirected_windows, window_actor))
     {
       meta_window_actor_set_redirected (window_actor, TRUE);
-      meta_shape_cow_for_window (screen,  NULL);
-      compositor->unredirected_window = NULL;
+      compositor->unredirected_windows = g_list_remove (compositor->unredirected_windows,
+                                                        window_actor);
+      meta_shape_cow_for_windows (screen, compositor->unredirected_windows);
     }
 
+  if (compositor->variable_refresh_window == window_actor)
+    compositor->variable_refresh_window = NULL;
+
   meta_window_actor_destroy (window_actor);
 }
 
@@ -1015,78 +1371,161 @@ meta_compositor_tile_window (MetaCompositor    *compositor,
   meta_window_actor_tile (window_actor, old_rect, new_rect);
 }
 
+/* Flags in @keep the elements of @values, @n distinct integers, that
+ * form a longest increasing subsequence */
+static void
+find_increasing_subsequence (const int *values,
+                             int        n,
+                             gboolean  *keep)
+{
+  /* tails[k] ends the best subsequence of length k + 1 found so far */
+  int *tails = g_new (int, n);
+  int *prev = g_new (int, n);
+  int length = 0;
+  int i, k;
+
+  for (i = 0; i < n; i++)
+    {
+      int lo = 0, hi = length;
+
+      while (lo < hi)
+        {
+          int mid = (lo + hi) / 2;
+
+          if (values[tails[mid]] < values[i])
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+
+      prev[i] = lo > 0 ? tails[lo - 1] : -1;
+      tails[lo] = i;
+      if (lo == length)
+        length++;
+
+      keep[i] = FALSE;
+    }
+
+  for (k = length > 0 ? tails[length - 1] : -1; k >= 0; k = prev[k])
+    keep[k] = TRUE;
+
+  g_free (prev);
+  g_free (tails);
+}
+
 static void
 sync_actor_stacking (MetaCompositor *compositor)
 {
+  ClutterActor *window_group = compositor->window_group;
+  ClutterActor *background = compositor->background_actor;
   GList *children;
   GList *tmp;
-  GList *old;
-  gboolean reordered;
+  GHashTable *target_index;
+  ClutterActor **target;
+  gboolean *in_place;
+  gboolean background_in_place;
+  int *current;
+  gboolean *keep;
+  int n_windows, n_current, i;
 
   /* NB: The first entries in the lists are stacked the lowest */
 
-  /* Restacking will trigger full screen redraws, so it's worth a
-   * little effort to make sure we actually need to restack before
-   * we go ahead and do it */
-
-  children = clutter_actor_get_children (compositor->window_group);
-  reordered = FALSE;
-
-  old = children;
-
-  /* We allow for actors in the window group other than the actors we
+  /* Every actor moved is redrawn, so only the ones out of place are
+   * moved: the longest run of window actors already in the right
+   * order stays where it is and the others are put back around it.
+   * Raising one window thus moves just that window.
+   *
+   * We allow for actors in the window group other than the actors we
    * know about, but it's up to a plugin to try and keep them stacked correctly
-   * (we really need extra API to make that reliable.)
+   * (we really need extra API to make that reliable.) They keep their
+   * place among the windows that don't move.
    */
 
+  n_windows = compositor->windows.length;
+  target = g_new (ClutterActor *, n_windows);
+  in_place = g_new0 (gboolean, n_windows);
+  target_index = g_hash_table_new (NULL, NULL);
+
+  for (tmp = compositor->windows.head, i = 0; tmp != NULL; tmp = tmp->next, i++)
+    {
+      target[i] = tmp->data;
+      g_hash_table_insert (target_index, tmp->data, GINT_TO_POINTER (i + 1));
+    }
+
   /* Of the actors we know, the bottom actor should be the background actor */
+  background_in_place = FALSE;
+  children = clutter_actor_get_children (window_group);
+  current = g_new (int, g_list_length (children));
+  n_current = 0;
 
-  while (old && old->data != compositor->background_actor && !META_IS_WINDOW_ACTOR (old->data))
-    old = old->next;
-  if (old == NULL || old->data != compositor->background_actor)
+  for (tmp = children; tmp != NULL; tmp = tmp->next)
     {
-      reordered = TRUE;
-      goto done_with_check;
+      int index = GPOINTER_TO_INT (g_hash_table_lookup (target_index,
+                                                        tmp->data));
+
+      if (tmp->data == background)
+        background_in_place = n_current == 0;
+      else if (index > 0)
+        current[n_current++] = index - 1;
     }
 
+  g_list_free (children);
+  g_hash_table_destroy (target_index);
+
   /* Then the window actors should follow in sequence */
+  keep = g_new (gboolean, n_current);
+  find_increasing_subsequence (current, n_current, keep);
+  for (i = 0; i < n_current; i++)
+    if (keep[i])
+      in_place[current[i]] = TRUE;
 
-  old = old->next;
-  for (tmp = compositor->windows; tmp != NULL; tmp = tmp->next)
-    {
-      while (old && !META_IS_WINDOW_ACTOR (old->data))
-        old = old->next;
+  g_free (keep);
+  g_free (current);
 
-      /* old == NULL: someone reparented a window out of the window group,
-       * order undefined, always restack */
-      if (old == NULL || old->data != tmp->data)
-        {
-          reordered = TRUE;
-          goto done_with_check;
-        }
+  if (!background_in_place)
+    {
+      ClutterActor *parent = clutter_actor_get_parent (background);
 
-      old = old->next;
+      clutter_actor_set_child_below_sibling (parent, background, NULL);
     }
 
- done_with_check:
+  for (i = 0; i < n_windows; i++)
+    {
+      ClutterActor *actor = target[i];
+      ClutterActor *below = NULL;
+      int j;
+
+      if (in_place[i])
+        continue;
 
-  g_list_free (children);
+      /* someone reparented a window out of the window group, order
+       * undefined, lower it in its own parent */
+      if (clutter_actor_get_parent (actor) != window_group)
+        continue;
 
-  if (!reordered)
-    return;
+      for (j = i - 1; j >= 0 && below == NULL; j--)
+        if (clutter_actor_get_parent (target[j]) == window_group)
+          below = target[j];
+
+      if (below == NULL && clutter_actor_get_parent (background) == window_group)
+        below = background;
 
-  ClutterActor *parent;
+      if (below != NULL)
+        clutter_actor_set_child_above_sibling (window_group, actor, below);
+      else
+        clutter_actor_set_child_below_sibling (window_group, actor, NULL);
+    }
 
-  for (tmp = g_list_last (compositor->windows); tmp != NULL; tmp = tmp->prev)
+  for (i = n_windows - 1; i >= 0; i--)
     {
-      ClutterActor *actor = tmp->data;
+      ClutterActor *parent = clutter_actor_get_parent (target[i]);
 
-      parent = clutter_actor_get_parent (actor);
-      clutter_actor_set_child_below_sibling (parent, actor, NULL);
+      if (parent != window_group)
+        clutter_actor_set_child_below_sibling (parent, target[i], NULL);
     }
 
-  parent = clutter_actor_get_parent (compositor->background_actor);
-  clutter_actor_set_child_below_sibling (parent, compositor->background_actor, NULL);
+  g_free (in_place);
+  g_free (target);
 }
 
 void
@@ -1106,8 +1545,8 @@ meta_compositor_sync_stack (MetaCompositor  *compositor,
 
   /* Sources: first window is the highest */
   stack = g_list_copy (stack); /* The new stack of MetaWindow */
-  old_stack = g_list_reverse (compositor->windows); /* The old stack of MetaWindowActor */
-  compositor->windows = NULL;
+  old_stack = g_list_reverse (compositor->windows.head); /* The old stack of MetaWindowActor */
+  g_queue_init (&compositor->windows);
 
   while (TRUE)
     {
@@ -1171,7 +1610,7 @@ meta_compositor_sync_stack (MetaCompositor  *compositor,
        * be at the front of at least one, hopefully it will be
        * near the front of the other.)
        */
-      compositor->windows = g_list_prepend (compositor->windows, actor);
+      g_queue_push_head (&compositor->windows, actor);
 
       stack = g_list_remove (stack, window);
       old_stack = g_list_remove (old_stack, actor);
@@ -1225,7 +1664,7 @@ frame_callback (ClutterStage     *stage,
                 ClutterFrameInfo *frame_info,
                 MetaCompositor   *compositor)
 {
-  GList *l;
+  GList *l, *next;
 
   if (event == COGL_FRAME_EVENT_COMPLETE)
     {
@@ -1254,119 +1693,774 @@ frame_callback (ClutterStage     *stage,
           presentation_time = 0;
         }
 
-      for (l = compositor->windows; l; l = l->next)
-        meta_window_actor_frame_complete (l->data, frame_info, presentation_time);
+      meta_frame_timings_presented (frame_info->frame_counter, presentation_time);
+
+      /* Completing its frames may take a window off the queue */
+      for (l = compositor->frame_windows.head; l; l = next)
+        {
+          next = l->next;
+          meta_window_actor_frame_complete (l->data, frame_info, presentation_time);
+        }
+
+      meta_compositor_flush_frame_messages (compositor);
     }
 }
 
-static gboolean
-meta_pre_paint_func (gpointer data)
+/* Works out which windows should be unredirected: walking down the
+ * stack, a window qualifies if it is unredirectable in itself and no
+ * window above it overlaps it. This picks the topmost fullscreen window
+ * of every monitor independently, so that a panel or dialog on one
+ * monitor doesn't keep a game on another one composited. A window is
+ * only unredirected once it has qualified for a while, see
+ * meta_window_actor_unredirect_settled(), but is composited again as
+ * soon as it stops qualifying.
+ */
+static void
+update_unredirected_windows (MetaCompositor *compositor)
 {
+  MetaScreen *screen = compositor->display->active_screen;
+  GList *expected = NULL;
   GList *l;
-  MetaCompositor *compositor = data;
-  GSList *screens = compositor->display->screens;
-  MetaWindowActor *top_window;
-  MetaWindowActor *expected_unredirected_window = NULL;
+  cairo_region_t *above;
+  gboolean changed = FALSE;
 
-  if (compositor->windows == NULL)
-    return TRUE;
+  above = cairo_region_create ();
 
-  top_window = g_list_last (compositor->windows)->data;
+  for (l = compositor->windows.tail; l; l = l->prev)
+    {
+      MetaWindowActor *window_actor = l->data;
+      MetaUnredirectBlocker blocker;
+      MetaRectangle rect;
 
-  if (meta_window_actor_should_unredirect (top_window) &&
-      compositor->disable_unredirect_count == 0)
-    expected_unredirected_window = top_window;
+      if (!CLUTTER_ACTOR_IS_VISIBLE (window_actor))
+        continue;
 
-  if (compositor->unredirected_window != expected_unredirected_window)
-    {
-      if (compositor->unredirected_window != NULL)
-        {
-          meta_window_actor_set_redirected (compositor->unredirected_window, TRUE);
-          meta_shape_cow_for_window (compositor->display->active_screen, NULL);
-        }
+      meta_window_get_outer_rect (meta_window_actor_get_meta_window (window_actor), &rect);
 
-      if (expected_unredirected_window != NULL)
-        {
-          meta_shape_cow_for_window (compositor->display->active_screen,
-                                     meta_window_actor_get_meta_window (top_window));
-          meta_window_actor_set_redirected (top_window, FALSE);
-        }
+      blocker = meta_window_actor_get_unredirect_blocker (window_actor);
+      if (blocker == META_UNREDIRECT_ALLOWED &&
+          cairo_region_contains_rectangle (above, (cairo_rectangle_int_t *) &rect) != CAIRO_REGION_OVERLAP_OUT)
+        blocker = META_UNREDIRECT_BLOCKED_OBSCURED;
+      if (blocker == META_UNREDIRECT_ALLOWED &&
+          compositor->disable_unredirect_count > 0)
+        blocker = META_UNREDIRECT_BLOCKED_DISABLED;
+      if (blocker == META_UNREDIRECT_ALLOWED &&
+          !meta_window_actor_unredirect_settled (window_actor))
+        blocker = META_UNREDIRECT_BLOCKED_SETTLING;
+
+      meta_window_actor_note_unredirect_blocker (window_actor, blocker);
 
-      compositor->unredirected_window = expected_unredirected_window;
+      if (blocker == META_UNREDIRECT_ALLOWED)
+        expected = g_list_prepend (expected, window_actor);
+
+      cairo_region_union_rectangle (above, (cairo_rectangle_int_t *) &rect);
     }
 
-  for (l = compositor->windows; l; l = l->next)
-    meta_window_actor_pre_paint (l->data);
+  cairo_region_destroy (above);
 
-  if (compositor->frame_has_updated_xsurfaces)
+  for (l = compositor->unredirected_windows; l; l = l->next)
+    if (!g_list_find (expected, l->data))
+      {
+        meta_window_actor_set_redirected (l->data, TRUE);
+        changed = TRUE;
+      }
+
+  for (l = expected; l; l = l->next)
+    if (!g_list_find (compositor->unredirected_windows, l->data))
+      changed = TRUE;
+
+  if (!changed)
     {
-      /* We need to make sure that any X drawing that happens before
-       * the XDamageSubtract() for each window above is visible to
-       * subsequent GL rendering; the standardized way to do this is
-       * GL_EXT_X11_sync_object. Since this isn't implemented yet in
-       * mesa, we also have a path that relies on the implementation
-       * of the open source drivers.
-       *
-       * Anything else, we just hope for the best.
-       *
-       * Xorg and open source driver specifics:
-       *
-       * The X server makes sure to flush drawing to the kernel before
-       * sending out damage events, but since we use
-       * DamageReportBoundingBox there may be drawing between the last
-       * damage event and the XDamageSubtract() that needs to be
-       * flushed as well.
-       *
-       * Xorg always makes sure that drawing is flushed to the kernel
-       * before writing events or responses to the client, so any
-       * round trip request at this point is sufficient to flush the
-       * GLX buffers.
-       */
-      if (compositor->have_x11_sync_object)
-        compositor->have_x11_sync_object = meta_sync_ring_insert_wait ();
-      else
-        XSync (compositor->display->xdisplay, False);
+      g_list_free (expected);
+      return;
     }
 
-  return TRUE;
+  meta_shape_cow_for_windows (screen, expected);
+
+  for (l = expected; l; l = l->next)
+    meta_window_actor_set_redirected (l->data, FALSE);
+
+  g_list_free (compositor->unredirected_windows);
+  compositor->unredirected_windows = expected;
 }
 
-static gboolean
-meta_post_paint_func (gpointer data)
+/* Lets the driver vary the refresh rate of the monitors to when frames
+ * are presented, by setting _VARIABLE_REFRESH on the stage window, while
+ * the topmost window on the monitors that support it is a composited
+ * fullscreen window and no window is animating. The damage of that
+ * window then has the stage painted without waiting for the next
+ * refresh, see queue_damage_flush(). Windows that are unredirected
+ * present their frames themselves, and set the property on their own
+ * windows if they want to.
+ */
+static void
+update_variable_refresh (MetaCompositor *compositor)
 {
-  MetaCompositor *compositor = data;
-  CoglGraphicsResetStatus status;
+  MetaDisplay *display = compositor->display;
+  MetaWindowActor *topmost = NULL;
+  Window xstage;
+  GList *l;
 
-  if (compositor->frame_has_updated_xsurfaces)
+  for (l = compositor->windows.tail; l; l = l->prev)
     {
-      if (compositor->have_x11_sync_object)
-        compositor->have_x11_sync_object = meta_sync_ring_after_frame ();
+      MetaWindowActor *window_actor = l->data;
+      MetaWindow *window = meta_window_actor_get_meta_window (window_actor);
 
-      compositor->frame_has_updated_xsurfaces = FALSE;
+      if (meta_window_actor_effect_in_progress (window_actor))
+        {
+          topmost = NULL;
+          break;
+        }
+
+      if (topmost == NULL &&
+          CLUTTER_ACTOR_IS_VISIBLE (window_actor) &&
+          window->monitor != NULL &&
+          window->monitor->vrr_capable)
+        topmost = window_actor;
     }
 
-  status = cogl_get_graphics_reset_status (compositor->context);
-  switch (status)
-    {
-    case COGL_GRAPHICS_RESET_STATUS_NO_ERROR:
+  if (topmost != NULL &&
+      (!meta_window_is_fullscreen (meta_window_actor_get_meta_window (topmost)) ||
+       g_list_find (compositor->unredirected_windows, topmost) != NULL))
+    topmost = NULL;
+
+  compositor->variable_refresh_window = topmost;
+
+  if ((topmost != NULL) == compositor->variable_refresh)
+    return;
+
+  compositor->variable_refresh = topmost != NULL;
+
+  xstage = clutter_x11_get_stage_window (CLUTTER_STAGE (compositor->stage));
+
+  meta_error_trap_push (display);
+
+  if (compositor->variable_refresh)
+    {
+      gulong data = 1;
+
+      XChangeProperty (display->xdisplay, xstage,
+                       display->atom__VARIABLE_REFRESH,
+                       XA_CARDINAL, 32, PropModeReplace,
+                       (guchar *) &data, 1);
+    }
+  else
+    XDeleteProperty (display->xdisplay, xstage,
+                     display->atom__VARIABLE_REFRESH);
+
+  meta_error_trap_pop (display);
+}
+
+static gboolean
+window_allows_tearing (MetaWindow *window)
+{
+  const char * const *wm_classes = meta_prefs_get_tearing_allowed_wm_classes ();
+  int i;
+
+  if (wm_classes == NULL)
+    return FALSE;
+
+  for (i = 0; wm_classes[i] != NULL; i++)
+    if (g_strcmp0 (wm_classes[i], window->res_class) == 0 ||
+        g_strcmp0 (wm_classes[i], window->res_name) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+/* Lets frames that miss their vblank be presented right away, with a
+ * tear line, instead of a whole refresh later, while the focused window
+ * is a composited fullscreen window on top of everything else whose
+ * WM_CLASS is listed in the tearing-allowed-wm-classes preference. This is
+ * for games and the like, for which the latency of a late frame matters
+ * more than the tear. As soon as a window animates, synchronized swaps
+ * are back, so that effects never tear.
+ */
+static void
+update_tearing (MetaCompositor *compositor)
+{
+  MetaWindow *focus_window = compositor->display->focus_window;
+  MetaWindowActor *topmost = NULL;
+  gboolean allowed = FALSE;
+  GList *l;
+
+  if (focus_window != NULL &&
+      meta_window_is_fullscreen (focus_window) &&
+      window_allows_tearing (focus_window))
+    {
+      for (l = compositor->windows.tail; l; l = l->prev)
+        {
+          MetaWindowActor *window_actor = l->data;
+
+          if (meta_window_actor_effect_in_progress (window_actor))
+            {
+              topmost = NULL;
+              break;
+            }
+
+          if (topmost == NULL && CLUTTER_ACTOR_IS_VISIBLE (window_actor))
+            topmost = window_actor;
+        }
+
+      allowed = (topmost != NULL &&
+                 meta_window_actor_get_meta_window (topmost) == focus_window &&
+                 g_list_find (compositor->unredirected_windows, topmost) == NULL);
+    }
+
+  if (allowed == compositor->tearing_allowed)
+    return;
+
+  compositor->tearing_allowed = allowed;
+  clutter_stage_set_tearing_allowed (CLUTTER_STAGE (compositor->stage),
+                                     allowed);
+}
+
+/**
+ * meta_compositor_queue_frame_message:
+ * @compositor: a #MetaCompositor
+ * @event: a _NET_WM_FRAME_DRAWN or _NET_WM_FRAME_TIMINGS message
+ *
+ * Window actors queue their frame messages here rather than sending
+ * them one by one; everything queued during a frame goes out together
+ * in meta_compositor_flush_frame_messages().
+ */
+LOCAL_SYMBOL void
+meta_compositor_queue_frame_message (MetaCompositor      *compositor,
+                                     XClientMessageEvent *event)
+{
+  g_array_append_val (compositor->frame_messages, *event);
+}
+
+/**
+ * meta_compositor_flush_frame_messages:
+ * @compositor: a #MetaCompositor
+ *
+ * Sends the queued frame messages under a single error trap, since
+ * the windows may have been destroyed in the meantime.
+ */
+LOCAL_SYMBOL void
+meta_compositor_flush_frame_messages (MetaCompositor *compositor)
+{
+  MetaDisplay *display = compositor->display;
+  guint i;
+
+  if (compositor->frame_messages->len == 0)
+    return;
+
+  meta_error_trap_push (display);
+
+  for (i = 0; i < compositor->frame_messages->len; i++)
+    {
+      XClientMessageEvent *ev = &g_array_index (compositor->frame_messages,
+                                                XClientMessageEvent, i);
+
+      XSendEvent (display->xdisplay, ev->window, False, 0, (XEvent *) ev);
+    }
+
+  meta_display_flush (display);
+  meta_error_trap_pop (display);
+
+  g_array_set_size (compositor->frame_messages, 0);
+}
+
+static gboolean
+frame_messages_timeout (gpointer data)
+{
+  MetaCompositor *compositor = data;
+  gint64 now = g_get_monotonic_time ();
+  gint64 next_deadline = 0;
+  GList *l;
+
+  compositor->frame_messages_timer = 0;
+  compositor->frame_messages_deadline = 0;
+
+  for (l = compositor->windows.head; l; l = l->next)
+    {
+      gint64 deadline = meta_window_actor_dispatch_frame_messages (l->data, now);
+
+      if (deadline != 0 && (next_deadline == 0 || deadline < next_deadline))
+        next_deadline = deadline;
+    }
+
+  meta_compositor_flush_frame_messages (compositor);
+
+  if (next_deadline != 0)
+    meta_compositor_schedule_frame_messages (compositor, next_deadline);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * meta_compositor_schedule_frame_messages:
+ * @compositor: a #MetaCompositor
+ * @deadline: monotonic time, in microseconds, by which a window wants
+ *   its pending frame messages sent
+ *
+ * Obscured windows don't get painted, so their frame messages are sent
+ * from a timeout instead. All of them share one timer, set for the
+ * earliest deadline; meta_window_actor_dispatch_frame_messages() is
+ * called for every window when it expires.
+ */
+LOCAL_SYMBOL void
+meta_compositor_schedule_frame_messages (MetaCompositor *compositor,
+                                         gint64          deadline)
+{
+  gint64 offset;
+
+  if (compositor->frame_messages_timer != 0)
+    {
+      if (compositor->frame_messages_deadline <= deadline)
+        return;
+
+      g_source_remove (compositor->frame_messages_timer);
+    }
+
+  offset = MAX (0, deadline - g_get_monotonic_time ()) / 1000;
+
+  /* The clutter master clock source has already been added with META_PRIORITY_REDRAW,
+   * so the timer will run *after* the clutter frame handling, if a frame is ready
+   * to be drawn when the timer expires.
+   */
+  compositor->frame_messages_deadline = deadline;
+  compositor->frame_messages_timer = g_timeout_add_full (META_PRIORITY_REDRAW, offset,
+                                                         frame_messages_timeout,
+                                                         compositor, NULL);
+  g_source_set_name_by_id (compositor->frame_messages_timer, "[muffin] frame_messages_timeout");
+}
+
+static gboolean
+redraw_for_deferred_binds (gpointer data)
+{
+  MetaCompositor *compositor = data;
+
+  compositor->deferred_bind_id = 0;
+  clutter_actor_queue_redraw (compositor->stage);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * meta_compositor_reserve_pixmap_bind:
+ * @compositor: a #MetaCompositor
+ *
+ * Window actors call this before naming and binding a new pixmap in
+ * their pre-paint, so that when many windows map or resize at once
+ * (session restore, workspace switch) the X round trips and texture
+ * setup are spread over several frames instead of stalling one. When
+ * this frame's budget is used up another frame is scheduled, and the
+ * caller keeps painting its current texture, if any, until then.
+ *
+ * Return value: %TRUE if the caller may bind a pixmap this frame
+ */
+LOCAL_SYMBOL gboolean
+meta_compositor_reserve_pixmap_bind (MetaCompositor *compositor)
+{
+  if (compositor->pixmap_bind_budget == 0)
+    return TRUE;
+
+  if (compositor->pixmap_binds_remaining > 0)
+    {
+      compositor->pixmap_binds_remaining--;
+      return TRUE;
+    }
+
+  if (compositor->deferred_bind_id == 0)
+    compositor->deferred_bind_id = g_idle_add (redraw_for_deferred_binds, compositor);
+
+  return FALSE;
+}
+
+static gint
+compare_last_shown_time (gconstpointer a,
+                         gconstpointer b)
+{
+  gint64 time_a = meta_window_actor_get_last_shown_time ((MetaWindowActor *) a);
+  gint64 time_b = meta_window_actor_get_last_shown_time ((MetaWindowActor *) b);
+
+  if (time_a < time_b)
+    return -1;
+  else if (time_a > time_b)
+    return 1;
+  else
+    return 0;
+}
+
+typedef struct
+{
+  const char *category;
+  int         n_objects;
+  size_t      bytes;
+} TextureMemory;
+
+static void
+collect_texture_memory (const char *category,
+                        int         n_objects,
+                        size_t      bytes,
+                        void       *user_data)
+{
+  GArray *categories = user_data;
+  TextureMemory memory = { category, n_objects, bytes };
+
+  g_array_append_val (categories, memory);
+}
+
+static void
+collect_texture_uploads (const char   *category,
+                         unsigned int  n_uploads,
+                         uint64_t      bytes,
+                         void         *user_data)
+{
+  GArray *categories = user_data;
+  TextureMemory memory = { category, n_uploads, bytes };
+
+  g_array_append_val (categories, memory);
+}
+
+static gint
+compare_texture_memory (gconstpointer a,
+                        gconstpointer b)
+{
+  const TextureMemory *memory_a = a;
+  const TextureMemory *memory_b = b;
+
+  if (memory_a->bytes > memory_b->bytes)
+    return -1;
+  else if (memory_a->bytes < memory_b->bytes)
+    return 1;
+  else
+    return 0;
+}
+
+static void
+get_pipeline_cache_stats (gpointer        data,
+                          MetaCacheStats *stats)
+{
+  CoglCacheStats cogl_stats;
+
+  cogl_context_get_pipeline_cache_stats (data, &cogl_stats);
+  stats->n_entries = cogl_stats.n_entries;
+  stats->bytes = cogl_stats.bytes;
+  stats->hits = cogl_stats.hits;
+  stats->misses = cogl_stats.misses;
+  stats->evictions = cogl_stats.evictions;
+}
+
+static void
+trim_pipeline_cache (gpointer data)
+{
+  cogl_context_trim_pipeline_cache (data);
+}
+
+static void
+get_sampler_cache_stats (gpointer        data,
+                         MetaCacheStats *stats)
+{
+  CoglCacheStats cogl_stats;
+
+  cogl_context_get_sampler_cache_stats (data, &cogl_stats);
+  stats->n_entries = cogl_stats.n_entries;
+  stats->bytes = cogl_stats.bytes;
+  stats->hits = cogl_stats.hits;
+  stats->misses = cogl_stats.misses;
+  stats->evictions = cogl_stats.evictions;
+}
+
+static void
+get_glyph_cache_stats (gpointer        data,
+                       MetaCacheStats *stats)
+{
+  CoglCacheStats cogl_stats;
+
+  cogl_pango_font_map_get_glyph_cache_stats (data, &cogl_stats);
+  stats->n_entries = cogl_stats.n_entries;
+  stats->bytes = cogl_stats.bytes;
+  stats->hits = cogl_stats.hits;
+  stats->misses = cogl_stats.misses;
+  stats->evictions = cogl_stats.evictions;
+}
+
+/* The glyphs of the labels on screen are cached again on their next
+ * paint */
+static void
+trim_glyph_cache (gpointer data)
+{
+  cogl_pango_font_map_clear_glyph_cache (data);
+}
+
+#if GLIB_CHECK_VERSION (2, 64, 0)
+static void
+on_low_memory_warning (GMemoryMonitor             *monitor,
+                       GMemoryMonitorWarningLevel  level,
+                       MetaCompositor             *compositor)
+{
+  meta_verbose ("Trimming caches on low memory warning %d\n", level);
+  meta_cache_trim_all ();
+}
+#endif
+
+static gboolean
+report_texture_memory (gpointer data)
+{
+  MetaCompositor *compositor = data;
+  GArray *categories = g_array_new (FALSE, FALSE, sizeof (TextureMemory));
+  size_t total = 0;
+  guint i;
+
+  cogl_context_foreach_texture_memory (compositor->context,
+                                       collect_texture_memory, categories);
+  g_array_sort (categories, compare_texture_memory);
+
+  for (i = 0; i < categories->len; i++)
+    total += g_array_index (categories, TextureMemory, i).bytes;
+
+  g_printerr ("Texture memory: %.1f MiB\n", total / (1024. * 1024.));
+
+  for (i = 0; i < categories->len; i++)
+    {
+      TextureMemory *memory = &g_array_index (categories, TextureMemory, i);
+
+      g_printerr ("  %-18s %6d textures %8.1f MiB\n",
+                  memory->category, memory->n_objects,
+                  memory->bytes / (1024. * 1024.));
+    }
+
+  g_array_set_size (categories, 0);
+  cogl_context_foreach_texture_uploads (compositor->context,
+                                        collect_texture_uploads, categories);
+  g_array_sort (categories, compare_texture_memory);
+
+  g_printerr ("Texture uploads since startup:\n");
+
+  for (i = 0; i < categories->len; i++)
+    {
+      TextureMemory *memory = &g_array_index (categories, TextureMemory, i);
+
+      g_printerr ("  %-18s %8d uploads %8.1f MiB\n",
+                  memory->category, memory->n_objects,
+                  memory->bytes / (1024. * 1024.));
+    }
+
+  g_array_free (categories, TRUE);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* When the window textures together take more than the budget set with
+ * META_TEXTURE_BUDGET, evicts the textures of the hidden windows that
+ * were shown least recently until we are back within it. Visible windows
+ * are never evicted, so the budget can still be exceeded.
+ */
+static void
+enforce_texture_budget (MetaCompositor *compositor)
+{
+  GList *candidates = NULL;
+  GList *l;
+  gsize total = 0;
+
+  if (compositor->texture_budget == 0)
+    return;
+
+  for (l = compositor->windows.head; l; l = l->next)
+    {
+      MetaWindowActor *window_actor = l->data;
+
+      total += meta_window_actor_get_texture_memory (window_actor);
+
+      if (meta_window_actor_can_evict_texture (window_actor))
+        candidates = g_list_prepend (candidates, window_actor);
+    }
+
+  if (total > compositor->texture_budget)
+    {
+      candidates = g_list_sort (candidates, compare_last_shown_time);
+
+      for (l = candidates; l && total > compositor->texture_budget; l = l->next)
+        {
+          MetaWindowActor *window_actor = l->data;
+          gsize before = meta_window_actor_get_texture_memory (window_actor);
+
+          meta_window_actor_evict_texture (window_actor);
+          total -= before - meta_window_actor_get_texture_memory (window_actor);
+        }
+    }
+
+  g_list_free (candidates);
+}
+
+static gboolean
+meta_pre_paint_func (gpointer data)
+{
+  guint n_windows;
+  MetaCompositor *compositor = data;
+  GSList *screens = compositor->display->screens;
+  gint64 frame_counter = clutter_stage_get_frame_counter (CLUTTER_STAGE (compositor->stage));
+
+  META_TRACE1 (pre_paint_start, frame_counter);
+
+  /* The first frame compiles most of the shaders and pays for the
+   * first swap; the trace is written once it is done */
+  if (G_UNLIKELY (meta_startup_trace_enabled ()))
+    meta_startup_trace_begin ("first frame");
+
+  meta_frame_timings_begin_frame (frame_counter);
+  meta_texture_tower_begin_frame ();
+
+  /* Apply the latest motion of a mouse move or resize before the
+   * window actors are synced below */
+  if (compositor->display->grab_window != NULL)
+    meta_window_flush_grab_motion (compositor->display->grab_window);
+
+  if (compositor->windows.head == NULL)
+    {
+      meta_frame_timings_mark (META_FRAME_PHASE_LAYOUT);
+      META_TRACE (pre_paint_end);
+      return TRUE;
+    }
+
+  update_unredirected_windows (compositor);
+  update_variable_refresh (compositor);
+  update_tearing (compositor);
+  enforce_texture_budget (compositor);
+
+  compositor->pixmap_binds_remaining = compositor->pixmap_bind_budget;
+
+  /* Windows left with updates pending go back to the tail */
+  for (n_windows = compositor->pre_paint_windows.length; n_windows > 0; n_windows--)
+    meta_window_actor_pre_paint (compositor->pre_paint_windows.head->data);
+
+  if (compositor->frame_has_updated_xsurfaces)
+    {
+      /* We need to make sure that any X drawing that happens before
+       * the XDamageSubtract() for each window above is visible to
+       * subsequent GL rendering; the standardized way to do this is
+       * GL_EXT_X11_sync_object. Since this isn't implemented yet in
+       * mesa, we also have a path that relies on the implementation
+       * of the open source drivers.
+       *
+       * Anything else, we just hope for the best.
+       *
+       * Xorg and open source driver specifics:
+       *
+       * The X server makes sure to flush drawing to the kernel before
+       * sending out damage events, but since we use
+       * DamageReportBoundingBox (or DamageReportNonEmpty with
+       * META_DAMAGE_REGIONS) there may be drawing between the last
+       * damage event and the XDamageSubtract() that needs to be
+       * flushed as well.
+       *
+       * Xorg always makes sure that drawing is flushed to the kernel
+       * before writing events or responses to the client, so any
+       * round trip request at this point is sufficient to flush the
+       * GLX buffers.
+       */
+      if (compositor->have_x11_sync_object)
+        compositor->have_x11_sync_object = meta_sync_ring_insert_wait ();
+      else
+        XSync (compositor->display->xdisplay, False);
+    }
+
+  meta_frame_timings_mark (META_FRAME_PHASE_LAYOUT);
+
+  META_TRACE (pre_paint_end);
+
+  return TRUE;
+}
+
+/* Queues a redraw of @actor and each of its descendants, so that
+ * those with offscreen effects paint their cached images again */
+LOCAL_SYMBOL void
+meta_queue_redraw_all (ClutterActor *actor)
+{
+  ClutterActorIter iter;
+  ClutterActor *child;
+
+  clutter_actor_queue_redraw (actor);
+
+  clutter_actor_iter_init (&iter, actor);
+  while (clutter_actor_iter_next (&iter, &child))
+    meta_queue_redraw_all (child);
+}
+
+/* A video memory purge leaves the GL context usable but takes the
+ * contents of every texture and framebuffer with it, so everything
+ * the compositor drew into one is made again: the window textures
+ * are bound to their pixmaps again and their masks and shadows are
+ * made again on the next paint, the background is reloaded, and the
+ * icons are uploaded again. The cached images of the offscreen
+ * effects are painted again by redrawing every actor. Whatever the
+ * plugin made is up to it, on ::gl-video-memory-purged.
+ */
+static void
+recover_from_video_memory_purge (MetaCompositor *compositor)
+{
+  GSList *s;
+  GList *l;
+
+  meta_verbose ("Recreating textures after a video memory purge\n");
+
+  meta_shadow_factory_forget_shadows (meta_shadow_factory_get_default ());
+
+  for (l = compositor->windows.head; l; l = l->next)
+    meta_window_actor_reload_textures (l->data);
+
+  for (s = meta_display_get_screens (compositor->display); s; s = s->next)
+    meta_background_actor_reload (s->data);
+
+  meta_icon_textures_reload (compositor->stage);
+  cogl_pango_font_map_clear_glyph_cache (COGL_PANGO_FONT_MAP (clutter_get_font_map ()));
+
+  meta_queue_redraw_all (compositor->stage);
+
+  g_signal_emit_by_name (compositor->display, "gl-video-memory-purged");
+}
+
+static gboolean
+meta_post_paint_func (gpointer data)
+{
+  MetaCompositor *compositor = data;
+  CoglGraphicsResetStatus status;
+
+  META_TRACE (post_paint_start);
+
+  meta_frame_timings_mark (META_FRAME_PHASE_DONE);
+
+  if (compositor->frame_has_updated_xsurfaces)
+    {
+      if (compositor->have_x11_sync_object)
+        compositor->have_x11_sync_object = meta_sync_ring_after_frame ();
+
+      compositor->frame_has_updated_xsurfaces = FALSE;
+    }
+
+  status = cogl_get_graphics_reset_status (compositor->context);
+  switch (status)
+    {
+    case COGL_GRAPHICS_RESET_STATUS_NO_ERROR:
       break;
 
     case COGL_GRAPHICS_RESET_STATUS_PURGED_CONTEXT_RESET:
-      g_signal_emit_by_name (compositor->display, "gl-video-memory-purged");
-      clutter_actor_queue_redraw (CLUTTER_ACTOR (compositor->stage));
+      recover_from_video_memory_purge (compositor);
       break;
 
     default:
       /* The ARB_robustness spec says that, on error, the application
-         should destroy the old context and create a new one. Since we
-         don't have the necessary plumbing to do this we'll simply
-         restart the process. Obviously we can't do this when we are
-         a wayland compositor but in that case we shouldn't get here
-         since we don't enable robustness in that case. */
+         should destroy the old context and create a new one. The
+         context is shared by every Cogl object in the process, down to
+         the textures and pipelines the plugin and clutter's caches
+         hold, and Cogl can't put a new one under them, so we restart
+         the process instead. */
       meta_restart ();
       break;
     }
 
+  if (G_UNLIKELY (meta_startup_trace_enabled ()))
+    {
+      meta_startup_trace_end ("first frame");
+      meta_startup_trace_finish ();
+    }
+
+  META_TRACE (post_paint_end);
+
   return TRUE;
 }
 
@@ -1375,7 +2469,7 @@ meta_compositor_on_shadow_factory_changed (void)
 {
   GList *l;
 
-  for (l = compositor_global->windows; l; l = l->next)
+  for (l = compositor_global->windows.head; l; l = l->next)
     meta_window_actor_invalidate_shadow (l->data);
 }
 
@@ -1402,10 +2496,67 @@ meta_compositor_new (MetaDisplay *display)
 
   compositor->display = display;
   compositor->context = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  compositor->frame_messages = g_array_new (FALSE, FALSE, sizeof (XClientMessageEvent));
 
   if (g_getenv("META_DISABLE_MIPMAPS"))
     compositor->no_mipmaps = TRUE;
 
+  if (g_getenv("META_DAMAGE_REGIONS"))
+    compositor->damage_regions = TRUE;
+
+  if (g_getenv("META_DISABLE_OPAQUE_DETECTION"))
+    compositor->no_opaque_detection = TRUE;
+
+  if (g_getenv("META_MIPMAP_FRAME_BUDGET"))
+    meta_texture_tower_set_frame_budget (g_ascii_strtoll (g_getenv ("META_MIPMAP_FRAME_BUDGET"), NULL, 10));
+
+  if (g_getenv("META_DRIVER_MIPMAPS"))
+    meta_texture_tower_set_driver_mipmaps (TRUE);
+
+  compositor->pixmap_bind_budget = DEFAULT_PIXMAP_BIND_BUDGET;
+  if (g_getenv("META_PIXMAP_BIND_BUDGET"))
+    compositor->pixmap_bind_budget = MAX (0, g_ascii_strtoll (g_getenv ("META_PIXMAP_BIND_BUDGET"), NULL, 10));
+
+  /* In megabytes */
+  if (g_getenv("META_TEXTURE_BUDGET"))
+    compositor->texture_budget = MAX (0, g_ascii_strtoll (g_getenv ("META_TEXTURE_BUDGET"), NULL, 10)) * 1024 * 1024;
+
+  /* In seconds */
+  if (g_getenv ("MUFFIN_DEBUG_TEXTURE_MEMORY"))
+    {
+      gint64 period = g_ascii_strtoll (g_getenv ("MUFFIN_DEBUG_TEXTURE_MEMORY"), NULL, 10);
+
+      compositor->texture_memory_report_id =
+        g_timeout_add_seconds (period > 0 ? period : 10,
+                               report_texture_memory, compositor);
+    }
+
+  meta_cache_register ("cogl pipelines", get_pipeline_cache_stats,
+                       trim_pipeline_cache, compositor->context);
+  meta_cache_register ("cogl samplers", get_sampler_cache_stats,
+                       NULL, compositor->context);
+  meta_cache_register ("glyphs", get_glyph_cache_stats,
+                       trim_glyph_cache, clutter_get_font_map ());
+
+  if (g_getenv ("MUFFIN_DISTANCE_FIELD_TEXT"))
+    cogl_pango_font_map_set_use_distance_field
+      (COGL_PANGO_FONT_MAP (clutter_get_font_map ()), TRUE);
+
+  /* In seconds */
+  if (g_getenv ("MUFFIN_DEBUG_CACHES"))
+    {
+      gint64 period = g_ascii_strtoll (g_getenv ("MUFFIN_DEBUG_CACHES"), NULL, 10);
+
+      meta_cache_start_sampler (period > 0 ? period : 60);
+    }
+
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  compositor->memory_monitor = g_memory_monitor_dup_default ();
+  compositor->low_memory_id =
+    g_signal_connect (compositor->memory_monitor, "low-memory-warning",
+                      G_CALLBACK (on_low_memory_warning), compositor);
+#endif
+
   meta_verbose ("Creating %d atoms\n", (int) G_N_ELEMENTS (atom_names));
   XInternAtoms (xdisplay, atom_names, G_N_ELEMENTS (atom_names),
                 False, atoms);
@@ -1632,3 +2783,146 @@ meta_compositor_update_sync_state (MetaCompositor *compositor,
 {
   clutter_stage_x11_update_sync_state (compositor->stage, method);
 }
+
+void
+meta_compositor_update_geometric_picking (MetaCompositor *compositor)
+{
+  clutter_stage_set_geometric_picking (CLUTTER_STAGE (compositor->stage),
+                                       meta_prefs_get_geometric_picking ());
+}
+
+/*
+ * Density mode is for hosts running many sessions without a GPU: the
+ * frame rate is capped, so that damage is coalesced, and the work that
+ * doesn't follow from damage (effects, transitions and mipmaps, which
+ * take several frames to update) is skipped. The effects are skipped by
+ * the plugin manager and the background actors as they start.
+ */
+LOCAL_SYMBOL void
+meta_compositor_update_density_mode (MetaCompositor *compositor)
+{
+  GList *l;
+
+  if (meta_prefs_get_density_mode ())
+    clutter_master_clock_set_max_frame_rate (meta_prefs_get_density_frame_rate ());
+  else
+    clutter_master_clock_set_max_frame_rate (0);
+
+  for (l = compositor->windows.head; l; l = l->next)
+    meta_window_actor_update_create_mipmaps (l->data);
+}
+
+/* How an eye missing one kind of cone sees the colours (Machado et
+ * al., 2009), by row of red, green and blue */
+static const float color_blindness[3][3][3] = {
+  [0] = { {  0.152286,  1.052583, -0.204868 },
+          {  0.114503,  0.786281,  0.099216 },
+          { -0.003882, -0.048116,  1.051998 } },
+  [1] = { {  0.367322,  0.860646, -0.227968 },
+          {  0.280085,  0.672501,  0.047413 },
+          { -0.011820,  0.042940,  0.968881 } },
+  [2] = { {  1.255528, -0.076749, -0.178779 },
+          { -0.078411,  0.930809,  0.147602 },
+          {  0.004733,  0.691367,  0.303900 } },
+};
+
+/* Where the colour lost to colour blindness is added back */
+static const float color_error_shift[3][3] = {
+  { 0.0, 0.0, 0.0 },
+  { 0.7, 1.0, 0.0 },
+  { 0.7, 0.0, 1.0 },
+};
+
+static void
+get_color_filter_transform (MetaColorFilter  filter,
+                            CoglMatrix      *transform)
+{
+  float rgb[3][3] = { { 0 } };
+  float offset = 0.0;
+  float array[16] = { 0 };
+  int row, col, i;
+
+  switch (filter)
+    {
+    case META_COLOR_FILTER_GRAYSCALE:
+      for (row = 0; row < 3; row++)
+        {
+          rgb[row][0] = 0.2126;
+          rgb[row][1] = 0.7152;
+          rgb[row][2] = 0.0722;
+        }
+      break;
+    case META_COLOR_FILTER_INVERT:
+      for (row = 0; row < 3; row++)
+        rgb[row][row] = -1.0;
+      offset = 1.0;
+      break;
+    case META_COLOR_FILTER_PROTANOPIA:
+    case META_COLOR_FILTER_DEUTERANOPIA:
+    case META_COLOR_FILTER_TRITANOPIA:
+      {
+        const float (*simulation)[3] =
+          color_blindness[filter - META_COLOR_FILTER_PROTANOPIA];
+
+        /* The colour plus the shifted difference between it and what
+         * is seen of it: I + shift * (I - simulation) */
+        for (row = 0; row < 3; row++)
+          for (col = 0; col < 3; col++)
+            {
+              rgb[row][col] = row == col ? 1.0 : 0.0;
+
+              for (i = 0; i < 3; i++)
+                rgb[row][col] += color_error_shift[row][i] *
+                                 ((i == col ? 1.0 : 0.0) - simulation[i][col]);
+            }
+      }
+      break;
+    case META_COLOR_FILTER_NONE:
+      g_assert_not_reached ();
+    }
+
+  /* Column major, with the offset in the fourth column */
+  for (row = 0; row < 3; row++)
+    {
+      for (col = 0; col < 3; col++)
+        array[col * 4 + row] = rgb[row][col];
+      array[12 + row] = offset;
+    }
+  array[15] = 1.0;
+
+  cogl_matrix_init_from_array (transform, array);
+}
+
+/*
+ * meta_compositor_update_color_filter:
+ *
+ * Applies the color-filter preference, as a single pass over what each
+ * frame repaints rather than an effect on every window.
+ */
+LOCAL_SYMBOL void
+meta_compositor_update_color_filter (MetaCompositor *compositor)
+{
+  MetaColorFilter filter = meta_prefs_get_color_filter ();
+  gboolean active = filter != META_COLOR_FILTER_NONE;
+
+  if (active)
+    {
+      CoglMatrix transform;
+
+      get_color_filter_transform (filter, &transform);
+      clutter_stage_set_color_transform (CLUTTER_STAGE (compositor->stage),
+                                         &transform);
+    }
+  else
+    {
+      clutter_stage_set_color_transform (CLUTTER_STAGE (compositor->stage),
+                                         NULL);
+    }
+
+  if (active && !compositor->color_filter_active)
+    meta_disable_unredirect_for_screen (compositor->screen);
+  else if (!active && compositor->color_filter_active)
+    meta_enable_unredirect_for_screen (compositor->screen);
+
+  compositor->color_filter_active = active;
+}
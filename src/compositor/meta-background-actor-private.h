@@ -12,6 +12,7 @@ void meta_background_actor_set_visible_region  (MetaBackgroundActor *self,
 
 void meta_background_actor_update              (MetaScreen *screen);
 void meta_background_actor_screen_size_changed (MetaScreen *screen);
+void meta_background_actor_reload              (MetaScreen *screen);
 
 
 #endif /* META_BACKGROUND_ACTOR_PRIVATE_H */
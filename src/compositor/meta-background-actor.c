@@ -31,9 +31,13 @@
 
 #include <config.h>
 
+#include <math.h>
+#include <string.h>
+
 #include <cogl/winsys/cogl-texture-pixmap-x11.h>
 
 #include <clutter/clutter.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
 
 #include <X11/Xatom.h>
 
@@ -64,6 +68,11 @@ struct _MetaScreenBackground
   CoglTexture *texture;
   CoglPipelineWrapMode wrap_mode;
   guint have_pixmap : 1;
+
+  /* Set by meta_background_actor_set_file(); the root pixmap is
+   * ignored while it is */
+  char *filename;
+  GCancellable *load_cancellable;
 };
 
 struct _MetaBackgroundActorPrivate
@@ -105,6 +114,13 @@ on_notify_stage_color (GObject              *stage,
 static void
 free_screen_background (MetaScreenBackground *background)
 {
+  if (background->load_cancellable != NULL)
+    {
+      g_cancellable_cancel (background->load_cancellable);
+      g_clear_object (&background->load_cancellable);
+    }
+  g_free (background->filename);
+
   set_texture (background, NULL);
 
   if (background->screen != NULL)
@@ -181,6 +197,7 @@ cancel_transitions (MetaBackgroundActor *self)
   clutter_actor_remove_all_transitions (priv->top_actor);
   clutter_actor_set_opacity (priv->top_actor, 255);
   meta_background_set_layer (META_BACKGROUND (priv->bottom_actor), priv->background->texture);
+  clutter_actor_hide (priv->bottom_actor);
 
   priv->transition_running = FALSE;
 }
@@ -193,6 +210,11 @@ on_transition_complete (ClutterActor *actor,
   MetaBackgroundActorPrivate *priv = self->priv;
 
   meta_background_set_layer (META_BACKGROUND (priv->bottom_actor), priv->background->texture);
+
+  /* The top actor is opaque again and covers the bottom one entirely,
+   * so don't waste a full screen of fill rate drawing it underneath */
+  clutter_actor_hide (priv->bottom_actor);
+
   priv->transition_running = FALSE;
 }
 
@@ -218,7 +240,8 @@ set_texture_on_actor (MetaBackgroundActor *self)
 
   background_transition = meta_prefs_get_background_transition();
 
-  if (background_transition == META_BACKGROUND_TRANSITION_NONE)
+  if (background_transition == META_BACKGROUND_TRANSITION_NONE ||
+      meta_prefs_get_density_mode ())
   {
     // NO TRANSITION
     clutter_actor_set_opacity (CLUTTER_ACTOR (priv->bottom_actor), 0);
@@ -234,6 +257,7 @@ set_texture_on_actor (MetaBackgroundActor *self)
     }
 
     // BLEND TRANSITION
+    clutter_actor_show (priv->bottom_actor);
     clutter_actor_set_opacity (CLUTTER_ACTOR (priv->top_actor), 0);
     meta_background_set_layer (META_BACKGROUND (priv->top_actor), priv->background->texture);
 
@@ -272,7 +296,10 @@ set_texture (MetaScreenBackground *background,
   meta_error_trap_pop (display);
 
   if (texture != NULL)
-    background->texture = cogl_object_ref (texture);
+    {
+      background->texture = cogl_object_ref (texture);
+      cogl_texture_set_memory_category (texture, "backgrounds");
+    }
 
   background->texture_width = cogl_texture_get_width (background->texture);
   background->texture_height = cogl_texture_get_height (background->texture);
@@ -515,6 +542,9 @@ meta_background_actor_new_for_screen (MetaScreen *screen)
   set_texture_on_actors (self);
   update_wrap_mode_of_actor (self);
 
+  /* Nothing to show through the top actor until a transition starts */
+  clutter_actor_hide (priv->bottom_actor);
+
   return CLUTTER_ACTOR (self);
 }
 
@@ -543,6 +573,9 @@ meta_background_actor_update (MetaScreen *screen)
   Pixmap root_pixmap_id;
 
   background = meta_screen_background_get (screen);
+  if (background->filename != NULL)
+    return;
+
   display = meta_screen_get_display (screen);
   compositor = meta_display_get_compositor (display);
 
@@ -595,6 +628,234 @@ meta_background_actor_update (MetaScreen *screen)
   set_texture_to_stage_color (background);
 }
 
+/* Decoding a large image takes long enough to drop frames, so it's
+ * done on a worker thread, straight into a pixel buffer mapped for it
+ * beforehand. The image is scaled to cover the screen while it is
+ * decoded, which lets the JPEG decoder skip most of the work for an
+ * image much larger than the screen; the main thread is only left with
+ * uploading a screen-sized image from the buffer.
+ */
+typedef struct
+{
+  char *filename;
+  int width;
+  int height;
+
+  /* Only touched in the main thread */
+  CoglPixelBuffer *buffer;
+  /* The mapped buffer, written by the worker thread */
+  guint8 *pixels;
+
+  CoglPixelFormat format;
+  int rowstride;
+} LoadData;
+
+static void
+load_data_free (gpointer user_data)
+{
+  LoadData *data = user_data;
+
+  g_free (data->filename);
+  g_free (data);
+}
+
+static void
+load_file_thread (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+  LoadData *data = task_data;
+  GdkPixbuf *pixbuf;
+  GError *error = NULL;
+  const guint8 *src;
+  int image_width, image_height;
+  int scaled_width, scaled_height;
+  int n_channels, src_rowstride;
+  double scale;
+  int x, y;
+
+  if (!gdk_pixbuf_get_file_info (data->filename, &image_width, &image_height))
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                               "Couldn't recognize the image file format");
+      return;
+    }
+
+  scale = MAX ((double) data->width / image_width,
+               (double) data->height / image_height);
+  scaled_width = MAX (data->width, (int) ceil (image_width * scale));
+  scaled_height = MAX (data->height, (int) ceil (image_height * scale));
+
+  pixbuf = gdk_pixbuf_new_from_file_at_scale (data->filename,
+                                              scaled_width, scaled_height,
+                                              FALSE, &error);
+  if (pixbuf == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  /* The middle of the image is shown when it doesn't have the aspect
+   * ratio of the screen */
+  n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+  src_rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  x = (gdk_pixbuf_get_width (pixbuf) - data->width) / 2;
+  y = (gdk_pixbuf_get_height (pixbuf) - data->height) / 2;
+  src = gdk_pixbuf_get_pixels (pixbuf) + y * src_rowstride + x * n_channels;
+
+  data->format = n_channels == 4 ? COGL_PIXEL_FORMAT_RGBA_8888
+                                 : COGL_PIXEL_FORMAT_RGB_888;
+  data->rowstride = data->width * n_channels;
+
+  for (y = 0; y < data->height; y++)
+    memcpy (data->pixels + y * data->rowstride,
+            src + y * src_rowstride,
+            data->rowstride);
+
+  g_object_unref (pixbuf);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+on_file_loaded (GObject      *source_object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  MetaScreen *screen = META_SCREEN (source_object);
+  GTask *task = G_TASK (result);
+  LoadData *data = g_task_get_task_data (task);
+  MetaScreenBackground *background;
+  CoglBitmap *bitmap;
+  CoglTexture *texture;
+  CoglError *catch_error = NULL;
+  GError *error = NULL;
+
+  /* The worker thread is done with the buffer */
+  if (data->pixels != NULL)
+    cogl_buffer_unmap (COGL_BUFFER (data->buffer));
+
+  if (!g_task_propagate_boolean (task, &error))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to load background image %s: %s",
+                   data->filename, error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (data->buffer),
+                                        data->format,
+                                        data->width, data->height,
+                                        data->rowstride, 0);
+  texture = COGL_TEXTURE (cogl_texture_2d_new_from_bitmap (bitmap));
+  cogl_object_unref (bitmap);
+
+  if (!cogl_texture_allocate (texture, &catch_error))
+    {
+      g_warning ("Failed to create background texture from %s: %s",
+                 data->filename, catch_error->message);
+      cogl_error_free (catch_error);
+      cogl_object_unref (texture);
+      goto out;
+    }
+
+  background = meta_screen_background_get (screen);
+  g_clear_object (&background->load_cancellable);
+
+  set_texture (background, texture);
+  cogl_object_unref (texture);
+
+  background->have_pixmap = TRUE;
+
+ out:
+  cogl_object_unref (data->buffer);
+  data->buffer = NULL;
+}
+
+static void
+load_file (MetaScreenBackground *background)
+{
+  CoglContext *ctx;
+  LoadData *data;
+  GTask *task;
+
+  if (background->load_cancellable != NULL)
+    {
+      g_cancellable_cancel (background->load_cancellable);
+      g_object_unref (background->load_cancellable);
+    }
+  background->load_cancellable = g_cancellable_new ();
+
+  data = g_new0 (LoadData, 1);
+  data->filename = g_strdup (background->filename);
+  meta_screen_get_size (background->screen, &data->width, &data->height);
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  data->buffer = cogl_pixel_buffer_new (ctx, data->width * data->height * 4,
+                                        NULL);
+  data->pixels = cogl_buffer_map (COGL_BUFFER (data->buffer),
+                                  COGL_BUFFER_ACCESS_WRITE,
+                                  COGL_BUFFER_MAP_HINT_DISCARD);
+
+  task = g_task_new (background->screen, background->load_cancellable,
+                     on_file_loaded, NULL);
+  g_task_set_task_data (task, data, load_data_free);
+
+  if (data->pixels == NULL)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Couldn't map a buffer for the image");
+      g_object_unref (task);
+      return;
+    }
+
+  g_task_run_in_thread (task, load_file_thread);
+  g_object_unref (task);
+}
+
+/**
+ * meta_background_actor_set_file:
+ * @screen: a #MetaScreen
+ * @filename: (allow-none): an image file, or %NULL to go back to
+ *   the root window's background
+ *
+ * Shows the image in @filename in the background actors of @screen,
+ * scaled to cover the screen, instead of the root window's background
+ * pixmap. The image is decoded without blocking the compositor; the
+ * current background stays until it is ready, and then they are
+ * crossfaded like when the root pixmap changes.
+ */
+void
+meta_background_actor_set_file (MetaScreen *screen,
+                                const char *filename)
+{
+  MetaScreenBackground *background;
+
+  g_return_if_fail (META_IS_SCREEN (screen));
+
+  background = meta_screen_background_get (screen);
+
+  g_free (background->filename);
+  background->filename = g_strdup (filename);
+
+  if (filename != NULL)
+    {
+      load_file (background);
+    }
+  else
+    {
+      if (background->load_cancellable != NULL)
+        {
+          g_cancellable_cancel (background->load_cancellable);
+          g_clear_object (&background->load_cancellable);
+        }
+
+      meta_background_actor_update (screen);
+    }
+}
+
 /**
  * meta_background_actor_set_visible_region:
  * @self: a #MetaBackgroundActor
@@ -616,6 +877,11 @@ meta_background_actor_set_visible_region (MetaBackgroundActor *self,
 
   if (priv->top_actor != NULL)
     meta_background_set_visible_region (META_BACKGROUND (priv->top_actor), visible_region);
+
+  /* Only painted while the top actor fades in, and then the windows
+   * obscure both the same way */
+  if (priv->bottom_actor != NULL)
+    meta_background_set_visible_region (META_BACKGROUND (priv->bottom_actor), visible_region);
 }
 
 /**
@@ -634,4 +900,37 @@ meta_background_actor_screen_size_changed (MetaScreen *screen)
 
   for (l = background->actors; l; l = l->next)
     clutter_actor_queue_relayout (l->data);
+
+  /* Images from files are scaled to the size of the screen */
+  if (background->filename != NULL)
+    load_file (background);
+}
+
+/**
+ * meta_background_actor_reload:
+ * @screen: a #MetaScreen
+ *
+ * Creates the background texture of @screen again, from the root
+ * pixmap or the file, after the contents of the textures were lost.
+ */
+LOCAL_SYMBOL void
+meta_background_actor_reload (MetaScreen *screen)
+{
+  MetaScreenBackground *background = meta_screen_background_get (screen);
+  GSList *l;
+
+  /* Don't fade from what the old texture holds now */
+  set_texture_to_stage_color (background);
+  for (l = background->actors; l; l = l->next)
+    {
+      MetaBackgroundActor *self = l->data;
+
+      if (self->priv->transition_running)
+        cancel_transitions (self);
+    }
+
+  if (background->filename != NULL)
+    load_file (background);
+  else
+    meta_background_actor_update (screen);
 }
@@ -35,6 +35,8 @@ struct _MetaBackgroundPrivate
 {
   MetaScreen *screen;
   CoglPipeline  *pipeline;
+  /* The same with blending turned off, used when fully opaque */
+  CoglPipeline  *opaque_pipeline;
 
   float texture_width;
   float texture_height;
@@ -58,6 +60,12 @@ meta_background_dispose (GObject *object)
       priv->pipeline = NULL;
     }
 
+  if (priv->opaque_pipeline != NULL)
+    {
+      cogl_object_unref (priv->opaque_pipeline);
+      priv->opaque_pipeline = NULL;
+    }
+
   G_OBJECT_CLASS (meta_background_parent_class)->dispose (object);
 }
 
@@ -104,38 +112,57 @@ meta_background_paint (ClutterActor *actor)
   MetaBackground *self = META_BACKGROUND (actor);
   MetaBackgroundPrivate *priv = self->priv;
   guint8 opacity = clutter_actor_get_paint_opacity (actor);
-  guint8 color_component;
+  CoglPipeline *pipeline;
   int width, height;
 
   meta_screen_get_size (priv->screen, &width, &height);
 
-  color_component = (int)(0.5 + opacity);
-
-  cogl_pipeline_set_color4ub (priv->pipeline,
-                              color_component,
-                              color_component,
-                              color_component,
-                              opacity);
+  /* The root pixmap has no meaningful alpha, so at full opacity there
+   * is nothing to blend with what is below */
+  if (opacity == 255)
+    {
+      pipeline = priv->opaque_pipeline;
+    }
+  else
+    {
+      pipeline = priv->pipeline;
+      cogl_pipeline_set_color4ub (pipeline,
+                                  opacity, opacity, opacity, opacity);
+    }
 
-  cogl_set_source (priv->pipeline);
+  cogl_set_source (pipeline);
 
   if (priv->visible_region)
     {
       int n_rectangles = cairo_region_num_rectangles (priv->visible_region);
+      float *coords;
       int i;
 
+      if (n_rectangles == 0)
+        return;
+
+      /* Hand all the rectangles to Cogl at once so they are logged
+       * into the journal as a single batch */
+      coords = g_newa (float, n_rectangles * 8);
+
       for (i = 0; i < n_rectangles; i++)
         {
           cairo_rectangle_int_t rect;
+          float *v = coords + i * 8;
+
           cairo_region_get_rectangle (priv->visible_region, i, &rect);
 
-          cogl_rectangle_with_texture_coords (rect.x, rect.y,
-                                              rect.x + rect.width, rect.y + rect.height,
-                                              rect.x / priv->texture_width,
-                                              rect.y / priv->texture_height,
-                                              (rect.x + rect.width) / priv->texture_width,
-                                              (rect.y + rect.height) / priv->texture_height);
+          v[0] = rect.x;
+          v[1] = rect.y;
+          v[2] = rect.x + rect.width;
+          v[3] = rect.y + rect.height;
+          v[4] = rect.x / priv->texture_width;
+          v[5] = rect.y / priv->texture_height;
+          v[6] = (rect.x + rect.width) / priv->texture_width;
+          v[7] = (rect.y + rect.height) / priv->texture_height;
         }
+
+      cogl_rectangles_with_texture_coords (coords, n_rectangles);
     }
   else
     {
@@ -154,6 +181,19 @@ meta_background_get_paint_volume (ClutterActor       *actor,
   return clutter_paint_volume_set_from_allocation (volume, actor);
 }
 
+static cairo_region_t *
+meta_background_get_opaque_region (ClutterActor *actor)
+{
+  MetaBackground *self = META_BACKGROUND (actor);
+  cairo_rectangle_int_t rect = { 0, 0, 0, 0 };
+
+  /* We always paint the whole screen, and the root pixmap has no
+   * meaningful alpha; see meta_background_paint() */
+  meta_screen_get_size (self->priv->screen, &rect.width, &rect.height);
+
+  return cairo_region_create_rectangle (&rect);
+}
+
 
 static void
 meta_background_class_init (MetaBackgroundClass *klass)
@@ -169,6 +209,7 @@ meta_background_class_init (MetaBackgroundClass *klass)
   actor_class->get_preferred_height = meta_background_get_preferred_height;
   actor_class->get_paint_volume = meta_background_get_paint_volume;
   actor_class->paint = meta_background_paint;
+  actor_class->get_opaque_region = meta_background_get_opaque_region;
 }
 
 static void
@@ -191,6 +232,8 @@ meta_background_new (MetaScreen *screen)
 
   priv->screen = screen;
   priv->pipeline = meta_create_texture_pipeline (NULL);
+  priv->opaque_pipeline = cogl_pipeline_copy (priv->pipeline);
+  cogl_pipeline_set_blend (priv->opaque_pipeline, "RGBA = ADD (SRC_COLOR, 0)", NULL);
 
   return CLUTTER_ACTOR (self);
 }
@@ -207,6 +250,7 @@ meta_background_set_layer (MetaBackground *self,
    * X errors inside DRI. For safety, trap errors */
   meta_error_trap_push (display);
   cogl_pipeline_set_layer_texture (priv->pipeline, 0, texture);
+  cogl_pipeline_set_layer_texture (priv->opaque_pipeline, 0, texture);
   meta_error_trap_pop (display);
 
   priv->texture_width = cogl_texture_get_width (texture);
@@ -222,6 +266,7 @@ meta_background_set_layer_wrap_mode (MetaBackground       *self,
   MetaBackgroundPrivate *priv = self->priv;
 
   cogl_pipeline_set_layer_wrap_mode (priv->pipeline, 0, wrap_mode);
+  cogl_pipeline_set_layer_wrap_mode (priv->opaque_pipeline, 0, wrap_mode);
 }
 
 void
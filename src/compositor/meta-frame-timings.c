@@ -0,0 +1,222 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Frame timing history for the compositor
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <meta/util.h>
+
+#include "meta-frame-timings.h"
+#include "meta-sync-ring.h"
+
+/* We keep the last NUM_FRAMES stage frames. Every entry is written only
+ * from the main loop, in the order pre-paint, layout, paint, swap, done,
+ * and later presented when the frame event arrives, so there is no
+ * locking; a frame is simply overwritten once the ring wraps around.
+ *
+ * All times are in the g_get_monotonic_time() clock, in microseconds,
+ * with 0 meaning "didn't happen (yet)".
+ */
+#define NUM_FRAMES 512
+
+typedef struct
+{
+  gint64 frame_counter;
+
+  gint64 pre_paint_time;
+  gint64 phase_time[META_FRAME_PHASE_DONE + 1];
+  gint64 presentation_time;
+
+  guint  n_windows_updated;
+  gint64 damage_area;
+
+  gint64 sync_stall_time;
+} FrameTimings;
+
+static FrameTimings frames[NUM_FRAMES];
+static guint64 n_frames;
+
+static FrameTimings *
+current_frame (void)
+{
+  if (n_frames == 0)
+    return NULL;
+
+  return &frames[(n_frames - 1) % NUM_FRAMES];
+}
+
+/**
+ * meta_frame_timings_begin_frame:
+ * @frame_counter: the stage frame counter for the frame about to be drawn
+ *
+ * Starts recording a new frame; called at the start of the compositor's
+ * pre-paint hook.
+ */
+LOCAL_SYMBOL void
+meta_frame_timings_begin_frame (gint64 frame_counter)
+{
+  FrameTimings *frame = &frames[n_frames % NUM_FRAMES];
+
+  memset (frame, 0, sizeof (FrameTimings));
+  frame->frame_counter = frame_counter;
+  frame->pre_paint_time = g_get_monotonic_time ();
+
+  n_frames++;
+}
+
+/**
+ * meta_frame_timings_mark:
+ * @phase: the phase of the frame that is starting
+ *
+ * Records the time @phase of the current frame starts at, if it
+ * hasn't been recorded yet.
+ */
+LOCAL_SYMBOL void
+meta_frame_timings_mark (MetaFramePhase phase)
+{
+  FrameTimings *frame = current_frame ();
+
+  if (frame && frame->phase_time[phase] == 0)
+    frame->phase_time[phase] = g_get_monotonic_time ();
+}
+
+/**
+ * meta_frame_timings_add_damage:
+ * @area: number of damaged pixels
+ *
+ * Records that one window actor repaired @area pixels of damage
+ * for the current frame.
+ */
+LOCAL_SYMBOL void
+meta_frame_timings_add_damage (gint64 area)
+{
+  FrameTimings *frame = current_frame ();
+
+  if (frame)
+    {
+      frame->n_windows_updated++;
+      frame->damage_area += area;
+    }
+}
+
+/**
+ * meta_frame_timings_add_sync_stall:
+ * @stall_time: time spent blocked, in microseconds
+ *
+ * Records that the sync ring had to wait @stall_time for the GPU
+ * during the current frame.
+ */
+LOCAL_SYMBOL void
+meta_frame_timings_add_sync_stall (gint64 stall_time)
+{
+  FrameTimings *frame = current_frame ();
+
+  if (frame)
+    frame->sync_stall_time += stall_time;
+}
+
+/**
+ * meta_frame_timings_presented:
+ * @frame_counter: the frame counter from the frame event
+ * @presentation_time: presentation time, or 0 if unknown
+ *
+ * Records when the frame with @frame_counter hit the screen.
+ */
+LOCAL_SYMBOL void
+meta_frame_timings_presented (gint64 frame_counter,
+                              gint64 presentation_time)
+{
+  guint64 i;
+
+  /* Presentation is normally reported for one of the last couple of
+   * frames, so search backwards and give up quickly */
+  for (i = n_frames; i > 0 && n_frames - i < 8; i--)
+    {
+      FrameTimings *frame = &frames[(i - 1) % NUM_FRAMES];
+
+      if (frame->frame_counter == frame_counter)
+        {
+          frame->presentation_time = presentation_time;
+          break;
+        }
+    }
+}
+
+/**
+ * meta_frame_timings_dump:
+ * @filename: file to write to
+ * @error: return location for an error
+ *
+ * Writes the recorded frames, oldest first, as tab-separated text:
+ * one line per frame with the frame counter, the pre-paint time, the
+ * offsets of the layout, paint, swap, end and presentation times from
+ * it, the number of windows updated, the damaged area in pixels and
+ * the time spent stalled on the sync ring.
+ *
+ * Return value: %TRUE on success
+ */
+LOCAL_SYMBOL gboolean
+meta_frame_timings_dump (const char  *filename,
+                         GError     **error)
+{
+  MetaSyncRingStats sync_stats;
+  GString *str;
+  guint64 first, i;
+  gboolean result;
+
+  str = g_string_new (NULL);
+
+  if (meta_sync_ring_get_stats (&sync_stats))
+    g_string_append_printf (str, "# sync ring: %u syncs, %u stalls, "
+                            "%" G_GINT64_FORMAT " us total, %" G_GINT64_FORMAT " us max\n",
+                            sync_stats.n_syncs, sync_stats.n_stalls,
+                            sync_stats.total_stall_time, sync_stats.max_stall_time);
+
+  g_string_append (str, "# frame\tpre_paint\tlayout\tpaint\tswap\tdone\tpresented\twindows\tdamage\tsync_stall\n");
+
+  first = n_frames > NUM_FRAMES ? n_frames - NUM_FRAMES : 0;
+
+  for (i = first; i < n_frames; i++)
+    {
+      FrameTimings *frame = &frames[i % NUM_FRAMES];
+      int phase;
+
+      g_string_append_printf (str, "%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT,
+                              frame->frame_counter, frame->pre_paint_time);
+
+      for (phase = META_FRAME_PHASE_LAYOUT; phase <= META_FRAME_PHASE_DONE; phase++)
+        g_string_append_printf (str, "\t%" G_GINT64_FORMAT,
+                                frame->phase_time[phase] ?
+                                frame->phase_time[phase] - frame->pre_paint_time : -1);
+
+      g_string_append_printf (str, "\t%" G_GINT64_FORMAT "\t%u\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\n",
+                              frame->presentation_time ?
+                              frame->presentation_time - frame->pre_paint_time : -1,
+                              frame->n_windows_updated,
+                              frame->damage_area,
+                              frame->sync_stall_time);
+    }
+
+  result = g_file_set_contents (filename, str->str, str->len, error);
+  g_string_free (str, TRUE);
+
+  return result;
+}
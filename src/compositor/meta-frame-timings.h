@@ -0,0 +1,44 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Frame timing history for the compositor
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#ifndef __META_FRAME_TIMINGS_H__
+#define __META_FRAME_TIMINGS_H__
+
+#include <glib.h>
+
+typedef enum
+{
+  META_FRAME_PHASE_LAYOUT,
+  META_FRAME_PHASE_PAINT,
+  META_FRAME_PHASE_SWAP,
+  META_FRAME_PHASE_DONE
+} MetaFramePhase;
+
+void     meta_frame_timings_begin_frame    (gint64          frame_counter);
+void     meta_frame_timings_mark           (MetaFramePhase  phase);
+void     meta_frame_timings_add_damage     (gint64          area);
+void     meta_frame_timings_add_sync_stall (gint64          stall_time);
+void     meta_frame_timings_presented      (gint64          frame_counter,
+                                            gint64          presentation_time);
+
+gboolean meta_frame_timings_dump           (const char     *filename,
+                                            GError        **error);
+
+#endif /* __META_FRAME_TIMINGS_H__ */
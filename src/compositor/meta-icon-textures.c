@@ -0,0 +1,316 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Window icons shared as textures
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include <meta/compositor-muffin.h>
+#include <meta/window.h>
+#include "cache-stats.h"
+#include "compositor-private.h"
+
+/* Windows of the same application mostly have the same icon, so the
+ * textures are keyed by the icon's pixels: thirty terminals share one.
+ * Each texture is an atlas texture, so the icons also share a few
+ * large textures on the GPU, and drawing several of them doesn't
+ * switch textures between each.
+ *
+ * The icon pixbufs that meta_window_create_icon() keeps for each size
+ * hold a reference on their texture, so a texture lives as long as
+ * some window still has its icon, and looking it up again for the same
+ * pixbuf costs nothing.
+ */
+typedef struct
+{
+  guint hash;
+  int width;
+  int height;
+  int rowstride;
+  gboolean has_alpha;
+  /* Packed rows, kept to tell icons with the same hash apart */
+  guint8 *pixels;
+
+  CoglTexture *texture;
+  int ref_count;
+} MetaIconTexture;
+
+static GHashTable *icon_textures = NULL;
+static GQuark icon_texture_quark = 0;
+static guint64 n_hits = 0;
+static guint64 n_misses = 0;
+
+/* Icons being uploaded again, and the stage to redraw once they are */
+static int n_reloading = 0;
+static ClutterActor *reload_stage = NULL;
+
+/* Up to half a second at 60 frames a second */
+#define RELOAD_DEADLINE 30
+
+static guint
+meta_icon_texture_hash (gconstpointer data)
+{
+  const MetaIconTexture *icon = data;
+
+  return icon->hash;
+}
+
+static gboolean
+meta_icon_texture_equal (gconstpointer a,
+                         gconstpointer b)
+{
+  const MetaIconTexture *icon_a = a;
+  const MetaIconTexture *icon_b = b;
+
+  return (icon_a->hash == icon_b->hash &&
+          icon_a->width == icon_b->width &&
+          icon_a->height == icon_b->height &&
+          icon_a->has_alpha == icon_b->has_alpha &&
+          memcmp (icon_a->pixels, icon_b->pixels,
+                  (gsize) icon_a->rowstride * icon_a->height) == 0);
+}
+
+static void
+meta_icon_texture_unref (MetaIconTexture *icon)
+{
+  if (--icon->ref_count > 0)
+    return;
+
+  g_hash_table_remove (icon_textures, icon);
+
+  cogl_object_unref (icon->texture);
+  g_free (icon->pixels);
+  g_slice_free (MetaIconTexture, icon);
+}
+
+static void
+get_cache_stats (gpointer        data,
+                 MetaCacheStats *stats)
+{
+  GHashTableIter iter;
+  MetaIconTexture *icon;
+
+  g_hash_table_iter_init (&iter, icon_textures);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &icon, NULL))
+    {
+      stats->n_entries++;
+      stats->bytes += (gsize) icon->width * icon->height * 4;
+    }
+
+  stats->hits = n_hits;
+  stats->misses = n_misses;
+}
+
+/* Copies the pixels of @pixbuf into @icon without the padding at the
+ * end of the rows, and hashes them */
+static void
+init_icon_texture (MetaIconTexture *icon,
+                   GdkPixbuf       *pixbuf)
+{
+  const guint8 *src = gdk_pixbuf_get_pixels (pixbuf);
+  int src_rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  gsize size;
+  guint hash = 5381;
+  gsize i;
+  int y;
+
+  icon->width = gdk_pixbuf_get_width (pixbuf);
+  icon->height = gdk_pixbuf_get_height (pixbuf);
+  icon->has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+  icon->rowstride = icon->width * gdk_pixbuf_get_n_channels (pixbuf);
+
+  size = (gsize) icon->rowstride * icon->height;
+  icon->pixels = g_malloc (size);
+
+  for (y = 0; y < icon->height; y++)
+    memcpy (icon->pixels + y * icon->rowstride,
+            src + y * src_rowstride,
+            icon->rowstride);
+
+  for (i = 0; i < size; i++)
+    hash = hash * 33 + icon->pixels[i];
+
+  icon->hash = hash;
+}
+
+static CoglTexture *
+create_texture (MetaIconTexture *icon)
+{
+  CoglContext *ctx =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  CoglPixelFormat format;
+  CoglTexture *texture;
+  CoglError *error = NULL;
+
+  format = icon->has_alpha ? COGL_PIXEL_FORMAT_RGBA_8888
+                           : COGL_PIXEL_FORMAT_RGB_888;
+
+  texture = COGL_TEXTURE (cogl_atlas_texture_new_from_data (ctx,
+                                                            icon->width,
+                                                            icon->height,
+                                                            format,
+                                                            icon->rowstride,
+                                                            icon->pixels,
+                                                            NULL));
+  if (texture != NULL)
+    return texture;
+
+  /* Too large an icon for the atlas */
+  texture = COGL_TEXTURE (cogl_texture_2d_new_from_data (ctx,
+                                                         icon->width,
+                                                         icon->height,
+                                                         format,
+                                                         icon->rowstride,
+                                                         icon->pixels,
+                                                         &error));
+  if (texture == NULL)
+    {
+      g_warning ("Failed to create a %dx%d icon texture: %s",
+                 icon->width, icon->height, error->message);
+      cogl_error_free (error);
+    }
+
+  return texture;
+}
+
+static void
+on_icon_reloaded (CoglTexture *texture,
+                  CoglBool     uploaded,
+                  void        *user_data)
+{
+  if (--n_reloading > 0)
+    return;
+
+  /* Including what offscreen effects cached with the icons missing */
+  meta_queue_redraw_all (reload_stage);
+  g_clear_object (&reload_stage);
+}
+
+/* The textures are handed out without a reference for as long as the
+ * icon stays the same, so their contents are uploaded again from the
+ * pixels kept for each rather than the textures being replaced. That
+ * happens along with everything else the compositor makes again, so
+ * the icons are queued at a low priority and @stage is redrawn once
+ * they have all landed */
+LOCAL_SYMBOL void
+meta_icon_textures_reload (ClutterActor *stage)
+{
+  GHashTableIter iter;
+  MetaIconTexture *icon;
+
+  if (icon_textures == NULL)
+    return;
+
+  if (reload_stage == NULL)
+    reload_stage = g_object_ref (stage);
+
+  g_hash_table_iter_init (&iter, icon_textures);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &icon, NULL))
+    {
+      if (cogl_texture_queue_region (icon->texture,
+                                     0, 0,
+                                     icon->width, icon->height,
+                                     icon->has_alpha ? COGL_PIXEL_FORMAT_RGBA_8888
+                                                     : COGL_PIXEL_FORMAT_RGB_888,
+                                     icon->rowstride,
+                                     icon->pixels,
+                                     COGL_UPLOAD_PRIORITY_LOW,
+                                     RELOAD_DEADLINE,
+                                     on_icon_reloaded, NULL))
+        n_reloading++;
+    }
+
+  if (n_reloading == 0)
+    g_clear_object (&reload_stage);
+}
+
+/**
+ * meta_get_icon_texture_for_window:
+ * @window: a #MetaWindow
+ * @size: icon width and height
+ *
+ * Gets the icon of @window, as meta_window_create_icon() creates it,
+ * as a texture. Windows with identical icons get the same texture.
+ *
+ * Return value: (transfer none): a #CoglTexture, valid until the icon
+ * of @window changes, or %NULL
+ */
+CoglTexture *
+meta_get_icon_texture_for_window (MetaWindow *window,
+                                  int         size)
+{
+  GdkPixbuf *pixbuf;
+  MetaIconTexture key;
+  MetaIconTexture *icon;
+
+  g_return_val_if_fail (META_IS_WINDOW (window), NULL);
+
+  pixbuf = meta_window_create_icon (window, size);
+  if (pixbuf == NULL)
+    return NULL;
+
+  if (icon_textures == NULL)
+    {
+      icon_textures = g_hash_table_new (meta_icon_texture_hash,
+                                        meta_icon_texture_equal);
+      icon_texture_quark = g_quark_from_static_string ("meta-icon-texture");
+
+      meta_cache_register ("icon textures", get_cache_stats, NULL, NULL);
+    }
+
+  icon = g_object_get_qdata (G_OBJECT (pixbuf), icon_texture_quark);
+  if (icon != NULL)
+    {
+      n_hits++;
+      return icon->texture;
+    }
+
+  init_icon_texture (&key, pixbuf);
+
+  icon = g_hash_table_lookup (icon_textures, &key);
+  if (icon != NULL)
+    {
+      n_hits++;
+      icon->ref_count++;
+      g_free (key.pixels);
+    }
+  else
+    {
+      n_misses++;
+
+      key.texture = create_texture (&key);
+      if (key.texture == NULL)
+        {
+          g_free (key.pixels);
+          return NULL;
+        }
+
+      key.ref_count = 1;
+      icon = g_slice_dup (MetaIconTexture, &key);
+      g_hash_table_add (icon_textures, icon);
+    }
+
+  g_object_set_qdata_full (G_OBJECT (pixbuf), icon_texture_quark, icon,
+                           (GDestroyNotify) meta_icon_texture_unref);
+
+  return icon->texture;
+}
@@ -0,0 +1,211 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Full screen magnifier drawn by the compositor
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+
+#include <config.h>
+
+#include <meta/compositor-muffin.h>
+#include <meta/display.h>
+#include <meta/prefs.h>
+
+#include "meta-magnifier.h"
+
+/* The stage's children are scaled about the pointer by the stage's
+ * child transform, so the GPU samples the window textures at the zoom
+ * rather than a screenshot being scaled, and whatever is under the
+ * pointer stays under it: clicks reach what they appear to. Damage to
+ * a window goes through the same transform, so while the pointer
+ * stands still only what changed is redrawn; moving it redraws the
+ * whole stage, as the whole view moves.
+ *
+ * Muffin doesn't get pointer motion outside its own windows, so the
+ * pointer is polled while the screen is magnified, and only then.
+ */
+#define ZOOM_STEP 1.25
+#define MAX_ZOOM 32.0
+#define TRACK_INTERVAL 16 /* ms */
+
+static MetaScreen *magnifier_screen;
+static double magnifier_zoom = 1.0;
+static int pointer_x, pointer_y;
+static guint track_id;
+static gulong zoom_in_id, zoom_out_id;
+
+static void
+apply_transform (void)
+{
+  ClutterActor *stage = meta_get_stage_for_screen (magnifier_screen);
+  ClutterMatrix transform;
+
+  clutter_matrix_init_identity (&transform);
+
+  if (magnifier_zoom > 1.0)
+    {
+      cogl_matrix_translate (&transform,
+                             pointer_x * (1.0 - magnifier_zoom),
+                             pointer_y * (1.0 - magnifier_zoom),
+                             0);
+      cogl_matrix_scale (&transform, magnifier_zoom, magnifier_zoom, 1);
+    }
+
+  clutter_actor_set_child_transform (stage, &transform);
+}
+
+static gboolean
+query_pointer (void)
+{
+  MetaDisplay *display = meta_screen_get_display (magnifier_screen);
+  Window root, child;
+  int x, y, win_x, win_y;
+  unsigned int mask;
+
+  if (!XQueryPointer (meta_display_get_xdisplay (display),
+                      meta_screen_get_xroot (magnifier_screen),
+                      &root, &child, &x, &y, &win_x, &win_y, &mask))
+    return FALSE;
+
+  if (x == pointer_x && y == pointer_y)
+    return FALSE;
+
+  pointer_x = x;
+  pointer_y = y;
+
+  return TRUE;
+}
+
+static gboolean
+track_pointer (gpointer data)
+{
+  if (query_pointer ())
+    apply_transform ();
+
+  return G_SOURCE_CONTINUE;
+}
+
+LOCAL_SYMBOL void
+meta_magnifier_set_zoom (double zoom)
+{
+  gboolean was_magnified = magnifier_zoom > 1.0;
+
+  g_return_if_fail (magnifier_screen != NULL);
+
+  zoom = CLAMP (zoom, 1.0, MAX_ZOOM);
+  if (zoom == magnifier_zoom)
+    return;
+
+  magnifier_zoom = zoom;
+
+  if (zoom > 1.0 && !was_magnified)
+    {
+      /* An unredirected window would be shown unmagnified */
+      meta_disable_unredirect_for_screen (magnifier_screen);
+
+      query_pointer ();
+      track_id = g_timeout_add (TRACK_INTERVAL, track_pointer, NULL);
+      g_source_set_name_by_id (track_id, "[muffin] magnifier_track_pointer");
+    }
+  else if (zoom == 1.0 && was_magnified)
+    {
+      g_source_remove (track_id);
+      track_id = 0;
+
+      meta_enable_unredirect_for_screen (magnifier_screen);
+    }
+
+  apply_transform ();
+}
+
+LOCAL_SYMBOL double
+meta_magnifier_get_zoom (void)
+{
+  return magnifier_zoom;
+}
+
+static void
+on_zoom_scroll_in (MetaDisplay *display,
+                   gpointer     data)
+{
+  if (meta_prefs_get_compositor_magnifier ())
+    meta_magnifier_set_zoom (magnifier_zoom * ZOOM_STEP);
+}
+
+static void
+on_zoom_scroll_out (MetaDisplay *display,
+                    gpointer     data)
+{
+  double zoom = magnifier_zoom / ZOOM_STEP;
+
+  if (!meta_prefs_get_compositor_magnifier ())
+    return;
+
+  /* Don't get stuck just above 1 after rounding */
+  if (zoom < 1.0 + 1e-3)
+    zoom = 1.0;
+
+  meta_magnifier_set_zoom (zoom);
+}
+
+static void
+prefs_changed_callback (MetaPreference pref,
+                        gpointer       data)
+{
+  if (pref == META_PREF_COMPOSITOR_MAGNIFIER &&
+      !meta_prefs_get_compositor_magnifier ())
+    meta_magnifier_set_zoom (1.0);
+}
+
+LOCAL_SYMBOL void
+meta_magnifier_init (MetaScreen *screen)
+{
+  MetaDisplay *display = meta_screen_get_display (screen);
+
+  magnifier_screen = screen;
+
+  zoom_in_id = g_signal_connect (display, "zoom-scroll-in",
+                                 G_CALLBACK (on_zoom_scroll_in), NULL);
+  zoom_out_id = g_signal_connect (display, "zoom-scroll-out",
+                                  G_CALLBACK (on_zoom_scroll_out), NULL);
+
+  meta_prefs_add_listener (prefs_changed_callback, NULL);
+}
+
+LOCAL_SYMBOL void
+meta_magnifier_shutdown (void)
+{
+  MetaDisplay *display;
+
+  if (magnifier_screen == NULL)
+    return;
+
+  display = meta_screen_get_display (magnifier_screen);
+
+  meta_prefs_remove_listener (prefs_changed_callback, NULL);
+  g_signal_handler_disconnect (display, zoom_in_id);
+  g_signal_handler_disconnect (display, zoom_out_id);
+
+  if (track_id != 0)
+    {
+      g_source_remove (track_id);
+      track_id = 0;
+    }
+
+  magnifier_screen = NULL;
+  magnifier_zoom = 1.0;
+}
@@ -0,0 +1,33 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Full screen magnifier drawn by the compositor
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+
+#ifndef __META_MAGNIFIER_H__
+#define __META_MAGNIFIER_H__
+
+#include <meta/screen.h>
+
+void   meta_magnifier_init     (MetaScreen *screen);
+void   meta_magnifier_shutdown (void);
+
+void   meta_magnifier_set_zoom (double      zoom);
+double meta_magnifier_get_zoom (void);
+
+#endif /* __META_MAGNIFIER_H__ */
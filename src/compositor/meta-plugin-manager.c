@@ -134,7 +134,8 @@ meta_plugin_manager_event_simple (MetaPluginManager *plugin_mgr,
     MetaDisplay *display  = meta_screen_get_display (plugin_mgr->screen);
     gboolean retval = FALSE;
 
-    if (display->display_opening)
+    if (display->display_opening || meta_prefs_get_density_mode () ||
+        !meta_plugin_wants_effect (plugin, event))
       return FALSE;
 
     switch (event)
@@ -197,7 +198,8 @@ meta_plugin_manager_event_maximize (MetaPluginManager *plugin_mgr,
     MetaDisplay *display  = meta_screen_get_display (plugin_mgr->screen);
     gboolean retval = FALSE;
 
-    if (display->display_opening)
+    if (display->display_opening || meta_prefs_get_density_mode () ||
+        !meta_plugin_wants_effect (plugin, event))
         return FALSE;
 
     switch (event)
@@ -268,7 +270,8 @@ meta_plugin_manager_switch_workspace (MetaPluginManager   *plugin_mgr,
     MetaDisplay *display  = meta_screen_get_display (plugin_mgr->screen);
     gboolean retval = FALSE;
 
-    if (display->display_opening)
+    if (display->display_opening || meta_prefs_get_density_mode () ||
+        !meta_plugin_wants_effect (plugin, META_PLUGIN_SWITCH_WORKSPACE))
         return FALSE;
 
     if (klass->switch_workspace)
@@ -294,19 +297,23 @@ LOCAL_SYMBOL gboolean
 meta_plugin_manager_xevent_filter (MetaPluginManager *plugin_mgr,
                                    XEvent            *xev)
 {
-  MetaPlugin *plugin = plugin_mgr->plugin;
-  MetaPluginClass *klass = META_PLUGIN_GET_CLASS (plugin);
+  MetaPlugin *plugin;
+  MetaPluginClass *klass;
 
   if (!plugin_mgr)
     return FALSE;
 
+  plugin = plugin_mgr->plugin;
+  klass = META_PLUGIN_GET_CLASS (plugin);
+
   /* We need to make sure that clutter gets certain events, like
    * ConfigureNotify on the stage window. If there is a plugin that
    * provides an xevent_filter function, then it's the responsibility
-   * of that plugin to pass events to Clutter. Otherwise, we send the
+   * of that plugin to pass events to Clutter. Otherwise, or if the
+   * plugin didn't subscribe to this type of event, we send the
    * event directly to Clutter ourselves.
    */
-   if (klass->xevent_filter)
+   if (klass->xevent_filter && meta_plugin_wants_xevent (plugin, xev->type))
     return klass->xevent_filter (plugin, xev);
    else
     return clutter_x11_handle_event (xev) != CLUTTER_X11_FILTER_CONTINUE;
@@ -31,15 +31,22 @@
 #include <meta/meta-plugin.h>
 #undef   META_PLUGIN_FROM_MANAGER_
 
-#define META_PLUGIN_MINIMIZE         (1<<0)
-#define META_PLUGIN_MAXIMIZE         (1<<1)
-#define META_PLUGIN_UNMAXIMIZE       (1<<2)
-#define META_PLUGIN_TILE             (1<<6)
-#define META_PLUGIN_MAP              (1<<3)
-#define META_PLUGIN_DESTROY          (1<<4)
-#define META_PLUGIN_SWITCH_WORKSPACE (1<<5)
-
-#define META_PLUGIN_ALL_EFFECTS      (~0)
+#define META_PLUGIN_MINIMIZE         META_PLUGIN_EFFECT_MINIMIZE
+#define META_PLUGIN_MAXIMIZE         META_PLUGIN_EFFECT_MAXIMIZE
+#define META_PLUGIN_UNMAXIMIZE       META_PLUGIN_EFFECT_UNMAXIMIZE
+#define META_PLUGIN_TILE             META_PLUGIN_EFFECT_TILE
+#define META_PLUGIN_MAP              META_PLUGIN_EFFECT_MAP
+#define META_PLUGIN_DESTROY          META_PLUGIN_EFFECT_DESTROY
+#define META_PLUGIN_SWITCH_WORKSPACE META_PLUGIN_EFFECT_SWITCH_WORKSPACE
+
+#define META_PLUGIN_ALL_EFFECTS      META_PLUGIN_EFFECT_ALL
+
+/* What the plugin subscribed to; see meta_plugin_set_effects() and
+ * meta_plugin_set_xevent_types() */
+gboolean meta_plugin_wants_effect (MetaPlugin    *plugin,
+                                   unsigned long  event);
+gboolean meta_plugin_wants_xevent (MetaPlugin    *plugin,
+                                   int            event_type);
 
 /**
  * MetaPluginManager: (skip)
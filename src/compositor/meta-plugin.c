@@ -59,8 +59,17 @@ struct _MetaPluginPrivate
 
   gint          running;
   gboolean      debug    : 1;
+
+  MetaPluginEffect effects;
+
+  /* NULL while every X event goes to xevent_filter; otherwise a bit
+   * for each event type, extension ones included, that does */
+  guint32      *xevent_types;
 };
 
+/* Event types are 7 bits; the top bit of the code is send_event */
+#define N_XEVENT_TYPES 128
+
 static void
 meta_plugin_set_property (GObject      *object,
                           guint         prop_id,
@@ -105,12 +114,23 @@ meta_plugin_get_property (GObject    *object,
     }
 }
 
+static void
+meta_plugin_finalize (GObject *object)
+{
+  MetaPluginPrivate *priv = META_PLUGIN (object)->priv;
+
+  g_free (priv->xevent_types);
+
+  G_OBJECT_CLASS (meta_plugin_parent_class)->finalize (object);
+}
+
 
 static void
 meta_plugin_class_init (MetaPluginClass *klass)
 {
   GObjectClass      *gobject_class = G_OBJECT_CLASS (klass);
 
+  gobject_class->finalize        = meta_plugin_finalize;
   gobject_class->set_property    = meta_plugin_set_property;
   gobject_class->get_property    = meta_plugin_get_property;
 
@@ -139,6 +159,8 @@ meta_plugin_init (MetaPlugin *self)
   MetaPluginPrivate *priv;
 
   self->priv = priv = META_PLUGIN_GET_PRIVATE (self);
+
+  priv->effects = META_PLUGIN_EFFECT_ALL;
 }
 
 gboolean
@@ -168,6 +190,112 @@ meta_plugin_get_info (MetaPlugin *plugin)
   return NULL;
 }
 
+/**
+ * meta_plugin_set_effects:
+ * @plugin: a #MetaPlugin
+ * @effects: the effects the plugin runs
+ *
+ * Stops the plugin being called for the effects it doesn't run, even
+ * though its class has the vfuncs for them; muffin then does without
+ * the effects, as if the vfuncs were missing. By default every effect
+ * the class has a vfunc for is run.
+ *
+ * This spares plugins that decide in script whether to animate a
+ * window, and return at once for most windows, a call for every
+ * window that maps or closes.
+ */
+void
+meta_plugin_set_effects (MetaPlugin       *plugin,
+                         MetaPluginEffect  effects)
+{
+  MetaPluginPrivate *priv = META_PLUGIN (plugin)->priv;
+
+  priv->effects = effects & META_PLUGIN_EFFECT_ALL;
+}
+
+/**
+ * meta_plugin_get_effects:
+ * @plugin: a #MetaPlugin
+ *
+ * Return value: the effects set by meta_plugin_set_effects()
+ */
+MetaPluginEffect
+meta_plugin_get_effects (MetaPlugin *plugin)
+{
+  MetaPluginPrivate *priv = META_PLUGIN (plugin)->priv;
+
+  return priv->effects;
+}
+
+/**
+ * meta_plugin_set_xevent_types:
+ * @plugin: a #MetaPlugin
+ * @event_types: (array length=n_event_types) (allow-none): the X event
+ *   types the plugin's xevent_filter wants, or %NULL for all of them
+ * @n_event_types: the length of @event_types
+ *
+ * Limits the events the xevent_filter vfunc is called for, which is
+ * otherwise every X event muffin sees. The others are handed to
+ * Clutter directly, as they would be if the plugin had no filter, and
+ * are then processed by muffin; so the plugin has to subscribe to the
+ * events it may want to block as well as those it watches.
+ *
+ * Extension events are subscribed to by their type as reported by the
+ * server, and all XInput 2 events by GenericEvent. Events grabbed
+ * during meta_plugin_begin_modal() always reach the plugin.
+ */
+void
+meta_plugin_set_xevent_types (MetaPlugin *plugin,
+                              const int  *event_types,
+                              int         n_event_types)
+{
+  MetaPluginPrivate *priv = META_PLUGIN (plugin)->priv;
+  int i;
+
+  g_clear_pointer (&priv->xevent_types, g_free);
+
+  if (event_types == NULL)
+    return;
+
+  priv->xevent_types = g_new0 (guint32, N_XEVENT_TYPES / 32);
+
+  for (i = 0; i < n_event_types; i++)
+    {
+      int type = event_types[i];
+
+      if (type < 0 || type >= N_XEVENT_TYPES)
+        {
+          g_warning ("Invalid X event type %d", type);
+          continue;
+        }
+
+      priv->xevent_types[type / 32] |= 1u << (type % 32);
+    }
+}
+
+LOCAL_SYMBOL gboolean
+meta_plugin_wants_effect (MetaPlugin    *plugin,
+                          unsigned long  event)
+{
+  MetaPluginPrivate *priv = META_PLUGIN (plugin)->priv;
+
+  return (priv->effects & event) != 0;
+}
+
+LOCAL_SYMBOL gboolean
+meta_plugin_wants_xevent (MetaPlugin *plugin,
+                          int         event_type)
+{
+  MetaPluginPrivate *priv = META_PLUGIN (plugin)->priv;
+
+  if (priv->xevent_types == NULL)
+    return TRUE;
+
+  event_type &= N_XEVENT_TYPES - 1;
+
+  return (priv->xevent_types[event_type / 32] & (1u << (event_type % 32))) != 0;
+}
+
 /**
  * _meta_plugin_effect_started:
  * @plugin: the plugin
@@ -344,3 +472,62 @@ meta_plugin_get_screen (MetaPlugin *plugin)
 
   return priv->screen;
 }
+
+static gint
+compare_window_stats (gconstpointer a,
+                      gconstpointer b)
+{
+  const MetaWindowActorStats *stats_a = a;
+  const MetaWindowActorStats *stats_b = b;
+
+  if (stats_a->paint_time > stats_b->paint_time)
+    return -1;
+  if (stats_a->paint_time < stats_b->paint_time)
+    return 1;
+
+  return 0;
+}
+
+/**
+ * meta_plugin_get_window_stats:
+ * @plugin: a #MetaPlugin
+ *
+ * Gets what each window of the plugin's screen costs the compositor,
+ * averaged over about the last second, for showing the windows that
+ * slow the desktop down. The stats are kept whether or not anyone asks
+ * for them, so polling them every second or so costs little.
+ *
+ * Return value: (transfer full) (element-type MetaWindowActorStats): the
+ *   stats, the windows that take the longest to paint first; free with
+ *   g_list_free_full() and meta_window_actor_stats_free()
+ */
+GList *
+meta_plugin_get_window_stats (MetaPlugin *plugin)
+{
+  MetaScreen *screen = META_PLUGIN (plugin)->priv->screen;
+  GList *stats = NULL, *l;
+  double total_paint_time = 0;
+
+  for (l = meta_get_window_actors (screen); l != NULL; l = l->next)
+    {
+      MetaWindowActor *actor = l->data;
+      MetaWindowActorStats *window_stats;
+
+      if (meta_window_actor_is_destroyed (actor))
+        continue;
+
+      window_stats = meta_window_actor_get_stats (actor);
+      total_paint_time += window_stats->paint_time;
+      stats = g_list_prepend (stats, window_stats);
+    }
+
+  if (total_paint_time > 0)
+    for (l = stats; l != NULL; l = l->next)
+      {
+        MetaWindowActorStats *window_stats = l->data;
+
+        window_stats->paint_share = window_stats->paint_time / total_paint_time;
+      }
+
+  return g_list_sort (stats, compare_window_stats);
+}
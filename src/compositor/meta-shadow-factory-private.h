@@ -66,4 +66,6 @@ MetaShadow *meta_shadow_factory_get_shadow (MetaShadowFactory *factory,
                                             const char        *class_name,
                                             gboolean           focused);
 
+void meta_shadow_factory_forget_shadows (MetaShadowFactory *factory);
+
 #endif /* __META_SHADOW_FACTORY_PRIVATE_H__ */
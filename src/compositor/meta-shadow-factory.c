@@ -32,6 +32,7 @@
 #include <math.h>
 #include <string.h>
 
+#include "cache-stats.h"
 #include "cogl-utils.h"
 #include "meta-shadow-factory-private.h"
 #include "region-utils.h"
@@ -54,8 +55,22 @@
  *   in blocks, blur rows again, and then transpose back.
  *
  * - We approximate the 1D gaussian blur as 3 successive box filters.
+ *
+ * - When the GPU can render to textures and run GLSL, we skip all of
+ *   the above and do a true two-pass separable Gaussian blur into an
+ *   offscreen framebuffer instead; the CPU path remains as a fallback.
+ *   Those shadows are RGBA, so wide ones are kept at half resolution.
  */
 
+/* How many bytes of shadow textures that nobody references any more we
+ * keep around for reuse, by default */
+#define DEFAULT_SHADOW_CACHE_SIZE (4 * 1024 * 1024)
+
+/* Shadows blurred on the GPU with at least this radius are stored at
+ * half resolution: the blur leaves no detail that would be lost, and
+ * linear filtering hides the difference when they are drawn */
+#define HALF_RESOLUTION_MIN_RADIUS 6
+
 typedef struct _MetaShadowCacheKey  MetaShadowCacheKey;
 typedef struct _MetaShadowClassInfo MetaShadowClassInfo;
 
@@ -87,8 +102,17 @@ struct _MetaShadow
   int outer_border_left;
   int inner_border_left;
 
+  /* Approximate size of the texture in video memory */
+  gsize texture_bytes;
+
+  /* Link in the factory's idle list while ref_count is zero */
+  GList *idle_link;
+
   guint scale_width : 1;
   guint scale_height : 1;
+  guint cached : 1;
+  /* Each texel of the texture covers 2x2 pixels of the shadow */
+  guint half_resolution : 1;
 };
 
 struct _MetaShadowClassInfo
@@ -108,6 +132,21 @@ struct _MetaShadowFactory
 
   /* class name => MetaShadowClassInfo */
   GHashTable *shadow_classes;
+
+  /* spread => CoglPipeline template for the GPU blur passes */
+  GHashTable *blur_pipelines;
+
+  /* Cached shadows whose last reference went away, most recently
+   * used first; they are kept until they push the total past
+   * cache_size */
+  GQueue idle_shadows;
+  gsize idle_bytes;
+  gsize cache_size;
+
+  gsize resident_bytes;
+  guint n_hits;
+  guint n_misses;
+  guint n_evictions;
 };
 
 struct _MetaShadowFactoryClass
@@ -160,23 +199,71 @@ meta_shadow_ref (MetaShadow *shadow)
   return shadow;
 }
 
+static void
+meta_shadow_free (MetaShadow *shadow)
+{
+  if (shadow->factory)
+    {
+      if (shadow->cached)
+        g_hash_table_remove (shadow->factory->shadows,
+                             &shadow->key);
+
+      shadow->factory->resident_bytes -= shadow->texture_bytes;
+    }
+
+  meta_window_shape_unref (shadow->key.shape);
+  cogl_object_unref (shadow->texture);
+  cogl_object_unref (shadow->pipeline);
+
+  g_slice_free (MetaShadow, shadow);
+}
+
+static void
+trim_idle_shadows (MetaShadowFactory *factory,
+                   gsize              max_bytes)
+{
+  while (factory->idle_bytes > max_bytes)
+    {
+      MetaShadow *shadow = g_queue_pop_tail (&factory->idle_shadows);
+
+      shadow->idle_link = NULL;
+      factory->idle_bytes -= shadow->texture_bytes;
+      factory->n_evictions++;
+
+      meta_shadow_free (shadow);
+    }
+}
+
+static void
+meta_shadow_factory_trim_cache (MetaShadowFactory *factory)
+{
+  trim_idle_shadows (factory, factory->cache_size);
+}
+
 LOCAL_SYMBOL void
 meta_shadow_unref (MetaShadow *shadow)
 {
+  MetaShadowFactory *factory = shadow->factory;
+
   shadow->ref_count--;
   if (shadow->ref_count == 0)
     {
-      if (shadow->factory)
+      /* Minimizing, unmapping or refocusing a window drops its shadow
+       * only for it to be asked for again a moment later, so keep
+       * recently used ones around if they fit in the budget */
+      if (factory && shadow->cached &&
+          shadow->texture_bytes <= factory->cache_size)
         {
-          g_hash_table_remove (shadow->factory->shadows,
-                               &shadow->key);
-        }
-
-      meta_window_shape_unref (shadow->key.shape);
-      cogl_object_unref (shadow->texture);
-      cogl_object_unref (shadow->pipeline);
+          g_queue_push_head (&factory->idle_shadows, shadow);
+          shadow->idle_link = factory->idle_shadows.head;
+          factory->idle_bytes += shadow->texture_bytes;
 
-      g_slice_free (MetaShadow, shadow);
+          meta_shadow_factory_trim_cache (factory);
+        }
+      else
+        {
+          meta_shadow_free (shadow);
+        }
     }
 }
 
@@ -209,8 +296,9 @@ meta_shadow_paint (MetaShadow      *shadow,
                    gboolean         clip_strictly)
 
 {
-  float texture_width = cogl_texture_get_width (shadow->texture);
-  float texture_height = cogl_texture_get_height (shadow->texture);
+  int scale = shadow->half_resolution ? 2 : 1;
+  float texture_width = cogl_texture_get_width (shadow->texture) * scale;
+  float texture_height = cogl_texture_get_height (shadow->texture) * scale;
   int i, j;
   float src_x[4];
   float src_y[4];
@@ -407,6 +495,50 @@ meta_shadow_class_info_free (MetaShadowClassInfo *class_info)
   g_slice_free (MetaShadowClassInfo, class_info);
 }
 
+static void
+get_cache_stats (gpointer        data,
+                 MetaCacheStats *stats)
+{
+  MetaShadowFactory *factory = data;
+
+  stats->n_entries = g_hash_table_size (factory->shadows);
+  stats->bytes = factory->resident_bytes;
+  stats->hits = factory->n_hits;
+  stats->misses = factory->n_misses;
+  stats->evictions = factory->n_evictions;
+}
+
+/* Under memory pressure, drops all of the unused shadows */
+static void
+trim_cache (gpointer data)
+{
+  trim_idle_shadows (data, 0);
+}
+
+/**
+ * meta_shadow_factory_forget_shadows:
+ * @factory: a #MetaShadowFactory
+ *
+ * Drops the unused shadows and stops handing out the ones in use, so
+ * that every shadow asked for from now on is made again. The shadows
+ * in use are freed once their windows let go of them.
+ */
+LOCAL_SYMBOL void
+meta_shadow_factory_forget_shadows (MetaShadowFactory *factory)
+{
+  GHashTableIter iter;
+  MetaShadow *shadow;
+
+  trim_idle_shadows (factory, 0);
+
+  g_hash_table_iter_init (&iter, factory->shadows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &shadow))
+    {
+      shadow->cached = FALSE;
+      g_hash_table_iter_remove (&iter);
+    }
+}
+
 static void
 meta_shadow_factory_init (MetaShadowFactory *factory)
 {
@@ -420,6 +552,13 @@ meta_shadow_factory_init (MetaShadowFactory *factory)
                                                    NULL,
                                                    (GDestroyNotify)meta_shadow_class_info_free);
 
+  factory->blur_pipelines = g_hash_table_new_full (NULL, NULL,
+                                                   NULL,
+                                                   (GDestroyNotify)cogl_object_unref);
+
+  g_queue_init (&factory->idle_shadows);
+  factory->cache_size = DEFAULT_SHADOW_CACHE_SIZE;
+
   for (i = 0; i < G_N_ELEMENTS (default_shadow_classes); i++)
     {
       MetaShadowClassInfo *class_info = g_slice_new (MetaShadowClassInfo);
@@ -430,6 +569,8 @@ meta_shadow_factory_init (MetaShadowFactory *factory)
       g_hash_table_insert (factory->shadow_classes,
                            (char *)class_info->name, class_info);
     }
+
+  meta_cache_register ("shadows", get_cache_stats, trim_cache, factory);
 }
 
 static void
@@ -438,18 +579,31 @@ meta_shadow_factory_finalize (GObject *object)
   MetaShadowFactory *factory = META_SHADOW_FACTORY (object);
   GHashTableIter iter;
   gpointer key, value;
+  MetaShadow *shadow;
+
+  meta_cache_unregister ("shadows", factory);
+
+  /* Nobody else references the idle shadows, so they go with us;
+   * freeing them with the factory still set takes them out of the
+   * table before the loop below walks it */
+  while ((shadow = g_queue_pop_head (&factory->idle_shadows)))
+    {
+      shadow->idle_link = NULL;
+      meta_shadow_free (shadow);
+    }
 
   /* Detach from the shadows in the table so we won't try to
    * remove them when they're freed. */
   g_hash_table_iter_init (&iter, factory->shadows);
   while (g_hash_table_iter_next (&iter, &key, &value))
     {
-      MetaShadow *shadow = key;
+      shadow = value;
       shadow->factory = NULL;
     }
 
   g_hash_table_destroy (factory->shadows);
   g_hash_table_destroy (factory->shadow_classes);
+  g_hash_table_destroy (factory->blur_pipelines);
 
   G_OBJECT_CLASS (meta_shadow_factory_parent_class)->finalize (object);
 }
@@ -710,6 +864,284 @@ flip_buffer (guchar *buffer,
 #undef BLOCK_SIZE
 }
 
+static const char *shadow_blur_glsl_declarations =
+"uniform vec2 pixel_step;\n"
+"uniform float fade_start;\n"
+"uniform float fade_scale;\n";
+
+/* The blur is a 1D Gaussian with a standard deviation of radius,
+ * truncated at the spread of the box filter approximation so that the
+ * two paths produce shadows of the same extent. The loop bounds have
+ * to be constant for GLSL ES, so we build one program per spread.
+ */
+static CoglPipeline *
+get_blur_pipeline (MetaShadowFactory *factory,
+                   int                radius,
+                   int                spread)
+{
+  CoglPipeline *pipeline;
+  CoglSnippet *snippet;
+  char exponent_str[G_ASCII_DTOSTR_BUF_SIZE];
+  char normalize_str[G_ASCII_DTOSTR_BUF_SIZE];
+  double exponent, sum;
+  char *source;
+  int i;
+
+  pipeline = g_hash_table_lookup (factory->blur_pipelines,
+                                  GINT_TO_POINTER (spread));
+  if (pipeline)
+    return pipeline;
+
+  exponent = -1.0 / (2.0 * radius * radius);
+
+  sum = 0.0;
+  for (i = -spread; i <= spread; i++)
+    sum += exp (i * i * exponent);
+
+  g_ascii_dtostr (exponent_str, sizeof (exponent_str), exponent);
+  g_ascii_dtostr (normalize_str, sizeof (normalize_str), 1.0 / sum);
+
+  source = g_strdup_printf ("  float alpha = 0.0;\n"
+                            "  for (int i = -%d; i <= %d; i++)\n"
+                            "    alpha += texture2D (cogl_sampler,\n"
+                            "                        cogl_tex_coord.st + pixel_step * float (i)).a *\n"
+                            "             exp (float (i * i) * %s);\n"
+                            "  alpha *= %s;\n"
+                            "  if (fade_scale > 0.0)\n"
+                            "    alpha *= clamp ((cogl_tex_coord.t - fade_start) * fade_scale, 0.0, 1.0);\n"
+                            "  cogl_texel = vec4 (0.0, 0.0, 0.0, alpha);\n",
+                            spread, spread, exponent_str, normalize_str);
+
+  pipeline = cogl_pipeline_new (meta_compositor_get_cogl_context ());
+
+  snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                              shadow_blur_glsl_declarations,
+                              NULL);
+  cogl_snippet_set_replace (snippet, source);
+  cogl_pipeline_add_layer_snippet (pipeline, 0, snippet);
+  cogl_object_unref (snippet);
+  g_free (source);
+
+  cogl_pipeline_set_layer_null_texture (pipeline, 0, COGL_TEXTURE_TYPE_2D);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+  cogl_pipeline_set_layer_wrap_mode (pipeline, 0,
+                                     COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
+  cogl_pipeline_set_blend (pipeline, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+
+  g_hash_table_insert (factory->blur_pipelines,
+                       GINT_TO_POINTER (spread), pipeline);
+
+  return pipeline;
+}
+
+static CoglOffscreen *
+create_blur_target (int           width,
+                    int           height,
+                    CoglTexture **texture_out)
+{
+  CoglTexture *texture;
+  CoglOffscreen *offscreen;
+  CoglError *catch_error = NULL;
+
+  texture = COGL_TEXTURE (cogl_texture_2d_new_with_size (meta_compositor_get_cogl_context (),
+                                                         width, height));
+  cogl_texture_set_memory_category (texture, "shadows");
+  offscreen = cogl_offscreen_new_with_texture (texture);
+
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), &catch_error))
+    {
+      meta_verbose ("Couldn't allocate shadow framebuffer: %s\n", catch_error->message);
+      cogl_error_free (catch_error);
+      cogl_object_unref (offscreen);
+      cogl_object_unref (texture);
+      return NULL;
+    }
+
+  cogl_framebuffer_orthographic (COGL_FRAMEBUFFER (offscreen),
+                                 0, 0, width, height, -1., 1.);
+
+  *texture_out = texture;
+  return offscreen;
+}
+
+static void
+blur_pass (CoglFramebuffer *framebuffer,
+           CoglPipeline    *blur_template,
+           CoglTexture     *source,
+           float            step_x,
+           float            step_y,
+           float            fade_start,
+           float            fade_scale,
+           float            src_x1,
+           float            src_y1,
+           float            src_x2,
+           float            src_y2)
+{
+  CoglPipeline *pipeline;
+  float pixel_step[2] = { step_x, step_y };
+
+  pipeline = cogl_pipeline_copy (blur_template);
+  cogl_pipeline_set_layer_texture (pipeline, 0, source);
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline, "pixel_step"),
+                                   2, 1, pixel_step);
+  cogl_pipeline_set_uniform_1f (pipeline,
+                                cogl_pipeline_get_uniform_location (pipeline, "fade_start"),
+                                fade_start);
+  cogl_pipeline_set_uniform_1f (pipeline,
+                                cogl_pipeline_get_uniform_location (pipeline, "fade_scale"),
+                                fade_scale);
+
+  cogl_framebuffer_draw_textured_rectangle (framebuffer, pipeline,
+                                            0, 0,
+                                            cogl_framebuffer_get_width (framebuffer),
+                                            cogl_framebuffer_get_height (framebuffer),
+                                            src_x1, src_y1, src_x2, src_y2);
+
+  cogl_object_unref (pipeline);
+}
+
+static gboolean
+make_shadow_gpu (MetaShadow     *shadow,
+                 cairo_region_t *region)
+{
+  CoglContext *ctx = meta_compositor_get_cogl_context ();
+  int spread = get_shadow_spread (shadow->key.radius);
+  cairo_rectangle_int_t extents;
+  CoglOffscreen *shape_fb, *rows_fb, *shadow_fb;
+  CoglTexture *shape_texture, *rows_texture, *shadow_texture;
+  CoglPipeline *blur_template, *pipeline;
+  int buffer_width, buffer_height;
+  int shadow_width, shadow_height;
+  int extra_right, extra_bottom;
+  gboolean half_resolution;
+  float fade_start, fade_scale;
+  int n_rectangles, k;
+
+  if (spread <= 0 ||
+      !cogl_has_feature (ctx, COGL_FEATURE_ID_OFFSCREEN) ||
+      !cogl_has_feature (ctx, COGL_FEATURE_ID_GLSL) ||
+      !meta_cogl_hardware_supports_npot_sizes ())
+    return FALSE;
+
+  cairo_region_get_extents (region, &extents);
+
+  /* As in make_shadow(), we blur as if the top weren't going to be
+   * cropped and only crop on the final pass */
+  buffer_width = extents.width + 2 * spread;
+  buffer_height = extents.height + 2 * spread;
+
+  shadow_width = shadow->outer_border_left + extents.width + shadow->outer_border_right;
+  shadow_height = shadow->outer_border_top + extents.height + shadow->outer_border_bottom;
+
+  /* A half resolution shadow is made a pixel bigger where needed so
+   * that it spans a whole number of texels, which keeps the slices
+   * meta_shadow_paint() cuts it into in place */
+  half_resolution = shadow->key.radius >= HALF_RESOLUTION_MIN_RADIUS;
+  if (half_resolution)
+    {
+      extra_right = shadow_width & 1;
+      extra_bottom = shadow_height & 1;
+      shadow_width += extra_right;
+      shadow_height += extra_bottom;
+    }
+  else
+    {
+      extra_right = 0;
+      extra_bottom = 0;
+    }
+
+  shape_fb = create_blur_target (buffer_width, buffer_height, &shape_texture);
+  if (shape_fb == NULL)
+    return FALSE;
+
+  rows_fb = create_blur_target (buffer_width, buffer_height, &rows_texture);
+  if (rows_fb == NULL)
+    {
+      cogl_object_unref (shape_fb);
+      cogl_object_unref (shape_texture);
+      return FALSE;
+    }
+
+  shadow_fb = create_blur_target (half_resolution ? shadow_width / 2 : shadow_width,
+                                  half_resolution ? shadow_height / 2 : shadow_height,
+                                  &shadow_texture);
+  if (shadow_fb == NULL)
+    {
+      cogl_object_unref (shape_fb);
+      cogl_object_unref (shape_texture);
+      cogl_object_unref (rows_fb);
+      cogl_object_unref (rows_texture);
+      return FALSE;
+    }
+
+  /* Step 1: unblurred image */
+  cogl_framebuffer_clear4f (COGL_FRAMEBUFFER (shape_fb), COGL_BUFFER_BIT_COLOR,
+                            0.0, 0.0, 0.0, 0.0);
+
+  pipeline = cogl_pipeline_new (ctx);
+  n_rectangles = cairo_region_num_rectangles (region);
+  for (k = 0; k < n_rectangles; k++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, k, &rect);
+      cogl_framebuffer_draw_rectangle (COGL_FRAMEBUFFER (shape_fb), pipeline,
+                                       spread + rect.x - extents.x,
+                                       spread + rect.y - extents.y,
+                                       spread + rect.x - extents.x + rect.width,
+                                       spread + rect.y - extents.y + rect.height);
+    }
+  cogl_object_unref (pipeline);
+
+  blur_template = get_blur_pipeline (shadow->factory, shadow->key.radius, spread);
+
+  /* Step 2: blur rows */
+  blur_pass (COGL_FRAMEBUFFER (rows_fb), blur_template, shape_texture,
+             1.0 / buffer_width, 0.0,
+             0.0, 0.0,
+             0.0, 0.0, 1.0, 1.0);
+
+  /* Step 3: blur columns, fading out the top if applicable, and crop */
+  if (shadow->key.top_fade > 0)
+    {
+      fade_start = (spread + 0.5) / buffer_height;
+      fade_scale = (float) buffer_height / shadow->key.top_fade;
+    }
+  else
+    {
+      fade_start = 0.0;
+      fade_scale = 0.0;
+    }
+
+  blur_pass (COGL_FRAMEBUFFER (shadow_fb), blur_template, rows_texture,
+             0.0, 1.0 / buffer_height,
+             fade_start, fade_scale,
+             (float) (spread - shadow->outer_border_left) / buffer_width,
+             (float) (spread - shadow->outer_border_top) / buffer_height,
+             (float) (spread - shadow->outer_border_left + shadow_width) / buffer_width,
+             (float) (spread - shadow->outer_border_top + shadow_height) / buffer_height);
+
+  cogl_object_unref (shape_fb);
+  cogl_object_unref (shape_texture);
+  cogl_object_unref (rows_fb);
+  cogl_object_unref (rows_texture);
+  cogl_object_unref (shadow_fb);
+
+  shadow->outer_border_right += extra_right;
+  shadow->outer_border_bottom += extra_bottom;
+  shadow->half_resolution = half_resolution;
+
+  shadow->texture = shadow_texture;
+  shadow->texture_bytes = (cogl_texture_get_width (shadow_texture) *
+                           cogl_texture_get_height (shadow_texture) * 4);
+  shadow->pipeline = meta_create_texture_pipeline (shadow->texture);
+
+  return TRUE;
+}
+
 static void
 make_shadow (MetaShadow     *shadow,
              cairo_region_t *region)
@@ -726,6 +1158,9 @@ make_shadow (MetaShadow     *shadow,
   int y_offset;
   int n_rectangles, j, k;
 
+  if (make_shadow_gpu (shadow, region))
+    return;
+
   cairo_region_get_extents (region, &extents);
 
   /* In the case where top_fade >= 0 and the portion above the top
@@ -817,6 +1252,13 @@ make_shadow (MetaShadow     *shadow,
   cairo_region_destroy (column_convolve_region);
   free (buffer);
 
+  if (shadow->texture)
+    {
+      cogl_texture_set_memory_category (shadow->texture, "shadows");
+      shadow->texture_bytes = (cogl_texture_get_width (shadow->texture) *
+                               cogl_texture_get_height (shadow->texture));
+    }
+
   shadow->pipeline = meta_create_texture_pipeline (shadow->texture);
 }
 
@@ -946,9 +1388,22 @@ meta_shadow_factory_get_shadow (MetaShadowFactory *factory,
 
       shadow = g_hash_table_lookup (factory->shadows, &key);
       if (shadow)
-        return meta_shadow_ref (shadow);
+        {
+          if (shadow->idle_link)
+            {
+              g_queue_delete_link (&factory->idle_shadows, shadow->idle_link);
+              shadow->idle_link = NULL;
+              factory->idle_bytes -= shadow->texture_bytes;
+            }
+
+          factory->n_hits++;
+
+          return meta_shadow_ref (shadow);
+        }
     }
 
+  factory->n_misses++;
+
   shadow = g_slice_new0 (MetaShadow);
 
   shadow->ref_count = 1;
@@ -985,8 +1440,13 @@ meta_shadow_factory_get_shadow (MetaShadowFactory *factory,
 
   cairo_region_destroy (region);
 
+  factory->resident_bytes += shadow->texture_bytes;
+
   if (cacheable)
-    g_hash_table_insert (factory->shadows, &shadow->key, shadow);
+    {
+      g_hash_table_insert (factory->shadows, &shadow->key, shadow);
+      shadow->cached = TRUE;
+    }
 
   return shadow;
 }
@@ -1056,3 +1516,69 @@ meta_shadow_factory_get_params (MetaShadowFactory *factory,
   if (params)
     *params = *stored_params;
 }
+
+/**
+ * meta_shadow_factory_set_cache_size:
+ * @factory: a #MetaShadowFactory
+ * @cache_size: maximum number of bytes of unused shadow textures to keep
+ *
+ * Shadows that are no longer used by any window are kept around, most
+ * recently used first, so that they can be reused when a window with
+ * the same shape gets a shadow again. This sets how much texture memory
+ * they are allowed to take; zero disables keeping unused shadows.
+ */
+void
+meta_shadow_factory_set_cache_size (MetaShadowFactory *factory,
+                                    gsize              cache_size)
+{
+  g_return_if_fail (META_IS_SHADOW_FACTORY (factory));
+
+  factory->cache_size = cache_size;
+  meta_shadow_factory_trim_cache (factory);
+}
+
+/**
+ * meta_shadow_factory_get_cache_size:
+ * @factory: a #MetaShadowFactory
+ *
+ * Return value: the maximum number of bytes of unused shadow textures
+ *  that are kept for reuse. See meta_shadow_factory_set_cache_size().
+ */
+gsize
+meta_shadow_factory_get_cache_size (MetaShadowFactory *factory)
+{
+  g_return_val_if_fail (META_IS_SHADOW_FACTORY (factory), 0);
+
+  return factory->cache_size;
+}
+
+/**
+ * meta_shadow_factory_get_cache_stats:
+ * @factory: a #MetaShadowFactory
+ * @hits: (out) (allow-none): number of shadows found in the cache
+ * @misses: (out) (allow-none): number of shadows that had to be created
+ * @evictions: (out) (allow-none): number of unused shadows dropped to
+ *  stay within the cache size
+ * @resident_bytes: (out) (allow-none): approximate texture memory used
+ *  by all existing shadows, including unused ones kept for reuse
+ *
+ * Retrieves statistics about the shadow cache, for debugging.
+ */
+void
+meta_shadow_factory_get_cache_stats (MetaShadowFactory *factory,
+                                     guint             *hits,
+                                     guint             *misses,
+                                     guint             *evictions,
+                                     gsize             *resident_bytes)
+{
+  g_return_if_fail (META_IS_SHADOW_FACTORY (factory));
+
+  if (hits)
+    *hits = factory->n_hits;
+  if (misses)
+    *misses = factory->n_misses;
+  if (evictions)
+    *evictions = factory->n_evictions;
+  if (resident_bytes)
+    *resident_bytes = factory->resident_bytes;
+}
@@ -32,5 +32,8 @@
 ClutterActor *meta_shaped_texture_new (void);
 void meta_shaped_texture_set_texture (MetaShapedTexture *stex,
                                       CoglTexture       *texture);
+void meta_shaped_texture_evict_texture (MetaShapedTexture *stex);
+gsize meta_shaped_texture_get_memory_size (MetaShapedTexture *stex);
+gboolean meta_shaped_texture_has_visible_clones (MetaShapedTexture *stex);
 
 #endif
@@ -73,10 +73,42 @@ static void meta_shaped_texture_get_preferred_height (ClutterActor *self,
                                                       gfloat       *natural_height_p);
 
 static gboolean meta_shaped_texture_get_paint_volume (ClutterActor *self, ClutterPaintVolume *volume);
+static cairo_region_t *meta_shaped_texture_get_opaque_region (ClutterActor *self);
 
 G_DEFINE_TYPE (MetaShapedTexture, meta_shaped_texture,
                CLUTTER_TYPE_ACTOR);
 
+/* A #ClutterContent painting the texture of a #MetaShapedTexture, for
+ * clones that don't need to paint the rest of the window */
+#define META_TYPE_SHAPED_TEXTURE_CONTENT (meta_shaped_texture_content_get_type ())
+#define META_SHAPED_TEXTURE_CONTENT(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), META_TYPE_SHAPED_TEXTURE_CONTENT, MetaShapedTextureContent))
+
+typedef struct _MetaShapedTextureContent      MetaShapedTextureContent;
+typedef struct _MetaShapedTextureContentClass MetaShapedTextureContentClass;
+
+struct _MetaShapedTextureContent
+{
+  GObject parent;
+
+  /* Not a reference; cleared when the texture goes away */
+  MetaShapedTexture *stex;
+
+  /* The actors the content is attached to */
+  GList *actors;
+
+  CoglPipeline *pipeline;
+};
+
+struct _MetaShapedTextureContentClass
+{
+  GObjectClass parent_class;
+};
+
+static GType meta_shaped_texture_content_get_type (void) G_GNUC_CONST;
+
+static void invalidate_content (MetaShapedTexture *stex,
+                                gboolean           size_changed);
+
 #define META_SHAPED_TEXTURE_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), META_TYPE_SHAPED_TEXTURE, \
                                 MetaShapedTexturePrivate))
@@ -94,7 +126,25 @@ struct _MetaShapedTexturePrivate
   MetaTextureTower *paint_tower;
   Pixmap pixmap;
   CoglTexture *texture;
+
+  /* A scaled down copy of the texture to paint while the texture itself
+   * has been dropped by meta_shaped_texture_evict_texture() */
+  CoglTexture *placeholder_texture;
+
+  /* A full-size mask, only used for shapes too complex to paint as
+   * rectangles.  Otherwise shape_region holds the shape the mask is for,
+   * unmasked_region the part of it that is painted as plain rectangles,
+   * and corner_mask_texture the mask for the rectangles of corner_region,
+   * where the overlay path is drawn.
+   */
   CoglTexture *mask_texture;
+  CoglTexture *corner_mask_texture;
+  /* A full-size mask for those simpler shapes, only made once the
+   * content is painted, which draws the texture in one rectangle */
+  CoglTexture *content_mask_texture;
+  cairo_region_t *shape_region;
+  cairo_region_t *unmasked_region;
+  cairo_region_t *corner_region;
 
   cairo_region_t *clip_region;
   cairo_region_t *unobscured_region;
@@ -103,15 +153,29 @@ struct _MetaShapedTexturePrivate
   cairo_region_t *overlay_region;
   cairo_path_t *overlay_path;
 
+  /* Copies of the pipeline templates kept for painting this actor, so
+   * that painting only changes their state when the textures, filter
+   * or opacity differ from the previous frame. Dropped together with
+   * the textures they reference.
+   */
+  CoglPipeline *unmasked_pipeline;
+  CoglPipeline *masked_pipeline;
+  CoglPipeline *unblended_pipeline;
+
+  /* Handed out by meta_shaped_texture_get_content() */
+  MetaShapedTextureContent *content;
+
   guint tex_width, tex_height;
 
   gint64 prev_invalidation, last_invalidation;
   guint fast_updates;
   guint remipmap_timeout_id;
   gint64 earliest_remipmap;
+  guint revalidate_idle_id;
 
   guint create_mipmaps : 1;
   guint mask_needs_update : 1;
+  guint mask_has_frame : 1;
 };
 
 static void
@@ -126,6 +190,7 @@ meta_shaped_texture_class_init (MetaShapedTextureClass *klass)
   actor_class->get_preferred_height = meta_shaped_texture_get_preferred_height;
   actor_class->paint = meta_shaped_texture_paint;
   actor_class->get_paint_volume = meta_shaped_texture_get_paint_volume;
+  actor_class->get_opaque_region = meta_shaped_texture_get_opaque_region;
 
   signals[SIZE_CHANGED] = g_signal_new ("size-changed",
                                         G_TYPE_FROM_CLASS (gobject_class),
@@ -149,10 +214,28 @@ meta_shaped_texture_init (MetaShapedTexture *self)
   priv->paint_tower = meta_texture_tower_new ();
   priv->texture = NULL;
   priv->mask_texture = NULL;
+  priv->corner_mask_texture = NULL;
+  priv->content_mask_texture = NULL;
+  priv->shape_region = NULL;
+  priv->unmasked_region = NULL;
+  priv->corner_region = NULL;
+  priv->unmasked_pipeline = NULL;
+  priv->masked_pipeline = NULL;
+  priv->unblended_pipeline = NULL;
   priv->create_mipmaps = TRUE;
   priv->mask_needs_update = TRUE;
 }
 
+static void
+release_pipelines (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+
+  g_clear_pointer (&priv->unmasked_pipeline, cogl_object_unref);
+  g_clear_pointer (&priv->masked_pipeline, cogl_object_unref);
+  g_clear_pointer (&priv->unblended_pipeline, cogl_object_unref);
+}
+
 static void
 meta_shaped_texture_dispose (GObject *object)
 {
@@ -165,14 +248,30 @@ meta_shaped_texture_dispose (GObject *object)
       priv->remipmap_timeout_id = 0;
     }
 
+  if (priv->revalidate_idle_id)
+    {
+      g_source_remove (priv->revalidate_idle_id);
+      priv->revalidate_idle_id = 0;
+    }
+
   if (priv->paint_tower)
     meta_texture_tower_free (priv->paint_tower);
   priv->paint_tower = NULL;
 
   meta_shaped_texture_dirty_mask (self);
+  release_pipelines (self);
   g_clear_pointer (&priv->texture, cogl_object_unref);
+  g_clear_pointer (&priv->placeholder_texture, cogl_object_unref);
   g_clear_pointer (&priv->opaque_region, cairo_region_destroy);
 
+  if (priv->content != NULL)
+    {
+      /* Clones holding on to the content paint nothing from now on */
+      invalidate_content (self, TRUE);
+      priv->content->stex = NULL;
+      g_clear_object (&priv->content);
+    }
+
   meta_shaped_texture_set_clip_region (self, NULL);
   meta_shaped_texture_set_overlay_path (self, NULL, NULL);
 
@@ -233,6 +332,20 @@ get_unblended_pipeline (CoglContext *ctx)
   return template;
 }
 
+/* Returns the copy of @template kept in @pipeline, making it first if
+ * needed. The templates themselves are never modified after creation,
+ * so the per actor copies stay cheap leaves of them.
+ */
+static CoglPipeline *
+ensure_pipeline (CoglPipeline **pipeline,
+                 CoglPipeline  *template)
+{
+  if (*pipeline == NULL)
+    *pipeline = cogl_pipeline_copy (template);
+
+  return *pipeline;
+}
+
 static void
 paint_clipped_rectangle (CoglFramebuffer       *fb,
                          CoglPipeline          *pipeline,
@@ -263,12 +376,87 @@ paint_clipped_rectangle (CoglFramebuffer       *fb,
 
 }
 
+/* Like paint_clipped_rectangle(), but the mask layer samples
+ * (mask_x, mask_y) of a mask_width x mask_height texture at the
+ * top left corner of the rectangle.
+ */
+static void
+paint_masked_rectangle (CoglFramebuffer       *fb,
+                        CoglPipeline          *pipeline,
+                        cairo_rectangle_int_t *rect,
+                        int                    mask_x,
+                        int                    mask_y,
+                        int                    mask_width,
+                        int                    mask_height,
+                        ClutterActorBox       *alloc)
+{
+  float coords[8];
+
+  coords[0] = rect->x / (alloc->x2 - alloc->x1);
+  coords[1] = rect->y / (alloc->y2 - alloc->y1);
+  coords[2] = (rect->x + rect->width) / (alloc->x2 - alloc->x1);
+  coords[3] = (rect->y + rect->height) / (alloc->y2 - alloc->y1);
+
+  coords[4] = mask_x / (float) mask_width;
+  coords[5] = mask_y / (float) mask_height;
+  coords[6] = (mask_x + rect->width) / (float) mask_width;
+  coords[7] = (mask_y + rect->height) / (float) mask_height;
+
+  cogl_framebuffer_draw_multitextured_rectangle (fb, pipeline,
+                                                 rect->x, rect->y,
+                                                 rect->x + rect->width,
+                                                 rect->y + rect->height,
+                                                 &coords[0], 8);
+}
+
 LOCAL_SYMBOL void
 meta_shaped_texture_dirty_mask (MetaShapedTexture *stex)
 {
   MetaShapedTexturePrivate *priv = stex->priv;
 
   g_clear_pointer (&priv->mask_texture, cogl_object_unref);
+  g_clear_pointer (&priv->corner_mask_texture, cogl_object_unref);
+  g_clear_pointer (&priv->content_mask_texture, cogl_object_unref);
+  g_clear_pointer (&priv->masked_pipeline, cogl_object_unref);
+  g_clear_pointer (&priv->shape_region, cairo_region_destroy);
+  g_clear_pointer (&priv->unmasked_region, cairo_region_destroy);
+  g_clear_pointer (&priv->corner_region, cairo_region_destroy);
+}
+
+/* Sets the bytes covered by @region, offset by @dx, @dy, to 255 */
+static void
+fill_mask_region (guchar         *mask_data,
+                  int             width,
+                  int             height,
+                  int             stride,
+                  cairo_region_t *region,
+                  int             dx,
+                  int             dy)
+{
+  int i, n_rects;
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i ++)
+    {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle (region, i, &rect);
+
+      gint x1 = rect.x + dx, x2 = x1 + rect.width;
+      gint y1 = rect.y + dy, y2 = y1 + rect.height;
+      guchar *p;
+
+      /* Clip the rectangle to the size of the mask */
+      x1 = CLAMP (x1, 0, width - 1);
+      x2 = CLAMP (x2, x1, width);
+      y1 = CLAMP (y1, 0, height - 1);
+      y2 = CLAMP (y2, y1, height);
+
+      /* Fill the rectangle */
+      for (p = mask_data + y1 * stride + x1;
+           y1 < y2;
+           y1++, p += stride)
+        memset (p, 255, x2 - x1);
+    }
 }
 
 static void
@@ -324,6 +512,296 @@ install_overlay_path (MetaShapedTexture *stex,
   cairo_surface_destroy (surface);
 }
 
+static CoglTexture *
+new_mask_texture (CoglTexture *paint_tex,
+                  int          width,
+                  int          height,
+                  int          stride,
+                  guchar      *mask_data)
+{
+  CoglTexture *mask_texture;
+
+  if (meta_texture_rectangle_check (paint_tex))
+    mask_texture = meta_cogl_rectangle_new (width, height,
+                                            COGL_PIXEL_FORMAT_A_8,
+                                            stride, mask_data);
+  else
+    mask_texture = meta_cogl_texture_new_from_data_wrapper (width, height,
+                                                            COGL_TEXTURE_NONE,
+                                                            COGL_PIXEL_FORMAT_A_8,
+                                                            COGL_PIXEL_FORMAT_ANY,
+                                                            stride,
+                                                            mask_data);
+
+  if (mask_texture != NULL)
+    cogl_texture_set_memory_category (mask_texture, "masks");
+
+  return mask_texture;
+}
+
+/* Uploads the overlay path clipped to each rectangle of the overlay
+ * region into the same rectangle of @mask_texture, rasterizing only
+ * those rectangles. Where there is no overlay path the rectangles are
+ * cleared, like install_overlay_path() does.
+ */
+static void
+upload_overlay_rectangles (MetaShapedTexture *stex,
+                           CoglTexture       *mask_texture,
+                           int                tex_width,
+                           int                tex_height)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  cairo_rectangle_int_t tex_rect = { 0, 0, tex_width, tex_height };
+  cairo_region_t *region;
+  int i, n_rects;
+
+  region = cairo_region_copy (priv->overlay_region);
+  cairo_region_intersect_rectangle (region, &tex_rect);
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      guchar *data;
+      int stride;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      stride = cairo_format_stride_for_width (CAIRO_FORMAT_A8, rect.width);
+      data = g_malloc0 (stride * rect.height);
+
+      if (priv->overlay_path != NULL)
+        {
+          cairo_surface_t *surface;
+          cairo_t *cr;
+
+          surface = cairo_image_surface_create_for_data (data,
+                                                         CAIRO_FORMAT_A8,
+                                                         rect.width,
+                                                         rect.height,
+                                                         stride);
+          cr = cairo_create (surface);
+          cairo_set_source_rgba (cr, 1, 1, 1, 1);
+          cairo_translate (cr, - rect.x, - rect.y);
+          cairo_append_path (cr, priv->overlay_path);
+          cairo_fill (cr);
+          cairo_destroy (cr);
+          cairo_surface_flush (surface);
+          cairo_surface_destroy (surface);
+        }
+
+      cogl_texture_set_region (mask_texture,
+                               0, 0,
+                               rect.x, rect.y,
+                               rect.width, rect.height,
+                               rect.width, rect.height,
+                               COGL_PIXEL_FORMAT_A_8,
+                               stride, data);
+
+      g_free (data);
+    }
+
+  cairo_region_destroy (region);
+}
+
+/* Renders a mask covering the whole texture into an offscreen
+ * framebuffer, so that only the frame corners are rasterized and
+ * uploaded. Returns NULL if the driver can't render to an alpha-only
+ * texture.
+ */
+static CoglTexture *
+create_full_mask_on_gpu (MetaShapedTexture *stex,
+                         cairo_region_t    *shape_region,
+                         gboolean           has_frame,
+                         int                tex_width,
+                         int                tex_height)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  CoglContext *ctx =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  CoglTexture *mask_texture;
+  CoglOffscreen *offscreen;
+  CoglFramebuffer *fb;
+  CoglPipeline *pipeline;
+  CoglError *catch_error = NULL;
+  cairo_region_t *region;
+  float *coords;
+  int i, n_rects;
+
+  /* Rectangle textures are only used for the masks of windows whose
+   * pixmaps are, and those are uploaded like before */
+  if (meta_texture_rectangle_check (priv->texture))
+    return NULL;
+
+  mask_texture = COGL_TEXTURE (cogl_texture_2d_new_with_size (ctx,
+                                                              tex_width,
+                                                              tex_height));
+  cogl_texture_set_components (mask_texture, COGL_TEXTURE_COMPONENTS_A);
+  cogl_texture_set_memory_category (mask_texture, "masks");
+
+  offscreen = cogl_offscreen_new_with_texture (mask_texture);
+  fb = COGL_FRAMEBUFFER (offscreen);
+
+  if (!cogl_framebuffer_allocate (fb, &catch_error))
+    {
+      cogl_error_free (catch_error);
+      cogl_object_unref (offscreen);
+      cogl_object_unref (mask_texture);
+      return NULL;
+    }
+
+  cogl_framebuffer_orthographic (fb, 0, 0, tex_width, tex_height, -1., 1.);
+  cogl_framebuffer_clear4f (fb, COGL_BUFFER_BIT_COLOR, 0, 0, 0, 0);
+
+  region = cairo_region_copy (shape_region);
+
+  /* The overlay rectangles are uploaded directly and the shape is
+   * drawn around them, so the two never need ordering */
+  if (has_frame && priv->overlay_region != NULL)
+    {
+      cairo_region_subtract (region, priv->overlay_region);
+      upload_overlay_rectangles (stex, mask_texture, tex_width, tex_height);
+    }
+
+  n_rects = cairo_region_num_rectangles (region);
+  coords = g_new (float, 4 * n_rects);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle (region, i, &rect);
+
+      coords[i * 4 + 0] = rect.x;
+      coords[i * 4 + 1] = rect.y;
+      coords[i * 4 + 2] = rect.x + rect.width;
+      coords[i * 4 + 3] = rect.y + rect.height;
+    }
+
+  pipeline = cogl_pipeline_new (ctx);
+  cogl_framebuffer_draw_rectangles (fb, pipeline, coords, n_rects);
+
+  cogl_object_unref (pipeline);
+  g_free (coords);
+  cairo_region_destroy (region);
+
+  /* The journal keeps the framebuffer alive until the mask is first
+   * painted with, which flushes it */
+  cogl_object_unref (offscreen);
+
+  return mask_texture;
+}
+
+/* Creates a mask covering the whole texture */
+static CoglTexture *
+create_full_mask (MetaShapedTexture *stex,
+                  cairo_region_t    *shape_region,
+                  gboolean           has_frame)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  CoglTexture *paint_tex = priv->texture;
+  CoglTexture *mask_texture;
+  guint tex_width, tex_height;
+  guchar *mask_data;
+  int stride;
+
+  tex_width = cogl_texture_get_width (paint_tex);
+  tex_height = cogl_texture_get_height (paint_tex);
+
+  mask_texture = create_full_mask_on_gpu (stex, shape_region, has_frame,
+                                          tex_width, tex_height);
+  if (mask_texture != NULL)
+    return mask_texture;
+
+  stride = cairo_format_stride_for_width (CAIRO_FORMAT_A8, tex_width);
+
+  /* Create data for an empty image */
+  mask_data = g_malloc0 (stride * tex_height);
+
+  fill_mask_region (mask_data, tex_width, tex_height, stride,
+                    shape_region, 0, 0);
+
+  if (has_frame)
+    install_overlay_path (stex, mask_data, tex_width, tex_height, stride);
+
+  mask_texture = new_mask_texture (paint_tex, tex_width, tex_height,
+                                   stride, mask_data);
+
+  g_free (mask_data);
+
+  return mask_texture;
+}
+
+/* Creates a mask for just the rectangles of the overlay region, laid
+ * out side by side, holding the overlay path clipped to each of them.
+ * The rest of the shape is painted without a mask.
+ */
+static CoglTexture *
+create_corner_mask (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  CoglTexture *mask_texture;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  guchar *mask_data;
+  int width, height, stride;
+  int i, n_rects, x;
+
+  n_rects = cairo_region_num_rectangles (priv->corner_region);
+
+  width = 0;
+  height = 0;
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle (priv->corner_region, i, &rect);
+
+      width += rect.width;
+      height = MAX (height, rect.height);
+    }
+
+  stride = cairo_format_stride_for_width (CAIRO_FORMAT_A8, width);
+  mask_data = g_malloc0 (stride * height);
+
+  surface = cairo_image_surface_create_for_data (mask_data,
+                                                 CAIRO_FORMAT_A8,
+                                                 width, height,
+                                                 stride);
+  cr = cairo_create (surface);
+  cairo_set_source_rgba (cr, 1, 1, 1, 1);
+
+  x = 0;
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle (priv->corner_region, i, &rect);
+
+      cairo_save (cr);
+      cairo_rectangle (cr, x, 0, rect.width, rect.height);
+      cairo_clip (cr);
+      cairo_translate (cr, x - rect.x, - rect.y);
+      cairo_append_path (cr, priv->overlay_path);
+      cairo_fill (cr);
+      cairo_restore (cr);
+
+      x += rect.width;
+    }
+
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+  cairo_surface_destroy (surface);
+
+  mask_texture = new_mask_texture (priv->texture, width, height,
+                                   stride, mask_data);
+
+  g_free (mask_data);
+
+  return mask_texture;
+}
+
+/* Shapes made of more rectangles than this get a full mask texture
+ * instead of being painted rectangle by rectangle.
+ */
+#define MAX_SHAPE_RECTS 16
+
 LOCAL_SYMBOL void
 meta_shaped_texture_ensure_mask (MetaShapedTexture *stex,
                                  cairo_region_t    *shape_region,
@@ -332,6 +810,8 @@ meta_shaped_texture_ensure_mask (MetaShapedTexture *stex,
   MetaShapedTexturePrivate *priv = stex->priv;
   CoglTexture *paint_tex;
   guint tex_width, tex_height;
+  cairo_rectangle_int_t tex_rect;
+  cairo_region_t *unmasked_region;
 
   paint_tex = priv->texture;
 
@@ -341,22 +821,18 @@ meta_shaped_texture_ensure_mask (MetaShapedTexture *stex,
   tex_width = cogl_texture_get_width (paint_tex);
   tex_height = cogl_texture_get_height (paint_tex);
 
-  /* If the mask texture we have was created for a different size then
+  /* If the mask we have was created for a different size then
      recreate it */
-  if (priv->mask_texture != NULL && priv->mask_needs_update)
+  if ((priv->mask_texture != NULL || priv->shape_region != NULL) &&
+      priv->mask_needs_update)
     {
       priv->mask_needs_update = FALSE;
       meta_shaped_texture_dirty_mask (stex);
     }
 
-  /* If we don't have a mask texture yet then create one */
-  if (priv->mask_texture == NULL)
+  /* If we don't have a mask yet then create one */
+  if (priv->mask_texture == NULL && priv->shape_region == NULL)
     {
-      guchar *mask_data;
-      int i;
-      int n_rects;
-      int stride;
-
       /* If we have no shape region and no (or an empty) overlay region, we
        * don't need to create a full mask texture, so quit early. */
       if (shape_region == NULL &&
@@ -369,55 +845,47 @@ meta_shaped_texture_ensure_mask (MetaShapedTexture *stex,
       if (shape_region == NULL)
         return;
 
-      n_rects = cairo_region_num_rectangles (shape_region);
-
-      if (n_rects == 0)
+      if (cairo_region_num_rectangles (shape_region) == 0)
         return;
 
-      stride = cairo_format_stride_for_width (CAIRO_FORMAT_A8, tex_width);
-
-      /* Create data for an empty image */
-      mask_data = g_malloc0 (stride * tex_height);
-
-      /* Fill in each rectangle. */
-      for (i = 0; i < n_rects; i ++)
+      /* Most shapes are a handful of rectangles with rounded corners
+       * drawn over them by the overlay path; paint those rectangles
+       * directly and only keep a mask for the corners.
+       */
+      tex_rect.x = tex_rect.y = 0;
+      tex_rect.width = tex_width;
+      tex_rect.height = tex_height;
+
+      unmasked_region = cairo_region_copy (shape_region);
+      cairo_region_intersect_rectangle (unmasked_region, &tex_rect);
+      if (has_frame && priv->overlay_region != NULL)
+        cairo_region_subtract (unmasked_region, priv->overlay_region);
+
+      if (cairo_region_num_rectangles (unmasked_region) > MAX_SHAPE_RECTS ||
+          (has_frame && priv->overlay_region != NULL &&
+           cairo_region_num_rectangles (priv->overlay_region) > MAX_SHAPE_RECTS))
         {
-          cairo_rectangle_int_t rect;
-          cairo_region_get_rectangle (shape_region, i, &rect);
-
-          gint x1 = rect.x, x2 = x1 + rect.width;
-          gint y1 = rect.y, y2 = y1 + rect.height;
-          guchar *p;
-
-          /* Clip the rectangle to the size of the texture */
-          x1 = CLAMP (x1, 0, (gint) tex_width - 1);
-          x2 = CLAMP (x2, x1, (gint) tex_width);
-          y1 = CLAMP (y1, 0, (gint) tex_height - 1);
-          y2 = CLAMP (y2, y1, (gint) tex_height);
-
-          /* Fill the rectangle */
-          for (p = mask_data + y1 * stride + x1;
-               y1 < y2;
-               y1++, p += stride)
-            memset (p, 255, x2 - x1);
+          cairo_region_destroy (unmasked_region);
+          priv->mask_texture = create_full_mask (stex, shape_region, has_frame);
+          invalidate_content (stex, FALSE);
+          return;
         }
 
-      if (has_frame)
-        install_overlay_path (stex, mask_data, tex_width, tex_height, stride);
+      priv->shape_region = cairo_region_copy (shape_region);
+      priv->unmasked_region = unmasked_region;
+      priv->mask_has_frame = has_frame;
 
-      if (meta_texture_rectangle_check (paint_tex))
-        priv->mask_texture = meta_cogl_rectangle_new (tex_width, tex_height,
-                                                        COGL_PIXEL_FORMAT_A_8,
-                                                        stride, mask_data);
-      else
-        priv->mask_texture = meta_cogl_texture_new_from_data_wrapper (tex_width, tex_height,
-                                                                      COGL_TEXTURE_NONE,
-                                                                      COGL_PIXEL_FORMAT_A_8,
-                                                                      COGL_PIXEL_FORMAT_ANY,
-                                                                      stride,
-                                                                      mask_data);
-
-      g_free (mask_data);
+      if (has_frame && priv->overlay_region != NULL &&
+          priv->overlay_path != NULL)
+        {
+          priv->corner_region = cairo_region_copy (priv->overlay_region);
+          cairo_region_intersect_rectangle (priv->corner_region, &tex_rect);
+
+          if (cairo_region_is_empty (priv->corner_region))
+            g_clear_pointer (&priv->corner_region, cairo_region_destroy);
+          else
+            priv->corner_mask_texture = create_corner_mask (stex);
+        }
     }
 }
 
@@ -436,6 +904,210 @@ texture_is_idle_and_not_mipmapped (gpointer user_data)
   return G_SOURCE_REMOVE;
 }
 
+static gboolean
+texture_tower_is_stale (gpointer user_data)
+{
+  MetaShapedTexture *stex = META_SHAPED_TEXTURE (user_data);
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (stex));
+  stex->priv->revalidate_idle_id = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Paints the blended part of a shape that has no full mask texture:
+ * the plain rectangles of the shape first, then the corners with
+ * their small mask.
+ */
+static void
+paint_shape_rectangles (MetaShapedTexture  *stex,
+                        CoglFramebuffer    *fb,
+                        CoglContext        *ctx,
+                        CoglTexture        *paint_tex,
+                        CoglPipelineFilter  min_filter,
+                        CoglPipelineFilter  filter,
+                        guchar              opacity,
+                        cairo_region_t     *blended_region,
+                        ClutterActorBox    *alloc)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  CoglPipeline *pipeline;
+  CoglColor color;
+  cairo_region_t *region;
+  int mask_width, mask_height;
+  int i, j, n_rects, n_corners, x;
+
+  cogl_color_init_from_4ub (&color, opacity, opacity, opacity, opacity);
+
+  if (blended_region != NULL)
+    {
+      region = cairo_region_copy (priv->unmasked_region);
+      cairo_region_intersect (region, blended_region);
+    }
+  else
+    {
+      region = cairo_region_reference (priv->unmasked_region);
+    }
+
+  if (!cairo_region_is_empty (region))
+    {
+      pipeline = ensure_pipeline (&priv->unmasked_pipeline,
+                                  get_unmasked_pipeline (ctx));
+      cogl_pipeline_set_layer_texture (pipeline, 0, paint_tex);
+      cogl_pipeline_set_layer_filters (pipeline, 0, min_filter, filter);
+      cogl_pipeline_set_color (pipeline, &color);
+
+      n_rects = cairo_region_num_rectangles (region);
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+          cairo_region_get_rectangle (region, i, &rect);
+          paint_clipped_rectangle (fb, pipeline, &rect, alloc);
+        }
+    }
+
+  cairo_region_destroy (region);
+
+  if (priv->corner_mask_texture == NULL)
+    return;
+
+  pipeline = ensure_pipeline (&priv->masked_pipeline,
+                              get_masked_pipeline (ctx));
+  cogl_pipeline_set_layer_texture (pipeline, 0, paint_tex);
+  cogl_pipeline_set_layer_filters (pipeline, 0, min_filter, filter);
+  cogl_pipeline_set_layer_texture (pipeline, 1, priv->corner_mask_texture);
+  cogl_pipeline_set_layer_filters (pipeline, 1, filter, filter);
+  cogl_pipeline_set_color (pipeline, &color);
+
+  mask_width = cogl_texture_get_width (priv->corner_mask_texture);
+  mask_height = cogl_texture_get_height (priv->corner_mask_texture);
+
+  /* The corners are laid out left to right in the mask, in the
+   * order of the region's rectangles.
+   */
+  x = 0;
+  n_corners = cairo_region_num_rectangles (priv->corner_region);
+  for (i = 0; i < n_corners; i++)
+    {
+      cairo_rectangle_int_t corner;
+      cairo_region_overlap_t overlap = CAIRO_REGION_OVERLAP_IN;
+
+      cairo_region_get_rectangle (priv->corner_region, i, &corner);
+
+      /* Only corners that are partly visible need a region of their
+       * own to work out which parts to paint */
+      if (blended_region != NULL)
+        overlap = cairo_region_contains_rectangle (blended_region, &corner);
+
+      if (overlap == CAIRO_REGION_OVERLAP_OUT)
+        {
+          x += corner.width;
+          continue;
+        }
+      else if (overlap == CAIRO_REGION_OVERLAP_IN)
+        {
+          paint_masked_rectangle (fb, pipeline, &corner, x, 0,
+                                  mask_width, mask_height, alloc);
+          x += corner.width;
+          continue;
+        }
+
+      region = cairo_region_create_rectangle (&corner);
+      cairo_region_intersect (region, blended_region);
+
+      n_rects = cairo_region_num_rectangles (region);
+      for (j = 0; j < n_rects; j++)
+        {
+          cairo_rectangle_int_t rect;
+          cairo_region_get_rectangle (region, j, &rect);
+          paint_masked_rectangle (fb, pipeline, &rect,
+                                  x + rect.x - corner.x, rect.y - corner.y,
+                                  mask_width, mask_height, alloc);
+        }
+
+      cairo_region_destroy (region);
+      x += corner.width;
+    }
+}
+
+static void
+paint_placeholder (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  CoglContext *ctx;
+  CoglPipeline *pipeline;
+  ClutterActorBox alloc;
+  guchar opacity;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  opacity = clutter_actor_get_paint_opacity (CLUTTER_ACTOR (stex));
+  clutter_actor_get_allocation_box (CLUTTER_ACTOR (stex), &alloc);
+
+  pipeline = ensure_pipeline (&priv->unmasked_pipeline,
+                              get_unmasked_pipeline (ctx));
+  cogl_pipeline_set_layer_texture (pipeline, 0, priv->placeholder_texture);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_LINEAR,
+                                   COGL_PIPELINE_FILTER_LINEAR);
+  cogl_pipeline_set_color4ub (pipeline, opacity, opacity, opacity, opacity);
+
+  cogl_framebuffer_draw_rectangle (cogl_get_draw_framebuffer (), pipeline,
+                                   0, 0,
+                                   alloc.x2 - alloc.x1,
+                                   alloc.y2 - alloc.y1);
+}
+
+/* Returns the texture to paint at the current transform: a level of
+ * the tower if the window hasn't been updating too quickly for it to
+ * be worth mipmapping, else the texture itself, or %NULL if there is
+ * none.
+ */
+static CoglTexture *
+select_paint_texture (MetaShapedTexture *stex,
+                      gint64             now)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  CoglTexture *paint_tex = NULL;
+
+  if (priv->create_mipmaps && priv->last_invalidation)
+    {
+      gint64 age = now - priv->last_invalidation;
+
+      if (age >= MIN_MIPMAP_AGE_USEC ||
+          priv->fast_updates < MIN_FAST_UPDATES_BEFORE_UNMIPMAP)
+        {
+          paint_tex = meta_texture_tower_get_paint_texture (priv->paint_tower);
+
+          /* The tower ran out of budget for this frame and gave us an
+           * out-of-date level; come back for the rest next frame */
+          if (paint_tex != NULL &&
+              meta_texture_tower_is_stale (priv->paint_tower) &&
+              !priv->revalidate_idle_id)
+            priv->revalidate_idle_id = g_idle_add (texture_tower_is_stale, stex);
+        }
+    }
+
+  if (paint_tex != NULL)
+    return paint_tex;
+
+  if (priv->texture == NULL)
+    return NULL;
+
+  if (priv->create_mipmaps)
+    {
+      /* Minus 1000 to ensure we don't fail the age test in timeout */
+      priv->earliest_remipmap = now + MIN_MIPMAP_AGE_USEC - 1000;
+
+      if (!priv->remipmap_timeout_id)
+        priv->remipmap_timeout_id =
+          g_timeout_add (MIN_MIPMAP_AGE_USEC / 1000,
+                         texture_is_idle_and_not_mipmapped,
+                         stex);
+    }
+
+  return priv->texture;
+}
+
 static void
 meta_shaped_texture_paint (ClutterActor *actor)
 {
@@ -447,7 +1119,7 @@ meta_shaped_texture_paint (ClutterActor *actor)
   CoglFramebuffer *fb;
   CoglTexture *paint_tex = NULL;
   ClutterActorBox alloc;
-  CoglPipelineFilter filter;
+  CoglPipelineFilter filter, min_filter;
   gint64 now = g_get_monotonic_time ();
 
   if (priv->clip_region && cairo_region_is_empty (priv->clip_region))
@@ -464,40 +1136,19 @@ meta_shaped_texture_paint (ClutterActor *actor)
    *  - Updating mipmaps that we don't need
    *  - Having to reallocate pixmaps on the server into larger buffers
    *
-   * So, we just unconditionally use our mipmap emulation code. If we
-   * wanted to use SGIS_generate_mipmap, we'd have to  query COGL to
-   * see if it was supported (no API currently), and then if and only
-   * if that was the case, set the clutter texture quality to HIGH.
-   * Setting the texture quality to high without SGIS_generate_mipmap
-   * support for TFP textures will result in fallbacks to XGetImage.
+   * So, we never mipmap the TFP texture itself: COGL has no API to
+   * query whether it would work, and asking for mipmaps without
+   * support for them on TFP textures results in fallbacks to
+   * XGetImage. The tower either emulates the mipmaps or, with
+   * META_DRIVER_MIPMAPS, lets the driver mipmap a copy of the texture.
    */
-  if (priv->create_mipmaps && priv->last_invalidation)
-    {
-      gint64 age = now - priv->last_invalidation;
-
-      if (age >= MIN_MIPMAP_AGE_USEC ||
-          priv->fast_updates < MIN_FAST_UPDATES_BEFORE_UNMIPMAP)
-        paint_tex = meta_texture_tower_get_paint_texture (priv->paint_tower);
-    }
+  paint_tex = select_paint_texture (stex, now);
 
   if (paint_tex == NULL)
     {
-      paint_tex = COGL_TEXTURE (priv->texture);
-
-      if (paint_tex == NULL)
-        return;
-
-      if (priv->create_mipmaps)
-        {
-          /* Minus 1000 to ensure we don't fail the age test in timeout */
-          priv->earliest_remipmap = now + MIN_MIPMAP_AGE_USEC - 1000;
-
-          if (!priv->remipmap_timeout_id)
-            priv->remipmap_timeout_id =
-              g_timeout_add (MIN_MIPMAP_AGE_USEC / 1000,
-                             texture_is_idle_and_not_mipmapped,
-                             stex);
-        }
+      if (priv->placeholder_texture != NULL)
+        paint_placeholder (stex);
+      return;
     }
 
   tex_width = priv->tex_width;
@@ -517,6 +1168,17 @@ meta_shaped_texture_paint (ClutterActor *actor)
   if (meta_actor_painting_untransformed (tex_width, tex_height, NULL, NULL))
     filter = COGL_PIPELINE_FILTER_NEAREST;
 
+  /* Scaled down paints of a texture the driver made mipmaps for pick
+   * between its levels */
+  min_filter = filter;
+
+  if (priv->paint_tower != NULL &&
+      meta_texture_tower_is_mipmapped (priv->paint_tower, paint_tex))
+    {
+      filter = COGL_PIPELINE_FILTER_LINEAR;
+      min_filter = COGL_PIPELINE_FILTER_LINEAR_MIPMAP_LINEAR;
+    }
+
   ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
   fb = cogl_get_draw_framebuffer ();
 
@@ -579,9 +1241,11 @@ meta_shaped_texture_paint (ClutterActor *actor)
 
       if (!cairo_region_is_empty (region))
         {
-          CoglPipeline *opaque_pipeline = get_unblended_pipeline (ctx);
+          CoglPipeline *opaque_pipeline =
+            ensure_pipeline (&priv->unblended_pipeline,
+                             get_unblended_pipeline (ctx));
           cogl_pipeline_set_layer_texture (opaque_pipeline, 0, paint_tex);
-          cogl_pipeline_set_layer_filters (opaque_pipeline, 0, filter, filter);
+          cogl_pipeline_set_layer_filters (opaque_pipeline, 0, min_filter, filter);
 
           n_rects = cairo_region_num_rectangles (region);
           for (i = 0; i < n_rects; i++)
@@ -605,94 +1269,387 @@ meta_shaped_texture_paint (ClutterActor *actor)
    *   1) and 3) are the times where we have to paint stuff. This tests
    *   for 1) and 3).
    */
-  if (blended_region == NULL || !cairo_region_is_empty (blended_region))
+  if ((blended_region == NULL || !cairo_region_is_empty (blended_region)) &&
+      priv->mask_texture == NULL && priv->shape_region != NULL)
+    {
+      /* The shape is simple enough to paint as rectangles */
+      paint_shape_rectangles (stex, fb, ctx, paint_tex, min_filter, filter,
+                              opacity, blended_region, &alloc);
+    }
+  else if (blended_region == NULL || !cairo_region_is_empty (blended_region))
     {
       CoglPipeline *blended_pipeline;
 
-      if (priv->mask_texture == NULL)
-        {
-          blended_pipeline = get_unmasked_pipeline (ctx);
-        }
-      else
-        {
-          blended_pipeline = get_masked_pipeline (ctx);
-          cogl_pipeline_set_layer_texture (blended_pipeline, 1, priv->mask_texture);
-          cogl_pipeline_set_layer_filters (blended_pipeline, 1, filter, filter);
-        }
+      if (priv->mask_texture == NULL)
+        {
+          blended_pipeline = ensure_pipeline (&priv->unmasked_pipeline,
+                                              get_unmasked_pipeline (ctx));
+        }
+      else
+        {
+          blended_pipeline = ensure_pipeline (&priv->masked_pipeline,
+                                              get_masked_pipeline (ctx));
+          cogl_pipeline_set_layer_texture (blended_pipeline, 1, priv->mask_texture);
+          cogl_pipeline_set_layer_filters (blended_pipeline, 1, filter, filter);
+        }
+
+      cogl_pipeline_set_layer_texture (blended_pipeline, 0, paint_tex);
+      cogl_pipeline_set_layer_filters (blended_pipeline, 0, min_filter, filter);
+
+      CoglColor color;
+      cogl_color_init_from_4ub (&color, opacity, opacity, opacity, opacity);
+      cogl_pipeline_set_color (blended_pipeline, &color);
+
+      if (blended_region != NULL)
+        {
+          /* 1) blended_region is not empty. Paint the rectangles. */
+          int i;
+          int n_rects = cairo_region_num_rectangles (blended_region);
+
+          for (i = 0; i < n_rects; i++)
+            {
+              cairo_rectangle_int_t rect;
+              cairo_region_get_rectangle (blended_region, i, &rect);
+
+              if (!gdk_rectangle_intersect (&tex_rect, &rect, &rect))
+                continue;
+
+              paint_clipped_rectangle (fb, blended_pipeline, &rect, &alloc);
+            }
+        }
+      else
+        {
+          /* 3) blended_region is NULL. Do a full paint. */
+          cogl_framebuffer_draw_rectangle (fb, blended_pipeline,
+                                           0, 0,
+                                           alloc.x2 - alloc.x1,
+                                           alloc.y2 - alloc.y1);
+        }
+    }
+
+  if (blended_region != NULL)
+    cairo_region_destroy (blended_region);
+}
+
+static void
+meta_shaped_texture_get_preferred_width (ClutterActor *self,
+                                         gfloat        for_height,
+                                         gfloat       *min_width_p,
+                                         gfloat       *natural_width_p)
+{
+  MetaShapedTexturePrivate *priv = META_SHAPED_TEXTURE (self)->priv;
+
+  if (min_width_p)
+    *min_width_p = priv->tex_width;
+
+  if (natural_width_p)
+    *natural_width_p = priv->tex_width;
+}
+
+static void
+meta_shaped_texture_get_preferred_height (ClutterActor *self,
+                                          gfloat        for_width,
+                                          gfloat       *min_height_p,
+                                          gfloat       *natural_height_p)
+{
+  MetaShapedTexturePrivate *priv = META_SHAPED_TEXTURE (self)->priv;
+
+  if (min_height_p)
+    *min_height_p = priv->tex_height;
+
+  if (natural_height_p)
+    *natural_height_p = priv->tex_height;
+}
+
+static gboolean
+meta_shaped_texture_get_paint_volume (ClutterActor *self,
+                                      ClutterPaintVolume *volume)
+{
+  return clutter_paint_volume_set_from_allocation (volume, self);
+}
+
+static cairo_region_t *
+meta_shaped_texture_get_opaque_region (ClutterActor *self)
+{
+  MetaShapedTexturePrivate *priv = META_SHAPED_TEXTURE (self)->priv;
+  ClutterActorBox alloc;
+
+  if (priv->opaque_region == NULL ||
+      priv->tex_width == 0 || priv->tex_height == 0)
+    return NULL;
+
+  /* The opaque region is in texture coordinates */
+  clutter_actor_get_allocation_box (self, &alloc);
+  if (clutter_actor_box_get_width (&alloc) != priv->tex_width ||
+      clutter_actor_box_get_height (&alloc) != priv->tex_height)
+    return NULL;
+
+  return cairo_region_copy (priv->opaque_region);
+}
+
+static void meta_shaped_texture_content_iface_init (ClutterContentIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (MetaShapedTextureContent, meta_shaped_texture_content,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (CLUTTER_TYPE_CONTENT,
+                                                meta_shaped_texture_content_iface_init));
+
+static void
+meta_shaped_texture_content_paint_content (ClutterContent   *content,
+                                           ClutterActor     *actor,
+                                           ClutterPaintNode *root)
+{
+  MetaShapedTextureContent *self = META_SHAPED_TEXTURE_CONTENT (content);
+  MetaShapedTexture *stex = self->stex;
+  MetaShapedTexturePrivate *priv;
+  CoglTexture *paint_tex;
+  ClutterPaintNode *node;
+  ClutterActorBox box;
+  CoglTexture *mask_texture;
+  CoglPipelineFilter filter, min_filter;
+  CoglContext *ctx;
+  gboolean masked;
+  guchar opacity;
+
+  if (stex == NULL)
+    return;
+
+  priv = stex->priv;
+
+  if (priv->tex_width == 0 || priv->tex_height == 0)
+    return;
+
+  clutter_actor_get_content_box (actor, &box);
+
+  if (box.x2 <= box.x1 || box.y2 <= box.y1)
+    return;
+
+  /* The tower picks its level for the texture being painted at its
+   * own size, so scale the transform to the size of the box */
+  cogl_push_matrix ();
+  cogl_translate (box.x1, box.y1, 0);
+  cogl_scale ((box.x2 - box.x1) / priv->tex_width,
+              (box.y2 - box.y1) / priv->tex_height,
+              1);
+  paint_tex = select_paint_texture (stex, g_get_monotonic_time ());
+  cogl_pop_matrix ();
+
+  if (paint_tex == NULL)
+    paint_tex = priv->placeholder_texture;
+
+  if (paint_tex == NULL)
+    return;
+
+  filter = COGL_PIPELINE_FILTER_LINEAR;
+  min_filter = filter;
+
+  if (meta_texture_tower_is_mipmapped (priv->paint_tower, paint_tex))
+    min_filter = COGL_PIPELINE_FILTER_LINEAR_MIPMAP_LINEAR;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  opacity = clutter_actor_get_paint_opacity (actor);
+
+  /* The content is painted as a single rectangle, so shapes the
+   * texture paints as rectangles plus a corner mask need a full mask
+   * here, like meta_shaped_texture_get_image() makes. The placeholder
+   * is painted unshaped, as the texture itself is gone. */
+  mask_texture = NULL;
+  if (paint_tex != priv->placeholder_texture)
+    {
+      mask_texture = priv->mask_texture;
+
+      if (mask_texture == NULL && priv->shape_region != NULL)
+        {
+          if (priv->content_mask_texture == NULL)
+            priv->content_mask_texture =
+              create_full_mask (stex, priv->shape_region,
+                                priv->mask_has_frame);
+
+          mask_texture = priv->content_mask_texture;
+        }
+    }
+
+  masked = mask_texture != NULL;
+
+  if (self->pipeline != NULL &&
+      masked != (cogl_pipeline_get_n_layers (self->pipeline) > 1))
+    g_clear_pointer (&self->pipeline, cogl_object_unref);
+
+  if (self->pipeline == NULL)
+    self->pipeline = cogl_pipeline_copy (masked ? get_masked_pipeline (ctx)
+                                                : get_unmasked_pipeline (ctx));
+
+  if (masked)
+    {
+      cogl_pipeline_set_layer_texture (self->pipeline, 1, mask_texture);
+      cogl_pipeline_set_layer_filters (self->pipeline, 1, filter, filter);
+    }
+
+  cogl_pipeline_set_layer_texture (self->pipeline, 0, paint_tex);
+  cogl_pipeline_set_layer_filters (self->pipeline, 0, min_filter, filter);
+  cogl_pipeline_set_color4ub (self->pipeline, opacity, opacity, opacity, opacity);
+
+  node = clutter_pipeline_node_new (self->pipeline);
+  clutter_paint_node_set_name (node, "MetaShapedTexture Content");
+  clutter_paint_node_add_rectangle (node, &box);
+  clutter_paint_node_add_child (root, node);
+  clutter_paint_node_unref (node);
+}
+
+static gboolean
+meta_shaped_texture_content_get_preferred_size (ClutterContent *content,
+                                                gfloat         *width,
+                                                gfloat         *height)
+{
+  MetaShapedTextureContent *self = META_SHAPED_TEXTURE_CONTENT (content);
+
+  if (self->stex == NULL)
+    return FALSE;
 
-      cogl_pipeline_set_layer_texture (blended_pipeline, 0, paint_tex);
-      cogl_pipeline_set_layer_filters (blended_pipeline, 0, filter, filter);
+  if (width)
+    *width = self->stex->priv->tex_width;
 
-      CoglColor color;
-      cogl_color_init_from_4ub (&color, opacity, opacity, opacity, opacity);
-      cogl_pipeline_set_color (blended_pipeline, &color);
+  if (height)
+    *height = self->stex->priv->tex_height;
 
-      if (blended_region != NULL)
-        {
-          /* 1) blended_region is not empty. Paint the rectangles. */
-          int i;
-          int n_rects = cairo_region_num_rectangles (blended_region);
+  return TRUE;
+}
 
-          for (i = 0; i < n_rects; i++)
-            {
-              cairo_rectangle_int_t rect;
-              cairo_region_get_rectangle (blended_region, i, &rect);
+static void
+meta_shaped_texture_content_attached (ClutterContent *content,
+                                      ClutterActor   *actor)
+{
+  MetaShapedTextureContent *self = META_SHAPED_TEXTURE_CONTENT (content);
 
-              if (!gdk_rectangle_intersect (&tex_rect, &rect, &rect))
-                continue;
+  self->actors = g_list_prepend (self->actors, actor);
+}
 
-              paint_clipped_rectangle (fb, blended_pipeline, &rect, &alloc);
-            }
-        }
-      else
-        {
-          /* 3) blended_region is NULL. Do a full paint. */
-          cogl_framebuffer_draw_rectangle (fb, blended_pipeline,
-                                           0, 0,
-                                           alloc.x2 - alloc.x1,
-                                           alloc.y2 - alloc.y1);
-        }
-    }
+static void
+meta_shaped_texture_content_detached (ClutterContent *content,
+                                      ClutterActor   *actor)
+{
+  MetaShapedTextureContent *self = META_SHAPED_TEXTURE_CONTENT (content);
 
-  if (blended_region != NULL)
-    cairo_region_destroy (blended_region);
+  self->actors = g_list_remove (self->actors, actor);
 }
 
 static void
-meta_shaped_texture_get_preferred_width (ClutterActor *self,
-                                         gfloat        for_height,
-                                         gfloat       *min_width_p,
-                                         gfloat       *natural_width_p)
+meta_shaped_texture_content_iface_init (ClutterContentIface *iface)
 {
-  MetaShapedTexturePrivate *priv = META_SHAPED_TEXTURE (self)->priv;
+  iface->paint_content = meta_shaped_texture_content_paint_content;
+  iface->get_preferred_size = meta_shaped_texture_content_get_preferred_size;
+  iface->attached = meta_shaped_texture_content_attached;
+  iface->detached = meta_shaped_texture_content_detached;
+}
 
-  if (min_width_p)
-    *min_width_p = priv->tex_width;
+static void
+meta_shaped_texture_content_finalize (GObject *object)
+{
+  MetaShapedTextureContent *self = META_SHAPED_TEXTURE_CONTENT (object);
 
-  if (natural_width_p)
-    *natural_width_p = priv->tex_width;
+  g_clear_pointer (&self->pipeline, cogl_object_unref);
+  g_list_free (self->actors);
+
+  G_OBJECT_CLASS (meta_shaped_texture_content_parent_class)->finalize (object);
 }
 
 static void
-meta_shaped_texture_get_preferred_height (ClutterActor *self,
-                                          gfloat        for_width,
-                                          gfloat       *min_height_p,
-                                          gfloat       *natural_height_p)
+meta_shaped_texture_content_class_init (MetaShapedTextureContentClass *klass)
 {
-  MetaShapedTexturePrivate *priv = META_SHAPED_TEXTURE (self)->priv;
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
-  if (min_height_p)
-    *min_height_p = priv->tex_height;
+  gobject_class->finalize = meta_shaped_texture_content_finalize;
+}
 
-  if (natural_height_p)
-    *natural_height_p = priv->tex_height;
+static void
+meta_shaped_texture_content_init (MetaShapedTextureContent *self)
+{
 }
 
-static gboolean
-meta_shaped_texture_get_paint_volume (ClutterActor *self,
-                                      ClutterPaintVolume *volume)
+static void
+invalidate_content (MetaShapedTexture *stex,
+                    gboolean           size_changed)
 {
-  return clutter_paint_volume_set_from_allocation (volume, self);
+  MetaShapedTextureContent *content = stex->priv->content;
+  GList *l;
+
+  if (content == NULL || content->actors == NULL)
+    return;
+
+  clutter_content_invalidate (CLUTTER_CONTENT (content));
+
+  if (size_changed)
+    {
+      for (l = content->actors; l != NULL; l = l->next)
+        clutter_actor_queue_relayout (l->data);
+    }
+}
+
+/**
+ * meta_shaped_texture_get_content:
+ * @stex: a #MetaShapedTexture
+ *
+ * Gets a #ClutterContent painting the texture of @stex, scaled to the
+ * content box of the actors it is set on. It is meant for previews of
+ * windows: unlike a #ClutterClone of the window actor it doesn't paint
+ * the shadow or the rest of the window actor again, and it picks the
+ * level of the mipmaps that fits the size of the preview. The content
+ * is redrawn whenever @stex is updated, and paints nothing once @stex
+ * is destroyed.
+ *
+ * Return value: (transfer none): the #ClutterContent for @stex
+ */
+ClutterContent *
+meta_shaped_texture_get_content (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv;
+
+  g_return_val_if_fail (META_IS_SHAPED_TEXTURE (stex), NULL);
+
+  priv = stex->priv;
+
+  if (priv->content == NULL)
+    {
+      priv->content = g_object_new (META_TYPE_SHAPED_TEXTURE_CONTENT, NULL);
+      priv->content->stex = stex;
+    }
+
+  return CLUTTER_CONTENT (priv->content);
+}
+
+/**
+ * meta_shaped_texture_has_visible_clones:
+ * @stex: a #MetaShapedTexture
+ *
+ * Returns whether @stex is shown anywhere besides its own place on the
+ * stage: through a visible #ClutterClone of it or of one of its
+ * ancestors, or through an actor showing the content returned by
+ * meta_shaped_texture_get_content().
+ *
+ * Return value: %TRUE if @stex has visible clones
+ */
+LOCAL_SYMBOL gboolean
+meta_shaped_texture_has_visible_clones (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  GList *l;
+
+  if (clutter_actor_has_visible_clones (CLUTTER_ACTOR (stex)))
+    return TRUE;
+
+  if (priv->content == NULL)
+    return FALSE;
+
+  for (l = priv->content->actors; l != NULL; l = l->next)
+    {
+      ClutterActor *actor = l->data;
+
+      if (CLUTTER_ACTOR_IS_MAPPED (actor) &&
+          clutter_actor_get_paint_opacity (actor) != 0)
+        return TRUE;
+    }
+
+  return FALSE;
 }
 
 ClutterActor *
@@ -734,7 +1691,7 @@ meta_shaped_texture_set_create_mipmaps (MetaShapedTexture *stex,
  * @height: the height of the damaged area
  * @unobscured_region: The unobscured region of the window or %NULL if
  * there is no valid one (like when the actor is transformed or
- * has a mapped clone)
+ * has visible clones)
  *
  * Repairs the damaged area indicated by @x, @y, @width and @height
  * and queues a redraw for the intersection @visibible_region and
@@ -760,6 +1717,7 @@ meta_shaped_texture_update_area (MetaShapedTexture *stex,
     return FALSE;
 
   meta_texture_tower_update_area (priv->paint_tower, x, y, width, height);
+  invalidate_content (stex, FALSE);
 
   priv->prev_invalidation = priv->last_invalidation;
   priv->last_invalidation = g_get_monotonic_time ();
@@ -779,8 +1737,16 @@ meta_shaped_texture_update_area (MetaShapedTexture *stex,
     {
       cairo_region_t *intersection;
 
-      if (cairo_region_is_empty (unobscured_region))
-        return FALSE;
+      switch (cairo_region_contains_rectangle (unobscured_region, &clip))
+        {
+        case CAIRO_REGION_OVERLAP_OUT:
+          return FALSE;
+        case CAIRO_REGION_OVERLAP_IN:
+          clutter_actor_queue_redraw_with_clip (CLUTTER_ACTOR (stex), &clip);
+          return TRUE;
+        case CAIRO_REGION_OVERLAP_PART:
+          break;
+        }
 
       intersection = cairo_region_copy (unobscured_region);
       cairo_region_intersect_rectangle (intersection, &clip);
@@ -820,6 +1786,9 @@ set_cogl_texture (MetaShapedTexture *stex,
 
   priv->texture = cogl_tex;
 
+  g_clear_pointer (&priv->placeholder_texture, cogl_object_unref);
+  release_pipelines (stex);
+
   if (cogl_tex != NULL)
     {
       width = cogl_texture_get_width (COGL_TEXTURE (cogl_tex));
@@ -850,6 +1819,8 @@ set_cogl_texture (MetaShapedTexture *stex,
 
   if (priv->create_mipmaps)
     meta_texture_tower_set_base_texture (priv->paint_tower, cogl_tex);
+
+  invalidate_content (stex, priv->mask_needs_update);
 }
 
 /**
@@ -866,6 +1837,79 @@ meta_shaped_texture_set_texture (MetaShapedTexture *stex,
   set_cogl_texture (stex, texture);
 }
 
+/**
+ * meta_shaped_texture_evict_texture:
+ * @stex: a #MetaShapedTexture
+ *
+ * Drops the texture, its scaled down copies and the mask to free their
+ * memory while the window is hidden, without changing the size of
+ * @stex. If a small enough scaled down copy exists it is kept and
+ * painted stretched in place of the texture, until a new texture is
+ * set with meta_shaped_texture_set_texture().
+ */
+LOCAL_SYMBOL void
+meta_shaped_texture_evict_texture (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv;
+
+  g_return_if_fail (META_IS_SHAPED_TEXTURE (stex));
+
+  priv = stex->priv;
+
+  if (priv->texture == NULL)
+    return;
+
+  g_clear_pointer (&priv->placeholder_texture, cogl_object_unref);
+  if (priv->create_mipmaps)
+    priv->placeholder_texture = meta_texture_tower_ref_placeholder (priv->paint_tower);
+
+  meta_texture_tower_set_base_texture (priv->paint_tower, NULL);
+  g_clear_pointer (&priv->texture, cogl_object_unref);
+
+  meta_shaped_texture_dirty_mask (stex);
+  release_pipelines (stex);
+  invalidate_content (stex, FALSE);
+}
+
+/**
+ * meta_shaped_texture_get_memory_size:
+ * @stex: a #MetaShapedTexture
+ *
+ * Return value: an estimate of the texture memory used by @stex, in
+ *  bytes, counting the texture, its scaled down copies, the masks and
+ *  any placeholder
+ */
+LOCAL_SYMBOL gsize
+meta_shaped_texture_get_memory_size (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv;
+  gsize size = 0;
+
+  g_return_val_if_fail (META_IS_SHAPED_TEXTURE (stex), 0);
+
+  priv = stex->priv;
+
+  if (priv->texture != NULL)
+    size += (gsize) priv->tex_width * priv->tex_height * 4;
+
+  if (priv->paint_tower != NULL)
+    size += meta_texture_tower_get_memory_size (priv->paint_tower);
+
+  if (priv->mask_texture != NULL)
+    size += (gsize) cogl_texture_get_width (priv->mask_texture) *
+            cogl_texture_get_height (priv->mask_texture);
+
+  if (priv->corner_mask_texture != NULL)
+    size += (gsize) cogl_texture_get_width (priv->corner_mask_texture) *
+            cogl_texture_get_height (priv->corner_mask_texture);
+
+  if (priv->placeholder_texture != NULL)
+    size += (gsize) cogl_texture_get_width (priv->placeholder_texture) *
+            cogl_texture_get_height (priv->placeholder_texture) * 4;
+
+  return size;
+}
+
 /**
  * meta_shaped_texture_get_texture:
  * @stex: The #MetaShapedTexture
@@ -1043,8 +2087,15 @@ meta_shaped_texture_get_image (MetaShapedTexture     *stex,
     cogl_object_unref (texture);
 
   mask_texture = stex->priv->mask_texture;
+  if (mask_texture != NULL)
+    cogl_object_ref (mask_texture);
+  else if (stex->priv->shape_region != NULL)
+    mask_texture = create_full_mask (stex, stex->priv->shape_region,
+                                     stex->priv->mask_has_frame);
+
   if (mask_texture != NULL)
     {
+      CoglTexture *full_mask_texture = mask_texture;
       cairo_t *cr;
       cairo_surface_t *mask_surface;
 
@@ -1075,7 +2126,277 @@ meta_shaped_texture_get_image (MetaShapedTexture     *stex,
 
       if (clip != NULL)
         cogl_object_unref (mask_texture);
+      cogl_object_unref (full_mask_texture);
     }
 
   return surface;
 }
+
+typedef struct
+{
+  CoglOffscreen   *offscreen;
+  CoglPixelBuffer *buffer;
+  int              width;
+  int              height;
+  int              rowstride;
+} GetImageData;
+
+static void
+get_image_data_free (gpointer user_data)
+{
+  GetImageData *data = user_data;
+
+  if (data->offscreen)
+    cogl_object_unref (data->offscreen);
+  if (data->buffer)
+    cogl_object_unref (data->buffer);
+
+  g_free (data);
+}
+
+static void
+finish_get_image (GTask *task)
+{
+  GetImageData *data = g_task_get_task_data (task);
+  cairo_surface_t *surface;
+  guchar *src, *dst;
+  int dst_stride;
+  int y;
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_object_unref (task);
+      return;
+    }
+
+  /* The fence has signalled, so the read into the buffer has finished
+   * and mapping it doesn't have to wait for the GPU */
+  src = cogl_buffer_map (COGL_BUFFER (data->buffer),
+                         COGL_BUFFER_ACCESS_READ, 0);
+  if (src == NULL)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Failed to map the window image buffer");
+      g_object_unref (task);
+      return;
+    }
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        data->width, data->height);
+  dst = cairo_image_surface_get_data (surface);
+  dst_stride = cairo_image_surface_get_stride (surface);
+
+  for (y = 0; y < data->height; y++)
+    memcpy (dst + y * dst_stride, src + y * data->rowstride, data->width * 4);
+
+  cogl_buffer_unmap (COGL_BUFFER (data->buffer));
+  cairo_surface_mark_dirty (surface);
+
+  g_task_return_pointer (task, surface,
+                         (GDestroyNotify) cairo_surface_destroy);
+  g_object_unref (task);
+}
+
+static void
+get_image_fence_cb (CoglFence *fence,
+                    void      *user_data)
+{
+  finish_get_image (user_data);
+}
+
+static gboolean
+get_image_idle_cb (gpointer user_data)
+{
+  finish_get_image (user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * meta_shaped_texture_get_image_async:
+ * @stex: A #MetaShapedTexture
+ * @clip: (allow-none): A clipping rectangle, as for
+ *   meta_shaped_texture_get_image()
+ * @max_width: the maximum width of the image, or 0 for no limit
+ * @max_height: the maximum height of the image, or 0 for no limit
+ * @cancellable: (allow-none): a #GCancellable
+ * @callback: called when the image is ready
+ * @user_data: data for @callback
+ *
+ * Like meta_shaped_texture_get_image(), but the shape is applied and
+ * the image scaled down to fit within @max_width by @max_height on the
+ * GPU, and the result is read back without waiting for the GPU to
+ * catch up. @callback is called once the image is available, usually
+ * a frame or two later; call meta_shaped_texture_get_image_finish()
+ * from it to get the image.
+ */
+void
+meta_shaped_texture_get_image_async (MetaShapedTexture     *stex,
+                                     cairo_rectangle_int_t *clip,
+                                     int                    max_width,
+                                     int                    max_height,
+                                     GCancellable          *cancellable,
+                                     GAsyncReadyCallback    callback,
+                                     gpointer               user_data)
+{
+  MetaShapedTexturePrivate *priv;
+  CoglContext *ctx;
+  CoglTexture *texture, *mask_texture, *target;
+  CoglFramebuffer *fb;
+  CoglPipeline *pipeline;
+  CoglBitmap *bitmap;
+  CoglError *catch_error = NULL;
+  cairo_rectangle_int_t texture_rect = { 0, 0, 0, 0 };
+  cairo_rectangle_int_t rect;
+  GetImageData *data;
+  GTask *task;
+  double scale = 1.0;
+  float tex_coords[8];
+
+  g_return_if_fail (META_IS_SHAPED_TEXTURE (stex));
+
+  priv = stex->priv;
+  task = g_task_new (stex, cancellable, callback, user_data);
+  texture = priv->texture;
+
+  if (texture == NULL)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                               "The window has no texture");
+      g_object_unref (task);
+      return;
+    }
+
+  texture_rect.width = cogl_texture_get_width (texture);
+  texture_rect.height = cogl_texture_get_height (texture);
+
+  rect = texture_rect;
+  if (clip != NULL && !gdk_rectangle_intersect (&texture_rect, clip, &rect))
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                               "The clip doesn't intersect the window");
+      g_object_unref (task);
+      return;
+    }
+
+  if (max_width > 0 && rect.width > max_width)
+    scale = (double) max_width / rect.width;
+  if (max_height > 0 && rect.height > max_height)
+    scale = MIN (scale, (double) max_height / rect.height);
+
+  data = g_new0 (GetImageData, 1);
+  data->width = MAX (1, (int) (rect.width * scale + 0.5));
+  data->height = MAX (1, (int) (rect.height * scale + 0.5));
+  data->rowstride = data->width * 4;
+  g_task_set_task_data (task, data, get_image_data_free);
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  target = COGL_TEXTURE (cogl_texture_2d_new_with_size (ctx,
+                                                        data->width,
+                                                        data->height));
+  data->offscreen = cogl_offscreen_new_with_texture (target);
+  cogl_object_unref (target);
+  fb = COGL_FRAMEBUFFER (data->offscreen);
+
+  if (!cogl_framebuffer_allocate (fb, &catch_error))
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Couldn't allocate the window image framebuffer: %s",
+                               catch_error->message);
+      cogl_error_free (catch_error);
+      g_object_unref (task);
+      return;
+    }
+
+  cogl_framebuffer_orthographic (fb, 0, 0, data->width, data->height, -1., 1.);
+
+  mask_texture = priv->mask_texture;
+  if (mask_texture != NULL)
+    cogl_object_ref (mask_texture);
+  else if (priv->shape_region != NULL)
+    mask_texture = create_full_mask (stex, priv->shape_region,
+                                     priv->mask_has_frame);
+
+  if (mask_texture != NULL)
+    {
+      pipeline = cogl_pipeline_copy (get_masked_pipeline (ctx));
+      cogl_pipeline_set_layer_texture (pipeline, 1, mask_texture);
+      cogl_pipeline_set_layer_filters (pipeline, 1,
+                                       COGL_PIPELINE_FILTER_LINEAR,
+                                       COGL_PIPELINE_FILTER_LINEAR);
+      cogl_object_unref (mask_texture);
+    }
+  else
+    pipeline = cogl_pipeline_copy (get_unmasked_pipeline (ctx));
+
+  /* Replace the contents of the new framebuffer outright */
+  cogl_pipeline_set_blend (pipeline, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+  cogl_pipeline_set_layer_texture (pipeline, 0, texture);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_LINEAR,
+                                   COGL_PIPELINE_FILTER_LINEAR);
+
+  /* The mask always covers the whole texture, so both layers use the
+   * same coordinates */
+  tex_coords[0] = tex_coords[4] = (float) rect.x / texture_rect.width;
+  tex_coords[1] = tex_coords[5] = (float) rect.y / texture_rect.height;
+  tex_coords[2] = tex_coords[6] = (float) (rect.x + rect.width) / texture_rect.width;
+  tex_coords[3] = tex_coords[7] = (float) (rect.y + rect.height) / texture_rect.height;
+
+  cogl_framebuffer_draw_multitextured_rectangle (fb, pipeline,
+                                                 0, 0,
+                                                 data->width, data->height,
+                                                 tex_coords,
+                                                 mask_texture != NULL ? 8 : 4);
+  cogl_object_unref (pipeline);
+
+  /* Reading into a pixel buffer only queues the copy; the data is
+   * mapped once the fence behind it signals */
+  data->buffer = cogl_pixel_buffer_new (ctx,
+                                        data->rowstride * data->height,
+                                        NULL);
+  bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (data->buffer),
+                                        CLUTTER_CAIRO_FORMAT_ARGB32,
+                                        data->width, data->height,
+                                        data->rowstride, 0);
+
+  if (!cogl_framebuffer_read_pixels_into_bitmap (fb, 0, 0,
+                                                 COGL_READ_PIXELS_COLOR_BUFFER,
+                                                 bitmap))
+    {
+      cogl_object_unref (bitmap);
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Failed to read back the window image");
+      g_object_unref (task);
+      return;
+    }
+
+  cogl_object_unref (bitmap);
+
+  /* Without fences, the read will usually have finished by the time
+   * the main loop gets back to us */
+  if (cogl_framebuffer_add_fence_callback (fb, get_image_fence_cb, task) == NULL)
+    g_idle_add (get_image_idle_cb, task);
+}
+
+/**
+ * meta_shaped_texture_get_image_finish:
+ * @stex: A #MetaShapedTexture
+ * @result: the #GAsyncResult passed to the callback
+ * @error: return location for a #GError
+ *
+ * Finishes a call to meta_shaped_texture_get_image_async().
+ *
+ * Returns: (transfer full): a new cairo surface to be freed with
+ * cairo_surface_destroy(), or %NULL on error.
+ */
+cairo_surface_t *
+meta_shaped_texture_get_image_finish (MetaShapedTexture  *stex,
+                                      GAsyncResult       *result,
+                                      GError            **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, stex), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
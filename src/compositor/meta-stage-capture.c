@@ -0,0 +1,322 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Asynchronous capture of the painted stage
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+
+#include <config.h>
+
+#include <string.h>
+
+#include <meta/util.h>
+
+#include "meta-stage-capture.h"
+
+/* After each stage paint the part of the stage that changed is copied
+ * into one of a small ring of pixel buffers. glReadPixels() into a
+ * buffer object only queues the copy, and the buffer is mapped and
+ * handed to the consumers once a fence placed after it signals, so the
+ * main loop never waits for the GPU. When every buffer is still in
+ * flight the frame is skipped and its damage folded into the next
+ * capture, so consumers always see every changed pixel eventually.
+ */
+#define N_CAPTURE_SLOTS 3
+
+typedef struct
+{
+  CoglPixelBuffer       *buffer;
+  size_t                 size;
+  cairo_rectangle_int_t  area;
+  gboolean               bottom_up;
+  gboolean               busy;
+} CaptureSlot;
+
+typedef struct
+{
+  guint                id;
+  MetaStageCaptureFunc func;
+  gpointer             user_data;
+  GDestroyNotify       notify;
+} CaptureConsumer;
+
+static GList *consumers;
+static guint next_consumer_id = 1;
+static CaptureSlot slots[N_CAPTURE_SLOTS];
+static cairo_region_t *pending_damage;
+
+/**
+ * meta_stage_capture_add:
+ * @stage: the stage to capture
+ * @func: called with each captured area
+ * @user_data: data for @func
+ * @notify: called on @user_data when the consumer is removed
+ *
+ * Starts passing the changed parts of @stage to @func after it has
+ * been painted.
+ *
+ * Returns: an id for meta_stage_capture_remove()
+ */
+LOCAL_SYMBOL guint
+meta_stage_capture_add (ClutterStage         *stage,
+                        MetaStageCaptureFunc  func,
+                        gpointer              user_data,
+                        GDestroyNotify        notify)
+{
+  CaptureConsumer *consumer;
+  cairo_rectangle_int_t stage_rect = { 0, 0, 0, 0 };
+  float width, height;
+
+  consumer = g_new0 (CaptureConsumer, 1);
+  consumer->id = next_consumer_id++;
+  consumer->func = func;
+  consumer->user_data = user_data;
+  consumer->notify = notify;
+
+  consumers = g_list_append (consumers, consumer);
+
+  /* A new consumer needs a full first frame */
+  clutter_actor_get_size (CLUTTER_ACTOR (stage), &width, &height);
+  stage_rect.width = width;
+  stage_rect.height = height;
+
+  if (pending_damage == NULL)
+    pending_damage = cairo_region_create ();
+  cairo_region_union_rectangle (pending_damage, &stage_rect);
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (stage));
+
+  return consumer->id;
+}
+
+/**
+ * meta_stage_capture_remove:
+ * @id: an id returned from meta_stage_capture_add()
+ *
+ * Stops passing captured areas to a consumer.
+ */
+LOCAL_SYMBOL void
+meta_stage_capture_remove (guint id)
+{
+  GList *l;
+  int i;
+
+  for (l = consumers; l; l = l->next)
+    {
+      CaptureConsumer *consumer = l->data;
+
+      if (consumer->id != id)
+        continue;
+
+      consumers = g_list_delete_link (consumers, l);
+
+      if (consumer->notify)
+        consumer->notify (consumer->user_data);
+      g_free (consumer);
+      break;
+    }
+
+  if (consumers != NULL)
+    return;
+
+  /* Buffers still being read into are released when their fence
+   * fires */
+  for (i = 0; i < N_CAPTURE_SLOTS; i++)
+    if (!slots[i].busy && slots[i].buffer)
+      {
+        cogl_object_unref (slots[i].buffer);
+        slots[i].buffer = NULL;
+        slots[i].size = 0;
+      }
+
+  g_clear_pointer (&pending_damage, cairo_region_destroy);
+}
+
+static void
+deliver_slot (CaptureSlot *slot)
+{
+  cairo_surface_t *surface;
+  guchar *src, *dst;
+  int src_stride, dst_stride;
+  int y;
+  GList *l;
+
+  slot->busy = FALSE;
+
+  if (consumers == NULL)
+    {
+      cogl_object_unref (slot->buffer);
+      slot->buffer = NULL;
+      slot->size = 0;
+      return;
+    }
+
+  src = cogl_buffer_map (COGL_BUFFER (slot->buffer),
+                         COGL_BUFFER_ACCESS_READ, 0);
+  if (src == NULL)
+    {
+      meta_verbose ("Failed to map stage capture buffer\n");
+      return;
+    }
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        slot->area.width, slot->area.height);
+  dst = cairo_image_surface_get_data (surface);
+  dst_stride = cairo_image_surface_get_stride (surface);
+  src_stride = slot->area.width * 4;
+
+  /* Rows read from an onscreen framebuffer are bottom up, see
+   * capture_area() */
+  for (y = 0; y < slot->area.height; y++)
+    {
+      int src_y = slot->bottom_up ? slot->area.height - 1 - y : y;
+
+      memcpy (dst + y * dst_stride, src + src_y * src_stride, src_stride);
+    }
+
+  cogl_buffer_unmap (COGL_BUFFER (slot->buffer));
+  cairo_surface_mark_dirty (surface);
+
+  for (l = consumers; l; )
+    {
+      CaptureConsumer *consumer = l->data;
+
+      /* The consumer may remove itself */
+      l = l->next;
+      consumer->func (surface, &slot->area, consumer->user_data);
+    }
+
+  cairo_surface_destroy (surface);
+}
+
+static void
+capture_fence_cb (CoglFence *fence,
+                  void      *user_data)
+{
+  deliver_slot (user_data);
+}
+
+static gboolean
+capture_idle_cb (gpointer user_data)
+{
+  deliver_slot (user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+capture_area (CoglFramebuffer             *framebuffer,
+              CaptureSlot                 *slot,
+              const cairo_rectangle_int_t *area)
+{
+  CoglContext *ctx = cogl_framebuffer_get_context (framebuffer);
+  CoglBitmap *bitmap;
+  size_t size = (size_t) area->width * area->height * 4;
+  gboolean success;
+
+  if (slot->buffer == NULL || slot->size < size)
+    {
+      if (slot->buffer)
+        cogl_object_unref (slot->buffer);
+
+      slot->buffer = cogl_pixel_buffer_new (ctx, size, NULL);
+      slot->size = size;
+    }
+
+  bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (slot->buffer),
+                                        CLUTTER_CAIRO_FORMAT_ARGB32,
+                                        area->width, area->height,
+                                        area->width * 4, 0);
+
+  /* Flipping the rows of an onscreen framebuffer would mean mapping
+   * the buffer right away, so they are read as they are and reversed
+   * while copying them out */
+  success = cogl_framebuffer_read_pixels_into_bitmap (framebuffer,
+                                                      area->x, area->y,
+                                                      COGL_READ_PIXELS_COLOR_BUFFER |
+                                                      COGL_READ_PIXELS_NO_FLIP,
+                                                      bitmap);
+  cogl_object_unref (bitmap);
+
+  if (!success)
+    return FALSE;
+
+  slot->area = *area;
+  slot->bottom_up = !cogl_is_offscreen (framebuffer);
+  slot->busy = TRUE;
+
+  if (cogl_framebuffer_add_fence_callback (framebuffer,
+                                           capture_fence_cb, slot) == NULL)
+    g_idle_add (capture_idle_cb, slot);
+
+  return TRUE;
+}
+
+/**
+ * meta_stage_capture_after_paint:
+ * @stage: the stage that was just painted
+ *
+ * Queues the capture of what changed in the frame; called from the
+ * compositor's after-paint handler, while the painted framebuffer is
+ * still the draw framebuffer.
+ */
+LOCAL_SYMBOL void
+meta_stage_capture_after_paint (ClutterStage *stage)
+{
+  CoglFramebuffer *framebuffer;
+  cairo_rectangle_int_t damage;
+  cairo_rectangle_int_t area;
+  cairo_rectangle_int_t fb_rect = { 0, 0, 0, 0 };
+  CaptureSlot *slot = NULL;
+  int i;
+
+  if (consumers == NULL)
+    return;
+
+  clutter_stage_get_redraw_clip_bounds (stage, &damage);
+
+  if (pending_damage == NULL)
+    pending_damage = cairo_region_create ();
+  cairo_region_union_rectangle (pending_damage, &damage);
+
+  for (i = 0; i < N_CAPTURE_SLOTS; i++)
+    if (!slots[i].busy)
+      {
+        slot = &slots[i];
+        break;
+      }
+
+  /* The consumers are behind; catch up on a later frame */
+  if (slot == NULL)
+    return;
+
+  framebuffer = cogl_get_draw_framebuffer ();
+  fb_rect.width = cogl_framebuffer_get_width (framebuffer);
+  fb_rect.height = cogl_framebuffer_get_height (framebuffer);
+
+  cairo_region_intersect_rectangle (pending_damage, &fb_rect);
+  if (cairo_region_is_empty (pending_damage))
+    return;
+
+  cairo_region_get_extents (pending_damage, &area);
+
+  if (capture_area (framebuffer, slot, &area))
+    {
+      cairo_region_destroy (pending_damage);
+      pending_damage = cairo_region_create ();
+    }
+}
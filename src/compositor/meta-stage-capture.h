@@ -0,0 +1,36 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Asynchronous capture of the painted stage
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+
+#ifndef __META_STAGE_CAPTURE_H__
+#define __META_STAGE_CAPTURE_H__
+
+#include <clutter/clutter.h>
+#include <meta/compositor-muffin.h>
+
+guint meta_stage_capture_add         (ClutterStage         *stage,
+                                      MetaStageCaptureFunc  func,
+                                      gpointer              user_data,
+                                      GDestroyNotify        notify);
+void  meta_stage_capture_remove      (guint                 id);
+
+void  meta_stage_capture_after_paint (ClutterStage         *stage);
+
+#endif /* __META_STAGE_CAPTURE_H__ */
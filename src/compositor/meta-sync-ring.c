@@ -41,24 +41,32 @@
 #include <meta/util.h>
 
 #include "cogl-utils.h"
+#include "meta-frame-timings.h"
 #include "meta-sync-ring.h"
 
 /* Theory of operation:
  *
- * We use a ring of NUM_SYNCS fence objects. On each frame we advance
+ * We use a ring of n_syncs fence objects. On each frame we advance
  * to the next fence in the ring. For each fence we do:
  *
  * 1. fence is XSyncTriggerFence()'d and glWaitSync()'d
- * 2. NUM_SYNCS / 2 frames later, fence should be triggered
- * 3. fence is XSyncResetFence()'d
- * 4. NUM_SYNCS / 2 frames later, fence should be reset
- * 5. go back to 1 and re-use fence
+ * 2. after every frame, the fences in flight are polled with a zero
+ *    timeout, and each one found triggered is XSyncResetFence()'d
+ * 3. the XAlarm tells us when the fence has been reset
+ * 4. n_syncs frames later, go back to 1 and re-use fence
  *
- * glClientWaitSync() and XAlarms are used in steps 2 and 4,
- * respectively, to double-check the expectections.
+ * We only block when we get back to a fence that has not made it
+ * through 2 and 3 yet, which is the last moment we can wait before
+ * the frame needs it. Every time that happens we grow the ring; and
+ * every ADAPT_INTERVAL frames the ring is resized to twice the number
+ * of frames the GPU was seen lagging behind, plus room for the reset,
+ * so a fast GPU doesn't keep more fences in flight than it needs.
  */
 
-#define NUM_SYNCS 10
+#define MIN_SYNCS 4
+#define DEFAULT_SYNCS 10
+#define MAX_SYNCS 16
+#define ADAPT_INTERVAL 120 /* frames */
 #define MAX_SYNC_WAIT_TIME (1 * 1000 * 1000 * 1000) /* one sec */
 #define MAX_REBOOT_ATTEMPTS 2
 
@@ -83,6 +91,7 @@ typedef struct
   XSyncValue next_counter_value;
 
   MetaSyncState state;
+  guint64 insert_frame;
 } MetaSync;
 
 typedef struct
@@ -93,10 +102,22 @@ typedef struct
 
   GHashTable *alarm_to_sync;
 
-  MetaSync *syncs_array[NUM_SYNCS];
+  MetaSync *syncs_array[MAX_SYNCS];
+  guint n_syncs;
+  guint target_syncs;
   guint current_sync_idx;
   MetaSync *current_sync;
-  guint warmup_syncs;
+
+  /* Frames since the ring was set up, and the largest number of frames
+   * a fence took to be triggered during the current ADAPT_INTERVAL */
+  guint64 frame;
+  guint adapt_frames;
+  guint max_latency;
+
+  /* Kept across reboots */
+  guint n_stalls;
+  gint64 total_stall_time;
+  gint64 max_stall_time;
 
   guint reboots;
 } MetaSyncRing;
@@ -488,7 +509,7 @@ meta_sync_ring_init (Display *xdisplay)
 
   ring->alarm_to_sync = g_hash_table_new (NULL, NULL);
 
-  for (i = 0; i < NUM_SYNCS; ++i)
+  for (i = 0; i < MAX_SYNCS; ++i)
     {
       MetaSync *sync = meta_sync_new (ring->xdisplay);
       ring->syncs_array[i] = sync;
@@ -498,12 +519,16 @@ meta_sync_ring_init (Display *xdisplay)
    * the one used for the GLX context, we need to XSync() here to
    * ensure glImportSync() succeeds. */
   XSync (xdisplay, False);
-  for (i = 0; i < NUM_SYNCS; ++i)
+  for (i = 0; i < MAX_SYNCS; ++i)
     meta_sync_import (ring->syncs_array[i]);
 
+  ring->n_syncs = DEFAULT_SYNCS;
+  ring->target_syncs = DEFAULT_SYNCS;
   ring->current_sync_idx = 0;
   ring->current_sync = ring->syncs_array[0];
-  ring->warmup_syncs = 0;
+  ring->frame = 0;
+  ring->adapt_frames = 0;
+  ring->max_latency = 0;
 
   return TRUE;
 }
@@ -521,9 +546,8 @@ meta_sync_ring_destroy (void)
 
   ring->current_sync_idx = 0;
   ring->current_sync = NULL;
-  ring->warmup_syncs = 0;
 
-  for (i = 0; i < NUM_SYNCS; ++i)
+  for (i = 0; i < MAX_SYNCS; ++i)
     meta_sync_free (ring->syncs_array[i]);
 
   g_hash_table_destroy (ring->alarm_to_sync);
@@ -554,43 +578,124 @@ meta_sync_ring_reboot (Display *xdisplay)
   return meta_sync_ring_init (xdisplay);
 }
 
+static void
+meta_sync_ring_note_latency (MetaSyncRing *ring,
+                             MetaSync     *sync)
+{
+  guint latency = ring->frame - sync->insert_frame;
+
+  if (latency > ring->max_latency)
+    ring->max_latency = latency;
+}
+
+/* Blocks until @sync can be inserted again. This is only needed when
+ * the GPU has fallen further behind than the ring is long, so the time
+ * spent here goes into the stall statistics and the ring is grown.
+ */
+static gboolean
+meta_sync_ring_wait_for_sync (MetaSyncRing *ring,
+                              MetaSync     *sync)
+{
+  gint64 start, stall_time;
+
+  start = g_get_monotonic_time ();
+
+  if (sync->state == META_SYNC_STATE_WAITING)
+    {
+      GLenum status = meta_sync_check_update_finished (sync, MAX_SYNC_WAIT_TIME);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+          meta_warning ("MetaSyncRing: Timed out waiting for sync object.\n");
+          return FALSE;
+        }
+
+      meta_sync_ring_note_latency (ring, sync);
+    }
+
+  if (sync->state == META_SYNC_STATE_DONE)
+    meta_sync_reset (sync);
+
+  if (sync->state == META_SYNC_STATE_RESET_PENDING)
+    {
+      XEvent event;
+      XIfEvent (sync->xdisplay, &event, alarm_event_predicate, (XPointer) sync);
+      meta_sync_handle_event (sync, (XSyncAlarmNotifyEvent *) &event);
+    }
+
+  stall_time = g_get_monotonic_time () - start;
+
+  ring->n_stalls += 1;
+  ring->total_stall_time += stall_time;
+  if (stall_time > ring->max_stall_time)
+    ring->max_stall_time = stall_time;
+
+  meta_frame_timings_add_sync_stall (stall_time);
+
+  ring->target_syncs = MIN (MAX (ring->target_syncs, ring->n_syncs + 2), MAX_SYNCS);
+
+  meta_verbose ("MetaSyncRing: stalled %" G_GINT64_FORMAT " us on a sync, "
+                "growing to %u syncs\n", stall_time, ring->target_syncs);
+
+  return TRUE;
+}
+
 gboolean
 meta_sync_ring_after_frame (void)
 {
   MetaSyncRing *ring = meta_sync_ring_get ();
+  guint i;
 
   if (!ring)
     return FALSE;
 
   g_return_val_if_fail (ring->xdisplay != NULL, FALSE);
 
-  if (ring->warmup_syncs >= NUM_SYNCS / 2)
+  /* Reset every fence the GPU is done with, without waiting for any */
+  for (i = 0; i < MAX_SYNCS; ++i)
     {
-      guint reset_sync_idx = (ring->current_sync_idx + NUM_SYNCS - (NUM_SYNCS / 2)) % NUM_SYNCS;
-      MetaSync *sync_to_reset = ring->syncs_array[reset_sync_idx];
+      MetaSync *sync = ring->syncs_array[i];
+      GLenum status;
+
+      if (sync->state != META_SYNC_STATE_WAITING)
+        continue;
 
-      GLenum status = meta_sync_check_update_finished (sync_to_reset, 0);
+      status = meta_sync_check_update_finished (sync, 0);
       if (status == GL_TIMEOUT_EXPIRED)
-        {
-          meta_warning ("MetaSyncRing: We should never wait for a sync -- add more syncs?\n");
-          status = meta_sync_check_update_finished (sync_to_reset, MAX_SYNC_WAIT_TIME);
-        }
+        continue;
 
       if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
         {
-          meta_warning ("MetaSyncRing: Timed out waiting for sync object.\n");
+          meta_warning ("MetaSyncRing: Failed to poll sync object.\n");
           return meta_sync_ring_reboot (ring->xdisplay);
         }
 
-      meta_sync_reset (sync_to_reset);
+      meta_sync_ring_note_latency (ring, sync);
+      meta_sync_reset (sync);
     }
-  else
+
+  ring->frame += 1;
+
+  ring->adapt_frames += 1;
+  if (ring->adapt_frames >= ADAPT_INTERVAL)
     {
-      ring->warmup_syncs += 1;
+      ring->target_syncs = CLAMP (2 * ring->max_latency + 2, MIN_SYNCS, MAX_SYNCS);
+      ring->adapt_frames = 0;
+      ring->max_latency = 0;
     }
 
+  /* The ring is only resized when we wrap around; growing it just
+   * means carrying on into the spare syncs instead of wrapping. Syncs
+   * left out by shrinking it are still polled above until they are
+   * ready again.
+   */
   ring->current_sync_idx += 1;
-  ring->current_sync_idx %= NUM_SYNCS;
+  if (ring->current_sync_idx >= ring->n_syncs)
+    {
+      if (ring->target_syncs <= ring->n_syncs)
+        ring->current_sync_idx = 0;
+
+      ring->n_syncs = ring->target_syncs;
+    }
 
   ring->current_sync = ring->syncs_array[ring->current_sync_idx];
 
@@ -607,18 +712,45 @@ meta_sync_ring_insert_wait (void)
 
   g_return_val_if_fail (ring->xdisplay != NULL, FALSE);
 
-  if (ring->current_sync->state != META_SYNC_STATE_READY)
+  if (ring->current_sync->state != META_SYNC_STATE_READY &&
+      !meta_sync_ring_wait_for_sync (ring, ring->current_sync))
     {
-      meta_warning ("MetaSyncRing: Sync object is not ready -- were events handled properly?\n");
       if (!meta_sync_ring_reboot (ring->xdisplay))
         return FALSE;
     }
 
+  ring->current_sync->insert_frame = ring->frame;
   meta_sync_insert (ring->current_sync);
 
   return TRUE;
 }
 
+/**
+ * meta_sync_ring_get_stats:
+ * @stats: (out): location to store the statistics
+ *
+ * Retrieves how the sync ring is doing: its current size and how
+ * often and for how long the compositor had to block on the GPU
+ * because a fence came round again before it was triggered.
+ *
+ * Return value: %FALSE if the sync ring isn't in use
+ */
+gboolean
+meta_sync_ring_get_stats (MetaSyncRingStats *stats)
+{
+  MetaSyncRing *ring = meta_sync_ring_get ();
+
+  if (!ring || ring->xdisplay == NULL)
+    return FALSE;
+
+  stats->n_syncs = ring->n_syncs;
+  stats->n_stalls = ring->n_stalls;
+  stats->total_stall_time = ring->total_stall_time;
+  stats->max_stall_time = ring->max_stall_time;
+
+  return TRUE;
+}
+
 void
 meta_sync_ring_handle_event (XEvent *xevent)
 {
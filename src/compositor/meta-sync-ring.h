@@ -5,10 +5,19 @@
 
 #include <X11/Xlib.h>
 
+typedef struct
+{
+  guint  n_syncs;          /* current size of the ring */
+  guint  n_stalls;         /* times we blocked on a sync */
+  gint64 total_stall_time; /* in microseconds */
+  gint64 max_stall_time;   /* in microseconds */
+} MetaSyncRingStats;
+
 gboolean meta_sync_ring_init (Display *dpy);
 void meta_sync_ring_destroy (void);
 gboolean meta_sync_ring_after_frame (void);
 gboolean meta_sync_ring_insert_wait (void);
 void meta_sync_ring_handle_event (XEvent *event);
+gboolean meta_sync_ring_get_stats (MetaSyncRingStats *stats);
 
 #endif  /* _META_SYNC_RING_H_ */
@@ -39,6 +39,20 @@
 
 #define MAX_TEXTURE_LEVELS 12
 
+/* Levels smaller than this are too blurry to stand in for the window */
+#define MIN_PLACEHOLDER_SIZE 64
+
+/* How many destination pixels all towers together may redraw in one
+ * frame when revalidating levels; see meta_texture_tower_set_frame_budget() */
+#define DEFAULT_FRAME_BUDGET (1024 * 1024)
+
+static int frame_budget = DEFAULT_FRAME_BUDGET;
+static int frame_budget_remaining = DEFAULT_FRAME_BUDGET;
+
+/* Whether scaled down versions come from a mipmapped copy of the base
+ * texture; see meta_texture_tower_set_driver_mipmaps() */
+static gboolean driver_mipmaps = FALSE;
+
 /* If the texture format in memory doesn't match this, then Mesa
  * will do the conversion, so things will still work, but it might
  * be slow depending on how efficient Mesa is. These should be the
@@ -66,8 +80,28 @@ struct _MetaTextureTower
   int n_levels;
   CoglTexture *textures[MAX_TEXTURE_LEVELS];
   CoglOffscreen *fbos[MAX_TEXTURE_LEVELS];
+  /* Pipelines drawing each level from the one above it, made once per
+   * base texture */
+  CoglPipeline *pipelines[MAX_TEXTURE_LEVELS];
   Box invalid[MAX_TEXTURE_LEVELS];
+  /* Whether the level has been completely drawn at least once, so that
+   * it can be painted while stale */
+  gboolean populated[MAX_TEXTURE_LEVELS];
   CoglPipeline *pipeline_template;
+
+  /* With driver mipmaps, a copy of the base texture that the GL driver
+   * generates the mipmap levels of, and the area of the base texture
+   * not yet copied into it */
+  CoglTexture *mipmap_texture;
+  CoglOffscreen *mipmap_fbo;
+  CoglPipeline *mipmap_pipeline;
+  Box mipmap_invalid;
+  gboolean mipmap_populated;
+
+  guint stale : 1;
+  /* Set when the mipmapped copy can't be created for this base
+   * texture, so that we don't try again every frame */
+  guint mipmap_failed : 1;
 };
 
 /**
@@ -143,8 +177,37 @@ meta_texture_tower_set_base_texture (MetaTextureTower *tower,
               cogl_object_unref (tower->fbos[i]);
               tower->fbos[i] = NULL;
             }
+
+          if (tower->pipelines[i] != NULL)
+            {
+              cogl_object_unref (tower->pipelines[i]);
+              tower->pipelines[i] = NULL;
+            }
+
+          tower->populated[i] = FALSE;
+        }
+
+      if (tower->mipmap_texture != NULL)
+        {
+          cogl_object_unref (tower->mipmap_texture);
+          tower->mipmap_texture = NULL;
         }
 
+      if (tower->mipmap_fbo != NULL)
+        {
+          cogl_object_unref (tower->mipmap_fbo);
+          tower->mipmap_fbo = NULL;
+        }
+
+      if (tower->mipmap_pipeline != NULL)
+        {
+          cogl_object_unref (tower->mipmap_pipeline);
+          tower->mipmap_pipeline = NULL;
+        }
+
+      tower->mipmap_populated = FALSE;
+      tower->mipmap_failed = FALSE;
+
       cogl_object_unref (tower->textures[0]);
     }
 
@@ -206,6 +269,22 @@ meta_texture_tower_update_area (MetaTextureTower *tower,
   invalid.x2 = x + width;
   invalid.y2 = y + height;
 
+  if (tower->mipmap_invalid.x1 == tower->mipmap_invalid.x2 ||
+      tower->mipmap_invalid.y1 == tower->mipmap_invalid.y2)
+    {
+      tower->mipmap_invalid = invalid;
+    }
+  else
+    {
+      tower->mipmap_invalid.x1 = MIN (tower->mipmap_invalid.x1, invalid.x1);
+      tower->mipmap_invalid.y1 = MIN (tower->mipmap_invalid.y1, invalid.y1);
+      tower->mipmap_invalid.x2 = MAX (tower->mipmap_invalid.x2, invalid.x2);
+      tower->mipmap_invalid.y2 = MAX (tower->mipmap_invalid.y2, invalid.y2);
+    }
+
+  tower->mipmap_invalid.x2 = MIN (tower->mipmap_invalid.x2, texture_width);
+  tower->mipmap_invalid.y2 = MIN (tower->mipmap_invalid.y2, texture_height);
+
   for (i = 1; i < tower->n_levels; i++)
     {
       texture_width = MAX (1, texture_width / 2);
@@ -378,12 +457,26 @@ texture_tower_create_texture (MetaTextureTower *tower,
                                                            TEXTURE_FORMAT);
     }
 
+  cogl_texture_set_memory_category (tower->textures[level], "texture tower");
+
   tower->invalid[level].x1 = 0;
   tower->invalid[level].y1 = 0;
   tower->invalid[level].x2 = width;
   tower->invalid[level].y2 = height;
 }
 
+static CoglPipeline *
+texture_tower_get_pipeline_template (MetaTextureTower *tower)
+{
+  if (!tower->pipeline_template)
+    {
+      tower->pipeline_template = cogl_pipeline_new (meta_compositor_get_cogl_context ());
+      cogl_pipeline_set_blend (tower->pipeline_template, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+    }
+
+  return tower->pipeline_template;
+}
+
 static void
 texture_tower_revalidate (MetaTextureTower *tower,
                               int               level)
@@ -397,7 +490,6 @@ texture_tower_revalidate (MetaTextureTower *tower,
   Box *invalid = &tower->invalid[level];
   CoglFramebuffer *fb;
   CoglError *catch_error = NULL;
-  CoglPipeline *pipeline;
 
   if (tower->fbos[level] == NULL)
     tower->fbos[level] = cogl_offscreen_new_with_texture (dest_texture);
@@ -412,16 +504,15 @@ texture_tower_revalidate (MetaTextureTower *tower,
 
   cogl_framebuffer_orthographic (fb, 0, 0, dest_texture_width, dest_texture_height, -1., 1.);
 
-  if (!tower->pipeline_template)
+  if (tower->pipelines[level] == NULL)
     {
-      tower->pipeline_template = cogl_pipeline_new (meta_compositor_get_cogl_context ());
-      cogl_pipeline_set_blend (tower->pipeline_template, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+      tower->pipelines[level] =
+        cogl_pipeline_copy (texture_tower_get_pipeline_template (tower));
+      cogl_pipeline_set_layer_texture (tower->pipelines[level], 0,
+                                       source_texture);
     }
 
-  pipeline = cogl_pipeline_copy (tower->pipeline_template);
-  cogl_pipeline_set_layer_texture (pipeline, 0, tower->textures[level - 1]);
-
-  cogl_framebuffer_draw_textured_rectangle (fb, pipeline,
+  cogl_framebuffer_draw_textured_rectangle (fb, tower->pipelines[level],
                                             invalid->x1, invalid->y1,
                                             invalid->x2, invalid->y2,
                                             (2. * invalid->x1) / source_texture_width,
@@ -429,10 +520,139 @@ texture_tower_revalidate (MetaTextureTower *tower,
                                             (2. * invalid->x2) / source_texture_width,
                                             (2. * invalid->y2) / source_texture_height);
 
-  cogl_object_unref (pipeline);
-
   tower->invalid[level].x1 = tower->invalid[level].x2 = 0;
   tower->invalid[level].y1 = tower->invalid[level].y2 = 0;
+  tower->populated[level] = TRUE;
+}
+
+static gboolean
+level_is_invalid (MetaTextureTower *tower,
+                  int               level)
+{
+  return (tower->invalid[level].x2 != tower->invalid[level].x1 &&
+          tower->invalid[level].y2 != tower->invalid[level].y1);
+}
+
+static gboolean
+texture_tower_ensure_mipmap_texture (MetaTextureTower *tower)
+{
+  CoglContext *ctx = meta_compositor_get_cogl_context ();
+  int width = cogl_texture_get_width (tower->textures[0]);
+  int height = cogl_texture_get_height (tower->textures[0]);
+  CoglTexture *texture;
+  CoglOffscreen *fbo;
+  CoglError *catch_error = NULL;
+
+  if (tower->mipmap_texture != NULL)
+    return TRUE;
+
+  if (tower->mipmap_failed)
+    return FALSE;
+
+  if ((!is_power_of_two (width) || !is_power_of_two (height)) &&
+      !cogl_has_feature (ctx, COGL_FEATURE_ID_TEXTURE_NPOT_MIPMAP))
+    {
+      tower->mipmap_failed = TRUE;
+      return FALSE;
+    }
+
+  texture = COGL_TEXTURE (cogl_texture_2d_new_with_size (ctx, width, height));
+  cogl_texture_set_memory_category (texture, "texture tower");
+  fbo = cogl_offscreen_new_with_texture (texture);
+
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (fbo), &catch_error))
+    {
+      cogl_error_free (catch_error);
+      cogl_object_unref (fbo);
+      cogl_object_unref (texture);
+      tower->mipmap_failed = TRUE;
+      return FALSE;
+    }
+
+  cogl_framebuffer_orthographic (COGL_FRAMEBUFFER (fbo),
+                                 0, 0, width, height, -1., 1.);
+
+  tower->mipmap_texture = texture;
+  tower->mipmap_fbo = fbo;
+
+  tower->mipmap_pipeline =
+    cogl_pipeline_copy (texture_tower_get_pipeline_template (tower));
+  cogl_pipeline_set_layer_texture (tower->mipmap_pipeline, 0,
+                                   tower->textures[0]);
+  cogl_pipeline_set_layer_filters (tower->mipmap_pipeline, 0,
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+
+  tower->mipmap_invalid.x1 = 0;
+  tower->mipmap_invalid.y1 = 0;
+  tower->mipmap_invalid.x2 = width;
+  tower->mipmap_invalid.y2 = height;
+
+  return TRUE;
+}
+
+/* Copies the changed part of the base texture into the mipmapped copy.
+ * Drawing into the copy marks its mipmaps as dirty, and Cogl has the
+ * driver regenerate all levels with glGenerateMipmap() the next time
+ * it is sampled with a mipmap filter. */
+static void
+texture_tower_revalidate_mipmap_texture (MetaTextureTower *tower)
+{
+  Box *invalid = &tower->mipmap_invalid;
+  int width = cogl_texture_get_width (tower->textures[0]);
+  int height = cogl_texture_get_height (tower->textures[0]);
+
+  cogl_framebuffer_draw_textured_rectangle (COGL_FRAMEBUFFER (tower->mipmap_fbo),
+                                            tower->mipmap_pipeline,
+                                            invalid->x1, invalid->y1,
+                                            invalid->x2, invalid->y2,
+                                            (float) invalid->x1 / width,
+                                            (float) invalid->y1 / height,
+                                            (float) invalid->x2 / width,
+                                            (float) invalid->y2 / height);
+
+  invalid->x1 = invalid->x2 = 0;
+  invalid->y1 = invalid->y2 = 0;
+  tower->mipmap_populated = TRUE;
+}
+
+/* The driver mipmap path of meta_texture_tower_get_paint_texture();
+ * returns NULL to fall back to drawing the levels ourselves */
+static CoglTexture *
+texture_tower_get_mipmap_paint_texture (MetaTextureTower *tower)
+{
+  Box *invalid = &tower->mipmap_invalid;
+  int cost;
+
+  if (!texture_tower_ensure_mipmap_texture (tower))
+    return NULL;
+
+  if (invalid->x1 == invalid->x2 || invalid->y1 == invalid->y2)
+    return tower->mipmap_texture;
+
+  /* The copy is made at full size, and regenerating the mipmaps costs
+   * about a third of that again */
+  cost = (invalid->x2 - invalid->x1) * (invalid->y2 - invalid->y1);
+  cost += cost / 3;
+
+  if (frame_budget > 0 &&
+      cost > frame_budget_remaining &&
+      frame_budget_remaining < frame_budget)
+    {
+      tower->stale = TRUE;
+
+      if (tower->mipmap_populated)
+        return tower->mipmap_texture;
+      else
+        return tower->textures[0];
+    }
+
+  texture_tower_revalidate_mipmap_texture (tower);
+
+  if (frame_budget > 0)
+    frame_budget_remaining = MAX (0, frame_budget_remaining - cost);
+
+  return tower->mipmap_texture;
 }
 
 /**
@@ -445,6 +665,13 @@ texture_tower_revalidate (MetaTextureTower *tower,
  * size in pixels, so a 200x200 texture will be rendered on the
  * rectangle (0, 0, 200, 200).
  *
+ * Bringing scaled down levels up to date is limited by a budget
+ * shared between all towers for each frame. When the budget runs
+ * out, the last complete but out-of-date version of the level is
+ * returned, or a larger level if there is none, and
+ * meta_texture_tower_is_stale() returns %TRUE until a later call
+ * finishes the work.
+ *
  * Return value: the COGL texture handle to use for painting, or
  *  %NULL if no base texture has yet been set.
  */
@@ -453,9 +680,12 @@ meta_texture_tower_get_paint_texture (MetaTextureTower *tower)
 {
   int texture_width, texture_height;
   int level;
+  int i;
 
   g_return_val_if_fail (tower != NULL, NULL);
 
+  tower->stale = FALSE;
+
   if (tower->textures[0] == NULL)
     return NULL;
 
@@ -467,29 +697,202 @@ meta_texture_tower_get_paint_texture (MetaTextureTower *tower)
     return NULL;
   level = MIN (level, tower->n_levels - 1);
 
-  if (tower->textures[level] == NULL ||
-      (tower->invalid[level].x2 != tower->invalid[level].x1 &&
-       tower->invalid[level].y2 != tower->invalid[level].y1))
+  if (driver_mipmaps && level > 0)
+    {
+      CoglTexture *texture = texture_tower_get_mipmap_paint_texture (tower);
+
+      if (texture != NULL)
+        return texture;
+    }
+
+  if (tower->textures[level] != NULL && !level_is_invalid (tower, level))
+    return tower->textures[level];
+
+  for (i = 1; i <= level; i++)
+    {
+      /* Use "floor" convention here to be consistent with the NPOT texture extension */
+      texture_width = MAX (1, texture_width / 2);
+      texture_height = MAX (1, texture_height / 2);
+
+      if (tower->textures[i] == NULL)
+        texture_tower_create_texture (tower, i, texture_width, texture_height);
+    }
+
+  /* Each level is computed from the one below it, so levels are brought
+   * up to date in order; levels above the one painted are left alone
+   * until something paints at that scale. */
+  for (i = 1; i <= level; i++)
     {
-      int i;
-
-      for (i = 1; i <= level; i++)
-       {
-         /* Use "floor" convention here to be consistent with the NPOT texture extension */
-         texture_width = MAX (1, texture_width / 2);
-         texture_height = MAX (1, texture_height / 2);
-
-         if (tower->textures[i] == NULL)
-           texture_tower_create_texture (tower, i, texture_width, texture_height);
-       }
-
-      for (i = 1; i <= level; i++)
-       {
-         if (tower->invalid[level].x2 != tower->invalid[level].x1 &&
-             tower->invalid[level].y2 != tower->invalid[level].y1)
-           texture_tower_revalidate (tower, i);
-       }
-   }
+      Box *invalid = &tower->invalid[i];
+      int cost;
+
+      if (!level_is_invalid (tower, i))
+        continue;
+
+      cost = (invalid->x2 - invalid->x1) * (invalid->y2 - invalid->y1);
+
+      /* Always allow the first revalidation of a frame so that even
+       * a single very large window makes progress */
+      if (frame_budget > 0 &&
+          cost > frame_budget_remaining &&
+          frame_budget_remaining < frame_budget)
+        {
+          tower->stale = TRUE;
+
+          if (tower->populated[level])
+            return tower->textures[level];
+          else
+            return tower->textures[i - 1];
+        }
+
+      texture_tower_revalidate (tower, i);
+
+      if (frame_budget > 0)
+        frame_budget_remaining = MAX (0, frame_budget_remaining - cost);
+    }
 
   return tower->textures[level];
 }
+
+/**
+ * meta_texture_tower_is_stale:
+ * @tower: a #MetaTextureTower
+ *
+ * Return value: %TRUE if the texture last returned by
+ *  meta_texture_tower_get_paint_texture() was not up to date, and
+ *  the caller should paint again in a later frame.
+ */
+LOCAL_SYMBOL gboolean
+meta_texture_tower_is_stale (MetaTextureTower *tower)
+{
+  g_return_val_if_fail (tower != NULL, FALSE);
+
+  return tower->stale;
+}
+
+/**
+ * meta_texture_tower_get_memory_size:
+ * @tower: a #MetaTextureTower
+ *
+ * Return value: the number of bytes of texture memory taken by the
+ *  scaled down levels of @tower, not counting the base texture
+ */
+LOCAL_SYMBOL gsize
+meta_texture_tower_get_memory_size (MetaTextureTower *tower)
+{
+  gsize size = 0;
+  int i;
+
+  g_return_val_if_fail (tower != NULL, 0);
+
+  for (i = 1; i < tower->n_levels; i++)
+    if (tower->textures[i] != NULL)
+      size += (gsize) cogl_texture_get_width (tower->textures[i]) *
+              cogl_texture_get_height (tower->textures[i]) * 4;
+
+  /* The mipmap levels add about a third to the copy */
+  if (tower->mipmap_texture != NULL)
+    size += (gsize) cogl_texture_get_width (tower->mipmap_texture) *
+            cogl_texture_get_height (tower->mipmap_texture) * 4 * 4 / 3;
+
+  return size;
+}
+
+/**
+ * meta_texture_tower_ref_placeholder:
+ * @tower: a #MetaTextureTower
+ *
+ * Finds a small version of the base texture that can stand in for it
+ * while the base texture isn't available: the smallest level that has
+ * been drawn (even if it is out of date by now) and is still at least
+ * MIN_PLACEHOLDER_SIZE pixels across.
+ * Levels 0 and 1 are never used, as they would save little memory.
+ *
+ * Return value: (transfer full): a texture, or %NULL if no suitable
+ *  level has been drawn
+ */
+LOCAL_SYMBOL CoglTexture *
+meta_texture_tower_ref_placeholder (MetaTextureTower *tower)
+{
+  int i;
+
+  g_return_val_if_fail (tower != NULL, NULL);
+
+  for (i = tower->n_levels - 1; i >= 2; i--)
+    {
+      CoglTexture *texture = tower->textures[i];
+
+      if (texture == NULL || !tower->populated[i])
+        continue;
+
+      if (MAX (cogl_texture_get_width (texture),
+               cogl_texture_get_height (texture)) < MIN_PLACEHOLDER_SIZE)
+        continue;
+
+      return cogl_object_ref (texture);
+    }
+
+  return NULL;
+}
+
+/**
+ * meta_texture_tower_set_frame_budget:
+ * @budget: number of pixels, or 0 for no limit
+ *
+ * Sets how many pixels of scaled down levels all towers together
+ * may redraw in one frame. Work beyond that is spread over following
+ * frames.
+ */
+LOCAL_SYMBOL void
+meta_texture_tower_set_frame_budget (int budget)
+{
+  frame_budget = MAX (0, budget);
+  frame_budget_remaining = frame_budget;
+}
+
+/**
+ * meta_texture_tower_set_driver_mipmaps:
+ * @enabled: whether to let the GL driver generate the mipmaps
+ *
+ * Chooses how scaled down versions of the base textures are made. By
+ * default each level is drawn from the one below it. When enabled,
+ * the base texture is instead copied once into a texture the driver
+ * generates mipmaps for; this is used wherever the driver can mipmap
+ * a texture of that size, and the levels are drawn as before
+ * otherwise. Textures returned this way must be painted with a
+ * mipmap minification filter; see meta_texture_tower_is_mipmapped().
+ */
+LOCAL_SYMBOL void
+meta_texture_tower_set_driver_mipmaps (gboolean enabled)
+{
+  driver_mipmaps = enabled;
+}
+
+/**
+ * meta_texture_tower_is_mipmapped:
+ * @tower: a #MetaTextureTower
+ * @texture: a texture returned by meta_texture_tower_get_paint_texture()
+ *
+ * Return value: %TRUE if @texture has driver generated mipmaps and
+ *  should be painted with %COGL_PIPELINE_FILTER_LINEAR_MIPMAP_LINEAR
+ */
+LOCAL_SYMBOL gboolean
+meta_texture_tower_is_mipmapped (MetaTextureTower *tower,
+                                 CoglTexture      *texture)
+{
+  g_return_val_if_fail (tower != NULL, FALSE);
+
+  return texture != NULL && texture == tower->mipmap_texture;
+}
+
+/**
+ * meta_texture_tower_begin_frame:
+ *
+ * Resets the per-frame revalidation budget. Called from the compositor
+ * before each stage paint.
+ */
+LOCAL_SYMBOL void
+meta_texture_tower_begin_frame (void)
+{
+  frame_budget_remaining = frame_budget;
+}
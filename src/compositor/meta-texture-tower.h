@@ -63,6 +63,15 @@ void              meta_texture_tower_update_area       (MetaTextureTower *tower,
                                                         int               width,
                                                         int               height);
 CoglTexture     *meta_texture_tower_get_paint_texture (MetaTextureTower *tower);
+gboolean          meta_texture_tower_is_stale          (MetaTextureTower *tower);
+gsize             meta_texture_tower_get_memory_size   (MetaTextureTower *tower);
+CoglTexture      *meta_texture_tower_ref_placeholder   (MetaTextureTower *tower);
+gboolean          meta_texture_tower_is_mipmapped      (MetaTextureTower *tower,
+                                                        CoglTexture      *texture);
+
+void              meta_texture_tower_set_frame_budget  (int               budget);
+void              meta_texture_tower_set_driver_mipmaps (gboolean         enabled);
+void              meta_texture_tower_begin_frame       (void);
 
 G_BEGIN_DECLS
 
@@ -34,12 +34,59 @@ void meta_window_actor_process_damage (MetaWindowActor    *self,
 
 void meta_window_actor_pre_paint      (MetaWindowActor    *self);
 void meta_window_actor_post_paint     (MetaWindowActor    *self);
+gint64 meta_window_actor_dispatch_frame_messages (MetaWindowActor *self,
+                                                  gint64           now);
 
 void meta_window_actor_invalidate_shadow (MetaWindowActor *self);
 
 void meta_window_actor_set_redirected (MetaWindowActor *self, gboolean state);
 
-gboolean meta_window_actor_should_unredirect (MetaWindowActor *self);
+MetaWindowActorStats *meta_window_actor_get_stats (MetaWindowActor *self);
+
+gsize    meta_window_actor_get_texture_memory   (MetaWindowActor *self);
+void     meta_window_actor_update_create_mipmaps (MetaWindowActor *self);
+gint64   meta_window_actor_get_last_shown_time  (MetaWindowActor *self);
+gboolean meta_window_actor_can_evict_texture    (MetaWindowActor *self);
+void     meta_window_actor_evict_texture        (MetaWindowActor *self);
+void     meta_window_actor_reload_textures      (MetaWindowActor *self);
+
+/**
+ * MetaUnredirectBlocker:
+ * @META_UNREDIRECT_ALLOWED: the window can be unredirected
+ * @META_UNREDIRECT_BLOCKED_DESTROYED: the window is being destroyed
+ * @META_UNREDIRECT_BLOCKED_REQUESTED: the client asked to stay composited
+ * @META_UNREDIRECT_BLOCKED_TRANSLUCENT: the window isn't fully opaque
+ * @META_UNREDIRECT_BLOCKED_SHAPED: the window has a bounding shape
+ * @META_UNREDIRECT_BLOCKED_ARGB: the window has an alpha channel
+ * @META_UNREDIRECT_BLOCKED_NOT_MONITOR_SIZED: the window doesn't cover a monitor
+ * @META_UNREDIRECT_BLOCKED_PARTIAL_DAMAGE: the window doesn't redraw all of itself
+ * @META_UNREDIRECT_BLOCKED_PREFERENCE: unredirecting fullscreen windows is turned off
+ * @META_UNREDIRECT_BLOCKED_OBSCURED: another window is stacked over part of it
+ * @META_UNREDIRECT_BLOCKED_DISABLED: unredirection is disabled for the screen
+ * @META_UNREDIRECT_BLOCKED_SETTLING: the window was composited again too
+ *   recently
+ *
+ * Why a window is, or isn't, unredirected.
+ */
+typedef enum {
+  META_UNREDIRECT_ALLOWED,
+  META_UNREDIRECT_BLOCKED_DESTROYED,
+  META_UNREDIRECT_BLOCKED_REQUESTED,
+  META_UNREDIRECT_BLOCKED_TRANSLUCENT,
+  META_UNREDIRECT_BLOCKED_SHAPED,
+  META_UNREDIRECT_BLOCKED_ARGB,
+  META_UNREDIRECT_BLOCKED_NOT_MONITOR_SIZED,
+  META_UNREDIRECT_BLOCKED_PARTIAL_DAMAGE,
+  META_UNREDIRECT_BLOCKED_PREFERENCE,
+  META_UNREDIRECT_BLOCKED_OBSCURED,
+  META_UNREDIRECT_BLOCKED_DISABLED,
+  META_UNREDIRECT_BLOCKED_SETTLING
+} MetaUnredirectBlocker;
+
+MetaUnredirectBlocker meta_window_actor_get_unredirect_blocker  (MetaWindowActor       *self);
+void                  meta_window_actor_note_unredirect_blocker (MetaWindowActor       *self,
+                                                                 MetaUnredirectBlocker  blocker);
+gboolean              meta_window_actor_unredirect_settled      (MetaWindowActor       *self);
 
 void meta_window_actor_get_shape_bounds (MetaWindowActor       *self,
                                           cairo_rectangle_int_t *bounds);
@@ -67,6 +114,7 @@ void meta_window_actor_reset_visible_regions      (MetaWindowActor *self);
 
 void meta_window_actor_set_unobscured_region      (MetaWindowActor *self,
                                                    cairo_region_t  *unobscured_region);
+void meta_window_actor_update_occlusion          (MetaWindowActor *self);
 
 void meta_window_actor_effect_completed (MetaWindowActor *actor,
                                          gulong           event);
@@ -9,11 +9,16 @@
 #include <config.h>
 
 #include <math.h>
+#include <string.h>
 
 #include <X11/extensions/shape.h>
 #include <X11/extensions/Xcomposite.h>
 #include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
 #include <X11/extensions/Xrender.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/shape.h>
 
 #include <clutter/x11/clutter-x11.h>
 #include <cogl/winsys/cogl-texture-pixmap-x11.h>
@@ -30,6 +35,7 @@
 #include "meta-shaped-texture-private.h"
 #include "meta-shadow-factory-private.h"
 #include "meta-window-actor-private.h"
+#include "meta-frame-timings.h"
 
 enum {
   POSITION_CHANGED,
@@ -39,6 +45,19 @@ enum {
 
 static guint signals[LAST_SIGNAL] = {0};
 
+/* What a window cost the compositor over a stats period, see
+ * meta_window_actor_get_stats(); times are in microseconds */
+typedef struct
+{
+  guint  damage_events;
+  gint64 damage_pixels;
+  gint64 upload_bytes;
+  gint64 paint_time;
+  guint  shadow_updates;
+  guint  mask_updates;
+  guint  sync_waits;
+  gint64 sync_wait_time;
+} MetaWindowActorCounters;
 
 struct _MetaWindowActorPrivate
 {
@@ -70,8 +89,13 @@ struct _MetaWindowActorPrivate
 
   /* If the window is shaped, a region that matches the shape */
   cairo_region_t   *shape_region;
-  /* The opaque region, from _NET_WM_OPAQUE_REGION, intersected with
-   * the shape region. */
+  /* The bounding shape the client set, in client coordinates, as last
+   * fetched; and the request for it made on the latest ShapeNotify,
+   * see request_client_shape() */
+  cairo_region_t   *client_shape;
+  xcb_shape_get_rectangles_cookie_t client_shape_cookie;
+  /* The opaque region, from _NET_WM_OPAQUE_REGION or detected_opaque,
+   * intersected with the shape region. */
   cairo_region_t   *opaque_region;
   /* The region we should clip to when painting the shadow */
   cairo_region_t   *shadow_clip;
@@ -79,6 +103,14 @@ struct _MetaWindowActorPrivate
    /* The region that is visible, used to optimize out redraws */
   cairo_region_t   *unobscured_region;
 
+  /* Damage received since the last repaint, in window coordinates;
+   * flushed to the texture once per frame from pre_paint */
+  cairo_region_t   *pending_damage;
+
+  /* With report_damage_regions, the XFixes region the damage is
+   * subtracted into so we can fetch the exact rectangles */
+  XserverRegion     damage_region;
+
   /* Extracted size-invariant shape used for shadows */
   MetaWindowShape  *shadow_shape;
 
@@ -114,18 +146,23 @@ struct _MetaWindowActorPrivate
   guint		    needs_damage_all       : 1;
   guint		    received_damage        : 1;
   guint             repaint_scheduled      : 1;
+  guint             report_damage_regions  : 1;
 
   /* If set, the client needs to be sent a _NET_WM_FRAME_DRAWN
    * client message using the most recent frame in ->frames */
-  guint             send_frame_messages_timer;
   gint64            frame_drawn_time;
   guint             needs_frame_drawn      : 1;
 
+  /* When obscured, the monotonic time by which the compositor's shared
+   * timer sends our frame messages, see queue_send_frame_messages_timeout() */
+  gint64            frame_messages_deadline;
+
   guint             size_changed_id;
   guint             opacity_changed_id;
 
   guint		    needs_pixmap           : 1;
   guint             needs_reshape          : 1;
+  guint             client_shape_pending   : 1;
   guint             recompute_focused_shadow   : 1;
   guint             recompute_unfocused_shadow : 1;
   guint             size_changed               : 1;
@@ -137,6 +174,14 @@ struct _MetaWindowActorPrivate
   guint             no_shadow              : 1;
 
   guint             unredirected           : 1;
+  /* The last MetaUnredirectBlocker we logged, see
+   * meta_window_actor_note_unredirect_blocker() */
+  guint             unredirect_blocker     : 4;
+  /* Set when the window is redirected, so its new pixmap is bound in
+   * the same frame whatever the pixmap bind budget */
+  guint             bind_on_redirect       : 1;
+  /* When the window last became unredirectable (but for settling) */
+  gint64            unredirectable_time;
 
   /* This is used to detect fullscreen windows that need to be unredirected */
   guint             full_damage_frames_count;
@@ -144,8 +189,47 @@ struct _MetaWindowActorPrivate
 
   guint             has_desat_effect : 1;
 
+  /* Set when the texture was dropped to stay within the compositor's
+   * texture budget; texture_wanted when something painted us since,
+   * so the texture has to be bound again even though we're hidden */
+  guint             texture_evicted : 1;
+  guint             texture_wanted  : 1;
+  guint             rebind_idle_id;
+  /* Repairs the damage dropped while on an inactive workspace once
+   * something, most likely a clone, paints us; see updates_suspended() */
+  guint             resume_damage_id;
+  gint64            last_shown_time;
+
+  /* Set when sampling the pixmap of an ARGB window found its client
+   * area fully opaque; see detect_opaque_contents() */
+  guint             detected_opaque : 1;
+  guint             detect_opaque_id;
+
+  /* Whether the client was told that none of the window can be seen;
+   * occlusion_id runs while it's obscured but not published yet, see
+   * meta_window_actor_update_occlusion() */
+  guint             occluded : 1;
+  guint             occlusion_id;
+
   guint             reshapes;
   guint             should_have_shadow : 1;
+
+  /* The counters of the period being accumulated and of the last
+   * complete one, and when that started and how long it lasted */
+  MetaWindowActorCounters counters;
+  MetaWindowActorCounters last_counters;
+  gint64            counters_start;
+  gint64            last_counters_period;
+  /* When the frame-sync wait in progress, if any, started */
+  gint64            sync_wait_start;
+
+  /* Our links in the compositor's queues of the windows with pre-paint
+   * work pending and of those still owing frame timings; see
+   * queue_pre_paint() */
+  GList             pre_paint_link;
+  GList             frames_link;
+  guint             pre_paint_queued : 1;
+  guint             frames_queued : 1;
 };
 
 typedef struct _FrameData FrameData;
@@ -171,6 +255,41 @@ enum
 #define DEFAULT_SHADOW_X_OFFSET 0
 #define DEFAULT_SHADOW_Y_OFFSET 8
 
+/* Above this many rectangles, pending damage is repaired as a single
+ * rectangle covering its extents */
+#define MAX_PENDING_DAMAGE_RECTS 16
+
+/* How long a hidden window must go unpainted before its texture may be
+ * evicted, so windows shown through clones aren't rebound every frame */
+#define MIN_EVICTION_AGE (G_USEC_PER_SEC)
+
+/* How long, in milliseconds, the pixmap of an ARGB window must stay
+ * the same size before we sample its alpha; this keeps the round trips
+ * out of interactive resizes and gives the client time to draw */
+#define OPAQUE_DETECTION_DELAY 250
+
+/* How long the periods the per-window stats are averaged over last */
+#define STATS_PERIOD (G_USEC_PER_SEC)
+
+/* How long, in milliseconds, a window has to stay completely obscured
+ * before the client is told, so windows that are only briefly covered,
+ * by a menu or while other windows move over them, aren't told every
+ * time that changes */
+#define OCCLUSION_DELAY 500
+
+/* How many refresh intervals the frame messages to the client of an
+ * obscured window, and of one the client was told is occluded, are
+ * held back for; this is what slows down clients that draw in step
+ * with the _NET_WM_FRAME_DRAWN messages */
+#define OBSCURED_FRAME_INTERVAL 6
+#define OCCLUDED_FRAME_INTERVAL 60
+
+/* How long, in microseconds, a fullscreen window has to be
+ * unredirectable before it is unredirected; a video player whose
+ * controls pop up every few seconds then stays composited instead of
+ * switching back and forth */
+#define UNREDIRECT_SETTLE_TIME (G_USEC_PER_SEC)
+
 static void meta_window_actor_dispose    (GObject *object);
 static void meta_window_actor_finalize   (GObject *object);
 static void meta_window_actor_constructed (GObject *object);
@@ -186,6 +305,8 @@ static void meta_window_actor_get_property (GObject      *object,
 static void meta_window_actor_pick (ClutterActor       *actor,
 			                              const ClutterColor *color);
 static void meta_window_actor_paint (ClutterActor *actor);
+static void meta_window_actor_queue_redraw (ClutterActor *actor,
+                                            ClutterActor *leaf_that_queued);
 
 static gboolean meta_window_actor_get_paint_volume (ClutterActor       *actor,
                                                     ClutterPaintVolume *volume);
@@ -195,8 +316,11 @@ static void     meta_window_actor_detach     (MetaWindowActor *self);
 static gboolean meta_window_actor_has_shadow (MetaWindowActor *self);
 
 static void meta_window_actor_handle_updates (MetaWindowActor *self);
+static void meta_window_actor_damage_all (MetaWindowActor *self);
+static gboolean is_frozen (MetaWindowActor *self);
 
 static void check_needs_reshape (MetaWindowActor *self);
+static void queue_pre_paint (MetaWindowActor *self);
 
 static void do_send_frame_drawn (MetaWindowActor *self, FrameData *frame);
 static void do_send_frame_timings (MetaWindowActor  *self,
@@ -230,6 +354,7 @@ meta_window_actor_class_init (MetaWindowActorClass *klass)
   actor_class->pick = meta_window_actor_pick;
   actor_class->paint = meta_window_actor_paint;
   actor_class->get_paint_volume = meta_window_actor_get_paint_volume;
+  actor_class->queue_redraw = meta_window_actor_queue_redraw;
 
   pspec = g_param_spec_object ("meta-window",
                                "MetaWindow",
@@ -309,6 +434,9 @@ meta_window_actor_init (MetaWindowActor *self)
   priv->has_desat_effect = FALSE;
   priv->reshapes = 0;
   priv->should_have_shadow = FALSE;
+  priv->counters_start = g_get_monotonic_time ();
+  priv->pre_paint_link.data = self;
+  priv->frames_link.data = self;
 }
 
 static void
@@ -397,6 +525,12 @@ window_decorated_notify (MetaWindow *mw,
       priv->damage = None;
     }
 
+  if (priv->damage_region != None)
+    {
+      XFixesDestroyRegion (xdisplay, priv->damage_region);
+      priv->damage_region = None;
+    }
+
   priv->xwindow = new_xwindow;
 
   /*
@@ -451,7 +585,15 @@ meta_window_actor_constructed (GObject *object)
   Display                *xdisplay = meta_display_get_xdisplay (display);
   XRenderPictFormat      *format;
 
+  /* By default the server only tells us the bounding box of the damage,
+   * which is cheap to handle but repaints everything between two small
+   * updates at opposite corners. Optionally, only get told that there is
+   * new damage and fetch the exact region once per frame instead.
+   */
+  priv->report_damage_regions = display->compositor->damage_regions;
   priv->damage = XDamageCreate (xdisplay, xwindow,
+                                priv->report_damage_regions ?
+                                XDamageReportNonEmpty :
                                 XDamageReportBoundingBox);
 
   format = XRenderFindVisualFormat (xdisplay, window->xvisual);
@@ -522,10 +664,30 @@ meta_window_actor_dispose (GObject *object)
 
   priv->disposed = TRUE;
 
-  if (priv->send_frame_messages_timer != 0)
+  priv->frame_messages_deadline = 0;
+
+  if (priv->rebind_idle_id != 0)
+    {
+      g_source_remove (priv->rebind_idle_id);
+      priv->rebind_idle_id = 0;
+    }
+
+  if (priv->detect_opaque_id != 0)
+    {
+      g_source_remove (priv->detect_opaque_id);
+      priv->detect_opaque_id = 0;
+    }
+
+  if (priv->resume_damage_id != 0)
+    {
+      g_source_remove (priv->resume_damage_id);
+      priv->resume_damage_id = 0;
+    }
+
+  if (priv->occlusion_id != 0)
     {
-      g_source_remove (priv->send_frame_messages_timer);
-      priv->send_frame_messages_timer = 0;
+      g_source_remove (priv->occlusion_id);
+      priv->occlusion_id = 0;
     }
 
   screen = priv->screen;
@@ -536,10 +698,19 @@ meta_window_actor_dispose (GObject *object)
   meta_window_actor_detach (self);
 
   g_clear_pointer (&priv->unobscured_region, cairo_region_destroy);
+  g_clear_pointer (&priv->pending_damage, cairo_region_destroy);
   g_clear_pointer (&priv->shape_region, cairo_region_destroy);
+  g_clear_pointer (&priv->client_shape, cairo_region_destroy);
   g_clear_pointer (&priv->opaque_region, cairo_region_destroy);
   g_clear_pointer (&priv->shadow_clip, cairo_region_destroy);
 
+  if (priv->client_shape_pending)
+    {
+      xcb_discard_reply (XGetXCBConnection (xdisplay),
+                         priv->client_shape_cookie.sequence);
+      priv->client_shape_pending = FALSE;
+    }
+
   g_clear_pointer (&priv->shadow_class, free);
   g_clear_pointer (&priv->focused_shadow, meta_shadow_unref);
   g_clear_pointer (&priv->unfocused_shadow, meta_shadow_unref);
@@ -554,7 +725,25 @@ meta_window_actor_dispose (GObject *object)
       priv->damage = None;
     }
 
-  compositor->windows = g_list_remove (compositor->windows, (gconstpointer) self);
+  if (priv->damage_region != None)
+    {
+      XFixesDestroyRegion (xdisplay, priv->damage_region);
+      priv->damage_region = None;
+    }
+
+  g_queue_remove (&compositor->windows, self);
+
+  if (priv->pre_paint_queued)
+    {
+      g_queue_unlink (&compositor->pre_paint_windows, &priv->pre_paint_link);
+      priv->pre_paint_queued = FALSE;
+    }
+
+  if (priv->frames_queued)
+    {
+      g_queue_unlink (&compositor->frame_windows, &priv->frames_link);
+      priv->frames_queued = FALSE;
+    }
 
   g_clear_object (&priv->window);
 
@@ -763,6 +952,81 @@ clip_shadow_under_window (MetaWindowActor *self)
   return (priv->argb32 || priv->opacity != 0xff) && priv->window->frame;
 }
 
+/* The compositor only pre-paints the windows queued here: whatever
+ * leaves a window with work for meta_window_actor_pre_paint() queues
+ * it, as does any redraw queued on it, so a frame costs nothing for
+ * the windows that didn't change. */
+static void
+queue_pre_paint (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  MetaCompositor *compositor;
+
+  if (priv->pre_paint_queued || priv->disposed)
+    return;
+
+  compositor = priv->screen->display->compositor;
+  g_queue_push_tail_link (&compositor->pre_paint_windows, &priv->pre_paint_link);
+  priv->pre_paint_queued = TRUE;
+}
+
+/* Whether meta_window_actor_handle_updates() left work for the next
+ * frame, say because the pixmap bind was deferred */
+static gboolean
+has_pending_updates (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+
+  if (meta_window_actor_is_destroyed (self) || is_frozen (self) ||
+      priv->unredirected)
+    return FALSE;
+
+  if (!priv->visible &&
+      (!priv->needs_pixmap || (priv->texture_evicted && !priv->texture_wanted)))
+    return FALSE;
+
+  return (priv->received_damage || priv->needs_pixmap ||
+          priv->needs_reshape || priv->pending_damage != NULL);
+}
+
+/* Keeps the windows with frames waiting for their timings in a queue
+ * of their own, so frame completion doesn't walk all the windows */
+static void
+queue_frame_timings (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+
+  if (priv->frames_queued || priv->disposed)
+    return;
+
+  g_queue_push_tail_link (&priv->screen->display->compositor->frame_windows,
+                          &priv->frames_link);
+  priv->frames_queued = TRUE;
+}
+
+static void
+unqueue_frame_timings (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+
+  if (!priv->frames_queued || priv->frames != NULL)
+    return;
+
+  g_queue_unlink (&priv->screen->display->compositor->frame_windows,
+                  &priv->frames_link);
+  priv->frames_queued = FALSE;
+}
+
+static void
+meta_window_actor_queue_redraw (ClutterActor *actor,
+                                ClutterActor *leaf_that_queued)
+{
+  queue_pre_paint (META_WINDOW_ACTOR (actor));
+
+  CLUTTER_ACTOR_CLASS (meta_window_actor_parent_class)->queue_redraw (actor,
+                                                                      leaf_that_queued);
+}
+
 static void
 assign_frame_counter_to_frames (MetaWindowActor *self)
 {
@@ -773,7 +1037,7 @@ assign_frame_counter_to_frames (MetaWindowActor *self)
   /* If the window is obscured, then we're expecting to deal with sending
    * frame messages in a timeout, rather than in this paint cycle.
    */
-  if (priv->send_frame_messages_timer != 0)
+  if (priv->frame_messages_deadline != 0)
     return;
 
   for (l = priv->frames; l; l = l->next)
@@ -803,38 +1067,26 @@ meta_window_actor_pick (ClutterActor       *actor,
   else
     {
       int n_rects;
-      float *rectangles;
       int i;
-      CoglPipeline *pipeline;
-      CoglContext *ctx;
-      CoglFramebuffer *fb;
-      CoglColor cogl_color;
 
+      /* Describe the input shape box by box rather than painting it, so
+       * the window can also be hit-tested by a geometric pick. */
       n_rects = cairo_region_num_rectangles (priv->shape_region);
-      rectangles = g_alloca (sizeof (float) * 4 * n_rects);
 
       for (i = 0; i < n_rects; i++)
         {
           cairo_rectangle_int_t rect;
-          int pos = i * 4;
+          ClutterActorBox box;
 
           cairo_region_get_rectangle (priv->shape_region, i, &rect);
 
-          rectangles[pos + 0] = rect.x;
-          rectangles[pos + 1] = rect.y;
-          rectangles[pos + 2] = rect.x + rect.width;
-          rectangles[pos + 3] = rect.y + rect.height;
-        }
-
-      ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
-      fb = cogl_get_draw_framebuffer ();
-
-      cogl_color_init_from_4ub (&cogl_color, color->red, color->green, color->blue, color->alpha);
+          box.x1 = rect.x;
+          box.y1 = rect.y;
+          box.x2 = rect.x + rect.width;
+          box.y2 = rect.y + rect.height;
 
-      pipeline = cogl_pipeline_new (ctx);
-      cogl_pipeline_set_color (pipeline, &cogl_color);
-      cogl_framebuffer_draw_rectangles (fb, pipeline, rectangles, n_rects);
-      cogl_object_unref (pipeline);
+          clutter_actor_pick_box (actor, &box);
+        }
     }
 
   clutter_actor_iter_init (&iter, actor);
@@ -843,6 +1095,34 @@ meta_window_actor_pick (ClutterActor       *actor,
     clutter_actor_paint (child);
 }
 
+static gboolean
+rebind_evicted_texture (gpointer user_data)
+{
+  MetaWindowActor *self = META_WINDOW_ACTOR (user_data);
+  MetaWindowActorPrivate *priv = self->priv;
+
+  priv->rebind_idle_id = 0;
+
+  /* We are hidden, so queue the redraw on the stage; our pre-paint
+   * will then bind the texture again */
+  queue_pre_paint (self);
+  clutter_actor_queue_redraw (priv->screen->display->compositor->stage);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+resume_suspended_damage (gpointer user_data)
+{
+  MetaWindowActor *self = META_WINDOW_ACTOR (user_data);
+
+  self->priv->resume_damage_id = 0;
+
+  meta_window_actor_damage_all (self);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 meta_window_actor_paint (ClutterActor *actor)
 {
@@ -851,19 +1131,38 @@ meta_window_actor_paint (ClutterActor *actor)
   CoglFramebuffer *framebuffer = NULL;
   gboolean appears_focused = meta_window_appears_focused (priv->window);
   MetaShadow *shadow = appears_focused ? priv->focused_shadow : priv->unfocused_shadow;
+  gint64 paint_start;
 
   if (!priv->window->display->shadows_enabled) {
       shadow = NULL;
   }
 
+  paint_start = g_get_monotonic_time ();
+  priv->last_shown_time = paint_start;
+
+  /* Something, most likely a clone, is painting us after our texture
+   * was evicted; the shaped texture paints the placeholder, if any,
+   * this time, and we get the real texture back for the next frame */
+  if (priv->texture_evicted && !priv->texture_wanted)
+    {
+      priv->texture_wanted = TRUE;
+      if (priv->rebind_idle_id == 0)
+        priv->rebind_idle_id = g_idle_add (rebind_evicted_texture, self);
+    }
+
+  /* Likewise when we dropped damage on an inactive workspace; from now
+   * on the visible clone keeps damage flowing */
+  if (priv->needs_damage_all && !is_frozen (self) &&
+      priv->resume_damage_id == 0)
+    priv->resume_damage_id = g_idle_add (resume_suspended_damage, self);
+
  /* This window got damage when obscured; we set up a timer
   * to send frame completion events, but since we're drawing
   * the window now (for some other reason) cancel the timer
   * and send the completion events normally */
-  if (priv->send_frame_messages_timer != 0)
+  if (priv->frame_messages_deadline != 0)
     {
-      g_source_remove (priv->send_frame_messages_timer);
-      priv->send_frame_messages_timer = 0;
+      priv->frame_messages_deadline = 0;
 
       assign_frame_counter_to_frames (self);
     }
@@ -907,6 +1206,8 @@ meta_window_actor_paint (ClutterActor *actor)
     }
 
   CLUTTER_ACTOR_CLASS (meta_window_actor_parent_class)->paint (actor);
+
+  priv->counters.paint_time += g_get_monotonic_time () - paint_start;
 }
 
 static gboolean
@@ -1086,13 +1387,30 @@ meta_window_actor_is_destroyed (MetaWindowActor *self)
   return self->priv->disposed || self->priv->needs_destroy;
 }
 
-static gboolean
-send_frame_messages_timeout (gpointer data)
+/**
+ * meta_window_actor_dispatch_frame_messages:
+ * @self: a #MetaWindowActor
+ * @now: the current monotonic time
+ *
+ * Called for every window when the compositor's frame message timer
+ * expires. If this window's deadline has passed, the messages for its
+ * frames that were never painted are queued.
+ *
+ * Return value: the deadline still pending for this window, or 0
+ */
+LOCAL_SYMBOL gint64
+meta_window_actor_dispatch_frame_messages (MetaWindowActor *self,
+                                           gint64           now)
 {
-  MetaWindowActor *self = (MetaWindowActor *) data;
   MetaWindowActorPrivate *priv = self->priv;
   GList *l;
 
+  if (priv->frame_messages_deadline == 0)
+    return 0;
+
+  if (priv->frame_messages_deadline > now)
+    return priv->frame_messages_deadline;
+
   for (l = priv->frames; l;)
     {
       GList *l_next = l->next;
@@ -1110,10 +1428,12 @@ send_frame_messages_timeout (gpointer data)
       l = l_next;
     }
 
+  unqueue_frame_timings (self);
+
   priv->needs_frame_drawn = FALSE;
-  priv->send_frame_messages_timer = 0;
+  priv->frame_messages_deadline = 0;
 
-  return FALSE;
+  return 0;
 }
 
 static void
@@ -1126,7 +1446,7 @@ queue_send_frame_messages_timeout (MetaWindowActor *self)
   float refresh_rate;
   int interval, offset;
 
-  if (priv->send_frame_messages_timer != 0)
+  if (priv->frame_messages_deadline != 0)
     return;
 
   if (window->monitor)
@@ -1141,15 +1461,13 @@ queue_send_frame_messages_timeout (MetaWindowActor *self)
   current_time =
     meta_compositor_monotonic_time_to_server_time (display,
                                                    g_get_monotonic_time ());
-  interval = (int)(1000000 / refresh_rate) * 6;
-  offset = MAX (0, priv->frame_drawn_time + interval - current_time) / 1000;
+  interval = (int)(1000000 / refresh_rate) *
+             (priv->occluded ? OCCLUDED_FRAME_INTERVAL : OBSCURED_FRAME_INTERVAL);
+  offset = MAX (0, priv->frame_drawn_time + interval - current_time);
 
- /* The clutter master clock source has already been added with META_PRIORITY_REDRAW,
-  * so the timer will run *after* the clutter frame handling, if a frame is ready
-  * to be drawn when the timer expires.
-  */
-  priv->send_frame_messages_timer = g_timeout_add_full (META_PRIORITY_REDRAW, offset, send_frame_messages_timeout, self, NULL);
-  g_source_set_name_by_id (priv->send_frame_messages_timer, "[muffin] send_frame_messages_timeout");
+  priv->frame_messages_deadline = g_get_monotonic_time () + offset;
+  meta_compositor_schedule_frame_messages (display->compositor,
+                                           priv->frame_messages_deadline);
 }
 
 gboolean
@@ -1222,27 +1540,36 @@ update_area (MetaWindowActor *self,
 
   cogl_texture_pixmap_x11_update_area (COGL_TEXTURE_PIXMAP_X11 (texture),
                                        x, y, width, height);
+
+  /* Without texture-from-pixmap the area is copied from the server
+   * and uploaded, 4 bytes per pixel */
+  if (!cogl_texture_pixmap_x11_is_using_tfp_extension (COGL_TEXTURE_PIXMAP_X11 (texture)))
+    priv->counters.upload_bytes += (gint64) width * height * 4;
 }
 
 static void
 meta_window_actor_damage_all (MetaWindowActor *self)
 {
   MetaWindowActorPrivate *priv = self->priv;
+  MetaShapedTexture *stex;
   CoglTexture *texture;
 
-  if (!priv->needs_damage_all || !priv->window->mapped || priv->needs_pixmap)
+  if (!priv->needs_damage_all || !priv->window->mapped || priv->needs_pixmap ||
+      is_frozen (self))
     return;
 
   texture = meta_shaped_texture_get_texture (META_SHAPED_TEXTURE (priv->actor));
 
   priv->needs_damage_all = FALSE;
+  g_clear_pointer (&priv->pending_damage, cairo_region_destroy);
 
   update_area (self, 0, 0, cogl_texture_get_width (texture), cogl_texture_get_height (texture));
-  priv->repaint_scheduled = meta_shaped_texture_update_area (META_SHAPED_TEXTURE (priv->actor),
+  stex = META_SHAPED_TEXTURE (priv->actor);
+  priv->repaint_scheduled = meta_shaped_texture_update_area (stex,
                                    0, 0,
                                    cogl_texture_get_width (texture),
                                    cogl_texture_get_height (texture),
-                                   clutter_actor_has_mapped_clones (priv->actor) ? NULL : priv->unobscured_region);
+                                   meta_shaped_texture_has_visible_clones (stex) ? NULL : priv->unobscured_region);
 }
 
 static void
@@ -1262,6 +1589,7 @@ meta_window_actor_thaw (MetaWindowActor *self)
 
   /* We sometimes ignore moves and resizes on frozen windows */
   meta_window_actor_sync_actor_geometry (self, FALSE);
+  queue_pre_paint (self);
 
   /* We do this now since we might be going right back into the
    * frozen state */
@@ -1274,6 +1602,42 @@ meta_window_actor_thaw (MetaWindowActor *self)
     meta_window_actor_damage_all (self);
 }
 
+/* Whether the last paint found nothing of the window that isn't
+ * covered by the windows above it */
+static gboolean
+is_completely_obscured (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  cairo_rectangle_int_t shape_bounds;
+  cairo_region_overlap_t overlap;
+  gboolean is_obscured = FALSE;
+
+  if (priv->unobscured_region == NULL)
+    return FALSE;
+
+  /* Only intersect the regions when the bounds of the shape
+   * don't already tell */
+  cairo_region_get_extents (priv->shape_region, &shape_bounds);
+  overlap = cairo_region_contains_rectangle (priv->unobscured_region,
+                                             &shape_bounds);
+
+  if (overlap == CAIRO_REGION_OVERLAP_OUT ||
+      cairo_region_is_empty (priv->shape_region))
+    {
+      is_obscured = TRUE;
+    }
+  else if (overlap == CAIRO_REGION_OVERLAP_PART)
+    {
+      cairo_region_t *unobscured_window_region;
+      unobscured_window_region = cairo_region_copy (priv->shape_region);
+      cairo_region_intersect (unobscured_window_region, priv->unobscured_region);
+      is_obscured = cairo_region_is_empty (unobscured_window_region);
+      cairo_region_destroy (unobscured_window_region);
+    }
+
+  return is_obscured;
+}
+
 void
 meta_window_actor_queue_frame_drawn (MetaWindowActor *self,
                                      gboolean         no_delay_frame)
@@ -1292,6 +1656,8 @@ meta_window_actor_queue_frame_drawn (MetaWindowActor *self,
   frame->sync_request_serial = priv->window->sync_request_serial;
 
   priv->frames = g_list_prepend (priv->frames, frame);
+  queue_frame_timings (self);
+  queue_pre_paint (self);
 
   if (no_delay_frame)
     {
@@ -1301,16 +1667,7 @@ meta_window_actor_queue_frame_drawn (MetaWindowActor *self,
 
   if (!priv->repaint_scheduled)
     {
-      gboolean is_obscured = FALSE;
-       /* Find out whether the window is completly obscured */
-      if (priv->unobscured_region)
-        {
-          cairo_region_t *unobscured_window_region;
-          unobscured_window_region = cairo_region_copy (priv->shape_region);
-          cairo_region_intersect (unobscured_window_region, priv->unobscured_region);
-          is_obscured = cairo_region_is_empty (unobscured_window_region);
-          cairo_region_destroy (unobscured_window_region);
-        }
+      gboolean is_obscured = is_completely_obscured (self);
 
       /* A frame was marked by the client without actually doing any
        * damage, or while we had the window frozen (e.g. during an
@@ -1543,43 +1900,268 @@ meta_window_actor_detach (MetaWindowActor *self)
   XFreePixmap (xdisplay, priv->back_pixmap);
   priv->back_pixmap = None;
 
+  /* Any damage queued against the old pixmap is meaningless now */
+  g_clear_pointer (&priv->pending_damage, cairo_region_destroy);
+
+  /* Whatever we sampled was the old pixmap's contents */
+  if (priv->detect_opaque_id != 0)
+    {
+      g_source_remove (priv->detect_opaque_id);
+      priv->detect_opaque_id = 0;
+    }
+
+  if (priv->detected_opaque)
+    {
+      priv->detected_opaque = FALSE;
+      priv->needs_reshape = TRUE;
+    }
+
   priv->needs_pixmap = TRUE;
+  queue_pre_paint (self);
+}
+
+/**
+ * meta_window_actor_get_texture_memory:
+ * @self: a #MetaWindowActor
+ *
+ * Return value: an estimate of the texture memory held by @self, in bytes
+ */
+LOCAL_SYMBOL gsize
+meta_window_actor_get_texture_memory (MetaWindowActor *self)
+{
+  return meta_shaped_texture_get_memory_size (META_SHAPED_TEXTURE (self->priv->actor));
+}
+
+/*
+ * meta_window_actor_update_create_mipmaps:
+ * @self: a #MetaWindowActor
+ *
+ * Mipmaps are turned off by META_DISABLE_MIPMAPS or in density mode;
+ * called again when density mode is toggled.
+ */
+LOCAL_SYMBOL void
+meta_window_actor_update_create_mipmaps (MetaWindowActor *self)
+{
+  MetaCompositor *compositor = self->priv->screen->display->compositor;
+
+  meta_shaped_texture_set_create_mipmaps (META_SHAPED_TEXTURE (self->priv->actor),
+                                          !compositor->no_mipmaps &&
+                                          !meta_prefs_get_density_mode ());
+}
+
+/**
+ * meta_window_actor_get_last_shown_time:
+ * @self: a #MetaWindowActor
+ *
+ * Return value: the monotonic time of the last frame @self was shown in
+ */
+LOCAL_SYMBOL gint64
+meta_window_actor_get_last_shown_time (MetaWindowActor *self)
+{
+  return self->priv->last_shown_time;
 }
 
+/**
+ * meta_window_actor_can_evict_texture:
+ * @self: a #MetaWindowActor
+ *
+ * Checks whether the texture of @self may be dropped to save memory:
+ * the window has to be hidden (minimized or on another workspace), not
+ * animating and not painted (say, by a clone) for MIN_EVICTION_AGE, and
+ * it must still hold a texture.
+ *
+ * Return value: %TRUE if meta_window_actor_evict_texture() would help
+ */
 LOCAL_SYMBOL gboolean
-meta_window_actor_should_unredirect (MetaWindowActor *self)
+meta_window_actor_can_evict_texture (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+
+  return (priv->back_pixmap != None &&
+          !priv->visible &&
+          g_get_monotonic_time () - priv->last_shown_time >= MIN_EVICTION_AGE &&
+          !priv->texture_wanted &&
+          !priv->unredirected &&
+          !CLUTTER_ACTOR_IS_VISIBLE (self) &&
+          !meta_window_actor_is_destroyed (self) &&
+          !meta_window_actor_effect_in_progress (self));
+}
+
+/**
+ * meta_window_actor_evict_texture:
+ * @self: a #MetaWindowActor
+ *
+ * Releases the pixmap and textures of a hidden window. They are bound
+ * again when the window is shown, or as soon as something such as a
+ * clone paints it, with a scaled down copy standing in for the frame
+ * in between when one is available.
+ */
+LOCAL_SYMBOL void
+meta_window_actor_evict_texture (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv     = self->priv;
+  MetaScreen            *screen   = priv->screen;
+  MetaDisplay           *display  = meta_screen_get_display (screen);
+  Display               *xdisplay = meta_display_get_xdisplay (display);
+
+  if (!priv->back_pixmap)
+    return;
+
+  meta_verbose ("Evicting texture of hidden window %s\n", priv->window->desc);
+
+  meta_shaped_texture_evict_texture (META_SHAPED_TEXTURE (priv->actor));
+
+  cogl_flush();
+
+  XFreePixmap (xdisplay, priv->back_pixmap);
+  priv->back_pixmap = None;
+
+  g_clear_pointer (&priv->pending_damage, cairo_region_destroy);
+
+  priv->needs_pixmap = TRUE;
+  priv->texture_evicted = TRUE;
+  queue_pre_paint (self);
+}
+
+/**
+ * meta_window_actor_reload_textures:
+ * @self: a #MetaWindowActor
+ *
+ * Drops the textures of @self after their contents were lost: the
+ * pixmap is bound again, and the mask and shadows are made again,
+ * before the next paint. A hidden window whose texture was evicted
+ * loses its scaled down copy too.
+ */
+LOCAL_SYMBOL void
+meta_window_actor_reload_textures (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+
+  if (priv->back_pixmap)
+    meta_window_actor_detach (self);
+  else if (priv->texture_evicted)
+    meta_shaped_texture_set_texture (META_SHAPED_TEXTURE (priv->actor), NULL);
+
+  priv->needs_reshape = TRUE;
+  meta_window_actor_invalidate_shadow (self);
+}
+
+static const char *unredirect_blocker_names[] = {
+  "unredirectable",
+  "being destroyed",
+  "asked to stay composited",
+  "translucent",
+  "shaped",
+  "ARGB",
+  "not monitor sized",
+  "not doing full damage",
+  "not fullscreen-unredirectable by preference",
+  "obscured",
+  "on a screen with unredirection disabled",
+  "settling after being composited"
+};
+
+/**
+ * meta_window_actor_get_unredirect_blocker:
+ * @self: a #MetaWindowActor
+ *
+ * Checks what, in the window itself, stops it from being unredirected.
+ * Whether other windows cover it is up to the caller.
+ *
+ * Return value: %META_UNREDIRECT_ALLOWED if nothing does, otherwise
+ *   the first reason found
+ */
+LOCAL_SYMBOL MetaUnredirectBlocker
+meta_window_actor_get_unredirect_blocker (MetaWindowActor *self)
 {
   MetaWindow *metaWindow = meta_window_actor_get_meta_window (self);
   MetaWindowActorPrivate *priv = self->priv;
 
   if (meta_window_actor_is_destroyed (self))
-    return FALSE;
+    return META_UNREDIRECT_BLOCKED_DESTROYED;
 
   if (meta_window_requested_dont_bypass_compositor (metaWindow))
-    return FALSE;
+    return META_UNREDIRECT_BLOCKED_REQUESTED;
 
   if (priv->opacity != 0xff)
-    return FALSE;
+    return META_UNREDIRECT_BLOCKED_TRANSLUCENT;
 
   if (metaWindow->has_shape)
-    return FALSE;
+    return META_UNREDIRECT_BLOCKED_SHAPED;
 
   if (priv->argb32 && !meta_window_requested_bypass_compositor (metaWindow))
-    return FALSE;
+    return META_UNREDIRECT_BLOCKED_ARGB;
 
   if (!meta_window_is_monitor_sized (metaWindow))
-    return FALSE;
+    return META_UNREDIRECT_BLOCKED_NOT_MONITOR_SIZED;
 
   if (meta_window_requested_bypass_compositor (metaWindow))
-    return TRUE;
+    return META_UNREDIRECT_ALLOWED;
 
   if (meta_window_is_override_redirect (metaWindow))
-    return TRUE;
+    return META_UNREDIRECT_ALLOWED;
+
+  if (!priv->does_full_damage)
+    return META_UNREDIRECT_BLOCKED_PARTIAL_DAMAGE;
+
+  if (!meta_prefs_get_unredirect_fullscreen_windows ())
+    return META_UNREDIRECT_BLOCKED_PREFERENCE;
+
+  return META_UNREDIRECT_ALLOWED;
+}
+
+/**
+ * meta_window_actor_note_unredirect_blocker:
+ * @self: a #MetaWindowActor
+ * @blocker: the reason the compositor settled on for this frame
+ *
+ * Records why @self is or isn't unredirected, logging it under
+ * META_DEBUG_COMPOSITOR whenever the reason changes, so that a window
+ * which unexpectedly stays composited can be diagnosed.
+ */
+LOCAL_SYMBOL void
+meta_window_actor_note_unredirect_blocker (MetaWindowActor       *self,
+                                           MetaUnredirectBlocker  blocker)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+
+  if (blocker != META_UNREDIRECT_ALLOWED &&
+      blocker != META_UNREDIRECT_BLOCKED_SETTLING)
+    priv->unredirectable_time = 0;
+  else if (priv->unredirectable_time == 0)
+    priv->unredirectable_time = g_get_monotonic_time ();
+
+  if (priv->unredirect_blocker == blocker)
+    return;
+
+  priv->unredirect_blocker = blocker;
+
+  meta_topic (META_DEBUG_COMPOSITOR, "Window %s is now %s\n",
+              priv->window->desc, unredirect_blocker_names[blocker]);
+}
+
+/**
+ * meta_window_actor_unredirect_settled:
+ * @self: a #MetaWindowActor
+ *
+ * Checks whether @self, which is unredirectable this frame, may be
+ * unredirected now: it has to have been unredirectable, as noted with
+ * meta_window_actor_note_unredirect_blocker(), for a while first,
+ * unless the client asked to bypass the compositor.
+ *
+ * Return value: whether @self may be unredirected
+ */
+LOCAL_SYMBOL gboolean
+meta_window_actor_unredirect_settled (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
 
-  if (priv->does_full_damage && meta_prefs_get_unredirect_fullscreen_windows ())
+  if (priv->unredirected ||
+      meta_window_requested_bypass_compositor (priv->window))
     return TRUE;
 
-  return FALSE;
+  return (priv->unredirectable_time != 0 &&
+          g_get_monotonic_time () - priv->unredirectable_time >= UNREDIRECT_SETTLE_TIME);
 }
 
 LOCAL_SYMBOL void
@@ -1602,6 +2184,9 @@ meta_window_actor_set_redirected (MetaWindowActor *self, gboolean state)
       XCompositeRedirectWindow (xdisplay, xwin, CompositeRedirectManual);
       meta_window_actor_detach (self);
       priv->unredirected = FALSE;
+      /* The server fills the new pixmap with what's on screen, so binding
+       * it right away has the first composited frame show the window */
+      priv->bind_on_redirect = TRUE;
     }
   else
     {
@@ -1624,11 +2209,7 @@ meta_window_actor_destroy (MetaWindowActor *self)
   window_type = meta_window_get_window_type (window);
   meta_window_set_compositor_private (window, NULL);
 
-  if (priv->send_frame_messages_timer != 0)
-    {
-      g_source_remove (priv->send_frame_messages_timer);
-      priv->send_frame_messages_timer = 0;
-    }
+  priv->frame_messages_deadline = 0;
 
   if (window_type == META_WINDOW_DROPDOWN_MENU ||
       window_type == META_WINDOW_POPUP_MENU ||
@@ -1692,6 +2273,7 @@ meta_window_actor_sync_actor_geometry (MetaWindowActor *self,
   if (priv->size_changed)
     {
       priv->needs_pixmap = TRUE;
+      queue_pre_paint (self);
       meta_window_actor_update_shape (self);
 
       clutter_actor_set_size (CLUTTER_ACTOR (self),
@@ -1715,6 +2297,7 @@ meta_window_actor_show (MetaWindowActor   *self,
   g_return_if_fail (!priv->visible);
 
   priv->visible = TRUE;
+  queue_pre_paint (self);
 
   event = 0;
   switch (effect)
@@ -1742,6 +2325,11 @@ meta_window_actor_show (MetaWindowActor   *self,
       clutter_actor_show (CLUTTER_ACTOR (self));
       priv->redecorating = FALSE;
     }
+
+  /* Catch up with what was drawn while we were on an inactive
+   * workspace; a map effect does this when it thaws us */
+  if (priv->needs_damage_all)
+    meta_window_actor_damage_all (self);
 }
 
 LOCAL_SYMBOL void
@@ -1754,6 +2342,12 @@ meta_window_actor_hide (MetaWindowActor *self,
 
   g_return_if_fail (priv->visible || (!priv->visible && meta_window_is_attached_dialog (priv->window)));
 
+  /* Hidden windows aren't pre-painted every frame any more, so the
+   * time they were last shown is when they were hidden, unless
+   * something paints them later */
+  if (priv->visible)
+    priv->last_shown_time = g_get_monotonic_time ();
+
   priv->visible = FALSE;
 
   /* If a plugin is animating a workspace transition, we have to
@@ -1903,6 +2497,7 @@ meta_window_actor_new (MetaWindow *window)
   priv->last_y = -1;
 
   priv->needs_pixmap = TRUE;
+  queue_pre_paint (self);
 
   meta_window_actor_set_updates_frozen (self,
                                         meta_window_updates_are_frozen (priv->window));
@@ -1934,7 +2529,7 @@ meta_window_actor_new (MetaWindow *window)
   /* Initial position in the stack is arbitrary; stacking will be synced
    * before we first paint.
    */
-  compositor->windows = g_list_append (compositor->windows, self);
+  g_queue_push_tail (&compositor->windows, self);
 
   return self;
 }
@@ -2020,12 +2615,91 @@ meta_window_actor_set_unobscured_region (MetaWindowActor *self,
     priv->unobscured_region = NULL;
 }
 
-/**
- * meta_window_actor_set_visible_region:
- * @self: a #MetaWindowActor
- * @visible_region: the region of the screen that isn't completely
- *  obscured.
- *
+static void
+set_occluded (MetaWindowActor *self,
+              gboolean         occluded)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  MetaDisplay *display = priv->window->display;
+
+  priv->occluded = occluded;
+
+  meta_error_trap_push (display);
+
+  if (occluded)
+    {
+      gulong data = 1;
+
+      XChangeProperty (display->xdisplay, priv->window->xwindow,
+                       display->atom__MUFFIN_OCCLUDED,
+                       XA_CARDINAL, 32, PropModeReplace,
+                       (guchar *) &data, 1);
+    }
+  else
+    XDeleteProperty (display->xdisplay, priv->window->xwindow,
+                     display->atom__MUFFIN_OCCLUDED);
+
+  meta_error_trap_pop (display);
+}
+
+static gboolean
+publish_occlusion (gpointer user_data)
+{
+  MetaWindowActor *self = META_WINDOW_ACTOR (user_data);
+
+  self->priv->occlusion_id = 0;
+
+  set_occluded (self, TRUE);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * meta_window_actor_update_occlusion:
+ * @self: a #MetaWindowActor
+ *
+ * Tells the client whether nothing of the window can be seen, through
+ * the _MUFFIN_OCCLUDED property on its window, once the unobscured
+ * region of the window was set for a paint. A window only counts as
+ * occluded after staying so for %OCCLUSION_DELAY, and stops as soon as
+ * any of it shows, on the screen or through a clone.
+ */
+LOCAL_SYMBOL void
+meta_window_actor_update_occlusion (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  gboolean obscured;
+
+  if (meta_window_actor_is_destroyed (self))
+    return;
+
+  obscured = (!CLUTTER_ACTOR_IS_MAPPED (self) || is_completely_obscured (self)) &&
+             !meta_shaped_texture_has_visible_clones (META_SHAPED_TEXTURE (priv->actor));
+
+  if (!obscured)
+    {
+      if (priv->occlusion_id != 0)
+        {
+          g_source_remove (priv->occlusion_id);
+          priv->occlusion_id = 0;
+        }
+
+      if (priv->occluded)
+        set_occluded (self, FALSE);
+
+      return;
+    }
+
+  if (!priv->occluded && priv->occlusion_id == 0)
+    priv->occlusion_id = g_timeout_add (OCCLUSION_DELAY, publish_occlusion, self);
+}
+
+/**
+ * meta_window_actor_set_visible_region:
+ * @self: a #MetaWindowActor
+ * @visible_region: the region of the screen that isn't completely
+ *  obscured.
+ *
  * Provides a hint as to what areas of the window need to be
  * drawn. Regions not in @visible_region are completely obscured.
  * This will be set before painting then unset afterwards.
@@ -2087,6 +2761,108 @@ meta_window_actor_reset_visible_regions (MetaWindowActor *self)
   g_clear_pointer (&priv->shadow_clip, cairo_region_destroy);
 }
 
+/* Returns TRUE if every pixel we sample from the client area of the
+ * window's pixmap has full alpha. We look at the edges, where
+ * decorations drawn by the client have their shadows and rounded
+ * corners, and a few rows and a column through the middle, which a
+ * translucent background would show up in. */
+static gboolean
+client_area_is_opaque (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  MetaDisplay *display = priv->screen->display;
+  Display *xdisplay = display->xdisplay;
+  XRenderPictFormat *format;
+  cairo_rectangle_int_t client_area;
+  cairo_rectangle_int_t samples[8];
+  unsigned long alpha_mask;
+  gboolean opaque = TRUE;
+  int w, h;
+  int i, x, y;
+
+  format = XRenderFindVisualFormat (xdisplay, priv->window->xvisual);
+  if (format == NULL || format->type != PictTypeDirect || !format->direct.alphaMask)
+    return FALSE;
+
+  alpha_mask = (unsigned long) format->direct.alphaMask << format->direct.alpha;
+
+  meta_window_get_client_area_rect (priv->window, &client_area);
+  w = client_area.width;
+  h = client_area.height;
+  if (w <= 0 || h <= 0)
+    return FALSE;
+
+  for (i = 0; i < 5; i++)
+    {
+      samples[i].x = client_area.x;
+      samples[i].y = client_area.y + (h - 1) * i / 4;
+      samples[i].width = w;
+      samples[i].height = 1;
+    }
+
+  for (i = 0; i < 3; i++)
+    {
+      samples[5 + i].x = client_area.x + (w - 1) * i / 2;
+      samples[5 + i].y = client_area.y;
+      samples[5 + i].width = 1;
+      samples[5 + i].height = h;
+    }
+
+  meta_error_trap_push (display);
+
+  for (i = 0; i < (int) G_N_ELEMENTS (samples) && opaque; i++)
+    {
+      XImage *image;
+
+      image = XGetImage (xdisplay, priv->back_pixmap,
+                         samples[i].x, samples[i].y,
+                         samples[i].width, samples[i].height,
+                         AllPlanes, ZPixmap);
+      if (image == NULL)
+        {
+          opaque = FALSE;
+          break;
+        }
+
+      for (y = 0; y < samples[i].height && opaque; y++)
+        for (x = 0; x < samples[i].width && opaque; x++)
+          if ((XGetPixel (image, x, y) & alpha_mask) != alpha_mask)
+            opaque = FALSE;
+
+      XDestroyImage (image);
+    }
+
+  meta_error_trap_pop (display);
+
+  return opaque;
+}
+
+/* Most ARGB clients don't set _NET_WM_OPAQUE_REGION even though they
+ * paint nothing translucent, so once the pixmap has settled we look at
+ * its alpha ourselves. If it is opaque, the client area is painted
+ * without blending and hides what is below it. This is redone for
+ * every new pixmap, so only once per resize. */
+static gboolean
+detect_opaque_contents (gpointer data)
+{
+  MetaWindowActor *self = data;
+  MetaWindowActorPrivate *priv = self->priv;
+
+  priv->detect_opaque_id = 0;
+
+  if (priv->back_pixmap == None)
+    return G_SOURCE_REMOVE;
+
+  if (client_area_is_opaque (self))
+    {
+      priv->detected_opaque = TRUE;
+      priv->needs_reshape = TRUE;
+      clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 check_needs_pixmap (MetaWindowActor *self)
 {
@@ -2104,6 +2880,15 @@ check_needs_pixmap (MetaWindowActor *self)
       xwindow == clutter_x11_get_stage_window (compositor->stage))
     return;
 
+  /* Keep showing what we have until there's room in this frame's budget;
+   * a window that was just redirected has nothing to show until then */
+  if ((priv->size_changed || priv->back_pixmap == None) &&
+      !priv->bind_on_redirect &&
+      !meta_compositor_reserve_pixmap_bind (compositor))
+    return;
+
+  priv->bind_on_redirect = FALSE;
+
   if (priv->size_changed)
     {
       meta_window_actor_detach (self);
@@ -2142,11 +2927,10 @@ check_needs_pixmap (MetaWindowActor *self)
           goto out;
         }
 
-      if (compositor->no_mipmaps)
-        meta_shaped_texture_set_create_mipmaps (META_SHAPED_TEXTURE (priv->actor),
-                                                FALSE);
+      meta_window_actor_update_create_mipmaps (self);
 
       texture = COGL_TEXTURE (cogl_texture_pixmap_x11_new (ctx, priv->back_pixmap, FALSE, NULL));
+      cogl_texture_set_memory_category (texture, "window pixmaps");
 
       /*
        * This only works *after* actually setting the pixmap, so we have to
@@ -2157,6 +2941,18 @@ check_needs_pixmap (MetaWindowActor *self)
         g_warning ("NOTE: Not using GLX TFP!\n");
 
       meta_shaped_texture_set_texture (META_SHAPED_TEXTURE (priv->actor), texture);
+
+      if (priv->argb32 && !compositor->no_opaque_detection)
+        priv->detect_opaque_id = g_timeout_add (OPAQUE_DETECTION_DELAY,
+                                                detect_opaque_contents, self);
+
+      /* The mask went with the evicted texture */
+      if (priv->texture_evicted)
+        {
+          priv->texture_evicted = FALSE;
+          priv->texture_wanted = FALSE;
+          priv->needs_reshape = TRUE;
+        }
     }
 
   priv->needs_pixmap = FALSE;
@@ -2234,6 +3030,7 @@ check_needs_shadow (MetaWindowActor *self)
                                                              priv->shadow_shape,
                                                              shape_bounds.width, shape_bounds.height,
                                                              shadow_class, appears_focused);
+          priv->counters.shadow_updates++;
         }
     }
 
@@ -2241,20 +3038,66 @@ check_needs_shadow (MetaWindowActor *self)
     meta_shadow_unref (old_shadow);
 }
 
+/* Makes sure a frame actually gets scheduled so that pending damage is
+ * flushed; the real clip is queued at flush time.
+ */
+static void
+queue_damage_flush (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+
+  if (!priv->repaint_scheduled &&
+      (priv->unobscured_region == NULL ||
+       meta_shaped_texture_has_visible_clones (META_SHAPED_TEXTURE (priv->actor)) ||
+       !cairo_region_is_empty (priv->unobscured_region)))
+    {
+      MetaCompositor *compositor = priv->window->display->compositor;
+      const cairo_rectangle_int_t clip = { 0, 0, 1, 1 };
+
+      clutter_actor_queue_redraw_with_clip (priv->actor, &clip);
+      priv->repaint_scheduled = TRUE;
+
+      /* The monitor refreshes when we present the new frame, so there
+       * is no refresh to wait for */
+      if (compositor->variable_refresh_window == self)
+        clutter_stage_skip_sync_delay (CLUTTER_STAGE (compositor->stage));
+    }
+}
+
+/* Whether the window is hidden on a workspace other than the active
+ * one and no clone shows it */
+static gboolean
+updates_suspended (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+
+  if (CLUTTER_ACTOR_IS_VISIBLE (self) || priv->window->on_all_workspaces)
+    return FALSE;
+
+  if (meta_window_located_on_workspace (priv->window,
+                                        priv->screen->active_workspace))
+    return FALSE;
+
+  return !meta_shaped_texture_has_visible_clones (META_SHAPED_TEXTURE (priv->actor));
+}
+
 LOCAL_SYMBOL void
 meta_window_actor_process_damage (MetaWindowActor    *self,
                                   XDamageNotifyEvent *event)
 {
   MetaWindowActorPrivate *priv = self->priv;
   MetaCompositor *compositor = priv->window->display->compositor;
+  cairo_rectangle_int_t rect;
 
   priv->received_damage = TRUE;
+  priv->counters.damage_events++;
+  queue_pre_paint (self);
 
   /* Drop damage event for unredirected windows */
   if (priv->unredirected)
     return;
 
-  if (meta_window_is_fullscreen (priv->window) && g_list_last (compositor->windows)->data == self)
+  if (meta_window_is_fullscreen (priv->window) && compositor->windows.tail->data == self)
     {
       MetaRectangle window_rect;
       meta_window_get_outer_rect (priv->window, &window_rect);
@@ -2291,16 +3134,151 @@ meta_window_actor_process_damage (MetaWindowActor    *self,
       return;
     }
 
+  /* Similarly, nothing shows what hidden windows on other workspaces
+   * draw, so rather than repairing their textures as they draw we
+   * repair them once when they are shown again */
+  if (updates_suspended (self))
+    {
+      priv->needs_damage_all = TRUE;
+      g_clear_pointer (&priv->pending_damage, cairo_region_destroy);
+      return;
+    }
+
   if (!priv->window->mapped || priv->needs_pixmap)
     return;
 
-  update_area (self, event->area.x, event->area.y, event->area.width, event->area.height);
-  priv->repaint_scheduled = meta_shaped_texture_update_area (META_SHAPED_TEXTURE (priv->actor),
-                                   event->area.x,
-                                   event->area.y,
-                                   event->area.width,
-                                   event->area.height,
-                                   clutter_actor_has_mapped_clones (priv->actor) ? NULL : priv->unobscured_region);
+  /* With XDamageReportNonEmpty this is only a notification that there
+   * is damage; the region itself is fetched in flush_damage() */
+  if (priv->report_damage_regions)
+    {
+      queue_damage_flush (self);
+      return;
+    }
+
+  /* Clients frequently send bursts of small damage events between two
+   * frames; rather than repairing the texture and queueing a clipped
+   * redraw for every one of them, accumulate them here and repair the
+   * whole region once from meta_window_actor_pre_paint().
+   */
+  rect.x = event->area.x;
+  rect.y = event->area.y;
+  rect.width = event->area.width;
+  rect.height = event->area.height;
+
+  if (priv->pending_damage == NULL)
+    {
+      priv->pending_damage = cairo_region_create_rectangle (&rect);
+      queue_damage_flush (self);
+    }
+  else
+    {
+      cairo_region_union_rectangle (priv->pending_damage, &rect);
+    }
+}
+
+/* Fetches the damage accumulated by the server since the last
+ * subtract into priv->pending_damage. Only used with
+ * report_damage_regions.
+ */
+static void
+fetch_damage_region (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  MetaDisplay *display = meta_screen_get_display (priv->screen);
+  Display *xdisplay = meta_display_get_xdisplay (display);
+  XRectangle *rects;
+  int i, n_rects;
+
+  if (priv->damage_region == None)
+    priv->damage_region = XFixesCreateRegion (xdisplay, NULL, 0);
+
+  meta_error_trap_push (display);
+  XDamageSubtract (xdisplay, priv->damage, None, priv->damage_region);
+  rects = XFixesFetchRegion (xdisplay, priv->damage_region, &n_rects);
+  meta_error_trap_pop (display);
+
+  priv->received_damage = FALSE;
+
+  if (rects == NULL)
+    return;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      rect.x = rects[i].x;
+      rect.y = rects[i].y;
+      rect.width = rects[i].width;
+      rect.height = rects[i].height;
+
+      if (priv->pending_damage == NULL)
+        priv->pending_damage = cairo_region_create_rectangle (&rect);
+      else
+        cairo_region_union_rectangle (priv->pending_damage, &rect);
+    }
+
+  XFree (rects);
+}
+
+static void
+meta_window_actor_flush_damage (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  cairo_region_t *unobscured_region;
+  cairo_rectangle_int_t rect;
+  gint64 damage_area = 0;
+  int i, n_rects;
+
+  if (priv->report_damage_regions && priv->received_damage &&
+      !is_frozen (self) && !priv->unredirected)
+    fetch_damage_region (self);
+
+  if (priv->pending_damage == NULL)
+    return;
+
+  if (priv->unredirected || !priv->window->mapped || priv->needs_pixmap)
+    {
+      g_clear_pointer (&priv->pending_damage, cairo_region_destroy);
+      return;
+    }
+
+  unobscured_region =
+    meta_shaped_texture_has_visible_clones (META_SHAPED_TEXTURE (priv->actor)) ? NULL : priv->unobscured_region;
+
+  n_rects = cairo_region_num_rectangles (priv->pending_damage);
+
+  if (n_rects > MAX_PENDING_DAMAGE_RECTS)
+    {
+      cairo_region_get_extents (priv->pending_damage, &rect);
+      damage_area = (gint64) rect.width * rect.height;
+
+      update_area (self, rect.x, rect.y, rect.width, rect.height);
+      if (meta_shaped_texture_update_area (META_SHAPED_TEXTURE (priv->actor),
+                                           rect.x, rect.y,
+                                           rect.width, rect.height,
+                                           unobscured_region))
+        priv->repaint_scheduled = TRUE;
+    }
+  else
+    {
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_region_get_rectangle (priv->pending_damage, i, &rect);
+          damage_area += (gint64) rect.width * rect.height;
+
+          update_area (self, rect.x, rect.y, rect.width, rect.height);
+          if (meta_shaped_texture_update_area (META_SHAPED_TEXTURE (priv->actor),
+                                               rect.x, rect.y,
+                                               rect.width, rect.height,
+                                               unobscured_region))
+            priv->repaint_scheduled = TRUE;
+        }
+    }
+
+  meta_frame_timings_add_damage (damage_area);
+  priv->counters.damage_pixels += damage_area;
+
+  g_clear_pointer (&priv->pending_damage, cairo_region_destroy);
 }
 
 LOCAL_SYMBOL void
@@ -2429,12 +3407,93 @@ update_corners (MetaWindowActor   *self)
   cairo_region_destroy (corner_region);
 }
 
+#ifdef HAVE_SHAPE
+/* Asks for the client's bounding shape without waiting for it. This is
+ * done as the ShapeNotify comes in, so the reply has arrived by the
+ * time the next frame reshapes the window, instead of the paint making
+ * a round trip; only the request for the latest shape is kept, as the
+ * reshape happens once per frame however many notifies came first.
+ */
+static void
+request_client_shape (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  Display *xdisplay = meta_display_get_xdisplay (priv->screen->display);
+  xcb_connection_t *xcb_conn = XGetXCBConnection (xdisplay);
+
+  g_clear_pointer (&priv->client_shape, cairo_region_destroy);
+
+  if (priv->client_shape_pending)
+    {
+      xcb_discard_reply (xcb_conn, priv->client_shape_cookie.sequence);
+      priv->client_shape_pending = FALSE;
+    }
+
+  if (!priv->window->has_shape)
+    return;
+
+  priv->client_shape_cookie =
+    xcb_shape_get_rectangles (xcb_conn, priv->window->xwindow,
+                              XCB_SHAPE_SK_BOUNDING);
+  priv->client_shape_pending = TRUE;
+
+  xcb_flush (xcb_conn);
+}
+
+/* Returns the client's bounding shape, fetching it only if no request
+ * is on its way and it hasn't changed since it was last fetched */
+static cairo_region_t *
+get_client_shape (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  Display *xdisplay = meta_display_get_xdisplay (priv->screen->display);
+  xcb_connection_t *xcb_conn = XGetXCBConnection (xdisplay);
+  xcb_shape_get_rectangles_reply_t *reply;
+  xcb_generic_error_t *error = NULL;
+  xcb_rectangle_t *rects;
+  int n_rects, i;
+
+  if (priv->client_shape)
+    return priv->client_shape;
+
+  if (!priv->client_shape_pending)
+    request_client_shape (self);
+
+  reply = xcb_shape_get_rectangles_reply (xcb_conn,
+                                          priv->client_shape_cookie,
+                                          &error);
+  priv->client_shape_pending = FALSE;
+
+  /* The window going away is reported here rather than to the error
+   * trap */
+  free (error);
+
+  priv->client_shape = cairo_region_create ();
+
+  if (reply == NULL)
+    return priv->client_shape;
+
+  rects = xcb_shape_get_rectangles_rectangles (reply);
+  n_rects = xcb_shape_get_rectangles_rectangles_length (reply);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect = { rects[i].x, rects[i].y,
+                                     rects[i].width, rects[i].height };
+
+      cairo_region_union_rectangle (priv->client_shape, &rect);
+    }
+
+  free (reply);
+
+  return priv->client_shape;
+}
+#endif
+
 static void
 check_needs_reshape (MetaWindowActor *self)
 {
   MetaWindowActorPrivate *priv = self->priv;
-  MetaScreen *screen = priv->screen;
-  MetaDisplay *display = meta_screen_get_display (screen);
   cairo_region_t *region = NULL;
   cairo_rectangle_int_t client_area;
   gboolean full_mask_reset = priv->window->fullscreen;
@@ -2442,6 +3501,8 @@ check_needs_reshape (MetaWindowActor *self)
   if ((!priv->window->mapped && !priv->window->shaded) || !priv->needs_reshape)
     return;
 
+  priv->counters.mask_updates++;
+
   g_clear_pointer (&priv->shape_region, cairo_region_destroy);
   g_clear_pointer (&priv->shadow_shape, meta_window_shape_unref);
   g_clear_pointer (&priv->opaque_region, cairo_region_destroy);
@@ -2467,38 +3528,24 @@ check_needs_reshape (MetaWindowActor *self)
 #ifdef HAVE_SHAPE
   if (priv->window->has_shape)
     {
-      Display *xdisplay = meta_display_get_xdisplay (display);
-      XRectangle *rects;
-      int n_rects, ordering;
+      cairo_region_t *client_shape;
 
       /* Punch out client area. */
       cairo_region_subtract_rectangle (region, &client_area);
 
-      meta_error_trap_push (display);
-      rects = XShapeGetRectangles (xdisplay,
-                                   priv->window->xwindow,
-                                   ShapeBounding,
-                                   &n_rects,
-                                   &ordering);
-      meta_error_trap_pop (display);
-
-      if (rects)
-        {
-          int i;
-          for (i = 0; i < n_rects; i ++)
-            {
-              cairo_rectangle_int_t rect = { rects[i].x + client_area.x,
-                                             rects[i].y + client_area.y,
-                                             rects[i].width,
-                                             rects[i].height };
-              cairo_region_union_rectangle (region, &rect);
-            }
-          XFree (rects);
-        }
+      client_shape = cairo_region_copy (get_client_shape (self));
+      cairo_region_translate (client_shape, client_area.x, client_area.y);
+      cairo_region_union (region, client_shape);
+      cairo_region_destroy (client_shape);
     }
 #endif
 
-  if (priv->argb32 && priv->window->opaque_region != NULL)
+  if (priv->argb32 && priv->detected_opaque)
+    {
+      priv->opaque_region = cairo_region_create_rectangle (&client_area);
+      cairo_region_intersect (priv->opaque_region, region);
+    }
+  else if (priv->argb32 && priv->window->opaque_region != NULL)
     {
       /* The opaque region is defined to be a part of the
        * window which ARGB32 will always paint with opaque
@@ -2519,6 +3566,9 @@ check_needs_reshape (MetaWindowActor *self)
   else
     priv->opaque_region = cairo_region_reference (region);
 
+  meta_shaped_texture_set_opaque_region (META_SHAPED_TEXTURE (priv->actor),
+                                         priv->opaque_region);
+
   if (priv->window->frame)
     update_corners (self);
   else if (priv->window->has_shape && priv->reshapes == 1)
@@ -2543,6 +3593,11 @@ meta_window_actor_update_shape (MetaWindowActor *self)
   MetaWindowActorPrivate *priv = self->priv;
 
   priv->needs_reshape = TRUE;
+  queue_pre_paint (self);
+
+#ifdef HAVE_SHAPE
+  request_client_shape (self);
+#endif
 
   if (is_frozen (self))
     return;
@@ -2574,6 +3629,10 @@ meta_window_actor_handle_updates (MetaWindowActor *self)
   if (!priv->visible && !priv->needs_pixmap)
     return;
 
+  /* Keep an evicted texture unbound until it is needed */
+  if (!priv->visible && priv->texture_evicted && !priv->texture_wanted)
+    return;
+
   if (priv->received_damage)
     {
       meta_error_trap_push (display);
@@ -2588,15 +3647,146 @@ meta_window_actor_handle_updates (MetaWindowActor *self)
   check_needs_shadow (self);
 }
 
+/* Starts a new stats period if the current one is over; a window
+ * nothing happens to may go several periods without this being called,
+ * so the period then covers all of them */
+static void
+update_stats_period (MetaWindowActor *self,
+                     gint64           now)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+
+  if (now - priv->counters_start < STATS_PERIOD)
+    return;
+
+  if (priv->sync_wait_start != 0)
+    {
+      priv->counters.sync_wait_time += now - priv->sync_wait_start;
+      priv->sync_wait_start = now;
+    }
+
+  priv->last_counters = priv->counters;
+  priv->last_counters_period = now - priv->counters_start;
+
+  memset (&priv->counters, 0, sizeof (priv->counters));
+  priv->counters_start = now;
+}
+
+/**
+ * meta_window_actor_get_stats:
+ * @self: a #MetaWindowActor
+ *
+ * Averages what the window cost the compositor over the last complete
+ * stats period, or over its lifetime when it is younger than one. The
+ * paint share is left at 0 since it depends on the other windows.
+ *
+ * Return value: (transfer full): a new #MetaWindowActorStats
+ */
+LOCAL_SYMBOL MetaWindowActorStats *
+meta_window_actor_get_stats (MetaWindowActor *self)
+{
+  MetaWindowActorPrivate *priv = self->priv;
+  MetaWindowActorStats *stats = g_slice_new0 (MetaWindowActorStats);
+  const MetaWindowActorCounters *counters;
+  gint64 now = g_get_monotonic_time ();
+  double period;
+
+  update_stats_period (self, now);
+
+  if (priv->last_counters_period > 0)
+    {
+      counters = &priv->last_counters;
+      period = priv->last_counters_period / (double) G_USEC_PER_SEC;
+    }
+  else
+    {
+      counters = &priv->counters;
+      period = MAX (now - priv->counters_start, 1) / (double) G_USEC_PER_SEC;
+    }
+
+  stats->window = g_object_ref (priv->window);
+  stats->damage_events = counters->damage_events / period;
+  stats->damage_pixels = counters->damage_pixels / period;
+  stats->upload_bytes = counters->upload_bytes / period;
+  stats->paint_time = counters->paint_time / 1000.0 / period;
+  stats->shadow_updates = counters->shadow_updates / period;
+  stats->mask_updates = counters->mask_updates / period;
+  stats->sync_waits = counters->sync_waits / period;
+  stats->sync_wait_time = counters->sync_wait_time / 1000.0 / period;
+
+  return stats;
+}
+
+/**
+ * meta_window_actor_stats_copy:
+ * @stats: a #MetaWindowActorStats
+ *
+ * Return value: (transfer full): a copy of @stats
+ */
+MetaWindowActorStats *
+meta_window_actor_stats_copy (const MetaWindowActorStats *stats)
+{
+  MetaWindowActorStats *copy = g_slice_dup (MetaWindowActorStats, stats);
+
+  if (copy->window)
+    g_object_ref (copy->window);
+
+  return copy;
+}
+
+/**
+ * meta_window_actor_stats_free:
+ * @stats: a #MetaWindowActorStats
+ */
+void
+meta_window_actor_stats_free (MetaWindowActorStats *stats)
+{
+  g_clear_object (&stats->window);
+  g_slice_free (MetaWindowActorStats, stats);
+}
+
+GType
+meta_window_actor_stats_get_type (void)
+{
+  static GType type_id = 0;
+
+  if (G_UNLIKELY (type_id == 0))
+    type_id = g_boxed_type_register_static (g_intern_static_string ("MetaWindowActorStats"),
+                                            (GBoxedCopyFunc) meta_window_actor_stats_copy,
+                                            (GBoxedFreeFunc) meta_window_actor_stats_free);
+
+  return type_id;
+}
+
+/* Called by the compositor for the window at the head of its
+ * pre-paint queue; the window stays queued, at the tail, as long as
+ * it has updates pending */
 void
 meta_window_actor_pre_paint (MetaWindowActor *self)
 {
-  if (meta_window_actor_is_destroyed (self))
-    return;
+  MetaWindowActorPrivate *priv = self->priv;
+  MetaCompositor *compositor = priv->screen->display->compositor;
 
-  meta_window_actor_handle_updates (self);
+  /* Still marked queued, so redraws we queue below don't requeue us */
+  g_queue_unlink (&compositor->pre_paint_windows, &priv->pre_paint_link);
+
+  if (!meta_window_actor_is_destroyed (self))
+    {
+      if (priv->visible)
+        priv->last_shown_time = g_get_monotonic_time ();
+
+      update_stats_period (self, g_get_monotonic_time ());
 
-  assign_frame_counter_to_frames (self);
+      meta_window_actor_flush_damage (self);
+      meta_window_actor_handle_updates (self);
+
+      assign_frame_counter_to_frames (self);
+    }
+
+  if (has_pending_updates (self))
+    g_queue_push_tail_link (&compositor->pre_paint_windows, &priv->pre_paint_link);
+  else
+    priv->pre_paint_queued = FALSE;
 }
 
 static void
@@ -2605,8 +3795,6 @@ do_send_frame_drawn (MetaWindowActor *self, FrameData *frame)
   MetaWindowActorPrivate *priv = self->priv;
   MetaDisplay *display = meta_screen_get_display (priv->screen);
   MetaWindow *window = meta_window_actor_get_meta_window (self);
-  Display *xdisplay = meta_display_get_xdisplay (display);
-
   XClientMessageEvent ev = { 0, };
 
   frame->frame_drawn_time = meta_compositor_monotonic_time_to_server_time (display,
@@ -2622,10 +3810,7 @@ do_send_frame_drawn (MetaWindowActor *self, FrameData *frame)
   ev.data.l[2] = frame->frame_drawn_time & G_GUINT64_CONSTANT(0xffffffff);
   ev.data.l[3] = frame->frame_drawn_time >> 32;
 
-  meta_error_trap_push (display);
-  XSendEvent (xdisplay, ev.window, False, 0, (XEvent*) &ev);
-  XFlush (xdisplay);
-  meta_error_trap_pop (display);
+  meta_compositor_queue_frame_message (display->compositor, &ev);
 }
 
 
@@ -2643,7 +3828,7 @@ meta_window_actor_post_paint (MetaWindowActor *self)
    * it is obscured, we should wait until timer expiration before
    * sending _NET_WM_FRAME_* messages.
    */
-  if (priv->send_frame_messages_timer == 0 &&
+  if (priv->frame_messages_deadline == 0 &&
       priv->needs_frame_drawn)
     {
       GList *l;
@@ -2669,8 +3854,6 @@ do_send_frame_timings (MetaWindowActor  *self,
   MetaWindowActorPrivate *priv = self->priv;
   MetaDisplay *display = meta_screen_get_display (priv->screen);
   MetaWindow *window = meta_window_actor_get_meta_window (self);
-  Display *xdisplay = meta_display_get_xdisplay (display);
-
   XClientMessageEvent ev = { 0, };
 
   ev.type = ClientMessage;
@@ -2695,10 +3878,7 @@ do_send_frame_timings (MetaWindowActor  *self,
   ev.data.l[3] = refresh_interval;
   ev.data.l[4] = 1000 * META_SYNC_DELAY;
 
-  meta_error_trap_push (display);
-  XSendEvent (xdisplay, ev.window, False, 0, (XEvent*) &ev);
-  XFlush (xdisplay);
-  meta_error_trap_pop (display);
+  meta_compositor_queue_frame_message (display->compositor, &ev);
 }
 
 static void
@@ -2754,6 +3934,8 @@ meta_window_actor_frame_complete (MetaWindowActor  *self,
 
       l = l_next;
     }
+
+  unqueue_frame_timings (self);
 }
 
 LOCAL_SYMBOL void
@@ -2763,6 +3945,7 @@ meta_window_actor_invalidate_shadow (MetaWindowActor *self)
 
   priv->recompute_focused_shadow = TRUE;
   priv->recompute_unfocused_shadow = TRUE;
+  queue_pre_paint (self);
 
   if (is_frozen (self))
     return;
@@ -2804,6 +3987,21 @@ meta_window_actor_set_updates_frozen (MetaWindowActor *self,
   if (priv->updates_frozen != updates_frozen)
     {
       priv->updates_frozen = updates_frozen;
+
+      /* Updates are frozen while we wait for the client to answer a
+       * _NET_WM_SYNC_REQUEST */
+      if (updates_frozen)
+        {
+          priv->counters.sync_waits++;
+          priv->sync_wait_start = g_get_monotonic_time ();
+        }
+      else if (priv->sync_wait_start != 0)
+        {
+          priv->counters.sync_wait_time +=
+            g_get_monotonic_time () - priv->sync_wait_start;
+          priv->sync_wait_start = 0;
+        }
+
       if (updates_frozen)
         meta_window_actor_freeze (self);
       else
@@ -14,6 +14,8 @@
 #include "meta-window-actor-private.h"
 #include "meta-window-group.h"
 #include "meta-background-actor-private.h"
+#include "meta-frame-timings.h"
+#include "region-utils.h"
 
 struct _MetaWindowGroupClass
 {
@@ -87,10 +89,101 @@ painting_untransformed (MetaWindowGroup *window_group,
   return meta_actor_vertices_are_untransformed (vertices, width, height, x_origin, y_origin);
 }
 
+/* Check whether every enabled effect on @actor promises to leave the
+ * actor's opaque pixels where they are and as opaque as they are, so
+ * that it can still occlude the actors beneath it.
+ */
+static gboolean
+effects_preserve_opaque_region (ClutterActor *actor)
+{
+  GList *effects, *l;
+  gboolean result = TRUE;
+
+  effects = clutter_actor_get_effects (actor);
+  for (l = effects; l != NULL; l = l->next)
+    {
+      ClutterEffect *effect = l->data;
+
+      if (clutter_actor_meta_get_enabled (CLUTTER_ACTOR_META (effect)) &&
+          !clutter_effect_preserves_opaque_region (effect))
+        {
+          result = FALSE;
+          break;
+        }
+    }
+  g_list_free (effects);
+
+  return result;
+}
+
+/* Culling for a window actor which is slid or scaled rather than just
+ * translated by whole pixels. Regions going into the actor are rounded
+ * outwards and its obscured region is rounded inwards (with half a pixel
+ * to spare for filtering), so we only ever cull less than we could.
+ */
+static void
+cull_out_axis_aligned_window (MetaWindowActor *window_actor,
+                              gboolean         clip,
+                              cairo_region_t  *unobscured_region,
+                              cairo_region_t  *clip_region)
+{
+  ClutterActor *actor = CLUTTER_ACTOR (window_actor);
+  float x_origin, y_origin, x_scale, y_scale;
+  float x_inverse, y_inverse;
+  cairo_region_t *region;
+
+  if (!meta_actor_is_axis_aligned (actor, &x_origin, &y_origin, &x_scale, &y_scale))
+    return;
+
+  x_inverse = 1 / x_scale;
+  y_inverse = 1 / y_scale;
+
+  if (clip)
+    {
+      region = meta_region_transform_covering (unobscured_region,
+                                               x_inverse, y_inverse,
+                                               - x_origin * x_inverse,
+                                               - y_origin * y_inverse);
+      meta_window_actor_set_unobscured_region (window_actor, region);
+      cairo_region_destroy (region);
+
+      region = meta_region_transform_covering (clip_region,
+                                               x_inverse, y_inverse,
+                                               - x_origin * x_inverse,
+                                               - y_origin * y_inverse);
+      meta_window_actor_set_visible_region (window_actor, region);
+      cairo_region_destroy (region);
+    }
+
+  if (clutter_actor_get_paint_opacity (actor) == 0xff)
+    {
+      cairo_region_t *obscured_region = meta_window_actor_get_obscured_region (window_actor);
+      if (obscured_region)
+        {
+          region = meta_region_transform_interior (obscured_region,
+                                                   x_scale, y_scale,
+                                                   x_origin, y_origin,
+                                                   0.5);
+          cairo_region_subtract (unobscured_region, region);
+          cairo_region_subtract (clip_region, region);
+          cairo_region_destroy (region);
+        }
+    }
+
+  if (clip)
+    {
+      region = meta_region_transform_covering (clip_region,
+                                               x_inverse, y_inverse,
+                                               - x_origin * x_inverse,
+                                               - y_origin * y_inverse);
+      meta_window_actor_set_visible_region_beneath (window_actor, region);
+      cairo_region_destroy (region);
+    }
+}
+
 static void
 meta_window_group_cull_out (MetaWindowGroup *group,
-                            ClutterActor    *unredirected_window,
-                            gboolean         has_unredirected_window,
+                            GList           *unredirected_windows,
                             cairo_region_t  *unobscured_region,
                             cairo_region_t  *clip_region)
 {
@@ -105,30 +198,38 @@ meta_window_group_cull_out (MetaWindowGroup *group,
   clutter_actor_iter_init (&iter, actor);
   while (clutter_actor_iter_prev (&iter, &child))
     {
+      gboolean clip = TRUE;
+
       if (!CLUTTER_ACTOR_IS_VISIBLE (child))
         continue;
 
-      if (has_unredirected_window && child == unredirected_window)
+      if (unredirected_windows && g_list_find (unredirected_windows, child))
         continue;
 
       /* If an actor has effects applied, then that can change the area
        * it paints and the opacity, so we no longer can figure out what
        * portion of the actor is obscured and what portion of the screen
-       * it obscures, so we skip the actor.
+       * it obscures, so we skip the actor - unless all of its effects
+       * declare that they leave the opaque region alone, in which case
+       * it can still obscure what is beneath it.
        *
-       * This has a secondary beneficial effect: if a ClutterOffscreenEffect
+       * Even then we don't clip the actor itself: if a ClutterOffscreenEffect
        * is applied to an actor, then our clipped redraws interfere with the
        * caching of the FBO - even if we only need to draw a small portion
        * of the window right now, ClutterOffscreenEffect may use other portions
-       * of the FBO later. So, skipping actors with effects applied also
-       * prevents these bugs.
+       * of the FBO later.
        *
        * Theoretically, we should check clutter_actor_get_offscreen_redirect()
        * as well for the same reason, but omitted for simplicity in the
        * hopes that no-one will do that.
        */
       if (clutter_actor_has_effects (child))
-        continue;
+        {
+          if (!effects_preserve_opaque_region (child))
+            continue;
+
+          clip = FALSE;
+        }
 
       if (META_IS_WINDOW_ACTOR (child))
         {
@@ -136,14 +237,21 @@ meta_window_group_cull_out (MetaWindowGroup *group,
           int x, y;
 
           if (!meta_actor_is_untransformed (CLUTTER_ACTOR (window_actor), &x, &y))
-            continue;
+            {
+              cull_out_axis_aligned_window (window_actor, clip,
+                                            unobscured_region, clip_region);
+              continue;
+            }
 
           /* Temporarily move to the coordinate system of the actor */
           cairo_region_translate (unobscured_region, - x, - y);
           cairo_region_translate (clip_region, - x, - y);
 
-          meta_window_actor_set_unobscured_region (window_actor, unobscured_region);
-          meta_window_actor_set_visible_region (window_actor, clip_region);
+          if (clip)
+            {
+              meta_window_actor_set_unobscured_region (window_actor, unobscured_region);
+              meta_window_actor_set_visible_region (window_actor, clip_region);
+            }
 
           if (clutter_actor_get_paint_opacity (CLUTTER_ACTOR (window_actor)) == 0xff)
             {
@@ -155,23 +263,38 @@ meta_window_group_cull_out (MetaWindowGroup *group,
                 }
             }
 
-          meta_window_actor_set_visible_region_beneath (window_actor, clip_region);
+          if (clip)
+            meta_window_actor_set_visible_region_beneath (window_actor, clip_region);
 
           cairo_region_translate (unobscured_region, x, y);
           cairo_region_translate (clip_region, x, y);
         }
       else if (META_IS_BACKGROUND_ACTOR (child))
         {
+          float x_origin, y_origin, x_scale, y_scale;
+          cairo_region_t *region;
           int x, y;
 
-          if (!meta_actor_is_untransformed (child, &x, &y))
+          if (!clip)
             continue;
 
-          cairo_region_translate (clip_region, - x, - y);
+          if (meta_actor_is_untransformed (child, &x, &y))
+            {
+              cairo_region_translate (clip_region, - x, - y);
 
-          meta_background_actor_set_visible_region (META_BACKGROUND_ACTOR (child), clip_region);
+              meta_background_actor_set_visible_region (META_BACKGROUND_ACTOR (child), clip_region);
 
-          cairo_region_translate (clip_region, x, y);
+              cairo_region_translate (clip_region, x, y);
+            }
+          else if (meta_actor_is_axis_aligned (child, &x_origin, &y_origin, &x_scale, &y_scale))
+            {
+              region = meta_region_transform_covering (clip_region,
+                                                       1 / x_scale, 1 / y_scale,
+                                                       - x_origin / x_scale,
+                                                       - y_origin / y_scale);
+              meta_background_actor_set_visible_region (META_BACKGROUND_ACTOR (child), region);
+              cairo_region_destroy (region);
+            }
         }
     }
 }
@@ -202,6 +325,20 @@ meta_window_group_reset_culling (MetaWindowGroup *group)
     }
 }
 
+static void
+update_occlusion (MetaWindowGroup *window_group)
+{
+  ClutterActorIter iter;
+  ClutterActor *child;
+
+  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (window_group));
+  while (clutter_actor_iter_next (&iter, &child))
+    {
+      if (META_IS_WINDOW_ACTOR (child))
+        meta_window_actor_update_occlusion (META_WINDOW_ACTOR (child));
+    }
+}
+
 static void
 meta_window_group_paint (ClutterActor *actor)
 {
@@ -213,11 +350,14 @@ meta_window_group_paint (ClutterActor *actor)
   int paint_x_offset, paint_y_offset;
   int paint_x_origin, paint_y_origin;
   int actor_x_origin, actor_y_origin;
+  GList *l;
 
   MetaWindowGroup *window_group = META_WINDOW_GROUP (actor);
   MetaCompositor *compositor = window_group->screen->display->compositor;
   ClutterActor *stage = CLUTTER_STAGE (compositor->stage);
 
+  meta_frame_timings_mark (META_FRAME_PHASE_PAINT);
+
   /* Start off by treating all windows as completely unobscured, so damage anywhere
    * in a window queues redraws, but confine it more below. */
   clutter_actor_iter_init (&iter, actor);
@@ -246,6 +386,7 @@ meta_window_group_paint (ClutterActor *actor)
   if (!painting_untransformed (window_group, &paint_x_origin, &paint_y_origin) ||
       !meta_actor_is_untransformed (actor, &actor_x_origin, &actor_y_origin))
     {
+      update_occlusion (window_group);
       CLUTTER_ACTOR_CLASS (meta_window_group_parent_class)->paint (actor);
       return;
     }
@@ -271,11 +412,10 @@ meta_window_group_paint (ClutterActor *actor)
 
   cairo_region_translate (clip_region, -paint_x_offset, -paint_y_offset);
 
-  gboolean has_unredirected_window = compositor->unredirected_window != NULL;
-  if (has_unredirected_window)
+  for (l = compositor->unredirected_windows; l; l = l->next)
     {
       cairo_rectangle_int_t unredirected_rect;
-      MetaWindow *window = meta_window_actor_get_meta_window (compositor->unredirected_window);
+      MetaWindow *window = meta_window_actor_get_meta_window (l->data);
 
       meta_window_get_outer_rect (window, (MetaRectangle *)&unredirected_rect);
       cairo_region_subtract_rectangle (unobscured_region, &unredirected_rect);
@@ -283,11 +423,12 @@ meta_window_group_paint (ClutterActor *actor)
     }
 
   meta_window_group_cull_out (window_group,
-                              CLUTTER_ACTOR (compositor->unredirected_window),
-                              has_unredirected_window,
+                              compositor->unredirected_windows,
                               unobscured_region,
                               clip_region);
 
+  update_occlusion (window_group);
+
   cairo_region_destroy (unobscured_region);
   cairo_region_destroy (clip_region);
 
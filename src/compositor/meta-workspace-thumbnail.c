@@ -0,0 +1,405 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * meta-workspace-thumbnail.c: Live preview of a workspace
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#include <config.h>
+
+#include <clutter/clutter.h>
+
+#include <meta/common.h>
+#include <meta/compositor-muffin.h>
+#include <meta/meta-window-actor.h>
+#include <meta/meta-workspace-thumbnail.h>
+#include "window-private.h"
+#include "workspace-private.h"
+
+/* The thumbnail holds a clone of the actor of each window shown on the
+ * workspace, under a child scaled down from the size of the screen to
+ * the size of the thumbnail. Painting the windows scaled makes
+ * MetaShapedTexture sample the matching level of their texture towers,
+ * so nothing is read back or drawn with cairo.
+ *
+ * The thumbnail is redirected offscreen, and its paint volume is its
+ * allocation, so a framebuffer the size of the thumbnail caches the
+ * result. Damage to a window reaches its clones and from them the
+ * offscreen redirect, which then renders again only the part of the
+ * framebuffer that changed; when nothing changed the cached image is
+ * painted as it is.
+ */
+
+struct _MetaWorkspaceThumbnailPrivate
+{
+  MetaWorkspace *workspace;
+  MetaScreen *screen;
+
+  /* Scaled from screen coordinates to the thumbnail's */
+  ClutterActor *contents;
+
+  /* Every window with an actor that has been seen, to the clone of its
+   * actor when the window is shown on the workspace, or NULL */
+  GHashTable *windows;
+
+  guint sync_id;
+};
+
+G_DEFINE_TYPE (MetaWorkspaceThumbnail, meta_workspace_thumbnail, CLUTTER_TYPE_ACTOR);
+
+static void queue_sync (MetaWorkspaceThumbnail *self);
+
+static void
+on_window_unmanaged (MetaWindow             *window,
+                     MetaWorkspaceThumbnail *self)
+{
+  MetaWorkspaceThumbnailPrivate *priv = self->priv;
+  ClutterActor *clone = g_hash_table_lookup (priv->windows, window);
+
+  g_signal_handlers_disconnect_by_func (window, queue_sync, self);
+  g_signal_handlers_disconnect_by_func (window, on_window_unmanaged, self);
+
+  if (clone != NULL)
+    clutter_actor_destroy (clone);
+
+  g_hash_table_remove (priv->windows, window);
+}
+
+static void
+watch_window (MetaWorkspaceThumbnail *self,
+              MetaWindow             *window)
+{
+  MetaWorkspaceThumbnailPrivate *priv = self->priv;
+
+  g_hash_table_insert (priv->windows, window, NULL);
+
+  g_signal_connect_swapped (window, "notify::minimized",
+                            G_CALLBACK (queue_sync), self);
+  g_signal_connect_swapped (window, "workspace-changed",
+                            G_CALLBACK (queue_sync), self);
+  g_signal_connect (window, "unmanaged",
+                    G_CALLBACK (on_window_unmanaged), self);
+}
+
+static gboolean
+shows_window (MetaWorkspaceThumbnail *self,
+              MetaWindow             *window)
+{
+  return (!window->minimized &&
+          meta_window_located_on_workspace (window, self->priv->workspace));
+}
+
+static void
+sync_windows (MetaWorkspaceThumbnail *self)
+{
+  MetaWorkspaceThumbnailPrivate *priv = self->priv;
+  ClutterActor *below = NULL;
+  GList *l;
+
+  /* The window actors are listed bottom to top */
+  for (l = meta_get_window_actors (priv->screen); l; l = l->next)
+    {
+      ClutterActor *actor = l->data;
+      MetaWindow *window;
+      gpointer clone;
+
+      window = meta_window_actor_get_meta_window (META_WINDOW_ACTOR (actor));
+
+      if (!g_hash_table_lookup_extended (priv->windows, window, NULL, &clone))
+        {
+          watch_window (self, window);
+          clone = NULL;
+        }
+
+      if (!shows_window (self, window))
+        {
+          if (clone != NULL)
+            {
+              clutter_actor_destroy (clone);
+              g_hash_table_insert (priv->windows, window, NULL);
+            }
+          continue;
+        }
+
+      if (clone == NULL)
+        {
+          clone = clutter_clone_new (actor);
+          clutter_actor_add_constraint (clone,
+                                        clutter_bind_constraint_new (actor,
+                                                                     CLUTTER_BIND_POSITION,
+                                                                     0));
+          clutter_actor_insert_child_above (priv->contents, clone, below);
+          g_hash_table_insert (priv->windows, window, clone);
+        }
+      /* Restacking the clones redraws the whole thumbnail, so leave
+       * the ones already in place alone */
+      else if (clutter_actor_get_previous_sibling (clone) != below)
+        {
+          if (below != NULL)
+            clutter_actor_set_child_above_sibling (priv->contents, clone, below);
+          else
+            clutter_actor_set_child_below_sibling (priv->contents, clone, NULL);
+        }
+
+      below = clone;
+    }
+}
+
+static gboolean
+sync_idle (gpointer data)
+{
+  MetaWorkspaceThumbnail *self = data;
+
+  self->priv->sync_id = 0;
+  sync_windows (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Windows get their actors, and change stacking, workspace or
+ * minimization, in bursts; going over them once is enough */
+static void
+queue_sync (MetaWorkspaceThumbnail *self)
+{
+  MetaWorkspaceThumbnailPrivate *priv = self->priv;
+
+  if (priv->sync_id != 0)
+    return;
+
+  priv->sync_id = g_idle_add_full (META_PRIORITY_BEFORE_REDRAW,
+                                   sync_idle, self, NULL);
+  g_source_set_name_by_id (priv->sync_id, "[muffin] sync_workspace_thumbnail");
+}
+
+static void
+meta_workspace_thumbnail_dispose (GObject *object)
+{
+  MetaWorkspaceThumbnail *self = META_WORKSPACE_THUMBNAIL (object);
+  MetaWorkspaceThumbnailPrivate *priv = self->priv;
+
+  if (priv->sync_id != 0)
+    {
+      g_source_remove (priv->sync_id);
+      priv->sync_id = 0;
+    }
+
+  if (priv->windows != NULL)
+    {
+      GHashTableIter iter;
+      gpointer window;
+
+      g_hash_table_iter_init (&iter, priv->windows);
+      while (g_hash_table_iter_next (&iter, &window, NULL))
+        {
+          g_signal_handlers_disconnect_by_func (window, queue_sync, self);
+          g_signal_handlers_disconnect_by_func (window, on_window_unmanaged, self);
+        }
+
+      g_hash_table_destroy (priv->windows);
+      priv->windows = NULL;
+    }
+
+  if (priv->screen != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (priv->screen, queue_sync, self);
+      priv->screen = NULL;
+    }
+
+  if (priv->workspace != NULL)
+    {
+      g_object_unref (priv->workspace);
+      priv->workspace = NULL;
+    }
+
+  priv->contents = NULL;
+
+  G_OBJECT_CLASS (meta_workspace_thumbnail_parent_class)->dispose (object);
+}
+
+static void
+meta_workspace_thumbnail_get_preferred_width (ClutterActor *actor,
+                                              gfloat        for_height,
+                                              gfloat       *min_width_p,
+                                              gfloat       *natural_width_p)
+{
+  MetaWorkspaceThumbnail *self = META_WORKSPACE_THUMBNAIL (actor);
+  int width, height;
+
+  meta_screen_get_size (self->priv->screen, &width, &height);
+
+  if (min_width_p)
+    *min_width_p = 0;
+  if (natural_width_p)
+    *natural_width_p = for_height >= 0 ? for_height * width / height : width;
+}
+
+static void
+meta_workspace_thumbnail_get_preferred_height (ClutterActor *actor,
+                                               gfloat        for_width,
+                                               gfloat       *min_height_p,
+                                               gfloat       *natural_height_p)
+{
+  MetaWorkspaceThumbnail *self = META_WORKSPACE_THUMBNAIL (actor);
+  int width, height;
+
+  meta_screen_get_size (self->priv->screen, &width, &height);
+
+  if (min_height_p)
+    *min_height_p = 0;
+  if (natural_height_p)
+    *natural_height_p = for_width >= 0 ? for_width * height / width : height;
+}
+
+static void
+meta_workspace_thumbnail_allocate (ClutterActor           *actor,
+                                   const ClutterActorBox  *box,
+                                   ClutterAllocationFlags  flags)
+{
+  MetaWorkspaceThumbnail *self = META_WORKSPACE_THUMBNAIL (actor);
+  MetaWorkspaceThumbnailPrivate *priv = self->priv;
+  ClutterActorBox contents_box;
+  double scale_x, scale_y;
+  int width, height;
+
+  clutter_actor_set_allocation (actor, box, flags);
+
+  meta_screen_get_size (priv->screen, &width, &height);
+
+  contents_box.x1 = 0;
+  contents_box.y1 = 0;
+  contents_box.x2 = width;
+  contents_box.y2 = height;
+  clutter_actor_allocate (priv->contents, &contents_box, flags);
+
+  clutter_actor_get_scale (priv->contents, &scale_x, &scale_y);
+  if (scale_x != clutter_actor_box_get_width (box) / width ||
+      scale_y != clutter_actor_box_get_height (box) / height)
+    clutter_actor_set_scale (priv->contents,
+                             clutter_actor_box_get_width (box) / width,
+                             clutter_actor_box_get_height (box) / height);
+}
+
+static gboolean
+meta_workspace_thumbnail_get_paint_volume (ClutterActor       *actor,
+                                           ClutterPaintVolume *volume)
+{
+  return clutter_paint_volume_set_from_allocation (volume, actor);
+}
+
+/* An unredirected window isn't drawn by the compositor, so its clones
+ * would be left empty */
+static void
+meta_workspace_thumbnail_map (ClutterActor *actor)
+{
+  MetaWorkspaceThumbnail *self = META_WORKSPACE_THUMBNAIL (actor);
+
+  CLUTTER_ACTOR_CLASS (meta_workspace_thumbnail_parent_class)->map (actor);
+
+  meta_disable_unredirect_for_screen (self->priv->screen);
+}
+
+static void
+meta_workspace_thumbnail_unmap (ClutterActor *actor)
+{
+  MetaWorkspaceThumbnail *self = META_WORKSPACE_THUMBNAIL (actor);
+
+  meta_enable_unredirect_for_screen (self->priv->screen);
+
+  CLUTTER_ACTOR_CLASS (meta_workspace_thumbnail_parent_class)->unmap (actor);
+}
+
+static void
+meta_workspace_thumbnail_class_init (MetaWorkspaceThumbnailClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
+
+  g_type_class_add_private (klass, sizeof (MetaWorkspaceThumbnailPrivate));
+
+  object_class->dispose = meta_workspace_thumbnail_dispose;
+
+  actor_class->get_preferred_width = meta_workspace_thumbnail_get_preferred_width;
+  actor_class->get_preferred_height = meta_workspace_thumbnail_get_preferred_height;
+  actor_class->allocate = meta_workspace_thumbnail_allocate;
+  actor_class->get_paint_volume = meta_workspace_thumbnail_get_paint_volume;
+  actor_class->map = meta_workspace_thumbnail_map;
+  actor_class->unmap = meta_workspace_thumbnail_unmap;
+}
+
+static void
+meta_workspace_thumbnail_init (MetaWorkspaceThumbnail *self)
+{
+  MetaWorkspaceThumbnailPrivate *priv;
+
+  priv = self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
+                                                   META_TYPE_WORKSPACE_THUMBNAIL,
+                                                   MetaWorkspaceThumbnailPrivate);
+
+  priv->windows = g_hash_table_new (NULL, NULL);
+
+  priv->contents = clutter_actor_new ();
+  clutter_actor_add_child (CLUTTER_ACTOR (self), priv->contents);
+
+  clutter_actor_set_clip_to_allocation (CLUTTER_ACTOR (self), TRUE);
+  clutter_actor_set_offscreen_redirect (CLUTTER_ACTOR (self),
+                                        CLUTTER_OFFSCREEN_REDIRECT_ALWAYS);
+}
+
+/**
+ * meta_workspace_thumbnail_new:
+ * @workspace: the #MetaWorkspace to show
+ *
+ * Creates an actor showing the windows of @workspace as they are drawn,
+ * scaled to the size of the actor.
+ *
+ * Return value: the newly created workspace thumbnail
+ */
+ClutterActor *
+meta_workspace_thumbnail_new (MetaWorkspace *workspace)
+{
+  MetaWorkspaceThumbnail *self;
+  MetaWorkspaceThumbnailPrivate *priv;
+
+  g_return_val_if_fail (META_IS_WORKSPACE (workspace), NULL);
+
+  self = g_object_new (META_TYPE_WORKSPACE_THUMBNAIL, NULL);
+  priv = self->priv;
+
+  priv->workspace = g_object_ref (workspace);
+  priv->screen = workspace->screen;
+
+  /* New windows are stacked, so this covers them too */
+  g_signal_connect_swapped (priv->screen, "restacked",
+                            G_CALLBACK (queue_sync), self);
+
+  sync_windows (self);
+
+  return CLUTTER_ACTOR (self);
+}
+
+/**
+ * meta_workspace_thumbnail_get_workspace:
+ * @self: a #MetaWorkspaceThumbnail
+ *
+ * Return value: (transfer none): the workspace shown by @self
+ */
+MetaWorkspace *
+meta_workspace_thumbnail_get_workspace (MetaWorkspaceThumbnail *self)
+{
+  g_return_val_if_fail (META_IS_WORKSPACE_THUMBNAIL (self), NULL);
+
+  return self->priv->workspace;
+}
@@ -332,3 +332,104 @@ meta_make_border_region (cairo_region_t *region,
 
   return border_region;
 }
+
+static cairo_region_t *
+transform_region (cairo_region_t *region,
+                  float           x_scale,
+                  float           y_scale,
+                  float           x_offset,
+                  float           y_offset,
+                  float           margin,
+                  gboolean        covering)
+{
+  MetaRegionBuilder builder;
+  int n_rects, i;
+
+  meta_region_builder_init (&builder);
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      float x1, y1, x2, y2;
+      int ix1, iy1, ix2, iy2;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      x1 = (rect.x + margin) * x_scale + x_offset;
+      y1 = (rect.y + margin) * y_scale + y_offset;
+      x2 = (rect.x + rect.width - margin) * x_scale + x_offset;
+      y2 = (rect.y + rect.height - margin) * y_scale + y_offset;
+
+      if (covering)
+        {
+          ix1 = floorf (x1); iy1 = floorf (y1);
+          ix2 = ceilf (x2); iy2 = ceilf (y2);
+        }
+      else
+        {
+          ix1 = ceilf (x1); iy1 = ceilf (y1);
+          ix2 = floorf (x2); iy2 = floorf (y2);
+        }
+
+      if (ix2 > ix1 && iy2 > iy1)
+        meta_region_builder_add_rectangle (&builder,
+                                           ix1, iy1, ix2 - ix1, iy2 - iy1);
+    }
+
+  return meta_region_builder_finish (&builder);
+}
+
+/**
+ * meta_region_transform_covering:
+ * @region: a #cairo_region_t
+ * @x_scale: horizontal scale factor, must be positive
+ * @y_scale: vertical scale factor, must be positive
+ * @x_offset: horizontal offset added after scaling
+ * @y_offset: vertical offset added after scaling
+ *
+ * Maps @region through the given scale and offset, rounding outwards,
+ * so that the result contains every pixel that the image of @region
+ * touches.
+ *
+ * Return value: a new region
+ */
+LOCAL_SYMBOL cairo_region_t *
+meta_region_transform_covering (cairo_region_t *region,
+                                float           x_scale,
+                                float           y_scale,
+                                float           x_offset,
+                                float           y_offset)
+{
+  return transform_region (region, x_scale, y_scale, x_offset, y_offset,
+                           0, TRUE);
+}
+
+/**
+ * meta_region_transform_interior:
+ * @region: a #cairo_region_t
+ * @x_scale: horizontal scale factor, must be positive
+ * @y_scale: vertical scale factor, must be positive
+ * @x_offset: horizontal offset added after scaling
+ * @y_offset: vertical offset added after scaling
+ * @margin: amount, before scaling, by which each rectangle of @region
+ *   is shrunk first
+ *
+ * Maps @region through the given scale and offset, rounding inwards,
+ * so that the result only contains pixels that lie entirely inside the
+ * image of @region. A @margin of half a pixel keeps out pixels which
+ * linear filtering would blend with what lies outside @region.
+ *
+ * Return value: a new region
+ */
+LOCAL_SYMBOL cairo_region_t *
+meta_region_transform_interior (cairo_region_t *region,
+                                float           x_scale,
+                                float           y_scale,
+                                float           x_offset,
+                                float           y_offset,
+                                float           margin)
+{
+  return transform_region (region, x_scale, y_scale, x_offset, y_offset,
+                           margin, FALSE);
+}
@@ -73,4 +73,16 @@ cairo_region_t *meta_make_border_region (cairo_region_t *region,
                                          int             y_amount,
                                          gboolean        flip);
 
+cairo_region_t *meta_region_transform_covering (cairo_region_t *region,
+                                                float           x_scale,
+                                                float           y_scale,
+                                                float           x_offset,
+                                                float           y_offset);
+cairo_region_t *meta_region_transform_interior (cairo_region_t *region,
+                                                float           x_scale,
+                                                float           y_scale,
+                                                float           x_offset,
+                                                float           y_offset,
+                                                float           margin);
+
 #endif /* __META_REGION_UTILS_H__ */
@@ -429,113 +429,94 @@ meta_rectangle_resize_with_gravity (const MetaRectangle *old_rect,
 }
 
 /* Not so simple helper function for get_minimal_spanning_set_for_region() */
-static GList*
-merge_spanning_rects_in_region (GList *region)
+static void
+merge_spanning_rects_in_region (GArray *region)
 {
   /* NOTE FOR ANY OPTIMIZATION PEOPLE OUT THERE: Please see the
    * documentation of get_minimal_spanning_set_for_region() for performance
    * considerations that also apply to this function.
    */
 
-  GList* compare;
-  compare = region;
+  guint compare;
 
-  if (region == NULL)
+  if (region->len == 0)
     {
       meta_warning ("Region to merge was empty!  Either you have a some "
                     "pathological STRUT list or there's a bug somewhere!\n");
-      return NULL;
+      return;
     }
 
-  while (compare && compare->next)
+  compare = 0;
+  while (compare + 1 < region->len)
     {
-      MetaRectangle *a = compare->data;
-      GList *other = compare->next;
+      MetaRectangle *a = &g_array_index (region, MetaRectangle, compare);
+      guint other = compare + 1;
 
       g_assert (a->width > 0 && a->height > 0);
 
-      while (other)
+      while (other < region->len)
         {
-          MetaRectangle *b = other->data;
-          GList *delete_me = NULL;
+          MetaRectangle *b = &g_array_index (region, MetaRectangle, other);
+          gboolean delete_a = FALSE;
+          gboolean delete_b = FALSE;
 
           g_assert (b->width > 0 && b->height > 0);
 
           /* If a contains b, just remove b */
           if (meta_rectangle_contains_rect (a, b))
             {
-              delete_me = other;
+              delete_b = TRUE;
             }
           /* If b contains a, just remove a */
           else if (meta_rectangle_contains_rect (b, a))
             {
-              delete_me = compare;
+              delete_a = TRUE;
             }
           /* If a and b might be mergeable horizontally */
           else if (a->y == b->y && a->height == b->height)
             {
-              /* If a and b overlap */
-              if (meta_rectangle_overlap (a, b))
-                {
-                  int new_x = MIN (a->x, b->x);
-                  a->width = MAX (a->x + a->width, b->x + b->width) - new_x;
-                  a->x = new_x;
-                  delete_me = other;
-                }
-              /* If a and b are adjacent */
-              else if (a->x + a->width == b->x || a->x == b->x + b->width)
+              /* If a and b overlap or are adjacent */
+              if (meta_rectangle_overlap (a, b) ||
+                  a->x + a->width == b->x || a->x == b->x + b->width)
                 {
                   int new_x = MIN (a->x, b->x);
                   a->width = MAX (a->x + a->width, b->x + b->width) - new_x;
                   a->x = new_x;
-                  delete_me = other;
+                  delete_b = TRUE;
                 }
             }
           /* If a and b might be mergeable vertically */
           else if (a->x == b->x && a->width == b->width)
             {
-              /* If a and b overlap */
-              if (meta_rectangle_overlap (a, b))
+              /* If a and b overlap or are adjacent */
+              if (meta_rectangle_overlap (a, b) ||
+                  a->y + a->height == b->y || a->y == b->y + b->height)
                 {
                   int new_y = MIN (a->y, b->y);
                   a->height = MAX (a->y + a->height, b->y + b->height) - new_y;
                   a->y = new_y;
-                  delete_me = other;
-                }
-              /* If a and b are adjacent */
-              else if (a->y + a->height == b->y || a->y == b->y + b->height)
-                {
-                  int new_y = MIN (a->y, b->y);
-                  a->height = MAX (a->y + a->height, b->y + b->height) - new_y;
-                  a->y = new_y;
-                  delete_me = other;
+                  delete_b = TRUE;
                 }
             }
 
-          other = other->next;
-
-          /* Delete any rectangle in the list that is no longer wanted */
-          if (delete_me != NULL)
+          /* Delete any rectangle that is no longer wanted, keeping the
+           * order of the others.  Deleting the rect we compare others to
+           * means starting over with the one after it.
+           */
+          if (delete_a)
             {
-              /* Deleting the rect we compare others to is a little tricker */
-              if (compare == delete_me)
-                {
-                  compare = compare->next;
-                  other = compare->next;
-                  a = compare->data;
-                }
-
-              /* Okay, we can free it now */
-              free (delete_me->data);
-              region = g_list_delete_link (region, delete_me);
+              g_array_remove_index (region, compare);
+              a = &g_array_index (region, MetaRectangle, compare);
+              other = compare + 1;
             }
-
+          else if (delete_b)
+            g_array_remove_index (region, other);
+          else
+            other++;
         }
 
-      compare = compare->next;
+      compare++;
     }
-
-  return region;
 }
 
 /* Simple helper function for get_minimal_spanning_set_for_region()... */
@@ -599,8 +580,8 @@ meta_rectangle_get_minimal_spanning_set_for_region (
   /* NOTE FOR OPTIMIZERS: This function *might* be somewhat slow,
    * especially due to the call to merge_spanning_rects_in_region() (which
    * is O(n^2) where n is the size of the list generated in this function).
-   * This is made more onerous due to the fact that it involves a fair
-   * number of memory allocation and deallocation calls.  However, n is 1
+   * The intermediate rectangles live in arrays, so only the returned list
+   * costs an allocation per rectangle.  In any case, n is 1
    * for default installations of Gnome (because partial struts aren't used
    * by default and only partial struts increase the size of the spanning
    * set generated).  With one partial strut, n will be 2 or 3.  With 2
@@ -632,10 +613,12 @@ meta_rectangle_get_minimal_spanning_set_for_region (
    *     URL splitting.)
    */
 
+  GArray        *rects;
+  GArray        *split_rects;
   GList         *ret;
-  GList         *tmp_list;
   const GSList  *strut_iter;
-  MetaRectangle *temp_rect;
+  MetaRectangle  temp_rect;
+  int            i;
 
   /* The algorithm is basically as follows:
    *   Initialize rectangle_set to basic_rect
@@ -646,80 +629,106 @@ meta_rectangle_get_minimal_spanning_set_for_region (
    *       - Remove the old (pre-split) rectangle from the rectangle_set,
    *         and replace it with the new rectangles generated from the
    *         splitting
+   *
+   * The rectangle sets are kept in two arrays that are swapped for each
+   * strut, so that only the final list has to be allocated.  Each split
+   * set is built in reverse and flipped afterwards, which keeps the order
+   * of the rectangles (and so the answer when merging them below) the
+   * same as when the set used to be built by prepending to a list.
    */
 
-  temp_rect = g_new (MetaRectangle, 1);
-  *temp_rect = *basic_rect;
-  ret = g_list_prepend (NULL, temp_rect);
+  rects = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+  split_rects = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+  g_array_append_val (rects, *basic_rect);
 
   for (strut_iter = all_struts; strut_iter; strut_iter = strut_iter->next)
     {
-      GList *rect_iter;
       MetaStrut *strut = (MetaStrut*)strut_iter->data;
       MetaRectangle *strut_rect = &strut->rect;
+      GArray *tmp;
+      guint j;
 
-      tmp_list = ret;
-      ret = NULL;
-      rect_iter = tmp_list;
-      while (rect_iter)
+      g_array_set_size (split_rects, 0);
+      for (j = 0; j < rects->len; j++)
         {
-          MetaRectangle *rect = (MetaRectangle*) rect_iter->data;
+          MetaRectangle *rect = &g_array_index (rects, MetaRectangle, j);
 
           if (!meta_rectangle_overlap (strut_rect, rect) ||
               !check_strut_align (strut, basic_rect))
-            ret = g_list_prepend (ret, rect);
+            g_array_append_val (split_rects, *rect);
           else
             {
               /* If there is area in rect left of strut */
               if (BOX_LEFT (*rect) < BOX_LEFT (*strut_rect))
                 {
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  temp_rect->width = BOX_LEFT (*strut_rect) - BOX_LEFT (*rect);
-                  ret = g_list_prepend (ret, temp_rect);
+                  temp_rect = *rect;
+                  temp_rect.width = BOX_LEFT (*strut_rect) - BOX_LEFT (*rect);
+                  g_array_append_val (split_rects, temp_rect);
                 }
               /* If there is area in rect right of strut */
               if (BOX_RIGHT (*rect) > BOX_RIGHT (*strut_rect))
                 {
                   int new_x;
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
+                  temp_rect = *rect;
                   new_x = BOX_RIGHT (*strut_rect);
-                  temp_rect->width = BOX_RIGHT(*rect) - new_x;
-                  temp_rect->x = new_x;
-                  ret = g_list_prepend (ret, temp_rect);
+                  temp_rect.width = BOX_RIGHT(*rect) - new_x;
+                  temp_rect.x = new_x;
+                  g_array_append_val (split_rects, temp_rect);
                 }
               /* If there is area in rect above strut */
               if (BOX_TOP (*rect) < BOX_TOP (*strut_rect))
                 {
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  temp_rect->height = BOX_TOP (*strut_rect) - BOX_TOP (*rect);
-                  ret = g_list_prepend (ret, temp_rect);
+                  temp_rect = *rect;
+                  temp_rect.height = BOX_TOP (*strut_rect) - BOX_TOP (*rect);
+                  g_array_append_val (split_rects, temp_rect);
                 }
               /* If there is area in rect below strut */
               if (BOX_BOTTOM (*rect) > BOX_BOTTOM (*strut_rect))
                 {
                   int new_y;
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
+                  temp_rect = *rect;
                   new_y = BOX_BOTTOM (*strut_rect);
-                  temp_rect->height = BOX_BOTTOM (*rect) - new_y;
-                  temp_rect->y = new_y;
-                  ret = g_list_prepend (ret, temp_rect);
+                  temp_rect.height = BOX_BOTTOM (*rect) - new_y;
+                  temp_rect.y = new_y;
+                  g_array_append_val (split_rects, temp_rect);
                 }
-              free (rect);
             }
-          rect_iter = rect_iter->next;
         }
-      g_list_free (tmp_list);
+
+      for (j = 0; j < split_rects->len / 2; j++)
+        {
+          MetaRectangle *front, *back;
+
+          front = &g_array_index (split_rects, MetaRectangle, j);
+          back = &g_array_index (split_rects, MetaRectangle,
+                                 split_rects->len - 1 - j);
+          temp_rect = *front;
+          *front = *back;
+          *back = temp_rect;
+        }
+
+      tmp = rects;
+      rects = split_rects;
+      split_rects = tmp;
     }
 
-  /* Sort by maximal area, just because I feel like it... */
-  ret = g_list_sort (ret, compare_rect_areas);
+  /* Sort by maximal area, just because I feel like it... (the sort is
+   * stable, like the list sort was)
+   */
+  g_array_sort (rects, compare_rect_areas);
 
   /* Merge rectangles if possible so that the list really is minimal */
-  ret = merge_spanning_rects_in_region (ret);
+  merge_spanning_rects_in_region (rects);
+
+  ret = NULL;
+  for (i = rects->len - 1; i >= 0; i--)
+    ret = g_list_prepend (ret,
+                          meta_rectangle_copy (&g_array_index (rects,
+                                                               MetaRectangle,
+                                                               i)));
+
+  g_array_free (rects, TRUE);
+  g_array_free (split_rects, TRUE);
 
   return ret;
 }
@@ -0,0 +1,200 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "cache-stats.h"
+
+typedef struct
+{
+  const char         *name;
+  MetaCacheStatsFunc  stats_func;
+  MetaCacheTrimFunc   trim_func;
+  gpointer            data;
+
+  /* What the sampler saw the first and the last time round */
+  gboolean            sampled;
+  MetaCacheStats      first;
+  MetaCacheStats      last;
+} MetaCache;
+
+static GList *caches = NULL;
+
+static guint sampler_id = 0;
+static gint64 sampler_start = 0;
+
+LOCAL_SYMBOL void
+meta_cache_register (const char         *name,
+                     MetaCacheStatsFunc  stats_func,
+                     MetaCacheTrimFunc   trim_func,
+                     gpointer            data)
+{
+  MetaCache *cache = g_slice_new0 (MetaCache);
+
+  cache->name = name;
+  cache->stats_func = stats_func;
+  cache->trim_func = trim_func;
+  cache->data = data;
+
+  caches = g_list_append (caches, cache);
+}
+
+LOCAL_SYMBOL void
+meta_cache_unregister (const char *name,
+                       gpointer    data)
+{
+  GList *l;
+
+  for (l = caches; l; l = l->next)
+    {
+      MetaCache *cache = l->data;
+
+      if (strcmp (cache->name, name) == 0 && cache->data == data)
+        {
+          caches = g_list_delete_link (caches, l);
+          g_slice_free (MetaCache, cache);
+          return;
+        }
+    }
+
+  g_warning ("Cache \"%s\" was never registered", name);
+}
+
+static void
+get_stats (MetaCache      *cache,
+           MetaCacheStats *stats)
+{
+  memset (stats, 0, sizeof (MetaCacheStats));
+  cache->stats_func (cache->data, stats);
+}
+
+LOCAL_SYMBOL void
+meta_cache_foreach (MetaCacheForeachFunc func,
+                    gpointer             user_data)
+{
+  GList *l;
+
+  for (l = caches; l; l = l->next)
+    {
+      MetaCache *cache = l->data;
+      MetaCacheStats stats;
+
+      get_stats (cache, &stats);
+      func (cache->name, &stats, user_data);
+    }
+}
+
+LOCAL_SYMBOL void
+meta_cache_trim_all (void)
+{
+  GList *l;
+
+  for (l = caches; l; l = l->next)
+    {
+      MetaCache *cache = l->data;
+
+      if (cache->trim_func)
+        cache->trim_func (cache->data);
+    }
+}
+
+/* Counters go back to zero when some caches are cleared */
+static guint64
+counter_delta (guint64 now,
+               guint64 before)
+{
+  return now >= before ? now - before : now;
+}
+
+static gboolean
+sample_caches (gpointer data)
+{
+  gint64 now = g_get_monotonic_time ();
+  double hours = (now - sampler_start) / (3600. * G_USEC_PER_SEC);
+  GList *l;
+
+  g_printerr ("Caches after %.2f hours:\n", hours);
+
+  for (l = caches; l; l = l->next)
+    {
+      MetaCache *cache = l->data;
+      MetaCacheStats stats;
+      guint64 hits, misses;
+      gint64 growth;
+
+      get_stats (cache, &stats);
+
+      /* A cache registered after the first sample starts its trend
+       * when it is first seen */
+      if (!cache->sampled)
+        {
+          cache->first = stats;
+          cache->last = stats;
+          cache->sampled = TRUE;
+        }
+
+      hits = counter_delta (stats.hits, cache->last.hits);
+      misses = counter_delta (stats.misses, cache->last.misses);
+      growth = (gint64) stats.bytes - (gint64) cache->last.bytes;
+
+      g_printerr ("  %-22s %7u entries %9.1f KiB (%+.1f KiB, %+.1f KiB/h)"
+                  " %5.1f%% hits %" G_GUINT64_FORMAT " evictions\n",
+                  cache->name, stats.n_entries, stats.bytes / 1024.,
+                  growth / 1024.,
+                  hours > 0 ?
+                  ((gint64) stats.bytes - (gint64) cache->first.bytes) /
+                  1024. / hours : 0.,
+                  hits + misses > 0 ? 100. * hits / (hits + misses) : 0.,
+                  counter_delta (stats.evictions, cache->last.evictions));
+
+      cache->last = stats;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+LOCAL_SYMBOL void
+meta_cache_start_sampler (guint period)
+{
+  GList *l;
+
+  meta_cache_stop_sampler ();
+
+  for (l = caches; l; l = l->next)
+    ((MetaCache *) l->data)->sampled = FALSE;
+
+  sampler_start = g_get_monotonic_time ();
+
+  /* The first sample sets the baselines */
+  sample_caches (NULL);
+
+  sampler_id = g_timeout_add_seconds (period, sample_caches, NULL);
+  g_source_set_name_by_id (sampler_id, "[muffin] sample_caches");
+}
+
+LOCAL_SYMBOL void
+meta_cache_stop_sampler (void)
+{
+  if (sampler_id != 0)
+    {
+      g_source_remove (sampler_id);
+      sampler_id = 0;
+    }
+}
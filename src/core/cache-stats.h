@@ -0,0 +1,75 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file cache-stats.h  Registry of Muffin's caches
+ *
+ * Every cache that may grow over a long session registers here with
+ * a function reporting its size and effectiveness, and optionally one
+ * dropping whatever it can rebuild later. That lets the caches be
+ * watched and trimmed together: MUFFIN_DEBUG_CACHES=<seconds> logs
+ * their growth periodically, and they are all trimmed when the system
+ * runs low on memory.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#ifndef META_CACHE_STATS_H
+#define META_CACHE_STATS_H
+
+#include <glib.h>
+
+typedef struct
+{
+  guint   n_entries;
+  /* An estimate of the memory the entries take */
+  gsize   bytes;
+  guint64 hits;
+  guint64 misses;
+  guint64 evictions;
+} MetaCacheStats;
+
+/* Fills in @stats, which is zeroed beforehand */
+typedef void (* MetaCacheStatsFunc) (gpointer        data,
+                                     MetaCacheStats *stats);
+/* Drops the entries that aren't in use */
+typedef void (* MetaCacheTrimFunc)  (gpointer        data);
+
+/* @name must be a string literal; @trim_func may be NULL */
+void     meta_cache_register   (const char         *name,
+                                MetaCacheStatsFunc  stats_func,
+                                MetaCacheTrimFunc   trim_func,
+                                gpointer            data);
+void     meta_cache_unregister (const char         *name,
+                                gpointer            data);
+
+typedef void (* MetaCacheForeachFunc) (const char           *name,
+                                       const MetaCacheStats *stats,
+                                       gpointer              user_data);
+
+/* Calls @func with the current stats of every cache, in the order
+ * they were registered */
+void     meta_cache_foreach    (MetaCacheForeachFunc  func,
+                                gpointer              user_data);
+
+void     meta_cache_trim_all   (void);
+
+/* Starts logging the growth of the caches every @period seconds */
+void     meta_cache_start_sampler (guint period);
+void     meta_cache_stop_sampler  (void);
+
+#endif
@@ -236,6 +236,56 @@ static const Constraint all_constraints[] = {
   {NULL,                         NULL}
 };
 
+/* Counts reported by MUFFIN_DEBUG_CONSTRAINTS */
+static struct
+{
+  gint64 period_start;
+  guint  n_constrains;
+  guint  n_already_satisfied;
+  guint  n_evaluations;
+} constraint_stats;
+
+static gboolean
+debug_constraints (void)
+{
+  static int debug = -1;
+
+  if (debug < 0)
+    debug = g_getenv ("MUFFIN_DEBUG_CONSTRAINTS") != NULL;
+
+  return debug;
+}
+
+static void
+update_constraint_stats (gboolean already_satisfied)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  constraint_stats.n_constrains++;
+  if (already_satisfied)
+    constraint_stats.n_already_satisfied++;
+
+  if (constraint_stats.period_start == 0)
+    constraint_stats.period_start = now;
+
+  if (now - constraint_stats.period_start >= G_USEC_PER_SEC)
+    {
+      double seconds = (now - constraint_stats.period_start) /
+                       (double) G_USEC_PER_SEC;
+
+      g_printerr ("Constraints: %.1f constrains/s (%.1f already satisfied), "
+                  "%.1f constraint evaluations/s\n",
+                  constraint_stats.n_constrains / seconds,
+                  constraint_stats.n_already_satisfied / seconds,
+                  constraint_stats.n_evaluations / seconds);
+
+      constraint_stats.period_start = now;
+      constraint_stats.n_constrains = 0;
+      constraint_stats.n_already_satisfied = 0;
+      constraint_stats.n_evaluations = 0;
+    }
+}
+
 static gboolean
 do_all_constraints (MetaWindow         *window,
                     ConstraintInfo     *info,
@@ -249,8 +299,11 @@ do_all_constraints (MetaWindow         *window,
   satisfied = TRUE;
   while (constraint->func != NULL)
     {
-      satisfied = satisfied &&
-                  (*constraint->func) (window, info, priority, check_only);
+      if (satisfied)
+        {
+          satisfied = (*constraint->func) (window, info, priority, check_only);
+          constraint_stats.n_evaluations++;
+        }
 
       if (!check_only)
         {
@@ -285,7 +338,8 @@ meta_window_constrain (MetaWindow          *window,
 {
   ConstraintInfo info;
   ConstraintPriority priority = PRIORITY_MINIMUM;
-  gboolean satisfied = FALSE;
+  gboolean satisfied;
+  gboolean already_satisfied;
 
   /* WARNING: orig and new specify positions and sizes of the inner window,
    * not the outer.  This is a common gotcha since half the constraints
@@ -307,6 +361,14 @@ meta_window_constrain (MetaWindow          *window,
                          new);
   place_window_if_needed (window, &info);
 
+  /* Most of the time the new geometry already satisfies everything, and
+   * enforcing a satisfied constraint leaves the geometry alone (see the
+   * skeleton at the top of this file), so enforcing them all only to
+   * check them again would be wasted work.
+   */
+  already_satisfied = do_all_constraints (window, &info, priority, TRUE);
+  satisfied = already_satisfied;
+
   while (!satisfied && priority <= PRIORITY_MAXIMUM) {
     gboolean check_only = TRUE;
 
@@ -331,6 +393,9 @@ meta_window_constrain (MetaWindow          *window,
    */
   update_onscreen_requirements (window, &info);
 
+  if (G_UNLIKELY (debug_constraints ()))
+    update_constraint_stats (already_satisfied);
+
   /* Ew, what an ugly way to do things.  Destructors (in a real OOP language,
    * not gobject-style--gobject would be more pain than it's worth) or
    * smart pointers would be so much nicer here.  *shrug*
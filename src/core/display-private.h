@@ -34,6 +34,7 @@
 #include <glib.h>
 #include <X11/Xlib.h>
 #include "eventqueue.h"
+#include "request-profiler.h"
 #include <meta/common.h>
 #include <meta/boxes.h>
 #include <meta/display.h>
@@ -54,6 +55,7 @@ typedef struct _MetaUISlave    MetaUISlave;
 
 typedef struct _MetaGroupPropHooks  MetaGroupPropHooks;
 typedef struct _MetaWindowPropHooks MetaWindowPropHooks;
+typedef struct _MetaErrorTraps      MetaErrorTraps;
 
 typedef struct MetaEdgeResistanceData MetaEdgeResistanceData;
 
@@ -139,6 +141,10 @@ struct _MetaDisplay
   GSList *screens;
   MetaScreen *active_screen;
   GHashTable *window_ids;
+  /* Every MetaWindow, override-redirect ones included, in the order
+   * they were managed, linked through their display_link; unlike
+   * window_ids it holds each window once */
+  GQueue windows;
   int error_traps;
   int (* error_trap_handler) (Display     *display,
                               XErrorEvent *error);  
@@ -165,6 +171,10 @@ struct _MetaDisplay
   /* Pings which we're waiting for a reply from */
   GSList     *pending_pings;
 
+  /* Windows whose geometry-changed is emitted before the next redraw */
+  GSList     *geometry_changed_windows;
+  guint       geometry_changed_later;
+
   /* Pending autoraise */
   guint       autoraise_timeout_id;
   MetaWindow* autoraise_window;
@@ -199,6 +209,10 @@ struct _MetaDisplay
   MetaResizePopup *grab_resize_popup;
   GTimeVal    grab_last_moveresize_time;
   guint32     grab_motion_notify_time;
+  /* the motion waiting for meta_window_flush_grab_motion() */
+  guint       grab_motion_pending : 1;
+  guint       grab_motion_pending_shift : 1;
+  guint       grab_motion_pending_snap : 1;
   GList*      grab_old_window_stacking;
   MetaEdgeResistanceData *grab_edge_resistance_data;
   unsigned int grab_last_user_action_was_snap;
@@ -217,6 +231,13 @@ struct _MetaDisplay
   /* Keybindings stuff */
   MetaKeyBinding *key_bindings;
   int             n_key_bindings;
+  /* (keycode, mask) => GPtrArray of MetaKeyBinding*, in table order */
+  GHashTable     *key_bindings_index;
+  /* (keycode, mask) => keysym of the grabs currently in place on the
+   * screens and on windows, so that regrabbing only touches changes */
+  GHashTable     *grabbed_screen_keys;
+  GHashTable     *grabbed_window_keys;
+  unsigned int    grabbed_ignored_mask;
   int             min_keycode;
   int             max_keycode;
   KeySym *keymap;
@@ -253,6 +274,9 @@ struct _MetaDisplay
   GHashTable *prop_hooks;
   int n_prop_hooks;
 
+  /* Managed by xprops.c */
+  GHashTable *prefetched_props;
+
   /* Managed by group-props.c */
   MetaGroupPropHooks *group_prop_hooks;
 
@@ -308,6 +332,30 @@ struct _MetaDisplay
 
   guint shadows_enabled : 1;
   guint debug_button_grabs : 1;
+
+  /* Managed by display.c: requests that don't need a reply are left in
+   * Xlib's output buffer and flushed once per main loop iteration by
+   * flush_source, unless MUFFIN_NO_BATCH_REQUESTS is set.
+   */
+  GSource *flush_source;
+  guint batch_requests : 1;
+  guint flush_pending : 1;
+
+  /* Round trips made while handling the current event, logged
+   * under META_DEBUG_ROUND_TRIPS.
+   */
+  guint round_trips;
+
+  /* NULL unless running with --profile-x-requests */
+  MetaRequestProfiler *request_profiler;
+  guint request_profiler_dump_id;
+
+  /* Serials of the error traps, see errors.c */
+  MetaErrorTraps *async_error_traps;
+
+  /* Lookups in the per-size icons of the windows */
+  guint64 n_icon_hits;
+  guint64 n_icon_misses;
 };
 
 struct _MetaDisplayClass
@@ -340,6 +388,14 @@ MetaScreen*   meta_display_screen_for_xwindow  (MetaDisplay *display,
 void          meta_display_grab                (MetaDisplay *display);
 void          meta_display_ungrab              (MetaDisplay *display);
 
+void          meta_display_flush               (MetaDisplay *display);
+void          meta_display_note_round_trip     (MetaDisplay *display);
+
+/* In errors.c */
+void          meta_error_traps_init            (MetaDisplay *display);
+void          meta_error_traps_free            (MetaDisplay *display);
+void          meta_error_traps_dispatch        (MetaDisplay *display);
+
 void          meta_display_unmanage_windows_for_screen (MetaDisplay *display,
                                                         MetaScreen  *screen,
                                                         guint32      timestamp);
@@ -398,8 +454,9 @@ void meta_display_grab_focus_window_button   (MetaDisplay *display,
 void meta_display_ungrab_focus_window_button (MetaDisplay *display,
                                               MetaWindow  *window);
 
-/* Next function is defined in edge-resistance.c */
+/* Next functions are defined in edge-resistance.c */
 void meta_display_cleanup_edges              (MetaDisplay *display);
+void meta_display_end_grab_edges             (MetaDisplay *display);
 
 /* make a request to ensure the event serial has changed */
 void     meta_display_increment_event_serial (MetaDisplay *display);
@@ -448,6 +505,13 @@ guint meta_display_get_above_tab_keycode (MetaDisplay *display);
 
 void meta_display_notify_restart (MetaDisplay *display);
 
+void meta_restart_save_state    (MetaDisplay *display);
+void meta_restart_restore_state (MetaScreen  *screen);
+
 void meta_display_update_sync_state (MetaSyncMethod method);
 
+void meta_display_update_geometric_picking (void);
+void meta_display_update_density_mode (void);
+void meta_display_update_color_filter (void);
+
 #endif
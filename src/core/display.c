@@ -80,6 +80,13 @@
 #include <X11/extensions/Xfixes.h>
 #include <string.h>
 #include <unistd.h>
+#include <signal.h>
+#include <glib-unix.h>
+#include "util-private.h"
+#include "trace-private.h"
+#include "startup-trace.h"
+#include "cache-stats.h"
+#include "wakeup-audit.h"
 
 #define GRAB_OP_IS_WINDOW_SWITCH(g)                     \
         (g == META_GRAB_OP_KEYBOARD_TABBING_NORMAL  ||  \
@@ -172,6 +179,8 @@ static void   meta_spew_event           (MetaDisplay    *display,
 
 static gboolean event_callback          (XEvent         *event,
                                          gpointer        data);
+static GSource *flush_source_new        (MetaDisplay    *display);
+static gboolean dump_request_profile    (gpointer        data);
 static Window event_get_modified_window (MetaDisplay    *display,
                                          XEvent         *event);
 static guint32 event_get_time           (MetaDisplay    *display,
@@ -188,8 +197,9 @@ static void    process_selection_clear   (MetaDisplay   *display,
 static void    update_window_grab_modifiers (MetaDisplay *display);
 static void    update_mouse_zoom_modifiers (MetaDisplay *display);
 
-static void    prefs_changed_callback    (MetaPreference pref,
-                                          void          *data);
+static void    prefs_changed_callback    (const MetaPreference *prefs,
+                                          int                   n_prefs,
+                                          void                 *data);
 
 static void    sanity_check_timestamps   (MetaDisplay *display,
                                           guint32      known_good_timestamp);
@@ -450,8 +460,10 @@ enable_compositor (MetaDisplay *display,
     {
       MetaScreen *screen = list->data;
 
+      meta_startup_trace_begin ("meta_compositor_manage_screen");
       meta_compositor_manage_screen (screen->display->compositor,
 				     screen);
+      meta_startup_trace_end ("meta_compositor_manage_screen");
 
       if (composite_windows)
         meta_screen_composite_all_windows (screen);
@@ -465,6 +477,55 @@ meta_display_init (MetaDisplay *disp)
    * but it doesn't really matter. */
 }
 
+static void
+get_icon_cache_stats (gpointer        data,
+                      MetaCacheStats *stats)
+{
+  MetaDisplay *display = data;
+  GSList *windows, *l;
+
+  windows = meta_display_list_windows (display, META_LIST_DEFAULT);
+  for (l = windows; l; l = l->next)
+    {
+      MetaWindow *window = l->data;
+      GHashTableIter iter;
+      GdkPixbuf *icon;
+
+      if (window->icons_by_size == NULL)
+        continue;
+
+      g_hash_table_iter_init (&iter, window->icons_by_size);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &icon))
+        {
+          stats->n_entries++;
+          stats->bytes += (gsize) gdk_pixbuf_get_rowstride (icon) *
+                                  gdk_pixbuf_get_height (icon);
+        }
+    }
+  g_slist_free (windows);
+
+  stats->hits = display->n_icon_hits;
+  stats->misses = display->n_icon_misses;
+}
+
+/* The icons are read again from the windows when next asked for */
+static void
+trim_icon_cache (gpointer data)
+{
+  MetaDisplay *display = data;
+  GSList *windows, *l;
+
+  windows = meta_display_list_windows (display, META_LIST_DEFAULT);
+  for (l = windows; l; l = l->next)
+    {
+      MetaWindow *window = l->data;
+
+      if (window->icons_by_size)
+        g_hash_table_remove_all (window->icons_by_size);
+    }
+  g_slist_free (windows);
+}
+
 /*
  * Opens a new display, sets it up, initialises all the X extensions
  * we will need, and adds it to the list of displays.
@@ -520,6 +581,8 @@ meta_display_open (void)
   the_display->name = g_strdup (XDisplayName (NULL));
   the_display->xdisplay = xdisplay;
   the_display->gdk_display = gdk_display_get_default();
+  meta_error_traps_init (the_display);
+  meta_wakeup_audit_init (xdisplay);
   the_display->gdk_device = gdk_seat_get_pointer (gdk_display_get_default_seat (the_display->gdk_display));
 
   if (gethostname (buf, sizeof(buf)-1) == 0)
@@ -555,13 +618,18 @@ meta_display_open (void)
 
   meta_bell_init (the_display);
 
+  meta_startup_trace_begin ("meta_display_init_keys");
   meta_display_init_keys (the_display);
+  meta_startup_trace_end ("meta_display_init_keys");
 
   update_window_grab_modifiers (the_display);
   update_mouse_zoom_modifiers (the_display);
   the_display->mouse_zoom_enabled = meta_prefs_get_mouse_zoom_enabled ();
 
-  meta_prefs_add_listener (prefs_changed_callback, the_display);
+  meta_prefs_add_batch_listener (prefs_changed_callback, the_display);
+
+  meta_cache_register ("window icons",
+                       get_icon_cache_stats, trim_icon_cache, the_display);
 
   meta_verbose ("Creating %d atoms\n", (int) G_N_ELEMENTS (atom_names));
   XInternAtoms (the_display->xdisplay, atom_names, G_N_ELEMENTS (atom_names),
@@ -587,6 +655,7 @@ meta_display_open (void)
   the_display->monitor_cache_invalidated = TRUE;
 
   the_display->groups_by_leader = NULL;
+  the_display->prefetched_props = NULL;
 
   the_display->window_with_menu = NULL;
   the_display->window_menu = NULL;
@@ -609,6 +678,7 @@ meta_display_open (void)
 
   the_display->window_ids = g_hash_table_new (meta_unsigned_long_hash,
                                           meta_unsigned_long_equal);
+  g_queue_init (&the_display->windows);
 
   i = 0;
   while (i < N_IGNORED_CROSSING_SERIALS)
@@ -877,6 +947,20 @@ meta_display_open (void)
   the_display->shadows_enabled = g_getenv ("MUFFIN_NO_SHADOWS") == NULL;
   the_display->debug_button_grabs = g_getenv ("MUFFIN_DEBUG_BUTTON_GRABS") != NULL;
 
+  the_display->batch_requests = g_getenv ("MUFFIN_NO_BATCH_REQUESTS") == NULL;
+  the_display->flush_pending = FALSE;
+  the_display->round_trips = 0;
+  the_display->flush_source = flush_source_new (the_display);
+
+  the_display->request_profiler = NULL;
+  the_display->request_profiler_dump_id = 0;
+  if (meta_is_profiling_requests ())
+    {
+      the_display->request_profiler = meta_request_profiler_new ();
+      the_display->request_profiler_dump_id =
+        g_unix_signal_add (SIGUSR1, dump_request_profile, the_display);
+    }
+
   screens = NULL;
 
   i = 0;
@@ -884,7 +968,9 @@ meta_display_open (void)
     {
       MetaScreen *screen;
 
+      meta_startup_trace_begin ("meta_screen_new");
       screen = meta_screen_new (the_display, i, timestamp);
+      meta_startup_trace_end ("meta_screen_new");
 
       if (screen)
         screens = g_slist_prepend (screens, screen);
@@ -909,7 +995,9 @@ meta_display_open (void)
   /* We don't composite the windows here because they will be composited
      faster with the call to meta_screen_manage_all_windows further down
      the code */
+  meta_startup_trace_begin ("compositor init");
   enable_compositor (the_display, FALSE);
+  meta_startup_trace_end ("compositor init");
 
   meta_display_grab (the_display);
 
@@ -919,7 +1007,11 @@ meta_display_open (void)
     {
       MetaScreen *screen = tmp->data;
 
+      meta_startup_trace_begin ("meta_screen_manage_all_windows");
       meta_screen_manage_all_windows (screen);
+      meta_startup_trace_end ("meta_screen_manage_all_windows");
+
+      meta_restart_restore_state (screen);
 
       tmp = tmp->next;
     }
@@ -949,17 +1041,6 @@ meta_display_open (void)
   return TRUE;
 }
 
-static gint
-ptrcmp (gconstpointer a, gconstpointer b)
-{
-  if (a < b)
-    return -1;
-  else if (a > b)
-    return 1;
-  else
-    return 0;
-}
-
 /**
  * meta_display_list_windows:
  * @display: a #MetaDisplay
@@ -976,59 +1057,19 @@ meta_display_list_windows (MetaDisplay          *display,
                            MetaListWindowsFlags  flags)
 {
   GSList *winlist;
-  GSList *tmp;
-  GSList *prev;
-  GHashTableIter iter;
-  gpointer key, value;
+  GList *l;
 
   winlist = NULL;
 
-  g_hash_table_iter_init (&iter, display->window_ids);
-  while (g_hash_table_iter_next (&iter, &key, &value))
+  for (l = display->windows.tail; l; l = l->prev)
     {
-      MetaWindow *window = value;
+      MetaWindow *window = l->data;
 
       if (!window->override_redirect ||
           (flags & META_LIST_INCLUDE_OVERRIDE_REDIRECT) != 0)
         winlist = g_slist_prepend (winlist, window);
     }
 
-  /* Uniquify the list, since both frame windows and plain
-   * windows are in the hash
-   */
-  winlist = g_slist_sort (winlist, ptrcmp);
-
-  prev = NULL;
-  tmp = winlist;
-  while (tmp != NULL)
-    {
-      GSList *next;
-
-      next = tmp->next;
-
-      if (next &&
-          next->data == tmp->data)
-        {
-          /* Delete tmp from list */
-
-          if (prev)
-            prev->next = next;
-
-          if (tmp == winlist)
-            winlist = next;
-
-          g_slist_free_1 (tmp);
-
-          /* leave prev unchanged */
-        }
-      else
-        {
-          prev = tmp;
-        }
-
-      tmp = next;
-    }
-
   return winlist;
 }
 
@@ -1051,13 +1092,16 @@ meta_display_close (MetaDisplay *display,
 
   display->closing += 1;
 
-  meta_prefs_remove_listener (prefs_changed_callback, display);
+  meta_prefs_remove_batch_listener (prefs_changed_callback, display);
+  meta_cache_unregister ("window icons", display);
 
   meta_display_remove_autoraise_callback (display);
 
   if (display->grab_old_window_stacking)
     g_list_free (display->grab_old_window_stacking);
 
+  meta_display_cleanup_edges (display);
+
   /* Stop caring about events */
   meta_ui_remove_event_func (display->xdisplay,
                              event_callback,
@@ -1091,6 +1135,19 @@ meta_display_close (MetaDisplay *display,
   if (display->leader_window != None)
     XDestroyWindow (display->xdisplay, display->leader_window);
 
+  g_source_destroy (display->flush_source);
+  g_source_unref (display->flush_source);
+  display->flush_source = NULL;
+
+  if (display->request_profiler)
+    {
+      g_source_remove (display->request_profiler_dump_id);
+      meta_request_profiler_dump (display->request_profiler);
+      meta_request_profiler_free (display->request_profiler);
+      display->request_profiler = NULL;
+    }
+
+  meta_error_traps_free (display);
   XFlush (display->xdisplay);
 
   meta_display_free_window_prop_hooks (display);
@@ -1213,6 +1270,111 @@ meta_display_ungrab (MetaDisplay *display)
                 display->server_grab_count);
 }
 
+typedef struct
+{
+  GSource source;
+  MetaDisplay *display;
+} MetaFlushSource;
+
+/* Runs before the main loop blocks, after everything dispatched in the
+ * previous iteration has queued its requests, so they go out together.
+ */
+static gboolean
+flush_source_prepare (GSource *source,
+                      gint    *timeout)
+{
+  MetaDisplay *display = ((MetaFlushSource *) source)->display;
+
+  *timeout = -1;
+
+  if (display->flush_pending)
+    {
+      display->flush_pending = FALSE;
+      XFlush (display->xdisplay);
+    }
+
+  return FALSE;
+}
+
+static gboolean
+flush_source_check (GSource *source)
+{
+  return FALSE;
+}
+
+static gboolean
+flush_source_dispatch (GSource     *source,
+                       GSourceFunc  callback,
+                       gpointer     user_data)
+{
+  return TRUE;
+}
+
+static GSourceFuncs flush_source_funcs = {
+  flush_source_prepare,
+  flush_source_check,
+  flush_source_dispatch
+};
+
+static GSource *
+flush_source_new (MetaDisplay *display)
+{
+  GSource *source;
+
+  source = g_source_new (&flush_source_funcs, sizeof (MetaFlushSource));
+  ((MetaFlushSource *) source)->display = display;
+
+  /* Sources are prepared in priority order and preparation stops at
+   * the first ready one, so go first to be sure to run every iteration.
+   */
+  g_source_set_priority (source, G_MININT);
+  g_source_attach (source, NULL);
+
+  return source;
+}
+
+/**
+ * meta_display_flush:
+ * @display: a #MetaDisplay
+ *
+ * Makes sure the requests queued so far are sent to the server.  When
+ * request batching is on (the default) this only happens once the
+ * current main loop iteration is done, together with everything else
+ * queued in the meantime; use XFlush() directly where the requests
+ * can't wait.
+ */
+LOCAL_SYMBOL void
+meta_display_flush (MetaDisplay *display)
+{
+  if (display->batch_requests)
+    display->flush_pending = TRUE;
+  else
+    XFlush (display->xdisplay);
+}
+
+/**
+ * meta_display_note_round_trip:
+ * @display: a #MetaDisplay
+ *
+ * Records that we just waited on the server, so expensive event handlers
+ * show up under META_DEBUG_ROUND_TRIPS.
+ */
+LOCAL_SYMBOL void
+meta_display_note_round_trip (MetaDisplay *display)
+{
+  display->round_trips += 1;
+}
+
+static gboolean
+dump_request_profile (gpointer data)
+{
+  MetaDisplay *display = data;
+
+  meta_request_profiler_dump (display->request_profiler);
+
+  return TRUE;
+}
+
 /*
  * Returns the singleton MetaDisplay if "xdisplay" matches the X display it's
  * managing; otherwise gives a warning and returns NULL.  When we were claiming
@@ -1432,6 +1594,9 @@ meta_display_get_current_time_roundtrip (MetaDisplay *display)
   if (timestamp == CurrentTime)
     {
       XEvent property_event;
+      gint64 start;
+
+      start = meta_request_profiler_begin (display->request_profiler);
 
       /* Using the property XA_PRIMARY because it's safe; nothing
        * would use it as a property. The type doesn't matter.
@@ -1445,6 +1610,11 @@ meta_display_get_current_time_roundtrip (MetaDisplay *display)
                     PropertyChangeMask,
                     &property_event);
       timestamp = property_event.xproperty.time;
+
+      meta_request_profiler_end (display->request_profiler,
+                                 META_REQUEST_TIMESTAMP,
+                                 META_REQUEST_CALLER, start);
+      meta_display_note_round_trip (display);
     }
 
   sanity_check_timestamps (display, timestamp);
@@ -1589,6 +1759,18 @@ meta_display_queue_autoraise_callback (MetaDisplay *display,
 {
   MetaAutoRaiseData *auto_raise_data;
 
+  if (display->autoraise_timeout_id != 0) {
+    g_source_remove (display->autoraise_timeout_id);
+    display->autoraise_timeout_id = 0;
+  }
+
+  /* The callback would only find there is nothing to raise */
+  if (meta_stack_get_top (window->screen->stack) == window)
+    {
+      display->autoraise_window = NULL;
+      return;
+    }
+
   meta_topic (META_DEBUG_FOCUS,
               "Queuing an autoraise timeout for %s with delay %d\n",
               window->desc,
@@ -1598,11 +1780,6 @@ meta_display_queue_autoraise_callback (MetaDisplay *display,
   auto_raise_data->display = window->display;
   auto_raise_data->xwindow = window->xwindow;
 
-  if (display->autoraise_timeout_id != 0) {
-    g_source_remove (display->autoraise_timeout_id);
-    display->autoraise_timeout_id = 0;
-  }
-
   display->autoraise_timeout_id =
     g_timeout_add_full (G_PRIORITY_DEFAULT,
                         meta_prefs_get_auto_raise_delay (),
@@ -1612,6 +1789,149 @@ meta_display_queue_autoraise_callback (MetaDisplay *display,
   display->autoraise_window = window;
 }
 
+/* Timings reported by MUFFIN_DEBUG_EVENT_STATS. Each latency is counted
+ * in the bucket given by its bit length in microseconds, so bucket i
+ * holds latencies below 2^i us.
+ */
+#define EVENT_STATS_PERIOD    (10 * G_USEC_PER_SEC)
+#define EVENT_STATS_N_BUCKETS 16
+/* Events of extensions such as XKB, Damage or Sync share the last slot */
+#define EVENT_STATS_N_TYPES   (LASTEvent + 1)
+
+typedef struct
+{
+  guint  n_events;
+  /* Pointer events on client windows nothing acted on */
+  guint  n_unused;
+  gint64 total_us;
+  gint64 max_us;
+  guint  histogram[EVENT_STATS_N_BUCKETS];
+} EventTimings;
+
+static struct
+{
+  gint64       period_start;
+  EventTimings dispatch[EVENT_STATS_N_TYPES];
+  EventTimings compositor;
+  EventTimings property_notify;
+} event_stats;
+
+static const char * const event_type_names[EVENT_STATS_N_TYPES] = {
+  NULL, NULL, "KeyPress", "KeyRelease", "ButtonPress", "ButtonRelease",
+  "MotionNotify", "EnterNotify", "LeaveNotify", "FocusIn", "FocusOut",
+  "KeymapNotify", "Expose", "GraphicsExpose", "NoExpose",
+  "VisibilityNotify", "CreateNotify", "DestroyNotify", "UnmapNotify",
+  "MapNotify", "MapRequest", "ReparentNotify", "ConfigureNotify",
+  "ConfigureRequest", "GravityNotify", "ResizeRequest", "CirculateNotify",
+  "CirculateRequest", "PropertyNotify", "SelectionClear",
+  "SelectionRequest", "SelectionNotify", "ColormapNotify", "ClientMessage",
+  "MappingNotify", "GenericEvent", "(extension)"
+};
+
+static gboolean
+debug_event_stats (void)
+{
+  static int debug = -1;
+
+  if (debug < 0)
+    debug = g_getenv ("MUFFIN_DEBUG_EVENT_STATS") != NULL;
+
+  return debug;
+}
+
+static void
+event_timings_add (EventTimings *timings,
+                   gint64        start,
+                   gint64        end)
+{
+  gint64 us = end - start;
+
+  timings->n_events++;
+  timings->total_us += us;
+  timings->max_us = MAX (timings->max_us, us);
+  timings->histogram[MIN (g_bit_storage (us),
+                          EVENT_STATS_N_BUCKETS - 1)]++;
+}
+
+/* Returns the upper bound of the bucket holding the given percentile */
+static gint64
+event_timings_percentile (const EventTimings *timings,
+                          guint               percent)
+{
+  guint target = (timings->n_events * percent + 99) / 100;
+  guint seen = 0;
+  int i;
+
+  for (i = 0; i < EVENT_STATS_N_BUCKETS - 1; i++)
+    {
+      seen += timings->histogram[i];
+      if (seen >= target)
+        return (gint64) 1 << i;
+    }
+
+  return timings->max_us;
+}
+
+static void
+print_event_timings (const char         *name,
+                     const EventTimings *timings,
+                     double              seconds)
+{
+  if (timings->n_events == 0)
+    return;
+
+  g_printerr ("  %-18s %8.1f/s  mean %6.1fus  p50 <%" G_GINT64_FORMAT
+              "us  p99 <%" G_GINT64_FORMAT "us  max %" G_GINT64_FORMAT "us",
+              name,
+              timings->n_events / seconds,
+              timings->total_us / (double) timings->n_events,
+              event_timings_percentile (timings, 50),
+              event_timings_percentile (timings, 99),
+              timings->max_us);
+
+  if (timings->n_unused > 0)
+    g_printerr ("  unused %.1f/s", timings->n_unused / seconds);
+
+  g_printerr ("\n");
+}
+
+static void
+update_event_stats (int      event_type,
+                    gint64   start,
+                    gboolean unused)
+{
+  gint64 now = g_get_monotonic_time ();
+  int i;
+
+  if (event_type < 0 || event_type >= LASTEvent)
+    event_type = LASTEvent;
+
+  event_timings_add (&event_stats.dispatch[event_type], start, now);
+  if (unused)
+    event_stats.dispatch[event_type].n_unused++;
+
+  if (event_stats.period_start == 0)
+    event_stats.period_start = start;
+
+  if (now - event_stats.period_start >= EVENT_STATS_PERIOD)
+    {
+      double seconds = (now - event_stats.period_start) /
+                       (double) G_USEC_PER_SEC;
+
+      g_printerr ("Event processing over the last %.1fs:\n", seconds);
+      for (i = 0; i < EVENT_STATS_N_TYPES; i++)
+        if (event_type_names[i] != NULL)
+          print_event_timings (event_type_names[i],
+                               &event_stats.dispatch[i], seconds);
+      print_event_timings ("compositor", &event_stats.compositor, seconds);
+      print_event_timings ("property notify", &event_stats.property_notify,
+                           seconds);
+
+      memset (&event_stats, 0, sizeof (event_stats));
+      event_stats.period_start = now;
+    }
+}
+
 /*
  * This is the most important function in the whole program. It is the heart,
  * it is the nexus, it is the Grand Central Station of Muffin's world.
@@ -1638,20 +1958,47 @@ event_callback (XEvent   *event,
   gboolean frame_was_receiver;
   gboolean bypass_compositor;
   gboolean filter_out_event;
+  gboolean pointer_event_unused = FALSE;
+  gint64 start_time = 0;
 
   display = data;
 
+  META_TRACE2 (event_start, event->type, event->xany.window);
+
+  if (G_UNLIKELY (debug_event_stats ()))
+    start_time = g_get_monotonic_time ();
+
+  /* The event is newer than any error for requests before it */
+  meta_error_traps_dispatch (display);
+
 #ifdef WITH_VERBOSE_MODE
   if (dump_events)
     meta_spew_event (display, event);
 #endif
 
+  /* Damage notifies are most of the events a busy desktop gets, and
+   * only the compositor wants them: they skip the window lookup and
+   * bookkeeping below, and GDK, which has no use for them either */
+  if (display->damage_event_base != 0 &&
+      event->type == display->damage_event_base + XDamageNotify)
+    {
+      meta_compositor_process_event (display->compositor, event, NULL);
+
+      if (start_time)
+        update_event_stats (event->type, start_time, FALSE);
+
+      META_TRACE1 (event_end, TRUE);
+
+      return TRUE;
+    }
+
 #ifdef HAVE_STARTUP_NOTIFICATION
   sn_display_process_event (display->sn_display, event);
 #endif
 
   bypass_compositor = FALSE;
   filter_out_event = FALSE;
+  display->round_trips = 0;
   display->current_time = event_get_time (display, event);
   display->monitor_cache_invalidated = TRUE;
 
@@ -2045,6 +2392,8 @@ event_callback (XEvent   *event,
       if (display->grab_window == window &&
           grab_op_is_mouse (display->grab_op))
         meta_window_handle_mouse_grab_op_event (window, event);
+      else
+        pointer_event_unused = window != NULL && !frame_was_receiver;
       break;
     case EnterNotify:
       if (display->grab_op == META_GRAB_OP_COMPOSITOR)
@@ -2057,6 +2406,9 @@ event_callback (XEvent   *event,
           break;
         }
 
+      /* Cleared below by whatever acts on the event */
+      pointer_event_unused = window != NULL && !frame_was_receiver;
+
       /* If the mouse switches screens, active the default window on the new
        * screen; this will make keybindings and workspace-launched items
        * actually appear on the right screen.
@@ -2066,9 +2418,12 @@ event_callback (XEvent   *event,
           meta_display_screen_for_root (display, event->xcrossing.root);
 
         if (new_screen != NULL && display->active_screen != new_screen)
-          meta_workspace_focus_default_window (new_screen->active_workspace,
-                                               NULL,
-                                               event->xcrossing.time);
+          {
+            meta_workspace_focus_default_window (new_screen->active_workspace,
+                                                 NULL,
+                                                 event->xcrossing.time);
+            pointer_event_unused = FALSE;
+          }
       }
 
       /* Check if we've entered a window; do this even if window->has_focus to
@@ -2085,6 +2440,7 @@ event_callback (XEvent   *event,
             case C_DESKTOP_FOCUS_MODE_SLOPPY:
             case C_DESKTOP_FOCUS_MODE_MOUSE:
               display->mouse_mode = TRUE;
+              pointer_event_unused = FALSE;
               if (window->type != META_WINDOW_DOCK &&
                   window->type != META_WINDOW_DESKTOP)
                 {
@@ -2140,7 +2496,10 @@ event_callback (XEvent   *event,
             }
 
           if (window->type == META_WINDOW_DOCK)
-            meta_window_raise (window);
+            {
+              meta_window_raise (window);
+              pointer_event_unused = FALSE;
+            }
         }
       break;
     case LeaveNotify:
@@ -2157,6 +2516,8 @@ event_callback (XEvent   *event,
               event->xcrossing.mode != NotifyUngrab &&
               !window->has_focus)
             meta_window_lower (window);
+          else
+            pointer_event_unused = !frame_was_receiver;
         }
       break;
     case FocusIn:
@@ -2461,11 +2822,17 @@ event_callback (XEvent   *event,
         MetaGroup *group;
         MetaScreen *screen;
 
+        gint64 property_start = start_time ? g_get_monotonic_time () : 0;
+
         if (window && !frame_was_receiver)
           meta_window_property_notify (window, event);
         else if (property_for_window && !frame_was_receiver)
           meta_window_property_notify (property_for_window, event);
 
+        if (start_time)
+          event_timings_add (&event_stats.property_notify, property_start,
+                             g_get_monotonic_time ());
+
         group = meta_display_lookup_group (display,
                                            event->xproperty.window);
         if (group != NULL)
@@ -2517,6 +2884,7 @@ event_callback (XEvent   *event,
       /* Note that processing that may have resulted in
        * closing the display... so return right away.
        */
+      META_TRACE1 (event_end, FALSE);
       return FALSE;
     case SelectionRequest:
       process_selection_request (display, event);
@@ -2711,13 +3079,32 @@ event_callback (XEvent   *event,
 
   if (!bypass_compositor)
     {
+      gint64 compositor_start = start_time ? g_get_monotonic_time () : 0;
+
       if (meta_compositor_process_event (display->compositor,
                                          event,
                                          window))
         filter_out_event = TRUE;
+
+      if (start_time)
+        event_timings_add (&event_stats.compositor, compositor_start,
+                           g_get_monotonic_time ());
     }
 
+  if (display->round_trips > 0)
+    meta_topic (META_DEBUG_ROUND_TRIPS,
+                "Event type %d serial %lu on 0x%lx cost %u round trips\n",
+                event->type, event->xany.serial, modified,
+                display->round_trips);
+
+  if (start_time)
+    update_event_stats (event->type, start_time,
+                        pointer_event_unused && !filter_out_event);
+
   display->current_time = CurrentTime;
+
+  META_TRACE1 (event_end, filter_out_event);
+
   return filter_out_event;
 }
 
@@ -3688,6 +4075,7 @@ meta_display_begin_grab_op (MetaDisplay *display,
   display->grab_last_moveresize_time.tv_sec = 0;
   display->grab_last_moveresize_time.tv_usec = 0;
   display->grab_motion_notify_time = 0;
+  display->grab_motion_pending = FALSE;
   display->grab_old_window_stacking = NULL;
 #ifdef HAVE_XSYNC
   display->grab_last_user_action_was_snap = FALSE;
@@ -3789,6 +4177,8 @@ meta_display_end_grab_op (MetaDisplay *display,
   if (display->grab_op == META_GRAB_OP_NONE)
     return;
 
+  display->grab_motion_pending = FALSE;
+
   meta_compositor_grab_op_end (display->compositor);
 
   g_signal_emit (display, display_signals[GRAB_OP_END], 0,
@@ -3821,13 +4211,13 @@ meta_display_end_grab_op (MetaDisplay *display,
       display->ungrab_should_not_cause_focus_window = display->grab_xwindow;
     }
 
-  /* If this was a move or resize clear out the edge cache */
+  /* If this was a move or resize stop using the edge cache */
   if (meta_grab_op_is_resizing (display->grab_op) ||
       meta_grab_op_is_moving (display->grab_op))
     {
       meta_topic (META_DEBUG_WINDOW_OPS,
-                  "Clearing out the edges for resistance/snapping");
-      meta_display_cleanup_edges (display);
+                  "Releasing the edges for resistance/snapping");
+      meta_display_end_grab_edges (display);
     }
 
   if (display->grab_old_window_stacking != NULL)
@@ -3916,6 +4306,27 @@ meta_display_check_threshold_reached (MetaDisplay *display,
     display->grab_threshold_movement_reached = TRUE;
 }
 
+typedef struct
+{
+  Window       xwindow;
+  gboolean     grab;
+  int          button;
+  unsigned int mask;
+} ButtonGrabCheck;
+
+static void
+button_grab_checked (MetaDisplay *display,
+                     int          error_code,
+                     gpointer     user_data)
+{
+  ButtonGrabCheck *check = user_data;
+
+  if (error_code != Success)
+    meta_verbose ("Failed to %s button %d with mask 0x%x for window 0x%lx error code %d\n",
+                  check->grab ? "grab" : "ungrab",
+                  check->button, check->mask, check->xwindow, error_code);
+}
+
 static void
 meta_change_button_grab (MetaDisplay *display,
                          Window       xwindow,
@@ -3946,7 +4357,7 @@ meta_change_button_grab (MetaDisplay *display,
         }
 
       if (meta_is_debugging ())
-        meta_error_trap_push_with_return (display);
+        meta_error_trap_push (display);
 
       /* GrabModeSync means freeze until XAllowEvents */
 
@@ -3964,14 +4375,14 @@ meta_change_button_grab (MetaDisplay *display,
 
       if (meta_is_debugging ())
         {
-          int result;
-
-          result = meta_error_trap_pop_with_return (display);
-
-          if (result != Success)
-            meta_verbose ("Failed to %s button %d with mask 0x%x for window 0x%lx error code %d\n",
-                          grab ? "grab" : "ungrab",
-                          button, modmask | ignored_mask, xwindow, result);
+          ButtonGrabCheck *check = g_new (ButtonGrabCheck, 1);
+
+          check->xwindow = xwindow;
+          check->grab = grab;
+          check->button = button;
+          check->mask = modmask | ignored_mask;
+          meta_error_trap_pop_async (display, button_grab_checked,
+                                     check, g_free);
         }
 
       ++ignored_mask;
@@ -4271,6 +4682,31 @@ meta_display_set_cursor_theme (const char *theme,
  */
 static gboolean is_syncing = FALSE;
 
+/*
+ * Stores whether the display should collect X round trip statistics.
+ */
+static gboolean is_profiling_requests = FALSE;
+
+/*
+ * Returns whether X round trip statistics are collected, as set with
+ * --profile-x-requests.
+ */
+LOCAL_SYMBOL gboolean
+meta_is_profiling_requests (void)
+{
+  return is_profiling_requests;
+}
+
+/*
+ * Turns collecting X round trip statistics on or off.  Only takes
+ * effect for displays opened afterwards.
+ */
+LOCAL_SYMBOL void
+meta_set_profiling_requests (gboolean setting)
+{
+  is_profiling_requests = setting;
+}
+
 /*
  * Returns whether X synchronisation is currently enabled.
  *
@@ -4683,6 +5119,7 @@ meta_display_get_tab_list (MetaDisplay   *display,
                            MetaWorkspace *workspace)
 {
   GList *tab_list;
+  GList *minimized_list;
 
   g_return_val_if_fail (workspace != NULL, NULL);
 
@@ -4693,50 +5130,37 @@ meta_display_get_tab_list (MetaDisplay   *display,
     GList *tmp;
 
     tab_list = NULL;
+    minimized_list = NULL;
     tmp = workspace->mru_list;
     while (tmp != NULL)
       {
         MetaWindow *window = tmp->data;
 
-        if (!window->minimized &&
-            window->screen == screen &&
+        if (window->screen == screen &&
             IN_TAB_CHAIN (window, type))
-          tab_list = g_list_prepend (tab_list, window);
+          {
+            if (window->minimized)
+              minimized_list = g_list_prepend (minimized_list, window);
+            else
+              tab_list = g_list_prepend (tab_list, window);
+          }
 
         tmp = tmp->next;
       }
   }
 
+  tab_list = g_list_concat (g_list_reverse (tab_list),
+                            g_list_reverse (minimized_list));
+
   {
     GList *tmp;
 
-    tmp = workspace->mru_list;
-    while (tmp != NULL)
+    for (tmp = display->windows.head; tmp; tmp = tmp->next)
       {
-        MetaWindow *window = tmp->data;
-
-        if (window->minimized &&
-            window->screen == screen &&
-            IN_TAB_CHAIN (window, type))
-          tab_list = g_list_prepend (tab_list, window);
-
-        tmp = tmp->next;
-      }
-  }
-
-  tab_list = g_list_reverse (tab_list);
-
-  {
-    GSList *windows, *tmp;
-    MetaWindow *l_window;
+        MetaWindow *l_window = tmp->data;
 
-    windows = meta_display_list_windows (display, META_LIST_DEFAULT);
-
-    /* Go through all windows */
-    tmp = windows;
-    while (tmp != NULL)
-      {
-        l_window=tmp->data;
+        if (l_window->override_redirect)
+          continue;
 
         /* Check to see if it demands attention */
         if (l_window->wm_state_demands_attention &&
@@ -4746,11 +5170,7 @@ meta_display_get_tab_list (MetaDisplay   *display,
             /* if it does, add it to the popup */
             tab_list = g_list_prepend (tab_list, l_window);
           }
-
-        tmp = tmp->next;
-      } /* End while tmp!=NULL */
-
-    g_slist_free (windows);
+      }
   }
 
   return tab_list;
@@ -4978,6 +5398,7 @@ convert_property (MetaDisplay *display,
 #define N_TARGETS 4
   Atom conversion_targets[N_TARGETS];
   long icccm_version[] = { 2, 0 };
+  gint64 start;
 
   conversion_targets[0] = display->atom_TARGETS;
   conversion_targets[1] = display->atom_MULTIPLE;
@@ -5011,7 +5432,11 @@ convert_property (MetaDisplay *display,
    */
   /* FIXME the error trap pop synced anyway, right? */
   meta_topic (META_DEBUG_SYNC, "Syncing on %s\n", G_STRFUNC);
+  start = meta_request_profiler_begin (display->request_profiler);
   XSync (display->xdisplay, False);
+  meta_request_profiler_end (display->request_profiler,
+                             META_REQUEST_SYNC, META_REQUEST_CALLER, start);
+  meta_display_note_round_trip (display);
 
   return TRUE;
 }
@@ -5313,17 +5738,47 @@ update_mouse_zoom_modifiers (MetaDisplay *display)
 }
 
 static void
-prefs_changed_callback (MetaPreference pref,
-                        void          *data)
+prefs_changed_callback (const MetaPreference *prefs,
+                        int                   n_prefs,
+                        void                 *data)
 {
+  gboolean regrab = FALSE;
+  gboolean button_mods_changed = FALSE;
+  gboolean zoom_mods_changed = FALSE;
+  gboolean focus_mode_changed = FALSE;
+  int i;
+
   /* It may not be obvious why we regrab on focus mode
    * change; it's because we handle focus clicks a
    * bit differently for the different focus modes.
    */
-  if (pref == META_PREF_MOUSE_BUTTON_MODS ||
-      pref == META_PREF_FOCUS_MODE ||
-      pref == META_PREF_MOUSE_BUTTON_ZOOM_MODS ||
-      pref == META_PREF_MOUSE_ZOOM_ENABLED)
+  for (i = 0; i < n_prefs; i++)
+    {
+      switch (prefs[i])
+        {
+        case META_PREF_MOUSE_BUTTON_MODS:
+          button_mods_changed = TRUE;
+          regrab = TRUE;
+          break;
+        case META_PREF_MOUSE_BUTTON_ZOOM_MODS:
+          zoom_mods_changed = TRUE;
+          regrab = TRUE;
+          break;
+        case META_PREF_FOCUS_MODE:
+          focus_mode_changed = TRUE;
+          regrab = TRUE;
+          break;
+        case META_PREF_MOUSE_ZOOM_ENABLED:
+          regrab = TRUE;
+          break;
+        default:
+          break;
+        }
+    }
+
+  /* Ungrabbing and grabbing again is done once for all the prefs
+   * that changed together */
+  if (regrab)
     {
       MetaDisplay *display = data;
       GSList *windows;
@@ -5348,10 +5803,10 @@ prefs_changed_callback (MetaPreference pref,
         }
 
       /* change our modifier */
-      if (pref == META_PREF_MOUSE_BUTTON_MODS)
+      if (button_mods_changed)
         update_window_grab_modifiers (display);
 
-      if (pref == META_PREF_MOUSE_BUTTON_ZOOM_MODS)
+      if (zoom_mods_changed)
         update_mouse_zoom_modifiers (display);
 
       display->mouse_zoom_enabled = meta_prefs_get_mouse_zoom_enabled ();
@@ -5361,6 +5816,11 @@ prefs_changed_callback (MetaPreference pref,
       while (tmp != NULL)
         {
           MetaWindow *w = tmp->data;
+
+          /* Click to focus doesn't need crossing events */
+          if (focus_mode_changed)
+            meta_window_update_crossing_events (w);
+
           if (w->type != META_WINDOW_DOCK)
             {
               meta_display_grab_focus_window_button (display, w);
@@ -5688,6 +6148,8 @@ meta_display_restart_internal (MetaDisplay *display)
    */
   meta_pre_exec_close_fds ();
 
+  meta_restart_save_state (display);
+
   meta_display_unmanage_screen (display,
                                 (MetaScreen*) display->screens->data,
                                 meta_display_get_current_time (display));
@@ -5724,3 +6186,24 @@ meta_display_update_sync_state (MetaSyncMethod method)
 {
   meta_compositor_update_sync_state (the_display->compositor, method);
 }
+
+void
+meta_display_update_geometric_picking (void)
+{
+  if (the_display->compositor)
+    meta_compositor_update_geometric_picking (the_display->compositor);
+}
+
+void
+meta_display_update_density_mode (void)
+{
+  if (the_display->compositor)
+    meta_compositor_update_density_mode (the_display->compositor);
+}
+
+void
+meta_display_update_color_filter (void)
+{
+  if (the_display->compositor)
+    meta_compositor_update_color_filter (the_display->compositor);
+}
@@ -22,6 +22,8 @@
  */
 
 #include <config.h>
+#include <stdlib.h>
+#include <string.h>
 #include "edge-resistance.h"
 #include "boxes-private.h"
 #include "display-private.h"
@@ -50,12 +52,40 @@ struct ResistanceDataForAnEdge
 };
 typedef struct ResistanceDataForAnEdge ResistanceDataForAnEdge;
 
+/* A flat array of edges sorted by position */
+struct SortedEdges
+{
+  MetaEdge *edges;
+  int       len;
+};
+typedef struct SortedEdges SortedEdges;
+
+/* What the window edges are computed from */
+struct EdgeSourceWindow
+{
+  MetaRectangle rect;
+  gboolean      is_dock;
+};
+typedef struct EdgeSourceWindow EdgeSourceWindow;
+
 struct MetaEdgeResistanceData
 {
-  GArray *left_edges;
-  GArray *right_edges;
-  GArray *top_edges;
-  GArray *bottom_edges;
+  /* The left and right edges, sorted by x, and the top and bottom
+   * edges, sorted by y.  Left edges may snap to right ones and the
+   * other way round, so they share an array.
+   */
+  SortedEdges x_edges;
+  SortedEdges y_edges;
+
+  /* The windows the edges were computed from, bottom to top, so that
+   * a later grab can tell whether they are still current
+   */
+  MetaScreen       *screen;
+  EdgeSourceWindow *sources;
+  int               n_sources;
+
+  /* Whether the data below has been set up for the current grab */
+  gboolean grab_initialized;
 
   ResistanceDataForAnEdge left_data;
   ResistanceDataForAnEdge right_data;
@@ -69,7 +99,7 @@ static void compute_resistance_and_snapping_edges (MetaDisplay *display);
  * edges->len); this is by design, but you need to remember this.
  */
 static int
-find_index_of_edge_near_position (const GArray *edges,
+find_index_of_edge_near_position (const SortedEdges *edges,
                                   int           position,
                                   gboolean      want_interval_min,
                                   gboolean      horizontal)
@@ -91,13 +121,13 @@ find_index_of_edge_near_position (const GArray *edges,
    */
   int low, high, mid;
   int compare;
-  MetaEdge *edge;
+  const MetaEdge *edge;
 
   /* Initialize mid, edge, & compare in the off change that the array only
    * has one element.
    */
   mid  = 0;
-  edge = g_array_index (edges, MetaEdge*, mid);
+  edge = &edges->edges[mid];
   compare = horizontal ? edge->rect.x : edge->rect.y;
 
   /* Begin the search... */
@@ -106,7 +136,7 @@ find_index_of_edge_near_position (const GArray *edges,
   while (low < high)
     {
       mid = low + (high - low)/2;
-      edge = g_array_index (edges, MetaEdge*, mid);
+      edge = &edges->edges[mid];
       compare = horizontal ? edge->rect.x : edge->rect.y;
 
       if (compare == position)
@@ -130,13 +160,13 @@ find_index_of_edge_near_position (const GArray *edges,
       while (compare >= position && mid > 0)
         {
           mid--;
-          edge = g_array_index (edges, MetaEdge*, mid);
+          edge = &edges->edges[mid];
           compare = horizontal ? edge->rect.x : edge->rect.y;
         }
       while (compare < position && mid < (int)edges->len - 1)
         {
           mid++;
-          edge = g_array_index (edges, MetaEdge*, mid);
+          edge = &edges->edges[mid];
           compare = horizontal ? edge->rect.x : edge->rect.y;
         }
 
@@ -152,13 +182,13 @@ find_index_of_edge_near_position (const GArray *edges,
       while (compare <= position && mid < (int)edges->len - 1)
         {
           mid++;
-          edge = g_array_index (edges, MetaEdge*, mid);
+          edge = &edges->edges[mid];
           compare = horizontal ? edge->rect.x : edge->rect.y;
         }
       while (compare > position && mid > 0)
         {
           mid--;
-          edge = g_array_index (edges, MetaEdge*, mid);
+          edge = &edges->edges[mid];
           compare = horizontal ? edge->rect.x : edge->rect.y;
         }
 
@@ -178,7 +208,7 @@ points_on_same_side (int ref, int pt1, int pt2)
 }
 
 static int
-find_nearest_position (const GArray        *edges,
+find_nearest_position (const SortedEdges   *edges,
                        int                  position,
                        int                  old_position,
                        const MetaRectangle *new_rect,
@@ -192,7 +222,7 @@ find_nearest_position (const GArray        *edges,
    */
   int low, high, mid;
   int compare;
-  MetaEdge *edge;
+  const MetaEdge *edge;
   int best, best_dist, i;
   gboolean edges_align;
 
@@ -207,7 +237,7 @@ find_nearest_position (const GArray        *edges,
   while (low < high)
     {
       mid = low + (high - low)/2;
-      edge = g_array_index (edges, MetaEdge*, mid);
+      edge = &edges->edges[mid];
       compare = horizontal ? edge->rect.x : edge->rect.y;
 
       if (compare == position)
@@ -227,7 +257,7 @@ find_nearest_position (const GArray        *edges,
   best_dist = INT_MAX;
 
   /* Start the search at mid */
-  edge = g_array_index (edges, MetaEdge*, mid);
+  edge = &edges->edges[mid];
   compare = horizontal ? edge->rect.x : edge->rect.y;
   edges_align = meta_rectangle_edge_aligns (new_rect, edge);
   if (edges_align &&
@@ -244,7 +274,7 @@ find_nearest_position (const GArray        *edges,
   /* Now start searching higher than mid */
   for (i = mid + 1; i < (int)edges->len; i++)
     {
-      edge = g_array_index (edges, MetaEdge*, i);
+      edge = &edges->edges[i];
       compare = horizontal ? edge->rect.x : edge->rect.y;
 
       edges_align = horizontal ?
@@ -268,7 +298,7 @@ find_nearest_position (const GArray        *edges,
   /* Now start searching lower than mid */
   for (i = mid-1; i >= 0; i--)
     {
-      edge = g_array_index (edges, MetaEdge*, i);
+      edge = &edges->edges[i];
       compare = horizontal ? edge->rect.x : edge->rect.y;
 
       edges_align = horizontal ?
@@ -326,7 +356,7 @@ apply_edge_resistance (MetaWindow                *window,
                        int                        new_pos,
                        const MetaRectangle       *old_rect,
                        const MetaRectangle       *new_rect,
-                       GArray                    *edges,
+                       const SortedEdges         *edges,
                        ResistanceDataForAnEdge   *resistance_data,
                        GSourceFunc                timeout_func,
                        gboolean                   xdir,
@@ -352,7 +382,7 @@ apply_edge_resistance (MetaWindow                *window,
     return new_pos;
 
   /* Quit if no movement was specified */
-  if (old_pos == new_pos)
+  if (old_pos == new_pos || edges->len == 0)
     return new_pos;
 
   /* Remove the old timeout if it's no longer relevant */
@@ -387,7 +417,7 @@ apply_edge_resistance (MetaWindow                *window,
          (!increasing && i >= end))
     {
       gboolean  edges_align;
-      MetaEdge *edge = g_array_index (edges, MetaEdge*, i);
+      const MetaEdge *edge = &edges->edges[i];
       int       compare = xdir ? edge->rect.x : edge->rect.y;
 
       /* Find out if this edge is relevant */
@@ -500,13 +530,13 @@ static int
 apply_edge_snapping (int                  old_pos,
                      int                  new_pos,
                      const MetaRectangle *new_rect,
-                     GArray              *edges,
+                     const SortedEdges   *edges,
                      gboolean             xdir,
                      gboolean             keyboard_op)
 {
   int snap_to;
 
-  if (old_pos == new_pos)
+  if (old_pos == new_pos || edges->len == 0)
     return new_pos;
 
   snap_to = find_nearest_position (edges,
@@ -553,7 +583,8 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
   gboolean                modified;
   int new_left, new_right, new_top, new_bottom;
 
-  if (display->grab_edge_resistance_data == NULL)
+  if (display->grab_edge_resistance_data == NULL ||
+      !display->grab_edge_resistance_data->grab_initialized)
     compute_resistance_and_snapping_edges (display);
 
   edge_data = display->grab_edge_resistance_data;
@@ -568,28 +599,28 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
       new_left   = apply_edge_snapping (BOX_LEFT (*old_outer),
                                         BOX_LEFT (*new_outer),
                                         new_outer,
-                                        edge_data->left_edges,
+                                        &edge_data->x_edges,
                                         TRUE,
                                         keyboard_op);
 
       new_right  = apply_edge_snapping (BOX_RIGHT (*old_outer),
                                         BOX_RIGHT (*new_outer),
                                         new_outer,
-                                        edge_data->right_edges,
+                                        &edge_data->x_edges,
                                         TRUE,
                                         keyboard_op);
 
       new_top    = apply_edge_snapping (BOX_TOP (*old_outer),
                                         BOX_TOP (*new_outer),
                                         new_outer,
-                                        edge_data->top_edges,
+                                        &edge_data->y_edges,
                                         FALSE,
                                         keyboard_op);
 
       new_bottom = apply_edge_snapping (BOX_BOTTOM (*old_outer),
                                         BOX_BOTTOM (*new_outer),
                                         new_outer,
-                                        edge_data->bottom_edges,
+                                        &edge_data->y_edges,
                                         FALSE,
                                         keyboard_op);
     }
@@ -607,7 +638,7 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
                                               BOX_LEFT (*new_outer),
                                               old_outer,
                                               new_outer,
-                                              edge_data->left_edges,
+                                              &edge_data->x_edges,
                                               &edge_data->left_data,
                                               timeout_func,
                                               TRUE,
@@ -617,7 +648,7 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
                                               BOX_RIGHT (*new_outer),
                                               old_outer,
                                               new_outer,
-                                              edge_data->right_edges,
+                                              &edge_data->x_edges,
                                               &edge_data->right_data,
                                               timeout_func,
                                               TRUE,
@@ -636,7 +667,7 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
                                               BOX_TOP (*new_outer),
                                               old_outer,
                                               new_outer,
-                                              edge_data->top_edges,
+                                              &edge_data->y_edges,
                                               &edge_data->top_data,
                                               timeout_func,
                                               FALSE,
@@ -646,7 +677,7 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
                                               BOX_BOTTOM (*new_outer),
                                               old_outer,
                                               new_outer,
-                                              edge_data->bottom_edges,
+                                              &edge_data->y_edges,
                                               &edge_data->bottom_data,
                                               timeout_func,
                                               FALSE,
@@ -669,75 +700,9 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
   return modified;
 }
 
-LOCAL_SYMBOL void
-meta_display_cleanup_edges (MetaDisplay *display)
+static void
+remove_resistance_timeouts (MetaEdgeResistanceData *edge_data)
 {
-  guint i,j;
-  MetaEdgeResistanceData *edge_data = display->grab_edge_resistance_data;
-  GHashTable *edges_to_be_freed;
-
-  if (edge_data == NULL) /* Not currently cached */
-    return;
-
-  /* We first need to clean out any window edges */
-  edges_to_be_freed = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                             free, NULL);
-  for (i = 0; i < 4; i++)
-    {
-      GArray *tmp = NULL;
-      MetaSide side;
-      switch (i)
-        {
-        case 0:
-          tmp = edge_data->left_edges;
-          side = META_SIDE_LEFT;
-          break;
-        case 1:
-          tmp = edge_data->right_edges;
-          side = META_SIDE_RIGHT;
-          break;
-        case 2:
-          tmp = edge_data->top_edges;
-          side = META_SIDE_TOP;
-          break;
-        case 3:
-          tmp = edge_data->bottom_edges;
-          side = META_SIDE_BOTTOM;
-          break;
-        default:
-          g_assert_not_reached ();
-        }
-
-      for (j = 0; j < tmp->len; j++)
-        {
-          MetaEdge *edge = g_array_index (tmp, MetaEdge*, j);
-          if (edge->edge_type == META_EDGE_WINDOW &&
-              edge->side_type == side)
-            {
-              /* The same edge will appear in two arrays, and we can't free
-               * it yet we still need to compare edge->side_type for the other
-               * array that it is in.  So store it in a hash table for later
-               * freeing.  Could also do this in a simple linked list.
-               */
-              g_hash_table_insert (edges_to_be_freed, edge, edge);
-            }
-        }
-    }
-
-  /* Now free all the window edges (the key destroy function is free) */
-  g_hash_table_destroy (edges_to_be_freed);
-
-  /* Now free the arrays and data */
-  g_array_free (edge_data->left_edges, TRUE);
-  g_array_free (edge_data->right_edges, TRUE);
-  g_array_free (edge_data->top_edges, TRUE);
-  g_array_free (edge_data->bottom_edges, TRUE);
-  edge_data->left_edges = NULL;
-  edge_data->right_edges = NULL;
-  edge_data->top_edges = NULL;
-  edge_data->bottom_edges = NULL;
-
-  /* Cleanup the timeouts */
   if (edge_data->left_data.timeout_setup && edge_data->left_data.timeout_id != 0) {
     g_source_remove (edge_data->left_data.timeout_id);
     edge_data->left_data.timeout_id = 0;
@@ -754,18 +719,43 @@ meta_display_cleanup_edges (MetaDisplay *display)
     g_source_remove (edge_data->bottom_data.timeout_id);
     edge_data->bottom_data.timeout_id = 0;
   }
+}
+
+/* Frees the cached edges; needed whenever the monitor or screen edges
+ * of the active workspace change, since the window edges don't track
+ * those.
+ */
+LOCAL_SYMBOL void
+meta_display_cleanup_edges (MetaDisplay *display)
+{
+  MetaEdgeResistanceData *edge_data = display->grab_edge_resistance_data;
+
+  if (edge_data == NULL) /* Not currently cached */
+    return;
+
+  remove_resistance_timeouts (edge_data);
+
+  free (edge_data->x_edges.edges);
+  free (edge_data->y_edges.edges);
+  free (edge_data->sources);
 
   free (display->grab_edge_resistance_data);
   display->grab_edge_resistance_data = NULL;
 }
 
-static int
-stupid_sort_requiring_extra_pointer_dereference (gconstpointer a,
-                                                 gconstpointer b)
+/* Called at the end of a move or resize.  The edges are kept, so that
+ * the next grab can reuse them if no window moved in between.
+ */
+LOCAL_SYMBOL void
+meta_display_end_grab_edges (MetaDisplay *display)
 {
-  const MetaEdge * const *a_edge = a;
-  const MetaEdge * const *b_edge = b;
-  return meta_rectangle_edge_cmp_ignore_type (*a_edge, *b_edge);
+  MetaEdgeResistanceData *edge_data = display->grab_edge_resistance_data;
+
+  if (edge_data == NULL)
+    return;
+
+  remove_resistance_timeouts (edge_data);
+  edge_data->grab_initialized = FALSE;
 }
 
 static void
@@ -776,7 +766,7 @@ cache_edges (MetaDisplay *display,
 {
   MetaEdgeResistanceData *edge_data;
   GList *tmp;
-  int num_left, num_right, num_top, num_bottom;
+  int num_x, num_y;
   int i;
 
   /*
@@ -807,7 +797,7 @@ cache_edges (MetaDisplay *display,
   /*
    * 1st: Get the total number of each kind of edge
    */
-  num_left = num_right = num_top = num_bottom = 0;
+  num_x = num_y = 0;
   for (i = 0; i < 3; i++)
     {
       tmp = NULL;
@@ -832,16 +822,12 @@ cache_edges (MetaDisplay *display,
           switch (edge->side_type)
             {
             case META_SIDE_LEFT:
-              num_left++;
-              break;
             case META_SIDE_RIGHT:
-              num_right++;
+              num_x++;
               break;
             case META_SIDE_TOP:
-              num_top++;
-              break;
             case META_SIDE_BOTTOM:
-              num_bottom++;
+              num_y++;
               break;
             default:
               g_assert_not_reached ();
@@ -856,25 +842,11 @@ cache_edges (MetaDisplay *display,
   g_assert (display->grab_edge_resistance_data == NULL);
   display->grab_edge_resistance_data = g_new0 (MetaEdgeResistanceData, 1);
   edge_data = display->grab_edge_resistance_data;
-  edge_data->left_edges   = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_left + num_right);
-  edge_data->right_edges  = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_left + num_right);
-  edge_data->top_edges    = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_top + num_bottom);
-  edge_data->bottom_edges = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_top + num_bottom);
+  edge_data->x_edges.edges = g_new (MetaEdge, num_x);
+  edge_data->y_edges.edges = g_new (MetaEdge, num_y);
 
   /*
-   * 3rd: Add the edges to the arrays
+   * 3rd: Copy the edges into the arrays
    */
   for (i = 0; i < 3; i++)
     {
@@ -901,13 +873,11 @@ cache_edges (MetaDisplay *display,
             {
             case META_SIDE_LEFT:
             case META_SIDE_RIGHT:
-              g_array_append_val (edge_data->left_edges, edge);
-              g_array_append_val (edge_data->right_edges, edge);
+              edge_data->x_edges.edges[edge_data->x_edges.len++] = *edge;
               break;
             case META_SIDE_TOP:
             case META_SIDE_BOTTOM:
-              g_array_append_val (edge_data->top_edges, edge);
-              g_array_append_val (edge_data->bottom_edges, edge);
+              edge_data->y_edges.edges[edge_data->y_edges.len++] = *edge;
               break;
             default:
               g_assert_not_reached ();
@@ -917,19 +887,12 @@ cache_edges (MetaDisplay *display,
     }
 
   /*
-   * 4th: Sort the arrays (FIXME: This is kinda dumb since the arrays were
-   * individually sorted earlier and we could have done this faster and
-   * avoided this sort by sticking them into the array with some simple
-   * merging of the lists).
+   * 4th: Sort the arrays
    */
-  g_array_sort (display->grab_edge_resistance_data->left_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->right_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->top_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->bottom_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
+  qsort (edge_data->x_edges.edges, edge_data->x_edges.len,
+         sizeof (MetaEdge), meta_rectangle_edge_cmp_ignore_type);
+  qsort (edge_data->y_edges.edges, edge_data->y_edges.len,
+         sizeof (MetaEdge), meta_rectangle_edge_cmp_ignore_type);
 }
 
 static void
@@ -946,21 +909,23 @@ initialize_grab_edge_resistance_data (MetaDisplay *display)
   edge_data->right_data.keyboard_buildup  = 0;
   edge_data->top_data.keyboard_buildup    = 0;
   edge_data->bottom_data.keyboard_buildup = 0;
+
+  edge_data->grab_initialized = TRUE;
 }
 
 static void
 compute_resistance_and_snapping_edges (MetaDisplay *display)
 {
+  MetaEdgeResistanceData *edge_data;
   GList *stacked_windows;
   GList *cur_window_iter;
   GList *edges;
-  /* Lists of window positions (rects) and their relative stacking positions */
-  int stack_position;
-  GSList *obscuring_windows, *window_stacking;
-  /* The portions of the above lists that still remain at the stacking position
-   * in the layer that we are working on
+  EdgeSourceWindow *sources;
+  int n_sources, i;
+  /* The window rects that can obscure edges, from bottom to top, and
+   * the portion of them above the window we are working on
    */
-  GSList *rem_windows, *rem_win_stacking;
+  GSList *obscuring_windows, *rem_windows;
 
   g_assert (display->grab_window != NULL);
   meta_topic (META_DEBUG_WINDOW_OPS,
@@ -968,174 +933,157 @@ compute_resistance_and_snapping_edges (MetaDisplay *display)
               display->grab_window->desc);
 
   /*
-   * 1st: Get the list of relevant windows, from bottom to top
+   * 1st: Get the geometry of the relevant windows, from bottom to top
    */
   stacked_windows =
     meta_stack_list_windows (display->grab_screen->stack,
                              display->grab_screen->active_workspace);
 
-  /*
-   * 2nd: we need to separate that stacked list into a list of windows that
-   * can obscure other edges.  To make sure we only have windows obscuring
-   * those below it instead of going both ways, we also need to keep a
-   * counter list.  Messy, I know.
-   */
-  obscuring_windows = window_stacking = NULL;
-  cur_window_iter = stacked_windows;
-  stack_position = 0;
-  while (cur_window_iter != NULL)
+  sources = g_new (EdgeSourceWindow, g_list_length (stacked_windows));
+  n_sources = 0;
+  for (cur_window_iter = stacked_windows;
+       cur_window_iter != NULL;
+       cur_window_iter = cur_window_iter->next)
     {
       MetaWindow *cur_window = cur_window_iter->data;
       if (WINDOW_EDGES_RELEVANT (cur_window, display))
         {
-          MetaRectangle *new_rect;
-          new_rect = g_new (MetaRectangle, 1);
-          meta_window_get_outer_rect (cur_window, new_rect);
-          obscuring_windows = g_slist_prepend (obscuring_windows, new_rect);
-          window_stacking = 
-            g_slist_prepend (window_stacking, GINT_TO_POINTER (stack_position));
+          meta_window_get_outer_rect (cur_window, &sources[n_sources].rect);
+          sources[n_sources].is_dock = cur_window->type == META_WINDOW_DOCK;
+          n_sources++;
         }
-
-      stack_position++;
-      cur_window_iter = cur_window_iter->next;
     }
-  /* Put 'em in bottom to top order */
-  rem_windows = obscuring_windows = g_slist_reverse (obscuring_windows);
-  rem_win_stacking = window_stacking = g_slist_reverse (window_stacking);
+  g_list_free (stacked_windows);
 
   /*
-   * 3rd: loop over the windows again, this time getting the edges from
-   * them and removing intersections with the relevant obscuring_windows &
-   * obscuring_docks.
+   * 2nd: If the windows are where they were for the previous grab, so
+   * are the edges.  This is the common case of moving or resizing the
+   * same window several times in a row.
    */
-  edges = NULL;
-  stack_position = 0;
-  cur_window_iter = stacked_windows;
-  while (cur_window_iter != NULL)
+  edge_data = display->grab_edge_resistance_data;
+  if (edge_data != NULL &&
+      edge_data->screen == display->grab_screen &&
+      edge_data->n_sources == n_sources &&
+      (n_sources == 0 ||
+       memcmp (edge_data->sources, sources,
+               n_sources * sizeof (EdgeSourceWindow)) == 0))
     {
-      MetaRectangle  cur_rect;
-      MetaWindow    *cur_window = cur_window_iter->data;
-      meta_window_get_outer_rect (cur_window, &cur_rect);
+      meta_topic (META_DEBUG_WINDOW_OPS,
+                  "Reusing the edges of the previous grab.\n");
+      free (sources);
+      initialize_grab_edge_resistance_data (display);
+      return;
+    }
 
-      /* Check if we want to use this window's edges for edge
-       * resistance (note that dock edges are considered screen edges
-       * which are handled separately
-       */
-      if (WINDOW_EDGES_RELEVANT (cur_window, display) &&
-          cur_window->type != META_WINDOW_DOCK)
-        {
-          GList *new_edges;
-          MetaEdge *new_edge;
-          MetaRectangle reduced;
+  meta_display_cleanup_edges (display);
 
-          /* We don't care about snapping to any portion of the window that
-           * is offscreen (we also don't care about parts of edges covered
-           * by other windows or DOCKS, but that's handled below).
-           */
-          meta_rectangle_intersect (&cur_rect, 
-                                    &display->grab_screen->rect,
-                                    &reduced);
+  obscuring_windows = NULL;
+  for (i = n_sources - 1; i >= 0; i--)
+    obscuring_windows = g_slist_prepend (obscuring_windows, &sources[i].rect);
+
+  /*
+   * 3rd: get the edges of the windows, removing the parts obscured by
+   * the windows stacked above them.
+   */
+  edges = NULL;
+  rem_windows = obscuring_windows;
+  for (i = 0; i < n_sources; i++)
+    {
+      GList *new_edges;
+      MetaEdge *new_edge;
+      MetaRectangle reduced;
 
-          new_edges = NULL;
+      /* Only the windows stacked above this one can obscure it */
+      rem_windows = rem_windows->next;
 
-          /* Left side of this window is resistance for the right edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.width = 0;
-          new_edge->side_type = META_SIDE_RIGHT;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Right side of this window is resistance for the left edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.x += new_edge->rect.width;
-          new_edge->rect.width = 0;
-          new_edge->side_type = META_SIDE_LEFT;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-          
-          /* Top side of this window is resistance for the bottom edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.height = 0;
-          new_edge->side_type = META_SIDE_BOTTOM;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Top side of this window is resistance for the bottom edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.y += new_edge->rect.height;
-          new_edge->rect.height = 0;
-          new_edge->side_type = META_SIDE_TOP;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Update the remaining windows to only those at a higher
-           * stacking position than this one.
-           */
-          while (rem_win_stacking &&
-                 stack_position >= GPOINTER_TO_INT (rem_win_stacking->data))
-            {
-              rem_windows      = rem_windows->next;
-              rem_win_stacking = rem_win_stacking->next;
-            }
+      /* Dock edges are considered screen edges which are handled
+       * separately
+       */
+      if (sources[i].is_dock)
+        continue;
 
-          /* Remove edge portions overlapped by rem_windows and rem_docks */
-          new_edges =
-            meta_rectangle_remove_intersections_with_boxes_from_edges (
-              new_edges,
-              rem_windows);
+      /* We don't care about snapping to any portion of the window that
+       * is offscreen (we also don't care about parts of edges covered
+       * by other windows or DOCKS, but that's handled below).
+       */
+      meta_rectangle_intersect (&sources[i].rect,
+                                &display->grab_screen->rect,
+                                &reduced);
 
-          /* Save the new edges */
-          edges = g_list_concat (new_edges, edges);
-        }
+      new_edges = NULL;
 
-      stack_position++;
-      cur_window_iter = cur_window_iter->next;
+      /* Left side of this window is resistance for the right edge of
+       * the window being moved.
+       */
+      new_edge = g_new (MetaEdge, 1);
+      new_edge->rect = reduced;
+      new_edge->rect.width = 0;
+      new_edge->side_type = META_SIDE_RIGHT;
+      new_edge->edge_type = META_EDGE_WINDOW;
+      new_edges = g_list_prepend (new_edges, new_edge);
+
+      /* Right side of this window is resistance for the left edge of
+       * the window being moved.
+       */
+      new_edge = g_new (MetaEdge, 1);
+      new_edge->rect = reduced;
+      new_edge->rect.x += new_edge->rect.width;
+      new_edge->rect.width = 0;
+      new_edge->side_type = META_SIDE_LEFT;
+      new_edge->edge_type = META_EDGE_WINDOW;
+      new_edges = g_list_prepend (new_edges, new_edge);
+
+      /* Top side of this window is resistance for the bottom edge of
+       * the window being moved.
+       */
+      new_edge = g_new (MetaEdge, 1);
+      new_edge->rect = reduced;
+      new_edge->rect.height = 0;
+      new_edge->side_type = META_SIDE_BOTTOM;
+      new_edge->edge_type = META_EDGE_WINDOW;
+      new_edges = g_list_prepend (new_edges, new_edge);
+
+      /* Top side of this window is resistance for the bottom edge of
+       * the window being moved.
+       */
+      new_edge = g_new (MetaEdge, 1);
+      new_edge->rect = reduced;
+      new_edge->rect.y += new_edge->rect.height;
+      new_edge->rect.height = 0;
+      new_edge->side_type = META_SIDE_TOP;
+      new_edge->edge_type = META_EDGE_WINDOW;
+      new_edges = g_list_prepend (new_edges, new_edge);
+
+      /* Remove edge portions overlapped by rem_windows and rem_docks */
+      new_edges =
+        meta_rectangle_remove_intersections_with_boxes_from_edges (
+          new_edges,
+          rem_windows);
+
+      /* Save the new edges */
+      edges = g_list_concat (new_edges, edges);
     }
 
-  /*
-   * 4th: Free the extra memory not needed and sort the list
-   */
-  g_list_free (stacked_windows);
-  /* Free the memory used by the obscuring windows/docks lists */
-  g_slist_free (window_stacking);
-  /* FIXME: Shouldn't there be a helper function to make this one line of code
-   * to free a list instead of four ugly ones?
-   */
-  g_slist_foreach (obscuring_windows,
-                   (void (*)(gpointer,gpointer))&free, /* ew, for ugly */
-                   NULL);
   g_slist_free (obscuring_windows);
 
-  /* Sort the list.  FIXME: Should I bother with this sorting?  I just
-   * sort again later in cache_edges() anyway...
-   */
-  edges = g_list_sort (edges, meta_rectangle_edge_cmp);
-
   /*
-   * 5th: Cache the combination of these edges with the onscreen and
-   * monitor edges in an array for quick access.  Free the edges since
-   * they've been cached elsewhere.
+   * 4th: Copy the combination of these edges with the onscreen and
+   * monitor edges into sorted arrays for quick access, and remember
+   * what they were computed from.
    */
   cache_edges (display,
                edges,
                display->grab_screen->active_workspace->monitor_edges,
                display->grab_screen->active_workspace->screen_edges);
-  g_list_free (edges);
+  meta_rectangle_free_list_and_elements (edges);
+
+  edge_data = display->grab_edge_resistance_data;
+  edge_data->screen = display->grab_screen;
+  edge_data->sources = sources;
+  edge_data->n_sources = n_sources;
 
   /*
-   * 6th: Initialize the resistance timeouts and buildups
+   * 5th: Initialize the resistance timeouts and buildups
    */
   initialize_grab_edge_resistance_data (display);
 }
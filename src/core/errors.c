@@ -45,28 +45,369 @@
  * to the right place, with GTK+-3.0 we simply omit our own error handler and
  * use the GTK+ handling straight-up.
  * (See https://bugzilla.gnome.org/show_bug.cgi?id=630216 for restoring logging.)
+ *
+ * On top of GDK's traps we keep our own record of the serials each trap
+ * covers, so that meta_error_trap_pop_async() can hand the error code
+ * to a callback once the server has got to the end of the trap instead
+ * of waiting for it with a round trip. GDK still handles every error as
+ * before: we install an X error handler of our own over GDK's that
+ * notes the error for the trap covering its serial and passes it on.
+ * GDK puts its own handler back while one of its traps is pushed, so
+ * the round trips we make ourselves put ours back, see sync_display().
+ */
+
+/* How long a trap popped with meta_error_trap_pop_async() may wait
+ * for the server to show it has processed the trap's requests before
+ * we make it with a round trip, in milliseconds
  */
+#define ASYNC_TRAP_TIMEOUT 250
+
+struct _MetaErrorTraps
+{
+  MetaDisplay *display;
+
+  /* The traps pushed and not popped yet, innermost last */
+  GPtrArray *open;
+  /* The traps popped with meta_error_trap_pop_async(), waiting for
+   * the server; traps are popped in the order their requests end, so
+   * this is sorted by end_serial
+   */
+  GQueue pending;
+
+  guint timeout_id;
+};
+
+typedef struct
+{
+  unsigned long start_serial;
+  unsigned long end_serial;
+  int error_code;
+
+  MetaErrorTrapFunc func;
+  gpointer user_data;
+  GDestroyNotify destroy;
+} MetaErrorTrap;
+
+static void
+error_trap_free (MetaErrorTrap *trap)
+{
+  if (trap->destroy)
+    trap->destroy (trap->user_data);
+
+  g_slice_free (MetaErrorTrap, trap);
+}
+
+/* X error handlers don't get any data, and there is only one display */
+static MetaErrorTraps *error_traps = NULL;
+static XErrorHandler gdk_error_handler = NULL;
+
+/* Records the error code for the innermost trap covering the failed
+ * request. Nested traps cover nested ranges, so that is the one that
+ * started last.
+ */
+static int
+meta_x_error (Display     *xdisplay,
+              XErrorEvent *error)
+{
+  MetaErrorTraps *traps = error_traps;
+
+  if (traps && traps->display->xdisplay == xdisplay)
+    {
+      unsigned long serial = error->serial;
+      MetaErrorTrap *innermost = NULL;
+      GList *l;
+      guint i;
+
+      for (l = traps->pending.head; l; l = l->next)
+        {
+          MetaErrorTrap *trap = l->data;
+
+          if (trap->start_serial <= serial && serial < trap->end_serial &&
+              (innermost == NULL || trap->start_serial > innermost->start_serial))
+            innermost = trap;
+        }
+
+      for (i = 0; i < traps->open->len; i++)
+        {
+          MetaErrorTrap *trap = g_ptr_array_index (traps->open, i);
+
+          if (trap->start_serial <= serial &&
+              (innermost == NULL || trap->start_serial > innermost->start_serial))
+            innermost = trap;
+        }
+
+      if (innermost && innermost->error_code == Success)
+        innermost->error_code = error->error_code;
+    }
+
+  /* Let GDK's trap see it too */
+  return gdk_error_handler (xdisplay, error);
+}
+
+/* Reads everything the server has to say up to now with our error
+ * handler in place, even inside a GDK trap, where GDK's is
+ */
+static void
+sync_display (MetaDisplay *display)
+{
+  XErrorHandler old_handler;
+
+  old_handler = XSetErrorHandler (meta_x_error);
+  XSync (display->xdisplay, False);
+  XSetErrorHandler (old_handler);
+}
+
+LOCAL_SYMBOL void
+meta_error_traps_init (MetaDisplay *display)
+{
+  MetaErrorTraps *traps = g_new0 (MetaErrorTraps, 1);
+
+  traps->display = display;
+  traps->open = g_ptr_array_new ();
+  g_queue_init (&traps->pending);
+
+  /* GDK installs its handler when it opens the display and only swaps
+   * it in and out around its traps, so this is the one we pass on to
+   */
+  gdk_error_handler = XSetErrorHandler (meta_x_error);
+
+  error_traps = traps;
+  display->async_error_traps = traps;
+}
+
+/* The callbacks of traps still waiting aren't called */
+LOCAL_SYMBOL void
+meta_error_traps_free (MetaDisplay *display)
+{
+  MetaErrorTraps *traps = display->async_error_traps;
+  MetaErrorTrap *trap;
+
+  if (traps == NULL)
+    return;
+
+  /* If a GDK trap is pushed, GDK puts ours back when it is popped;
+   * that is harmless, it passes everything on now
+   */
+  XSetErrorHandler (gdk_error_handler);
+  error_traps = NULL;
+
+  if (traps->timeout_id)
+    g_source_remove (traps->timeout_id);
+
+  while ((trap = g_queue_pop_head (&traps->pending)))
+    error_trap_free (trap);
+
+  g_ptr_array_foreach (traps->open, (GFunc) error_trap_free, NULL);
+  g_ptr_array_free (traps->open, TRUE);
+
+  g_free (traps);
+  display->async_error_traps = NULL;
+}
+
+/**
+ * meta_error_traps_dispatch:
+ * @display: a #MetaDisplay
+ *
+ * Calls back the traps popped with meta_error_trap_pop_async() whose
+ * requests the server is known to have processed, which it is once
+ * an event, reply or error for a later request has been read.
+ */
+LOCAL_SYMBOL void
+meta_error_traps_dispatch (MetaDisplay *display)
+{
+  MetaErrorTraps *traps = display->async_error_traps;
+  unsigned long processed;
+  MetaErrorTrap *trap;
+
+  if (traps == NULL)
+    return;
+
+  processed = LastKnownRequestProcessed (display->xdisplay);
+
+  while ((trap = g_queue_peek_head (&traps->pending)) &&
+         trap->end_serial - 1 <= processed)
+    {
+      g_queue_pop_head (&traps->pending);
+      trap->func (display, trap->error_code, trap->user_data);
+      error_trap_free (trap);
+    }
+
+  if (g_queue_is_empty (&traps->pending) && traps->timeout_id)
+    {
+      g_source_remove (traps->timeout_id);
+      traps->timeout_id = 0;
+    }
+}
+
+/* Nothing came from the server for a while; one round trip settles
+ * all of the waiting traps at once
+ */
+static gboolean
+async_trap_timeout (gpointer data)
+{
+  MetaErrorTraps *traps = data;
+  MetaDisplay *display = traps->display;
+
+  traps->timeout_id = 0;
+
+  meta_topic (META_DEBUG_SYNC, "Syncing on %s\n", G_STRFUNC);
+  meta_display_note_round_trip (display);
+  sync_display (display);
+
+  meta_error_traps_dispatch (display);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+open_trap (MetaDisplay *display)
+{
+  MetaErrorTrap *trap;
+
+  if (display->async_error_traps == NULL)
+    return;
+
+  trap = g_slice_new0 (MetaErrorTrap);
+  trap->start_serial = XNextRequest (display->xdisplay);
+  g_ptr_array_add (display->async_error_traps->open, trap);
+}
+
+static MetaErrorTrap *
+close_trap (MetaDisplay *display)
+{
+  GPtrArray *open;
+
+  if (display->async_error_traps == NULL)
+    return NULL;
+
+  open = display->async_error_traps->open;
+  g_return_val_if_fail (open->len > 0, NULL);
+
+  return g_ptr_array_remove_index (open, open->len - 1);
+}
 
 void
 meta_error_trap_push (MetaDisplay *display)
 {
+  open_trap (display);
   gdk_x11_display_error_trap_push (display->gdk_display);
 }
 
 void
 meta_error_trap_pop (MetaDisplay *display)
 {
+  MetaErrorTrap *trap;
+
+  trap = close_trap (display);
+  if (trap)
+    error_trap_free (trap);
+
+  /* Never syncs, so there is no round trip to profile */
+  gdk_x11_display_error_trap_pop_ignored (display->gdk_display);
+}
+
+/**
+ * meta_error_trap_pop_async:
+ * @display: a #MetaDisplay
+ * @func: (scope notified): called with the X error code of the first
+ *   request that failed since the trap was pushed, or Success
+ * @user_data: data for @func
+ * @destroy: (allow-none): called on @user_data once it isn't needed
+ *
+ * Pops a trap pushed with meta_error_trap_push(), like
+ * meta_error_trap_pop(), but lets @func find out whether the requests
+ * it covered failed. Unlike meta_error_trap_pop_with_return() this
+ * doesn't wait for the X server: @func is called later, once events or
+ * replies for later requests show the server got past the trapped
+ * ones, or after a short while at the latest. Objects may be gone by
+ * then, so @user_data should rather be an XID to look them up with.
+ *
+ * If the display is closed before that, @func is never called.
+ */
+void
+meta_error_trap_pop_async (MetaDisplay       *display,
+                           MetaErrorTrapFunc  func,
+                           gpointer           user_data,
+                           GDestroyNotify     destroy)
+{
+  MetaErrorTraps *traps = display->async_error_traps;
+  MetaErrorTrap *trap;
+
+  /* Traps pushed while the display was being opened can only be
+   * answered the slow way
+   */
+  if (traps == NULL)
+    {
+      func (display, meta_error_trap_pop_with_return (display), user_data);
+      if (destroy)
+        destroy (user_data);
+      return;
+    }
+
+  trap = close_trap (display);
+
   gdk_x11_display_error_trap_pop_ignored (display->gdk_display);
+
+  if (trap == NULL)
+    {
+      if (destroy)
+        destroy (user_data);
+      return;
+    }
+
+  trap->end_serial = XNextRequest (display->xdisplay);
+  trap->func = func;
+  trap->user_data = user_data;
+  trap->destroy = destroy;
+
+  g_queue_push_tail (&traps->pending, trap);
+
+  if (traps->timeout_id == 0)
+    {
+      traps->timeout_id = g_timeout_add (ASYNC_TRAP_TIMEOUT,
+                                         async_trap_timeout, traps);
+      g_source_set_name_by_id (traps->timeout_id,
+                               "[muffin] async_trap_timeout");
+    }
 }
 
 void
 meta_error_trap_push_with_return (MetaDisplay *display)
 {
+  open_trap (display);
   gdk_x11_display_error_trap_push (display->gdk_display);
 }
 
 int
 meta_error_trap_pop_with_return  (MetaDisplay *display)
 {
-  return gdk_x11_display_error_trap_pop (display->gdk_display);
+  MetaErrorTrap *trap;
+  gint64 start;
+  int result;
+
+  trap = close_trap (display);
+  if (trap)
+    error_trap_free (trap);
+
+  /* GDK only has to sync if some request since the trap was pushed
+   * hasn't been answered yet, i.e. the last one wasn't a round trip
+   * itself; meta_error_trap_pop() never syncs. We make that round trip
+   * ourselves, so that errors for traps popped with
+   * meta_error_trap_pop_async() read on the way are recorded too, and
+   * GDK then finds it has nothing left to wait for.
+   */
+  if (LastKnownRequestProcessed (display->xdisplay) !=
+      XNextRequest (display->xdisplay) - 1)
+    {
+      meta_display_note_round_trip (display);
+      sync_display (display);
+    }
+
+  start = meta_request_profiler_begin (display->request_profiler);
+  result = gdk_x11_display_error_trap_pop (display->gdk_display);
+  meta_request_profiler_end (display->request_profiler,
+                             META_REQUEST_ERROR_TRAP_POP,
+                             META_REQUEST_CALLER, start);
+
+  return result;
 }
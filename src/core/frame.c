@@ -150,6 +150,7 @@ meta_window_ensure_frame (MetaWindow *window)
 
   /* stick frame to the window */
   window->frame = frame;
+  meta_stack_invalidate_hit_index (window->screen->stack);
 
   /* Now that frame->xwindow is registered with window, we can set its
    * style and background.
@@ -219,6 +220,7 @@ meta_window_destroy_frame (MetaWindow *window)
                                     frame->xwindow);
 
   window->frame = NULL;
+  meta_stack_invalidate_hit_index (window->screen->stack);
   if (window->frame_bounds)
     {
       cairo_region_destroy (window->frame_bounds);
@@ -443,7 +445,7 @@ meta_frame_set_screen_cursor (MetaFrame	*frame,
     {
       xcursor = meta_display_create_x_cursor (frame->window->display, cursor);
       XDefineCursor (frame->window->display->xdisplay, frame->xwindow, xcursor);
-      XFlush (frame->window->display->xdisplay);
+      meta_display_flush (frame->window->display);
       XFreeCursor (frame->window->display->xdisplay, xcursor);
     }
 }
@@ -199,19 +199,59 @@ reload_keymap (MetaDisplay *display)
                                          &display->keysyms_per_keycode);
 }
 
+/* Fetches only the keysyms of the keycodes that changed; returns
+ * FALSE if the whole keymap has to be reloaded instead */
+static gboolean
+update_keymap_range (MetaDisplay *display,
+                     int          first_keycode,
+                     int          n_keycodes)
+{
+  KeySym *keysyms;
+  int keysyms_per_keycode;
+
+  if (display->keymap == NULL ||
+      n_keycodes <= 0 ||
+      first_keycode < display->min_keycode ||
+      first_keycode + n_keycodes - 1 > display->max_keycode)
+    return FALSE;
+
+  keysyms = XGetKeyboardMapping (display->xdisplay,
+                                 first_keycode, n_keycodes,
+                                 &keysyms_per_keycode);
+  if (keysyms == NULL)
+    return FALSE;
+
+  /* The keymap is one array with the same width for every keycode */
+  if (keysyms_per_keycode != display->keysyms_per_keycode)
+    {
+      meta_XFree (keysyms);
+      return FALSE;
+    }
+
+  memcpy (display->keymap +
+          (first_keycode - display->min_keycode) * keysyms_per_keycode,
+          keysyms,
+          n_keycodes * keysyms_per_keycode * sizeof (KeySym));
+  meta_XFree (keysyms);
+
+  display->above_tab_keycode = 0;
+
+  meta_topic (META_DEBUG_KEYBINDINGS,
+              "Reloaded keysyms of keycodes %d to %d\n",
+              first_keycode, first_keycode + n_keycodes - 1);
+
+  return TRUE;
+}
+
+/* Works out which modifiers are Super, Num Lock and so forth from the
+ * modmap and the keysyms it maps */
 static void
-reload_modmap (MetaDisplay *display)
+decode_modmap (MetaDisplay *display)
 {
-  XModifierKeymap *modmap;
+  XModifierKeymap *modmap = display->modmap;
   int map_size;
   int i;
 
-  if (display->modmap)
-    XFreeModifiermap (display->modmap);
-
-  modmap = XGetModifierMapping (display->xdisplay);
-  display->modmap = modmap;
-
   display->ignored_modifier_mask = 0;
 
   /* Multiple bits may get set in each of these */
@@ -303,6 +343,17 @@ reload_modmap (MetaDisplay *display)
               display->meta_mask);
 }
 
+static void
+reload_modmap (MetaDisplay *display)
+{
+  if (display->modmap)
+    XFreeModifiermap (display->modmap);
+
+  display->modmap = XGetModifierMapping (display->xdisplay);
+
+  decode_modmap (display);
+}
+
 static guint
 keysym_to_keycode (MetaDisplay *display,
                    guint        keysym)
@@ -337,6 +388,54 @@ reload_keycodes (MetaDisplay *display)
     }
 }
 
+#define KEY_BINDING_INDEX_KEY(keycode, mask) \
+  GUINT_TO_POINTER (((guint) (keycode) << 16) | ((mask) & 0xffff))
+
+/* Key presses are matched on keycode and devirtualized mask, so both
+ * lookups below go through this index instead of scanning the whole
+ * table; it has to be redone whenever either changes.
+ */
+static void
+reindex_key_bindings (MetaDisplay *display)
+{
+  int i;
+
+  if (display->key_bindings_index == NULL)
+    display->key_bindings_index =
+      g_hash_table_new_full (NULL, NULL, NULL,
+                             (GDestroyNotify) g_ptr_array_unref);
+  else
+    g_hash_table_remove_all (display->key_bindings_index);
+
+  for (i = 0; i < display->n_key_bindings; i++)
+    {
+      MetaKeyBinding *binding = &display->key_bindings[i];
+      gpointer key = KEY_BINDING_INDEX_KEY (binding->keycode, binding->mask);
+      GPtrArray *bindings;
+
+      bindings = g_hash_table_lookup (display->key_bindings_index, key);
+      if (bindings == NULL)
+        {
+          bindings = g_ptr_array_new ();
+          g_hash_table_insert (display->key_bindings_index, key, bindings);
+        }
+
+      g_ptr_array_add (bindings, binding);
+    }
+}
+
+static GPtrArray *
+lookup_key_bindings (MetaDisplay  *display,
+                     unsigned int  keycode,
+                     unsigned long mask)
+{
+  if (display->key_bindings_index == NULL)
+    return NULL;
+
+  return g_hash_table_lookup (display->key_bindings_index,
+                              KEY_BINDING_INDEX_KEY (keycode, mask));
+}
+
 static void
 reload_modifiers (MetaDisplay *display)
 {
@@ -363,6 +462,8 @@ reload_modifiers (MetaDisplay *display)
           ++i;
         }
     }
+
+  reindex_key_bindings (display);
 }
 
 
@@ -489,11 +590,190 @@ rebuild_key_binding_table (MetaDisplay *display)
   g_list_free (prefs);
 }
 
+static void meta_change_keygrab (MetaDisplay *display,
+                                 Window       xwindow,
+                                 gboolean     grab,
+                                 int          keysym,
+                                 unsigned int keycode,
+                                 int          modmask);
+
+static GHashTable *
+compute_grab_set (MetaDisplay *display,
+                  gboolean     binding_per_window)
+{
+  GHashTable *grabs;
+  int i;
+
+  grabs = g_hash_table_new (NULL, NULL);
+
+  for (i = 0; i < display->n_key_bindings; i++)
+    {
+      MetaKeyBinding *binding = &display->key_bindings[i];
+
+      if (!!binding_per_window ==
+          !!(binding->handler->flags & META_KEY_BINDING_PER_WINDOW) &&
+          binding->keycode != 0)
+        g_hash_table_insert (grabs,
+                             KEY_BINDING_INDEX_KEY (binding->keycode, binding->mask),
+                             GUINT_TO_POINTER (binding->keysym));
+    }
+
+  return grabs;
+}
+
+/* Puts the grabs in @new_grabs that aren't in @old_grabs in @added and
+ * the reverse in @removed */
+static void
+diff_grab_sets (GHashTable *old_grabs,
+                GHashTable *new_grabs,
+                GHashTable *added,
+                GHashTable *removed)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_hash_table_iter_init (&iter, new_grabs);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    if (!g_hash_table_contains (old_grabs, key))
+      g_hash_table_insert (added, key, value);
+
+  g_hash_table_iter_init (&iter, old_grabs);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    if (!g_hash_table_contains (new_grabs, key))
+      g_hash_table_insert (removed, key, value);
+}
+
+static void
+change_grab_set (MetaDisplay *display,
+                 Window       xwindow,
+                 GHashTable  *grabs,
+                 gboolean     grab)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_hash_table_iter_init (&iter, grabs);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      guint index_key = GPOINTER_TO_UINT (key);
+
+      meta_change_keygrab (display, xwindow, grab,
+                           GPOINTER_TO_UINT (value),
+                           index_key >> 16,
+                           index_key & 0xffff);
+    }
+}
+
+static void
+apply_grab_changes (MetaDisplay *display,
+                    Window       xwindow,
+                    GHashTable  *added,
+                    GHashTable  *removed)
+{
+  change_grab_set (display, xwindow, removed, FALSE);
+  change_grab_set (display, xwindow, added, TRUE);
+}
+
+/* Only issue XGrabKey/XUngrabKey for the key combinations that were
+ * actually added or removed since the last time. This is only possible
+ * while the set of ignored modifiers, whose combinations get grabbed
+ * along with each key, stays the same.
+ */
+static gboolean
+regrab_key_bindings_incrementally (MetaDisplay *display,
+                                   GHashTable  *screen_grabs,
+                                   GHashTable  *window_grabs)
+{
+  GHashTable *screen_added, *screen_removed;
+  GHashTable *window_added, *window_removed;
+  GSList *tmp;
+  GSList *windows;
+
+  if (display->grabbed_screen_keys == NULL ||
+      display->grabbed_window_keys == NULL ||
+      display->grabbed_ignored_mask != display->ignored_modifier_mask)
+    return FALSE;
+
+  screen_added = g_hash_table_new (NULL, NULL);
+  screen_removed = g_hash_table_new (NULL, NULL);
+  window_added = g_hash_table_new (NULL, NULL);
+  window_removed = g_hash_table_new (NULL, NULL);
+
+  diff_grab_sets (display->grabbed_screen_keys, screen_grabs,
+                  screen_added, screen_removed);
+  diff_grab_sets (display->grabbed_window_keys, window_grabs,
+                  window_added, window_removed);
+
+  meta_topic (META_DEBUG_KEYBINDINGS,
+              "Regrabbing keys: %u/%u screen and %u/%u window grabs added/removed\n",
+              g_hash_table_size (screen_added), g_hash_table_size (screen_removed),
+              g_hash_table_size (window_added), g_hash_table_size (window_removed));
+
+  meta_error_trap_push (display); /* for efficiency push outer trap */
+
+  if (g_hash_table_size (screen_added) > 0 ||
+      g_hash_table_size (screen_removed) > 0)
+    {
+      for (tmp = display->screens; tmp != NULL; tmp = tmp->next)
+        {
+          MetaScreen *screen = tmp->data;
+
+          if (screen->keys_grabbed)
+            apply_grab_changes (display, screen->xroot,
+                                screen_added, screen_removed);
+        }
+    }
+
+  if (g_hash_table_size (window_added) > 0 ||
+      g_hash_table_size (window_removed) > 0)
+    {
+      windows = meta_display_list_windows (display, META_LIST_DEFAULT);
+      for (tmp = windows; tmp != NULL; tmp = tmp->next)
+        {
+          MetaWindow *w = tmp->data;
+
+          if (!w->keys_grabbed)
+            continue;
+
+          /* If the frame came or went since the grabs were made, they
+           * need to move anyway */
+          if (w->grab_on_frame != (w->frame != NULL))
+            {
+              meta_window_ungrab_keys (w);
+              meta_window_grab_keys (w);
+              continue;
+            }
+
+          apply_grab_changes (display,
+                              w->frame ? w->frame->xwindow : w->xwindow,
+                              window_added, window_removed);
+        }
+      g_slist_free (windows);
+    }
+
+  meta_error_trap_pop (display);
+
+  g_hash_table_destroy (screen_added);
+  g_hash_table_destroy (screen_removed);
+  g_hash_table_destroy (window_added);
+  g_hash_table_destroy (window_removed);
+
+  return TRUE;
+}
+
 static void
 regrab_key_bindings (MetaDisplay *display)
 {
   GSList *tmp;
   GSList *windows;
+  GHashTable *screen_grabs;
+  GHashTable *window_grabs;
+
+  screen_grabs = compute_grab_set (display, FALSE);
+  window_grabs = compute_grab_set (display, TRUE);
+
+  if (regrab_key_bindings_incrementally (display, screen_grabs, window_grabs))
+    goto out;
 
   meta_error_trap_push (display); /* for efficiency push outer trap */
 
@@ -522,6 +802,13 @@ regrab_key_bindings (MetaDisplay *display)
   meta_error_trap_pop (display);
 
   g_slist_free (windows);
+
+ out:
+  g_clear_pointer (&display->grabbed_screen_keys, g_hash_table_destroy);
+  g_clear_pointer (&display->grabbed_window_keys, g_hash_table_destroy);
+  display->grabbed_screen_keys = screen_grabs;
+  display->grabbed_window_keys = window_grabs;
+  display->grabbed_ignored_mask = display->ignored_modifier_mask;
 }
 
 static MetaKeyBinding *
@@ -530,19 +817,20 @@ display_get_keybinding (MetaDisplay  *display,
                         unsigned int  keycode,
                         unsigned long mask)
 {
+  GPtrArray *bindings;
   int i;
 
-  i = display->n_key_bindings - 1;
-  while (i >= 0)
+  bindings = lookup_key_bindings (display, keycode, mask);
+  if (bindings == NULL)
+    return NULL;
+
+  /* The last binding in the table wins */
+  for (i = bindings->len - 1; i >= 0; i--)
     {
-      if (display->key_bindings[i].keysym == keysym &&
-          display->key_bindings[i].keycode == keycode &&
-          display->key_bindings[i].mask == mask)
-        {
-          return &display->key_bindings[i];
-        }
+      MetaKeyBinding *binding = g_ptr_array_index (bindings, i);
 
-      --i;
+      if (binding->keysym == keysym)
+        return binding;
     }
 
   return NULL;
@@ -802,15 +1090,44 @@ meta_display_process_mapping_event (MetaDisplay *display,
 {
   gboolean keymap_changed = FALSE;
   gboolean modmap_changed = FALSE;
+  /* The keycodes whose keysyms changed; none means all of them */
+  int first_keycode = 0;
+  int n_keycodes = 0;
 
 #ifdef HAVE_XKB
   if (event->type == display->xkb_base_event_type)
     {
-      meta_topic (META_DEBUG_KEYBINDINGS,
-                  "XKB mapping changed, will redo keybindings\n");
+      XkbAnyEvent *xkb_ev = (XkbAnyEvent *) event;
 
-      keymap_changed = TRUE;
-      modmap_changed = TRUE;
+      if (xkb_ev->xkb_type == XkbMapNotify)
+        {
+          XkbMapNotifyEvent *map_ev = (XkbMapNotifyEvent *) event;
+
+          meta_topic (META_DEBUG_KEYBINDINGS,
+                      "XKB map changed (0x%x), will redo keybindings\n",
+                      map_ev->changed);
+
+          /* New key types can change the keysyms of any keycode;
+           * the rest of the map (actions, behaviors...) doesn't
+           * matter to us */
+          keymap_changed = (map_ev->changed &
+                            (XkbKeyTypesMask | XkbKeySymsMask)) != 0;
+          modmap_changed = (map_ev->changed & XkbModifierMapMask) != 0;
+
+          if (!(map_ev->changed & XkbKeyTypesMask))
+            {
+              first_keycode = map_ev->first_key_sym;
+              n_keycodes = map_ev->num_key_syms;
+            }
+        }
+      else
+        {
+          meta_topic (META_DEBUG_KEYBINDINGS,
+                      "New XKB keyboard, will redo keybindings\n");
+
+          keymap_changed = TRUE;
+          modmap_changed = TRUE;
+        }
     }
   else
 #endif
@@ -827,19 +1144,26 @@ meta_display_process_mapping_event (MetaDisplay *display,
                   "Received MappingKeyboard event, will reload keycodes and redo keybindings\n");
 
       keymap_changed = TRUE;
+      first_keycode = event->xmapping.first_keycode;
+      n_keycodes = event->xmapping.count;
     }
 
   /* Now to do the work itself */
 
   if (keymap_changed || modmap_changed)
     {
-      if (keymap_changed)
+      if (keymap_changed &&
+          !update_keymap_range (display, first_keycode, n_keycodes))
         reload_keymap (display);
 
       /* Deciphering the modmap depends on the loaded keysyms to find out
-       * what modifiers is Super and so forth, so we need to reload it
-       * even when only the keymap changes */
-      reload_modmap (display);
+       * what modifiers is Super and so forth, so we need to redo it
+       * even when only the keymap changes; the modmap itself only needs
+       * fetching again when it changed */
+      if (modmap_changed || display->modmap == NULL)
+        reload_modmap (display);
+      else
+        decode_modmap (display);
 
       if (keymap_changed)
         reload_keycodes (display);
@@ -922,6 +1246,10 @@ meta_display_shutdown_keys (MetaDisplay *display)
 
   if (display->modmap)
     XFreeModifiermap (display->modmap);
+
+  g_clear_pointer (&display->key_bindings_index, g_hash_table_destroy);
+  g_clear_pointer (&display->grabbed_screen_keys, g_hash_table_destroy);
+  g_clear_pointer (&display->grabbed_window_keys, g_hash_table_destroy);
   free (display->key_bindings);
 }
 
@@ -938,6 +1266,30 @@ keysym_name (int keysym)
 }
 
 /* Grab/ungrab, ignoring all annoying modifiers like NumLock etc. */
+typedef struct
+{
+  int          keysym;
+  unsigned int mask;
+} KeyGrabCheck;
+
+/* Learning why a grab failed doesn't need a round trip per grab */
+static void
+key_grab_checked (MetaDisplay *display,
+                  int          error_code,
+                  gpointer     user_data)
+{
+  KeyGrabCheck *check = user_data;
+
+  if (error_code == BadAccess)
+    meta_warning ("Some other program is already using the key %s with modifiers %x as a binding\n", keysym_name (check->keysym), check->mask);
+#ifdef WITH_VERBOSE_MODE
+  else if (error_code != Success)
+    meta_topic (META_DEBUG_KEYBINDINGS,
+                "Failed to grab key %s with modifiers %x\n",
+                keysym_name (check->keysym), check->mask);
+#endif
+}
+
 static void
 meta_change_keygrab (MetaDisplay *display,
                      Window       xwindow,
@@ -974,8 +1326,8 @@ meta_change_keygrab (MetaDisplay *display,
           continue;
         }
 
-      if (meta_is_debugging ())
-        meta_error_trap_push_with_return (display);
+      if (grab && meta_is_debugging ())
+        meta_error_trap_push (display);
       if (grab)
         XGrabKey (display->xdisplay, keycode,
                   modmask | ignored_mask,
@@ -987,23 +1339,13 @@ meta_change_keygrab (MetaDisplay *display,
                     modmask | ignored_mask,
                     xwindow);
 
-      if (meta_is_debugging ())
+      if (grab && meta_is_debugging ())
         {
-          int result;
-
-          result = meta_error_trap_pop_with_return (display);
+          KeyGrabCheck *check = g_new (KeyGrabCheck, 1);
 
-          if (grab && result != Success)
-            {
-              if (result == BadAccess)
-                meta_warning ("Some other program is already using the key %s with modifiers %x as a binding\n", keysym_name (keysym), modmask | ignored_mask);
-#ifdef WITH_VERBOSE_MODE
-              else
-                meta_topic (META_DEBUG_KEYBINDINGS,
-                            "Failed to grab key %s with modifiers %x\n",
-                            keysym_name (keysym), modmask | ignored_mask);
-#endif
-            }
+          check->keysym = keysym;
+          check->mask = modmask | ignored_mask;
+          meta_error_trap_pop_async (display, key_grab_checked, check, g_free);
         }
 
       ++ignored_mask;
@@ -1054,29 +1396,31 @@ grab_keys (MetaKeyBinding *bindings,
   meta_error_trap_pop (display);
 }
 
+static void
+ungrab_all_keys_checked (MetaDisplay *display,
+                         int          error_code,
+                         gpointer     user_data)
+{
+#ifdef WITH_VERBOSE_MODE
+  if (error_code != Success)
+    meta_topic (META_DEBUG_KEYBINDINGS,
+                "Ungrabbing all keys on 0x%lx failed\n",
+                (Window) GPOINTER_TO_SIZE (user_data));
+#endif
+}
+
 static void
 ungrab_all_keys (MetaDisplay *display,
                  Window       xwindow)
 {
-  if (meta_is_debugging ())
-    meta_error_trap_push_with_return (display);
-  else
-    meta_error_trap_push (display);
+  meta_error_trap_push (display);
 
   XUngrabKey (display->xdisplay, AnyKey, AnyModifier,
               xwindow);
 
   if (meta_is_debugging ())
-    {
-      int result;
-
-      result = meta_error_trap_pop_with_return (display);
-#ifdef WITH_VERBOSE_MODE
-      if (result != Success)
-        meta_topic (META_DEBUG_KEYBINDINGS,
-                    "Ungrabbing all keys on 0x%lx failed\n", xwindow);
-#endif
-    }
+    meta_error_trap_pop_async (display, ungrab_all_keys_checked,
+                               GSIZE_TO_POINTER (xwindow), NULL);
   else
     meta_error_trap_pop (display);
 }
@@ -1505,9 +1849,7 @@ is_modifier_only_kb (MetaDisplay *display, XEvent *event, KeySym keysym)
 
 /* now called from only one place, may be worth merging */
 static gboolean
-process_event (MetaKeyBinding       *bindings,
-               int                   n_bindings,
-               MetaDisplay          *display,
+process_event (MetaDisplay          *display,
                MetaScreen           *screen,
                MetaWindow           *window,
                XEvent               *event,
@@ -1516,7 +1858,8 @@ process_event (MetaKeyBinding       *bindings,
                gboolean              allow_release,
                gboolean              mouse_grab_move)
 {
-  int i;
+  GPtrArray *bindings;
+  guint i;
   unsigned long mask;
 
   /* we used to have release-based bindings but no longer. */
@@ -1530,13 +1873,12 @@ process_event (MetaKeyBinding       *bindings,
       strip_self_mod (keysym, &mask);
     }
 
-  /*
-   * TODO: This would be better done with a hash table;
-   * it doesn't suit to use O(n) for such a common operation.
-   */
-  for (i=0; i<n_bindings; i++)
+  bindings = lookup_key_bindings (display, event->xkey.keycode, mask);
+
+  for (i = 0; bindings != NULL && i < bindings->len; i++)
     {
-      MetaKeyHandler *handler = bindings[i].handler;
+      MetaKeyBinding *binding = g_ptr_array_index (bindings, i);
+      MetaKeyHandler *handler = binding->handler;
 
       /* Custom keybindings are from Cinnamon, and never need a window */
       if (!on_window && handler->flags & META_KEY_BINDING_PER_WINDOW && handler->action < META_KEYBINDING_ACTION_CUSTOM)
@@ -1549,9 +1891,7 @@ process_event (MetaKeyBinding       *bindings,
           (handler->action < META_KEYBINDING_ACTION_WORKSPACE_1 || handler->action > META_KEYBINDING_ACTION_WORKSPACE_RIGHT))
         continue;
 
-      if ((event->type != KeyPress && !allow_release) ||
-          bindings[i].keycode != event->xkey.keycode ||
-          mask != bindings[i].mask)
+      if (event->type != KeyPress && !allow_release)
         continue;
 
       /*
@@ -1562,16 +1902,16 @@ process_event (MetaKeyBinding       *bindings,
 
       meta_topic (META_DEBUG_KEYBINDINGS,
                   "Binding keycode 0x%x mask 0x%x matches event 0x%x state 0x%x\n",
-                  bindings[i].keycode, bindings[i].mask,
+                  binding->keycode, binding->mask,
                   event->xkey.keycode, event->xkey.state);
 
       if (handler == NULL)
-        meta_bug ("Binding %s has no handler\n", bindings[i].name);
+        meta_bug ("Binding %s has no handler\n", binding->name);
 #ifdef WITH_VERBOSE_MODE
       else
         meta_topic (META_DEBUG_KEYBINDINGS,
                     "Running handler for %s\n",
-                    bindings[i].name);
+                    binding->name);
 #endif
       /* Global keybindings count as a let-the-terminal-lose-focus
        * due to new window mapping until the user starts
@@ -1579,7 +1919,7 @@ process_event (MetaKeyBinding       *bindings,
        */
       display->allow_terminal_deactivation = TRUE;
 
-      invoke_handler (display, screen, handler, window, event, &bindings[i]);
+      invoke_handler (display, screen, handler, window, event, binding);
 
       return TRUE;
     }
@@ -1624,9 +1964,7 @@ process_modifier_key (MetaDisplay *display,
            */
           modifier_only_is_down = FALSE;
             /* Try our keybindings */
-          if (process_event (display->key_bindings,
-                             display->n_key_bindings,
-                             display, screen, window, event, keysym,
+          if (process_event (display, screen, window, event, keysym,
                              have_window, FALSE, FALSE))
             {
               /* we had a binding, we're done */
@@ -1820,9 +2158,7 @@ meta_display_process_key_event (MetaDisplay *display,
     }
 
   /* Do the normal keybindings */
-  return process_event (display->key_bindings,
-                        display->n_key_bindings,
-                        display, screen, window, event, keysym,
+  return process_event (display, screen, window, event, keysym,
                         !all_keys_grabbed && window, allow_key_up,
                         mouse_grab_move);
 }
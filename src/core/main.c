@@ -54,6 +54,7 @@
 #include <meta/errors.h>
 #include "ui.h"
 #include "session.h"
+#include "startup-trace.h"
 #include <meta/prefs.h>
 #include <meta/compositor.h>
 
@@ -95,8 +96,9 @@ static MetaExitCode meta_exit_code = META_EXIT_SUCCESS;
  */
 static GMainLoop *meta_main_loop = NULL;
 
-static void prefs_changed_callback (MetaPreference pref,
-                                    gpointer       data);
+static void prefs_changed_callback (const MetaPreference *prefs,
+                                    int                   n_prefs,
+                                    gpointer              data);
 
 /*
  * Prints log messages. If Muffin was compiled with backtrace support,
@@ -205,6 +207,7 @@ static gchar    *opt_client_id;
 static gboolean  opt_replace_wm;
 static gboolean  opt_disable_sm;
 static gboolean  opt_sync;
+static gboolean  opt_profile_x_requests;
 
 static GOptionEntry meta_options[] = {
   {
@@ -242,6 +245,12 @@ static GOptionEntry meta_options[] = {
     N_("Make X calls synchronous"),
     NULL
   },
+  {
+    "profile-x-requests", 0, 0, G_OPTION_ARG_NONE,
+    &opt_profile_x_requests,
+    N_("Collect statistics about X round trips, printed on SIGUSR1 and at exit"),
+    NULL
+  },
   {NULL}
 };
 
@@ -345,6 +354,12 @@ meta_clutter_init (void)
             * otherwise, without INTEL_swap_event, we'll just block in glXSwapBuffers().
             */
           cogl_xlib_renderer_set_threaded_swap_wait_enabled (renderer, TRUE);
+
+          /* Optionally issue glXSwapBuffers() from that thread as well, so
+           * that a driver throttling us in the swap doesn't hold up events.
+           */
+          cogl_xlib_renderer_set_threaded_present_enabled (renderer,
+                                                           meta_prefs_get_threaded_present ());
         }
     }
   else
@@ -418,6 +433,8 @@ meta_init (void)
   GIOChannel *channel;
   gboolean threaded_swap = meta_prefs_get_threaded_swap ();
 
+  meta_startup_trace_init ();
+
   /* XInitThreads() is needed to use the "threaded swap wait" functionality
    * in Cogl. We call it here to hopefully call it before any other use of XLib.
    */
@@ -469,6 +486,8 @@ meta_init (void)
 #endif
 
   meta_set_syncing (opt_sync || (g_getenv ("MUFFIN_SYNC") != NULL));
+  meta_set_profiling_requests (opt_profile_x_requests ||
+                               (g_getenv ("MUFFIN_PROFILE_X_REQUESTS") != NULL));
 
   meta_select_display (opt_display_name);
 
@@ -480,7 +499,9 @@ meta_init (void)
 
   meta_main_loop = g_main_loop_new (NULL, FALSE);
 
+  meta_startup_trace_begin ("meta_ui_init");
   meta_ui_init ();
+  meta_startup_trace_end ("meta_ui_init");
 
   /*
    * Disable some variables that cause rendering issues with private Clutter,
@@ -492,13 +513,17 @@ meta_init (void)
     g_unsetenv ("CLUTTER_PAINT");
 
   /* Load prefs */
+  meta_startup_trace_begin ("meta_prefs_init");
   meta_prefs_init ();
+  meta_startup_trace_end ("meta_prefs_init");
   _clutter_set_sync_method (meta_prefs_get_sync_method ());
 
   /*
    * Clutter can only be initialized after the UI.
    */
+  meta_startup_trace_begin ("clutter init");
   meta_clutter_init ();
+  meta_startup_trace_end ("clutter init");
 
   const char *renderer = (const char *) glGetString (GL_RENDERER);
   if (strstr (renderer, "llvmpipe") ||
@@ -528,7 +553,7 @@ meta_run (void)
   };
   guint i;
 
-  meta_prefs_add_listener (prefs_changed_callback, NULL);
+  meta_prefs_add_batch_listener (prefs_changed_callback, NULL);
 
   for (i=0; i<G_N_ELEMENTS(log_domains); i++)
     g_log_set_handler (log_domains[i],
@@ -538,6 +563,7 @@ meta_run (void)
   if (g_getenv ("MUFFIN_G_FATAL_WARNINGS") != NULL)
     g_log_set_always_fatal (G_LOG_LEVEL_MASK);
 
+  meta_startup_trace_begin ("theme load");
   meta_ui_set_current_theme (meta_prefs_get_theme (), FALSE);
 
   if (!meta_ui_have_a_theme ())
@@ -545,6 +571,7 @@ meta_run (void)
       meta_ui_set_current_theme ("Default", FALSE);
       meta_warning ("Could not find theme %s. Falling back to default theme.", meta_prefs_get_theme ());
     }
+  meta_startup_trace_end ("theme load");
 
 
   /* Connect to SM as late as possible - but before managing display,
@@ -567,7 +594,9 @@ meta_run (void)
        * use the same client id. */
       g_unsetenv ("DESKTOP_AUTOSTART_ID");
 
+      meta_startup_trace_begin ("meta_session_init");
       meta_session_init (opt_client_id, opt_save_file);
+      meta_startup_trace_end ("meta_session_init");
     }
   /* Free memory possibly allocated by the argument parsing which are
    * no longer needed.
@@ -576,8 +605,10 @@ meta_run (void)
   free (opt_display_name);
   free (opt_client_id);
 
+  meta_startup_trace_begin ("meta_display_open");
   if (!meta_display_open ())
     meta_exit (META_EXIT_ERROR);
+  meta_startup_trace_end ("meta_display_open");
 
   g_main_loop_run (meta_main_loop);
 
@@ -611,37 +642,68 @@ meta_quit (MetaExitCode code)
  * \bug Why are these particular prefs handled in main.c and not others?
  * Should they be?
  *
- * \param pref  Which preference has changed
+ * Several of them reload the theme or the cursors, so all the prefs
+ * that changed together are handled at once and each of those is done
+ * only once however many of its prefs changed.
+ *
+ * \param prefs  Which preferences have changed
+ * \param n_prefs  How many preferences have changed
  * \param data  Arbitrary data (which we ignore)
  */
 static void
-prefs_changed_callback (MetaPreference pref,
-                        gpointer       data)
+prefs_changed_callback (const MetaPreference *prefs,
+                        int                   n_prefs,
+                        gpointer              data)
 {
-  switch (pref)
+  gboolean set_theme = FALSE;
+  gboolean force_reload_theme = FALSE;
+  gboolean set_cursor_theme = FALSE;
+  int i;
+
+  for (i = 0; i < n_prefs; i++)
     {
-    case META_PREF_THEME:
-    case META_PREF_DRAGGABLE_BORDER_WIDTH:
-      meta_ui_set_current_theme (meta_prefs_get_theme (), FALSE);
-      meta_display_retheme_all ();
-      break;
-
-    case META_PREF_CURSOR_THEME:
-    case META_PREF_CURSOR_SIZE:
-      meta_display_set_cursor_theme (meta_prefs_get_cursor_theme (),
-				     meta_prefs_get_cursor_size ());
-      break;
-    case META_PREF_SYNC_METHOD:
-      meta_display_update_sync_state (meta_prefs_get_sync_method ());
-      break;
-    case META_PREF_UI_SCALE:
-      meta_ui_set_current_theme (meta_prefs_get_theme (), TRUE);
+      switch (prefs[i])
+        {
+        case META_PREF_THEME:
+        case META_PREF_DRAGGABLE_BORDER_WIDTH:
+          set_theme = TRUE;
+          break;
+
+        case META_PREF_CURSOR_THEME:
+        case META_PREF_CURSOR_SIZE:
+          set_cursor_theme = TRUE;
+          break;
+        case META_PREF_SYNC_METHOD:
+          meta_display_update_sync_state (meta_prefs_get_sync_method ());
+          break;
+        case META_PREF_GEOMETRIC_PICKING:
+          meta_display_update_geometric_picking ();
+          break;
+        case META_PREF_DENSITY_MODE:
+        case META_PREF_DENSITY_FRAME_RATE:
+          meta_display_update_density_mode ();
+          break;
+        case META_PREF_COLOR_FILTER:
+          meta_display_update_color_filter ();
+          break;
+        case META_PREF_UI_SCALE:
+          set_theme = TRUE;
+          force_reload_theme = TRUE;
+          set_cursor_theme = TRUE;
+          break;
+        default:
+          /* handled elsewhere or otherwise */
+          break;
+        }
+    }
+
+  if (set_theme)
+    {
+      meta_ui_set_current_theme (meta_prefs_get_theme (), force_reload_theme);
       meta_display_retheme_all ();
-      meta_display_set_cursor_theme (meta_prefs_get_cursor_theme (),
-                                     meta_prefs_get_cursor_size ());
-      break;
-    default:
-      /* handled elsewhere or otherwise */
-      break;
     }
+
+  if (set_cursor_theme)
+    meta_display_set_cursor_theme (meta_prefs_get_cursor_theme (),
+                                   meta_prefs_get_cursor_size ());
 }
@@ -442,48 +442,126 @@ avoid_being_obscured_as_second_modal_dialog (MetaWindow *window,
     }
 }
 
+/* The outer rects of the windows that new windows shouldn't overlap,
+ * sorted by their left edge, so that only the ones that could overlap
+ * a candidate rect need to be looked at.
+ */
+typedef struct
+{
+  MetaRectangle *rects;
+  int            n_rects;
+  int            max_width;
+} PlacementObstacles;
+
 static gboolean
-rectangle_overlaps_some_window (MetaRectangle *rect,
-                                GList         *windows)
+window_obstructs_placement (MetaWindow *window)
+{
+  switch (window->type)
+    {
+    case META_WINDOW_DOCK:
+    case META_WINDOW_SPLASHSCREEN:
+    case META_WINDOW_DESKTOP:
+    case META_WINDOW_DIALOG:
+    case META_WINDOW_MODAL_DIALOG:
+    /* override redirect window types: */
+    case META_WINDOW_DROPDOWN_MENU:
+    case META_WINDOW_POPUP_MENU:
+    case META_WINDOW_TOOLTIP:
+    case META_WINDOW_NOTIFICATION:
+    case META_WINDOW_COMBO:
+    case META_WINDOW_DND:
+    case META_WINDOW_OVERRIDE_OTHER:
+      return FALSE;
+
+    case META_WINDOW_NORMAL:
+    case META_WINDOW_UTILITY:
+    case META_WINDOW_TOOLBAR:
+    case META_WINDOW_MENU:
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static int
+compare_rect_left (const void *a, const void *b)
+{
+  const MetaRectangle *ar = a;
+  const MetaRectangle *br = b;
+
+  if (ar->x < br->x)
+    return -1;
+  else if (ar->x > br->x)
+    return 1;
+  else
+    return 0;
+}
+
+static void
+placement_obstacles_init (PlacementObstacles *obstacles,
+                          GList              *windows)
 {
   GList *tmp;
-  MetaRectangle dest;
-  
-  tmp = windows;
-  while (tmp != NULL)
+
+  obstacles->rects = g_new (MetaRectangle, g_list_length (windows));
+  obstacles->n_rects = 0;
+  obstacles->max_width = 0;
+
+  for (tmp = windows; tmp != NULL; tmp = tmp->next)
     {
       MetaWindow *other = tmp->data;
-      MetaRectangle other_rect;      
+      MetaRectangle *other_rect = &obstacles->rects[obstacles->n_rects];
 
-      switch (other->type)
-        {
-        case META_WINDOW_DOCK:
-        case META_WINDOW_SPLASHSCREEN:
-        case META_WINDOW_DESKTOP:
-        case META_WINDOW_DIALOG:
-        case META_WINDOW_MODAL_DIALOG:
-	/* override redirect window types: */
-	case META_WINDOW_DROPDOWN_MENU:
-	case META_WINDOW_POPUP_MENU:
-	case META_WINDOW_TOOLTIP:
-	case META_WINDOW_NOTIFICATION:
-	case META_WINDOW_COMBO:
-	case META_WINDOW_DND:
-	case META_WINDOW_OVERRIDE_OTHER:
-          break;
+      if (!window_obstructs_placement (other))
+        continue;
 
-        case META_WINDOW_NORMAL:
-        case META_WINDOW_UTILITY:
-        case META_WINDOW_TOOLBAR:
-        case META_WINDOW_MENU:
-          meta_window_get_outer_rect (other, &other_rect);
-          
-          if (meta_rectangle_intersect (rect, &other_rect, &dest))
-            return TRUE;
-          break;
-        }
-      
-      tmp = tmp->next;
+      meta_window_get_outer_rect (other, other_rect);
+      obstacles->max_width = MAX (obstacles->max_width, other_rect->width);
+      obstacles->n_rects++;
+    }
+
+  qsort (obstacles->rects, obstacles->n_rects, sizeof (MetaRectangle),
+         compare_rect_left);
+}
+
+static void
+placement_obstacles_clear (PlacementObstacles *obstacles)
+{
+  free (obstacles->rects);
+  obstacles->rects = NULL;
+  obstacles->n_rects = 0;
+}
+
+static gboolean
+rectangle_overlaps_some_window (MetaRectangle            *rect,
+                                const PlacementObstacles *obstacles)
+{
+  MetaRectangle dest;
+  int low, high, i;
+
+  /* Nothing starting max_width or more left of rect can reach it; find
+   * the first rect that starts to the right of that
+   */
+  low = 0;
+  high = obstacles->n_rects;
+  while (low < high)
+    {
+      int mid = low + (high - low) / 2;
+
+      if (obstacles->rects[mid].x <= rect->x - obstacles->max_width)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  /* and stop at the first one that starts right of rect */
+  for (i = low;
+       i < obstacles->n_rects &&
+       obstacles->rects[i].x < rect->x + rect->width;
+       i++)
+    {
+      if (meta_rectangle_intersect (rect, &obstacles->rects[i], &dest))
+        return TRUE;
     }
 
   return FALSE;
@@ -595,9 +673,13 @@ find_first_fit (MetaWindow *window,
   GList *tmp;
   MetaRectangle rect;
   MetaRectangle work_area;
+  PlacementObstacles obstacles;
   
   retval = FALSE;
 
+  /* The windows to avoid, which are the same for every candidate */
+  placement_obstacles_init (&obstacles, windows);
+
   /* Below each window */
   below_sorted = g_list_copy (windows);
   below_sorted = g_list_sort (below_sorted, leftmost_cmp);
@@ -633,7 +715,7 @@ find_first_fit (MetaWindow *window,
     center_tile_rect_in_area (&rect, &work_area);
 
     if (meta_rectangle_contains_rect (&work_area, &rect) &&
-        !rectangle_overlaps_some_window (&rect, windows))
+        !rectangle_overlaps_some_window (&rect, &obstacles))
       {
         *new_x = rect.x;
         *new_y = rect.y;
@@ -661,7 +743,7 @@ find_first_fit (MetaWindow *window,
         rect.y = outer_rect.y + outer_rect.height;
       
         if (meta_rectangle_contains_rect (&work_area, &rect) &&
-            !rectangle_overlaps_some_window (&rect, below_sorted))
+            !rectangle_overlaps_some_window (&rect, &obstacles))
           {
             *new_x = rect.x;
             *new_y = rect.y;
@@ -692,7 +774,7 @@ find_first_fit (MetaWindow *window,
         rect.y = outer_rect.y;
    
         if (meta_rectangle_contains_rect (&work_area, &rect) &&
-            !rectangle_overlaps_some_window (&rect, right_sorted))
+            !rectangle_overlaps_some_window (&rect, &obstacles))
           {
             *new_x = rect.x;
             *new_y = rect.y;
@@ -712,6 +794,7 @@ find_first_fit (MetaWindow *window,
       
  out:
 
+  placement_obstacles_clear (&obstacles);
   g_list_free (below_sorted);
   g_list_free (right_sorted);
   return retval;
@@ -53,6 +53,7 @@
 #define KEY_NUM_WORKSPACES "num-workspaces"
 #define KEY_WORKSPACE_NAMES "workspace-names"
 #define KEY_WORKSPACE_CYCLE "workspace-cycle"
+#define KEY_TEARING_ALLOWED_WM_CLASSES "tearing-allowed-wm-classes"
 
 /* Keys from "foreign" schemas */
 #define KEY_GNOME_ANIMATIONS "enable-animations"
@@ -77,6 +78,7 @@
 static GList *changes = NULL;
 static guint changed_idle;
 static GList *listeners = NULL;
+static GList *batch_listeners = NULL;
 static GHashTable *settings_schemas;
 
 static gboolean use_system_font = FALSE;
@@ -99,9 +101,14 @@ static CDesktopTitlebarScrollAction action_scroll_titlebar = C_DESKTOP_TITLEBAR_
 static gboolean dynamic_workspaces = FALSE;
 static gboolean unredirect_fullscreen_windows = FALSE;
 static gboolean desktop_effects = TRUE;
+static gboolean density_mode = FALSE;
+static gboolean compositor_magnifier = FALSE;
+static int density_frame_rate = 20;
 static MetaSyncMethod sync_method = META_SYNC_PRESENTATION_TIME;
 static gboolean threaded_swap = TRUE;
+static gboolean threaded_present = FALSE;
 static gboolean send_frame_timings = TRUE;
+static gboolean geometric_picking = FALSE;
 static gboolean application_based = FALSE;
 static gboolean disable_workarounds = FALSE;
 static gboolean auto_raise = FALSE;
@@ -125,6 +132,9 @@ static MetaButtonLayout button_layout;
 /* NULL-terminated array */
 static char **workspace_names = NULL;
 
+/* NULL-terminated array */
+static char **tearing_allowed_wm_classes = NULL;
+
 static gboolean workspaces_only_on_primary = FALSE;
 
 static gboolean legacy_snap = FALSE;
@@ -139,6 +149,7 @@ static gboolean update_key_binding     (const char  *key,
                                         gchar      **strokes);
 static gboolean update_workspace_names (void);
 static void update_min_win_opacity (void);
+static gboolean update_tearing_allowed_wm_classes (void);
 
 static void settings_changed (GSettings      *settings,
                               gchar          *key,
@@ -167,12 +178,20 @@ static MetaPlacementMode placement_mode = META_PLACEMENT_MODE_AUTOMATIC;
 
 static MetaBackgroundTransition background_transition = META_BACKGROUND_TRANSITION_BLEND;
 
+static MetaColorFilter color_filter = META_COLOR_FILTER_NONE;
+
 typedef struct
 {
   MetaPrefsChangedFunc func;
   gpointer data;
 } MetaPrefsListener;
 
+typedef struct
+{
+  MetaPrefsBatchChangedFunc func;
+  gpointer data;
+} MetaPrefsBatchListener;
+
 typedef struct
 {
   char *key;
@@ -303,6 +322,13 @@ static MetaEnumPreference preferences_enum[] =
       },
       &sync_method,
     },
+    {
+      { "color-filter",
+        SCHEMA_MUFFIN,
+        META_PREF_COLOR_FILTER,
+      },
+      &color_filter,
+    },
     { { NULL, 0, 0 }, NULL },
   };
 
@@ -364,6 +390,20 @@ static MetaBoolPreference preferences_bool[] =
       },
       &desktop_effects,
     },
+    {
+      { "density-mode",
+        SCHEMA_MUFFIN,
+        META_PREF_DENSITY_MODE,
+      },
+      &density_mode,
+    },
+    {
+      { "compositor-magnifier",
+        SCHEMA_MUFFIN,
+        META_PREF_COMPOSITOR_MAGNIFIER,
+      },
+      &compositor_magnifier,
+    },
     {
       { "threaded-swap",
         SCHEMA_MUFFIN,
@@ -371,6 +411,13 @@ static MetaBoolPreference preferences_bool[] =
       },
       &threaded_swap,
     },
+    {
+      { "threaded-present",
+        SCHEMA_MUFFIN,
+        META_PREF_THREADED_PRESENT,
+      },
+      &threaded_present,
+    },
     {
       { "send-frame-timings",
         SCHEMA_MUFFIN,
@@ -378,6 +425,13 @@ static MetaBoolPreference preferences_bool[] =
       },
       &send_frame_timings,
     },
+    {
+      { "geometric-picking",
+        SCHEMA_MUFFIN,
+        META_PREF_GEOMETRIC_PICKING,
+      },
+      &geometric_picking,
+    },
     {
       { "application-based",
         SCHEMA_GENERAL,
@@ -571,6 +625,13 @@ static MetaIntPreference preferences_int[] =
       },
       &resize_threshold
     },
+    {
+      { "density-frame-rate",
+        SCHEMA_MUFFIN,
+        META_PREF_DENSITY_FRAME_RATE,
+      },
+      &density_frame_rate
+    },
     { { NULL, 0, 0 }, NULL },
   };
 
@@ -852,6 +913,58 @@ meta_prefs_remove_listener (MetaPrefsChangedFunc func,
   meta_bug ("Did not find listener to remove\n");
 }
 
+/**
+ * meta_prefs_add_batch_listener: (skip)
+ *
+ * Adds a listener that is told about all the preferences that changed
+ * together at once, after the listeners added by
+ * meta_prefs_add_listener() have been told about each of them. Setting
+ * a theme changes many preferences at once, so listeners doing work the
+ * same for several of them should use this to do it only once.
+ */
+void
+meta_prefs_add_batch_listener (MetaPrefsBatchChangedFunc func,
+                               gpointer                  data)
+{
+  MetaPrefsBatchListener *l;
+
+  l = g_new (MetaPrefsBatchListener, 1);
+  l->func = func;
+  l->data = data;
+
+  batch_listeners = g_list_prepend (batch_listeners, l);
+}
+
+/**
+ * meta_prefs_remove_batch_listener: (skip)
+ *
+ */
+void
+meta_prefs_remove_batch_listener (MetaPrefsBatchChangedFunc func,
+                                  gpointer                  data)
+{
+  GList *tmp;
+
+  tmp = batch_listeners;
+  while (tmp != NULL)
+    {
+      MetaPrefsBatchListener *l = tmp->data;
+
+      if (l->func == func &&
+          l->data == data)
+        {
+          free (l);
+          batch_listeners = g_list_delete_link (batch_listeners, tmp);
+
+          return;
+        }
+
+      tmp = tmp->next;
+    }
+
+  meta_bug ("Did not find listener to remove\n");
+}
+
 static void
 emit_changed (MetaPreference pref)
 {
@@ -877,11 +990,39 @@ emit_changed (MetaPreference pref)
   g_list_free (copy);
 }
 
+static void
+emit_batch_changed (const MetaPreference *prefs,
+                    int                   n_prefs)
+{
+  GList *tmp;
+  GList *copy;
+
+  meta_topic (META_DEBUG_PREFS, "Notifying batch listeners of %d changes\n",
+              n_prefs);
+
+  copy = g_list_copy (batch_listeners);
+
+  tmp = copy;
+
+  while (tmp != NULL)
+    {
+      MetaPrefsBatchListener *l = tmp->data;
+
+      (* l->func) (prefs, n_prefs, l->data);
+
+      tmp = tmp->next;
+    }
+
+  g_list_free (copy);
+}
+
 static gboolean
 changed_idle_handler (gpointer data)
 {
   GList *tmp;
   GList *copy;
+  MetaPreference *prefs;
+  int n_prefs;
 
   changed_idle = 0;
 
@@ -890,16 +1031,24 @@ changed_idle_handler (gpointer data)
   g_list_free (changes);
   changes = NULL;
 
+  prefs = g_new (MetaPreference, g_list_length (copy));
+  n_prefs = 0;
+
   tmp = copy;
   while (tmp != NULL)
     {
       MetaPreference pref = GPOINTER_TO_INT (tmp->data);
 
       emit_changed (pref);
+      prefs[n_prefs++] = pref;
 
       tmp = tmp->next;
     }
 
+  if (n_prefs > 0)
+    emit_batch_changed (prefs, n_prefs);
+
+  free (prefs);
   g_list_free (copy);
 
   return FALSE;
@@ -1005,6 +1154,7 @@ meta_prefs_init (void)
   init_bindings ();
   init_workspace_names ();
   update_min_win_opacity ();
+  update_tearing_allowed_wm_classes ();
 }
 
 static gboolean
@@ -1170,6 +1320,13 @@ settings_changed (GSettings *settings,
       return;
     }
 
+  if (strcmp (key, KEY_TEARING_ALLOWED_WM_CLASSES) == 0)
+    {
+      if (update_tearing_allowed_wm_classes ())
+        queue_changed (META_PREF_TEARING_ALLOWED_WM_CLASSES);
+      return;
+    }
+
   value = g_settings_get_value (settings, key);
   type = g_variant_get_type (value);
 
@@ -1792,6 +1949,42 @@ meta_prefs_get_desktop_effects (void)
   return desktop_effects;
 }
 
+gboolean
+meta_prefs_get_density_mode (void)
+{
+  return density_mode;
+}
+
+int
+meta_prefs_get_density_frame_rate (void)
+{
+  return density_frame_rate;
+}
+
+gboolean
+meta_prefs_get_compositor_magnifier (void)
+{
+  return compositor_magnifier;
+}
+
+MetaColorFilter
+meta_prefs_get_color_filter (void)
+{
+  return color_filter;
+}
+
+/**
+ * meta_prefs_get_tearing_allowed_wm_classes:
+ *
+ * Returns: (transfer none) (array zero-terminated=1): the WM_CLASS names
+ * or classes of the fullscreen windows whose late frames may tear
+ */
+const char * const *
+meta_prefs_get_tearing_allowed_wm_classes (void)
+{
+  return (const char * const *) tearing_allowed_wm_classes;
+}
+
 MetaSyncMethod
 meta_prefs_get_sync_method (void)
 {
@@ -1804,12 +1997,24 @@ meta_prefs_get_threaded_swap (void)
   return threaded_swap;
 }
 
+gboolean
+meta_prefs_get_threaded_present (void)
+{
+  return threaded_present;
+}
+
 gboolean
 meta_prefs_get_send_frame_timings (void)
 {
   return send_frame_timings;
 }
 
+gboolean
+meta_prefs_get_geometric_picking (void)
+{
+  return geometric_picking;
+}
+
 gboolean
 meta_prefs_get_application_based (void)
 {
@@ -1951,9 +2156,15 @@ meta_preference_to_string (MetaPreference pref)
     case META_PREF_THREADED_SWAP:
       return "THREADED_SWAP";
 
+    case META_PREF_THREADED_PRESENT:
+      return "THREADED_PRESENT";
+
     case META_PREF_SEND_FRAME_TIMINGS:
       return "SEND_FRAME_TIMINGS";
 
+    case META_PREF_GEOMETRIC_PICKING:
+      return "GEOMETRIC_PICKING";
+
     case META_PREF_SNAP_MODIFIER:
       return "SNAP_MODIFIER";
 
@@ -1974,6 +2185,21 @@ meta_preference_to_string (MetaPreference pref)
 
     case META_PREF_MIN_WIN_OPACITY:
       return "MIN_WIN_OPACITY";
+
+    case META_PREF_DENSITY_MODE:
+      return "DENSITY_MODE";
+
+    case META_PREF_DENSITY_FRAME_RATE:
+      return "DENSITY_FRAME_RATE";
+
+    case META_PREF_COMPOSITOR_MAGNIFIER:
+      return "COMPOSITOR_MAGNIFIER";
+
+    case META_PREF_COLOR_FILTER:
+      return "COLOR_FILTER";
+
+    case META_PREF_TEARING_ALLOWED_WM_CLASSES:
+      return "TEARING_ALLOWED_WM_CLASSES";
     }
 
   return "(unknown)";
@@ -2147,6 +2373,34 @@ update_min_win_opacity (void)
   min_window_opacity = CLAMP (mapped, 0, 255);
 }
 
+static gboolean
+update_tearing_allowed_wm_classes (void)
+{
+  char **wm_classes;
+  int i;
+
+  wm_classes = g_settings_get_strv (SETTINGS (SCHEMA_MUFFIN),
+                                    KEY_TEARING_ALLOWED_WM_CLASSES);
+
+  if (tearing_allowed_wm_classes != NULL)
+    {
+      for (i = 0; wm_classes[i] != NULL; i++)
+        if (g_strcmp0 (wm_classes[i], tearing_allowed_wm_classes[i]) != 0)
+          break;
+
+      if (wm_classes[i] == NULL && tearing_allowed_wm_classes[i] == NULL)
+        {
+          g_strfreev (wm_classes);
+          return FALSE;
+        }
+    }
+
+  g_strfreev (tearing_allowed_wm_classes);
+  tearing_allowed_wm_classes = wm_classes;
+
+  return TRUE;
+}
+
 const char*
 meta_prefs_get_workspace_name (int i)
 {
@@ -0,0 +1,244 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file request-profiler.c  Aggregate statistics about X round trips
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#include <config.h>
+#include "request-profiler.h"
+
+#include <stdlib.h>
+
+#ifdef HAVE_BACKTRACE
+#include <execinfo.h>
+#endif
+
+/* Latency buckets are decades starting at 10us, the last one is open */
+#define N_BUCKETS 6
+
+typedef struct
+{
+  MetaRequestKind kind;
+  gconstpointer site;
+
+  guint count;
+  gint64 total_time;
+  gint64 max_time;
+  guint histogram[N_BUCKETS];
+} ProfileEntry;
+
+struct _MetaRequestProfiler
+{
+  /* One table per kind, mapping call site to ProfileEntry */
+  GHashTable *entries[META_N_REQUEST_KINDS];
+
+  gint64 start_time;
+};
+
+static const char *kind_names[META_N_REQUEST_KINDS] = {
+  "error-trap-pop",
+  "sync",
+  "get-properties",
+  "get-window-property",
+  "timestamp"
+};
+
+LOCAL_SYMBOL MetaRequestProfiler *
+meta_request_profiler_new (void)
+{
+  MetaRequestProfiler *profiler;
+  int i;
+
+  profiler = g_new0 (MetaRequestProfiler, 1);
+
+  for (i = 0; i < META_N_REQUEST_KINDS; i++)
+    profiler->entries[i] = g_hash_table_new_full (NULL, NULL, NULL, free);
+
+  profiler->start_time = g_get_monotonic_time ();
+
+  return profiler;
+}
+
+LOCAL_SYMBOL void
+meta_request_profiler_free (MetaRequestProfiler *profiler)
+{
+  int i;
+
+  if (profiler == NULL)
+    return;
+
+  for (i = 0; i < META_N_REQUEST_KINDS; i++)
+    g_hash_table_destroy (profiler->entries[i]);
+
+  free (profiler);
+}
+
+/**
+ * meta_request_profiler_begin:
+ * @profiler: (allow-none): a #MetaRequestProfiler
+ *
+ * Returns: the time to pass to meta_request_profiler_end() once the
+ *          request has completed, or 0 if @profiler is %NULL
+ */
+LOCAL_SYMBOL gint64
+meta_request_profiler_begin (MetaRequestProfiler *profiler)
+{
+  if (profiler == NULL)
+    return 0;
+
+  return g_get_monotonic_time ();
+}
+
+/**
+ * meta_request_profiler_end:
+ * @profiler: (allow-none): a #MetaRequestProfiler
+ * @kind: what sort of request completed
+ * @site: the code address which made the request, see META_REQUEST_CALLER
+ * @start: the value meta_request_profiler_begin() returned
+ *
+ * Adds one request of @kind made from @site to the statistics.
+ */
+LOCAL_SYMBOL void
+meta_request_profiler_end (MetaRequestProfiler *profiler,
+                           MetaRequestKind      kind,
+                           gconstpointer        site,
+                           gint64               start)
+{
+  ProfileEntry *entry;
+  gint64 elapsed, limit;
+  int bucket;
+
+  if (profiler == NULL)
+    return;
+
+  elapsed = g_get_monotonic_time () - start;
+
+  entry = g_hash_table_lookup (profiler->entries[kind], site);
+  if (entry == NULL)
+    {
+      entry = g_new0 (ProfileEntry, 1);
+      entry->kind = kind;
+      entry->site = site;
+      g_hash_table_insert (profiler->entries[kind], (gpointer) site, entry);
+    }
+
+  entry->count += 1;
+  entry->total_time += elapsed;
+  if (elapsed > entry->max_time)
+    entry->max_time = elapsed;
+
+  bucket = 0;
+  limit = 10;
+  while (bucket < N_BUCKETS - 1 && elapsed >= limit)
+    {
+      bucket += 1;
+      limit *= 10;
+    }
+  entry->histogram[bucket] += 1;
+}
+
+static gint
+compare_total_time (gconstpointer a,
+                    gconstpointer b)
+{
+  const ProfileEntry *entry_a = *(ProfileEntry * const *) a;
+  const ProfileEntry *entry_b = *(ProfileEntry * const *) b;
+
+  if (entry_a->total_time > entry_b->total_time)
+    return -1;
+  else if (entry_a->total_time < entry_b->total_time)
+    return 1;
+  else
+    return 0;
+}
+
+static char *
+describe_site (gconstpointer site)
+{
+#ifdef HAVE_BACKTRACE
+  char **syms;
+  char *description;
+
+  syms = backtrace_symbols ((void * const *) &site, 1);
+  if (syms != NULL)
+    {
+      description = g_strdup (syms[0]);
+      free (syms);
+      return description;
+    }
+#endif
+
+  return g_strdup_printf ("%p", site);
+}
+
+/**
+ * meta_request_profiler_dump:
+ * @profiler: (allow-none): a #MetaRequestProfiler
+ *
+ * Prints the statistics gathered so far to stderr, most expensive
+ * call sites first.
+ */
+LOCAL_SYMBOL void
+meta_request_profiler_dump (MetaRequestProfiler *profiler)
+{
+  GPtrArray *all;
+  GHashTableIter iter;
+  gpointer value;
+  guint i;
+  int kind;
+
+  if (profiler == NULL)
+    return;
+
+  all = g_ptr_array_new ();
+  for (kind = 0; kind < META_N_REQUEST_KINDS; kind++)
+    {
+      g_hash_table_iter_init (&iter, profiler->entries[kind]);
+      while (g_hash_table_iter_next (&iter, NULL, &value))
+        g_ptr_array_add (all, value);
+    }
+
+  g_ptr_array_sort (all, compare_total_time);
+
+  g_printerr ("X round trip profile after %.1f s:\n",
+              (g_get_monotonic_time () - profiler->start_time) / 1e6);
+  g_printerr ("%-20s %8s %10s %9s  %7s %7s %7s %7s %7s %7s  %s\n",
+              "kind", "count", "total ms", "max ms",
+              "<10us", "<100us", "<1ms", "<10ms", "<100ms", ">100ms",
+              "call site");
+
+  for (i = 0; i < all->len; i++)
+    {
+      ProfileEntry *entry = g_ptr_array_index (all, i);
+      char *site;
+
+      site = describe_site (entry->site);
+      g_printerr ("%-20s %8u %10.2f %9.2f  %7u %7u %7u %7u %7u %7u  %s\n",
+                  kind_names[entry->kind], entry->count,
+                  entry->total_time / 1000.0, entry->max_time / 1000.0,
+                  entry->histogram[0], entry->histogram[1],
+                  entry->histogram[2], entry->histogram[3],
+                  entry->histogram[4], entry->histogram[5],
+                  site);
+      free (site);
+    }
+
+  g_ptr_array_free (all, TRUE);
+}
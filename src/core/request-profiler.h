@@ -0,0 +1,69 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file request-profiler.h  Aggregate statistics about X round trips
+ *
+ * MetaRequestProfiler counts the X requests that make us wait on the
+ * server (error trap pops, XSync(), property fetches, timestamp pings)
+ * per kind and per call site, with a latency histogram, so that the
+ * code paths costing round trips can be found on a running session.
+ * It is only created when Muffin runs with --profile-x-requests or
+ * MUFFIN_PROFILE_X_REQUESTS set; every entry point accepts NULL and
+ * does nothing, so the hooks cost one branch when it is off.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#ifndef META_REQUEST_PROFILER_H
+#define META_REQUEST_PROFILER_H
+
+#include <glib.h>
+
+typedef enum
+{
+  META_REQUEST_ERROR_TRAP_POP,
+  META_REQUEST_SYNC,
+  META_REQUEST_GET_PROPERTIES,
+  META_REQUEST_GET_WINDOW_PROPERTY,
+  META_REQUEST_TIMESTAMP,
+  META_N_REQUEST_KINDS
+} MetaRequestKind;
+
+/* The call site recorded for a request is the caller of the function
+ * using this, i.e. the code that asked for the round trip.
+ */
+#ifdef __GNUC__
+#define META_REQUEST_CALLER __builtin_return_address (0)
+#else
+#define META_REQUEST_CALLER NULL
+#endif
+
+typedef struct _MetaRequestProfiler MetaRequestProfiler;
+
+MetaRequestProfiler *meta_request_profiler_new   (void);
+void                 meta_request_profiler_free  (MetaRequestProfiler *profiler);
+
+gint64               meta_request_profiler_begin (MetaRequestProfiler *profiler);
+void                 meta_request_profiler_end   (MetaRequestProfiler *profiler,
+                                                  MetaRequestKind      kind,
+                                                  gconstpointer        site,
+                                                  gint64               start);
+
+void                 meta_request_profiler_dump  (MetaRequestProfiler *profiler);
+
+#endif
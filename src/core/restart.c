@@ -32,10 +32,23 @@
  *    isn't unmapped and mapped.
  *
  * This handles both of these.
+ *
+ * Most of the state of the windows survives in their properties, which
+ * the new process reads back when it manages them again. What doesn't
+ * is handed over in a memfd the new process inherits: see
+ * meta_restart_save_state().
  */
 
 #include <config.h>
 
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_MEMFD_CREATE
+#include <sys/mman.h>
+#endif
+
 #include <clutter/clutter.h>
 #include <gio/gunixinputstream.h>
 
@@ -43,6 +56,18 @@
 #include "ui.h"
 #include <meta/util.h>
 #include "display-private.h"
+#include "screen-private.h"
+#include "stack.h"
+#include "window-private.h"
+#include "workspace-private.h"
+
+/* The descriptor of the memfd holding the state, in the environment of
+ * the new process */
+#define RESTART_STATE_FD_ENV "MUFFIN_RESTART_STATE_FD"
+
+/* The client windows from the bottom of the stack to the top, and for
+ * each workspace, its windows from the most recently used */
+#define RESTART_STATE_FORMAT "(ata(uat))"
 
 static gboolean restart_helper_started = FALSE;
 static gboolean restart_stage_shown = FALSE;
@@ -156,4 +181,284 @@ meta_restart (void)
   restart_check_ready ();
 
   return;
-}
\ No newline at end of file
+}
+
+/**
+ * meta_restart_save_state:
+ * @display: a #MetaDisplay
+ *
+ * Writes what the properties of the windows don't record — the stacking
+ * order within a layer and the order of the windows in Alt-Tab — to a
+ * memfd left open across the exec, and points the new process at it.
+ * Must be called before the screen is unmanaged, which changes both.
+ */
+LOCAL_SYMBOL void
+meta_restart_save_state (MetaDisplay *display)
+{
+#ifdef HAVE_MEMFD_CREATE
+  MetaScreen *screen = display->screens->data;
+  GVariantBuilder stacking, mru;
+  GVariant *state;
+  const guint8 *data;
+  gsize size, written;
+  GList *windows, *l;
+  char fd_string[16];
+  guint i;
+  int fd;
+
+  g_variant_builder_init (&stacking, G_VARIANT_TYPE ("at"));
+  windows = meta_stack_get_positions (screen->stack);
+  for (l = windows; l; l = l->next)
+    {
+      MetaWindow *window = l->data;
+
+      if (!window->override_redirect)
+        g_variant_builder_add (&stacking, "t", (guint64) window->xwindow);
+    }
+  g_list_free (windows);
+
+  g_variant_builder_init (&mru, G_VARIANT_TYPE ("a(uat)"));
+  for (l = screen->workspaces, i = 0; l; l = l->next, i++)
+    {
+      MetaWorkspace *workspace = l->data;
+      GVariantBuilder workspace_mru;
+      GList *m;
+
+      g_variant_builder_init (&workspace_mru, G_VARIANT_TYPE ("at"));
+      for (m = workspace->mru_list; m; m = m->next)
+        {
+          MetaWindow *window = m->data;
+
+          g_variant_builder_add (&workspace_mru, "t", (guint64) window->xwindow);
+        }
+
+      g_variant_builder_add (&mru, "(uat)", i, &workspace_mru);
+    }
+
+  state = g_variant_ref_sink (g_variant_new (RESTART_STATE_FORMAT,
+                                             &stacking, &mru));
+
+  /* Without MFD_CLOEXEC, so that it's inherited */
+  fd = memfd_create ("muffin-restart-state", 0);
+  if (fd < 0)
+    {
+      meta_warning ("Failed to create the restart state memfd: %s\n",
+                    g_strerror (errno));
+      g_variant_unref (state);
+      return;
+    }
+
+  data = g_variant_get_data (state);
+  size = g_variant_get_size (state);
+  for (written = 0; written < size; )
+    {
+      ssize_t res = write (fd, data + written, size - written);
+
+      if (res < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          meta_warning ("Failed to write the restart state: %s\n",
+                        g_strerror (errno));
+          close (fd);
+          g_variant_unref (state);
+          return;
+        }
+
+      written += res;
+    }
+
+  g_variant_unref (state);
+
+  g_snprintf (fd_string, sizeof (fd_string), "%d", fd);
+  g_setenv (RESTART_STATE_FD_ENV, fd_string, TRUE);
+#endif /* HAVE_MEMFD_CREATE */
+}
+
+static GVariant *
+read_state (int fd)
+{
+  GByteArray *bytes = g_byte_array_new ();
+  guint8 buffer[4096];
+
+  if (lseek (fd, 0, SEEK_SET) < 0)
+    {
+      g_byte_array_unref (bytes);
+      return NULL;
+    }
+
+  for (;;)
+    {
+      ssize_t res = read (fd, buffer, sizeof (buffer));
+
+      if (res < 0 && errno == EINTR)
+        continue;
+
+      if (res < 0)
+        {
+          meta_warning ("Failed to read the restart state: %s\n",
+                        g_strerror (errno));
+          g_byte_array_unref (bytes);
+          return NULL;
+        }
+
+      if (res == 0)
+        break;
+
+      g_byte_array_append (bytes, buffer, res);
+    }
+
+  /* Not trusted: a malformed state reads as empty arrays */
+  return g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (RESTART_STATE_FORMAT),
+                                                       g_byte_array_free_to_bytes (bytes),
+                                                       FALSE));
+}
+
+static void
+restore_stacking (MetaScreen *screen,
+                  GVariant   *stacking)
+{
+  GHashTable *ranks = g_hash_table_new (NULL, NULL);
+  GPtrArray *known = g_ptr_array_new ();
+  GList *windows, *l;
+  GVariantIter iter;
+  guint64 xwindow;
+  guint rank = 0, i;
+
+  g_variant_iter_init (&iter, stacking);
+  while (g_variant_iter_next (&iter, "t", &xwindow))
+    {
+      MetaWindow *window = meta_display_lookup_x_window (screen->display, xwindow);
+
+      if (window != NULL && window->screen == screen)
+        g_hash_table_insert (ranks, window, GUINT_TO_POINTER (++rank));
+    }
+
+  /* The windows this process found on its own keep their places; the
+   * known ones are put back in their old order in the places they
+   * took */
+  windows = meta_stack_get_positions (screen->stack);
+  for (l = windows; l; l = l->next)
+    {
+      if (g_hash_table_contains (ranks, l->data))
+        g_ptr_array_add (known, l->data);
+    }
+
+  for (i = 1; i < known->len; i++)
+    {
+      gpointer window = known->pdata[i];
+      guint window_rank = GPOINTER_TO_UINT (g_hash_table_lookup (ranks, window));
+      guint j = i;
+
+      while (j > 0 &&
+             GPOINTER_TO_UINT (g_hash_table_lookup (ranks, known->pdata[j - 1])) > window_rank)
+        {
+          known->pdata[j] = known->pdata[j - 1];
+          j--;
+        }
+
+      known->pdata[j] = window;
+    }
+
+  for (l = windows, i = 0; l; l = l->next)
+    {
+      if (g_hash_table_contains (ranks, l->data))
+        l->data = known->pdata[i++];
+    }
+
+  if (known->len > 1)
+    meta_stack_set_positions (screen->stack, windows);
+
+  g_list_free (windows);
+  g_ptr_array_free (known, TRUE);
+  g_hash_table_destroy (ranks);
+}
+
+static void
+restore_mru (MetaScreen *screen,
+             GVariant   *mru)
+{
+  GVariantIter iter;
+  GVariant *xwindows;
+  guint index;
+
+  g_variant_iter_init (&iter, mru);
+  while (g_variant_iter_next (&iter, "(u@at)", &index, &xwindows))
+    {
+      MetaWorkspace *workspace = meta_screen_get_workspace_by_index (screen, index);
+      GList *restored = NULL;
+      GVariantIter window_iter;
+      guint64 xwindow;
+
+      if (workspace == NULL)
+        {
+          g_variant_unref (xwindows);
+          continue;
+        }
+
+      g_variant_iter_init (&window_iter, xwindows);
+      while (g_variant_iter_next (&window_iter, "t", &xwindow))
+        {
+          MetaWindow *window = meta_display_lookup_x_window (screen->display, xwindow);
+          GList *link;
+
+          if (window == NULL)
+            continue;
+
+          link = g_list_find (workspace->mru_list, window);
+          if (link == NULL)
+            continue;
+
+          workspace->mru_list = g_list_remove_link (workspace->mru_list, link);
+          restored = g_list_concat (link, restored);
+        }
+
+      /* Windows that are new to this process come last */
+      workspace->mru_list = g_list_concat (g_list_reverse (restored),
+                                           workspace->mru_list);
+
+      g_variant_unref (xwindows);
+    }
+}
+
+/**
+ * meta_restart_restore_state:
+ * @screen: a #MetaScreen, with its windows managed
+ *
+ * Applies the state meta_restart_save_state() handed over, if this
+ * process was started by a restart, to the windows still there.
+ */
+LOCAL_SYMBOL void
+meta_restart_restore_state (MetaScreen *screen)
+{
+  const char *fd_string = g_getenv (RESTART_STATE_FD_ENV);
+  GVariant *state, *stacking, *mru;
+  int fd;
+
+  if (fd_string == NULL)
+    return;
+
+  fd = atoi (fd_string);
+  g_unsetenv (RESTART_STATE_FD_ENV);
+  if (fd <= STDERR_FILENO)
+    return;
+
+  state = read_state (fd);
+  close (fd);
+
+  if (state == NULL)
+    return;
+
+  g_variant_get (state, "(@at@a(uat))", &stacking, &mru);
+
+  meta_verbose ("Restoring the stacking of %" G_GSIZE_FORMAT " windows after restart\n",
+                g_variant_n_children (stacking));
+
+  restore_stacking (screen, stacking);
+  restore_mru (screen, mru);
+
+  g_variant_unref (stacking);
+  g_variant_unref (mru);
+  g_variant_unref (state);
+}
@@ -49,6 +49,9 @@ struct _MetaMonitorInfo
   gboolean in_fullscreen;
   XID output; /* The primary or first output for this crtc, None if no xrandr */
   float refresh_rate;
+  /* The vrr_capable property of output; the driver can vary the
+   * refresh rate of the monitor to when frames are presented */
+  gboolean vrr_capable;
 };
 
 typedef void (* MetaScreenWindowFunc) (MetaScreen *screen, MetaWindow *window,
@@ -42,8 +42,10 @@
 #include "keybindings-private.h"
 #include "stack.h"
 #include "xprops.h"
+#include "window-props.h"
 #include <meta/compositor.h>
 #include "muffin-enum-types.h"
+#include "startup-trace.h"
 
 #ifdef HAVE_SOLARIS_XINERAMA
 #include <X11/extensions/xinerama.h>
@@ -53,10 +55,13 @@
 #endif
 #ifdef HAVE_RANDR
 #include <X11/extensions/Xrandr.h>
+#include <xcb/randr.h>
 #endif
 #include <X11/extensions/Xcomposite.h>
 
 #include <X11/Xatom.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
 #include <locale.h>
 #include <string.h>
 #include <stdio.h>
@@ -485,33 +490,178 @@ find_monitor_with_rect (MetaScreen *screen, int x, int y, int w, int h)
   return NULL;
 }
 
-/* In the case of multiple outputs of a single crtc (mirroring), we consider one of the
+/* Fills in the refresh rate and the main output of each monitor from
+ * RandR. Through Xlib that is a round trip for every CRTC and then for
+ * every output of each, which adds up on drivers that are slow to
+ * answer while a dock is being plugged in, so, as in list_windows(),
+ * the requests are sent in batches and cost three round trips in
+ * total.
+ *
+ * In the case of multiple outputs of a single crtc (mirroring), we consider one of the
  * outputs the "main". This is the one we consider "owning" the windows, so if
  * the mirroring is changed to a dual monitor setup then the windows are moved to the
  * crtc that now has that main output. If one of the outputs is the primary that is
  * always the main, otherwise we just use the first.
  */
-static XID
-find_main_output_for_crtc (MetaScreen *screen, XRRScreenResources *resources, XRRCrtcInfo *crtc)
+static void
+read_randr_outputs (MetaScreen *screen)
 {
-  XRROutputInfo *output;
-  RROutput primary_output;
-  int i;
-  XID res;
+  xcb_connection_t *xcb_conn;
+  xcb_randr_get_screen_resources_current_cookie_t resources_cookie;
+  xcb_randr_get_output_primary_cookie_t primary_cookie;
+  xcb_randr_get_screen_resources_current_reply_t *resources;
+  xcb_randr_get_output_primary_reply_t *primary;
+  xcb_intern_atom_cookie_t vrr_capable_cookie;
+  xcb_intern_atom_reply_t *vrr_capable_reply;
+  xcb_atom_t vrr_capable;
+  xcb_randr_get_crtc_info_cookie_t *crtc_cookies;
+  xcb_randr_get_crtc_info_reply_t **crtcs;
+  xcb_randr_get_output_info_cookie_t **output_cookies;
+  xcb_randr_crtc_t *crtc_ids;
+  xcb_randr_mode_info_t *modes;
+  xcb_randr_output_t primary_output;
+  int n_crtcs, n_modes;
+  int i, j;
 
-  primary_output = XRRGetOutputPrimary (screen->display->xdisplay, screen->xroot);
+  xcb_conn = XGetXCBConnection (screen->display->xdisplay);
+
+  resources_cookie = xcb_randr_get_screen_resources_current (xcb_conn,
+                                                             screen->xroot);
+  primary_cookie = xcb_randr_get_output_primary (xcb_conn, screen->xroot);
+  /* Only drivers that support variable refresh create the property */
+  vrr_capable_cookie = xcb_intern_atom (xcb_conn, TRUE,
+                                        strlen ("vrr_capable"), "vrr_capable");
+
+  resources = xcb_randr_get_screen_resources_current_reply (xcb_conn,
+                                                            resources_cookie,
+                                                            NULL);
+  primary = xcb_randr_get_output_primary_reply (xcb_conn, primary_cookie,
+                                                NULL);
+  primary_output = primary ? primary->output : XCB_NONE;
+  free (primary);
+
+  vrr_capable_reply = xcb_intern_atom_reply (xcb_conn, vrr_capable_cookie,
+                                             NULL);
+  vrr_capable = vrr_capable_reply ? vrr_capable_reply->atom : XCB_ATOM_NONE;
+  free (vrr_capable_reply);
+
+  if (resources == NULL)
+    return;
 
-  res = None;
-  for (i = 0; i < crtc->noutput; i++)
+  crtc_ids = xcb_randr_get_screen_resources_current_crtcs (resources);
+  n_crtcs = xcb_randr_get_screen_resources_current_crtcs_length (resources);
+  modes = xcb_randr_get_screen_resources_current_modes (resources);
+  n_modes = xcb_randr_get_screen_resources_current_modes_length (resources);
+
+  crtc_cookies = g_new (xcb_randr_get_crtc_info_cookie_t, n_crtcs);
+  for (i = 0; i < n_crtcs; i++)
+    crtc_cookies[i] = xcb_randr_get_crtc_info (xcb_conn, crtc_ids[i],
+                                               resources->config_timestamp);
+
+  /* The outputs of each CRTC are asked for as soon as its reply is in,
+   * while the replies for the other CRTCs are on their way */
+  crtcs = g_new0 (xcb_randr_get_crtc_info_reply_t *, n_crtcs);
+  output_cookies = g_new0 (xcb_randr_get_output_info_cookie_t *, n_crtcs);
+  for (i = 0; i < n_crtcs; i++)
     {
-      output = XRRGetOutputInfo (screen->display->xdisplay, resources, crtc->outputs[i]);
-      if (output->connection != RR_Disconnected &&
-          (res == None || crtc->outputs[i] == primary_output))
-        res = crtc->outputs[i];
-      XRRFreeOutputInfo (output);
+      xcb_randr_output_t *outputs;
+      int n_outputs;
+
+      crtcs[i] = xcb_randr_get_crtc_info_reply (xcb_conn, crtc_cookies[i],
+                                                NULL);
+      if (crtcs[i] == NULL)
+        continue;
+
+      outputs = xcb_randr_get_crtc_info_outputs (crtcs[i]);
+      n_outputs = xcb_randr_get_crtc_info_outputs_length (crtcs[i]);
+
+      output_cookies[i] = g_new (xcb_randr_get_output_info_cookie_t, n_outputs);
+      for (j = 0; j < n_outputs; j++)
+        output_cookies[i][j] =
+          xcb_randr_get_output_info (xcb_conn, outputs[j],
+                                     resources->config_timestamp);
     }
 
-  return res;
+  for (i = 0; i < n_crtcs; i++)
+    {
+      xcb_randr_get_crtc_info_reply_t *crtc = crtcs[i];
+      xcb_randr_output_t *outputs;
+      MetaMonitorInfo *info;
+      XID main_output;
+      int n_outputs;
+
+      if (crtc == NULL)
+        continue;
+
+      outputs = xcb_randr_get_crtc_info_outputs (crtc);
+      n_outputs = xcb_randr_get_crtc_info_outputs_length (crtc);
+
+      /* Every reply is collected, even for CRTCs that match no monitor */
+      main_output = None;
+      for (j = 0; j < n_outputs; j++)
+        {
+          xcb_randr_get_output_info_reply_t *output;
+
+          output = xcb_randr_get_output_info_reply (xcb_conn,
+                                                    output_cookies[i][j],
+                                                    NULL);
+          if (output != NULL &&
+              output->connection != XCB_RANDR_CONNECTION_DISCONNECTED &&
+              (main_output == None || outputs[j] == primary_output))
+            main_output = outputs[j];
+
+          free (output);
+        }
+
+      info = find_monitor_with_rect (screen, crtc->x, crtc->y,
+                                     crtc->width, crtc->height);
+      if (info)
+        {
+          for (j = 0; j < n_modes; j++)
+            {
+              if (modes[j].id == crtc->mode &&
+                  modes[j].htotal != 0 && modes[j].vtotal != 0)
+                info->refresh_rate = (modes[j].dot_clock /
+                                      ((float) modes[j].htotal *
+                                       modes[j].vtotal));
+            }
+
+          info->output = main_output;
+          info->vrr_capable = FALSE;
+
+          if (main_output != None && vrr_capable != XCB_ATOM_NONE)
+            {
+              xcb_randr_get_output_property_reply_t *property;
+
+              property =
+                xcb_randr_get_output_property_reply (xcb_conn,
+                                                     xcb_randr_get_output_property (xcb_conn,
+                                                                                    main_output,
+                                                                                    vrr_capable,
+                                                                                    XCB_ATOM_ANY,
+                                                                                    0, 1,
+                                                                                    FALSE,
+                                                                                    FALSE),
+                                                     NULL);
+
+              if (property != NULL &&
+                  property->format == 32 &&
+                  property->num_items == 1)
+                info->vrr_capable =
+                  *(uint32_t *) xcb_randr_get_output_property_data (property) != 0;
+
+              free (property);
+            }
+        }
+
+      g_free (output_cookies[i]);
+      free (crtc);
+    }
+
+  g_free (output_cookies);
+  g_free (crtcs);
+  g_free (crtc_cookies);
+  free (resources);
 }
 
 #endif
@@ -521,20 +671,6 @@ reload_monitor_infos (MetaScreen *screen)
 {
   MetaDisplay *display;
 
-  {
-    GList *tmp;
-
-    tmp = screen->workspaces;
-    while (tmp != NULL)
-      {
-        MetaWorkspace *space = tmp->data;
-
-        meta_workspace_invalidate_work_area (space);
-
-        tmp = tmp->next;
-      }
-  }
-
   display = screen->display;
 
   /* Any previous screen->monitor_infos is freed by the caller */
@@ -583,7 +719,7 @@ reload_monitor_infos (MetaScreen *screen)
     {
       XineramaScreenInfo *infos;
       int n_infos;
-      int i, j;
+      int i;
 
       n_infos = 0;
       infos = XineramaQueryScreens (display->xdisplay, &n_infos);
@@ -622,34 +758,7 @@ reload_monitor_infos (MetaScreen *screen)
       meta_XFree (infos);
 
 #ifdef HAVE_RANDR
-      {
-        XRRScreenResources *resources;
-
-        resources = XRRGetScreenResourcesCurrent (display->xdisplay, screen->xroot);
-        if (resources)
-          {
-            for (i = 0; i < resources->ncrtc; i++)
-              {
-                XRRCrtcInfo *crtc;
-                MetaMonitorInfo *info;
-
-                crtc = XRRGetCrtcInfo (display->xdisplay, resources, resources->crtcs[i]);
-                info = find_monitor_with_rect (screen, crtc->x, crtc->y, (int)crtc->width, (int)crtc->height);
-                for (j = 0; j < resources->nmode; j++)
-                  {
-                    if (resources->modes[j].id == crtc->mode)
-                      info->refresh_rate = (resources->modes[j].dotClock /
-                                            ((float)resources->modes[j].hTotal *
-                                            resources->modes[j].vTotal));
-                  }
-                if (info)
-                  info->output = find_main_output_for_crtc (screen, resources, crtc);
-
-                XRRFreeCrtcInfo (crtc);
-              }
-            XRRFreeScreenResources (resources);
-          }
-      }
+      read_randr_outputs (screen);
 #endif
     }
   else if (screen->n_monitor_infos > 0)
@@ -972,7 +1081,9 @@ meta_screen_new (MetaDisplay *display,
   screen->n_monitor_infos = 0;
   screen->last_monitor_index = 0;
 
+  meta_startup_trace_begin ("reload_monitor_infos");
   reload_monitor_infos (screen);
+  meta_startup_trace_end ("reload_monitor_infos");
 
   meta_screen_set_cursor (screen, META_CURSOR_DEFAULT);
 
@@ -1015,7 +1126,9 @@ meta_screen_new (MetaDisplay *display,
 
   screen->all_keys_grabbed = FALSE;
   screen->keys_grabbed = FALSE;
+  meta_startup_trace_begin ("keybinding grabs");
   meta_screen_grab_keys (screen);
+  meta_startup_trace_end ("keybinding grabs");
 
   screen->ui = meta_ui_new (display,
                             screen->xscreen);
@@ -1155,42 +1268,113 @@ typedef struct
   XWindowAttributes	attrs;
 } WindowInfo;
 
+static Visual *
+find_visual (Screen   *xscreen,
+             VisualID  visual_id)
+{
+  int i, j;
+
+  for (i = 0; i < xscreen->ndepths; i++)
+    {
+      Depth *depth = &xscreen->depths[i];
+
+      for (j = 0; j < depth->nvisuals; j++)
+        if (depth->visuals[j].visualid == visual_id)
+          return &depth->visuals[j];
+    }
+
+  return NULL;
+}
+
+/* Lists the children of the root window along with their attributes.
+ * XGetWindowAttributes() costs two round trips per window, so instead
+ * we send the requests for every child up front and then collect the
+ * replies, which costs two round trips in total.
+ */
 static GList *
 list_windows (MetaScreen *screen)
 {
+  xcb_connection_t *xcb_conn;
   Window ignored1, ignored2;
   Window *children;
   guint n_children, i;
+  xcb_get_window_attributes_cookie_t *attrs_cookies;
+  xcb_get_geometry_cookie_t *geometry_cookies;
   GList *result;
 
   XQueryTree (screen->display->xdisplay,
               screen->xroot,
               &ignored1, &ignored2, &children, &n_children);
 
-  result = NULL;
+  xcb_conn = XGetXCBConnection (screen->display->xdisplay);
+
+  attrs_cookies = g_new (xcb_get_window_attributes_cookie_t, n_children);
+  geometry_cookies = g_new (xcb_get_geometry_cookie_t, n_children);
+
   for (i = 0; i < n_children; ++i)
     {
-      WindowInfo *info = g_new0 (WindowInfo, 1);
+      attrs_cookies[i] = xcb_get_window_attributes (xcb_conn, children[i]);
+      geometry_cookies[i] = xcb_get_geometry (xcb_conn, children[i]);
+    }
 
-      meta_error_trap_push_with_return (screen->display);
+  result = NULL;
+  for (i = 0; i < n_children; ++i)
+    {
+      xcb_get_window_attributes_reply_t *attrs;
+      xcb_get_geometry_reply_t *geometry;
+      WindowInfo *info;
 
-      XGetWindowAttributes (screen->display->xdisplay,
-                            children[i], &info->attrs);
+      attrs = xcb_get_window_attributes_reply (xcb_conn, attrs_cookies[i],
+                                               NULL);
+      geometry = xcb_get_geometry_reply (xcb_conn, geometry_cookies[i], NULL);
 
-      if (meta_error_trap_pop_with_return (screen->display))
-	{
+      if (attrs == NULL || geometry == NULL)
+        {
+          /* Most likely the window went away before we got to it */
           meta_verbose ("Failed to get attributes for window 0x%lx\n",
                         children[i]);
-	  free (info);
+          free (attrs);
+          free (geometry);
+          continue;
         }
-      else
-        {
-	  info->xwindow = children[i];
-	}
+
+      info = g_new0 (WindowInfo, 1);
+      info->xwindow = children[i];
+
+      info->attrs.x = geometry->x;
+      info->attrs.y = geometry->y;
+      info->attrs.width = geometry->width;
+      info->attrs.height = geometry->height;
+      info->attrs.border_width = geometry->border_width;
+      info->attrs.depth = geometry->depth;
+      info->attrs.root = geometry->root;
+      info->attrs.screen = screen->xscreen;
+
+      info->attrs.visual = find_visual (screen->xscreen, attrs->visual);
+      info->attrs.class = attrs->_class;
+      info->attrs.bit_gravity = attrs->bit_gravity;
+      info->attrs.win_gravity = attrs->win_gravity;
+      info->attrs.backing_store = attrs->backing_store;
+      info->attrs.backing_planes = attrs->backing_planes;
+      info->attrs.backing_pixel = attrs->backing_pixel;
+      info->attrs.save_under = attrs->save_under;
+      info->attrs.colormap = attrs->colormap;
+      info->attrs.map_installed = attrs->map_is_installed;
+      info->attrs.map_state = attrs->map_state;
+      info->attrs.all_event_masks = attrs->all_event_masks;
+      info->attrs.your_event_mask = attrs->your_event_mask;
+      info->attrs.do_not_propagate_mask = attrs->do_not_propagate_mask;
+      info->attrs.override_redirect = attrs->override_redirect;
+
+      free (attrs);
+      free (geometry);
 
       result = g_list_prepend (result, info);
     }
 
+  free (attrs_cookies);
+  free (geometry_cookies);
+
   if (children)
     XFree (children);
 
@@ -1211,6 +1395,21 @@ meta_screen_manage_all_windows (MetaScreen *screen)
 
   windows = list_windows (screen);
 
+  /* Ask for the properties of every window at once; each
+   * meta_window_new_with_attrs() below then finds its replies waiting
+   * rather than doing its own round trip.  This is safe because the
+   * server is grabbed until we are done.
+   */
+  for (list = windows; list != NULL; list = list->next)
+    {
+      WindowInfo *info = list->data;
+
+      if (info->attrs.class != InputOnly)
+        meta_window_prefetch_initial_properties (screen->display,
+                                                 info->xwindow,
+                                                 info->attrs.override_redirect);
+    }
+
   meta_stack_freeze (screen->stack);
   for (list = windows; list != NULL; list = list->next)
     {
@@ -1233,6 +1432,8 @@ meta_screen_manage_all_windows (MetaScreen *screen)
     }
   meta_stack_thaw (screen->stack);
 
+  meta_prop_discard_prefetched (screen->display);
+
   g_list_foreach (windows, (GFunc)free, NULL);
   g_list_free (windows);
 
@@ -1347,27 +1548,6 @@ get_screen_name (MetaDisplay *display,
   return scr;
 }
 
-static gint
-ptrcmp (gconstpointer a, gconstpointer b)
-{
-  if (a < b)
-    return -1;
-  else if (a > b)
-    return 1;
-  else
-    return 0;
-}
-
-static void
-listify_func (gpointer key, gpointer value, gpointer data)
-{
-  GSList **listp;
-
-  listp = data;
-
-  *listp = g_slist_prepend (*listp, value);
-}
-
 /**
  * meta_screen_foreach_window:
  * @screen: a #MetaScreen
@@ -1382,38 +1562,19 @@ meta_screen_foreach_window (MetaScreen *screen,
                             MetaScreenWindowFunc func,
                             gpointer data)
 {
-  GSList *winlist;
-  GSList *tmp;
-
-  /* If we end up doing this often, just keeping a list
-   * of windows might be sensible.
-   */
-
-  winlist = NULL;
-  g_hash_table_foreach (screen->display->window_ids,
-                        listify_func,
-                        &winlist);
-
-  winlist = g_slist_sort (winlist, ptrcmp);
+  GList *tmp;
+  GList *next;
 
-  tmp = winlist;
-  while (tmp != NULL)
+  for (tmp = screen->display->windows.head; tmp; tmp = next)
     {
-      /* If the next node doesn't contain this window
-       * a second time, delete the window.
-       */
-      if (tmp->next == NULL ||
-          (tmp->next && tmp->next->data != tmp->data))
-        {
-          MetaWindow *window = tmp->data;
+      MetaWindow *window = tmp->data;
 
-          if (window->screen == screen && !window->override_redirect)
-            (* func) (screen, window, data);
-        }
+      /* @func may unmanage the window */
+      next = tmp->next;
 
-      tmp = tmp->next;
+      if (window->screen == screen && !window->override_redirect)
+        (* func) (screen, window, data);
     }
-  g_slist_free (winlist);
 }
 
 static void
@@ -1827,7 +1988,7 @@ meta_screen_set_cursor (MetaScreen *screen,
 
   xcursor = meta_display_create_x_cursor (screen->display, cursor);
   XDefineCursor (screen->display->xdisplay, screen->xroot, xcursor);
-  XFlush (screen->display->xdisplay);
+  meta_display_flush (screen->display);
   XFreeCursor (screen->display->xdisplay, xcursor);
 }
 
@@ -1839,7 +2000,7 @@ meta_screen_update_cursor (MetaScreen *screen)
   xcursor = meta_display_create_x_cursor (screen->display,
 					  screen->current_cursor);
   XDefineCursor (screen->display->xdisplay, screen->xroot, xcursor);
-  XFlush (screen->display->xdisplay);
+  meta_display_flush (screen->display);
   XFreeCursor (screen->display->xdisplay, xcursor);
 }
 
@@ -3080,22 +3241,94 @@ meta_screen_resize_func (MetaScreen *screen,
   meta_window_recalc_features (window);
 }
 
+/* Whether the windows would be laid out the same on @new_infos as on
+ * @old_infos; the refresh rates don't matter to that */
+static gboolean
+monitor_layout_equal (const MetaMonitorInfo *old_infos,
+                      int                    n_old_infos,
+                      const MetaMonitorInfo *new_infos,
+                      int                    n_new_infos)
+{
+  int i;
+
+  if (n_old_infos != n_new_infos)
+    return FALSE;
+
+  for (i = 0; i < n_new_infos; i++)
+    {
+      if (old_infos[i].number != new_infos[i].number ||
+          !meta_rectangle_equal (&old_infos[i].rect, &new_infos[i].rect) ||
+          old_infos[i].is_primary != new_infos[i].is_primary ||
+          old_infos[i].output != new_infos[i].output)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 LOCAL_SYMBOL void
 meta_screen_resize (MetaScreen *screen,
                     int         width,
                     int         height)
 {
   GSList *windows, *tmp;
+  GList *l;
   MetaMonitorInfo *old_monitor_infos;
+  int n_old_monitor_infos;
+  gboolean size_changed;
+  int i;
+
+  size_changed = (width != screen->rect.width ||
+                  height != screen->rect.height);
 
   screen->rect.width = width;
   screen->rect.height = height;
 
   /* Save the old monitor infos, so they stay valid during the update */
   old_monitor_infos = screen->monitor_infos;
+  n_old_monitor_infos = screen->n_monitor_infos;
 
   reload_monitor_infos (screen);
-  set_desktop_geometry_hint (screen);
+
+  /* Most RandR notifications, such as an output being plugged in but
+   * left off, or a second one for a change already handled, leave the
+   * monitors as they were. The old infos are kept then, since every
+   * window points into them, and nothing has to be laid out again. */
+  if (!size_changed &&
+      monitor_layout_equal (old_monitor_infos, n_old_monitor_infos,
+                            screen->monitor_infos, screen->n_monitor_infos))
+    {
+      gboolean rates_changed = FALSE;
+
+      for (i = 0; i < n_old_monitor_infos; i++)
+        {
+          if (old_monitor_infos[i].refresh_rate !=
+              screen->monitor_infos[i].refresh_rate)
+            {
+              old_monitor_infos[i].refresh_rate =
+                screen->monitor_infos[i].refresh_rate;
+              rates_changed = TRUE;
+            }
+        }
+
+      free (screen->monitor_infos);
+      screen->monitor_infos = old_monitor_infos;
+
+      meta_topic (META_DEBUG_XINERAMA, "Monitor layout unchanged\n");
+
+      if (rates_changed)
+        g_signal_emit (screen, screen_signals[MONITORS_CHANGED], 0);
+
+      return;
+    }
+
+  meta_stack_invalidate_hit_index (screen->stack);
+
+  for (l = screen->workspaces; l != NULL; l = l->next)
+    meta_workspace_invalidate_work_area (l->data);
+
+  if (size_changed)
+    set_desktop_geometry_hint (screen);
 
   meta_compositor_sync_screen_size (screen->display->compositor,
                                     screen, width, height);
@@ -3253,7 +3486,7 @@ meta_screen_unshow_desktop (MetaScreen *screen)
 
 
 #ifdef HAVE_STARTUP_NOTIFICATION
-static gboolean startup_sequence_timeout (void *data);
+static void schedule_startup_sequence_timeout (MetaScreen *screen);
 
 static void
 update_startup_feedback (MetaScreen *screen)
@@ -3283,13 +3516,8 @@ add_sequence (MetaScreen        *screen,
   screen->startup_sequences = g_slist_prepend (screen->startup_sequences,
                                                sequence);
 
-  /* our timeout just polls every second, instead of bothering
-   * to compute exactly when we may next time out
-   */
   if (screen->startup_sequence_timeout == 0)
-    screen->startup_sequence_timeout = g_timeout_add_seconds (1,
-                                                              startup_sequence_timeout,
-                                                              screen);
+    schedule_startup_sequence_timeout (screen);
 
   update_startup_feedback (screen);
 }
@@ -3321,6 +3549,8 @@ typedef struct
 {
   GSList *list;
   GTimeVal now;
+  /* How long until the next sequence that is still running times out */
+  double next_timeout;
 } CollectTimedOutData;
 
 /* This should be fairly long, as it should never be required unless
@@ -3352,6 +3582,8 @@ collect_timed_out_foreach (void *element,
 
   if (elapsed > STARTUP_TIMEOUT)
     ctod->list = g_slist_prepend (ctod->list, sequence);
+  else
+    ctod->next_timeout = MIN (ctod->next_timeout, STARTUP_TIMEOUT - elapsed);
 }
 
 static gboolean
@@ -3362,6 +3594,7 @@ startup_sequence_timeout (void *data)
   GSList *tmp;
 
   ctod.list = NULL;
+  ctod.next_timeout = STARTUP_TIMEOUT;
   g_get_current_time (&ctod.now);
   g_slist_foreach (screen->startup_sequences,
                    collect_timed_out_foreach,
@@ -3383,16 +3616,38 @@ startup_sequence_timeout (void *data)
 
   g_slist_free (ctod.list);
 
+  screen->startup_sequence_timeout = 0;
   if (screen->startup_sequences != NULL)
-    {
-      return TRUE;
-    }
-  else
-    {
-      /* remove */
-      screen->startup_sequence_timeout = 0;
-      return FALSE;
-    }
+    schedule_startup_sequence_timeout (screen);
+
+  return FALSE;
+}
+
+/* Wakes up when the oldest sequence would time out, rather than
+ * polling; activity on the sequences only makes it find nothing to do
+ * yet and wait again.
+ */
+static void
+schedule_startup_sequence_timeout (MetaScreen *screen)
+{
+  CollectTimedOutData ctod;
+
+  ctod.list = NULL;
+  ctod.next_timeout = STARTUP_TIMEOUT;
+  g_get_current_time (&ctod.now);
+  g_slist_foreach (screen->startup_sequences,
+                   collect_timed_out_foreach,
+                   &ctod);
+  if (ctod.list != NULL)
+    ctod.next_timeout = 0;
+  g_slist_free (ctod.list);
+
+  screen->startup_sequence_timeout =
+    g_timeout_add ((guint) ctod.next_timeout + 1,
+                   startup_sequence_timeout,
+                   screen);
+  g_source_set_name_by_id (screen->startup_sequence_timeout,
+                           "[muffin] startup_sequence_timeout");
 }
 
 static void
@@ -3860,9 +4115,7 @@ check_fullscreen_func (gpointer data)
     {
       /* DOCK window stacking depends on the monitor's fullscreen
          status so we need to trigger a re-layering. */
-      MetaWindow *top_window = meta_stack_get_top (screen->stack);
-      if (top_window)
-        meta_stack_update_layer (screen->stack, top_window);
+      meta_stack_update_layer (screen->stack, NULL);
 
       g_signal_emit (screen, screen_signals[IN_FULLSCREEN_CHANGED], 0, NULL);
     }
@@ -61,6 +61,7 @@ meta_window_release_saved_state (const MetaWindowSessionInfo *info)
 #include <fcntl.h>
 #include <errno.h>
 #include <glib.h>
+#include <gio/gio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -74,7 +75,7 @@ static void ice_io_error_handler (IceConn connection);
 static void new_ice_connection (IceConn connection, IcePointer client_data,
 				Bool opening, IcePointer *watch_data);
 
-static void        save_state         (void);
+static void        save_state         (gboolean shutdown);
 static char*       load_state         (const char *previous_save_file);
 static void        regenerate_save_file (void);
 static const char* full_save_file       (void);
@@ -454,9 +455,8 @@ save_phase_2_callback (SmcConn smc_conn, SmPointer client_data)
 
   current_state = STATE_SAVING_PHASE_2;
 
-  save_state ();
-
-  save_yourself_possibly_done (shutdown, TRUE);
+  /* Finishes the save once the file has been written */
+  save_state (shutdown);
 }
 
 static void
@@ -809,20 +809,64 @@ decode_text_from_utf8 (const char *text)
   return g_string_free (str, FALSE);
 }
 
+/* What the session file was last written with, so that saving the
+ * same state again doesn't touch the file */
+static char *last_saved_contents = NULL;
+
+typedef struct
+{
+  gboolean shutdown;
+  GFile *file;
+  char *contents;
+} SaveStateData;
+
+static void
+save_state_done (GObject      *source,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+  SaveStateData *data = user_data;
+  GError *error = NULL;
+
+  /* FIXME need a dialog for this */
+  if (!g_file_replace_contents_finish (data->file, result, NULL, &error))
+    {
+      meta_warning ("Error writing session file '%s': %s\n",
+                    full_save_file (), error->message);
+      g_error_free (error);
+    }
+  else
+    {
+      free (last_saved_contents);
+      last_saved_contents = data->contents;
+      data->contents = NULL;
+    }
+
+  save_yourself_possibly_done (data->shutdown, TRUE);
+
+  g_object_unref (data->file);
+  free (data->contents);
+  free (data);
+}
+
+/*
+ * Writes the session file and then tells the session manager we're
+ * done. The state is formatted up front, so the windows can change
+ * while the file is written asynchronously.
+ */
 static void
-save_state (void)
+save_state (gboolean shutdown)
 {
   char *muffin_dir;
   char *session_dir;
-  FILE *outfile;
+  GString *contents;
+  SaveStateData *data;
   GSList *windows;
   GSList *tmp;
   int stack_position;
 
   g_assert (client_id);
 
-  outfile = NULL;
-
   /*
    * g_get_user_config_dir() is guaranteed to return an existing directory.
    * Eventually, if SM stays with the WM, I'd like to make this
@@ -853,16 +897,10 @@ save_state (void)
                     session_dir, g_strerror (errno));
     }
 
-  meta_topic (META_DEBUG_SM, "Saving session to '%s'\n", full_save_file ());
-
-  outfile = fopen (full_save_file (), "w");
+  free (muffin_dir);
+  free (session_dir);
 
-  if (outfile == NULL)
-    {
-      meta_warning ("Could not open session file '%s' for writing: %s\n",
-                    full_save_file (), g_strerror (errno));
-      goto out;
-    }
+  meta_topic (META_DEBUG_SM, "Saving session to '%s'\n", full_save_file ());
 
   /* The file format is:
    * <muffin_session id="foo">
@@ -880,8 +918,10 @@ save_state (void)
    *
    */
 
-  fprintf (outfile, "<muffin_session id=\"%s\">\n",
-           client_id);
+  contents = g_string_new (NULL);
+
+  g_string_append_printf (contents, "<muffin_session id=\"%s\">\n",
+                          client_id);
 
   windows = meta_display_list_windows (meta_get_display (), META_LIST_DEFAULT);
 
@@ -923,15 +963,15 @@ save_state (void)
           meta_topic (META_DEBUG_SM, "Saving session managed window %s, client ID '%s'\n",
                       window->desc, window->sm_client_id);
 
-          fprintf (outfile,
-                   "  <window id=\"%s\" class=\"%s\" name=\"%s\" title=\"%s\" role=\"%s\" type=\"%s\" stacking=\"%d\">\n",
-                   sm_client_id,
-                   res_class ? res_class : "",
-                   res_name ? res_name : "",
-                   title ? title : "",
-                   role ? role : "",
-                   window_type_to_string (window->type),
-                   stack_position);
+          g_string_append_printf (contents,
+                                  "  <window id=\"%s\" class=\"%s\" name=\"%s\" title=\"%s\" role=\"%s\" type=\"%s\" stacking=\"%d\">\n",
+                                  sm_client_id,
+                                  res_class ? res_class : "",
+                                  res_name ? res_name : "",
+                                  title ? title : "",
+                                  role ? role : "",
+                                  window_type_to_string (window->type),
+                                  stack_position);
 
           free (sm_client_id);
           free (res_class);
@@ -941,29 +981,29 @@ save_state (void)
 
           /* Sticky */
           if (window->on_all_workspaces_requested)
-            fputs ("    <sticky/>\n", outfile);
+            g_string_append (contents, "    <sticky/>\n");
 
           /* Minimized */
           if (window->minimized)
-            fputs ("    <minimized/>\n", outfile);
+            g_string_append (contents, "    <minimized/>\n");
 
           /* Maximized */
           if (META_WINDOW_MAXIMIZED (window))
             {
-              fprintf (outfile,
-                       "    <maximized saved_x=\"%d\" saved_y=\"%d\" saved_width=\"%d\" saved_height=\"%d\"/>\n",
-                       window->saved_rect.x,
-                       window->saved_rect.y,
-                       window->saved_rect.width,
-                       window->saved_rect.height);
+              g_string_append_printf (contents,
+                                      "    <maximized saved_x=\"%d\" saved_y=\"%d\" saved_width=\"%d\" saved_height=\"%d\"/>\n",
+                                      window->saved_rect.x,
+                                      window->saved_rect.y,
+                                      window->saved_rect.width,
+                                      window->saved_rect.height);
             }
 
           /* Workspaces we're on */
           {
             int n;
             n = meta_workspace_index (window->workspace);
-            fprintf (outfile,
-                     "    <workspace index=\"%d\"/>\n", n);
+            g_string_append_printf (contents,
+                                    "    <workspace index=\"%d\"/>\n", n);
           }
 
           /* Gravity */
@@ -971,13 +1011,13 @@ save_state (void)
             int x, y, w, h;
             meta_window_get_geometry (window, &x, &y, &w, &h);
 
-            fprintf (outfile,
-                     "    <geometry x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" gravity=\"%s\"/>\n",
-                     x, y, w, h,
-                     meta_gravity_to_string (window->size_hints.win_gravity));
+            g_string_append_printf (contents,
+                                    "    <geometry x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" gravity=\"%s\"/>\n",
+                                    x, y, w, h,
+                                    meta_gravity_to_string (window->size_hints.win_gravity));
           }
 
-          fputs ("  </window>\n", outfile);
+          g_string_append (contents, "  </window>\n");
         }
 #ifdef WITH_VERBOSE_MODE
       else
@@ -992,26 +1032,32 @@ save_state (void)
 
   g_slist_free (windows);
 
-  fputs ("</muffin_session>\n", outfile);
+  g_string_append (contents, "</muffin_session>\n");
 
- out:
-  if (outfile)
+  if (last_saved_contents &&
+      strcmp (last_saved_contents, contents->str) == 0 &&
+      g_file_test (full_save_file (), G_FILE_TEST_EXISTS))
     {
-      /* FIXME need a dialog for this */
-      if (ferror (outfile))
-        {
-          meta_warning ("Error writing session file '%s': %s\n",
-                        full_save_file (), g_strerror (errno));
-        }
-      if (fclose (outfile))
-        {
-          meta_warning ("Error closing session file '%s': %s\n",
-                        full_save_file (), g_strerror (errno));
-        }
+      meta_topic (META_DEBUG_SM, "Session is unchanged, not writing it again\n");
+
+      g_string_free (contents, TRUE);
+      save_yourself_possibly_done (shutdown, TRUE);
+      return;
     }
 
-  free (muffin_dir);
-  free (session_dir);
+  data = g_new (SaveStateData, 1);
+  data->shutdown = shutdown;
+  data->file = g_file_new_for_path (full_save_file ());
+  data->contents = g_string_free (contents, FALSE);
+
+  g_file_replace_contents_async (data->file,
+                                 data->contents,
+                                 strlen (data->contents),
+                                 NULL, FALSE,
+                                 G_FILE_CREATE_NONE,
+                                 NULL,
+                                 save_state_done,
+                                 data);
 }
 
 typedef enum
@@ -1059,6 +1105,10 @@ static GMarkupParser muffin_session_parser = {
 
 static GSList *window_info_list = NULL;
 
+/* window_info_list by client ID, each list in the same order, built
+ * when the first window is looked up */
+static GHashTable *window_info_by_id = NULL;
+
 static char*
 load_state (const char *previous_save_file)
 {
@@ -1513,6 +1563,38 @@ both_null_or_matching (const char *a,
     return FALSE;
 }
 
+static void
+ensure_window_info_index (void)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  GSList *tmp;
+
+  if (window_info_by_id)
+    return;
+
+  window_info_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             free, NULL);
+
+  for (tmp = window_info_list; tmp != NULL; tmp = tmp->next)
+    {
+      MetaWindowSessionInfo *info = tmp->data;
+      GSList *infos;
+
+      /* Those can't match a session managed window */
+      if (info->id == NULL)
+        continue;
+
+      infos = g_hash_table_lookup (window_info_by_id, info->id);
+      g_hash_table_insert (window_info_by_id, g_strdup (info->id),
+                           g_slist_prepend (infos, info));
+    }
+
+  g_hash_table_iter_init (&iter, window_info_by_id);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    g_hash_table_iter_replace (&iter, g_slist_reverse (value));
+}
+
 static GSList*
 get_possible_matches (MetaWindow *window)
 {
@@ -1525,7 +1607,15 @@ get_possible_matches (MetaWindow *window)
 
   ignore_client_id = g_getenv ("MUFFIN_DEBUG_SM") != NULL;
 
-  tmp = window_info_list;
+  /* The verbose output explains why every other window didn't match */
+  if (ignore_client_id || meta_is_verbose ())
+    tmp = window_info_list;
+  else
+    {
+      ensure_window_info_index ();
+      tmp = g_hash_table_lookup (window_info_by_id, window->sm_client_id);
+    }
+
   while (tmp != NULL)
     {
       MetaWindowSessionInfo *info;
@@ -1669,6 +1759,19 @@ meta_window_release_saved_state (const MetaWindowSessionInfo *info)
    */
   window_info_list = g_slist_remove (window_info_list, info);
 
+  if (window_info_by_id && info->id)
+    {
+      GSList *infos;
+
+      infos = g_hash_table_lookup (window_info_by_id, info->id);
+      infos = g_slist_remove (infos, info);
+
+      if (infos)
+        g_hash_table_insert (window_info_by_id, g_strdup (info->id), infos);
+      else
+        g_hash_table_remove (window_info_by_id, info->id);
+    }
+
   session_info_free ((MetaWindowSessionInfo*) info);
 }
 
@@ -57,13 +57,32 @@
  * no longer pending b) if necessary, drop the predicted stacking
  * order to recompute it at the next opportunity.
  *
- * Possible optimizations:
- *  Keep the stacks as an array + reverse-mapping hash table to avoid
- *    linear lookups.
- *  Keep the stacks as a GList + reverse-mapping hash table to avoid
- *    linear lookups and to make restacking constant-time.
+ * The stacks are kept as a linked list plus a reverse-mapping hash
+ * table, so that finding a window and applying a stacking operation
+ * are constant-time; a sequence like raising a group of transients
+ * would otherwise be quadratic. An array of the windows is only made
+ * when someone asks for it with meta_stack_tracker_get_stack().
  */
 
+typedef struct _MetaTrackedStack MetaTrackedStack;
+
+/* A stack of X windows, bottom to top */
+struct _MetaTrackedStack
+{
+  /* Windows as GUINT_TO_POINTER(), bottom to top */
+  GQueue windows;
+
+  /* Window => GList link in windows */
+  GHashTable *links;
+
+  /* Array of the windows, bottom to top, valid if snapshot_valid is set.
+   * Kept around between snapshots so that the array handed out by
+   * meta_stack_tracker_get_stack() stays allocated as long as possible.
+   */
+  GArray *snapshot;
+  gboolean snapshot_valid;
+};
+
 typedef union _MetaStackOp MetaStackOp;
 
 typedef enum {
@@ -115,7 +134,7 @@ struct _MetaStackTracker
   /* This is the last state of the stack as based on events received
    * from the X server.
    */
-  GArray *server_stack;
+  MetaTrackedStack *server_stack;
 
   /* This is the serial of the last request we made that was reflected
    * in server_stack
@@ -130,7 +149,7 @@ struct _MetaStackTracker
   /* This is how we think the stack is, based on server_stack, and
    * on requests we've made subsequent to server_stack
    */
-  GArray *predicted_stack;
+  MetaTrackedStack *predicted_stack;
 
   /* Idle function used to sync the compositor's view of the window
    * stack up with our best guess before a frame is drawn.
@@ -173,20 +192,19 @@ meta_stack_op_dump (MetaStackOp *op,
 static void
 meta_stack_tracker_dump (MetaStackTracker *tracker)
 {
-  guint i;
   GList *l;
 
   meta_topic (META_DEBUG_STACK, "MetaStackTracker state (screen=%d)\n", tracker->screen->number);
   meta_push_no_msg_prefix ();
   meta_topic (META_DEBUG_STACK, "  server_serial: %ld\n", tracker->server_serial);
   meta_topic (META_DEBUG_STACK, "  server_stack: ");
-  for (i = 0; i < tracker->server_stack->len; i++)
-    meta_topic (META_DEBUG_STACK, "  %#lx", g_array_index (tracker->server_stack, Window, i));
+  for (l = tracker->server_stack->windows.head; l; l = l->next)
+    meta_topic (META_DEBUG_STACK, "  %#x", GPOINTER_TO_UINT (l->data));
   if (tracker->predicted_stack)
     {
       meta_topic (META_DEBUG_STACK, "\n  predicted_stack: ");
-      for (i = 0; i < tracker->predicted_stack->len; i++)
-	meta_topic (META_DEBUG_STACK, "  %#lx", g_array_index (tracker->predicted_stack, Window, i));
+      for (l = tracker->predicted_stack->windows.head; l; l = l->next)
+	meta_topic (META_DEBUG_STACK, "  %#x", GPOINTER_TO_UINT (l->data));
     }
   meta_topic (META_DEBUG_STACK, "\n  queued_requests: [");
   for (l = tracker->queued_requests->head; l; l = l->next)
@@ -204,88 +222,137 @@ meta_stack_op_free (MetaStackOp *op)
   g_slice_free (MetaStackOp, op);
 }
 
-static int
-find_window (GArray *stack,
-	     Window  window)
+static MetaTrackedStack *
+tracked_stack_new (Window *windows,
+                   guint   n_windows)
 {
+  MetaTrackedStack *stack = g_new0 (MetaTrackedStack, 1);
   guint i;
 
-  for (i = 0; i < stack->len; i++)
-    if (g_array_index (stack, Window, i) == window)
-      return i;
+  g_queue_init (&stack->windows);
+  stack->links = g_hash_table_new (NULL, NULL);
+  stack->snapshot = g_array_new (FALSE, FALSE, sizeof (Window));
+  stack->snapshot_valid = FALSE;
 
-  return -1;
+  /* The macro is safe to use: Window is guaranteed to be 32 bits */
+  for (i = 0; i < n_windows; i++)
+    {
+      g_queue_push_tail (&stack->windows, GUINT_TO_POINTER (windows[i]));
+      g_hash_table_insert (stack->links,
+                           GUINT_TO_POINTER (windows[i]),
+                           stack->windows.tail);
+    }
+
+  return stack;
 }
 
-/* Returns TRUE if stack was changed */
-static gboolean
-move_window_above (GArray *stack,
-                   Window  window,
-                   int     old_pos,
-                   int     above_pos)
+static MetaTrackedStack *
+tracked_stack_copy (MetaTrackedStack *other)
 {
-  int i;
+  MetaTrackedStack *stack = tracked_stack_new (NULL, 0);
+  GList *l;
 
-  if (old_pos < above_pos)
+  for (l = other->windows.head; l; l = l->next)
     {
-      for (i = old_pos; i < above_pos; i++)
-	g_array_index (stack, Window, i) = g_array_index (stack, Window, i + 1);
+      g_queue_push_tail (&stack->windows, l->data);
+      g_hash_table_insert (stack->links, l->data, stack->windows.tail);
+    }
 
-      g_array_index (stack, Window, above_pos) = window;
+  return stack;
+}
 
-      return TRUE;
-    }
-  else if (old_pos > above_pos + 1)
-    {
-      for (i = old_pos; i > above_pos + 1; i--)
-	g_array_index (stack, Window, i) = g_array_index (stack, Window, i - 1);
+static void
+tracked_stack_free (MetaTrackedStack *stack)
+{
+  g_queue_clear (&stack->windows);
+  g_hash_table_destroy (stack->links);
+  g_array_free (stack->snapshot, TRUE);
+  free (stack);
+}
+
+static GList *
+find_window (MetaTrackedStack *stack,
+	     Window            window)
+{
+  return g_hash_table_lookup (stack->links, GUINT_TO_POINTER (window));
+}
+
+/* Moves link to just above "above", or to the bottom if "above" is
+ * NULL. Returns TRUE if stack was changed.
+ */
+static gboolean
+move_window_above (MetaTrackedStack *stack,
+                   GList            *link,
+                   GList            *above)
+{
+  gpointer window = link->data;
+
+  if (link == above || link->prev == above)
+    return FALSE;
 
-      g_array_index (stack, Window, above_pos + 1) = window;
+  g_queue_delete_link (&stack->windows, link);
 
-      return TRUE;
+  if (above)
+    {
+      g_queue_insert_after (&stack->windows, above, window);
+      link = above->next;
     }
   else
-    return FALSE;
+    {
+      g_queue_push_head (&stack->windows, window);
+      link = stack->windows.head;
+    }
+
+  g_hash_table_insert (stack->links, window, link);
+
+  return TRUE;
 }
 
 /* Returns TRUE if stack was changed */
 static gboolean
-meta_stack_op_apply (MetaStackOp *op,
-		     GArray      *stack)
+meta_stack_op_apply (MetaStackOp      *op,
+		     MetaTrackedStack *stack)
 {
+  gboolean changed;
+
   switch (op->any.type)
     {
     case STACK_OP_ADD:
       {
-	int old_pos = find_window (stack, op->add.window);
-	if (old_pos >= 0)
+	if (find_window (stack, op->add.window))
 	  {
 	    g_warning ("STACK_OP_ADD: window %#lx already in stack",
 		       op->add.window);
 	    return FALSE;
 	  }
 
-	g_array_append_val (stack, op->add.window);
-	return TRUE;
+	g_queue_push_tail (&stack->windows, GUINT_TO_POINTER (op->add.window));
+	g_hash_table_insert (stack->links,
+	                     GUINT_TO_POINTER (op->add.window),
+	                     stack->windows.tail);
+	changed = TRUE;
+	break;
       }
     case STACK_OP_REMOVE:
       {
-	int old_pos = find_window (stack, op->remove.window);
-	if (old_pos < 0)
+	GList *link = find_window (stack, op->remove.window);
+	if (link == NULL)
 	  {
 	    g_warning ("STACK_OP_REMOVE: window %#lx not in stack",
 		       op->remove.window);
 	    return FALSE;
 	  }
 
-	g_array_remove_index (stack, old_pos);
-	return TRUE;
+	g_hash_table_remove (stack->links, GUINT_TO_POINTER (op->remove.window));
+	g_queue_delete_link (&stack->windows, link);
+	changed = TRUE;
+	break;
       }
     case STACK_OP_RAISE_ABOVE:
       {
-	int old_pos = find_window (stack, op->raise_above.window);
-	int above_pos;
-	if (old_pos < 0)
+	GList *link = find_window (stack, op->raise_above.window);
+	GList *above;
+	if (link == NULL)
 	  {
 	    g_warning ("STACK_OP_RAISE_ABOVE: window %#lx not in stack",
 		       op->raise_above.window);
@@ -294,8 +361,8 @@ meta_stack_op_apply (MetaStackOp *op,
 
 	if (op->raise_above.sibling != None)
 	  {
-	    above_pos = find_window (stack, op->raise_above.sibling);
-	    if (above_pos < 0)
+	    above = find_window (stack, op->raise_above.sibling);
+	    if (above == NULL)
 	      {
 		g_warning ("STACK_OP_RAISE_ABOVE: sibling window %#lx not in stack",
 			   op->raise_above.sibling);
@@ -304,16 +371,17 @@ meta_stack_op_apply (MetaStackOp *op,
 	  }
 	else
 	  {
-	    above_pos = -1;
+	    above = NULL;
 	  }
 
-	return move_window_above (stack, op->raise_above.window, old_pos, above_pos);
+	changed = move_window_above (stack, link, above);
+	break;
       }
     case STACK_OP_LOWER_BELOW:
       {
-	int old_pos = find_window (stack, op->lower_below.window);
-	int above_pos;
-	if (old_pos < 0)
+	GList *link = find_window (stack, op->lower_below.window);
+	GList *above;
+	if (link == NULL)
 	  {
 	    g_warning ("STACK_OP_LOWER_BELOW: window %#lx not in stack",
 		       op->lower_below.window);
@@ -322,39 +390,58 @@ meta_stack_op_apply (MetaStackOp *op,
 
 	if (op->lower_below.sibling != None)
 	  {
-	    int below_pos = find_window (stack, op->lower_below.sibling);
-	    if (below_pos < 0)
+	    GList *below = find_window (stack, op->lower_below.sibling);
+	    if (below == NULL)
 	      {
 		g_warning ("STACK_OP_LOWER_BELOW: sibling window %#lx not in stack",
 			   op->lower_below.sibling);
 		return FALSE;
 	      }
 
-	    above_pos = below_pos - 1;
+	    /* Already just below the sibling? */
+	    if (below->prev == link)
+	      return FALSE;
+
+	    above = below->prev;
 	  }
 	else
 	  {
-	    above_pos = stack->len - 1;
+	    above = stack->windows.tail;
 	  }
 
-	return move_window_above (stack, op->lower_below.window, old_pos, above_pos);
+	changed = move_window_above (stack, link, above);
+	break;
       }
+    default:
+      g_assert_not_reached ();
+      return FALSE;
     }
 
-  g_assert_not_reached ();
-  return FALSE;
+  if (changed)
+    stack->snapshot_valid = FALSE;
+
+  return changed;
 }
 
+/* Returns the windows of stack, bottom to top. The array is owned by
+ * the stack and is only valid until it is next changed.
+ */
 static GArray *
-copy_stack (Window *windows,
-	    guint   n_windows)
+tracked_stack_get_snapshot (MetaTrackedStack *stack)
 {
-  GArray *stack = g_array_new (FALSE, FALSE, sizeof (Window));
+  if (!stack->snapshot_valid)
+    {
+      GList *l;
+      guint i;
 
-  g_array_set_size (stack, n_windows);
-  memcpy (stack->data, windows, sizeof (Window) * n_windows);
+      g_array_set_size (stack->snapshot, stack->windows.length);
+      for (l = stack->windows.head, i = 0; l; l = l->next, i++)
+        g_array_index (stack->snapshot, Window, i) = GPOINTER_TO_UINT (l->data);
 
-  return stack;
+      stack->snapshot_valid = TRUE;
+    }
+
+  return stack->snapshot;
 }
 
 LOCAL_SYMBOL MetaStackTracker *
@@ -373,7 +460,7 @@ meta_stack_tracker_new (MetaScreen *screen)
   XQueryTree (screen->display->xdisplay,
               screen->xroot,
               &ignored1, &ignored2, &children, &n_children);
-  tracker->server_stack = copy_stack (children, n_children);
+  tracker->server_stack = tracked_stack_new (children, n_children);
   XFree (children);
 
   tracker->queued_requests = g_queue_new ();
@@ -387,9 +474,9 @@ meta_stack_tracker_free (MetaStackTracker *tracker)
   if (tracker->sync_stack_later)
     meta_later_remove (tracker->sync_stack_later);
 
-  g_array_free (tracker->server_stack, TRUE);
+  tracked_stack_free (tracker->server_stack);
   if (tracker->predicted_stack)
-    g_array_free (tracker->predicted_stack, TRUE);
+    tracked_stack_free (tracker->predicted_stack);
 
   g_queue_foreach (tracker->queued_requests, (GFunc)meta_stack_op_free, NULL);
   g_queue_free (tracker->queued_requests);
@@ -534,7 +621,7 @@ stack_tracker_event_received (MetaStackTracker *tracker,
     {
       if (tracker->predicted_stack)
         {
-          g_array_free (tracker->predicted_stack, TRUE);
+          tracked_stack_free (tracker->predicted_stack);
           tracker->predicted_stack = NULL;
         }
 
@@ -632,11 +719,12 @@ meta_stack_tracker_get_stack (MetaStackTracker *tracker,
 			      Window          **windows,
 			      int              *n_windows)
 {
+  MetaTrackedStack *tracked;
   GArray *stack;
 
   if (tracker->queued_requests->length == 0)
     {
-      stack = tracker->server_stack;
+      tracked = tracker->server_stack;
     }
   else
     {
@@ -644,8 +732,7 @@ meta_stack_tracker_get_stack (MetaStackTracker *tracker,
         {
           GList *l;
 
-          tracker->predicted_stack = copy_stack ((Window *)tracker->server_stack->data,
-                                                 tracker->server_stack->len);
+          tracker->predicted_stack = tracked_stack_copy (tracker->server_stack);
           for (l = tracker->queued_requests->head; l; l = l->next)
             {
               MetaStackOp *op = l->data;
@@ -653,9 +740,11 @@ meta_stack_tracker_get_stack (MetaStackTracker *tracker,
             }
         }
 
-      stack = tracker->predicted_stack;
+      tracked = tracker->predicted_stack;
     }
 
+  stack = tracked_stack_get_snapshot (tracked);
+
   if (windows)
     *windows = (Window *)stack->data;
   if (n_windows)
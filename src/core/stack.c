@@ -30,6 +30,7 @@
 #include <config.h>
 #include "stack.h"
 #include "window-private.h"
+#include "group-private.h"
 #include <meta/errors.h>
 #include "frame.h"
 #include <meta/group.h>
@@ -37,6 +38,7 @@
 #include <meta/workspace.h>
 
 #include <X11/Xatom.h>
+#include <string.h>
 
 #define WINDOW_HAS_TRANSIENT_TYPE(w)                    \
           (w->type == META_WINDOW_DIALOG ||             \
@@ -63,6 +65,11 @@ static void stack_do_resort           (MetaStack *stack);
 
 static void stack_ensure_sorted (MetaStack *stack);
 
+static void free_hit_index (MetaStack *stack);
+
+static void queue_window_once (GList      **pending,
+                               MetaWindow  *window);
+
 LOCAL_SYMBOL MetaStack*
 meta_stack_new (MetaScreen *screen)
 {
@@ -79,6 +86,8 @@ meta_stack_new (MetaScreen *screen)
 
   stack->freeze_count = 0;
   stack->last_root_children_stacked = NULL;
+  stack->last_client_list = NULL;
+  stack->last_client_list_stacking = NULL;
 
   stack->n_positions = 0;
 
@@ -86,6 +95,15 @@ meta_stack_new (MetaScreen *screen)
   stack->need_relayer = FALSE;
   stack->need_constrain = FALSE;
 
+  stack->relayer_pending = NULL;
+  stack->constrain_pending = NULL;
+  stack->resort_pending = NULL;
+
+  stack->hit_index = NULL;
+  stack->hit_index_columns = 0;
+  stack->hit_index_rows = 0;
+  stack->hit_index_valid = FALSE;
+
   return stack;
 }
 
@@ -98,8 +116,18 @@ meta_stack_free (MetaStack *stack)
   g_list_free (stack->added);
   g_list_free (stack->removed);
 
+  g_list_free (stack->relayer_pending);
+  g_list_free (stack->constrain_pending);
+  g_list_free (stack->resort_pending);
+
   if (stack->last_root_children_stacked)
     g_array_free (stack->last_root_children_stacked, TRUE);
+  if (stack->last_client_list)
+    g_array_free (stack->last_client_list, TRUE);
+  if (stack->last_client_list_stacking)
+    g_array_free (stack->last_client_list_stacking, TRUE);
+
+  free_hit_index (stack);
 
   free (stack);
 }
@@ -146,6 +174,11 @@ meta_stack_remove (MetaStack  *stack,
   /* We don't know if it's been moved from "added" to "stack" yet */
   stack->added = g_list_remove (stack->added, window);
   stack->sorted = g_list_remove (stack->sorted, window);
+  stack->hit_index_valid = FALSE;
+
+  stack->relayer_pending = g_list_remove (stack->relayer_pending, window);
+  stack->constrain_pending = g_list_remove (stack->constrain_pending, window);
+  stack->resort_pending = g_list_remove (stack->resort_pending, window);
 
   /* Remember the window ID to remove it from the stack array.
    * The macro is safe to use: Window is guaranteed to be 32 bits, and
@@ -165,17 +198,21 @@ LOCAL_SYMBOL void
 meta_stack_update_layer (MetaStack  *stack,
                          MetaWindow *window)
 {
-  stack->need_relayer = TRUE;
+  if (window == NULL)
+    stack->need_relayer = TRUE;
+  else if (!stack->need_relayer && WINDOW_IN_STACK (window))
+    queue_window_once (&stack->relayer_pending, window);
 
   stack_sync_to_server (stack);
-  meta_stack_update_window_tile_matches (stack, window->screen->active_workspace);
+  meta_stack_update_window_tile_matches (stack, stack->screen->active_workspace);
 }
 
 LOCAL_SYMBOL void
 meta_stack_update_transient (MetaStack  *stack,
                              MetaWindow *window)
 {
-  stack->need_constrain = TRUE;
+  if (!stack->need_constrain && WINDOW_IN_STACK (window))
+    queue_window_once (&stack->constrain_pending, window);
 
   stack_sync_to_server (stack);
   meta_stack_update_window_tile_matches (stack, window->screen->active_workspace);
@@ -321,27 +358,35 @@ get_standalone_layer (MetaWindow *window)
 
 /* Note that this function can never use window->layer only
  * get_standalone_layer, or we'd have issues.
+ *
+ * Since standalone layers don't depend on the layers being computed,
+ * the result stays valid for a whole relayer: @group_max_layers keeps
+ * it for each group, so that relayering all the members of a group
+ * walks the group once rather than once per member.
  */
 static MetaStackLayer
-get_maximum_layer_in_group (MetaWindow *window)
+get_maximum_layer_in_group (MetaWindow  *window,
+                            GHashTable **group_max_layers)
 {
-  GSList *members;
   MetaGroup *group;
   GSList *tmp;
   MetaStackLayer max;
   MetaStackLayer layer;
+  gpointer cached;
 
   max = META_LAYER_DESKTOP;
 
   group = meta_window_get_group (window);
+  if (group == NULL)
+    return max;
 
-  if (group != NULL)
-    members = meta_group_list_windows (group);
-  else
-    members = NULL;
+  if (*group_max_layers == NULL)
+    *group_max_layers = g_hash_table_new (NULL, NULL);
+  else if (g_hash_table_lookup_extended (*group_max_layers, group,
+                                         NULL, &cached))
+    return GPOINTER_TO_INT (cached);
 
-  tmp = members;
-  while (tmp != NULL)
+  for (tmp = group->windows; tmp != NULL; tmp = tmp->next)
     {
       MetaWindow *w = tmp->data;
 
@@ -351,17 +396,16 @@ get_maximum_layer_in_group (MetaWindow *window)
           if (layer > max)
             max = layer;
         }
-
-      tmp = tmp->next;
     }
 
-  g_slist_free (members);
+  g_hash_table_insert (*group_max_layers, group, GINT_TO_POINTER (max));
 
   return max;
 }
 
 static void
-compute_layer (MetaWindow *window)
+compute_layer (MetaWindow  *window,
+               GHashTable **group_max_layers)
 {
   window->layer = get_standalone_layer (window);
 
@@ -384,7 +428,7 @@ compute_layer (MetaWindow *window)
 
       MetaStackLayer group_max;
 
-      group_max = get_maximum_layer_in_group (window);
+      group_max = get_maximum_layer_in_group (window, group_max_layers);
 
       if (group_max > window->layer)
         {
@@ -693,6 +737,7 @@ ensure_above (MetaWindow *above,
 		  "Promoting window %s from layer %u to %u due to contraint\n",
 		  above->desc, above->layer, below->layer);
       above->layer = below->layer;
+      above->screen->stack->need_resort = TRUE;
     }
 
   if (above->stack_position < below->stack_position)
@@ -767,6 +812,142 @@ apply_constraints (Constraint **constraints,
   g_slist_free (heads);
 }
 
+static void
+queue_window_once (GList      **pending,
+                   MetaWindow  *window)
+{
+  if (g_list_find (*pending, window) == NULL)
+    *pending = g_list_prepend (*pending, window);
+}
+
+static void
+queue_window_and_group (GList      **pending,
+                        MetaWindow  *window)
+{
+  MetaGroup *group;
+  GSList *members, *tmp;
+
+  queue_window_once (pending, window);
+
+  group = meta_window_get_group (window);
+  if (group == NULL)
+    return;
+
+  members = meta_group_list_windows (group);
+  for (tmp = members; tmp != NULL; tmp = tmp->next)
+    {
+      MetaWindow *w = tmp->data;
+
+      if (w->screen == window->screen && WINDOW_IN_STACK (w))
+        queue_window_once (pending, w);
+    }
+
+  g_slist_free (members);
+}
+
+static MetaWindow *
+get_transient_parent (MetaWindow *window)
+{
+  MetaWindow *parent;
+
+  if (window->xtransient_for == None ||
+      window->transient_parent_is_root_window)
+    return NULL;
+
+  parent = meta_display_lookup_x_window (window->display,
+                                         window->xtransient_for);
+
+  if (parent == NULL || parent->screen != window->screen)
+    return NULL;
+
+  return parent;
+}
+
+/*
+ * Collect the windows from "sorted" which share a constraint chain
+ * with one of the windows in constrain_pending: their transient
+ * parents and children, transitively, and every member of their
+ * groups.  Constraints never cross from this set to the rest of the
+ * stack, so solving it on its own gives the same result as solving
+ * the whole stack.
+ */
+static GList *
+list_constraint_closure (MetaStack *stack)
+{
+  GHashTable *windows;
+  GHashTable *groups;
+  GList *closure;
+  GList *tmp;
+  gboolean changed;
+
+  windows = g_hash_table_new (NULL, NULL);
+  groups = g_hash_table_new (NULL, NULL);
+
+  for (tmp = stack->constrain_pending; tmp != NULL; tmp = tmp->next)
+    {
+      MetaWindow *w = tmp->data;
+      MetaGroup *group;
+
+      g_hash_table_add (windows, w);
+
+      group = meta_window_get_group (w);
+      if (group != NULL)
+        g_hash_table_add (groups, group);
+    }
+
+  do
+    {
+      changed = FALSE;
+
+      for (tmp = stack->sorted; tmp != NULL; tmp = tmp->next)
+        {
+          MetaWindow *w = tmp->data;
+          MetaWindow *parent;
+          MetaGroup *group;
+
+          parent = get_transient_parent (w);
+          group = meta_window_get_group (w);
+
+          if (g_hash_table_contains (windows, w))
+            {
+              if (parent != NULL && !g_hash_table_contains (windows, parent))
+                {
+                  g_hash_table_add (windows, parent);
+                  changed = TRUE;
+                }
+            }
+          else if ((parent != NULL && g_hash_table_contains (windows, parent)) ||
+                   (group != NULL && g_hash_table_contains (groups, group)))
+            {
+              g_hash_table_add (windows, w);
+              changed = TRUE;
+            }
+          else
+            continue;
+
+          /* Whichever way w joined, its group comes with it */
+          if (group != NULL && !g_hash_table_contains (groups, group))
+            {
+              g_hash_table_add (groups, group);
+              changed = TRUE;
+            }
+        }
+    }
+  while (changed);
+
+  closure = NULL;
+  for (tmp = stack->sorted; tmp != NULL; tmp = tmp->next)
+    {
+      if (g_hash_table_contains (windows, tmp->data))
+        closure = g_list_prepend (closure, tmp->data);
+    }
+
+  g_hash_table_destroy (windows);
+  g_hash_table_destroy (groups);
+
+  return closure;
+}
+
 /*
  * Go through "deleted" and take the matching windows
  * out of "windows".
@@ -854,13 +1035,18 @@ stack_do_window_additions (MetaStack *stack)
           /* add to the main list */
           stack->sorted = g_list_prepend (stack->sorted, w);
 
+          /* A new group member can promote the group's dialogs, so
+           * they get relayered along with it.
+           */
+          queue_window_and_group (&stack->relayer_pending, w);
+          queue_window_once (&stack->constrain_pending, w);
+          queue_window_once (&stack->resort_pending, w);
+
           ++i;
           tmp = tmp->next;
         }
 
-      stack->need_resort = TRUE; /* may not be needed as we add to top */
-      stack->need_constrain = TRUE;
-      stack->need_relayer = TRUE;
+      stack->hit_index_valid = FALSE;
     }
 
   g_list_free (stack->added);
@@ -874,14 +1060,19 @@ static void
 stack_do_relayer (MetaStack *stack)
 {
   GList *tmp;
+  GHashTable *group_max_layers = NULL;
 
-  if (!stack->need_relayer)
+  if (!stack->need_relayer && stack->relayer_pending == NULL)
       return;
 
   meta_topic (META_DEBUG_STACK,
-              "Recomputing layers\n");
+              "Recomputing layers%s\n",
+              stack->need_relayer ? "" : " of changed windows");
 
-  tmp = stack->sorted;
+  if (stack->need_relayer)
+    tmp = stack->sorted;
+  else
+    tmp = stack->relayer_pending;
 
   while (tmp != NULL)
     {
@@ -891,7 +1082,26 @@ stack_do_relayer (MetaStack *stack)
       w = tmp->data;
       old_layer = w->layer;
 
-      compute_layer (w);
+      compute_layer (w, &group_max_layers);
+
+      /* Transients promoted to w's layer by their constraints, and
+       * dialogs promoted by their group, only come back down when
+       * their own layer is recomputed; that takes every window.
+       */
+      if (w->layer < old_layer && !stack->need_relayer)
+        {
+          meta_topic (META_DEBUG_STACK,
+                      "Window %s moved down from layer %u to %u, "
+                      "recomputing all layers\n",
+                      w->desc, old_layer, w->layer);
+          stack->need_resort = TRUE;
+          if (!stack->need_constrain)
+            queue_window_once (&stack->constrain_pending, w);
+
+          stack->need_relayer = TRUE;
+          tmp = stack->sorted;
+          continue;
+        }
 
       if (w->layer != old_layer)
         {
@@ -899,16 +1109,21 @@ stack_do_relayer (MetaStack *stack)
                       "Window %s moved from layer %u to %u\n",
                       w->desc, old_layer, w->layer);
           stack->need_resort = TRUE;
-          stack->need_constrain = TRUE;
-          /* don't need to constrain as constraining
-           * purely operates in terms of stack_position
-           * not layer
+          /* a transient promoted to its parent's layer needs
+           * promoting again, so reapply the window's constraints
            */
+          if (!stack->need_constrain)
+            queue_window_once (&stack->constrain_pending, w);
         }
 
       tmp = tmp->next;
     }
 
+  if (group_max_layers)
+    g_hash_table_destroy (group_max_layers);
+
+  g_list_free (stack->relayer_pending);
+  stack->relayer_pending = NULL;
   stack->need_relayer = FALSE;
 }
 
@@ -920,19 +1135,24 @@ static void
 stack_do_constrain (MetaStack *stack)
 {
   Constraint **constraints;
+  GList *windows;
 
-  /* It'd be nice if this were all faster, probably */
-
-  if (!stack->need_constrain)
+  if (!stack->need_constrain && stack->constrain_pending == NULL)
     return;
 
   meta_topic (META_DEBUG_STACK,
-              "Reapplying constraints\n");
+              "Reapplying constraints%s\n",
+              stack->need_constrain ? "" : " around changed windows");
+
+  if (stack->need_constrain)
+    windows = stack->sorted;
+  else
+    windows = list_constraint_closure (stack);
 
   constraints = g_new0 (Constraint*,
                         stack->n_positions);
 
-  create_constraints (constraints, stack->sorted);
+  create_constraints (constraints, windows);
 
   graph_constraints (constraints, stack->n_positions);
 
@@ -941,6 +1161,14 @@ stack_do_constrain (MetaStack *stack)
   free_constraints (constraints, stack->n_positions);
   free (constraints);
 
+  if (windows != stack->sorted)
+    g_list_free (windows);
+
+  /* Applying the constraints moves windows, which queues them again;
+   * they are satisfied now.
+   */
+  g_list_free (stack->constrain_pending);
+  stack->constrain_pending = NULL;
   stack->need_constrain = FALSE;
 }
 
@@ -950,17 +1178,48 @@ stack_do_constrain (MetaStack *stack)
 static void
 stack_do_resort (MetaStack *stack)
 {
-  if (!stack->need_resort)
+  GList *tmp;
+  guint n_pending;
+
+  if (!stack->need_resort && stack->resort_pending == NULL)
     return;
 
-  meta_topic (META_DEBUG_STACK,
-              "Sorting stack list\n");
+  /* Moving a window to a new stack_position shifts the windows it
+   * passes by one, which keeps them in the same order relative to each
+   * other; only the moved windows are out of place.  Take those out and
+   * insert them again, unless there are enough of them that a full sort
+   * is cheaper.
+   */
+  n_pending = g_list_length (stack->resort_pending);
+  if (!stack->need_resort &&
+      n_pending <= g_bit_storage (stack->n_positions))
+    {
+      meta_topic (META_DEBUG_STACK,
+                  "Re-inserting %u moved windows in stack list\n",
+                  n_pending);
 
-  stack->sorted = g_list_sort (stack->sorted,
-                               (GCompareFunc) compare_window_position);
+      for (tmp = stack->resort_pending; tmp != NULL; tmp = tmp->next)
+        stack->sorted = g_list_remove (stack->sorted, tmp->data);
+
+      for (tmp = stack->resort_pending; tmp != NULL; tmp = tmp->next)
+        stack->sorted = g_list_insert_sorted (stack->sorted, tmp->data,
+                                              (GCompareFunc) compare_window_position);
+    }
+  else
+    {
+      meta_topic (META_DEBUG_STACK,
+                  "Sorting stack list\n");
+
+      stack->sorted = g_list_sort (stack->sorted,
+                                   (GCompareFunc) compare_window_position);
+    }
+
+  stack->hit_index_valid = FALSE;
 
   meta_screen_queue_check_fullscreen (stack->screen);
 
+  g_list_free (stack->resort_pending);
+  stack->resort_pending = NULL;
   stack->need_resort = FALSE;
 }
 
@@ -1083,6 +1342,97 @@ raise_window_relative_to_managed_windows (MetaScreen *screen,
     }
 }
 
+static gboolean
+window_arrays_equal (GArray *a,
+                     GArray *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  return a->len == b->len &&
+         memcmp (a->data, b->data, a->len * sizeof (Window)) == 0;
+}
+
+/*
+ * Works out which windows of new_stack can stay where they are when
+ * going from old_stack to new_stack (both top to bottom): the longest
+ * subsequence of new_stack that is in the same order in old_stack.
+ * Since no window appears twice, that is the longest increasing
+ * subsequence of the positions in new_stack of the windows of
+ * old_stack, which takes O(n log n).
+ *
+ * Returns an array of new_stack->len booleans, to be freed with free().
+ */
+static gboolean *
+find_windows_in_place (GArray *old_stack,
+                       GArray *new_stack)
+{
+  GHashTable *new_positions;
+  gboolean *in_place;
+  int *positions, *tails, *prev;
+  int n_positions, n_tails;
+  guint i;
+  int j;
+
+  in_place = g_new0 (gboolean, new_stack->len);
+
+  /* Positions are stored off by one so that 0 means "not there" */
+  new_positions = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < new_stack->len; i++)
+    g_hash_table_insert (new_positions,
+                         GUINT_TO_POINTER (g_array_index (new_stack, Window, i)),
+                         GINT_TO_POINTER (i + 1));
+
+  /* Windows that are gone from the new stack don't matter */
+  positions = g_new (int, old_stack->len);
+  n_positions = 0;
+  for (i = 0; i < old_stack->len; i++)
+    {
+      int pos = GPOINTER_TO_INT (g_hash_table_lookup (new_positions,
+                                                      GUINT_TO_POINTER (g_array_index (old_stack, Window, i))));
+      if (pos > 0)
+        positions[n_positions++] = pos - 1;
+    }
+
+  g_hash_table_destroy (new_positions);
+
+  /* tails[k] is the index in positions of the smallest last element
+   * of an increasing run of length k + 1; prev links the runs back.
+   */
+  tails = g_new (int, MAX (n_positions, 1));
+  prev = g_new (int, MAX (n_positions, 1));
+  n_tails = 0;
+
+  for (j = 0; j < n_positions; j++)
+    {
+      int lo = 0, hi = n_tails;
+
+      while (lo < hi)
+        {
+          int mid = (lo + hi) / 2;
+
+          if (positions[tails[mid]] < positions[j])
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+
+      prev[j] = lo > 0 ? tails[lo - 1] : -1;
+      tails[lo] = j;
+      if (lo == n_tails)
+        n_tails++;
+    }
+
+  for (j = n_tails > 0 ? tails[n_tails - 1] : -1; j >= 0; j = prev[j])
+    in_place[positions[j]] = TRUE;
+
+  free (positions);
+  free (tails);
+  free (prev);
+
+  return in_place;
+}
+
 /*
  * Order the windows on the X server to be the same as in our structure.
  * We do this using XRestackWindows if we don't know the previous order,
@@ -1201,96 +1551,66 @@ stack_sync_to_server (MetaStack *stack)
     }
   else if (root_children_stacked->len > 0)
     {
-      /* Try to do minimal window moves to get the stack in order */
+      /* Try to do minimal window moves to get the stack in order:
+       * the windows in the longest run that is already in the right
+       * relative order stay where they are, and only the others are
+       * moved.
+       */
       /* A point of note: these arrays include frames not client windows,
        * so if a client window has changed frame since last_root_children_stacked
        * was saved, then we may have inefficiency, but I don't think things
        * break...
        */
-      const Window *old_stack = (Window *) stack->last_root_children_stacked->data;
       const Window *new_stack = (Window *) root_children_stacked->data;
-      const int old_len = stack->last_root_children_stacked->len;
       const int new_len = root_children_stacked->len;
-      const Window *oldp = old_stack;
-      const Window *newp = new_stack;
-      const Window *old_end = old_stack + old_len;
-      const Window *new_end = new_stack + new_len;
+      gboolean *in_place;
       Window last_window = None;
+      int i;
+
+      in_place = find_windows_in_place (stack->last_root_children_stacked,
+                                        root_children_stacked);
 
-      while (oldp != old_end &&
-             newp != new_end)
+      for (i = 0; i < new_len; i++)
         {
-          if (*oldp == *newp)
+          if (in_place[i])
             {
               /* Stacks are the same here, move on */
-              ++oldp;
-              last_window = *newp;
-              ++newp;
             }
-          else if (meta_display_lookup_x_window (stack->screen->display,
-                                                 *oldp) == NULL)
+          else if (last_window == None)
             {
-              /* *oldp is no longer known to us (probably destroyed),
-               * so we can just skip it
-               */
-              ++oldp;
+              meta_topic (META_DEBUG_STACK, "Using window 0x%lx as topmost (but leaving it in-place)\n", new_stack[i]);
+
+              raise_window_relative_to_managed_windows (stack->screen,
+                                                        new_stack[i]);
             }
           else
             {
-              /* Move *newp below last_window */
-              if (last_window == None)
-                {
-                  meta_topic (META_DEBUG_STACK, "Using window 0x%lx as topmost (but leaving it in-place)\n", *newp);
+              /* This means that if last_window is dead, but not
+               * new_stack[i], then we fail to restack new_stack[i]; but
+               * on unmanaging last_window, we'll fix it up.
+               */
 
-                  raise_window_relative_to_managed_windows (stack->screen,
-                                                            *newp);
-                }
-              else
-                {
-                  /* This means that if last_window is dead, but not
-                   * *newp, then we fail to restack *newp; but on
-                   * unmanaging last_window, we'll fix it up.
-                   */
-
-                  XWindowChanges changes;
-
-                  changes.sibling = last_window;
-                  changes.stack_mode = Below;
-
-                  meta_topic (META_DEBUG_STACK, "Placing window 0x%lx below 0x%lx\n",
-                              *newp, last_window);
-
-                  meta_stack_tracker_record_lower_below (stack->screen->stack_tracker,
-                                                         *newp, last_window,
-                                                         XNextRequest (stack->screen->display->xdisplay));
-                  XConfigureWindow (stack->screen->display->xdisplay,
-                                    *newp,
-                                    CWSibling | CWStackMode,
-                                    &changes);
-                }
+              XWindowChanges changes;
 
-              last_window = *newp;
-              ++newp;
-            }
-        }
+              changes.sibling = last_window;
+              changes.stack_mode = Below;
 
-      if (newp != new_end)
-        {
-          /* Restack remaining windows */
-          meta_topic (META_DEBUG_STACK, "Restacking remaining %d windows\n",
-                        (int) (new_end - newp));
-          /* We need to include an already-stacked window
-           * in the restack call, so we get in the proper position
-           * with respect to it.
-           */
-          if (newp != new_stack)
-            --newp;
-          meta_stack_tracker_record_restack_windows (stack->screen->stack_tracker,
-                                                     (Window *) newp, new_end - newp,
+              meta_topic (META_DEBUG_STACK, "Placing window 0x%lx below 0x%lx\n",
+                          new_stack[i], last_window);
+
+              meta_stack_tracker_record_lower_below (stack->screen->stack_tracker,
+                                                     new_stack[i], last_window,
                                                      XNextRequest (stack->screen->display->xdisplay));
-          XRestackWindows (stack->screen->display->xdisplay,
-                           (Window *) newp, new_end - newp);
+              XConfigureWindow (stack->screen->display->xdisplay,
+                                new_stack[i],
+                                CWSibling | CWStackMode,
+                                &changes);
+            }
+
+          last_window = new_stack[i];
         }
+
+      free (in_place);
     }
 
   /* Push hidden windows to the bottom of the stack under the guard window */
@@ -1313,24 +1633,45 @@ stack_sync_to_server (MetaStack *stack)
    * and we'll fix stacking at that time.
    */
 
-  /* Sync _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING */
-
-  XChangeProperty (stack->screen->display->xdisplay,
-                   stack->screen->xroot,
-                   stack->screen->display->atom__NET_CLIENT_LIST,
-                   XA_WINDOW,
-                   32, PropModeReplace,
-                   (unsigned char *)stack->windows->data,
-                   stack->windows->len);
-  XChangeProperty (stack->screen->display->xdisplay,
-                   stack->screen->xroot,
-                   stack->screen->display->atom__NET_CLIENT_LIST_STACKING,
-                   XA_WINDOW,
-                   32, PropModeReplace,
-                   (unsigned char *)stacked->data,
-                   stacked->len);
-
-  g_array_free (stacked, TRUE);
+  /* Sync _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING; pagers
+   * redraw on every write, so leave them alone if nothing changed.
+   */
+
+  if (!window_arrays_equal (stack->last_client_list, stack->windows))
+    {
+      XChangeProperty (stack->screen->display->xdisplay,
+                       stack->screen->xroot,
+                       stack->screen->display->atom__NET_CLIENT_LIST,
+                       XA_WINDOW,
+                       32, PropModeReplace,
+                       (unsigned char *)stack->windows->data,
+                       stack->windows->len);
+
+      if (stack->last_client_list == NULL)
+        stack->last_client_list = g_array_new (FALSE, FALSE, sizeof (Window));
+      g_array_set_size (stack->last_client_list, stack->windows->len);
+      memcpy (stack->last_client_list->data, stack->windows->data,
+              stack->windows->len * sizeof (Window));
+    }
+
+  if (!window_arrays_equal (stack->last_client_list_stacking, stacked))
+    {
+      XChangeProperty (stack->screen->display->xdisplay,
+                       stack->screen->xroot,
+                       stack->screen->display->atom__NET_CLIENT_LIST_STACKING,
+                       XA_WINDOW,
+                       32, PropModeReplace,
+                       (unsigned char *)stacked->data,
+                       stacked->len);
+
+      if (stack->last_client_list_stacking)
+        g_array_free (stack->last_client_list_stacking, TRUE);
+      stack->last_client_list_stacking = stacked;
+    }
+  else
+    {
+      g_array_free (stacked, TRUE);
+    }
 
   if (stack->last_root_children_stacked)
     g_array_free (stack->last_root_children_stacked, TRUE);
@@ -1415,6 +1756,123 @@ meta_stack_get_below (MetaStack      *stack,
     return below;
 }
 
+/* Side of a (square) cell of the hit-testing grid, in pixels.  Big enough
+ * that a typical window only touches a few dozen cells, small enough that a
+ * cell rarely holds more than a handful of windows.
+ */
+#define HIT_INDEX_CELL_SIZE 128
+
+static void
+free_hit_index (MetaStack *stack)
+{
+  int i;
+
+  if (stack->hit_index == NULL)
+    return;
+
+  for (i = 0; i < stack->hit_index_columns * stack->hit_index_rows; i++)
+    g_ptr_array_free (stack->hit_index[i], TRUE);
+
+  g_free (stack->hit_index);
+  stack->hit_index = NULL;
+  stack->hit_index_columns = 0;
+  stack->hit_index_rows = 0;
+  stack->hit_index_valid = FALSE;
+}
+
+LOCAL_SYMBOL void
+meta_stack_invalidate_hit_index (MetaStack *stack)
+{
+  stack->hit_index_valid = FALSE;
+}
+
+/* Brings stack->hit_index up to date with stack->sorted, which must
+ * already be sorted.
+ */
+static void
+ensure_hit_index (MetaStack *stack)
+{
+  const MetaRectangle *screen_rect = &stack->screen->rect;
+  int columns, rows, i;
+  GList *link;
+
+  columns = MAX (1, (screen_rect->width + HIT_INDEX_CELL_SIZE - 1) /
+                    HIT_INDEX_CELL_SIZE);
+  rows = MAX (1, (screen_rect->height + HIT_INDEX_CELL_SIZE - 1) /
+                 HIT_INDEX_CELL_SIZE);
+
+  if (stack->hit_index_valid &&
+      stack->hit_index_columns == columns &&
+      stack->hit_index_rows == rows)
+    return;
+
+  if (stack->hit_index_columns != columns ||
+      stack->hit_index_rows != rows)
+    {
+      free_hit_index (stack);
+
+      stack->hit_index = g_new (GPtrArray *, columns * rows);
+      for (i = 0; i < columns * rows; i++)
+        stack->hit_index[i] = g_ptr_array_new ();
+
+      stack->hit_index_columns = columns;
+      stack->hit_index_rows = rows;
+    }
+  else
+    {
+      for (i = 0; i < columns * rows; i++)
+        g_ptr_array_set_size (stack->hit_index[i], 0);
+    }
+
+  meta_topic (META_DEBUG_STACK,
+              "Rebuilding %dx%d hit-testing grid\n", columns, rows);
+
+  /* top of this layer is at the front of the list, so every cell
+   * ends up topmost first
+   */
+  for (link = stack->sorted; link; link = link->next)
+    {
+      MetaWindow *window = link->data;
+      MetaRectangle rect, visible;
+      int x1, y1, x2, y2, x, y;
+
+      meta_window_get_outer_rect (window, &rect);
+      if (!meta_rectangle_intersect (&rect, screen_rect, &visible))
+        continue;
+
+      x1 = (visible.x - screen_rect->x) / HIT_INDEX_CELL_SIZE;
+      y1 = (visible.y - screen_rect->y) / HIT_INDEX_CELL_SIZE;
+      x2 = (visible.x + visible.width - 1 - screen_rect->x) / HIT_INDEX_CELL_SIZE;
+      y2 = (visible.y + visible.height - 1 - screen_rect->y) / HIT_INDEX_CELL_SIZE;
+
+      for (y = y1; y <= y2; y++)
+        for (x = x1; x <= x2; x++)
+          g_ptr_array_add (stack->hit_index[y * columns + x], window);
+    }
+
+  stack->hit_index_valid = TRUE;
+}
+
+/* Returns the windows whose outer rectangle may contain the given point,
+ * topmost first, or %NULL if the point is off the screen.
+ */
+static GPtrArray *
+get_windows_near_point (MetaStack *stack,
+                        int        root_x,
+                        int        root_y)
+{
+  const MetaRectangle *screen_rect = &stack->screen->rect;
+
+  if (!META_POINT_IN_RECT (root_x, root_y, *screen_rect))
+    return NULL;
+
+  ensure_hit_index (stack);
+
+  return stack->hit_index[((root_y - screen_rect->y) / HIT_INDEX_CELL_SIZE) *
+                          stack->hit_index_columns +
+                          (root_x - screen_rect->x) / HIT_INDEX_CELL_SIZE];
+}
+
 static gboolean
 window_contains_point (MetaWindow *window,
                        int         root_x,
@@ -1427,6 +1885,20 @@ window_contains_point (MetaWindow *window,
   return META_POINT_IN_RECT (root_x, root_y, rect);
 }
 
+static gboolean
+window_can_take_default_focus (MetaWindow    *window,
+                               MetaWorkspace *workspace,
+                               MetaWindow    *not_this_one)
+{
+  return (window &&
+          window != not_this_one &&
+          (window->unmaps_pending == 0) &&
+          !window->minimized &&
+          (window->input || window->take_focus) &&
+          (workspace == NULL ||
+           meta_window_located_on_workspace (window, workspace)));
+}
+
 static MetaWindow*
 get_default_focus_window (MetaStack     *stack,
                           MetaWorkspace *workspace,
@@ -1459,6 +1931,52 @@ get_default_focus_window (MetaStack     *stack,
 
   stack_ensure_sorted (stack);
 
+  if (must_be_at_point)
+    {
+      GPtrArray *nearby;
+      guint i;
+
+      /* Every window containing the point is in the point's cell, in
+       * stacking order, so the candidates that must be under the pointer
+       * can be picked from there alone.  Only the dock fallback, which
+       * ignores the pointer, needs the full walk below.
+       */
+      nearby = get_windows_near_point (stack, root_x, root_y);
+
+      for (i = 0; nearby != NULL && i < nearby->len; i++)
+        {
+          MetaWindow *window = g_ptr_array_index (nearby, i);
+
+          if (!window_can_take_default_focus (window, workspace, not_this_one) ||
+              !window_contains_point (window, root_x, root_y))
+            continue;
+
+          if (not_this_one != NULL)
+            {
+              if (transient_parent == NULL &&
+                  not_this_one->xtransient_for != None &&
+                  not_this_one->xtransient_for == window->xwindow)
+                transient_parent = window;
+
+              if (topmost_in_group == NULL &&
+                  not_this_one_group != NULL &&
+                  not_this_one_group == meta_window_get_group (window))
+                topmost_in_group = window;
+            }
+
+          if (topmost_overall == NULL &&
+              window->type != META_WINDOW_DOCK)
+            topmost_overall = window;
+        }
+
+      if (transient_parent)
+        return transient_parent;
+      else if (topmost_in_group)
+        return topmost_in_group;
+      else if (topmost_overall)
+        return topmost_overall;
+    }
+
   /* top of this layer is at the front of the list */
   link = stack->sorted;
 
@@ -1466,13 +1984,7 @@ get_default_focus_window (MetaStack     *stack,
     {
       MetaWindow *window = link->data;
 
-      if (window &&
-          window != not_this_one &&
-          (window->unmaps_pending == 0) &&
-          !window->minimized &&
-          (window->input || window->take_focus) &&
-          (workspace == NULL ||
-           meta_window_located_on_workspace (window, workspace)))
+      if (window_can_take_default_focus (window, workspace, not_this_one))
         {
           if (topmost_dock == NULL &&
               window->type == META_WINDOW_DOCK)
@@ -1679,6 +2191,7 @@ meta_stack_set_positions (MetaStack *stack,
 
   g_list_free (stack->sorted);
   stack->sorted = g_list_copy (windows);
+  stack->hit_index_valid = FALSE;
 
   stack->need_resort = TRUE;
   stack->need_constrain = TRUE;
@@ -1718,8 +2231,9 @@ meta_window_set_stack_position_no_sync (MetaWindow *window,
       return;
     }
 
-  window->screen->stack->need_resort = TRUE;
-  window->screen->stack->need_constrain = TRUE;
+  queue_window_once (&window->screen->stack->resort_pending, window);
+  if (!window->screen->stack->need_constrain)
+    queue_window_once (&window->screen->stack->constrain_pending, window);
 
   if (position < window->stack_position)
     {
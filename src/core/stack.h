@@ -100,26 +100,69 @@ struct _MetaStack
    */
   GArray *last_root_children_stacked;
 
+  /**
+   * The last values we set _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING
+   * to, so that we only rewrite them when they change.
+   */
+  GArray *last_client_list;
+  GArray *last_client_list_stacking;
+
   /**
    * Number of stack positions; same as the length of added, but
    * kept for quick reference.
    */
   gint n_positions;
 
-  /** Is the stack in need of re-sorting? */
+  /**
+   * Does the whole stack need re-sorting?  Set when some window changed
+   * layer; windows that merely changed stack_position go in resort_pending.
+   */
   unsigned int need_resort : 1;
 
   /**
-   * Are the windows in the stack in need of having their
+   * Are all the windows in the stack in need of having their
    * layers recalculated?
    */
   unsigned int need_relayer : 1;
 
   /**
-   * Are the windows in the stack in need of having their positions
+   * Are all the windows in the stack in need of having their positions
    * recalculated with respect to transiency (parent and child windows)?
    */
   unsigned int need_constrain : 1;
+
+  /**
+   * Windows whose layer needs recalculating, when need_relayer is not set.
+   */
+  GList *relayer_pending;
+
+  /**
+   * Windows whose transiency constraints need reapplying, when
+   * need_constrain is not set.  Only these windows and those related to
+   * them by transiency or group are re-solved.
+   */
+  GList *constrain_pending;
+
+  /**
+   * Windows whose place in "sorted" is stale because their stack_position
+   * changed.  They are re-inserted individually rather than re-sorting
+   * the whole list, unless need_resort is set.
+   */
+  GList *resort_pending;
+
+  /**
+   * A coarse grid over the screen, used to answer "which windows are under
+   * this point" without walking the whole stack.  Each cell holds the
+   * MetaWindows whose outer rectangle touches it, topmost first.  The grid
+   * is rebuilt lazily the next time it is needed after being invalidated
+   * by meta_stack_invalidate_hit_index().
+   */
+  GPtrArray **hit_index;
+  int hit_index_columns;
+  int hit_index_rows;
+
+  /** Does hit_index reflect the current stacking and window geometry? */
+  unsigned int hit_index_valid : 1;
 };
 
 /**
@@ -157,23 +200,23 @@ void       meta_stack_add       (MetaStack      *stack,
 void       meta_stack_remove    (MetaStack      *stack,
                                  MetaWindow     *window);
 /**
- * Recalculates the correct layer for all windows in the stack,
- * and moves them about accordingly.
+ * Recalculates the correct layer for a window in the stack,
+ * and moves it about accordingly.
  *
- * \param window  Dummy parameter
+ * \param window  The window whose layer may have changed, or NULL to
+ *                recalculate the layers of all windows in the stack
  * \param stack   The stack to recalculate
- * \bug What's with the dummy parameter?
  */
 void       meta_stack_update_layer    (MetaStack      *stack,
                                        MetaWindow     *window);
 
 /**
- * Recalculates the correct stacking order for all windows in the stack
- * according to their transience, and moves them about accordingly.
+ * Recalculates the correct stacking order for a window and the windows
+ * related to it according to their transience, and moves them about
+ * accordingly.
  *
- * \param window  Dummy parameter
+ * \param window  The window whose transiency changed
  * \param stack   The stack to recalculate
- * \bug What's with the dummy parameter?
  */
 void       meta_stack_update_transient (MetaStack     *stack,
                                         MetaWindow    *window);
@@ -385,4 +428,14 @@ void   meta_stack_set_positions (MetaStack *stack,
 
 void meta_stack_update_window_tile_matches (MetaStack     *stack,
                                             MetaWorkspace *workspace);
+
+/**
+ * Marks the point hit-testing index of the stack as out of date, so that it
+ * is rebuilt before it is next used.  This must be called whenever the
+ * outer rectangle of a window in the stack changes; changes to the stacking
+ * order made through the stack itself invalidate the index automatically.
+ *
+ * \param stack  The stack whose index is out of date
+ */
+void meta_stack_invalidate_hit_index (MetaStack *stack);
 #endif
@@ -0,0 +1,189 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file startup-trace.c  Timeline of Muffin's startup
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#include <config.h>
+#include "startup-trace.h"
+#include <meta/util.h>
+
+#include <string.h>
+#include <unistd.h>
+
+typedef struct
+{
+  const char *name;
+  gint64 start;
+  gint64 end;
+  int depth;
+} TraceStep;
+
+typedef struct
+{
+  char *filename;
+  gint64 start_time;
+
+  /* All steps in the order they began, and the open ones innermost
+   * first */
+  GArray *steps;
+  GSList *open;
+} StartupTrace;
+
+static StartupTrace *trace = NULL;
+
+LOCAL_SYMBOL void
+meta_startup_trace_init (void)
+{
+  const char *filename = g_getenv ("MUFFIN_STARTUP_TRACE");
+
+  if (trace != NULL || filename == NULL || *filename == '\0')
+    return;
+
+  trace = g_new0 (StartupTrace, 1);
+  trace->filename = g_strdup (filename);
+  trace->start_time = g_get_monotonic_time ();
+  trace->steps = g_array_new (FALSE, FALSE, sizeof (TraceStep));
+}
+
+LOCAL_SYMBOL gboolean
+meta_startup_trace_enabled (void)
+{
+  return trace != NULL;
+}
+
+LOCAL_SYMBOL void
+meta_startup_trace_begin (const char *name)
+{
+  TraceStep step;
+
+  if (G_LIKELY (trace == NULL))
+    return;
+
+  step.name = name;
+  step.start = g_get_monotonic_time ();
+  step.end = -1;
+  step.depth = g_slist_length (trace->open);
+
+  g_array_append_val (trace->steps, step);
+  trace->open = g_slist_prepend (trace->open,
+                                 GUINT_TO_POINTER (trace->steps->len - 1));
+}
+
+LOCAL_SYMBOL void
+meta_startup_trace_end (const char *name)
+{
+  TraceStep *step;
+
+  if (G_LIKELY (trace == NULL))
+    return;
+
+  if (trace->open == NULL)
+    {
+      meta_warning ("Startup step \"%s\" ended but never began\n", name);
+      return;
+    }
+
+  step = &g_array_index (trace->steps, TraceStep,
+                         GPOINTER_TO_UINT (trace->open->data));
+  if (strcmp (step->name, name) != 0)
+    meta_warning ("Startup step \"%s\" ended inside \"%s\"\n",
+                  name, step->name);
+
+  step->end = g_get_monotonic_time ();
+  trace->open = g_slist_delete_link (trace->open, trace->open);
+}
+
+static void
+write_json_string (GString    *out,
+                   const char *str)
+{
+  g_string_append_c (out, '"');
+  for (; *str; str++)
+    {
+      if (*str == '"' || *str == '\\')
+        g_string_append_c (out, '\\');
+      g_string_append_c (out, *str);
+    }
+  g_string_append_c (out, '"');
+}
+
+LOCAL_SYMBOL void
+meta_startup_trace_finish (void)
+{
+  GString *out;
+  GError *error = NULL;
+  gint64 now;
+  guint i;
+  int pid;
+
+  if (G_LIKELY (trace == NULL))
+    return;
+
+  now = g_get_monotonic_time ();
+  pid = getpid ();
+
+  out = g_string_new ("{\n  \"traceEvents\": [\n");
+
+  for (i = 0; i < trace->steps->len; i++)
+    {
+      TraceStep *step = &g_array_index (trace->steps, TraceStep, i);
+      gint64 end = step->end >= 0 ? step->end : now;
+
+      g_string_append (out, "    { \"name\": ");
+      write_json_string (out, step->name);
+      g_string_append_printf (out,
+                              ", \"ph\": \"X\", \"pid\": %d, \"tid\": %d"
+                              ", \"ts\": %" G_GINT64_FORMAT
+                              ", \"dur\": %" G_GINT64_FORMAT
+                              ", \"args\": { \"depth\": %d } },\n",
+                              pid, pid,
+                              step->start - trace->start_time,
+                              end - step->start,
+                              step->depth);
+    }
+
+  /* The whole of startup, which also gives the array an element
+   * without a trailing comma */
+  g_string_append_printf (out,
+                          "    { \"name\": \"startup\", \"ph\": \"X\""
+                          ", \"pid\": %d, \"tid\": %d, \"ts\": 0"
+                          ", \"dur\": %" G_GINT64_FORMAT " }\n"
+                          "  ],\n"
+                          "  \"displayTimeUnit\": \"ms\",\n"
+                          "  \"otherData\": { \"monotonic_start_us\": %"
+                          G_GINT64_FORMAT " }\n}\n",
+                          pid, pid, now - trace->start_time,
+                          trace->start_time);
+
+  if (!g_file_set_contents (trace->filename, out->str, out->len, &error))
+    {
+      meta_warning ("Could not write the startup trace: %s\n", error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (out, TRUE);
+
+  g_slist_free (trace->open);
+  g_array_free (trace->steps, TRUE);
+  g_free (trace->filename);
+  g_free (trace);
+  trace = NULL;
+}
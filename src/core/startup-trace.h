@@ -0,0 +1,46 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file startup-trace.h  Timeline of Muffin's startup
+ *
+ * When MUFFIN_STARTUP_TRACE names a file, the steps of startup from
+ * meta_init() to the first frame on screen are timed and written to
+ * it, once that frame has been swapped, in the Trace Event format
+ * that chrome://tracing and Perfetto load. The steps can nest. Until
+ * meta_startup_trace_init() has found the variable set, and after the
+ * file is written, every entry point does nothing.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#ifndef META_STARTUP_TRACE_H
+#define META_STARTUP_TRACE_H
+
+#include <glib.h>
+
+void     meta_startup_trace_init     (void);
+gboolean meta_startup_trace_enabled  (void);
+
+/* @name must be a string literal, or otherwise outlive the trace */
+void     meta_startup_trace_begin    (const char *name);
+void     meta_startup_trace_end      (const char *name);
+
+/* Ends any open steps and writes the file */
+void     meta_startup_trace_finish   (void);
+
+#endif
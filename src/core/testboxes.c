@@ -25,6 +25,7 @@
 #include <glib.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <X11/Xutil.h> /* Just for the definition of the various gravities */
 #include <time.h>      /* To initialize random seed */
 
@@ -1380,9 +1381,52 @@ test_find_closest_point_to_line ()
   printf ("%s passed.\n", G_STRFUNC);
 }
 
+#define NUM_BENCHMARK_RUNS 100000
+
+/* Times the work area computation for each of the test strut lists;
+ * run with --benchmark
+ */
+static void
+benchmark_regions ()
+{
+  MetaRectangle basic_rect = meta_rect (0, 0, 1600, 1200);
+  int which;
+
+  for (which = 0; which <= 6; which++)
+    {
+      GSList *struts = get_strut_list (which);
+      gint64 start, elapsed;
+      int i;
+
+      start = g_get_monotonic_time ();
+      for (i = 0; i < NUM_BENCHMARK_RUNS; i++)
+        {
+          GList *region, *edges;
+
+          region = meta_rectangle_get_minimal_spanning_set_for_region (&basic_rect,
+                                                                       struts);
+          edges = meta_rectangle_find_onscreen_edges (&basic_rect, struts);
+          meta_rectangle_free_list_and_elements (region);
+          meta_rectangle_free_list_and_elements (edges);
+        }
+      elapsed = g_get_monotonic_time () - start;
+
+      printf ("Strut list %d: %.3f us per work area\n",
+              which, (double) elapsed / NUM_BENCHMARK_RUNS);
+
+      free_strut_list (struts);
+    }
+}
+
 int
-main()
+main (int argc, char **argv)
 {
+  if (argc > 1 && strcmp (argv[1], "--benchmark") == 0)
+    {
+      benchmark_regions ();
+      return 0;
+    }
+
   init_random_ness ();
   test_area ();
   test_intersect ();
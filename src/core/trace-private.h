@@ -0,0 +1,45 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Muffin static tracepoints */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_TRACE_PRIVATE_H
+#define META_TRACE_PRIVATE_H
+
+/* USDT probes in the "muffin" provider, built whenever <sys/sdt.h> is
+ * available. Once "perf buildid-cache --add" has seen the binary they
+ * show up in "perf list sdt_muffin:*". */
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define META_TRACE(probe) DTRACE_PROBE (muffin, probe)
+#define META_TRACE1(probe, a) DTRACE_PROBE1 (muffin, probe, a)
+#define META_TRACE2(probe, a, b) DTRACE_PROBE2 (muffin, probe, a, b)
+
+#else
+
+#define META_TRACE(probe) G_STMT_START { } G_STMT_END
+#define META_TRACE1(probe, a) G_STMT_START { } G_STMT_END
+#define META_TRACE2(probe, a, b) G_STMT_START { } G_STMT_END
+
+#endif
+
+#endif /* META_TRACE_PRIVATE_H */
@@ -31,6 +31,8 @@
 void     meta_set_verbose (gboolean setting);
 void     meta_set_debugging (gboolean setting);
 void     meta_set_syncing (gboolean setting);
+void     meta_set_profiling_requests (gboolean setting);
+gboolean meta_is_profiling_requests (void);
 void     meta_set_replace_current_wm (gboolean setting);
 
 #endif
@@ -372,6 +372,8 @@ topic_name (MetaDebugTopic topic)
       return "COMPOSITOR";
     case META_DEBUG_EDGE_RESISTANCE:
       return "EDGE_RESISTANCE";
+    case META_DEBUG_ROUND_TRIPS:
+      return "ROUND_TRIPS";
     case META_DEBUG_VERBOSE:
       return "VERBOSE";
     default:
@@ -742,9 +744,17 @@ typedef struct
   gboolean run_once;
 } MetaLater;
 
-static GSList *laters = NULL;
-/* This is a dummy timeline used to get the Clutter master clock running */
-static ClutterTimeline *later_timeline;
+/* The laters of each type, in the order they were added. Each queue
+ * holds a reference on its laters, except while run_repaint_laters()
+ * has taken its laters out to run them.
+ */
+static GQueue laters[META_LATER_IDLE + 1];
+static GHashTable *laters_by_id = NULL;
+
+/* A pre-paint repaint function that removes itself after one frame;
+ * it is only added back while there are laters to run, so the master
+ * clock can stop when there are none.
+ */
 static guint later_repaint_func = 0;
 
 static void ensure_later_repaint_func (void);
@@ -775,71 +785,86 @@ destroy_later (MetaLater *later)
   unref_later (later);
 }
 
-/* Used to sort the list of laters with the highest priority
- * functions first.
+/* Whether the later is run from the repaint function; those that also
+ * have an idle source only until the idle has run them once.
  */
-static int
-compare_laters (gconstpointer a,
-                gconstpointer b)
+static gboolean
+later_runs_on_repaint (MetaLater *later)
 {
-  return ((const MetaLater *)a)->when - ((const MetaLater *)b)->when;
+  return later->when <= META_LATER_BEFORE_REDRAW &&
+         (later->source == 0 || !later->run_once);
 }
 
 static gboolean
 run_repaint_laters (gpointer data)
 {
-  GSList *laters_copy;
-  GSList *l;
-  gboolean keep_timeline_running = FALSE;
+  gboolean keep_running = FALSE;
+  int when;
+
+  later_repaint_func = 0;
 
-  laters_copy = NULL;
-  for (l = laters; l; l = l->next)
+  /* Each phase runs what was queued up to when it starts, including
+   * what earlier phases of this frame added
+   */
+  for (when = META_LATER_RESIZE; when <= META_LATER_BEFORE_REDRAW; when++)
     {
-      MetaLater *later = l->data;
-      if (later->source == 0 ||
-          (later->when <= META_LATER_BEFORE_REDRAW && !later->run_once))
+      GList *run, *l;
+
+      run = laters[when].head;
+      g_queue_init (&laters[when]);
+
+      for (l = run; l; l = l->next)
         {
-          later->ref_count++;
-          laters_copy = g_slist_prepend (laters_copy, later);
+          MetaLater *later = l->data;
+
+          if (later->func && later_runs_on_repaint (later) &&
+              !later->func (later->data))
+            {
+              /* Unless it removed itself already */
+              if (later->func)
+                g_hash_table_remove (laters_by_id, GUINT_TO_POINTER (later->id));
+              destroy_later (later);
+            }
+          else if (later->func == NULL)
+            unref_later (later);
+          else
+            g_queue_push_tail (&laters[when], later);
         }
+
+      g_list_free (run);
     }
-  laters_copy = g_slist_reverse (laters_copy);
 
-  for (l = laters_copy; l; l = l->next)
+  for (when = META_LATER_RESIZE; when <= META_LATER_BEFORE_REDRAW; when++)
     {
-      MetaLater *later = l->data;
+      GList *l;
 
-      if (later->func && later->func (later->data))
+      for (l = laters[when].head; l && !keep_running; l = l->next)
         {
+          MetaLater *later = l->data;
+
           if (later->source == 0)
-            keep_timeline_running = TRUE;
+            keep_running = TRUE;
         }
-      else
-        meta_later_remove (later->id);
-      unref_later (later);
     }
 
-  if (!keep_timeline_running)
-    clutter_timeline_stop (later_timeline);
-
-  g_slist_free (laters_copy);
+  if (keep_running)
+    ensure_later_repaint_func ();
 
-  /* Just keep the repaint func around - it's cheap if the list is empty */
-  return TRUE;
+  return FALSE;
 }
 
 static void
 ensure_later_repaint_func (void)
 {
-  if (!later_timeline)
-    later_timeline = clutter_timeline_new (G_MAXUINT);
-
+  /* Adding the function makes the master clock run another frame, but
+   * by itself doesn't make the stage redraw
+   */
   if (later_repaint_func == 0)
-    later_repaint_func = clutter_threads_add_repaint_func (run_repaint_laters,
-                                                           NULL, NULL);
-
-  /* Make sure the repaint function gets run */
-  clutter_timeline_start (later_timeline);
+    later_repaint_func =
+      clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_PRE_PAINT |
+                                             CLUTTER_REPAINT_FLAGS_QUEUE_REDRAW_ON_ADD,
+                                             run_repaint_laters,
+                                             NULL, NULL);
 }
 
 static gboolean
@@ -882,8 +907,11 @@ meta_later_add (MetaLaterType  when,
                 gpointer       data,
                 GDestroyNotify notify)
 {
-  MetaLater *later = g_slice_new0 (MetaLater);
+  MetaLater *later;
+
+  g_return_val_if_fail (when <= META_LATER_IDLE, 0);
 
+  later = g_slice_new0 (MetaLater);
   later->id = ++last_later_id;
   later->ref_count = 1;
   later->when = when;
@@ -891,7 +919,11 @@ meta_later_add (MetaLaterType  when,
   later->data = data;
   later->notify = notify;
 
-  laters = g_slist_insert_sorted (laters, later, compare_laters);
+  if (laters_by_id == NULL)
+    laters_by_id = g_hash_table_new (NULL, NULL);
+
+  g_queue_push_tail (&laters[when], later);
+  g_hash_table_insert (laters_by_id, GUINT_TO_POINTER (later->id), later);
 
   switch (when)
     {
@@ -933,20 +965,28 @@ meta_later_add (MetaLaterType  when,
 void
 meta_later_remove (guint later_id)
 {
-  GSList *l;
+  MetaLater *later;
+
+  if (laters_by_id == NULL)
+    return;
 
-  for (l = laters; l; l = l->next)
+  later = g_hash_table_lookup (laters_by_id, GUINT_TO_POINTER (later_id));
+  if (later == NULL)
+    return;
+
+  g_hash_table_remove (laters_by_id, GUINT_TO_POINTER (later_id));
+
+  if (g_queue_remove (&laters[later->when], later))
+    destroy_later (later);
+  else
     {
-      MetaLater *later = l->data;
-      if (later->id == later_id)
+      /* run_repaint_laters() has it and drops it when it gets to it */
+      if (later->source)
         {
-          laters = g_slist_delete_link (laters, l);
-          /* If this was a "repaint func" later, we just let the
-           * repaint func run and get removed
-           */
-          destroy_later (later);
-          return;
+          g_source_remove (later->source);
+          later->source = 0;
         }
+      later->func = NULL;
     }
 }
 
@@ -0,0 +1,203 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "wakeup-audit.h"
+
+#define REPORT_SOURCE_NAME "[muffin] report_wakeups"
+
+static GPollFunc real_poll = NULL;
+static int x_fd = -1;
+
+/* Cause -> number of wakeups it took part in since the last report;
+ * one wakeup can have several causes */
+static GHashTable *wakeups = NULL;
+static guint n_wakeups = 0;
+
+static void
+count_wakeup (const char *cause)
+{
+  guint n = GPOINTER_TO_UINT (g_hash_table_lookup (wakeups, cause));
+
+  g_hash_table_replace (wakeups, g_strdup (cause), GUINT_TO_POINTER (n + 1));
+}
+
+/* GLib doesn't say which timeout woke the loop, but since 2.36 timeouts
+ * keep their expiration as their ready time, so the expired ones can be
+ * found. Source ids are handed out in sequence; attaching a source
+ * tells how far they go. That makes this slow in a long session, which
+ * is fine for a debugging aid.
+ *
+ * Returns FALSE if the report was all that woke us.
+ */
+static gboolean
+count_expired_sources (void)
+{
+  GMainContext *context = g_main_context_default ();
+  GSource *probe;
+  gint64 now;
+  guint id, last_id;
+  gboolean found = FALSE, reported = FALSE;
+
+  probe = g_idle_source_new ();
+  last_id = g_source_attach (probe, context);
+  g_source_destroy (probe);
+  g_source_unref (probe);
+
+  now = g_get_monotonic_time ();
+
+  for (id = 1; id < last_id; id++)
+    {
+      GSource *source = g_main_context_find_source_by_id (context, id);
+      const char *name;
+      gint64 ready_time;
+
+      if (source == NULL)
+        continue;
+
+      ready_time = g_source_get_ready_time (source);
+      if (ready_time < 0 || ready_time > now)
+        continue;
+
+      name = g_source_get_name (source);
+      if (name && strcmp (name, REPORT_SOURCE_NAME) == 0)
+        {
+          reported = TRUE;
+          continue;
+        }
+
+      count_wakeup (name ? name : "unnamed timeout");
+      found = TRUE;
+    }
+
+  /* The clutter master clock and GDK's frame clock work out their
+   * timeouts when polled, without a ready time */
+  if (!found && !reported)
+    count_wakeup ("other timeout (e.g. the master clock)");
+
+  return found || !reported;
+}
+
+static gint
+audit_poll (GPollFD *ufds,
+            guint    nfds,
+            gint     timeout)
+{
+  gboolean x_events = FALSE;
+  gint ret;
+  guint i;
+
+  ret = real_poll (ufds, nfds, timeout);
+
+  /* With nothing to wait for the loop was awake already */
+  if (timeout == 0 || ret < 0)
+    return ret;
+
+  if (ret == 0)
+    {
+      if (count_expired_sources ())
+        n_wakeups++;
+      return ret;
+    }
+
+  n_wakeups++;
+
+  for (i = 0; i < nfds; i++)
+    {
+      char *cause;
+
+      if (ufds[i].revents == 0)
+        continue;
+
+      /* Both GDK and Clutter poll the X connection */
+      if (ufds[i].fd == x_fd)
+        {
+          if (!x_events)
+            count_wakeup ("X events");
+          x_events = TRUE;
+          continue;
+        }
+
+      cause = g_strdup_printf ("file descriptor %d", ufds[i].fd);
+      count_wakeup (cause);
+      g_free (cause);
+    }
+
+  return ret;
+}
+
+static int
+compare_counts (gconstpointer a,
+                gconstpointer b,
+                gpointer      user_data)
+{
+  GHashTable *counts = user_data;
+
+  return GPOINTER_TO_UINT (g_hash_table_lookup (counts, b)) -
+         GPOINTER_TO_UINT (g_hash_table_lookup (counts, a));
+}
+
+static gboolean
+report_wakeups (gpointer data)
+{
+  GList *causes, *l;
+
+  if (n_wakeups == 0)
+    return G_SOURCE_CONTINUE;
+
+  g_printerr ("%u wakeups:\n", n_wakeups);
+
+  causes = g_hash_table_get_keys (wakeups);
+  causes = g_list_sort_with_data (causes, compare_counts, wakeups);
+  for (l = causes; l; l = l->next)
+    g_printerr ("  %6u %s\n",
+                GPOINTER_TO_UINT (g_hash_table_lookup (wakeups, l->data)),
+                (const char *) l->data);
+  g_list_free (causes);
+
+  g_hash_table_remove_all (wakeups);
+  n_wakeups = 0;
+
+  return G_SOURCE_CONTINUE;
+}
+
+LOCAL_SYMBOL void
+meta_wakeup_audit_init (Display *xdisplay)
+{
+  const char *env = g_getenv ("MUFFIN_DEBUG_WAKEUPS");
+  GMainContext *context = g_main_context_default ();
+  gint64 period;
+  guint id;
+
+  if (env == NULL || real_poll != NULL)
+    return;
+
+  period = g_ascii_strtoll (env, NULL, 10);
+
+  x_fd = ConnectionNumber (xdisplay);
+  wakeups = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  real_poll = g_main_context_get_poll_func (context);
+  g_main_context_set_poll_func (context, audit_poll);
+
+  id = g_timeout_add_seconds (period > 0 ? period : 10, report_wakeups, NULL);
+  g_source_set_name_by_id (id, REPORT_SOURCE_NAME);
+}
@@ -0,0 +1,39 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file wakeup-audit.h  Tells what keeps waking Muffin up
+ *
+ * When MUFFIN_DEBUG_WAKEUPS is set, every time the main loop wakes up
+ * from waiting is put down to its cause: X events, another file
+ * descriptor, or the timeouts that expired, by their source names.
+ * A summary is printed every MUFFIN_DEBUG_WAKEUPS seconds (ten by
+ * default). On an idle desktop it should stay empty.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#ifndef META_WAKEUP_AUDIT_H
+#define META_WAKEUP_AUDIT_H
+
+#include <X11/Xlib.h>
+#include <glib.h>
+
+/* Does nothing unless MUFFIN_DEBUG_WAKEUPS is set */
+void meta_wakeup_audit_init (Display *xdisplay);
+
+#endif
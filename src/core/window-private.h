@@ -55,8 +55,9 @@ typedef enum {
 } MetaClientType;
 
 typedef enum {
-  META_QUEUE_CALC_SHOWING = 1 << 0,
-  META_QUEUE_MOVE_RESIZE  = 1 << 1
+  META_QUEUE_CALC_SHOWING     = 1 << 0,
+  META_QUEUE_MOVE_RESIZE      = 1 << 1,
+  META_QUEUE_RELOAD_PROPERTIES = 1 << 2
 } MetaQueueType;
 
 /* edge zones for tiling/snapping identification
@@ -89,7 +90,7 @@ enum {
     ZONE_NONE
 };
 
-#define NUMBER_OF_QUEUES 2
+#define NUMBER_OF_QUEUES 3
 
 #define HUD_WIDTH 24
 #define CSD_TITLEBAR_HEIGHT 48
@@ -107,6 +108,18 @@ typedef enum
   META_EDGE_CONSTRAINT_MONITOR = 2,
 } MetaEdgeConstraint;
 
+/* The GApplication properties of the window, which most windows
+ * don't set; allocated the first time one of them is */
+typedef struct
+{
+  char *application_id;
+  char *unique_bus_name;
+  char *application_object_path;
+  char *window_object_path;
+  char *app_menu_object_path;
+  char *menubar_object_path;
+} MetaWindowGtkInfo;
+
 struct _MetaWindow
 {
   GObject parent_instance;
@@ -135,6 +148,8 @@ struct _MetaWindow
   GdkPixbuf *icon;
   MetaIconCache icon_cache;
   int icon_size;
+  /* Icons created by meta_window_create_icon(), keyed by size */
+  GHashTable *icons_by_size;
 
   Pixmap wm_hints_pixmap;
   Pixmap wm_hints_mask;
@@ -144,22 +159,21 @@ struct _MetaWindow
   
   /* NOTE these five are not in UTF-8, we just treat them as random
    * binary data
+   *
+   * The class, name and client machine are shared by many windows,
+   * so they are interned with g_intern_string() and never freed.
    */
-  char *res_class;
-  char *res_name;
+  const char *res_class;
+  const char *res_name;
   char *role;
   char *sm_client_id;
-  char *wm_client_machine;
+  const char *wm_client_machine;
 
   char *startup_id;
   char *muffin_hints;
   char *gtk_theme_variant;
-  char *gtk_application_id;
-  char *gtk_unique_bus_name;
-  char *gtk_application_object_path;
-  char *gtk_window_object_path;
-  char *gtk_app_menu_object_path;
-  char *gtk_menubar_object_path;
+  /* may be NULL! */
+  MetaWindowGtkInfo *gtk;
   
   int hide_titlebar_when_maximized;
   int net_wm_pid;
@@ -177,6 +191,12 @@ struct _MetaWindow
   /* Whether this is an override redirect window or not */
   guint override_redirect : 1;
 
+  /* Whether EnterNotify and LeaveNotify are selected on the client */
+  guint crossing_events_selected : 1;
+
+  /* Whether the window is ours and so keeps the input it selected */
+  guint keeps_own_input : 1;
+
   /* Whether we're maximized */
   guint maximized_horizontally : 1;
   guint maximized_vertically : 1;
@@ -410,16 +430,28 @@ struct _MetaWindow
   /* if TRUE, window is attached to its parent */
   guint attached : 1;
 
+  /* if TRUE, window is queued for geometry-changed, see
+   * geometry_changed_old_rect */
+  guint geometry_changed_pending : 1;
+
   /* if non-NULL, the bounds of the window frame */
   cairo_region_t *frame_bounds;
 
   /* if non-NULL, the opaque region _NET_WM_OPAQUE_REGION */
   cairo_region_t *opaque_region;
 
+  /* Atoms which changed since the last time the RELOAD_PROPERTIES
+   * queue was run, each at most once; NULL if there are none.
+   */
+  GArray *pending_properties;
+
   /* if TRUE, the we have the new form of sync request counter which
    * also handles application frames */
   guint extended_sync_request_counter : 1;
 
+  /* The outer rect as of the last geometry-changed emission */
+  MetaRectangle geometry_changed_old_rect;
+
   /* Note: can be NULL */
   GSList *struts;
 
@@ -442,6 +474,9 @@ struct _MetaWindow
   /* See docs for meta_window_get_stable_sequence() */
   guint32 stable_sequence;
 
+  /* Link in display->windows */
+  GList display_link;
+
   /* set to the most recent user-interaction event timestamp that we
      know about for this window */
   guint32 net_wm_user_time;
@@ -674,6 +709,7 @@ void        meta_window_focus              (MetaWindow  *window,
                                             guint32      timestamp);
 
 void        meta_window_update_unfocused_button_grabs (MetaWindow *window);
+void        meta_window_update_crossing_events (MetaWindow *window);
 
 /* Sends a client message */
 void meta_window_send_icccm_message (MetaWindow *window,
@@ -720,6 +756,8 @@ void meta_window_set_gravity (MetaWindow *window,
                                                gint64      new_counter_value);
 #endif /* HAVE_XSYNC */
 
+void meta_window_flush_grab_motion (MetaWindow *window);
+
 void meta_window_handle_mouse_grab_op_event (MetaWindow *window,
                                              XEvent     *event);
 
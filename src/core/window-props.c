@@ -67,9 +67,10 @@ struct _MetaWindowPropHooks
   ReloadValueFunc reload_func;
   gboolean load_initially;
   gboolean include_override_redirect;
+  gboolean deferred;
 };
 
-static void init_prop_value            (MetaWindow          *window,
+static void init_prop_value            (gboolean             override_redirect,
                                         MetaWindowPropHooks *hooks,
                                         MetaPropValue       *value);
 static void reload_prop_value          (MetaWindow          *window,
@@ -130,7 +131,7 @@ meta_window_reload_properties_from_xwindow (MetaWindow *window,
   while (i < n_properties)
     {
       MetaWindowPropHooks *hooks = find_hooks (window->display, properties[i]);
-      init_prop_value (window, hooks, &values[i]);
+      init_prop_value (window->override_redirect, hooks, &values[i]);
       ++i;
     }
 
@@ -152,25 +153,94 @@ meta_window_reload_properties_from_xwindow (MetaWindow *window,
 }
 
 LOCAL_SYMBOL void
-meta_window_load_initial_properties (MetaWindow *window)
+meta_window_reload_properties_multi (MetaWindow **windows,
+                                     const Atom  *properties,
+                                     int          n_properties,
+                                     gboolean     initial)
 {
-  int i, j;
+  int i;
+  MetaDisplay *display;
   MetaPropValue *values;
-  int n_properties = 0;
+  Window *xwindows;
 
-  values = g_new0 (MetaPropValue, window->display->n_prop_hooks);
+  g_return_if_fail (windows != NULL);
+  g_return_if_fail (properties != NULL);
+
+  if (n_properties == 0)
+    return;
+
+  display = windows[0]->display;
+
+  values = g_new0 (MetaPropValue, n_properties);
+  xwindows = g_new (Window, n_properties);
+
+  for (i = 0; i < n_properties; i++)
+    {
+      MetaWindowPropHooks *hooks = find_hooks (display, properties[i]);
+      init_prop_value (windows[i]->override_redirect, hooks, &values[i]);
+      xwindows[i] = windows[i]->xwindow;
+    }
+
+  meta_prop_get_values_multi (display, xwindows, values, n_properties);
+
+  for (i = 0; i < n_properties; i++)
+    {
+      MetaWindowPropHooks *hooks = find_hooks (display, properties[i]);
+      reload_prop_value (windows[i], hooks, &values[i], initial);
+    }
+
+  meta_prop_free_values (values, n_properties);
+
+  free (xwindows);
+  free (values);
+}
+
+LOCAL_SYMBOL gboolean
+meta_window_property_is_deferred (MetaDisplay *display,
+                                  Atom         property)
+{
+  MetaWindowPropHooks *hooks = find_hooks (display, property);
+
+  return hooks != NULL && hooks->deferred;
+}
+
+/* Fills in "values" with the properties loaded when a window is first
+ * managed, and returns how many there are.  "values" must have room for
+ * all the hooks of the display.
+ */
+static int
+init_initial_prop_values (MetaDisplay   *display,
+                          gboolean       override_redirect,
+                          MetaPropValue *values)
+{
+  int i, j;
 
   j = 0;
-  for (i = 0; i < window->display->n_prop_hooks; i++)
+  for (i = 0; i < display->n_prop_hooks; i++)
     {
-      MetaWindowPropHooks *hooks = &window->display->prop_hooks_table[i];
+      MetaWindowPropHooks *hooks = &display->prop_hooks_table[i];
       if (hooks->load_initially)
         {
-          init_prop_value (window, hooks, &values[j]);
+          init_prop_value (override_redirect, hooks, &values[j]);
           ++j;
         }
     }
-  n_properties = j;
+
+  return j;
+}
+
+LOCAL_SYMBOL void
+meta_window_load_initial_properties (MetaWindow *window)
+{
+  int i, j;
+  MetaPropValue *values;
+  int n_properties = 0;
+
+  values = g_new0 (MetaPropValue, window->display->n_prop_hooks);
+
+  n_properties = init_initial_prop_values (window->display,
+                                           window->override_redirect,
+                                           values);
 
   meta_prop_get_values (window->display, window->xwindow,
                         values, n_properties);
@@ -196,14 +266,31 @@ meta_window_load_initial_properties (MetaWindow *window)
   free (values);
 }
 
+LOCAL_SYMBOL void
+meta_window_prefetch_initial_properties (MetaDisplay *display,
+                                         Window       xwindow,
+                                         gboolean     override_redirect)
+{
+  MetaPropValue *values;
+  int n_properties;
+
+  values = g_new0 (MetaPropValue, display->n_prop_hooks);
+
+  n_properties = init_initial_prop_values (display, override_redirect,
+                                           values);
+  meta_prop_prefetch_values (display, xwindow, values, n_properties);
+
+  free (values);
+}
+
 /* Fill in the MetaPropValue used to get the value of "property" */
 static void
-init_prop_value (MetaWindow          *window,
+init_prop_value (gboolean             override_redirect,
                  MetaWindowPropHooks *hooks,
                  MetaPropValue       *value)
 {
   if (!hooks || hooks->type == META_PROP_VALUE_INVALID ||
-      (window->override_redirect && !hooks->include_override_redirect))
+      (override_redirect && !hooks->include_override_redirect))
     {
       value->type = META_PROP_VALUE_INVALID;
       value->atom = None;
@@ -231,11 +318,10 @@ reload_wm_client_machine (MetaWindow    *window,
                           MetaPropValue *value,
                           gboolean       initial)
 {
-  free (window->wm_client_machine);
   window->wm_client_machine = NULL;
 
   if (value->type != META_PROP_VALUE_INVALID)
-    window->wm_client_machine = g_strdup (value->v.str);
+    window->wm_client_machine = g_intern_string (value->v.str);
 
   meta_verbose ("Window has client machine \"%s\"\n",
                 window->wm_client_machine ? window->wm_client_machine : "unset");
@@ -387,6 +473,9 @@ reload_gtk_frame_extents (MetaWindow    *window,
     {
       window->has_custom_frame_extents = FALSE;
     }
+
+  if (window->screen->stack)
+    meta_stack_invalidate_hit_index (window->screen->stack);
 }
 
 static void
@@ -537,33 +626,51 @@ reload_net_wm_user_time_window (MetaWindow    *window,
 
 #define MAX_TITLE_LENGTH 512
 
+/* Replaces *target with a copy of new_value, unless they are the
+ * same; returns whether *target changed */
+static gboolean
+update_string (char       **target,
+               const char  *new_value)
+{
+  if (g_strcmp0 (*target, new_value) == 0)
+    return FALSE;
+
+  free (*target);
+  *target = g_strdup (new_value);
+
+  return TRUE;
+}
+
 /*
  * Called by set_window_title and set_icon_title to set the value of
  * *target to title. It required and atom is set, it will update the
  * appropriate property.
  *
- * Returns TRUE if a new title was set.
+ * Returns TRUE if the title was modified from the one passed in; sets
+ * *changed to whether *target is different from before.
  */
 static gboolean
 set_title_text (MetaWindow  *window,
                 gboolean     previous_was_modified,
                 const char  *title,
                 Atom         atom,
-                char       **target)
+                char       **target,
+                gboolean    *changed)
 {
   char hostname[HOST_NAME_MAX + 1];
   gboolean modified = FALSE;
+  char *text = NULL;
+
+  *changed = FALSE;
 
   if (!target)
     return FALSE;
 
-  free (*target);
-
   if (!title)
-    *target = g_strdup ("");
+    title = "";
   else if (g_utf8_strlen (title, MAX_TITLE_LENGTH + 1) > MAX_TITLE_LENGTH)
     {
-      *target = meta_g_utf8_strndup (title, MAX_TITLE_LENGTH);
+      text = meta_g_utf8_strndup (title, MAX_TITLE_LENGTH);
       modified = TRUE;
     }
   /* if WM_CLIENT_MACHINE indicates this machine is on a remote host
@@ -572,12 +679,26 @@ set_title_text (MetaWindow  *window,
            !gethostname (hostname, HOST_NAME_MAX + 1) &&
            strcmp (hostname, window->wm_client_machine))
     {
-      *target = g_strdup_printf (_("%s (on %s)"),
-                      title, window->wm_client_machine);
+      text = g_strdup_printf (_("%s (on %s)"),
+                              title, window->wm_client_machine);
       modified = TRUE;
     }
+
+  /* Clients often set the same title again, and then neither the
+   * string nor anything derived from it needs redoing */
+  if (text != NULL)
+    {
+      if (g_strcmp0 (*target, text) == 0)
+        free (text);
+      else
+        {
+          free (*target);
+          *target = text;
+          *changed = TRUE;
+        }
+    }
   else
-    *target = g_strdup (title);
+    *changed = update_string (target, title);
 
   if (modified && atom != None)
     meta_prop_set_utf8_string_hint (window->display,
@@ -602,15 +723,20 @@ set_window_title (MetaWindow *window,
                   const char *title)
 {
   char *str;
+  gboolean changed;
 
   gboolean modified =
     set_title_text (window,
                     window->using_net_wm_visible_name,
                     title,
                     window->display->atom__NET_WM_VISIBLE_NAME,
-                    &window->title);
+                    &window->title,
+                    &changed);
   window->using_net_wm_visible_name = modified;
 
+  if (!changed)
+    return;
+
   /* strndup is a hack since GNU libc has broken %.10s */
   str = g_strndup (window->title, 10);
   free (window->desc);
@@ -787,12 +913,14 @@ static void
 set_icon_title (MetaWindow *window,
                 const char *title)
 {
+  gboolean changed;
   gboolean modified =
     set_title_text (window,
                     window->using_net_wm_visible_icon_name,
                     title,
                     window->display->atom__NET_WM_VISIBLE_ICON_NAME,
-                    &window->icon_name);
+                    &window->icon_name,
+                    &changed);
   window->using_net_wm_visible_icon_name = modified;
 }
 
@@ -1055,21 +1183,16 @@ reload_wm_class (MetaWindow    *window,
                  MetaPropValue *value,
                  gboolean       initial)
 {
-  if (window->res_class)
-    free (window->res_class);
-  if (window->res_name)
-    free (window->res_name);
-
   window->res_class = NULL;
   window->res_name = NULL;
 
   if (value->type != META_PROP_VALUE_INVALID)
     {
       if (value->v.class_hint.res_name)
-        window->res_name = g_strdup (value->v.class_hint.res_name);
+        window->res_name = g_intern_string (value->v.class_hint.res_name);
 
       if (value->v.class_hint.res_class)
-        window->res_class = g_strdup (value->v.class_hint.res_class);
+        window->res_class = g_intern_string (value->v.class_hint.res_class);
 
       g_object_notify (G_OBJECT (window), "wm-class");
     }
@@ -1970,30 +2093,36 @@ reload_bypass_compositor (MetaWindow    *window,
   window->bypass_compositor = requested_value;
 }
 
-#define RELOAD_STRING(var_name, propname) \
-  static void                                       \
-  reload_ ## var_name (MetaWindow    *window,       \
-                       MetaPropValue *value,        \
-                       gboolean       initial)      \
-  {                                                 \
-    free (window->var_name);                      \
-                                                    \
-    if (value->type != META_PROP_VALUE_INVALID)     \
-      window->var_name = g_strdup (value->v.str);   \
-    else                                            \
-      window->var_name = NULL;                      \
-                                                    \
-    g_object_notify (G_OBJECT (window), propname);  \
+#define RELOAD_GTK_STRING(field, propname) \
+  static void                                                 \
+  reload_gtk_ ## field (MetaWindow    *window,                \
+                        MetaPropValue *value,                 \
+                        gboolean       initial)               \
+  {                                                           \
+    const char *str = NULL;                                   \
+                                                              \
+    if (value->type != META_PROP_VALUE_INVALID)               \
+      str = value->v.str;                                     \
+                                                              \
+    if (window->gtk == NULL)                                  \
+      {                                                       \
+        if (str == NULL)                                      \
+          return;                                             \
+        window->gtk = g_slice_new0 (MetaWindowGtkInfo);       \
+      }                                                       \
+                                                              \
+    if (update_string (&window->gtk->field, str))             \
+      g_object_notify (G_OBJECT (window), propname);          \
   }
 
-RELOAD_STRING (gtk_unique_bus_name,         "gtk-unique-bus-name")
-RELOAD_STRING (gtk_application_id,          "gtk-application-id")
-RELOAD_STRING (gtk_application_object_path, "gtk-application-object-path")
-RELOAD_STRING (gtk_window_object_path,      "gtk-window-object-path")
-RELOAD_STRING (gtk_app_menu_object_path,    "gtk-app-menu-object-path")
-RELOAD_STRING (gtk_menubar_object_path,     "gtk-menubar-object-path")
+RELOAD_GTK_STRING (unique_bus_name,         "gtk-unique-bus-name")
+RELOAD_GTK_STRING (application_id,          "gtk-application-id")
+RELOAD_GTK_STRING (application_object_path, "gtk-application-object-path")
+RELOAD_GTK_STRING (window_object_path,      "gtk-window-object-path")
+RELOAD_GTK_STRING (app_menu_object_path,    "gtk-app-menu-object-path")
+RELOAD_GTK_STRING (menubar_object_path,     "gtk-menubar-object-path")
 
-#undef RELOAD_STRING
+#undef RELOAD_GTK_STRING
 
 /*
  * Initialises the property hooks system.  Each row in the table named "hooks"
@@ -2014,6 +2143,9 @@ meta_display_init_window_prop_hooks (MetaDisplay *display)
 {
   /* INIT: load initially
    * O-R:  fetch for override-redirect windows
+   * DEF:  changes are coalesced and reloaded once per frame; only for
+   *       properties nothing needs synchronously (see
+   *       meta_window_property_is_deferred())
    *
    * The ordering here is significant for the properties we load
    * initially: they are roughly ordered in the order we want them to
@@ -2028,50 +2160,50 @@ meta_display_init_window_prop_hooks (MetaDisplay *display)
    *  - NET_WM_WINDOW_TYPE: can be used to do appropriate handling
    *    for different types of override-redirect windows.
    */
-  MetaWindowPropHooks hooks[] = {                                                       /* INIT   O-R     */
-    { display->atom_WM_CLIENT_MACHINE, META_PROP_VALUE_STRING,   reload_wm_client_machine, TRUE,  TRUE },
-    { display->atom__NET_WM_NAME,      META_PROP_VALUE_UTF8,     reload_net_wm_name,       TRUE,  TRUE },
-    { XA_WM_CLASS,                     META_PROP_VALUE_CLASS_HINT, reload_wm_class,        TRUE,  TRUE },
-    { display->atom__NET_WM_PID,       META_PROP_VALUE_CARDINAL, reload_net_wm_pid,        TRUE,  TRUE },
-    { XA_WM_NAME,                      META_PROP_VALUE_TEXT_PROPERTY, reload_wm_name,      TRUE,  TRUE },
-    { display->atom__MUFFIN_HINTS,     META_PROP_VALUE_TEXT_PROPERTY, reload_muffin_hints, TRUE,  TRUE },
-    { display->atom__NET_WM_OPAQUE_REGION, META_PROP_VALUE_CARDINAL_LIST, reload_opaque_region, TRUE, TRUE },
-    { display->atom__NET_WM_ICON_NAME, META_PROP_VALUE_UTF8,     reload_net_wm_icon_name,  TRUE,  FALSE },
-    { XA_WM_ICON_NAME,                 META_PROP_VALUE_TEXT_PROPERTY, reload_wm_icon_name, TRUE,  FALSE },
-    { display->atom__NET_WM_DESKTOP,   META_PROP_VALUE_CARDINAL, reload_net_wm_desktop,    TRUE,  FALSE },
-    { display->atom__NET_STARTUP_ID,   META_PROP_VALUE_UTF8,     reload_net_startup_id,    TRUE,  FALSE },
-    { display->atom__NET_WM_SYNC_REQUEST_COUNTER, META_PROP_VALUE_SYNC_COUNTER_LIST, reload_update_counter, TRUE, TRUE },
-    { XA_WM_NORMAL_HINTS,              META_PROP_VALUE_SIZE_HINTS, reload_normal_hints,    TRUE,  FALSE },
-    { display->atom_WM_PROTOCOLS,      META_PROP_VALUE_ATOM_LIST, reload_wm_protocols,     TRUE,  FALSE },
-    { XA_WM_HINTS,                     META_PROP_VALUE_WM_HINTS,  reload_wm_hints,         TRUE,  FALSE },
-    { display->atom__NET_WM_USER_TIME, META_PROP_VALUE_CARDINAL, reload_net_wm_user_time,  TRUE,  FALSE },
-    { display->atom__NET_WM_STATE,     META_PROP_VALUE_ATOM_LIST, reload_net_wm_state,     TRUE,  FALSE },
-    { display->atom__MOTIF_WM_HINTS,   META_PROP_VALUE_MOTIF_HINTS, reload_mwm_hints,      TRUE,  FALSE },
-    { XA_WM_TRANSIENT_FOR,             META_PROP_VALUE_WINDOW,    reload_transient_for,    TRUE,  FALSE },
-    { display->atom__GTK_THEME_VARIANT, META_PROP_VALUE_UTF8,     reload_gtk_theme_variant, TRUE, FALSE },
-    { display->atom__GTK_HIDE_TITLEBAR_WHEN_MAXIMIZED, META_PROP_VALUE_CARDINAL,     reload_gtk_hide_titlebar_when_maximized, TRUE, FALSE },
-    { display->atom__GTK_APPLICATION_ID,               META_PROP_VALUE_UTF8,         reload_gtk_application_id,               TRUE, FALSE },
-    { display->atom__GTK_UNIQUE_BUS_NAME,              META_PROP_VALUE_UTF8,         reload_gtk_unique_bus_name,              TRUE, FALSE },
-    { display->atom__GTK_APPLICATION_OBJECT_PATH,      META_PROP_VALUE_UTF8,         reload_gtk_application_object_path,      TRUE, FALSE },
-    { display->atom__GTK_WINDOW_OBJECT_PATH,           META_PROP_VALUE_UTF8,         reload_gtk_window_object_path,           TRUE, FALSE },
-    { display->atom__GTK_APP_MENU_OBJECT_PATH,         META_PROP_VALUE_UTF8,         reload_gtk_app_menu_object_path,         TRUE, FALSE },
-    { display->atom__GTK_MENUBAR_OBJECT_PATH,          META_PROP_VALUE_UTF8,         reload_gtk_menubar_object_path,          TRUE, FALSE },
-    { display->atom__GTK_FRAME_EXTENTS,                META_PROP_VALUE_CARDINAL_LIST,reload_gtk_frame_extents,                TRUE, FALSE },
-    { display->atom__NET_WM_USER_TIME_WINDOW, META_PROP_VALUE_WINDOW, reload_net_wm_user_time_window, TRUE, FALSE },
-    { display->atom_WM_STATE,          META_PROP_VALUE_INVALID,  NULL,                     FALSE, FALSE },
-    { display->atom__NET_WM_ICON,      META_PROP_VALUE_INVALID,  reload_net_wm_icon,       FALSE, FALSE },
-    { display->atom__KWM_WIN_ICON,     META_PROP_VALUE_INVALID,  reload_kwm_win_icon,      FALSE, FALSE },
-    { display->atom__NET_WM_ICON_GEOMETRY, META_PROP_VALUE_CARDINAL_LIST, reload_icon_geometry, FALSE, FALSE },
-    { display->atom_WM_CLIENT_LEADER,  META_PROP_VALUE_INVALID, complain_about_broken_client, FALSE, FALSE },
-    { display->atom_SM_CLIENT_ID,      META_PROP_VALUE_INVALID, complain_about_broken_client, FALSE, FALSE },
-    { display->atom_WM_WINDOW_ROLE,    META_PROP_VALUE_INVALID, reload_wm_window_role,        FALSE, FALSE },
-    { display->atom__NET_WM_WINDOW_TYPE, META_PROP_VALUE_INVALID, reload_net_wm_window_type,  FALSE, TRUE },
-    { display->atom__NET_WM_STRUT,         META_PROP_VALUE_INVALID, reload_struts,            FALSE, FALSE },
-    { display->atom__NET_WM_STRUT_PARTIAL, META_PROP_VALUE_INVALID, reload_struts,            FALSE, FALSE },
-    { display->atom__NET_WM_BYPASS_COMPOSITOR, META_PROP_VALUE_CARDINAL,  reload_bypass_compositor, TRUE, TRUE },
-    { display->atom__NET_WM_XAPP_ICON_NAME, META_PROP_VALUE_UTF8,     reload_theme_icon_name, TRUE,  TRUE },
-    { display->atom__NET_WM_XAPP_PROGRESS, META_PROP_VALUE_CARDINAL, reload_progress,         TRUE,  TRUE },
-    { display->atom__NET_WM_XAPP_PROGRESS_PULSE, META_PROP_VALUE_CARDINAL, reload_progress_pulse, TRUE,  TRUE },
+  MetaWindowPropHooks hooks[] = {                                                       /* INIT   O-R    DEF */
+    { display->atom_WM_CLIENT_MACHINE, META_PROP_VALUE_STRING,   reload_wm_client_machine, TRUE,  TRUE,  FALSE },
+    { display->atom__NET_WM_NAME,      META_PROP_VALUE_UTF8,     reload_net_wm_name,       TRUE,  TRUE,  TRUE },
+    { XA_WM_CLASS,                     META_PROP_VALUE_CLASS_HINT, reload_wm_class,        TRUE,  TRUE,  FALSE },
+    { display->atom__NET_WM_PID,       META_PROP_VALUE_CARDINAL, reload_net_wm_pid,        TRUE,  TRUE,  FALSE },
+    { XA_WM_NAME,                      META_PROP_VALUE_TEXT_PROPERTY, reload_wm_name,      TRUE,  TRUE,  TRUE },
+    { display->atom__MUFFIN_HINTS,     META_PROP_VALUE_TEXT_PROPERTY, reload_muffin_hints, TRUE,  TRUE,  FALSE },
+    { display->atom__NET_WM_OPAQUE_REGION, META_PROP_VALUE_CARDINAL_LIST, reload_opaque_region, TRUE, TRUE,  FALSE },
+    { display->atom__NET_WM_ICON_NAME, META_PROP_VALUE_UTF8,     reload_net_wm_icon_name,  TRUE,  FALSE,  TRUE },
+    { XA_WM_ICON_NAME,                 META_PROP_VALUE_TEXT_PROPERTY, reload_wm_icon_name, TRUE,  FALSE,  TRUE },
+    { display->atom__NET_WM_DESKTOP,   META_PROP_VALUE_CARDINAL, reload_net_wm_desktop,    TRUE,  FALSE,  FALSE },
+    { display->atom__NET_STARTUP_ID,   META_PROP_VALUE_UTF8,     reload_net_startup_id,    TRUE,  FALSE,  FALSE },
+    { display->atom__NET_WM_SYNC_REQUEST_COUNTER, META_PROP_VALUE_SYNC_COUNTER_LIST, reload_update_counter, TRUE, TRUE,  FALSE },
+    { XA_WM_NORMAL_HINTS,              META_PROP_VALUE_SIZE_HINTS, reload_normal_hints,    TRUE,  FALSE,  FALSE },
+    { display->atom_WM_PROTOCOLS,      META_PROP_VALUE_ATOM_LIST, reload_wm_protocols,     TRUE,  FALSE,  FALSE },
+    { XA_WM_HINTS,                     META_PROP_VALUE_WM_HINTS,  reload_wm_hints,         TRUE,  FALSE,  FALSE },
+    { display->atom__NET_WM_USER_TIME, META_PROP_VALUE_CARDINAL, reload_net_wm_user_time,  TRUE,  FALSE,  FALSE },
+    { display->atom__NET_WM_STATE,     META_PROP_VALUE_ATOM_LIST, reload_net_wm_state,     TRUE,  FALSE,  FALSE },
+    { display->atom__MOTIF_WM_HINTS,   META_PROP_VALUE_MOTIF_HINTS, reload_mwm_hints,      TRUE,  FALSE,  FALSE },
+    { XA_WM_TRANSIENT_FOR,             META_PROP_VALUE_WINDOW,    reload_transient_for,    TRUE,  FALSE,  FALSE },
+    { display->atom__GTK_THEME_VARIANT, META_PROP_VALUE_UTF8,     reload_gtk_theme_variant, TRUE, FALSE,  FALSE },
+    { display->atom__GTK_HIDE_TITLEBAR_WHEN_MAXIMIZED, META_PROP_VALUE_CARDINAL,     reload_gtk_hide_titlebar_when_maximized, TRUE, FALSE,  FALSE },
+    { display->atom__GTK_APPLICATION_ID,               META_PROP_VALUE_UTF8,         reload_gtk_application_id,               TRUE, FALSE,  FALSE },
+    { display->atom__GTK_UNIQUE_BUS_NAME,              META_PROP_VALUE_UTF8,         reload_gtk_unique_bus_name,              TRUE, FALSE,  FALSE },
+    { display->atom__GTK_APPLICATION_OBJECT_PATH,      META_PROP_VALUE_UTF8,         reload_gtk_application_object_path,      TRUE, FALSE,  FALSE },
+    { display->atom__GTK_WINDOW_OBJECT_PATH,           META_PROP_VALUE_UTF8,         reload_gtk_window_object_path,           TRUE, FALSE,  FALSE },
+    { display->atom__GTK_APP_MENU_OBJECT_PATH,         META_PROP_VALUE_UTF8,         reload_gtk_app_menu_object_path,         TRUE, FALSE,  FALSE },
+    { display->atom__GTK_MENUBAR_OBJECT_PATH,          META_PROP_VALUE_UTF8,         reload_gtk_menubar_object_path,          TRUE, FALSE,  FALSE },
+    { display->atom__GTK_FRAME_EXTENTS,                META_PROP_VALUE_CARDINAL_LIST,reload_gtk_frame_extents,                TRUE, FALSE,  FALSE },
+    { display->atom__NET_WM_USER_TIME_WINDOW, META_PROP_VALUE_WINDOW, reload_net_wm_user_time_window, TRUE, FALSE,  FALSE },
+    { display->atom_WM_STATE,          META_PROP_VALUE_INVALID,  NULL,                     FALSE, FALSE,  FALSE },
+    { display->atom__NET_WM_ICON,      META_PROP_VALUE_INVALID,  reload_net_wm_icon,       FALSE, FALSE,  FALSE },
+    { display->atom__KWM_WIN_ICON,     META_PROP_VALUE_INVALID,  reload_kwm_win_icon,      FALSE, FALSE,  FALSE },
+    { display->atom__NET_WM_ICON_GEOMETRY, META_PROP_VALUE_CARDINAL_LIST, reload_icon_geometry, FALSE, FALSE,  TRUE },
+    { display->atom_WM_CLIENT_LEADER,  META_PROP_VALUE_INVALID, complain_about_broken_client, FALSE, FALSE,  FALSE },
+    { display->atom_SM_CLIENT_ID,      META_PROP_VALUE_INVALID, complain_about_broken_client, FALSE, FALSE,  FALSE },
+    { display->atom_WM_WINDOW_ROLE,    META_PROP_VALUE_INVALID, reload_wm_window_role,        FALSE, FALSE,  FALSE },
+    { display->atom__NET_WM_WINDOW_TYPE, META_PROP_VALUE_INVALID, reload_net_wm_window_type,  FALSE, TRUE,  FALSE },
+    { display->atom__NET_WM_STRUT,         META_PROP_VALUE_INVALID, reload_struts,            FALSE, FALSE,  FALSE },
+    { display->atom__NET_WM_STRUT_PARTIAL, META_PROP_VALUE_INVALID, reload_struts,            FALSE, FALSE,  FALSE },
+    { display->atom__NET_WM_BYPASS_COMPOSITOR, META_PROP_VALUE_CARDINAL,  reload_bypass_compositor, TRUE, TRUE,  FALSE },
+    { display->atom__NET_WM_XAPP_ICON_NAME, META_PROP_VALUE_UTF8,     reload_theme_icon_name, TRUE,  TRUE,  TRUE },
+    { display->atom__NET_WM_XAPP_PROGRESS, META_PROP_VALUE_CARDINAL, reload_progress,         TRUE,  TRUE,  TRUE },
+    { display->atom__NET_WM_XAPP_PROGRESS_PULSE, META_PROP_VALUE_CARDINAL, reload_progress_pulse, TRUE,  TRUE,  TRUE },
     { 0 },
   };
 
@@ -95,6 +95,33 @@ void meta_window_reload_properties_from_xwindow
                                     int         n_properties,
                                     gboolean    initial);
 
+/**
+ * Requests the current values of properties of several windows from the
+ * server in a single round trip, and deals with them appropriately.
+ * properties[i] is read from windows[i]; a window may appear more than
+ * once.  Does not return them to the caller (they've been dealt with!)
+ *
+ * \param windows       The windows, "n_properties" long, all on one display.
+ * \param properties    The X atoms to read, "n_properties" long.
+ * \param n_properties  The length of both lists.
+ * \param initial       Whether this is the first time the values are loaded.
+ */
+void meta_window_reload_properties_multi (MetaWindow **windows,
+                                          const Atom  *properties,
+                                          int          n_properties,
+                                          gboolean     initial);
+
+/**
+ * Whether changes to a property are coalesced rather than reloaded as
+ * soon as the PropertyNotify arrives.  Deferred properties are queued on
+ * the window and read in one batch before the next redraw.
+ *
+ * \param display   The display.
+ * \param property  The X atom that changed.
+ */
+gboolean meta_window_property_is_deferred (MetaDisplay *display,
+                                           Atom         property);
+
 /**
  * Requests the current values for standard properties for a given
  * window from the server, and deals with them appropriately.
@@ -104,6 +131,19 @@ void meta_window_reload_properties_from_xwindow
  */
 void meta_window_load_initial_properties (MetaWindow *window);
 
+/**
+ * Sends the requests for the properties meta_window_load_initial_properties()
+ * will want for a window that is about to be managed, without waiting for
+ * the replies.  Must be called with the server grabbed.
+ *
+ * \param display            The display.
+ * \param xwindow            The X window that will be managed.
+ * \param override_redirect  Whether the window is override-redirect.
+ */
+void meta_window_prefetch_initial_properties (MetaDisplay *display,
+                                              Window       xwindow,
+                                              gboolean     override_redirect);
+
 /**
  * Initialises the hooks used for the reload_propert* functions
  * on a particular display, and stores a pointer to them in the
@@ -57,6 +57,8 @@
 
 #ifdef HAVE_SHAPE
 #include <X11/extensions/shape.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/shape.h>
 #endif
 #include <X11/XKBlib.h>
 #include <X11/extensions/Xcomposite.h>
@@ -69,6 +71,10 @@ static void     update_sm_hints           (MetaWindow     *window);
 static void     update_net_frame_extents  (MetaWindow     *window);
 static void     recalc_window_type        (MetaWindow     *window);
 static void     recalc_window_features    (MetaWindow     *window);
+static long     client_event_mask         (gboolean        override_redirect,
+                                           gboolean        crossing);
+static gboolean window_needs_crossing_events (MetaDisplay    *display,
+                                              MetaWindowType  type);
 static void     invalidate_work_areas     (MetaWindow     *window);
 static void     recalc_window_type        (MetaWindow     *window);
 static void     set_wm_state_on_xwindow   (MetaDisplay    *display,
@@ -157,6 +163,7 @@ static void update_gtk_edge_constraints (MetaWindow *window);
  * need to sort out at some point.
  */
 static gboolean idle_calc_showing (gpointer data);
+static gboolean idle_reload_properties (gpointer data);
 static gboolean idle_move_resize (gpointer data);
 
 G_DEFINE_TYPE (MetaWindow, meta_window, G_TYPE_OBJECT);
@@ -200,6 +207,7 @@ enum
   UNMANAGED,
   SIZE_CHANGED,
   POSITION_CHANGED,
+  GEOMETRY_CHANGED,
   ICON_CHANGED,
 
   LAST_SIGNAL
@@ -241,32 +249,40 @@ meta_window_finalize (GObject *object)
   if (window->icon)
     g_object_unref (G_OBJECT (window->icon));
 
+  if (window->icons_by_size)
+    g_hash_table_destroy (window->icons_by_size);
+
   if (window->frame_bounds)
     cairo_region_destroy (window->frame_bounds);
 
   if (window->opaque_region)
     cairo_region_destroy (window->opaque_region);
 
+  if (window->pending_properties)
+    g_array_free (window->pending_properties, TRUE);
+
   meta_icon_cache_free (&window->icon_cache);
 
   free (window->sm_client_id);
-  free (window->wm_client_machine);
   free (window->startup_id);
   free (window->muffin_hints);
   free (window->role);
-  free (window->res_class);
-  free (window->res_name);
   free (window->title);
   free (window->icon_name);
   free (window->theme_icon_name);
   free (window->desc);
   free (window->gtk_theme_variant);
-  free (window->gtk_application_id);
-  free (window->gtk_unique_bus_name);
-  free (window->gtk_application_object_path);
-  free (window->gtk_window_object_path);
-  free (window->gtk_app_menu_object_path);
-  free (window->gtk_menubar_object_path);
+
+  if (window->gtk)
+    {
+      free (window->gtk->application_id);
+      free (window->gtk->unique_bus_name);
+      free (window->gtk->application_object_path);
+      free (window->gtk->window_object_path);
+      free (window->gtk->app_menu_object_path);
+      free (window->gtk->menubar_object_path);
+      g_slice_free (MetaWindowGtkInfo, window->gtk);
+    }
 
   G_OBJECT_CLASS (meta_window_parent_class)->finalize (object);
 }
@@ -330,22 +346,22 @@ meta_window_get_property(GObject         *object,
       g_value_set_boolean (value, win->wm_state_above);
       break;
     case PROP_GTK_APPLICATION_ID:
-      g_value_set_string (value, win->gtk_application_id);
+      g_value_set_string (value, win->gtk ? win->gtk->application_id : NULL);
       break;
     case PROP_GTK_UNIQUE_BUS_NAME:
-      g_value_set_string (value, win->gtk_unique_bus_name);
+      g_value_set_string (value, win->gtk ? win->gtk->unique_bus_name : NULL);
       break;
     case PROP_GTK_APPLICATION_OBJECT_PATH:
-      g_value_set_string (value, win->gtk_application_object_path);
+      g_value_set_string (value, win->gtk ? win->gtk->application_object_path : NULL);
       break;
     case PROP_GTK_WINDOW_OBJECT_PATH:
-      g_value_set_string (value, win->gtk_window_object_path);
+      g_value_set_string (value, win->gtk ? win->gtk->window_object_path : NULL);
       break;
     case PROP_GTK_APP_MENU_OBJECT_PATH:
-      g_value_set_string (value, win->gtk_app_menu_object_path);
+      g_value_set_string (value, win->gtk ? win->gtk->app_menu_object_path : NULL);
       break;
     case PROP_GTK_MENUBAR_OBJECT_PATH:
-      g_value_set_string (value, win->gtk_menubar_object_path);
+      g_value_set_string (value, win->gtk ? win->gtk->menubar_object_path : NULL);
       break;
     case PROP_PROGRESS:
       g_value_set_uint (value, win->progress);
@@ -630,6 +646,28 @@ meta_window_class_init (MetaWindowClass *klass)
                   NULL, NULL, NULL,
                   G_TYPE_NONE, 0);
 
+  /**
+   * MetaWindow::geometry-changed:
+   * @window: the #MetaWindow
+   * @old_rect: the outer rect of @window at the previous emission
+   * @new_rect: the outer rect of @window now
+   *
+   * Emitted at most once per frame, before the stage is redrawn, when
+   * @window was moved or resized since the previous emission. Unlike
+   * #MetaWindow::position-changed and #MetaWindow::size-changed, which
+   * are emitted for every configure, the steps of an interactive move
+   * or resize are coalesced into one emission per frame.
+   */
+  window_signals[GEOMETRY_CHANGED] =
+    g_signal_new ("geometry-changed",
+                  G_TYPE_FROM_CLASS (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 2,
+                  META_TYPE_RECTANGLE | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  META_TYPE_RECTANGLE | G_SIGNAL_TYPE_STATIC_SCOPE);
+
   window_signals[ICON_CHANGED] =
     g_signal_new ("icon-changed",
                   G_TYPE_FROM_CLASS (object_class),
@@ -911,6 +949,9 @@ meta_window_new_with_attrs (MetaDisplay       *display,
   gulong event_mask;
   MetaMoveResizeFlags flags;
   gboolean has_shape;
+#ifdef HAVE_SHAPE
+  xcb_shape_query_extents_cookie_t shape_cookie;
+#endif
   MetaScreen *screen;
 
   g_assert (attrs != NULL);
@@ -1010,18 +1051,22 @@ meta_window_new_with_attrs (MetaDisplay       *display,
    * with Muffin we want to be able to create manageable windows from within
    * the process (such as a dummy desktop window), so we do not want this
    * call failing to prevent the window from being managed -- wrap it in its
-   * own error trap (we use the _with_return() version here to ensure that
-   * XSync() is done on the pop, otherwise the error will not get caught).
+   * own error trap.  GDK keeps ignoring errors for a popped trap until the
+   * server has caught up, so there is no need to XSync() here.
    */
-  meta_error_trap_push_with_return (display);
+  meta_error_trap_push (display);
   XAddToSaveSet (display->xdisplay, xwindow);
-  meta_error_trap_pop_with_return (display);
+  meta_error_trap_pop (display);
 
-  event_mask =
-    PropertyChangeMask | EnterWindowMask | LeaveWindowMask |
-    FocusChangeMask | ColormapChangeMask;
-  if (attrs->override_redirect)
-    event_mask |= StructureNotifyMask;
+  /* Crossing events are what the server sends most of after motion,
+   * so they are only selected once something will act on them; see
+   * meta_window_update_crossing_events(). DOCK windows start without
+   * them and get them when their type is known.
+   */
+  event_mask = client_event_mask (attrs->override_redirect,
+                                  attrs->your_event_mask != 0 ||
+                                  window_needs_crossing_events (display,
+                                                                META_WINDOW_NORMAL));
 
   /* If the window is from this client (a menu, say) we need to augment
    * the event mask, not replace it. For windows from other clients,
@@ -1031,26 +1076,15 @@ meta_window_new_with_attrs (MetaDisplay       *display,
 
   has_shape = FALSE;
 #ifdef HAVE_SHAPE
+  /* The reply is collected after the error trap below, whose sync it
+   * arrives with, rather than costing a round trip of its own */
   if (META_DISPLAY_HAS_SHAPE (display))
     {
-      int x_bounding, y_bounding, x_clip, y_clip;
-      unsigned w_bounding, h_bounding, w_clip, h_clip;
-      int bounding_shaped, clip_shaped;
-
       XShapeSelectInput (display->xdisplay, xwindow, ShapeNotifyMask);
 
-      XShapeQueryExtents (display->xdisplay, xwindow,
-                          &bounding_shaped, &x_bounding, &y_bounding,
-                          &w_bounding, &h_bounding,
-                          &clip_shaped, &x_clip, &y_clip,
-                          &w_clip, &h_clip);
-
-      has_shape = bounding_shaped != FALSE;
-
-      meta_topic (META_DEBUG_SHAPES,
-                  "Window has_shape = %d extents %d,%d %u x %u\n",
-                  has_shape, x_bounding, y_bounding,
-                  w_bounding, h_bounding);
+      shape_cookie =
+        xcb_shape_query_extents (XGetXCBConnection (display->xdisplay),
+                                 xwindow);
     }
 #endif
 
@@ -1075,11 +1109,44 @@ meta_window_new_with_attrs (MetaDisplay       *display,
     {
       meta_verbose ("Window 0x%lx disappeared just as we tried to manage it\n",
                     xwindow);
+#ifdef HAVE_SHAPE
+      if (META_DISPLAY_HAS_SHAPE (display))
+        xcb_discard_reply (XGetXCBConnection (display->xdisplay),
+                           shape_cookie.sequence);
+#endif
       meta_error_trap_pop (display);
       meta_display_ungrab (display);
       return NULL;
     }
 
+#ifdef HAVE_SHAPE
+  if (META_DISPLAY_HAS_SHAPE (display))
+    {
+      xcb_shape_query_extents_reply_t *extents;
+      xcb_generic_error_t *error = NULL;
+
+      extents =
+        xcb_shape_query_extents_reply (XGetXCBConnection (display->xdisplay),
+                                       shape_cookie, &error);
+      free (error);
+
+      if (extents)
+        {
+          has_shape = extents->bounding_shaped != FALSE;
+
+          meta_topic (META_DEBUG_SHAPES,
+                      "Window has_shape = %d extents %d,%d %u x %u\n",
+                      has_shape,
+                      extents->bounding_shape_extents_x,
+                      extents->bounding_shape_extents_y,
+                      extents->bounding_shape_extents_width,
+                      extents->bounding_shape_extents_height);
+
+          free (extents);
+        }
+    }
+#endif
+
 
   window = g_object_new (META_TYPE_WINDOW, NULL);
 
@@ -1107,6 +1174,9 @@ meta_window_new_with_attrs (MetaDisplay       *display,
   window->desc = g_strdup_printf ("0x%lx", window->xwindow);
 
   window->override_redirect = attrs->override_redirect;
+  window->crossing_events_selected = (event_mask & EnterWindowMask) != 0;
+  /* Our own windows keep whatever input they selected */
+  window->keeps_own_input = attrs->your_event_mask != 0;
 
   /* avoid tons of stack updates */
   meta_stack_freeze (window->screen->stack);
@@ -1140,6 +1210,7 @@ meta_window_new_with_attrs (MetaDisplay       *display,
   window->icon_name = NULL;
   window->icon = NULL;
   window->icon_size = -1;
+  window->icons_by_size = NULL;
   meta_icon_cache_init (&window->icon_cache);
   window->theme_icon_name = NULL;
   window->wm_hints_pixmap = None;
@@ -1300,6 +1371,9 @@ meta_window_new_with_attrs (MetaDisplay       *display,
 
   meta_display_register_x_window (display, &window->xwindow, window);
 
+  window->display_link.data = window;
+  g_queue_push_tail_link (&display->windows, &window->display_link);
+
   /* Assign this #MetaWindow a sequence number which can be used
    * for sorting.
    */
@@ -1884,7 +1958,8 @@ meta_window_unmanage (MetaWindow  *window,
     unmaximize_window_before_freeing (window);
 
   meta_window_unqueue (window, META_QUEUE_CALC_SHOWING |
-                               META_QUEUE_MOVE_RESIZE);
+                               META_QUEUE_MOVE_RESIZE |
+                               META_QUEUE_RELOAD_PROPERTIES);
   meta_window_free_delete_dialog (window);
 
   if (window->workspace)
@@ -1972,6 +2047,7 @@ meta_window_unmanage (MetaWindow  *window,
   meta_display_ungrab_focus_window_button (window->display, window);
 
   meta_display_unregister_x_window (window->display, window->xwindow);
+  g_queue_unlink (&window->display->windows, &window->display_link);
 
 
   meta_error_trap_push (window->display);
@@ -2029,6 +2105,13 @@ meta_window_unmanage (MetaWindow  *window,
       meta_window_destroy_frame (window);
     }
 
+  if (window->geometry_changed_pending)
+    {
+      window->display->geometry_changed_windows =
+        g_slist_remove (window->display->geometry_changed_windows, window);
+      window->geometry_changed_pending = FALSE;
+    }
+
   g_signal_emit (window, window_signals[UNMANAGED], 0);
   g_signal_emit_by_name (window->screen, "window-removed", window);
 
@@ -2568,7 +2651,7 @@ idle_calc_showing (gpointer data)
 
 #ifdef WITH_VERBOSE_MODE
 static const gchar* meta_window_queue_names[NUMBER_OF_QUEUES] =
-  {"calc_showing", "move_resize", "update_icon"};
+  {"calc_showing", "move_resize", "reload_properties"};
 #endif
 
 static void
@@ -2637,12 +2720,14 @@ meta_window_queue (MetaWindow *window, guint queuebits)
             {
               META_LATER_CALC_SHOWING,  /* CALC_SHOWING */
               META_LATER_RESIZE,        /* MOVE_RESIZE */
+              META_LATER_BEFORE_REDRAW, /* RELOAD_PROPERTIES */
             };
 
           const GSourceFunc window_queue_later_handler[NUMBER_OF_QUEUES] =
             {
               idle_calc_showing,
-              idle_move_resize
+              idle_move_resize,
+              idle_reload_properties
             };
 
           /* If we're about to drop the window, there's no point in putting
@@ -3107,6 +3192,12 @@ meta_window_show (MetaWindow *window)
 
   if (window->hidden)
     {
+      /* A move/resize idle_move_resize() put off while the window was
+       * hidden has to be done before it is seen.
+       */
+      if (window->is_in_queues & META_QUEUE_MOVE_RESIZE)
+        meta_window_move_resize_now (window);
+
       meta_stack_freeze (window->screen->stack);
       window->hidden = FALSE;
       meta_stack_thaw (window->screen->stack);
@@ -4923,6 +5014,64 @@ meta_window_update_monitor (MetaWindow *window)
     }
 }
 
+static gboolean
+emit_geometry_changed (gpointer data)
+{
+  MetaDisplay *display = data;
+  GSList *windows, *l;
+
+  display->geometry_changed_later = 0;
+
+  /* Handlers moving windows again queue them for the next frame */
+  windows = g_slist_reverse (display->geometry_changed_windows);
+  display->geometry_changed_windows = NULL;
+
+  for (l = windows; l; l = l->next)
+    {
+      MetaWindow *window = l->data;
+      MetaRectangle old_rect, new_rect;
+
+      window->geometry_changed_pending = FALSE;
+
+      old_rect = window->geometry_changed_old_rect;
+      meta_window_get_outer_rect (window, &new_rect);
+
+      if (meta_rectangle_equal (&old_rect, &new_rect))
+        continue;
+
+      g_signal_emit (window, window_signals[GEOMETRY_CHANGED], 0,
+                     &old_rect, &new_rect);
+    }
+
+  g_slist_free (windows);
+
+  return FALSE;
+}
+
+/* Remembers where @window was before the first move or resize since
+ * the last frame, for geometry-changed to be emitted once before the
+ * next redraw */
+static void
+queue_geometry_changed (MetaWindow          *window,
+                        const MetaRectangle *old_rect)
+{
+  MetaDisplay *display = window->display;
+
+  if (window->geometry_changed_pending)
+    return;
+
+  window->geometry_changed_pending = TRUE;
+  window->geometry_changed_old_rect = *old_rect;
+
+  display->geometry_changed_windows =
+    g_slist_prepend (display->geometry_changed_windows, window);
+
+  if (display->geometry_changed_later == 0)
+    display->geometry_changed_later =
+      meta_later_add (META_LATER_BEFORE_REDRAW,
+                      emit_geometry_changed, display, NULL);
+}
+
 static void
 meta_window_move_resize_internal (MetaWindow          *window,
                                   MetaMoveResizeFlags  flags,
@@ -4991,6 +5140,7 @@ meta_window_move_resize_internal (MetaWindow          *window,
   int client_move_y;
   MetaRectangle new_rect;
   MetaRectangle old_rect;
+  MetaRectangle old_outer_rect;
 
   g_return_if_fail (!window->override_redirect);
 
@@ -5005,6 +5155,7 @@ meta_window_move_resize_internal (MetaWindow          *window,
   meta_window_unqueue (window, META_QUEUE_MOVE_RESIZE);
 
   meta_window_get_client_root_coords (window, &old_rect);
+  meta_window_get_outer_rect (window, &old_outer_rect);
 
   meta_topic (META_DEBUG_GEOMETRY,
               "Move/resize %s to %d,%d %dx%d%s%s from %d,%d %dx%d\n",
@@ -5362,6 +5513,10 @@ meta_window_move_resize_internal (MetaWindow          *window,
   if (need_resize_client)
     g_signal_emit (window, window_signals[SIZE_CHANGED], 0);
 
+  if (need_move_frame || need_resize_frame ||
+      need_move_client || need_resize_client)
+    queue_geometry_changed (window, &old_outer_rect);
+
   if (need_move_frame || need_resize_frame ||
       need_move_client || need_resize_client ||
       did_placement)
@@ -5400,6 +5555,7 @@ meta_window_move_resize_internal (MetaWindow          *window,
 
   meta_window_foreach_transient (window, maybe_move_attached_dialog, NULL);
 
+  meta_stack_invalidate_hit_index (window->screen->stack);
   meta_stack_update_window_tile_matches (window->screen->stack,
                                          window->screen->active_workspace);
 }
@@ -5646,11 +5802,27 @@ meta_window_move_resize_now (MetaWindow  *window)
                            window->user_rect.height);
 }
 
+/* How long idle_move_resize() may spend on hidden windows before it
+ * leaves the rest for after the next frame, in microseconds */
+#define HIDDEN_MOVE_RESIZE_BUDGET 2000
+
+static guint deferred_move_resize_later = 0;
+
+static gboolean
+idle_deferred_move_resize (gpointer data)
+{
+  deferred_move_resize_later = 0;
+
+  return idle_move_resize (data);
+}
+
 static gboolean
 idle_move_resize (gpointer data)
 {
   GSList *tmp;
   GSList *copy;
+  GSList *deferred;
+  gint64 start;
   guint queue_index = GPOINTER_TO_INT (data);
 
   meta_topic (META_DEBUG_GEOMETRY, "Clearing the move_resize queue\n");
@@ -5666,6 +5838,12 @@ idle_move_resize (gpointer data)
 
   destroying_windows_disallowed += 1;
 
+  /* Windows that can be seen first, and all of them, since they are
+   * what the next frame shows. Hidden windows, say those on the
+   * workspace being switched away from, only get a time budget; the
+   * rest stay queued and are done once that frame is out, or when
+   * they are shown.
+   */
   tmp = copy;
   while (tmp != NULL)
     {
@@ -5674,13 +5852,52 @@ idle_move_resize (gpointer data)
       window = tmp->data;
 
       /* As a side effect, sets window->move_resize_queued = FALSE */
-      meta_window_move_resize_now (window);
+      if (!window->hidden)
+        meta_window_move_resize_now (window);
+
+      tmp = tmp->next;
+    }
+
+  start = g_get_monotonic_time ();
+  deferred = NULL;
+
+  tmp = copy;
+  while (tmp != NULL)
+    {
+      MetaWindow *window;
+
+      window = tmp->data;
+
+      if (window->hidden)
+        {
+          if ((window->is_in_queues & META_QUEUE_MOVE_RESIZE) &&
+              g_get_monotonic_time () - start >= HIDDEN_MOVE_RESIZE_BUDGET)
+            deferred = g_slist_prepend (deferred, window);
+          else
+            meta_window_move_resize_now (window);
+        }
 
       tmp = tmp->next;
     }
 
   g_slist_free (copy);
 
+  if (deferred)
+    {
+      meta_topic (META_DEBUG_GEOMETRY,
+                  "Deferring move_resize of %d hidden windows\n",
+                  g_slist_length (deferred));
+
+      /* They are still marked as queued */
+      queue_pending[queue_index] = g_slist_concat (deferred,
+                                                   queue_pending[queue_index]);
+
+      if (deferred_move_resize_later == 0)
+        deferred_move_resize_later = meta_later_add (META_LATER_IDLE,
+                                                     idle_deferred_move_resize,
+                                                     data, NULL);
+    }
+
   destroying_windows_disallowed -= 1;
 
   return FALSE;
@@ -7666,6 +7883,83 @@ meta_window_notify_focus (MetaWindow *window,
   return FALSE;
 }
 
+static void
+queue_property_reload (MetaWindow *window,
+                       Atom        property)
+{
+  guint i;
+
+  if (window->pending_properties == NULL)
+    window->pending_properties = g_array_new (FALSE, FALSE, sizeof (Atom));
+
+  /* A newer notification supersedes an older one; we read the
+   * current value either way.
+   */
+  for (i = 0; i < window->pending_properties->len; i++)
+    if (g_array_index (window->pending_properties, Atom, i) == property)
+      return;
+
+  g_array_append_val (window->pending_properties, property);
+  meta_window_queue (window, META_QUEUE_RELOAD_PROPERTIES);
+}
+
+static gboolean
+idle_reload_properties (gpointer data)
+{
+  GSList *tmp;
+  GSList *copy;
+  GPtrArray *windows;
+  GArray *properties;
+  guint queue_index = GPOINTER_TO_INT (data);
+
+  meta_topic (META_DEBUG_WINDOW_STATE, "Clearing the reload_properties queue\n");
+
+  copy = queue_pending[queue_index];
+  queue_pending[queue_index] = NULL;
+  queue_later[queue_index] = 0;
+
+  windows = g_ptr_array_new ();
+  properties = g_array_new (FALSE, FALSE, sizeof (Atom));
+
+  for (tmp = copy; tmp != NULL; tmp = tmp->next)
+    {
+      MetaWindow *window = tmp->data;
+      guint i;
+
+      window->is_in_queues &= ~META_QUEUE_RELOAD_PROPERTIES;
+
+      if (window->pending_properties == NULL)
+        continue;
+
+      for (i = 0; i < window->pending_properties->len; i++)
+        {
+          g_ptr_array_add (windows, window);
+          g_array_append_val (properties,
+                              g_array_index (window->pending_properties,
+                                             Atom, i));
+        }
+
+      g_array_set_size (window->pending_properties, 0);
+    }
+
+  g_slist_free (copy);
+
+  destroying_windows_disallowed += 1;
+
+  if (properties->len > 0)
+    meta_window_reload_properties_multi ((MetaWindow **) windows->pdata,
+                                         (Atom *) properties->data,
+                                         properties->len,
+                                         FALSE);
+
+  destroying_windows_disallowed -= 1;
+
+  g_ptr_array_free (windows, TRUE);
+  g_array_free (properties, TRUE);
+
+  return FALSE;
+}
+
 static gboolean
 process_property_notify (MetaWindow     *window,
                          XPropertyEvent *event)
@@ -7688,6 +7982,17 @@ process_property_notify (MetaWindow     *window,
         xid = window->user_time_window;
     }
 
+  /* Properties that some clients rewrite many times a second are
+   * collected and read once per frame, in a single round trip for
+   * all windows, instead of once per notification.
+   */
+  if (xid == window->xwindow &&
+      meta_window_property_is_deferred (window->display, event->atom))
+    {
+      queue_property_reload (window, event->atom);
+      return TRUE;
+    }
+
   meta_window_reload_property_from_xwindow (window, xid, event->atom, FALSE);
 
   return TRUE;
@@ -7995,6 +8300,8 @@ void
 meta_window_icon_changed (MetaWindow *window)
 {
   g_clear_object (&window->icon);
+  if (window->icons_by_size)
+    g_hash_table_remove_all (window->icons_by_size);
   g_signal_emit (window, window_signals[ICON_CHANGED], 0, window);
 }
 
@@ -8006,6 +8313,9 @@ meta_window_icon_changed (MetaWindow *window)
  * Creates an icon for @window. This is intended to only be used for
  * window-backed apps.
  *
+ * Icons are kept for each size asked for until the window's icon
+ * changes, so asking again for the same size is cheap.
+ *
  * Return value: (transfer none): a #GdkPixbuf, or NULL.
  */
 GdkPixbuf *
@@ -8017,9 +8327,18 @@ meta_window_create_icon (MetaWindow *window,
   if (window->override_redirect)
     return NULL;
 
-  if (window->icon)
-    return window->icon;
+  if (window->icons_by_size)
+    {
+      icon = g_hash_table_lookup (window->icons_by_size,
+                                  GINT_TO_POINTER (size));
+      if (icon)
+        {
+          window->display->n_icon_hits++;
+          return icon;
+        }
+    }
 
+  window->display->n_icon_misses++;
   icon = NULL;
 
   if (meta_read_icons (window->screen,
@@ -8040,6 +8359,12 @@ meta_window_create_icon (MetaWindow *window,
       window->icon = icon;
       window->icon_size = size;
 
+      if (window->icons_by_size == NULL)
+        window->icons_by_size = g_hash_table_new_full (NULL, NULL, NULL,
+                                                       g_object_unref);
+      g_hash_table_replace (window->icons_by_size,
+                            GINT_TO_POINTER (size), g_object_ref (icon));
+
       return icon;
     }
 
@@ -8245,6 +8570,64 @@ meta_window_update_struts (MetaWindow *window)
     }
 }
 
+static long
+client_event_mask (gboolean override_redirect,
+                   gboolean crossing)
+{
+  long event_mask;
+
+  event_mask = PropertyChangeMask | FocusChangeMask | ColormapChangeMask;
+  if (override_redirect)
+    event_mask |= StructureNotifyMask;
+  if (crossing)
+    event_mask |= EnterWindowMask | LeaveWindowMask;
+
+  return event_mask;
+}
+
+/* Crossing events on client windows drive sloppy and mouse focus, the
+ * raising and lowering of docks, and activating the screen the pointer
+ * moves to. Grab ops get theirs from the pointer grab.
+ */
+static gboolean
+window_needs_crossing_events (MetaDisplay    *display,
+                              MetaWindowType  type)
+{
+  return meta_prefs_get_focus_mode () != C_DESKTOP_FOCUS_MODE_CLICK ||
+         type == META_WINDOW_DOCK ||
+         (display->screens != NULL && display->screens->next != NULL);
+}
+
+/**
+ * meta_window_update_crossing_events:
+ * @window: a #MetaWindow
+ *
+ * Selects or deselects EnterNotify and LeaveNotify on the client window
+ * after its type or the focus mode changed.
+ */
+LOCAL_SYMBOL void
+meta_window_update_crossing_events (MetaWindow *window)
+{
+  gboolean crossing;
+
+  if (window->keeps_own_input)
+    return;
+
+  crossing = window_needs_crossing_events (window->display, window->type);
+  if (crossing == window->crossing_events_selected)
+    return;
+
+  meta_verbose ("%s crossing events on %s\n",
+                crossing ? "Selecting" : "Deselecting", window->desc);
+
+  window->crossing_events_selected = crossing;
+
+  meta_error_trap_push (window->display);
+  XSelectInput (window->display->xdisplay, window->xwindow,
+                client_event_mask (window->override_redirect, crossing));
+  meta_error_trap_pop (window->display);
+}
+
 LOCAL_SYMBOL void
 meta_window_recalc_window_type (MetaWindow *window)
 {
@@ -8383,6 +8766,8 @@ recalc_window_type (MetaWindow *window)
 
       meta_window_grab_keys (window);
 
+      meta_window_update_crossing_events (window);
+
       g_object_freeze_notify (object);
 
       if (old_decorated != window->decorated)
@@ -10008,6 +10393,7 @@ typedef struct
   const XEvent *current_event;
   int           count;
   guint32       last_time;
+  gboolean      stopped;
 } EventScannerData;
 
 static Bool
@@ -10017,6 +10403,24 @@ find_last_time_predicate (Display  *display,
 {
   EventScannerData *esd = (void*) arg;
 
+  if (esd->stopped)
+    return False;
+
+  /* Don't skip motion past a button or key event; the grab op has to
+   * see the pointer where it was when that happened */
+  switch (xevent->type)
+    {
+    case ButtonPress:
+    case ButtonRelease:
+    case KeyPress:
+    case KeyRelease:
+      esd->stopped = TRUE;
+      return False;
+
+    default:
+      break;
+    }
+
   if (esd->current_event->type == xevent->type &&
       esd->current_event->xany.window == xevent->xany.window)
     {
@@ -10056,6 +10460,7 @@ check_use_this_motion_notify (MetaWindow *window,
   esd.current_event = event;
   esd.count = 0;
   esd.last_time = 0;
+  esd.stopped = FALSE;
 
   /* "useless" isn't filled in because the predicate never returns True */
   XCheckIfEvent (window->display->xdisplay,
@@ -10100,6 +10505,53 @@ update_tile_mode (MetaWindow *window)
     }
 }
 
+/* Whether the motion of mouse moves and resizes is applied once per
+ * frame, rather than for every MotionNotify */
+static gboolean
+grab_motion_syncs_to_frame (void)
+{
+  static int syncs = -1;
+
+  if (syncs < 0)
+    syncs = g_getenv ("META_DISABLE_FRAME_SYNC_GRAB_OPS") == NULL;
+
+  return syncs;
+}
+
+static void
+schedule_grab_motion (MetaWindow *window)
+{
+  MetaDisplay *display = window->display;
+  ClutterActor *actor;
+
+  if (display->grab_motion_pending)
+    return;
+
+  display->grab_motion_pending = TRUE;
+
+  /* make sure there is a frame to apply the motion in; the window is
+   * going to be redrawn when it moves or resizes anyway */
+  actor = CLUTTER_ACTOR (meta_window_get_compositor_private (window));
+  if (actor != NULL)
+    clutter_actor_queue_redraw (actor);
+}
+
+static void
+queue_grab_motion (MetaWindow *window,
+                   XEvent     *event)
+{
+  MetaDisplay *display = window->display;
+
+  display->grab_latest_motion_x = event->xmotion.x_root;
+  display->grab_latest_motion_y = event->xmotion.y_root;
+  display->grab_motion_pending_shift =
+    (event->xmotion.state & ShiftMask) != 0;
+  display->grab_motion_pending_snap =
+    (event->xmotion.state & get_mask_from_snap_keysym (window)) != 0;
+
+  schedule_grab_motion (window);
+}
+
 #ifdef HAVE_XSYNC
 void
 meta_window_update_sync_request_counter (MetaWindow *window,
@@ -10132,13 +10584,24 @@ meta_window_update_sync_request_counter (MetaWindow *window,
       g_source_remove (window->sync_request_timeout_id);
       window->sync_request_timeout_id = 0;
 
-      /* This means we are ready for another configure;
-       * no pointer round trip here, to keep in sync */
-      update_resize (window,
-                     window->display->grab_last_user_action_was_snap,
-                     window->display->grab_latest_motion_x,
-                     window->display->grab_latest_motion_y,
-                     TRUE);
+      /* This means we are ready for another configure. It goes out
+       * with the next frame, like the motion, so however fast the
+       * client redraws it gets at most one a frame, and as slowly as
+       * it redraws */
+      if (grab_motion_syncs_to_frame ())
+        {
+          if (!window->display->grab_motion_pending)
+            window->display->grab_motion_pending_shift =
+              window->display->grab_last_user_action_was_snap;
+          schedule_grab_motion (window);
+        }
+      else
+        /* no pointer round trip here, to keep in sync */
+        update_resize (window,
+                       window->display->grab_last_user_action_was_snap,
+                       window->display->grab_latest_motion_x,
+                       window->display->grab_latest_motion_y,
+                       TRUE);
     }
 
   /* If sync was previously disabled, turn it back on and hope
@@ -10153,6 +10616,39 @@ meta_window_update_sync_request_counter (MetaWindow *window,
 }
 #endif /* HAVE_XSYNC */
 
+/**
+ * meta_window_flush_grab_motion:
+ * @window: the window being moved or resized
+ *
+ * Applies the latest pointer motion of the mouse move or resize of
+ * @window, if one arrived since the last frame. Called by the
+ * compositor before painting, so that at most one constrain and
+ * configure happens per frame however fast the pointer reports motion.
+ */
+LOCAL_SYMBOL void
+meta_window_flush_grab_motion (MetaWindow *window)
+{
+  MetaDisplay *display = window->display;
+
+  if (!display->grab_motion_pending)
+    return;
+
+  display->grab_motion_pending = FALSE;
+
+  if (meta_grab_op_is_moving (display->grab_op))
+    update_move (window,
+                 display->grab_motion_pending_shift,
+                 display->grab_motion_pending_snap,
+                 display->grab_latest_motion_x,
+                 display->grab_latest_motion_y);
+  else if (meta_grab_op_is_resizing (display->grab_op))
+    update_resize (window,
+                   display->grab_motion_pending_shift,
+                   display->grab_latest_motion_x,
+                   display->grab_latest_motion_y,
+                   FALSE);
+}
+
 LOCAL_SYMBOL void
 meta_window_handle_mouse_grab_op_event (MetaWindow *window,
                                         XEvent     *event)
@@ -10208,6 +10704,9 @@ meta_window_handle_mouse_grab_op_event (MetaWindow *window,
   switch (event->type)
     {
     case ButtonRelease:
+      /* the release has the final position */
+      window->display->grab_motion_pending = FALSE;
+
       meta_display_check_threshold_reached (window->display,
                                             event->xbutton.x_root,
                                             event->xbutton.y_root);
@@ -10267,7 +10766,14 @@ meta_window_handle_mouse_grab_op_event (MetaWindow *window,
       meta_display_check_threshold_reached (window->display,
                                             event->xmotion.x_root,
                                             event->xmotion.y_root);
-      if (meta_grab_op_is_moving (window->display->grab_op))
+      if (event->xmotion.root == window->screen->xroot &&
+          grab_motion_syncs_to_frame () &&
+          (meta_grab_op_is_moving (window->display->grab_op) ||
+           meta_grab_op_is_resizing (window->display->grab_op)))
+        {
+          queue_grab_motion (window, event);
+        }
+      else if (meta_grab_op_is_moving (window->display->grab_op))
         {
           if (event->xmotion.root == window->screen->xroot)
             {
@@ -10853,6 +11359,16 @@ meta_window_is_ancestor_of_transient (MetaWindow *window,
 /* Warp pointer to location appropriate for grab,
  * return root coordinates where pointer ended up.
  */
+static void
+warp_pointer_checked (MetaDisplay *display,
+                      int          error_code,
+                      gpointer     user_data)
+{
+  if (error_code != Success)
+    meta_verbose ("Failed to warp pointer for window 0x%lx\n",
+                  (Window) GPOINTER_TO_SIZE (user_data));
+}
+
 static gboolean
 warp_grab_pointer (MetaWindow          *window,
                    MetaGrabOp           grab_op,
@@ -10928,7 +11444,7 @@ warp_grab_pointer (MetaWindow          *window,
   *x = CLAMP (*x, 0, window->screen->rect.width-1);
   *y = CLAMP (*y, 0, window->screen->rect.height-1);
 
-  meta_error_trap_push_with_return (display);
+  meta_error_trap_push (display);
 
   meta_topic (META_DEBUG_WINDOW_OPS,
               "Warping pointer to %d,%d with window at %d,%d\n",
@@ -10951,12 +11467,9 @@ warp_grab_pointer (MetaWindow          *window,
                 0, 0, 0, 0,
                 *x, *y);
 
-  if (meta_error_trap_pop_with_return (display) != Success)
-    {
-      meta_verbose ("Failed to warp pointer for window %s\n",
-                    window->desc);
-      return FALSE;
-    }
+  /* Nothing waits for the warp, so failures are only logged */
+  meta_error_trap_pop_async (display, warp_pointer_checked,
+                             GSIZE_TO_POINTER (window->xwindow), NULL);
 
   return TRUE;
 }
@@ -11591,7 +12104,7 @@ meta_window_get_wm_class_instance (MetaWindow *window)
 const char *
 meta_window_get_gtk_application_id (MetaWindow *window)
 {
-  return window->gtk_application_id;
+  return window->gtk ? window->gtk->application_id : NULL;
 }
 
 /**
@@ -11603,7 +12116,7 @@ meta_window_get_gtk_application_id (MetaWindow *window)
 const char *
 meta_window_get_gtk_unique_bus_name (MetaWindow *window)
 {
-  return window->gtk_unique_bus_name;
+  return window->gtk ? window->gtk->unique_bus_name : NULL;
 }
 
 /**
@@ -11615,7 +12128,7 @@ meta_window_get_gtk_unique_bus_name (MetaWindow *window)
 const char *
 meta_window_get_gtk_application_object_path (MetaWindow *window)
 {
-  return window->gtk_application_object_path;
+  return window->gtk ? window->gtk->application_object_path : NULL;
 }
 
 /**
@@ -11627,7 +12140,7 @@ meta_window_get_gtk_application_object_path (MetaWindow *window)
 const char *
 meta_window_get_gtk_window_object_path (MetaWindow *window)
 {
-  return window->gtk_window_object_path;
+  return window->gtk ? window->gtk->window_object_path : NULL;
 }
 
 /**
@@ -11639,7 +12152,7 @@ meta_window_get_gtk_window_object_path (MetaWindow *window)
 const char *
 meta_window_get_gtk_app_menu_object_path (MetaWindow *window)
 {
-  return window->gtk_app_menu_object_path;
+  return window->gtk ? window->gtk->app_menu_object_path : NULL;
 }
 
 /**
@@ -11651,7 +12164,7 @@ meta_window_get_gtk_app_menu_object_path (MetaWindow *window)
 const char *
 meta_window_get_gtk_menubar_object_path (MetaWindow *window)
 {
-  return window->gtk_menubar_object_path;
+  return window->gtk ? window->gtk->menubar_object_path : NULL;
 }
 
 /**
@@ -60,6 +60,7 @@ struct _MetaWorkspace
   MetaRectangle *work_area_monitor;
   GList  *screen_region;
   GList  **monitor_region;
+  MetaRectangle *monitor_region_rects;
   gint n_monitor_regions;
   GList  *screen_edges;
   GList  *monitor_edges;
@@ -68,6 +69,11 @@ struct _MetaWorkspace
   GList *snapped_windows;
   guint work_areas_invalid : 1;
 
+  /* For the WORKAREA debug topic */
+  guint n_work_area_invalidations;
+  guint n_work_area_validations;
+  guint n_work_area_shares;
+
   guint showing_desktop : 1;
 };
 
@@ -193,6 +193,8 @@ meta_workspace_new (MetaScreen *screen)
 
   workspace->screen_region = NULL;
   workspace->monitor_region = NULL;
+  workspace->monitor_region_rects = NULL;
+  workspace->n_monitor_regions = 0;
   workspace->screen_edges = NULL;
   workspace->monitor_edges = NULL;
   workspace->list_containing_self = g_list_prepend (NULL, workspace);
@@ -248,7 +250,6 @@ LOCAL_SYMBOL void
 meta_workspace_remove (MetaWorkspace *workspace)
 {
   GList *tmp;
-  MetaScreen *screen;
   int i;
 
   g_return_if_fail (workspace != workspace->screen->active_workspace);
@@ -273,13 +274,9 @@ meta_workspace_remove (MetaWorkspace *workspace)
 
   g_assert (workspace->windows == NULL);
 
-  screen = workspace->screen;
-
   workspace->screen->workspaces =
     g_list_remove (workspace->screen->workspaces, workspace);
 
-  free (workspace->work_area_monitor);
-
   g_list_free (workspace->mru_list);
   g_list_free (workspace->list_containing_self);
 
@@ -287,21 +284,19 @@ meta_workspace_remove (MetaWorkspace *workspace)
 
   /* screen.c:update_num_workspaces(), which calls us, removes windows from
    * workspaces first, which can cause the workareas on the workspace to be
-   * invalidated (and hence for struts/regions/edges to be freed).
-   * So, no point trying to double free it; that causes a crash
-   * anyway.  #361804.
+   * invalidated.  That only frees the screen region and edges, which are
+   * NULL then, and keeps the struts and monitor regions for reuse.
    */
 
-  if (!workspace->work_areas_invalid)
-    {
-      workspace_free_all_struts (workspace);
-      for (i = 0; i < screen->n_monitor_infos; i++)
-        meta_rectangle_free_list_and_elements (workspace->monitor_region[i]);
-      free (workspace->monitor_region);
-      meta_rectangle_free_list_and_elements (workspace->screen_region);
-      meta_rectangle_free_list_and_elements (workspace->screen_edges);
-      meta_rectangle_free_list_and_elements (workspace->monitor_edges);
-    }
+  workspace_free_all_struts (workspace);
+  for (i = 0; i < workspace->n_monitor_regions; i++)
+    meta_rectangle_free_list_and_elements (workspace->monitor_region[i]);
+  free (workspace->monitor_region);
+  free (workspace->monitor_region_rects);
+  free (workspace->work_area_monitor);
+  meta_rectangle_free_list_and_elements (workspace->screen_region);
+  meta_rectangle_free_list_and_elements (workspace->screen_edges);
+  meta_rectangle_free_list_and_elements (workspace->monitor_edges);
 
   g_object_unref (workspace);
 
@@ -832,7 +827,6 @@ meta_workspace_invalidate_work_area (MetaWorkspace *workspace)
 {
   GList *tmp;
   GList *windows;
-  int i;
 
   if (workspace->work_areas_invalid)
     {
@@ -851,23 +845,19 @@ meta_workspace_invalidate_work_area (MetaWorkspace *workspace)
   if (workspace == workspace->screen->active_workspace)
     meta_display_cleanup_edges (workspace->screen->display);
 
-  free (workspace->work_area_monitor);
-  workspace->work_area_monitor = NULL;
-
-  workspace_free_all_struts (workspace);
-
-  for (i = 0; i < workspace->screen->n_monitor_infos; i++)
-    meta_rectangle_free_list_and_elements (workspace->monitor_region[i]);
-  free (workspace->monitor_region);
+  /* The struts and per-monitor results are kept until the next
+   * validation, which reuses those of the monitors the change didn't
+   * affect.
+   */
   meta_rectangle_free_list_and_elements (workspace->screen_region);
   meta_rectangle_free_list_and_elements (workspace->screen_edges);
   meta_rectangle_free_list_and_elements (workspace->monitor_edges);
-  workspace->monitor_region = NULL;
   workspace->screen_region = NULL;
   workspace->screen_edges = NULL;
   workspace->monitor_edges = NULL;
 
   workspace->work_areas_invalid = TRUE;
+  workspace->n_work_area_invalidations++;
 
   /* redo the size/position constraints on all windows */
   windows = meta_workspace_list_windows (workspace);
@@ -906,23 +896,159 @@ copy_strut_list(GSList *original)
   return g_slist_reverse (result);
 }
 
+static gboolean
+strut_lists_equal (GSList *l,
+                   GSList *m)
+{
+  for (; l && m; l = l->next, m = m->next)
+    {
+      MetaStrut *a = l->data;
+      MetaStrut *b = m->data;
+
+      if (a->side != b->side ||
+          !meta_rectangle_equal (&a->rect, &b->rect))
+        return FALSE;
+    }
+
+  return l == NULL && m == NULL;
+}
+
+/* Whether the struts that can affect @monitor_rect are the same in both
+ * lists; the others don't change its spanning set or work area.
+ */
+static gboolean
+monitor_struts_equal (GSList              *l,
+                      GSList              *m,
+                      const MetaRectangle *monitor_rect)
+{
+  while (TRUE)
+    {
+      MetaStrut *a, *b;
+
+      while (l && !meta_rectangle_overlap (&((MetaStrut *) l->data)->rect,
+                                           monitor_rect))
+        l = l->next;
+      while (m && !meta_rectangle_overlap (&((MetaStrut *) m->data)->rect,
+                                           monitor_rect))
+        m = m->next;
+
+      if (l == NULL || m == NULL)
+        return l == NULL && m == NULL;
+
+      a = l->data;
+      b = m->data;
+      if (a->side != b->side ||
+          !meta_rectangle_equal (&a->rect, &b->rect))
+        return FALSE;
+
+      l = l->next;
+      m = m->next;
+    }
+}
+
+static GList *
+copy_rect_list (GList *original,
+                gsize  element_size)
+{
+  GList *result = NULL;
+
+  while (original)
+    {
+      result = g_list_prepend (result, g_memdup (original->data, element_size));
+      original = original->next;
+    }
+
+  return g_list_reverse (result);
+}
+
+/* Returns another workspace of the same screen whose work areas are
+ * valid and were computed from the same struts, if there is one.  This
+ * is the common case of panels that are on all workspaces.
+ */
+static MetaWorkspace *
+find_workspace_with_same_struts (MetaWorkspace *workspace)
+{
+  GList *l;
+
+  for (l = workspace->screen->workspaces; l != NULL; l = l->next)
+    {
+      MetaWorkspace *other = l->data;
+
+      if (other != workspace &&
+          !other->work_areas_invalid &&
+          other->n_monitor_regions == workspace->screen->n_monitor_infos &&
+          strut_lists_equal (other->all_struts, workspace->all_struts))
+        return other;
+    }
+
+  return NULL;
+}
+
+static void
+copy_work_areas (MetaWorkspace *workspace,
+                 MetaWorkspace *other)
+{
+  int i, n = other->n_monitor_regions;
+
+  workspace->n_monitor_regions = n;
+  workspace->monitor_region = g_new (GList*, n);
+  workspace->monitor_region_rects = g_memdup (other->monitor_region_rects,
+                                              n * sizeof (MetaRectangle));
+  workspace->work_area_monitor = g_memdup (other->work_area_monitor,
+                                           n * sizeof (MetaRectangle));
+  for (i = 0; i < n; i++)
+    workspace->monitor_region[i] = copy_rect_list (other->monitor_region[i],
+                                                   sizeof (MetaRectangle));
+
+  workspace->work_area_screen = other->work_area_screen;
+  workspace->screen_region = copy_rect_list (other->screen_region,
+                                             sizeof (MetaRectangle));
+  workspace->screen_edges = copy_rect_list (other->screen_edges,
+                                            sizeof (MetaEdge));
+  workspace->monitor_edges = copy_rect_list (other->monitor_edges,
+                                             sizeof (MetaEdge));
+}
+
 static void
 ensure_work_areas_validated (MetaWorkspace *workspace)
 {
   GList         *windows;
   GList         *tmp;
   MetaRectangle  work_area;
+  MetaWorkspace *other;
+  GSList        *old_struts;
+  GList        **old_monitor_region;
+  MetaRectangle *old_monitor_rects;
+  MetaRectangle *old_work_area_monitor;
+  int            n_old_monitors;
+  int            n_reused_monitors;
   int            i;  /* C89 absolutely sucks... */
 
   if (!workspace->work_areas_invalid)
     return;
 
-  g_assert (workspace->all_struts == NULL);
-  g_assert (workspace->monitor_region == NULL);
   g_assert (workspace->screen_region == NULL);
   g_assert (workspace->screen_edges == NULL);
   g_assert (workspace->monitor_edges == NULL);
 
+  /* The per-monitor results of the last validation are kept across the
+   * invalidation, so that monitors that no changed strut touches can keep
+   * theirs.
+   */
+  old_struts = workspace->all_struts;
+  old_monitor_region = workspace->monitor_region;
+  old_monitor_rects = workspace->monitor_region_rects;
+  old_work_area_monitor = workspace->work_area_monitor;
+  n_old_monitors = workspace->n_monitor_regions;
+  workspace->all_struts = NULL;
+  workspace->monitor_region = NULL;
+  workspace->monitor_region_rects = NULL;
+  workspace->work_area_monitor = NULL;
+  workspace->n_monitor_regions = 0;
+  n_reused_monitors = 0;
+
+  workspace->n_work_area_validations++;
+
   /* STEP 1: Get the list of struts */
 
   workspace->all_struts = copy_strut_list (workspace->builtin_struts);
@@ -940,29 +1066,84 @@ ensure_work_areas_validated (MetaWorkspace *workspace)
     }
   g_list_free (windows);
 
-  /* STEP 2: Get the maximal/spanning rects for the onscreen and
-   *         on-single-monitor regions
+  /* If another workspace already did the work for these struts, just
+   * take its results.
    */
-  g_assert (workspace->monitor_region == NULL);
-  g_assert (workspace->screen_region   == NULL);
+  other = find_workspace_with_same_struts (workspace);
+  if (other != NULL)
+    {
+      meta_topic (META_DEBUG_WORKAREA,
+                  "Sharing the work areas of workspace %d with workspace %d\n",
+                  meta_workspace_index (other),
+                  meta_workspace_index (workspace));
+      copy_work_areas (workspace, other);
+      workspace->n_work_area_shares++;
+      goto out;
+    }
 
+  /* STEP 2: Get the maximal/spanning rects for the onscreen and
+   *         on-single-monitor regions, and the work areas of the monitors
+   */
+  workspace->n_monitor_regions = workspace->screen->n_monitor_infos;
   workspace->monitor_region = g_new (GList*,
                                       workspace->screen->n_monitor_infos);
+  workspace->monitor_region_rects = g_new (MetaRectangle,
+                                            workspace->screen->n_monitor_infos);
+  workspace->work_area_monitor = g_new (MetaRectangle,
+                                         workspace->screen->n_monitor_infos);
   for (i = 0; i < workspace->screen->n_monitor_infos; i++)
     {
+      const MetaRectangle *monitor_rect =
+        &workspace->screen->monitor_infos[i].rect;
+
+      workspace->monitor_region_rects[i] = *monitor_rect;
+
+      if (i < n_old_monitors &&
+          meta_rectangle_equal (&old_monitor_rects[i], monitor_rect) &&
+          monitor_struts_equal (old_struts, workspace->all_struts,
+                                monitor_rect))
+        {
+          workspace->monitor_region[i] = old_monitor_region[i];
+          old_monitor_region[i] = NULL;
+          workspace->work_area_monitor[i] = old_work_area_monitor[i];
+          n_reused_monitors++;
+          continue;
+        }
+
       workspace->monitor_region[i] =
         meta_rectangle_get_minimal_spanning_set_for_region (
-          &workspace->screen->monitor_infos[i].rect,
+          monitor_rect,
           workspace->all_struts);
+
+      work_area = *monitor_rect;
+
+      if (workspace->monitor_region[i] == NULL)
+        /* FIXME: constraints.c untested with this, but it might be nice for
+         * a screen reader or magnifier.
+         */
+        work_area = meta_rect (work_area.x, work_area.y, -1, -1);
+      else
+        meta_rectangle_clip_to_region (workspace->monitor_region[i],
+                                       FIXED_DIRECTION_NONE,
+                                       &work_area);
+
+      workspace->work_area_monitor[i] = work_area;
+      meta_topic (META_DEBUG_WORKAREA,
+                  "Computed work area for workspace %d "
+                  "monitor %d: %d,%d %d x %d\n",
+                  meta_workspace_index (workspace),
+                  i,
+                  workspace->work_area_monitor[i].x,
+                  workspace->work_area_monitor[i].y,
+                  workspace->work_area_monitor[i].width,
+                  workspace->work_area_monitor[i].height);
     }
   workspace->screen_region =
     meta_rectangle_get_minimal_spanning_set_for_region (
       &workspace->screen->rect,
       workspace->all_struts);
 
-  /* STEP 3: Get the work areas (region-to-maximize-to) for the screen and
-   *         monitors.
-   */
+  /* STEP 3: Get the work area (region-to-maximize-to) for the screen. */
   work_area = workspace->screen->rect;  /* start with the screen */
   if (workspace->screen_region == NULL)
     work_area = meta_rect (0, 0, -1, -1);
@@ -1016,37 +1197,6 @@ ensure_work_areas_validated (MetaWorkspace *workspace)
               workspace->work_area_screen.width,
               workspace->work_area_screen.height);
 
-  /* Now find the work areas for each monitor */
-  free (workspace->work_area_monitor);
-  workspace->work_area_monitor = g_new (MetaRectangle,
-                                         workspace->screen->n_monitor_infos);
-
-  for (i = 0; i < workspace->screen->n_monitor_infos; i++)
-    {
-      work_area = workspace->screen->monitor_infos[i].rect;
-
-      if (workspace->monitor_region[i] == NULL)
-        /* FIXME: constraints.c untested with this, but it might be nice for
-         * a screen reader or magnifier.
-         */
-        work_area = meta_rect (work_area.x, work_area.y, -1, -1);
-      else
-        meta_rectangle_clip_to_region (workspace->monitor_region[i],
-                                       FIXED_DIRECTION_NONE,
-                                       &work_area);
-
-      workspace->work_area_monitor[i] = work_area;
-      meta_topic (META_DEBUG_WORKAREA,
-                  "Computed work area for workspace %d "
-                  "monitor %d: %d,%d %d x %d\n",
-                  meta_workspace_index (workspace),
-                  i,
-                  workspace->work_area_monitor[i].x,
-                  workspace->work_area_monitor[i].y,
-                  workspace->work_area_monitor[i].width,
-                  workspace->work_area_monitor[i].height);
-    }
-
   /* STEP 4: Make sure the screen_region is nonempty (separate from step 2
    *         since it relies on step 3).
    */
@@ -1059,8 +1209,6 @@ ensure_work_areas_validated (MetaWorkspace *workspace)
     }
 
   /* STEP 5: Cache screen and monitor edges for edge resistance and snapping */
-  g_assert (workspace->screen_edges    == NULL);
-  g_assert (workspace->monitor_edges  == NULL);
   workspace->screen_edges =
     meta_rectangle_find_onscreen_edges (&workspace->screen->rect,
                                         workspace->all_struts);
@@ -1072,25 +1220,25 @@ ensure_work_areas_validated (MetaWorkspace *workspace)
                                                        workspace->all_struts);
   g_list_free (tmp);
 
-  /* We're all done, YAAY!  Record that everything has been validated. */
-  workspace->work_areas_invalid = FALSE;
-}
+ out:
+  for (i = 0; i < n_old_monitors; i++)
+    meta_rectangle_free_list_and_elements (old_monitor_region[i]);
+  free (old_monitor_region);
+  free (old_monitor_rects);
+  free (old_work_area_monitor);
+  g_slist_free_full (old_struts, free);
 
-static gboolean
-strut_lists_equal (GSList *l,
-                   GSList *m)
-{
-  for (; l && m; l = l->next, m = m->next)
-    {
-      MetaStrut *a = l->data;
-      MetaStrut *b = m->data;
-
-      if (a->side != b->side ||
-          !meta_rectangle_equal (&a->rect, &b->rect))
-        return FALSE;
-    }
+  meta_topic (META_DEBUG_WORKAREA,
+              "Validated work areas for workspace %d, reusing %d of %d "
+              "monitors; %u invalidations, %u validations, %u shared\n",
+              meta_workspace_index (workspace),
+              n_reused_monitors, workspace->n_monitor_regions,
+              workspace->n_work_area_invalidations,
+              workspace->n_work_area_validations,
+              workspace->n_work_area_shares);
 
-  return l == NULL && m == NULL;
+  /* We're all done, YAAY!  Record that everything has been validated. */
+  workspace->work_areas_invalid = FALSE;
 }
 
 /**
@@ -184,6 +184,9 @@ get_property (MetaDisplay        *display,
               Atom                req_type,
               GetPropertyResults *results)
 {
+  gint64 start;
+  int status;
+
   results->display = display;
   results->xwindow = xwindow;
   results->xatom = xatom;
@@ -194,13 +197,19 @@ get_property (MetaDisplay        *display,
   results->format = 0;
 
   meta_error_trap_push_with_return (display);
-  if (XGetWindowProperty (display->xdisplay, xwindow, xatom,
-                          0, G_MAXLONG,
-                          False, req_type, &results->type, &results->format,
-                          &results->n_items,
-                          &results->bytes_after,
-                          &results->prop) != Success ||
-      results->type == None)
+  start = meta_request_profiler_begin (display->request_profiler);
+  status = XGetWindowProperty (display->xdisplay, xwindow, xatom,
+                               0, G_MAXLONG,
+                               False, req_type, &results->type, &results->format,
+                               &results->n_items,
+                               &results->bytes_after,
+                               &results->prop);
+  meta_request_profiler_end (display->request_profiler,
+                             META_REQUEST_GET_WINDOW_PROPERTY,
+                             META_REQUEST_CALLER, start);
+  meta_display_note_round_trip (display);
+
+  if (status != Success || results->type == None)
     {
       if (results->prop)
         XFree (results->prop);
@@ -968,257 +977,454 @@ latin1_to_utf8 (const char *text)
   return g_string_free (str, FALSE);
 }
 
-LOCAL_SYMBOL void
-meta_prop_get_values (MetaDisplay   *display,
-                      Window         xwindow,
-                      MetaPropValue *values,
-                      int            n_values)
+/* Fills in the type we will accept for a value whose caller didn't ask
+ * for a particular one.
+ */
+static void
+init_required_type (MetaDisplay   *display,
+                    MetaPropValue *value)
 {
-  int i;
-  AgGetPropertyTask **tasks;
+  if (value->required_type != None)
+    return;
 
-  meta_verbose ("Requesting %d properties of 0x%lx at once\n",
-                n_values, xwindow);
+  switch (value->type)
+    {
+    case META_PROP_VALUE_INVALID:
+      /* This means we don't really want a value, e.g. got
+       * property notify on an atom we don't care about.
+       */
+      if (value->atom != None)
+        meta_bug ("META_PROP_VALUE_INVALID requested in %s\n", G_STRFUNC);
+      break;
+    case META_PROP_VALUE_UTF8_LIST:
+    case META_PROP_VALUE_UTF8:
+      value->required_type = display->atom_UTF8_STRING;
+      break;
+    case META_PROP_VALUE_STRING:
+    case META_PROP_VALUE_STRING_AS_UTF8:
+      value->required_type = XA_STRING;
+      break;
+    case META_PROP_VALUE_MOTIF_HINTS:
+      value->required_type = AnyPropertyType;
+      break;
+    case META_PROP_VALUE_CARDINAL_LIST:
+    case META_PROP_VALUE_CARDINAL:
+      value->required_type = XA_CARDINAL;
+      break;
+    case META_PROP_VALUE_WINDOW:
+      value->required_type = XA_WINDOW;
+      break;
+    case META_PROP_VALUE_ATOM_LIST:
+      value->required_type = XA_ATOM;
+      break;
+    case META_PROP_VALUE_TEXT_PROPERTY:
+      value->required_type = AnyPropertyType;
+      break;
+    case META_PROP_VALUE_WM_HINTS:
+      value->required_type = XA_WM_HINTS;
+      break;
+    case META_PROP_VALUE_CLASS_HINT:
+      value->required_type = XA_STRING;
+      break;
+    case META_PROP_VALUE_SIZE_HINTS:
+      value->required_type = XA_WM_SIZE_HINTS;
+      break;
+    case META_PROP_VALUE_SYNC_COUNTER:
+    case META_PROP_VALUE_SYNC_COUNTER_LIST:
+	      value->required_type = XA_CARDINAL;
+      break;
+    }
+}
 
-  if (n_values == 0)
-    return;
+/* Collects the reply of a completed task and converts it into "value",
+ * freeing the task.  A NULL task leaves the value invalid.
+ */
+static void
+value_from_task (MetaDisplay       *display,
+                 Window             xwindow,
+                 AgGetPropertyTask *task,
+                 MetaPropValue     *value)
+{
+  GetPropertyResults results;
 
-  tasks = g_new0 (AgGetPropertyTask*, n_values);
+  if (task == NULL)
+    {
+      /* Probably value->type was None, or ag_task_create()
+       * returned NULL.
+       */
+      value->type = META_PROP_VALUE_INVALID;
+      return;
+    }
 
-  /* Start up tasks. The "values" array can have values
-   * with atom == None, which means to ignore that element.
-   */
-  i = 0;
-  while (i < n_values)
+  g_assert (ag_task_have_reply (task));
+
+  results.display = display;
+  results.xwindow = xwindow;
+  results.xatom = value->atom;
+  results.prop = NULL;
+  results.n_items = 0;
+  results.type = None;
+  results.bytes_after = 0;
+  results.format = 0;
+
+  if (ag_task_get_reply_and_free (task,
+                                  &results.type, &results.format,
+                                  &results.n_items,
+                                  &results.bytes_after,
+                                  &results.prop) != Success ||
+      results.type == None)
+    {
+      value->type = META_PROP_VALUE_INVALID;
+      if (results.prop)
+        {
+          XFree (results.prop);
+          results.prop = NULL;
+        }
+      return;
+    }
+
+  switch (value->type)
     {
-      if (values[i].required_type == None)
+    case META_PROP_VALUE_INVALID:
+      g_assert_not_reached ();
+      break;
+    case META_PROP_VALUE_UTF8_LIST:
+      if (!utf8_list_from_results (&results,
+                                   &value->v.string_list.strings,
+                                   &value->v.string_list.n_strings))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_UTF8:
+      if (!utf8_string_from_results (&results,
+                                     &value->v.str))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_STRING:
+      if (!latin1_string_from_results (&results,
+                                       &value->v.str))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_STRING_AS_UTF8:
+      if (!latin1_string_from_results (&results,
+                                       &value->v.str))
+        value->type = META_PROP_VALUE_INVALID;
+      else
         {
-          switch (values[i].type)
+          char *new_str;
+          char *xmalloc_new_str;
+
+          new_str = latin1_to_utf8 (value->v.str);
+          xmalloc_new_str = ag_Xmalloc (strlen (new_str) + 1);
+          if (xmalloc_new_str != NULL)
             {
-            case META_PROP_VALUE_INVALID:
-              /* This means we don't really want a value, e.g. got
-               * property notify on an atom we don't care about.
-               */
-              if (values[i].atom != None)
-                meta_bug ("META_PROP_VALUE_INVALID requested in %s\n", G_STRFUNC);
-              break;
-            case META_PROP_VALUE_UTF8_LIST:
-            case META_PROP_VALUE_UTF8:
-              values[i].required_type = display->atom_UTF8_STRING;
-              break;
-            case META_PROP_VALUE_STRING:
-            case META_PROP_VALUE_STRING_AS_UTF8:
-              values[i].required_type = XA_STRING;
-              break;
-            case META_PROP_VALUE_MOTIF_HINTS:
-              values[i].required_type = AnyPropertyType;
-              break;
-            case META_PROP_VALUE_CARDINAL_LIST:
-            case META_PROP_VALUE_CARDINAL:
-              values[i].required_type = XA_CARDINAL;
-              break;
-            case META_PROP_VALUE_WINDOW:
-              values[i].required_type = XA_WINDOW;
-              break;
-            case META_PROP_VALUE_ATOM_LIST:
-              values[i].required_type = XA_ATOM;
-              break;
-            case META_PROP_VALUE_TEXT_PROPERTY:
-              values[i].required_type = AnyPropertyType;
-              break;
-            case META_PROP_VALUE_WM_HINTS:
-              values[i].required_type = XA_WM_HINTS;
-              break;
-            case META_PROP_VALUE_CLASS_HINT:
-              values[i].required_type = XA_STRING;
-              break;
-            case META_PROP_VALUE_SIZE_HINTS:
-              values[i].required_type = XA_WM_SIZE_HINTS;
-              break;
-            case META_PROP_VALUE_SYNC_COUNTER:
-            case META_PROP_VALUE_SYNC_COUNTER_LIST:
-	      values[i].required_type = XA_CARDINAL;
-              break;
+              strcpy (xmalloc_new_str, new_str);
+              meta_XFree (value->v.str);
+              value->v.str = xmalloc_new_str;
             }
+
+          free (new_str);
+        }
+      break;
+    case META_PROP_VALUE_MOTIF_HINTS:
+      if (!motif_hints_from_results (&results,
+                                     &value->v.motif_hints))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_CARDINAL_LIST:
+      if (!cardinal_list_from_results (&results,
+                                       &value->v.cardinal_list.cardinals,
+                                       &value->v.cardinal_list.n_cardinals))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_CARDINAL:
+      if (!cardinal_with_atom_type_from_results (&results,
+                                                 value->required_type,
+                                                 &value->v.cardinal))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_WINDOW:
+      if (!window_from_results (&results,
+                                &value->v.xwindow))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_ATOM_LIST:
+      if (!atom_list_from_results (&results,
+                                   &value->v.atom_list.atoms,
+                                   &value->v.atom_list.n_atoms))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_TEXT_PROPERTY:
+      if (!text_property_from_results (&results, &value->v.str))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_WM_HINTS:
+      if (!wm_hints_from_results (&results, &value->v.wm_hints))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_CLASS_HINT:
+      if (!class_hint_from_results (&results, &value->v.class_hint))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_SIZE_HINTS:
+      if (!size_hints_from_results (&results,
+                                    &value->v.size_hints.hints,
+                                    &value->v.size_hints.flags))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+#ifdef HAVE_XSYNC
+    case META_PROP_VALUE_SYNC_COUNTER:
+      if (!counter_from_results (&results,
+                                 &value->v.xcounter))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+    case META_PROP_VALUE_SYNC_COUNTER_LIST:
+      if (!counter_list_from_results (&results,
+                                      &value->v.xcounter_list.counters,
+                                      &value->v.xcounter_list.n_counters))
+        value->type = META_PROP_VALUE_INVALID;
+      break;
+#else
+    case META_PROP_VALUE_SYNC_COUNTER:
+    case META_PROP_VALUE_SYNC_COUNTER_LIST:
+      value->type = META_PROP_VALUE_INVALID;
+      if (results.prop)
+        {
+          XFree (results.prop);
+          results.prop = NULL;
         }
+      break;
+#endif
+    }
+}
 
-      if (values[i].atom != None)
-        tasks[i] = get_task (display, xwindow,
-                             values[i].atom, values[i].required_type);
+typedef struct
+{
+  Window             xwindow;
+  Atom               atom;
+  Atom               required_type;
+  AgGetPropertyTask *task;
+} PrefetchedProp;
+
+static guint
+prefetched_prop_hash (gconstpointer key)
+{
+  const PrefetchedProp *prop = key;
 
-      ++i;
-    }
+  return (guint) (prop->xwindow ^ (prop->atom << 16));
+}
 
-  /* Get replies for all our tasks */
-  meta_topic (META_DEBUG_SYNC, "Syncing to get %d GetProperty replies in %s\n",
-              n_values, G_STRFUNC);
-  XSync (display->xdisplay, False);
+static gboolean
+prefetched_prop_equal (gconstpointer a,
+                       gconstpointer b)
+{
+  const PrefetchedProp *prop_a = a;
+  const PrefetchedProp *prop_b = b;
 
-  /* Collect results, should arrive in order requested */
-  i = 0;
-  while (i < n_values)
+  return prop_a->xwindow == prop_b->xwindow && prop_a->atom == prop_b->atom;
+}
+
+/* Takes the task started by meta_prop_prefetch_values() for this
+ * value, if there is one and it asked for the same type.
+ */
+static AgGetPropertyTask*
+steal_prefetched_task (MetaDisplay   *display,
+                       Window         xwindow,
+                       MetaPropValue *value)
+{
+  PrefetchedProp key, *prop;
+  AgGetPropertyTask *task;
+
+  if (display->prefetched_props == NULL)
+    return NULL;
+
+  key.xwindow = xwindow;
+  key.atom = value->atom;
+
+  prop = g_hash_table_lookup (display->prefetched_props, &key);
+  if (prop == NULL || prop->required_type != value->required_type)
+    return NULL;
+
+  task = prop->task;
+  g_hash_table_remove (display->prefetched_props, prop);
+
+  return task;
+}
+
+LOCAL_SYMBOL void
+meta_prop_prefetch_values (MetaDisplay   *display,
+                           Window         xwindow,
+                           MetaPropValue *values,
+                           int            n_values)
+{
+  int i;
+
+  if (display->prefetched_props == NULL)
+    display->prefetched_props = g_hash_table_new_full (prefetched_prop_hash,
+                                                       prefetched_prop_equal,
+                                                       free, NULL);
+
+  for (i = 0; i < n_values; i++)
     {
+      PrefetchedProp key, *prop;
       AgGetPropertyTask *task;
-      GetPropertyResults results;
 
-      if (tasks[i] == NULL)
-        {
-          /* Probably values[i].type was None, or ag_task_create()
-           * returned NULL.
-           */
-          values[i].type = META_PROP_VALUE_INVALID;
-          goto next;
-        }
+      if (values[i].atom == None)
+        continue;
+
+      init_required_type (display, &values[i]);
+
+      /* Don't ask twice for a value already on its way; only the
+       * table holds the task, so replacing it would leak it. A fetch
+       * asking for another type leaves it to
+       * meta_prop_discard_prefetched().
+       */
+      key.xwindow = xwindow;
+      key.atom = values[i].atom;
+      if (g_hash_table_contains (display->prefetched_props, &key))
+        continue;
+
+      task = get_task (display, xwindow,
+                       values[i].atom, values[i].required_type);
+      if (task == NULL)
+        continue;
+
+      prop = g_new (PrefetchedProp, 1);
+      prop->xwindow = xwindow;
+      prop->atom = values[i].atom;
+      prop->required_type = values[i].required_type;
+      prop->task = task;
+
+      g_hash_table_add (display->prefetched_props, prop);
+    }
+}
+
+LOCAL_SYMBOL void
+meta_prop_discard_prefetched (MetaDisplay *display)
+{
+  GHashTableIter iter;
+  PrefetchedProp *prop;
+  gboolean synced;
+
+  if (display->prefetched_props == NULL)
+    return;
 
-      task = ag_get_next_completed_task (display->xdisplay);
-      g_assert (task != NULL);
-      g_assert (ag_task_have_reply (task));
-
-      results.display = display;
-      results.xwindow = xwindow;
-      results.xatom = values[i].atom;
-      results.prop = NULL;
-      results.n_items = 0;
-      results.type = None;
-      results.bytes_after = 0;
-      results.format = 0;
-
-      if (ag_task_get_reply_and_free (task,
-                                      &results.type, &results.format,
-                                      &results.n_items,
-                                      &results.bytes_after,
-                                      &results.prop) != Success ||
-          results.type == None)
+  synced = FALSE;
+  g_hash_table_iter_init (&iter, display->prefetched_props);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &prop, NULL))
+    {
+      Atom type;
+      int format;
+      unsigned long n_items, bytes_after;
+      unsigned char *data = NULL;
+
+      if (!synced && !ag_task_have_reply (prop->task))
         {
-          values[i].type = META_PROP_VALUE_INVALID;
-          if (results.prop)
-            {
-              XFree (results.prop);
-              results.prop = NULL;
-            }
-          goto next;
+          gint64 start;
+
+          start = meta_request_profiler_begin (display->request_profiler);
+          XSync (display->xdisplay, False);
+          meta_request_profiler_end (display->request_profiler,
+                                     META_REQUEST_SYNC,
+                                     META_REQUEST_CALLER, start);
+          meta_display_note_round_trip (display);
+          synced = TRUE;
         }
 
-      switch (values[i].type)
+      ag_task_get_reply_and_free (prop->task, &type, &format,
+                                  &n_items, &bytes_after, &data);
+      if (data)
+        XFree (data);
+    }
+
+  g_hash_table_destroy (display->prefetched_props);
+  display->prefetched_props = NULL;
+}
+
+LOCAL_SYMBOL void
+meta_prop_get_values_multi (MetaDisplay   *display,
+                            const Window  *xwindows,
+                            MetaPropValue *values,
+                            int            n_values)
+{
+  int i;
+  AgGetPropertyTask **tasks;
+  gboolean need_sync;
+
+  if (n_values == 0)
+    return;
+
+  tasks = g_new0 (AgGetPropertyTask*, n_values);
+  need_sync = FALSE;
+
+  /* Start up tasks. The "values" array can have values
+   * with atom == None, which means to ignore that element.
+   */
+  i = 0;
+  while (i < n_values)
+    {
+      init_required_type (display, &values[i]);
+
+      if (values[i].atom != None)
         {
-        case META_PROP_VALUE_INVALID:
-          g_assert_not_reached ();
-          break;
-        case META_PROP_VALUE_UTF8_LIST:
-          if (!utf8_list_from_results (&results,
-                                       &values[i].v.string_list.strings,
-                                       &values[i].v.string_list.n_strings))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_UTF8:
-          if (!utf8_string_from_results (&results,
-                                         &values[i].v.str))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_STRING:
-          if (!latin1_string_from_results (&results,
-                                           &values[i].v.str))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_STRING_AS_UTF8:
-          if (!latin1_string_from_results (&results,
-                                           &values[i].v.str))
-            values[i].type = META_PROP_VALUE_INVALID;
-          else
-            {
-              char *new_str;
-              char *xmalloc_new_str;
-
-              new_str = latin1_to_utf8 (values[i].v.str);
-              xmalloc_new_str = ag_Xmalloc (strlen (new_str) + 1);
-              if (xmalloc_new_str != NULL)
-                {
-                  strcpy (xmalloc_new_str, new_str);
-                  meta_XFree (values[i].v.str);
-                  values[i].v.str = xmalloc_new_str;
-                }
-
-              free (new_str);
-            }
-          break;
-        case META_PROP_VALUE_MOTIF_HINTS:
-          if (!motif_hints_from_results (&results,
-                                         &values[i].v.motif_hints))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_CARDINAL_LIST:
-          if (!cardinal_list_from_results (&results,
-                                           &values[i].v.cardinal_list.cardinals,
-                                           &values[i].v.cardinal_list.n_cardinals))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_CARDINAL:
-          if (!cardinal_with_atom_type_from_results (&results,
-                                                     values[i].required_type,
-                                                     &values[i].v.cardinal))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_WINDOW:
-          if (!window_from_results (&results,
-                                    &values[i].v.xwindow))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_ATOM_LIST:
-          if (!atom_list_from_results (&results,
-                                       &values[i].v.atom_list.atoms,
-                                       &values[i].v.atom_list.n_atoms))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_TEXT_PROPERTY:
-          if (!text_property_from_results (&results, &values[i].v.str))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_WM_HINTS:
-          if (!wm_hints_from_results (&results, &values[i].v.wm_hints))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_CLASS_HINT:
-          if (!class_hint_from_results (&results, &values[i].v.class_hint))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_SIZE_HINTS:
-          if (!size_hints_from_results (&results,
-                                        &values[i].v.size_hints.hints,
-                                        &values[i].v.size_hints.flags))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-#ifdef HAVE_XSYNC
-        case META_PROP_VALUE_SYNC_COUNTER:
-          if (!counter_from_results (&results,
-                                     &values[i].v.xcounter))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-        case META_PROP_VALUE_SYNC_COUNTER_LIST:
-          if (!counter_list_from_results (&results,
-                                          &values[i].v.xcounter_list.counters,
-                                          &values[i].v.xcounter_list.n_counters))
-            values[i].type = META_PROP_VALUE_INVALID;
-          break;
-#else
-        case META_PROP_VALUE_SYNC_COUNTER:
-        case META_PROP_VALUE_SYNC_COUNTER_LIST:
-          values[i].type = META_PROP_VALUE_INVALID;
-          if (results.prop)
-            {
-              XFree (results.prop);
-              results.prop = NULL;
-            }
-          break;
-#endif
+          tasks[i] = steal_prefetched_task (display, xwindows[i], &values[i]);
+          if (tasks[i] == NULL)
+            tasks[i] = get_task (display, xwindows[i],
+                                 values[i].atom, values[i].required_type);
+
+          if (tasks[i] != NULL && !ag_task_have_reply (tasks[i]))
+            need_sync = TRUE;
         }
 
-    next:
       ++i;
     }
 
+  /* Get replies for all our tasks; if they were all prefetched and
+   * have already been answered there is no need for the round trip.
+   */
+  if (need_sync)
+    {
+      gint64 start;
+
+      meta_topic (META_DEBUG_SYNC, "Syncing to get %d GetProperty replies in %s\n",
+                  n_values, G_STRFUNC);
+      start = meta_request_profiler_begin (display->request_profiler);
+      XSync (display->xdisplay, False);
+      meta_request_profiler_end (display->request_profiler,
+                                 META_REQUEST_GET_PROPERTIES,
+                                 META_REQUEST_CALLER, start);
+      meta_display_note_round_trip (display);
+    }
+
+  for (i = 0; i < n_values; i++)
+    value_from_task (display, xwindows[i], tasks[i], &values[i]);
+
   free (tasks);
 }
 
+LOCAL_SYMBOL void
+meta_prop_get_values (MetaDisplay   *display,
+                      Window         xwindow,
+                      MetaPropValue *values,
+                      int            n_values)
+{
+  Window *xwindows;
+  int i;
+
+  meta_verbose ("Requesting %d properties of 0x%lx at once\n",
+                n_values, xwindow);
+
+  if (n_values == 0)
+    return;
+
+  xwindows = g_new (Window, n_values);
+  for (i = 0; i < n_values; i++)
+    xwindows[i] = xwindow;
+
+  meta_prop_get_values_multi (display, xwindows, values, n_values);
+
+  free (xwindows);
+}
+
 static void
 free_value (MetaPropValue *value)
 {
@@ -223,9 +223,32 @@ void meta_prop_get_values (MetaDisplay   *display,
                            MetaPropValue *values,
                            int            n_values);
 
+/* Like meta_prop_get_values(), but values[i] is read from xwindows[i],
+ * so properties of many windows can be fetched in a single round trip.
+ */
+void meta_prop_get_values_multi (MetaDisplay   *display,
+                                 const Window  *xwindows,
+                                 MetaPropValue *values,
+                                 int            n_values);
+
 void meta_prop_free_values (MetaPropValue *values,
                             int            n_values);
 
+/* Sends the requests for the given values without waiting for the
+ * replies.  A later meta_prop_get_values() on the same window picks up
+ * the outstanding requests instead of making new ones, so prefetching a
+ * batch of windows costs a single round trip for all of them.  Only
+ * prefetch while the server is grabbed, or the values may be stale by
+ * the time they are used.
+ */
+void meta_prop_prefetch_values (MetaDisplay   *display,
+                                Window         xwindow,
+                                MetaPropValue *values,
+                                int            n_values);
+
+/* Throws away any prefetched values nobody asked for. */
+void meta_prop_discard_prefetched (MetaDisplay *display);
+
 #endif
 
 
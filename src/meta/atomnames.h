@@ -74,6 +74,7 @@ item(_GNOME_PANEL_ACTION)
 item(_GNOME_PANEL_ACTION_RUN_DIALOG)
 item(_MUFFIN_SENTINEL)
 item(_MUFFIN_VERSION)
+item(_MUFFIN_OCCLUDED)
 item(WM_CLIENT_MACHINE)
 item(_NET_WM_XAPP_ICON_NAME)
 item(_NET_WM_XAPP_PROGRESS)
@@ -184,6 +185,7 @@ item(_NET_WM_OPAQUE_REGION)
 item(_NET_WM_FRAME_DRAWN)
 item(_NET_WM_FRAME_TIMINGS)
 item(_NET_RESTACK_WINDOW)
+item(_VARIABLE_REFRESH)
 
 /* eof atomnames.h */
 
@@ -443,12 +443,27 @@ typedef enum
   META_BACKGROUND_TRANSITION_BLEND
 } MetaBackgroundTransition;
 
+/*
+ * Colour filter applied to the whole screen; the colour blindness ones
+ * shift the colours that can't be told apart towards ones that can
+ */
+typedef enum
+{
+  META_COLOR_FILTER_NONE,
+  META_COLOR_FILTER_GRAYSCALE,
+  META_COLOR_FILTER_INVERT,
+  META_COLOR_FILTER_PROTANOPIA,
+  META_COLOR_FILTER_DEUTERANOPIA,
+  META_COLOR_FILTER_TRITANOPIA
+} MetaColorFilter;
+
 typedef enum
 {
   META_SYNC_NONE = 0,
   META_SYNC_FALLBACK,
   META_SYNC_SWAP_THROTTLING,
-  META_SYNC_PRESENTATION_TIME
+  META_SYNC_PRESENTATION_TIME,
+  META_SYNC_LATE_LATCHING
 } MetaSyncMethod;
 
 #endif
@@ -46,8 +46,44 @@ void        meta_disable_unredirect_for_screen  (MetaScreen *screen);
 void        meta_enable_unredirect_for_screen   (MetaScreen *screen);
 
 ClutterActor *meta_get_background_actor_for_screen (MetaScreen *screen);
+
+CoglTexture  *meta_get_icon_texture_for_window (MetaWindow *window,
+                                                int         size);
 void meta_set_stage_input_region     (MetaScreen    *screen,
                                       XserverRegion  region);
 void meta_empty_stage_input_region   (MetaScreen    *screen);
 
+gboolean meta_dump_frame_timings_for_screen (MetaScreen  *screen,
+                                             const char  *filename,
+                                             GError     **error);
+
+GVariant *meta_get_texture_memory_for_screen (MetaScreen *screen);
+
+GVariant *meta_get_cache_stats_for_screen (MetaScreen *screen);
+void      meta_trim_caches_for_screen     (MetaScreen *screen);
+
+void      meta_set_magnification_for_screen (MetaScreen *screen,
+                                             double      zoom);
+double    meta_get_magnification_for_screen (MetaScreen *screen);
+
+/**
+ * MetaStageCaptureFunc:
+ * @image: the pixels of @area; only valid during the call
+ * @area: the part of the stage that changed, in stage coordinates
+ * @user_data: the data passed to meta_add_stage_capture_for_screen()
+ *
+ * Receives the changed parts of the stage, see
+ * meta_add_stage_capture_for_screen().
+ */
+typedef void (* MetaStageCaptureFunc) (cairo_surface_t             *image,
+                                       const cairo_rectangle_int_t *area,
+                                       gpointer                     user_data);
+
+guint meta_add_stage_capture_for_screen    (MetaScreen           *screen,
+                                            MetaStageCaptureFunc  func,
+                                            gpointer              user_data,
+                                            GDestroyNotify        notify);
+void  meta_remove_stage_capture_for_screen (MetaScreen           *screen,
+                                            guint                 id);
+
 #endif
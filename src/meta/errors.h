@@ -36,5 +36,20 @@ void      meta_error_trap_push_with_return (MetaDisplay *display);
 /* returns X error code, or 0 for no error */
 int       meta_error_trap_pop_with_return  (MetaDisplay *display);
 
+/**
+ * MetaErrorTrapFunc:
+ * @display: a #MetaDisplay
+ * @error_code: the X error code, or 0 for no error
+ * @user_data: the data passed to meta_error_trap_pop_async()
+ */
+typedef void (* MetaErrorTrapFunc) (MetaDisplay *display,
+                                    int          error_code,
+                                    gpointer     user_data);
+
+void      meta_error_trap_pop_async (MetaDisplay       *display,
+                                     MetaErrorTrapFunc  func,
+                                     gpointer           user_data,
+                                     GDestroyNotify     destroy);
+
 
 #endif
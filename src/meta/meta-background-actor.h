@@ -62,4 +62,7 @@ GType meta_background_actor_get_type (void);
 
 ClutterActor *meta_background_actor_new_for_screen (MetaScreen *screen);
 
+void meta_background_actor_set_file (MetaScreen *screen,
+                                     const char *filename);
+
 #endif /* META_BACKGROUND_ACTOR_H */
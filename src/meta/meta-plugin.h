@@ -265,6 +265,42 @@ void
 meta_plugin_destroy_completed (MetaPlugin      *plugin,
                                MetaWindowActor *actor);
 
+/**
+ * MetaPluginEffect:
+ * @META_PLUGIN_EFFECT_MINIMIZE: the minimize vfunc
+ * @META_PLUGIN_EFFECT_MAXIMIZE: the maximize vfunc
+ * @META_PLUGIN_EFFECT_UNMAXIMIZE: the unmaximize vfunc
+ * @META_PLUGIN_EFFECT_MAP: the map vfunc
+ * @META_PLUGIN_EFFECT_DESTROY: the destroy vfunc
+ * @META_PLUGIN_EFFECT_SWITCH_WORKSPACE: the switch_workspace vfunc
+ * @META_PLUGIN_EFFECT_TILE: the tile vfunc
+ * @META_PLUGIN_EFFECT_ALL: all of the above
+ *
+ * The effects a plugin can be asked to run; see meta_plugin_set_effects().
+ */
+typedef enum {
+  META_PLUGIN_EFFECT_MINIMIZE         = 1 << 0,
+  META_PLUGIN_EFFECT_MAXIMIZE         = 1 << 1,
+  META_PLUGIN_EFFECT_UNMAXIMIZE       = 1 << 2,
+  META_PLUGIN_EFFECT_MAP              = 1 << 3,
+  META_PLUGIN_EFFECT_DESTROY          = 1 << 4,
+  META_PLUGIN_EFFECT_SWITCH_WORKSPACE = 1 << 5,
+  META_PLUGIN_EFFECT_TILE             = 1 << 6,
+  META_PLUGIN_EFFECT_ALL              = (1 << 7) - 1
+} MetaPluginEffect;
+
+void
+meta_plugin_set_effects (MetaPlugin       *plugin,
+                         MetaPluginEffect  effects);
+
+MetaPluginEffect
+meta_plugin_get_effects (MetaPlugin *plugin);
+
+void
+meta_plugin_set_xevent_types (MetaPlugin *plugin,
+                              const int  *event_types,
+                              int         n_event_types);
+
 /**
  * MetaModalOptions:
  * @META_MODAL_POINTER_ALREADY_GRABBED: if set the pointer is already
@@ -292,6 +328,8 @@ meta_plugin_end_modal (MetaPlugin *plugin,
 
 MetaScreen *meta_plugin_get_screen        (MetaPlugin *plugin);
 
+GList      *meta_plugin_get_window_stats  (MetaPlugin *plugin);
+
 void
 _meta_plugin_effect_started (MetaPlugin *plugin);
 
@@ -81,6 +81,15 @@ void meta_shadow_factory_get_params (MetaShadowFactory *factory,
                                      gboolean           focused,
                                      MetaShadowParams  *params);
 
+void  meta_shadow_factory_set_cache_size  (MetaShadowFactory *factory,
+                                           gsize              cache_size);
+gsize meta_shadow_factory_get_cache_size  (MetaShadowFactory *factory);
+void  meta_shadow_factory_get_cache_stats (MetaShadowFactory *factory,
+                                           guint             *hits,
+                                           guint             *misses,
+                                           guint             *evictions,
+                                           gsize             *resident_bytes);
+
 void meta_compositor_on_shadow_factory_changed (void);
 
 #endif /* __META_SHADOW_FACTORY_H__ */
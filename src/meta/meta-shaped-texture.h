@@ -27,6 +27,7 @@
 #define __META_SHAPED_TEXTURE_H__
 
 #include <clutter/clutter.h>
+#include <gio/gio.h>
 #include <X11/Xlib.h>
 
 G_BEGIN_DECLS
@@ -68,6 +69,8 @@ gboolean meta_shaped_texture_update_area (MetaShapedTexture *stex,
 
 CoglTexture *meta_shaped_texture_get_texture (MetaShapedTexture *stex);
 
+ClutterContent *meta_shaped_texture_get_content (MetaShapedTexture *stex);
+
 void meta_shaped_texture_set_overlay_path (MetaShapedTexture *stex,
                                            cairo_region_t    *overlay_region,
                                            cairo_path_t      *overlay_path);
@@ -81,6 +84,18 @@ void meta_shaped_texture_set_opaque_region (MetaShapedTexture *stex,
 cairo_surface_t * meta_shaped_texture_get_image (MetaShapedTexture     *stex,
                                                  cairo_rectangle_int_t *clip);
 
+void meta_shaped_texture_get_image_async (MetaShapedTexture     *stex,
+                                          cairo_rectangle_int_t *clip,
+                                          int                    max_width,
+                                          int                    max_height,
+                                          GCancellable          *cancellable,
+                                          GAsyncReadyCallback    callback,
+                                          gpointer               user_data);
+
+cairo_surface_t * meta_shaped_texture_get_image_finish (MetaShapedTexture  *stex,
+                                                        GAsyncResult       *result,
+                                                        GError            **error);
+
 void meta_shaped_texture_ensure_mask (MetaShapedTexture *stex,
                                       cairo_region_t    *shape_region,
                                       gboolean           has_frame);
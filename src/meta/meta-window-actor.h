@@ -66,4 +66,46 @@ gboolean           meta_window_actor_is_override_redirect (MetaWindowActor *self
 gboolean       meta_window_actor_showing_on_its_workspace (MetaWindowActor *self);
 gboolean       meta_window_actor_is_destroyed (MetaWindowActor *self);
 
+#define META_TYPE_WINDOW_ACTOR_STATS (meta_window_actor_stats_get_type ())
+
+typedef struct _MetaWindowActorStats MetaWindowActorStats;
+
+/**
+ * MetaWindowActorStats:
+ * @window: the #MetaWindow the stats are for
+ * @damage_events: damage events received per second
+ * @damage_pixels: damaged pixels repaired per second
+ * @upload_bytes: bytes of texture uploaded per second; 0 when the
+ *   texture is bound with texture-from-pixmap
+ * @paint_time: milliseconds per second spent painting the window
+ * @paint_share: the window's fraction of the time spent painting all
+ *   the windows, between 0 and 1
+ * @shadow_updates: shadows fetched from the shadow factory per second
+ * @mask_updates: shape and mask regenerations per second
+ * @sync_waits: frame-sync waits for the client per second
+ * @sync_wait_time: milliseconds per second spent waiting for the client
+ *   to answer frame-sync requests
+ *
+ * What a window cost the compositor, averaged over about the last
+ * second; see meta_plugin_get_window_stats().
+ */
+struct _MetaWindowActorStats
+{
+  MetaWindow *window;
+
+  double damage_events;
+  double damage_pixels;
+  double upload_bytes;
+  double paint_time;
+  double paint_share;
+  double shadow_updates;
+  double mask_updates;
+  double sync_waits;
+  double sync_wait_time;
+};
+
+GType                 meta_window_actor_stats_get_type (void);
+MetaWindowActorStats *meta_window_actor_stats_copy     (const MetaWindowActorStats *stats);
+void                  meta_window_actor_stats_free     (MetaWindowActorStats       *stats);
+
 #endif /* META_WINDOW_ACTOR_H */
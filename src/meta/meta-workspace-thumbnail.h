@@ -0,0 +1,66 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * meta-workspace-thumbnail.h: Live preview of a workspace
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+#ifndef META_WORKSPACE_THUMBNAIL_H
+#define META_WORKSPACE_THUMBNAIL_H
+
+#include <clutter/clutter.h>
+
+#include <meta/workspace.h>
+
+/**
+ * MetaWorkspaceThumbnail:
+ *
+ * This class shows the windows of a workspace, as the compositor draws
+ * them, scaled down to the size the actor is given. Its natural size is
+ * the size of the screen, and its height for a width keeps the screen's
+ * aspect ratio. The windows are kept in stacking order; the background
+ * isn't included.
+ */
+
+#define META_TYPE_WORKSPACE_THUMBNAIL            (meta_workspace_thumbnail_get_type ())
+#define META_WORKSPACE_THUMBNAIL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), META_TYPE_WORKSPACE_THUMBNAIL, MetaWorkspaceThumbnail))
+#define META_WORKSPACE_THUMBNAIL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), META_TYPE_WORKSPACE_THUMBNAIL, MetaWorkspaceThumbnailClass))
+#define META_IS_WORKSPACE_THUMBNAIL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), META_TYPE_WORKSPACE_THUMBNAIL))
+#define META_IS_WORKSPACE_THUMBNAIL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), META_TYPE_WORKSPACE_THUMBNAIL))
+#define META_WORKSPACE_THUMBNAIL_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), META_TYPE_WORKSPACE_THUMBNAIL, MetaWorkspaceThumbnailClass))
+
+typedef struct _MetaWorkspaceThumbnail        MetaWorkspaceThumbnail;
+typedef struct _MetaWorkspaceThumbnailClass   MetaWorkspaceThumbnailClass;
+typedef struct _MetaWorkspaceThumbnailPrivate MetaWorkspaceThumbnailPrivate;
+
+struct _MetaWorkspaceThumbnailClass
+{
+  ClutterActorClass parent_class;
+};
+
+struct _MetaWorkspaceThumbnail
+{
+  ClutterActor parent;
+
+  MetaWorkspaceThumbnailPrivate *priv;
+};
+
+GType meta_workspace_thumbnail_get_type (void);
+
+ClutterActor  *meta_workspace_thumbnail_new           (MetaWorkspace          *workspace);
+MetaWorkspace *meta_workspace_thumbnail_get_workspace (MetaWorkspaceThumbnail *self);
+
+#endif /* META_WORKSPACE_THUMBNAIL_H */
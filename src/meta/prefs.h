@@ -53,9 +53,16 @@ typedef enum
   META_PREF_DYNAMIC_WORKSPACES,
   META_PREF_UNREDIRECT_FULLSCREEN_WINDOWS,
   META_PREF_DESKTOP_EFFECTS,
+  META_PREF_DENSITY_MODE,
+  META_PREF_DENSITY_FRAME_RATE,
+  META_PREF_COMPOSITOR_MAGNIFIER,
+  META_PREF_COLOR_FILTER,
+  META_PREF_TEARING_ALLOWED_WM_CLASSES,
   META_PREF_SYNC_METHOD,
   META_PREF_THREADED_SWAP,
+  META_PREF_THREADED_PRESENT,
   META_PREF_SEND_FRAME_TIMINGS,
+  META_PREF_GEOMETRIC_PICKING,
   META_PREF_APPLICATION_BASED,
   META_PREF_KEYBINDINGS,
   META_PREF_DISABLE_WORKAROUNDS,
@@ -96,6 +103,15 @@ void meta_prefs_add_listener    (MetaPrefsChangedFunc func,
 void meta_prefs_remove_listener (MetaPrefsChangedFunc func,
                                  gpointer             data);
 
+typedef void (* MetaPrefsBatchChangedFunc) (const MetaPreference *prefs,
+                                            int                   n_prefs,
+                                            gpointer              data);
+
+void meta_prefs_add_batch_listener    (MetaPrefsBatchChangedFunc func,
+                                       gpointer                  data);
+void meta_prefs_remove_batch_listener (MetaPrefsBatchChangedFunc func,
+                                       gpointer                  data);
+
 void meta_prefs_init (void);
 
 void meta_prefs_override_preference_schema (const char *key,
@@ -120,9 +136,16 @@ int                         meta_prefs_get_num_workspaces     (void);
 gboolean                    meta_prefs_get_workspace_cycle    (void);
 gboolean                    meta_prefs_get_dynamic_workspaces (void);
 gboolean                    meta_prefs_get_unredirect_fullscreen_windows (void);
+gboolean                    meta_prefs_get_density_mode (void);
+int                         meta_prefs_get_density_frame_rate (void);
+gboolean                    meta_prefs_get_compositor_magnifier (void);
+MetaColorFilter             meta_prefs_get_color_filter (void);
+const char * const *        meta_prefs_get_tearing_allowed_wm_classes (void);
 MetaSyncMethod              meta_prefs_get_sync_method (void);
 gboolean                    meta_prefs_get_threaded_swap (void);
+gboolean                    meta_prefs_get_threaded_present (void);
 gboolean                    meta_prefs_get_send_frame_timings (void);
+gboolean                    meta_prefs_get_geometric_picking (void);
 gboolean                    meta_prefs_get_application_based  (void);
 gboolean                    meta_prefs_get_disable_workarounds (void);
 gboolean                    meta_prefs_get_auto_raise         (void);
@@ -35,6 +35,7 @@
 #include <meta/theme.h>
 #include <meta/prefs.h>
 #include "ui.h"
+#include "cache-stats.h"
 
 #include <cairo-xlib.h>
 
@@ -84,6 +85,7 @@ static MetaUIFrame* meta_frames_lookup_window (MetaFrames *frames,
                                                Window      xwindow);
 
 static void meta_frames_font_changed          (MetaFrames *frames);
+static void meta_frames_titlebar_font_changed (MetaFrames *frames);
 static void meta_frames_button_layout_changed (MetaFrames *frames);
 
 
@@ -94,6 +96,9 @@ static MetaFrameControl get_control  (MetaFrames        *frames,
                                       int                x,
                                       int                y);
 static void invalidate_all_caches (MetaFrames *frames);
+static void get_cache_stats (gpointer        data,
+                             MetaCacheStats *stats);
+static void trim_cache (gpointer data);
 static void invalidate_whole_window (MetaFrames *frames,
                                      MetaUIFrame *frame);
 
@@ -169,7 +174,7 @@ prefs_changed_callback (MetaPreference pref,
   switch (pref)
     {
     case META_PREF_TITLEBAR_FONT:
-      meta_frames_font_changed (META_FRAMES (data));
+      meta_frames_titlebar_font_changed (META_FRAMES (data));
       break;
     case META_PREF_BUTTON_LAYOUT:
       meta_frames_button_layout_changed (META_FRAMES (data));
@@ -247,6 +252,55 @@ update_style_contexts (MetaFrames *frames)
   g_list_free (variant_list);
 }
 
+/* Everything but the titlebar looks the same for frames of the same
+ * style, state and size, so those pieces are shared between frames.
+ */
+typedef struct
+{
+  MetaTheme       *theme;
+  GtkStyleContext *style;
+  MetaFrameType    type;
+  MetaFrameFlags   flags;
+  int              client_width;
+  int              client_height;
+  int              text_height;
+  int              piece;
+} SharedPieceKey;
+
+static guint
+shared_piece_key_hash (gconstpointer data)
+{
+  const SharedPieceKey *key = data;
+  guint hash;
+
+  hash = g_direct_hash (key->style);
+  hash = hash * 31 + key->type;
+  hash = hash * 31 + key->flags;
+  hash = hash * 31 + key->client_width;
+  hash = hash * 31 + key->client_height;
+  hash = hash * 31 + key->text_height;
+  hash = hash * 31 + key->piece;
+
+  return hash;
+}
+
+static gboolean
+shared_piece_key_equal (gconstpointer a,
+                        gconstpointer b)
+{
+  const SharedPieceKey *ka = a;
+  const SharedPieceKey *kb = b;
+
+  return ka->theme == kb->theme &&
+         ka->style == kb->style &&
+         ka->type == kb->type &&
+         ka->flags == kb->flags &&
+         ka->client_width == kb->client_width &&
+         ka->client_height == kb->client_height &&
+         ka->text_height == kb->text_height &&
+         ka->piece == kb->piece;
+}
+
 static void
 meta_frames_init (MetaFrames *frames)
 {
@@ -257,6 +311,10 @@ meta_frames_init (MetaFrames *frames)
   frames->invalidate_cache_timeout_id = 0;
   frames->invalidate_frames = NULL;
   frames->cache = g_hash_table_new (g_direct_hash, g_direct_equal);
+  frames->shared_pieces = g_hash_table_new_full (shared_piece_key_hash,
+                                                 shared_piece_key_equal,
+                                                 free,
+                                                 (GDestroyNotify) cairo_surface_destroy);
 
   frames->style_variants = g_hash_table_new_full (g_str_hash, g_str_equal,
 
@@ -266,6 +324,8 @@ meta_frames_init (MetaFrames *frames)
   gtk_widget_set_double_buffered (GTK_WIDGET (frames), FALSE);
 
   meta_prefs_add_listener (prefs_changed_callback, frames);
+
+  meta_cache_register ("frame pieces", get_cache_stats, trim_cache, frames);
 }
 
 static void
@@ -323,6 +383,7 @@ meta_frames_finalize (GObject *object)
   frames = META_FRAMES (object);
 
   meta_prefs_remove_listener (prefs_changed_callback, frames);
+  meta_cache_unregister ("frame pieces", frames);
 
   g_hash_table_destroy (frames->text_heights);
 
@@ -335,6 +396,7 @@ meta_frames_finalize (GObject *object)
   g_assert (g_hash_table_size (frames->frames) == 0);
   g_hash_table_destroy (frames->frames);
   g_hash_table_destroy (frames->cache);
+  g_hash_table_destroy (frames->shared_pieces);
 
   G_OBJECT_CLASS (meta_frames_parent_class)->finalize (object);
 }
@@ -379,12 +441,32 @@ invalidate_cache (MetaFrames *frames,
 
   for (i = 0; i < 4; i++)
     if (pixels->piece[i].pixmap)
-      cairo_surface_destroy (pixels->piece[i].pixmap);
+      {
+        cairo_surface_destroy (pixels->piece[i].pixmap);
+        frames->n_piece_evictions++;
+      }
 
   free (pixels);
   g_hash_table_remove (frames->cache, frame);
 }
 
+/* The title and the buttons are only in the titlebar piece; the
+ * others are shared with frames of the same size and kept
+ */
+static void
+invalidate_titlebar_cache (MetaFrames  *frames,
+                           MetaUIFrame *frame)
+{
+  CachedPixels *pixels = g_hash_table_lookup (frames->cache, frame);
+
+  if (pixels && pixels->piece[0].pixmap)
+    {
+      cairo_surface_destroy (pixels->piece[0].pixmap);
+      pixels->piece[0].pixmap = NULL;
+      frames->n_piece_evictions++;
+    }
+}
+
 static void
 invalidate_all_caches (MetaFrames *frames)
 {
@@ -399,6 +481,9 @@ invalidate_all_caches (MetaFrames *frames)
 
   g_list_free (frames->invalidate_frames);
   frames->invalidate_frames = NULL;
+
+  /* The frames hold their own references to the pieces they use */
+  g_hash_table_remove_all (frames->shared_pieces);
 }
 
 static gboolean
@@ -411,6 +496,61 @@ invalidate_cache_timeout (gpointer data)
   return FALSE;
 }
 
+/* The shared pieces are all used by some frame, so counting the pieces
+ * of the frames covers them
+ */
+static void
+get_cache_stats (gpointer        data,
+                 MetaCacheStats *stats)
+{
+  MetaFrames *frames = data;
+  GHashTableIter iter;
+  CachedPixels *pixels;
+  int i;
+
+  g_hash_table_iter_init (&iter, frames->cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &pixels))
+    for (i = 0; i < 4; i++)
+      if (pixels->piece[i].pixmap)
+        {
+          cairo_rectangle_int_t *rect = &pixels->piece[i].rect;
+
+          stats->n_entries++;
+          stats->bytes += (gsize) rect->width * rect->height * 4;
+        }
+
+  stats->hits = frames->n_piece_hits;
+  stats->misses = frames->n_piece_misses;
+  stats->evictions = frames->n_piece_evictions;
+}
+
+static void
+trim_cache (gpointer data)
+{
+  MetaFrames *frames = data;
+
+  invalidate_all_caches (frames);
+  if (frames->invalidate_cache_timeout_id) {
+    g_source_remove (frames->invalidate_cache_timeout_id);
+    frames->invalidate_cache_timeout_id = 0;
+  }
+}
+
+static void
+forget_layout (MetaUIFrame *frame)
+{
+  if (frame->layout)
+    {
+      /* save title to recreate layout */
+      free (frame->title);
+
+      frame->title = g_strdup (pango_layout_get_text (frame->layout));
+
+      g_object_unref (G_OBJECT (frame->layout));
+      frame->layout = NULL;
+    }
+}
+
 static void
 queue_recalc_func (gpointer key, gpointer value, gpointer data)
 {
@@ -423,26 +563,58 @@ queue_recalc_func (gpointer key, gpointer value, gpointer data)
   invalidate_whole_window (frames, frame);
   meta_core_queue_frame_resize (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
                                 frame->xwindow);
-  if (frame->layout)
-    {
-      /* save title to recreate layout */
-      free (frame->title);
+  forget_layout (frame);
+}
 
-      frame->title = g_strdup (pango_layout_get_text (frame->layout));
+/* Only the title bar's height depends on the font, so a frame whose
+ * title keeps its height is just redrawn rather than every window
+ * being moved and resized */
+static void
+queue_title_recalc_func (gpointer key, gpointer value, gpointer data)
+{
+  MetaUIFrame *frame;
+  MetaFrames *frames;
+  gboolean had_layout;
+  int old_text_height;
 
-      g_object_unref (G_OBJECT (frame->layout));
-      frame->layout = NULL;
+  frames = META_FRAMES (data);
+  frame = value;
+
+  had_layout = frame->layout != NULL;
+  old_text_height = frame->text_height;
+
+  invalidate_whole_window (frames, frame);
+  forget_layout (frame);
+
+  if (had_layout && gtk_widget_get_realized (GTK_WIDGET (frames)))
+    {
+      meta_frames_ensure_layout (frames, frame);
+
+      if (frame->text_height == old_text_height)
+        return;
     }
+
+  meta_core_queue_frame_resize (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
+                                frame->xwindow);
 }
 
 static void
-meta_frames_font_changed (MetaFrames *frames)
+forget_font_caches (MetaFrames *frames)
 {
+  /* The pieces may have been drawn with the old style */
+  g_hash_table_remove_all (frames->shared_pieces);
+
   if (g_hash_table_size (frames->text_heights) > 0)
     {
       g_hash_table_destroy (frames->text_heights);
       frames->text_heights = g_hash_table_new (NULL, NULL);
     }
+}
+
+static void
+meta_frames_font_changed (MetaFrames *frames)
+{
+  forget_font_caches (frames);
 
   /* Queue a draw/resize on all frames */
   g_hash_table_foreach (frames->frames,
@@ -450,6 +622,15 @@ meta_frames_font_changed (MetaFrames *frames)
 
 }
 
+static void
+meta_frames_titlebar_font_changed (MetaFrames *frames)
+{
+  forget_font_caches (frames);
+
+  g_hash_table_foreach (frames->frames,
+                        queue_title_recalc_func, frames);
+}
+
 static void
 queue_draw_func (gpointer key, gpointer value, gpointer data)
 {
@@ -1004,6 +1185,8 @@ meta_frames_set_title (MetaFrames *frames,
                        const char *title)
 {
   MetaUIFrame *frame;
+  MetaFrameGeometry fgeom;
+  GdkRectangle rect;
 
   frame = meta_frames_lookup_window (frames, xwindow);
 
@@ -1018,7 +1201,17 @@ meta_frames_set_title (MetaFrames *frames,
       frame->layout = NULL;
     }
 
-  invalidate_whole_window (frames, frame);
+  /* Only the titlebar is drawn again, so that is all the compositor
+   * sees damaged and updates */
+  meta_frames_calc_geometry (frames, frame, &fgeom);
+
+  rect.x = 0;
+  rect.y = 0;
+  rect.width = fgeom.width;
+  rect.height = fgeom.borders.total.top;
+
+  gdk_window_invalidate_rect (frame->window, &rect, FALSE);
+  invalidate_titlebar_cache (frames, frame);
 }
 
 LOCAL_SYMBOL void
@@ -1064,7 +1257,7 @@ redraw_control (MetaFrames *frames,
   rect = control_rect (control, &fgeom);
 
   gdk_window_invalidate_rect (frame->window, rect, FALSE);
-  invalidate_cache (frames, frame);
+  invalidate_titlebar_cache (frames, frame);
 }
 
 enum
@@ -1963,12 +2156,42 @@ setup_bg_cr (cairo_t *cr, GdkWindow *window, int x_offset, int y_offset)
     }
 }
 
+/* Records the drawing of the whole frame, background included. The
+ * theme is drawn through GTK+ and Pango, which only work on the main
+ * thread, and that is what takes the time: replaying the recording
+ * for each piece is cheap in comparison.
+ */
+static cairo_surface_t *
+record_frame (MetaFrames  *frames,
+              MetaUIFrame *frame)
+{
+  cairo_surface_t *recording;
+  cairo_t *cr;
+
+  recording = cairo_recording_surface_create (CAIRO_CONTENT_COLOR, NULL);
+
+  cr = cairo_create (recording);
+
+  setup_bg_cr (cr, frame->window, 0, 0);
+  cairo_paint (cr);
+
+  meta_frames_paint (frames, frame, cr);
+
+  cairo_destroy (cr);
+
+  return recording;
+}
+
 /* Returns a pixmap with a piece of the windows frame painted on it.
-*/
+ * The frame is only drawn once for all its pieces: *@recording is
+ * made on the first call and replayed by the next ones; the caller
+ * destroys it.
+ */
 
 static cairo_surface_t *
 generate_pixmap (MetaFrames            *frames,
                  MetaUIFrame           *frame,
+                 cairo_surface_t      **recording,
                  cairo_rectangle_int_t *rect)
 {
   cairo_surface_t *result;
@@ -1978,6 +2201,9 @@ generate_pixmap (MetaFrames            *frames,
   if (rect->width <= 0 || rect->height <= 0)
     return NULL;
 
+  if (*recording == NULL)
+    *recording = record_frame (frames, frame);
+
   result = gdk_window_create_similar_surface (frame->window,
                                               CAIRO_CONTENT_COLOR,
                                               rect->width, rect->height);
@@ -1985,21 +2211,52 @@ generate_pixmap (MetaFrames            *frames,
   cr = cairo_create (result);
   cairo_translate (cr, -rect->x, -rect->y);
 
-  setup_bg_cr (cr, frame->window, 0, 0);
+  cairo_set_source_surface (cr, *recording, 0, 0);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
   cairo_paint (cr);
 
-  meta_frames_paint (frames, frame, cr);
-
   cairo_destroy (cr);
 
   return result;
 }
 
 
+/* Returns a new reference to the piece @key of @frame, drawing it only
+ * if no other frame has drawn an identical one since the caches were
+ * last dropped.
+ */
+static cairo_surface_t *
+get_shared_pixmap (MetaFrames            *frames,
+                   MetaUIFrame           *frame,
+                   const SharedPieceKey  *key,
+                   cairo_surface_t      **recording,
+                   cairo_rectangle_int_t *rect)
+{
+  cairo_surface_t *pixmap;
+
+  pixmap = g_hash_table_lookup (frames->shared_pieces, key);
+  if (pixmap)
+    {
+      frames->n_piece_hits++;
+      return cairo_surface_reference (pixmap);
+    }
+
+  frames->n_piece_misses++;
+  pixmap = generate_pixmap (frames, frame, recording, rect);
+  if (pixmap)
+    g_hash_table_insert (frames->shared_pieces,
+                         g_memdup (key, sizeof (SharedPieceKey)),
+                         cairo_surface_reference (pixmap));
+
+  return pixmap;
+}
+
 static void
 populate_cache (MetaFrames *frames,
                 MetaUIFrame *frame)
 {
+  SharedPieceKey key;
+  cairo_surface_t *recording = NULL;
   MetaFrameBorders borders;
   int width, height;
   int frame_width, frame_height, screen_width, screen_height;
@@ -2070,15 +2327,43 @@ populate_cache (MetaFrames *frames,
   pixels->piece[3].rect.width = width + borders.visible.left + borders.visible.right;
   pixels->piece[3].rect.height = borders.visible.bottom;
 
+  key.theme = meta_theme_get_current ();
+  key.style = frame->style;
+  key.type = frame_type;
+  key.flags = frame_flags;
+  key.client_width = width;
+  key.client_height = height;
+  key.text_height = frame->text_height;
+
   for (i = 0; i < 4; i++)
     {
       CachedFramePiece *piece = &pixels->piece[i];
       /* generate_pixmap() returns NULL for 0 width/height pieces, but
        * does so cheaply so we don't need to cache the NULL return */
-      if (!piece->pixmap)
-        piece->pixmap = generate_pixmap (frames, frame, &piece->rect);
+      if (piece->pixmap)
+        {
+          frames->n_piece_hits++;
+          continue;
+        }
+
+      /* The titlebar has the title, icon and button states of its own */
+      if (i == 0)
+        {
+          frames->n_piece_misses++;
+          piece->pixmap = generate_pixmap (frames, frame, &recording,
+                                           &piece->rect);
+        }
+      else
+        {
+          key.piece = i;
+          piece->pixmap = get_shared_pixmap (frames, frame, &key, &recording,
+                                             &piece->rect);
+        }
     }
 
+  if (recording)
+    cairo_surface_destroy (recording);
+
   if (frames->invalidate_cache_timeout_id) {
     g_source_remove (frames->invalidate_cache_timeout_id);
     frames->invalidate_cache_timeout_id = 0;
@@ -102,6 +102,11 @@ struct _MetaFrames
   int invalidate_cache_timeout_id;
   GList *invalidate_frames;
   GHashTable *cache;
+  GHashTable *shared_pieces;
+
+  guint64 n_piece_hits;
+  guint64 n_piece_misses;
+  guint64 n_piece_evictions;
 };
 
 struct _MetaFramesClass
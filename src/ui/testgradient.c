@@ -22,6 +22,8 @@
 
 #include <meta/gradient.h>
 #include <gtk/gtk.h>
+#include <stdio.h>
+#include <string.h>
 
 typedef void (* RenderGradientFunc) (cairo_t     *cr,
                                      int          width,
@@ -303,9 +305,74 @@ meta_gradient_test (void)
 
 }
 
+#define NUM_BENCHMARK_RUNS 200
+
+/* Times rendering gradients at titlebar sizes, as a frame being
+ * resized does on every step; run with --benchmark
+ */
+static void
+benchmark_gradients (void)
+{
+  static const char *names[] = { "vertical", "horizontal", "diagonal" };
+  static const guchar alphas[] = { 0xff, 0x00, 0xff };
+  GdkRGBA colors[3];
+  int type, n_colors;
+
+  gdk_rgba_parse (&colors[0], "red");
+  gdk_rgba_parse (&colors[1], "blue");
+  gdk_rgba_parse (&colors[2], "yellow");
+
+  for (type = 0; type < META_GRADIENT_LAST; type++)
+    for (n_colors = 2; n_colors <= 3; n_colors++)
+      {
+        gint64 start, elapsed;
+        int i;
+
+        start = g_get_monotonic_time ();
+        for (i = 0; i < NUM_BENCHMARK_RUNS; i++)
+          {
+            GdkPixbuf *pixbuf;
+
+            pixbuf = meta_gradient_create_multi (600 + i, 24, colors,
+                                                 n_colors, type);
+            g_object_unref (G_OBJECT (pixbuf));
+          }
+        elapsed = g_get_monotonic_time () - start;
+
+        printf ("%d color %s: %.3f us per gradient\n",
+                n_colors, names[type], (double) elapsed / NUM_BENCHMARK_RUNS);
+      }
+
+  {
+    GdkPixbuf *pixbuf;
+    gint64 start, elapsed;
+    int i;
+
+    pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 800, 24);
+    gdk_pixbuf_fill (pixbuf, 0xffffffff);
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < NUM_BENCHMARK_RUNS; i++)
+      meta_gradient_add_alpha (pixbuf, alphas, G_N_ELEMENTS (alphas),
+                               META_GRADIENT_HORIZONTAL);
+    elapsed = g_get_monotonic_time () - start;
+
+    printf ("horizontal alpha: %.3f us per gradient\n",
+            (double) elapsed / NUM_BENCHMARK_RUNS);
+
+    g_object_unref (G_OBJECT (pixbuf));
+  }
+}
+
 int
 main (int argc, char **argv)
 {
+  if (argc > 1 && strcmp (argv[1], "--benchmark") == 0)
+    {
+      benchmark_gradients ();
+      return 0;
+    }
+
   gtk_init (&argc, &argv);
 
   meta_gradient_test ();
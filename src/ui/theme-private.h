@@ -439,13 +439,83 @@ typedef struct
   } d;
 } PosToken;
 
+/**
+ * The kinds of instruction an expression is compiled to. Expressions
+ * are run on a small stack of values whose types are known when the
+ * expression is compiled, so each operator instruction says whether it
+ * works on integers or doubles.
+ *
+ * \ingroup parser
+ */
+typedef enum
+{
+  /** Push an integer constant */
+  POS_INSTR_INT,
+  /** Push a double constant */
+  POS_INSTR_DOUBLE,
+  /** Push the value of one of the PosVariable slots */
+  POS_INSTR_VARIABLE,
+  /** Turn the integer d.depth values below the top into a double */
+  POS_INSTR_TO_DOUBLE,
+  /** Replace the top two integers with the result of d.op */
+  POS_INSTR_INT_OP,
+  /** Replace the top two doubles with the result of d.op */
+  POS_INSTR_DOUBLE_OP
+} PosInstrType;
+
+/**
+ * The variables an expression can refer to, resolved when the
+ * expression is compiled.
+ *
+ * \ingroup parser
+ */
+typedef enum
+{
+  POS_VAR_WIDTH,
+  POS_VAR_HEIGHT,
+  POS_VAR_OBJECT_WIDTH,
+  POS_VAR_OBJECT_HEIGHT,
+  POS_VAR_LEFT_WIDTH,
+  POS_VAR_RIGHT_WIDTH,
+  POS_VAR_TOP_HEIGHT,
+  POS_VAR_BOTTOM_HEIGHT,
+  POS_VAR_MINI_ICON_WIDTH,
+  POS_VAR_MINI_ICON_HEIGHT,
+  POS_VAR_ICON_WIDTH,
+  POS_VAR_ICON_HEIGHT,
+  POS_VAR_TITLE_WIDTH,
+  POS_VAR_TITLE_HEIGHT,
+  POS_VAR_FRAME_X_CENTER,
+  POS_VAR_FRAME_Y_CENTER
+} PosVariable;
+
+/**
+ * A single instruction of a compiled expression.
+ *
+ * \ingroup parser
+ */
+typedef struct
+{
+  PosInstrType type;
+
+  union
+  {
+    int int_val;
+    double double_val;
+    PosVariable variable;
+    int depth;
+    PosOperatorType op;
+  } d;
+} PosInstr;
+
 /**
  * MetaDrawSpec: (skip)
  *
  * A computed expression in our simple vector drawing language.
- * While it appears to take the form of a tree, this is actually
- * merely a list; concerns such as precedence of operators are
- * currently recomputed on every recalculation.
+ * The tokens are kept as a list, and expressions that aren't
+ * constant are also compiled into a list of stack instructions in
+ * postfix order, so drawing a frame doesn't have to work out
+ * precedence or look up variables by name again.
  *
  * Created by meta_draw_spec_new(), destroyed by meta_draw_spec_free().
  * pos_eval() fills this with ...FIXME. Are tokens a tree or a list?
@@ -466,10 +536,39 @@ struct _MetaDrawSpec
   /** How many tokens are in the tokens list. */
   int n_tokens;
 
+  /**
+   * The compiled expression, or NULL if it is constant or couldn't be
+   * compiled; in the latter case the tokens are evaluated instead so
+   * that the error is reported as before.
+   */
+  PosInstr *code;
+
+  /** How many instructions are in the code list. */
+  int n_code;
+
+  /** Is the result of the compiled expression a double? */
+  gboolean code_is_double : 1;
+
+  /** Does the compiled expression use object_width or object_height? */
+  gboolean code_uses_object_width : 1;
+  gboolean code_uses_object_height : 1;
+
   /** Does the expression contain any variables? */
   gboolean constant : 1;
 };
 
+/**
+ * A scaled, colorized and alpha-blended image an image draw op drew,
+ * identified by the size and colorize color it was drawn with.
+ */
+typedef struct
+{
+  guint32 pixel;
+  int width;
+  int height;
+  GdkPixbuf *pixbuf;
+} MetaImageCacheEntry;
+
 /**
  * A single drawing operation in our simple vector drawing language.
  */
@@ -534,6 +633,10 @@ struct _MetaDrawOp
       MetaDrawSpec *y;
       MetaDrawSpec *width;
       MetaDrawSpec *height;
+
+      GdkRGBA *cache_colors;
+      int cache_n_colors;
+      GdkPixbuf *cache_pixbuf;
     } gradient;
 
     struct {
@@ -547,6 +650,9 @@ struct _MetaDrawOp
 
       guint32 colorize_cache_pixel;
       GdkPixbuf *colorize_cache_pixbuf;
+      /* Recently drawn results, most recent first */
+      MetaImageCacheEntry *scale_cache;
+      int scale_cache_len;
       MetaImageFillType fill_type;
       unsigned int vertical_stripes : 1;
       unsigned int horizontal_stripes : 1;
@@ -1209,6 +1315,23 @@ void                  meta_gtk_style_get_dark_color    (GtkStyleContext      *st
 
 guint meta_theme_earliest_version_with_button (MetaButtonType type);
 
+/* Splits the time spent drawing frames into the phases below, for
+ * muffin-theme-viewer --benchmark; everything not accounted to them is
+ * cairo and GTK drawing. Off unless enabled, as reading the clock
+ * around every expression isn't free.
+ */
+typedef enum
+{
+  META_THEME_PROFILE_EXPRESSIONS,
+  META_THEME_PROFILE_PIXBUFS,
+  META_THEME_PROFILE_LAST
+} MetaThemeProfilePhase;
+
+void   meta_theme_profile_set_enabled (gboolean              enabled);
+gint64 meta_theme_profile_now         (void);
+/* Returns the nanoseconds spent in @phase since the last call */
+gint64 meta_theme_profile_take        (MetaThemeProfilePhase phase);
+
 
 #define META_THEME_ALLOWS(theme, feature) (theme->format_version >= feature)
 
@@ -28,7 +28,9 @@
 #include <meta/preview-widget.h>
 #include <gtk/gtk.h>
 #include <time.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <string.h>
 #include <glib/gi18n.h>
 
@@ -60,11 +62,27 @@ static MetaTheme *global_theme = NULL;
 static GtkWidget *previews[META_FRAME_TYPE_LAST*FONT_SIZE_LAST + BUTTON_LAYOUT_COMBINATIONS] = { NULL, };
 static double milliseconds_to_draw_frame = 0.0;
 
+static gboolean benchmark = FALSE;
+static int benchmark_loads = 20;
+static char *benchmark_output = NULL;
+
+static GOptionEntry options[] = {
+  { "benchmark", 0, 0, G_OPTION_ARG_NONE, &benchmark,
+    N_("Time loading and drawing the theme, print JSON results and exit"), NULL },
+  { "loads", 0, 0, G_OPTION_ARG_INT, &benchmark_loads,
+    N_("Number of times the benchmark loads the theme (default 20)"), "N" },
+  { "output", 'o', 0, G_OPTION_ARG_FILENAME, &benchmark_output,
+    N_("Write the benchmark results to FILE instead of stdout"), "FILE" },
+  { NULL }
+};
+
 static void run_position_expression_tests (void);
 #if 0
 static void run_position_expression_timings (void);
 #endif
 static void run_theme_benchmark (void);
+static void run_frame_benchmark (const char *theme_name,
+                                 FILE       *out);
 
 
 static const gchar *menu_item_string =
@@ -778,6 +796,7 @@ main (int argc, char **argv)
   GError *err;
   clock_t start, end;
   GtkWidget *notebook;
+  const char *theme_name;
   int i;
 
   bindtextdomain (GETTEXT_PACKAGE, MUFFIN_LOCALEDIR);
@@ -789,7 +808,13 @@ main (int argc, char **argv)
   run_position_expression_timings ();
 #endif
 
-  gtk_init (&argc, &argv);
+  err = NULL;
+  if (!gtk_init_with_args (&argc, &argv, "[THEMENAME]", options,
+                           GETTEXT_PACKAGE, &err))
+    {
+      g_printerr ("%s\n", err->message);
+      exit (1);
+    }
 
   if (g_getenv ("MUFFIN_DEBUG") != NULL)
     {
@@ -797,17 +822,19 @@ main (int argc, char **argv)
       meta_set_verbose (TRUE);
     }
 
-  start = clock ();
-  err = NULL;
   if (argc == 1)
-    global_theme = meta_theme_load ("Atlanta", &err);
+    theme_name = "Atlanta";
   else if (argc == 2)
-    global_theme = meta_theme_load (argv[1], &err);
+    theme_name = argv[1];
   else
     {
       g_printerr (_("Usage: metacity-theme-viewer [THEMENAME]\n"));
       exit (1);
     }
+
+  start = clock ();
+  err = NULL;
+  global_theme = meta_theme_load (theme_name, &err);
   end = clock ();
 
   if (global_theme == NULL)
@@ -818,6 +845,29 @@ main (int argc, char **argv)
       exit (1);
     }
 
+  if (benchmark)
+    {
+      FILE *out = stdout;
+
+      if (benchmark_output)
+        {
+          out = fopen (benchmark_output, "w");
+          if (out == NULL)
+            {
+              g_printerr ("Failed to open %s: %s\n",
+                          benchmark_output, g_strerror (errno));
+              exit (1);
+            }
+        }
+
+      run_frame_benchmark (theme_name, out);
+
+      if (out != stdout)
+        fclose (out);
+
+      return 0;
+    }
+
   g_print (_("Loaded theme \"%s\" in %g seconds\n"),
            global_theme->name,
            (end - start) / (double) CLOCKS_PER_SEC);
@@ -1060,6 +1110,345 @@ run_theme_benchmark (void)
 #undef ITERATIONS
 }
 
+/* The states each frame type is drawn in by run_frame_benchmark(),
+ * on top of being focused or not
+ */
+static const MetaFrameFlags benchmark_states[] = {
+  0,
+  META_FRAME_MAXIMIZED,
+  META_FRAME_SHADED,
+  META_FRAME_MAXIMIZED | META_FRAME_SHADED,
+  META_FRAME_TILED_LEFT,
+  META_FRAME_TILED_RIGHT
+};
+
+static const char *benchmark_titles[] = {
+  "",
+  "xterm",
+  "notes.txt - Text Editor",
+  "A title long enough to be ellipsized by any theme, like many web page titles - Web Browser"
+};
+
+/* Each case is drawn this many times, at a new size every time */
+#define RESIZES_PER_CASE 4
+
+static int
+compare_samples (gconstpointer a,
+                 gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a;
+  gint64 y = *(const gint64 *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void
+print_samples (FILE       *out,
+               const char *indent,
+               const char *name,
+               GArray     *samples,
+               gboolean    last)
+{
+  gint64 total = 0;
+  guint i;
+
+  fprintf (out, "%s\"%s\": { \"count\": %u", indent, name, samples->len);
+
+  if (samples->len > 0)
+    {
+      g_array_sort (samples, compare_samples);
+
+      for (i = 0; i < samples->len; i++)
+        total += g_array_index (samples, gint64, i);
+
+      fprintf (out,
+               ", \"mean\": %.1f, \"p50\": %" G_GINT64_FORMAT
+               ", \"p90\": %" G_GINT64_FORMAT ", \"p99\": %" G_GINT64_FORMAT
+               ", \"max\": %" G_GINT64_FORMAT,
+               total / (double) samples->len,
+               g_array_index (samples, gint64, samples->len / 2),
+               g_array_index (samples, gint64, samples->len * 90 / 100),
+               g_array_index (samples, gint64, samples->len * 99 / 100),
+               g_array_index (samples, gint64, samples->len - 1));
+    }
+
+  fprintf (out, " }%s\n", last ? "" : ",");
+}
+
+static void
+add_sample (GArray *samples,
+            gint64  value)
+{
+  g_array_append_val (samples, value);
+}
+
+/* Draws the frame into a new surface the size of @piece, the way
+ * MetaFrames' generate_pixmap() fills its cache, and returns how long
+ * that took.
+ */
+static gint64
+draw_frame_piece (GtkWidget              *widget,
+                  MetaFrameType           type,
+                  MetaFrameFlags          flags,
+                  int                     client_width,
+                  int                     client_height,
+                  PangoLayout            *layout,
+                  int                     text_height,
+                  const MetaButtonLayout *button_layout,
+                  MetaButtonState         button_states[META_BUTTON_TYPE_LAST],
+                  cairo_rectangle_int_t  *piece)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  gint64 start;
+
+  if (piece->width <= 0 || piece->height <= 0)
+    return 0;
+
+  start = meta_theme_profile_now ();
+
+  /* An image surface keeps the X server out of the numbers, which
+   * makes runs comparable */
+  surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+                                        piece->width, piece->height);
+  cr = cairo_create (surface);
+  cairo_translate (cr, -piece->x, -piece->y);
+
+  cairo_set_source_rgb (cr, 0.5, 0.5, 0.5);
+  cairo_paint (cr);
+
+  meta_theme_draw_frame (global_theme,
+                         widget,
+                         cr,
+                         type,
+                         flags,
+                         client_width, client_height,
+                         layout,
+                         text_height,
+                         button_layout,
+                         button_states);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+
+  return meta_theme_profile_now () - start;
+}
+
+/* Times loading the theme, drawing every frame type in every state
+ * with titles of different lengths and a few button states, and
+ * filling the four pieces MetaFrames caches for a frame, then prints
+ * percentiles of each as JSON.
+ *
+ * Drawing is split into the time spent evaluating expressions, making
+ * pixbufs for images, gradients and tints, and the rest, which is
+ * cairo and GTK drawing. Each case is drawn at several sizes, never
+ * the same twice in a row, so that the caches of scaled images and
+ * gradients don't hide the cost of a resize.
+ */
+static void
+run_frame_benchmark (const char *theme_name,
+                     FILE       *out)
+{
+  GtkWidget *widget;
+  PangoLayout *layouts[G_N_ELEMENTS (benchmark_titles)];
+  MetaButtonLayout button_layout;
+  MetaButtonState button_states[META_BUTTON_TYPE_LAST];
+  MetaFrameFlags base_flags;
+  GArray *loads, *draws, *expressions, *pixbufs, *drawing, *cache_fills;
+  GArray *type_draws[META_FRAME_TYPE_LAST];
+  int text_height;
+  int type;
+  int n_sizes = 0;
+  guint i, state, focus, title, buttons, r;
+
+  loads = g_array_new (FALSE, FALSE, sizeof (gint64));
+  draws = g_array_new (FALSE, FALSE, sizeof (gint64));
+  expressions = g_array_new (FALSE, FALSE, sizeof (gint64));
+  pixbufs = g_array_new (FALSE, FALSE, sizeof (gint64));
+  drawing = g_array_new (FALSE, FALSE, sizeof (gint64));
+  cache_fills = g_array_new (FALSE, FALSE, sizeof (gint64));
+  for (type = 0; type < META_FRAME_TYPE_LAST; type++)
+    type_draws[type] = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  /* Parsing and validating the theme file; after the first load the
+   * images come from the theme image cache, as they would at startup */
+  for (i = 0; i < (guint) benchmark_loads; i++)
+    {
+      MetaTheme *theme;
+      GError *err = NULL;
+      gint64 start;
+
+      start = meta_theme_profile_now ();
+      theme = meta_theme_load (theme_name, &err);
+      add_sample (loads, meta_theme_profile_now () - start);
+
+      if (theme == NULL)
+        {
+          g_printerr (_("Error loading theme: %s\n"), err->message);
+          g_error_free (err);
+          break;
+        }
+
+      meta_theme_free (theme);
+    }
+
+  widget = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  gtk_widget_realize (widget);
+
+  text_height = get_text_height (widget);
+  base_flags = get_flags (widget) & ~META_FRAME_HAS_FOCUS;
+
+  for (title = 0; title < G_N_ELEMENTS (benchmark_titles); title++)
+    layouts[title] = gtk_widget_create_pango_layout (widget,
+                                                     benchmark_titles[title]);
+
+  memset (&button_layout, 0, sizeof (button_layout));
+  for (i = 0; i < MAX_BUTTONS_PER_CORNER; i++)
+    {
+      button_layout.left_buttons[i] = META_BUTTON_FUNCTION_LAST;
+      button_layout.right_buttons[i] = META_BUTTON_FUNCTION_LAST;
+    }
+  button_layout.left_buttons[0] = META_BUTTON_FUNCTION_MENU;
+  button_layout.right_buttons[0] = META_BUTTON_FUNCTION_MINIMIZE;
+  button_layout.right_buttons[1] = META_BUTTON_FUNCTION_MAXIMIZE;
+  button_layout.right_buttons[2] = META_BUTTON_FUNCTION_CLOSE;
+
+  meta_theme_profile_set_enabled (TRUE);
+
+  for (type = 0; type < META_FRAME_TYPE_LAST; type++)
+    for (state = 0; state < G_N_ELEMENTS (benchmark_states); state++)
+      for (focus = 0; focus < 2; focus++)
+        for (title = 0; title < G_N_ELEMENTS (benchmark_titles); title++)
+          for (buttons = 0; buttons < META_BUTTON_STATE_LAST; buttons++)
+            {
+              MetaFrameFlags flags;
+              MetaFrameBorders borders;
+
+              flags = base_flags | benchmark_states[state];
+              if (focus)
+                flags |= META_FRAME_HAS_FOCUS;
+
+              /* All buttons normal, or the close button pressed or
+               * hovered */
+              for (i = 0; i < META_BUTTON_TYPE_LAST; i++)
+                button_states[i] = META_BUTTON_STATE_NORMAL;
+              button_states[META_BUTTON_TYPE_CLOSE] = buttons;
+
+              meta_theme_get_frame_borders (global_theme, type, text_height,
+                                            flags, &borders);
+
+              for (r = 0; r < RESIZES_PER_CASE; r++)
+                {
+                  cairo_rectangle_int_t whole;
+                  int client_width, client_height;
+                  gint64 elapsed, expression_ns, pixbuf_ns;
+
+                  client_width = 100 + (n_sizes * 37) % 1500;
+                  client_height = 80 + (n_sizes * 23) % 1000;
+                  n_sizes++;
+
+                  whole.x = 0;
+                  whole.y = 0;
+                  whole.width = client_width + borders.total.left + borders.total.right;
+                  whole.height = client_height + borders.total.top + borders.total.bottom;
+
+                  meta_theme_profile_take (META_THEME_PROFILE_EXPRESSIONS);
+                  meta_theme_profile_take (META_THEME_PROFILE_PIXBUFS);
+
+                  elapsed = draw_frame_piece (widget, type, flags,
+                                              client_width, client_height,
+                                              layouts[title], text_height,
+                                              &button_layout, button_states,
+                                              &whole);
+
+                  expression_ns = meta_theme_profile_take (META_THEME_PROFILE_EXPRESSIONS);
+                  pixbuf_ns = meta_theme_profile_take (META_THEME_PROFILE_PIXBUFS);
+
+                  add_sample (draws, elapsed);
+                  add_sample (type_draws[type], elapsed);
+                  add_sample (expressions, expression_ns);
+                  add_sample (pixbufs, pixbuf_ns);
+                  add_sample (drawing, MAX (elapsed - expression_ns - pixbuf_ns, 0));
+                }
+
+              /* The cache MetaFrames keeps holds the visible part of
+               * each side of the frame, see populate_cache() */
+              if (buttons == META_BUTTON_STATE_NORMAL)
+                {
+                  cairo_rectangle_int_t pieces[4];
+                  int client_width, client_height;
+                  gint64 elapsed = 0;
+
+                  client_width = 100 + (n_sizes * 37) % 1500;
+                  client_height = 80 + (n_sizes * 23) % 1000;
+                  n_sizes++;
+
+                  pieces[0].x = borders.invisible.left;
+                  pieces[0].y = borders.invisible.top;
+                  pieces[0].width = client_width + borders.visible.left + borders.visible.right;
+                  pieces[0].height = borders.visible.top;
+
+                  pieces[1].x = borders.invisible.left;
+                  pieces[1].y = borders.total.top;
+                  pieces[1].width = borders.visible.left;
+                  pieces[1].height = client_height;
+
+                  pieces[2].x = borders.total.left + client_width;
+                  pieces[2].y = borders.total.top;
+                  pieces[2].width = borders.visible.right;
+                  pieces[2].height = client_height;
+
+                  pieces[3].x = borders.invisible.left;
+                  pieces[3].y = borders.total.top + client_height;
+                  pieces[3].width = client_width + borders.visible.left + borders.visible.right;
+                  pieces[3].height = borders.visible.bottom;
+
+                  for (i = 0; i < G_N_ELEMENTS (pieces); i++)
+                    elapsed += draw_frame_piece (widget, type, flags,
+                                                 client_width, client_height,
+                                                 layouts[title], text_height,
+                                                 &button_layout, button_states,
+                                                 &pieces[i]);
+
+                  add_sample (cache_fills, elapsed);
+                }
+            }
+
+  meta_theme_profile_set_enabled (FALSE);
+
+  fprintf (out, "{\n");
+  fprintf (out, "  \"theme\": \"%s\",\n", theme_name);
+  fprintf (out, "  \"format_version\": %u,\n", global_theme->format_version);
+
+  /* All in nanoseconds */
+  print_samples (out, "  ", "load_ns", loads, FALSE);
+  print_samples (out, "  ", "draw_ns", draws, FALSE);
+  print_samples (out, "  ", "expressions_ns", expressions, FALSE);
+  print_samples (out, "  ", "pixbufs_ns", pixbufs, FALSE);
+  print_samples (out, "  ", "cairo_ns", drawing, FALSE);
+  print_samples (out, "  ", "cache_fill_ns", cache_fills, FALSE);
+
+  fprintf (out, "  \"per_type_draw_ns\": {\n");
+  for (type = 0; type < META_FRAME_TYPE_LAST; type++)
+    print_samples (out, "    ", meta_frame_type_to_string (type),
+                   type_draws[type], type == META_FRAME_TYPE_LAST - 1);
+  fprintf (out, "  }\n");
+  fprintf (out, "}\n");
+
+  for (type = 0; type < META_FRAME_TYPE_LAST; type++)
+    g_array_free (type_draws[type], TRUE);
+  g_array_free (cache_fills, TRUE);
+  g_array_free (drawing, TRUE);
+  g_array_free (pixbufs, TRUE);
+  g_array_free (expressions, TRUE);
+  g_array_free (draws, TRUE);
+  g_array_free (loads, TRUE);
+
+  for (title = 0; title < G_N_ELEMENTS (benchmark_titles); title++)
+    g_object_unref (layouts[title]);
+  gtk_widget_destroy (widget);
+}
+
 typedef struct
 {
   GdkRectangle rect;
@@ -56,12 +56,16 @@
 #include <config.h>
 #include "theme-private.h"
 #include "util-private.h"
+#include "cache-stats.h"
 #include <meta/gradient.h>
 #include <meta/prefs.h>
 #include <gtk/gtk.h>
+#include <glib/gstdio.h>
 #include <string.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
 
 #define GDK_COLOR_RGBA(color)                                           \
                          ((guint32) (0xff                         |     \
@@ -1021,24 +1025,21 @@ meta_gradient_spec_free (MetaGradientSpec *spec)
   free (spec);
 }
 
-LOCAL_SYMBOL GdkPixbuf*
-meta_gradient_spec_render (const MetaGradientSpec *spec,
-                           GtkStyleContext        *style,
-                           int                     width,
-                           int                     height)
+static GdkRGBA *
+render_gradient_colors (const MetaGradientSpec *spec,
+                        GtkStyleContext        *style,
+                        int                    *n_colors)
 {
-  int n_colors;
   GdkRGBA *colors;
   GSList *tmp;
   int i;
-  GdkPixbuf *pixbuf;
 
-  n_colors = g_slist_length (spec->color_specs);
+  *n_colors = g_slist_length (spec->color_specs);
 
-  if (n_colors == 0)
+  if (*n_colors == 0)
     return NULL;
 
-  colors = g_new (GdkRGBA, n_colors);
+  colors = g_new (GdkRGBA, *n_colors);
 
   i = 0;
   tmp = spec->color_specs;
@@ -1050,6 +1051,24 @@ meta_gradient_spec_render (const MetaGradientSpec *spec,
       ++i;
     }
 
+  return colors;
+}
+
+LOCAL_SYMBOL GdkPixbuf*
+meta_gradient_spec_render (const MetaGradientSpec *spec,
+                           GtkStyleContext        *style,
+                           int                     width,
+                           int                     height)
+{
+  int n_colors;
+  GdkRGBA *colors;
+  GdkPixbuf *pixbuf;
+
+  colors = render_gradient_colors (spec, style, &n_colors);
+
+  if (colors == NULL)
+    return NULL;
+
   pixbuf = meta_gradient_create_multi (width, height,
                                        colors, n_colors,
                                        spec->type);
@@ -2649,6 +2668,426 @@ pos_eval_helper (PosToken                   *tokens,
   return TRUE;
 }
 
+/*
+ * The compiler turns the tokens of an expression into PosInstrs in
+ * postfix order, by recursive descent over the same grammar and
+ * precedences that pos_eval_helper() works out on every evaluation.
+ *
+ * It only accepts expressions that pos_eval_helper() would evaluate
+ * without a parse error, and so that the only error left when running
+ * the code is a division by zero, which pos_eval_helper() reports the
+ * same way whatever order it meets it in. Anything else is left to
+ * pos_eval_helper(), so broken themes get the same messages as ever.
+ *
+ * \ingroup parser
+ */
+
+/* The evaluation stack; pos_eval_helper() already refuses anything
+ * with more than MAX_EXPRS terms at one level. */
+#define POS_STACK_SIZE 32
+
+typedef struct
+{
+  PosToken *tokens;
+  int n_tokens;
+  int pos;
+
+  GArray *code;
+  int depth;
+  /* Terms and operators at the current parenthesis level */
+  int n_exprs;
+
+  gboolean uses_object_width;
+  gboolean uses_object_height;
+} PosCompiler;
+
+static const struct
+{
+  const char *name;
+  PosVariable variable;
+} pos_variables[] = {
+  { "width", POS_VAR_WIDTH },
+  { "height", POS_VAR_HEIGHT },
+  { "object_width", POS_VAR_OBJECT_WIDTH },
+  { "object_height", POS_VAR_OBJECT_HEIGHT },
+  { "left_width", POS_VAR_LEFT_WIDTH },
+  { "right_width", POS_VAR_RIGHT_WIDTH },
+  { "top_height", POS_VAR_TOP_HEIGHT },
+  { "bottom_height", POS_VAR_BOTTOM_HEIGHT },
+  { "mini_icon_width", POS_VAR_MINI_ICON_WIDTH },
+  { "mini_icon_height", POS_VAR_MINI_ICON_HEIGHT },
+  { "icon_width", POS_VAR_ICON_WIDTH },
+  { "icon_height", POS_VAR_ICON_HEIGHT },
+  { "title_width", POS_VAR_TITLE_WIDTH },
+  { "title_height", POS_VAR_TITLE_HEIGHT },
+  { "frame_x_center", POS_VAR_FRAME_X_CENTER },
+  { "frame_y_center", POS_VAR_FRAME_Y_CENTER }
+};
+
+static int
+op_precedence (PosOperatorType op)
+{
+  switch (op)
+    {
+    case POS_OP_MULTIPLY:
+    case POS_OP_DIVIDE:
+    case POS_OP_MOD:
+      return 2;
+    case POS_OP_ADD:
+    case POS_OP_SUBTRACT:
+      return 1;
+    case POS_OP_MAX:
+    case POS_OP_MIN:
+      return 0;
+    case POS_OP_NONE:
+      break;
+    }
+
+  return -1;
+}
+
+static void
+pos_compiler_emit (PosCompiler *c,
+                   PosInstr    *instr,
+                   int          stack_change)
+{
+  g_array_append_val (c->code, *instr);
+  c->depth += stack_change;
+}
+
+static gboolean pos_compile_binary (PosCompiler *c,
+                                    int          precedence,
+                                    gboolean    *is_double);
+
+static gboolean
+pos_compile_operand (PosCompiler *c,
+                     gboolean    *is_double)
+{
+  PosToken *t;
+  PosInstr instr;
+  guint i;
+
+  if (c->pos == c->n_tokens || c->n_exprs >= MAX_EXPRS)
+    return FALSE;
+
+  t = &c->tokens[c->pos++];
+  c->n_exprs++;
+
+  switch (t->type)
+    {
+    case POS_TOKEN_INT:
+      instr.type = POS_INSTR_INT;
+      instr.d.int_val = t->d.i.val;
+      *is_double = FALSE;
+      break;
+
+    case POS_TOKEN_DOUBLE:
+      instr.type = POS_INSTR_DOUBLE;
+      instr.d.double_val = t->d.d.val;
+      *is_double = TRUE;
+      break;
+
+    case POS_TOKEN_VARIABLE:
+      for (i = 0; i < G_N_ELEMENTS (pos_variables); i++)
+        if (strcmp (t->d.v.name, pos_variables[i].name) == 0)
+          break;
+
+      if (i == G_N_ELEMENTS (pos_variables))
+        return FALSE;
+
+      instr.type = POS_INSTR_VARIABLE;
+      instr.d.variable = pos_variables[i].variable;
+      if (instr.d.variable == POS_VAR_OBJECT_WIDTH)
+        c->uses_object_width = TRUE;
+      else if (instr.d.variable == POS_VAR_OBJECT_HEIGHT)
+        c->uses_object_height = TRUE;
+      *is_double = FALSE;
+      break;
+
+    case POS_TOKEN_OPEN_PAREN:
+      {
+        int outer_exprs = c->n_exprs;
+
+        c->n_exprs = 0;
+        if (!pos_compile_binary (c, 0, is_double))
+          return FALSE;
+        c->n_exprs = outer_exprs;
+
+        if (c->pos == c->n_tokens ||
+            c->tokens[c->pos].type != POS_TOKEN_CLOSE_PAREN)
+          return FALSE;
+        c->pos++;
+      }
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+
+  pos_compiler_emit (c, &instr, 1);
+
+  return c->depth <= POS_STACK_SIZE;
+}
+
+static gboolean
+pos_compile_binary (PosCompiler *c,
+                    int          precedence,
+                    gboolean    *is_double)
+{
+  gboolean a_is_double, b_is_double;
+  PosOperatorType op;
+  PosInstr instr;
+
+  if (precedence > 2)
+    return pos_compile_operand (c, is_double);
+
+  if (!pos_compile_binary (c, precedence + 1, &a_is_double))
+    return FALSE;
+
+  while (c->pos < c->n_tokens &&
+         c->tokens[c->pos].type == POS_TOKEN_OPERATOR &&
+         op_precedence (c->tokens[c->pos].d.o.op) == precedence)
+    {
+      op = c->tokens[c->pos].d.o.op;
+      c->pos++;
+
+      if (c->n_exprs++ >= MAX_EXPRS)
+        return FALSE;
+
+      if (!pos_compile_binary (c, precedence + 1, &b_is_double))
+        return FALSE;
+
+      /* Promote the integer operand, as do_operation() does */
+      if (a_is_double != b_is_double)
+        {
+          instr.type = POS_INSTR_TO_DOUBLE;
+          instr.d.depth = a_is_double ? 0 : 1;
+          pos_compiler_emit (c, &instr, 0);
+        }
+
+      a_is_double = a_is_double || b_is_double;
+
+      if (a_is_double && op == POS_OP_MOD)
+        return FALSE;
+
+      instr.type = a_is_double ? POS_INSTR_DOUBLE_OP : POS_INSTR_INT_OP;
+      instr.d.op = op;
+      pos_compiler_emit (c, &instr, -1);
+    }
+
+  *is_double = a_is_double;
+
+  return TRUE;
+}
+
+/*
+ * Compiles the tokens of a spec that isn't constant, leaving spec->code
+ * NULL if they have to be evaluated by pos_eval_helper().
+ */
+static void
+pos_compile (MetaDrawSpec *spec)
+{
+  PosCompiler c = { 0, };
+  gboolean is_double;
+
+  c.tokens = spec->tokens;
+  c.n_tokens = spec->n_tokens;
+  c.code = g_array_new (FALSE, FALSE, sizeof (PosInstr));
+
+  if (pos_compile_binary (&c, 0, &is_double) && c.pos == c.n_tokens)
+    {
+      g_assert (c.depth == 1);
+
+      spec->n_code = c.code->len;
+      spec->code = (PosInstr *) g_array_free (c.code, FALSE);
+      spec->code_is_double = is_double;
+      spec->code_uses_object_width = c.uses_object_width;
+      spec->code_uses_object_height = c.uses_object_height;
+    }
+  else
+    g_array_free (c.code, TRUE);
+}
+
+static inline int
+pos_get_variable (PosVariable                variable,
+                  const MetaPositionExprEnv *env)
+{
+  switch (variable)
+    {
+    case POS_VAR_WIDTH:
+      return env->rect.width;
+    case POS_VAR_HEIGHT:
+      return env->rect.height;
+    case POS_VAR_OBJECT_WIDTH:
+      return env->object_width;
+    case POS_VAR_OBJECT_HEIGHT:
+      return env->object_height;
+    case POS_VAR_LEFT_WIDTH:
+      return env->left_width;
+    case POS_VAR_RIGHT_WIDTH:
+      return env->right_width;
+    case POS_VAR_TOP_HEIGHT:
+      return env->top_height;
+    case POS_VAR_BOTTOM_HEIGHT:
+      return env->bottom_height;
+    case POS_VAR_MINI_ICON_WIDTH:
+      return env->mini_icon_width;
+    case POS_VAR_MINI_ICON_HEIGHT:
+      return env->mini_icon_height;
+    case POS_VAR_ICON_WIDTH:
+      return env->icon_width;
+    case POS_VAR_ICON_HEIGHT:
+      return env->icon_height;
+    case POS_VAR_TITLE_WIDTH:
+      return env->title_width;
+    case POS_VAR_TITLE_HEIGHT:
+      return env->title_height;
+    case POS_VAR_FRAME_X_CENTER:
+      return env->frame_x_center;
+    case POS_VAR_FRAME_Y_CENTER:
+      return env->frame_y_center;
+    }
+
+  g_assert_not_reached ();
+  return 0;
+}
+
+typedef union
+{
+  int i;
+  double d;
+} PosValue;
+
+/*
+ * Runs the compiled code of a spec.
+ *
+ * \return  False if the expression divided by zero
+ * \ingroup parser
+ */
+static gboolean
+pos_eval_code (const MetaDrawSpec        *spec,
+               const MetaPositionExprEnv *env,
+               int                       *val_p,
+               GError                   **err)
+{
+  PosValue stack[POS_STACK_SIZE];
+  PosValue *a, *b;
+  int sp = 0;
+  int i;
+
+  for (i = 0; i < spec->n_code; i++)
+    {
+      const PosInstr *instr = &spec->code[i];
+
+      switch (instr->type)
+        {
+        case POS_INSTR_INT:
+          stack[sp++].i = instr->d.int_val;
+          break;
+
+        case POS_INSTR_DOUBLE:
+          stack[sp++].d = instr->d.double_val;
+          break;
+
+        case POS_INSTR_VARIABLE:
+          stack[sp++].i = pos_get_variable (instr->d.variable, env);
+          break;
+
+        case POS_INSTR_TO_DOUBLE:
+          a = &stack[sp - 1 - instr->d.depth];
+          a->d = a->i;
+          break;
+
+        case POS_INSTR_INT_OP:
+          a = &stack[sp - 2];
+          b = &stack[sp - 1];
+          sp--;
+
+          switch (instr->d.op)
+            {
+            case POS_OP_MULTIPLY:
+              a->i = a->i * b->i;
+              break;
+            case POS_OP_DIVIDE:
+              if (b->i == 0)
+                goto divide_by_zero;
+              a->i = a->i / b->i;
+              break;
+            case POS_OP_MOD:
+              if (b->i == 0)
+                goto divide_by_zero;
+              a->i = a->i % b->i;
+              break;
+            case POS_OP_ADD:
+              a->i = a->i + b->i;
+              break;
+            case POS_OP_SUBTRACT:
+              a->i = a->i - b->i;
+              break;
+            case POS_OP_MAX:
+              a->i = MAX (a->i, b->i);
+              break;
+            case POS_OP_MIN:
+              a->i = MIN (a->i, b->i);
+              break;
+            case POS_OP_NONE:
+              g_assert_not_reached ();
+              break;
+            }
+          break;
+
+        case POS_INSTR_DOUBLE_OP:
+          a = &stack[sp - 2];
+          b = &stack[sp - 1];
+          sp--;
+
+          switch (instr->d.op)
+            {
+            case POS_OP_MULTIPLY:
+              a->d = a->d * b->d;
+              break;
+            case POS_OP_DIVIDE:
+              if (b->d == 0.0)
+                goto divide_by_zero;
+              a->d = a->d / b->d;
+              break;
+            case POS_OP_ADD:
+              a->d = a->d + b->d;
+              break;
+            case POS_OP_SUBTRACT:
+              a->d = a->d - b->d;
+              break;
+            case POS_OP_MAX:
+              a->d = MAX (a->d, b->d);
+              break;
+            case POS_OP_MIN:
+              a->d = MIN (a->d, b->d);
+              break;
+            case POS_OP_MOD:
+            case POS_OP_NONE:
+              g_assert_not_reached ();
+              break;
+            }
+          break;
+        }
+    }
+
+  g_assert (sp == 1);
+
+  if (spec->code_is_double)
+    *val_p = stack[0].d;
+  else
+    *val_p = stack[0].i;
+
+  return TRUE;
+
+ divide_by_zero:
+  g_set_error (err, META_THEME_ERROR,
+               META_THEME_ERROR_DIVIDE_BY_ZERO,
+               _("Coordinate expression results in division by zero"));
+  return FALSE;
+}
+
 /*
  *   expr = int | double | expr * expr | expr / expr |
  *          expr + expr | expr - expr | (expr)
@@ -2681,6 +3120,13 @@ pos_eval (MetaDrawSpec              *spec,
 
   *val_p = 0;
 
+  /* Without an object size those variables are unknown, which is
+   * reported by pos_eval_helper() */
+  if (spec->code &&
+      (!spec->code_uses_object_width || env->object_width >= 0) &&
+      (!spec->code_uses_object_height || env->object_height >= 0))
+    return pos_eval_code (spec, env, val_p, err);
+
   if (pos_eval_helper (spec->tokens, spec->n_tokens, env, &expr, err))
     {
       switch (expr.type)
@@ -2830,12 +3276,64 @@ meta_theme_replace_constants (MetaTheme   *theme,
   return is_constant;
 }
 
+static gboolean profile_enabled = FALSE;
+static gint64 profile_ns[META_THEME_PROFILE_LAST];
+
+void
+meta_theme_profile_set_enabled (gboolean enabled)
+{
+  profile_enabled = enabled;
+  memset (profile_ns, 0, sizeof (profile_ns));
+}
+
+gint64
+meta_theme_profile_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+gint64
+meta_theme_profile_take (MetaThemeProfilePhase phase)
+{
+  gint64 ns = profile_ns[phase];
+
+  profile_ns[phase] = 0;
+
+  return ns;
+}
+
+static inline gint64
+profile_begin (void)
+{
+  if (G_LIKELY (!profile_enabled))
+    return 0;
+
+  return meta_theme_profile_now ();
+}
+
+static inline void
+profile_end (MetaThemeProfilePhase phase,
+             gint64                start)
+{
+  if (G_LIKELY (!profile_enabled))
+    return;
+
+  profile_ns[phase] += meta_theme_profile_now () - start;
+}
+
 static int
 parse_x_position_unchecked (MetaDrawSpec              *spec,
                             const MetaPositionExprEnv *env)
 {
   int retval;
   GError *error;
+  gint64 start;
+
+  start = profile_begin ();
 
   retval = 0;
   error = NULL;
@@ -2847,6 +3345,8 @@ parse_x_position_unchecked (MetaDrawSpec              *spec,
       g_error_free (error);
     }
 
+  profile_end (META_THEME_PROFILE_EXPRESSIONS, start);
+
   return retval;
 }
 
@@ -2856,6 +3356,9 @@ parse_y_position_unchecked (MetaDrawSpec              *spec,
 {
   int retval;
   GError *error;
+  gint64 start;
+
+  start = profile_begin ();
 
   retval = 0;
   error = NULL;
@@ -2867,6 +3370,8 @@ parse_y_position_unchecked (MetaDrawSpec              *spec,
       g_error_free (error);
     }
 
+  profile_end (META_THEME_PROFILE_EXPRESSIONS, start);
+
   return retval;
 }
 
@@ -2876,6 +3381,9 @@ parse_size_unchecked (MetaDrawSpec        *spec,
 {
   int retval;
   GError *error;
+  gint64 start;
+
+  start = profile_begin ();
 
   retval = 0;
   error = NULL;
@@ -2887,6 +3395,8 @@ parse_size_unchecked (MetaDrawSpec        *spec,
       g_error_free (error);
     }
 
+  profile_end (META_THEME_PROFILE_EXPRESSIONS, start);
+
   return retval;
 }
 
@@ -2895,6 +3405,7 @@ meta_draw_spec_free (MetaDrawSpec *spec)
 {
   if (!spec) return;
   free_tokens (spec->tokens, spec->n_tokens);
+  free (spec->code);
   g_slice_free (MetaDrawSpec, spec);
 }
 
@@ -2926,6 +3437,8 @@ meta_draw_spec_new (MetaTheme  *theme,
           return NULL;
         }
     }
+  else
+    pos_compile (spec);
 
   return spec;
 }
@@ -3007,11 +3520,17 @@ meta_draw_op_new (MetaDrawType type)
   return op;
 }
 
+static void forget_cached_op (MetaDrawOp *op);
+
 LOCAL_SYMBOL void
 meta_draw_op_free (MetaDrawOp *op)
 {
+  int i;
+
   g_return_if_fail (op != NULL);
 
+  forget_cached_op (op);
+
   switch (op->type)
     {
     case META_DRAW_LINE:
@@ -3067,6 +3586,10 @@ meta_draw_op_free (MetaDrawOp *op)
       if (op->data.gradient.alpha_spec)
         meta_alpha_gradient_spec_free (op->data.gradient.alpha_spec);
 
+      if (op->data.gradient.cache_pixbuf)
+        g_object_unref (G_OBJECT (op->data.gradient.cache_pixbuf));
+      free (op->data.gradient.cache_colors);
+
       meta_draw_spec_free (op->data.gradient.x);
       meta_draw_spec_free (op->data.gradient.y);
       meta_draw_spec_free (op->data.gradient.width);
@@ -3086,6 +3609,10 @@ meta_draw_op_free (MetaDrawOp *op)
       if (op->data.image.colorize_cache_pixbuf)
         g_object_unref (G_OBJECT (op->data.image.colorize_cache_pixbuf));
 
+      for (i = 0; i < op->data.image.scale_cache_len; i++)
+        g_object_unref (G_OBJECT (op->data.image.scale_cache[i].pixbuf));
+      free (op->data.image.scale_cache);
+
       meta_draw_spec_free (op->data.image.x);
       meta_draw_spec_free (op->data.image.y);
       meta_draw_spec_free (op->data.image.width);
@@ -3440,6 +3967,311 @@ scale_and_alpha_pixbuf (GdkPixbuf             *src,
   return pixbuf;
 }
 
+/* The draw ops holding cached pixbufs, for the cache stats and for
+ * dropping the pixbufs when memory runs low
+ */
+static GHashTable *cached_ops = NULL;
+static guint64 n_op_cache_hits = 0;
+static guint64 n_op_cache_misses = 0;
+static guint64 n_op_cache_evictions = 0;
+
+static gsize
+pixbuf_bytes (GdkPixbuf *pixbuf)
+{
+  return (gsize) gdk_pixbuf_get_rowstride (pixbuf) *
+                 gdk_pixbuf_get_height (pixbuf);
+}
+
+static void
+get_op_cache_stats (gpointer        data,
+                    MetaCacheStats *stats)
+{
+  GHashTableIter iter;
+  MetaDrawOp *op;
+  int i;
+
+  g_hash_table_iter_init (&iter, cached_ops);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &op, NULL))
+    {
+      if (op->type == META_DRAW_GRADIENT)
+        {
+          if (op->data.gradient.cache_pixbuf)
+            {
+              stats->n_entries++;
+              stats->bytes += pixbuf_bytes (op->data.gradient.cache_pixbuf);
+            }
+          continue;
+        }
+
+      if (op->data.image.colorize_cache_pixbuf)
+        {
+          stats->n_entries++;
+          stats->bytes += pixbuf_bytes (op->data.image.colorize_cache_pixbuf);
+        }
+
+      for (i = 0; i < op->data.image.scale_cache_len; i++)
+        {
+          stats->n_entries++;
+          stats->bytes += pixbuf_bytes (op->data.image.scale_cache[i].pixbuf);
+        }
+    }
+
+  stats->hits = n_op_cache_hits;
+  stats->misses = n_op_cache_misses;
+  stats->evictions = n_op_cache_evictions;
+}
+
+static void
+clear_op_cache (MetaDrawOp *op)
+{
+  int i;
+
+  if (op->type == META_DRAW_GRADIENT)
+    {
+      g_clear_object (&op->data.gradient.cache_pixbuf);
+      free (op->data.gradient.cache_colors);
+      op->data.gradient.cache_colors = NULL;
+      op->data.gradient.cache_n_colors = 0;
+      return;
+    }
+
+  g_clear_object (&op->data.image.colorize_cache_pixbuf);
+
+  for (i = 0; i < op->data.image.scale_cache_len; i++)
+    g_object_unref (G_OBJECT (op->data.image.scale_cache[i].pixbuf));
+  free (op->data.image.scale_cache);
+  op->data.image.scale_cache = NULL;
+  op->data.image.scale_cache_len = 0;
+}
+
+static void
+trim_op_caches (gpointer data)
+{
+  GHashTableIter iter;
+  MetaDrawOp *op;
+
+  g_hash_table_iter_init (&iter, cached_ops);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &op, NULL))
+    clear_op_cache (op);
+
+  g_hash_table_remove_all (cached_ops);
+}
+
+static void
+remember_cached_op (const MetaDrawOp *op)
+{
+  if (cached_ops == NULL)
+    {
+      cached_ops = g_hash_table_new (NULL, NULL);
+      meta_cache_register ("theme pixbufs",
+                           get_op_cache_stats, trim_op_caches, NULL);
+    }
+
+  g_hash_table_add (cached_ops, (gpointer) op);
+}
+
+static void
+forget_cached_op (MetaDrawOp *op)
+{
+  if (cached_ops)
+    g_hash_table_remove (cached_ops, op);
+}
+
+/* Image ops keep the last few pixbufs they drew, so that the
+ * colorize color flipping with the focus of frames, or frames of a
+ * few different sizes, don't scale and colorize the image every time.
+ * The op belongs to the theme, so all frames share its cache.
+ */
+#define IMAGE_SCALE_CACHE_SIZE 6
+
+static GdkPixbuf*
+draw_image_as_pixbuf (const MetaDrawOp *op,
+                      GtkStyleContext  *context,
+                      int               width,
+                      int               height)
+{
+  MetaDrawOp *cache_op = (MetaDrawOp*) op; /* const cast here */
+  MetaImageCacheEntry *cache;
+  MetaImageCacheEntry entry;
+  GdkPixbuf *src;
+  GdkRGBA color;
+  guint32 pixel = 0;
+  int i;
+
+  if (op->data.image.colorize_spec)
+    {
+      meta_color_spec_render (op->data.image.colorize_spec,
+                              context, &color);
+      pixel = GDK_COLOR_RGB (color);
+    }
+
+  cache = op->data.image.scale_cache;
+  for (i = 0; i < op->data.image.scale_cache_len; i++)
+    {
+      if (cache[i].pixel == pixel &&
+          cache[i].width == width &&
+          cache[i].height == height)
+        {
+          entry = cache[i];
+          memmove (&cache[1], &cache[0], i * sizeof (MetaImageCacheEntry));
+          cache[0] = entry;
+          n_op_cache_hits++;
+
+          return g_object_ref (G_OBJECT (entry.pixbuf));
+        }
+    }
+
+  n_op_cache_misses++;
+
+  if (op->data.image.colorize_spec)
+    {
+      if (op->data.image.colorize_cache_pixbuf == NULL ||
+          op->data.image.colorize_cache_pixel != pixel)
+        {
+          if (op->data.image.colorize_cache_pixbuf)
+            g_object_unref (G_OBJECT (op->data.image.colorize_cache_pixbuf));
+
+          cache_op->data.image.colorize_cache_pixbuf =
+            colorize_pixbuf (op->data.image.pixbuf, &color);
+          cache_op->data.image.colorize_cache_pixel = pixel;
+        }
+
+      src = op->data.image.colorize_cache_pixbuf;
+    }
+  else
+    src = op->data.image.pixbuf;
+
+  if (src == NULL)
+    return NULL;
+
+  entry.pixel = pixel;
+  entry.width = width;
+  entry.height = height;
+  entry.pixbuf = scale_and_alpha_pixbuf (src,
+                                         op->data.image.alpha_spec,
+                                         op->data.image.fill_type,
+                                         width, height,
+                                         op->data.image.vertical_stripes,
+                                         op->data.image.horizontal_stripes);
+  if (entry.pixbuf == NULL)
+    return NULL;
+
+  if (cache == NULL)
+    cache = cache_op->data.image.scale_cache =
+      g_new (MetaImageCacheEntry, IMAGE_SCALE_CACHE_SIZE);
+
+  if (op->data.image.scale_cache_len == IMAGE_SCALE_CACHE_SIZE)
+    {
+      g_object_unref (G_OBJECT (cache[IMAGE_SCALE_CACHE_SIZE - 1].pixbuf));
+      n_op_cache_evictions++;
+    }
+  else
+    cache_op->data.image.scale_cache_len++;
+
+  memmove (&cache[1], &cache[0],
+           (op->data.image.scale_cache_len - 1) * sizeof (MetaImageCacheEntry));
+  cache[0] = entry;
+  remember_cached_op (op);
+
+  return g_object_ref (G_OBJECT (entry.pixbuf));
+}
+
+/* Gradients are rendered through a cache on their draw op, so frames
+ * sharing the op reuse each other's pixbuf. A vertical gradient whose
+ * alpha doesn't change across it looks the same at any width, and a
+ * horizontal one at any height, so for those a cached pixbuf that is
+ * larger in that direction is reused as a subpixbuf. That way resizing
+ * a frame doesn't render its titlebar gradient again on every step.
+ */
+#define GRADIENT_CACHE_STEP 256
+
+static GdkPixbuf*
+draw_gradient_as_pixbuf (const MetaDrawOp *op,
+                         GtkStyleContext  *context,
+                         int               width,
+                         int               height)
+{
+  MetaGradientSpec *spec = op->data.gradient.gradient_spec;
+  MetaAlphaGradientSpec *alpha_spec = op->data.gradient.alpha_spec;
+  GdkPixbuf *pixbuf;
+  GdkRGBA *colors;
+  int n_colors;
+  int render_width, render_height;
+  gboolean any_width, any_height;
+
+  colors = render_gradient_colors (spec, context, &n_colors);
+  if (colors == NULL)
+    return NULL;
+
+  any_width = spec->type == META_GRADIENT_VERTICAL &&
+              (alpha_spec == NULL ||
+               alpha_spec->n_alphas == 1 ||
+               alpha_spec->type != META_GRADIENT_HORIZONTAL);
+  any_height = spec->type == META_GRADIENT_HORIZONTAL;
+
+  pixbuf = op->data.gradient.cache_pixbuf;
+
+  if (pixbuf &&
+      op->data.gradient.cache_n_colors == n_colors &&
+      memcmp (op->data.gradient.cache_colors, colors,
+              n_colors * sizeof (GdkRGBA)) == 0)
+    {
+      int cache_width = gdk_pixbuf_get_width (pixbuf);
+      int cache_height = gdk_pixbuf_get_height (pixbuf);
+
+      if ((cache_width == width || (any_width && cache_width > width)) &&
+          (cache_height == height || (any_height && cache_height > height)))
+        {
+          free (colors);
+          n_op_cache_hits++;
+          goto out;
+        }
+    }
+
+  n_op_cache_misses++;
+
+  render_width = width;
+  if (any_width)
+    render_width = GRADIENT_CACHE_STEP * ((width + GRADIENT_CACHE_STEP - 1) /
+                                          GRADIENT_CACHE_STEP);
+
+  render_height = height;
+  if (any_height)
+    render_height = GRADIENT_CACHE_STEP * ((height + GRADIENT_CACHE_STEP - 1) /
+                                           GRADIENT_CACHE_STEP);
+
+  pixbuf = meta_gradient_create_multi (render_width, render_height,
+                                       colors, n_colors,
+                                       spec->type);
+  if (pixbuf == NULL)
+    {
+      free (colors);
+      return NULL;
+    }
+
+  pixbuf = apply_alpha (pixbuf, alpha_spec, FALSE);
+
+  /* const cast here */
+  if (op->data.gradient.cache_pixbuf)
+    {
+      g_object_unref (G_OBJECT (op->data.gradient.cache_pixbuf));
+      n_op_cache_evictions++;
+    }
+  free (op->data.gradient.cache_colors);
+
+  ((MetaDrawOp*)op)->data.gradient.cache_pixbuf = pixbuf;
+  ((MetaDrawOp*)op)->data.gradient.cache_colors = colors;
+  ((MetaDrawOp*)op)->data.gradient.cache_n_colors = n_colors;
+  remember_cached_op (op);
+
+ out:
+  if (gdk_pixbuf_get_width (pixbuf) == width &&
+      gdk_pixbuf_get_height (pixbuf) == height)
+    return g_object_ref (pixbuf);
+
+  return gdk_pixbuf_new_subpixbuf (pixbuf, 0, 0, width, height);
+}
+
 static GdkPixbuf*
 draw_op_as_pixbuf (const MetaDrawOp    *op,
                    GtkStyleContext     *context,
@@ -3452,6 +4284,9 @@ draw_op_as_pixbuf (const MetaDrawOp    *op,
    * if the op can't be converted to an equivalent pixbuf.
    */
   GdkPixbuf *pixbuf;
+  gint64 start;
+
+  start = profile_begin ();
 
   pixbuf = NULL;
 
@@ -3532,60 +4367,14 @@ draw_op_as_pixbuf (const MetaDrawOp    *op,
 
     case META_DRAW_GRADIENT:
       {
-        pixbuf = meta_gradient_spec_render (op->data.gradient.gradient_spec,
-                                            context, width, height);
-
-        pixbuf = apply_alpha (pixbuf,
-                              op->data.gradient.alpha_spec,
-                              FALSE);
+        pixbuf = draw_gradient_as_pixbuf (op, context, width, height);
       }
       break;
 
 
     case META_DRAW_IMAGE:
-      {
-	if (op->data.image.colorize_spec)
-	  {
-	    GdkRGBA color;
-
-            meta_color_spec_render (op->data.image.colorize_spec,
-                                    context, &color);
-
-            if (op->data.image.colorize_cache_pixbuf == NULL ||
-                op->data.image.colorize_cache_pixel != GDK_COLOR_RGB (color))
-              {
-                if (op->data.image.colorize_cache_pixbuf)
-                  g_object_unref (G_OBJECT (op->data.image.colorize_cache_pixbuf));
-
-                /* const cast here */
-                ((MetaDrawOp*)op)->data.image.colorize_cache_pixbuf =
-                  colorize_pixbuf (op->data.image.pixbuf,
-                                   &color);
-                ((MetaDrawOp*)op)->data.image.colorize_cache_pixel =
-                  GDK_COLOR_RGB (color);
-              }
-
-            if (op->data.image.colorize_cache_pixbuf)
-              {
-                pixbuf = scale_and_alpha_pixbuf (op->data.image.colorize_cache_pixbuf,
-                                                 op->data.image.alpha_spec,
-                                                 op->data.image.fill_type,
-                                                 width, height,
-                                                 op->data.image.vertical_stripes,
-                                                 op->data.image.horizontal_stripes);
-              }
-	  }
-	else
-	  {
-	    pixbuf = scale_and_alpha_pixbuf (op->data.image.pixbuf,
-                                             op->data.image.alpha_spec,
-                                             op->data.image.fill_type,
-                                             width, height,
-                                             op->data.image.vertical_stripes,
-                                             op->data.image.horizontal_stripes);
-	  }
-        break;
-      }
+      pixbuf = draw_image_as_pixbuf (op, context, width, height);
+      break;
 
     case META_DRAW_GTK_ARROW:
     case META_DRAW_GTK_BOX:
@@ -3603,6 +4392,8 @@ draw_op_as_pixbuf (const MetaDrawOp    *op,
       break;
     }
 
+  profile_end (META_THEME_PROFILE_PIXBUFS, start);
+
   return pixbuf;
 }
 
@@ -5344,6 +6135,158 @@ meta_theme_validate (MetaTheme *theme,
   return TRUE;
 }
 
+/*
+ * Decoded theme images are kept under the user cache directory, so
+ * that starting up or switching back to a theme maps the pixels of
+ * each image instead of decoding it again. A cached image is the header
+ * below followed by the pixbuf's pixels, and is only used while the
+ * source file keeps the size and modification time it was decoded from.
+ */
+#define THEME_IMAGE_CACHE_MAGIC   0x4d544943 /* "CITM" */
+#define THEME_IMAGE_CACHE_VERSION 1
+
+typedef struct
+{
+  guint32 magic;
+  guint32 version;
+  gint64  mtime;
+  gint64  size;
+  gint32  width;
+  gint32  height;
+  gint32  rowstride;
+  gint32  has_alpha;
+} ThemeImageCacheHeader;
+
+static char *
+theme_image_cache_file (const char *full_path,
+                        guint       scale)
+{
+  char *key;
+  char *checksum;
+  char *filename;
+
+  /* Another gdk-pixbuf may well decode the same file differently */
+  key = g_strdup_printf ("%s %u %s", full_path, scale, GDK_PIXBUF_VERSION);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+
+  filename = g_build_filename (g_get_user_cache_dir (),
+                               "muffin", "theme-images", checksum, NULL);
+
+  g_free (checksum);
+  g_free (key);
+
+  return filename;
+}
+
+static gsize
+theme_image_cache_pixels_length (const ThemeImageCacheHeader *header)
+{
+  int n_channels = header->has_alpha ? 4 : 3;
+
+  return (gsize) header->rowstride * (header->height - 1) +
+         header->width * n_channels;
+}
+
+static void
+theme_image_cache_unmap (guchar   *pixels,
+                         gpointer  data)
+{
+  g_mapped_file_unref (data);
+}
+
+static GdkPixbuf *
+theme_image_cache_load (const char     *cache_file,
+                        const GStatBuf *source)
+{
+  ThemeImageCacheHeader header;
+  GMappedFile *mapped;
+  char *contents;
+  gsize length;
+
+  /* Mapped privately so a pixbuf written to doesn't touch the file */
+  mapped = g_mapped_file_new (cache_file, TRUE, NULL);
+  if (mapped == NULL)
+    return NULL;
+
+  contents = g_mapped_file_get_contents (mapped);
+  length = g_mapped_file_get_length (mapped);
+
+  if (length < sizeof (header))
+    goto fail;
+
+  memcpy (&header, contents, sizeof (header));
+
+  if (header.magic != THEME_IMAGE_CACHE_MAGIC ||
+      header.version != THEME_IMAGE_CACHE_VERSION ||
+      header.mtime != source->st_mtime ||
+      header.size != source->st_size ||
+      header.width <= 0 || header.height <= 0 ||
+      header.rowstride < header.width * (header.has_alpha ? 4 : 3) ||
+      length != sizeof (header) + theme_image_cache_pixels_length (&header))
+    goto fail;
+
+  return gdk_pixbuf_new_from_data ((guchar *) contents + sizeof (header),
+                                   GDK_COLORSPACE_RGB,
+                                   header.has_alpha,
+                                   8,
+                                   header.width,
+                                   header.height,
+                                   header.rowstride,
+                                   theme_image_cache_unmap,
+                                   mapped);
+
+ fail:
+  g_mapped_file_unref (mapped);
+  return NULL;
+}
+
+static void
+theme_image_cache_store (const char     *cache_file,
+                         const GStatBuf *source,
+                         GdkPixbuf      *pixbuf)
+{
+  ThemeImageCacheHeader header;
+  GError *error = NULL;
+  char *contents;
+  char *dir;
+  gsize length;
+
+  if (gdk_pixbuf_get_colorspace (pixbuf) != GDK_COLORSPACE_RGB ||
+      gdk_pixbuf_get_bits_per_sample (pixbuf) != 8 ||
+      gdk_pixbuf_get_n_channels (pixbuf) !=
+        (gdk_pixbuf_get_has_alpha (pixbuf) ? 4 : 3))
+    return;
+
+  memset (&header, 0, sizeof (header));
+  header.magic = THEME_IMAGE_CACHE_MAGIC;
+  header.version = THEME_IMAGE_CACHE_VERSION;
+  header.mtime = source->st_mtime;
+  header.size = source->st_size;
+  header.width = gdk_pixbuf_get_width (pixbuf);
+  header.height = gdk_pixbuf_get_height (pixbuf);
+  header.rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  header.has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+
+  length = theme_image_cache_pixels_length (&header);
+  contents = g_malloc (sizeof (header) + length);
+  memcpy (contents, &header, sizeof (header));
+  memcpy (contents + sizeof (header), gdk_pixbuf_get_pixels (pixbuf), length);
+
+  dir = g_path_get_dirname (cache_file);
+
+  if (g_mkdir_with_parents (dir, 0700) != 0 ||
+      !g_file_set_contents (cache_file, contents,
+                            sizeof (header) + length, &error))
+    {
+      meta_topic (META_DEBUG_THEMES, "Failed to cache theme image in %s: %s\n",
+                  cache_file, error ? error->message : g_strerror (errno));
+      g_clear_error (&error);
+    }
+
+  g_free (dir);
+  g_free (contents);
+}
+
 /**
  * meta_theme_load_image: (skip)
  *
@@ -5376,27 +6319,44 @@ meta_theme_load_image (MetaTheme  *theme,
       else
         {
           char *full_path;
+          char *cache_file = NULL;
+          GStatBuf source;
           gint width, height;
 
           full_path = g_build_filename (theme->dirname, filename, NULL);
 
-          if (gdk_pixbuf_get_file_info (full_path, &width, &height) == NULL)
+          if (g_stat (full_path, &source) == 0)
             {
-              g_free (full_path);
-              return NULL;
+              cache_file = theme_image_cache_file (full_path, scale);
+              pixbuf = theme_image_cache_load (cache_file, &source);
             }
 
-          width *= scale;
-          height *= scale;
-
-          pixbuf = gdk_pixbuf_new_from_file_at_size (full_path, width, height, error);
-
           if (pixbuf == NULL)
             {
-              g_free (full_path);
-              return NULL;
+              if (gdk_pixbuf_get_file_info (full_path, &width, &height) == NULL)
+                {
+                  g_free (cache_file);
+                  g_free (full_path);
+                  return NULL;
+                }
+
+              width *= scale;
+              height *= scale;
+
+              pixbuf = gdk_pixbuf_new_from_file_at_size (full_path, width, height, error);
+
+              if (pixbuf == NULL)
+                {
+                  g_free (cache_file);
+                  g_free (full_path);
+                  return NULL;
+                }
+
+              if (cache_file)
+                theme_image_cache_store (cache_file, &source, pixbuf);
             }
 
+          g_free (cache_file);
           g_free (full_path);
         }
       g_hash_table_replace (theme->images_by_filename,
@@ -0,0 +1,690 @@
+/* Compositor benchmark client */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Suite 500, Boston, MA
+ * 02110-1335, USA.
+ */
+
+/*
+ * Maps a number of windows that draw with a chosen damage pattern,
+ * optionally with ARGB visuals, shape masks and property storms, and
+ * uses the extended _NET_WM_SYNC_REQUEST_COUNTER protocol so that the
+ * compositor reports each frame with _NET_WM_FRAME_DRAWN and
+ * _NET_WM_FRAME_TIMINGS. When the run is over a JSON summary of the
+ * frame times is written to stdout, or to the file given by --output.
+ */
+
+#include <glib.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/shape.h>
+#include <X11/extensions/sync.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+
+typedef enum
+{
+  PATTERN_FULL,
+  PATTERN_BLINK,
+  PATTERN_SCROLL
+} Pattern;
+
+typedef struct
+{
+  Window window;
+  GC gc;
+  int index;
+  gboolean mapped;
+
+  XSyncCounter basic_counter;
+  XSyncCounter extended_counter;
+  gint64 counter_value;
+  /* Serial the window manager asked for with _NET_WM_SYNC_REQUEST */
+  gint64 requested_value;
+
+  guint frame;
+  guint frames_submitted;
+  guint frames_drawn;
+  guint frames_presented;
+  guint properties_changed;
+
+  /* Client times, by serial, of the frames not yet drawn */
+  GHashTable *pending_frames;
+  /* Server time of the last _NET_WM_FRAME_DRAWN */
+  gint64 last_drawn_time;
+} BenchWindow;
+
+static Display *xdisplay;
+static Atom atom_wm_protocols;
+static Atom atom_wm_delete_window;
+static Atom atom_net_wm_name;
+static Atom atom_utf8_string;
+static Atom atom_net_wm_sync_request;
+static Atom atom_net_wm_sync_request_counter;
+static Atom atom_net_wm_frame_drawn;
+static Atom atom_net_wm_frame_timings;
+
+static int n_windows = 4;
+static int window_width = 400;
+static int window_height = 300;
+static char *pattern_name = NULL;
+static double fps = 60;
+static double duration = 10;
+static double property_rate = 0;
+static gboolean use_argb = FALSE;
+static gboolean use_shape = FALSE;
+static gboolean no_frame_sync = FALSE;
+static char *output = NULL;
+
+static GOptionEntry options[] = {
+  { "windows", 'n', 0, G_OPTION_ARG_INT, &n_windows,
+    "Number of windows (default 4)", "N" },
+  { "width", 0, 0, G_OPTION_ARG_INT, &window_width,
+    "Window width (default 400)", "PIXELS" },
+  { "height", 0, 0, G_OPTION_ARG_INT, &window_height,
+    "Window height (default 300)", "PIXELS" },
+  { "pattern", 'p', 0, G_OPTION_ARG_STRING, &pattern_name,
+    "Damage pattern: full, blink or scroll (default full)", "PATTERN" },
+  { "fps", 0, 0, G_OPTION_ARG_DOUBLE, &fps,
+    "Frames drawn per second by each window (default 60)", "RATE" },
+  { "duration", 'd', 0, G_OPTION_ARG_DOUBLE, &duration,
+    "Length of the run in seconds (default 10)", "SECONDS" },
+  { "property-rate", 0, 0, G_OPTION_ARG_DOUBLE, &property_rate,
+    "Title changes per second by each window (default 0)", "RATE" },
+  { "argb", 0, 0, G_OPTION_ARG_NONE, &use_argb,
+    "Use a 32-bit ARGB visual", NULL },
+  { "shape", 0, 0, G_OPTION_ARG_NONE, &use_shape,
+    "Give the windows a bounding shape", NULL },
+  { "no-frame-sync", 0, 0, G_OPTION_ARG_NONE, &no_frame_sync,
+    "Don't use the frame sync protocol", NULL },
+  { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+    "Write the results to FILE instead of stdout", "FILE" },
+  { NULL }
+};
+
+/* Samples in microseconds */
+static GArray *frame_intervals;
+static GArray *drawn_latencies;
+static GArray *presentation_offsets;
+
+static gint64
+server_time_from_message (long low, long high)
+{
+  return ((gint64) (guint32) high << 32) | (guint32) low;
+}
+
+static void
+set_counter (XSyncCounter counter,
+             gint64       value)
+{
+  XSyncValue sync_value;
+
+  XSyncIntsToValue (&sync_value,
+                    value & G_GINT64_CONSTANT (0xffffffff),
+                    value >> 32);
+  XSyncSetCounter (xdisplay, counter, sync_value);
+}
+
+static void
+set_shape (BenchWindow *bw)
+{
+  XRectangle rects[3];
+  int notch = MIN (window_width, window_height) / 8;
+
+  /* A cross with the corners cut out, so the shape has a few
+   * rectangles but every pattern stays visible */
+  rects[0].x = notch;
+  rects[0].y = 0;
+  rects[0].width = window_width - 2 * notch;
+  rects[0].height = notch;
+  rects[1].x = 0;
+  rects[1].y = notch;
+  rects[1].width = window_width;
+  rects[1].height = window_height - 2 * notch;
+  rects[2].x = notch;
+  rects[2].y = window_height - notch;
+  rects[2].width = window_width - 2 * notch;
+  rects[2].height = notch;
+
+  XShapeCombineRectangles (xdisplay, bw->window, ShapeBounding, 0, 0,
+                           rects, G_N_ELEMENTS (rects), ShapeSet, Unsorted);
+}
+
+static void
+create_window (BenchWindow *bw,
+               int          index)
+{
+  XSetWindowAttributes attrs;
+  unsigned long mask;
+  XVisualInfo visual_info;
+  Visual *visual;
+  int depth;
+  Atom protocols[2];
+  int n_protocols = 0;
+  char *title;
+
+  memset (bw, 0, sizeof (BenchWindow));
+  bw->index = index;
+  bw->pending_frames = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                              g_free, g_free);
+
+  visual = DefaultVisual (xdisplay, DefaultScreen (xdisplay));
+  depth = DefaultDepth (xdisplay, DefaultScreen (xdisplay));
+
+  attrs.background_pixel = 0;
+  attrs.border_pixel = 0;
+  attrs.event_mask = ExposureMask | StructureNotifyMask;
+  mask = CWBackPixel | CWBorderPixel | CWEventMask;
+
+  if (use_argb)
+    {
+      if (XMatchVisualInfo (xdisplay, DefaultScreen (xdisplay), 32,
+                            TrueColor, &visual_info))
+        {
+          visual = visual_info.visual;
+          depth = 32;
+          attrs.colormap = XCreateColormap (xdisplay,
+                                            DefaultRootWindow (xdisplay),
+                                            visual, AllocNone);
+          mask |= CWColormap;
+        }
+      else
+        g_printerr ("No 32-bit visual, using the default one\n");
+    }
+
+  bw->window = XCreateWindow (xdisplay, DefaultRootWindow (xdisplay),
+                              (index % 8) * 40, (index % 8) * 30,
+                              window_width, window_height, 0,
+                              depth, InputOutput, visual, mask, &attrs);
+  bw->gc = XCreateGC (xdisplay, bw->window, 0, NULL);
+
+  title = g_strdup_printf ("bench-compositor %d", index);
+  XStoreName (xdisplay, bw->window, title);
+  g_free (title);
+
+  protocols[n_protocols++] = atom_wm_delete_window;
+
+  if (!no_frame_sync)
+    {
+      XSyncValue zero;
+      long counters[2];
+
+      XSyncIntToValue (&zero, 0);
+      bw->basic_counter = XSyncCreateCounter (xdisplay, zero);
+      bw->extended_counter = XSyncCreateCounter (xdisplay, zero);
+
+      counters[0] = bw->basic_counter;
+      counters[1] = bw->extended_counter;
+      XChangeProperty (xdisplay, bw->window,
+                       atom_net_wm_sync_request_counter,
+                       XA_CARDINAL, 32, PropModeReplace,
+                       (unsigned char *) counters, 2);
+
+      protocols[n_protocols++] = atom_net_wm_sync_request;
+    }
+
+  XSetWMProtocols (xdisplay, bw->window, protocols, n_protocols);
+
+  if (use_shape)
+    set_shape (bw);
+
+  XMapWindow (xdisplay, bw->window);
+}
+
+static unsigned long
+frame_color (guint frame)
+{
+  /* Opaque, and in ARGB visuals also premultiplied */
+  static const unsigned long colors[] = {
+    0xffcc3333, 0xff33cc33, 0xff3333cc, 0xffcccc33
+  };
+
+  return colors[frame % G_N_ELEMENTS (colors)];
+}
+
+static void
+draw_frame (BenchWindow *bw,
+            Pattern      pattern)
+{
+  int step;
+
+  switch (pattern)
+    {
+    case PATTERN_FULL:
+      XSetForeground (xdisplay, bw->gc, frame_color (bw->frame));
+      XFillRectangle (xdisplay, bw->window, bw->gc,
+                      0, 0, window_width, window_height);
+      break;
+    case PATTERN_BLINK:
+      /* A text cursor somewhere in the middle of the window */
+      XSetForeground (xdisplay, bw->gc,
+                      bw->frame % 2 ? frame_color (0) : 0xff000000);
+      XFillRectangle (xdisplay, bw->window, bw->gc,
+                      window_width / 2, window_height / 2, 2, 16);
+      break;
+    case PATTERN_SCROLL:
+      step = MAX (window_height / 30, 1);
+      XCopyArea (xdisplay, bw->window, bw->window, bw->gc,
+                 0, step, window_width, window_height - step, 0, 0);
+      XSetForeground (xdisplay, bw->gc, frame_color (bw->frame));
+      XFillRectangle (xdisplay, bw->window, bw->gc,
+                      0, window_height - step, window_width, step);
+      break;
+    }
+
+  bw->frame++;
+}
+
+static void
+submit_frame (BenchWindow *bw,
+              Pattern      pattern)
+{
+  gint64 *serial;
+  gint64 *start;
+
+  if (no_frame_sync)
+    {
+      draw_frame (bw, pattern);
+      bw->frames_submitted++;
+      return;
+    }
+
+  /* An odd value tells the compositor a frame is being drawn, the
+   * following even value that it is complete */
+  if (bw->counter_value % 2 == 0)
+    {
+      bw->counter_value++;
+      set_counter (bw->extended_counter, bw->counter_value);
+    }
+
+  draw_frame (bw, pattern);
+
+  bw->counter_value++;
+  if (bw->requested_value > bw->counter_value)
+    bw->counter_value = bw->requested_value + bw->requested_value % 2;
+  set_counter (bw->extended_counter, bw->counter_value);
+
+  serial = g_new (gint64, 1);
+  *serial = bw->counter_value;
+  start = g_new (gint64, 1);
+  *start = g_get_monotonic_time ();
+  g_hash_table_replace (bw->pending_frames, serial, start);
+
+  bw->frames_submitted++;
+}
+
+static void
+change_property (BenchWindow *bw)
+{
+  char *title;
+
+  title = g_strdup_printf ("bench-compositor %d (%u)",
+                           bw->index, bw->properties_changed++);
+  XChangeProperty (xdisplay, bw->window, atom_net_wm_name,
+                   atom_utf8_string, 8, PropModeReplace,
+                   (unsigned char *) title, strlen (title));
+  g_free (title);
+}
+
+static BenchWindow *
+find_window (BenchWindow *windows,
+             Window       xwindow)
+{
+  int i;
+
+  for (i = 0; i < n_windows; i++)
+    if (windows[i].window == xwindow)
+      return &windows[i];
+
+  return NULL;
+}
+
+static void
+handle_frame_drawn (BenchWindow *bw,
+                    XClientMessageEvent *event)
+{
+  gint64 serial = server_time_from_message (event->data.l[0],
+                                            event->data.l[1]);
+  gint64 drawn_time = server_time_from_message (event->data.l[2],
+                                                event->data.l[3]);
+  gint64 *start;
+
+  bw->frames_drawn++;
+
+  start = g_hash_table_lookup (bw->pending_frames, &serial);
+  if (start != NULL)
+    {
+      gint64 latency = g_get_monotonic_time () - *start;
+
+      g_array_append_val (drawn_latencies, latency);
+      g_hash_table_remove (bw->pending_frames, &serial);
+    }
+
+  if (bw->last_drawn_time != 0 && drawn_time > bw->last_drawn_time)
+    {
+      gint64 interval = drawn_time - bw->last_drawn_time;
+
+      g_array_append_val (frame_intervals, interval);
+    }
+
+  bw->last_drawn_time = drawn_time;
+}
+
+static void
+handle_frame_timings (BenchWindow *bw,
+                      XClientMessageEvent *event)
+{
+  /* Zero when the presentation time isn't known */
+  gint64 offset = (gint32) event->data.l[2];
+
+  if (offset == 0)
+    return;
+
+  bw->frames_presented++;
+  g_array_append_val (presentation_offsets, offset);
+}
+
+static void
+handle_event (BenchWindow *windows,
+              XEvent      *event)
+{
+  BenchWindow *bw = find_window (windows, event->xany.window);
+
+  if (bw == NULL)
+    return;
+
+  switch (event->type)
+    {
+    case MapNotify:
+      bw->mapped = TRUE;
+      break;
+    case UnmapNotify:
+      bw->mapped = FALSE;
+      break;
+    case ClientMessage:
+      if (event->xclient.message_type == atom_net_wm_frame_drawn)
+        handle_frame_drawn (bw, &event->xclient);
+      else if (event->xclient.message_type == atom_net_wm_frame_timings)
+        handle_frame_timings (bw, &event->xclient);
+      else if (event->xclient.message_type == atom_wm_protocols &&
+               (Atom) event->xclient.data.l[0] == atom_net_wm_sync_request)
+        bw->requested_value = server_time_from_message (event->xclient.data.l[2],
+                                                        event->xclient.data.l[3]);
+      break;
+    default:
+      break;
+    }
+}
+
+static int
+compare_samples (gconstpointer a,
+                 gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a;
+  gint64 y = *(const gint64 *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void
+print_samples (FILE       *out,
+               const char *name,
+               GArray     *samples,
+               gboolean    last)
+{
+  gint64 total = 0;
+  guint i;
+
+  fprintf (out, "  \"%s\": { \"count\": %u", name, samples->len);
+
+  if (samples->len > 0)
+    {
+      g_array_sort (samples, compare_samples);
+
+      for (i = 0; i < samples->len; i++)
+        total += g_array_index (samples, gint64, i);
+
+      fprintf (out,
+               ", \"mean\": %.1f, \"p50\": %" G_GINT64_FORMAT
+               ", \"p90\": %" G_GINT64_FORMAT ", \"p99\": %" G_GINT64_FORMAT
+               ", \"max\": %" G_GINT64_FORMAT,
+               total / (double) samples->len,
+               g_array_index (samples, gint64, samples->len / 2),
+               g_array_index (samples, gint64, samples->len * 90 / 100),
+               g_array_index (samples, gint64, samples->len * 99 / 100),
+               g_array_index (samples, gint64, samples->len - 1));
+    }
+
+  fprintf (out, " }%s\n", last ? "" : ",");
+}
+
+static void
+print_results (FILE        *out,
+               BenchWindow *windows,
+               double       elapsed)
+{
+  int i;
+
+  fprintf (out, "{\n");
+  fprintf (out, "  \"windows\": %d,\n", n_windows);
+  fprintf (out, "  \"width\": %d,\n", window_width);
+  fprintf (out, "  \"height\": %d,\n", window_height);
+  fprintf (out, "  \"pattern\": \"%s\",\n", pattern_name);
+  fprintf (out, "  \"fps\": %.1f,\n", fps);
+  fprintf (out, "  \"property_rate\": %.1f,\n", property_rate);
+  fprintf (out, "  \"argb\": %s,\n", use_argb ? "true" : "false");
+  fprintf (out, "  \"shape\": %s,\n", use_shape ? "true" : "false");
+  fprintf (out, "  \"frame_sync\": %s,\n", no_frame_sync ? "false" : "true");
+  fprintf (out, "  \"elapsed_s\": %.3f,\n", elapsed);
+
+  fprintf (out, "  \"per_window\": [\n");
+  for (i = 0; i < n_windows; i++)
+    fprintf (out,
+             "    { \"submitted\": %u, \"drawn\": %u, \"presented\": %u,"
+             " \"properties\": %u }%s\n",
+             windows[i].frames_submitted, windows[i].frames_drawn,
+             windows[i].frames_presented, windows[i].properties_changed,
+             i == n_windows - 1 ? "" : ",");
+  fprintf (out, "  ],\n");
+
+  /* All in microseconds */
+  print_samples (out, "frame_interval_us", frame_intervals, FALSE);
+  print_samples (out, "drawn_latency_us", drawn_latencies, FALSE);
+  print_samples (out, "presentation_offset_us", presentation_offsets, TRUE);
+  fprintf (out, "}\n");
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  BenchWindow *windows;
+  Pattern pattern;
+  gint64 start_time, end_time, now;
+  gint64 next_frame, frame_period;
+  gint64 next_property, property_period;
+  int event_base, error_base, major, minor;
+  FILE *out;
+  int i;
+
+  context = g_option_context_new ("- load the compositor with synthetic clients");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (pattern_name == NULL)
+    pattern_name = g_strdup ("full");
+
+  if (strcmp (pattern_name, "full") == 0)
+    pattern = PATTERN_FULL;
+  else if (strcmp (pattern_name, "blink") == 0)
+    pattern = PATTERN_BLINK;
+  else if (strcmp (pattern_name, "scroll") == 0)
+    pattern = PATTERN_SCROLL;
+  else
+    {
+      g_printerr ("Unknown pattern %s\n", pattern_name);
+      return 1;
+    }
+
+  if (n_windows <= 0 || window_width <= 0 || window_height <= 0 ||
+      fps <= 0 || duration <= 0 || property_rate < 0)
+    {
+      g_printerr ("Invalid option values\n");
+      return 1;
+    }
+
+  xdisplay = XOpenDisplay (NULL);
+  if (xdisplay == NULL)
+    {
+      g_printerr ("Could not open display\n");
+      return 1;
+    }
+
+  if (!no_frame_sync &&
+      !(XSyncQueryExtension (xdisplay, &event_base, &error_base) &&
+        XSyncInitialize (xdisplay, &major, &minor)))
+    {
+      g_printerr ("No XSync extension, running without frame sync\n");
+      no_frame_sync = TRUE;
+    }
+
+  atom_wm_protocols = XInternAtom (xdisplay, "WM_PROTOCOLS", False);
+  atom_wm_delete_window = XInternAtom (xdisplay, "WM_DELETE_WINDOW", False);
+  atom_net_wm_name = XInternAtom (xdisplay, "_NET_WM_NAME", False);
+  atom_utf8_string = XInternAtom (xdisplay, "UTF8_STRING", False);
+  atom_net_wm_sync_request =
+    XInternAtom (xdisplay, "_NET_WM_SYNC_REQUEST", False);
+  atom_net_wm_sync_request_counter =
+    XInternAtom (xdisplay, "_NET_WM_SYNC_REQUEST_COUNTER", False);
+  atom_net_wm_frame_drawn =
+    XInternAtom (xdisplay, "_NET_WM_FRAME_DRAWN", False);
+  atom_net_wm_frame_timings =
+    XInternAtom (xdisplay, "_NET_WM_FRAME_TIMINGS", False);
+
+  frame_intervals = g_array_new (FALSE, FALSE, sizeof (gint64));
+  drawn_latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+  presentation_offsets = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  windows = g_new (BenchWindow, n_windows);
+  for (i = 0; i < n_windows; i++)
+    create_window (&windows[i], i);
+  XFlush (xdisplay);
+
+  frame_period = G_USEC_PER_SEC / fps;
+  property_period = property_rate > 0 ? G_USEC_PER_SEC / property_rate : 0;
+
+  start_time = g_get_monotonic_time ();
+  end_time = start_time + duration * G_USEC_PER_SEC;
+  next_frame = start_time;
+  next_property = start_time + property_period;
+
+  while ((now = g_get_monotonic_time ()) < end_time)
+    {
+      gint64 next_wakeup;
+      struct timeval timeout;
+      fd_set fds;
+
+      while (XPending (xdisplay))
+        {
+          XEvent event;
+
+          XNextEvent (xdisplay, &event);
+          handle_event (windows, &event);
+        }
+
+      if (now >= next_frame)
+        {
+          for (i = 0; i < n_windows; i++)
+            if (windows[i].mapped)
+              submit_frame (&windows[i], pattern);
+
+          /* Don't try to catch up with frames we were too slow for */
+          next_frame += frame_period;
+          if (next_frame < now)
+            next_frame = now + frame_period;
+        }
+
+      if (property_period && now >= next_property)
+        {
+          for (i = 0; i < n_windows; i++)
+            change_property (&windows[i]);
+
+          next_property += property_period;
+          if (next_property < now)
+            next_property = now + property_period;
+        }
+
+      XFlush (xdisplay);
+
+      next_wakeup = next_frame;
+      if (property_period)
+        next_wakeup = MIN (next_wakeup, next_property);
+      next_wakeup = MAX (next_wakeup - g_get_monotonic_time (), 0);
+
+      timeout.tv_sec = next_wakeup / G_USEC_PER_SEC;
+      timeout.tv_usec = next_wakeup % G_USEC_PER_SEC;
+
+      FD_ZERO (&fds);
+      FD_SET (ConnectionNumber (xdisplay), &fds);
+      if (select (ConnectionNumber (xdisplay) + 1, &fds, NULL, NULL,
+                  &timeout) < 0 && errno != EINTR)
+        break;
+    }
+
+  if (output != NULL)
+    {
+      out = fopen (output, "w");
+      if (out == NULL)
+        {
+          g_printerr ("Could not open %s: %s\n", output, g_strerror (errno));
+          return 1;
+        }
+    }
+  else
+    out = stdout;
+
+  print_results (out, windows, (now - start_time) / (double) G_USEC_PER_SEC);
+
+  if (out != stdout)
+    fclose (out);
+
+  for (i = 0; i < n_windows; i++)
+    {
+      if (!no_frame_sync)
+        {
+          XSyncDestroyCounter (xdisplay, windows[i].basic_counter);
+          XSyncDestroyCounter (xdisplay, windows[i].extended_counter);
+        }
+      XFreeGC (xdisplay, windows[i].gc);
+      XDestroyWindow (xdisplay, windows[i].window);
+      g_hash_table_destroy (windows[i].pending_frames);
+    }
+
+  XCloseDisplay (xdisplay);
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# Runs bench-compositor against a muffin started on its own Xvfb server,
+# with software GL and a virtual refresh rate, so that compositor
+# performance can be compared between runs on machines without a
+# display or a GPU.
+#
+# Usage: bench-headless.sh [bench-compositor options]
+#
+# MUFFIN, BENCH_COMPOSITOR, HEADLESS_DISPLAY, HEADLESS_SCREEN and
+# HEADLESS_REFRESH override the defaults below.
+
+MUFFIN=${MUFFIN:-../muffin}
+BENCH_COMPOSITOR=${BENCH_COMPOSITOR:-./bench-compositor}
+HEADLESS_DISPLAY=${HEADLESS_DISPLAY:-:99}
+HEADLESS_SCREEN=${HEADLESS_SCREEN:-1920x1080x24}
+HEADLESS_REFRESH=${HEADLESS_REFRESH:-60}
+
+for tool in Xvfb xdpyinfo; do
+        command -v $tool > /dev/null || {
+                echo "$0: $tool is needed to run the headless benchmark" >&2
+                exit 1
+        }
+done
+
+Xvfb $HEADLESS_DISPLAY -screen 0 $HEADLESS_SCREEN -nolisten tcp +extension GLX &
+xvfb_pid=$!
+
+muffin_pid=
+cleanup () {
+        test -n "$muffin_pid" && kill $muffin_pid 2> /dev/null
+        kill $xvfb_pid 2> /dev/null
+        wait 2> /dev/null
+}
+trap cleanup EXIT INT TERM
+
+DISPLAY=$HEADLESS_DISPLAY
+export DISPLAY
+
+# Wait for the server to accept connections
+tries=0
+until xdpyinfo > /dev/null 2>&1; do
+        tries=`expr $tries + 1`
+        test $tries -gt 50 && {
+                echo "$0: Xvfb did not start on $HEADLESS_DISPLAY" >&2
+                exit 1
+        }
+        sleep 0.1
+done
+
+LIBGL_ALWAYS_SOFTWARE=1 \
+CLUTTER_VBLANK=none \
+CLUTTER_VIRTUAL_REFRESH=$HEADLESS_REFRESH \
+        $MUFFIN --replace --sm-disable &
+muffin_pid=$!
+
+# Give muffin time to manage the screen before the clients map
+sleep 2
+
+$BENCH_COMPOSITOR "$@"
+exit $?